@@ -0,0 +1,515 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       CPU Benchmark
+//  Workfile:        cpu_bench.cpp
+//  Revision:        1.0 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Micro-benchmarks of the pure-CPU hot paths of CRPI:  matrix products and
+//  inverses, RPY conversion, CRPI and CRCL XML command parsing, UR real-time
+//  frame and KRC2 reply decoding, and k-means re-clustering.  Each benchmark
+//  is calibrated to run for a minimum time, repeated, and reported as the
+//  median and minimum cost per operation.  Parsers are fed the recorded
+//  inputs in samples/ (or another directory given with --samples):
+//
+//    ur_cb3_frames.bin   UR CB3 real-time frames as sent (1044 bytes each)
+//    krc2_replies.txt    KUKA KRC2 replies, one per line
+//    crpi_stream.xml     CRPI XML commands, one per line
+//    crcl_stream.xml     CRCL command instances, one per line
+//
+//  Usage:  cpu_bench [--filter TEXT] [--samples DIR] [--min-time S]
+//                    [--repetitions N] [--json FILE] [--list]
+//
+//  --json writes the results in Google Benchmark's JSON layout, so runs can
+//  be compared with its tools:  one "iteration" entry per repetition and
+//  the median as an "aggregate" entry.  perf_check.py compares them with a
+//  stored baseline.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "../../Libraries/Math/MatrixMath.h"
+#include "../../Libraries/CRPI/crpi_xml.h"
+#include "../../Libraries/CRPI/crpi_parse.h"
+#include "../../Clustering/kMeans/kMeansCluster.h"
+
+using namespace std;
+using namespace Math;
+using namespace Xml;
+using namespace Clustering;
+
+//! @brief Default minimum time (s) per repetition and number of repetitions
+//!
+#define BENCH_MIN_TIME 0.2
+#define BENCH_REPETITIONS 5
+
+//! @brief Size of the k-means problem:  patterns, feature dimensions, and clusters
+//!
+#define BENCH_KMEANS_PATTERNS 4096
+#define BENCH_KMEANS_DIMS 8
+#define BENCH_KMEANS_CLUSTERS 16
+
+//! @brief Bytes of each KRC2 reply examined (as in CrpiKukaLWR::parseFeedback) and values parsed
+//!
+#define BENCH_KRC2_BYTES 80
+#define BENCH_KRC2_VALUES 8
+
+//! @brief Accumulated so the compiler cannot discard the operations being timed
+//!
+static volatile double sink = 0.0;
+
+//! @brief A benchmark:  fn runs the operation being measured n times
+//!
+struct benchCase
+{
+  string name;
+  function<void (size_t)> fn;
+};
+
+//! @brief Result of one benchmark
+//!
+struct benchResult
+{
+  string name;
+  size_t iterations;
+  double median;
+  double min;
+  vector<double> samples; //! Cost per operation of each repetition, in run order
+};
+
+//! @brief Recorded inputs for the parsers
+//!
+struct benchSamples
+{
+  vector<vector<char> > urFrames;
+  vector<vector<char> > krc2Replies;
+  vector<string> crpiCommands;
+  vector<string> crclCommands;
+};
+
+
+//! @brief Read a text file, one entry per line
+//!
+static bool readLines (const string &path, vector<string> &out)
+{
+  ifstream in(path.c_str());
+  string line;
+  if (!in)
+  {
+    return false;
+  }
+  while (getline(in, line))
+  {
+    if (!line.empty() && line[line.size() - 1] == '\r')
+    {
+      line.erase(line.size() - 1);
+    }
+    if (!line.empty())
+    {
+      out.push_back(line);
+    }
+  }
+  return !out.empty();
+}
+
+
+//! @brief Read a stream of UR real-time frames, each starting with its big-endian length
+//!
+static bool readFrames (const string &path, vector<vector<char> > &out)
+{
+  ifstream in(path.c_str(), ios::binary);
+  char header[4];
+  if (!in)
+  {
+    return false;
+  }
+  while (in.read(header, 4))
+  {
+    int len = crpi_load_be32(header);
+    if (len < 4 || len > 4096)
+    {
+      return false;
+    }
+    out.push_back(vector<char>(len));
+    memcpy(&out.back()[0], header, 4);
+    if (!in.read(&out.back()[4], len - 4))
+    {
+      out.pop_back();
+      break;
+    }
+  }
+  return !out.empty();
+}
+
+
+static bool loadSamples (const string &dir, benchSamples &samples)
+{
+  vector<string> replies;
+  bool ok = true;
+
+  if (!readFrames(dir + "/ur_cb3_frames.bin", samples.urFrames))
+  {
+    cout << "Could not read " << dir << "/ur_cb3_frames.bin" << endl;
+    ok = false;
+  }
+  if (readLines(dir + "/krc2_replies.txt", replies))
+  {
+    //! Replies are read out of a fixed, NUL-padded receive buffer
+    for (size_t i = 0; i < replies.size(); ++i)
+    {
+      samples.krc2Replies.push_back(vector<char>(BENCH_KRC2_BYTES + 1, '\0'));
+      strncpy(&samples.krc2Replies.back()[0], replies[i].c_str(), BENCH_KRC2_BYTES);
+    }
+  }
+  else
+  {
+    cout << "Could not read " << dir << "/krc2_replies.txt" << endl;
+    ok = false;
+  }
+  if (!readLines(dir + "/crpi_stream.xml", samples.crpiCommands))
+  {
+    cout << "Could not read " << dir << "/crpi_stream.xml" << endl;
+    ok = false;
+  }
+  if (!readLines(dir + "/crcl_stream.xml", samples.crclCommands))
+  {
+    cout << "Could not read " << dir << "/crcl_stream.xml" << endl;
+    ok = false;
+  }
+  return ok;
+}
+
+
+//! @brief A well-conditioned (diagonally dominant) random square matrix
+//!
+static matrix randomMatrix (int n)
+{
+  matrix m(n, n);
+  for (int r = 0; r < n; ++r)
+  {
+    for (int c = 0; c < n; ++c)
+    {
+      m.at(r, c) = ((rand() % 2001) / 1000.0) - 1.0 + ((r == c) ? n : 0.0);
+    }
+  }
+  return m;
+}
+
+
+//! @brief Time a benchmark:  grow the iteration count until a run lasts minTime, then time
+//!        repetitions runs of that many iterations
+//!
+static benchResult runCase (const benchCase &bench, double minTime, int repetitions)
+{
+  benchResult result;
+  vector<double> perOp;
+  size_t n = 1;
+  double secs;
+
+  for (;;)
+  {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    bench.fn(n);
+    secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (secs >= minTime || n >= ((size_t)1 << 40))
+    {
+      break;
+    }
+    //! Aim 40% past the minimum, growing at most tenfold per attempt
+    double scale = (secs > 0.0) ? (1.4 * minTime / secs) : 10.0;
+    scale = (scale > 10.0) ? 10.0 : ((scale < 2.0) ? 2.0 : scale);
+    n = (size_t)(n * scale);
+  }
+
+  for (int r = 0; r < repetitions; ++r)
+  {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    bench.fn(n);
+    perOp.push_back(chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / n);
+  }
+  result.samples = perOp;
+  sort(perOp.begin(), perOp.end());
+
+  result.name = bench.name;
+  result.iterations = n;
+  result.median = perOp[perOp.size() / 2];
+  result.min = perOp[0];
+  return result;
+}
+
+
+static bool writeJson (const string &path, const vector<benchResult> &results, int repetitions)
+{
+  FILE *out = fopen(path.c_str(), "w");
+  if (out == NULL)
+  {
+    return false;
+  }
+  fprintf(out, "{\n  \"context\": {\n    \"executable\": \"cpu_bench\",\n");
+  fprintf(out, "    \"build\": \"%s %s\",\n    \"repetitions\": %d\n  },\n", __DATE__, __TIME__, repetitions);
+  fprintf(out, "  \"benchmarks\": [\n");
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    for (size_t r = 0; r < results[i].samples.size(); ++r)
+    {
+      fprintf(out, "    {\"name\": \"%s\", \"run_name\": \"%s\", \"run_type\": \"iteration\", "
+              "\"repetitions\": %d, \"repetition_index\": %d, \"iterations\": %llu, \"real_time\": %.3f, "
+              "\"cpu_time\": %.3f, \"time_unit\": \"ns\"},\n", results[i].name.c_str(),
+              results[i].name.c_str(), repetitions, (int)r, (unsigned long long)results[i].iterations,
+              results[i].samples[r], results[i].samples[r]);
+    }
+    fprintf(out, "    {\"name\": \"%s\", \"run_type\": \"aggregate\", \"aggregate_name\": \"median\", "
+            "\"iterations\": %llu, \"real_time\": %.3f, \"cpu_time\": %.3f, \"min_time\": %.3f, "
+            "\"time_unit\": \"ns\"}%s\n", results[i].name.c_str(), (unsigned long long)results[i].iterations,
+            results[i].median, results[i].median, results[i].min, (i + 1 < results.size()) ? "," : "");
+  }
+  fprintf(out, "  ]\n}\n");
+  fclose(out);
+  return true;
+}
+
+
+static void usage ()
+{
+  cout << "Usage:  cpu_bench [--filter TEXT] [--samples DIR] [--min-time S] [--repetitions N]" << endl
+       << "                  [--json FILE] [--list]" << endl;
+}
+
+
+int main (int argc, char *argv[])
+{
+  string filter, samplesDir = "samples", json;
+  double minTime = BENCH_MIN_TIME;
+  int repetitions = BENCH_REPETITIONS;
+  bool list = false;
+  int i;
+
+  for (i = 1; i < argc; ++i)
+  {
+    bool more = (i + 1 < argc);
+    if (strcmp(argv[i], "--filter") == 0 && more)
+    {
+      filter = argv[++i];
+    }
+    else if (strcmp(argv[i], "--samples") == 0 && more)
+    {
+      samplesDir = argv[++i];
+    }
+    else if (strcmp(argv[i], "--min-time") == 0 && more)
+    {
+      minTime = atof(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--repetitions") == 0 && more)
+    {
+      repetitions = atoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--json") == 0 && more)
+    {
+      json = argv[++i];
+    }
+    else if (strcmp(argv[i], "--list") == 0)
+    {
+      list = true;
+    }
+    else
+    {
+      usage();
+      return 1;
+    }
+  }
+  repetitions = (repetitions < 1) ? 1 : repetitions;
+
+  benchSamples samples;
+  if (!list && !loadSamples(samplesDir, samples))
+  {
+    return 1;
+  }
+
+  srand(1);
+  vector<benchCase> cases;
+
+  //! Math
+  const int sizes[] = { 4, 6, 16 };
+  vector<matrix> lhs, rhs;
+  for (i = 0; i < 3; ++i)
+  {
+    lhs.push_back(randomMatrix(sizes[i]));
+    rhs.push_back(randomMatrix(sizes[i]));
+  }
+  for (i = 0; i < 3; ++i)
+  {
+    char name[64];
+    matrix *a = &lhs[i], *b = &rhs[i];
+    snprintf(name, sizeof(name), "matrix_multiply/%dx%d", sizes[i], sizes[i]);
+    benchCase mult = { name, [a, b] (size_t n) {
+      for (size_t k = 0; k < n; ++k)
+      {
+        matrix c = (*a) * (*b);
+        sink += c.at(0, 0);
+      }
+    } };
+    cases.push_back(mult);
+    snprintf(name, sizeof(name), "matrix_inv/%dx%d", sizes[i], sizes[i]);
+    benchCase inv = { name, [a] (size_t n) {
+      for (size_t k = 0; k < n; ++k)
+      {
+        matrix c = a->inv();
+        sink += c.at(0, 0);
+      }
+    } };
+    cases.push_back(inv);
+  }
+
+  vector<pose> poses;
+  for (i = 0; i < 1024; ++i)
+  {
+    poses.push_back(pose(rand() % 1000, rand() % 1000, rand() % 1000,
+                         (rand() % 36000) / 100.0 - 180.0,
+                         (rand() % 18000) / 100.0 - 90.0,
+                         (rand() % 36000) / 100.0 - 180.0));
+  }
+  benchCase rpy = { "matrix_rpy_convert", [&poses] (size_t n) {
+    matrix m(4, 4);
+    for (size_t k = 0; k < n; ++k)
+    {
+      m.RPYMatrixConvert(poses[k % poses.size()], true);
+      sink += m.at(0, 0);
+    }
+  } };
+  cases.push_back(rpy);
+
+  //! XML command parsing, cycling through the recorded streams
+  CrpiXmlParams crpiParams, crclParams;
+  CrpiXml crpiXml(&crpiParams);
+  CrclXml crclXml(&crclParams);
+  benchCase crpiParse = { "crpi_xml_parse", [&] (size_t n) {
+    for (size_t k = 0; k < n; ++k)
+    {
+      sink += crpiXml.parse(samples.crpiCommands[k % samples.crpiCommands.size()]) ? 1.0 : 0.0;
+    }
+  } };
+  cases.push_back(crpiParse);
+  benchCase crclParse = { "crcl_xml_parse", [&] (size_t n) {
+    for (size_t k = 0; k < n; ++k)
+    {
+      sink += crclXml.parse(samples.crclCommands[k % samples.crclCommands.size()]) ? 1.0 : 0.0;
+    }
+  } };
+  cases.push_back(crclParse);
+
+  //! Feedback decoding, as done by the UR and KUKA LWR drivers' feedback threads
+  benchCase urParse = { "ur_parse_frame", [&samples] (size_t n) {
+    const urFrameLayout *layout = NULL;
+    urFeedback fb;
+    for (size_t k = 0; k < n; ++k)
+    {
+      const vector<char> &frame = samples.urFrames[k % samples.urFrames.size()];
+      crpi_parse_ur_frame((int)frame.size(), &frame[0], layout, fb);
+      sink += fb.axes[0];
+    }
+  } };
+  cases.push_back(urParse);
+  benchCase krc2Parse = { "krc2_parse_values", [&samples] (size_t n) {
+    double feedback[BENCH_KRC2_VALUES];
+    for (size_t k = 0; k < n; ++k)
+    {
+      crpi_parse_values(&samples.krc2Replies[k % samples.krc2Replies.size()][0], BENCH_KRC2_BYTES, " ",
+                        feedback, BENCH_KRC2_VALUES);
+      sink += feedback[0];
+    }
+  } };
+  cases.push_back(krc2Parse);
+
+  //! k-means:  one batch pass over blobs around random centers
+  kMeans clusters(BENCH_KMEANS_DIMS, 1, BENCH_KMEANS_CLUSTERS, NULL);
+  if (!list)
+  {
+    vector<double> centers(BENCH_KMEANS_CLUSTERS * BENCH_KMEANS_DIMS), features(BENCH_KMEANS_DIMS);
+    double attribute = 0.0;
+    for (i = 0; i < (int)centers.size(); ++i)
+    {
+      centers[i] = rand() % 1000;
+    }
+    for (i = 0; i < BENCH_KMEANS_PATTERNS; ++i)
+    {
+      int c = rand() % BENCH_KMEANS_CLUSTERS;
+      for (int d = 0; d < BENCH_KMEANS_DIMS; ++d)
+      {
+        features[d] = centers[(c * BENCH_KMEANS_DIMS) + d] + ((rand() % 2001) / 20.0) - 50.0;
+      }
+      clusters.addTrainingPattern(&features[0], &attribute);
+    }
+    clusters.setRandomSeed(1);
+    clusters.seedClusters();
+  }
+  benchCase recluster1 = { "kmeans_recluster/threads:1", [&clusters] (size_t n) {
+    for (size_t k = 0; k < n; ++k)
+    {
+      sink += clusters.recluster(1);
+    }
+  } };
+  cases.push_back(recluster1);
+  benchCase reclusterN = { "kmeans_recluster/threads:all", [&clusters] (size_t n) {
+    for (size_t k = 0; k < n; ++k)
+    {
+      sink += clusters.recluster(0);
+    }
+  } };
+  cases.push_back(reclusterN);
+
+  if (list)
+  {
+    for (i = 0; i < (int)cases.size(); ++i)
+    {
+      cout << cases[i].name << endl;
+    }
+    return 0;
+  }
+
+  //! Every recorded command should parse, or the benchmark is timing the error path
+  size_t failed = 0;
+  for (size_t k = 0; k < samples.crpiCommands.size(); ++k)
+  {
+    failed += crpiXml.parse(samples.crpiCommands[k]) ? 0 : 1;
+  }
+  for (size_t k = 0; k < samples.crclCommands.size(); ++k)
+  {
+    failed += crclXml.parse(samples.crclCommands[k]) ? 0 : 1;
+  }
+  if (failed > 0)
+  {
+    cout << "Warning:  " << failed << " recorded XML commands did not parse" << endl;
+  }
+
+  vector<benchResult> results;
+  printf("%-32s %14s %14s %14s\n", "benchmark", "iterations", "median (ns)", "min (ns)");
+  for (i = 0; i < (int)cases.size(); ++i)
+  {
+    if (!filter.empty() && cases[i].name.find(filter) == string::npos)
+    {
+      continue;
+    }
+    results.push_back(runCase(cases[i], minTime, repetitions));
+    printf("%-32s %14llu %14.1f %14.1f\n", results.back().name.c_str(),
+           (unsigned long long)results.back().iterations, results.back().median, results.back().min);
+    fflush(stdout);
+  }
+
+  if (!json.empty() && !writeJson(json, results, repetitions))
+  {
+    cout << "Could not write " << json << endl;
+    return 1;
+  }
+  return 0;
+}
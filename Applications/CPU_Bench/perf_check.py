@@ -0,0 +1,265 @@
+#!/usr/bin/env python
+
+#################################################################
+# System:   Collaborative Robot Programming Interface           #
+# File:     perf_check.py                                       #
+# Revision: 1.0 14 October, 2026                                #
+# Author:   J. Marvel                                           #
+#                                                               #
+# Description                                                   #
+# ===========                                                   #
+# Performance regression check for the CPU micro-benchmarks.    #
+# Runs cpu_bench with repeated measurements, compares every     #
+# benchmark with a stored baseline run using a one-sided        #
+# Mann-Whitney U test, and fails when a benchmark is both       #
+# significantly slower and slower by more than its threshold.   #
+#                                                               #
+# Each check leaves the raw run and a report in the output      #
+# directory and appends its results to perf_history.csv there,  #
+# for trend graphs.                                             #
+#                                                               #
+# Usage:  perf_check.py --bench cpu_bench [--samples DIR]       #
+#           [--baseline FILE] [--out DIR] [--repetitions N]     #
+#           [--min-time S] [--threshold PCT]                    #
+#           [--threshold NAME=PCT ...] [--alpha P] [--update]   #
+#                                                               #
+# --update records the run as the new baseline instead of       #
+# checking it.  Baselines are specific to the machine and build #
+# they were recorded on.                                        #
+#################################################################
+
+from __future__ import print_function
+
+import sys
+import os
+import json
+import math
+import time
+import subprocess
+
+
+#################################################################
+# Read a cpu_bench --json file
+# input: path of the file
+# output: dictionary of benchmark name to the list of its
+#         per-repetition costs (ns per operation)
+def readRun(path):
+	f = open(path, 'r')
+	data = json.load(f)
+	f.close()
+	runs = {}
+	for entry in data["benchmarks"]:
+		if entry.get("run_type") == "iteration":
+			runs.setdefault(entry["run_name"], []).append(entry["real_time"])
+	return runs
+
+
+#################################################################
+# One-sided Mann-Whitney U test, normal approximation with tie
+# and continuity corrections
+# input: baseline and current samples
+# output: probability of the current samples being at least this
+#         much larger than the baseline by chance
+def mannWhitney(base, cur):
+	n1 = len(cur)
+	n2 = len(base)
+	if n1 == 0 or n2 == 0:
+		return 1.0
+
+	#rank the pooled samples, giving ties their average rank
+	pooled = sorted([(v, 0) for v in cur] + [(v, 1) for v in base])
+	ranks = [0.0] * len(pooled)
+	ties = 0.0
+	i = 0
+	while i < len(pooled):
+		j = i
+		while j + 1 < len(pooled) and pooled[j + 1][0] == pooled[i][0]:
+			j += 1
+		for k in range(i, j + 1):
+			ranks[k] = (i + j) / 2.0 + 1.0
+		t = j - i + 1
+		ties += t * t * t - t
+		i = j + 1
+
+	r1 = sum(ranks[k] for k in range(len(pooled)) if pooled[k][1] == 0)
+	u = r1 - n1 * (n1 + 1) / 2.0
+	n = n1 + n2
+	mean = n1 * n2 / 2.0
+	var = n1 * n2 / 12.0 * ((n + 1) - ties / (n * (n - 1.0)))
+	if var <= 0.0:
+		return 1.0
+	z = (u - mean - 0.5) / math.sqrt(var)
+	return 0.5 * math.erfc(z / math.sqrt(2.0))
+
+
+def median(values):
+	v = sorted(values)
+	m = len(v) // 2
+	return v[m] if len(v) % 2 else (v[m - 1] + v[m]) / 2.0
+
+
+#################################################################
+# Threshold of a benchmark: the most specific NAME=PCT override
+# whose NAME is a prefix of the benchmark, else the default
+def threshold(name, default, overrides):
+	best = None
+	for prefix in overrides:
+		if name.startswith(prefix) and (best is None or len(prefix) > len(best)):
+			best = prefix
+	return default if best is None else overrides[best]
+
+
+def commit():
+	try:
+		out = subprocess.check_output(["git", "rev-parse", "--short", "HEAD"],
+		                              stderr=open(os.devnull, 'w'))
+		return out.decode().strip()
+	except Exception:
+		return ""
+
+
+def usage():
+	print("Usage:  perf_check.py --bench cpu_bench [--samples DIR] [--baseline FILE] [--out DIR]")
+	print("                      [--repetitions N] [--min-time S] [--threshold PCT]")
+	print("                      [--threshold NAME=PCT ...] [--alpha P] [--update]")
+	return 2
+
+
+def main(argv):
+	here = os.path.dirname(os.path.abspath(argv[0]))
+	bench = None
+	samples = os.path.join(here, "samples")
+	baseline = os.path.join(here, "perf_baseline.json")
+	out = "perf"
+	repetitions = 15
+	minTime = 0.1
+	default = 10.0
+	overrides = {}
+	alpha = 0.01
+	update = False
+
+	i = 1
+	while i < len(argv):
+		arg = argv[i]
+		more = i + 1 < len(argv)
+		if arg == "--update":
+			update = True
+		elif not more:
+			return usage()
+		elif arg == "--bench":
+			i += 1
+			bench = argv[i]
+		elif arg == "--samples":
+			i += 1
+			samples = argv[i]
+		elif arg == "--baseline":
+			i += 1
+			baseline = argv[i]
+		elif arg == "--out":
+			i += 1
+			out = argv[i]
+		elif arg == "--repetitions":
+			i += 1
+			repetitions = int(argv[i])
+		elif arg == "--min-time":
+			i += 1
+			minTime = float(argv[i])
+		elif arg == "--alpha":
+			i += 1
+			alpha = float(argv[i])
+		elif arg == "--threshold":
+			i += 1
+			if "=" in argv[i]:
+				name, pct = argv[i].rsplit("=", 1)
+				overrides[name] = float(pct)
+			else:
+				default = float(argv[i])
+		else:
+			return usage()
+		i += 1
+	if bench is None:
+		return usage()
+
+	if not os.path.isdir(out):
+		os.makedirs(out)
+	stamp = time.strftime("%Y%m%d-%H%M%S")
+	raw = os.path.join(out, "cpu_bench-" + stamp + ".json")
+	cmd = [bench, "--samples", samples, "--repetitions", str(repetitions),
+	       "--min-time", str(minTime), "--json", raw]
+	print(" ".join(cmd))
+	if subprocess.call(cmd) != 0 or not os.path.isfile(raw):
+		print("cpu_bench failed")
+		return 1
+
+	if update:
+		f = open(raw, 'r')
+		data = f.read()
+		f.close()
+		f = open(baseline, 'w')
+		f.write(data)
+		f.close()
+		print("Baseline written to " + baseline)
+		return 0
+	if not os.path.isfile(baseline):
+		print("No baseline at " + baseline + ";  record one with --update")
+		return 1
+
+	base = readRun(baseline)
+	cur = readRun(raw)
+	results = []
+	failed = 0
+	print("")
+	print("%-32s %12s %12s %9s %9s %9s  %s" % ("benchmark", "base (ns)", "now (ns)", "change", "limit",
+	                                            "p", "verdict"))
+	for name in sorted(cur.keys()):
+		if name not in base:
+			verdict = "new"
+			b = float("nan")
+			change = float("nan")
+			p = float("nan")
+		else:
+			b = median(base[name])
+			change = (median(cur[name]) - b) / b * 100.0 if b > 0.0 else 0.0
+			p = mannWhitney(base[name], cur[name])
+			if p < alpha and change > threshold(name, default, overrides):
+				verdict = "REGRESSED"
+				failed += 1
+			elif mannWhitney(cur[name], base[name]) < alpha and change < 0.0:
+				verdict = "faster"
+			else:
+				verdict = "ok"
+		limit = threshold(name, default, overrides)
+		print("%-32s %12.1f %12.1f %8.1f%% %8.1f%% %9.4f  %s" % (name, b, median(cur[name]), change, limit,
+		                                                          p, verdict))
+		results.append({"name": name, "baseline_ns": b, "median_ns": median(cur[name]),
+		                "change_pct": change, "threshold_pct": limit, "p_value": p,
+		                "verdict": verdict})
+
+	rev = commit()
+	report = os.path.join(out, "perf_report-" + stamp + ".json")
+	f = open(report, 'w')
+	json.dump({"date": stamp, "commit": rev, "baseline": baseline, "run": raw, "alpha": alpha,
+	           "repetitions": repetitions, "regressions": failed, "benchmarks": results}, f, indent=2)
+	f.close()
+
+	history = os.path.join(out, "perf_history.csv")
+	header = not os.path.isfile(history)
+	f = open(history, 'a')
+	if header:
+		f.write("date,commit,benchmark,baseline_ns,median_ns,change_pct,p_value,verdict\n")
+	for r in results:
+		f.write("%s,%s,%s,%.3f,%.3f,%.2f,%.6f,%s\n" % (stamp, rev, r["name"], r["baseline_ns"],
+		                                                r["median_ns"], r["change_pct"], r["p_value"],
+		                                                r["verdict"]))
+	f.close()
+
+	print("")
+	print("Report written to " + report)
+	if failed > 0:
+		print("%d benchmark(s) regressed" % failed)
+		return 1
+	return 0
+
+
+if __name__ == "__main__":
+	sys.exit(main(sys.argv))
@@ -4,453 +4,477 @@
 //  Subsystem:       CRPI Performance Evaluation
 //  Workfile:        crpi_eval.cpp
 //  Revision:        14 March, 2016
+//                   14 October, 2026 - Latency histograms, driver selection,
+//                                      and JSON reports
 //  Author:          J. Marvel
 //
 //  Description
 //  ===========
-//  
+//  Latency benchmark for a CRPI robot driver.  Measures the age of the
+//  driver's feedback, the latency of the state getters, and, if asked to,
+//  the time from a motion command to the start of motion, to settling at
+//  the target, and to completion, and reports percentiles of each as a
+//  table and optionally as JSON for tracking across CRPI versions.
+//
+//  Usage:  crpi_eval <driver> <config.xml> [options]
+//    driver         abb, universal, kuka_lwr, robotiq, or sim
+//    --samples N    Feedback and getter samples (default 1000)
+//    --motion       Also time motions (the robot moves)
+//    --moves N      Motions of each kind (default 20)
+//    --offset MM    Cartesian excursion of each motion (default 5 mm)
+//    --joint DEG    Joint excursion of each motion (default 1 deg)
+//    --couple NAME  Tool to couple before the tests
+//    --json FILE    Write the report as JSON to FILE
+//    --label TEXT   Label stored in the JSON report (e.g., a CRPI version)
+//    --yes          Do not ask before moving the robot
+//
 ///////////////////////////////////////////////////////////////////////////////
 
 #include <stdlib.h>
 #include <iostream>
 #include <string>
-#include <fstream>
-#include <time.h>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
 #include "crpi_robot.h"
 #include "crpi_kuka_lwr.h"
 #include "crpi_universal.h"
 #include "crpi_robotiq.h"
 #include "crpi_abb.h"
+#include "crpi_sim.h"
 #include "ulapi.h"
-#include "NumericalMath.h" 
+#include "latency_histogram.h"
 
 #pragma warning (disable: 4996)
 
 using namespace crpi_robot;
 using namespace std;
 
-void main ()
+//! @brief Time between feedback samples (s), so that consecutive samples see different
+//!        feedback, and the longest wait (s) for a motion to finish
+//!
+#define EVAL_SAMPLE_PERIOD 0.002
+#define EVAL_MOTION_TIMEOUT 30.0
+
+//! @brief Motion that counts as the robot having started (mm or deg), distance from the target
+//!        that counts as settled, and the poll period (s) while watching a motion
+//!
+#define EVAL_START_TOL 0.05
+#define EVAL_SETTLE_TOL 0.1
+#define EVAL_POLL_PERIOD 0.0005
+
+//! @brief Command-line settings
+//!
+struct evalOptions
 {
-  int i = 0;
-  double perf1, perf2, perf3, perf4;
-  crpi_timer timer;
-  double poseadd1 = 5.0f, poseadd2 = 10.0f, jointadd1 = 0.25f, jointadd2 = 0.5f, jointadd3 = 1.0f;
+  string driver;
+  string config;
+  string couple;
+  string json;
+  string label;
+  int samples;
+  int moves;
+  double offset;
+  double joint;
+  bool motion;
+  bool confirmed;
+
+  evalOptions () :
+    samples(1000),
+    moves(20),
+    offset(5.0),
+    joint(1.0),
+    motion(false),
+    confirmed(false)
+  {
+  }
+};
 
-  //CrpiRobot<CrpiUniversal> arm("universal_ur5.xml");
-  //CrpiRobot<CrpiAbb> arm("abb_irb14000_left.xml");
-  CrpiRobot<CrpiAbb> arm("abb_irb14000_right.xml");
-  //CrpiRobot<CrpiUniversal> arm("universal_ur10_right.xml");
-  //CrpiRobot<CrpiKukaLWR> arm("kuka_lwr.xml");
+//! @brief A measured quantity and its histogram
+//!
+struct evalMetric
+{
+  string name;
+  LatencyHistogram hist;
 
-  arm.SetAngleUnits("degree");
-  arm.SetLengthUnits("mm");
-  arm.Couple("Yumi_Parallel");
-  robotIO curIO, tarIO;
-  robotPose curPose, origPose, tarPose1, tarPose2;
-  robotAxes curAxes, origAxes, tarAxes1, tarAxes2, tarAxes3, tarAxes4;
-
-  curPose.x = curPose.y = curPose.z = curPose.xrot = curPose.yrot = curPose.zrot = 0.0f;
-  arm.GetRobotPose(&curPose);
-  arm.GetRobotAxes(&curAxes);
-
-  cout << "Robot Pose (" << curPose.x << ", " << curPose.y << ", " << curPose.z << ", " 
-       << curPose.xrot << ", " << curPose.yrot << ", " << curPose.zrot << ")" << endl;
-  cout << "Robot Joints (" << curAxes.axis.at(0) << ", " << curAxes.axis.at(1) << ", "
-    << curAxes.axis.at(2) << ", " << curAxes.axis.at(3) << ", " << curAxes.axis.at(4) << ", "
-    << curAxes.axis.at(5) << ", " << curAxes.axis.at(6) << ")" << endl;
-  cout << "Enter 1 to run tests (robot will begin moving), 0 to quit: ";
-  cin >> i;
-
-  if (i < 1)
+  evalMetric (const char *label) :
+    name(label)
+  {
+  }
+};
+
+//! @brief Largest difference between two poses' positions, or between two configurations
+//!
+static double poseDistance (const robotPose &a, const robotPose &b)
+{
+  double dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+  return sqrt((dx * dx) + (dy * dy) + (dz * dz));
+}
+
+
+static double axesDistance (const robotAxes &a, const double *b, int axes)
+{
+  double d = 0.0;
+  for (int i = 0; i < axes && i < a.axes; ++i)
   {
-    return;
+    d = (fabs(a.axis[i] - b[i]) > d) ? fabs(a.axis[i] - b[i]) : d;
   }
+  return d;
+}
 
-  origPose = curPose;
-  tarPose1 = curPose;
-  tarPose2 = curPose;
-  tarPose1.z += 10.0f;
-  tarPose2.z -= 10.0f;
-
-  origAxes = curAxes;
-  tarAxes1 = curAxes;
-  tarAxes2 = curAxes;
-  tarAxes3 = curAxes;
-  tarAxes4 = curAxes;
-  tarAxes1.axis.at(0) += 5;
-  tarAxes2.axis.at(0) -= 5;
-  tarAxes3.axis.at(0) += 10;
-  tarAxes4.axis.at(0) -= 10;
-
-  cout << "Running performance tests: " << endl;
-  cout << "  Base logic time:" << endl;
-  timer.start();
-  perf1 = 0.0f;
-  perf4 = 0.0f;
-  for (i = 0; i < 100; ++i)
+
+//! @brief Time one call of a getter per sample
+//!
+template <class F> void timeGetter (evalMetric &metric, int samples, F call)
+{
+  for (int i = 0; i < samples; ++i)
   {
-    if (poseadd1 < poseadd2)
+    double t0 = ulapi_time();
+    CanonReturn ret = call();
+    double t1 = ulapi_time();
+    if (ret == CANON_SUCCESS)
     {
-      perf4 *= perf1;
+      metric.hist.record(t1 - t0);
     }
     else
     {
-      perf4 += perf1;
+      metric.hist.miss();
     }
   }
-  perf1 = timer.stop();
-  cout << "    Total time: " << perf1 << endl;
-  perf1 = perf1 / 100.0f;
-  perf3 = 1000.0f / perf1;
-  cout << "    Logic sample: Avg = " << perf1 << "ms, " << perf3 << "Hz" << endl;
-
-  cout << "  Feedback test:" << endl;
-  timer.start();
-  perf4 = 0.0f;
-  for (i = 0; i < 100; ++i)
+}
+
+
+//! @brief Command one motion and watch the published state for when the robot starts moving
+//!        and when it settles at the target (within tolerance until the command finishes)
+//!
+template <class T> void timeMotion (CrpiRobot<T> &arm,
+                                    bool joint,
+                                    robotPose &pose,
+                                    robotAxes &axes,
+                                    evalMetric &start,
+                                    evalMetric &settle,
+                                    evalMetric &complete)
+{
+  RobotStateSnapshot first, state;
+  bool watched = (arm.GetRobotState(&first) == CANON_SUCCESS);
+  double started = -1.0, inside = -1.0, t0 = ulapi_time();
+  unsigned long seen = first.sequence;
+
+  CrpiCompletion done = joint ? arm.MoveToAxisTargetAsync(axes) : arm.MoveStraightToAsync(pose);
+  while (ulapi_time() - t0 < EVAL_MOTION_TIMEOUT)
   {
-    if (arm.GetRobotPose(&curPose) != CANON_SUCCESS)
+    bool finished = done.wait_for(0.0);
+    if (watched && arm.GetRobotState(&state) == CANON_SUCCESS && state.sequence != seen)
     {
-      perf4++;
+      seen = state.sequence;
+      double moved, error;
+      if (joint)
+      {
+        moved = axesDistance(axes, first.axis, first.axes);
+        moved = moved - axesDistance(axes, state.axis, state.axes);
+        error = axesDistance(axes, state.axis, state.axes);
+      }
+      else
+      {
+        moved = poseDistance(first.pose, state.pose);
+        error = poseDistance(pose, state.pose);
+      }
+      if (started < 0.0 && fabs(moved) > EVAL_START_TOL)
+      {
+        started = state.timestamp - t0;
+      }
+      inside = (error < EVAL_SETTLE_TOL) ? ((inside < 0.0) ? (state.timestamp - t0) : inside) : -1.0;
     }
-  }
-  perf1 = timer.stop();
-  cout << "    Total time: " << perf1 << endl;
-  perf1 = perf1 / 100.0f;
-  perf3 = 1000.0f / perf1;
-  cout << "    Pose feedback: Avg = " << perf1 << "ms, " << perf3 << "Hz, " << perf4 << " misses" << endl;
-
-  perf4 = 0.0f;
-  timer.restart();
-  for (i = 0; i < 100; ++i)
-  {
-    if (arm.GetRobotAxes(&curAxes) != CANON_SUCCESS)
+    if (finished && (!watched || inside >= 0.0))
     {
-      perf4++;
+      break;
     }
+    ulapi_sleep(EVAL_POLL_PERIOD);
+  }
+
+  CanonReturn ret = done.wait_for(0.0) ? done.get() : CANON_RUNNING;
+  if (ret == CANON_SUCCESS)
+  {
+    complete.hist.record(ulapi_time() - t0);
+  }
+  else
+  {
+    done.cancel();
+    complete.hist.miss();
+  }
+  if (started >= 0.0)
+  {
+    start.hist.record(started);
   }
-  perf1 = timer.stop();
-  cout << "    Total time: " << perf1 << endl;
+  else
+  {
+    start.hist.miss();
+  }
+  if (inside >= 0.0)
+  {
+    settle.hist.record(inside);
+  }
+  else
+  {
+    settle.hist.miss();
+  }
+}
 
-  perf1 = perf1 / 100.0f;
-  perf3 = 1000.0f / perf1;
-  cout << "    Joint feedback: Avg = " << perf1 << "ms, " << perf3 << "Hz, " << perf4 << " misses" << endl;
 
-  timer.restart();
-  perf4 = 0.0f;
-  for (i = 0; i < 100; ++i)
+static void printReport (const vector<evalMetric> &metrics)
+{
+  printf("%-22s %8s %8s %10s %10s %10s %10s %10s\n", "metric (us)", "count", "misses",
+         "mean", "p50", "p99", "p99.9", "max");
+  for (size_t i = 0; i < metrics.size(); ++i)
   {
-    if (arm.GetRobotIO(&curIO) != CANON_SUCCESS)
-    {
-      perf4++;
-    }
+    const LatencyHistogram &h = metrics[i].hist;
+    printf("%-22s %8llu %8llu %10.2f %10.2f %10.2f %10.2f %10.2f\n", metrics[i].name.c_str(),
+           h.count(), h.misses(), h.mean() * 1e6, h.percentile(0.5) * 1e6, h.percentile(0.99) * 1e6,
+           h.percentile(0.999) * 1e6, h.max() * 1e6);
   }
-  perf1 = timer.stop();
-  cout << "    Total time:  " << perf1 << endl;
-  perf1 = perf1 / 100.0f;
-  perf3 = 1000.0f / perf1;
-  cout << "    IO feedback: Avg = " << perf1 << "ms, " << perf3 << "Hz, " << perf4 << " misses" << endl;
-
-
-  cout << "  Motion test:" << endl;
-  cout << "    Zero motion:" << endl;
-  timer.restart();
-  perf1 = 0.0f;
-  perf2 = 0.0f;
-  for (i = 0; i < 100; ++i)
+}
+
+
+static bool writeJson (const evalOptions &opt, const vector<evalMetric> &metrics)
+{
+  FILE *out = fopen(opt.json.c_str(), "w");
+  if (out == NULL)
   {
-    if (arm.MoveStraightTo(origPose) != CANON_SUCCESS)
-    {
-      ++perf2;
-    }
-    else
-    {
-      arm.GetRobotPose(&curPose);
-      perf1 += curPose.distance(origPose);
-    }
+    return false;
   }
-  perf4 = timer.stop();
-  cout << "      Total Time:  " << perf4 << endl;
-  perf1 = perf1 / 100.0f;
-  perf4 = perf4 / 100.0f;
-  perf3 = 1000.0f / perf4;
-  cout << "      LIN:  Avg Error = " << perf1 << "mm, " << "Avg = " << perf4 << "ms, " << perf3 << "Hz, " << perf2 << " misses " << endl;
-
-  timer.restart();
-  perf1 = 0.0f;
-  perf2 = 0.0f;
-  for (i = 0; i < 100; ++i)
+
+  //! Labels and file names are written as given, less characters that would break the string
+  string label = opt.label, config = opt.config;
+  for (size_t i = 0; i < label.size(); ++i)
   {
-    if (arm.MoveTo(origPose) != CANON_SUCCESS)
-    {
-      ++perf2;
-    }
-    else
-    {
-      arm.GetRobotPose(&curPose);
-      perf1 += curPose.distance(origPose);
-    }
+    label[i] = (label[i] == '"' || label[i] == '\\') ? '_' : label[i];
   }
-  perf4 = timer.stop();
-  cout << "      Total Time:  " << perf4 << endl;
-  perf1 = perf1 / 100.0f;
-  perf4 = perf4 / 100.0f;
-  perf3 = 1000.0f / perf4;
-  cout << "      PTP:  Avg Error = " << perf1 << "mm, " << "Avg = " << perf4 << "ms, " << perf3 << "Hz, " << perf2 << " misses " << endl;
-
-  timer.restart();
-  perf1 = 0.0f;
-  perf2 = 0.0f;
-  for (i = 0; i < 100; ++i)
+  for (size_t i = 0; i < config.size(); ++i)
   {
-    if (arm.MoveToAxisTarget(origAxes) != CANON_SUCCESS)
-    {
-      ++perf2;
-    }
-    else
-    {
-      arm.GetRobotAxes(&curAxes);
-      //cout << "------" << endl;
-      //curAxes.print();
-      //origAxes.print();
-      perf1 += curAxes.error(origAxes);
-      //cout << perf1 << endl;
-      //cout << "------" << endl;
-    }
+    config[i] = (config[i] == '"' || config[i] == '\\') ? '/' : config[i];
   }
-  perf4 = timer.stop();
-  cout << "      Total Time:  " << perf4 << endl;
-  perf1 = perf1 / 100.0f;
-  perf4 = perf4 / 100.0f;
-  perf3 = 1000.0f / perf4;
-  cout << "      Joint:  Avg Error = " << perf1 << "deg, " << "Avg = " << perf4 << "ms, " << perf3 << "Hz, " << perf2 << " misses " << endl;
-
-  cout << "    Oscillation:" << endl;
-
-  arm.MoveStraightTo(origPose);
-
-  tarPose1 = origPose;
-  tarPose2 = origPose;
-  tarPose1.z += poseadd1;
-  tarPose2.z -= poseadd1;
-  cout << "       LIN:  Orig +/- " << poseadd1 << "mm" << endl;
-
-  timer.restart();
-  perf1 = 0.0f;
-  perf2 = 0.0f;
-  perf3 = 0.0f;
-  for (i = 0; i < 50; ++i)
+
+  fprintf(out, "{\n");
+  fprintf(out, "  \"label\": \"%s\",\n", label.c_str());
+  fprintf(out, "  \"build\": \"%s %s\",\n", __DATE__, __TIME__);
+  fprintf(out, "  \"driver\": \"%s\",\n", opt.driver.c_str());
+  fprintf(out, "  \"config\": \"%s\",\n", config.c_str());
+  fprintf(out, "  \"samples\": %d,\n", opt.samples);
+  fprintf(out, "  \"moves\": %d,\n", opt.motion ? opt.moves : 0);
+  fprintf(out, "  \"units\": \"us\",\n");
+  fprintf(out, "  \"metrics\": {\n");
+  for (size_t i = 0; i < metrics.size(); ++i)
   {
-    if (arm.MoveStraightTo(tarPose1) == CANON_SUCCESS)
-    {
-      arm.GetRobotPose(&curPose);
-      perf1 += tarPose1.distance(curPose);
-    }
-    else
-    {
-      ++perf3;
-    }
+    const LatencyHistogram &h = metrics[i].hist;
+    fprintf(out, "    \"%s\": {\"count\": %llu, \"misses\": %llu, \"mean\": %.3f, \"p50\": %.3f, "
+            "\"p99\": %.3f, \"p999\": %.3f, \"max\": %.3f}%s\n", metrics[i].name.c_str(), h.count(),
+            h.misses(), h.mean() * 1e6, h.percentile(0.5) * 1e6, h.percentile(0.99) * 1e6,
+            h.percentile(0.999) * 1e6, h.max() * 1e6, (i + 1 < metrics.size()) ? "," : "");
+  }
+  fprintf(out, "  }\n}\n");
+  fclose(out);
+  return true;
+}
 
-    if (arm.MoveStraightTo(tarPose2) == CANON_SUCCESS)
-    {
-      arm.GetRobotPose(&curPose);
-      perf2 += tarPose2.distance(curPose);
-    }
-    else
-    {
-      ++perf3;
-    }
+
+template <class T> int runEval (const evalOptions &opt)
+{
+  CrpiRobot<T> arm(opt.config.c_str());
+  robotPose curPose, tarPose[2];
+  robotAxes curAxes, tarAxes[2];
+  robotIO curIO;
+  RobotStateSnapshot state;
+  vector<evalMetric> metrics;
+  int i;
+
+  arm.SetAngleUnits("degree");
+  arm.SetLengthUnits("mm");
+  if (!opt.couple.empty())
+  {
+    arm.Couple(opt.couple.c_str());
   }
-  perf4 = timer.stop();
-  cout << "         Total Time:  " << perf4 << endl;
-  perf1 = perf1 / 50.0f;
-  perf2 = perf2 / 50.0f;
-  perf4 = perf4 / 100.0f;
-  cout << "         LIN:  Avg Err = (" << perf1 << ", " << perf2 << ")mm, " << perf4 << "ms, ";
-  perf4 = 1000.0f / perf4;
-  cout << perf4 << "Hz, " << perf3 << " misses" << endl;
-
-
-  arm.MoveStraightTo(origPose);
-
-  tarPose1 = origPose;
-  tarPose2 = origPose;
-  tarPose1.z += poseadd2;
-  tarPose2.z -= poseadd2;
-  cout << "       LIN:  Orig +/- " << poseadd2 << "mm" << endl;
-
-  timer.restart();
-  perf1 = 0.0f;
-  perf2 = 0.0f;
-  perf3 = 0.0f;
-  for (i = 0; i < 50; ++i)
+
+  metrics.push_back(evalMetric("feedback_age"));
+  metrics.push_back(evalMetric("get_robot_pose"));
+  metrics.push_back(evalMetric("get_robot_axes"));
+  metrics.push_back(evalMetric("get_robot_io"));
+  metrics.push_back(evalMetric("get_robot_state"));
+
+  //! Feedback age:  how old the latest published state is when a client looks at it
+  cout << "Sampling feedback..." << endl;
+  for (i = 0; i < opt.samples; ++i)
   {
-    if (arm.MoveStraightTo(tarPose1) == CANON_SUCCESS)
+    if (arm.GetRobotState(&state) == CANON_SUCCESS)
     {
-      arm.GetRobotPose(&curPose);
-      perf1 += tarPose1.distance(curPose);
+      metrics[0].hist.record(ulapi_time() - state.timestamp);
     }
     else
     {
-      ++perf3;
+      metrics[0].hist.miss();
     }
+    ulapi_sleep(EVAL_SAMPLE_PERIOD);
+  }
 
-    if (arm.MoveStraightTo(tarPose2) == CANON_SUCCESS)
+  cout << "Timing getters..." << endl;
+  timeGetter(metrics[1], opt.samples, [&] () { return arm.GetRobotPose(&curPose); });
+  timeGetter(metrics[2], opt.samples, [&] () { return arm.GetRobotAxes(&curAxes); });
+  timeGetter(metrics[3], opt.samples, [&] () { return arm.GetRobotIO(&curIO); });
+  timeGetter(metrics[4], opt.samples, [&] () { return arm.GetRobotState(&state); });
+
+  if (opt.motion)
+  {
+    if (arm.GetRobotPose(&curPose) != CANON_SUCCESS || arm.GetRobotAxes(&curAxes) != CANON_SUCCESS)
     {
-      arm.GetRobotPose(&curPose);
-      perf2 += tarPose2.distance(curPose);
+      cout << "Could not read the robot's position; skipping the motion tests" << endl;
     }
     else
     {
-      ++perf3;
+      cout << "Robot Pose (" << curPose.x << ", " << curPose.y << ", " << curPose.z << ", "
+           << curPose.xrot << ", " << curPose.yrot << ", " << curPose.zrot << ")" << endl;
+      if (!opt.confirmed)
+      {
+        cout << "Enter 1 to run the motion tests (robot will begin moving), 0 to skip them: ";
+        cin >> i;
+      }
+      if (opt.confirmed || i >= 1)
+      {
+        metrics.push_back(evalMetric("lin_motion_start"));
+        metrics.push_back(evalMetric("lin_settle"));
+        metrics.push_back(evalMetric("lin_complete"));
+        metrics.push_back(evalMetric("joint_motion_start"));
+        metrics.push_back(evalMetric("joint_settle"));
+        metrics.push_back(evalMetric("joint_complete"));
+        size_t m = metrics.size() - 6;
+
+        //! Oscillate about the starting position, first in Cartesian space, then on the first joint
+        tarPose[0] = tarPose[1] = curPose;
+        tarPose[0].z += opt.offset;
+        tarPose[1].z -= opt.offset;
+        tarAxes[0] = tarAxes[1] = curAxes;
+        tarAxes[0].axis[0] += opt.joint;
+        tarAxes[1].axis[0] -= opt.joint;
+
+        cout << "Timing straight-line motions..." << endl;
+        for (i = 0; i < opt.moves; ++i)
+        {
+          timeMotion(arm, false, tarPose[i % 2], curAxes, metrics[m], metrics[m + 1], metrics[m + 2]);
+        }
+        arm.MoveStraightTo(curPose);
+
+        cout << "Timing joint motions..." << endl;
+        for (i = 0; i < opt.moves; ++i)
+        {
+          timeMotion(arm, true, curPose, tarAxes[i % 2], metrics[m + 3], metrics[m + 4], metrics[m + 5]);
+        }
+        arm.MoveToAxisTarget(curAxes);
+      }
     }
   }
-  perf4 = timer.stop();
-  cout << "         Total Time:  " << perf4 << endl;
-  perf1 = perf1 / 50.0f;
-  perf2 = perf2 / 50.0f;
-  perf4 = perf4 / 100.0f;
-  cout << "         LIN:  Avg Err = (" << perf1 << ", " << perf2 << ")mm, " << perf4 << "ms, ";
-  perf4 = 1000.0f / perf4;
-  cout << perf4 << "Hz, " << perf3 << " misses" << endl;
-
-
-
-  arm.MoveToAxisTarget(origAxes);
-
-  tarAxes1 = origAxes;
-  tarAxes2 = origAxes;
-  tarAxes1.axis.at(0) += jointadd1;
-  tarAxes2.axis.at(0) -= jointadd1;
-  cout << "       Joint:  Orig +/- " << jointadd1 << "deg" << endl;
-
-  timer.restart();
-  perf1 = 0.0f;
-  perf2 = 0.0f;
-  perf3 = 0.0f;
-  for (i = 0; i < 50; ++i)
+
+  printReport(metrics);
+  if (!opt.json.empty())
   {
-    if (arm.MoveToAxisTarget(tarAxes1) == CANON_SUCCESS)
-    {
-      arm.GetRobotAxes(&curAxes);
-      perf1 += tarAxes1.error(curAxes);
-    }
-    else
+    if (!writeJson(opt, metrics))
     {
-      ++perf3;
+      cout << "Could not write " << opt.json << endl;
+      return 1;
     }
-      
-    if (arm.MoveToAxisTarget(tarAxes2) == CANON_SUCCESS)
+    cout << "Report written to " << opt.json << endl;
+  }
+  return 0;
+}
+
+
+static void usage ()
+{
+  cout << "Usage:  crpi_eval <abb|universal|kuka_lwr|robotiq|sim> <config.xml> [--samples N] [--motion]" << endl
+       << "                  [--moves N] [--offset MM] [--joint DEG] [--couple NAME] [--json FILE]" << endl
+       << "                  [--label TEXT] [--yes]" << endl;
+}
+
+
+int main (int argc, char *argv[])
+{
+  evalOptions opt;
+  int i;
+
+  if (argc < 3)
+  {
+    usage();
+    return 1;
+  }
+  opt.driver = argv[1];
+  opt.config = argv[2];
+  for (i = 3; i < argc; ++i)
+  {
+    bool more = (i + 1 < argc);
+    if (strcmp(argv[i], "--samples") == 0 && more)
     {
-      arm.GetRobotAxes(&curAxes);
-      perf2 += tarAxes2.error(curAxes);
+      opt.samples = atoi(argv[++i]);
     }
-    else
+    else if (strcmp(argv[i], "--moves") == 0 && more)
     {
-      ++perf3;
+      opt.moves = atoi(argv[++i]);
     }
-  }
-  perf4 = timer.stop();
-  cout << "         Total Time:  " << perf4 << endl;
-  perf1 = perf1 / 50.0f;
-  perf2 = perf2 / 50.0f;
-  perf4 = perf4 / 100.0f;
-  cout << "         Joint:  Avg Err = (" << perf1 << ", " << perf2 << ")deg, " << perf4 << "ms, ";
-  perf4 = 1000.0f / perf4;
-  cout << perf4 << "Hz, " << perf3 << " misses" << endl;
-
-
-  arm.MoveToAxisTarget(origAxes);
-
-  tarAxes1 = origAxes;
-  tarAxes2 = origAxes;
-  tarAxes1.axis.at(0) += jointadd2;
-  tarAxes2.axis.at(0) -= jointadd2;
-  cout << "       Joint:  Orig +/- " << jointadd2 << "deg" << endl;
-
-  timer.restart();
-  perf1 = 0.0f;
-  perf2 = 0.0f;
-  perf3 = 0.0f;
-  for (i = 0; i < 50; ++i)
-  {
-    if (arm.MoveToAxisTarget(tarAxes1) == CANON_SUCCESS)
+    else if (strcmp(argv[i], "--offset") == 0 && more)
     {
-      arm.GetRobotAxes(&curAxes);
-      perf1 += tarAxes1.error(curAxes);
+      opt.offset = atof(argv[++i]);
     }
-    else
+    else if (strcmp(argv[i], "--joint") == 0 && more)
     {
-      ++perf3;
+      opt.joint = atof(argv[++i]);
     }
-
-    if (arm.MoveToAxisTarget(tarAxes2) == CANON_SUCCESS)
+    else if (strcmp(argv[i], "--couple") == 0 && more)
     {
-      arm.GetRobotAxes(&curAxes);
-      perf2 += tarAxes2.error(curAxes);
+      opt.couple = argv[++i];
     }
-    else
+    else if (strcmp(argv[i], "--json") == 0 && more)
     {
-      ++perf3;
+      opt.json = argv[++i];
     }
-  }
-  perf4 = timer.stop();
-  cout << "         Total Time:  " << perf4 << endl;
-  perf1 = perf1 / 50.0f;
-  perf2 = perf2 / 50.0f;
-  perf4 = perf4 / 100.0f;
-  cout << "         Joint:  Avg Err = (" << perf1 << ", " << perf2 << ")deg, " << perf4 << "ms, ";
-  perf4 = 1000.0f / perf4;
-  cout << perf4 << "Hz, " << perf3 << " misses" << endl;
-
-
-  arm.MoveToAxisTarget(origAxes);
-
-  tarAxes1 = origAxes;
-  tarAxes2 = origAxes;
-  tarAxes1.axis.at(0) += jointadd3;
-  tarAxes2.axis.at(0) -= jointadd3;
-  cout << "       Joint:  Orig +/- " << jointadd3 << "deg" << endl;
-
-  timer.restart();
-  perf1 = 0.0f;
-  perf2 = 0.0f;
-  perf3 = 0.0f;
-  for (i = 0; i < 50; ++i)
-  {
-    if (arm.MoveToAxisTarget(tarAxes1) == CANON_SUCCESS)
+    else if (strcmp(argv[i], "--label") == 0 && more)
     {
-      arm.GetRobotAxes(&curAxes);
-      perf1 += tarAxes1.error(curAxes);
+      opt.label = argv[++i];
     }
-    else
+    else if (strcmp(argv[i], "--motion") == 0)
     {
-      ++perf3;
+      opt.motion = true;
     }
-
-    if (arm.MoveToAxisTarget(tarAxes2) == CANON_SUCCESS)
+    else if (strcmp(argv[i], "--yes") == 0)
     {
-      arm.GetRobotAxes(&curAxes);
-      perf2 += tarAxes2.error(curAxes);
+      opt.confirmed = true;
     }
     else
     {
-      ++perf3;
+      usage();
+      return 1;
     }
   }
-  perf4 = timer.stop();
-  cout << "         Total Time:  " << perf4 << endl;
-  perf1 = perf1 / 50.0f;
-  perf2 = perf2 / 50.0f;
-  perf4 = perf4 / 100.0f;
-  cout << "         Joint:  Avg Err = (" << perf1 << ", " << perf2 << ")deg, " << perf4 << "ms, ";
-  perf4 = 1000.0f / perf4;
-  cout << perf4 << "Hz, " << perf3 << " misses" << endl;
-
-  arm.MoveToAxisTarget(origAxes);
-
-  cout << "All done" << endl;
+  opt.samples = (opt.samples < 1) ? 1 : opt.samples;
+  opt.moves = (opt.moves < 1) ? 1 : opt.moves;
 
+  if (opt.driver == "abb")
+  {
+    return runEval<CrpiAbb>(opt);
+  }
+  else if (opt.driver == "universal")
+  {
+    return runEval<CrpiUniversal>(opt);
+  }
+  else if (opt.driver == "kuka_lwr")
+  {
+    return runEval<CrpiKukaLWR>(opt);
+  }
+  else if (opt.driver == "robotiq")
+  {
+    return runEval<CrpiRobotiq>(opt);
+  }
+  else if (opt.driver == "sim")
+  {
+    return runEval<CrpiSim>(opt);
+  }
+  cout << "Unknown driver " << opt.driver << endl;
+  usage();
+  return 1;
 }
-
-
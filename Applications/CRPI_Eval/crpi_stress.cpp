@@ -0,0 +1,922 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       CRPI Performance Evaluation
+//  Workfile:        crpi_stress.cpp
+//  Revision:        15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Concurrency stress test for a CRPI robot driver.  Where crpi_eval times
+//  one client, crpi_stress runs a weighted mix of state getters, I/O, and
+//  (if asked to) motion commands against one CrpiRobot from a growing
+//  number of threads, and reports the throughput and latency percentiles of
+//  each configuration, so that the scaling of the drivers' locking can be
+//  followed from one core to many.  With the simulated robot the sweep also
+//  covers feedback rates, and a recorded motion capture stream can be read
+//  from the same threads.
+//
+//  Every motion the test commands runs along a line:  Cartesian moves go
+//  between the starting pose and the starting pose offset equally along X,
+//  Y, and Z, and joint moves between the starting joints and the starting
+//  joints offset equally on every axis.  A pose or set of joints read while
+//  the robot moves must lie on its line, so a read more than the tolerance
+//  off it mixes two updates and is counted as torn.  On a real robot a
+//  Cartesian move also moves the joints (and a joint move the pose) off
+//  their lines, so with both kinds of motion only the simulated robot,
+//  which moves them independently, is checked.  Motion capture frames are
+//  torn if their frame number changes while they are being read.
+//
+//  Usage:  crpi_stress <driver> <config.xml> [options]
+//    driver          abb, universal, kuka_lwr, robotiq, or sim
+//    --threads LIST  Thread counts to sweep (default 1,2,4,8,16)
+//    --rates LIST    Feedback rates (Hz) to sweep (simulated robot only)
+//    --duration S    Run time of each configuration (default 2 s)
+//    --mix LIST      Operation weights as NAME=W,... (default pose=30,axes=30,
+//                    state=30,io=10):  pose, axes, state, io (the getters), do
+//                    (SetRobotDO on outputs 0-3), lin and joint (the robot
+//                    moves), frame and subject (motion capture)
+//    --offset MM     Cartesian excursion of each motion (default 5 mm)
+//    --joint DEG     Joint excursion of each motion (default 1 deg)
+//    --tolerance T   Distance (mm or deg) off the line that counts as torn
+//                    (default 0.01)
+//    --mocap FILE    Recorded motion capture stream to replay (frame=10 and
+//                    subject=10 unless mixed otherwise)
+//    --json FILE     Write the report as JSON to FILE
+//    --label TEXT    Label stored in the JSON report
+//    --yes           Do not ask before moving the robot or setting outputs
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include "crpi_robot.h"
+#include "crpi_kuka_lwr.h"
+#include "crpi_universal.h"
+#include "crpi_robotiq.h"
+#include "crpi_abb.h"
+#include "crpi_sim.h"
+#include "ulapi.h"
+#include "latency_histogram.h"
+#ifdef CRPI_STRESS_MOCAP
+#include "MoCapReplay.h"
+#endif
+
+#pragma warning (disable: 4996)
+
+using namespace crpi_robot;
+using namespace std;
+
+//! @brief Digital outputs toggled by the do operation
+//!
+#define STRESS_OUTPUTS 4
+
+//! @brief Time (s) given the threads to start before a run begins, and time allowed for a new
+//!        feedback rate to take effect
+//!
+#define STRESS_START_DELAY 0.05
+#define STRESS_RATE_SETTLE 0.1
+
+//! @brief Age (s) of the motion capture samples asked for, how far (s) outside the history a
+//!        query may fall, and the longest wait (s) for the first replayed frame
+//!
+#define STRESS_MOCAP_AGE 0.02
+#define STRESS_MOCAP_TOLERANCE 0.05
+#define STRESS_MOCAP_TIMEOUT 2.0
+
+//! @brief Operations of the mix
+//!
+enum stressOp
+{
+  OP_POSE = 0,
+  OP_AXES,
+  OP_STATE,
+  OP_IO,
+  OP_DO,
+  OP_LIN,
+  OP_JOINT,
+  OP_FRAME,
+  OP_SUBJECT,
+  OP_COUNT
+};
+
+//! @brief Accumulated so the compiler cannot discard the frame reads being timed
+//!
+static volatile double sink = 0.0;
+
+static const char *opNames[OP_COUNT] = {"pose", "axes", "state", "io", "do", "lin", "joint", "frame", "subject"};
+
+//! @brief Command-line settings
+//!
+struct stressOptions
+{
+  string driver;
+  string config;
+  string mocap;
+  string json;
+  string label;
+  vector<int> threads;
+  vector<double> rates;
+  int weights[OP_COUNT];
+  bool mixed;
+  double duration;
+  double offset;
+  double joint;
+  double tolerance;
+  bool confirmed;
+
+  stressOptions () :
+    mixed(false),
+    duration(2.0),
+    offset(5.0),
+    joint(1.0),
+    tolerance(0.01),
+    confirmed(false)
+  {
+    int defaults[OP_COUNT] = {30, 30, 30, 10, 0, 0, 0, 0, 0};
+    memcpy(weights, defaults, sizeof(weights));
+  }
+};
+
+//! @brief What every thread of a run shares:  the robot, the mix, and the lines of motion
+//!
+template <class T> struct stressShared
+{
+  CrpiRobot<T> *arm;
+#ifdef CRPI_STRESS_MOCAP
+  Sensor::MoCapReplay *mocap;
+  int subject;
+#endif
+  int weights[OP_COUNT];
+  int total;
+  robotPose line[2];
+  robotAxes lineAxes[2];
+  bool checkPose;
+  bool checkAxes;
+  double tolerance;
+  double start;
+  double end;
+};
+
+//! @brief One thread of a run and what it measured
+//!
+template <class T> struct stressWorker
+{
+  stressShared<T> *shared;
+  int index;
+  vector<LatencyHistogram> hist;
+  unsigned long long ops;
+  unsigned long long tornPose;
+  unsigned long long tornAxes;
+  unsigned long long tornFrames;
+  unsigned long long backwards;
+  unsigned long lastSequence;
+  unsigned int lastFrame;
+  double finished;
+  unsigned long long seed;
+
+  stressWorker () :
+    shared(NULL),
+    index(0),
+    hist(OP_COUNT),
+    ops(0),
+    tornPose(0),
+    tornAxes(0),
+    tornFrames(0),
+    backwards(0),
+    lastSequence(0),
+    lastFrame(0),
+    finished(0.0),
+    seed(0)
+  {
+  }
+};
+
+//! @brief The merged results of one configuration
+//!
+struct stressResult
+{
+  int threads;
+  double rate;
+  double elapsed;
+  unsigned long long ops;
+  unsigned long long tornPose;
+  unsigned long long tornAxes;
+  unsigned long long tornFrames;
+  unsigned long long backwards;
+  vector<LatencyHistogram> hist;
+  LatencyHistogram all;
+
+  stressResult () :
+    threads(0),
+    rate(0.0),
+    elapsed(0.0),
+    ops(0),
+    tornPose(0),
+    tornAxes(0),
+    tornFrames(0),
+    backwards(0),
+    hist(OP_COUNT)
+  {
+  }
+};
+
+
+//! @brief Difference of two angles (deg), ignoring whole turns
+//!
+static double angleDifference (double a, double b)
+{
+  double d = fmod(fabs(a - b), 360.0);
+  return (d > 180.0) ? (360.0 - d) : d;
+}
+
+
+//! @brief Distance of a pose from the line of the Cartesian motions:  the spread of its
+//!        offsets from the line's start along X, Y, and Z, or its change of orientation
+//!
+static double poseOffLine (const robotPose &p, const robotPose &start)
+{
+  double dx = p.x - start.x, dy = p.y - start.y, dz = p.z - start.z;
+  double off = fabs(dx - dy);
+  off = (fabs(dy - dz) > off) ? fabs(dy - dz) : off;
+  off = (fabs(dx - dz) > off) ? fabs(dx - dz) : off;
+  off = (angleDifference(p.xrot, start.xrot) > off) ? angleDifference(p.xrot, start.xrot) : off;
+  off = (angleDifference(p.yrot, start.yrot) > off) ? angleDifference(p.yrot, start.yrot) : off;
+  off = (angleDifference(p.zrot, start.zrot) > off) ? angleDifference(p.zrot, start.zrot) : off;
+  return off;
+}
+
+
+//! @brief Distance of a set of joints from the line of the joint motions:  the spread of their
+//!        offsets from the line's start
+//!
+static double axesOffLine (const double *axis, int axes, const robotAxes &start)
+{
+  double lo = 0.0, hi = 0.0, d;
+  for (int i = 0; i < axes && i < start.axes; ++i)
+  {
+    d = axis[i] - start.axis[i];
+    lo = (i == 0 || d < lo) ? d : lo;
+    hi = (i == 0 || d > hi) ? d : hi;
+  }
+  return hi - lo;
+}
+
+
+//! @brief Pick the next operation of a thread's mix (xorshift64)
+//!
+template <class T> static int nextOp (stressWorker<T> &w)
+{
+  w.seed ^= w.seed << 13;
+  w.seed ^= w.seed >> 7;
+  w.seed ^= w.seed << 17;
+  int r = (int)(w.seed % (unsigned long long)w.shared->total), op;
+  for (op = 0; op < OP_COUNT - 1 && r >= w.shared->weights[op]; ++op)
+  {
+    r -= w.shared->weights[op];
+  }
+  return op;
+}
+
+
+//! @brief Run one operation, checking what it read against the lines of motion
+//!
+template <class T> static CanonReturn runOp (stressWorker<T> &w, int op, bool &toggle)
+{
+  stressShared<T> &s = *w.shared;
+  CanonReturn ret = CANON_SUCCESS;
+  robotPose pose;
+  robotAxes axes;
+  robotIO io;
+  RobotStateSnapshot state;
+
+  switch (op)
+  {
+  case OP_POSE:
+    ret = s.arm->GetRobotPose(&pose);
+    if (ret == CANON_SUCCESS && s.checkPose && poseOffLine(pose, s.line[0]) > s.tolerance)
+    {
+      ++w.tornPose;
+    }
+    break;
+  case OP_AXES:
+    ret = s.arm->GetRobotAxes(&axes);
+    if (ret == CANON_SUCCESS && s.checkAxes && axesOffLine(&axes.axis[0], axes.axes, s.lineAxes[0]) > s.tolerance)
+    {
+      ++w.tornAxes;
+    }
+    break;
+  case OP_STATE:
+    ret = s.arm->GetRobotState(&state);
+    if (ret == CANON_SUCCESS)
+    {
+      w.backwards += (state.sequence < w.lastSequence) ? 1 : 0;
+      w.lastSequence = state.sequence;
+      if (s.checkPose && poseOffLine(state.pose, s.line[0]) > s.tolerance)
+      {
+        ++w.tornPose;
+      }
+      if (s.checkAxes && axesOffLine(state.axis, state.axes, s.lineAxes[0]) > s.tolerance)
+      {
+        ++w.tornAxes;
+      }
+    }
+    break;
+  case OP_IO:
+    ret = s.arm->GetRobotIO(&io);
+    break;
+  case OP_DO:
+    ret = s.arm->SetRobotDO(w.index % STRESS_OUTPUTS, toggle);
+    toggle = !toggle;
+    break;
+  case OP_LIN:
+    ret = s.arm->MoveStraightTo(s.line[toggle ? 1 : 0]);
+    toggle = !toggle;
+    break;
+  case OP_JOINT:
+    ret = s.arm->MoveToAxisTarget(s.lineAxes[toggle ? 1 : 0]);
+    toggle = !toggle;
+    break;
+#ifdef CRPI_STRESS_MOCAP
+  case OP_FRAME:
+    {
+      Sensor::MoCapFrameView view;
+      if (!s.mocap->AcquireFrame(view))
+      {
+        return CANON_FAILURE;
+      }
+      //! The frame number is read again through a volatile so that it is not taken from a register
+      unsigned int number = view->frameNumber;
+      double sum = 0.0;
+      for (int i = 0; i < view->subjectCount; ++i)
+      {
+        sum += view->subjects[i].pose.x + view->subjects[i].rotation[0];
+      }
+      sink = sum;
+      if (*(const volatile unsigned int*)&view->frameNumber != number)
+      {
+        ++w.tornFrames;
+      }
+      w.backwards += (number < w.lastFrame) ? 1 : 0;
+      w.lastFrame = number;
+    }
+    break;
+  case OP_SUBJECT:
+    {
+      Sensor::MoCapSample sample;
+      if (!s.mocap->GetSubjectPose(s.subject, ulapi_time() - STRESS_MOCAP_AGE, sample, STRESS_MOCAP_TOLERANCE))
+      {
+        return CANON_FAILURE;
+      }
+    }
+    break;
+#endif
+  default:
+    ret = CANON_REJECT;
+    break;
+  }
+  return ret;
+}
+
+
+//! @brief Thread of a run:  waits for the start, then runs its mix until the end
+//!
+template <class T> void stressThread (void *param)
+{
+  stressWorker<T> &w = *(stressWorker<T>*)param;
+  bool toggles[OP_COUNT] = {false};
+  double t0, t1;
+  int op;
+
+  t0 = ulapi_time();
+  if (t0 < w.shared->start)
+  {
+    ulapi_sleep(w.shared->start - t0);
+  }
+
+  while (ulapi_time() < w.shared->end)
+  {
+    op = nextOp(w);
+    t0 = ulapi_time();
+    CanonReturn ret = runOp(w, op, toggles[op]);
+    t1 = ulapi_time();
+    if (ret == CANON_SUCCESS)
+    {
+      w.hist[op].record(t1 - t0);
+    }
+    else
+    {
+      w.hist[op].miss();
+    }
+    ++w.ops;
+  }
+  w.finished = ulapi_time();
+}
+
+
+//! @brief Run the mix from a number of threads for the configured time
+//!
+template <class T> static void runConfiguration (stressShared<T> &shared,
+                                                 const stressOptions &opt,
+                                                 int threads,
+                                                 stressResult &result)
+{
+  vector<stressWorker<T> > workers(threads);
+  vector<void*> tasks(threads);
+  int i, op;
+
+  shared.start = ulapi_time() + STRESS_START_DELAY;
+  shared.end = shared.start + opt.duration;
+  for (i = 0; i < threads; ++i)
+  {
+    workers[i].shared = &shared;
+    workers[i].index = i;
+    workers[i].seed = 88172645463325252ULL + (0x9E3779B97F4A7C15ULL * (unsigned long long)(i + 1));
+    tasks[i] = ulapi_task_new();
+    ulapi_task_start((ulapi_task_struct*)tasks[i], stressThread<T>, &workers[i], ulapi_prio_lowest(), 0);
+  }
+
+  result.threads = threads;
+  result.elapsed = 0.0;
+  for (i = 0; i < threads; ++i)
+  {
+    ulapi_task_join((ulapi_task_struct*)tasks[i], NULL);
+    ulapi_task_delete((ulapi_task_struct*)tasks[i]);
+
+    const stressWorker<T> &w = workers[i];
+    result.ops += w.ops;
+    result.tornPose += w.tornPose;
+    result.tornAxes += w.tornAxes;
+    result.tornFrames += w.tornFrames;
+    result.backwards += w.backwards;
+    result.elapsed = ((w.finished - shared.start) > result.elapsed) ? (w.finished - shared.start) : result.elapsed;
+    for (op = 0; op < OP_COUNT; ++op)
+    {
+      result.hist[op].merge(w.hist[op]);
+      result.all.merge(w.hist[op]);
+    }
+  }
+}
+
+
+static void printResult (const stressResult &r, bool checked, bool frames)
+{
+  printf("\n%d thread%s", r.threads, (r.threads == 1) ? "" : "s");
+  if (r.rate > 0.0)
+  {
+    printf(", %.0f Hz feedback", r.rate);
+  }
+  printf(":  %.0f ops/s", (r.elapsed > 0.0) ? (r.ops / r.elapsed) : 0.0);
+  if (checked)
+  {
+    printf(", %llu torn poses, %llu torn joint reads", r.tornPose, r.tornAxes);
+  }
+  if (frames)
+  {
+    printf(", %llu torn frames", r.tornFrames);
+  }
+  if (r.backwards > 0)
+  {
+    printf(", %llu reads older than the thread's last", r.backwards);
+  }
+  printf("\n%-10s %10s %8s %10s %10s %10s %10s %10s\n", "op (us)", "count", "misses", "mean", "p50", "p99",
+         "p99.9", "max");
+  for (int op = 0; op <= OP_COUNT; ++op)
+  {
+    const LatencyHistogram &h = (op < OP_COUNT) ? r.hist[op] : r.all;
+    if (h.count() == 0 && h.misses() == 0)
+    {
+      continue;
+    }
+    printf("%-10s %10llu %8llu %10.2f %10.2f %10.2f %10.2f %10.2f\n", (op < OP_COUNT) ? opNames[op] : "all",
+           h.count(), h.misses(), h.mean() * 1e6, h.percentile(0.5) * 1e6, h.percentile(0.99) * 1e6,
+           h.percentile(0.999) * 1e6, h.max() * 1e6);
+  }
+}
+
+
+static void printSummary (const vector<stressResult> &results)
+{
+  char rate[16];
+
+  printf("\n%8s %10s %12s %10s %10s %10s %8s\n", "threads", "rate (Hz)", "ops/s", "p50 (us)", "p99 (us)",
+         "p99.9 (us)", "torn");
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    const stressResult &r = results[i];
+    if (r.rate > 0.0)
+    {
+      snprintf(rate, sizeof(rate), "%.0f", r.rate);
+    }
+    else
+    {
+      strcpy(rate, "driver");
+    }
+    printf("%8d %10s %12.0f %10.2f %10.2f %10.2f %8llu\n", r.threads, rate,
+           (r.elapsed > 0.0) ? (r.ops / r.elapsed) : 0.0, r.all.percentile(0.5) * 1e6,
+           r.all.percentile(0.99) * 1e6, r.all.percentile(0.999) * 1e6,
+           r.tornPose + r.tornAxes + r.tornFrames);
+  }
+}
+
+
+static bool writeJson (const stressOptions &opt, const vector<stressResult> &results)
+{
+  FILE *out = fopen(opt.json.c_str(), "w");
+  if (out == NULL)
+  {
+    return false;
+  }
+
+  //! Labels and file names are written as given, less characters that would break the string
+  string label = opt.label, config = opt.config;
+  for (size_t i = 0; i < label.size(); ++i)
+  {
+    label[i] = (label[i] == '"' || label[i] == '\\') ? '_' : label[i];
+  }
+  for (size_t i = 0; i < config.size(); ++i)
+  {
+    config[i] = (config[i] == '"' || config[i] == '\\') ? '/' : config[i];
+  }
+
+  fprintf(out, "{\n");
+  fprintf(out, "  \"label\": \"%s\",\n", label.c_str());
+  fprintf(out, "  \"build\": \"%s %s\",\n", __DATE__, __TIME__);
+  fprintf(out, "  \"driver\": \"%s\",\n", opt.driver.c_str());
+  fprintf(out, "  \"config\": \"%s\",\n", config.c_str());
+  fprintf(out, "  \"duration\": %.3f,\n", opt.duration);
+  fprintf(out, "  \"mix\": {");
+  for (int op = 0, n = 0; op < OP_COUNT; ++op)
+  {
+    if (opt.weights[op] > 0)
+    {
+      fprintf(out, "%s\"%s\": %d", (n++ > 0) ? ", " : "", opNames[op], opt.weights[op]);
+    }
+  }
+  fprintf(out, "},\n");
+  fprintf(out, "  \"units\": \"us\",\n");
+  fprintf(out, "  \"runs\": [\n");
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    const stressResult &r = results[i];
+    fprintf(out, "    {\"threads\": %d, \"rate\": %.1f, \"throughput\": %.1f, \"torn_pose\": %llu, "
+            "\"torn_axes\": %llu, \"torn_frames\": %llu, \"out_of_order\": %llu,\n", r.threads, r.rate,
+            (r.elapsed > 0.0) ? (r.ops / r.elapsed) : 0.0, r.tornPose, r.tornAxes, r.tornFrames, r.backwards);
+    fprintf(out, "     \"metrics\": {\n");
+    for (int op = 0; op <= OP_COUNT; ++op)
+    {
+      const LatencyHistogram &h = (op < OP_COUNT) ? r.hist[op] : r.all;
+      if (op < OP_COUNT && h.count() == 0 && h.misses() == 0)
+      {
+        continue;
+      }
+      fprintf(out, "       \"%s\": {\"count\": %llu, \"misses\": %llu, \"mean\": %.3f, \"p50\": %.3f, "
+              "\"p99\": %.3f, \"p999\": %.3f, \"max\": %.3f}%s\n", (op < OP_COUNT) ? opNames[op] : "all",
+              h.count(), h.misses(), h.mean() * 1e6, h.percentile(0.5) * 1e6, h.percentile(0.99) * 1e6,
+              h.percentile(0.999) * 1e6, h.max() * 1e6, (op < OP_COUNT) ? "," : "");
+    }
+    fprintf(out, "     }}%s\n", (i + 1 < results.size()) ? "," : "");
+  }
+  fprintf(out, "  ]\n}\n");
+  fclose(out);
+  return true;
+}
+
+
+template <class T> int runStress (stressOptions &opt)
+{
+  CrpiRobot<T> arm(opt.config.c_str());
+  stressShared<T> shared;
+  vector<stressResult> results;
+  robotPose curPose;
+  robotAxes curAxes;
+  bool sim = (opt.driver == "sim"), moving, frames;
+  int i, op;
+
+  arm.SetAngleUnits("degree");
+  arm.SetLengthUnits("mm");
+
+  shared.arm = &arm;
+  shared.total = 0;
+  for (op = 0; op < OP_COUNT; ++op)
+  {
+    shared.weights[op] = opt.weights[op];
+    shared.total += opt.weights[op];
+  }
+  if (shared.total <= 0)
+  {
+    cout << "Nothing to run:  every weight of the mix is 0" << endl;
+    return 1;
+  }
+  moving = (opt.weights[OP_LIN] > 0 || opt.weights[OP_JOINT] > 0);
+  frames = (opt.weights[OP_FRAME] > 0 || opt.weights[OP_SUBJECT] > 0);
+
+#ifdef CRPI_STRESS_MOCAP
+  Sensor::MoCapReplay *replay = NULL;
+  shared.mocap = NULL;
+  shared.subject = -1;
+  if (frames)
+  {
+    replay = new Sensor::MoCapReplay(opt.mocap.c_str());
+    if (!replay->Valid())
+    {
+      cout << "Could not open the recording " << opt.mocap << endl;
+      delete replay;
+      return 1;
+    }
+    //! The subject operation follows the first rigid body of the first replayed frame
+    for (double t0 = ulapi_time(); shared.subject < 0 && ulapi_time() - t0 < STRESS_MOCAP_TIMEOUT;)
+    {
+      Sensor::MoCapFrameView view;
+      if (replay->AcquireFrame(view) && view->subjectCount > 0)
+      {
+        shared.subject = view->subjects[0].id;
+      }
+      else
+      {
+        ulapi_sleep(0.01);
+      }
+    }
+    shared.mocap = replay;
+  }
+#else
+  if (frames)
+  {
+    cout << "Built without motion capture support (CRPI_STRESS_MOCAP)" << endl;
+    return 1;
+  }
+#endif
+
+  //! The lines of motion run from where the robot is
+  if (arm.GetRobotPose(&curPose) != CANON_SUCCESS || arm.GetRobotAxes(&curAxes) != CANON_SUCCESS)
+  {
+    if (moving)
+    {
+      cout << "Could not read the robot's position; not running the motion operations" << endl;
+      opt.weights[OP_LIN] = opt.weights[OP_JOINT] = 0;
+      shared.weights[OP_LIN] = shared.weights[OP_JOINT] = 0;
+      shared.total = 0;
+      for (op = 0; op < OP_COUNT; ++op)
+      {
+        shared.total += shared.weights[op];
+      }
+      if (shared.total <= 0)
+      {
+        return 1;
+      }
+      moving = false;
+    }
+  }
+  shared.line[0] = shared.line[1] = curPose;
+  shared.line[1].x += opt.offset;
+  shared.line[1].y += opt.offset;
+  shared.line[1].z += opt.offset;
+  shared.lineAxes[0] = shared.lineAxes[1] = curAxes;
+  for (i = 0; i < curAxes.axes; ++i)
+  {
+    shared.lineAxes[1].axis[i] += opt.joint;
+  }
+  shared.checkPose = (opt.weights[OP_LIN] > 0 && (opt.weights[OP_JOINT] == 0 || sim));
+  shared.checkAxes = (opt.weights[OP_JOINT] > 0 && (opt.weights[OP_LIN] == 0 || sim));
+  shared.tolerance = opt.tolerance;
+
+  if ((moving || opt.weights[OP_DO] > 0) && !opt.confirmed)
+  {
+    cout << "Robot Pose (" << curPose.x << ", " << curPose.y << ", " << curPose.z << ", " << curPose.xrot
+         << ", " << curPose.yrot << ", " << curPose.zrot << ")" << endl;
+    cout << "Enter 1 to run the test (the robot will move or set its outputs), 0 to quit: ";
+    cin >> i;
+    if (i < 1)
+    {
+      return 0;
+    }
+  }
+
+  if (!opt.rates.empty() && !sim)
+  {
+    cout << "Feedback rates can only be set on the simulated robot; using the driver's rate" << endl;
+    opt.rates.clear();
+  }
+  if (opt.rates.empty())
+  {
+    opt.rates.push_back(0.0);
+  }
+
+  for (size_t r = 0; r < opt.rates.size(); ++r)
+  {
+    if (opt.rates[r] > 0.0)
+    {
+      if (arm.SetParameter("sim_rate", &opt.rates[r]) != CANON_SUCCESS)
+      {
+        cout << "Could not set the feedback rate to " << opt.rates[r] << " Hz" << endl;
+        continue;
+      }
+      ulapi_sleep(STRESS_RATE_SETTLE);
+    }
+    for (size_t t = 0; t < opt.threads.size(); ++t)
+    {
+      results.push_back(stressResult());
+      results.back().rate = opt.rates[r];
+      runConfiguration(shared, opt, opt.threads[t], results.back());
+      printResult(results.back(), (shared.checkPose || shared.checkAxes), frames);
+    }
+  }
+
+  if (opt.weights[OP_LIN] > 0)
+  {
+    arm.MoveStraightTo(curPose);
+  }
+  if (opt.weights[OP_JOINT] > 0)
+  {
+    arm.MoveToAxisTarget(curAxes);
+  }
+#ifdef CRPI_STRESS_MOCAP
+  delete replay;
+#endif
+
+  printSummary(results);
+  if (!opt.json.empty())
+  {
+    if (!writeJson(opt, results))
+    {
+      cout << "Could not write " << opt.json << endl;
+      return 1;
+    }
+    cout << "Report written to " << opt.json << endl;
+  }
+  return 0;
+}
+
+
+//! @brief Parse a comma-separated list of positive numbers
+//!
+template <class N> static bool parseList (const char *text, vector<N> &list)
+{
+  char *end;
+  list.clear();
+  while (*text != '\0')
+  {
+    double value = strtod(text, &end);
+    if (end == text || value <= 0.0 || (*end != ',' && *end != '\0'))
+    {
+      return false;
+    }
+    list.push_back((N)value);
+    text = (*end == ',') ? (end + 1) : end;
+  }
+  return !list.empty();
+}
+
+
+//! @brief Parse the operation weights (NAME=W,...); operations not named get a weight of 0
+//!
+static bool parseMix (const char *text, int *weights)
+{
+  string item;
+  const char *next;
+  int op;
+
+  memset(weights, 0, OP_COUNT * sizeof(int));
+  while (*text != '\0')
+  {
+    next = strchr(text, ',');
+    item.assign(text, (next == NULL) ? strlen(text) : (size_t)(next - text));
+    size_t eq = item.find('=');
+    if (eq == string::npos)
+    {
+      return false;
+    }
+    for (op = 0; op < OP_COUNT && item.compare(0, eq, opNames[op]) != 0; ++op);
+    if (op == OP_COUNT || atoi(item.c_str() + eq + 1) < 0)
+    {
+      return false;
+    }
+    weights[op] = atoi(item.c_str() + eq + 1);
+    text = (next == NULL) ? (text + item.size()) : (next + 1);
+  }
+  return true;
+}
+
+
+static void usage ()
+{
+  cout << "Usage:  crpi_stress <abb|universal|kuka_lwr|robotiq|sim> <config.xml> [--threads LIST]" << endl
+       << "                    [--rates LIST] [--duration S] [--mix NAME=W,...] [--offset MM]" << endl
+       << "                    [--joint DEG] [--tolerance T] [--mocap FILE] [--json FILE]" << endl
+       << "                    [--label TEXT] [--yes]" << endl
+       << "  mix operations:  pose, axes, state, io, do, lin, joint, frame, subject" << endl;
+}
+
+
+int main (int argc, char *argv[])
+{
+  stressOptions opt;
+  int i;
+
+  if (argc < 3)
+  {
+    usage();
+    return 1;
+  }
+  opt.driver = argv[1];
+  opt.config = argv[2];
+  parseList("1,2,4,8,16", opt.threads);
+  for (i = 3; i < argc; ++i)
+  {
+    bool more = (i + 1 < argc), ok = true;
+    if (strcmp(argv[i], "--threads") == 0 && more)
+    {
+      ok = parseList(argv[++i], opt.threads);
+    }
+    else if (strcmp(argv[i], "--rates") == 0 && more)
+    {
+      ok = parseList(argv[++i], opt.rates);
+    }
+    else if (strcmp(argv[i], "--duration") == 0 && more)
+    {
+      opt.duration = atof(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--mix") == 0 && more)
+    {
+      ok = parseMix(argv[++i], opt.weights);
+      opt.mixed = true;
+    }
+    else if (strcmp(argv[i], "--offset") == 0 && more)
+    {
+      opt.offset = atof(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--joint") == 0 && more)
+    {
+      opt.joint = atof(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--tolerance") == 0 && more)
+    {
+      opt.tolerance = atof(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--mocap") == 0 && more)
+    {
+      opt.mocap = argv[++i];
+    }
+    else if (strcmp(argv[i], "--json") == 0 && more)
+    {
+      opt.json = argv[++i];
+    }
+    else if (strcmp(argv[i], "--label") == 0 && more)
+    {
+      opt.label = argv[++i];
+    }
+    else if (strcmp(argv[i], "--yes") == 0)
+    {
+      opt.confirmed = true;
+    }
+    else
+    {
+      ok = false;
+    }
+    if (!ok)
+    {
+      usage();
+      return 1;
+    }
+  }
+  opt.duration = (opt.duration > 0.0) ? opt.duration : 2.0;
+  if (!opt.mocap.empty() && !opt.mixed)
+  {
+    opt.weights[OP_FRAME] = opt.weights[OP_SUBJECT] = 10;
+  }
+  else if (opt.mocap.empty() && (opt.weights[OP_FRAME] > 0 || opt.weights[OP_SUBJECT] > 0))
+  {
+    cout << "The frame and subject operations need a recording (--mocap)" << endl;
+    return 1;
+  }
+
+  if (opt.driver == "abb")
+  {
+    return runStress<CrpiAbb>(opt);
+  }
+  else if (opt.driver == "universal")
+  {
+    return runStress<CrpiUniversal>(opt);
+  }
+  else if (opt.driver == "kuka_lwr")
+  {
+    return runStress<CrpiKukaLWR>(opt);
+  }
+  else if (opt.driver == "robotiq")
+  {
+    return runStress<CrpiRobotiq>(opt);
+  }
+  else if (opt.driver == "sim")
+  {
+    return runStress<CrpiSim>(opt);
+  }
+  cout << "Unknown driver " << opt.driver << endl;
+  usage();
+  return 1;
+}
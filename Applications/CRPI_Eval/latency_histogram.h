@@ -0,0 +1,153 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       CRPI Performance Evaluation
+//  Workfile:        latency_histogram.h
+//  Revision:        15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Latency histogram shared by crpi_eval and crpi_stress.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <vector>
+#include <cmath>
+
+//! @brief Linear sub-buckets per power of two in the histograms (a relative resolution of
+//!        1/HIST_SUB), and the number of buckets to cover 64-bit nanosecond values
+//!
+#define HIST_SUB 64
+#define HIST_BUCKETS ((2 * HIST_SUB) + (57 * HIST_SUB))
+
+//! @brief Latency histogram with log-linear buckets, in the manner of HdrHistogram:  the
+//!        resolution is the same fraction of the value over the whole range, so the tail
+//!        percentiles are as precise as the median, and recording never allocates.
+//!
+class LatencyHistogram
+{
+public:
+  LatencyHistogram () :
+    counts_(HIST_BUCKETS, 0),
+    total_(0),
+    misses_(0),
+    max_(0.0),
+    sum_(0.0)
+  {
+  }
+
+  //! @brief Record a latency (s)
+  //!
+  void record (double secs)
+  {
+    unsigned long long ns = (secs > 0.0) ? (unsigned long long)(secs * 1e9) : 0;
+    ++counts_[bucket(ns)];
+    ++total_;
+    sum_ += secs;
+    max_ = (secs > max_) ? secs : max_;
+  }
+
+  //! @brief Record a sample that could not be measured (failed call, no motion, timeout)
+  //!
+  void miss ()
+  {
+    ++misses_;
+  }
+
+  //! @brief Add the samples of another histogram (e.g., one kept by another thread)
+  //!
+  void merge (const LatencyHistogram &other)
+  {
+    for (int b = 0; b < HIST_BUCKETS; ++b)
+    {
+      counts_[b] += other.counts_[b];
+    }
+    total_ += other.total_;
+    misses_ += other.misses_;
+    sum_ += other.sum_;
+    max_ = (other.max_ > max_) ? other.max_ : max_;
+  }
+
+  unsigned long long count () const
+  {
+    return total_;
+  }
+
+  unsigned long long misses () const
+  {
+    return misses_;
+  }
+
+  double max () const
+  {
+    return max_;
+  }
+
+  double mean () const
+  {
+    return (total_ > 0) ? (sum_ / total_) : 0.0;
+  }
+
+  //! @brief Value (s) at or below which a fraction p of the samples lie, to the resolution of
+  //!        the buckets
+  //!
+  double percentile (double p) const
+  {
+    if (total_ == 0)
+    {
+      return 0.0;
+    }
+    unsigned long long rank = (unsigned long long)ceil(p * total_), seen = 0;
+    rank = (rank < 1) ? 1 : rank;
+    for (int b = 0; b < HIST_BUCKETS; ++b)
+    {
+      seen += counts_[b];
+      if (seen >= rank)
+      {
+        double mid = 0.5e-9 * (double)(lower(b) + lower(b + 1));
+        return (mid < max_) ? mid : max_;
+      }
+    }
+    return max_;
+  }
+
+private:
+  static int bucket (unsigned long long ns)
+  {
+    if (ns < 2 * HIST_SUB)
+    {
+      return (int)ns;
+    }
+    int e = 0;
+    for (unsigned long long v = ns; v > 1; v >>= 1)
+    {
+      ++e;
+    }
+    //! e >= 7:  keep the top 7 bits, of which the first is always set
+    int sub = (int)(ns >> (e - 6));
+    return (2 * HIST_SUB) + ((e - 7) * HIST_SUB) + (sub - HIST_SUB);
+  }
+
+  static unsigned long long lower (int b)
+  {
+    if (b < 2 * HIST_SUB)
+    {
+      return (unsigned long long)b;
+    }
+    int e = ((b - (2 * HIST_SUB)) / HIST_SUB) + 7;
+    unsigned long long sub = ((b - (2 * HIST_SUB)) % HIST_SUB) + HIST_SUB;
+    return sub << (e - 6);
+  }
+
+  std::vector<unsigned long long> counts_;
+  unsigned long long total_;
+  unsigned long long misses_;
+  double max_;
+  double sum_;
+};
+
+#endif
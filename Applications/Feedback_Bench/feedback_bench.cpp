@@ -0,0 +1,179 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Feedback Parsing Benchmark
+//  Workfile:        feedback_bench.cpp
+//  Revision:        1.0 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Micro-benchmark comparing the per-reply cost of the former string-based
+//  KUKA LWR feedback parser against crpi_parse_values.  Replies are read one
+//  per line from a capture file given on the command line, or generated in the
+//  KRC2 reply format if no capture is given.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include "../../Libraries/CRPI/crpi_parse.h"
+
+using namespace std;
+
+//! @brief Bytes kept per reply (both parsers look at the first 80), and number of passes over
+//!        the reply set
+//!
+#define BENCH_BUFFER 128
+#define BENCH_PASSES 200
+
+//! @brief Accumulated so the compiler cannot discard the parses being timed
+//!
+static volatile double sink = 0.0;
+
+//! @brief The parser CrpiKukaLWR::parseFeedback used before crpi_parse_values
+//!
+static bool legacyParse (const char *mssgBuffer, vector<string> *tempData, double *feedback, int num)
+{
+  bool newItem = false;
+  int index = -1, i;
+
+  for (i = 0; i < num; ++i)
+  {
+    tempData->at(i) = "";
+  }
+
+  for (i = 0; i < 80; ++i)
+  {
+    if (mssgBuffer[i] == ' ')
+    {
+      newItem = false;
+    }
+    else
+    {
+      if (!newItem)
+      {
+        newItem = true;
+        index++;
+        if (index >= num)
+        {
+          break;
+        }
+      }
+      tempData->at(index).push_back (mssgBuffer[i]);
+    }
+  }
+
+  for (i = 0; i < num; ++i)
+  {
+    feedback[i] = stod (tempData->at(i));
+  }
+  return true;
+}
+
+//! @brief Time a parser over the whole reply set and report the average cost
+//!
+//! @param name The label to print
+//! @param fn   Callable run once per pass over the reply set
+//! @param n    Number of replies per pass
+//!
+template <class F> void report (const char *name, F fn, size_t n)
+{
+  fn();
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  for (int pass = 0; pass < BENCH_PASSES; ++pass)
+  {
+    fn();
+  }
+  double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+  cout.width(40);
+  cout << left << name << ns / ((double)n * BENCH_PASSES) << " ns/reply" << endl;
+}
+
+int main (int argc, char *argv[])
+{
+  vector<vector<char> > replies;
+  char line[8192];
+
+  if (argc > 1)
+  {
+    ifstream capture(argv[1]);
+    if (!capture)
+    {
+      cout << "Could not open capture file " << argv[1] << endl;
+      return 1;
+    }
+    while (capture.getline(line, sizeof(line)))
+    {
+      replies.push_back(vector<char>(BENCH_BUFFER, '\0'));
+      strncpy(&replies.back()[0], line, BENCH_BUFFER - 1);
+    }
+  }
+  else
+  {
+    //! GetRobotPose replies:  X Y Z A B C S T
+    srand(1);
+    for (int i = 0; i < 4096; ++i)
+    {
+      snprintf(line, sizeof(line), "%.6f %.6f %.6f %.6f %.6f %.6f %d %d",
+               (rand() % 1000000) / 1000.0, (rand() % 1000000) / 1000.0 - 500.0,
+               (rand() % 1000000) / 1000.0, (rand() % 36000) / 100.0 - 180.0,
+               (rand() % 18000) / 100.0 - 90.0, (rand() % 36000) / 100.0 - 180.0,
+               rand() % 8, rand() % 64);
+      replies.push_back(vector<char>(BENCH_BUFFER, '\0'));
+      memcpy(&replies.back()[0], line, strlen(line));
+    }
+  }
+  if (replies.empty())
+  {
+    cout << "No replies to parse" << endl;
+    return 1;
+  }
+
+  vector<string> tempData(10, " ");
+  double feedback[10], check[10];
+
+  report("legacy string parser", [&]() {
+    for (size_t i = 0; i < replies.size(); ++i)
+    {
+      legacyParse(&replies[i][0], &tempData, feedback, 8);
+      sink += feedback[0];
+    }
+  }, replies.size());
+
+  report("crpi_parse_values", [&]() {
+    for (size_t i = 0; i < replies.size(); ++i)
+    {
+      crpi_parse_values(&replies[i][0], 80, " ", feedback, 8);
+      sink += feedback[0];
+    }
+  }, replies.size());
+
+  //! Both parsers should agree on every reply
+  size_t mismatches = 0;
+  for (size_t i = 0; i < replies.size(); ++i)
+  {
+    legacyParse(&replies[i][0], &tempData, check, 8);
+    if (crpi_parse_values(&replies[i][0], 80, " ", feedback, 8) != 8)
+    {
+      ++mismatches;
+      continue;
+    }
+    for (int j = 0; j < 8; ++j)
+    {
+      if (fabs(check[j] - feedback[j]) > 0.0)
+      {
+        ++mismatches;
+        break;
+      }
+    }
+  }
+  cout << "Replies parsed differently: " << mismatches << " of " << replies.size() << endl;
+
+  return 0;
+}
@@ -0,0 +1,172 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Math Benchmark
+//  Workfile:        kalman_bench.cpp
+//  Revision:        1.0 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Micro-benchmark reporting the per-sample cost of a Kalman filter update
+//  with the dynamic matrix type (as in Kalman::updateEstimate) and with
+//  FixedKalman, on a constant-velocity model of one tracked MoCap body, and
+//  the per-sample cost of SimpleKalman and BatchKalman over many channels.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <cstdlib>
+#include <cmath>
+#include "../../Libraries/Math/Filters.h"
+
+using namespace std;
+using namespace Math;
+
+//! @brief Number of samples filtered per pass and number of passes
+//!
+#define BENCH_SAMPLES 2400
+#define BENCH_PASSES 50
+
+//! @brief MoCap sample period (s) and measurement noise (mm)
+//!
+#define BENCH_DT (1.0 / 120.0)
+#define BENCH_NOISE 0.5
+
+//! @brief Number of independent channels in the scalar filter comparison (8 EMG x 8 armbands)
+//!
+#define BENCH_CHANNELS 64
+
+//! @brief Accumulated so the compiler cannot discard the updates being timed
+//!
+static volatile double sink = 0.0;
+
+//! @brief Time a filter over the whole sample set and report the average cost
+//!
+//! @param name The label to print
+//! @param fn   Callable run once per pass over the sample set
+//!
+template <class F> void report (const char *name, F fn)
+{
+  fn();
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  for (int pass = 0; pass < BENCH_PASSES; ++pass)
+  {
+    fn();
+  }
+  double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+  cout.width(40);
+  cout << left << name << ns / ((double)BENCH_SAMPLES * BENCH_PASSES) << " ns/update" << endl;
+}
+
+//! @brief Uniform noise in [-BENCH_NOISE, BENCH_NOISE]
+//!
+static double noise ()
+{
+  return BENCH_NOISE * (2.0 * rand() / (double)RAND_MAX - 1.0);
+}
+
+int main ()
+{
+  vector<Mat<3, 1> > readings(BENCH_SAMPLES);
+  vector<Mat<6, 1> > dynamicEst(BENCH_SAMPLES), fixedEst(BENCH_SAMPLES);
+
+  //! Body moving on a circle; the measurement is its noisy position
+  srand(1);
+  for (int i = 0; i < BENCH_SAMPLES; ++i)
+  {
+    double t = i * BENCH_DT;
+    readings[i].at(0, 0) = 500.0 * cos(t) + noise();
+    readings[i].at(1, 0) = 500.0 * sin(t) + noise();
+    readings[i].at(2, 0) = 100.0 * t + noise();
+  }
+
+  //! State (x, y, z, vx, vy, vz), measurement (x, y, z)
+  Mat<6, 6> F = Mat<6, 6>::identity(), Q = Mat<6, 6>::identity() * 0.01;
+  Mat<3, 6> H = Mat<3, 6>::identity();
+  Mat<3, 3> R = Mat<3, 3>::identity() * (BENCH_NOISE * BENCH_NOISE / 3.0);
+  for (int i = 0; i < 3; ++i)
+  {
+    F.at(i, i + 3) = BENCH_DT;
+    Q.at(i + 3, i + 3) = 10.0;
+  }
+
+  //! The same sequence of products, sums, and the explicit inverse as Kalman::updateEstimate,
+  //! on operands of the model's size.  Kalman itself is not called:  it never stores its
+  //! estimate, so every update would start from an empty state vector.
+  report("matrix (Kalman::updateEstimate)", [&]() {
+    matrix Fd = F.toMatrix(), Qd = Q.toMatrix(), Hd = H.toMatrix(), Rd = R.toMatrix();
+    matrix P, x(6, 1), I;
+    P.identity(6);
+    I.identity(6);
+    for (int i = 0; i < BENCH_SAMPLES; ++i)
+    {
+      matrix z = readings[i].toMatrix();
+      matrix xknew = Fd * x;
+      matrix PKnew = (Fd * P * Fd.trans()) + Qd;
+      matrix temp = (Hd * PKnew * Hd.trans() + Rd);
+      matrix Kk = (PKnew * Hd.trans()) * temp.inv();
+      x = xknew + (Kk * (z - (Hd * xknew)));
+      P = (I - (Kk * Hd)) * PKnew;
+      dynamicEst[i] = Mat<6, 1>(x);
+      sink += x.at(0, 0);
+    }
+  });
+
+  report("FixedKalman<6, 3>", [&]() {
+    FixedKalman<6, 3> filter;
+    filter.init(F, Mat<6, 1>(), Q, H, R);
+    for (int i = 0; i < BENCH_SAMPLES; ++i)
+    {
+      filter.updateEstimate(fixedEst[i], readings[i]);
+      sink += fixedEst[i].at(0, 0);
+    }
+  });
+
+  //! Both forms of the update agree in exact arithmetic
+  double diff = 0.0, err = 0.0;
+  for (int i = 0; i < BENCH_SAMPLES; ++i)
+  {
+    for (int j = 0; j < 6; ++j)
+    {
+      diff = max(diff, fabs(dynamicEst[i].at(j, 0) - fixedEst[i].at(j, 0)));
+    }
+    double t = i * BENCH_DT;
+    err = max(err, fabs(fixedEst[i].at(0, 0) - 500.0 * cos(t)) * ((i > 120) ? 1.0 : 0.0));
+  }
+  cout << "Largest difference between the two estimates:  " << diff << endl;
+  cout << "Largest x tracking error after the first second (mm):  " << err << endl;
+
+  //! Independent scalar channels, e.g., EMG from several armbands
+  vector<vector<double> > channels(BENCH_SAMPLES, vector<double>(BENCH_CHANNELS));
+  for (int i = 0; i < BENCH_SAMPLES; ++i)
+  {
+    for (int j = 0; j < BENCH_CHANNELS; ++j)
+    {
+      channels[i][j] = sin(i * BENCH_DT + j) + noise();
+    }
+  }
+  vector<double> chanNoise(BENCH_CHANNELS, BENCH_NOISE * BENCH_NOISE / 3.0), chanEst;
+
+  report("SimpleKalman, 64 channels", [&]() {
+    SimpleKalman filter;
+    for (int i = 0; i < BENCH_SAMPLES; ++i)
+    {
+      filter.updateEstimate(chanEst, channels[i], chanNoise);
+      sink += chanEst[0];
+    }
+  });
+
+  report("BatchKalman, 64 channels", [&]() {
+    BatchKalman filter(BENCH_CHANNELS);
+    filter.setNoise(chanNoise.data());
+    for (int i = 0; i < BENCH_SAMPLES; ++i)
+    {
+      filter.updateEstimate(chanEst, channels[i]);
+      sink += chanEst[0];
+    }
+  });
+
+  return 0;
+}
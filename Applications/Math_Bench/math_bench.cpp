@@ -0,0 +1,157 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Math Benchmark
+//  Workfile:        math_bench.cpp
+//  Revision:        1.0 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Micro-benchmark reporting the per-conversion cost of the rotation
+//  representation conversions in MatrixMath.h and RotationMath.h.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <cstdlib>
+#include "../../Libraries/Math/MatrixMath.h"
+#include "../../Libraries/Math/RotationMath.h"
+
+using namespace std;
+using namespace Math;
+
+//! @brief Number of poses converted per pass and number of passes
+//!
+#define BENCH_POSES 4096
+#define BENCH_PASSES 200
+
+//! @brief Accumulated so the compiler cannot discard the conversions being timed
+//!
+static volatile double sink = 0.0;
+
+//! @brief Time a conversion over the whole pose set and report the average cost
+//!
+//! @param name The label to print
+//! @param fn   Callable run once per pass over the pose set
+//!
+template <class F> void report (const char *name, F fn)
+{
+  fn();
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  for (int pass = 0; pass < BENCH_PASSES; ++pass)
+  {
+    fn();
+  }
+  double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+  cout.width(40);
+  cout << left << name << ns / ((double)BENCH_POSES * BENCH_PASSES) << " ns/conversion" << endl;
+}
+
+int main ()
+{
+  vector<pose> poses(BENCH_POSES), outPoses(BENCH_POSES);
+  vector<qpose> qposes(BENCH_POSES);
+  vector<Mat4> transforms(BENCH_POSES);
+
+  srand(1);
+  for (int i = 0; i < BENCH_POSES; ++i)
+  {
+    poses[i] = pose(rand() % 1000, rand() % 1000, rand() % 1000,
+                    (rand() % 36000) / 100.0 - 180.0,
+                    (rand() % 18000) / 100.0 - 90.0,
+                    (rand() % 36000) / 100.0 - 180.0);
+  }
+
+  report("matrix::RPYMatrixConvert", [&]() {
+    matrix m(4, 4);
+    for (int i = 0; i < BENCH_POSES; ++i)
+    {
+      m.RPYMatrixConvert(poses[i], true);
+      sink += m.at(0, 0);
+    }
+  });
+
+  report("matrix::matrixRPYConvert", [&]() {
+    matrix m(4, 4);
+    pose p;
+    m.RPYMatrixConvert(poses[0], true);
+    for (int i = 0; i < BENCH_POSES; ++i)
+    {
+      m.at(0, 3) = i;
+      m.matrixRPYConvert(p, true);
+      sink += p.xr;
+    }
+  });
+
+  report("Mat4::RPYMatrixConvert", [&]() {
+    Mat4 m;
+    for (int i = 0; i < BENCH_POSES; ++i)
+    {
+      m.RPYMatrixConvert(poses[i], true);
+      sink += m.at(0, 0);
+    }
+  });
+
+  report("Mat4::matrixRPYConvert", [&]() {
+    for (int i = 0; i < BENCH_POSES; ++i)
+    {
+      transforms[i].matrixRPYConvert(outPoses[i], true);
+    }
+    sink += outPoses[0].xr;
+  });
+
+  report("RPYToQuaternion", [&]() {
+    for (int i = 0; i < BENCH_POSES; ++i)
+    {
+      quaternion q = RPYToQuaternion(poses[i].xr, poses[i].yr, poses[i].zr, true);
+      sink += q.w;
+    }
+  });
+
+  report("quaternionToRPY", [&]() {
+    pose p;
+    for (int i = 0; i < BENCH_POSES; ++i)
+    {
+      quaternionToRPY(qposes[i].orientation, p.xr, p.yr, p.zr, true);
+      sink += p.xr;
+    }
+  });
+
+  report("RPYToQuaternionBatch", [&]() {
+    RPYToQuaternionBatch(&poses[0], &qposes[0], BENCH_POSES, true);
+    sink += qposes[0].orientation.w;
+  });
+
+  report("quaternionToRPYBatch", [&]() {
+    quaternionToRPYBatch(&qposes[0], &outPoses[0], BENCH_POSES, true);
+    sink += outPoses[0].xr;
+  });
+
+  report("RPYMatrixBatch", [&]() {
+    RPYMatrixBatch(&poses[0], &transforms[0], BENCH_POSES, true);
+    sink += transforms[0].at(0, 0);
+  });
+
+  report("qpose compose", [&]() {
+    qpose acc;
+    for (int i = 0; i < BENCH_POSES; ++i)
+    {
+      acc = qposes[i] * qposes[(i + 1) % BENCH_POSES];
+      sink += acc.position.x;
+    }
+  });
+
+  //! Round trip check:  RPY -> quaternion -> RPY should reproduce the input
+  double worst = 0.0;
+  for (int i = 0; i < BENCH_POSES; ++i)
+  {
+    pose p = fromQPose(toQPose(poses[i], true), true);
+    double err = fabs(p.xr - poses[i].xr) + fabs(p.yr - poses[i].yr) + fabs(p.zr - poses[i].zr);
+    worst = (err > worst) ? err : worst;
+  }
+  cout << "Largest round trip error: " << worst << " degrees" << endl;
+
+  return 0;
+}
@@ -0,0 +1,566 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       ROS 2 Bridge
+//  Workfile:        crpi_ros2_bridge.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  ROS 2 node that publishes a CRPI robot's state snapshots (and optionally
+//  the frames of a NatNet motion capture stream) as the fixed-size messages
+//  of crpi_msgs, and streams the setpoints it receives to the robot.
+//
+//  Each new RobotStateSnapshot is written straight into a message loaned
+//  from the middleware, so with a shared-memory RMW (rmw_iceoryx_cpp, or
+//  rmw_cyclonedds_cpp with iceoryx enabled) the state is copied once, from
+//  the driver's sequence lock into shared memory, and never serialized.
+//  Other RMWs fall back to a message allocated by rclcpp.
+//
+//  Usage:  crpi_ros2_bridge <driver> <config.xml> [options]
+//          crpi_ros2_bridge shm <key> [options]
+//    driver             abb, universal, kuka_lwr, robotiq, or sim:  the bridge
+//                       drives the robot, and accepts setpoints
+//    shm <key>          Publish the state another process mirrors with
+//                       CrpiRobot::PublishState (no setpoints)
+//    --name NAME        Node name, and the namespace of the topics (default
+//                       crpi_robot)
+//    --stream-timeout S End the stream when no setpoint arrives for S seconds
+//                       (default 0.1)
+//    --natnet IFACE     Also publish NatNet frames received on the interface
+//                       with address IFACE ("default" for the system default)
+//
+//  Topics (in the namespace NAME)
+//    state          crpi_msgs/RobotState, once per new snapshot
+//    setpoint       crpi_msgs/Setpoint, subscribed (driver mode only)
+//    mocap/frame    crpi_msgs/MoCapFrame, once per new frame
+//    mocap/subjects crpi_msgs/SubjectNames, whenever a subject appears
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <rclcpp/rclcpp.hpp>
+#include <crpi_msgs/msg/robot_state.hpp>
+#include <crpi_msgs/msg/mo_cap_frame.hpp>
+#include <crpi_msgs/msg/subject_names.hpp>
+#include <crpi_msgs/msg/setpoint.hpp>
+#include "crpi_robot.h"
+#include "crpi_state_shm.h"
+#include "crpi_kuka_lwr.h"
+#include "crpi_universal.h"
+#include "crpi_robotiq.h"
+#include "crpi_abb.h"
+#include "crpi_sim.h"
+#include "ulapi.h"
+#ifdef CRPI_ROS2_MOCAP
+#include "NatNetReceiver.h"
+#endif
+
+using namespace crpi_robot;
+using namespace std;
+
+//! @brief Period (s) at which new state snapshots and motion capture frames are looked for.
+//!        Well under the 2 ms of a 500 Hz robot, so a state is published at most this long
+//!        after the driver received it.
+//!
+#define BRIDGE_POLL_PERIOD 0.0002
+
+//! @brief Shared-memory transports allocate a fixed number of loans per publisher; a depth of
+//!        one keeps only the newest state, which is all a controller wants
+//!
+#define BRIDGE_QOS_DEPTH 1
+
+//! @brief Command line settings
+//!
+struct bridgeOptions
+{
+  string driver;
+  string config;
+  string name;
+  string natnet;
+  double streamTimeout;
+
+  bridgeOptions () :
+    name("crpi_robot"),
+    streamTimeout(0.1)
+  {
+  }
+};
+
+
+//! @brief Time of a CRPI timestamp (ulapi_time, s) on the node's clock
+//!
+static builtin_interfaces::msg::Time toStamp (rclcpp::Node &node, double timestamp)
+{
+  return node.now() - rclcpp::Duration::from_seconds(ulapi_time() - timestamp);
+}
+
+
+//! @brief Publishes the state snapshots of one robot
+//!
+class StateBridge
+{
+public:
+  StateBridge (rclcpp::Node &node) :
+    node_(node),
+    last_(0)
+  {
+    pub_ = node.create_publisher<crpi_msgs::msg::RobotState>("state",
+      rclcpp::QoS(BRIDGE_QOS_DEPTH).best_effort());
+  }
+
+  //! @brief Publish the source's state if it is newer than the last one published
+  //!
+  //! @param source A CrpiRobot or a CrpiStateReader
+  //!
+  //! @return True if a state was published
+  //!
+  template <class S> bool update (S &source)
+  {
+    if (source.GetRobotState(&state_) != CANON_SUCCESS || state_.sequence == last_)
+    {
+      return false;
+    }
+    last_ = state_.sequence;
+    publish(state_);
+    return true;
+  }
+
+private:
+  rclcpp::Node &node_;
+  rclcpp::Publisher<crpi_msgs::msg::RobotState>::SharedPtr pub_;
+  RobotStateSnapshot state_;
+  unsigned long last_;
+
+  void publish (const RobotStateSnapshot &state)
+  {
+    auto loan = pub_->borrow_loaned_message();
+    crpi_msgs::msg::RobotState &msg = loan.get();
+    int i;
+
+    msg.stamp = toStamp(node_, state.timestamp);
+    msg.sequence = state.sequence;
+    msg.valid = state.valid;
+    copyPose(state.pose, msg.pose.data());
+    copyPose(state.forces, msg.forces.data());
+    copyPose(state.speeds, msg.speeds.data());
+    msg.axes = (uint8_t)state.axes;
+    for (i = 0; i < CRPI_AXES_MAX; ++i)
+    {
+      msg.axis[i] = state.axis[i];
+      msg.torque[i] = state.torque[i];
+    }
+    msg.ndio = (uint8_t)state.ndio;
+    msg.naio = (uint8_t)state.naio;
+    for (i = 0; i < CRPI_IO_MAX; ++i)
+    {
+      msg.dio[i] = state.dio[i];
+      msg.aio[i] = state.aio[i];
+    }
+    msg.robot_mode = state.robotMode;
+    msg.safety_mode = state.safetyMode;
+    msg.program_state = (uint8_t)state.programState;
+    msg.status = state.status;
+    pub_->publish(std::move(loan));
+  }
+
+  static void copyPose (const robotPose &pose, double *out)
+  {
+    out[0] = pose.x;
+    out[1] = pose.y;
+    out[2] = pose.z;
+    out[3] = pose.xrot;
+    out[4] = pose.yrot;
+    out[5] = pose.zrot;
+  }
+};
+
+
+//! @brief Streams the setpoints received by the node to a robot.  The first setpoint starts a
+//!        stream (CrpiRobot::BeginStream), which ends on an END setpoint or when no setpoint
+//!        arrives within the timeout, so the robot is free for other commands again.
+//!
+template <class T> class StreamBridge
+{
+public:
+  StreamBridge (rclcpp::Node &node, CrpiRobot<T> &arm, double timeout) :
+    node_(node),
+    arm_(arm),
+    timeout_(timeout),
+    streaming_(false),
+    mode_(-1),
+    last_(0.0)
+  {
+    sub_ = node.create_subscription<crpi_msgs::msg::Setpoint>("setpoint",
+      rclcpp::QoS(BRIDGE_QOS_DEPTH).best_effort(),
+      [this] (const crpi_msgs::msg::Setpoint &msg) { onSetpoint(msg); });
+    timer_ = node.create_wall_timer(std::chrono::duration<double>(timeout / 2.0),
+      [this] () { onTimer(); });
+  }
+
+  ~StreamBridge ()
+  {
+    end();
+  }
+
+private:
+  rclcpp::Node &node_;
+  CrpiRobot<T> &arm_;
+  rclcpp::Subscription<crpi_msgs::msg::Setpoint>::SharedPtr sub_;
+  rclcpp::TimerBase::SharedPtr timer_;
+  double timeout_;
+  bool streaming_;
+  int mode_;
+  double last_;
+  robotPose pose_;
+  robotAxes axes_;
+
+  void onSetpoint (const crpi_msgs::msg::Setpoint &msg)
+  {
+    CanonReturn ret;
+
+    if (msg.mode == crpi_msgs::msg::Setpoint::END)
+    {
+      end();
+      return;
+    }
+
+    //! A stream carries either poses or axes; switching ends the old stream first
+    if (streaming_ && msg.mode != mode_)
+    {
+      end();
+    }
+    if (!streaming_)
+    {
+      if (arm_.BeginStream() != CANON_SUCCESS)
+      {
+        RCLCPP_WARN(node_.get_logger(), "Robot refused to start a stream");
+        return;
+      }
+      streaming_ = true;
+      mode_ = msg.mode;
+    }
+    last_ = ulapi_time();
+
+    if (msg.mode == crpi_msgs::msg::Setpoint::POSE)
+    {
+      pose_.x = msg.pose[0];
+      pose_.y = msg.pose[1];
+      pose_.z = msg.pose[2];
+      pose_.xrot = msg.pose[3];
+      pose_.yrot = msg.pose[4];
+      pose_.zrot = msg.pose[5];
+      ret = arm_.StreamPose(pose_);
+    }
+    else
+    {
+      axes_.axes = (msg.axes > CRPI_AXES_MAX) ? CRPI_AXES_MAX : msg.axes;
+      for (int i = 0; i < axes_.axes; ++i)
+      {
+        axes_.axis[i] = msg.axis[i];
+      }
+      ret = arm_.StreamAxes(axes_);
+    }
+    if (ret != CANON_SUCCESS)
+    {
+      RCLCPP_WARN(node_.get_logger(), "Setpoint not sent to the robot");
+    }
+  }
+
+  void onTimer ()
+  {
+    if (streaming_ && (ulapi_time() - last_) > timeout_)
+    {
+      RCLCPP_WARN(node_.get_logger(), "No setpoint for %.3f s, ending the stream", timeout_);
+      end();
+    }
+  }
+
+  void end ()
+  {
+    if (streaming_)
+    {
+      arm_.EndStream();
+      streaming_ = false;
+    }
+  }
+};
+
+
+#ifdef CRPI_ROS2_MOCAP
+//! @brief Publishes the frames of a motion capture stream, viewed in place in the stream's
+//!        frame pool, and the names of its subjects
+//!
+class MoCapBridge
+{
+public:
+  MoCapBridge (rclcpp::Node &node, Sensor::MoCapStream &stream) :
+    node_(node),
+    stream_(stream),
+    lastFrame_(0),
+    names_(0)
+  {
+    framePub_ = node.create_publisher<crpi_msgs::msg::MoCapFrame>("mocap/frame",
+      rclcpp::QoS(BRIDGE_QOS_DEPTH).best_effort());
+    namePub_ = node.create_publisher<crpi_msgs::msg::SubjectNames>("mocap/subjects",
+      rclcpp::QoS(1).reliable().transient_local());
+  }
+
+  //! @brief Publish the newest frame if it has not been published yet
+  //!
+  //! @return True if a frame was published
+  //!
+  bool update ()
+  {
+    Sensor::MoCapFrameView view;
+
+    if (!stream_.AcquireFrame(view) || view->frameNumber == lastFrame_)
+    {
+      return false;
+    }
+    lastFrame_ = view->frameNumber;
+    publishNames();
+    publish(*view.get());
+    return true;
+  }
+
+private:
+  rclcpp::Node &node_;
+  Sensor::MoCapStream &stream_;
+  rclcpp::Publisher<crpi_msgs::msg::MoCapFrame>::SharedPtr framePub_;
+  rclcpp::Publisher<crpi_msgs::msg::SubjectNames>::SharedPtr namePub_;
+  unsigned int lastFrame_;
+  int names_;
+
+  void publish (const Sensor::MoCapFrame &frame)
+  {
+    auto loan = framePub_->borrow_loaned_message();
+    crpi_msgs::msg::MoCapFrame &msg = loan.get();
+    const point *markers = frame.unlabeledMarkers();
+    int i, j;
+
+    msg.stamp = toStamp(node_, frame.timestamp);
+    msg.latency = frame.latency;
+    msg.frame_number = frame.frameNumber;
+    msg.subject_count = (uint8_t)frame.subjectCount;
+    for (i = 0; i < frame.subjectCount; ++i)
+    {
+      const Sensor::MoCapFrameSubject &subject = frame.subjects[i];
+      msg.subject_id[i] = subject.id;
+      msg.position[(i * 3) + 0] = subject.pose.x;
+      msg.position[(i * 3) + 1] = subject.pose.y;
+      msg.position[(i * 3) + 2] = subject.pose.z;
+      for (j = 0; j < 9; ++j)
+      {
+        msg.rotation[(i * 9) + j] = subject.rotation[j];
+      }
+    }
+    msg.marker_count = (uint16_t)frame.unlabeledCount;
+    for (i = 0; i < frame.unlabeledCount; ++i)
+    {
+      msg.markers[(i * 3) + 0] = markers[i].x;
+      msg.markers[(i * 3) + 1] = markers[i].y;
+      msg.markers[(i * 3) + 2] = markers[i].z;
+    }
+    framePub_->publish(std::move(loan));
+  }
+
+  //! @brief Publish the subject names when a new one has appeared (names are only ever
+  //!        added, with consecutive ids)
+  //!
+  void publishNames ()
+  {
+    int count = names_;
+
+    while (count < MOCAP_NAMES_MAX && stream_.SubjectName(count)[0] != '\0')
+    {
+      ++count;
+    }
+    if (count == names_)
+    {
+      return;
+    }
+    names_ = count;
+
+    crpi_msgs::msg::SubjectNames msg;
+    msg.names.reserve(count);
+    for (int i = 0; i < count; ++i)
+    {
+      msg.names.push_back(stream_.SubjectName(i));
+    }
+    namePub_->publish(msg);
+  }
+};
+#endif
+
+
+//! @brief Serve the node until it is shut down:  callbacks (setpoints) on a separate thread,
+//!        and new states and frames polled on this one
+//!
+template <class S> static int runBridge (rclcpp::Node::SharedPtr node, S &source,
+                                         const bridgeOptions &opt)
+{
+  rclcpp::executors::SingleThreadedExecutor executor;
+  StateBridge state(*node);
+
+  executor.add_node(node);
+  std::thread spinner([&executor] () { executor.spin(); });
+
+#ifdef CRPI_ROS2_MOCAP
+  Sensor::NatNetReceiver *natnet = NULL;
+  MoCapBridge *mocap = NULL;
+  if (!opt.natnet.empty())
+  {
+    natnet = new Sensor::NatNetReceiver((opt.natnet == "default") ? NULL : opt.natnet.c_str());
+    if (natnet->Listening())
+    {
+      mocap = new MoCapBridge(*node, *natnet);
+    }
+    else
+    {
+      RCLCPP_ERROR(node->get_logger(), "Could not join the NatNet stream on %s",
+                   opt.natnet.c_str());
+    }
+  }
+#else
+  if (!opt.natnet.empty())
+  {
+    RCLCPP_ERROR(node->get_logger(), "Built without motion capture support (CRPI_MOCAP)");
+  }
+#endif
+
+  while (rclcpp::ok())
+  {
+    bool busy = state.update(source);
+#ifdef CRPI_ROS2_MOCAP
+    if (mocap != NULL)
+    {
+      busy = mocap->update() || busy;
+    }
+#endif
+    if (!busy)
+    {
+      ulapi_sleep(BRIDGE_POLL_PERIOD);
+    }
+  }
+
+  executor.cancel();
+  spinner.join();
+#ifdef CRPI_ROS2_MOCAP
+  delete mocap;
+  delete natnet;
+#endif
+  return 0;
+}
+
+
+template <class T> static int runRobot (const bridgeOptions &opt)
+{
+  rclcpp::Node::SharedPtr node = std::make_shared<rclcpp::Node>(opt.name, opt.name);
+  CrpiRobot<T> arm(opt.config.c_str());
+  int ret;
+
+  {
+    StreamBridge<T> stream(*node, arm, opt.streamTimeout);
+    ret = runBridge(node, arm, opt);
+  }
+  return ret;
+}
+
+
+static int runShm (const bridgeOptions &opt)
+{
+  rclcpp::Node::SharedPtr node = std::make_shared<rclcpp::Node>(opt.name, opt.name);
+  CrpiStateReader reader((ulapi_id)strtoul(opt.config.c_str(), NULL, 0));
+
+  return runBridge(node, reader, opt);
+}
+
+
+static void usage ()
+{
+  cout << "Usage:  crpi_ros2_bridge <abb|universal|kuka_lwr|robotiq|sim> <config.xml> [options]" << endl
+       << "        crpi_ros2_bridge shm <key> [options]" << endl
+       << "Options:  [--name NAME] [--stream-timeout S] [--natnet IFACE]" << endl;
+}
+
+
+int main (int argc, char *argv[])
+{
+  bridgeOptions opt;
+  vector<string> args;
+  int i;
+
+  //! ROS arguments (--ros-args ...) are removed before the bridge's own are parsed
+  args = rclcpp::init_and_remove_ros_arguments(argc, argv);
+  if (args.size() < 3)
+  {
+    usage();
+    rclcpp::shutdown();
+    return 1;
+  }
+  opt.driver = args[1];
+  opt.config = args[2];
+  for (i = 3; i < (int)args.size(); ++i)
+  {
+    bool more = (i + 1 < (int)args.size());
+    if (args[i] == "--name" && more)
+    {
+      opt.name = args[++i];
+    }
+    else if (args[i] == "--stream-timeout" && more)
+    {
+      opt.streamTimeout = atof(args[++i].c_str());
+    }
+    else if (args[i] == "--natnet" && more)
+    {
+      opt.natnet = args[++i];
+    }
+    else
+    {
+      usage();
+      rclcpp::shutdown();
+      return 1;
+    }
+  }
+  opt.streamTimeout = (opt.streamTimeout < 0.01) ? 0.01 : opt.streamTimeout;
+
+  int ret = 1;
+  if (opt.driver == "shm")
+  {
+    ret = runShm(opt);
+  }
+  else if (opt.driver == "abb")
+  {
+    ret = runRobot<CrpiAbb>(opt);
+  }
+  else if (opt.driver == "universal")
+  {
+    ret = runRobot<CrpiUniversal>(opt);
+  }
+  else if (opt.driver == "kuka_lwr")
+  {
+    ret = runRobot<CrpiKukaLWR>(opt);
+  }
+  else if (opt.driver == "robotiq")
+  {
+    ret = runRobot<CrpiRobotiq>(opt);
+  }
+  else if (opt.driver == "sim")
+  {
+    ret = runRobot<CrpiSim>(opt);
+  }
+  else
+  {
+    cout << "Unknown driver " << opt.driver << endl;
+    usage();
+  }
+  rclcpp::shutdown();
+  return ret;
+}
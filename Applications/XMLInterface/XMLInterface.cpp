@@ -18,18 +18,38 @@
 #include <string.h>
 
 #include <fstream>
+#include <deque>
+#include <algorithm>
+#include <ctype.h>
 #include "crpi_robot.h"
+#include "crpi_any_robot.h"
 #include "crpi_abb.h"
 #include "crpi_kuka_lwr.h"
 #include "crpi_universal.h"
 #include "crpi_robotiq.h"
+#include "crpi_sim.h"
+#include "crpi_replay.h"
+#include "crpi_metrics.h"
+#include "crpi_gateway.h"
 #include "ulapi.h"
 
 //#define XMLINTERFACE_NOISY
 #define XMLINTERFACE_DEBUGTEST
 
+//! @brief Size of the per-client receive and response buffers (the largest binary frame plus
+//!        a terminator for XML strings)
+//!
+#define XMLINTERFACE_BUFFER (CRPI_BINARY_MAX_FRAME + 1)
+
+//! @brief Fastest status subscription (Hz), and the time (s) after which a subscriber is sent
+//!        every field it subscribed to, changed or not
+//!
+#define XMLINTERFACE_SUBSCRIBE_MAX 1000.0
+#define XMLINTERFACE_REFRESH 1.0
+
 using namespace std;
 using namespace crpi_robot;
+using namespace Xml;
 
 typedef CrpiUniversal robArmType;
 
@@ -65,162 +85,1075 @@ struct globalHandle
 };
 
 
-//! @brief Thread method for communicating with an ABB robot
+//! @brief Wire protocol spoken by a client connection, chosen from the first bytes it sends
 //!
-//! @param param Pointer to a globalHandle object containing runtime instructions
+enum clientProtocol
+{
+  ProtocolUnknown,
+  ProtocolXml,
+  ProtocolBinary
+};
+
+
+//! @brief Status pushed to a client that subscribed to it
 //!
-void armABBHandlerThread(void *param)
+struct statusSubscription
 {
-  globalHandle *gH = (globalHandle*)param;
-  CrpiRobot<CrpiAbb> arm(gH->path.c_str());
-  ulapi_integer server, client;
-  bool clientConnected = false;
+  //! @brief Subscribed CrpiStateField values (0 when not subscribed)
+  //!
+  unsigned int fields;
 
-  crpi_timer timer;
-  char buffer[2048];
+  //! @brief Seconds between checks for changes
+  //!
+  double period;
+
+  //! @brief Time (ulapi_time, s) of the next check, and of the next update with every field
+  //!
+  double next;
+  double refresh;
+
+  //! @brief Updates sent, and the values they last carried
+  //!
+  unsigned long sequence;
+  RobotStateSnapshot sent;
+};
+
+
+//! @brief State of one connected client
+//!
+struct clientConnection
+{
+  //! @brief Socket ID of the client
+  //!
+  ulapi_integer socket;
+
+  //! @brief Connection number.  Never reused, so responses for a client that has since
+  //!        disconnected can be recognized and discarded.
+  //!
+  unsigned long serial;
+
+  //! @brief Negotiated protocol
+  //!
+  clientProtocol protocol;
+
+  //! @brief Bytes received but not yet executed (partial or pipelined commands), split into
+  //!        whole commands as they complete
+  //!
+  CrpiXmlFramer in;
+
+  //! @brief Reusable buffer for the XML responses answered by the event loop
+  //!
+  CrpiXmlWriter out;
+
+  //! @brief Status subscription, if any
+  //!
+  statusSubscription sub;
+
+  clientConnection () :
+    in(XMLINTERFACE_BUFFER)
+  {
+  }
+};
+
+
+//! @brief A command waiting for, or completed by, the robot's command thread
+//!
+struct queuedCommand
+{
+  //! @brief Connection that issued the command
+  //!
+  unsigned long serial;
+
+  //! @brief Protocol of the issuing connection
+  //!
+  clientProtocol protocol;
+
+  //! @brief The command as received, replaced by the encoded response once executed
+  //!
+  string data;
+
+  //! @brief Time (ulapi_time, s) at which the command was queued
+  //!
+  double queued;
+
+  //! @brief Whether completing this command changes the coupled tool reported in status
+  //!        responses, and the decoded values needed to follow that change
+  //!
+  bool tool;
+  CanonCommand cmd;
   string str;
-  ulapi_integer rec, sent;
+  double real;
+};
 
-  //! Create socket connection
-  server = ulapi_socket_get_server_id(gH->port);
-  ulapi_socket_set_blocking(server);
 
-  while (gH->runThread)
+//! @brief Commands executed one at a time, in arrival order, by a robot's command thread
+//!
+struct commandQueue
+{
+  //! @brief The robot executing the commands
+  //!
+  AnyCrpiRobot arm;
+
+  //! @brief Guards pending, done, and run
+  //!
+  ulapi_mutex_struct *handle;
+
+  //! @brief Signalled when a command is added to pending or run is cleared
+  //!
+  void *wake;
+
+  //! @brief Commands waiting to be executed
+  //!
+  deque<queuedCommand> pending;
+
+  //! @brief Executed commands whose responses have not yet been sent
+  //!
+  deque<queuedCommand> done;
+
+  //! @brief Poller of the event loop, woken when a command is added to done
+  //!
+  void *poller;
+
+  //! @brief Whether or not to continue running the command thread
+  //!
+  bool run;
+
+  //! @brief Runtime metrics:  commands waiting, and the time commands spend waiting and
+  //!        executing
+  //!
+  CrpiGauge *depthMetric;
+  CrpiHistogram *waitMetric;
+  CrpiHistogram *execMetric;
+};
+
+
+//! @brief Thread method that executes queued commands on the robot.  Blocking motions run
+//!        here so that they never stall the event loop serving the robot's clients.
+//!
+//! @param param Pointer to a commandQueue object
+//!
+static void commandThread (void *param)
+{
+  commandQueue *q = (commandQueue*)param;
+  char response[XMLINTERFACE_BUFFER];
+  CrpiXmlWriter out(XMLINTERFACE_BUFFER);
+  queuedCommand cmd;
+  size_t len;
+  double start;
+
+  while (true)
   {
-    if (!clientConnected)
+    ulapi_mutex_take(q->handle);
+    while (q->run && q->pending.empty())
+    {
+      ulapi_cond_wait(q->wake, q->handle);
+    }
+    if (!q->run)
     {
-      cout << "Running XML Interface on port " << gH->port << " for the ABB arm" << endl;
-      client = ulapi_socket_get_connection_id(server);
-      ulapi_socket_set_blocking(client);
-      clientConnected = true;
-      cout << "Remote ABB client connected..." << endl;
+      ulapi_mutex_give(q->handle);
+      break;
     }
+    cmd = q->pending.front();
+    q->pending.pop_front();
+    q->depthMetric->Set((double)q->pending.size());
+    ulapi_mutex_give(q->handle);
 
-    while (clientConnected && gH->runThread)
+    start = ulapi_time();
+    q->waitMetric->Observe(start - cmd.queued);
+    if (cmd.protocol == ProtocolBinary)
     {
-      rec = ulapi_socket_read(client, buffer, 2048);
-      if (rec > 0)
+      q->arm.CrpiBinaryHandler(cmd.data.data(), cmd.data.size());
+      if (q->arm.CrpiBinaryResponse(response, XMLINTERFACE_BUFFER, len) != CANON_SUCCESS)
       {
-        str = buffer;
-        arm.CrpiXmlHandler(str);
-        arm.CrpiXmlResponse(buffer);
-        sent = ulapi_socket_write(client, buffer, strlen(buffer));
+        len = 0;
+      }
+      cmd.data.assign(response, len);
+    }
+    else
+    {
+      q->arm.CrpiXmlHandler(cmd.data);
+      if (q->arm.CrpiXmlResponse(out) == CANON_SUCCESS)
+      {
+        cmd.data.assign(out.data(), out.size());
       }
       else
       {
-        timer.waitUntil(5);
+        cmd.data.clear();
       }
-    } // while (clientConnected && gH->runThread)
-  } // while (gH->runThread)
+    }
+    q->execMetric->ObserveSince(start);
 
-  gH = NULL;
-  return;
+    ulapi_mutex_take(q->handle);
+    q->done.push_back(cmd);
+    ulapi_mutex_give(q->handle);
+    ulapi_poller_wake(q->poller);
+  }
 }
 
 
-//! @brief Thread method for communicating with a UR robot
+//! @brief Answer a read-only status query from the state snapshot published by the robot's
+//!        driver.  Snapshots are read without blocking, so this is safe while the command
+//!        thread is inside a blocking motion.
 //!
-//! @param param Pointer to a globalHandle object containing runtime instructions
+//! @param arm    The robot being queried
+//! @param params Decoded query, populated with the values to report
 //!
-void armUniversalHandlerThread(void *param)
+//! @return True if the query was answered, false if it has to be queued instead (it is not a
+//!         status query, or the driver has not published the requested state)
+//!
+static bool answerQuery (AnyCrpiRobot arm, CrpiXmlParams &params)
 {
-  globalHandle *gH = (globalHandle*)param;
-  cout << "Creating robot using " << gH->path.c_str() << endl;
-  CrpiRobot<CrpiUniversal> arm(gH->path.c_str());
-  cout << "Robot Created" << endl;
-  ulapi_integer server, client;
-  bool clientConnected = false;
+  RobotStateSnapshot state;
+  unsigned int need;
 
-  crpi_timer timer;
-  char buffer[2048];
-  string str;
-  ulapi_integer rec, sent;
+  switch (params.cmd)
+  {
+  case CmdGetRobotAxes:
+    need = STATE_AXES;
+    break;
+  case CmdGetRobotForces:
+    need = STATE_FORCES;
+    break;
+  case CmdGetRobotIO:
+    need = STATE_IO;
+    break;
+  case CmdGetRobotPose:
+    need = STATE_POSE;
+    break;
+  case CmdGetRobotTorques:
+    need = STATE_TORQUES;
+    break;
+  default:
+    return false;
+  }
 
-  //! Create socket connection
-  server = ulapi_socket_get_server_id(gH->port);
-  ulapi_socket_set_blocking(server);
+  if (arm.GetRobotState(&state) != CANON_SUCCESS || (state.valid & need) == 0)
+  {
+    return false;
+  }
 
-  while (gH->runThread)
+  //! Every status response carries the pose and joints along with the requested values
+  if (state.valid & STATE_POSE)
+  {
+    *params.pose = state.pose;
+  }
+  if (state.valid & STATE_AXES)
+  {
+    state.getAxes(*params.axes);
+  }
+  if (state.valid & STATE_FORCES)
+  {
+    *params.forces = state.forces;
+  }
+  if (state.valid & STATE_IO)
+  {
+    state.getIO(*params.io);
+  }
+  if (state.valid & STATE_TORQUES)
   {
-    if (!clientConnected)
+    params.torques->axes = state.axes;
+    for (int i = 0; i < state.axes; ++i)
     {
-      cout << "Running XML Interface on port " << gH->port << " for the Universal arm" << endl;
-      client = ulapi_socket_get_connection_id(server);
-      ulapi_socket_set_blocking(client);
-      clientConnected = true;
-      cout << "Remote Universal client connected..." << endl;
+      params.torques->axis[i] = state.torque[i];
     }
+  }
+  params.status = CANON_SUCCESS;
+  params.counter += 1;
+  return true;
+}
+
+
+//! @brief Status fields that can be subscribed to, by name
+//!
+static const struct
+{
+  const char *name;
+  unsigned int field;
+} subscribeFields[] =
+{
+  { "Pose",    STATE_POSE },
+  { "Joints",  STATE_AXES },
+  { "Forces",  STATE_FORCES },
+  { "Speeds",  STATE_SPEEDS },
+  { "IO",      STATE_IO },
+  { "Torques", STATE_TORQUES },
+  { "All",     STATE_POSE | STATE_AXES | STATE_FORCES | STATE_SPEEDS | STATE_IO | STATE_TORQUES }
+};
+
+
+//! @brief Whether a complete XML command is a status subscription.  Subscriptions belong to
+//!        the server rather than the robot, so they never reach the CRPI parser's command table.
+//!
+//! @param buf Start of the command
+//! @param len Length of the command in bytes
+//!
+static bool isSubscribe (const char *buf, size_t len)
+{
+  static const char type[] = "type=\"Subscribe\"";
+  const char *gt = (const char*)memchr(buf, '>', len);
+
+  return gt != NULL && search(buf, gt, type, type + sizeof(type) - 1) != gt;
+}
+
+
+//! @brief Decode the fields named in a subscription, separated by spaces or commas
+//!
+//! @param names The names (e.g., "Pose Joints")
+//!
+//! @return The CrpiStateField values named, or 0 if a name is not recognized
+//!
+static unsigned int subscribeMask (const string &names)
+{
+  unsigned int fields = 0;
+  size_t start = 0, end, i;
 
-    while (clientConnected && gH->runThread)
+  while (start < names.size())
+  {
+    end = names.find_first_of(" ,", start);
+    end = (end == string::npos) ? names.size() : end;
+    if (end > start)
     {
-      rec = ulapi_socket_read(client, buffer, 2048);
-      if (rec > 0)
+      for (i = 0; i < sizeof(subscribeFields) / sizeof(subscribeFields[0]); ++i)
       {
-        str = buffer;
-        arm.CrpiXmlHandler(str);
-
-        arm.CrpiXmlResponse(buffer);
-        sent = ulapi_socket_write(client, buffer, strlen(buffer));
+        if (names.compare(start, end - start, subscribeFields[i].name) == 0)
+        {
+          fields |= subscribeFields[i].field;
+          break;
+        }
       }
-      else
+      if (i == sizeof(subscribeFields) / sizeof(subscribeFields[0]))
       {
-        timer.waitUntil(5);
+        return 0;
       }
-    } // while (clientConnected && gH->runThread)
-  } // while (gH->runThread)
+    }
+    start = end + 1;
+  }
+  return fields;
+}
 
-  gH = NULL;
-  return;
+
+//! @brief Append a Cartesian value in the tags used by CRPIStatus
+//!
+static void appendPose (CrpiXmlWriter &out, const char *tag, const robotPose &pose)
+{
+  out.append("<");
+  out.append(tag, strlen(tag));
+  out.append("><X>");
+  out.appendReal(pose.x, false);
+  out.append("</X><Y>");
+  out.appendReal(pose.y, false);
+  out.append("</Y><Z>");
+  out.appendReal(pose.z, false);
+  out.append("</Z><XRot>");
+  out.appendReal(pose.xrot, false);
+  out.append("</XRot><YRot>");
+  out.appendReal(pose.yrot, false);
+  out.append("</YRot><ZRot>");
+  out.appendReal(pose.zrot, false);
+  out.append("</ZRot></");
+  out.append(tag, strlen(tag));
+  out.append(">");
 }
 
 
-//! @brief Thread method for communicating with a Kuka robot
+//! @brief Append per-joint values in the tags used by CRPIStatus
 //!
-//! @param param Pointer to a globalHandle object containing runtime instructions
+static void appendJoints (CrpiXmlWriter &out, const char *tag, const double *values, int count)
+{
+  out.append("<");
+  out.append(tag, strlen(tag));
+  out.append(">");
+  for (int i = 0; i < count; ++i)
+  {
+    out.append("<J");
+    out.appendInt(i);
+    out.append(">");
+    out.appendReal(values[i], false);
+    out.append("</J");
+    out.appendInt(i);
+    out.append(">");
+  }
+  out.append("</");
+  out.append(tag, strlen(tag));
+  out.append(">");
+}
+
+
+//! @brief Whether two poses differ
 //!
-void armKukaHandlerThread(void *param)
+static bool poseChanged (const robotPose &a, const robotPose &b)
 {
-  globalHandle *gH = (globalHandle*)param;
-  CrpiRobot<CrpiKukaLWR> arm(gH->path.c_str());
-  ulapi_integer server, client;
-  bool clientConnected = false;
+  return a.x != b.x || a.y != b.y || a.z != b.z || a.xrot != b.xrot || a.yrot != b.yrot || a.zrot != b.zrot;
+}
 
-  crpi_timer timer;
-  char buffer[2048];
-  string str;
-  ulapi_integer rec, sent;
 
-  //! Create socket connection
-  server = ulapi_socket_get_server_id(gH->port);
-  ulapi_socket_set_blocking(server);
+//! @brief Which subscribed fields of a state differ from those last sent
+//!
+//! @param state  The robot's latest state
+//! @param sent   The values last sent
+//! @param fields The subscribed fields
+//!
+//! @return The subscribed fields that changed
+//!
+static unsigned int changedFields (const RobotStateSnapshot &state, const RobotStateSnapshot &sent, unsigned int fields)
+{
+  unsigned int changed = 0;
 
-  while (gH->runThread)
+  if ((fields & STATE_POSE) && poseChanged(state.pose, sent.pose))
+  {
+    changed |= STATE_POSE;
+  }
+  if ((fields & STATE_FORCES) && poseChanged(state.forces, sent.forces))
+  {
+    changed |= STATE_FORCES;
+  }
+  if ((fields & STATE_SPEEDS) && poseChanged(state.speeds, sent.speeds))
+  {
+    changed |= STATE_SPEEDS;
+  }
+  if ((fields & STATE_AXES) &&
+      (state.axes != sent.axes || memcmp(state.axis, sent.axis, state.axes * sizeof(double)) != 0))
+  {
+    changed |= STATE_AXES;
+  }
+  if ((fields & STATE_TORQUES) &&
+      (state.axes != sent.axes || memcmp(state.torque, sent.torque, state.axes * sizeof(double)) != 0))
   {
-    if (!clientConnected)
+    changed |= STATE_TORQUES;
+  }
+  if ((fields & STATE_IO) &&
+      (state.ndio != sent.ndio || state.naio != sent.naio ||
+       memcmp(state.dio, sent.dio, state.ndio * sizeof(bool)) != 0 ||
+       memcmp(state.aio, sent.aio, state.naio * sizeof(double)) != 0))
+  {
+    changed |= STATE_IO;
+  }
+  return changed;
+}
+
+
+//! @brief Encode a status update carrying only some fields of a state
+//!
+//! @param out      The writer receiving the update, cleared first
+//! @param state    The robot's latest state
+//! @param fields   The fields to include
+//! @param sequence Number of the update
+//!
+//! @return True if the update fit in out
+//!
+static bool encodeUpdate (CrpiXmlWriter &out, const RobotStateSnapshot &state, unsigned int fields,
+                          unsigned long sequence)
+{
+  int i;
+
+  out.clear();
+  out.append("<CRPIUpdate><Sequence>");
+  out.appendUnsigned(sequence);
+  out.append("</Sequence><Time>");
+  out.appendReal(state.timestamp, true);
+  out.append("</Time>");
+  if (fields & STATE_POSE)
+  {
+    appendPose(out, "Pose", state.pose);
+  }
+  if (fields & STATE_AXES)
+  {
+    appendJoints(out, "Joints", state.axis, state.axes);
+  }
+  if (fields & STATE_FORCES)
+  {
+    appendPose(out, "Forces", state.forces);
+  }
+  if (fields & STATE_SPEEDS)
+  {
+    appendPose(out, "Speeds", state.speeds);
+  }
+  if (fields & STATE_TORQUES)
+  {
+    appendJoints(out, "Torques", state.torque, state.axes);
+  }
+  if (fields & STATE_IO)
+  {
+    //! Digital signals as a string of 0s and 1s, signal 0 first
+    out.append("<IO><DIO>");
+    for (i = 0; i < state.ndio; ++i)
+    {
+      out.append(state.dio[i] ? "1" : "0");
+    }
+    out.append("</DIO>");
+    appendJoints(out, "AIO", state.aio, state.naio);
+    out.append("</IO>");
+  }
+  out.append("</CRPIUpdate>");
+  return !out.overflowed();
+}
+
+
+//! @brief Serves any number of clients for one robot, of any type, from a single event
+//!        loop.  Every complete command received from a client is either answered at once
+//!        (read-only status queries) or queued for the robot's command thread, so clients can
+//!        pipeline several commands before reading responses, and status queries from one
+//!        client never wait behind another client's blocking motion.
+//!
+//!        The protocol of each connection is negotiated from its first bytes:  a frame
+//!        beginning with CRPI_BINARY_MAGIC selects the length-prefixed binary protocol,
+//!        anything else is handled as CRPI XML.  Both are executed by the same dispatcher.
+//!
+//!        XML clients may also subscribe to the robot's status instead of polling for it:
+//!
+//!          <CRPICommand type="Subscribe">
+//!            <String Value="Pose Joints"/>   (or Forces, Speeds, IO, Torques, All)
+//!            <Real Value="50"/>              (Hz; 0 ends the subscription)
+//!          </CRPICommand>
+//!
+//!        The state is checked at the given rate from the driver's snapshot, without going
+//!        through the command queue, and a <CRPIUpdate> carrying only the fields that changed
+//!        is pushed when any did.  Every XMLINTERFACE_REFRESH seconds (and first, as the
+//!        acknowledgement) all subscribed fields are sent.
+//!
+//! @note Responses to queued commands are sent in the order the commands arrived, but a
+//!       status query may be answered before the response to an earlier motion command from
+//!       the same client.  Binary clients can match responses using the header ID, and XML
+//!       clients by giving commands an ID attribute (<CRPICommand type="..." ID="17">),
+//!       which is echoed in the response (<CRPIStatus ID="17">).
+//!
+class robotServer
+{
+public:
+
+  //! @brief Constructor.  Starts the robot's command thread and opens the server socket.
+  //!
+  //! @param arm  The robot serving the clients
+  //! @param gH   Runtime instructions for this thread
+  //! @param name Robot name used in console messages
+  //!
+  robotServer (AnyCrpiRobot arm, globalHandle *gH, const char *name) :
+    arm_(arm),
+    gH_(gH),
+    name_(name),
+    xml_(&params_),
+    bin_(&params_),
+    serials_(0)
+  {
+    params_.toolName = "Nothing";
+    params_.toolVal = 0.0f;
+
+    char port[16];
+    snprintf(port, sizeof(port), "%d", gH_->port);
+    string labels = CrpiMetrics::Label("server", name_) + "," + CrpiMetrics::Label("port", port);
+    clientsMetric_ = CrpiMetrics::Gauge("crpi_xml_clients", "Connected clients", labels);
+    queriesMetric_ = CrpiMetrics::Counter("crpi_xml_commands", "Commands received",
+                                          labels + ",kind=\"query\"");
+    queuedMetric_ = CrpiMetrics::Counter("crpi_xml_commands", "Commands received",
+                                         labels + ",kind=\"queued\"");
+    malformedMetric_ = CrpiMetrics::Counter("crpi_xml_malformed", "Clients dropped for malformed commands",
+                                            labels);
+    updatesMetric_ = CrpiMetrics::Counter("crpi_xml_updates", "Status updates pushed to subscribers", labels);
+    lockWaitMetric_ = CrpiMetrics::Histogram("crpi_lock_wait_seconds", "Time spent waiting for a lock",
+                                             labels + ",lock=\"queue\"");
+    queue_.depthMetric = CrpiMetrics::Gauge("crpi_xml_queue_depth", "Commands waiting for the robot", labels);
+    queue_.waitMetric = CrpiMetrics::Histogram("crpi_xml_queue_seconds", "Time commands wait for the robot",
+                                               labels);
+    queue_.execMetric = CrpiMetrics::Histogram("crpi_xml_execute_seconds", "Time the robot takes to execute a command",
+                                               labels);
+
+    queue_.arm = arm_;
+    queue_.handle = ulapi_mutex_new(23);
+    queue_.wake = ulapi_cond_new(24);
+    queue_.run = true;
+    queue_.poller = poller_ = ulapi_poller_new();
+    task_ = ulapi_task_new();
+    ulapi_task_start((ulapi_task_struct*)task_, commandThread, &queue_, ulapi_prio_lowest(), 0);
+
+    server_ = ulapi_socket_get_server_id(gH_->port);
+    ulapi_socket_set_blocking(server_);
+    ulapi_poller_add(poller_, server_, ULAPI_POLL_READ, NULL);
+  }
+
+  //! @brief Destructor.  Waits for the command in progress to finish, then disconnects all
+  //!        clients.
+  //!
+  ~robotServer ()
+  {
+    ulapi_mutex_take(queue_.handle);
+    queue_.run = false;
+    ulapi_cond_broadcast(queue_.wake);
+    ulapi_mutex_give(queue_.handle);
+    ulapi_task_join((ulapi_task_struct*)task_, NULL);
+    ulapi_task_delete((ulapi_task_struct*)task_);
+
+    for (size_t i = 0; i < clients_.size(); ++i)
     {
-      cout << "Running XML Interface on port " << gH->port << " for the KUKA arm" << endl;
-      client = ulapi_socket_get_connection_id(server);
-      ulapi_socket_set_blocking(client);
-      clientConnected = true;
-      cout << "Remote KUKA client connected..." << endl;
+      ulapi_poller_remove(poller_, clients_[i]->socket);
+      ulapi_socket_close(clients_[i]->socket);
+      delete clients_[i];
     }
+    ulapi_poller_remove(poller_, server_);
+    ulapi_socket_close(server_);
+    ulapi_poller_delete(poller_);
+    ulapi_cond_delete(queue_.wake);
+    ulapi_mutex_delete(queue_.handle);
+  }
 
-    while (clientConnected && gH->runThread)
+  //! @brief Serve clients until the thread is told to stop
+  //!
+  void run ()
+  {
+    ulapi_poll_event events[ULAPI_SOCKET_POLL_MAX];
+    ulapi_integer n, i;
+    double timeout;
+    bool accept;
+
+    cout << "Running XML Interface on port " << gH_->port << " for the " << name_ << " arm" << endl;
+
+    while (gH_->runThread)
     {
-      rec = ulapi_socket_read(client, buffer, 2048);
-      if (rec > 0)
+      //! Sleep until a client sends something, the command thread finishes a command, or a
+      //! subscription is due.  Otherwise the timeout only bounds how long it takes to notice
+      //! runThread being cleared.
+      timeout = 0.1;
+      for (i = 0; i < (ulapi_integer)clients_.size(); ++i)
+      {
+        if (clients_[i]->sub.fields != 0 && clients_[i]->sub.next - ulapi_time() < timeout)
+        {
+          timeout = clients_[i]->sub.next - ulapi_time();
+          timeout = (timeout < 0.0) ? 0.0 : timeout;
+        }
+      }
+      n = ulapi_poller_wait(poller_, events, ULAPI_SOCKET_POLL_MAX, timeout);
+
+      accept = false;
+      for (i = 0; i < n; ++i)
       {
-        str = buffer;
-        arm.CrpiXmlHandler(str);
-        arm.CrpiXmlResponse(buffer);
-        sent = ulapi_socket_write(client, buffer, strlen(buffer));
+        clientConnection *c = (clientConnection*)events[i].data;
+        if (c == NULL)
+        {
+          accept = true;
+        }
+        else if (!receive(c))
+        {
+          cout << "Remote " << name_ << " client disconnected..." << endl;
+          dropClient(c);
+        }
+      }
+      if (accept)
+      {
+        acceptClient();
+      }
+
+      sendResponses();
+      sendUpdates();
+    } // while (gH_->runThread)
+  }
+
+private:
+
+  //! @brief Accept a pending connection on the server socket
+  //!
+  void acceptClient ()
+  {
+    ulapi_integer client = ulapi_socket_get_connection_id(server_);
+    if (client < 0)
+    {
+      return;
+    }
+    if (clients_.size() >= ULAPI_SOCKET_POLL_MAX - 1)
+    {
+      cout << "Too many " << name_ << " clients, refusing connection" << endl;
+      ulapi_socket_close(client);
+      return;
+    }
+
+    ulapi_socket_set_blocking(client);
+    clientConnection *c = new clientConnection;
+    c->socket = client;
+    c->serial = ++serials_;
+    c->protocol = ProtocolUnknown;
+    c->sub.fields = 0;
+    if (ulapi_poller_add(poller_, client, ULAPI_POLL_READ, c) != ULAPI_OK)
+    {
+      ulapi_socket_close(client);
+      delete c;
+      return;
+    }
+    clients_.push_back(c);
+    clientsMetric_->Set((double)clients_.size());
+    cout << "Remote " << name_ << " client connected..." << endl;
+  }
+
+  //! @brief Disconnect a client and forget it
+  //!
+  //! @param c The client to drop
+  //!
+  void dropClient (clientConnection *c)
+  {
+    clients_.erase(std::find(clients_.begin(), clients_.end(), c));
+    ulapi_poller_remove(poller_, c->socket);
+    ulapi_socket_close(c->socket);
+    delete c;
+    clientsMetric_->Set((double)clients_.size());
+  }
+
+  //! @brief Read from a client and execute every complete command received so far, keeping
+  //!        any partial command for the next read
+  //!
+  //! @param c The client with data waiting
+  //!
+  //! @return False if the client disconnected or sent a malformed command
+  //!
+  bool receive (clientConnection *c)
+  {
+    ulapi_integer rec;
+    const char *doc;
+    char *space;
+    size_t room, size;
+    long len = 0;
+    int found = 0;
+
+    //! Reads go straight into the framer, after whatever partial command it holds
+    space = c->in.space(room);
+    if (room == 0)
+    {
+      cout << "Malformed command from " << name_ << " client" << endl;
+      malformedMetric_->Inc();
+      return false;
+    }
+    rec = ulapi_socket_read(c->socket, space, (ulapi_integer)room);
+    if (rec <= 0)
+    {
+      return false;
+    }
+    c->in.commit((size_t)rec);
+
+    if (c->protocol == ProtocolUnknown)
+    {
+      if (!CrpiBinary::isBinary(c->in.data(), c->in.size()))
+      {
+        c->protocol = ProtocolXml;
+      }
+      else if (c->in.size() >= sizeof(CrpiBinaryHeader::magic))
+      {
+        c->protocol = ProtocolBinary;
       }
       else
       {
-        timer.waitUntil(5);
+        //! Not enough bytes yet to tell the protocols apart
+        return true;
       }
-    } // while (clientConnected && gH->runThread)
-  } // while (gH->runThread)
+    }
+
+    if (c->protocol == ProtocolBinary)
+    {
+      //! Binary frames carry their own length
+      while ((len = CrpiBinary::frameLength(c->in.data(), c->in.size())) > 0)
+      {
+        execute(c, c->in.data(), (size_t)len);
+        c->in.consume((size_t)len);
+      }
+      found = (len < 0 || c->in.size() >= XMLINTERFACE_BUFFER) ? -1 : 0;
+    }
+    else
+    {
+      //! Every complete command in this read, resuming the scan of any partial one
+      while ((found = c->in.next(doc, size)) > 0)
+      {
+        execute(c, doc, size);
+      }
+    }
+
+    if (found < 0)
+    {
+      cout << "Malformed command from " << name_ << " client" << endl;
+      malformedMetric_->Inc();
+      return false;
+    }
+    return true;
+  }
+
+  //! @brief Answer a status query immediately, or queue any other command for the robot
+  //!
+  //! @param c   The client that sent the command
+  //! @param buf Start of the command
+  //! @param len Length of the command in bytes
+  //!
+  void execute (clientConnection *c, const char *buf, size_t len)
+  {
+    queuedCommand cmd;
+    size_t out = 0;
+    bool decoded;
+
+    if (c->protocol == ProtocolXml && isSubscribe(buf, len))
+    {
+      subscribe(c, buf, len);
+      return;
+    }
+
+    if (c->protocol == ProtocolBinary)
+    {
+      decoded = bin_.decode(buf, len);
+    }
+    else
+    {
+      decoded = xml_.parse(string(buf, len));
+    }
+
+    if (decoded && answerQuery(arm_, params_))
+    {
+      queriesMetric_->Inc();
+      if (c->protocol == ProtocolBinary)
+      {
+        out = bin_.encode(response_, XMLINTERFACE_BUFFER);
+        if (out > 0)
+        {
+          ulapi_socket_write(c->socket, response_, (ulapi_integer)out);
+        }
+      }
+      else if (xml_.encode(c->out))
+      {
+        ulapi_socket_write(c->socket, c->out.data(), (ulapi_integer)c->out.size());
+      }
+      return;
+    }
+
+    cmd.serial = c->serial;
+    cmd.protocol = c->protocol;
+    cmd.data.assign(buf, len);
+    cmd.tool = decoded && (params_.cmd == CmdCouple || params_.cmd == CmdSetTool);
+    cmd.cmd = params_.cmd;
+    cmd.str = params_.str;
+    cmd.real = params_.real;
+    queuedMetric_->Inc();
+
+    cmd.queued = ulapi_time();
+    ulapi_mutex_take(queue_.handle);
+    lockWaitMetric_->ObserveSince(cmd.queued);
+    queue_.pending.push_back(cmd);
+    queue_.depthMetric->Set((double)queue_.pending.size());
+    ulapi_cond_signal(queue_.wake);
+    ulapi_mutex_give(queue_.handle);
+  }
+
+  //! @brief Start, change, or end a client's status subscription
+  //!
+  //! @param c   The client that sent the subscription
+  //! @param buf Start of the command
+  //! @param len Length of the command in bytes
+  //!
+  void subscribe (clientConnection *c, const char *buf, size_t len)
+  {
+    RobotStateSnapshot state;
+    unsigned int fields;
+
+    params_.str.clear();
+    params_.real = 0.0;
+    queriesMetric_->Inc();
+    if (!xml_.parse(string(buf, len)))
+    {
+      params_.status = CANON_FAILURE;
+    }
+    else if (params_.real <= 0.0)
+    {
+      c->sub.fields = 0;
+      params_.status = CANON_SUCCESS;
+    }
+    else if ((fields = subscribeMask(params_.str)) == 0 || arm_.GetRobotState(&state) != CANON_SUCCESS)
+    {
+      //! Unknown fields, or a driver that does not publish its state
+      params_.status = CANON_REJECT;
+    }
+    else
+    {
+      //! Acknowledged by the first update, which carries every field
+      c->sub.fields = fields;
+      c->sub.period = 1.0 / ((params_.real > XMLINTERFACE_SUBSCRIBE_MAX) ? XMLINTERFACE_SUBSCRIBE_MAX : params_.real);
+      c->sub.next = c->sub.refresh = ulapi_time();
+      c->sub.sequence = 0;
+      return;
+    }
+
+    params_.counter += 1;
+    if (xml_.encode(c->out))
+    {
+      ulapi_socket_write(c->socket, c->out.data(), (ulapi_integer)c->out.size());
+    }
+  }
+
+  //! @brief Push status updates to the subscribers that are due, from one read of the robot's
+  //!        state snapshot
+  //!
+  void sendUpdates ()
+  {
+    RobotStateSnapshot state;
+    unsigned int fields;
+    bool read = false;
+    double now = ulapi_time();
+
+    for (size_t i = 0; i < clients_.size(); ++i)
+    {
+      statusSubscription &sub = clients_[i]->sub;
+      if (sub.fields == 0 || now < sub.next)
+      {
+        continue;
+      }
+      if (!read)
+      {
+        if (arm_.GetRobotState(&state) != CANON_SUCCESS)
+        {
+          return;
+        }
+        read = true;
+      }
+
+      //! Keep the checks on the subscriber's period; one that fell behind restarts from now
+      sub.next += sub.period;
+      sub.next = (sub.next < now) ? now + sub.period : sub.next;
+
+      if (now >= sub.refresh)
+      {
+        fields = sub.fields & state.valid;
+        sub.refresh = now + XMLINTERFACE_REFRESH;
+      }
+      else
+      {
+        fields = changedFields(state, sub.sent, sub.fields & state.valid);
+      }
+      if (fields == 0)
+      {
+        continue;
+      }
+
+      if (encodeUpdate(clients_[i]->out, state, fields, ++sub.sequence))
+      {
+        ulapi_socket_write(clients_[i]->socket, clients_[i]->out.data(), (ulapi_integer)clients_[i]->out.size());
+        updatesMetric_->Inc();
+      }
+      sub.sent = state;
+    }
+  }
+
+  //! @brief Send the responses of commands completed by the command thread
+  //!
+  void sendResponses ()
+  {
+    size_t i, j;
+
+    ulapi_mutex_take(queue_.handle);
+    done_.swap(queue_.done);
+    ulapi_mutex_give(queue_.handle);
+
+    for (i = 0; i < done_.size(); ++i)
+    {
+      const queuedCommand &cmd = done_[i];
+      if (cmd.tool)
+      {
+        //! Keep the tool reported by fast-path status responses in step with the robot
+        if (cmd.cmd == CmdCouple)
+        {
+          params_.toolName = cmd.str;
+        }
+        else
+        {
+          params_.toolVal = cmd.real;
+        }
+      }
+
+      for (j = 0; j < clients_.size(); ++j)
+      {
+        if (clients_[j]->serial == cmd.serial)
+        {
+          if (!cmd.data.empty())
+          {
+            ulapi_socket_write(clients_[j]->socket, cmd.data.data(), (ulapi_integer)cmd.data.size());
+          }
+          break;
+        }
+      }
+    }
+    done_.clear();
+  }
+
+  AnyCrpiRobot arm_;
+  globalHandle *gH_;
+  const char *name_;
+
+  //! @brief Parameters, parsers, and encoders used by the event loop for decoding incoming
+  //!        commands and answering status queries (separate from those of the robot, which
+  //!        belong to the command thread)
+  //!
+  CrpiXmlParams params_;
+  CrpiXml xml_;
+  CrpiBinary bin_;
+  char response_[XMLINTERFACE_BUFFER];
+
+  commandQueue queue_;
+  deque<queuedCommand> done_;
+  void *task_;
+
+  void *poller_;
+  ulapi_integer server_;
+  vector<clientConnection*> clients_;
+  unsigned long serials_;
+
+  //! @brief Runtime metrics:  connected clients, commands answered by the event loop and
+  //!        queued for the robot, clients dropped for malformed commands, status updates
+  //!        pushed, and time spent waiting for the queue lock
+  //!
+  CrpiGauge *clientsMetric_;
+  CrpiCounter *queriesMetric_;
+  CrpiCounter *queuedMetric_;
+  CrpiCounter *malformedMetric_;
+  CrpiCounter *updatesMetric_;
+  CrpiHistogram *lockWaitMetric_;
+};
+
+
+//! @brief Thread method for communicating with an ABB robot
+//!
+//! @param param Pointer to a globalHandle object containing runtime instructions
+//!
+void armABBHandlerThread(void *param)
+{
+  globalHandle *gH = (globalHandle*)param;
+  CrpiRobot<CrpiAbb> arm(gH->path.c_str());
+  robotServer server(&arm, gH, "ABB");
+
+  server.run();
+
+  gH = NULL;
+  return;
+}
+
+
+//! @brief Thread method for communicating with a UR robot
+//!
+//! @param param Pointer to a globalHandle object containing runtime instructions
+//!
+void armUniversalHandlerThread(void *param)
+{
+  globalHandle *gH = (globalHandle*)param;
+  cout << "Creating robot using " << gH->path.c_str() << endl;
+  CrpiRobot<CrpiUniversal> arm(gH->path.c_str());
+  cout << "Robot Created" << endl;
+  robotServer server(&arm, gH, "Universal");
+
+  server.run();
+
+  gH = NULL;
+  return;
+}
+
+
+//! @brief Thread method for communicating with a Kuka robot
+//!
+//! @param param Pointer to a globalHandle object containing runtime instructions
+//!
+void armKukaHandlerThread(void *param)
+{
+  globalHandle *gH = (globalHandle*)param;
+  CrpiRobot<CrpiKukaLWR> arm(gH->path.c_str());
+  robotServer server(&arm, gH, "KUKA");
+
+  server.run();
 
   gH = NULL;
   return;
@@ -235,45 +1168,44 @@ void armRobotiqHandlerThread(void *param)
 {
   globalHandle *gH = (globalHandle*)param;
   CrpiRobot<CrpiRobotiq> arm(gH->path.c_str());
-  ulapi_integer server, client;
-  bool clientConnected = false;
+  robotServer server(&arm, gH, "Robotiq");
 
-  crpi_timer timer;
-  char buffer[2048];
-  string str;
-  ulapi_integer rec, sent;
+  server.run();
 
-  //! Create socket connection
-  server = ulapi_socket_get_server_id(gH->port);
-  ulapi_socket_set_blocking(server);
+  gH = NULL;
+  return;
+}
 
-  while (gH->runThread)
-  {
-    if (!clientConnected)
-    {
-      cout << "Running XML Interface on port " << gH->port << " for the Robotiq arm" << endl;
-      client = ulapi_socket_get_connection_id(server);
-      ulapi_socket_set_blocking(client);
-      clientConnected = true;
-      cout << "Remote RObotiq client connected..." << endl;
-    }
 
-    while (clientConnected && gH->runThread)
-    {
-      rec = ulapi_socket_read(client, buffer, 2048);
-      if (rec > 0)
-      {
-        str = buffer;
-        arm.CrpiXmlHandler(str);
-        arm.CrpiXmlResponse(buffer);
-        sent = ulapi_socket_write(client, buffer, strlen(buffer));
-      }
-      else
-      {
-        timer.waitUntil(5);
-      }
-    } // while (clientConnected && gH->runThread)
-  } // while (gH->runThread)
+//! @brief Thread method for serving a simulated robot (load testing without hardware)
+//!
+//! @param param Pointer to a globalHandle object containing runtime instructions
+//!
+void armSimHandlerThread(void *param)
+{
+  globalHandle *gH = (globalHandle*)param;
+  CrpiRobot<CrpiSim> arm(gH->path.c_str());
+  robotServer server(&arm, gH, "simulated");
+
+  server.run();
+
+  gH = NULL;
+  return;
+}
+
+
+//! @brief Thread method for serving a robot replayed from a recording (the robot XML names the
+//!        recording with its <Replay> tag)
+//!
+//! @param param Pointer to a globalHandle object containing runtime instructions
+//!
+void armReplayHandlerThread(void *param)
+{
+  globalHandle *gH = (globalHandle*)param;
+  CrpiRobot<CrpiReplay> arm(gH->path.c_str());
+  robotServer server(&arm, gH, "replayed");
+
+  server.run();
 
   gH = NULL;
   return;
@@ -335,6 +1267,7 @@ void main ()
   vector<void*> armTasks;
   void *armtask;
   globalHandle handle;
+  CrpiGateway gateway;
 
 #ifdef XMLINTERFACE_DEBUGTEST
   globalHandle demoHandle;
@@ -396,6 +1329,49 @@ void main ()
       handles.push_back(handle);
       armTasks.push_back(armtask);
     }
+    else if (robot == "METRICS")
+    {
+      //! "METRICS - <port>":  serve the runtime metrics to a Prometheus scraper
+      if (!CrpiMetrics::Serve(port))
+      {
+        cout << "Could not serve metrics on port " << port << endl;
+      }
+      continue;
+    }
+    else if (robot == "GATEWAY")
+    {
+      //! "GATEWAY <robot list> <port>":  route clients to the robots of other CRPI nodes, listed
+      //! one per line as "<robot> <host> <port>"
+      if (!gateway.LoadNodes(path.c_str()) || !gateway.Start(port))
+      {
+        cout << "Could not start the gateway on port " << port << endl;
+      }
+      continue;
+    }
+    else if (robot == "SIM")
+    {
+      handle.runThread = true;
+      handle.path = path;
+      handle.port = port;
+
+      armtask = ulapi_task_new();
+      //! Start new simulated robot thread
+      ulapi_task_start((ulapi_task_struct*)armtask, armSimHandlerThread, &handle, ulapi_prio_lowest(), 0);
+      handles.push_back(handle);
+      armTasks.push_back(armtask);
+    }
+    else if (robot == "REPLAY")
+    {
+      handle.runThread = true;
+      handle.path = path;
+      handle.port = port;
+
+      armtask = ulapi_task_new();
+      //! Start new replayed robot thread
+      ulapi_task_start((ulapi_task_struct*)armtask, armReplayHandlerThread, &handle, ulapi_prio_lowest(), 0);
+      handles.push_back(handle);
+      armTasks.push_back(armtask);
+    }
     else
     {
       cout << "Error in xmlsettings.dat.  Unknown robot type: " << robot << endl;
@@ -244,6 +244,22 @@ namespace Clustering
   }
 
 
+  LIBRARY_API void Cluster::setDefinition (int members, const double *valVec, const double *attributes)
+  {
+    unsigned int i;
+
+    for (i = 0; i < dimensions_; ++i)
+    {
+      features_.at(i) = valVec[i];
+    }
+    for (i = 0; i < attributeDims_; ++i)
+    {
+      avgAttributes_.at(i) = attributes[i];
+    }
+    members_ = members;
+  }
+
+
   LIBRARY_API void Cluster::getFeatures (double *valVec)
   {
     unsigned int i;
@@ -267,31 +283,15 @@ namespace Clustering
 
   LIBRARY_API double Cluster::distance (double *valVec)
   {
-    double dist = 0.0f;
-    unsigned int i;
-
     //! Compute the Euclidean distance from valVec to the cluster center
-    for (i = 0; i < dimensions_; ++i)
-    {
-      dist += (valVec[i] - features_.at(i)) * (valVec[i] - features_.at(i));
-    }
-    dist = sqrt (dist);
-    return dist;
+    return Math::distanceL2(valVec, &features_[0], dimensions_);
   }
 
 
   LIBRARY_API double Cluster::distance(vector<double> &valVec)
   {
-    double dist = 0.0f;
-    unsigned int i;
-
     //! Compute the Euclidean distance from valVec to the cluster center
-    for (i = 0; i < dimensions_; ++i)
-    {
-      dist += (valVec.at(i) - features_.at(i)) * (valVec.at(i) - features_.at(i));
-    }
-    dist = sqrt(dist);
-    return dist;
+    return Math::distanceL2(&valVec.at(0), &features_[0], dimensions_);
   }
 
 
@@ -340,7 +340,8 @@ namespace Clustering
   /////////////////////////////////////////////////////////////////////////////
 
   LIBRARY_API Clusters::Clusters (int kclusts, int fdim, int adim):
-    minMembers_(0)
+    minMembers_(0),
+    indexValid_(false)
   {
     resize (kclusts, fdim, adim);
   }
@@ -366,6 +367,7 @@ namespace Clustering
       temp = NULL;
     }
     kClusters_ = kclust;
+    indexValid_ = false;
   }
 
 
@@ -387,6 +389,7 @@ namespace Clustering
     if (kclust < kClusters_ && kclust >= 0)
     {
       clusters_.at(kclust).addMember (valVec, attributes);
+      indexValid_ = false;
     }
   }
 
@@ -399,6 +402,7 @@ namespace Clustering
     if (kclust < kClusters_ && kclust >= 0)
     {
       clusters_.at(kclust).addMember(valVec, attributes);
+      indexValid_ = false;
     }
   }
 
@@ -411,6 +415,7 @@ namespace Clustering
     if (kclust < kClusters_ && kclust >= 0)
     {
       clusters_.at(kclust).addMember(valVec, attributes);
+      indexValid_ = false;
     }
   }
 
@@ -423,6 +428,7 @@ namespace Clustering
     if (kclust < kClusters_ && kclust >= 0)
     {
       clusters_.at(kclust).addMember(valVec, attributes);
+      indexValid_ = false;
     }
   }
 
@@ -435,6 +441,7 @@ namespace Clustering
     //! cluster
     if (kclust < kClusters_)
     {
+      indexValid_ = false;
       return clusters_.at(kclust).removeMember (valVec, attributes);
     }
     return false;
@@ -449,6 +456,7 @@ namespace Clustering
     //! cluster
     if (kclust < kClusters_)
     {
+      indexValid_ = false;
       return clusters_.at(kclust).removeMember(valVec, attributes);
     }
     return false;
@@ -463,6 +471,7 @@ namespace Clustering
     //! cluster
     if (kclust < kClusters_)
     {
+      indexValid_ = false;
       return clusters_.at(kclust).removeMember(valVec, attributes);
     }
     return false;
@@ -477,12 +486,25 @@ namespace Clustering
     //! cluster
     if (kclust < kClusters_)
     {
+      indexValid_ = false;
       return clusters_.at(kclust).removeMember(valVec, attributes);
     }
     return false;
   }
 
 
+  LIBRARY_API bool Clusters::setDefinition (int kclust, int members, const double *valVec, const double *attributes)
+  {
+    if (kclust >= 0 && kclust < kClusters_)
+    {
+      clusters_.at(kclust).setDefinition(members, valVec, attributes);
+      indexValid_ = false;
+      return true;
+    }
+    return false;
+  }
+
+
   LIBRARY_API Cluster& Clusters::at(unsigned int kclust)
   {
     return clusters_.at(kclust);
@@ -491,6 +513,11 @@ namespace Clustering
 
   LIBRARY_API int Clusters::closestCluster (double *valVec)
   {
+    if (indexValid_)
+    {
+      return index_.nearest(valVec);
+    }
+
     double minDist;
     double testDist;
 
@@ -513,6 +540,11 @@ namespace Clustering
 
   LIBRARY_API int Clusters::closestCluster(vector<double> &valVec)
   {
+    if (indexValid_)
+    {
+      return index_.nearest(&valVec.at(0));
+    }
+
     double minDist;
     double testDist;
 
@@ -533,6 +565,72 @@ namespace Clustering
   }
 
 
+  LIBRARY_API void Clusters::closestClusters (double *valVecs,
+                                              int count,
+                                              int *nearest,
+                                              int *second,
+                                              double *dist,
+                                              double *secondDist)
+  {
+    if (!indexValid_)
+    {
+      buildIndex();
+    }
+    index_.nearestBatch(valVecs, count, nearest, second, dist, secondDist);
+  }
+
+
+  LIBRARY_API void Clusters::buildIndex ()
+  {
+    vector<double> centroids, features;
+    int k;
+
+    for (k = 0; k < kClusters_; ++k)
+    {
+      clusters_.at(k).getFeatures(features);
+      centroids.insert(centroids.end(), features.begin(), features.end());
+    }
+    index_.build(centroids.empty() ? NULL : &centroids[0], kClusters_,
+                 (kClusters_ > 0) ? clusters_.at(0).getFeatureDimensions() : 0);
+    indexValid_ = (index_.size() > 0);
+  }
+
+
+  LIBRARY_API void Clusters::clearIndex ()
+  {
+    index_.clear();
+    indexValid_ = false;
+  }
+
+
+  LIBRARY_API bool Clusters::getIndexLayout (vector<int> &order, vector<unsigned char> &axes)
+  {
+    if (!indexValid_)
+    {
+      return false;
+    }
+    order = index_.order();
+    axes = index_.axes();
+    return true;
+  }
+
+
+  LIBRARY_API bool Clusters::restoreIndex (const int *order, const unsigned char *axes)
+  {
+    vector<double> centroids, features;
+    int k;
+
+    for (k = 0; k < kClusters_; ++k)
+    {
+      clusters_.at(k).getFeatures(features);
+      centroids.insert(centroids.end(), features.begin(), features.end());
+    }
+    indexValid_ = index_.restore(centroids.empty() ? NULL : &centroids[0], order, axes, kClusters_,
+                                 (kClusters_ > 0) ? clusters_.at(0).getFeatureDimensions() : 0);
+    return indexValid_;
+  }
+
+
   LIBRARY_API int Clusters::getNumClusters ()
   {
     return kClusters_;
@@ -18,6 +18,8 @@
 
 #include <vector>
 #include "../../portable.h"
+#include "../../Libraries/Math/Distance.h"
+#include "../../Libraries/Math/KDTree.h"
 
 using namespace std;
 
@@ -69,6 +71,14 @@ namespace Clustering
     bool removeMember (double *valVec, vector<double> &attributes);
     bool removeMember (vector<double> &valVec, vector<double> &attributes);
 
+    //! @brief Replace the cluster definition outright (e.g., after a batch centroid update)
+    //!
+    //! @param members    The number of member patterns the definition is averaged over
+    //! @param valVec     The new cluster centroid
+    //! @param attributes The new average attributes
+    //!
+    void setDefinition (int members, const double *valVec, const double *attributes);
+
     //! @brief Populate a vector with a copy of the cluster centroid
     //!
     //! @param valVec Pointer to the vector to be filled by this function call
@@ -185,9 +195,50 @@ namespace Clustering
     //!
     //! @return The index of the cluster closest to valVec
     //!
+    //! @note Uses the centroid index when one has been built (see buildIndex), and a linear
+    //!       scan otherwise
+    //!
     int closestCluster (double *valVec);
     int closestCluster (vector<double> &valVec);
 
+    //! @brief Find the nearest and second nearest clusters to a batch of query feature vectors,
+    //!        e.g., to blend between the two local models around each query.  Builds the
+    //!        centroid index first if it is out of date.
+    //!
+    //! @param valVecs    count query feature vectors, one after another
+    //! @param count      The number of queries
+    //! @param nearest    Filled with the index of the closest cluster to each query
+    //! @param second     If not NULL, filled with the second closest cluster (-1 if k = 1)
+    //! @param dist       If not NULL, filled with the distances to the closest clusters
+    //! @param secondDist If not NULL, filled with the distances to the second closest clusters
+    //!
+    void closestClusters (double *valVecs, int count, int *nearest, int *second = NULL,
+                          double *dist = NULL, double *secondDist = NULL);
+
+    //! @brief Build a k-d tree over the current centroids (e.g., once training has finished),
+    //!        so that closestCluster no longer scans every cluster.  Any change made through the
+    //!        Clusters interface invalidates the index; changes made to a Cluster obtained from
+    //!        at() do not, so call buildIndex (or clearIndex) after making them.
+    //!
+    void buildIndex ();
+
+    //! @brief Discard the centroid index and return to linear scans
+    //!
+    void clearIndex ();
+
+    //! @brief The layout of the centroid index (see KDTree::order and KDTree::axes), for saving
+    //!        a trained model
+    //!
+    //! @return False if there is no index
+    //!
+    bool getIndexLayout (vector<int> &order, vector<unsigned char> &axes);
+
+    //! @brief Rebuild the centroid index from a saved layout, without repeating the splits
+    //!
+    //! @return False if the layout does not fit the clusters (the index is then dropped)
+    //!
+    bool restoreIndex (const int *order, const unsigned char *axes);
+
     //! @brief Install a member into the cluster
     //!
     //! @param kclus      The cluster number in which the new values are to be
@@ -213,6 +264,17 @@ namespace Clustering
     bool removeMember (int kclust, double *valVec, vector<double> &attributes);
     bool removeMember (int kclust, vector<double> &valVec, vector<double> &attributes);
 
+    //! @brief Replace the definition of a cluster outright
+    //!
+    //! @param kclust     The cluster number being redefined
+    //! @param members    The number of member patterns the definition is averaged over
+    //! @param valVec     The new cluster centroid
+    //! @param attributes The new average attributes
+    //!
+    //! @return True if the cluster exists, false otherwise
+    //!
+    bool setDefinition (int kclust, int members, const double *valVec, const double *attributes);
+
     //! @brief Access a specific cluster at a specific index
     //!
     //! @param kclust The specified cluster index number
@@ -260,6 +322,11 @@ namespace Clustering
     //! @brief The mimimum number of member patterns required for a given cluster (default is 0)
     //!
     int minMembers_;
+
+    //! @brief Spatial index over the centroids, and whether it matches them
+    //!
+    Math::KDTree index_;
+    bool indexValid_;
   }; // Clusters
 } // Clustering
 
@@ -0,0 +1,318 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Clustering
+//  Workfile:        DBSCANCluster.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Density-based (DBSCAN) clustering of 3D points over a uniform spatial
+//  hash grid, definition source file.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DBSCANCluster.h"
+#include <cmath>
+
+namespace Clustering
+{
+  //! @brief Label of a point not yet reached
+  //!
+  static const int dbscanUnvisited = -2;
+
+  //! @brief Label of a point that belongs to no cluster
+  //!
+  static const int dbscanNoise = -1;
+
+  //! @brief Grid cells further than this from the origin (in cells) are folded onto the edge
+  //!        cell, keeping the integer cell coordinates in range
+  //!
+  static const double dbscanCellLimit = 1.0e8;
+
+  //! @brief Bucket of a point left out of the grid
+  //!
+  static const unsigned int dbscanOutside = 0xFFFFFFFFu;
+
+
+  //! @brief Hash of a grid cell
+  //!
+  static inline unsigned int dbscanHash (int x, int y, int z)
+  {
+    return ((unsigned int)x * 73856093u) ^ ((unsigned int)y * 19349663u) ^ ((unsigned int)z * 83492791u);
+  }
+
+
+  LIBRARY_API DBSCAN::DBSCAN (double radius, int minPoints) :
+    radius_(radius),
+    minPoints_(minPoints),
+    mask_(0),
+    numClusters_(0),
+    numNoise_(0)
+  {
+  }
+
+
+  LIBRARY_API DBSCAN::~DBSCAN ()
+  {
+  }
+
+
+  LIBRARY_API void DBSCAN::setRadius (double radius)
+  {
+    radius_ = radius;
+  }
+
+
+  LIBRARY_API void DBSCAN::setMinPoints (int minPoints)
+  {
+    minPoints_ = minPoints;
+  }
+
+
+  LIBRARY_API int DBSCAN::cluster (const double *xyz, int count)
+  {
+    int i, j, k, c, head;
+
+    numClusters_ = 0;
+    numNoise_ = 0;
+    labels_.assign(count, dbscanUnvisited);
+    clusterStart_.assign(1, 0);
+    centroids_.clear();
+    members_.clear();
+    if (count < 1 || !(radius_ > 0.0))
+    {
+      labels_.assign(count, dbscanNoise);
+      numNoise_ = count;
+      return 0;
+    }
+
+    bin(xyz, count);
+
+    //! Grow a cluster from each unreached core point, breadth first
+    for (i = 0; i < count; ++i)
+    {
+      if (labels_[i] != dbscanUnvisited)
+      {
+        continue;
+      }
+      if (hashes_[i] == dbscanOutside)
+      {
+        labels_[i] = dbscanNoise;
+        continue;
+      }
+      neighbours_.clear();
+      region(xyz, i, neighbours_);
+      if ((int)neighbours_.size() < minPoints_)
+      {
+        //! Noise unless a cluster reaches it later as a border point
+        labels_[i] = dbscanNoise;
+        continue;
+      }
+
+      c = numClusters_++;
+      labels_[i] = c;
+      queue_.assign(neighbours_.begin(), neighbours_.end());
+      for (head = 0; head < (int)queue_.size(); ++head)
+      {
+        j = queue_[head];
+        if (labels_[j] == dbscanNoise)
+        {
+          labels_[j] = c;
+        }
+        if (labels_[j] != dbscanUnvisited)
+        {
+          continue;
+        }
+        labels_[j] = c;
+        neighbours_.clear();
+        region(xyz, j, neighbours_);
+        if ((int)neighbours_.size() >= minPoints_)
+        {
+          for (k = 0; k < (int)neighbours_.size(); ++k)
+          {
+            if (labels_[neighbours_[k]] < 0)
+            {
+              queue_.push_back(neighbours_[k]);
+            }
+          }
+        }
+      }
+    }
+
+    //! Points grouped by cluster (counting sort), and the centroids
+    clusterStart_.assign(numClusters_ + 1, 0);
+    centroids_.assign(numClusters_ * 3, 0.0);
+    for (i = 0; i < count; ++i)
+    {
+      if (labels_[i] < 0)
+      {
+        ++numNoise_;
+        continue;
+      }
+      ++clusterStart_[labels_[i] + 1];
+      for (k = 0; k < 3; ++k)
+      {
+        centroids_[(labels_[i] * 3) + k] += xyz[(i * 3) + k];
+      }
+    }
+    for (c = 0; c < numClusters_; ++c)
+    {
+      for (k = 0; k < 3; ++k)
+      {
+        centroids_[(c * 3) + k] /= clusterStart_[c + 1];
+      }
+      clusterStart_[c + 1] += clusterStart_[c];
+    }
+    members_.resize(count - numNoise_);
+    queue_.assign(clusterStart_.begin(), clusterStart_.end() - 1);
+    for (i = 0; i < count; ++i)
+    {
+      if (labels_[i] >= 0)
+      {
+        members_[queue_[labels_[i]]++] = i;
+      }
+    }
+
+    return numClusters_;
+  }
+
+
+  LIBRARY_API int DBSCAN::getClusterCount () const
+  {
+    return numClusters_;
+  }
+
+
+  LIBRARY_API int DBSCAN::getNoiseCount () const
+  {
+    return numNoise_;
+  }
+
+
+  LIBRARY_API const vector<int> &DBSCAN::getLabels () const
+  {
+    return labels_;
+  }
+
+
+  LIBRARY_API int DBSCAN::getMembers (int c, const int *&members) const
+  {
+    if (c < 0 || c >= numClusters_)
+    {
+      members = NULL;
+      return 0;
+    }
+    members = &members_[clusterStart_[c]];
+    return clusterStart_[c + 1] - clusterStart_[c];
+  }
+
+
+  LIBRARY_API bool DBSCAN::getCentroid (int c, double *xyz) const
+  {
+    if (c < 0 || c >= numClusters_)
+    {
+      return false;
+    }
+    for (int k = 0; k < 3; ++k)
+    {
+      xyz[k] = centroids_[(c * 3) + k];
+    }
+    return true;
+  }
+
+
+  void DBSCAN::bin (const double *xyz, int count)
+  {
+    unsigned int buckets = 1;
+    double inverse = 1.0 / radius_, v;
+    int i, k;
+    bool finite;
+
+    //! At least two buckets per point keeps the chains short
+    while (buckets < (unsigned int)(count * 2))
+    {
+      buckets <<= 1;
+    }
+    mask_ = buckets - 1;
+
+    cells_.resize(count * 3);
+    hashes_.resize(count);
+    bucketStart_.assign(buckets + 1, 0);
+    sorted_.resize(count);
+    for (i = 0; i < count; ++i)
+    {
+      finite = true;
+      for (k = 0; k < 3; ++k)
+      {
+        v = xyz[(i * 3) + k];
+        finite = finite && (v == v) && fabs(v) < HUGE_VAL;
+        v = finite ? floor(v * inverse) : 0.0;
+        v = (v > dbscanCellLimit) ? dbscanCellLimit : ((v < -dbscanCellLimit) ? -dbscanCellLimit : v);
+        cells_[(i * 3) + k] = (int)v;
+      }
+      if (!finite)
+      {
+        //! Left out of the grid, and labeled noise by cluster
+        hashes_[i] = dbscanOutside;
+        continue;
+      }
+      hashes_[i] = dbscanHash(cells_[(i * 3)], cells_[(i * 3) + 1], cells_[(i * 3) + 2]) & mask_;
+      ++bucketStart_[hashes_[i] + 1];
+    }
+
+    //! Counting sort of the points by bucket
+    for (i = 0; i < (int)buckets; ++i)
+    {
+      bucketStart_[i + 1] += bucketStart_[i];
+    }
+    queue_.assign(bucketStart_.begin(), bucketStart_.end() - 1);
+    for (i = 0; i < count; ++i)
+    {
+      if (hashes_[i] != dbscanOutside)
+      {
+        sorted_[queue_[hashes_[i]]++] = i;
+      }
+    }
+  }
+
+
+  void DBSCAN::region (const double *xyz, int i, vector<int> &out)
+  {
+    const int *cell = &cells_[i * 3];
+    const double *p = xyz + (i * 3), *q;
+    double r2 = radius_ * radius_, dx, dy, dz;
+    unsigned int h;
+    int x, y, z, s, j;
+
+    //! Cells are radius wide, so every neighbour is in one of the 27 cells around the point's;
+    //! the cell check skips points of other cells that share a bucket
+    for (x = cell[0] - 1; x <= cell[0] + 1; ++x)
+    {
+      for (y = cell[1] - 1; y <= cell[1] + 1; ++y)
+      {
+        for (z = cell[2] - 1; z <= cell[2] + 1; ++z)
+        {
+          h = dbscanHash(x, y, z) & mask_;
+          for (s = bucketStart_[h]; s < bucketStart_[h + 1]; ++s)
+          {
+            j = sorted_[s];
+            if (cells_[(j * 3)] != x || cells_[(j * 3) + 1] != y || cells_[(j * 3) + 2] != z)
+            {
+              continue;
+            }
+            q = xyz + (j * 3);
+            dx = q[0] - p[0];
+            dy = q[1] - p[1];
+            dz = q[2] - p[2];
+            if ((dx * dx) + (dy * dy) + (dz * dz) <= r2)
+            {
+              out.push_back(j);
+            }
+          }
+        }
+      }
+    }
+  }
+} // Clustering
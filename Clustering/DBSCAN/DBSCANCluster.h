@@ -0,0 +1,167 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Clustering
+//  Workfile:        DBSCANCluster.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Density-based (DBSCAN) clustering of 3D points over a uniform spatial
+//  hash grid, declaration file.  Intended for grouping unlabeled motion
+//  capture markers into candidate objects every frame.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef DBSCANCLUSTER_H
+#define DBSCANCLUSTER_H
+
+#include <vector>
+#include "../../portable.h"
+
+using namespace std;
+
+namespace Clustering
+{
+  //! @ingroup Clustering
+  //!
+  //! @brief DBSCAN:  points with at least minPoints points (themselves included) within radius
+  //!        are core points, core points within radius of each other share a cluster, and the
+  //!        other points within radius of a core point join its cluster; the rest are noise.
+  //!        The number of clusters is not fixed in advance, so groups of markers can appear
+  //!        and disappear from frame to frame.
+  //!
+  //!        Points are binned into a hash grid of radius-sized cells, so the neighbours of a
+  //!        point are found among the 27 cells around it and a frame takes expected time linear
+  //!        in the number of points.  Every buffer is kept between calls, so once the largest
+  //!        frame has been seen, clustering allocates nothing.
+  //!
+  class LIBRARY_API DBSCAN
+  {
+  public:
+    //! @brief Constructor
+    //!
+    //! @param radius    The neighbourhood radius (in the points' units, e.g., mm)
+    //! @param minPoints The number of points within radius (itself included) that makes a
+    //!                  point a core point
+    //!
+    DBSCAN (double radius, int minPoints = 2);
+
+    //! @brief Default destructor
+    //!
+    ~DBSCAN ();
+
+    //! @brief Change the neighbourhood radius and core point count for later calls
+    //!
+    void setRadius (double radius);
+    void setMinPoints (int minPoints);
+
+    //! @brief Cluster a frame of points
+    //!
+    //! @param xyz   count points, as x, y, z one after another (non-finite points, e.g.,
+    //!              occluded markers, are labeled noise)
+    //! @param count The number of points
+    //!
+    //! @return The number of clusters found
+    //!
+    int cluster (const double *xyz, int count);
+
+    //! @brief Cluster a frame of points of any type with x, y, and z members (e.g., the
+    //!        vector<point> from GetUnlabeledMarkers)
+    //!
+    template <class P> int cluster (const vector<P> &points);
+
+    //! @brief The number of clusters found by the last call to cluster
+    //!
+    int getClusterCount () const;
+
+    //! @brief The number of points labeled noise by the last call to cluster
+    //!
+    int getNoiseCount () const;
+
+    //! @brief The cluster of every point from the last call to cluster (-1 for noise), in the
+    //!        order the points were given
+    //!
+    const vector<int> &getLabels () const;
+
+    //! @brief The points of a cluster
+    //!
+    //! @param c       The cluster being accessed
+    //! @param members Set to the indices of the cluster's points (valid until the next call
+    //!                to cluster)
+    //!
+    //! @return The number of points in the cluster (0 if it does not exist)
+    //!
+    int getMembers (int c, const int *&members) const;
+
+    //! @brief The mean position of a cluster's points
+    //!
+    //! @param c   The cluster being accessed
+    //! @param xyz Filled with the centroid
+    //!
+    //! @return True if the cluster exists, false otherwise
+    //!
+    bool getCentroid (int c, double *xyz) const;
+
+  private:
+
+    //! @brief Parameters
+    //!
+    double radius_;
+    int minPoints_;
+
+    //! @brief The points of the current frame (from the template overload of cluster)
+    //!
+    vector<double> points_;
+
+    //! @brief Grid cell of each point, hash bucket of each point, start of each bucket in
+    //!        sorted_, and the points sorted by bucket
+    //!
+    vector<int> cells_;
+    vector<unsigned int> hashes_;
+    vector<int> bucketStart_;
+    vector<int> sorted_;
+    unsigned int mask_;
+
+    //! @brief Expansion work lists
+    //!
+    vector<int> neighbours_;
+    vector<int> queue_;
+
+    //! @brief Results:  label of each point, points sorted by cluster, start of each cluster
+    //!        in members_, and the cluster centroids
+    //!
+    vector<int> labels_;
+    vector<int> members_;
+    vector<int> clusterStart_;
+    vector<double> centroids_;
+    int numClusters_;
+    int numNoise_;
+
+    //! @brief Bin the points of a frame into the grid
+    //!
+    void bin (const double *xyz, int count);
+
+    //! @brief Append the points within radius of point i (itself included) to out
+    //!
+    void region (const double *xyz, int i, vector<int> &out);
+  }; // DBSCAN
+
+
+  template <class P> int DBSCAN::cluster (const vector<P> &points)
+  {
+    int i, count = (int)points.size();
+
+    points_.resize(count * 3);
+    for (i = 0; i < count; ++i)
+    {
+      points_[(i * 3) + 0] = points[i].x;
+      points_[(i * 3) + 1] = points[i].y;
+      points_[(i * 3) + 2] = points[i].z;
+    }
+    return cluster(count > 0 ? &points_[0] : NULL, count);
+  }
+} // Clustering
+
+#endif
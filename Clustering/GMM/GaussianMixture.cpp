@@ -0,0 +1,775 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Clustering
+//  Workfile:        GaussianMixture.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Gaussian mixture model (soft clustering) trained by expectation
+//  maximization, definition source file.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GaussianMixture.h"
+#include <time.h>
+#include <thread>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#define GMM_LOG_2PI 1.8378770664093454836
+
+namespace Clustering
+{
+  //! @brief Patterns handled per work unit.  Fixed (rather than derived from the thread count)
+  //!        so that the sums are always accumulated in the same order
+  //!
+  static const int emBlock = 512;
+
+  //! @brief Responsibilities below this are left out of the sums
+  //!
+  static const double emNegligible = 1.0e-12;
+
+  //! @brief What a pass over the patterns computes
+  //!
+  typedef enum
+  {
+    EM_SEED = 0,  //! Sums with each pattern given wholly to its nearest center
+    EM_STEP,      //! Sums weighted by the responsibilities
+    EM_EVALUATE   //! The two most responsible components of each input pattern
+  } emMode;
+
+  //! @brief Shared state for the EM worker threads
+  //!
+  struct emHandler
+  {
+    emMode mode;
+    Patterns *patterns;
+    const double *valVecs;
+    int numPatterns;
+    int numComponents;
+    int featureDims;
+    int attributeDims;
+    int numBlocks;
+    int threads;
+    bool full;
+
+    //! @brief Parameters being evaluated (see GaussianMixture), and the seed centers (about
+    //!        origin, numComponents x featureDims)
+    //!
+    const double *origin;
+    const double *means;
+    const double *logNorm;
+    const double *factors;
+    const double *centers;
+
+    //! @brief Per-block sums:  for each component its total responsibility, then the weighted
+    //!        sums of the features, their squares (or products), and the attributes (width
+    //!        values in all), and last the block's log likelihood
+    //!
+    int width;
+    vector<double> *sums;
+
+    //! @brief EM_EVALUATE outputs
+    //!
+    int *first;
+    int *second;
+    double *firstResp;
+    double *secondResp;
+  };
+
+
+  //! @brief Log of each component's weighted density at y (a pattern less the origin)
+  //!
+  //! @return The log of their sum (the log likelihood of the pattern)
+  //!
+  static double emLogDensities (const emHandler *h, const double *y, double *logp, double *z)
+  {
+    int d = h->featureDims, i, j, k;
+    double q, s, top = -HUGE_VAL, sum = 0.0;
+    const double *mu, *f;
+
+    for (k = 0; k < h->numComponents; ++k)
+    {
+      if (h->logNorm[k] == -HUGE_VAL)
+      {
+        logp[k] = -HUGE_VAL;
+        continue;
+      }
+      mu = h->means + (k * d);
+      q = 0.0;
+      if (h->full)
+      {
+        //! Mahalanobis distance |L^-1 (y - mu)|^2, by forward substitution
+        f = h->factors + (k * d * d);
+        for (i = 0; i < d; ++i)
+        {
+          s = y[i] - mu[i];
+          for (j = 0; j < i; ++j)
+          {
+            s -= f[(i * d) + j] * z[j];
+          }
+          z[i] = s / f[(i * d) + i];
+          q += z[i] * z[i];
+        }
+      }
+      else
+      {
+        f = h->factors + (k * d);
+        for (i = 0; i < d; ++i)
+        {
+          s = y[i] - mu[i];
+          q += s * s * f[i];
+        }
+      }
+      logp[k] = h->logNorm[k] - (0.5 * q);
+      top = (logp[k] > top) ? logp[k] : top;
+    }
+
+    if (top == -HUGE_VAL)
+    {
+      return top;
+    }
+    for (k = 0; k < h->numComponents; ++k)
+    {
+      sum += (logp[k] == -HUGE_VAL) ? 0.0 : exp(logp[k] - top);
+    }
+    return top + log(sum);
+  }
+
+
+  //! @brief Run the handler's pass over this worker's blocks
+  //!
+  static void emPass (emHandler *h, int id)
+  {
+    int d = h->featureDims, a = h->attributeDims, K = h->numComponents, b, i, j, l, k, last, best;
+    int moments = h->full ? (d * d) : d;
+    vector<double> y(d), z(d), resp(K);
+    const double *row, *attribs;
+    double *acc, *base, lse, dist, nearest, r;
+
+    for (b = id; b < h->numBlocks; b += h->threads)
+    {
+      acc = NULL;
+      if (h->mode != EM_EVALUATE)
+      {
+        h->sums[b].assign((K * h->width) + 1, 0.0);
+        acc = &h->sums[b][0];
+      }
+
+      last = (b + 1) * emBlock;
+      last = (last < h->numPatterns) ? last : h->numPatterns;
+      for (i = b * emBlock; i < last; ++i)
+      {
+        row = (h->mode == EM_EVALUATE) ? h->valVecs + (i * d) : h->patterns->getRawFeatureRow(i);
+        for (j = 0; j < d; ++j)
+        {
+          y[j] = row[j] - h->origin[j];
+        }
+
+        if (h->mode == EM_SEED)
+        {
+          best = 0;
+          nearest = DBL_MAX;
+          for (k = 0; k < K; ++k)
+          {
+            dist = 0.0;
+            for (j = 0; j < d; ++j)
+            {
+              dist += (y[j] - h->centers[(k * d) + j]) * (y[j] - h->centers[(k * d) + j]);
+            }
+            if (dist < nearest)
+            {
+              nearest = dist;
+              best = k;
+            }
+            resp[k] = 0.0;
+          }
+          resp[best] = 1.0;
+        }
+        else
+        {
+          lse = emLogDensities(h, &y[0], &resp[0], &z[0]);
+          for (k = 0; k < K; ++k)
+          {
+            resp[k] = (resp[k] == -HUGE_VAL) ? 0.0 : exp(resp[k] - lse);
+          }
+
+          if (h->mode == EM_EVALUATE)
+          {
+            int top = -1, next = -1;
+            for (k = 0; k < K; ++k)
+            {
+              if (top < 0 || resp[k] > resp[top])
+              {
+                next = top;
+                top = k;
+              }
+              else if (next < 0 || resp[k] > resp[next])
+              {
+                next = k;
+              }
+            }
+            h->first[i] = top;
+            if (h->second != NULL)
+            {
+              h->second[i] = next;
+            }
+            if (h->firstResp != NULL)
+            {
+              h->firstResp[i] = resp[top];
+            }
+            if (h->secondResp != NULL)
+            {
+              h->secondResp[i] = (next < 0) ? 0.0 : resp[next];
+            }
+            continue;
+          }
+          acc[K * h->width] += lse;
+        }
+
+        attribs = h->patterns->getAttributeRow(i);
+        for (k = 0; k < K; ++k)
+        {
+          r = resp[k];
+          if (r < emNegligible)
+          {
+            continue;
+          }
+          base = acc + (k * h->width);
+          base[0] += r;
+          for (j = 0; j < d; ++j)
+          {
+            base[1 + j] += r * y[j];
+            if (h->full)
+            {
+              //! Lower triangle only; update mirrors it
+              for (l = 0; l <= j; ++l)
+              {
+                base[1 + d + (j * d) + l] += r * y[j] * y[l];
+              }
+            }
+            else
+            {
+              base[1 + d + j] += r * y[j] * y[j];
+            }
+          }
+          for (j = 0; j < a; ++j)
+          {
+            base[1 + d + moments + j] += r * attribs[j];
+          }
+        }
+      }
+    }
+  }
+
+
+  LIBRARY_API GaussianMixture::GaussianMixture (int fdim, int adim, int components, char *path,
+                                                gmmCovariance covariance) :
+                                                numComponents_(components),
+                                                featureDims_(fdim),
+                                                attributeDims_(adim),
+                                                covariance_(covariance),
+                                                regularization_(0.0),
+                                                appliedRegularization_(0.0),
+                                                rng_((uint64_t)time(NULL)),
+                                                logLikelihood_(-HUGE_VAL),
+                                                iterations_(0),
+                                                seeded_(false)
+  {
+    trainingPatterns_ = new Patterns(fdim, adim, path);
+  }
+
+
+  LIBRARY_API GaussianMixture::~GaussianMixture ()
+  {
+    delete trainingPatterns_;
+  }
+
+
+  LIBRARY_API void GaussianMixture::setRandomSeed (uint64_t seed)
+  {
+    rng_.seed(seed);
+  }
+
+
+  LIBRARY_API void GaussianMixture::setRegularization (double variance)
+  {
+    regularization_ = (variance > 0.0) ? variance : 0.0;
+  }
+
+
+  LIBRARY_API void GaussianMixture::addTrainingPattern (double *valVec, double *attribute)
+  {
+    trainingPatterns_->addPattern(valVec, attribute);
+  }
+
+
+  LIBRARY_API void GaussianMixture::addTrainingPattern (vector<double> &valVec, vector<double> &attribute)
+  {
+    trainingPatterns_->addPattern(&valVec[0], attribute.empty() ? NULL : &attribute[0]);
+  }
+
+
+  LIBRARY_API void GaussianMixture::clearTrainingPatterns ()
+  {
+    trainingPatterns_->clearPatterns();
+  }
+
+
+  LIBRARY_API int GaussianMixture::getPatternCount ()
+  {
+    return trainingPatterns_->getPatternCount();
+  }
+
+
+  LIBRARY_API bool GaussianMixture::seedComponents ()
+  {
+    int n = trainingPatterns_->getPatternCount(), d = featureDims_, i, j, k;
+    vector<double> nearest, centers(numComponents_ * d);
+    double total, pick, dist, variance = 0.0;
+    const double *row;
+    emHandler handler;
+
+    if (numComponents_ < 1 || n < numComponents_)
+    {
+      return false;
+    }
+
+    //! Origin at the mean of the patterns; the default regularization from their spread
+    origin_.assign(d, 0.0);
+    for (i = 0; i < n; ++i)
+    {
+      row = trainingPatterns_->getRawFeatureRow(i);
+      for (j = 0; j < d; ++j)
+      {
+        origin_[j] += row[j] / n;
+      }
+    }
+    for (i = 0; i < n; ++i)
+    {
+      row = trainingPatterns_->getRawFeatureRow(i);
+      for (j = 0; j < d; ++j)
+      {
+        variance += (row[j] - origin_[j]) * (row[j] - origin_[j]) / ((double)n * d);
+      }
+    }
+    appliedRegularization_ = (regularization_ > 0.0) ? regularization_ :
+                             ((variance > 0.0) ? 1.0e-6 * variance : 1.0e-12);
+
+    //! k-means++ centers:  each drawn with probability proportional to its squared distance
+    //! from the centers already chosen
+    nearest.assign(n, DBL_MAX);
+    for (k = 0; k < numComponents_; ++k)
+    {
+      if (k == 0)
+      {
+        i = (int)rng_.below(n);
+      }
+      else
+      {
+        total = 0.0;
+        for (i = 0; i < n; ++i)
+        {
+          total += nearest[i];
+        }
+        pick = rng_.uniform() * total;
+        for (i = 0; i < n - 1 && pick >= nearest[i]; ++i)
+        {
+          pick -= nearest[i];
+        }
+      }
+      row = trainingPatterns_->getRawFeatureRow(i);
+      for (j = 0; j < d; ++j)
+      {
+        centers[(k * d) + j] = row[j] - origin_[j];
+      }
+      for (i = 0; i < n; ++i)
+      {
+        row = trainingPatterns_->getRawFeatureRow(i);
+        dist = 0.0;
+        for (j = 0; j < d; ++j)
+        {
+          dist += (row[j] - origin_[j] - centers[(k * d) + j]) * (row[j] - origin_[j] - centers[(k * d) + j]);
+        }
+        nearest[i] = (dist < nearest[i]) ? dist : nearest[i];
+      }
+    }
+
+    //! Components from the hard assignment to the centers
+    weights_.assign(numComponents_, 0.0);
+    means_ = centers;
+    covariances_.assign(numComponents_ * ((covariance_ == GMM_FULL) ? d * d : d), 0.0);
+    attributes_.assign(numComponents_ * attributeDims_, 0.0);
+    memset(&handler, 0, sizeof(handler));
+    handler.mode = EM_SEED;
+    handler.centers = &centers[0];
+    run(&handler, 0);
+    update(&handler);
+
+    logLikelihood_ = -HUGE_VAL;
+    iterations_ = 0;
+    seeded_ = true;
+    return true;
+  }
+
+
+  LIBRARY_API double GaussianMixture::iterate (int threads)
+  {
+    emHandler handler;
+
+    if (!seeded_ && !seedComponents())
+    {
+      return -HUGE_VAL;
+    }
+    memset(&handler, 0, sizeof(handler));
+    handler.mode = EM_STEP;
+    run(&handler, threads);
+    update(&handler);
+    ++iterations_;
+    return logLikelihood_;
+  }
+
+
+  LIBRARY_API int GaussianMixture::train (int maxIterations, double tolerance, int threads)
+  {
+    double previous = -HUGE_VAL, current;
+    int it;
+
+    if (!seeded_ && !seedComponents())
+    {
+      return -1;
+    }
+    for (it = 0; it < maxIterations; ++it)
+    {
+      current = iterate(threads);
+      if (current - previous < tolerance)
+      {
+        ++it;
+        break;
+      }
+      previous = current;
+    }
+    return it;
+  }
+
+
+  LIBRARY_API double GaussianMixture::getLogLikelihood ()
+  {
+    return logLikelihood_;
+  }
+
+
+  LIBRARY_API int GaussianMixture::getIterations ()
+  {
+    return iterations_;
+  }
+
+
+  LIBRARY_API int GaussianMixture::getComponentCount ()
+  {
+    return numComponents_;
+  }
+
+
+  LIBRARY_API int GaussianMixture::responsibilities (const double *valVec, double *resp)
+  {
+    vector<double> y(featureDims_), z(featureDims_);
+    emHandler handler;
+    double lse;
+    int j, k, top = 0;
+
+    if (!seeded_)
+    {
+      return -1;
+    }
+    memset(&handler, 0, sizeof(handler));
+    handler.numComponents = numComponents_;
+    handler.featureDims = featureDims_;
+    handler.full = (covariance_ == GMM_FULL);
+    handler.means = &means_[0];
+    handler.logNorm = &logNorm_[0];
+    handler.factors = &factors_[0];
+    for (j = 0; j < featureDims_; ++j)
+    {
+      y[j] = valVec[j] - origin_[j];
+    }
+    lse = emLogDensities(&handler, &y[0], resp, &z[0]);
+    for (k = 0; k < numComponents_; ++k)
+    {
+      resp[k] = (resp[k] == -HUGE_VAL) ? 0.0 : exp(resp[k] - lse);
+      top = (resp[k] > resp[top]) ? k : top;
+    }
+    return top;
+  }
+
+
+  LIBRARY_API int GaussianMixture::evalPattern (const double *valVec, double *attribs)
+  {
+    vector<double> resp(numComponents_);
+    int j, k, top;
+
+    top = responsibilities(valVec, &resp[0]);
+    for (j = 0; j < attributeDims_; ++j)
+    {
+      attribs[j] = 0.0;
+      for (k = 0; top >= 0 && k < numComponents_; ++k)
+      {
+        attribs[j] += resp[k] * attributes_[(k * attributeDims_) + j];
+      }
+    }
+    return top;
+  }
+
+
+  LIBRARY_API void GaussianMixture::evalPatterns (const double *valVecs, int count, int *first, int *second,
+                                                  double *firstResp, double *secondResp, int threads)
+  {
+    emHandler handler;
+
+    if (!seeded_ || count < 1)
+    {
+      return;
+    }
+    memset(&handler, 0, sizeof(handler));
+    handler.mode = EM_EVALUATE;
+    handler.valVecs = valVecs;
+    handler.numPatterns = count;
+    handler.first = first;
+    handler.second = second;
+    handler.firstResp = firstResp;
+    handler.secondResp = secondResp;
+    run(&handler, threads);
+  }
+
+
+  LIBRARY_API bool GaussianMixture::getComponentInfo (int c, double &weight, double *mean, double *covariance,
+                                                      double *attributes)
+  {
+    int d = featureDims_, i, j;
+
+    if (!seeded_ || c < 0 || c >= numComponents_)
+    {
+      return false;
+    }
+    weight = weights_[c];
+    for (i = 0; i < d; ++i)
+    {
+      mean[i] = means_[(c * d) + i] + origin_[i];
+      for (j = 0; j < d; ++j)
+      {
+        if (covariance_ == GMM_FULL)
+        {
+          covariance[(i * d) + j] = covariances_[(c * d * d) + (i * d) + j];
+        }
+        else
+        {
+          covariance[(i * d) + j] = (i == j) ? covariances_[(c * d) + i] : 0.0;
+        }
+      }
+    }
+    for (i = 0; i < attributeDims_; ++i)
+    {
+      attributes[i] = attributes_[(c * attributeDims_) + i];
+    }
+    return true;
+  }
+
+
+  LIBRARY_API bool GaussianMixture::getComponentInfo (int c, double &weight, vector<double> &mean,
+                                                      vector<double> &covariance, vector<double> &attributes)
+  {
+    mean.resize(featureDims_);
+    covariance.resize(featureDims_ * featureDims_);
+    attributes.resize(attributeDims_);
+    return getComponentInfo(c, weight, &mean[0], &covariance[0], attributes.empty() ? NULL : &attributes[0]);
+  }
+
+
+  LIBRARY_API void GaussianMixture::prepare ()
+  {
+    int d = featureDims_, i, j, l, k, attempt;
+    double logDet, s, extra;
+    bool factored;
+
+    logNorm_.assign(numComponents_, -HUGE_VAL);
+    factors_.assign(numComponents_ * ((covariance_ == GMM_FULL) ? d * d : d), 0.0);
+    for (k = 0; k < numComponents_; ++k)
+    {
+      if (weights_[k] <= 0.0)
+      {
+        continue;
+      }
+
+      logDet = 0.0;
+      if (covariance_ == GMM_FULL)
+      {
+        //! Cholesky factor, with more regularization should rounding leave the covariance
+        //! indefinite
+        const double *S = &covariances_[k * d * d];
+        double *L = &factors_[k * d * d];
+        factored = false;
+        extra = 0.0;
+        for (attempt = 0; attempt < 4 && !factored; ++attempt)
+        {
+          factored = true;
+          logDet = 0.0;
+          for (j = 0; j < d && factored; ++j)
+          {
+            s = S[(j * d) + j] + extra;
+            for (l = 0; l < j; ++l)
+            {
+              s -= L[(j * d) + l] * L[(j * d) + l];
+            }
+            if (s <= 0.0)
+            {
+              factored = false;
+              break;
+            }
+            L[(j * d) + j] = sqrt(s);
+            logDet += 2.0 * log(L[(j * d) + j]);
+            for (i = j + 1; i < d; ++i)
+            {
+              s = S[(i * d) + j];
+              for (l = 0; l < j; ++l)
+              {
+                s -= L[(i * d) + l] * L[(j * d) + l];
+              }
+              L[(i * d) + j] = s / L[(j * d) + j];
+            }
+          }
+          extra = (extra == 0.0) ? appliedRegularization_ : extra * 100.0;
+        }
+        if (!factored)
+        {
+          continue;
+        }
+      }
+      else
+      {
+        for (j = 0; j < d; ++j)
+        {
+          factors_[(k * d) + j] = 1.0 / covariances_[(k * d) + j];
+          logDet += log(covariances_[(k * d) + j]);
+        }
+      }
+      logNorm_[k] = log(weights_[k]) - (0.5 * d * GMM_LOG_2PI) - (0.5 * logDet);
+    }
+  }
+
+
+  LIBRARY_API void GaussianMixture::update (emHandler *handler)
+  {
+    int d = featureDims_, a = attributeDims_, n = handler->numPatterns, b, i, j, k;
+    int moments = (covariance_ == GMM_FULL) ? d * d : d;
+    vector<double> total((numComponents_ * handler->width) + 1, 0.0);
+    double N, *base, *mu, *S;
+
+    //! Blocks combined in order, so the result does not depend on the thread count
+    for (b = 0; b < handler->numBlocks; ++b)
+    {
+      for (i = 0; i < (int)total.size(); ++i)
+      {
+        total[i] += handler->sums[b][i];
+      }
+    }
+    delete [] handler->sums;
+
+    for (k = 0; k < numComponents_; ++k)
+    {
+      base = &total[k * handler->width];
+      N = base[0];
+
+      //! A component that no pattern supports keeps its last parameters but no weight
+      if (N <= (emNegligible * n))
+      {
+        weights_[k] = 0.0;
+        continue;
+      }
+      weights_[k] = N / n;
+      mu = &means_[k * d];
+      for (j = 0; j < d; ++j)
+      {
+        mu[j] = base[1 + j] / N;
+      }
+      S = &covariances_[k * moments];
+      for (j = 0; j < d; ++j)
+      {
+        if (covariance_ == GMM_FULL)
+        {
+          for (i = 0; i <= j; ++i)
+          {
+            S[(j * d) + i] = S[(i * d) + j] = (base[1 + d + (j * d) + i] / N) - (mu[j] * mu[i]);
+          }
+          S[(j * d) + j] += appliedRegularization_;
+        }
+        else
+        {
+          S[j] = (base[1 + d + j] / N) - (mu[j] * mu[j]);
+          S[j] = ((S[j] > 0.0) ? S[j] : 0.0) + appliedRegularization_;
+        }
+      }
+      for (j = 0; j < a; ++j)
+      {
+        attributes_[(k * a) + j] = base[1 + d + moments + j] / N;
+      }
+    }
+
+    if (handler->mode == EM_STEP)
+    {
+      logLikelihood_ = total[numComponents_ * handler->width] / n;
+    }
+    prepare();
+  }
+
+
+  LIBRARY_API void GaussianMixture::run (emHandler *handler, int threads)
+  {
+    vector<thread> workers;
+    int t;
+
+    handler->patterns = trainingPatterns_;
+    if (handler->mode != EM_EVALUATE)
+    {
+      handler->numPatterns = trainingPatterns_->getPatternCount();
+    }
+    handler->numComponents = numComponents_;
+    handler->featureDims = featureDims_;
+    handler->attributeDims = attributeDims_;
+    handler->full = (covariance_ == GMM_FULL);
+    handler->width = 1 + featureDims_ + (handler->full ? featureDims_ * featureDims_ : featureDims_) +
+                     attributeDims_;
+    handler->numBlocks = (handler->numPatterns + emBlock - 1) / emBlock;
+    handler->sums = (handler->mode == EM_EVALUATE) ? NULL : new vector<double>[handler->numBlocks];
+    handler->origin = &origin_[0];
+    handler->means = &means_[0];
+    if (handler->mode != EM_SEED)
+    {
+      handler->logNorm = &logNorm_[0];
+      handler->factors = &factors_[0];
+    }
+
+    if (threads < 1)
+    {
+      threads = (int)thread::hardware_concurrency();
+    }
+    threads = (threads < 1) ? 1 : threads;
+    handler->threads = (threads < handler->numBlocks) ? threads : handler->numBlocks;
+    if (handler->threads < 2)
+    {
+      emPass(handler, 0);
+      return;
+    }
+    for (t = 0; t < handler->threads; ++t)
+    {
+      workers.push_back(thread(emPass, handler, t));
+    }
+    for (t = 0; t < handler->threads; ++t)
+    {
+      workers[t].join();
+    }
+  }
+} // Clustering
@@ -0,0 +1,239 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Clustering
+//  Workfile:        GaussianMixture.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Gaussian mixture model (soft clustering) trained by expectation
+//  maximization, declaration file.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GAUSSIANMIXTURE_H
+#define GAUSSIANMIXTURE_H
+
+#include "../Patterns/Pattern.h"
+#include "../../Libraries/Math/Random.h"
+
+namespace Clustering
+{
+  //! @brief Covariance of each mixture component
+  //!
+  typedef enum
+  {
+    GMM_DIAGONAL = 0,  //! One variance per feature:  axis-aligned components, cheapest to evaluate
+    GMM_FULL           //! Full covariance matrix:  components may be oriented and elongated
+  } gmmCovariance;
+
+  //! @brief Worker state shared by the EM threads (GaussianMixture.cpp)
+  //!
+  struct emHandler;
+
+  //! @ingroup Clustering
+  //!
+  //! @brief Gaussian mixture model over a collection of patterns.  Where kMeans gives each
+  //!        pattern to one cluster, every component here has a responsibility (posterior
+  //!        probability) for every pattern, so models built per component (e.g., local
+  //!        registrations or gesture classes) can be blended smoothly across boundaries.
+  //!
+  class LIBRARY_API GaussianMixture
+  {
+  public:
+    //! @brief Constructor
+    //!
+    //! @param fdim       The number of elements in a feature vector
+    //! @param adim       The number of elements in an attribute vector
+    //! @param components The number of mixture components
+    //! @param path       Path to the file containing feature vector values (NULL for none)
+    //! @param covariance The covariance of each component
+    //!
+    GaussianMixture (int fdim, int adim, int components, char *path,
+                     gmmCovariance covariance = GMM_FULL);
+
+    //! @brief Default destructor
+    //!
+    ~GaussianMixture ();
+
+    //! @brief Seed this instance's random number stream (seeded from the clock by default), so
+    //!        that seedComponents is repeatable
+    //!
+    //! @param seed The random number seed
+    //!
+    void setRandomSeed (uint64_t seed);
+
+    //! @brief Variance added to the diagonal of every covariance, which keeps a component from
+    //!        collapsing onto a few coincident patterns (0, the default, for 1e-6 of the mean
+    //!        variance of the features)
+    //!
+    //! @param variance The added variance (squared feature units)
+    //!
+    void setRegularization (double variance);
+
+    //! @brief Add a new pattern to the collection of patterns
+    //!
+    //! @param valVec     The pattern vector being added to the collection
+    //! @param attributes The attributes of the feature vector
+    //!
+    void addTrainingPattern (double *valVec, double *attribute);
+    void addTrainingPattern (vector<double> &valVec, vector<double> &attribute);
+
+    //! @brief Remove all training patterns
+    //!
+    void clearTrainingPatterns ();
+
+    //! @brief The number of training patterns
+    //!
+    int getPatternCount ();
+
+    //! @brief Start the components from k-means++ centers:  each pattern is given to its
+    //!        nearest center, and the components take the means, covariances and shares of
+    //!        their patterns
+    //!
+    //! @return False if there are fewer patterns than components
+    //!
+    bool seedComponents ();
+
+    //! @brief Run one EM iteration.  Responsibilities (E-step) and the weighted sums they feed
+    //!        (M-step) are computed in one pass over blocks of patterns handled by worker
+    //!        threads, and the per-block sums are combined in block order, so the result is the
+    //!        same for any number of threads.
+    //!
+    //! @param threads The number of worker threads (0 uses one per hardware thread)
+    //!
+    //! @return The mean log likelihood of the patterns under the components before the update
+    //!
+    double iterate (int threads = 0);
+
+    //! @brief Seed (if not yet seeded) and iterate until the mean log likelihood improves by
+    //!        less than tolerance
+    //!
+    //! @param maxIterations The iteration limit
+    //! @param tolerance     The convergence threshold on the mean log likelihood
+    //! @param threads       As for iterate
+    //!
+    //! @return The number of iterations run, or -1 if the components could not be seeded
+    //!
+    int train (int maxIterations = 100, double tolerance = 1.0e-6, int threads = 0);
+
+    //! @brief The mean log likelihood from the last iteration, and the number of iterations
+    //!        since the last seedComponents
+    //!
+    double getLogLikelihood ();
+    int getIterations ();
+
+    //! @brief The number of mixture components
+    //!
+    int getComponentCount ();
+
+    //! @brief Posterior probability of each component for a pattern
+    //!
+    //! @param valVec The input pattern
+    //! @param resp   Filled with one responsibility per component (summing to 1)
+    //!
+    //! @return The most responsible component
+    //!
+    int responsibilities (const double *valVec, double *resp);
+
+    //! @brief Evaluate an input pattern:  the responsibility-weighted mean of the component
+    //!        attributes
+    //!
+    //! @param valVec  The input pattern
+    //! @param attribs Filled with the blended attributes
+    //!
+    //! @return The most responsible component
+    //!
+    int evalPattern (const double *valVec, double *attribs);
+
+    //! @brief Evaluate a batch of input patterns, returning the two most responsible components
+    //!        of each
+    //!
+    //! @param valVecs    count input patterns, one after another
+    //! @param count      The number of input patterns
+    //! @param first      Filled with the most responsible component of each pattern
+    //! @param second     If not NULL, filled with the second most responsible (-1 if only one)
+    //! @param firstResp  If not NULL, filled with the responsibilities of the first components
+    //! @param secondResp If not NULL, filled with the responsibilities of the second components
+    //! @param threads    As for iterate
+    //!
+    void evalPatterns (const double *valVecs, int count, int *first, int *second = NULL,
+                       double *firstResp = NULL, double *secondResp = NULL, int threads = 0);
+
+    //! @brief Grab the parameters of a component
+    //!
+    //! @param c          The component being accessed
+    //! @param weight     The mixing weight (share of the patterns)
+    //! @param mean       The mean feature vector
+    //! @param covariance The covariance (fdim x fdim, row-major, zero off the diagonal for
+    //!                   GMM_DIAGONAL)
+    //! @param attributes The responsibility-weighted mean attribute vector
+    //!
+    //! @return True if the component exists, false otherwise
+    //!
+    bool getComponentInfo (int c, double &weight, double *mean, double *covariance, double *attributes);
+    bool getComponentInfo (int c, double &weight, vector<double> &mean, vector<double> &covariance,
+                           vector<double> &attributes);
+
+  private:
+
+    //! @brief Collection of patterns used for training
+    //!
+    Patterns *trainingPatterns_;
+
+    //! @brief Model dimensions
+    //!
+    int numComponents_;
+    int featureDims_;
+    int attributeDims_;
+    gmmCovariance covariance_;
+
+    //! @brief Requested and applied diagonal regularization
+    //!
+    double regularization_;
+    double appliedRegularization_;
+
+    //! @brief Random number stream used when seeding the components
+    //!
+    Math::Xoshiro256 rng_;
+
+    //! @brief Component parameters:  weights, means and attributes, and covariances (fdim
+    //!        values each for GMM_DIAGONAL, fdim x fdim for GMM_FULL).  Means and covariances
+    //!        are taken about origin_ (the mean of the patterns when seeded), which keeps the
+    //!        sums well conditioned far from the origin.
+    //!
+    vector<double> weights_;
+    vector<double> means_;
+    vector<double> covariances_;
+    vector<double> attributes_;
+    vector<double> origin_;
+
+    //! @brief Derived from the parameters by prepare:  log(weight / sqrt((2 pi)^d |S|)) and the
+    //!        lower Cholesky factor of each covariance (or the inverse variances)
+    //!
+    vector<double> logNorm_;
+    vector<double> factors_;
+
+    //! @brief Progress since the last seedComponents
+    //!
+    double logLikelihood_;
+    int iterations_;
+    bool seeded_;
+
+    //! @brief Factor the covariances for evaluation
+    //!
+    void prepare ();
+
+    //! @brief Replace the parameters with the ones from a pass's combined sums
+    //!
+    void update (emHandler *handler);
+
+    //! @brief Run a pass of the workers over the patterns
+    //!
+    void run (emHandler *handler, int threads);
+  }; // GaussianMixture
+} // Clustering
+
+#endif
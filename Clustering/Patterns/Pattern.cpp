@@ -14,7 +14,16 @@
 
 #include "Pattern.h"
 #include <cmath>
-#include <fstream>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <thread>
+#ifdef WIN32
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
 
 namespace Clustering
 {
@@ -242,8 +251,182 @@ namespace Clustering
   //                    PATTERN COLLECTION DEFINITIONS                       //
   /////////////////////////////////////////////////////////////////////////////
 
+  //! @brief Row alignment (bytes) of the packed pattern store
+  //!
+  static const size_t patternAlign = 32;
+
+  //! @brief Allocate an aligned block of doubles
+  //!
+  static double *allocPatternStore (size_t count)
+  {
+#ifdef WIN32
+    return (double *)_aligned_malloc(count * sizeof(double), patternAlign);
+#else
+    void *ptr = NULL;
+    return (posix_memalign(&ptr, patternAlign, count * sizeof(double)) == 0) ? (double *)ptr : NULL;
+#endif
+  }
+
+
+  //! @brief Release a block from allocPatternStore
+  //!
+  static void freePatternStore (double *ptr)
+  {
+#ifdef WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+  }
+
+
+  //! @brief Round a row length up to a whole number of aligned blocks
+  //!
+  static int patternRowStride (int dims)
+  {
+    const int block = (int)(patternAlign / sizeof(double));
+    return (dims < 1) ? block : ((dims + block - 1) / block) * block;
+  }
+
+
+  //! @brief Leading bytes of a binary pattern file
+  //!
+  static const char patternMagic[8] = {'C', 'R', 'P', 'I', 'P', 'A', 'T', '1'};
+
+  //! @brief Binary pattern file header, followed by count rows of fdims features and then
+  //!        adims attributes (native byte order doubles)
+  //!
+  struct patternFileHeader
+  {
+    char magic[8];
+    unsigned int fdims;
+    unsigned int adims;
+    unsigned long long count;
+  };
+
+  LIBRARY_API MappedFile::MappedFile (const char *fname) :
+    data(NULL),
+    size(0)
+  {
+#ifdef WIN32
+    LARGE_INTEGER length;
+    mapping_ = NULL;
+    file_ = CreateFileA(fname, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file_ == INVALID_HANDLE_VALUE || !GetFileSizeEx(file_, &length) || length.QuadPart == 0)
+    {
+      return;
+    }
+    mapping_ = CreateFileMapping(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping_ != NULL)
+    {
+      data = (const char *)MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+      size = (data == NULL) ? 0 : (size_t)length.QuadPart;
+    }
+#else
+    struct stat info;
+    void *ptr;
+    file_ = open(fname, O_RDONLY);
+    if (file_ < 0 || fstat(file_, &info) != 0 || info.st_size == 0)
+    {
+      return;
+    }
+    ptr = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file_, 0);
+    if (ptr != MAP_FAILED)
+    {
+      data = (const char *)ptr;
+      size = (size_t)info.st_size;
+    }
+#endif
+  }
+
+
+  LIBRARY_API MappedFile::~MappedFile ()
+  {
+#ifdef WIN32
+    if (data != NULL)
+    {
+      UnmapViewOfFile(data);
+    }
+    if (mapping_ != NULL)
+    {
+      CloseHandle(mapping_);
+    }
+    if (file_ != INVALID_HANDLE_VALUE)
+    {
+      CloseHandle(file_);
+    }
+#else
+    if (data != NULL)
+    {
+      munmap((void *)data, size);
+    }
+    if (file_ >= 0)
+    {
+      close(file_);
+    }
+#endif
+  }
+
+
+  //! @brief One piece of a text pattern file handed to a parser thread
+  //!
+  struct patternTextChunk
+  {
+    const char *begin;
+    const char *end;
+
+    //! @brief The values parsed from the chunk, and whether parsing stopped at a bad token
+    //!
+    vector<double> values;
+    bool stopped;
+  };
+
+
+  //! @brief Parse the whitespace-separated numbers of a chunk
+  //!
+  static void parsePatternChunk (patternTextChunk *chunk)
+  {
+    const char *ptr = chunk->begin;
+    char *next;
+    double val;
+
+    chunk->stopped = false;
+    while (ptr < chunk->end)
+    {
+      while (ptr < chunk->end && isspace((unsigned char)*ptr))
+      {
+        ++ptr;
+      }
+      if (ptr >= chunk->end)
+      {
+        break;
+      }
+      val = strtod(ptr, &next);
+      if (next == ptr)
+      {
+        //! Not a number:  like the stream reader, stop here
+        chunk->stopped = true;
+        break;
+      }
+      chunk->values.push_back(val);
+      ptr = next;
+    }
+  }
+
+
   LIBRARY_API Patterns::Patterns (int fdims, int adims, char *fname) :
-    nPatterns_(0)
+    nPatterns_(0),
+    capacity_(0),
+    featureDims_(fdims),
+    attributeDims_(adims),
+    featureStride_(patternRowStride(fdims)),
+    attributeStride_(patternRowStride(adims)),
+    store_(NULL),
+    raw_(NULL),
+    scaled_(NULL),
+    attributes_(NULL),
+    scaledValid_(true)
   {
     minFeatures_.resize(fdims);
     maxFeatures_.resize(fdims);
@@ -251,7 +434,7 @@ namespace Clustering
     if (fname != NULL)
     {
       //! Get the pattern data from disk
-      readPatternsFromDisk (fdims, 1, fname);
+      readPatternsFromDisk (fdims, adims, fname);
       //! Find the min and max feature values for each feature element
       findMinMax();
       //! Fill in the scaled feature vector using the above min and max values
@@ -262,34 +445,108 @@ namespace Clustering
 
   LIBRARY_API Patterns::~Patterns ()
   {
-    patterns_.clear();
+    freePatternStore(store_);
     minFeatures_.clear();
     maxFeatures_.clear();
   }
 
 
+  LIBRARY_API void Patterns::reserve (int count)
+  {
+    double *store;
+    size_t rowDoubles;
+
+    if (count <= capacity_)
+    {
+      return;
+    }
+
+    //! One allocation holding the raw rows, then the scaled rows, then the attribute rows
+    rowDoubles = 2 * featureStride_ + attributeStride_;
+    store = allocPatternStore(rowDoubles * count);
+    if (store == NULL)
+    {
+      return;
+    }
+    memset(store, 0, rowDoubles * count * sizeof(double));
+
+    if (nPatterns_ > 0)
+    {
+      memcpy(store, raw_, nPatterns_ * featureStride_ * sizeof(double));
+      memcpy(store + count * featureStride_, scaled_, nPatterns_ * featureStride_ * sizeof(double));
+      memcpy(store + 2 * count * featureStride_, attributes_,
+             nPatterns_ * attributeStride_ * sizeof(double));
+    }
+    freePatternStore(store_);
+
+    store_ = store;
+    capacity_ = count;
+    raw_ = store_;
+    scaled_ = store_ + capacity_ * featureStride_;
+    attributes_ = store_ + 2 * capacity_ * featureStride_;
+  }
+
+
+  LIBRARY_API bool Patterns::addPattern (const double *features, const double *attributes)
+  {
+    int i;
+    double *row;
+
+    if (nPatterns_ >= capacity_)
+    {
+      reserve((capacity_ < 16) ? 16 : 2 * capacity_);
+      if (nPatterns_ >= capacity_)
+      {
+        return false;
+      }
+    }
+
+    row = raw_ + nPatterns_ * featureStride_;
+    for (i = 0; i < featureDims_; ++i)
+    {
+      row[i] = features[i];
+
+      //! Extend the feature ranges to cover the new pattern
+      if (nPatterns_ == 0 || row[i] > maxFeatures_.at(i))
+      {
+        maxFeatures_.at(i) = row[i];
+      }
+      if (nPatterns_ == 0 || row[i] < minFeatures_.at(i))
+      {
+        minFeatures_.at(i) = row[i];
+      }
+    }
+
+    row = attributes_ + nPatterns_ * attributeStride_;
+    for (i = 0; i < attributeDims_; ++i)
+    {
+      row[i] = attributes[i];
+    }
+
+    ++nPatterns_;
+
+    //! The new pattern may have moved the ranges, so every scaled row is rebuilt on next use
+    scaledValid_ = false;
+    return true;
+  }
+
+
   LIBRARY_API void Patterns::addPattern (Pattern& pat)
   {
-    double *feat = new double[pat.getDimensions()];
-    double *attribs = new double[pat.getAttributeDimensions()];
+    vector<double> feat, attribs;
 
     pat.getRawFeatures (feat);
     pat.getAttributes (attribs);
-    Pattern newPat (pat.getDimensions(), pat.getAttributeDimensions());
-    newPat.setRawFeatures (feat);
-    newPat.setAttributes (attribs);
-
-    patterns_.push_back (newPat);
-    nPatterns_ = patterns_.size();
-    findMinMax ();
-    scaleFeatures ();
+    feat.resize(featureDims_ + 1, 0.0);
+    attribs.resize(attributeDims_ + 1, 0.0);
+    addPattern(&feat[0], &attribs[0]);
   }
 
 
   LIBRARY_API void Patterns::clearPatterns ()
   {
-    patterns_.clear();
-    nPatterns_ = patterns_.size();
+    nPatterns_ = 0;
+    scaledValid_ = true;
   }
 
 
@@ -297,14 +554,7 @@ namespace Clustering
   {
     if (pat < nPatterns_ && pat >= 0)
     {
-      vector<double> vals;
-      patterns_.at(pat).getAttributes(vals);
-      double dim = patterns_.at(pat).getAttributeDimensions();
-
-      for (int i = 0; i < dim; ++i)
-      {
-        valVec[i] = vals.at(i);
-      }
+      memcpy(valVec, getAttributeRow(pat), attributeDims_ * sizeof(double));
       return true;
     }
     return false;
@@ -315,14 +565,8 @@ namespace Clustering
   {
     if (pat < nPatterns_ && pat >= 0)
     {
-      vector<double> vals;
-      patterns_.at(pat).getAttributes(vals);
-      double dim = patterns_.at(pat).getAttributeDimensions();
-      valVec.clear();
-      for (int i = 0; i < dim; ++i)
-      {
-        valVec.push_back(vals.at(i));
-      }
+      const double *row = getAttributeRow(pat);
+      valVec.assign(row, row + attributeDims_);
       return true;
     }
     return false;
@@ -331,9 +575,9 @@ namespace Clustering
 
   LIBRARY_API void Patterns::getPatternScaledFeatures (int pat, double *valVec)
   {
-    if (pat < nPatterns_)
+    if (pat < nPatterns_ && pat >= 0)
     {
-      patterns_.at(pat).getScaledFeatures (valVec);
+      memcpy(valVec, getScaledFeatureRow(pat), featureDims_ * sizeof(double));
     }
   }
 
@@ -342,16 +586,17 @@ namespace Clustering
   {
     if (pat < nPatterns_ && pat >= 0)
     {
-      patterns_.at(pat).getScaledFeatures (valVec);
+      const double *row = getScaledFeatureRow(pat);
+      valVec.assign(row, row + featureDims_);
     }
   }
 
 
   LIBRARY_API void Patterns::getPatternRawFeatures(int pat, double *valVec)
   {
-    if (pat < nPatterns_)
+    if (pat < nPatterns_ && pat >= 0)
     {
-      patterns_.at(pat).getRawFeatures(valVec);
+      memcpy(valVec, getRawFeatureRow(pat), featureDims_ * sizeof(double));
     }
   }
 
@@ -360,58 +605,239 @@ namespace Clustering
   {
     if (pat < nPatterns_ && pat >= 0)
     {
-      patterns_.at(pat).getRawFeatures(valVec);
+      const double *row = getRawFeatureRow(pat);
+      valVec.assign(row, row + featureDims_);
     }
   }
 
 
+  LIBRARY_API const double *Patterns::getRawFeatureRow (int pat) const
+  {
+    return raw_ + pat * featureStride_;
+  }
+
+
+  LIBRARY_API const double *Patterns::getScaledFeatureRow (int pat)
+  {
+    if (!scaledValid_)
+    {
+      scaleFeatures();
+    }
+    return scaled_ + pat * featureStride_;
+  }
+
+
+  LIBRARY_API const double *Patterns::getAttributeRow (int pat) const
+  {
+    return attributes_ + pat * attributeStride_;
+  }
+
+
+  LIBRARY_API int Patterns::getFeatureStride () const
+  {
+    return featureStride_;
+  }
+
+
+  LIBRARY_API int Patterns::getAttributeStride () const
+  {
+    return attributeStride_;
+  }
+
+
   LIBRARY_API int Patterns::getPatternCount ()
   {
     return nPatterns_;
   }
 
 
-  LIBRARY_API void Patterns::readPatternsFromDisk (int fdim, int adim, char *fname)
+  LIBRARY_API bool Patterns::loadText (const char *fname, int threads)
   {
-    vector<double> feats, attribs;
-    double val;
-    int i;
-    Pattern *newpat;
+    vector<char> text;
+    vector<patternTextChunk> chunks;
+    vector<thread> workers;
+    vector<double> values;
+    FILE *file;
+    long length;
+    size_t c, numChunks, i, width, target;
+    const char *ptr, *end;
 
+    file = fopen(fname, "rb");
+    if (file == NULL)
+    {
+      return false;
+    }
+    fseek(file, 0, SEEK_END);
+    length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (length <= 0)
+    {
+      fclose(file);
+      return true;
+    }
+
+    //! Read the whole file, terminated so that strtod cannot run off the end
+    text.resize((size_t)length + 1);
+    length = (long)fread(&text[0], 1, (size_t)length, file);
+    fclose(file);
+    text[(size_t)length] = '\0';
 
-    ifstream newfile (fname);
-    if (!newfile)
+    //! Split into roughly equal chunks at whitespace so that no number straddles two chunks
+    if (threads < 1)
     {
-      //! File does not exist;
-      return;
+      threads = (int)thread::hardware_concurrency();
+    }
+    threads = (threads < 1) ? 1 : threads;
+    numChunks = (size_t)length / (1 << 20) + 1;
+    numChunks = (numChunks < (size_t)threads) ? numChunks : (size_t)threads;
+    chunks.resize(numChunks);
+    ptr = &text[0];
+    end = &text[0] + length;
+    for (c = 0; c < numChunks; ++c)
+    {
+      chunks[c].begin = ptr;
+      target = (size_t)length * (c + 1) / numChunks;
+      ptr = (c + 1 == numChunks) ? end : &text[0] + target;
+      while (ptr < end && !isspace((unsigned char)*ptr))
+      {
+        ++ptr;
+      }
+      ptr = (ptr < chunks[c].begin) ? chunks[c].begin : ptr;
+      chunks[c].end = ptr;
     }
 
-    while (newfile >> val)
+    if (numChunks == 1)
+    {
+      parsePatternChunk(&chunks[0]);
+    }
+    else
     {
-      feats.push_back(val);
+      for (c = 0; c < numChunks; ++c)
+      {
+        workers.push_back(thread(parsePatternChunk, &chunks[c]));
+      }
+      for (c = 0; c < numChunks; ++c)
+      {
+        workers[c].join();
+      }
+    }
 
-      //! Read the feature values
-      for (i = 1; i < fdim; ++i)
+    //! Group the values, in file order, into patterns (a trailing partial pattern is dropped)
+    width = featureDims_ + attributeDims_;
+    for (c = 0; c < numChunks; ++c)
+    {
+      values.insert(values.end(), chunks[c].values.begin(), chunks[c].values.end());
+      if (chunks[c].stopped)
       {
-        newfile >> val;
-        feats.push_back(val);
+        break;
       }
+    }
+    if (width == 0)
+    {
+      return true;
+    }
+    reserve(nPatterns_ + (int)(values.size() / width));
+    values.push_back(0.0);
+    for (i = 0; i + width < values.size(); i += width)
+    {
+      if (!addPattern(&values[i], &values[i + featureDims_]))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+
+  LIBRARY_API bool Patterns::loadBinary (const char *fname)
+  {
+    MappedFile mapped(fname);
+    patternFileHeader header;
+    const double *rows;
+    size_t width;
+    unsigned long long i;
+
+    if (mapped.data == NULL || mapped.size < sizeof(header))
+    {
+      return false;
+    }
+    memcpy(&header, mapped.data, sizeof(header));
+    width = featureDims_ + attributeDims_;
+    if (memcmp(header.magic, patternMagic, sizeof(patternMagic)) != 0 ||
+        header.fdims != (unsigned int)featureDims_ || header.adims != (unsigned int)attributeDims_ ||
+        mapped.size < sizeof(header) + header.count * width * sizeof(double))
+    {
+      return false;
+    }
 
-      for (i = 0; i < adim; ++i)
+    //! The header is a multiple of 8 bytes long, so the rows are aligned for doubles
+    rows = (const double *)(mapped.data + sizeof(header));
+    reserve(nPatterns_ + (int)header.count);
+    for (i = 0; i < header.count; ++i)
+    {
+      if (!addPattern(rows + i * width, rows + i * width + featureDims_))
       {
-        newfile >> val;
-        attribs.push_back(val);
+        return false;
       }
+    }
+    return true;
+  }
+
+
+  LIBRARY_API bool Patterns::saveBinary (const char *fname)
+  {
+    patternFileHeader header;
+    FILE *file;
+    int i;
+    bool ok;
+
+    file = fopen(fname, "wb");
+    if (file == NULL)
+    {
+      return false;
+    }
+    memcpy(header.magic, patternMagic, sizeof(patternMagic));
+    header.fdims = (unsigned int)featureDims_;
+    header.adims = (unsigned int)attributeDims_;
+    header.count = (unsigned long long)nPatterns_;
+
+    ok = (fwrite(&header, sizeof(header), 1, file) == 1);
+    for (i = 0; ok && i < nPatterns_; ++i)
+    {
+      ok = (fwrite(getRawFeatureRow(i), sizeof(double), featureDims_, file) == (size_t)featureDims_) &&
+           (fwrite(getAttributeRow(i), sizeof(double), attributeDims_, file) == (size_t)attributeDims_);
+    }
+    ok = (fclose(file) == 0) && ok;
+    return ok;
+  }
 
-      newpat = new Pattern(fdim, adim);
 
-      //! Set feature values and attribute into a new pattern object
-      newpat->setRawFeatures (feats);
-      newpat->setAttributes (attribs);
+  LIBRARY_API bool Patterns::isBinaryPatternFile (const char *fname)
+  {
+    char magic[sizeof(patternMagic)];
+    FILE *file = fopen(fname, "rb");
+    bool binary = false;
+
+    if (file != NULL)
+    {
+      binary = (fread(magic, 1, sizeof(magic), file) == sizeof(magic)) &&
+               (memcmp(magic, patternMagic, sizeof(magic)) == 0);
+      fclose(file);
+    }
+    return binary;
+  }
 
-      patterns_.push_back(*newpat);
-      ++nPatterns_;
-      newpat = NULL;
+
+  LIBRARY_API void Patterns::readPatternsFromDisk (int fdim, int adim, char *fname)
+  {
+    //! The store was already sized for fdim and adim by the constructor
+    if (isBinaryPatternFile(fname))
+    {
+      loadBinary(fname);
+    }
+    else
+    {
+      loadText(fname);
     }
   }
 
@@ -419,55 +845,78 @@ namespace Clustering
   LIBRARY_API void Patterns::findMinMax ()
   {
     int ifeat, ipat;
+    const double *row;
+
     if (nPatterns_ < 1)
     {
       return;
     }
 
-    //! Find minimum and maximum values for each feature element over all patterns
-    for (ifeat = 0; ifeat < patterns_.at(0).getDimensions(); ++ifeat)
+    //! Find minimum and maximum values for each feature element over all patterns,
+    //! initializing with the first pattern
+    for (ifeat = 0; ifeat < featureDims_; ++ifeat)
     {
-      //! initialize min and max with first pattern
-      maxFeatures_.at(ifeat) = patterns_.at(0).getRawFeature (ifeat);
-      minFeatures_.at(ifeat) = patterns_.at(0).getRawFeature (ifeat);
+      maxFeatures_.at(ifeat) = minFeatures_.at(ifeat) = raw_[ifeat];
+    }
 
-      for (ipat = 1; ipat < nPatterns_; ++ipat)
+    for (ipat = 1; ipat < nPatterns_; ++ipat)
+    {
+      row = raw_ + ipat * featureStride_;
+      for (ifeat = 0; ifeat < featureDims_; ++ifeat)
       {
-        if (patterns_.at(ipat).getRawFeature (ifeat) > maxFeatures_.at(ifeat))
+        if (row[ifeat] > maxFeatures_[ifeat])
         {
-          maxFeatures_.at(ifeat) = patterns_.at(ipat).getRawFeature (ifeat);
+          maxFeatures_[ifeat] = row[ifeat];
         }
-
-        if (patterns_.at(ipat).getRawFeature (ifeat) < minFeatures_.at(ifeat))
+        if (row[ifeat] < minFeatures_[ifeat])
         {
-          minFeatures_.at(ifeat) = patterns_.at(ipat).getRawFeature (ifeat);
+          minFeatures_[ifeat] = row[ifeat];
         }
-      } // for (ipat = 1; ipat < nPatterns_; ++ipat)
-    } // for (ifeat = 0; ifeat < patterns_.getDimensions(); ++ifeat)
+      }
+    } // for (ipat = 1; ipat < nPatterns_; ++ipat)
   }
 
 
   LIBRARY_API void Patterns::scaleFeatures ()
   {
-    int ipat;
+    int ipat, ifeat;
+    vector<double> offset(featureDims_ + 1), range(featureDims_ + 1);
+    const double *row;
+    double *out;
 
     //! Requires that maximum and minimum values for all elements over all
     //! patterns have been defined.  Using these values, the raw feature values
-    //! are scaled.
+    //! are scaled.  Features with (nearly) no range scale to 1.
+    for (ifeat = 0; ifeat < featureDims_; ++ifeat)
+    {
+      offset[ifeat] = minFeatures_.at(ifeat);
+      range[ifeat] = maxFeatures_.at(ifeat) - minFeatures_.at(ifeat);
+      if (fabs(range[ifeat]) < 0.00001f)
+      {
+        range[ifeat] = 0.0;
+      }
+    }
+
     for (ipat = 0; ipat < nPatterns_; ++ipat)
     {
-      patterns_.at(ipat).scaleFeatures (maxFeatures_, minFeatures_);
+      row = raw_ + ipat * featureStride_;
+      out = scaled_ + ipat * featureStride_;
+      for (ifeat = 0; ifeat < featureDims_; ++ifeat)
+      {
+        out[ifeat] = (range[ifeat] == 0.0) ? 1.0 : (row[ifeat] - offset[ifeat]) / range[ifeat];
+      }
     }
+    scaledValid_ = true;
   }
 
 
   LIBRARY_API void Patterns::getRanges (double *maxVals, double *minVals)
   {
     int i;
-    for (i = 0; i < patterns_[0].getDimensions(); ++i)
+    for (i = 0; i < featureDims_; ++i)
     {
       maxVals[i] = maxFeatures_.at(i);
       minVals[i] = minFeatures_.at(i);
     }
   }
-} // Clustering
\ No newline at end of file
+} // Clustering
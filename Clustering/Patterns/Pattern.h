@@ -152,6 +152,39 @@ namespace Clustering
 
 
 
+  //! @ingroup Clustering
+  //!
+  //! @brief Read-only memory mapping of a whole file, used to load the binary pattern and
+  //!        model files without parsing or copying them
+  //!
+  struct LIBRARY_API MappedFile
+  {
+    //! @brief The file's contents, and their length (NULL and 0 if the file could not be
+    //!        opened or is empty)
+    //!
+    const char *data;
+    size_t size;
+
+    //! @brief Map a file for as long as this object lives
+    //!
+    //! @param fname The file to map
+    //!
+    MappedFile (const char *fname);
+    ~MappedFile ();
+
+    MappedFile (const MappedFile &) = delete;
+    MappedFile &operator= (const MappedFile &) = delete;
+
+  private:
+#ifdef WIN32
+    HANDLE file_;
+    HANDLE mapping_;
+#else
+    int file_;
+#endif
+  }; // MappedFile
+
+
   //! @ingroup Clustering
   //!
   //! @brief Patterns collection class description
@@ -160,11 +193,12 @@ namespace Clustering
   {
   public:
 
-    //! @brief Constructor that loads patterns from disk assuming 1D attributes
+    //! @brief Constructor that optionally loads patterns from disk
     //!
     //! @param fdims The dimensions of the feature vector
     //! @param adims The dimensions of the attribute vector
-    //! @param fname The file name contaiing the pattern data
+    //! @param fname The file name contaiing the pattern data (fdims features followed by
+    //!              adims attributes per pattern), or NULL to start empty
     //!
     Patterns(int fdims, int adims, char *fname);
 
@@ -172,6 +206,64 @@ namespace Clustering
     //!
     ~Patterns ();
 
+    //! @brief The pattern store is a single allocation and is not copied
+    //!
+    Patterns (const Patterns &) = delete;
+    Patterns &operator= (const Patterns &) = delete;
+
+    //! @brief Make room for a number of patterns without further reallocation
+    //!
+    //! @param count The number of patterns to hold
+    //!
+    //! @note Row pointers returned by the get*Row methods are invalidated when the store grows
+    //!
+    void reserve (int count);
+
+    //! @brief Append the patterns of a text file:  whitespace-separated numbers, fdims
+    //!        features followed by adims attributes per pattern.  The file is split into
+    //!        chunks parsed in parallel, and reading stops at the first token that is not a
+    //!        number, as the stream reader this replaces did.
+    //!
+    //! @param fname   The file to read
+    //! @param threads The number of parser threads (0 uses one per hardware thread)
+    //!
+    //! @return True if the file was read, false if it could not be opened
+    //!
+    bool loadText (const char *fname, int threads = 0);
+
+    //! @brief Append the patterns of a binary pattern file (see saveBinary), which is
+    //!        memory-mapped rather than parsed
+    //!
+    //! @param fname The file to read
+    //!
+    //! @return True if the file was read, false if it could not be opened, is truncated, or
+    //!         holds patterns of different dimensions
+    //!
+    bool loadBinary (const char *fname);
+
+    //! @brief Write all patterns as a binary pattern file:  an 8-byte "CRPIPAT1" tag, the
+    //!        feature and attribute dimensions (32-bit), the pattern count (64-bit), then each
+    //!        pattern's features and attributes as native byte order doubles
+    //!
+    //! @param fname The file to write
+    //!
+    //! @return True if the file was written
+    //!
+    bool saveBinary (const char *fname);
+
+    //! @brief Whether a file starts with the binary pattern file tag
+    //!
+    static bool isBinaryPatternFile (const char *fname);
+
+    //! @brief Add an additional pattern to the list of patterns
+    //!
+    //! @param features   The feature vector (fdims values)
+    //! @param attributes The attribute vector (adims values)
+    //!
+    //! @return True if the pattern was added, false if the store could not grow
+    //!
+    bool addPattern (const double *features, const double *attributes);
+
     //! @brief Add an additional pattern to the list of patterns
     //!
     //! @param pat A new pattern to be added to the pattern collection
@@ -215,6 +307,30 @@ namespace Clustering
     void getPatternRawFeatures(int pat, double *valVec);
     void getPatternRawFeatures(int pat, vector<double> &valVec);
 
+    //! @brief Zero-copy access to the packed pattern matrices.  Patterns are stored row-major,
+    //!        one row per pattern, with each row 32-byte aligned and getFeatureStride() (or
+    //!        getAttributeStride()) doubles apart, so getRawFeatureRow(0) is the base of the
+    //!        whole raw feature matrix.
+    //!
+    //! @param pat The pattern being accessed (not range checked)
+    //!
+    //! @return Pointer to the first value of the pattern's row
+    //!
+    //! @note Scaled rows are rebuilt once, on the first request after patterns are added.
+    //!       Call getScaledFeatureRow before sharing the scaled rows between threads.
+    //!
+    const double *getRawFeatureRow (int pat) const;
+    const double *getScaledFeatureRow (int pat);
+    const double *getAttributeRow (int pat) const;
+
+    //! @brief The distance (in doubles) between consecutive feature rows
+    //!
+    int getFeatureStride () const;
+
+    //! @brief The distance (in doubles) between consecutive attribute rows
+    //!
+    int getAttributeStride () const;
+
     //! @brief Get the number of patterns defined
     //!
     int getPatternCount ();
@@ -228,14 +344,38 @@ namespace Clustering
 
   private:
 
-    //! @brief The array of patterns owned by this class
-    //!
-    vector<Pattern> patterns_;
-
     //! @brief The number of patterns associated with this object
     //!
     int nPatterns_;
 
+    //! @brief The number of patterns the store can hold before growing
+    //!
+    int capacity_;
+
+    //! @brief The number of elements in each feature and attribute vector
+    //!
+    int featureDims_;
+    int attributeDims_;
+
+    //! @brief Row strides (doubles), rounded up so each row starts on an aligned boundary
+    //!
+    int featureStride_;
+    int attributeStride_;
+
+    //! @brief The single aligned allocation holding all pattern rows
+    //!
+    double *store_;
+
+    //! @brief Raw feature, scaled feature, and attribute matrices within store_
+    //!
+    double *raw_;
+    double *scaled_;
+    double *attributes_;
+
+    //! @brief Whether the scaled rows reflect the current feature ranges
+    //!
+    bool scaledValid_;
+
     //! @brief The maximum values encountered for each feature in the
     //!        collection of feature vectors
     //!
@@ -246,7 +386,7 @@ namespace Clustering
     //!
     vector<double> minFeatures_;
 
-    //! @brief Read a pattern set from disk
+    //! @brief Read a pattern set from disk, in either the binary or the text format
     //!
     //! @param fdim  The number of elements in a feature vector
     //! @param adim  The number of elements in an attribute vector
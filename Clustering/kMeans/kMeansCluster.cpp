@@ -13,70 +13,280 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "kMeansCluster.h"
+#include "kMeansOpenCL.h"
 #include <time.h>
+#include <thread>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
 
 namespace Clustering
 {
-  LIBRARY_API kMeans::kMeans (int fdim, int adim, int kclust, char *path) :
+  //! @brief Patterns handled per work unit in recluster.  Fixed (rather than derived from the
+  //!        thread count) so that the centroid sums are always accumulated in the same order
+  //!
+  static const int reclusterBlock = 512;
+
+  //! @brief Shared state for the recluster worker threads
+  //!
+  struct reclusterHandler
+  {
+    Patterns *patterns;
+    int numPatterns;
+    int numClusters;
+    int featureDims;
+    int attributeDims;
+    int numBlocks;
+    int threads;
+
+    //! @brief Current centroids, numClusters x featureDims
+    //!
+    const double *centroids;
+
+    //! @brief Current pattern assignments (read by the assignment phase)
+    //!
+    const int *current;
+
+    //! @brief Pattern assignments (nearest cluster on output of the assignment phase)
+    //!
+    int *assignments;
+
+    //! @brief Hamerly bounds (NULL for a plain Lloyd search), whether they are usable yet, and
+    //!        half the distance from each centroid to its nearest neighbouring centroid
+    //!
+    double *upper;
+    double *lower;
+    bool boundsValid;
+    const double *halfGap;
+
+    //! @brief Per-block distance evaluation counts
+    //!
+    long long *evaluations;
+
+    //! @brief Per-block feature and attribute sums and member counts for each cluster
+    //!
+    vector<double> *featureSums;
+    vector<double> *attributeSums;
+    vector<int> *counts;
+  };
+
+
+  //! @brief Find the nearest centroid for each pattern in this worker's blocks
+  //!
+  static void reclusterAssign (reclusterHandler *h, int id)
+  {
+    const double *valVec;
+    double d, best, second, bound;
+    int b, i, k, cur, nearest, last;
+    long long evaluations;
+
+    for (b = id; b < h->numBlocks; b += h->threads)
+    {
+      evaluations = 0;
+      last = (b + 1) * reclusterBlock;
+      last = (last < h->numPatterns) ? last : h->numPatterns;
+      for (i = b * reclusterBlock; i < last; ++i)
+      {
+        valVec = h->patterns->getRawFeatureRow(i);
+        cur = h->current[i];
+
+        if (h->upper == NULL)
+        {
+          h->assignments[i] = Math::distanceNearest(valVec, h->centroids, h->numClusters,
+                                                    h->featureDims);
+          evaluations += h->numClusters;
+          continue;
+        }
+
+        if (h->boundsValid && cur >= 0)
+        {
+          //! Hamerly:  no other centroid can be closer while the distance to the current one
+          //! is below both the lower bound and half the gap to the nearest other centroid
+          bound = (h->halfGap[cur] > h->lower[i]) ? h->halfGap[cur] : h->lower[i];
+          if (h->upper[i] < bound)
+          {
+            h->assignments[i] = cur;
+            continue;
+          }
+          h->upper[i] = sqrt(Math::distanceL2Squared(valVec, h->centroids + cur * h->featureDims,
+                                                     h->featureDims));
+          ++evaluations;
+          if (h->upper[i] < bound)
+          {
+            h->assignments[i] = cur;
+            continue;
+          }
+        }
+
+        //! Full search, keeping the two smallest (squared) distances for the bounds
+        nearest = 0;
+        best = second = DBL_MAX;
+        for (k = 0; k < h->numClusters; ++k)
+        {
+          d = Math::distanceL2Squared(valVec, h->centroids + k * h->featureDims, h->featureDims);
+          if (d < best)
+          {
+            second = best;
+            best = d;
+            nearest = k;
+          }
+          else if (d < second)
+          {
+            second = d;
+          }
+        }
+        evaluations += h->numClusters;
+        h->assignments[i] = nearest;
+        h->upper[i] = sqrt(best);
+        h->lower[i] = (second < DBL_MAX) ? sqrt(second) : DBL_MAX;
+      }
+      h->evaluations[b] = evaluations;
+    }
+  }
+
+
+  //! @brief Sum the features and attributes of each cluster's members over this worker's blocks
+  //!
+  static void reclusterSum (reclusterHandler *h, int id)
+  {
+    const double *valVec, *attribs;
+    int b, i, j, k, last;
+
+    for (b = id; b < h->numBlocks; b += h->threads)
+    {
+      vector<double> &fsum = h->featureSums[b];
+      vector<double> &asum = h->attributeSums[b];
+      vector<int> &count = h->counts[b];
+      fsum.assign(h->numClusters * h->featureDims, 0.0);
+      asum.assign(h->numClusters * h->attributeDims, 0.0);
+      count.assign(h->numClusters, 0);
+
+      last = (b + 1) * reclusterBlock;
+      last = (last < h->numPatterns) ? last : h->numPatterns;
+      for (i = b * reclusterBlock; i < last; ++i)
+      {
+        k = h->assignments[i];
+        if (k < 0)
+        {
+          continue;
+        }
+        valVec = h->patterns->getRawFeatureRow(i);
+        attribs = h->patterns->getAttributeRow(i);
+        for (j = 0; j < h->featureDims; ++j)
+        {
+          fsum[k * h->featureDims + j] += valVec[j];
+        }
+        for (j = 0; j < h->attributeDims; ++j)
+        {
+          asum[k * h->attributeDims + j] += attribs[j];
+        }
+        ++count[k];
+      }
+    }
+  }
+
+
+  //! @brief Fill in the block layout and thread count of a handler
+  //!
+  static void reclusterSetup (reclusterHandler *h, Patterns *patterns, int numPatterns,
+                              int numClusters, int featureDims, int attributeDims, int threads)
+  {
+    memset(h, 0, sizeof(reclusterHandler));
+    h->patterns = patterns;
+    h->numPatterns = numPatterns;
+    h->numClusters = numClusters;
+    h->featureDims = featureDims;
+    h->attributeDims = attributeDims;
+    h->numBlocks = (numPatterns + reclusterBlock - 1) / reclusterBlock;
+    if (threads < 1)
+    {
+      threads = (int)thread::hardware_concurrency();
+    }
+    threads = (threads < 1) ? 1 : threads;
+    h->threads = (threads < h->numBlocks) ? threads : h->numBlocks;
+  }
+
+
+  //! @brief Run a recluster phase on the handler's worker threads
+  //!
+  static void reclusterRun (reclusterHandler *h, void (*phase)(reclusterHandler *, int))
+  {
+    vector<thread> workers;
+    int t;
+
+    if (h->threads < 2)
+    {
+      phase(h, 0);
+      return;
+    }
+    for (t = 0; t < h->threads; ++t)
+    {
+      workers.push_back(thread(phase, h, t));
+    }
+    for (t = 0; t < h->threads; ++t)
+    {
+      workers[t].join();
+    }
+  }
+
+
+  //! @brief Leading bytes of a binary model file
+  //!
+  static const char kMeansModelMagic[8] = {'C', 'R', 'P', 'I', 'K', 'M', 'N', '1'};
+
+  //! @brief Binary model file header (see kMeans::saveModel)
+  //!
+  struct kMeansModelHeader
+  {
+    char magic[8];
+    unsigned int fdims;
+    unsigned int adims;
+    unsigned int clusters;
+    unsigned int indexed;
+  };
+
+
+  LIBRARY_API kMeans::kMeans (int fdim, int adim, int kclust, char *path,
+                              kMeansSeeding seeding, kMeansAssignment assignment,
+                              kMeansBackend backend) :
                               numClusters_(kclust),
                               featureDims_(fdim),
                               attributeDims_(adim),
-                              memClusterPattern_(NULL),
-                              patternAssignments_(NULL),
-                              minClusterMembers_(0)
+                              minClusterMembers_(0),
+                              rng_((uint64_t)time(NULL)),
+                              seeding_(seeding),
+                              assignment_(assignment),
+                              boundsValid_(false),
+                              iterations_(0),
+                              distanceEvaluations_(0),
+                              streamHorizon_(0),
+                              observations_(0),
+                              device_(NULL)
   {
-    int i, j, k;
     clusters_ = new Clusters(kclust, fdim, adim);
     clusters_->setMinMembers(minClusterMembers_);
 
     trainingPatterns_ = new Patterns (fdim, adim, path);
     numPatterns_ = trainingPatterns_->getPatternCount ();
 
-    //! Allocate space for the membership association matrix
-    memClusterPattern_ = new bool *[numClusters_];
-    for (i = 0; i < numClusters_; ++i)
-    {
-      memClusterPattern_[i] = NULL;
-    }
+    //! Set every pattern to "unassigned"
+    patternAssignments_.assign(numPatterns_, -1);
 
-    if (numPatterns_ > 0)
+    if (backend == KMEANS_BACKEND_OPENCL)
     {
-      //! Create vector for pattern assignments to clusters
-      patternAssignments_ = new int[numPatterns_];
-
-      for (i = 0; i < numPatterns_; ++i)
-      {
-        //! Set to "unassigned"
-        patternAssignments_[i] = -1;
-      }
-
-      //! Allocate space for the membership association matrix
-      for (i = 0; i < numClusters_; ++i)
+      device_ = new kMeansDevice();
+      if (!device_->open(fdim, adim))
       {
-        memClusterPattern_[i] = new bool[numPatterns_];
+        dropDevice();
       }
-
-      //! Assign all patterns to un-associated
-      for (j = 0; j < numClusters_; ++j)
-      {
-        for (k = 0; k < numPatterns_; ++k)
-        {
-          memClusterPattern_[j][k] = false;
-        } // for (k = 0; k < numPatterns_; ++k)
-      } // for (j = 0; j < numClusters_; ++j)
-    } // if (numPatterns_ > 0)
+    }
   }
 
 
   LIBRARY_API kMeans::~kMeans()
   {
-    int i;
-    for (i = 0; i < numClusters_; ++i)
-    {
-      delete [] memClusterPattern_ [i];
-    }
-    delete [] memClusterPattern_;
-    delete [] patternAssignments_;
+    delete device_;
   }
 
 
@@ -87,12 +297,28 @@ namespace Clustering
   }
 
 
+  LIBRARY_API void kMeans::setRandomSeed (uint64_t seed)
+  {
+    rng_.seed(seed);
+  }
+
+
   LIBRARY_API void kMeans::seedClusters ()
   {
     int p, k = 0, km;
     vector<double> valVec;
     valVec.resize(featureDims_);
 
+    iterations_ = 0;
+    distanceEvaluations_ = 0;
+    boundsValid_ = false;
+
+    if (seeding_ == KMEANS_SEED_PLUSPLUS && numPatterns_ > 0)
+    {
+      seedPlusPlus();
+      return;
+    }
+
     vector<double> attribs;
     attribs.resize(attributeDims_);
 
@@ -100,8 +326,6 @@ namespace Clustering
     {
       patternAssignments_[p] = p;
 
-      memClusterPattern_[p][p] = true;
-
       trainingPatterns_->getPatternRawFeatures(p, valVec);
       trainingPatterns_->getPatternAttributes(p, attribs);
 
@@ -109,14 +333,11 @@ namespace Clustering
       clusters_->addMember(p, valVec, attribs);
     }
 
-    srand((unsigned)time(NULL));
     for (; p < numPatterns_; ++p)
     {
-      k = (rand() * numClusters_ / (RAND_MAX + 1));
+      k = (int)rng_.below(numClusters_);
       patternAssignments_[p] = k;
 
-      memClusterPattern_[k][p] = true;
-
       trainingPatterns_->getPatternRawFeatures(p, valVec);
       trainingPatterns_->getPatternAttributes(p, attribs);
 
@@ -145,9 +366,7 @@ namespace Clustering
         //! Install the pattern as the first member in the new cluster.
         //! Update the patternAssignments_ vector and pattern-cluster map.
         patternAssignments_[p] = k;
-        memClusterPattern_[k][p] = true;
-
-        trainingPatterns_->getPatternRawFeatures (p, valVec);
+          trainingPatterns_->getPatternRawFeatures (p, valVec);
         trainingPatterns_->getPatternAttributes (p, attribs);
 
         //! Install affiliation in Clusters array: 
@@ -163,17 +382,435 @@ namespace Clustering
 
   LIBRARY_API bool kMeans::isMember (int ipat, int kclust)
   {
-    return memClusterPattern_[kclust][ipat];
+    return (ipat >= 0 && ipat < numPatterns_ && kclust >= 0 && patternAssignments_[ipat] == kclust);
   }
 
 
   LIBRARY_API void kMeans::getRanges (double *maxVals, double *minVals)
   {
+    if (trainingPatterns_->getPatternCount() < 1 && !modelMax_.empty())
+    {
+      for (int i = 0; i < featureDims_; ++i)
+      {
+        maxVals[i] = modelMax_[i];
+        minVals[i] = modelMin_[i];
+      }
+      return;
+    }
     trainingPatterns_->getRanges (maxVals, minVals);
   }
 
 
-  LIBRARY_API int kMeans::recluster ()
+  LIBRARY_API bool kMeans::saveModel (const char *fname)
+  {
+    kMeansModelHeader header;
+    vector<unsigned long long> counts(numClusters_);
+    vector<double> centroids, attributes, ranges(featureDims_ * 2, 0.0), values;
+    vector<int> order;
+    vector<unsigned char> axes;
+    FILE *file;
+    int k;
+    bool ok;
+
+    for (k = 0; k < numClusters_; ++k)
+    {
+      counts[k] = (unsigned long long)clusters_->at(k).size();
+      clusters_->getClusterFeatures(k, values);
+      centroids.insert(centroids.end(), values.begin(), values.end());
+      clusters_->getClusterAttributes(k, values);
+      attributes.insert(attributes.end(), values.begin(), values.end());
+    }
+    if (featureDims_ > 0 && (trainingPatterns_->getPatternCount() > 0 || !modelMax_.empty()))
+    {
+      getRanges(&ranges[0], &ranges[featureDims_]);
+    }
+
+    memcpy(header.magic, kMeansModelMagic, sizeof(kMeansModelMagic));
+    header.fdims = (unsigned int)featureDims_;
+    header.adims = (unsigned int)attributeDims_;
+    header.clusters = (unsigned int)numClusters_;
+    header.indexed = clusters_->getIndexLayout(order, axes) ? 1 : 0;
+
+    file = fopen(fname, "wb");
+    if (file == NULL)
+    {
+      return false;
+    }
+    ok = (fwrite(&header, sizeof(header), 1, file) == 1);
+    ok = ok && (numClusters_ < 1 || fwrite(&counts[0], sizeof(counts[0]), counts.size(), file) == counts.size());
+    ok = ok && (centroids.empty() || fwrite(&centroids[0], sizeof(double), centroids.size(), file) == centroids.size());
+    ok = ok && (attributes.empty() || fwrite(&attributes[0], sizeof(double), attributes.size(), file) == attributes.size());
+    ok = ok && (ranges.empty() || fwrite(&ranges[0], sizeof(double), ranges.size(), file) == ranges.size());
+    if (header.indexed)
+    {
+      ok = ok && (fwrite(&order[0], sizeof(int), order.size(), file) == order.size()) &&
+           (fwrite(&axes[0], 1, axes.size(), file) == axes.size());
+    }
+    ok = (fclose(file) == 0) && ok;
+    return ok;
+  }
+
+
+  LIBRARY_API bool kMeans::loadModel (const char *fname)
+  {
+    MappedFile mapped(fname);
+    kMeansModelHeader header;
+    const unsigned long long *counts;
+    const double *centroids, *attributes, *ranges;
+    const char *at;
+    size_t need;
+    int k;
+
+    if (mapped.data == NULL || mapped.size < sizeof(header))
+    {
+      return false;
+    }
+    memcpy(&header, mapped.data, sizeof(header));
+    if (memcmp(header.magic, kMeansModelMagic, sizeof(kMeansModelMagic)) != 0 ||
+        header.fdims != (unsigned int)featureDims_ || header.adims != (unsigned int)attributeDims_ ||
+        header.clusters < 1)
+    {
+      return false;
+    }
+    need = sizeof(header) +
+           header.clusters * (sizeof(unsigned long long) + (header.fdims + header.adims) * sizeof(double)) +
+           2 * header.fdims * sizeof(double) +
+           (header.indexed ? header.clusters * (sizeof(int) + 1) : 0);
+    if (mapped.size < need)
+    {
+      return false;
+    }
+
+    //! Every section before the index is a whole number of 8-byte values, so each is aligned
+    at = mapped.data + sizeof(header);
+    counts = (const unsigned long long *)at;
+    at += header.clusters * sizeof(unsigned long long);
+    centroids = (const double *)at;
+    at += header.clusters * header.fdims * sizeof(double);
+    attributes = (const double *)at;
+    at += header.clusters * header.adims * sizeof(double);
+    ranges = (const double *)at;
+    at += 2 * header.fdims * sizeof(double);
+
+    numClusters_ = (int)header.clusters;
+    clusters_->resize(numClusters_, featureDims_, attributeDims_);
+    for (k = 0; k < numClusters_; ++k)
+    {
+      clusters_->setDefinition(k, (int)counts[k], centroids + k * featureDims_, attributes + k * attributeDims_);
+    }
+    modelMax_.assign(ranges, ranges + featureDims_);
+    modelMin_.assign(ranges + featureDims_, ranges + 2 * featureDims_);
+    if (header.indexed)
+    {
+      clusters_->restoreIndex((const int *)at, (const unsigned char *)(at + header.clusters * sizeof(int)));
+    }
+
+    //! Training patterns no longer belong to the clusters
+    numPatterns_ = trainingPatterns_->getPatternCount();
+    patternAssignments_.assign(numPatterns_, -1);
+    boundsValid_ = false;
+    iterations_ = 0;
+    return true;
+  }
+
+
+  LIBRARY_API int kMeans::recluster (int threads)
+  {
+    reclusterHandler handler;
+    vector<double> centroids, halfGap, shift;
+    vector<int> nearest, counts;
+    vector<long long> evaluations;
+    bool bounded = (assignment_ == KMEANS_ASSIGN_HAMERLY) && (device_ == NULL);
+    int numReassignments = 0;
+    int i, j, k, cur;
+    double d, maxShift, nextShift;
+
+    if (numPatterns_ < 1 || numClusters_ < 1)
+    {
+      return 0;
+    }
+
+    //! Pack the current centroids for the distance kernels
+    centroids.resize(numClusters_ * featureDims_);
+    for (k = 0; k < numClusters_; ++k)
+    {
+      clusters_->getClusterFeatures(k, &centroids[k * featureDims_]);
+    }
+
+    reclusterSetup(&handler, trainingPatterns_, numPatterns_, numClusters_, featureDims_,
+                   attributeDims_, threads);
+    handler.centroids = &centroids[0];
+    handler.current = &patternAssignments_[0];
+    evaluations.assign(handler.numBlocks, 0);
+    handler.evaluations = &evaluations[0];
+
+    if (bounded)
+    {
+      if ((int)upperBounds_.size() != numPatterns_)
+      {
+        upperBounds_.assign(numPatterns_, 0.0);
+        lowerBounds_.assign(numPatterns_, 0.0);
+        boundsValid_ = false;
+      }
+
+      //! Half the distance from each centroid to its nearest neighbour
+      halfGap.assign(numClusters_, DBL_MAX);
+      for (j = 0; j < numClusters_; ++j)
+      {
+        for (k = j + 1; k < numClusters_; ++k)
+        {
+          d = 0.5 * Math::distanceL2(&centroids[j * featureDims_], &centroids[k * featureDims_],
+                                     featureDims_);
+          halfGap[j] = (d < halfGap[j]) ? d : halfGap[j];
+          halfGap[k] = (d < halfGap[k]) ? d : halfGap[k];
+        }
+      }
+      distanceEvaluations_ += (long long)numClusters_ * (numClusters_ - 1) / 2;
+
+      handler.upper = &upperBounds_[0];
+      handler.lower = &lowerBounds_[0];
+      handler.boundsValid = boundsValid_;
+      handler.halfGap = &halfGap[0];
+    }
+
+    //! Assignment step:  nearest centroid for every pattern
+    nearest.resize(numPatterns_);
+    if (device_ != NULL && device_->assign(trainingPatterns_, numPatterns_, &centroids[0],
+                                           numClusters_, &nearest[0]))
+    {
+      distanceEvaluations_ += (long long)numPatterns_ * numClusters_;
+    }
+    else
+    {
+      dropDevice();
+      handler.assignments = &nearest[0];
+      reclusterRun(&handler, reclusterAssign);
+      for (i = 0; i < handler.numBlocks; ++i)
+      {
+        distanceEvaluations_ += evaluations[i];
+      }
+    }
+
+    //! Apply the moves in pattern order, refusing any that would take a cluster below its
+    //! minimum membership.  Unassigned patterns are left alone, as in reclusterOnline.
+    counts.assign(numClusters_, 0);
+    for (i = 0; i < numPatterns_; ++i)
+    {
+      if (patternAssignments_[i] >= 0)
+      {
+        ++counts[patternAssignments_[i]];
+      }
+    }
+    for (i = 0; i < numPatterns_; ++i)
+    {
+      cur = patternAssignments_[i];
+      k = nearest[i];
+      if (cur >= 0 && k != cur)
+      {
+        if (counts[cur] > minClusterMembers_)
+        {
+          --counts[cur];
+          ++counts[k];
+          patternAssignments_[i] = k;
+          numReassignments++;
+        }
+        else if (bounded)
+        {
+          //! The bounds describe the refused cluster, so force a full search next time
+          upperBounds_[i] = DBL_MAX;
+          lowerBounds_[i] = 0.0;
+        }
+      }
+    }
+
+    //! Update step
+    handler.assignments = &patternAssignments_[0];
+    shift.assign(numClusters_, 0.0);
+    updateCentroids(&handler, &shift[0]);
+
+    if (bounded)
+    {
+      //! Loosen the bounds by how far the centroids moved:  the own-centroid distance can grow
+      //! by at most its centroid's shift, and the distance to any other by at most the largest
+      //! shift among the others
+      maxShift = nextShift = 0.0;
+      j = 0;
+      for (k = 0; k < numClusters_; ++k)
+      {
+        if (shift[k] > maxShift)
+        {
+          nextShift = maxShift;
+          maxShift = shift[k];
+          j = k;
+        }
+        else if (shift[k] > nextShift)
+        {
+          nextShift = shift[k];
+        }
+      }
+      distanceEvaluations_ += numClusters_;
+
+      for (i = 0; i < numPatterns_; ++i)
+      {
+        cur = patternAssignments_[i];
+        if (cur >= 0 && upperBounds_[i] < DBL_MAX)
+        {
+          upperBounds_[i] += shift[cur];
+          lowerBounds_[i] -= (cur == j) ? nextShift : maxShift;
+        }
+      }
+      boundsValid_ = true;
+    }
+
+    ++iterations_;
+    return numReassignments;
+  }
+
+
+  LIBRARY_API void kMeans::updateCentroids (reclusterHandler *handler, double *shift)
+  {
+    vector<double> features, attribs, old;
+    vector<int> counts;
+    vector<vector<double> > featureSums, attributeSums;
+    vector<vector<int> > blockCounts;
+    int b, j, k;
+
+    features.assign(numClusters_ * featureDims_, 0.0);
+    attribs.assign(numClusters_ * attributeDims_ + 1, 0.0);
+    counts.assign(numClusters_, 0);
+    if (device_ == NULL ||
+        !device_->sum(handler->patterns, handler->numPatterns, handler->assignments, numClusters_,
+                      reclusterBlock, &features[0], &attribs[0], &counts[0]))
+    {
+      dropDevice();
+
+      //! Per-block centroid sums, reduced in block order
+      featureSums.resize(handler->numBlocks);
+      attributeSums.resize(handler->numBlocks);
+      blockCounts.resize(handler->numBlocks);
+      handler->featureSums = &featureSums[0];
+      handler->attributeSums = &attributeSums[0];
+      handler->counts = &blockCounts[0];
+      reclusterRun(handler, reclusterSum);
+
+      features.assign(numClusters_ * featureDims_, 0.0);
+      attribs.assign(numClusters_ * attributeDims_ + 1, 0.0);
+      counts.assign(numClusters_, 0);
+      for (b = 0; b < handler->numBlocks; ++b)
+      {
+        for (j = 0; j < numClusters_ * featureDims_; ++j)
+        {
+          features[j] += featureSums[b][j];
+        }
+        for (j = 0; j < numClusters_ * attributeDims_; ++j)
+        {
+          attribs[j] += attributeSums[b][j];
+        }
+        for (k = 0; k < numClusters_; ++k)
+        {
+          counts[k] += blockCounts[b][k];
+        }
+      }
+    }
+
+    old.resize(featureDims_ + 1);
+    for (k = 0; k < numClusters_; ++k)
+    {
+      clusters_->getClusterFeatures(k, &old[0]);
+      if (counts[k] < 1)
+      {
+        //! Empty cluster:  keep its last centroid
+        clusters_->getClusterAttributes(k, &attribs[k * attributeDims_]);
+        clusters_->setDefinition(k, 0, &old[0], &attribs[k * attributeDims_]);
+        if (shift != NULL)
+        {
+          shift[k] = 0.0;
+        }
+        continue;
+      }
+      for (j = 0; j < featureDims_; ++j)
+      {
+        features[k * featureDims_ + j] /= (double)counts[k];
+      }
+      for (j = 0; j < attributeDims_; ++j)
+      {
+        attribs[k * attributeDims_ + j] /= (double)counts[k];
+      }
+      if (shift != NULL)
+      {
+        shift[k] = Math::distanceL2(&old[0], &features[k * featureDims_], featureDims_);
+      }
+      clusters_->setDefinition(k, counts[k], &features[k * featureDims_], &attribs[k * attributeDims_]);
+    }
+  }
+
+
+  LIBRARY_API void kMeans::seedPlusPlus ()
+  {
+    reclusterHandler handler;
+    vector<double> weights, center(featureDims_ + 1);
+    double total, target, d;
+    int c, i, pick;
+
+    //! First center uniformly at random; each later one with probability proportional to the
+    //! squared distance to the nearest center chosen so far
+    weights.assign(numPatterns_, DBL_MAX);
+    for (c = 0; c < numClusters_; ++c)
+    {
+      total = 0.0;
+      if (c > 0)
+      {
+        for (i = 0; i < numPatterns_; ++i)
+        {
+          total += weights[i];
+        }
+      }
+
+      pick = numPatterns_ - 1;
+      if (c == 0 || total <= 0.0)
+      {
+        pick = (int)rng_.below(numPatterns_);
+      }
+      else
+      {
+        target = rng_.uniform() * total;
+        for (i = 0; i < numPatterns_; ++i)
+        {
+          target -= weights[i];
+          if (target < 0.0 && weights[i] > 0.0)
+          {
+            pick = i;
+            break;
+          }
+        }
+      }
+
+      memcpy(&center[0], trainingPatterns_->getRawFeatureRow(pick), featureDims_ * sizeof(double));
+      clusters_->setDefinition(c, 0, &center[0], trainingPatterns_->getAttributeRow(pick));
+
+      //! Track the nearest center (lowest index on ties, as in recluster) and its distance
+      for (i = 0; i < numPatterns_; ++i)
+      {
+        d = Math::distanceL2Squared(trainingPatterns_->getRawFeatureRow(i), &center[0],
+                                    featureDims_);
+        if (d < weights[i])
+        {
+          weights[i] = d;
+          patternAssignments_[i] = c;
+        }
+      }
+      distanceEvaluations_ += numPatterns_;
+    }
+
+    //! Each cluster starts as the mean of the patterns nearest its center
+    reclusterSetup(&handler, trainingPatterns_, numPatterns_, numClusters_, featureDims_,
+                   attributeDims_, 0);
+    handler.assignments = &patternAssignments_[0];
+    updateCentroids(&handler, NULL);
+  }
+
+
+  LIBRARY_API int kMeans::reclusterOnline ()
   {
     //! Step through all patterns and see if membership should change
 
@@ -201,10 +838,164 @@ namespace Clustering
     } // for (i = 0; i < numPatterns_; ++i)
 
     delete [] valVec;
+    ++iterations_;
+    distanceEvaluations_ += (long long)numPatterns_ * numClusters_;
     return numReassignments;
   }
 
 
+  LIBRARY_API kMeansBackend kMeans::getBackend ()
+  {
+    return (device_ != NULL) ? KMEANS_BACKEND_OPENCL : KMEANS_BACKEND_CPU;
+  }
+
+
+  LIBRARY_API void kMeans::dropDevice ()
+  {
+    if (device_ != NULL)
+    {
+      delete device_;
+      device_ = NULL;
+
+      //! Device passes keep no Hamerly bounds
+      boundsValid_ = false;
+    }
+  }
+
+
+  LIBRARY_API int kMeans::getIterations ()
+  {
+    return iterations_;
+  }
+
+
+  LIBRARY_API long long kMeans::getDistanceEvaluations ()
+  {
+    return distanceEvaluations_;
+  }
+
+
+  LIBRARY_API int kMeans::observe (double *valVec, double *attributes)
+  {
+    int k = firstEmptyCluster();
+
+    if (k < 0)
+    {
+      k = clusters_->closestCluster(valVec);
+      distanceEvaluations_ += numClusters_;
+    }
+    observeInto(k, valVec, attributes);
+    return k;
+  }
+
+
+  LIBRARY_API int kMeans::observe (vector<double> &valVec, vector<double> &attributes)
+  {
+    if ((int)valVec.size() < featureDims_ || (int)attributes.size() < attributeDims_)
+    {
+      return -1;
+    }
+    return observe(&valVec[0], attributes.empty() ? NULL : &attributes[0]);
+  }
+
+
+  LIBRARY_API void kMeans::observeBatch (double *valVecs, double *attributes, int count, int *clusters)
+  {
+    vector<double> centroids(numClusters_ * featureDims_ + 1);
+    vector<int> nearest(count + 1);
+    int i, k, first = 0;
+
+    //! Samples that start empty clusters are consumed first, in order
+    for (; first < count && (k = firstEmptyCluster()) >= 0; ++first)
+    {
+      observeInto(k, valVecs + first * featureDims_, attributes + first * attributeDims_);
+      nearest[first] = k;
+    }
+
+    //! Assign the rest of the batch against a snapshot of the centroids, then update
+    for (k = 0; k < numClusters_; ++k)
+    {
+      clusters_->getClusterFeatures(k, &centroids[k * featureDims_]);
+    }
+    for (i = first; i < count; ++i)
+    {
+      nearest[i] = Math::distanceNearest(valVecs + i * featureDims_, &centroids[0],
+                                         numClusters_, featureDims_);
+    }
+    distanceEvaluations_ += (long long)(count - first) * numClusters_;
+
+    for (i = first; i < count; ++i)
+    {
+      observeInto(nearest[i], valVecs + i * featureDims_, attributes + i * attributeDims_);
+    }
+
+    if (clusters != NULL)
+    {
+      for (i = 0; i < count; ++i)
+      {
+        clusters[i] = nearest[i];
+      }
+    }
+  }
+
+
+  LIBRARY_API void kMeans::setStreamingHorizon (int samples)
+  {
+    streamHorizon_ = (samples > 0) ? samples : 0;
+  }
+
+
+  LIBRARY_API long long kMeans::getObservations ()
+  {
+    return observations_;
+  }
+
+
+  LIBRARY_API void kMeans::observeInto (int kclust, double *valVec, double *attributes)
+  {
+    Cluster &cluster = clusters_->at(kclust);
+    vector<double> features, attribs;
+
+    if (streamHorizon_ > 0 && cluster.size() >= streamHorizon_)
+    {
+      //! Treat the cluster as averaging horizon - 1 samples so the next one has weight 1/horizon
+      cluster.getFeatures(features);
+      cluster.getAttributes(attribs);
+      clusters_->setDefinition(kclust, streamHorizon_ - 1, &features[0],
+                               attribs.empty() ? NULL : &attribs[0]);
+    }
+    clusters_->addMember(kclust, valVec, attributes);
+    boundsValid_ = false;
+    ++observations_;
+  }
+
+
+  LIBRARY_API int kMeans::firstEmptyCluster ()
+  {
+    for (int k = 0; k < numClusters_; ++k)
+    {
+      if (clusters_->at(k).size() == 0)
+      {
+        return k;
+      }
+    }
+    return -1;
+  }
+
+
+  LIBRARY_API void kMeans::buildIndex ()
+  {
+    clusters_->buildIndex();
+  }
+
+
+  LIBRARY_API void kMeans::evalPatterns (double *valVecs, int count, int *nearest, int *second,
+                                         double *dist, double *secondDist)
+  {
+    clusters_->closestClusters(valVecs, count, nearest, second, dist, secondDist);
+  }
+
+
   LIBRARY_API int kMeans::evalPattern(double *valVec, double *features, double *attribs)
   {
     int knum = clusters_->closestCluster(valVec);
@@ -291,15 +1082,15 @@ namespace Clustering
       //! Pattern is not a member, so install it now.
       trainingPatterns_->getPatternRawFeatures(ipat, valVec);
       trainingPatterns_->getPatternAttributes(ipat, attribs);
-      memClusterPattern_[kclust][ipat] = true;
-
       patternAssignments_[ipat] = kclust;
       clusters_->addMember (kclust, valVec, attribs);
+      boundsValid_ = false;
     }
 
     if (valVec != NULL)
     {
       delete [] valVec;
+      delete [] attribs;
     }
   }
 
@@ -324,7 +1115,8 @@ namespace Clustering
 
         if (clusters_->removeMember(kclust, valVec, attribs))
         {
-          memClusterPattern_[kclust][ipat] = false;
+          patternAssignments_[ipat] = -1;
+          boundsValid_ = false;
           flag = true;
         }
       } // if (patternAssignments_[ipat] == kclust) 
@@ -333,6 +1125,7 @@ namespace Clustering
     if (valVec != NULL)
     {
       delete [] valVec;
+      delete [] attribs;
     }
     return flag;
   }
@@ -340,7 +1133,6 @@ namespace Clustering
 
   LIBRARY_API void kMeans::addTrainingPattern (double *valVec, double *attributes)
   {
-    int i, j, k;
     Pattern pat (featureDims_, attributeDims_);
     pat.setRawFeatures (valVec);
     pat.setAttributes (attributes);
@@ -348,45 +1140,13 @@ namespace Clustering
     trainingPatterns_->addPattern (pat);
     numPatterns_ = trainingPatterns_->getPatternCount ();
 
-    if (numPatterns_ > 1)
-    {
-      delete [] patternAssignments_;
-
-      for (i = 0; i < numClusters_; ++i)
-      {
-        delete [] memClusterPattern_[i];
-      }
-    }
-  
-    //! Create vector for pattern assignments to clusters
-    patternAssignments_ = new int[numPatterns_];
-
-    for (i = 0; i < numPatterns_; ++i)
-    {
-      //! Set to "unassigned"
-      patternAssignments_[i] = -1;
-    }
-
-    //! Allocate space for the membership association matrix
-    for (i = 0; i < numClusters_; ++i)
-    {
-      memClusterPattern_[i] = new bool[numPatterns_];
-    }
-
-    //! Assign all patterns to un-associated
-    for (j = 0; j < numClusters_; ++j)
-    {
-      for (k = 0; k < numPatterns_; ++k)
-      {
-        memClusterPattern_[j][k] = false;
-      }
-    }
+    //! The new pattern starts out unassigned
+    patternAssignments_.push_back(-1);
   }
 
 
   LIBRARY_API void kMeans::addTrainingPattern(vector<double> &valVec, double *attributes)
   {
-    int i, j, k;
     Pattern pat(featureDims_, attributeDims_);
     pat.setRawFeatures(valVec);
     pat.setAttributes(attributes);
@@ -394,45 +1154,13 @@ namespace Clustering
     trainingPatterns_->addPattern(pat);
     numPatterns_ = trainingPatterns_->getPatternCount();
 
-    if (numPatterns_ > 1)
-    {
-      delete[] patternAssignments_;
-
-      for (i = 0; i < numClusters_; ++i)
-      {
-        delete[] memClusterPattern_[i];
-      }
-    }
-
-    //! Create vector for pattern assignments to clusters
-    patternAssignments_ = new int[numPatterns_];
-
-    for (i = 0; i < numPatterns_; ++i)
-    {
-      //! Set to "unassigned"
-      patternAssignments_[i] = -1;
-    }
-
-    //! Allocate space for the membership association matrix
-    for (i = 0; i < numClusters_; ++i)
-    {
-      memClusterPattern_[i] = new bool[numPatterns_];
-    }
-
-    //! Assign all patterns to un-associated
-    for (j = 0; j < numClusters_; ++j)
-    {
-      for (k = 0; k < numPatterns_; ++k)
-      {
-        memClusterPattern_[j][k] = false;
-      }
-    }
+    //! The new pattern starts out unassigned
+    patternAssignments_.push_back(-1);
   }
 
 
   LIBRARY_API void kMeans::addTrainingPattern(double *valVec, vector<double> &attributes)
   {
-    int i, j, k;
     Pattern pat(featureDims_, attributeDims_);
     pat.setRawFeatures(valVec);
     pat.setAttributes(attributes);
@@ -440,45 +1168,13 @@ namespace Clustering
     trainingPatterns_->addPattern(pat);
     numPatterns_ = trainingPatterns_->getPatternCount();
 
-    if (numPatterns_ > 1)
-    {
-      delete[] patternAssignments_;
-
-      for (i = 0; i < numClusters_; ++i)
-      {
-        delete[] memClusterPattern_[i];
-      }
-    }
-
-    //! Create vector for pattern assignments to clusters
-    patternAssignments_ = new int[numPatterns_];
-
-    for (i = 0; i < numPatterns_; ++i)
-    {
-      //! Set to "unassigned"
-      patternAssignments_[i] = -1;
-    }
-
-    //! Allocate space for the membership association matrix
-    for (i = 0; i < numClusters_; ++i)
-    {
-      memClusterPattern_[i] = new bool[numPatterns_];
-    }
-
-    //! Assign all patterns to un-associated
-    for (j = 0; j < numClusters_; ++j)
-    {
-      for (k = 0; k < numPatterns_; ++k)
-      {
-        memClusterPattern_[j][k] = false;
-      }
-    }
+    //! The new pattern starts out unassigned
+    patternAssignments_.push_back(-1);
   }
 
 
   LIBRARY_API void kMeans::addTrainingPattern(vector<double> &valVec, vector<double> &attributes)
   {
-    int i, j, k;
     Pattern pat(featureDims_, attributeDims_);
     pat.setRawFeatures(valVec);
     pat.setAttributes(attributes);
@@ -486,45 +1182,44 @@ namespace Clustering
     trainingPatterns_->addPattern(pat);
     numPatterns_ = trainingPatterns_->getPatternCount();
 
-    if (numPatterns_ > 1)
-    {
-      delete[] patternAssignments_;
-
-      for (i = 0; i < numClusters_; ++i)
-      {
-        delete[] memClusterPattern_[i];
-      }
-    }
-
-    //! Create vector for pattern assignments to clusters
-    patternAssignments_ = new int[numPatterns_];
+    //! The new pattern starts out unassigned
+    patternAssignments_.push_back(-1);
+  }
 
-    for (i = 0; i < numPatterns_; ++i)
-    {
-      //! Set to "unassigned"
-      patternAssignments_[i] = -1;
-    }
 
-    //! Allocate space for the membership association matrix
-    for (i = 0; i < numClusters_; ++i)
-    {
-      memClusterPattern_[i] = new bool[numPatterns_];
-    }
+  LIBRARY_API int kMeans::addTrainingPatterns (const double *valVecs, const double *attributes, int count)
+  {
+    vector<double> zeros(attributeDims_ + 1, 0.0);
+    int added;
 
-    //! Assign all patterns to un-associated
-    for (j = 0; j < numClusters_; ++j)
+    trainingPatterns_->reserve(trainingPatterns_->getPatternCount() + count);
+    for (added = 0; added < count; ++added)
     {
-      for (k = 0; k < numPatterns_; ++k)
+      if (!trainingPatterns_->addPattern(valVecs + ((size_t)added * featureDims_),
+                                         (attributes == NULL) ? &zeros[0] :
+                                         attributes + ((size_t)added * attributeDims_)))
       {
-        memClusterPattern_[j][k] = false;
+        break;
       }
     }
+    numPatterns_ = trainingPatterns_->getPatternCount();
+
+    //! The new patterns start out unassigned
+    patternAssignments_.resize(numPatterns_, -1);
+    return added;
   }
 
 
   LIBRARY_API void kMeans::clearTrainingPatterns ()
   {
     trainingPatterns_->clearPatterns ();
+    numPatterns_ = 0;
+    patternAssignments_.clear();
+    boundsValid_ = false;
+    if (device_ != NULL)
+    {
+      device_->invalidate();
+    }
   }
 
 
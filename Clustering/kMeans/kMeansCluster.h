@@ -17,9 +17,45 @@
 
 #include "../Patterns/Pattern.h"
 #include "../Cluster/Cluster.h"
+#include "../../Libraries/Math/Random.h"
 
 namespace Clustering
 {
+  //! @brief How kMeans::seedClusters picks the initial clusters
+  //!
+  typedef enum
+  {
+    KMEANS_SEED_RANDOM = 0,   //! First k patterns start the clusters, the rest join a random one
+    KMEANS_SEED_PLUSPLUS      //! k-means++:  centers drawn with probability proportional to the
+                              //! squared distance from the centers already chosen
+  } kMeansSeeding;
+
+  //! @brief How kMeans::recluster finds each pattern's nearest cluster
+  //!
+  typedef enum
+  {
+    KMEANS_ASSIGN_LLOYD = 0,  //! Measure every pattern against every centroid
+    KMEANS_ASSIGN_HAMERLY     //! Keep per-pattern distance bounds and skip patterns that the
+                              //! triangle inequality shows cannot have changed cluster
+  } kMeansAssignment;
+
+  //! @brief Where kMeans::recluster does its distance and centroid work
+  //!
+  typedef enum
+  {
+    KMEANS_BACKEND_CPU = 0,   //! Worker threads on the host
+    KMEANS_BACKEND_OPENCL     //! An OpenCL device with double precision (a GPU if there is
+                              //! one), falling back to the CPU if none is usable
+  } kMeansBackend;
+
+  //! @brief Worker state shared by the recluster threads (kMeansCluster.cpp)
+  //!
+  struct reclusterHandler;
+
+  //! @brief OpenCL backend (kMeansOpenCL.h)
+  //!
+  class kMeansDevice;
+
   //! @ingroup Clustering
   //!
   //! @brief Container class for both Patterns and Clusters, and driver
@@ -34,8 +70,14 @@ namespace Clustering
     //! @Param adim   The number of elements in an attribute vector
     //! @param kclust The number of clusters to be defined
     //! @param path   Path to the file containing feature vector values
-    //!
-    kMeans (int fdim, int adim, int kclust, char *path);
+    //! @param seeding    Initial cluster selection used by seedClusters
+    //! @param assignment Nearest-cluster search used by recluster
+    //! @param backend    Where recluster runs (see getBackend)
+    //!
+    kMeans (int fdim, int adim, int kclust, char *path,
+            kMeansSeeding seeding = KMEANS_SEED_RANDOM,
+            kMeansAssignment assignment = KMEANS_ASSIGN_LLOYD,
+            kMeansBackend backend = KMEANS_BACKEND_CPU);
 
     //! @brief Default destructor
     //!
@@ -47,17 +89,92 @@ namespace Clustering
     //!
     void setMinClusterMembers(int min);
 
-    //! @brief Seed the clusters with random patterns
+    //! @brief Seed this instance's random number stream (seeded from the clock by default), so
+    //!        that seedClusters is repeatable and parallel instances use independent streams
+    //!
+    //! @param seed The random number seed
+    //!
+    void setRandomSeed (uint64_t seed);
+
+    //! @brief Seed the clusters using the seeding method chosen at construction
     //!
     void seedClusters ();
 
-    //! @brief Run the re-cluster method to adjust the cluster definitions
-    //!        and reassign patterns to clusters that better fit their
-    //!        profiles
+    //! @brief Run one Lloyd (batch) iteration:  reassign every pattern to its nearest cluster
+    //!        centroid, then recompute the centroids from their new members.  The assignment
+    //!        and centroid sums are split over blocks of patterns handled by worker threads, and
+    //!        the partial sums are combined in block order, so the result is the same for any
+    //!        number of threads.  A move that would leave a cluster below the minimum member
+    //!        count is refused, in pattern order.
+    //!
+    //! @param threads The number of worker threads (0 uses one per hardware thread; ignored
+    //!                while an OpenCL device is in use)
     //!
     //! @return The number of patterns reassigned
     //!
-    int recluster ();
+    //! @note On an OpenCL device every pass is a full (Lloyd) search, whatever the assignment
+    //!       method, and the results match the CPU path to within rounding (see kMeansDevice)
+    //!
+    int recluster (int threads = 0);
+
+    //! @brief Run the original online (MacQueen) re-cluster pass, in which each
+    //!        reassignment updates the centroids before the next pattern is tested
+    //!
+    //! @return The number of patterns reassigned
+    //!
+    int reclusterOnline ();
+
+    //! @brief The backend recluster uses:  KMEANS_BACKEND_OPENCL only while a device is
+    //!        working (the CPU takes over if none was found at construction or one fails)
+    //!
+    kMeansBackend getBackend ();
+
+    //! @brief The number of recluster/reclusterOnline passes since the last seedClusters
+    //!
+    int getIterations ();
+
+    //! @brief The number of pattern-centroid (and centroid-centroid) distances computed since
+    //!        the last seedClusters, including those used for seeding
+    //!
+    long long getDistanceEvaluations ();
+
+    //! @brief Streaming update:  move the nearest cluster toward a sample that is not kept as
+    //!        a training pattern, so memory stays bounded however many samples arrive.  While
+    //!        clusters are still empty, each sample starts the next one instead.  The centroid
+    //!        moves by 1/n of the difference, an exact running mean of the samples it has
+    //!        absorbed, or by at least 1/horizon once a streaming horizon has been set.
+    //!
+    //! @param valVec     The sample feature vector
+    //! @param attributes The sample attributes
+    //!
+    //! @return The index of the cluster updated
+    //!
+    //! @note Batch recluster passes recompute the centroids from the stored training patterns
+    //!       only, discarding what was learned from observed samples
+    //!
+    int observe (double *valVec, double *attributes);
+    int observe (vector<double> &valVec, vector<double> &attributes);
+
+    //! @brief Mini-batch update (Sculley, 2010):  assign a batch of samples against the
+    //!        current centroids, then fold each into its cluster as in observe
+    //!
+    //! @param valVecs    count feature vectors, one after another
+    //! @param attributes count attribute vectors, one after another
+    //! @param count      The number of samples in the batch
+    //! @param clusters   If not NULL, filled with the cluster assigned to each sample
+    //!
+    void observeBatch (double *valVecs, double *attributes, int count, int *clusters = NULL);
+
+    //! @brief Bound the memory of the streaming updates so that the clusters keep tracking a
+    //!        slowly drifting process (e.g., a registration that changes during production)
+    //!
+    //! @param samples The largest sample count a centroid averages over (0 for no limit)
+    //!
+    void setStreamingHorizon (int samples);
+
+    //! @brief The number of samples passed to observe or observeBatch
+    //!
+    long long getObservations ();
     
     //! @brief Evaluate an input pattern and get the value of the best fit's
     //!        attribute
@@ -77,6 +194,25 @@ namespace Clustering
     int evalPattern (double *valVec, vector<double> &features, vector<double> &attribs);
     int evalPattern (vector<double> &valVec, vector<double> &features, vector<double> &attribs);
 
+    //! @brief Evaluate a batch of input patterns, returning the closest and second closest
+    //!        clusters of each (see Clusters::closestClusters)
+    //!
+    //! @param valVecs    count input patterns, one after another
+    //! @param count      The number of input patterns
+    //! @param nearest    Filled with the closest cluster to each pattern
+    //! @param second     If not NULL, filled with the second closest cluster to each pattern
+    //! @param dist       If not NULL, filled with the distances to the closest clusters
+    //! @param secondDist If not NULL, filled with the distances to the second closest clusters
+    //!
+    void evalPatterns (double *valVecs, int count, int *nearest, int *second = NULL,
+                       double *dist = NULL, double *secondDist = NULL);
+
+    //! @brief Index the cluster centroids once training has finished, so that evalPattern
+    //!        queries no longer scan every cluster.  The index is dropped automatically the
+    //!        next time the clusters change.
+    //!
+    void buildIndex ();
+
     //! @brief Test whether or not a known pattern is a member of a particular
     //!        cluster
     //!
@@ -116,13 +252,40 @@ namespace Clustering
     //!
     bool removeMember (int ipat, int kclust);
 
-    //! @brief Get the rage of input pattern values
+    //! @brief Get the rage of input pattern values (those saved with the model when it was
+    //!        loaded and there are no training patterns)
     //!
     //! @param maxVals The ceiling of all x pattern values returned
     //! @param minVals The floor of all x pattern values returned
     //!
     void getRanges (double *maxVals, double *minVals);
 
+    //! @brief Write the trained model as a binary model file:  an 8-byte "CRPIKMN1" tag, the
+    //!        feature and attribute dimensions, cluster count, and whether the centroid index
+    //!        is included (32-bit each), then as native byte order values each cluster's member
+    //!        count (64-bit), the centroids and attribute means (doubles), the feature ranges
+    //!        (fdim maxima then fdim minima), and, if included, the index layout (32-bit order
+    //!        then 8-bit axes).  Training patterns are not saved.
+    //!
+    //! @param fname The file to write
+    //!
+    //! @return True if the file was written
+    //!
+    bool saveModel (const char *fname);
+
+    //! @brief Replace the clusters with those of a binary model file (see saveModel), which is
+    //!        memory-mapped rather than parsed, so that evalPattern is ready without training.
+    //!        The saved index is restored without repeating its splits.  Training patterns
+    //!        already held are kept, but left unassigned.
+    //!
+    //! @param fname The file to read
+    //!
+    //! @return True if the model was loaded, false if the file could not be opened, is
+    //!         truncated, or holds a model of different dimensions (the clusters are then
+    //!         unchanged)
+    //!
+    bool loadModel (const char *fname);
+
     //! @brief Add a new pattern to the collection of patterns
     //!
     //! @param valVec     The pattern vector being added to the collection
@@ -133,6 +296,17 @@ namespace Clustering
     void addTrainingPattern (double *valVec, vector<double> &attribute);
     void addTrainingPattern (vector<double> &valVec, vector<double> &attribute);
 
+    //! @brief Add a block of patterns to the collection, copied straight into the pattern
+    //!        store
+    //!
+    //! @param valVecs    count pattern vectors, one after another
+    //! @param attributes count attribute vectors, one after another (NULL for zeros)
+    //! @param count      The number of patterns
+    //!
+    //! @return The number of patterns added (fewer than count if the store could not grow)
+    //!
+    int addTrainingPatterns (const double *valVecs, const double *attributes, int count);
+
     //! @brief Remove all training patterns from the cluster population
     //!
     void clearTrainingPatterns ();
@@ -169,17 +343,77 @@ namespace Clustering
     //!
     int attributeDims_;
 
-    //! @brief Matrix used to cross-check pattern-cluster affiliations
+    //! @brief Cluster assignment for each pattern (-1 if unassigned).  This is the only record
+    //!        of membership, so isMember is a single lookup
     //!
-    bool **memClusterPattern_;
-
-    //! @brief Cluster assignment vector for each pattern
-    //!
-    int *patternAssignments_;
+    vector<int> patternAssignments_;
 
     //! @brief The minimum number of members required for a given cluster (default is 0)
     //!
     int minClusterMembers_;
+
+    //! @brief Random number stream used when seeding the clusters
+    //!
+    Math::Xoshiro256 rng_;
+
+    //! @brief Seeding and assignment methods
+    //!
+    kMeansSeeding seeding_;
+    kMeansAssignment assignment_;
+
+    //! @brief Hamerly bounds for each pattern:  an upper bound on the distance to its own
+    //!        centroid and a lower bound on the distance to any other centroid
+    //!
+    vector<double> upperBounds_;
+    vector<double> lowerBounds_;
+
+    //! @brief Whether upperBounds_ and lowerBounds_ match the current clusters (cleared whenever
+    //!        membership changes outside of recluster)
+    //!
+    bool boundsValid_;
+
+    //! @brief Passes and distance evaluations since the last seedClusters
+    //!
+    int iterations_;
+    long long distanceEvaluations_;
+
+    //! @brief Streaming horizon (0 for an exact running mean) and number of samples observed
+    //!
+    int streamHorizon_;
+    long long observations_;
+
+    //! @brief Feature ranges of the last loaded model (empty if none was loaded)
+    //!
+    vector<double> modelMax_;
+    vector<double> modelMin_;
+
+    //! @brief OpenCL device (NULL when recluster runs on the CPU)
+    //!
+    kMeansDevice *device_;
+
+    //! @brief Release the device after a failure, leaving recluster to the CPU
+    //!
+    void dropDevice ();
+
+    //! @brief Fold a sample into a cluster (or start an empty one) with the streaming step size
+    //!
+    void observeInto (int kclust, double *valVec, double *attributes);
+
+    //! @brief The index of the first cluster with no members, or -1 if there is none
+    //!
+    int firstEmptyCluster ();
+
+    //! @brief Pick centers by k-means++ and assign every pattern to its nearest center
+    //!
+    void seedPlusPlus ();
+
+    //! @brief Replace every cluster definition with the mean of its currently assigned members
+    //!        (a cluster left with no members keeps its old centroid)
+    //!
+    //! @param handler Worker state (patterns, block layout, and thread count) used for the sums
+    //! @param shift   If not NULL, filled with the distance each centroid moved
+    //!
+    void updateCentroids (reclusterHandler *handler, double *shift);
   }; // kMeans
 } // Clustering
 
@@ -0,0 +1,639 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Clustering
+//  Workfile:        kMeansOpenCL.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  OpenCL device backend for kMeans::recluster, definition source file.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "kMeansOpenCL.h"
+#include <cstring>
+#include <cstdint>
+#ifdef WIN32
+#include <windows.h>
+#define KMEANS_CL_CALL __stdcall
+#else
+#include <dlfcn.h>
+#define KMEANS_CL_CALL
+#endif
+
+namespace Clustering
+{
+  //! @brief The subset of the OpenCL 1.1 C API used here, declared locally so that no SDK is
+  //!        needed to build; the entry points are looked up in the runtime when it is loaded
+  //!
+  typedef int cl_int;
+  typedef unsigned int cl_uint;
+  typedef unsigned long long cl_ulong;
+  typedef struct _cl_platform_id *cl_platform_id;
+  typedef struct _cl_device_id *cl_device_id;
+  typedef struct _cl_context *cl_context;
+  typedef struct _cl_command_queue *cl_command_queue;
+  typedef struct _cl_mem *cl_mem;
+  typedef struct _cl_program *cl_program;
+  typedef struct _cl_kernel *cl_kernel;
+  typedef struct _cl_event *cl_event;
+
+  static const cl_int clSuccess = 0;
+  static const cl_ulong clDeviceTypeGpu = (1 << 2);
+  static const cl_ulong clDeviceTypeAll = 0xFFFFFFFF;
+  static const cl_uint clDeviceName = 0x102B;
+  static const cl_uint clDeviceExtensions = 0x1030;
+  static const cl_ulong clMemReadWrite = (1 << 0);
+
+  typedef cl_int (KMEANS_CL_CALL *clGetPlatformIDsFn)(cl_uint, cl_platform_id *, cl_uint *);
+  typedef cl_int (KMEANS_CL_CALL *clGetDeviceIDsFn)(cl_platform_id, cl_ulong, cl_uint, cl_device_id *,
+                                                    cl_uint *);
+  typedef cl_int (KMEANS_CL_CALL *clGetDeviceInfoFn)(cl_device_id, cl_uint, size_t, void *, size_t *);
+  typedef cl_context (KMEANS_CL_CALL *clCreateContextFn)(const intptr_t *, cl_uint, const cl_device_id *,
+                                                         void *, void *, cl_int *);
+  typedef cl_command_queue (KMEANS_CL_CALL *clCreateCommandQueueFn)(cl_context, cl_device_id, cl_ulong,
+                                                                    cl_int *);
+  typedef cl_mem (KMEANS_CL_CALL *clCreateBufferFn)(cl_context, cl_ulong, size_t, void *, cl_int *);
+  typedef cl_program (KMEANS_CL_CALL *clCreateProgramWithSourceFn)(cl_context, cl_uint, const char **,
+                                                                   const size_t *, cl_int *);
+  typedef cl_int (KMEANS_CL_CALL *clBuildProgramFn)(cl_program, cl_uint, const cl_device_id *,
+                                                    const char *, void *, void *);
+  typedef cl_kernel (KMEANS_CL_CALL *clCreateKernelFn)(cl_program, const char *, cl_int *);
+  typedef cl_int (KMEANS_CL_CALL *clSetKernelArgFn)(cl_kernel, cl_uint, size_t, const void *);
+  typedef cl_int (KMEANS_CL_CALL *clEnqueueNDRangeKernelFn)(cl_command_queue, cl_kernel, cl_uint,
+                                                            const size_t *, const size_t *,
+                                                            const size_t *, cl_uint, const cl_event *,
+                                                            cl_event *);
+  typedef cl_int (KMEANS_CL_CALL *clEnqueueWriteBufferFn)(cl_command_queue, cl_mem, cl_uint, size_t,
+                                                          size_t, const void *, cl_uint,
+                                                          const cl_event *, cl_event *);
+  typedef cl_int (KMEANS_CL_CALL *clEnqueueReadBufferFn)(cl_command_queue, cl_mem, cl_uint, size_t,
+                                                         size_t, void *, cl_uint, const cl_event *,
+                                                         cl_event *);
+  typedef cl_int (KMEANS_CL_CALL *clReleaseFn)(void *);
+
+  //! @brief Device buffers
+  //!
+  enum
+  {
+    kMeansBufferFeatures = 0,
+    kMeansBufferAttributes,
+    kMeansBufferCentroids,
+    kMeansBufferAssignments,
+    kMeansBufferPartial,
+    kMeansBufferTotals,
+    kMeansBufferCount
+  };
+
+  //! @brief Kernels.  Distances are summed one dimension at a time with contraction off, and
+  //!        the sums follow the CPU order:  each (block, column) work-item adds its block's
+  //!        patterns in order, then each (cluster, column) work-item adds the blocks in order.
+  //!        Column featureDims + attributeDims counts the members.
+  //!
+  static const char *kMeansKernels =
+    "#pragma OPENCL EXTENSION cl_khr_fp64 : enable\n"
+    "#pragma OPENCL FP_CONTRACT OFF\n"
+    "__kernel void kmeansAssign (__global const double *features, int stride, int count,\n"
+    "                            __global const double *centroids, int clusters, int dims,\n"
+    "                            __global int *nearest)\n"
+    "{\n"
+    "  int i = get_global_id(0), j, k, best = -1;\n"
+    "  double d, t, bestDist = 0.0;\n"
+    "  __global const double *row = features + (long)i * stride;\n"
+    "  if (i >= count) return;\n"
+    "  for (k = 0; k < clusters; ++k)\n"
+    "  {\n"
+    "    d = 0.0;\n"
+    "    for (j = 0; j < dims; ++j)\n"
+    "    {\n"
+    "      t = row[j] - centroids[k * dims + j];\n"
+    "      d += t * t;\n"
+    "    }\n"
+    "    if (best < 0 || d < bestDist)\n"
+    "    {\n"
+    "      best = k;\n"
+    "      bestDist = d;\n"
+    "    }\n"
+    "  }\n"
+    "  nearest[i] = best;\n"
+    "}\n"
+    "__kernel void kmeansBlockSums (__global const double *features, int fstride,\n"
+    "                               __global const double *attributes, int astride, int count,\n"
+    "                               __global const int *assignments, int clusters, int fdims,\n"
+    "                               int adims, int block, int blocks, __global double *partial)\n"
+    "{\n"
+    "  int id = get_global_id(0), width = fdims + adims + 1, b = id / width, c = id % width;\n"
+    "  int i, k, last;\n"
+    "  __global double *out = partial + (long)b * clusters * width;\n"
+    "  if (b >= blocks) return;\n"
+    "  for (k = 0; k < clusters; ++k) out[k * width + c] = 0.0;\n"
+    "  last = (b + 1) * block;\n"
+    "  last = (last < count) ? last : count;\n"
+    "  for (i = b * block; i < last; ++i)\n"
+    "  {\n"
+    "    k = assignments[i];\n"
+    "    if (k < 0) continue;\n"
+    "    if (c < fdims) out[k * width + c] += features[(long)i * fstride + c];\n"
+    "    else if (c < fdims + adims) out[k * width + c] += attributes[(long)i * astride + c - fdims];\n"
+    "    else out[k * width + c] += 1.0;\n"
+    "  }\n"
+    "}\n"
+    "__kernel void kmeansReduce (__global const double *partial, int blocks, int size,\n"
+    "                            __global double *totals)\n"
+    "{\n"
+    "  int id = get_global_id(0), b;\n"
+    "  double s = 0.0;\n"
+    "  if (id >= size) return;\n"
+    "  for (b = 0; b < blocks; ++b) s += partial[(long)b * size + id];\n"
+    "  totals[id] = s;\n"
+    "}\n";
+
+
+  //! @brief Runtime entry points and the objects created with them
+  //!
+  struct kMeansOpenCLState
+  {
+#ifdef WIN32
+    HMODULE library;
+#else
+    void *library;
+#endif
+
+    clGetPlatformIDsFn getPlatformIDs;
+    clGetDeviceIDsFn getDeviceIDs;
+    clGetDeviceInfoFn getDeviceInfo;
+    clCreateContextFn createContext;
+    clCreateCommandQueueFn createCommandQueue;
+    clCreateBufferFn createBuffer;
+    clCreateProgramWithSourceFn createProgramWithSource;
+    clBuildProgramFn buildProgram;
+    clCreateKernelFn createKernel;
+    clSetKernelArgFn setKernelArg;
+    clEnqueueNDRangeKernelFn enqueueNDRangeKernel;
+    clEnqueueWriteBufferFn enqueueWriteBuffer;
+    clEnqueueReadBufferFn enqueueReadBuffer;
+    clReleaseFn finish;
+    clReleaseFn releaseMemObject;
+    clReleaseFn releaseKernel;
+    clReleaseFn releaseProgram;
+    clReleaseFn releaseCommandQueue;
+    clReleaseFn releaseContext;
+
+    cl_device_id device;
+    cl_context context;
+    cl_command_queue queue;
+    cl_program program;
+    cl_kernel assignKernel;
+    cl_kernel sumKernel;
+    cl_kernel reduceKernel;
+    cl_mem buffers[kMeansBufferCount];
+    size_t sizes[kMeansBufferCount];
+    char name[256];
+  };
+
+
+  //! @brief Look up a runtime entry point
+  //!
+  static void *kMeansSymbol (kMeansOpenCLState *cl, const char *name)
+  {
+#ifdef WIN32
+    return (void *)GetProcAddress(cl->library, name);
+#else
+    return dlsym(cl->library, name);
+#endif
+  }
+
+
+  //! @brief Whether a device supports double precision
+  //!
+  static bool kMeansDoubleCapable (kMeansOpenCLState *cl, cl_device_id device)
+  {
+    char extensions[4096];
+    size_t length = 0;
+
+    if (cl->getDeviceInfo(device, clDeviceExtensions, sizeof(extensions) - 1, extensions,
+                          &length) != clSuccess)
+    {
+      return false;
+    }
+    extensions[(length < sizeof(extensions)) ? length : sizeof(extensions) - 1] = '\0';
+    return strstr(extensions, "cl_khr_fp64") != NULL;
+  }
+
+
+  //! @brief Set a kernel argument
+  //!
+  template <class T> static bool kMeansArg (kMeansOpenCLState *cl, cl_kernel kernel, cl_uint index,
+                                            const T &value)
+  {
+    return cl->setKernelArg(kernel, index, sizeof(T), &value) == clSuccess;
+  }
+
+
+  //! @brief Run a one-dimensional kernel over count work-items
+  //!
+  static bool kMeansLaunch (kMeansOpenCLState *cl, cl_kernel kernel, size_t count)
+  {
+    if (count < 1)
+    {
+      return true;
+    }
+    return cl->enqueueNDRangeKernel(cl->queue, kernel, 1, NULL, &count, NULL, 0, NULL,
+                                    NULL) == clSuccess;
+  }
+
+
+  kMeansDevice::kMeansDevice () :
+    cl_(NULL),
+    featureDims_(0),
+    attributeDims_(0),
+    uploaded_(NULL),
+    numUploaded_(0)
+  {
+  }
+
+
+  kMeansDevice::~kMeansDevice ()
+  {
+    close();
+  }
+
+
+  bool kMeansDevice::open (int featureDims, int attributeDims)
+  {
+    vector<cl_platform_id> platforms;
+    vector<cl_device_id> devices;
+    cl_uint numPlatforms = 0, numDevices = 0, p, d;
+    cl_ulong types[2] = {clDeviceTypeGpu, clDeviceTypeAll};
+    cl_int err = clSuccess;
+    int t;
+    size_t length;
+
+    if (cl_ != NULL)
+    {
+      return true;
+    }
+    featureDims_ = featureDims;
+    attributeDims_ = attributeDims;
+    cl_ = new kMeansOpenCLState;
+    memset(cl_, 0, sizeof(kMeansOpenCLState));
+
+#ifdef WIN32
+    cl_->library = LoadLibraryA("OpenCL.dll");
+#else
+    cl_->library = dlopen("libOpenCL.so.1", RTLD_NOW | RTLD_LOCAL);
+    if (cl_->library == NULL)
+    {
+      cl_->library = dlopen("libOpenCL.so", RTLD_NOW | RTLD_LOCAL);
+    }
+#endif
+    if (cl_->library == NULL)
+    {
+      close();
+      return false;
+    }
+
+    cl_->getPlatformIDs = (clGetPlatformIDsFn)kMeansSymbol(cl_, "clGetPlatformIDs");
+    cl_->getDeviceIDs = (clGetDeviceIDsFn)kMeansSymbol(cl_, "clGetDeviceIDs");
+    cl_->getDeviceInfo = (clGetDeviceInfoFn)kMeansSymbol(cl_, "clGetDeviceInfo");
+    cl_->createContext = (clCreateContextFn)kMeansSymbol(cl_, "clCreateContext");
+    cl_->createCommandQueue = (clCreateCommandQueueFn)kMeansSymbol(cl_, "clCreateCommandQueue");
+    cl_->createBuffer = (clCreateBufferFn)kMeansSymbol(cl_, "clCreateBuffer");
+    cl_->createProgramWithSource = (clCreateProgramWithSourceFn)kMeansSymbol(cl_, "clCreateProgramWithSource");
+    cl_->buildProgram = (clBuildProgramFn)kMeansSymbol(cl_, "clBuildProgram");
+    cl_->createKernel = (clCreateKernelFn)kMeansSymbol(cl_, "clCreateKernel");
+    cl_->setKernelArg = (clSetKernelArgFn)kMeansSymbol(cl_, "clSetKernelArg");
+    cl_->enqueueNDRangeKernel = (clEnqueueNDRangeKernelFn)kMeansSymbol(cl_, "clEnqueueNDRangeKernel");
+    cl_->enqueueWriteBuffer = (clEnqueueWriteBufferFn)kMeansSymbol(cl_, "clEnqueueWriteBuffer");
+    cl_->enqueueReadBuffer = (clEnqueueReadBufferFn)kMeansSymbol(cl_, "clEnqueueReadBuffer");
+    cl_->finish = (clReleaseFn)kMeansSymbol(cl_, "clFinish");
+    cl_->releaseMemObject = (clReleaseFn)kMeansSymbol(cl_, "clReleaseMemObject");
+    cl_->releaseKernel = (clReleaseFn)kMeansSymbol(cl_, "clReleaseKernel");
+    cl_->releaseProgram = (clReleaseFn)kMeansSymbol(cl_, "clReleaseProgram");
+    cl_->releaseCommandQueue = (clReleaseFn)kMeansSymbol(cl_, "clReleaseCommandQueue");
+    cl_->releaseContext = (clReleaseFn)kMeansSymbol(cl_, "clReleaseContext");
+    if (cl_->getPlatformIDs == NULL || cl_->getDeviceIDs == NULL || cl_->getDeviceInfo == NULL ||
+        cl_->createContext == NULL || cl_->createCommandQueue == NULL || cl_->createBuffer == NULL ||
+        cl_->createProgramWithSource == NULL || cl_->buildProgram == NULL ||
+        cl_->createKernel == NULL || cl_->setKernelArg == NULL || cl_->enqueueNDRangeKernel == NULL ||
+        cl_->enqueueWriteBuffer == NULL || cl_->enqueueReadBuffer == NULL || cl_->finish == NULL ||
+        cl_->releaseMemObject == NULL || cl_->releaseKernel == NULL || cl_->releaseProgram == NULL ||
+        cl_->releaseCommandQueue == NULL || cl_->releaseContext == NULL)
+    {
+      close();
+      return false;
+    }
+
+    //! The first double precision GPU, or failing that the first double precision device
+    if (cl_->getPlatformIDs(0, NULL, &numPlatforms) != clSuccess || numPlatforms < 1)
+    {
+      close();
+      return false;
+    }
+    platforms.resize(numPlatforms);
+    cl_->getPlatformIDs(numPlatforms, &platforms[0], NULL);
+    for (t = 0; t < 2 && cl_->device == NULL; ++t)
+    {
+      for (p = 0; p < numPlatforms && cl_->device == NULL; ++p)
+      {
+        if (cl_->getDeviceIDs(platforms[p], types[t], 0, NULL, &numDevices) != clSuccess ||
+            numDevices < 1)
+        {
+          continue;
+        }
+        devices.resize(numDevices);
+        cl_->getDeviceIDs(platforms[p], types[t], numDevices, &devices[0], NULL);
+        for (d = 0; d < numDevices; ++d)
+        {
+          if (kMeansDoubleCapable(cl_, devices[d]))
+          {
+            cl_->device = devices[d];
+            break;
+          }
+        }
+      }
+    }
+    if (cl_->device == NULL)
+    {
+      close();
+      return false;
+    }
+    length = 0;
+    cl_->getDeviceInfo(cl_->device, clDeviceName, sizeof(cl_->name) - 1, cl_->name, &length);
+    cl_->name[(length < sizeof(cl_->name)) ? length : sizeof(cl_->name) - 1] = '\0';
+
+    cl_->context = cl_->createContext(NULL, 1, &cl_->device, NULL, NULL, &err);
+    if (err == clSuccess)
+    {
+      cl_->queue = cl_->createCommandQueue(cl_->context, cl_->device, 0, &err);
+    }
+    if (err == clSuccess)
+    {
+      cl_->program = cl_->createProgramWithSource(cl_->context, 1, &kMeansKernels, NULL, &err);
+    }
+    if (err == clSuccess)
+    {
+      err = cl_->buildProgram(cl_->program, 1, &cl_->device, "", NULL, NULL);
+    }
+    if (err == clSuccess)
+    {
+      cl_->assignKernel = cl_->createKernel(cl_->program, "kmeansAssign", &err);
+    }
+    if (err == clSuccess)
+    {
+      cl_->sumKernel = cl_->createKernel(cl_->program, "kmeansBlockSums", &err);
+    }
+    if (err == clSuccess)
+    {
+      cl_->reduceKernel = cl_->createKernel(cl_->program, "kmeansReduce", &err);
+    }
+    if (err != clSuccess)
+    {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+
+  bool kMeansDevice::ready () const
+  {
+    return cl_ != NULL;
+  }
+
+
+  const char *kMeansDevice::deviceName () const
+  {
+    return (cl_ != NULL) ? cl_->name : "";
+  }
+
+
+  void kMeansDevice::invalidate ()
+  {
+    uploaded_ = NULL;
+    numUploaded_ = 0;
+  }
+
+
+  bool kMeansDevice::assign (Patterns *patterns, int numPatterns, const double *centroids,
+                             int numClusters, int *nearest)
+  {
+    int dims = featureDims_, stride = patterns->getFeatureStride();
+    size_t bytes = (size_t)numClusters * dims * sizeof(double);
+    cl_kernel kernel;
+
+    if (cl_ == NULL || !upload(patterns, numPatterns) ||
+        !reserve(kMeansBufferCentroids, bytes) ||
+        !reserve(kMeansBufferAssignments, (size_t)numPatterns * sizeof(int)) ||
+        cl_->enqueueWriteBuffer(cl_->queue, cl_->buffers[kMeansBufferCentroids], 0, 0, bytes,
+                                centroids, 0, NULL, NULL) != clSuccess)
+    {
+      return false;
+    }
+
+    kernel = cl_->assignKernel;
+    if (!kMeansArg(cl_, kernel, 0, cl_->buffers[kMeansBufferFeatures]) ||
+        !kMeansArg(cl_, kernel, 1, stride) ||
+        !kMeansArg(cl_, kernel, 2, numPatterns) ||
+        !kMeansArg(cl_, kernel, 3, cl_->buffers[kMeansBufferCentroids]) ||
+        !kMeansArg(cl_, kernel, 4, numClusters) ||
+        !kMeansArg(cl_, kernel, 5, dims) ||
+        !kMeansArg(cl_, kernel, 6, cl_->buffers[kMeansBufferAssignments]) ||
+        !kMeansLaunch(cl_, kernel, numPatterns))
+    {
+      return false;
+    }
+    return cl_->enqueueReadBuffer(cl_->queue, cl_->buffers[kMeansBufferAssignments], 1, 0,
+                                  (size_t)numPatterns * sizeof(int), nearest, 0, NULL,
+                                  NULL) == clSuccess;
+  }
+
+
+  bool kMeansDevice::sum (Patterns *patterns, int numPatterns, const int *assignments,
+                          int numClusters, int block, double *features, double *attributes,
+                          int *counts)
+  {
+    int fdims = featureDims_, adims = attributeDims_;
+    int fstride = patterns->getFeatureStride(), astride = patterns->getAttributeStride();
+    int width = fdims + adims + 1, size = numClusters * width;
+    int blocks = (numPatterns + block - 1) / block;
+    int j, k;
+    cl_kernel kernel;
+
+    if (cl_ == NULL || !upload(patterns, numPatterns) ||
+        !reserve(kMeansBufferAssignments, (size_t)numPatterns * sizeof(int)) ||
+        !reserve(kMeansBufferPartial, (size_t)blocks * size * sizeof(double)) ||
+        !reserve(kMeansBufferTotals, (size_t)size * sizeof(double)) ||
+        cl_->enqueueWriteBuffer(cl_->queue, cl_->buffers[kMeansBufferAssignments], 0, 0,
+                                (size_t)numPatterns * sizeof(int), assignments, 0, NULL,
+                                NULL) != clSuccess)
+    {
+      return false;
+    }
+
+    kernel = cl_->sumKernel;
+    if (!kMeansArg(cl_, kernel, 0, cl_->buffers[kMeansBufferFeatures]) ||
+        !kMeansArg(cl_, kernel, 1, fstride) ||
+        !kMeansArg(cl_, kernel, 2, cl_->buffers[kMeansBufferAttributes]) ||
+        !kMeansArg(cl_, kernel, 3, astride) ||
+        !kMeansArg(cl_, kernel, 4, numPatterns) ||
+        !kMeansArg(cl_, kernel, 5, cl_->buffers[kMeansBufferAssignments]) ||
+        !kMeansArg(cl_, kernel, 6, numClusters) ||
+        !kMeansArg(cl_, kernel, 7, fdims) ||
+        !kMeansArg(cl_, kernel, 8, adims) ||
+        !kMeansArg(cl_, kernel, 9, block) ||
+        !kMeansArg(cl_, kernel, 10, blocks) ||
+        !kMeansArg(cl_, kernel, 11, cl_->buffers[kMeansBufferPartial]) ||
+        !kMeansLaunch(cl_, kernel, (size_t)blocks * width))
+    {
+      return false;
+    }
+
+    kernel = cl_->reduceKernel;
+    if (!kMeansArg(cl_, kernel, 0, cl_->buffers[kMeansBufferPartial]) ||
+        !kMeansArg(cl_, kernel, 1, blocks) ||
+        !kMeansArg(cl_, kernel, 2, size) ||
+        !kMeansArg(cl_, kernel, 3, cl_->buffers[kMeansBufferTotals]) ||
+        !kMeansLaunch(cl_, kernel, size))
+    {
+      return false;
+    }
+
+    totals_.resize(size);
+    if (cl_->enqueueReadBuffer(cl_->queue, cl_->buffers[kMeansBufferTotals], 1, 0,
+                               (size_t)size * sizeof(double), &totals_[0], 0, NULL,
+                               NULL) != clSuccess)
+    {
+      return false;
+    }
+    for (k = 0; k < numClusters; ++k)
+    {
+      for (j = 0; j < fdims; ++j)
+      {
+        features[k * fdims + j] = totals_[k * width + j];
+      }
+      for (j = 0; j < adims; ++j)
+      {
+        attributes[k * adims + j] = totals_[k * width + fdims + j];
+      }
+      counts[k] = (int)totals_[k * width + fdims + adims];
+    }
+    return true;
+  }
+
+
+  bool kMeansDevice::upload (Patterns *patterns, int numPatterns)
+  {
+    size_t fbytes = (size_t)numPatterns * patterns->getFeatureStride() * sizeof(double);
+    size_t abytes = (size_t)numPatterns * patterns->getAttributeStride() * sizeof(double);
+
+    if (patterns == uploaded_ && numPatterns == numUploaded_)
+    {
+      return true;
+    }
+    invalidate();
+    if (numPatterns < 1 || !reserve(kMeansBufferFeatures, fbytes) ||
+        !reserve(kMeansBufferAttributes, abytes) ||
+        cl_->enqueueWriteBuffer(cl_->queue, cl_->buffers[kMeansBufferFeatures], 1, 0, fbytes,
+                                patterns->getRawFeatureRow(0), 0, NULL, NULL) != clSuccess)
+    {
+      return false;
+    }
+    if (abytes > 0 &&
+        cl_->enqueueWriteBuffer(cl_->queue, cl_->buffers[kMeansBufferAttributes], 1, 0, abytes,
+                                patterns->getAttributeRow(0), 0, NULL, NULL) != clSuccess)
+    {
+      return false;
+    }
+    uploaded_ = patterns;
+    numUploaded_ = numPatterns;
+    return true;
+  }
+
+
+  bool kMeansDevice::reserve (int which, size_t bytes)
+  {
+    cl_int err = clSuccess;
+
+    //! Never create an empty buffer (e.g., attributes when there are none)
+    bytes = (bytes < sizeof(double)) ? sizeof(double) : bytes;
+    if (cl_->buffers[which] != NULL && cl_->sizes[which] >= bytes)
+    {
+      return true;
+    }
+    if (cl_->buffers[which] != NULL)
+    {
+      cl_->finish(cl_->queue);
+      cl_->releaseMemObject(cl_->buffers[which]);
+      cl_->buffers[which] = NULL;
+      cl_->sizes[which] = 0;
+    }
+    cl_->buffers[which] = cl_->createBuffer(cl_->context, clMemReadWrite, bytes, NULL, &err);
+    if (err != clSuccess || cl_->buffers[which] == NULL)
+    {
+      cl_->buffers[which] = NULL;
+      return false;
+    }
+    cl_->sizes[which] = bytes;
+    return true;
+  }
+
+
+  void kMeansDevice::close ()
+  {
+    int i;
+
+    if (cl_ == NULL)
+    {
+      return;
+    }
+    if (cl_->queue != NULL)
+    {
+      cl_->finish(cl_->queue);
+    }
+    for (i = 0; i < kMeansBufferCount; ++i)
+    {
+      if (cl_->buffers[i] != NULL)
+      {
+        cl_->releaseMemObject(cl_->buffers[i]);
+      }
+    }
+    if (cl_->assignKernel != NULL)
+    {
+      cl_->releaseKernel(cl_->assignKernel);
+    }
+    if (cl_->sumKernel != NULL)
+    {
+      cl_->releaseKernel(cl_->sumKernel);
+    }
+    if (cl_->reduceKernel != NULL)
+    {
+      cl_->releaseKernel(cl_->reduceKernel);
+    }
+    if (cl_->program != NULL)
+    {
+      cl_->releaseProgram(cl_->program);
+    }
+    if (cl_->queue != NULL)
+    {
+      cl_->releaseCommandQueue(cl_->queue);
+    }
+    if (cl_->context != NULL)
+    {
+      cl_->releaseContext(cl_->context);
+    }
+    if (cl_->library != NULL)
+    {
+#ifdef WIN32
+      FreeLibrary(cl_->library);
+#else
+      dlclose(cl_->library);
+#endif
+    }
+    delete cl_;
+    cl_ = NULL;
+    invalidate();
+  }
+} // Clustering
@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Clustering
+//  Workfile:        kMeansOpenCL.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  OpenCL device backend for kMeans::recluster, declaration file.  The
+//  OpenCL runtime is loaded when the backend is first used, so neither the
+//  build nor machines without a GPU depend on an OpenCL SDK.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef KMEANSOPENCL_H
+#define KMEANSOPENCL_H
+
+#include <vector>
+#include "../Patterns/Pattern.h"
+
+using namespace std;
+
+namespace Clustering
+{
+  //! @brief OpenCL runtime entry points and objects (kMeansOpenCL.cpp)
+  //!
+  struct kMeansOpenCLState;
+
+  //! @ingroup Clustering
+  //!
+  //! @brief Runs the two data-parallel recluster phases on an OpenCL device with double
+  //!        precision support (a GPU if there is one):  the nearest-centroid search, one
+  //!        work-item per pattern, and the centroid sums.  The sums are accumulated per block
+  //!        of patterns in pattern order and then combined in block order, exactly as the
+  //!        CPU threads do, so for the same assignments the centroids are bit-for-bit those of
+  //!        the CPU path.  Distances are summed dimension by dimension without contraction;
+  //!        the CPU kernels use SIMD lanes, so a pattern almost equidistant from two
+  //!        centroids may be assigned differently (within rounding).
+  //!
+  //!        The pattern matrix is uploaded once and kept on the device until the patterns
+  //!        change.
+  //!
+  class kMeansDevice
+  {
+  public:
+    //! @brief Default constructor (no device until open succeeds)
+    //!
+    kMeansDevice ();
+
+    //! @brief Default destructor
+    //!
+    ~kMeansDevice ();
+
+    //! @brief Load the OpenCL runtime, choose a device, and build the kernels
+    //!
+    //! @param featureDims   The number of elements in a feature vector
+    //! @param attributeDims The number of elements in an attribute vector
+    //!
+    //! @return True if a usable device was found
+    //!
+    bool open (int featureDims, int attributeDims);
+
+    //! @brief Whether open has succeeded
+    //!
+    bool ready () const;
+
+    //! @brief The name of the device in use (empty if none)
+    //!
+    const char *deviceName () const;
+
+    //! @brief Mark the uploaded patterns stale, so the next pass uploads them again
+    //!
+    void invalidate ();
+
+    //! @brief Nearest centroid for every pattern
+    //!
+    //! @param patterns    The training patterns (uploaded if they changed)
+    //! @param numPatterns The number of patterns
+    //! @param centroids   numClusters x featureDims centroids
+    //! @param numClusters The number of clusters
+    //! @param nearest     Filled with the nearest cluster of each pattern
+    //!
+    //! @return True on success; false if the device failed (nearest is then undefined)
+    //!
+    bool assign (Patterns *patterns, int numPatterns, const double *centroids, int numClusters,
+                 int *nearest);
+
+    //! @brief Feature and attribute sums and member counts of every cluster
+    //!
+    //! @param patterns    The training patterns (uploaded if they changed)
+    //! @param numPatterns The number of patterns
+    //! @param assignments Cluster of each pattern (-1 patterns are skipped)
+    //! @param numClusters The number of clusters
+    //! @param block       Patterns per block (reclusterBlock)
+    //! @param features    Filled with numClusters x featureDims sums
+    //! @param attributes  Filled with numClusters x attributeDims sums
+    //! @param counts      Filled with the number of members of each cluster
+    //!
+    //! @return True on success; false if the device failed
+    //!
+    bool sum (Patterns *patterns, int numPatterns, const int *assignments, int numClusters,
+              int block, double *features, double *attributes, int *counts);
+
+  private:
+
+    //! @brief Runtime entry points, context, queue, kernels, and buffers
+    //!
+    kMeansOpenCLState *cl_;
+
+    //! @brief Pattern dimensions
+    //!
+    int featureDims_;
+    int attributeDims_;
+
+    //! @brief Patterns and pattern count held on the device
+    //!
+    Patterns *uploaded_;
+    int numUploaded_;
+
+    //! @brief Host copy of the reduced sums
+    //!
+    vector<double> totals_;
+
+    //! @brief Upload the pattern matrices if they are not already on the device
+    //!
+    bool upload (Patterns *patterns, int numPatterns);
+
+    //! @brief Make a device buffer hold at least bytes, reallocating if needed
+    //!
+    bool reserve (int which, size_t bytes);
+
+    //! @brief Release every device object and unload the runtime
+    //!
+    void close ();
+  }; // kMeansDevice
+} // Clustering
+
+#endif
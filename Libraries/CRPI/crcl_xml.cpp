@@ -47,323 +47,17 @@ namespace Xml
 
   LIBRARY_API bool CrclXml::parse (const string &line)
   {
-    static char buff[1024];
-    bool readTags = false;
-    bool state = true;
-    bool error = false;
-
-    xmlAttributes attr;
-    vector<string> chars;
-
-    int marker = 0;
-    int openTags = 0;
-    bool tagActive = false;
-    bool start = false;
-    bool single = false;
-    bool validXML = false;
-
-    int strLength = line.length();
-    int count;
-    string temp;
-    string name;
-    string attrname;
-    string attrval;
     try
     {
-      //! JAM:  TODO, STRIP OFF WHITE SPACE:  Carriage returns, tabs, etc.
-
-      while (marker < strLength && !error && line[marker] != '\0')
-      {
-        if (line[marker] == '<')
-        {
-          //! ***** Handle tags *****
-          tagActive = true;
-          for (int i = 0; i < 20; i++)
-          {
-            buff[i] = ' ';
-          }
-
-          name = "";
-          ++marker;
-
-          //! Skip white space
-          while (line[marker] == ' ' || line[marker] == '\t' || line[marker] == '?')
-          {
-            ++marker;
-            if (marker >= (strLength - 1))
-            {
-              break;
-            }
-          }
-
-          if (marker >= (strLength - 1))
-          {
-            //! Ill-formed XML string (end encountered before closing tags
-            error = true;
-            break;
-          }
-
-          if (line[marker] == '/')
-          {
-            start = false;
-            marker++;
-          }
-          else
-          {
-            start = true;
-          }
-
-          int count = 0;
-          while (line[marker] != ' ' && line[marker] != '\t' &&
-                 line[marker] != '/' && line[marker] != '>' &&
-                 line[marker] != '?' && marker <= (strLength - 1))
-          {
-            buff[count] = line[marker];
-            count++;
-            marker++;
-            if (marker >= (strLength - 1))
-            {
-              break;
-            }
-          }
-          if (marker > (strLength - 1))
-          {
-            //! Ill-formed XML string (end encountered before closing tags
-            error = true;
-            break;
-          }
-
-          buff[count] = '\0';
-          name = buff;
-          name = name.substr(0, count);
-
-          if (start)
-          {
-            //! Look for attributes of opening tags
-            while (line[marker] != '/' && line[marker] != '>' &&
-                   line[marker] != '?' && marker <= (strLength -1))
-            {
-              if (line[marker] != ' ' && line[marker] != '\t' &&
-                  line[marker] != '?' && line[marker] != '\n')
-              {
-                //! Non-white-space character & non-terminating element
-                //! Ergo, an attribute
-                count = 0;
-
-                //! grab the attribute name
-                while (line[marker] != '=' && line[marker] != ' ' && line[marker] != '?')
-                {
-                  buff[count++] = line[marker++];
-                  if (marker >= strLength - 1)
-                  {
-                    break;
-                  }
-                }
-                if (marker >= strLength - 1)
-                {
-                  break;
-                }
-                buff[count] = '\0';
-                attrname = buff;
-                attrname = attrname.substr(0, count);
-                attr.name.push_back(attrname);
-
-                //! grab the attribute value
-                while (line[marker] != '\"')
-                {
-                  marker++;
-                  if (marker >= strLength - 1)
-                  {
-                    break;
-                  }
-                }
-                marker++;
-                if (marker >= strLength - 1)
-                {
-                  break;
-                }
-
-                count = 0;
-                while (line[marker] != '\"')
-                {
-                  buff[count++] = line[marker++];
-                  if (marker >= strLength - 1)
-                  {
-                    break;
-                  }
-                }
-                buff[count] = '\0';
-                attrval = buff;
-                attrval = attrval.substr(0, count);
-                attr.val.push_back(attrval);
-              } // if (line[marker] != ' ' && line[marker] != '\t' && line[marker] != '\n' && line[marker] != '?')
-              marker++;
-              if (marker > strLength - 1)
-              {
-                break;
-              }
-            } // while (line[marker] != '/' && line[marker] != '>' && line[marker] != '?')
-
-            if (marker > (strLength - 1))
-            {
-              //! Ill-formed XML string (end encountered before closing tags
-              error = true;
-              break;
-            } // if (marker > (strLength - 1))
-
-            //! Test for single-tag XML lines (ex. <tag/>
-            if (line[marker] == '/')
-            {
-              single = true;
-            }
-            while (line[marker] != '>')
-            {
-              marker++;
-              if (marker >= strLength - 1)
-              {
-                break;
-              }
-            } // while (line[marker] != '>')
-          } // if (start)
-
-          if (error)
-          {
-            break;
-          }
-
-          //! Pass tag information for data structure assignment
-          if (start)
-          {
-            if (state && startElement (name, attr))
-            {
-              state = true;
-              attr.name.clear();
-              attr.val.clear();
-            }
-            else
-            {
-              state = false;
-            }
-
-            validXML = false;
-            openTags++;
-            readTags = true;
-            if (single)
-            {
-              tagActive = false;
-              validXML = true;
-              if (state && endElement (name))
-              {
-                state = true;
-              }
-              else
-              {
-                state = false;
-              }
-              openTags--;
-              start = false;
-            }
-          } // if (start)
-          else
-          {
-            tagActive = false;
-            validXML = true;
-            if (state && endElement (name))
-            {
-              state = true;
-            }
-            else
-            {
-              state = false;
-            }
-            openTags--;
-          } // if (start) ... else
-        } // if (line[marker] == '<')
-        else if (tagActive)
-        {
-          //! ***** Handle text between tags *****
-          while(start)
-          {
-            if (marker > strLength || line[marker] == '<')
-            {
-              marker--;
-              break;
-            }
-
-            //! Skip white space
-            while (line[marker] == ' ' || line[marker] == '\t' ||
-                   line[marker] == '\n' || line[marker] == ',' ||
-                   line[marker] == '?')
-            {
-              marker++;
-              if (marker >= strLength)
-              {
-                break;
-              }
-            }
-
-            if (marker > strLength || line[marker] == '<')
-            {
-              marker--;
-              break;
-            }
-
-            count = 0;
-            while (line[marker] != ',' && line[marker] != '<')
-            {
-              buff[count++] = line[marker++];
-              if (marker >= strLength - 1)
-              {
-                break;
-              }
-            }
-            if (marker >= (strLength - 1))
-            {
-              //! Ill-formed XML string (end encountered before closing tags
-              error = true;
-              break;
-            }
-            if (count > 0)
-            {
-              temp = buff;
-              temp = temp.substr (0, count);
-              chars.push_back (temp);
-            }
-          } // while(start)
-          if (start)
-          {
-            if (state && interTagElement (name, chars))
-            {
-              state = true;
-            }
-            else
-            {
-              state = false;
-            }
-            chars.clear ();
-          }
-          start = false;
-        } // else if (tagActive)
-
-        ++marker;
-        if (openTags < 1 && readTags)
-        {
-//          break;
-        }
-      } // while (marker < strLength && marker < 1024)
-    } // try
+      return sax_.parse (line.c_str(), line.length(), *this);
+    }
     catch (...)
     {
       return false;
     }
-
-    if (error)
-    {
-      //! Exiting with errors
-    }
-    return state;
   }
 
+
   /*
     Example command for robot motion:
 
@@ -399,6 +93,40 @@ namespace Xml
     </CRCLCommandInstance>
   */
 
+  //! @brief CRCLCommand xsi:type attribute values and the CRPI commands they map to (-1 if none)
+  //!
+  static const xmlName crclCommandNames[] =
+  {
+    CRPI_XML_NAME("ActuateJointsType",                CmdMoveToAxisTarget),
+    CRPI_XML_NAME("CloseToolChangerType",             CmdCouple),
+    CRPI_XML_NAME("ConfigureJointReportsType",        -1), //! No CRPI equivalent
+    CRPI_XML_NAME("DwellType",                        CmdDwell),
+    CRPI_XML_NAME("EndCanonType",                     CmdEndCanon),
+    CRPI_XML_NAME("GetStatusType",                    CmdGetRobotPose),
+    CRPI_XML_NAME("InitCanonType",                    CmdInitCanon),
+    CRPI_XML_NAME("MessageType",                      CmdMessage),
+    CRPI_XML_NAME("MoveScrewType",                    -1), //! No CRPI equivalent
+    CRPI_XML_NAME("MoveThroughToType",                CmdMoveThroughTo),
+    CRPI_XML_NAME("MoveToType",                       CmdMoveTo),
+    CRPI_XML_NAME("RunProgramType",                   CmdRunProgram),
+    CRPI_XML_NAME("SetAbsoluteAccelerationType",      CmdSetAbsoluteAcceleration),
+    CRPI_XML_NAME("SetAbsoluteSpeedType",             CmdSetAbsoluteSpeed),
+    CRPI_XML_NAME("SetAngleUnitsType",                CmdSetAngleUnits),
+    CRPI_XML_NAME("SetEndEffectorParametersType",     CmdSetParameter),
+    CRPI_XML_NAME("SetEndEffectorType",               CmdSetTool),
+    CRPI_XML_NAME("SetEndPoseToleranceType",          CmdSetEndPoseTolerance),
+    CRPI_XML_NAME("SetForceUnitsType",                -1), //! No CRPI equivalent
+    CRPI_XML_NAME("SetIntermediatePoseToleranceType", CmdSetIntermediatePoseTolerance),
+    CRPI_XML_NAME("SetJointControlModesType",         -1), //! No CRPI equivalent
+    CRPI_XML_NAME("SetLengthUnitsType",               CmdSetLengthUnits),
+    CRPI_XML_NAME("SetRelativeAccelerationType",      CmdSetRelativeAcceleration),
+    CRPI_XML_NAME("SetTransSpeedRelativeType",        CmdSetRelativeSpeed),
+    CRPI_XML_NAME("SetRobotParametersType",           CmdSetParameter),
+    CRPI_XML_NAME("SetTorqueUnitsType",               -1), //! No CRPI equivalent
+    CRPI_XML_NAME("StopMotionType",                   CmdStopMotion)
+  };
+
+
   LIBRARY_API bool CrclXml::startElement (const string& tagName, 
                                           const xmlAttributes& attr)
   {
@@ -414,116 +142,10 @@ namespace Xml
         {
           if (strcmp (nameiter->c_str(), "xsi:type") == 0)
           {
-            if (strcmp (valiter->c_str(), "ActuateJointsType") == 0)
-            {
-              params_->cmd = CmdMoveToAxisTarget;
-            }
-            else if (strcmp (valiter->c_str(), "CloseToolChangerType") == 0)
-            {
-              params_->cmd = CmdCouple;
-            }
-            else if (strcmp (valiter->c_str(), "ConfigureJointReportsType") == 0)
-            {
-              //! JAM: No CRPI equivalent
-            }
-            else if (strcmp (valiter->c_str(), "DwellType") == 0)
-            {
-              //! No CRPI equivalent
-              params_->cmd = CmdDwell;
-            }
-            else if (strcmp (valiter->c_str(), "EndCanonType") == 0)
-            {
-              //! No CRPI equivalent
-              params_->cmd = CmdEndCanon;
-            }
-            else if (strcmp (valiter->c_str(), "GetStatusType") == 0)
-            {
-              params_->cmd = CmdGetRobotPose;
-            }
-            else if (strcmp (valiter->c_str(), "InitCanonType") == 0)
-            {
-              params_->cmd = CmdInitCanon;
-            }
-            else if (strcmp (valiter->c_str(), "MessageType") == 0)
-            {
-              params_->cmd = CmdMessage;
-            }
-            else if (strcmp (valiter->c_str(), "MoveScrewType") == 0)
-            {
-              //! JAM:  No CRPI equivalent
-            }
-            else if (strcmp (valiter->c_str(), "MoveThroughToType") == 0)
-            {
-              params_->cmd = CmdMoveThroughTo;
-            }
-            else if (strcmp (valiter->c_str(), "MoveToType") == 0)
-            {
-              params_->cmd = CmdMoveTo;
-            }
-            else if (strcmp (valiter->c_str(), "RunProgramType") == 0)
-            {
-              //! JAM:  No CRPI equivalent
-              params_->cmd = CmdRunProgram;
-            }
-            else if (strcmp (valiter->c_str(), "SetAbsoluteAccelerationType") == 0)
-            {
-              params_->cmd = CmdSetAbsoluteAcceleration;
-            }
-            else if (strcmp (valiter->c_str(), "SetAbsoluteSpeedType") == 0)
+            int cmd;
+            if (crpi_xml_lookup (crclCommandNames, sizeof(crclCommandNames) / sizeof(xmlName), valiter->c_str(), cmd) && cmd >= 0)
             {
-              params_->cmd = CmdSetAbsoluteSpeed;
-            }
-            else if (strcmp (valiter->c_str(), "SetAngleUnitsType") == 0)
-            {
-              params_->cmd = CmdSetAngleUnits;
-            }
-            else if (strcmp (valiter->c_str(), "SetEndEffectorParametersType") == 0)
-            {
-              params_->cmd = CmdSetParameter;
-            }
-            else if (strcmp (valiter->c_str(), "SetEndEffectorType") == 0)
-            {
-              params_->cmd = CmdSetTool;
-            }
-            else if (strcmp (valiter->c_str(), "SetEndPoseToleranceType") == 0)
-            {
-              params_->cmd = CmdSetEndPoseTolerance;
-            }
-            else if (strcmp (valiter->c_str(), "SetForceUnitsType") == 0)
-            {
-              //! JAM: No CRPI equivalent
-            }
-            else if (strcmp (valiter->c_str(), "SetIntermediatePoseToleranceType") == 0)
-            {
-              params_->cmd = CmdSetIntermediatePoseTolerance;
-            }
-            else if (strcmp (valiter->c_str(), "SetJointControlModesType") == 0)
-            {
-              //! JAM:  No CRPI equivalent
-            }
-            else if (strcmp (valiter->c_str(), "SetLengthUnitsType") == 0)
-            {
-              params_->cmd = CmdSetLengthUnits;
-            }
-            else if (strcmp (valiter->c_str(), "SetRelativeAccelerationType") == 0)
-            {
-              params_->cmd = CmdSetRelativeAcceleration;
-            }
-            else if (strcmp (valiter->c_str(), "SetTransSpeedRelativeType") == 0)
-            {
-              params_->cmd = CmdSetRelativeSpeed;
-            }
-            else if (strcmp (valiter->c_str(), "SetRobotParametersType") == 0)
-            {
-              params_->cmd = CmdSetParameter;
-            }
-            else if (strcmp (valiter->c_str(), "SetTorqueUnitsType") == 0)
-            {
-              //! JAM: No CRPI equivalent
-            }
-            else if (strcmp (valiter->c_str(), "StopMotionType") == 0)
-            {
-              params_->cmd = CmdStopMotion;
+              params_->cmd = (CanonCommand)cmd;
             }
           } //if (strcmp (nameiter->c_str(), "xsi:type") == 0)
         } //for (; nameiter != attr.name.end(); ++nameiter, ++valiter)
@@ -659,7 +281,7 @@ namespace Xml
       {
         for (; valiter != vals.end(); ++valiter)
         {
-          if (strcmp (valiter->c_str(), "true"))
+          if (strcmp (valiter->c_str(), "true") == 0)
           {
             params_->moveStraight = true;
           }
@@ -734,66 +356,66 @@ namespace Xml
   */
   LIBRARY_API bool CrclXml::encode (char *line)
   {
-    std::string str;
-    switch (params_->status)
+    if (!encode (out_))
     {
-    case CANON_SUCCESS:
-      str = "Done";
-      break;
-    case CANON_REJECT:
-      str = "Error";
-      break;
-    case CANON_FAILURE:
-      str = "Error";
-      break;
-    case CANON_RUNNING:
-      str = "Working";
-      break;
-    default:
-      return CANON_FAILURE;
+      return false;
     }
+    memcpy (line, out_.data(), out_.size());
+    line[out_.size()] = '\0';
+    return true;
+  }
 
 
-    if (params_ != NULL)
+  LIBRARY_API bool CrclXml::encode (CrpiXmlWriter &out)
+  {
+    out.clear();
+    if (params_ == NULL)
     {
-      if (strcmp (params_->toolName.c_str(), "Nothing") == 0)
-      {
-        sprintf (line, "<?xml version=\"1.0\" encoding=\"UTF-8\"?><CRCLStatus xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" xsi:noNamespaceSchemaLocation=\"../xmlSchemas/CRCLStatus.xsd\"><CommandStatus><CommandID>%d</CommandID><StatusID>%d</StatusID><CommandState>%s</CommandState></CommandStatus><Pose><Point><X>%f</X><Y>%f</Y><Z>%f</Z></Point><XAxis><I>%f</I><J>%f</J><K>%f</K></XAxis><ZAxis><I>%f</I><J>%f</J><K>%f</K></ZAxis></Pose></CRCLStatus>\0",
-                 params_->commandID,
-                 params_->counter,
-                 str.c_str(),
-                 params_->pose->x,
-                 params_->pose->y,
-                 params_->pose->z,
-                 params_->xaxis.i,
-                 params_->xaxis.j,
-                 params_->xaxis.k,
-                 params_->zaxis.i,
-                 params_->zaxis.j,
-                 params_->zaxis.k);
-      }
-      else
-      {
-        //! Include gripper status if a tool has been defined using the couple command
-        sprintf (line, "<?xml version=\"1.0\" encoding=\"UTF-8\"?><CRCLStatus xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" xsi:noNamespaceSchemaLocation=\"../xmlSchemas/CRCLStatus.xsd\"><CommandStatus><CommandID>%d</CommandID><StatusID>%d</StatusID><CommandState>%s</CommandState></CommandStatus><GripperStatus><GripperName>%s</GripperName><Separation>%f</Separation></GripperStatus><Pose><Point><X>%f</X><Y>%f</Y><Z>%f</Z></Point><XAxis><I>%f</I><J>%f</J><K>%f</K></XAxis><ZAxis><I>%f</I><J>%f</J><K>%f</K></ZAxis></Pose></CRCLStatus>\0",
-                 params_->commandID,
-                 params_->counter,      
-                 str.c_str(),
-                 params_->toolName.c_str(),
-                 params_->toolVal,
-                 params_->pose->x,
-                 params_->pose->y,
-                 params_->pose->z,
-                 params_->xaxis.i,
-                 params_->xaxis.j,
-                 params_->xaxis.k,
-                 params_->zaxis.i,
-                 params_->zaxis.j,
-                 params_->zaxis.k);
-      }
+      return false;
+    }
 
-    } //if (params_ != NULL)
-    return true;
+    out.append ("<?xml version=\"1.0\" encoding=\"UTF-8\"?><CRCLStatus xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" xsi:noNamespaceSchemaLocation=\"../xmlSchemas/CRCLStatus.xsd\"><CommandStatus><CommandID>");
+    out.appendInt (params_->commandID);
+    out.append ("</CommandID><StatusID>");
+    out.appendUnsigned (params_->counter);
+    out.append ("</StatusID><CommandState>");
+    if (!crpi_xml_state (out, params_->status))
+    {
+      return false;
+    }
+    out.append ("</CommandState></CommandStatus>");
+
+    if (strcmp (params_->toolName.c_str(), "Nothing") != 0)
+    {
+      //! Include gripper status if a tool has been defined using the couple command
+      out.append ("<GripperStatus><GripperName>");
+      out.append (params_->toolName);
+      out.append ("</GripperName><Separation>");
+      out.appendReal (params_->toolVal, true);
+      out.append ("</Separation></GripperStatus>");
+    }
+
+    out.append ("<Pose><Point><X>");
+    out.appendReal (params_->pose->x, true);
+    out.append ("</X><Y>");
+    out.appendReal (params_->pose->y, true);
+    out.append ("</Y><Z>");
+    out.appendReal (params_->pose->z, true);
+    out.append ("</Z></Point><XAxis><I>");
+    out.appendReal (params_->xaxis.i, true);
+    out.append ("</I><J>");
+    out.appendReal (params_->xaxis.j, true);
+    out.append ("</J><K>");
+    out.appendReal (params_->xaxis.k, true);
+    out.append ("</K></XAxis><ZAxis><I>");
+    out.appendReal (params_->zaxis.i, true);
+    out.append ("</I><J>");
+    out.appendReal (params_->zaxis.j, true);
+    out.append ("</J><K>");
+    out.appendReal (params_->zaxis.k, true);
+    out.append ("</K></ZAxis></Pose></CRCLStatus>");
+
+    return !out.overflowed();
   }
 
 } // XML
\ No newline at end of file
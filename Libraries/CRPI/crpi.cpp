@@ -1,2 +1,662 @@
 #include "crpi.h"
+#include <stdio.h>
+#ifdef WIN32
+#include <windows.h>
+#include <process.h>
+#define crpi_getpid _getpid
+#else
+#define crpi_getpid getpid
+#endif
 
+
+LIBRARY_API bool crpi_xml_lookup (const xmlName *table, size_t count, const char *name, int &value)
+{
+  unsigned long long hash = crpi_xml_hash (name);
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    if (table[i].hash == hash && strcmp (table[i].name, name) == 0)
+    {
+      value = table[i].value;
+      return true;
+    }
+  }
+  return false;
+}
+
+
+//! @brief Whether c separates XML names and attributes
+//!
+static inline bool xmlSpace (char c)
+{
+  return (c == ' ' || c == '\t' || c == '\n' || c == '\r');
+}
+
+
+LIBRARY_API bool CrpiSaxParser::parse (const char *text, size_t length, CrpiSaxHandler &handler)
+{
+  const char *end = (const char*)memchr (text, '\0', length);
+  const char *p = text;
+  const char *start;
+  bool textActive = false;
+
+  if (end == NULL)
+  {
+    end = text + length;
+  }
+
+  while (p < end)
+  {
+    if (*p != '<')
+    {
+      if (!textActive)
+      {
+        ++p;
+        continue;
+      }
+
+      //! ***** Handle text between an opening tag and the next tag *****
+      textActive = false;
+      chars_.clear();
+      while (p < end && *p != '<')
+      {
+        //! Skip white space and separators
+        while (p < end && (xmlSpace(*p) || *p == ',' || *p == '?'))
+        {
+          ++p;
+        }
+        start = p;
+        while (p < end && *p != ',' && *p != '<')
+        {
+          ++p;
+        }
+        if (p >= end)
+        {
+          //! Ill-formed XML string (end encountered before closing tags)
+          return true;
+        }
+        const char *last = p;
+        while (last > start && xmlSpace(*(last - 1)))
+        {
+          --last;
+        }
+        if (last > start)
+        {
+          chars_.push_back(std::string(start, last));
+        }
+      }
+      if (!handler.interTagElement (name_, chars_))
+      {
+        return false;
+      }
+      continue;
+    }
+
+    //! ***** Handle tags *****
+    textActive = false;
+    ++p;
+    while (p < end && (*p == ' ' || *p == '\t'))
+    {
+      ++p;
+    }
+    if (p >= end)
+    {
+      return true;
+    }
+
+    if (*p == '?' || *p == '!')
+    {
+      //! Declaration, comment, or processing instruction:  no callbacks
+      if ((end - p) >= 3 && p[0] == '!' && p[1] == '-' && p[2] == '-')
+      {
+        for (p += 3; p + 2 < end && !(p[0] == '-' && p[1] == '-' && p[2] == '>'); ++p);
+        p += 3;
+      }
+      else
+      {
+        while (p < end && *p != '>')
+        {
+          ++p;
+        }
+        ++p;
+      }
+      continue;
+    }
+
+    bool closing = (*p == '/');
+    if (closing)
+    {
+      ++p;
+    }
+
+    start = p;
+    while (p < end && !xmlSpace(*p) && *p != '/' && *p != '>')
+    {
+      ++p;
+    }
+    if (p >= end)
+    {
+      return true;
+    }
+    name_.assign(start, p);
+
+    if (closing)
+    {
+      while (p < end && *p != '>')
+      {
+        ++p;
+      }
+      ++p;
+      if (!handler.endElement (name_))
+      {
+        return false;
+      }
+      continue;
+    }
+
+    //! Attributes of opening tags
+    attr_.name.clear();
+    attr_.val.clear();
+    while (p < end && *p != '/' && *p != '>')
+    {
+      if (xmlSpace(*p))
+      {
+        ++p;
+        continue;
+      }
+
+      start = p;
+      while (p < end && *p != '=' && !xmlSpace(*p) && *p != '/' && *p != '>')
+      {
+        ++p;
+      }
+      attr_.name.push_back(std::string(start, p));
+
+      while (p < end && *p != '\"' && *p != '\'')
+      {
+        ++p;
+      }
+      if (p >= end)
+      {
+        return true;
+      }
+      char quote = *p++;
+      start = p;
+      while (p < end && *p != quote)
+      {
+        ++p;
+      }
+      if (p >= end)
+      {
+        return true;
+      }
+      attr_.val.push_back(std::string(start, p));
+      ++p;
+    }
+    if (p >= end)
+    {
+      return true;
+    }
+
+    //! Test for single-tag XML lines (ex. <tag/>)
+    bool single = (*p == '/');
+    while (p < end && *p != '>')
+    {
+      ++p;
+    }
+    ++p;
+
+    if (!handler.startElement (name_, attr_))
+    {
+      return false;
+    }
+    if (single)
+    {
+      if (!handler.endElement (name_))
+      {
+        return false;
+      }
+    }
+    else
+    {
+      textActive = true;
+    }
+  }
+
+  return true;
+}
+
+
+LIBRARY_API bool crpi_replace_file (const char *path, const char *contents, size_t length)
+{
+  static std::atomic<unsigned int> serial(0);
+  std::string temp(path);
+  char suffix[64];
+  FILE *out;
+  bool ok;
+
+  //! Unique per process and per call, so simultaneous writers never share a temporary file
+  sprintf(suffix, ".%d.%u.tmp", (int)crpi_getpid(), serial++);
+  temp += suffix;
+
+  if ((out = fopen(temp.c_str(), "wb")) == NULL)
+  {
+    return false;
+  }
+  ok = (fwrite(contents, 1, length, out) == length);
+  ok = (fclose(out) == 0) && ok;
+
+#ifdef WIN32
+  ok = ok && (MoveFileExA(temp.c_str(), path, MOVEFILE_REPLACE_EXISTING) != 0);
+#else
+  ok = ok && (rename(temp.c_str(), path) == 0);
+#endif
+  if (!ok)
+  {
+    remove(temp.c_str());
+  }
+  return ok;
+}
+
+
+LIBRARY_API double crpi_translation_norm (const robotPose &pose)
+{
+  return sqrt((pose.x * pose.x) + (pose.y * pose.y) + (pose.z * pose.z));
+}
+
+
+LIBRARY_API bool crpi_length_unit (const char *name, CanonLengthUnit &units)
+{
+  if (strcmp(name, "meter") == 0)
+  {
+    units = METER;
+  }
+  else if (strcmp(name, "mm") == 0)
+  {
+    units = MM;
+  }
+  else if (strcmp(name, "inch") == 0)
+  {
+    units = INCH;
+  }
+  else
+  {
+    return false;
+  }
+  return true;
+}
+
+
+LIBRARY_API bool crpi_angle_unit (const char *name, CanonAngleUnit &units)
+{
+  if (strcmp(name, "degree") == 0)
+  {
+    units = DEGREE;
+  }
+  else if (strcmp(name, "radian") == 0)
+  {
+    units = RADIAN;
+  }
+  else
+  {
+    return false;
+  }
+  return true;
+}
+
+
+LIBRARY_API double crpi_length_scale (CanonLengthUnit from, CanonLengthUnit to)
+{
+  //! Millimeters per unit
+  static const double mm[3] = {1000.0, 1.0, 25.4};
+
+  return mm[from] / mm[to];
+}
+
+
+LIBRARY_API double crpi_angle_scale (CanonAngleUnit from, CanonAngleUnit to)
+{
+  //! Radians per unit
+  static const double rad[2] = {1.0, 3.141592654 / 180.0};
+
+  return rad[from] / rad[to];
+}
+
+
+LIBRARY_API void crpi_blend_radii (const robotPose *poses,
+                                   int numPoses,
+                                   const robotPose *tolerances,
+                                   double defaultRadius,
+                                   double *radii)
+{
+  double seg, prev = 0.0f;
+  robotPose delta;
+  int i;
+
+  for (i = 0; i < numPoses; ++i)
+  {
+    if (i == numPoses - 1)
+    {
+      //! Stop on the final target
+      radii[i] = 0.0f;
+      break;
+    }
+
+    radii[i] = (tolerances != NULL) ? crpi_translation_norm (tolerances[i]) : defaultRadius;
+
+    delta.x = poses[i + 1].x - poses[i].x;
+    delta.y = poses[i + 1].y - poses[i].y;
+    delta.z = poses[i + 1].z - poses[i].z;
+    seg = 0.5f * crpi_translation_norm (delta);
+
+    if (i > 0 && radii[i] > prev)
+    {
+      radii[i] = prev;
+    }
+    if (radii[i] > seg)
+    {
+      radii[i] = seg;
+    }
+    if (radii[i] < 0.0f)
+    {
+      radii[i] = 0.0f;
+    }
+    prev = seg;
+  }
+}
+
+
+//! @brief Lock and condition variable shared by all completion handles.  Completions are rare
+//!        compared to the work between them, and one condition lets crpi_wait_any wait on
+//!        commands from different robots.
+//!
+struct CrpiCompletionSync
+{
+  CrpiCompletionSync ()
+  {
+    mutex = ulapi_mutex_new(23);
+    cond = ulapi_cond_new(23);
+    finished = 0;
+  }
+
+  ulapi_mutex_struct *mutex;
+  void *cond;
+
+  //! @brief Number of commands finished so far, so waiters can tell whether they missed one
+  //!
+  unsigned long finished;
+};
+
+static CrpiCompletionSync &completionSync ()
+{
+  static CrpiCompletionSync sync;
+  return sync;
+}
+
+
+struct CrpiCompletion::State
+{
+  State () :
+    started(false),
+    done(false),
+    result(CANON_REJECT)
+  {
+  }
+
+  bool started;
+  bool done;
+  CanonReturn result;
+  std::function<CanonReturn ()> cancel;
+  std::function<void (CanonReturn)> callback;
+};
+
+
+//! @brief Wait on the shared completion condition.  Must be called with the shared lock held.
+//!
+//! @param deadline ulapi_time() at which to give up, or a negative value to wait indefinitely
+//!
+//! @return False once the deadline has passed
+//!
+static bool completionWait (double deadline)
+{
+  CrpiCompletionSync &sync = completionSync();
+
+  if (deadline < 0.0)
+  {
+    ulapi_cond_wait(sync.cond, sync.mutex);
+    return true;
+  }
+
+  double left = deadline - ulapi_time();
+  if (left <= 0.0)
+  {
+    return false;
+  }
+  ulapi_cond_timedwait(sync.cond, sync.mutex, left);
+  return true;
+}
+
+
+LIBRARY_API CrpiCompletion::CrpiCompletion ()
+{
+}
+
+
+LIBRARY_API CrpiCompletion CrpiCompletion::create (std::function<CanonReturn ()> cancel)
+{
+  CrpiCompletion handle;
+  handle.state_ = std::make_shared<State>();
+  handle.state_->cancel = cancel;
+  return handle;
+}
+
+
+LIBRARY_API bool CrpiCompletion::valid () const
+{
+  return (state_ != NULL);
+}
+
+
+LIBRARY_API bool CrpiCompletion::ready () const
+{
+  if (!state_)
+  {
+    return true;
+  }
+
+  CrpiCompletionSync &sync = completionSync();
+  ulapi_mutex_take(sync.mutex);
+  bool done = state_->done;
+  ulapi_mutex_give(sync.mutex);
+  return done;
+}
+
+
+LIBRARY_API bool CrpiCompletion::wait_for (double secs) const
+{
+  if (!state_)
+  {
+    return true;
+  }
+
+  CrpiCompletionSync &sync = completionSync();
+  double deadline = (secs < 0.0) ? -1.0 : (ulapi_time() + secs);
+
+  ulapi_mutex_take(sync.mutex);
+  while (!state_->done && completionWait(deadline))
+  {
+  }
+  bool done = state_->done;
+  ulapi_mutex_give(sync.mutex);
+  return done;
+}
+
+
+LIBRARY_API CanonReturn CrpiCompletion::get () const
+{
+  if (!state_)
+  {
+    return CANON_REJECT;
+  }
+
+  wait_for(-1.0);
+  return state_->result;
+}
+
+
+LIBRARY_API void CrpiCompletion::then (std::function<void (CanonReturn)> callback)
+{
+  if (!state_)
+  {
+    return;
+  }
+
+  CrpiCompletionSync &sync = completionSync();
+  ulapi_mutex_take(sync.mutex);
+  if (!state_->done)
+  {
+    state_->callback = callback;
+    ulapi_mutex_give(sync.mutex);
+    return;
+  }
+  CanonReturn result = state_->result;
+  ulapi_mutex_give(sync.mutex);
+
+  if (callback)
+  {
+    callback(result);
+  }
+}
+
+
+LIBRARY_API CanonReturn CrpiCompletion::cancel ()
+{
+  if (!state_)
+  {
+    return CANON_REJECT;
+  }
+
+  CrpiCompletionSync &sync = completionSync();
+  ulapi_mutex_take(sync.mutex);
+  if (state_->done)
+  {
+    ulapi_mutex_give(sync.mutex);
+    return CANON_REJECT;
+  }
+  if (state_->started)
+  {
+    //! Already executing:  stop the robot and let the command report how it ended
+    std::function<CanonReturn ()> stop = state_->cancel;
+    ulapi_mutex_give(sync.mutex);
+    return (stop ? stop() : CANON_REJECT);
+  }
+  ulapi_mutex_give(sync.mutex);
+
+  //! Not started yet:  drop it
+  finish(CANON_REJECT);
+  return CANON_SUCCESS;
+}
+
+
+LIBRARY_API bool CrpiCompletion::start ()
+{
+  if (!state_)
+  {
+    return false;
+  }
+
+  CrpiCompletionSync &sync = completionSync();
+  ulapi_mutex_take(sync.mutex);
+  bool run = !state_->done;
+  state_->started = run;
+  ulapi_mutex_give(sync.mutex);
+  return run;
+}
+
+
+LIBRARY_API void CrpiCompletion::finish (CanonReturn result)
+{
+  if (!state_)
+  {
+    return;
+  }
+
+  CrpiCompletionSync &sync = completionSync();
+  std::function<void (CanonReturn)> callback;
+
+  ulapi_mutex_take(sync.mutex);
+  if (state_->done)
+  {
+    ulapi_mutex_give(sync.mutex);
+    return;
+  }
+  state_->result = result;
+  state_->done = true;
+  callback.swap(state_->callback);
+  ++sync.finished;
+  ulapi_cond_broadcast(sync.cond);
+  ulapi_mutex_give(sync.mutex);
+
+  if (callback)
+  {
+    callback(result);
+  }
+}
+
+
+LIBRARY_API CanonReturn crpi_wait_all (const CrpiCompletion *handles, int count, double secs)
+{
+  double deadline = (secs < 0.0) ? -1.0 : (ulapi_time() + secs);
+  CanonReturn result = CANON_SUCCESS, val;
+
+  for (int i = 0; i < count; ++i)
+  {
+    if (!handles[i].wait_for((deadline < 0.0) ? -1.0 : (deadline - ulapi_time())))
+    {
+      return CANON_RUNNING;
+    }
+  }
+  for (int i = 0; i < count; ++i)
+  {
+    val = handles[i].get();
+    if (result == CANON_SUCCESS && val != CANON_SUCCESS)
+    {
+      result = val;
+    }
+  }
+  return result;
+}
+
+
+LIBRARY_API int crpi_wait_any (const CrpiCompletion *handles, int count, double secs)
+{
+  CrpiCompletionSync &sync = completionSync();
+  double deadline = (secs < 0.0) ? -1.0 : (ulapi_time() + secs);
+  unsigned long seen;
+  bool waiting = true;
+
+  while (waiting)
+  {
+    ulapi_mutex_take(sync.mutex);
+    seen = sync.finished;
+    ulapi_mutex_give(sync.mutex);
+
+    for (int i = 0; i < count; ++i)
+    {
+      if (handles[i].ready())
+      {
+        return i;
+      }
+    }
+
+    //! Sleep until another command finishes, unless one already has since the check began
+    ulapi_mutex_take(sync.mutex);
+    while (waiting && sync.finished == seen)
+    {
+      waiting = completionWait(deadline);
+    }
+    ulapi_mutex_give(sync.mutex);
+  }
+
+  return -1;
+}
@@ -24,6 +24,14 @@
 #include <string>
 #include <time.h>
 #include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <array>
+#include <bitset>
+#include <type_traits>
+#include <memory>
+#include <functional>
+#include <unordered_map>
 
 #if defined(_MSC_VER)
 #include "ulapi.h"
@@ -422,7 +430,8 @@ struct robotPose
   //!
   double distance(robotPose &pB)
   {
-    return sqrt(((x-pB.x)*(x-pB.x))+((y-pB.y)*(y-pB.y))+((z-pB.z)*(z-pB.z)));
+    double a[3] = { x, y, z }, b[3] = { pB.x, pB.y, pB.z };
+    return Math::distanceL2(a, b, 3);
   }
 
   //! @brief Calculate the rotational distance between two pose orientations
@@ -446,12 +455,37 @@ struct robotPose
 
 #define CRPI_AXES_MAX 16
 
+//! @brief Kernels over a fixed number of axes.  The trip counts are constants, so the loops are
+//!        unrolled (and vectorized) where they are instantiated.
+//!
+template <int N> struct crpiAxesKernel
+{
+  static double distance (const double *a, const double *b)
+  {
+    double sum = 0.0;
+    for (int i = 0; i < N; ++i)
+    {
+      sum += (a[i] - b[i]) * (a[i] - b[i]);
+    }
+    return sqrt(sum);
+  }
+
+  static double error (const double *a, const double *b)
+  {
+    double err = 0.0;
+    for (int i = 0; i < N; ++i)
+    {
+      err += fabs(a[i] - b[i]);
+    }
+    return err / N;
+  }
+};
+
 struct robotAxes
 {
-  //! @brief Set of axis values
+  //! @brief Set of axis values (fixed capacity; only the first axes entries are used)
   //!
-  //double *axis;
-  vector<double> axis;
+  std::array<double, CRPI_AXES_MAX> axis;
 
   //! @brief Size of axis array
   //!
@@ -461,60 +495,18 @@ struct robotAxes
   //!
   robotAxes()
   {
-    axis.clear();
-    //axis = new double[CRPI_AXES_MAX];
-    axis.resize(CRPI_AXES_MAX);
-    for (int i = 0; i < CRPI_AXES_MAX; ++i)
-    {
-      //axis[i] = 0.0f;
-      axis.at(i) = 0.0;
-    }
-    axes = axis.size();
-    //axes = CRPI_AXES_MAX;
+    axis.fill(0.0);
+    axes = CRPI_AXES_MAX;
   }
 
   //! @brief Size-specifying constructor
   //!
-  //! @param size The number of axes for this robot
+  //! @param size The number of axes for this robot (at most CRPI_AXES_MAX)
   //!
   robotAxes(int size)
   {
-    axis.clear();
-    axis.resize(size);
-    //axis = new double[size];
-    for (int i = 0; i < size; ++i)
-    {
-      //axis[i] = 0.0f;
-      axis.at(i) = 0.0;
-    }
-    axes = size;
-  }
-
-  //! @brief Default destructor
-  //!
-  ~robotAxes()
-  {
-    axis.clear();
-    axes = 0;
-  }
-
-  //! @brief Axes assignment function
-  //!
-  //! @param source An existing axes set that will be used to populate this set
-  //!               instance
-  //!
-  robotAxes & operator=(const robotAxes &source)
-  {
-    if (this != &source)
-    {
-      axis.clear();
-      for (int i = 0; i < source.axes; ++i)
-      {
-        axis.push_back(source.axis.at(i));
-      }
-      axes = source.axes;
-    }
-    return *this;
+    axis.fill(0.0);
+    axes = (size > CRPI_AXES_MAX) ? CRPI_AXES_MAX : size;
   }
 
   //! @brief Display the axes values on the screen
@@ -523,7 +515,7 @@ struct robotAxes
   {
     for (int i = 0; i < axes; ++i)
     {
-      printf("%f", axis.at(i));// [i]);
+      printf("%f", axis[i]);
       if (i < (axes - 1))
       {
         printf(", ");
@@ -539,19 +531,21 @@ struct robotAxes
   //!
   double distance(robotAxes &target)
   {
-    double dist = 0.0f;
-    int i;
-
     if (axes != target.axes)
     {
       return -1.0f;
     }
 
-    for (i = 0; i < axes; ++i)
+    //! The arms' axis counts get the unrolled kernels
+    switch (axes)
     {
-      dist += ((axis.at(i) - target.axis.at(i)) * (axis.at(i) - target.axis.at(i)));
+    case 6:
+      return crpiAxesKernel<6>::distance(axis.data(), target.axis.data());
+    case 7:
+      return crpiAxesKernel<7>::distance(axis.data(), target.axis.data());
+    default:
+      return Math::distanceL2(axis.data(), target.axis.data(), axes);
     }
-    return sqrt(dist);
   }
 
   //! @brief Calculate the average magnitude error between two axis vectors
@@ -570,14 +564,105 @@ struct robotAxes
       return -1.0f;
     }
 
+    switch (axes)
+    {
+    case 6:
+      return crpiAxesKernel<6>::error(axis.data(), target.axis.data());
+    case 7:
+      return crpiAxesKernel<7>::error(axis.data(), target.axis.data());
+    default:
+      break;
+    }
     for (i = 0; i < axes; ++i)
     {
-      err += fabs(axis.at(i) - target.axis.at(i));
+      err += fabs(axis[i] - target.axis[i]);
     }
     return err / axes;
   }
 };
 
+//! @brief Axis values of a robot whose number of axes is known when compiled (see
+//!        CrpiAxisCount).  Loops over the axes have a constant trip count and are unrolled.
+//!        robotAxes remains the type of the CrpiRobot interface; the two convert to each other.
+//!
+template <int N> struct robotAxesN
+{
+  static_assert(N > 0 && N <= CRPI_AXES_MAX, "robotAxesN holds 1 to CRPI_AXES_MAX axes");
+
+  //! @brief Number of axes
+  //!
+  enum { axes = N };
+
+  //! @brief Set of axis values
+  //!
+  std::array<double, N> axis;
+
+  //! @brief Default constructor
+  //!
+  robotAxesN ()
+  {
+    axis.fill(0.0);
+  }
+
+  //! @brief Conversion from a run-time sized set of axes.  Axes the source lacks are 0, and
+  //!        any beyond N are dropped.
+  //!
+  explicit robotAxesN (const robotAxes &source)
+  {
+    for (int i = 0; i < N; ++i)
+    {
+      axis[i] = (i < source.axes) ? source.axis[i] : 0.0;
+    }
+  }
+
+  //! @brief Conversion to a run-time sized set of axes
+  //!
+  operator robotAxes () const
+  {
+    robotAxes out(N);
+    for (int i = 0; i < N; ++i)
+    {
+      out.axis[i] = axis[i];
+    }
+    return out;
+  }
+
+  //! @brief Calculate the distance between two axis vectors
+  //!
+  //! @return The L2 norm of the two axis vectors
+  //!
+  double distance (const robotAxesN &target) const
+  {
+    return crpiAxesKernel<N>::distance(axis.data(), target.axis.data());
+  }
+
+  //! @brief Calculate the average magnitude error between two axis vectors
+  //!
+  //! @return The average magnitude error of all axis values
+  //!
+  double error (const robotAxesN &target) const
+  {
+    return crpiAxesKernel<N>::error(axis.data(), target.axis.data());
+  }
+};
+
+//! @brief Number of axes of the driver T, taken from its constexpr axisCount member, or 0 for
+//!        drivers whose number of axes is only known at run time (e.g., CrpiSim)
+//!
+template <class T> struct CrpiAxisCount
+{
+private:
+  template <class U> static std::integral_constant<int, U::axisCount> test (int);
+  template <class U> static std::integral_constant<int, 0> test (...);
+
+public:
+  static constexpr int value = decltype(test<T>(0))::value;
+};
+
+
+//! @brief Cache line size (bytes) assumed when laying out state shared by hot paths
+//!
+#define CRPI_CACHE_LINE 64
 
 #define CRPI_IO_MAX 16
 
@@ -585,11 +670,11 @@ struct robotIO
 {
   //! @brief Set of digital I/O values
   //!
-  vector<bool> dio;
+  std::bitset<CRPI_IO_MAX> dio;
 
   //! @brief Set of analog I/O values
   //!
-  vector<double> aio;
+  std::array<double, CRPI_IO_MAX> aio;
 
   //! @brief Number of DI/O values defined
   //!
@@ -603,74 +688,369 @@ struct robotIO
   //!
   robotIO ()
   {
-    dio.resize(CRPI_IO_MAX);
-    aio.resize(CRPI_IO_MAX);
+    aio.fill(0.0);
+    ndio = naio = CRPI_IO_MAX;
+  }
+
+  //! @brief Size-specifying constructor
+  //!
+  //! @param diosize The number of DIO signals (at most CRPI_IO_MAX)
+  //! @param aiosize The number of AIO signals (at most CRPI_IO_MAX)
+  //!
+  robotIO(int diosize, int aiosize)
+  {
+    aio.fill(0.0);
+    ndio = (diosize > CRPI_IO_MAX) ? CRPI_IO_MAX : diosize;
+    naio = (aiosize > CRPI_IO_MAX) ? CRPI_IO_MAX : aiosize;
+  }
+};
+
+//! robotAxes and robotIO are copied in the feedback paths; keep them plain data so that copies
+//! never allocate
+static_assert(std::is_trivially_copyable<robotAxes>::value, "robotAxes must be trivially copyable");
+static_assert(std::is_trivially_copyable<robotAxesN<7> >::value, "robotAxesN must be trivially copyable");
+static_assert(std::is_trivially_copyable<robotIO>::value, "robotIO must be trivially copyable");
+
+//! @brief Flags identifying which parts of a RobotStateSnapshot have been filled by the driver
+//!
+typedef enum
+{
+  STATE_POSE = 1,
+  STATE_AXES = 2,
+  STATE_FORCES = 4,
+  STATE_SPEEDS = 8,
+  STATE_IO = 16,
+  STATE_TORQUES = 32,
+  STATE_STATUS = 64
+} CrpiStateField;
+
+//! @brief State of the program running on the robot's controller
+//!
+typedef enum
+{
+  PROGRAM_UNKNOWN = 0,
+  PROGRAM_STOPPED,
+  PROGRAM_PLAYING,
+  PROGRAM_PAUSED
+} CrpiProgramState;
+
+//! @brief Flags of RobotStateSnapshot::status
+//!
+typedef enum
+{
+  STATUS_POWER_ON = 1,        //! The arm is powered
+  STATUS_PROTECTIVE_STOP = 2, //! The arm was stopped by a protective (safeguard) stop
+  STATUS_EMERGENCY_STOP = 4,  //! The arm was stopped by an emergency stop
+  STATUS_REAL_ROBOT = 8       //! The controller drives a real arm rather than simulating one
+} CrpiStatusFlag;
+
+//! @brief Consistent copy of the latest robot state, as published by a driver through a
+//!        crpi_seqlock.  Fixed-size so that it can be copied without allocating.
+//!
+struct RobotStateSnapshot
+{
+  //! @brief Cartesian pose of the robot's TCP
+  //!
+  robotPose pose;
+
+  //! @brief Forces and torques at the robot's TCP
+  //!
+  robotPose forces;
+
+  //! @brief Cartesian speed of the robot's TCP
+  //!
+  robotPose speeds;
+
+  //! @brief Axis values and the number of axes used
+  //!
+  double axis[CRPI_AXES_MAX];
+  int axes;
+
+  //! @brief Axis torques (same count as axis)
+  //!
+  double torque[CRPI_AXES_MAX];
+
+  //! @brief Digital and analog I/O values and the number of each used
+  //!
+  bool dio[CRPI_IO_MAX];
+  double aio[CRPI_IO_MAX];
+  int ndio;
+  int naio;
+
+  //! @brief Bitwise OR of the CrpiStateField values that hold valid data
+  //!
+  unsigned int valid;
+
+  //! @brief Time (ulapi_time, s) at which the state was received from the robot.  Drivers that
+  //!        follow the controller's clock (see crpi_timesync.h) map the controller's own sample
+  //!        time instead, which leaves out the network jitter.
+  //!
+  double timestamp;
+
+  //! @brief Publication count, incremented each time the driver publishes a new state
+  //!
+  unsigned long sequence;
+
+  //! @brief Controller status (STATE_STATUS):  the controller's own robot and safety mode codes
+  //!        (e.g., UrRobotMode and UrSafetyMode), the CrpiProgramState, and the bitwise OR of
+  //!        the CrpiStatusFlag values that are set.  Appended last, so that states recorded
+  //!        before these fields existed are still read.
+  //!
+  int robotMode;
+  int safetyMode;
+  int programState;
+  unsigned int status;
 
+  //! @brief Default constructor
+  //!
+  RobotStateSnapshot ()
+  {
+    for (int i = 0; i < CRPI_AXES_MAX; ++i)
+    {
+      axis[i] = torque[i] = 0.0;
+    }
     for (int i = 0; i < CRPI_IO_MAX; ++i)
     {
       dio[i] = false;
-      aio[i] = 0.0f;
+      aio[i] = 0.0;
     }
-    ndio = naio = CRPI_IO_MAX;
+    axes = 0;
+    ndio = naio = 0;
+    valid = 0;
+    timestamp = 0.0;
+    sequence = 0;
+    robotMode = safetyMode = 0;
+    programState = PROGRAM_UNKNOWN;
+    status = 0;
   }
 
-  //! @brief Size-specifying constructor
+  //! @brief Store axis values
   //!
-  //! @param diosize The number of DIO signals
-  //! @param aiosize The number of AIO signals
+  void setAxes (const robotAxes &source)
+  {
+    axes = (source.axes > CRPI_AXES_MAX) ? CRPI_AXES_MAX : source.axes;
+    for (int i = 0; i < axes; ++i)
+    {
+      axis[i] = source.axis[i];
+    }
+  }
+
+  //! @brief Retrieve axis values
   //!
-  robotIO(int diosize, int aiosize)
+  void getAxes (robotAxes &dest) const
   {
-    dio.resize(diosize);
-    aio.resize(aiosize);
+    for (int i = 0; i < axes; ++i)
+    {
+      dest.axis[i] = axis[i];
+    }
+    dest.axes = axes;
+  }
 
-    for (int i = 0; i < diosize; ++i)
+  //! @brief Store I/O values
+  //!
+  void setIO (const robotIO &source)
+  {
+    ndio = (source.ndio > CRPI_IO_MAX) ? CRPI_IO_MAX : source.ndio;
+    naio = (source.naio > CRPI_IO_MAX) ? CRPI_IO_MAX : source.naio;
+    for (int i = 0; i < ndio; ++i)
     {
-      dio[i] = false;
+      dio[i] = source.dio[i];
     }
-    for (int i = 0; i < aiosize; ++i)
+    for (int i = 0; i < naio; ++i)
     {
-      aio[i] = 0.0f;
+      aio[i] = source.aio[i];
     }
-    ndio = diosize;
-    naio = aiosize;
   }
 
-  //! @brief Default destructor
+  //! @brief Retrieve I/O values
   //!
-  ~robotIO()
+  void getIO (robotIO &dest) const
   {
-    dio.clear();
-    aio.clear();
+    for (int i = 0; i < ndio; ++i)
+    {
+      dest.dio[i] = dio[i];
+    }
+    for (int i = 0; i < naio; ++i)
+    {
+      dest.aio[i] = aio[i];
+    }
+    dest.ndio = ndio;
+    dest.naio = naio;
   }
+};
 
-  //! @brief Assignment function
+//! @brief Sequence lock for publishing a fixed-size value from one writer to any number of readers.
+//!        Readers never block the writer:  they copy the value and retry if a write overlapped.
+//!
+//! @note T must not own heap memory (it is copied byte-wise while the writer may be updating it)
+//! @note Writes must be serialized by the caller (e.g., a single feedback thread, or the driver's
+//!       communication mutex)
+//!
+template <class T> class crpi_seqlock
+{
+public:
+  //! @brief Default constructor
   //!
-  //! @param source An existing IO structur that will be used to populate this
-  //!               instance
+  crpi_seqlock () :
+    seq_(0)
+  {
+  }
+
+  //! @brief Publish a new value
   //!
-  robotIO & operator=(const robotIO &source)
+  void write (const T &value)
   {
-    if (this != &source)
+    unsigned long s = seq_.load(std::memory_order_relaxed);
+
+    //! Odd sequence marks a write in progress
+    seq_.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy((void*)&data_, (const void*)&value, sizeof(T));
+    seq_.store(s + 2, std::memory_order_release);
+  }
+
+  //! @brief Copy the latest value
+  //!
+  //! @param value Destination of the copy
+  //!
+  //! @return Number of values published so far (0 if nothing has been written yet)
+  //!
+  unsigned long read (T &value) const
+  {
+    unsigned long s1, s2;
+
+    do
     {
-      dio.clear();
-      dio.resize(source.ndio);
-      aio.clear();
-      aio.resize(source.naio);
+      s1 = seq_.load(std::memory_order_acquire);
+      memcpy((void*)&value, (const void*)&data_, sizeof(T));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      s2 = seq_.load(std::memory_order_relaxed);
+    } while ((s1 & 1) || (s1 != s2));
+
+    return s1 / 2;
+  }
+
+  //! @brief Copy the latest value, giving up if every attempt overlaps a write (for readers in
+  //!        other processes, whose writer may have stopped in the middle of one)
+  //!
+  //! @param value    Destination of the copy
+  //! @param count    Populated with the number of values published so far
+  //! @param attempts Number of copies to try
+  //!
+  //! @return True if a consistent copy was made, false otherwise
+  //!
+  bool tryRead (T &value, unsigned long &count, int attempts) const
+  {
+    unsigned long s1, s2;
 
-      for (int i = 0; i < source.ndio; ++i)
+    for (; attempts > 0; --attempts)
+    {
+      s1 = seq_.load(std::memory_order_acquire);
+      if (s1 & 1)
       {
-        dio[i] = source.dio[i];
+        continue;
       }
-      for (int i = 0; i < source.naio; ++i)
+      memcpy((void*)&value, (const void*)&data_, sizeof(T));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      s2 = seq_.load(std::memory_order_relaxed);
+      if (s1 == s2)
       {
-        aio[i] = source.aio[i];
+        count = s1 / 2;
+        return true;
       }
-      ndio = source.ndio;
-      naio = source.naio;
     }
-    return *this;
+    return false;
   }
+
+  //! @brief Number of values published so far, without copying the value
+  //!
+  unsigned long count () const
+  {
+    return seq_.load(std::memory_order_acquire) / 2;
+  }
+
+private:
+  std::atomic<unsigned long> seq_;
+  T data_;
+};
+
+//! @brief Typed lock-free queue (ulapi_spsc_new or ulapi_mpsc_new) for handing values from one
+//!        thread to another, e.g., commands to a driver's control thread or samples from a
+//!        sensor thread
+//!
+//! @note T is copied byte-wise, so it must not own heap memory
+//!
+template <class T> class crpi_queue
+{
+public:
+  //! @brief Default constructor
+  //!
+  //! @param slots         Capacity (rounded up to a power of two)
+  //! @param multiProducer Whether more than one thread pushes
+  //!
+  crpi_queue (int slots, bool multiProducer = false)
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "crpi_queue values must be trivially copyable");
+    queue_ = multiProducer ? ulapi_mpsc_new(slots, sizeof(T)) : ulapi_spsc_new(slots, sizeof(T));
+  }
+
+  //! @brief Default destructor
+  //!
+  ~crpi_queue ()
+  {
+    if (queue_ != NULL)
+    {
+      ulapi_queue_delete(queue_);
+    }
+  }
+
+  //! @brief Add a value, without blocking
+  //!
+  //! @return False if the queue is full
+  //!
+  bool push (const T &value)
+  {
+    return ulapi_queue_push(queue_, &value) == ULAPI_OK;
+  }
+
+  //! @brief Remove the oldest value, without blocking
+  //!
+  //! @return False if the queue is empty
+  //!
+  bool pop (T &value)
+  {
+    return ulapi_queue_pop(queue_, &value) == ULAPI_OK;
+  }
+
+  //! @brief Remove the oldest value, waiting up to timeout seconds (forever if negative) for
+  //!        one to be pushed
+  //!
+  //! @return False on a timeout
+  //!
+  bool popWait (T &value, double timeout)
+  {
+    return ulapi_queue_pop_wait(queue_, &value, timeout) == ULAPI_OK;
+  }
+
+  //! @brief Number of values queued (a snapshot, while other threads use the queue)
+  //!
+  int size () const
+  {
+    return (int)ulapi_queue_count(queue_);
+  }
+
+  //! @brief The ulapi queue, for ulapi_queue_set_notify and ulapi_queue_arm
+  //!
+  void *handle () const
+  {
+    return queue_;
+  }
+
+private:
+  void *queue_;
+
+  crpi_queue (const crpi_queue &) = delete;
+  crpi_queue &operator= (const crpi_queue &) = delete;
 };
 
 //! @brief Generic structure for passing information between threads of a multi-threaded robot object
@@ -681,6 +1061,11 @@ struct keepalive
   //!
   ulapi_mutex_struct *handle;
 
+  //! @brief Fast lock (ulapi_fastlock_new), used instead of handle by drivers whose shared data
+  //!        is never waited on with a condition variable
+  //!
+  void *lock;
+
   //! @brief Terminator signal from the main thread to exit any loops still running in the target thread
   //!
   bool runThread;
@@ -705,6 +1090,126 @@ struct xmlAttributes
 };
 
 
+//! @brief FNV-1a hash of a tag name or attribute value.  Usable in constant expressions, so that
+//!        name tables can be hashed at compile time.
+//!
+//! @param str  The null-terminated string to hash
+//! @param hash The running hash value (leave as the default)
+//!
+inline constexpr unsigned long long crpi_xml_hash (const char *str,
+                                                   unsigned long long hash = 14695981039346656037ULL)
+{
+  return (*str == '\0') ? hash : crpi_xml_hash (str + 1, (hash ^ (unsigned char)(*str)) * 1099511628211ULL);
+}
+
+
+//! @brief Entry in a table mapping XML names to values (see crpi_xml_lookup)
+//!
+struct xmlName
+{
+  //! @brief The name as it appears in the XML
+  //!
+  const char *name;
+
+  //! @brief crpi_xml_hash of name
+  //!
+  unsigned long long hash;
+
+  //! @brief The value associated with name
+  //!
+  int value;
+};
+
+//! @brief Construct an xmlName table entry with its hash computed at compile time
+//!
+#define CRPI_XML_NAME(str, val) { str, crpi_xml_hash(str), val }
+
+
+//! @brief Look up a name in a table of xmlName entries
+//!
+//! @param table The name table
+//! @param count The number of entries in table
+//! @param name  The name to find
+//! @param value The value associated with name, if found
+//!
+//! @return True if name is in the table, false otherwise
+//!
+LIBRARY_API bool crpi_xml_lookup (const xmlName *table, size_t count, const char *name, int &value);
+
+
+//! @brief Callbacks issued by CrpiSaxParser as it walks an XML string
+//!
+class LIBRARY_API CrpiSaxHandler
+{
+public:
+  //! @brief Default destructor
+  //!
+  virtual ~CrpiSaxHandler ()
+  {
+  }
+
+  //! @brief Parse the first tag of a tag pair (or a self-closing tag)
+  //!
+  //! @param tagName The tag label
+  //! @param attr    Attributes located within the tag
+  //!
+  //! @return True if parsing is successful
+  //!
+  virtual bool startElement (const std::string& tagName, const xmlAttributes& attr) = 0;
+
+  //! @brief Parse the text between the tag pair
+  //!
+  //! @param tagName The label of the enclosing tag
+  //! @param vals    The comma-separated values found in the text
+  //!
+  //! @return True if parsing is successful
+  //!
+  virtual bool interTagElement (const std::string& tagName, const std::vector<std::string>& vals) = 0;
+
+  //! @brief Parse the second tag of a tag pair
+  //!
+  //! @param tagName The tag label
+  //!
+  //! @return True if parsing is successful
+  //!
+  virtual bool endElement (const std::string& tagName) = 0;
+};
+
+
+//! @brief Single-pass SAX tokenizer shared by the CRPI, CRCL, and robot configuration XML parsers.
+//!        Names and values are copied straight from the input into buffers that are reused from
+//!        one tag to the next, so there is no fixed-size scratch buffer and each parser object
+//!        can be used independently of the others.
+//!
+class LIBRARY_API CrpiSaxParser
+{
+public:
+  //! @brief Parse an XML string, issuing handler callbacks for each tag and text section
+  //!
+  //! @param text    The XML to parse (parsing stops at the first null character)
+  //! @param length  The number of characters in text
+  //! @param handler Receiver of the tag and text callbacks
+  //!
+  //! @return True if every callback succeeded, false otherwise.  Parsing stops at the first
+  //!         callback that fails; a truncated final tag is ignored.
+  //!
+  bool parse (const char *text, size_t length, CrpiSaxHandler &handler);
+
+private:
+  //! @brief Label of the most recent tag
+  //!
+  std::string name_;
+
+  //! @brief Attributes of the most recent opening tag
+  //!
+  xmlAttributes attr_;
+
+  //! @brief Values found in the most recent text section
+  //!
+  std::vector<std::string> chars_;
+};
+
+
 /*
 <Robot>
 <TCP_IP Address="127.0.0.1" Port="6007" Client="false"/>
@@ -721,6 +1226,137 @@ struct xmlAttributes
 
 
 
+//! @brief Feedback watchdog thresholds, as read in from the configuration XML file (see
+//!        crpi_watchdog.h).  A threshold of 0 disables its policy.
+//!
+//! @note Example XML file entry:
+//!       <Watchdog Warn="0.05" Slow="0.1" Stop="0.5" Speed="0.25" Jitter="0.004" Period="0.005"/>
+//!
+struct CrpiWatchdogParams
+{
+  //! @brief Feedback ages (s) at which the watchdog warns, slows the robot, and stops it
+  //!
+  double warnAge;
+  double slowAge;
+  double stopAge;
+
+  //! @brief Fraction of the commanded relative speed used while slowed, in (0, 1]
+  //!
+  double slowSpeed;
+
+  //! @brief Inter-arrival jitter (s) at which the watchdog warns
+  //!
+  double jitterWarn;
+
+  //! @brief Seconds between checks
+  //!
+  double period;
+
+  //! @brief Default constructor
+  //!
+  CrpiWatchdogParams()
+  {
+    warnAge = slowAge = stopAge = jitterWarn = 0.0;
+    slowSpeed = 0.25;
+    period = 0.005;
+  }
+
+  //! @brief Whether any policy is enabled
+  //!
+  bool enabled() const
+  {
+    return warnAge > 0.0 || slowAge > 0.0 || stopAge > 0.0 || jitterWarn > 0.0;
+  }
+};
+
+
+//! @brief Cartesian limits of the TCP, as read in from the configuration XML file, for
+//!        CrpiOnlineTrajectory.  Linear limits are in mm, angular limits in degrees.  A jerk of
+//!        0 is taken as CRPI_OTG_JERK_RATIO times the acceleration.
+//!
+//! @note Example XML file entry:
+//!       <CartesianLimit Velocity="250" Acceleration="1000" Jerk="10000" AngularVelocity="90"
+//!                       AngularAcceleration="360" AngularJerk="3600"/>
+//!
+struct CrpiCartesianLimits
+{
+  //! @brief Linear velocity (mm/s), acceleration (mm/s^2), and jerk (mm/s^3)
+  //!
+  double vel;
+  double acc;
+  double jerk;
+
+  //! @brief Angular velocity (deg/s), acceleration (deg/s^2), and jerk (deg/s^3)
+  //!
+  double angVel;
+  double angAcc;
+  double angJerk;
+
+  //! @brief Default constructor
+  //!
+  CrpiCartesianLimits()
+  {
+    vel = acc = jerk = angVel = angAcc = angJerk = 0.0;
+  }
+
+  //! @brief Whether the velocity and acceleration limits are all given
+  //!
+  bool enabled() const
+  {
+    return vel > 0.0 && acc > 0.0 && angVel > 0.0 && angAcc > 0.0;
+  }
+};
+
+
+//! @brief UDP multicast state broadcast, as read in from the configuration XML file (see
+//!        crpi_broadcast.h)
+//!
+//! @note Example XML file entry:
+//!       <Broadcast Port="30750" Group="239.255.0.80" Rate="10" Name="cell1_ur5"/>
+//!
+struct CrpiBroadcastParams
+{
+  //! @brief UDP port of the broadcast, 0 for none
+  //!
+  int port;
+
+  //! @brief Multicast group address (empty for CRPI_BROADCAST_GROUP)
+  //!
+  std::string group;
+
+  //! @brief Snapshots sent per second
+  //!
+  double rate;
+
+  //! @brief Label listeners see for the robot (empty for its address)
+  //!
+  std::string name;
+
+  //! @brief Default constructor
+  //!
+  CrpiBroadcastParams()
+  {
+    port = 0;
+    rate = 10.0;
+  }
+
+  //! @brief Whether a broadcast is configured
+  //!
+  bool enabled() const
+  {
+    return port > 0 && rate > 0.0;
+  }
+};
+
+
+//! @brief Interned handles of tools and coordinate systems:  their indices in
+//!        CrpiRobotParams::tools and CrpiRobotParams::coordSystNames, or CRPI_NO_HANDLE
+//!
+typedef int ToolHandle;
+typedef int FrameHandle;
+#define CRPI_NO_HANDLE -1
+
+
 //! @brief Tool definition as read in from the configuration XML file
 //!
 //! @note Example XML file entry:
@@ -815,6 +1451,11 @@ struct CrpiRobotParams
   //!
   bool tcp_ip_client;
 
+  //! @brief Modbus unit identifier of a device reached through a Modbus/TCP gateway, so that
+  //!        several devices can share one gateway connection (0 for the driver's default)
+  //!
+  int tcp_ip_unit;
+
   //! @brief IPv4 address of the robot state observer
   //!
   char obs_tcp_ip_addr[16];
@@ -851,6 +1492,35 @@ struct CrpiRobotParams
   //!
   bool use_serial;
 
+  //! @brief Robot state feedback protocol, if the driver supports more than one (e.g., "RTDE"
+  //!        for Universal Robots).  Empty to use the driver's default.
+  //!
+  char feedback_protocol[16];
+
+  //! @brief Requested robot state feedback rate (Hz), or 0 to use the driver's default
+  //!
+  double feedback_rate;
+
+  //! @brief For CrpiReplay:  the recording to replay (see crpi_recorder.h), the recorder
+  //!        channel to replay (empty for the first channel holding robot states), and the
+  //!        replay speed relative to the recording (0 for as fast as possible)
+  //!
+  std::string replay_file;
+  std::string replay_channel;
+  double replay_speed;
+
+  //! @brief Driver of the robot (e.g., "universal"), from the <Driver> tag, used by
+  //!        CrpiPluginRobot to pick the driver module to load.  Ignored by CrpiRobot<T>, whose
+  //!        driver is fixed when it is compiled.
+  //!
+  std::string driver;
+
+  //! @brief How the driver's servo-rate thread (e.g., state feedback or EGM), and the CrpiServo
+  //!        task of "stream_servo" streams, are run.  Left at ULAPI_SCHED_NORMAL, the driver
+  //!        uses its usual priority.
+  //!
+  ulapi_task_attr servo_task;
+
   //! @brief Transformation to realign the robot's coordinate system to correct for mounting
   //!
   robotPose *mounting;
@@ -885,10 +1555,94 @@ struct CrpiRobotParams
   //!
   std::vector<CrpiToolDef> tools;
 
+  //! @brief Velocity (deg/s), acceleration (deg/s^2), and jerk (deg/s^3, 0 if not given) limit
+  //!        of each joint, from the <JointLimit> tags (empty if none are given), for
+  //!        CrpiTrajectory and CrpiOnlineTrajectory
+  //!
+  std::vector<double> joint_max_vel;
+  std::vector<double> joint_max_acc;
+  std::vector<double> joint_max_jerk;
+
+  //! @brief Cartesian limits of the TCP, from the <CartesianLimit> tag (disabled if none is
+  //!        given), for CrpiOnlineTrajectory
+  //!
+  CrpiCartesianLimits cart_limits;
+
+  //! @brief Feedback watchdog of the robot, from the <Watchdog> tag (disabled if none is given)
+  //!
+  CrpiWatchdogParams watchdog;
+
+  //! @brief State broadcast of the robot, from the <Broadcast> tag (disabled if none is given)
+  //!
+  CrpiBroadcastParams broadcast;
+
+  //! @brief Hash indices of tools and coordSystNames by name, and how many entries of each
+  //!        vector they cover.  Entries appended to the vectors are indexed on the next lookup;
+  //!        anything else (e.g., renaming or removing an entry) needs a call to reindex().
+  //!
+  std::unordered_map<std::string, int> toolIndex;
+  std::unordered_map<std::string, int> coordSystIndex;
+  size_t toolsIndexed;
+  size_t coordSystsIndexed;
+
+  //! @brief Look up a tool by name
+  //!
+  //! @param name The name of the tool
+  //!
+  //! @return The tool's handle (index in tools), or CRPI_NO_HANDLE if there is no such tool
+  //!
+  ToolHandle findTool (const char *name)
+  {
+    if (toolsIndexed > tools.size())
+    {
+      reindex();
+    }
+    for (; toolsIndexed < tools.size(); ++toolsIndexed)
+    {
+      //! The first of several tools of the same name is the one found, as by a linear search
+      toolIndex.insert(std::make_pair(tools[toolsIndexed].toolName, (int)toolsIndexed));
+    }
+    std::unordered_map<std::string, int>::const_iterator itr = toolIndex.find(name);
+    return (itr == toolIndex.end()) ? CRPI_NO_HANDLE : itr->second;
+  }
+
+  //! @brief Look up a coordinate system by name
+  //!
+  //! @param name The name of the coordinate system
+  //!
+  //! @return The system's handle (index in coordSystNames), or CRPI_NO_HANDLE if there is no
+  //!         such system
+  //!
+  FrameHandle findSystem (const char *name)
+  {
+    if (coordSystsIndexed > coordSystNames.size())
+    {
+      reindex();
+    }
+    for (; coordSystsIndexed < coordSystNames.size(); ++coordSystsIndexed)
+    {
+      coordSystIndex.insert(std::make_pair(coordSystNames[coordSystsIndexed], (int)coordSystsIndexed));
+    }
+    std::unordered_map<std::string, int>::const_iterator itr = coordSystIndex.find(name);
+    return (itr == coordSystIndex.end()) ? CRPI_NO_HANDLE : itr->second;
+  }
+
+  //! @brief Drop the name indices, to be rebuilt by the next lookup
+  //!
+  void reindex ()
+  {
+    toolIndex.clear();
+    coordSystIndex.clear();
+    toolsIndexed = 0;
+    coordSystsIndexed = 0;
+  }
+
   //! @brief Default constructor
   //!
   CrpiRobotParams()
   {
+    toolsIndexed = 0;
+    coordSystsIndexed = 0;
     usedMatrix = false;
     mounting = new robotPose();
     toWorld = new robotPose();
@@ -896,6 +1650,7 @@ struct CrpiRobotParams
     tcp_ip_addr[0] = '\0';
     tcp_ip_port = 0;
     tcp_ip_client = false;
+    tcp_ip_unit = 0;
     obs_tcp_ip_addr[0] = '\0';
     obs_tcp_ip_port = 0;
     obs_tcp_ip_client = false;
@@ -905,6 +1660,10 @@ struct CrpiRobotParams
     serial_sbits = 0;
     serial_handshake[0] = '\0';
     use_serial = true;
+    feedback_protocol[0] = '\0';
+    feedback_rate = 0.0;
+    replay_speed = 1.0;
+    ulapi_task_attr_init(&servo_task);
   }
 
   //! @brief Assignment function
@@ -933,6 +1692,7 @@ struct CrpiRobotParams
       serial_sbits = source.serial_sbits;
       strcpy(serial_handshake, source.serial_handshake);
       use_serial = source.use_serial;
+      strcpy(feedback_protocol, source.feedback_protocol);
 #else
       strcpy_s(tcp_ip_addr, source.tcp_ip_addr);
       tcp_ip_port = source.tcp_ip_port;
@@ -946,10 +1706,25 @@ struct CrpiRobotParams
       serial_sbits = source.serial_sbits;
       strcpy_s(serial_handshake, source.serial_handshake);
       use_serial = source.use_serial;
+      strcpy_s(feedback_protocol, source.feedback_protocol);
 #endif
+      tcp_ip_unit = source.tcp_ip_unit;
+      feedback_rate = source.feedback_rate;
+      replay_file = source.replay_file;
+      replay_channel = source.replay_channel;
+      replay_speed = source.replay_speed;
+      driver = source.driver;
+      servo_task = source.servo_task;
+      joint_max_vel = source.joint_max_vel;
+      joint_max_acc = source.joint_max_acc;
+      joint_max_jerk = source.joint_max_jerk;
+      cart_limits = source.cart_limits;
+      watchdog = source.watchdog;
+      broadcast = source.broadcast;
       tools.clear();
       coordSystNames.clear();
       toCoordSystMatrices.clear();
+      reindex();
       std::vector<CrpiToolDef>::const_iterator itr;
       for (itr = source.tools.begin(); itr != source.tools.end(); ++itr)
       {
@@ -961,6 +1736,295 @@ struct CrpiRobotParams
 
 };
 
+//! @brief Replace the contents of a file without readers ever seeing it partially written.
+//!        The data is written to a temporary file beside the destination, which is then
+//!        renamed over it, so concurrent writers (threads or processes) never interleave.
+//!
+//! @param path     The file to replace
+//! @param contents The new contents of the file
+//! @param length   Number of bytes in contents
+//!
+//! @return True if the file was replaced, false otherwise (the original file is untouched)
+//!
+LIBRARY_API bool crpi_replace_file (const char *path, const char *contents, size_t length);
+
+//! @brief Blend radius, in mm, used by MoveThroughTo when no tolerances are given
+//!
+#define CRPI_DEFAULT_BLEND_MM 10.0
+
+//! @brief Compute the blend radius at each waypoint of a blended multi-point move
+//!
+//! @param poses         The waypoints
+//! @param numPoses      Number of waypoints
+//! @param tolerances    Allowed deviation at each waypoint (the length of its translational part
+//!                      is used), or NULL to use defaultRadius everywhere
+//! @param defaultRadius Radius used when tolerances is NULL, in the length units of poses
+//! @param radii         The numPoses computed radii, in the length units of poses
+//!
+//! @note The last waypoint always gets 0 (an exact stop), and no radius exceeds half the
+//!       length of either segment meeting at its waypoint, so neighbouring blends never overlap
+//!
+LIBRARY_API void crpi_blend_radii (const robotPose *poses,
+                                   int numPoses,
+                                   const robotPose *tolerances,
+                                   double defaultRadius,
+                                   double *radii);
+
+//! @brief Length of the translational part of a pose, speed, or acceleration
+//!
+LIBRARY_API double crpi_translation_norm (const robotPose &pose);
+
+//! @brief Parse a length ("meter," "mm," or "inch") or angle ("degree" or "radian") unit name
+//!
+//! @return True if the name was recognized, with units set to it; false otherwise, with units
+//!         unchanged
+//!
+LIBRARY_API bool crpi_length_unit (const char *name, CanonLengthUnit &units);
+LIBRARY_API bool crpi_angle_unit (const char *name, CanonAngleUnit &units);
+
+//! @brief Factor converting a length or angle from one unit to another (e.g.,
+//!        crpi_length_scale(MM, METER) is 0.001)
+//!
+LIBRARY_API double crpi_length_scale (CanonLengthUnit from, CanonLengthUnit to);
+LIBRARY_API double crpi_angle_scale (CanonAngleUnit from, CanonAngleUnit to);
+
+//! @brief Conditions that end a search run on the robot's controller
+//!
+typedef enum
+{
+  SEARCH_RUNNING = 0,
+  SEARCH_CONTACT,
+  SEARCH_DISTANCE,
+  SEARCH_SIGNAL,
+  SEARCH_TIMEOUT
+} CrpiSearchEnd;
+
+//! @brief A search path and its termination conditions, for robots that can run the whole search
+//!        on their controller (SetParameter("guarded_search", &search), which returns when the
+//!        search ends).  The conditions are then tested at the controller's own rate rather than
+//!        on the feedback CRPI receives.
+//!
+struct crpiGuardedSearch
+{
+  //! @brief Waypoints, in the current units:  prefix waypoints, then a cycle of cycle waypoints
+  //!        that repeats until a condition is met
+  //!
+  const robotPose *path;
+  int prefix;
+  int cycle;
+
+  //! @brief Seconds taken to move from one waypoint to the next
+  //!
+  double step;
+
+  //! @brief Conditions, each ignored unless positive:  magnitude of the Z force (N, as reported by
+  //!        GetRobotForces), travel along Z and in total from the robot's pose at the start (length
+  //!        units), and a time limit (s)
+  //!
+  double contact;
+  double zDelta;
+  double distance;
+  double timeout;
+
+  //! @brief Digital input whose going high ends the search (-1 for none)
+  //!
+  int signal;
+
+  //! @brief Filled by the robot:  the condition that ended the search, and the TCP pose at the
+  //!        moment it was met
+  //!
+  CrpiSearchEnd reason;
+  robotPose pose;
+
+  //! @brief Default constructor
+  //!
+  crpiGuardedSearch ()
+  {
+    path = NULL;
+    prefix = cycle = 0;
+    step = 0.1;
+    contact = zDelta = distance = timeout = 0.0;
+    signal = -1;
+    reason = SEARCH_RUNNING;
+  }
+};
+
+
+//! @brief The paths of two arms run as one job, for robots whose controller synchronizes the arms
+//!        itself (e.g., ABB MultiMove).  Each arm's robot is given the job with
+//!        SetParameter("sync_left", &job) or SetParameter("sync_right", &job); the first call only
+//!        joins the arm to the job, and the second runs both paths and returns when both arms
+//!        have stopped.  Both arms start together and pass each waypoint together, so the paths
+//!        must have the same number of waypoints.
+//!
+struct crpiSyncJob
+{
+  //! @brief Waypoints of the left [0] and right [1] arm, in the current units
+  //!
+  robotPose *poses[2];
+  int numPoses;
+
+  //! @brief Speed of each waypoint, or NULL to use the current speed
+  //!
+  robotPose *speeds[2];
+
+  //! @brief Blend tolerance of each waypoint, or NULL for the default blending
+  //!
+  robotPose *tolerances[2];
+
+  //! @brief Set by the robots as they join the job
+  //!
+  void *arms[2];
+
+  //! @brief Default constructor
+  //!
+  crpiSyncJob ()
+  {
+    poses[0] = poses[1] = NULL;
+    speeds[0] = speeds[1] = NULL;
+    tolerances[0] = tolerances[1] = NULL;
+    arms[0] = arms[1] = NULL;
+    numPoses = 0;
+  }
+};
+
+
+namespace Xml
+{
+  struct CrpiCompiledProgram;
+}
+
+//! @brief A compiled program (CrpiRobot::LoadProgram) translated into the controller's own
+//!        language, so that a long fixed sequence runs as one program on the controller instead
+//!        of one command round trip per step (SetParameter("native_program", &native)).  Poses
+//!        are used as they are in the program, in the robot's frame; IO, dwells, and speed and
+//!        unit settings are interleaved with the moves, and runs of consecutive moves of one
+//!        type are blended.  Settings the program changes apply to the translated program only.
+//!
+struct crpiNativeProgram
+{
+  //! @brief The program, translated from its next step
+  //!
+  const Xml::CrpiCompiledProgram *program;
+
+  //! @brief Whether to upload and run the translated program (returning when it ends), rather
+  //!        than only translate it
+  //!
+  bool run;
+
+  //! @brief Called on the calling thread, while the program runs, with the number of steps the
+  //!        controller has finished (may be empty)
+  //!
+  std::function<void (size_t)> progress;
+
+  //! @brief Filled by the robot:  the translated program
+  //!
+  std::string text;
+
+  //! @brief Filled by the robot:  the number of steps the controller has finished
+  //!
+  size_t completed;
+
+  //! @brief Default constructor
+  //!
+  crpiNativeProgram ()
+  {
+    program = NULL;
+    run = false;
+    completed = 0;
+  }
+};
+
+
+//! @brief Completion handle for a command queued with one of the CrpiRobot *Async methods.
+//!        Copies share the same command.
+//!
+class LIBRARY_API CrpiCompletion
+{
+public:
+  //! @brief Default constructor, creates a handle with no command attached
+  //!
+  CrpiCompletion ();
+
+  //! @brief Create the handle for a new queued command
+  //!
+  //! @param cancel Called by cancel() if the command is already executing (e.g., StopMotion)
+  //!
+  static CrpiCompletion create (std::function<CanonReturn ()> cancel);
+
+  //! @brief Whether a command is attached to this handle
+  //!
+  bool valid () const;
+
+  //! @brief Whether the command has finished (or was cancelled before it started)
+  //!
+  bool ready () const;
+
+  //! @brief Wait for the command to finish
+  //!
+  //! @param secs Maximum time to wait (s), or a negative value to wait indefinitely
+  //!
+  //! @return True if the command has finished, false on timeout
+  //!
+  bool wait_for (double secs) const;
+
+  //! @brief Wait for the command to finish
+  //!
+  //! @return The command's result, or REJECT if no command is attached or it was cancelled
+  //!         before it started
+  //!
+  CanonReturn get () const;
+
+  //! @brief Register a function to be called with the command's result.  The function runs on
+  //!        the robot's command thread, or immediately on this thread if the command has already
+  //!        finished.  Only the most recently registered function is kept.
+  //!
+  void then (std::function<void (CanonReturn)> callback);
+
+  //! @brief Cancel the command.  A command that has not started is dropped; one that is executing
+  //!        is stopped through the cancel function given to create().
+  //!
+  //! @return SUCCESS if the command was dropped or stopped, REJECT if it had already finished
+  //!
+  CanonReturn cancel ();
+
+  //! @brief Mark the command as started (command threads only)
+  //!
+  //! @return False if the command was cancelled and should not run
+  //!
+  bool start ();
+
+  //! @brief Publish the command's result and run its callback (command threads only)
+  //!
+  void finish (CanonReturn result);
+
+private:
+  struct State;
+  std::shared_ptr<State> state_;
+};
+
+//! @brief Wait for several commands, e.g., on different robots, with one shared time budget
+//!
+//! @param handles The commands to wait for
+//! @param count   The number of handles
+//! @param secs    Maximum time to wait (s), or a negative value to wait indefinitely
+//!
+//! @return SUCCESS if every command succeeded, RUNNING if any had not finished in time, and
+//!         otherwise the first non-SUCCESS result
+//!
+LIBRARY_API CanonReturn crpi_wait_all (const CrpiCompletion *handles, int count, double secs);
+
+//! @brief Wait for the first of several commands to finish
+//!
+//! @param handles The commands to wait for
+//! @param count   The number of handles
+//! @param secs    Maximum time to wait (s), or a negative value to wait indefinitely
+//!
+//! @return The index of a finished command, or -1 on timeout
+//!
+LIBRARY_API int crpi_wait_any (const CrpiCompletion *handles, int count, double secs);
+
+
 //! @brief Get the current system time
 //!
 //! @return The current system time in ms
@@ -1029,7 +2093,8 @@ inline const char* TimeStr ()
 };
 
 
-//! @brief Timer class, includes stopwatch and alarm functionality
+//! @brief Timer class, includes stopwatch and alarm functionality.  Both run on the monotonic
+//!        ulapi_time clock.
 //!
 class crpi_timer
 {
@@ -1037,21 +2102,15 @@ public:
   //! @brief Default constructor
   //!
   crpi_timer () :
+    start_(0.0),
     running_(false)
   {
-#ifdef WIN32
-    highRes_ = (QueryPerformanceFrequency (&frequency_) ? true : false);
-    timeBeginPeriod (1);
-#endif
   };
 
   //! @brief Default destructor
   //!
   ~crpi_timer ()
   {
-#ifdef WIN32
-    timeEndPeriod (1);
-#endif
   };
 
   //! @brief Start the timer if it isn't already running, otherwise
@@ -1062,16 +2121,7 @@ public:
     if (!running_)
     {
       running_ = true;
-#ifdef WIN32
-    if (highRes_)
-    {
-      QueryPerformanceCounter (&hRstart_);
-    }
-    else
-    {
-      lRstart_ = (long)getCurrentTime ();
-    }
-#endif
+      start_ = ulapi_time();
     }
   };
 
@@ -1080,16 +2130,7 @@ public:
   inline void restart ()
   {
     running_ = true;
-#ifdef WIN32
-    if (highRes_)
-    {
-      QueryPerformanceCounter (&hRstart_);
-    }
-    else
-    {
-      lRstart_ = (long)getCurrentTime ();
-    }
-#endif
+    start_ = ulapi_time();
   };
 
   //! @brief Stop the timer and return the elapsed time in ms
@@ -1099,26 +2140,10 @@ public:
   //!
   inline double stop ()
   {
-    if (!running_)
-    {
-      return 0.0;
-    }
+    double elapsed = elapsedTime ();
 
-#ifdef WIN32
     running_ = false;
-    if (highRes_)
-    {
-      QueryPerformanceCounter (&hRsample_);
-      timeDiff_ = hRsample_.QuadPart - hRstart_.QuadPart;
-      return ((double)timeDiff_ * 1000.0 /
-              (double)frequency_.QuadPart);
-    }
-    else
-    {
-      lRsample_ = (long)getCurrentTime ();
-      return (lRsample_ - lRstart_);
-    }
-#endif    
+    return elapsed;
   };
 
   //! @brief Sample the clock and report the length of time that has
@@ -1129,89 +2154,105 @@ public:
   //!
   inline double elapsedTime ()
   {
-    if (!running_)
-    {
-      return 0.0;
-    }
-
-#ifdef WIN32
-    if (highRes_)
-    {
-      QueryPerformanceCounter (&hRsample_);
-      timeDiff_ = hRsample_.QuadPart - hRstart_.QuadPart;
-      return ((double)timeDiff_ * 1000.0 /
-              (double)frequency_.QuadPart);
-    }
-    else
-    {
-      lRsample_ = (long)getCurrentTime ();
-      return (lRsample_ - lRstart_);
-    }
-#endif
+    return running_ ? ((ulapi_time() - start_) * 1000.0) : 0.0;
   };
 
-  //! @brief Wait until a specific amount of time has passed
+  //! @brief Wait until a specific amount of time has passed.  Sleeps once, to an absolute
+  //!        deadline, rather than polling.
   //!
   //! @param ms The time to wait in milliseconds
   //!
   inline void waitUntil (double ms)
   {
-    if (highRes_)
-    {
-      restart ();
-      while (elapsedTime () < ms)
-      {
-#ifdef WIN32
-        Sleep (1);
-#else
-        usleep(1000);
-#endif
-      }
-      stop ();
-    }
-    else
-    {
-#ifdef WIN32
-      Sleep ((DWORD)ms);
-#else
-      usleep(ms * 1000);
-#endif
-    }
+    restart ();
+    ulapi_sleep_until (start_ + (ms / 1000.0));
+    stop ();
   };
 
 private:
-  //! @brief High resolution timer start time
+  //! @brief Time (ulapi_time, s) the timer was started
+  //!
+  double start_;
+
+  //! @brief Whether the timer is currently running
   //!
-  LARGE_INTEGER hRstart_;
+  bool running_;
+}; // class timer
 
-  //! @brief High resolution timer sample time
+
+//! @brief Periodic wake-up for fixed-rate loops.  Deadlines are absolute (see
+//!        ulapi_periodic_new), so a loop paced by wait() keeps its rate however long each pass
+//!        takes, and passes that overrun are counted rather than silently stretching the period.
+//!
+//! @code
+//!   crpi_periodic cycle (0.004);
+//!   while (running)
+//!   {
+//!     step ();
+//!     cycle.wait ();
+//!   }
+//! @endcode
+//!
+class crpi_periodic
+{
+public:
+  //! @brief Default constructor
   //!
-  LARGE_INTEGER hRsample_;
+  //! @param period Seconds between deadlines
+  //!
+  crpi_periodic (double period) :
+    timer_(ulapi_periodic_new(period))
+  {
+  };
 
-  //! @brief High resolution system timer frequency
+  //! @brief Default destructor
   //!
-  LARGE_INTEGER frequency_;
+  ~crpi_periodic ()
+  {
+    if (timer_ != NULL)
+    {
+      ulapi_periodic_delete (timer_);
+    }
+  };
 
-  //! @brief Low resolution timer start time
+  //! @brief Sleep until the next deadline
   //!
-  long lRstart_;
+  //! @return 0 if the deadline was met, otherwise the number of deadlines overrun (and skipped)
+  //!
+  inline int wait ()
+  {
+    return (timer_ == NULL) ? 0 : (int)ulapi_periodic_wait (timer_);
+  };
 
-  //! @brief Low resolution timer sample time
+  //! @brief Restart the deadlines from now, optionally with a new period (s), and clear the
+  //!        statistics
   //!
-  long lRsample_;
+  inline void reset (double period = 0.0)
+  {
+    ulapi_periodic_reset (timer_, period);
+  };
 
-  //! @brief High resolution time sample difference variable
+  //! @brief Deadlines overrun since the timer was made or reset
   //!
-  LONGLONG timeDiff_;
+  inline long overruns () const
+  {
+    return (long)ulapi_periodic_overruns (timer_);
+  };
 
-  //! @brief Whether the timer is currently running
+  //! @brief Longest a wait has returned after its deadline (s)
   //!
-  bool running_;
+  inline double worst () const
+  {
+    return ulapi_periodic_worst (timer_);
+  };
+
+private:
+  crpi_periodic (const crpi_periodic &);
+  crpi_periodic &operator= (const crpi_periodic &);
 
-  //! @brief Whether the system is capable of handling high
-  //!        resolution clock sampling
+  //! @brief ulapi periodic timer
   //!
-  bool highRes_;
-}; // class timer
+  void *timer_;
+}; // class crpi_periodic
 
 #endif  // CRPI_H_
@@ -13,65 +13,395 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "crpi_abb.h"
+#include "crpi_alloc.h"
+#include "crpi_hub.h"
+#include "crpi_log.h"
+#include "crpi_native.h"
+#include "crpi_trace.h"
 #if defined (_MSC_VER)
 #include "..\Math\MatrixMath.h"
 #elif defined(__GNUC__)
 #include "../Math/MatrixMath.h"
 #endif
+#include <algorithm>
 
 using namespace std;
 
-//#define ABB_NOISY
 
 namespace crpi_robot
 {
+  //! @brief Read a little-endian 32-bit value from a state record
+  //!
+  static unsigned long abbUnpackU32 (const char *bytes)
+  {
+    const unsigned char *b = (const unsigned char*)bytes;
+    return ((unsigned long)b[0]) | ((unsigned long)b[1] << 8) |
+           ((unsigned long)b[2] << 16) | ((unsigned long)b[3] << 24);
+  }
+
+
+  //! @brief Read a little-endian IEEE single-precision value (RAPID Float4) from a state record
+  //!
+  static double abbUnpackF32 (const char *bytes)
+  {
+    unsigned int u = (unsigned int)abbUnpackU32(bytes);
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return (double)f;
+  }
+
+
+  //! @brief Receive the binary state records sent by CRPI_StateServer_*.mod (see
+  //!        ABB_STATE_RECORD for the layout)
+  //!
+  //! @param param Pointer to the abbStateStream to populate
+  //!
+  void stateABB (void *param)
+  {
+    abbStateStream *as = (abbStateStream*)param;
+    abbStateRecord record;
+    const char *b;
+    int get, i, used;
+    double arrived;
+    bool connected = false, sequenced = false;
+    unsigned long last = 0;
+
+    while (as->runThread)
+    {
+      if (as->client < 0)
+      {
+        as->client = ulapi_socket_get_client_id(as->port, as->addr);
+        as->held = 0;
+        if (as->client < 0)
+        {
+          //! State server not running yet
+#ifdef WIN32
+          Sleep (100);
+#else
+          usleep (100000);
+#endif
+          continue;
+        }
+        if (connected)
+        {
+          as->reconnectMetric->Inc();
+        }
+        connected = true;
+        //! The state server restarts its sequence on a new connection
+        sequenced = false;
+        ulapi_socket_set_blocking(as->client);
+        ulapi_socket_set_timestamps(as->client, ULAPI_STAMP_KERNEL);
+      }
+
+      get = ulapi_socket_read_stamped(as->client, as->buffer + as->held, (int)sizeof(as->buffer) - as->held, &arrived);
+      if (get <= 0)
+      {
+        ulapi_socket_close(as->client);
+        as->client = -1;
+        continue;
+      }
+      as->held += get;
+
+      used = 0;
+      while ((as->held - used) >= ABB_STATE_RECORD)
+      {
+        b = as->buffer + used;
+        if (abbUnpackU32(b) != ABB_STATE_MAGIC)
+        {
+          //! Out of step with the record boundaries; slide forward to the next marker
+          ++used;
+          continue;
+        }
+
+        record.sequence = abbUnpackU32(b + 4);
+        record.time = abbUnpackU32(b + 8);
+        for (i = 0; i < 7; ++i)
+        {
+          record.pose[i] = abbUnpackF32(b + 12 + (4 * i));
+          record.axes[i] = abbUnpackF32(b + 40 + (4 * i));
+          record.torques[i] = abbUnpackF32(b + 68 + (4 * i));
+        }
+        record.dio = abbUnpackU32(b + 96);
+        record.valid = STATE_POSE | STATE_AXES | STATE_TORQUES | STATE_IO;
+        record.timestamp = arrived;
+        as->record.write(record);
+        CrpiRecorder::Record(as->recordChannel, RECORD_FEEDBACK, arrived, &record, sizeof(record));
+        used += ABB_STATE_RECORD;
+
+        if (sequenced && record.sequence > last + 1)
+        {
+          as->droppedMetric->Inc(record.sequence - last - 1);
+        }
+        last = record.sequence;
+        sequenced = true;
+        as->framesMetric->Inc();
+        as->rateMetric.Tick(arrived);
+      }
+
+      if (used > 0)
+      {
+        as->held -= used;
+        memmove(as->buffer, as->buffer + used, as->held);
+      }
+    }
+    return;
+  }
+
+
+  //! @brief Serve the Externally Guided Motion UDP channel:  every EgmRobot message from the
+  //!        controller updates the streamed feedback and is answered with an EgmSensor correction
+  //!        toward the latest setpoint (or the measured position if there is none)
+  //!
+  //! @param param Pointer to the abbEgmChannel to serve
+  //!
+  void egmABB (void *param)
+  {
+    abbEgmChannel *eg = (abbEgmChannel*)param;
+    static const int robotJoint[6] = {0, 1, 3, 4, 5, 6};
+    char in[EGM_BATCH][EGM_MAX_MESSAGE], out[EGM_MAX_MESSAGE];
+    ulapi_datagram msgs[EGM_BATCH];
+    egmRobotFeedback fb;
+    abbStateRecord record;
+    ulapi_integer ready, addr, port;
+    double pose[7], joints[6], external[1];
+    unsigned long tm;
+    int length, mode, i, count;
+    bool hold;
+
+    for (i = 0; i < EGM_BATCH; ++i)
+    {
+      msgs[i].buf = in[i];
+      msgs[i].size = EGM_MAX_MESSAGE;
+    }
+
+    while (eg->runThread)
+    {
+      //! Time out periodically so that the thread notices shutdown
+      if (ulapi_socket_poll(&eg->socket, &ready, 1, 0.1) <= 0)
+      {
+        continue;
+      }
+
+      //! If the thread fell behind, only the newest feedback is answered:  the controller
+      //! wants a setpoint for its latest cycle, not one per stale message
+      count = (int)ulapi_socket_read_batch(eg->socket, msgs, EGM_BATCH);
+      if (count > 1)
+      {
+        eg->droppedMetric->Inc(count - 1);
+      }
+      while (--count >= 0 && !egm_decode_robot(msgs[count].buf, (int)msgs[count].len, fb))
+      {
+        if (count == 0)
+        {
+          //! Nothing in the batch could be decoded, so the newest message was lost as well
+          eg->droppedMetric->Inc();
+        }
+      }
+      if (count < 0)
+      {
+        continue;
+      }
+      addr = msgs[count].address;
+      port = msgs[count].port;
+
+      memset(&record, 0, sizeof(record));
+      record.sequence = fb.seqno;
+      record.time = fb.tm;
+      if (fb.hasPose)
+      {
+        for (i = 0; i < 3; ++i)
+        {
+          record.pose[i] = fb.pos[i];
+        }
+        for (i = 0; i < 4; ++i)
+        {
+          record.pose[i + 3] = fb.orient[i];
+        }
+        record.valid |= STATE_POSE;
+      }
+      if (fb.numJoints >= 6)
+      {
+        for (i = 0; i < 6; ++i)
+        {
+          record.axes[robotJoint[i]] = fb.joints[i];
+        }
+        record.axes[2] = ((fb.numExternal > 0) ? fb.external[0] : 0.0);
+        record.valid |= STATE_AXES;
+      }
+      record.timestamp = msgs[count].stamp;
+      eg->record.write(record);
+      CrpiRecorder::Record(eg->recordChannel, RECORD_FEEDBACK, record.timestamp, &record, sizeof(record));
+      eg->framesMetric->Inc();
+      eg->rateMetric.Tick(record.timestamp);
+
+      ulapi_fastlock_take(eg->handle);
+      mode = eg->mode;
+      hold = !eg->hasSetpoint;
+      memcpy(pose, (hold ? record.pose : eg->pose), sizeof(pose));
+      for (i = 0; i < 6; ++i)
+      {
+        joints[i] = (hold ? record.axes : eg->joints)[robotJoint[i]];
+      }
+      external[0] = (hold ? record.axes : eg->joints)[2];
+      ulapi_fastlock_give(eg->handle);
+
+      //! EgmHeader.tm is a 32-bit millisecond clock
+      tm = (unsigned long)(((unsigned long long)(ulapi_time() * 1000.0)) & 0xFFFFFFFFULL);
+      if (mode == 2 || !fb.hasPose)
+      {
+        length = egm_encode_sensor(out, EGM_MAX_MESSAGE, ++eg->seqno, tm,
+                                   NULL, NULL, joints, 6, external, (fb.numExternal > 0) ? 1 : 0);
+      }
+      else
+      {
+        length = egm_encode_sensor(out, EGM_MAX_MESSAGE, ++eg->seqno, tm,
+                                   pose, pose + 3, NULL, 0, NULL, 0);
+      }
+      if (length > 0)
+      {
+        ulapi_socket_write_to(eg->socket, addr, port, out, length);
+      }
+    }
+    return;
+  }
+
+
+  //! @brief Keep-alive, run every ABB_KEEPALIVE seconds by the SensorHub
+  //!
   void livemanABB (void *param)
   {
     keepalive *ka = (keepalive*)param;
     robotPose pose;
-    crpi_timer timer;
 
-    while (ka->runThread)
+    if (ka->runThread)
     {
       ((CrpiAbb*)ka->rob)->GetRobotPose (&pose);
-
-      //! Don't slam your processor!  You don't need to poll at full speed.
-      timer.waitUntil(5000);
     }
     return;
   }
 
 
-  LIBRARY_API CrpiAbb::CrpiAbb (CrpiRobotParams &params)
+  LIBRARY_API CrpiAbb::CrpiAbb (CrpiRobotParams &params) :
+    poseRates_(6),
+    axisRates_(CRPI_AXES_MAX)
   {
     mssgBuffer_ = new char[8192];
 
     params_ = params;
-    ka_.handle = ulapi_mutex_new(99);
+    ka_.handle = NULL;
+    ka_.lock = ulapi_fastlock_new();
+    ulapi_lock_name(ka_.lock, "CrpiAbb state");
+
+    useStateStream_ = (strcmp(params_.feedback_protocol, "STREAM") == 0);
+    useEGM_ = (strcmp(params_.feedback_protocol, "EGM") == 0);
+    streamAxes_ = false;
+    egm_.runThread = false;
+    egm_.mode = 0;
+    egm_.hasSetpoint = false;
+    egm_.seqno = 0;
+    egmTask_ = NULL;
+    stream_.runThread = false;
+    stream_.client = -1;
+    stream_.held = 0;
+    stateTask_ = NULL;
+    firstIO_ = true;
+
+    string labels = CrpiMetrics::Label("driver", "abb") + "," + CrpiMetrics::Label("robot", params_.tcp_ip_addr);
+    stream_.framesMetric = egm_.framesMetric = CrpiMetrics::Counter("crpi_feedback_frames", "Feedback frames published",
+                                                                    labels);
+    stream_.droppedMetric = egm_.droppedMetric = CrpiMetrics::Counter("crpi_feedback_dropped", "Feedback frames dropped",
+                                                                      labels);
+    stream_.rateMetric.gauge = egm_.rateMetric.gauge = CrpiMetrics::Gauge("crpi_feedback_rate_hz",
+                                                                          "Feedback frames published per second", labels);
+    stream_.reconnectMetric = CrpiMetrics::Counter("crpi_reconnects", "Connections re-established",
+                                                   labels + ",link=\"feedback\"");
+    stream_.recordChannel = CrpiRecorder::Channel(string("abb/") + params_.tcp_ip_addr + "/state");
+    egm_.recordChannel = CrpiRecorder::Channel(string("abb/") + params_.tcp_ip_addr + "/egm");
 
     //! Connect to ABB IRB 14000 server
     server_ = ulapi_socket_get_client_id (params_.tcp_ip_port, params_.tcp_ip_addr);
     ulapi_socket_set_blocking(server_);
 
-    task = ulapi_task_new();
     ka_.rob = this;
     ka_.runThread = true;
+    keepalive_ = SensorHub::Instance().AddPeriodic(livemanABB, &ka_, ABB_KEEPALIVE, HUB_MONITOR);
 
-    ulapi_task_start((ulapi_task_struct*)task, livemanABB, &ka_, ulapi_prio_lowest(), 0);
+    if (useStateStream_)
+    {
+      strcpy(stream_.addr, params_.tcp_ip_addr);
+      stream_.port = params_.tcp_ip_port + ABB_STATE_PORT_OFFSET;
+      stream_.runThread = true;
+      stateTask_ = ulapi_task_new();
+      SensorHub::Instance().StartTask((ulapi_task_struct*)stateTask_, stateABB, &stream_, HUB_BACKGROUND,
+                                      &params_.servo_task);
+    }
+
+    if (useEGM_)
+    {
+      //! The controller sends to this port once EGM is set up (see BeginStream)
+      egm_.socket = ulapi_socket_get_broadcastee_id(params_.tcp_ip_port + ABB_EGM_PORT_OFFSET);
+      if (egm_.socket >= 0)
+      {
+        ulapi_socket_set_timestamps(egm_.socket, ULAPI_STAMP_KERNEL);
+        egm_.handle = ulapi_fastlock_new();
+        ulapi_lock_name(egm_.handle, "CrpiAbb EGM");
+        egm_.runThread = true;
+        egmTask_ = ulapi_task_new();
+        SensorHub::Instance().StartTask((ulapi_task_struct*)egmTask_, egmABB, &egm_, HUB_REALTIME,
+                                        &params_.servo_task);
+      }
+    }
 
-    feedback_ = new double[10];
-    tempData_ = new vector<string>(10, " ");
+    //! Room for a full feedback field, so that parsing does not allocate
+    tempData_.assign(10, string());
+    for (size_t i = 0; i < tempData_.size(); ++i)
+    {
+      tempData_[i].reserve(32);
+    }
 
     angleUnits_ = DEGREE;
     lengthUnits_ = MM;
+    rateLength_ = lengthUnits_;
+    rateAngle_ = angleUnits_;
+    poseRates_.Wrap(3, 3, 360.0);
     curTool_ = 1; //! Set default to parallel gripper
+
+    streaming_ = false;
+    streamPeriod_ = 0.004;
+    streamLookahead_ = 0.0;
+    streamDeadline_ = 0.5;
   }
 
 
   LIBRARY_API CrpiAbb::~CrpiAbb ()
   {
+    //! Waits out a keep-alive in progress, so the socket can be closed below
+    ka_.runThread = false;
+    SensorHub::Instance().RemovePeriodic(keepalive_);
+
+    if (stateTask_ != NULL)
+    {
+      //! The receive thread may be blocked waiting for the controller
+      stream_.runThread = false;
+      ulapi_task_stop((ulapi_task_struct*)stateTask_);
+      ulapi_task_join((ulapi_task_struct*)stateTask_, NULL);
+      ulapi_task_delete((ulapi_task_struct*)stateTask_);
+      if (stream_.client >= 0)
+      {
+        ulapi_socket_close(stream_.client);
+      }
+    }
+
+    if (egmTask_ != NULL)
+    {
+      egm_.runThread = false;
+      ulapi_task_join((ulapi_task_struct*)egmTask_, NULL);
+      ulapi_task_delete((ulapi_task_struct*)egmTask_);
+      ulapi_socket_close(egm_.socket);
+      ulapi_fastlock_delete(egm_.handle);
+    }
+
     delete [] mssgBuffer_;
-    delete [] feedback_;
     ulapi_socket_close(server_);
   }
 
@@ -79,7 +409,7 @@ namespace crpi_robot
   LIBRARY_API CanonReturn CrpiAbb::SetTool (double percent)
   {
     bool status = false;
-    ulapi_mutex_take(ka_.handle);
+    ulapi_fastlock_take(ka_.lock);
     if (curTool_ == 1)
     {
       status = generateTool ('A', percent);
@@ -99,17 +429,17 @@ namespace crpi_robot
       if (!send ())
       {
         //! error sending
-        ulapi_mutex_give(ka_.handle);
+        ulapi_fastlock_give(ka_.lock);
         return CANON_FAILURE;
       }
       //! Wait for response from robot
       if (!get ())
       {
         //! error getting
-        ulapi_mutex_give(ka_.handle);
+        ulapi_fastlock_give(ka_.lock);
         return CANON_FAILURE;
       }
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
       if (mssgBuffer_[0] == '1')
       {
         return CANON_SUCCESS;
@@ -122,12 +452,12 @@ namespace crpi_robot
     else
     {
       //! Error generating tool actuation message
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
       return CANON_FAILURE;
     }
   }
 
-  LIBRARY_API CanonReturn CrpiAbb::ApplyCartesianForceTorque (robotPose &robotForceTorque, vector<bool> activeAxes, vector<bool> manipulator)
+  LIBRARY_API CanonReturn CrpiAbb::ApplyCartesianForceTorque (robotPose &robotForceTorque, const vector<bool> &activeAxes, const vector<bool> &manipulator)
   {
     return CANON_SUCCESS;
   }
@@ -139,19 +469,12 @@ namespace crpi_robot
 
   LIBRARY_API CanonReturn CrpiAbb::Couple (const char *targetID)
   {
-    std::vector<CrpiToolDef>::const_iterator itr;
-    for (itr = params_.tools.begin(); itr != params_.tools.end(); ++itr)
-    {
-      if (strcmp(targetID, itr->toolName.c_str()) == 0)
-      {
-        curTool_ = itr->toolID;
-        break;
-      }
-    }
-    if (itr == params_.tools.end())
+    int tool = params_.findTool(targetID);
+    if (tool == CRPI_NO_HANDLE)
     {
       return CANON_FAILURE;
     }
+    curTool_ = params_.tools[tool].toolID;
     return CANON_SUCCESS;
   }
 
@@ -192,7 +515,7 @@ namespace crpi_robot
     target.push_back (q.at(2));
     target.push_back (q.at(3));
 
-    ulapi_mutex_take(ka_.handle);
+    ulapi_fastlock_take(ka_.lock);
     //! LIN, Cartesian, Absolute
     if (generateMove ('L', 'C', 'A', target))
     {
@@ -200,18 +523,18 @@ namespace crpi_robot
       if (!send ())
       {
         //! error sending
-        printf("failed send\n");
-        ulapi_mutex_give(ka_.handle);
+        CRPI_LOG(CRPI_LOG_WARNING, "CrpiAbb:  failed send");
+        ulapi_fastlock_give(ka_.lock);
         return CANON_FAILURE;
       }
       //! Wait for response from robot
       if (!get ())
       {
-        printf("failed get\n");
-        ulapi_mutex_give(ka_.handle);
+        CRPI_LOG(CRPI_LOG_WARNING, "CrpiAbb:  failed get");
+        ulapi_fastlock_give(ka_.lock);
         return CANON_FAILURE;
       }
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
 //      printf("%s\n", mssgBuffer_);
       if (mssgBuffer_[1] == '1')
       {
@@ -219,15 +542,15 @@ namespace crpi_robot
       }
       else
       {
-        printf("bad motion?\n");
+        CRPI_LOG(CRPI_LOG_WARNING, "CrpiAbb:  motion rejected");
         return CANON_FAILURE;
       }
     }
     else
     {
       //! Error generating motion message
-      printf("bad message\n");
-      ulapi_mutex_give(ka_.handle);
+      CRPI_LOG(CRPI_LOG_WARNING, "CrpiAbb:  bad message");
+      ulapi_fastlock_give(ka_.lock);
       return CANON_FAILURE;
     }
   }
@@ -239,24 +562,89 @@ namespace crpi_robot
                                                    robotPose *speeds,
                                                    robotPose *tolerances)
   {
-    bool status = true;
+    if (poses == NULL || numPoses < 1)
+    {
+      return CANON_REJECT;
+    }
 
-    //! This is a temporary function definition until the KRL code has been updated to properly handle
-    //! this method
-    for (int x = 0; x < numPoses; ++x)
+    vector<double> radii(numPoses), param(7, 0.0f);
+    crpi_blend_radii (poses, numPoses, tolerances, CRPI_DEFAULT_BLEND_MM, &radii[0]);
+
+    //! 0 keeps the commanded speed and leaves the acceleration unlimited
+    double last[3] = {-1.0f, -1.0f, -1.0f};
+    int start;
+
+    ulapi_fastlock_take(ka_.lock);
+    for (start = 0; start < numPoses; start += ABB_PATH_MAX)
     {
-      status &= (MoveTo (poses[x], true) == CANON_SUCCESS);
-      if (!status)
+      int end = ((start + ABB_PATH_MAX < numPoses) ? (start + ABB_PATH_MAX) : numPoses);
+
+      //! Blended path, execute.  The controller responds once the last waypoint is reached.
+      param.assign (7, 0.0f);
+      if (!queuePath (poses, start, end, accelerations, speeds, &radii[0], last) ||
+          !generateMove ('T', 'E', 'A', param) || !exchange ())
       {
-        //! Error when executing multi move
+        ulapi_fastlock_give(ka_.lock);
         return CANON_FAILURE;
       }
     }
+    ulapi_fastlock_give(ka_.lock);
 
     return CANON_SUCCESS;
   }
 
 
+  CanonReturn CrpiAbb::moveSynchronized (crpiSyncJob &job)
+  {
+    CrpiAbb *arm[2] = {(CrpiAbb*)job.arms[0], (CrpiAbb*)job.arms[1]};
+    vector<double> radii[2], param(7, 0.0f);
+    double last[2][3] = {{-1.0f, -1.0f, -1.0f}, {-1.0f, -1.0f, -1.0f}};
+    bool okay = true;
+    int start, side;
+
+    if (arm[0] == arm[1] || job.numPoses < 1 || job.poses[0] == NULL || job.poses[1] == NULL)
+    {
+      return CANON_REJECT;
+    }
+    for (side = 0; side < 2; ++side)
+    {
+      radii[side].resize (job.numPoses);
+      crpi_blend_radii (job.poses[side], job.numPoses, job.tolerances[side], CRPI_DEFAULT_BLEND_MM, &radii[side][0]);
+    }
+
+    //! Always the left arm's lock first, so that two jobs cannot deadlock
+    ulapi_fastlock_take(arm[0]->ka_.lock);
+    ulapi_fastlock_take(arm[1]->ka_.lock);
+    for (start = 0; okay && start < job.numPoses; start += ABB_PATH_MAX)
+    {
+      //! Both arms stop at the end of the same batch
+      int end = ((start + ABB_PATH_MAX < job.numPoses) ? (start + ABB_PATH_MAX) : job.numPoses);
+
+      for (side = 0; okay && side < 2; ++side)
+      {
+        okay = arm[side]->queuePath (job.poses[side], start, end, NULL, job.speeds[side], &radii[side][0], last[side]);
+      }
+
+      //! Synchronized blended path, execute.  Neither controller task responds until both arms
+      //! have reached their last waypoint, so both are started before either response is read;
+      //! SyncMoveOn then starts the arms together, whichever command arrived first.
+      param.assign (7, 0.0f);
+      for (side = 0; okay && side < 2; ++side)
+      {
+        okay = (arm[side]->generateMove ('T', 'Y', 'A', param) && arm[side]->send ());
+      }
+      for (side = 0; okay && side < 2; ++side)
+      {
+        okay = (arm[side]->get () && arm[side]->mssgBuffer_[1] == '1');
+      }
+    }
+    ulapi_fastlock_give(arm[1]->ka_.lock);
+    ulapi_fastlock_give(arm[0]->ka_.lock);
+
+    return (okay ? CANON_SUCCESS : CANON_FAILURE);
+  }
+
+
   LIBRARY_API CanonReturn CrpiAbb::MoveTo (robotPose &pose, bool useBlocking)
   {
     //! Construct message
@@ -288,25 +676,25 @@ namespace crpi_robot
 
     //! PTP, Cartesian, Absolute
     //if (generateMove ('P', 'C', 'R', target)) //! JAM:  for initial testing purposes only
-    ulapi_mutex_take(ka_.handle);
+    ulapi_fastlock_take(ka_.lock);
     if (generateMove ('P', 'C', 'A', target))
     {
       //! Send message to robot
       if (!send())
       {
         //! error sending
-        printf("failed send\n");
-        ulapi_mutex_give(ka_.handle);
+        CRPI_LOG(CRPI_LOG_WARNING, "CrpiAbb:  failed send");
+        ulapi_fastlock_give(ka_.lock);
         return CANON_FAILURE;
       }
       //! Wait for response from robot
       if (!get ())
       {
-        printf("failed get\n");
-        ulapi_mutex_give(ka_.handle);
+        CRPI_LOG(CRPI_LOG_WARNING, "CrpiAbb:  failed get");
+        ulapi_fastlock_give(ka_.lock);
         return CANON_FAILURE;
       }
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
       if (mssgBuffer_[1] == '1')
       {
         //printf("got message\n");
@@ -321,8 +709,8 @@ namespace crpi_robot
     else
     {
       //! Error generating motion message
-      printf("bad message\n");
-      ulapi_mutex_give(ka_.handle);
+      CRPI_LOG(CRPI_LOG_WARNING, "CrpiAbb:  bad message");
+      ulapi_fastlock_give(ka_.lock);
       return CANON_FAILURE;
     }
   }
@@ -332,32 +720,10 @@ namespace crpi_robot
   {
     //! Construct request for axis information
 
-    ulapi_mutex_take(ka_.handle);
-    if (generateFeedback ('A'))
+    ulapi_fastlock_take(ka_.lock);
+    if (readFeedback ('A', 8))
     {
-      if (!send ())
-      {
-        //! error sending
-        ulapi_mutex_give(ka_.handle);
-        return CANON_FAILURE;
-      }
-      //! Wait for response from robot
-      if (!get ())
-      {
-        //! error receiving
-        ulapi_mutex_give(ka_.handle);
-        return CANON_FAILURE;
-      }
-      
-      //! Parse data
-      if (!parseFeedback (8))
-      {
-        //! Error parsing data
-        ulapi_mutex_give(ka_.handle);
-        return CANON_FAILURE;
-      }
-
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
       try
       {
         for (int i = 0; i < 7; ++i)
@@ -370,13 +736,17 @@ namespace crpi_robot
         //! probably an axis violation due to vector missmatch
         return CANON_FAILURE;
       }
-    } // if generateFeedback ('A')
+    } // if readFeedback
     else
     {
-      //! Error generating feedback request message
-      ulapi_mutex_give(ka_.handle);
+      //! Error requesting or parsing feedback
+      ulapi_fastlock_give(ka_.lock);
       return CANON_FAILURE;
     }
+    ulapi_fastlock_take(ka_.lock);
+    latest_.setAxes(*axes);
+    publishState(STATE_AXES);
+    ulapi_fastlock_give(ka_.lock);
     return CANON_SUCCESS;
   }
 
@@ -391,30 +761,10 @@ namespace crpi_robot
   LIBRARY_API CanonReturn CrpiAbb::GetRobotIO (robotIO *io)
   {
     //! Construct request for axis information
-    ulapi_mutex_take(ka_.handle);
-    if (generateFeedback('S'))
+    ulapi_fastlock_take(ka_.lock);
+    if (readFeedback ('S', 8))
     {
-      if (!send())
-      {
-        //! error sending
-        ulapi_mutex_give(ka_.handle);
-        return CANON_FAILURE;
-      }
-      //! Wait for response from robot
-      if (!get())
-      {
-        //! error receiving
-        ulapi_mutex_give(ka_.handle);
-        return CANON_FAILURE;
-      }
-      //! Parse data
-      if (!parseFeedback(8))
-      {
-        //! Error parsing data
-        ulapi_mutex_give(ka_.handle);
-        return CANON_FAILURE;
-      }
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
 
       try
       {
@@ -434,11 +784,15 @@ namespace crpi_robot
     }
     else
     {
-      //! Error generating feedback request message
-      ulapi_mutex_give(ka_.handle);
+      //! Error requesting or parsing feedback
+      ulapi_fastlock_give(ka_.lock);
       return CANON_FAILURE;
     }
 
+    ulapi_fastlock_take(ka_.lock);
+    latest_.setIO(*io);
+    publishState(STATE_IO);
+    ulapi_fastlock_give(ka_.lock);
     return CANON_SUCCESS;
   }
 
@@ -447,30 +801,10 @@ namespace crpi_robot
   {
     double qx, qy, qz, qw;
     //! Construct request for axis information
-    ulapi_mutex_take(ka_.handle);
-    if (generateFeedback ('C'))
+    ulapi_fastlock_take(ka_.lock);
+    if (readFeedback ('C', 8))
     {
-      if (!send ())
-      {
-        //! error sending
-        ulapi_mutex_give(ka_.handle);
-        return CANON_FAILURE;
-      }
-      //! Wait for response from robot
-      if (!get ())
-      {
-        //! error receiving
-        ulapi_mutex_give(ka_.handle);
-        return CANON_FAILURE;
-      }
-      //! Parse data
-      if (!parseFeedback (8))
-      {
-        //! Error parsing data
-        ulapi_mutex_give(ka_.handle);
-        return CANON_FAILURE;
-      }
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
 
       try
       {
@@ -527,26 +861,47 @@ namespace crpi_robot
     }
     else
     {
-      //! Error generating feedback request message
-      ulapi_mutex_give(ka_.handle);
+      //! Error requesting or parsing feedback
+      ulapi_fastlock_give(ka_.lock);
       return CANON_FAILURE;
     }
 
+    ulapi_fastlock_take(ka_.lock);
+    latest_.pose = *pose;
+    publishState(STATE_POSE);
+    ulapi_fastlock_give(ka_.lock);
     return CANON_SUCCESS;
   }
 
 
   LIBRARY_API CanonReturn CrpiAbb::GetRobotSpeed (robotPose *speed)
   {
-    //! TODO
-    return CANON_FAILURE;
+    RobotStateSnapshot state;
+
+    //! Estimated from the poses read so far (by the application or the keep-alive thread)
+    if (state_.read(state) == 0 || (state.valid & STATE_SPEEDS) == 0)
+    {
+      return CANON_FAILURE;
+    }
+    *speed = state.speeds;
+    return CANON_SUCCESS;
   }
 
 
   LIBRARY_API CanonReturn CrpiAbb::GetRobotSpeed (robotAxes *speed)
   {
-    //! TODO
-    return CANON_FAILURE;
+    CrpiMotionRates rates;
+
+    ratesPub_.read(rates);
+    if (rates.axes == 0)
+    {
+      return CANON_FAILURE;
+    }
+    for (int i = 0; i < rates.axes && i < speed->axes; ++i)
+    {
+      speed->axis[i] = rates.axisSpeed[i];
+    }
+    return CANON_SUCCESS;
   }
 
 
@@ -554,32 +909,10 @@ namespace crpi_robot
   {
     //! Construct request for axis torque information
 
-    ulapi_mutex_take(ka_.handle);
-    if (generateFeedback('T'))
+    ulapi_fastlock_take(ka_.lock);
+    if (readFeedback ('T', 8))
     {
-      if (!send())
-      {
-        //! error sending
-        ulapi_mutex_give(ka_.handle);
-        return CANON_FAILURE;
-      }
-      //! Wait for response from robot
-      if (!get())
-      {
-        //! error receiving
-        ulapi_mutex_give(ka_.handle);
-        return CANON_FAILURE;
-      }
-
-      //! Parse data
-      if (!parseFeedback(8))
-      {
-        //! Error parsing data
-        ulapi_mutex_give(ka_.handle);
-        return CANON_FAILURE;
-      }
-
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
       try
       {
         for (int i = 0; i < 7; ++i)
@@ -596,17 +929,134 @@ namespace crpi_robot
         //! probably an axis violation due to vector missmatch
         return CANON_FAILURE;
       }
-    } // if generateFeedback ('A')
+    } // if readFeedback
     else
     {
-      //! Error generating feedback request message
-      ulapi_mutex_give(ka_.handle);
+      //! Error requesting or parsing feedback
+      ulapi_fastlock_give(ka_.lock);
       return CANON_FAILURE;
     }
+    ulapi_fastlock_take(ka_.lock);
+    for (int i = 0; i < torques->axes && i < CRPI_AXES_MAX; ++i)
+    {
+      latest_.torque[i] = torques->axis[i];
+    }
+    publishState(STATE_TORQUES);
+    ulapi_fastlock_give(ka_.lock);
     return CANON_SUCCESS;
   }
 
 
+  LIBRARY_API CanonReturn CrpiAbb::GetRobotState (RobotStateSnapshot *state)
+  {
+    if (useStateStream_)
+    {
+      //! Refresh every field from the streamed record; no controller round trips are needed
+      robotPose pose;
+      robotAxes axes(7), torques(7);
+      robotIO io;
+      GetRobotPose(&pose);
+      GetRobotAxes(&axes);
+      GetRobotTorques(&torques);
+      GetRobotIO(&io);
+    }
+
+    //! Holds whatever the most recent Get* calls (including the keep-alive thread's) returned
+    if (state_.read(*state) == 0)
+    {
+      return CANON_REJECT;
+    }
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiAbb::GetPredictedState (RobotStateSnapshot *state, double lead)
+  {
+    CrpiMotionRates rates;
+    int i;
+
+    //! The rates are published just before their state, so a state newer than the rates read
+    //! first was published in between; read both again
+    for (i = 0; i < 3; ++i)
+    {
+      ratesPub_.read(rates);
+      if (state_.read(*state) == 0)
+      {
+        return CANON_REJECT;
+      }
+      if (rates.sequence == state->sequence)
+      {
+        break;
+      }
+    }
+
+    return crpi_predict_state(*state, rates, ulapi_time() + lead) ? CANON_SUCCESS : CANON_REJECT;
+  }
+
+
+  void CrpiAbb::publishState (unsigned int field)
+  {
+    double values[6], accel[6];
+
+    latest_.valid |= field;
+    latest_.timestamp = ulapi_time();
+    ++latest_.sequence;
+
+    //! Samples taken in other units cannot be fitted together
+    if (lengthUnits_ != rateLength_ || angleUnits_ != rateAngle_)
+    {
+      poseRates_.Reset();
+      axisRates_.Reset();
+      poseRates_.Wrap(3, 3, (angleUnits_ == DEGREE) ? 360.0 : (2.0 * 3.141592654));
+      rateLength_ = lengthUnits_;
+      rateAngle_ = angleUnits_;
+      latest_.valid &= ~STATE_SPEEDS;
+      rates_.axes = 0;
+    }
+
+    if (field == STATE_POSE)
+    {
+      values[0] = latest_.pose.x;
+      values[1] = latest_.pose.y;
+      values[2] = latest_.pose.z;
+      values[3] = latest_.pose.xrot;
+      values[4] = latest_.pose.yrot;
+      values[5] = latest_.pose.zrot;
+      poseRates_.Add(latest_.timestamp, values);
+      if (poseRates_.Estimate(values, accel))
+      {
+        latest_.speeds.x = values[0];
+        latest_.speeds.y = values[1];
+        latest_.speeds.z = values[2];
+        latest_.speeds.xrot = values[3];
+        latest_.speeds.yrot = values[4];
+        latest_.speeds.zrot = values[5];
+        latest_.valid |= STATE_SPEEDS;
+        rates_.poseAccel.x = accel[0];
+        rates_.poseAccel.y = accel[1];
+        rates_.poseAccel.z = accel[2];
+        rates_.poseAccel.xrot = accel[3];
+        rates_.poseAccel.yrot = accel[4];
+        rates_.poseAccel.zrot = accel[5];
+        rates_.poseTime = poseRates_.Time();
+      }
+    }
+    else if (field == STATE_AXES)
+    {
+      axisRates_.Add(latest_.timestamp, latest_.axis);
+      if (axisRates_.Estimate(rates_.axisSpeed, rates_.axisAccel))
+      {
+        rates_.axes = latest_.axes;
+        rates_.axisTime = axisRates_.Time();
+      }
+    }
+
+    rates_.sequence = latest_.sequence;
+    ratesPub_.write(rates_);
+    state_.write(latest_);
+  }
+
+
   LIBRARY_API CanonReturn CrpiAbb::MoveAttractor (robotPose &pose)
   {
     //! Not supported
@@ -624,32 +1074,202 @@ namespace crpi_robot
     }
 
     //! PTP, Angular, Absolute
-    ulapi_mutex_take(ka_.handle);
+    ulapi_fastlock_take(ka_.lock);
     if (generateMove ('P', 'A', 'A', target))
     {
       //! Send message to robot
       if (!send())
       {
         //! error sending
-        ulapi_mutex_give(ka_.handle);
+        ulapi_fastlock_give(ka_.lock);
         return CANON_FAILURE;
       }
       //! Wait for response from robot
       if (!get ())
       {
-        ulapi_mutex_give(ka_.handle);
+        ulapi_fastlock_give(ka_.lock);
         return CANON_FAILURE;
       }
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
+    }
+    else
+    {
+      //! Error generating motion message
+      ulapi_fastlock_give(ka_.lock);
+      return CANON_FAILURE;
+    }
+
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiAbb::BeginStream ()
+  {
+    vector<double> target(7, 0.0);
+    CanonReturn val;
+
+    if (streaming_)
+    {
+      return CANON_REJECT;
+    }
+
+    target.at(0) = streamPeriod_;
+    target.at(1) = streamDeadline_;
+    target.at(2) = streamLookahead_;
+
+    if (useEGM_)
+    {
+      if (egmTask_ == NULL)
+      {
+        //! EGM port could not be opened
+        return CANON_FAILURE;
+      }
+      //! Hold the measured position until the first setpoint arrives
+      ulapi_fastlock_take(egm_.handle);
+      egm_.mode = (streamAxes_ ? 2 : 1);
+      egm_.hasSetpoint = false;
+      ulapi_fastlock_give(egm_.handle);
+      target.at(3) = egm_.mode;
+    }
+
+    if ((val = streamCommand('B', target)) == CANON_SUCCESS)
+    {
+      streaming_ = true;
+    }
+    return val;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiAbb::StreamPose (robotPose &pose)
+  {
+    vector<double> target;
+
+    if (!streaming_)
+    {
+      return CANON_REJECT;
+    }
+
+    poseTarget (pose, target);
+
+    if (useEGM_)
+    {
+      if (egm_.mode != 1)
+      {
+        //! Joint stream (see SetParameter "stream_axes")
+        return CANON_REJECT;
+      }
+      //! Sent with the reply to the next EgmRobot message
+      ulapi_fastlock_take(egm_.handle);
+      for (int i = 0; i < 7; ++i)
+      {
+        egm_.pose[i] = target.at(i);
+      }
+      egm_.hasSetpoint = true;
+      ulapi_fastlock_give(egm_.handle);
+      return CANON_SUCCESS;
+    }
+
+    return streamCommand('C', target);
+  }
+
+
+  LIBRARY_API CanonReturn CrpiAbb::StreamAxes (robotAxes &axes)
+  {
+    vector<double> target;
+
+    if (!streaming_)
+    {
+      return CANON_REJECT;
+    }
+
+    for (int i = 0; i < 7; ++i)
+    {
+      target.push_back (axes.axis.at(i));
+    }
+
+    if (useEGM_)
+    {
+      if (egm_.mode != 2)
+      {
+        //! Pose stream (see SetParameter "stream_axes")
+        return CANON_REJECT;
+      }
+      ulapi_fastlock_take(egm_.handle);
+      for (int i = 0; i < 7; ++i)
+      {
+        egm_.joints[i] = target.at(i);
+      }
+      egm_.hasSetpoint = true;
+      ulapi_fastlock_give(egm_.handle);
+      return CANON_SUCCESS;
+    }
+
+    return streamCommand('A', target);
+  }
+
+
+  LIBRARY_API CanonReturn CrpiAbb::EndStream ()
+  {
+    vector<double> target(7, 0.0);
+    CanonReturn val;
+
+    if (!streaming_)
+    {
+      return CANON_REJECT;
+    }
+
+    streaming_ = false;
+    val = streamCommand('E', target);
+
+    if (useEGM_)
+    {
+      ulapi_fastlock_take(egm_.handle);
+      egm_.mode = 0;
+      egm_.hasSetpoint = false;
+      ulapi_fastlock_give(egm_.handle);
+    }
+    return val;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiAbb::BeginWrenchStream ()
+  {
+    //! The CRPI server does not use the IRC5 Force Control option
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiAbb::StreamWrench (robotPose &wrench, const vector<bool> &activeAxes, robotPose &limits)
+  {
+    //! Not supported
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiAbb::EndWrenchStream ()
+  {
+    //! Not supported
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiAbb::streamCommand (char posType, vector<double> &input)
+  {
+    ulapi_fastlock_take(ka_.lock);
+    if (!generateMove ('S', posType, 'A', input) || !send ())
+    {
+      ulapi_fastlock_give(ka_.lock);
+      return CANON_FAILURE;
     }
-    else
+    //! Acknowledgement only; the controller does not wait for the robot to reach the setpoint
+    if (!get ())
     {
-      //! Error generating motion message
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
       return CANON_FAILURE;
     }
+    ulapi_fastlock_give(ka_.lock);
 
-    return CANON_SUCCESS;
+    return ((mssgBuffer_[1] == '1') ? CANON_SUCCESS : CANON_FAILURE);
   }
 
 
@@ -749,8 +1369,60 @@ namespace crpi_robot
 
   LIBRARY_API CanonReturn CrpiAbb::SetParameter (const char *paramName, void *paramVal)
   {
-    //! Not yet implemented
-    return CANON_REJECT;
+    //! Tool definitions from CrpiRobot::ReloadConfig, taken even while streaming
+    if (paramVal != NULL && strcmp(paramName, "tools") == 0)
+    {
+      params_.tools = *((std::vector<CrpiToolDef>*)paramVal);
+      params_.reindex();
+      return CANON_SUCCESS;
+    }
+    if (paramVal == NULL || streaming_)
+    {
+      return CANON_REJECT;
+    }
+
+    if (strcmp(paramName, "native_program") == 0)
+    {
+      crpiNativeProgram *native = (crpiNativeProgram*)paramVal;
+      if (native->run)
+      {
+        CRPI_LOG(CRPI_LOG_ERROR, "CrpiAbb:  native programs can be translated but not uploaded");
+        return CANON_REJECT;
+      }
+      native->completed = 0;
+      return ((native->program != NULL && generateNative (*native)) ? CANON_SUCCESS : CANON_REJECT);
+    }
+    else if (strcmp(paramName, "sync_left") == 0 || strcmp(paramName, "sync_right") == 0)
+    {
+      crpiSyncJob *job = (crpiSyncJob*)paramVal;
+      int side = ((paramName[5] == 'l') ? 0 : 1);
+      job->arms[side] = this;
+      //! The job runs once both arms have joined it
+      return ((job->arms[1 - side] == NULL) ? CANON_SUCCESS : moveSynchronized (*job));
+    }
+    //! Streaming settings take effect on the next BeginStream
+    else if (strcmp(paramName, "stream_period") == 0)
+    {
+      streamPeriod_ = *((double*)paramVal);
+    }
+    else if (strcmp(paramName, "stream_lookahead") == 0)
+    {
+      streamLookahead_ = *((double*)paramVal);
+    }
+    else if (strcmp(paramName, "stream_deadline") == 0)
+    {
+      streamDeadline_ = *((double*)paramVal);
+    }
+    else if (strcmp(paramName, "stream_axes") == 0)
+    {
+      streamAxes_ = *((bool*)paramVal);
+    }
+    else
+    {
+      //! Not yet implemented
+      return CANON_REJECT;
+    }
+    return CANON_SUCCESS;
   }
 
 
@@ -782,18 +1454,18 @@ namespace crpi_robot
     if (!send())
     {
       //! error sending
-      printf("failed send\n");
-      ulapi_mutex_give(ka_.handle);
+      CRPI_LOG(CRPI_LOG_WARNING, "CrpiAbb:  failed send");
+      ulapi_fastlock_give(ka_.lock);
       return CANON_FAILURE;
     }
     //! Wait for response from robot
     if (!get())
     {
-      printf("failed get\n");
-      ulapi_mutex_give(ka_.handle);
+      CRPI_LOG(CRPI_LOG_WARNING, "CrpiAbb:  failed get");
+      ulapi_fastlock_give(ka_.lock);
       return CANON_FAILURE;
     }
-    ulapi_mutex_give(ka_.handle);
+    ulapi_fastlock_give(ka_.lock);
     if (mssgBuffer_[1] == '1')
     {
       //printf("got message\n");
@@ -809,43 +1481,71 @@ namespace crpi_robot
 
   LIBRARY_API CanonReturn CrpiAbb::SetRobotIO (robotIO &io)
   {
+    int mask = 0, bits = 0;
     bool state = true;
+
+    //! Every changed output goes in one message (command 420) and one round trip
     for (int x = 0; x < 7; ++x)
     {
-      state &= (SetRobotDO(x, io.dio[x]) == CANON_SUCCESS);
+      if (firstIO_ || (curIO_.dio[x] != io.dio[x]))
+      {
+        mask |= (1 << x);
+        bits |= (io.dio[x] ? (1 << x) : 0);
+      }
+    }
+    if (mask == 0)
+    {
+      return CANON_SUCCESS;
+    }
+
+    ulapi_fastlock_take(ka_.lock);
+    state = generateIO('B', mask, bits) && send() && get();
+    ulapi_fastlock_give(ka_.lock);
+    if (!state)
+    {
+      return CANON_FAILURE;
     }
 
-    return (state ? CANON_SUCCESS : CANON_FAILURE);
+    for (int x = 0; x < 7; ++x)
+    {
+      curIO_.dio[x] = io.dio[x];
+    }
+    firstIO_ = false;
+    return CANON_SUCCESS;
   }
 
 
   LIBRARY_API CanonReturn CrpiAbb::SetRobotDO (int dig_out, bool val)
   {
     //! Construct digital signal output command
-    ulapi_mutex_take(ka_.handle);
+    ulapi_fastlock_take(ka_.lock);
     if (generateIO('D', dig_out, val))
     {
       //! Send message to robot
       if (!send())
       {
         //! error sending
-        ulapi_mutex_give(ka_.handle);
+        ulapi_fastlock_give(ka_.lock);
         return CANON_FAILURE;
       }
       //! Wait for response from robot
       if (!get())
       {
-        ulapi_mutex_give(ka_.handle);
+        ulapi_fastlock_give(ka_.lock);
         return CANON_FAILURE;
       }
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
     }
     else
     {
-      //! Error generating feedback request message
-      ulapi_mutex_give(ka_.handle);
+      //! Error requesting or parsing feedback
+      ulapi_fastlock_give(ka_.lock);
       return CANON_FAILURE;
     }
+    if (dig_out >= 0 && dig_out < CRPI_IO_MAX)
+    {
+      curIO_.dio[dig_out] = val;
+    }
     return CANON_SUCCESS;
   }
 
@@ -882,6 +1582,7 @@ namespace crpi_robot
 
   LIBRARY_API bool CrpiAbb::generateMove (char moveType, char posType, char deltaType, vector<double> &input)
   {
+    CrpiTraceSpan span("CrpiAbb::generateMove", CRPI_TRACE_GENERATE);
     int cmdNum = 0;
     bool state = true;
     size_t found;
@@ -892,17 +1593,25 @@ namespace crpi_robot
 
     //! Check validity of inputs...
     //!   Check movement type
-    state &= (moveType == 'P' || moveType == 'L');
+    state &= (moveType == 'P' || moveType == 'L' || moveType == 'S' || moveType == 'T');
     //!   Check position type
-    state &= (posType == 'C' || posType == 'A');
+    if (moveType == 'T')
+    {
+      state &= (posType == 'P' || posType == 'C' || posType == 'E' || posType == 'Y');
+    }
+    else
+    {
+      state &= (posType == 'C' || posType == 'A' ||
+                (moveType == 'S' && (posType == 'B' || posType == 'E')));
+    }
     //!   Check absolute or relative motion
     state &= (deltaType == 'A' || deltaType == 'R');
 
     if (!state)
     {
-      printf("bad args\n");
+      CRPI_LOG(CRPI_LOG_WARNING, "CrpiAbb:  bad arguments");
       //! Invalid arguments generating move
-      return false;
+      return span.End(false);
     }
 
     //! Clear variables
@@ -915,7 +1624,22 @@ namespace crpi_robot
       posType = 'C';
     }
 
-    cmdNum = ((moveType == 'P') ? 200 : 300) + ((posType == 'C') ? 0 : 10) + ((deltaType == 'A') ? 0 : 1);
+    if (moveType == 'S')
+    {
+      //! Streaming:  450 Cartesian setpoint, 460 axis setpoint, 490 begin, 499 end (400 and 410
+      //! are digital and analog outputs)
+      cmdNum = 400 + ((posType == 'C') ? 50 : ((posType == 'A') ? 60 : ((posType == 'B') ? 90 : 99)));
+    }
+    else if (moveType == 'T')
+    {
+      //! Blended path:  350 parameters, 360 queue waypoint, 370 execute, 380 execute in step
+      //! with the other arm
+      cmdNum = 350 + ((posType == 'P') ? 0 : ((posType == 'C') ? 10 : ((posType == 'E') ? 20 : 30)));
+    }
+    else
+    {
+      cmdNum = ((moveType == 'P') ? 200 : 300) + ((posType == 'C') ? 0 : 10) + ((deltaType == 'A') ? 0 : 1);
+    }
     moveMe_ << "[" << cmdNum << ",";
 
     //! Loop through paramaters, completes 10 char string, and adds to command string
@@ -948,15 +1672,274 @@ namespace crpi_robot
     } // for (i = 0; i < 7; ++i)
     moveMe_ << "]\0";
 
+    return span.End(true);
+  }
+
+
+  LIBRARY_API void CrpiAbb::poseTarget (robotPose &pose, vector<double> &target)
+  {
+    Math::matrix m1(3,3);
+    vector<double> q, e;
+
+    target.clear();
+    target.push_back (pose.x);
+    target.push_back (pose.y);
+    target.push_back (pose.z);
+
+    e.push_back(pose.xrot);
+    e.push_back(pose.yrot);
+    e.push_back(pose.zrot);
+
+    if (angleUnits_ == DEGREE)
+    {
+      e.at(0) *= (3.141592654f / 180.0f);
+      e.at(1) *= (3.141592654f / 180.0f);
+      e.at(2) *= (3.141592654f / 180.0f);
+    }
+
+    m1.rotEulerMatrixConvert(e);
+    m1.rotMatrixQuaternionConvert(q);
+
+    target.push_back (q.at(0));
+    target.push_back (q.at(1));
+    target.push_back (q.at(2));
+    target.push_back (q.at(3));
+  }
+
+
+  bool CrpiAbb::queuePath (robotPose *poses, int start, int end, robotPose *accelerations,
+                           robotPose *speeds, const double *radii, double last[3])
+  {
+    //! Speeds and accelerations follow SetAbsoluteSpeed; poses and zones are sent as-is (mm)
+    double scale = 1.0f;
+    if (lengthUnits_ == METER)
+    {
+      scale = 1000.0f;
+    }
+    else if (lengthUnits_ == INCH)
+    {
+      scale = 25.4f;
+    }
+
+    vector<double> param(7, 0.0f), target;
+    int x;
+
+    for (x = start; x < end; ++x)
+    {
+      double v = ((speeds != NULL) ? crpi_translation_norm(speeds[x]) * scale : 0.0f);
+      double a = ((accelerations != NULL) ? crpi_translation_norm(accelerations[x]) * scale * 0.001f : 0.0f);
+      //! The controller stops at the end of each batch
+      double r = ((x == end - 1) ? 0.0f : radii[x]);
+      if (a > 0.0f && a < 0.1f)
+      {
+        //! PathAccLim lower bound
+        a = 0.1f;
+      }
+
+      if (v != last[0] || r != last[1] || a != last[2])
+      {
+        //! Blended path, parameters of the waypoints that follow
+        param.at(0) = last[0] = v;
+        param.at(1) = last[1] = r;
+        param.at(2) = last[2] = a;
+        if (!generateMove ('T', 'P', 'A', param) || !exchange ())
+        {
+          return false;
+        }
+      }
+
+      //! Blended path, queue Cartesian waypoint
+      poseTarget (poses[x], target);
+      if (!generateMove ('T', 'C', 'A', target) || !exchange ())
+      {
+        return false;
+      }
+    }
     return true;
   }
 
 
+  //! @brief Appends the RAPID of each step, as the handler would run the same commands:  targets
+  //!        keep the configuration and arm angle of the robot's pose when the module starts, and
+  //!        outputs are the handler's custom_DO signals
+  //!
+  class CrpiAbb::nativeWriter : public CrpiNativeWriter
+  {
+  public:
+    nativeWriter (CrpiAbb &robot, ostringstream &module) :
+      CrpiNativeWriter(robot.lengthUnits_, robot.angleUnits_),
+      robot_(robot),
+      module_(module)
+    {
+    }
+
+  protected:
+    bool move (CanonCommand cmd, const robotPose &pose, double radius)
+    {
+      double length = crpi_length_scale(length_, MM);
+      robotPose in = pose;
+      vector<double> target;
+
+      //! poseTarget takes the orientation in the driver's angle units
+      in.xrot *= crpi_angle_scale(angle_, robot_.angleUnits_);
+      in.yrot *= crpi_angle_scale(angle_, robot_.angleUnits_);
+      in.zrot *= crpi_angle_scale(angle_, robot_.angleUnits_);
+      robot_.poseTarget(in, target);
+      radius *= length;
+
+      module_ << "    crpi_target.trans := [" << (target[0] * length) << ", " << (target[1] * length) << ", "
+              << (target[2] * length) << "];\r\n";
+      module_ << "    crpi_target.rot := [" << target[3] << ", " << target[4] << ", " << target[5] << ", "
+              << target[6] << "];\r\n";
+      module_ << "    " << ((cmd == CmdMoveTo) ? "MoveJ" : "MoveL") << " crpi_target, crpi_speed, ";
+      if (radius > 0.0)
+      {
+        //! The handler's zone for a blend radius
+        module_ << "[FALSE, " << radius << ", " << (1.5 * radius) << ", " << (1.5 * radius) << ", "
+                << (0.15 * radius) << ", " << (1.5 * radius) << ", " << (0.15 * radius) << "]";
+      }
+      else
+      {
+        module_ << "fine";
+      }
+      module_ << ", tool0;\r\n";
+      return true;
+    }
+
+    bool axes (const robotAxes &joints)
+    {
+      //! Axes in the order the handler takes them:  1, 2, arm angle, 3, 4, 5, 6
+      static const char *names[axisCount] = {"robax.rax_1", "robax.rax_2", "extax.eax_a", "robax.rax_3",
+                                             "robax.rax_4", "robax.rax_5", "robax.rax_6"};
+      double scale = crpi_angle_scale(angle_, DEGREE);
+
+      if (joints.axes < axisCount)
+      {
+        return false;
+      }
+      module_ << "    crpi_joints := CJointT();\r\n";
+      for (int i = 0; i < axisCount; ++i)
+      {
+        module_ << "    crpi_joints." << names[i] << " := " << (joints.axis.at(i) * scale) << ";\r\n";
+      }
+      module_ << "    MoveAbsJ crpi_joints, crpi_speed, fine, tool0;\r\n";
+      return true;
+    }
+
+    bool output (int signal, bool value)
+    {
+      if (signal < 0)
+      {
+        return false;
+      }
+      //! The handler sets custom_DO_4 for any higher output
+      module_ << "    SetDO custom_DO_" << ((signal < 4) ? signal : 4) << ", " << (value ? 1 : 0) << ";\r\n";
+      return true;
+    }
+
+    bool dwell (double seconds)
+    {
+      if (seconds > 0.0)
+      {
+        module_ << "    WaitTime " << seconds << ";\r\n";
+      }
+      return true;
+    }
+
+    bool message (const string &text)
+    {
+      //! RAPID strings hold at most 80 characters
+      string quoted = text.substr(0, 80);
+      replace(quoted.begin(), quoted.end(), '"', '\'');
+      replace(quoted.begin(), quoted.end(), '\\', '/');
+      module_ << "    TPWrite \"" << quoted << "\";\r\n";
+      return true;
+    }
+
+    //! Same limits as SetAbsoluteSpeed and SetRelativeSpeed (mm/s)
+    bool speed (double value, bool relative)
+    {
+      double mms = relative ? (value * 1000.0) : (value * crpi_length_scale(length_, MM));
+
+      if (value < 0.0)
+      {
+        return false;
+      }
+      mms = (mms < 5.0) ? 5.0 : ((mms > 1000.0) ? 1000.0 : mms);
+      module_ << "    crpi_speed := [" << mms << ", 500, " << mms << ", 1000];\r\n";
+      return true;
+    }
+
+    bool acceleration (double value, bool relative)
+    {
+      double accel;
+
+      if (value < 0.0 || (relative && value > 1.0))
+      {
+        return false;
+      }
+      if (relative)
+      {
+        module_ << "    AccSet " << ((value > 0.01) ? (value * 100.0) : 1.0) << ", 100;\r\n";
+      }
+      else if (value > 0.0)
+      {
+        //! PathAccLim lower bound, as for MoveThroughTo (m/s^2)
+        accel = value * crpi_length_scale(length_, METER);
+        accel = (accel < 0.1) ? 0.1 : accel;
+        module_ << "    PathAccLim TRUE \\AccMax:=" << accel << ", TRUE \\DecelMax:=" << accel << ";\r\n";
+      }
+      else
+      {
+        module_ << "    PathAccLim FALSE, FALSE;\r\n";
+      }
+      return true;
+    }
+
+  private:
+    CrpiAbb &robot_;
+    ostringstream &module_;
+  };
+
+
+  LIBRARY_API bool CrpiAbb::generateNative (crpiNativeProgram &native)
+  {
+    CrpiTraceSpan span("CrpiAbb::generateNative", CRPI_TRACE_GENERATE);
+    ostringstream module;
+    nativeWriter writer(*this, module);
+
+    module.precision(9);
+    module << "MODULE CRPI_Native\r\n";
+    module << "  ! Translated by CRPI from a compiled program.  Run CRPI_Native_Main in the arm's\r\n";
+    module << "  ! motion task after the CRPI handler has set up its tool.\r\n";
+    module << "  PROC CRPI_Native_Main()\r\n";
+    module << "    VAR robtarget crpi_target;\r\n";
+    module << "    VAR jointtarget crpi_joints;\r\n";
+    module << "    VAR speeddata crpi_speed:=[200,500,200,1000];\r\n";
+    module << "\r\n";
+    module << "    ConfJ \\Off;\r\n";
+    module << "    ConfL \\Off;\r\n";
+    module << "    crpi_target := CRobT(\\Tool:=tool0 \\WObj:=wobj0);\r\n";
+    if (!writer.write(*native.program))
+    {
+      return span.End(false);
+    }
+    module << "    AccSet 100, 100;\r\n";
+    module << "    PathAccLim FALSE, FALSE;\r\n";
+    module << "  ENDPROC\r\n";
+    module << "ENDMODULE\r\n";
+    native.text = module.str();
+
+    return span.End(true);
+  }
+
+
   LIBRARY_API bool CrpiAbb::generateTool (char mode, double value)
   {
+    CrpiTraceSpan span("CrpiAbb::generateTool", CRPI_TRACE_GENERATE);
     if (!(mode == 'B' || mode == 'A'))
     {
-      return false;
+      return span.End(false);
     }
     size_t found;
     int currLength, j;
@@ -991,19 +1974,18 @@ namespace crpi_robot
     moveMe_ << tempString_.str() << ",";
     moveMe_ << "0.0000000,0.0000000,0.0000000,0.0000000,0.0000000,0.0000000]\0";
 
-#ifdef ABB_NOISY
-    printf(moveMe_.str().c_str());
-#endif
-    return true;
+    CRPI_LOG(CRPI_LOG_DEBUG, "%s", moveMe_.str().c_str());
+    return span.End(true);
   }
 
 
   LIBRARY_API bool CrpiAbb::generateFeedback (char retType)
   {
+    CrpiTraceSpan span("CrpiAbb::generateFeedback", CRPI_TRACE_GENERATE);
     if (retType != 'C' && retType != 'A' && retType != 'F' && retType != 'T' && retType != 'S')
     {
       //! Unsupported variable
-      return false;
+      return span.End(false);
     }
     int cmd = 0;
 
@@ -1031,13 +2013,13 @@ namespace crpi_robot
     moveMe_.str(string());
     moveMe_ << "[" << cmd << ",0.0000000,0.0000000,0.0000000,0.0000000,0.0000000,0.0000000,0.0000000]\0";
     
-    return true;
+    return span.End(true);
   }
 
 
   LIBRARY_API bool CrpiAbb::generateIO(char sigtype, int signum, double val )
   {
-    if (sigtype != 'D' && sigtype != 'A')
+    if (sigtype != 'D' && sigtype != 'A' && sigtype != 'B')
     {
       //! Unsupported variable
       return false;
@@ -1052,6 +2034,9 @@ namespace crpi_robot
     case 'A':
       cmd = 410;
       break;
+    case 'B':
+      cmd = 420;
+      break;
     default:
       break;
     }
@@ -1064,6 +2049,7 @@ namespace crpi_robot
 
   LIBRARY_API bool CrpiAbb::generateParameter (char paramType, char subType, vector<double> &input)
   {
+    CrpiTraceSpan span("CrpiAbb::generateParameter", CRPI_TRACE_GENERATE);
     size_t found;
     int j = 0, currLength = 0;
     int cmd = 0;
@@ -1083,7 +2069,7 @@ namespace crpi_robot
       }
       else
       {
-        return false;
+        return span.End(false);
       }
       break;
     case 'S':
@@ -1094,12 +2080,12 @@ namespace crpi_robot
         //! Relative
         if (input[0] > 1000.0f || input[0] < 0.0f)
         {
-          return false;
+          return span.End(false);
         }
       }
       else
       {
-        return false;
+        return span.End(false);
       }
 
       cmd = 100 + ((paramType == 'S') ? 0 : 10);
@@ -1130,55 +2116,59 @@ namespace crpi_robot
 
       break;
     default:
-      return false;
+      return span.End(false);
     }
     
-    return true;
+    return span.End(true);
   }
 
   
   LIBRARY_API bool CrpiAbb::send ()
   {
+    CrpiTraceSpan span("CrpiAbb::send", CRPI_TRACE_SEND);
     int x;
     
-#ifdef ABB_NOISY
-    printf ("server_ = %d\n", server_);
-    printf ("Sending message %s\n", moveMe_.str().c_str());
-#endif
+    CRPI_LOG(CRPI_LOG_DEBUG, "server_ = %d, sending message %s", (int)server_, moveMe_.str().c_str());
       //! Use TCP/IP
       x = ulapi_socket_write(server_, moveMe_.str().c_str(), strlen(moveMe_.str().c_str())+1);
-#ifdef ABB_NOISY
-      printf ("%i\n", x);
-#endif
-      return true;
+      CRPI_LOG(CRPI_LOG_DEBUG, "%d bytes sent", x);
+      return span.End(true);
   }
 
 
   LIBRARY_API bool CrpiAbb::get ()
   {
+    CrpiTraceSpan span("CrpiAbb::get", CRPI_TRACE_WAIT);
     int x = 0;
 
-#ifdef ABB_NOISY
-      printf ("getting feedback...\n");
-#endif
+      CRPI_LOG(CRPI_LOG_DEBUG, "getting feedback...");
 
       //! Use TCP/IP
       x = ulapi_socket_read(server_, mssgBuffer_, 8192);
-#ifdef ABB_NOISY
-      printf ("%d %s read\n", x, mssgBuffer_);
-#endif
-      return true;
+      CRPI_LOG(CRPI_LOG_DEBUG, "%d %s read", x, mssgBuffer_);
+      return span.End(true);
+  }
+
+
+  LIBRARY_API bool CrpiAbb::exchange ()
+  {
+    if (!send () || !get ())
+    {
+      return false;
+    }
+    return (mssgBuffer_[1] == '1');
   }
 
 
   LIBRARY_API bool CrpiAbb::parseFeedback (int num)
   {
+    CRPI_NO_ALLOC_SCOPE("CrpiAbb::parseFeedback");
     bool newItem = false;
     int index = -1, i;
 
     for (i = 0; i < num; ++i)
     {
-      tempData_->at(i) = "";
+      tempData_.at(i).clear();
     }
 
     //! REQUEST_MSG_SIZE is very large, feedback from robot is limited to 80 characters
@@ -1200,14 +2190,83 @@ namespace crpi_robot
 //            return false;
           }
         }
-        tempData_->at(index).push_back (mssgBuffer_[i]);
+        tempData_.at(index).push_back (mssgBuffer_[i]);
       } // if (mssgBuffer_[i] == ' ') ... else
     } //for (int i = 0; i < 65; ++i)
   
     //! Convert strings to floats
     for (i = 0; i < num; ++i)
     {
-      feedback_[i] = stod (tempData_->at(i));
+      feedback_[i] = stod (tempData_.at(i));
+    }
+    return true;
+  }
+
+
+  LIBRARY_API bool CrpiAbb::readFeedback (char retType, int num)
+  {
+    abbStateRecord record;
+
+    if (num == 8)
+    {
+      if (useStateStream_ && stream_.record.read(record) > 0 &&
+          (ulapi_time() - record.timestamp) < ABB_STATE_STALE && recordFeedback(record, retType))
+      {
+        return true;
+      }
+      if (useEGM_ && egm_.record.read(record) > 0 &&
+          (ulapi_time() - record.timestamp) < ABB_STATE_STALE && recordFeedback(record, retType))
+      {
+        return true;
+      }
+    }
+
+    return (generateFeedback (retType) && send () && get () && parseFeedback (num));
+  }
+
+
+  LIBRARY_API bool CrpiAbb::recordFeedback (const abbStateRecord &record, char retType)
+  {
+    const double *values = NULL;
+    int i;
+
+    //! Same layout as the text replies:  record type, then 7 values
+    switch (retType)
+    {
+    case 'C':
+      feedback_[0] = 1;
+      values = ((record.valid & STATE_POSE) ? record.pose : NULL);
+      break;
+    case 'A':
+      feedback_[0] = 2;
+      values = ((record.valid & STATE_AXES) ? record.axes : NULL);
+      break;
+    case 'T':
+      feedback_[0] = 3;
+      values = ((record.valid & STATE_TORQUES) ? record.torques : NULL);
+      break;
+    case 'S':
+      if ((record.valid & STATE_IO) == 0)
+      {
+        return false;
+      }
+      feedback_[0] = 4;
+      for (i = 0; i < 7; ++i)
+      {
+        feedback_[i + 1] = (double)((record.dio >> i) & 1);
+      }
+      return true;
+    default:
+      break;
+    }
+
+    if (values == NULL)
+    {
+      return false;
+    }
+    for (i = 0; i < 7; ++i)
+    {
+      feedback_[i + 1] = values[i];
     }
     return true;
   }
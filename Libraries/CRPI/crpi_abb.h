@@ -16,6 +16,10 @@
 #define ABB_H
 
 #include "crpi.h"
+#include "crpi_egm.h"
+#include "crpi_estimator.h"
+#include "crpi_metrics.h"
+#include "crpi_recorder.h"
 
 #if defined (_MSC_VER)
 #include "..\Math\MatrixMath.h"
@@ -30,8 +34,155 @@
 
 using namespace std;
 
+//! @brief Maximum number of waypoints the RAPID server queues for one blended path.  Longer
+//!        MoveThroughTo calls are sent in batches that each end in an exact stop.
+//!
+#define ABB_PATH_MAX 16
+
+//! @brief Size (bytes) of one binary state record sent by CRPI_StateServer_*.mod, and the
+//!        marker at its start ("CRPI" as a little-endian UDINT)
+//!
+#define ABB_STATE_RECORD 100
+#define ABB_STATE_MAGIC 0x43525049UL
+
+//! @brief The state server listens on the command port plus this offset (1025 -> 2025)
+//!
+#define ABB_STATE_PORT_OFFSET 1000
+
+//! @brief Age (s) after which a streamed record is no longer used and getters fall back to
+//!        request/response over the command connection
+//!
+#define ABB_STATE_STALE 0.1
+
+//! @brief The EGM UdpUc devices send to the command port plus this offset (1025 -> 6510 for
+//!        ROB_L, 1026 -> 6511 for ROB_R)
+//!
+#define ABB_EGM_PORT_OFFSET 5485
+
+//! @brief Most EGM messages drained per wake-up of the EGM thread
+//!
+#define EGM_BATCH 8
+
+//! @brief Seconds between keep-alive pose requests
+//!
+#define ABB_KEEPALIVE 5.0
+
 namespace crpi_robot
 {
+  //! @brief One state record received from the RAPID state server
+  //!
+  struct abbStateRecord
+  {
+    //! @brief Record sequence number and controller time (ms)
+    //!
+    unsigned long sequence;
+    unsigned long time;
+
+    //! @brief TCP position (mm) and orientation quaternion (q1..q4)
+    //!
+    double pose[7];
+
+    //! @brief Joint positions (deg) and motor torques, ordered rax_1, rax_2, eax_a, rax_3..rax_6
+    //!
+    double axes[7];
+    double torques[7];
+
+    //! @brief Digital inputs (bit 0 = custom_DI_0)
+    //!
+    unsigned long dio;
+
+    //! @brief The CrpiStateField values present in the record
+    //!
+    unsigned int valid;
+
+    //! @brief Time (ulapi_time, s) at which the record was received
+    //!
+    double timestamp;
+  };
+
+
+  //! @brief State stream shared between CrpiAbb and its receive thread
+  //!
+  struct LIBRARY_API abbStateStream
+  {
+    bool runThread;
+
+    //! @brief State server address and port
+    //!
+    char addr[16];
+    int port;
+
+    //! @brief Connection to the state server (-1 while disconnected)
+    //!
+    ulapi_integer client;
+
+    //! @brief Raw received bytes not yet unpacked
+    //!
+    char buffer[4 * ABB_STATE_RECORD];
+    int held;
+
+    //! @brief Latest complete record, published for lock-free readers
+    //!
+    crpi_seqlock<abbStateRecord> record;
+
+    //! @brief Runtime metrics:  records published, records missed (gaps in the sequence
+    //!        numbers), the record rate, and reconnections to the state server
+    //!
+    CrpiCounter *framesMetric;
+    CrpiCounter *droppedMetric;
+    CrpiRateMeter rateMetric;
+    CrpiCounter *reconnectMetric;
+
+    //! @brief Recorder channel of the records (see crpi_recorder.h)
+    //!
+    int recordChannel;
+  };
+
+
+  //! @brief Externally Guided Motion channel shared between CrpiAbb and its UDP thread
+  //!
+  struct LIBRARY_API abbEgmChannel
+  {
+    bool runThread;
+
+    //! @brief UDP socket bound to the EGM port
+    //!
+    ulapi_integer socket;
+
+    //! @brief Fast lock (ulapi_fastlock_new) on the setpoint fields
+    //!
+    void *handle;
+
+    //! @brief Correction mode (0 hold the measured position, 1 pose, 2 joint), whether a setpoint
+    //!        has been given since BeginStream, and the setpoint:  position (mm) and quaternion,
+    //!        or joints in CRPI order (rax_1, rax_2, eax_a, rax_3..rax_6, deg)
+    //!
+    int mode;
+    bool hasSetpoint;
+    double pose[7];
+    double joints[7];
+
+    //! @brief Sequence number of the last EgmSensor message
+    //!
+    unsigned long seqno;
+
+    //! @brief Latest feedback (pose and axes) from the EgmRobot messages
+    //!
+    crpi_seqlock<abbStateRecord> record;
+
+    //! @brief Runtime metrics:  messages published, messages dropped (undecodable, or
+    //!        superseded by a newer one in the same batch), and the message rate
+    //!
+    CrpiCounter *framesMetric;
+    CrpiCounter *droppedMetric;
+    CrpiRateMeter rateMetric;
+
+    //! @brief Recorder channel of the feedback (see crpi_recorder.h)
+    //!
+    int recordChannel;
+  };
+
+
   //! @ingroup Robot
   //!
   //! @brief CRPI interface for the ABB IRB 14000 robot
@@ -39,6 +190,10 @@ namespace crpi_robot
   class LIBRARY_API CrpiAbb
   {
   public:
+    //! @brief Number of axes of the arm (see CrpiAxisCount)
+    //!
+    static constexpr int axisCount = 7;
+
     //! @brief Default constructor
     //!
     //! @param params Configuration parameters for the CRPI instance of this robot
@@ -58,7 +213,7 @@ namespace crpi_robot
     //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
     //!         not accepted, and FAILURE if the command is accepted but not executed successfully
     //!
-    CanonReturn ApplyCartesianForceTorque (robotPose &robotForceTorque, vector<bool> activeAxes, vector<bool> manipulator);
+    CanonReturn ApplyCartesianForceTorque (robotPose &robotForceTorque, const vector<bool> &activeAxes, const vector<bool> &manipulator);
 
     //! @brief Apply joint torques
     //!
@@ -169,7 +324,8 @@ namespace crpi_robot
     //!
     CanonReturn GetRobotPose (robotPose *pose);
 
-    //! @brief Get instantaneous Cartesian velocity
+    //! @brief Get instantaneous Cartesian velocity, as estimated from the pose feedback (see
+    //!        crpi_estimator.h)
     //!
     //! @param speed Cartesian velocities to be populated by the method
     //!
@@ -178,7 +334,7 @@ namespace crpi_robot
     //!
     CanonReturn GetRobotSpeed (robotPose *speed);
 
-    //! @brief Get instantaneous joint speeds
+    //! @brief Get instantaneous joint speeds, as estimated from the joint feedback
     //!
     //! @param speed Joint velocities array to be populated by the method
     //!
@@ -196,6 +352,28 @@ namespace crpi_robot
     //!
     CanonReturn GetRobotTorques (robotAxes *torques);
 
+    //! @brief Get a consistent snapshot of the robot's latest state without waiting on the
+    //!        robot's feedback connection
+    //!
+    //! @param state Snapshot to be populated by the method
+    //!
+    //! @return SUCCESS if a state has been published by the driver, REJECT if no state is
+    //!         available yet or the robot does not publish state snapshots
+    //!
+    CanonReturn GetRobotState (RobotStateSnapshot *state);
+
+    //! @brief Get the robot's latest state extrapolated to compensate for its age, from the speeds
+    //!        in the state
+    //!
+    //! @param state Snapshot to be populated by the method, as by GetRobotState; its timestamp is
+    //!              the time predicted for
+    //! @param lead  Seconds past the current time (ulapi_time) to predict for; 0 for now
+    //!
+    //! @return SUCCESS if a state has been published by the driver, REJECT if no state is
+    //!         available yet or the robot does not publish the speeds to extrapolate from
+    //!
+    CanonReturn GetPredictedState (RobotStateSnapshot *state, double lead = 0.0);
+
     //! @brief Move a virtual attractor to a specified coordinate in Cartesian space for force control
     //!
     //! @param pose The 6DOF destination of the virtual attractor 
@@ -215,6 +393,72 @@ namespace crpi_robot
     //!
     CanonReturn MoveToAxisTarget (robotAxes &axes, bool useBlocking);
 
+    //! @brief Start streaming motion setpoints to the robot at the controller's native rate
+    //!
+    //! @return SUCCESS if the robot is ready to accept setpoints, REJECT if streaming is not
+    //!         supported, and FAILURE if the stream could not be started
+    //!
+    CanonReturn BeginStream ();
+
+    //! @brief Send the next Cartesian setpoint of an active stream without waiting for the motion
+    //!
+    //! @param pose The 6DOF setpoint for the robot's TCP in Cartesian space coordinates
+    //!
+    //! @return SUCCESS if the setpoint was sent, REJECT if no stream is active, and FAILURE if the
+    //!         setpoint could not be sent
+    //!
+    CanonReturn StreamPose (robotPose &pose);
+
+    //! @brief Send the next joint setpoint of an active stream without waiting for the motion
+    //!
+    //! @param axes Target axis values specified in the current axial unit
+    //!
+    //! @return SUCCESS if the setpoint was sent, REJECT if no stream is active, and FAILURE if the
+    //!         setpoint could not be sent
+    //!
+    CanonReturn StreamAxes (robotAxes &axes);
+
+    //! @brief Stop an active stream and bring the robot to rest
+    //!
+    //! @return SUCCESS if the stream was stopped, REJECT if no stream is active, and FAILURE if the
+    //!         robot could not be stopped
+    //!
+    CanonReturn EndStream ();
+
+    //! @brief Start streaming Cartesian force/torque targets to a force controller that stays
+    //!        running on the robot, so each update needs no new program
+    //!
+    //! @return SUCCESS if the robot is ready to accept wrench targets, REJECT if force streaming
+    //!         is not supported or a stream is already active, and FAILURE if the stream could
+    //!         not be started
+    //!
+    //! @note The robot holds its position (no axes selected) until the first StreamWrench.  The
+    //!       "stream_period" and "stream_deadline" settings of BeginStream also apply.
+    //!
+    CanonReturn BeginWrenchStream ();
+
+    //! @brief Send the next force/torque target of an active wrench stream without waiting for
+    //!        the robot to respond
+    //!
+    //! @param wrench     Target forces (N) along and torques (N m) about the tool axes
+    //! @param activeAxes Which tool axes (x, y, z, xrot, yrot, zrot) are force controlled; the
+    //!                   others hold position.  TRUE = ACTIVE, FALSE = INACTIVE
+    //! @param limits     For active axes, the largest TCP speed along or about the axis (length or
+    //!                   angle units per second); for the others, the largest deviation from the
+    //!                   held position (length or angle units)
+    //!
+    //! @return SUCCESS if the target was sent, REJECT if no wrench stream is active, and FAILURE
+    //!         if the target could not be sent
+    //!
+    CanonReturn StreamWrench (robotPose &wrench, const vector<bool> &activeAxes, robotPose &limits);
+
+    //! @brief Stop an active wrench stream, leave force control, and bring the robot to rest
+    //!
+    //! @return SUCCESS if the stream was stopped, REJECT if no wrench stream is active, and
+    //!         FAILURE if the robot could not be stopped
+    //!
+    CanonReturn EndWrenchStream ();
+
     //! @brief Set the accerlation for the controlled pose to the given value in length units per
     //!        second per second
     //!
@@ -298,6 +542,15 @@ namespace crpi_robot
     //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
     //!         not accepted, and FAILURE if the command is accepted but not executed successfully
     //!
+    //! @note "sync_left" and "sync_right" (a crpiSyncJob) join the left or right YuMi arm to a
+    //!       dual-arm job; the second arm to join runs it.  The controller starts both arms
+    //!       together and keeps them in step (MultiMove), so no waiting is needed on the PC.
+    //!       Accelerations are not limited in synchronized paths.
+    //! @note "native_program" (a crpiNativeProgram) translates a compiled program into a RAPID
+    //!       module (CRPI_Native, procedure CRPI_Native_Main) using the handler's tool and
+    //!       custom_DO outputs.  The handler takes numeric commands only, so the module is loaded
+    //!       onto the controller by other means; asking to run it is rejected.
+    //!
     CanonReturn SetParameter (const char *paramName, void *paramVal);
 
     //! @brief Set the accerlation for the controlled pose to the given percentage of the robot's
@@ -395,13 +648,20 @@ namespace crpi_robot
     CanonReturn PointAppendage(CanonRobotAppendage app_ID, robotPose &to);
 
   private:
-    void *task;
+    //! @brief Keep-alive registered on the SensorHub timer wheel
+    //!
+    int keepalive_;
     keepalive ka_;
     char IPAddr_[16];
     ulapi_integer server_;
     ulapi_integer client_;
     int curTool_;
 
+    //! @brief Digital outputs as last written by SetRobotIO, which only sends the changes
+    //!
+    bool firstIO_;
+    robotIO curIO_;
+
     //! @brief Robot configuration paramters
     //!
     CrpiRobotParams params_;
@@ -420,7 +680,7 @@ namespace crpi_robot
 
     //! @brief Returned data from the robot
     //!
-    double *feedback_;
+    double feedback_[10];
 
     CanonAngleUnit angleUnits_;
     CanonLengthUnit lengthUnits_;
@@ -429,12 +689,17 @@ namespace crpi_robot
     double defaultSpeed_;
     double axial;
 
-    vector<string> *tempData_;
+    vector<string> tempData_;
 
     //! @brief Generate a motion command for the ABB
     //!
-    //! @param moveType  Specify the movement type, either PTP ('P'), LIN ('L'), or force control ('F')
-    //! @param posType   Specify the position type, either cartesian ('C') or angular ('A')
+    //! @param moveType  Specify the movement type, either PTP ('P'), LIN ('L'), force control ('F'),
+    //!                  streaming ('S'), or blended path ('T')
+    //! @param posType   Specify the position type, either cartesian ('C') or angular ('A'), or for
+    //!                  streaming commands, begin ('B') or end ('E').  Blended paths use
+    //!                  parameters ('P':  speed mm/s, zone mm, acceleration m/s^2), a queued
+    //!                  Cartesian waypoint ('C'), execute ('E'), or execute in step with the
+    //!                  other arm ('Y').
     //! @param deltaType Specify the motion delta, either absolute ('A') or relative ('R')
     //! @param input     Vector of 6 position values (note that J3 of the robot is E1, and is thus not
     //!                  used here for angular motion commands)
@@ -443,6 +708,115 @@ namespace crpi_robot
     //!
     bool generateMove (char moveType, char posType, char deltaType, vector<double> &input);
 
+    //! @brief Convert a pose to the position and quaternion values of a Cartesian motion command
+    //!
+    //! @param pose   The 6DOF pose in the current length and angle units
+    //! @param target Vector populated with the 7 command values
+    //!
+    void poseTarget (robotPose &pose, vector<double> &target);
+
+    //! @brief Queue waypoints [start, end) of a blended path, sending new parameters whenever the
+    //!        speed, zone, or acceleration changes.  Called with the keep-alive lock held.
+    //!
+    //! @param poses         The path's waypoints
+    //! @param start         First waypoint to queue
+    //! @param end           One past the last waypoint to queue, on which the controller stops
+    //! @param accelerations Acceleration of each waypoint (NULL for no limit)
+    //! @param speeds        Speed of each waypoint (NULL for the current speed)
+    //! @param radii         Blend radius (mm) of each waypoint
+    //! @param last          Parameters last sent (speed, zone, acceleration; -1 if none yet)
+    //!
+    //! @return True if every waypoint was queued, false otherwise
+    //!
+    bool queuePath (robotPose *poses, int start, int end, robotPose *accelerations,
+                    robotPose *speeds, const double *radii, double last[3]);
+
+    //! @brief Run a dual-arm job once both arms have joined it (SetParameter "sync_left" and
+    //!        "sync_right"):  each arm's waypoints are queued on its own connection, and both
+    //!        paths are then run with the 380 command, which the RAPID handlers run between
+    //!        SyncMoveOn and SyncMoveOff
+    //!
+    //! @return SUCCESS once both arms have stopped, REJECT for an invalid job, FAILURE otherwise
+    //!
+    static CanonReturn moveSynchronized (crpiSyncJob &job);
+
+    //! @brief Translates compiled programs into RAPID
+    //!
+    class nativeWriter;
+
+    //! @brief Translate a compiled program into a RAPID module (SetParameter "native_program")
+    //!
+    //! @param native The program to translate; its text is set to the module
+    //!
+    //! @return True if the program was translated, false if one of its steps cannot be
+    //!
+    bool generateNative (crpiNativeProgram &native);
+
+    //! @brief Send a streaming command ('S' move type, command numbers 450-499) and wait for the
+    //!        controller's acknowledgement.  The RAPID server acknowledges setpoints on receipt and
+    //!        runs them as concurrent moves.  With EGM, only begin and end are sent this way.
+    //!
+    //! @param posType Begin ('B'), Cartesian setpoint ('C'), axis setpoint ('A'), or end ('E')
+    //! @param input   Vector of 7 values
+    //!
+    //! @return SUCCESS if acknowledged, FAILURE otherwise
+    //!
+    CanonReturn streamCommand (char posType, vector<double> &input);
+
+    //! @brief Whether a setpoint stream started by BeginStream is active
+    //!
+    bool streaming_;
+
+    //! @brief Stream settings (see SetParameter):  correction cycle (s), lookahead (s), and the
+    //!        deadline (s) after which the controller stops if no setpoint has arrived
+    //!
+    double streamPeriod_, streamLookahead_, streamDeadline_;
+
+    //! @brief Whether robot state is taken from the binary state server (<Feedback
+    //!        Protocol="STREAM"/> in the robot XML) rather than requested one value at a time
+    //!
+    bool useStateStream_;
+
+    //! @brief State stream and the thread receiving it
+    //!
+    abbStateStream stream_;
+    void *stateTask_;
+
+    //! @brief Whether BeginStream uses Externally Guided Motion (<Feedback Protocol="EGM"/> in
+    //!        the robot XML), and whether EGM streams joint (SetParameter "stream_axes") rather
+    //!        than pose setpoints
+    //!
+    bool useEGM_;
+    bool streamAxes_;
+
+    //! @brief EGM channel and the thread serving it
+    //!
+    abbEgmChannel egm_;
+    void *egmTask_;
+
+    //! @brief State assembled from the Get* replies (guarded by ka_.lock) and its published copy
+    //!
+    RobotStateSnapshot latest_;
+    crpi_seqlock<RobotStateSnapshot> state_;
+
+    //! @brief Speed and acceleration estimators of the pose and axis feedback and their latest
+    //!        estimates (guarded by ka_.lock), the units the samples were taken in, and the
+    //!        estimates' published copy, written before each state
+    //!
+    CrpiRateEstimator poseRates_;
+    CrpiRateEstimator axisRates_;
+    CrpiMotionRates rates_;
+    CanonLengthUnit rateLength_;
+    CanonAngleUnit rateAngle_;
+    crpi_seqlock<CrpiMotionRates> ratesPub_;
+
+    //! @brief Mark a field of latest_ as valid and publish it to GetRobotState readers.  Must be
+    //!        called with ka_.lock held.
+    //!
+    //! @param field The CrpiStateField that was just updated
+    //!
+    void publishState (unsigned int field);
+
     //! @brief Generate a feedback request for the ABB
     //!
     //! @param retType Specify the return value, either Cartesian position ('C'), joint position ('A')
@@ -454,9 +828,11 @@ namespace crpi_robot
 
     //! @brief Generate a signal output request for the ABB
     //!
-    //! @param sigtype The type of signal output ('D'igital, or 'A'nalog)
-    //! @param signum  The IO channel number
-    //! @param val     The output value ((0, 1) for DO, or [0, 1] for AO)
+    //! @param sigtype The type of signal output ('D'igital, 'A'nalog, or a 'B'atch of digital
+    //!                outputs)
+    //! @param signum  The IO channel number (for a batch, the mask of channels to set)
+    //! @param val     The output value ((0, 1) for DO, [0, 1] for AO, or the channels' bits for a
+    //!                batch)
     //!
     //! @return True if signal output string generation was successful, false otherwise
     //!
@@ -470,6 +846,26 @@ namespace crpi_robot
     //!
     bool parseFeedback (int num);
 
+    //! @brief Populate feedback_ with a feedback reply, rebuilt from the latest streamed state
+    //!        record if one is fresh and requested from the controller otherwise.  Must be called
+    //!        with ka_.lock held.
+    //!
+    //! @param retType The feedback type (see generateFeedback)
+    //! @param num     The number of values in the reply
+    //!
+    //! @return True if feedback_ holds the reply, false otherwise
+    //!
+    bool readFeedback (char retType, int num);
+
+    //! @brief Populate feedback_ with a feedback reply rebuilt from a streamed record
+    //!
+    //! @param record  The record
+    //! @param retType The feedback type (see generateFeedback)
+    //!
+    //! @return True if the record holds the requested values, false otherwise
+    //!
+    bool recordFeedback (const abbStateRecord &record, char retType);
+
     //! @brief Generate a parameter set request for the ABB
     //!
     //! @param paramType Specify the parameter to set, see notes for valid parameters
@@ -500,6 +896,13 @@ namespace crpi_robot
     //! @brief Store data from robot in mssgBuffer_ using whatever communication protocol is defined
     //!
     bool get ();
+
+    //! @brief Send moveMe_ and wait for the controller's response.  Must be called with ka_.lock
+    //!        held.
+    //!
+    //! @return True if the controller acknowledged the command, false otherwise
+    //!
+    bool exchange ();
   }; // CrpiAbb
 
 } // namespace crpi_robot
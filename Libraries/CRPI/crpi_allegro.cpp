@@ -13,6 +13,7 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "crpi_allegro.h"
+#include "crpi_log.h"
 #include <fstream>
 #include <iostream>
 #include <string.h>
@@ -26,6 +27,35 @@ namespace crpi_robot
 
   LIBRARY_API CrpiAllegro::CrpiAllegro (CrpiRobotParams &params)
   {
+    server_config = server_params = server_feedback = -1;
+    hasGrasp_ = false;
+
+    //! The grasp controller runs in the hand server's CAN cycle, with either transport
+    graspHandle_ = ulapi_shm_new(ALLEGRO_GRASP_SHM_KEY, sizeof(allegroGraspShared));
+    grasp_ = (graspHandle_ != NULL) ? (allegroGraspShared*)ulapi_shm_addr(graspHandle_) : NULL;
+    if (grasp_ != NULL &&
+        (grasp_->magic.load(std::memory_order_acquire) != ALLEGRO_GRASP_SHM_MAGIC ||
+         grasp_->version != ALLEGRO_GRASP_VERSION))
+    {
+      grasp_ = NULL;
+    }
+    if (grasp_ != NULL)
+    {
+      CRPI_LOG(CRPI_LOG_INFO, "CrpiAllegro:  using the hand server's grasp controller");
+    }
+
+    //! Use the hand server's shared memory segment if it has published one
+    shmHandle_ = ulapi_shm_new(ALLEGRO_SHM_KEY, sizeof(allegroShared));
+    shm_ = (shmHandle_ != NULL) ? (allegroShared*)ulapi_shm_addr(shmHandle_) : NULL;
+    useShm_ = (shm_ != NULL &&
+               shm_->magic.load(std::memory_order_acquire) == ALLEGRO_SHM_MAGIC &&
+               shm_->version == ALLEGRO_SHM_VERSION);
+    if (useShm_)
+    {
+      CRPI_LOG(CRPI_LOG_INFO, "CrpiAllegro:  connection success for shared memory");
+      return;
+    }
+
     server_config = ulapi_socket_get_client_id (6008, "127.0.0.1");
 
     server_params = ulapi_socket_get_client_id (6009, "127.0.0.1");
@@ -34,38 +64,123 @@ namespace crpi_robot
 
     if (server_config < 0)
     {
-      cout << "no connection for controllers" << endl;
+      CRPI_LOG(CRPI_LOG_ERROR, "CrpiAllegro:  no connection for controllers");
     }
     else
     {
-      cout << "connection success for controllers" << endl;
+      CRPI_LOG(CRPI_LOG_INFO, "CrpiAllegro:  connection success for controllers");
     }
 
     if (server_params < 0)
     {
-      cout << "no connection for parameters" << endl;
+      CRPI_LOG(CRPI_LOG_ERROR, "CrpiAllegro:  no connection for parameters");
     }
     else
     {
-      cout << "connection success for parameters" << endl;
+      CRPI_LOG(CRPI_LOG_INFO, "CrpiAllegro:  connection success for parameters");
     }
 
     if (server_feedback < 0)
     {
-      cout << "no connection for feedback" << endl;
+      CRPI_LOG(CRPI_LOG_ERROR, "CrpiAllegro:  no connection for feedback");
     }
     else
     {
-      cout << "connection success for feedback" << endl;
+      CRPI_LOG(CRPI_LOG_INFO, "CrpiAllegro:  connection success for feedback");
     }
   }
 
   LIBRARY_API CrpiAllegro::~CrpiAllegro ()
   {
+    //! The shared memory segment belongs to the hand server and is left in place
+    if (server_config >= 0)
+    {
+      ulapi_socket_close(server_config);
+    }
+    if (server_params >= 0)
+    {
+      ulapi_socket_close(server_params);
+    }
+    if (server_feedback >= 0)
+    {
+      ulapi_socket_close(server_feedback);
+    }
+  }
+
+
+  LIBRARY_API bool CrpiAllegro::post (unsigned int channel, const char *text, int pause)
+  {
+    if (useShm_)
+    {
+      return allegro_push_command(shm_, channel, text);
+    }
+
+    if (text != outbuffer)
+    {
+      strncpy(outbuffer, text, MSG_SIZE - 1);
+      outbuffer[MSG_SIZE - 1] = '\0';
+    }
+    send = ulapi_socket_write((channel == ALLEGRO_CHANNEL_PARAMS) ? server_params : server_config,
+                              outbuffer,
+                              sizeof(outbuffer));
+    //! The socket server frames messages by time, so give it a moment before the next one
+#ifdef WIN32
+    Sleep (pause);
+#else
+    usleep(pause * 1000);
+#endif
+    return send > 0;
+  }
+
+
+  LIBRARY_API bool CrpiAllegro::query (const char *request)
+  {
+    strcpy(outbuffer, request);
+    send = ulapi_socket_write(server_feedback, outbuffer, MSG_SIZE);
+#ifdef WIN32
+    Sleep (10);
+#else
+    usleep(10000);
+#endif
+
+    strcpy(inbuffer,"");
+    get = ulapi_socket_read(server_feedback, inbuffer, MSG_SIZE);
+    if (get <= 0)
+    {
+      return false;
+    }
+    inbuffer[(get < MSG_SIZE) ? get : MSG_SIZE - 1] = '\0';
+    return true;
   }
 
   LIBRARY_API CanonReturn CrpiAllegro::SetTool (double percent)
   {
+    if (grasp_ != NULL)
+    {
+      allegroGraspGoal goal;
+
+      if (percent > 0.0 && percent <= 1.0)
+      {
+        if (!hasGrasp_)
+        {
+          return CANON_REJECT;
+        }
+        goal = lastGrasp_;
+        goal.squeeze = percent * ((goal.squeeze > 0.0) ? goal.squeeze : ALLEGRO_GRASP_SQUEEZE);
+      }
+      else if (percent == 0 || percent == -1)
+      {
+        memset(&goal, 0, sizeof(goal));
+        goal.mode = (percent == 0) ? ALLEGRO_GOAL_HOLD : ALLEGRO_GOAL_IDLE;
+      }
+      else
+      {
+        return CANON_REJECT;
+      }
+      allegro_grasp_post_goal(grasp_, goal);
+      return CANON_SUCCESS;
+    }
+
     //This is probably a good place to start, pause, and stop control processes
 
     /*
@@ -100,7 +215,7 @@ namespace crpi_robot
     return CANON_SUCCESS;
   }
 
-  LIBRARY_API CanonReturn CrpiAllegro::ApplyCartesianForceTorque (robotPose &robotForceTorque, vector<bool> activeAxes, vector<bool> manipulator)
+  LIBRARY_API CanonReturn CrpiAllegro::ApplyCartesianForceTorque (robotPose &robotForceTorque, const vector<bool> &activeAxes, const vector<bool> &manipulator)
   {
     //This assumes that all toggled fingers will experience the same force/torque and active axes commands, unless disengaged with the manipulator command
     
@@ -160,16 +275,11 @@ namespace crpi_robot
       sstream.str(std::string());
     }
 
-    send = ulapi_socket_write(server_config, outbuffer, sizeof(outbuffer));
-#ifdef WIN32
-    Sleep (3);
-#else
-    usleep(3000);
-#endif    
+    bool sent = post(ALLEGRO_CHANNEL_CONFIG, outbuffer, 3);
 
     strcpy(outbuffer,"");
     
-    return CANON_SUCCESS;
+    return sent ? CANON_SUCCESS : CANON_FAILURE;
   }
 
   LIBRARY_API CanonReturn CrpiAllegro::ApplyJointTorque (robotAxes &robotJointTorque)
@@ -211,19 +321,24 @@ namespace crpi_robot
 
   LIBRARY_API CanonReturn CrpiAllegro::GetRobotAxes (robotAxes *axes)
   {
-    strcpy(outbuffer,"");
-    strcpy(outbuffer,"joint_angles");
+    if (useShm_)
+    {
+      allegroState state;
+      if (allegro_latest_state(shm_, state) == 0)
+      {
+        return CANON_FAILURE;
+      }
+      for (unsigned int jj = 0; jj < ALLEGRO_JOINTS; ++jj)
+      {
+        axes->axis.at(jj) = state.joints[jj];
+      }
+      return CANON_SUCCESS;
+    }
 
-    send = ulapi_socket_write(server_feedback, outbuffer, MSG_SIZE);
-#ifdef WIN32
-        Sleep (10);
-#else
-        usleep(10000);
-#endif
-    
-    
-    strcpy(inbuffer,"");
-    get = ulapi_socket_read(server_feedback, inbuffer, MSG_SIZE);
+    if (!query("joint_angles"))
+    {
+      return CANON_FAILURE;
+    }
 
     //Copy over into string and replace commas with spaces
     std::string temp(inbuffer);
@@ -255,20 +370,25 @@ namespace crpi_robot
  
   LIBRARY_API CanonReturn CrpiAllegro::GetRobotForces (robotPose *forces)
   {
+    if (useShm_)
+    {
+      allegroState state;
+      if (allegro_latest_state(shm_, state) == 0)
+      {
+        return CANON_FAILURE;
+      }
+      forces->x = state.force[0];
+      forces->y = state.force[1];
+      forces->z = state.force[2];
+      //no torques yet
+      forces->xrot = forces->yrot = forces->zrot = 0;
+      return CANON_SUCCESS;
+    }
 
-    strcpy(outbuffer,"");
-    strcpy(outbuffer,"cart_force");
-
-    send = ulapi_socket_write(server_feedback, outbuffer, MSG_SIZE);
-#ifdef WIN32
-        Sleep (10);
-#else
-        usleep(10000);
-#endif
-    
-    
-    strcpy(inbuffer,"");
-    get = ulapi_socket_read(server_feedback, inbuffer, MSG_SIZE);
+    if (!query("cart_force"))
+    {
+      return CANON_FAILURE;
+    }
 
     //Copy over into string and replace commas with spaces
     std::string temp(inbuffer);
@@ -303,18 +423,26 @@ namespace crpi_robot
 
   LIBRARY_API CanonReturn CrpiAllegro::GetRobotPose (robotPose *pose)
   {
-    strcpy(outbuffer,"");
-    strcpy(outbuffer,"cart_pose");
+    if (useShm_)
+    {
+      allegroState state;
+      if (allegro_latest_state(shm_, state) == 0)
+      {
+        return CANON_FAILURE;
+      }
+      pose->x = state.pose[0];
+      pose->y = state.pose[1];
+      pose->z = state.pose[2];
+      pose->xrot = state.pose[3];
+      pose->yrot = state.pose[4];
+      pose->zrot = state.pose[5];
+      return CANON_SUCCESS;
+    }
 
-    send = ulapi_socket_write(server_feedback, outbuffer, MSG_SIZE);
-#ifdef WIN32
-        Sleep (10);
-#else
-        usleep(10000);
-#endif
-    
-    strcpy(inbuffer,"");
-    get = ulapi_socket_read(server_feedback, inbuffer, MSG_SIZE);
+    if (!query("cart_pose"))
+    {
+      return CANON_FAILURE;
+    }
 
     //Copy over into string and replace commas with spaces
     std::string temp(inbuffer);
@@ -356,11 +484,40 @@ namespace crpi_robot
 
   LIBRARY_API CanonReturn CrpiAllegro::GetRobotTorques (robotAxes *torques)
   {
+    if (grasp_ != NULL)
+    {
+      //! Commanded by the grasp controller in its latest cycle
+      allegroGraspStatus status;
+      if (!allegro_grasp_latest_status(grasp_, status))
+      {
+        return CANON_FAILURE;
+      }
+      for (unsigned int jj = 0; jj < ALLEGRO_JOINTS; ++jj)
+      {
+        torques->axis.at(jj) = status.torque[jj];
+      }
+      return CANON_SUCCESS;
+    }
+
     //! TODO
     return CANON_REJECT;
   }
 
 
+  LIBRARY_API CanonReturn CrpiAllegro::GetRobotState (RobotStateSnapshot *state)
+  {
+    //! Not applicable:  state is only available by polling the hand directly
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiAllegro::GetPredictedState (RobotStateSnapshot *state, double lead)
+  {
+    //! Not applicable
+    return CANON_REJECT;
+  }
+
+
   LIBRARY_API CanonReturn CrpiAllegro::MoveAttractor (robotPose &pose) //hijacked for grasping control
   {
 #if defined(__GNUC__)
@@ -434,23 +591,31 @@ namespace crpi_robot
     strcat(outbuffer, " ");
     sstream.str(std::string());
 
-    send = ulapi_socket_write(server_config, outbuffer, sizeof(outbuffer));
-#ifdef WIN32
-        Sleep (10);
-#else
-        usleep(10000);
-#endif
-    
+    bool sent = post(ALLEGRO_CHANNEL_CONFIG, outbuffer, 10);
 
     strcpy(outbuffer,"");
     
-    return CANON_SUCCESS;
+    return sent ? CANON_SUCCESS : CANON_FAILURE;
 
   }
 
 
   LIBRARY_API CanonReturn CrpiAllegro::MoveToAxisTarget (robotAxes &axes, bool useBlocking)
   {
+    if (grasp_ != NULL)
+    {
+      allegroGraspGoal goal;
+
+      memset(&goal, 0, sizeof(goal));
+      goal.mode = ALLEGRO_GOAL_POSITION;
+      for (unsigned int jj = 0; jj < ALLEGRO_JOINTS; ++jj)
+      {
+        goal.target[jj] = axes.axis.at(jj);
+      }
+      allegro_grasp_post_goal(grasp_, goal);
+      return CANON_SUCCESS;
+    }
+
 #if defined(__GNUC__)
     string one,two;
     one = "Control"; two = "joint_pos";
@@ -494,16 +659,60 @@ namespace crpi_robot
       sstream.str(std::string());
     }
 
-    send = ulapi_socket_write(server_config, outbuffer, sizeof(outbuffer));
-#ifdef WIN32
-    Sleep (10);
-#else
-    usleep(10000);
-#endif
+    bool sent = post(ALLEGRO_CHANNEL_CONFIG, outbuffer, 10);
 
     strcpy(outbuffer,"");
     
-    return CANON_SUCCESS;
+    return sent ? CANON_SUCCESS : CANON_FAILURE;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiAllegro::BeginStream ()
+  {
+    //! Not applicable
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiAllegro::StreamPose (robotPose &pose)
+  {
+    //! Not applicable
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiAllegro::StreamAxes (robotAxes &axes)
+  {
+    //! Not applicable
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiAllegro::EndStream ()
+  {
+    //! Not applicable
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiAllegro::BeginWrenchStream ()
+  {
+    //! Not applicable
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiAllegro::StreamWrench (robotPose &wrench, const vector<bool> &activeAxes, robotPose &limits)
+  {
+    //! Not applicable
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiAllegro::EndWrenchStream ()
+  {
+    //! Not applicable
+    return CANON_REJECT;
   }
 
 
@@ -518,28 +727,16 @@ namespace crpi_robot
     std::ostringstream sstream;
     std::string SpeedAsString;
 
-    strcpy(outbuffer,"");
-    strcat(outbuffer, "Speed");
-    send = ulapi_socket_write(server_params, outbuffer, sizeof(outbuffer));
-#ifdef WIN32
-    Sleep (10);
-#else
-    usleep(10000);
-#endif
-    strcpy(outbuffer,"");
+    bool sent;
+
+    sent = post(ALLEGRO_CHANNEL_PARAMS, "Speed", 10);
   
     sstream << speed;
     SpeedAsString = sstream.str();
-    strcat(outbuffer, SpeedAsString.c_str());
-    send = ulapi_socket_write(server_params, outbuffer, sizeof(outbuffer));
-#ifdef WIN32
-    Sleep (10);
-#else
-    usleep(10000);
-#endif
+    sent = post(ALLEGRO_CHANNEL_PARAMS, SpeedAsString.c_str(), 10) && sent;
     strcpy(outbuffer,"");
 
-    return CANON_SUCCESS;
+    return sent ? CANON_SUCCESS : CANON_FAILURE;
   }
 
 
@@ -587,20 +784,37 @@ namespace crpi_robot
     //control modes: read_only, joint_pos, gravity_comp
     //planner  modes: set_point, set_point_smooth, function, file, feed_forward
 
+    if (strncmp(paramName, "grasp_", 6) == 0)
+    {
+      if (grasp_ == NULL || paramVal == NULL)
+      {
+        return CANON_REJECT;
+      }
+      if (strcmp(paramName, "grasp_goal") == 0)
+      {
+        allegro_grasp_post_goal(grasp_, *((allegroGraspGoal*)paramVal));
+        if (((allegroGraspGoal*)paramVal)->mode == ALLEGRO_GOAL_GRASP)
+        {
+          lastGrasp_ = *((allegroGraspGoal*)paramVal);
+          hasGrasp_ = true;
+        }
+        return CANON_SUCCESS;
+      }
+      if (strcmp(paramName, "grasp_status") == 0)
+      {
+        return allegro_grasp_latest_status(grasp_, *((allegroGraspStatus*)paramVal)) ? CANON_SUCCESS : CANON_FAILURE;
+      }
+      return CANON_REJECT;
+    }
+
     char * temp_char = (char*) paramVal;
     //int val = *temp_int;
   
-    strcpy(outbuffer,"");
+    bool sent = true;
 
     if (strcmp(paramName,"Control")==0 || strcmp(paramName,"Plan")==0)
     {
-      strcat(outbuffer, temp_char);
-      send = ulapi_socket_write(server_config, outbuffer, sizeof(outbuffer));
-#ifdef WIN32
-        Sleep (10);
-#else
-        usleep(10000);
-#endif
+      sent = post(ALLEGRO_CHANNEL_CONFIG, temp_char, 10);
     }
 
     //parameters for various other behaviors:
@@ -608,54 +822,20 @@ namespace crpi_robot
 
     else if  (strcmp(paramName,"touch_stop")==0)
     {
-      strcat(outbuffer, "touch_stop");
-      send = ulapi_socket_write(server_params, outbuffer, sizeof(outbuffer));
-#ifdef WIN32
-        Sleep (10);
-#else
-        usleep(10000);
-#endif
-      strcpy(outbuffer,"");
-
-      strcat(outbuffer, temp_char);
-      send = ulapi_socket_write(server_params, outbuffer, sizeof(outbuffer));
-#ifdef WIN32
-        Sleep (10);
-#else
-        usleep(10000);
-#endif
+      sent = post(ALLEGRO_CHANNEL_PARAMS, "touch_stop", 10);
+      sent = post(ALLEGRO_CHANNEL_PARAMS, temp_char, 10) && sent;
     }
 
     else if  (strcmp(paramName,"gravity_vector")==0)
     {
-      strcat(outbuffer, "gravity_vector");
-      send = ulapi_socket_write(server_params, outbuffer, sizeof(outbuffer));
-#ifdef WIN32
-        Sleep (10);
-#else
-        usleep(10000);
-#endif
-      strcpy(outbuffer,"");
-
-      strcat(outbuffer, temp_char);
-      send = ulapi_socket_write(server_params, outbuffer, sizeof(outbuffer));
-#ifdef WIN32
-        Sleep (10);
-#else
-        usleep(10000);
-#endif
+      sent = post(ALLEGRO_CHANNEL_PARAMS, "gravity_vector", 10);
+      sent = post(ALLEGRO_CHANNEL_PARAMS, temp_char, 10) && sent;
     }
 
     else if  (strcmp(paramName,"tare_nano17")==0)
     {
-      cout << "TARING SENSORS" << endl;
-      strcat(outbuffer, "tare_nano17");
-      send = ulapi_socket_write(server_params, outbuffer, sizeof(outbuffer));
-#ifdef WIN32
-        Sleep (10);
-#else
-        usleep(10000);
-#endif
+      CRPI_LOG(CRPI_LOG_INFO, "CrpiAllegro:  taring sensors");
+      sent = post(ALLEGRO_CHANNEL_PARAMS, "tare_nano17", 10);
     }
 
     /*
@@ -669,7 +849,7 @@ namespace crpi_robot
 
     strcpy(outbuffer,"");
 
-    return CANON_SUCCESS;
+    return sent ? CANON_SUCCESS : CANON_FAILURE;
 
   }
 
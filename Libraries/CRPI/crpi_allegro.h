@@ -24,6 +24,8 @@
 #endif
 #include "string.h"
 #include "crpi.h"
+#include "crpi_allegro_shm.h"
+#include "crpi_allegro_grasp.h"
 
 
 namespace crpi_robot
@@ -35,6 +37,10 @@ namespace crpi_robot
   class LIBRARY_API CrpiAllegro
   {
   public:
+    //! @brief Number of axes of the hand (see CrpiAxisCount)
+    //!
+    static constexpr int axisCount = 16;
+
     int ii;
 
     //! @brief Default constructor
@@ -56,7 +62,7 @@ namespace crpi_robot
     //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
     //!         not accepted, and FAILURE if the command is accepted but not executed successfully
     //!
-    CanonReturn ApplyCartesianForceTorque (robotPose &robotForceTorque, vector<bool> activeAxes, vector<bool> manipulator);
+    CanonReturn ApplyCartesianForceTorque (robotPose &robotForceTorque, const vector<bool> &activeAxes, const vector<bool> &manipulator);
 
     //! @brief Apply joint torques
     //!
@@ -194,6 +200,28 @@ namespace crpi_robot
     //!
     CanonReturn GetRobotTorques (robotAxes *torques);
 
+    //! @brief Get a consistent snapshot of the robot's latest state without waiting on the
+    //!        robot's feedback connection
+    //!
+    //! @param state Snapshot to be populated by the method
+    //!
+    //! @return SUCCESS if a state has been published by the driver, REJECT if no state is
+    //!         available yet or the robot does not publish state snapshots
+    //!
+    CanonReturn GetRobotState (RobotStateSnapshot *state);
+
+    //! @brief Get the robot's latest state extrapolated to compensate for its age, from the speeds
+    //!        in the state
+    //!
+    //! @param state Snapshot to be populated by the method, as by GetRobotState; its timestamp is
+    //!              the time predicted for
+    //! @param lead  Seconds past the current time (ulapi_time) to predict for; 0 for now
+    //!
+    //! @return SUCCESS if a state has been published by the driver, REJECT if no state is
+    //!         available yet or the robot does not publish the speeds to extrapolate from
+    //!
+    CanonReturn GetPredictedState (RobotStateSnapshot *state, double lead = 0.0);
+
     //! @brief Move a virtual attractor to a specified coordinate in Cartesian space for force control
     //!
     //! @param pose The 6DOF destination of the virtual attractor 
@@ -211,8 +239,77 @@ namespace crpi_robot
     //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
     //!         not accepted, and FAILURE if the command is accepted but not executed successfully
     //!
+    //! @note With the hand server's grasp controller, the axes (radians) become an
+    //!       ALLEGRO_GOAL_POSITION goal followed by the server's own control cycle
+    //!
     CanonReturn MoveToAxisTarget (robotAxes &axes, bool useBlocking);
 
+    //! @brief Start streaming motion setpoints to the robot at the controller's native rate
+    //!
+    //! @return SUCCESS if the robot is ready to accept setpoints, REJECT if streaming is not
+    //!         supported, and FAILURE if the stream could not be started
+    //!
+    CanonReturn BeginStream ();
+
+    //! @brief Send the next Cartesian setpoint of an active stream without waiting for the motion
+    //!
+    //! @param pose The 6DOF setpoint for the robot's TCP in Cartesian space coordinates
+    //!
+    //! @return SUCCESS if the setpoint was sent, REJECT if no stream is active, and FAILURE if the
+    //!         setpoint could not be sent
+    //!
+    CanonReturn StreamPose (robotPose &pose);
+
+    //! @brief Send the next joint setpoint of an active stream without waiting for the motion
+    //!
+    //! @param axes Target axis values specified in the current axial unit
+    //!
+    //! @return SUCCESS if the setpoint was sent, REJECT if no stream is active, and FAILURE if the
+    //!         setpoint could not be sent
+    //!
+    CanonReturn StreamAxes (robotAxes &axes);
+
+    //! @brief Stop an active stream and bring the robot to rest
+    //!
+    //! @return SUCCESS if the stream was stopped, REJECT if no stream is active, and FAILURE if the
+    //!         robot could not be stopped
+    //!
+    CanonReturn EndStream ();
+
+    //! @brief Start streaming Cartesian force/torque targets to a force controller that stays
+    //!        running on the robot, so each update needs no new program
+    //!
+    //! @return SUCCESS if the robot is ready to accept wrench targets, REJECT if force streaming
+    //!         is not supported or a stream is already active, and FAILURE if the stream could
+    //!         not be started
+    //!
+    //! @note The robot holds its position (no axes selected) until the first StreamWrench.  The
+    //!       "stream_period" and "stream_deadline" settings of BeginStream also apply.
+    //!
+    CanonReturn BeginWrenchStream ();
+
+    //! @brief Send the next force/torque target of an active wrench stream without waiting for
+    //!        the robot to respond
+    //!
+    //! @param wrench     Target forces (N) along and torques (N m) about the tool axes
+    //! @param activeAxes Which tool axes (x, y, z, xrot, yrot, zrot) are force controlled; the
+    //!                   others hold position.  TRUE = ACTIVE, FALSE = INACTIVE
+    //! @param limits     For active axes, the largest TCP speed along or about the axis (length or
+    //!                   angle units per second); for the others, the largest deviation from the
+    //!                   held position (length or angle units)
+    //!
+    //! @return SUCCESS if the target was sent, REJECT if no wrench stream is active, and FAILURE
+    //!         if the target could not be sent
+    //!
+    CanonReturn StreamWrench (robotPose &wrench, const vector<bool> &activeAxes, robotPose &limits);
+
+    //! @brief Stop an active wrench stream, leave force control, and bring the robot to rest
+    //!
+    //! @return SUCCESS if the stream was stopped, REJECT if no wrench stream is active, and
+    //!         FAILURE if the robot could not be stopped
+    //!
+    CanonReturn EndWrenchStream ();
+
     //! @brief Set the accerlation for the controlled pose to the given value in length units per
     //!        second per second
     //!
@@ -296,6 +393,10 @@ namespace crpi_robot
     //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
     //!         not accepted, and FAILURE if the command is accepted but not executed successfully
     //!
+    //! @note With the hand server's grasp controller, "grasp_goal" (allegroGraspGoal*) sets its
+    //!       goal and "grasp_status" (allegroGraspStatus*) copies its newest status (FAILURE if
+    //!       there is none yet); both are REJECTed without it
+    //!
     CanonReturn SetParameter (const char *paramName, void *paramVal);
 
     //! @brief Set the accerlation for the controlled pose to the given percentage of the robot's
@@ -334,6 +435,10 @@ namespace crpi_robot
     //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
     //!         not accepted, and FAILURE if the command is accepted but not executed successfully
     //!
+    //! @note With the hand server's grasp controller, a percent in (0, 1] repeats the last
+    //!       "grasp_goal" grasp with its squeeze scaled by percent (REJECT if there was none), 0
+    //!       holds the hand where it is, and -1 leaves it idle
+    //!
     CanonReturn SetTool (double percent);
 
     //! @brief Set the speed for the controlled point to the given percentage of the robot's maximum
@@ -396,6 +501,44 @@ namespace crpi_robot
 
     ulapi_integer server_config, server_params, server_feedback;
 
+    //! @brief Shared memory segment published by the hand server, if any
+    //!
+    void *shmHandle_;
+    allegroShared *shm_;
+
+    //! @brief Whether commands and feedback go through shared memory instead of the sockets
+    //!
+    bool useShm_;
+
+    //! @brief Grasp segment published by the hand server, if any (grasp_ is NULL otherwise)
+    //!
+    void *graspHandle_;
+    allegroGraspShared *grasp_;
+
+    //! @brief The last grasp goal set through "grasp_goal", for SetTool
+    //!
+    allegroGraspGoal lastGrasp_;
+    bool hasGrasp_;
+
+    //! @brief Send a command to the hand server
+    //!
+    //! @param channel ALLEGRO_CHANNEL_CONFIG or ALLEGRO_CHANNEL_PARAMS
+    //! @param text    Command text
+    //! @param pause   Time (ms) to leave the server before the next socket message
+    //!
+    //! @return True if the command was queued or written
+    //!
+    bool post (unsigned int channel, const char *text, int pause);
+
+    //! @brief Ask the hand server for a feedback value over the feedback socket; the reply is
+    //!        left in inbuffer
+    //!
+    //! @param request Feedback request ("joint_angles", "cart_force", or "cart_pose")
+    //!
+    //! @return True if a reply was received
+    //!
+    bool query (const char *request);
+
     void *task;
     keepalive ka_;
     unsigned long threadID_;
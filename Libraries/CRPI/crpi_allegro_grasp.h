@@ -0,0 +1,424 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_allegro_grasp.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Grasp controller for the Allegro hand server's own control cycle, and the
+//  shared-memory mailbox through which CrpiAllegro sets its goals.
+//  Self-contained, as crpi_allegro_shm.h is, so that the hand server can
+//  include it without CRPI.
+//
+//  Without it, grasping closes its loop in the application:  each cycle,
+//  joint targets go out through CrpiAllegro and the joints come back through
+//  the server's feedback path, so the loop runs at whatever rate that round
+//  trip allows.  With it, the loop is closed by the hand server at its CAN
+//  rate (about 333 Hz), and the application only sets a goal:  move to a
+//  posture, hold where the hand is, or close chosen fingers until they touch
+//  something and then squeeze with a set torque.
+//
+//  The hand server owns the segment:  it creates it with key
+//  ALLEGRO_GRASP_SHM_KEY and size sizeof(allegroGraspShared), zeroes it, and
+//  stores ALLEGRO_GRASP_SHM_MAGIC in magic last.  Then, every CAN cycle:
+//
+//    if (allegro_grasp_take_goal(shm, goal, taken))
+//      controller.setGoal(goal, taken, q);
+//    controller.step(q, tau, status);       // tau goes out on the CAN bus
+//    allegro_grasp_publish_status(shm, status);
+//
+//  None of these allocate, lock, or wait on CrpiAllegro.  CrpiAllegro keeps
+//  to the command and state rings (or the loopback sockets) if no server has
+//  published the segment.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef ALLEGRO_GRASP_H
+#define ALLEGRO_GRASP_H
+
+#include "crpi_allegro_shm.h"
+
+#include <math.h>
+
+//! Shared memory key of the hand server's grasp segment
+#define ALLEGRO_GRASP_SHM_KEY 6012
+
+//! Marks a segment that has been initialized by the hand server ("AGRP")
+#define ALLEGRO_GRASP_SHM_MAGIC 0x50524741
+
+//! Layout version of allegroGraspShared
+#define ALLEGRO_GRASP_VERSION 1
+
+//! Fingers of the hand (index, middle, ring, thumb), and joints of each
+#define ALLEGRO_FINGERS 4
+#define ALLEGRO_FINGER_JOINTS 4
+
+//! Default control period (s) of the hand server's CAN cycle
+#define ALLEGRO_GRASP_PERIOD 0.003
+
+//! Defaults for goal fields left 0:  stiffness (N m/rad), damping (N m s/rad), torque limit
+//! (N m), setpoint speed (rad/s), tracking torque that marks a contact (N m), and squeeze
+//! torque (N m)
+#define ALLEGRO_GRASP_KP 1.0
+#define ALLEGRO_GRASP_KD 0.03
+#define ALLEGRO_GRASP_TORQUE 0.6
+#define ALLEGRO_GRASP_SPEED 1.0
+#define ALLEGRO_GRASP_CONTACT 0.15
+#define ALLEGRO_GRASP_SQUEEZE 0.2
+
+//! Weight of the newest finite difference in the joint velocity estimate
+#define ALLEGRO_GRASP_VEL_FILTER 0.3
+
+//! Distance (rad) within which a joint has reached its target
+#define ALLEGRO_GRASP_SETTLED 0.01
+
+//! Goal modes
+#define ALLEGRO_GOAL_IDLE     0  //! Only the feed-forward torques (e.g., gravity compensation)
+#define ALLEGRO_GOAL_POSITION 1  //! Move every joint to its target
+#define ALLEGRO_GOAL_HOLD     2  //! Hold the joints where they are when the goal arrives
+#define ALLEGRO_GOAL_GRASP    3  //! Close the chosen fingers toward their targets until contact,
+                                 //! then squeeze; the other fingers move to their targets
+
+//! @brief A goal for the grasp controller.  Joint order is the hand's (finger by finger, four
+//!        joints each, the thumb last); angles are in radians.
+//!
+struct allegroGraspGoal
+{
+  //! @brief ALLEGRO_GOAL_*
+  //!
+  unsigned int mode;
+
+  //! @brief Fingers that grasp (bit f for finger f; 0 for all), for ALLEGRO_GOAL_GRASP
+  //!
+  unsigned int fingers;
+
+  //! @brief Target of each joint (the closed posture, for grasping fingers)
+  //!
+  double target[ALLEGRO_JOINTS];
+
+  //! @brief Stiffness, damping, and torque limit of each joint (0 for the defaults)
+  //!
+  double kp[ALLEGRO_JOINTS];
+  double kd[ALLEGRO_JOINTS];
+  double maxTorque[ALLEGRO_JOINTS];
+
+  //! @brief Torque (N m) added to each joint every cycle
+  //!
+  double feedForward[ALLEGRO_JOINTS];
+
+  //! @brief Speed (rad/s) of the setpoints toward the targets (0 for the default)
+  //!
+  double speed;
+
+  //! @brief Tracking torque (N m) on any joint of a grasping finger that marks its contact, and
+  //!        the torque then held on each of its joints (0 for the defaults)
+  //!
+  double contactTorque;
+  double squeeze;
+};
+
+//! @brief What the grasp controller did in one cycle
+//!
+struct allegroGraspStatus
+{
+  //! @brief Number of the goal being run (as counted by allegro_grasp_post_goal), and its mode
+  //!
+  unsigned int goal;
+  unsigned int mode;
+
+  //! @brief Fingers in contact, and fingers done (at their targets, or squeezing)
+  //!
+  unsigned int contact;
+  unsigned int settled;
+
+  //! @brief Setpoint, estimated velocity (rad/s), and commanded torque (N m) of each joint
+  //!
+  double setpoint[ALLEGRO_JOINTS];
+  double velocity[ALLEGRO_JOINTS];
+  double torque[ALLEGRO_JOINTS];
+
+  //! @brief Cycles run
+  //!
+  unsigned long cycles;
+};
+
+//! @brief Layout of the grasp segment
+//!
+//! @note The goal has a single writer (CrpiAllegro) and the status a single writer (the hand
+//!       server); each side only ever looks at the other's newest value.
+//!
+struct allegroGraspShared
+{
+  std::atomic<unsigned int> magic;
+  unsigned int version;
+
+  //! @brief Goals posted so far, and the goal's sequence (odd while CrpiAllegro is writing it)
+  //!
+  std::atomic<unsigned int> goalCount;
+  std::atomic<unsigned int> goalSeq;
+  allegroGraspGoal goal;
+
+  //! @brief The status's sequence (odd while the hand server is writing it)
+  //!
+  std::atomic<unsigned int> statusSeq;
+  allegroGraspStatus status;
+};
+
+//! @brief Set the goal (CrpiAllegro side).  Replaces a goal the server has not taken yet.
+//!
+//! @return The goal's number, from 1
+//!
+inline unsigned int allegro_grasp_post_goal (allegroGraspShared *shm, const allegroGraspGoal &goal)
+{
+  unsigned int s = shm->goalSeq.load(std::memory_order_relaxed);
+  unsigned int n = shm->goalCount.load(std::memory_order_relaxed) + 1;
+
+  shm->goalSeq.store(s + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy((void*)&shm->goal, (const void*)&goal, sizeof(allegroGraspGoal));
+  shm->goalCount.store(n, std::memory_order_relaxed);
+  shm->goalSeq.store(s + 2, std::memory_order_release);
+  return n;
+}
+
+//! @brief Take the goal if it is newer than the last one taken (hand server side).  Makes one
+//!        attempt, so a goal being written is simply taken on the next cycle.
+//!
+//! @param shm   Shared segment
+//! @param goal  Destination of the goal
+//! @param taken Number of the last goal taken; updated when a newer one is taken
+//!
+//! @return True if a newer goal was taken
+//!
+inline bool allegro_grasp_take_goal (allegroGraspShared *shm, allegroGraspGoal &goal, unsigned int &taken)
+{
+  unsigned int s1 = shm->goalSeq.load(std::memory_order_acquire), s2, n;
+
+  if (s1 & 1)
+  {
+    return false;
+  }
+  n = shm->goalCount.load(std::memory_order_relaxed);
+  if (n == taken)
+  {
+    return false;
+  }
+  memcpy((void*)&goal, (const void*)&shm->goal, sizeof(allegroGraspGoal));
+  std::atomic_thread_fence(std::memory_order_acquire);
+  s2 = shm->goalSeq.load(std::memory_order_relaxed);
+  if (s1 != s2)
+  {
+    return false;
+  }
+  taken = n;
+  return true;
+}
+
+//! @brief Publish the controller's status (hand server side)
+//!
+inline void allegro_grasp_publish_status (allegroGraspShared *shm, const allegroGraspStatus &status)
+{
+  unsigned int s = shm->statusSeq.load(std::memory_order_relaxed);
+
+  shm->statusSeq.store(s + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy((void*)&shm->status, (const void*)&status, sizeof(allegroGraspStatus));
+  shm->statusSeq.store(s + 2, std::memory_order_release);
+}
+
+//! @brief Copy the controller's newest status (CrpiAllegro side)
+//!
+//! @return False if the server has not published one
+//!
+inline bool allegro_grasp_latest_status (allegroGraspShared *shm, allegroGraspStatus &status)
+{
+  unsigned int s1, s2;
+
+  do
+  {
+    s1 = shm->statusSeq.load(std::memory_order_acquire);
+    if (s1 == 0)
+    {
+      return false;
+    }
+    memcpy((void*)&status, (const void*)&shm->status, sizeof(allegroGraspStatus));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    s2 = shm->statusSeq.load(std::memory_order_relaxed);
+  } while ((s1 & 1) || (s1 != s2));
+
+  return true;
+}
+
+
+//! @brief Joint-space PD grasp controller, stepped once per CAN cycle by the hand server.
+//!        Never allocates, so step can run in the CAN loop.
+//!
+//! Setpoints move toward the targets at the goal's speed, and each joint is driven by
+//! kp (setpoint - q) - kd qdot + feedForward, limited to its torque limit.  A grasping finger
+//! is in contact once the stiffness term of any of its joints reaches the contact torque (its
+//! setpoint has run ahead of a blocked joint); its setpoints then stop kp / squeeze past where
+//! its joints are, so that it holds the object with the squeeze torque rather than with
+//! whatever torque the setpoint had built up.
+//!
+struct allegroGraspController
+{
+  double period;
+  allegroGraspGoal goal;
+  allegroGraspStatus status;
+
+  //! @brief Previous joint angles, and whether there are any yet
+  //!
+  double last[ALLEGRO_JOINTS];
+  bool primed;
+
+  //! @brief Direction (+1 or -1) each joint closes in, for grasping fingers
+  //!
+  double closing[ALLEGRO_JOINTS];
+
+  //! @brief Start idle
+  //!
+  //! @param cycle Control period (s)
+  //!
+  void init (double cycle = ALLEGRO_GRASP_PERIOD)
+  {
+    period = (cycle > 0.0) ? cycle : ALLEGRO_GRASP_PERIOD;
+    memset(&goal, 0, sizeof(goal));
+    memset(&status, 0, sizeof(status));
+    memset(last, 0, sizeof(last));
+    memset(closing, 0, sizeof(closing));
+    primed = false;
+  }
+
+  //! @brief Start a new goal from the current joint angles
+  //!
+  //! @param next   The goal
+  //! @param number Its number (reported in the status)
+  //! @param q      Current joint angles
+  //!
+  void setGoal (const allegroGraspGoal &next, unsigned int number, const double *q)
+  {
+    int j;
+
+    goal = next;
+    for (j = 0; j < ALLEGRO_JOINTS; ++j)
+    {
+      goal.kp[j] = (goal.kp[j] > 0.0) ? goal.kp[j] : ALLEGRO_GRASP_KP;
+      goal.kd[j] = (goal.kd[j] > 0.0) ? goal.kd[j] : ALLEGRO_GRASP_KD;
+      goal.maxTorque[j] = (goal.maxTorque[j] > 0.0) ? goal.maxTorque[j] : ALLEGRO_GRASP_TORQUE;
+      closing[j] = (goal.target[j] >= q[j]) ? 1.0 : -1.0;
+    }
+    goal.speed = (goal.speed > 0.0) ? goal.speed : ALLEGRO_GRASP_SPEED;
+    goal.contactTorque = (goal.contactTorque > 0.0) ? goal.contactTorque : ALLEGRO_GRASP_CONTACT;
+    goal.squeeze = (goal.squeeze > 0.0) ? goal.squeeze : ALLEGRO_GRASP_SQUEEZE;
+    if (goal.fingers == 0)
+    {
+      goal.fingers = (1u << ALLEGRO_FINGERS) - 1;
+    }
+
+    //! Setpoints start where the joints are, so a new goal never starts with a jump
+    for (j = 0; j < ALLEGRO_JOINTS; ++j)
+    {
+      status.setpoint[j] = q[j];
+      if (goal.mode == ALLEGRO_GOAL_HOLD)
+      {
+        goal.target[j] = q[j];
+      }
+    }
+    status.goal = number;
+    status.mode = goal.mode;
+    status.contact = 0;
+    status.settled = 0;
+  }
+
+  //! @brief Run one control cycle
+  //!
+  //! @param q   Joint angles measured this cycle
+  //! @param tau Joint torques (N m) to be populated by the method
+  //!
+  //! @return The cycle's status
+  //!
+  const allegroGraspStatus &step (const double *q, double *tau)
+  {
+    const double stepMax = goal.speed * period;
+    double error, drive;
+    int f, j, k;
+    bool grasping, done;
+
+    for (j = 0; j < ALLEGRO_JOINTS; ++j)
+    {
+      if (primed)
+      {
+        status.velocity[j] += ALLEGRO_GRASP_VEL_FILTER * (((q[j] - last[j]) / period) - status.velocity[j]);
+      }
+      last[j] = q[j];
+    }
+    primed = true;
+    ++status.cycles;
+
+    if (goal.mode == ALLEGRO_GOAL_IDLE)
+    {
+      for (j = 0; j < ALLEGRO_JOINTS; ++j)
+      {
+        status.setpoint[j] = q[j];
+        tau[j] = status.torque[j] = goal.feedForward[j];
+      }
+      return status;
+    }
+
+    for (f = 0; f < ALLEGRO_FINGERS; ++f)
+    {
+      const unsigned int bit = 1u << f;
+      grasping = (goal.mode == ALLEGRO_GOAL_GRASP) && (goal.fingers & bit);
+
+      if (grasping && !(status.contact & bit))
+      {
+        //! Contact:  a joint is held back from its setpoint by more than the contact torque
+        for (k = 0; k < ALLEGRO_FINGER_JOINTS; ++k)
+        {
+          j = (f * ALLEGRO_FINGER_JOINTS) + k;
+          if (closing[j] * goal.kp[j] * (status.setpoint[j] - q[j]) >= goal.contactTorque)
+          {
+            break;
+          }
+        }
+        if (k < ALLEGRO_FINGER_JOINTS)
+        {
+          status.contact |= bit;
+          status.settled |= bit;
+          for (k = 0; k < ALLEGRO_FINGER_JOINTS; ++k)
+          {
+            j = (f * ALLEGRO_FINGER_JOINTS) + k;
+            status.setpoint[j] = q[j] + (closing[j] * goal.squeeze / goal.kp[j]);
+          }
+        }
+      }
+
+      done = true;
+      for (k = 0; k < ALLEGRO_FINGER_JOINTS; ++k)
+      {
+        j = (f * ALLEGRO_FINGER_JOINTS) + k;
+        if (!(status.contact & bit))
+        {
+          //! Setpoints move toward the targets at the goal's speed
+          error = goal.target[j] - status.setpoint[j];
+          status.setpoint[j] += (error > stepMax) ? stepMax : ((error < -stepMax) ? -stepMax : error);
+          done = done && (fabs(goal.target[j] - q[j]) <= ALLEGRO_GRASP_SETTLED);
+        }
+
+        drive = (goal.kp[j] * (status.setpoint[j] - q[j])) - (goal.kd[j] * status.velocity[j]) + goal.feedForward[j];
+        drive = (drive > goal.maxTorque[j]) ? goal.maxTorque[j] : ((drive < -goal.maxTorque[j]) ? -goal.maxTorque[j] : drive);
+        tau[j] = status.torque[j] = drive;
+      }
+      if (done && !(status.contact & bit))
+      {
+        status.settled |= bit;
+      }
+    }
+    return status;
+  }
+};
+
+#endif
@@ -0,0 +1,214 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_allegro_shm.h
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Shared-memory transport between CrpiAllegro and the Allegro hand server.
+//  Self-contained so that the hand server can include it without CRPI.
+//
+//  The hand server owns the segment:  it creates it with key ALLEGRO_SHM_KEY
+//  and size sizeof(allegroShared), zeroes it, and stores ALLEGRO_SHM_MAGIC in
+//  magic last.  It then pops commands with allegro_pop_command (each one is
+//  exactly the text it would have read from the config or params socket) and
+//  publishes a state record with allegro_publish_state every control cycle.
+//  CrpiAllegro falls back to the loopback sockets if no server has published
+//  the segment.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef ALLEGRO_SHM_H
+#define ALLEGRO_SHM_H
+
+#include <atomic>
+#include <string.h>
+
+//! Shared memory key of the hand server's segment
+#define ALLEGRO_SHM_KEY 6008
+
+//! Marks a segment that has been initialized by the hand server ("ALGR")
+#define ALLEGRO_SHM_MAGIC 0x414C4752
+
+//! Layout version of allegroShared
+#define ALLEGRO_SHM_VERSION 1
+
+//! Number of hand joints
+#define ALLEGRO_JOINTS 16
+
+//! Longest command text, including the terminator
+#define ALLEGRO_TEXT_MAX 512
+
+//! Ring sizes (powers of two)
+#define ALLEGRO_COMMAND_SLOTS 64
+#define ALLEGRO_STATE_SLOTS 8
+
+//! Command channels, matching the config (6008) and params (6009) sockets
+#define ALLEGRO_CHANNEL_CONFIG 0
+#define ALLEGRO_CHANNEL_PARAMS 1
+
+//! @brief One command message
+//!
+struct allegroCommand
+{
+  //! @brief ALLEGRO_CHANNEL_CONFIG or ALLEGRO_CHANNEL_PARAMS
+  //!
+  unsigned int channel;
+
+  //! @brief Null-terminated command text
+  //!
+  char text[ALLEGRO_TEXT_MAX];
+};
+
+//! @brief One hand state record
+//!
+struct allegroState
+{
+  //! @brief Joint angles
+  //!
+  double joints[ALLEGRO_JOINTS];
+
+  //! @brief Cartesian fingertip force (x, y, z)
+  //!
+  double force[3];
+
+  //! @brief Cartesian pose (x, y, z, xrot, yrot, zrot)
+  //!
+  double pose[6];
+
+  //! @brief Hand server time stamp (s)
+  //!
+  double timestamp;
+};
+
+//! @brief State ring slot; seq is odd while the server is writing it
+//!
+struct allegroStateSlot
+{
+  std::atomic<unsigned int> seq;
+  allegroState state;
+};
+
+//! @brief Layout of the shared memory segment
+//!
+//! @note The command ring has a single producer (CrpiAllegro) and a single consumer (the hand
+//!       server).  The state ring has a single producer (the hand server) and any number of
+//!       readers, which only ever look at the newest record.
+//!
+struct allegroShared
+{
+  std::atomic<unsigned int> magic;
+  unsigned int version;
+
+  //! @brief Commands pushed so far (written by CrpiAllegro)
+  //!
+  std::atomic<unsigned int> commandHead;
+
+  //! @brief Commands consumed so far (written by the hand server)
+  //!
+  std::atomic<unsigned int> commandTail;
+
+  allegroCommand commands[ALLEGRO_COMMAND_SLOTS];
+
+  //! @brief State records published so far (written by the hand server)
+  //!
+  std::atomic<unsigned int> stateHead;
+
+  allegroStateSlot states[ALLEGRO_STATE_SLOTS];
+};
+
+//! @brief Queue a command for the hand server
+//!
+//! @param shm     Shared segment
+//! @param channel ALLEGRO_CHANNEL_CONFIG or ALLEGRO_CHANNEL_PARAMS
+//! @param text    Command text (truncated to ALLEGRO_TEXT_MAX - 1 characters)
+//!
+//! @return False if the ring is full
+//!
+inline bool allegro_push_command (allegroShared *shm, unsigned int channel, const char *text)
+{
+  unsigned int head = shm->commandHead.load(std::memory_order_relaxed);
+  allegroCommand *cmd;
+
+  if (head - shm->commandTail.load(std::memory_order_acquire) >= ALLEGRO_COMMAND_SLOTS)
+  {
+    return false;
+  }
+
+  cmd = &shm->commands[head & (ALLEGRO_COMMAND_SLOTS - 1)];
+  cmd->channel = channel;
+  strncpy(cmd->text, text, ALLEGRO_TEXT_MAX - 1);
+  cmd->text[ALLEGRO_TEXT_MAX - 1] = '\0';
+  shm->commandHead.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+//! @brief Take the oldest queued command (hand server side)
+//!
+//! @param shm Shared segment
+//! @param cmd Destination of the command
+//!
+//! @return False if no command is queued
+//!
+inline bool allegro_pop_command (allegroShared *shm, allegroCommand &cmd)
+{
+  unsigned int tail = shm->commandTail.load(std::memory_order_relaxed);
+
+  if (tail == shm->commandHead.load(std::memory_order_acquire))
+  {
+    return false;
+  }
+
+  memcpy(&cmd, &shm->commands[tail & (ALLEGRO_COMMAND_SLOTS - 1)], sizeof(allegroCommand));
+  shm->commandTail.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+//! @brief Publish a new state record (hand server side)
+//!
+inline void allegro_publish_state (allegroShared *shm, const allegroState &state)
+{
+  unsigned int head = shm->stateHead.load(std::memory_order_relaxed);
+  allegroStateSlot *slot = &shm->states[head & (ALLEGRO_STATE_SLOTS - 1)];
+  unsigned int s = slot->seq.load(std::memory_order_relaxed);
+
+  slot->seq.store(s + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy((void*)&slot->state, (const void*)&state, sizeof(allegroState));
+  slot->seq.store(s + 2, std::memory_order_release);
+  shm->stateHead.store(head + 1, std::memory_order_release);
+}
+
+//! @brief Copy the newest state record
+//!
+//! @param shm   Shared segment
+//! @param state Destination of the copy
+//!
+//! @return Number of records published so far (0 if none, in which case state is untouched)
+//!
+inline unsigned int allegro_latest_state (allegroShared *shm, allegroState &state)
+{
+  unsigned int head, s1, s2;
+  allegroStateSlot *slot;
+
+  do
+  {
+    head = shm->stateHead.load(std::memory_order_acquire);
+    if (head == 0)
+    {
+      return 0;
+    }
+    slot = &shm->states[(head - 1) & (ALLEGRO_STATE_SLOTS - 1)];
+    s1 = slot->seq.load(std::memory_order_acquire);
+    memcpy((void*)&state, (const void*)&slot->state, sizeof(allegroState));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    s2 = slot->seq.load(std::memory_order_relaxed);
+  } while ((s1 & 1) || (s1 != s2));
+
+  return head;
+}
+
+#endif
@@ -0,0 +1,285 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_alloc.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Heap allocation tracking definitions.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_alloc.h"
+#include "crpi_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+namespace crpi_robot
+{
+  //! @brief What a violation does
+  //!
+  enum allocMode
+  {
+    ALLOC_OFF = 0,
+    ALLOC_LOG,
+    ALLOC_ABORT
+  };
+
+  static std::atomic<int> allocMode(ALLOC_LOG);
+  static std::atomic<unsigned long long> allocWarmup(100);
+  static std::atomic<unsigned long long> allocViolations(0);
+  static std::atomic<crpiAllocSite*> allocSites(NULL);
+
+  //! @brief The calling thread's counters.  Plain values, so that reaching them from operator
+  //!        new neither allocates nor runs a constructor.
+  //!
+  //! allocArmed counts the warmed-up scopes the thread is in, and allocPaused is set while a
+  //! scope reports (the log's first message on a thread allocates its ring).
+  //!
+  static thread_local unsigned long long allocCount = 0;
+  static thread_local unsigned long long allocFrees = 0;
+  static thread_local unsigned long long allocBlamed = 0;
+  static thread_local int allocArmed = 0;
+  static thread_local bool allocPaused = false;
+
+
+  //! @brief Count an allocation by the calling thread
+  //!
+  static inline void allocNoted ()
+  {
+    if (allocPaused)
+    {
+      return;
+    }
+    ++allocCount;
+    if (allocArmed > 0 && allocMode.load(std::memory_order_relaxed) == ALLOC_ABORT)
+    {
+      //! Not through the log:  its thread will not get to run
+      fprintf(stderr, "CRPI:  heap allocation inside a CRPI_NO_ALLOC_SCOPE\n");
+      abort();
+    }
+  }
+
+
+  LIBRARY_API crpiAllocSite::crpiAllocSite (const char *siteName) :
+    name(siteName),
+    passes(0),
+    violations(0)
+  {
+    next = allocSites.load(std::memory_order_relaxed);
+    while (!allocSites.compare_exchange_weak(next, this, std::memory_order_release,
+                                             std::memory_order_relaxed))
+    {
+    }
+  }
+
+
+  LIBRARY_API CrpiNoAllocScope::CrpiNoAllocScope (crpiAllocSite &site) :
+    site_(site),
+    allocations_(allocCount),
+    blamed_(allocBlamed)
+  {
+    armed_ = (site.passes.fetch_add(1, std::memory_order_relaxed) >=
+              allocWarmup.load(std::memory_order_relaxed)) &&
+             allocMode.load(std::memory_order_relaxed) != ALLOC_OFF;
+    if (armed_)
+    {
+      ++allocArmed;
+    }
+  }
+
+
+  LIBRARY_API CrpiNoAllocScope::~CrpiNoAllocScope ()
+  {
+    unsigned long long count;
+
+    if (!armed_)
+    {
+      return;
+    }
+    --allocArmed;
+
+    //! Allocations already blamed on a scope nested in this one are not counted again
+    count = (allocCount - allocations_) - (allocBlamed - blamed_);
+    if (count == 0)
+    {
+      return;
+    }
+    allocBlamed += count;
+    allocViolations.fetch_add(count, std::memory_order_relaxed);
+    if (site_.violations.fetch_add(count, std::memory_order_relaxed) == 0)
+    {
+      allocPaused = true;
+      CRPI_LOG(CRPI_LOG_WARNING, "CrpiAlloc:  %llu heap allocation(s) in no-allocation scope %s",
+               count, site_.name);
+      allocPaused = false;
+    }
+  }
+
+
+  LIBRARY_API bool CrpiAlloc::Tracking ()
+  {
+#ifdef CRPI_ALLOC_TRACKING
+    return true;
+#else
+    return false;
+#endif
+  }
+
+
+  LIBRARY_API unsigned long long CrpiAlloc::Allocations ()
+  {
+    return allocCount;
+  }
+
+
+  LIBRARY_API unsigned long long CrpiAlloc::Frees ()
+  {
+    return allocFrees;
+  }
+
+
+  LIBRARY_API unsigned long long CrpiAlloc::Violations ()
+  {
+    return allocViolations.load(std::memory_order_relaxed);
+  }
+
+
+  LIBRARY_API void CrpiAlloc::SetAbort (bool abort)
+  {
+    allocMode.store(abort ? ALLOC_ABORT : ALLOC_LOG, std::memory_order_relaxed);
+  }
+
+
+  LIBRARY_API void CrpiAlloc::SetWarmup (unsigned long long passes)
+  {
+    allocWarmup.store(passes, std::memory_order_relaxed);
+  }
+
+
+  LIBRARY_API void CrpiAlloc::Report ()
+  {
+    crpiAllocSite *site;
+    unsigned long long violations;
+
+    for (site = allocSites.load(std::memory_order_acquire); site != NULL; site = site->next)
+    {
+      violations = site->violations.load(std::memory_order_relaxed);
+      if (violations > 0)
+      {
+        CRPI_LOG(CRPI_LOG_WARNING, "CrpiAlloc:  %s:  %llu heap allocation(s) in %llu passes", site->name,
+                 violations, site->passes.load(std::memory_order_relaxed));
+      }
+    }
+  }
+
+
+  //! @brief Reads CRPI_ALLOC and CRPI_ALLOC_WARMUP when the library is loaded
+  //!
+  struct allocEnvironment
+  {
+    allocEnvironment ()
+    {
+      const char *setting = getenv("CRPI_ALLOC");
+      if (setting != NULL)
+      {
+        if (strcmp(setting, "off") == 0)
+        {
+          allocMode.store(ALLOC_OFF, std::memory_order_relaxed);
+        }
+        else if (strcmp(setting, "abort") == 0)
+        {
+          allocMode.store(ALLOC_ABORT, std::memory_order_relaxed);
+        }
+      }
+
+      setting = getenv("CRPI_ALLOC_WARMUP");
+      if (setting != NULL && setting[0] != '\0')
+      {
+        allocWarmup.store(strtoull(setting, NULL, 10), std::memory_order_relaxed);
+      }
+    }
+  };
+
+  static allocEnvironment allocStartup;
+} // namespace crpi_robot
+
+
+#ifdef CRPI_ALLOC_TRACKING
+//! The replaceable global allocation functions, counting into the calling thread's counters
+
+void *operator new (size_t size)
+{
+  void *p;
+
+  crpi_robot::allocNoted();
+  while ((p = malloc((size == 0) ? 1 : size)) == NULL)
+  {
+    std::new_handler handler = std::get_new_handler();
+    if (handler == NULL)
+    {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+  return p;
+}
+
+
+void *operator new[] (size_t size)
+{
+  return operator new(size);
+}
+
+
+void *operator new (size_t size, const std::nothrow_t &) noexcept
+{
+  try
+  {
+    return operator new(size);
+  }
+  catch (...)
+  {
+    return NULL;
+  }
+}
+
+
+void *operator new[] (size_t size, const std::nothrow_t &) noexcept
+{
+  return operator new(size, std::nothrow);
+}
+
+
+void operator delete (void *p) noexcept
+{
+  if (p != NULL)
+  {
+    ++crpi_robot::allocFrees;
+    free(p);
+  }
+}
+
+
+void operator delete[] (void *p) noexcept
+{
+  operator delete(p);
+}
+
+
+void operator delete (void *p, const std::nothrow_t &) noexcept
+{
+  operator delete(p);
+}
+
+
+void operator delete[] (void *p, const std::nothrow_t &) noexcept
+{
+  operator delete(p);
+}
+#endif
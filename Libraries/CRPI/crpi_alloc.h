@@ -0,0 +1,134 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_alloc.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Heap allocation tracking for the real-time paths.
+//
+//  Built with CRPI_ALLOC_TRACKING defined (the CMake option of the same
+//  name), CRPI replaces the global operator new and delete with versions
+//  that count each thread's allocations, and CRPI_NO_ALLOC_SCOPE(name)
+//  marks a block that must not allocate:  a feedback thread's iteration,
+//  GetRobotPose, ToWorld, a sensor callback.  Each site is allowed a number
+//  of passes to warm up (fill its caches, claim its rings); an allocation
+//  inside it after that is a violation.  Violations are logged, once per
+//  site and then only counted, or abort the process at the allocation so
+//  that a test fails with the offending call on the stack.  Without
+//  CRPI_ALLOC_TRACKING the scopes compile to nothing.
+//
+//  CRPI_ALLOC in the environment is "log" (the default), "abort", or "off",
+//  and CRPI_ALLOC_WARMUP is the number of passes each site is allowed to
+//  warm up (100 by default).
+//
+//  On Windows a DLL's operator new replaces only the DLL's own, so there
+//  only allocations made inside CRPI are seen.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_alloc_H
+#define crpi_alloc_H
+
+#include "crpi.h"
+#include <atomic>
+
+#define CRPI_ALLOC_CAT2(a, b) a##b
+#define CRPI_ALLOC_CAT(a, b) CRPI_ALLOC_CAT2(a, b)
+
+//! @brief Check that the rest of the enclosing block does not allocate once warmed up.  The
+//!        name must be a string literal.
+//!
+#ifdef CRPI_ALLOC_TRACKING
+#define CRPI_NO_ALLOC_SCOPE(name)                                                        \
+  static crpi_robot::crpiAllocSite CRPI_ALLOC_CAT(crpiAllocSite_, __LINE__)(name);       \
+  crpi_robot::CrpiNoAllocScope CRPI_ALLOC_CAT(crpiAllocScope_, __LINE__)(CRPI_ALLOC_CAT(crpiAllocSite_, __LINE__))
+#else
+#define CRPI_NO_ALLOC_SCOPE(name) do {} while (false)
+#endif
+
+namespace crpi_robot
+{
+  //! @brief One CRPI_NO_ALLOC_SCOPE in the source, shared by every thread that enters it
+  //!
+  struct LIBRARY_API crpiAllocSite
+  {
+    const char *name;
+
+    //! @brief Times the scope was entered, and allocations made in it after warm-up
+    //!
+    std::atomic<unsigned long long> passes;
+    std::atomic<unsigned long long> violations;
+
+    //! @brief Next site in the process-wide list (sites are never removed)
+    //!
+    crpiAllocSite *next;
+
+    crpiAllocSite (const char *siteName);
+  };
+
+  //! @ingroup Robot
+  //!
+  //! @brief Checks one pass through a CRPI_NO_ALLOC_SCOPE (use the macro)
+  //!
+  class LIBRARY_API CrpiNoAllocScope
+  {
+  public:
+    CrpiNoAllocScope (crpiAllocSite &site);
+    ~CrpiNoAllocScope ();
+
+  private:
+    crpiAllocSite &site_;
+
+    //! @brief The thread's allocations, and those already blamed on inner scopes, on entry
+    //!
+    unsigned long long allocations_;
+    unsigned long long blamed_;
+
+    //! @brief Whether the site had warmed up on entry
+    //!
+    bool armed_;
+
+    CrpiNoAllocScope (const CrpiNoAllocScope &) = delete;
+    CrpiNoAllocScope &operator= (const CrpiNoAllocScope &) = delete;
+  }; // CrpiNoAllocScope
+
+  //! @ingroup Robot
+  //!
+  //! @brief Process-wide allocation tracking control and counters
+  //!
+  class LIBRARY_API CrpiAlloc
+  {
+  public:
+    //! @brief Whether CRPI was built with CRPI_ALLOC_TRACKING (all counts are 0 otherwise)
+    //!
+    static bool Tracking ();
+
+    //! @brief Heap allocations and frees made so far by the calling thread
+    //!
+    static unsigned long long Allocations ();
+    static unsigned long long Frees ();
+
+    //! @brief Allocations made inside warmed-up scopes, over all sites
+    //!
+    static unsigned long long Violations ();
+
+    //! @brief Abort at an allocation inside a warmed-up scope, rather than logging it
+    //!
+    static void SetAbort (bool abort);
+
+    //! @brief Passes each site is allowed before its allocations are violations.  Sites that
+    //!        have already warmed up are not affected.
+    //!
+    static void SetWarmup (unsigned long long passes);
+
+    //! @brief Log every site that has had a violation, with its counts
+    //!
+    static void Report ();
+  }; // CrpiAlloc
+} // namespace crpi_robot
+
+#endif
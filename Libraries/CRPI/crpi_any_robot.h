@@ -0,0 +1,860 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_any_robot.h
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Type-erased handle to a CrpiRobot of any robot type.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_any_robot_H
+#define crpi_any_robot_H
+
+#include "crpi_robot.h"
+
+namespace crpi_robot
+{
+  //! @brief Table of CrpiRobot methods, one entry per method (overloads get their own entry).
+  //!        Each entry takes the CrpiRobot as its first argument.
+  //!
+  struct AnyCrpiRobotOps
+  {
+    CanonReturn (*applyCartesianForceTorque) (void *, robotPose &, const vector<bool> &, const vector<bool> &);
+    CanonReturn (*applyJointTorque) (void *, robotAxes &);
+    CanonReturn (*couple) (void *, const char *);
+    CanonReturn (*getRobotAxes) (void *, robotAxes *);
+    CanonReturn (*getRobotForces) (void *, robotPose *);
+    CanonReturn (*getRobotIO) (void *, robotIO *);
+    CanonReturn (*getRobotPose) (void *, robotPose *);
+    CanonReturn (*getRobotSpeedPose) (void *, robotPose *);
+    CanonReturn (*getRobotSpeedAxes) (void *, robotAxes *);
+    CanonReturn (*getRobotTorques) (void *, robotAxes *);
+    CanonReturn (*getRobotState) (void *, RobotStateSnapshot *);
+    CanonReturn (*getPredictedState) (void *, RobotStateSnapshot *, double);
+    CanonReturn (*message) (void *, const char *);
+    CanonReturn (*moveAttractor) (void *, robotPose &);
+    CanonReturn (*moveStraightTo) (void *, robotPose &, bool);
+    CanonReturn (*moveThroughTo) (void *, robotPose *, int, robotPose *, robotPose *, robotPose *);
+    CanonReturn (*moveTo) (void *, robotPose &, bool);
+    CanonReturn (*moveToAxisTarget) (void *, robotAxes &, bool);
+    CanonReturn (*beginStream) (void *);
+    CanonReturn (*streamPose) (void *, robotPose &);
+    CanonReturn (*streamAxes) (void *, robotAxes &);
+    CanonReturn (*endStream) (void *);
+    CanonReturn (*beginWrenchStream) (void *);
+    CanonReturn (*streamWrench) (void *, robotPose &, const vector<bool> &, robotPose &);
+    CanonReturn (*endWrenchStream) (void *);
+    CanonReturn (*setAbsoluteAcceleration) (void *, double);
+    CanonReturn (*setAbsoluteSpeed) (void *, double);
+    CanonReturn (*setAngleUnits) (void *, const char *);
+    CanonReturn (*setAxialSpeeds) (void *, double *);
+    CanonReturn (*setAxialUnits) (void *, const char **);
+    CanonReturn (*setEndPoseTolerance) (void *, robotPose &);
+    CanonReturn (*setIntermediatePoseTolerance) (void *, robotPose *);
+    CanonReturn (*setLengthUnits) (void *, const char *);
+    CanonReturn (*setParameter) (void *, const char *, void *);
+    CanonReturn (*setRelativeAcceleration) (void *, double);
+    CanonReturn (*setRelativeSpeed) (void *, double);
+    CanonReturn (*setRobotIO) (void *, robotIO &);
+    CanonReturn (*setRobotDO) (void *, int, bool);
+    CanonReturn (*setTool) (void *, double);
+    CanonReturn (*stopMotion) (void *, int);
+    CanonReturn (*crclXmlHandler) (void *, std::string &);
+    CanonReturn (*crclXmlResponseText) (void *, char *);
+    CanonReturn (*crclXmlResponse) (void *, CrpiXmlWriter &);
+    CanonReturn (*crpiXmlHandler) (void *, std::string &);
+    CanonReturn (*crpiXmlResponseText) (void *, char *);
+    CanonReturn (*crpiXmlResponse) (void *, CrpiXmlWriter &);
+    CanonReturn (*crpiBinaryHandler) (void *, const char *, size_t);
+    CanonReturn (*crpiBinaryResponse) (void *, char *, size_t, size_t &);
+    CanonReturn (*loadProgram) (void *, const std::string &, CrpiCompiledProgram &, bool);
+    CanonReturn (*runProgram) (void *, CrpiCompiledProgram &);
+    CanonReturn (*compileNative) (void *, CrpiCompiledProgram &, std::string &);
+    CanonReturn (*runNative) (void *, CrpiCompiledProgram &);
+    CrpiCompletion (*moveToAsync) (void *, robotPose &);
+    CrpiCompletion (*moveStraightToAsync) (void *, robotPose &);
+    CrpiCompletion (*moveToAxisTargetAsync) (void *, robotAxes &);
+    CrpiCompletion (*moveThroughToAsync) (void *, robotPose *, int, robotPose *, robotPose *, robotPose *);
+    CrpiCompletion (*setToolAsync) (void *, double);
+    CrpiCompletion (*setRobotIOAsync) (void *, robotIO &);
+    CrpiCompletion (*setRobotDOAsync) (void *, int, bool);
+    CrpiCompletion (*callAsync) (void *, std::function<CanonReturn ()>);
+    CanonReturn (*toWorldMatrix) (void *, matrix &);
+  };
+
+
+  //! @brief The method table of CrpiRobot<T>, generated at compile time
+  //!
+  template <class T> struct AnyCrpiRobotTable
+  {
+    static const AnyCrpiRobotOps ops;
+
+    static CanonReturn applyCartesianForceTorque (void *robot, robotPose &robotForceTorque, const vector<bool> &activeAxes, const vector<bool> &manipulator)
+    {
+      return ((CrpiRobot<T>*)robot)->ApplyCartesianForceTorque(robotForceTorque, activeAxes, manipulator);
+    }
+
+    static CanonReturn applyJointTorque (void *robot, robotAxes &robotJointTorque)
+    {
+      return ((CrpiRobot<T>*)robot)->ApplyJointTorque(robotJointTorque);
+    }
+
+    static CanonReturn couple (void *robot, const char *targetID)
+    {
+      return ((CrpiRobot<T>*)robot)->Couple(targetID);
+    }
+
+    static CanonReturn getRobotAxes (void *robot, robotAxes *axes)
+    {
+      return ((CrpiRobot<T>*)robot)->GetRobotAxes(axes);
+    }
+
+    static CanonReturn getRobotForces (void *robot, robotPose *forces)
+    {
+      return ((CrpiRobot<T>*)robot)->GetRobotForces(forces);
+    }
+
+    static CanonReturn getRobotIO (void *robot, robotIO *io)
+    {
+      return ((CrpiRobot<T>*)robot)->GetRobotIO(io);
+    }
+
+    static CanonReturn getRobotPose (void *robot, robotPose *pose)
+    {
+      return ((CrpiRobot<T>*)robot)->GetRobotPose(pose);
+    }
+
+    static CanonReturn getRobotSpeedPose (void *robot, robotPose *speed)
+    {
+      return ((CrpiRobot<T>*)robot)->GetRobotSpeed(speed);
+    }
+
+    static CanonReturn getRobotSpeedAxes (void *robot, robotAxes *speed)
+    {
+      return ((CrpiRobot<T>*)robot)->GetRobotSpeed(speed);
+    }
+
+    static CanonReturn getRobotTorques (void *robot, robotAxes *torques)
+    {
+      return ((CrpiRobot<T>*)robot)->GetRobotTorques(torques);
+    }
+
+    static CanonReturn getRobotState (void *robot, RobotStateSnapshot *state)
+    {
+      return ((CrpiRobot<T>*)robot)->GetRobotState(state);
+    }
+
+    static CanonReturn getPredictedState (void *robot, RobotStateSnapshot *state, double lead)
+    {
+      return ((CrpiRobot<T>*)robot)->GetPredictedState(state, lead);
+    }
+
+    static CanonReturn message (void *robot, const char *message)
+    {
+      return ((CrpiRobot<T>*)robot)->Message(message);
+    }
+
+    static CanonReturn moveAttractor (void *robot, robotPose &pose)
+    {
+      return ((CrpiRobot<T>*)robot)->MoveAttractor(pose);
+    }
+
+    static CanonReturn moveStraightTo (void *robot, robotPose &pose, bool useBlocking)
+    {
+      return ((CrpiRobot<T>*)robot)->MoveStraightTo(pose, useBlocking);
+    }
+
+    static CanonReturn moveThroughTo (void *robot, robotPose *poses, int numPoses, robotPose *accelerations, robotPose *speeds, robotPose *tolerances)
+    {
+      return ((CrpiRobot<T>*)robot)->MoveThroughTo(poses, numPoses, accelerations, speeds, tolerances);
+    }
+
+    static CanonReturn moveTo (void *robot, robotPose &pose, bool useBlocking)
+    {
+      return ((CrpiRobot<T>*)robot)->MoveTo(pose, useBlocking);
+    }
+
+    static CanonReturn moveToAxisTarget (void *robot, robotAxes &axes, bool useBlocking)
+    {
+      return ((CrpiRobot<T>*)robot)->MoveToAxisTarget(axes, useBlocking);
+    }
+
+    static CanonReturn beginStream (void *robot)
+    {
+      return ((CrpiRobot<T>*)robot)->BeginStream();
+    }
+
+    static CanonReturn streamPose (void *robot, robotPose &pose)
+    {
+      return ((CrpiRobot<T>*)robot)->StreamPose(pose);
+    }
+
+    static CanonReturn streamAxes (void *robot, robotAxes &axes)
+    {
+      return ((CrpiRobot<T>*)robot)->StreamAxes(axes);
+    }
+
+    static CanonReturn endStream (void *robot)
+    {
+      return ((CrpiRobot<T>*)robot)->EndStream();
+    }
+
+    static CanonReturn beginWrenchStream (void *robot)
+    {
+      return ((CrpiRobot<T>*)robot)->BeginWrenchStream();
+    }
+
+    static CanonReturn streamWrench (void *robot, robotPose &wrench, const vector<bool> &activeAxes, robotPose &limits)
+    {
+      return ((CrpiRobot<T>*)robot)->StreamWrench(wrench, activeAxes, limits);
+    }
+
+    static CanonReturn endWrenchStream (void *robot)
+    {
+      return ((CrpiRobot<T>*)robot)->EndWrenchStream();
+    }
+
+    static CanonReturn setAbsoluteAcceleration (void *robot, double acceleration)
+    {
+      return ((CrpiRobot<T>*)robot)->SetAbsoluteAcceleration(acceleration);
+    }
+
+    static CanonReturn setAbsoluteSpeed (void *robot, double speed)
+    {
+      return ((CrpiRobot<T>*)robot)->SetAbsoluteSpeed(speed);
+    }
+
+    static CanonReturn setAngleUnits (void *robot, const char *unitName)
+    {
+      return ((CrpiRobot<T>*)robot)->SetAngleUnits(unitName);
+    }
+
+    static CanonReturn setAxialSpeeds (void *robot, double *speeds)
+    {
+      return ((CrpiRobot<T>*)robot)->SetAxialSpeeds(speeds);
+    }
+
+    static CanonReturn setAxialUnits (void *robot, const char **unitNames)
+    {
+      return ((CrpiRobot<T>*)robot)->SetAxialUnits(unitNames);
+    }
+
+    static CanonReturn setEndPoseTolerance (void *robot, robotPose &tolerance)
+    {
+      return ((CrpiRobot<T>*)robot)->SetEndPoseTolerance(tolerance);
+    }
+
+    static CanonReturn setIntermediatePoseTolerance (void *robot, robotPose *tolerances)
+    {
+      return ((CrpiRobot<T>*)robot)->SetIntermediatePoseTolerance(tolerances);
+    }
+
+    static CanonReturn setLengthUnits (void *robot, const char *unitName)
+    {
+      return ((CrpiRobot<T>*)robot)->SetLengthUnits(unitName);
+    }
+
+    static CanonReturn setParameter (void *robot, const char *paramName, void *paramVal)
+    {
+      return ((CrpiRobot<T>*)robot)->SetParameter(paramName, paramVal);
+    }
+
+    static CanonReturn setRelativeAcceleration (void *robot, double percent)
+    {
+      return ((CrpiRobot<T>*)robot)->SetRelativeAcceleration(percent);
+    }
+
+    static CanonReturn setRelativeSpeed (void *robot, double percent)
+    {
+      return ((CrpiRobot<T>*)robot)->SetRelativeSpeed(percent);
+    }
+
+    static CanonReturn setRobotIO (void *robot, robotIO &io)
+    {
+      return ((CrpiRobot<T>*)robot)->SetRobotIO(io);
+    }
+
+    static CanonReturn setRobotDO (void *robot, int dig_out, bool val)
+    {
+      return ((CrpiRobot<T>*)robot)->SetRobotDO(dig_out, val);
+    }
+
+    static CanonReturn setTool (void *robot, double percent)
+    {
+      return ((CrpiRobot<T>*)robot)->SetTool(percent);
+    }
+
+    static CanonReturn stopMotion (void *robot, int condition)
+    {
+      return ((CrpiRobot<T>*)robot)->StopMotion(condition);
+    }
+
+    static CanonReturn crclXmlHandler (void *robot, std::string &str)
+    {
+      return ((CrpiRobot<T>*)robot)->CrclXmlHandler(str);
+    }
+
+    static CanonReturn crclXmlResponseText (void *robot, char *str)
+    {
+      return ((CrpiRobot<T>*)robot)->CrclXmlResponse(str);
+    }
+
+    static CanonReturn crclXmlResponse (void *robot, CrpiXmlWriter &out)
+    {
+      return ((CrpiRobot<T>*)robot)->CrclXmlResponse(out);
+    }
+
+    static CanonReturn crpiXmlHandler (void *robot, std::string &str)
+    {
+      return ((CrpiRobot<T>*)robot)->CrpiXmlHandler(str);
+    }
+
+    static CanonReturn crpiXmlResponseText (void *robot, char *str)
+    {
+      return ((CrpiRobot<T>*)robot)->CrpiXmlResponse(str);
+    }
+
+    static CanonReturn crpiXmlResponse (void *robot, CrpiXmlWriter &out)
+    {
+      return ((CrpiRobot<T>*)robot)->CrpiXmlResponse(out);
+    }
+
+    static CanonReturn crpiBinaryHandler (void *robot, const char *buf, size_t len)
+    {
+      return ((CrpiRobot<T>*)robot)->CrpiBinaryHandler(buf, len);
+    }
+
+    static CanonReturn crpiBinaryResponse (void *robot, char *buf, size_t max, size_t &len)
+    {
+      return ((CrpiRobot<T>*)robot)->CrpiBinaryResponse(buf, max, len);
+    }
+
+    static CanonReturn loadProgram (void *robot, const std::string &xml, CrpiCompiledProgram &program, bool worldFrame)
+    {
+      return ((CrpiRobot<T>*)robot)->LoadProgram(xml, program, worldFrame);
+    }
+
+    static CanonReturn runProgram (void *robot, CrpiCompiledProgram &program)
+    {
+      return ((CrpiRobot<T>*)robot)->RunProgram(program);
+    }
+
+    static CanonReturn compileNative (void *robot, CrpiCompiledProgram &program, std::string &text)
+    {
+      return ((CrpiRobot<T>*)robot)->CompileNative(program, text);
+    }
+
+    static CanonReturn runNative (void *robot, CrpiCompiledProgram &program)
+    {
+      return ((CrpiRobot<T>*)robot)->RunNative(program);
+    }
+
+    static CrpiCompletion moveToAsync (void *robot, robotPose &pose)
+    {
+      return ((CrpiRobot<T>*)robot)->MoveToAsync(pose);
+    }
+
+    static CrpiCompletion moveStraightToAsync (void *robot, robotPose &pose)
+    {
+      return ((CrpiRobot<T>*)robot)->MoveStraightToAsync(pose);
+    }
+
+    static CrpiCompletion moveToAxisTargetAsync (void *robot, robotAxes &axes)
+    {
+      return ((CrpiRobot<T>*)robot)->MoveToAxisTargetAsync(axes);
+    }
+
+    static CrpiCompletion moveThroughToAsync (void *robot, robotPose *poses, int numPoses, robotPose *accelerations, robotPose *speeds, robotPose *tolerances)
+    {
+      return ((CrpiRobot<T>*)robot)->MoveThroughToAsync(poses, numPoses, accelerations, speeds, tolerances);
+    }
+
+    static CrpiCompletion setToolAsync (void *robot, double percent)
+    {
+      return ((CrpiRobot<T>*)robot)->SetToolAsync(percent);
+    }
+
+    static CrpiCompletion setRobotIOAsync (void *robot, robotIO &io)
+    {
+      return ((CrpiRobot<T>*)robot)->SetRobotIOAsync(io);
+    }
+
+    static CrpiCompletion setRobotDOAsync (void *robot, int dig_out, bool val)
+    {
+      return ((CrpiRobot<T>*)robot)->SetRobotDOAsync(dig_out, val);
+    }
+
+    static CrpiCompletion callAsync (void *robot, std::function<CanonReturn ()> command)
+    {
+      return ((CrpiRobot<T>*)robot)->CallAsync(command);
+    }
+
+    static CanonReturn toWorldMatrix (void *robot, matrix &R_T_W)
+    {
+      return ((CrpiRobot<T>*)robot)->ToWorldMatrix(R_T_W);
+    }
+  };
+
+
+  template <class T> const AnyCrpiRobotOps AnyCrpiRobotTable<T>::ops =
+  {
+    &AnyCrpiRobotTable<T>::applyCartesianForceTorque,
+    &AnyCrpiRobotTable<T>::applyJointTorque,
+    &AnyCrpiRobotTable<T>::couple,
+    &AnyCrpiRobotTable<T>::getRobotAxes,
+    &AnyCrpiRobotTable<T>::getRobotForces,
+    &AnyCrpiRobotTable<T>::getRobotIO,
+    &AnyCrpiRobotTable<T>::getRobotPose,
+    &AnyCrpiRobotTable<T>::getRobotSpeedPose,
+    &AnyCrpiRobotTable<T>::getRobotSpeedAxes,
+    &AnyCrpiRobotTable<T>::getRobotTorques,
+    &AnyCrpiRobotTable<T>::getRobotState,
+    &AnyCrpiRobotTable<T>::getPredictedState,
+    &AnyCrpiRobotTable<T>::message,
+    &AnyCrpiRobotTable<T>::moveAttractor,
+    &AnyCrpiRobotTable<T>::moveStraightTo,
+    &AnyCrpiRobotTable<T>::moveThroughTo,
+    &AnyCrpiRobotTable<T>::moveTo,
+    &AnyCrpiRobotTable<T>::moveToAxisTarget,
+    &AnyCrpiRobotTable<T>::beginStream,
+    &AnyCrpiRobotTable<T>::streamPose,
+    &AnyCrpiRobotTable<T>::streamAxes,
+    &AnyCrpiRobotTable<T>::endStream,
+    &AnyCrpiRobotTable<T>::beginWrenchStream,
+    &AnyCrpiRobotTable<T>::streamWrench,
+    &AnyCrpiRobotTable<T>::endWrenchStream,
+    &AnyCrpiRobotTable<T>::setAbsoluteAcceleration,
+    &AnyCrpiRobotTable<T>::setAbsoluteSpeed,
+    &AnyCrpiRobotTable<T>::setAngleUnits,
+    &AnyCrpiRobotTable<T>::setAxialSpeeds,
+    &AnyCrpiRobotTable<T>::setAxialUnits,
+    &AnyCrpiRobotTable<T>::setEndPoseTolerance,
+    &AnyCrpiRobotTable<T>::setIntermediatePoseTolerance,
+    &AnyCrpiRobotTable<T>::setLengthUnits,
+    &AnyCrpiRobotTable<T>::setParameter,
+    &AnyCrpiRobotTable<T>::setRelativeAcceleration,
+    &AnyCrpiRobotTable<T>::setRelativeSpeed,
+    &AnyCrpiRobotTable<T>::setRobotIO,
+    &AnyCrpiRobotTable<T>::setRobotDO,
+    &AnyCrpiRobotTable<T>::setTool,
+    &AnyCrpiRobotTable<T>::stopMotion,
+    &AnyCrpiRobotTable<T>::crclXmlHandler,
+    &AnyCrpiRobotTable<T>::crclXmlResponseText,
+    &AnyCrpiRobotTable<T>::crclXmlResponse,
+    &AnyCrpiRobotTable<T>::crpiXmlHandler,
+    &AnyCrpiRobotTable<T>::crpiXmlResponseText,
+    &AnyCrpiRobotTable<T>::crpiXmlResponse,
+    &AnyCrpiRobotTable<T>::crpiBinaryHandler,
+    &AnyCrpiRobotTable<T>::crpiBinaryResponse,
+    &AnyCrpiRobotTable<T>::loadProgram,
+    &AnyCrpiRobotTable<T>::runProgram,
+    &AnyCrpiRobotTable<T>::compileNative,
+    &AnyCrpiRobotTable<T>::runNative,
+    &AnyCrpiRobotTable<T>::moveToAsync,
+    &AnyCrpiRobotTable<T>::moveStraightToAsync,
+    &AnyCrpiRobotTable<T>::moveToAxisTargetAsync,
+    &AnyCrpiRobotTable<T>::moveThroughToAsync,
+    &AnyCrpiRobotTable<T>::setToolAsync,
+    &AnyCrpiRobotTable<T>::setRobotIOAsync,
+    &AnyCrpiRobotTable<T>::setRobotDOAsync,
+    &AnyCrpiRobotTable<T>::callAsync,
+    &AnyCrpiRobotTable<T>::toWorldMatrix
+  };
+
+
+  //! @ingroup Robot
+  //!
+  //! @brief Non-owning handle to a CrpiRobot of any robot type
+  //!
+  //! @note The handle is a robot pointer and a pointer to that robot type's static method table,
+  //!       so code written against AnyCrpiRobot (servers, schedulers) is compiled once for all
+  //!       robot types instead of once per CrpiRobot<T>.  Calls cost one indirect call, the same
+  //!       as a virtual call, without adding a vtable to CrpiRobot.
+  //! @note Handles are cheap to copy.  The robot must outlive every handle to it.
+  //!
+  class AnyCrpiRobot
+  {
+  public:
+
+    //! @brief Default constructor, creates a handle to no robot
+    //!
+    AnyCrpiRobot () :
+      robot_(NULL),
+      ops_(NULL)
+    {
+    }
+
+    //! @brief Create a handle to a robot
+    //!
+    //! @param robot The robot to forward calls to
+    //!
+    template <class T> AnyCrpiRobot (CrpiRobot<T> *robot) :
+      robot_(robot),
+      ops_(&AnyCrpiRobotTable<T>::ops)
+    {
+    }
+
+    //! @brief Create a handle from a robot and its method table, for robots whose type is not
+    //!        known here (e.g., made by a driver module; see crpi_plugin.h)
+    //!
+    //! @param robot The robot, a CrpiRobot<T>
+    //! @param ops   AnyCrpiRobotTable<T>::ops of the same T
+    //!
+    AnyCrpiRobot (void *robot, const AnyCrpiRobotOps *ops) :
+      robot_((robot != NULL && ops != NULL) ? robot : NULL),
+      ops_(ops)
+    {
+    }
+
+    //! @brief Whether the handle refers to a robot
+    //!
+    bool valid () const
+    {
+      return robot_ != NULL;
+    }
+
+    //! @brief The robot this handle refers to, if it is a CrpiRobot<T>
+    //!
+    //! @return The robot, or NULL if the handle refers to a robot of a different type
+    //!
+    template <class T> CrpiRobot<T> *get () const
+    {
+      return (ops_ == &AnyCrpiRobotTable<T>::ops) ? (CrpiRobot<T>*)robot_ : NULL;
+    }
+
+    bool operator== (const AnyCrpiRobot &other) const
+    {
+      return robot_ == other.robot_;
+    }
+
+    bool operator!= (const AnyCrpiRobot &other) const
+    {
+      return robot_ != other.robot_;
+    }
+
+    //! @brief Forwarders to the CrpiRobot methods of the same name; see CrpiRobot for their
+    //!        arguments and results.  The handle must be valid().
+    //!
+    CanonReturn ApplyCartesianForceTorque (robotPose &robotForceTorque, const vector<bool> &activeAxes, const vector<bool> &manipulator) const
+    {
+      return ops_->applyCartesianForceTorque(robot_, robotForceTorque, activeAxes, manipulator);
+    }
+
+    CanonReturn ApplyJointTorque (robotAxes &robotJointTorque) const
+    {
+      return ops_->applyJointTorque(robot_, robotJointTorque);
+    }
+
+    CanonReturn Couple (const char *targetID) const
+    {
+      return ops_->couple(robot_, targetID);
+    }
+
+    CanonReturn GetRobotAxes (robotAxes *axes) const
+    {
+      return ops_->getRobotAxes(robot_, axes);
+    }
+
+    CanonReturn GetRobotForces (robotPose *forces) const
+    {
+      return ops_->getRobotForces(robot_, forces);
+    }
+
+    CanonReturn GetRobotIO (robotIO *io) const
+    {
+      return ops_->getRobotIO(robot_, io);
+    }
+
+    CanonReturn GetRobotPose (robotPose *pose) const
+    {
+      return ops_->getRobotPose(robot_, pose);
+    }
+
+    CanonReturn GetRobotSpeed (robotPose *speed) const
+    {
+      return ops_->getRobotSpeedPose(robot_, speed);
+    }
+
+    CanonReturn GetRobotSpeed (robotAxes *speed) const
+    {
+      return ops_->getRobotSpeedAxes(robot_, speed);
+    }
+
+    CanonReturn GetRobotTorques (robotAxes *torques) const
+    {
+      return ops_->getRobotTorques(robot_, torques);
+    }
+
+    CanonReturn GetRobotState (RobotStateSnapshot *state) const
+    {
+      return ops_->getRobotState(robot_, state);
+    }
+
+    CanonReturn GetPredictedState (RobotStateSnapshot *state, double lead = 0.0) const
+    {
+      return ops_->getPredictedState(robot_, state, lead);
+    }
+
+    CanonReturn Message (const char *message) const
+    {
+      return ops_->message(robot_, message);
+    }
+
+    CanonReturn MoveAttractor (robotPose &pose) const
+    {
+      return ops_->moveAttractor(robot_, pose);
+    }
+
+    CanonReturn MoveStraightTo (robotPose &pose, bool useBlocking = true) const
+    {
+      return ops_->moveStraightTo(robot_, pose, useBlocking);
+    }
+
+    CanonReturn MoveThroughTo (robotPose *poses, int numPoses, robotPose *accelerations = NULL, robotPose *speeds = NULL, robotPose *tolerances = NULL) const
+    {
+      return ops_->moveThroughTo(robot_, poses, numPoses, accelerations, speeds, tolerances);
+    }
+
+    CanonReturn MoveTo (robotPose &pose, bool useBlocking = true) const
+    {
+      return ops_->moveTo(robot_, pose, useBlocking);
+    }
+
+    CanonReturn MoveToAxisTarget (robotAxes &axes, bool useBlocking = true) const
+    {
+      return ops_->moveToAxisTarget(robot_, axes, useBlocking);
+    }
+
+    CanonReturn BeginStream () const
+    {
+      return ops_->beginStream(robot_);
+    }
+
+    CanonReturn StreamPose (robotPose &pose) const
+    {
+      return ops_->streamPose(robot_, pose);
+    }
+
+    CanonReturn StreamAxes (robotAxes &axes) const
+    {
+      return ops_->streamAxes(robot_, axes);
+    }
+
+    CanonReturn EndStream () const
+    {
+      return ops_->endStream(robot_);
+    }
+
+    CanonReturn BeginWrenchStream () const
+    {
+      return ops_->beginWrenchStream(robot_);
+    }
+
+    CanonReturn StreamWrench (robotPose &wrench, const vector<bool> &activeAxes, robotPose &limits) const
+    {
+      return ops_->streamWrench(robot_, wrench, activeAxes, limits);
+    }
+
+    CanonReturn EndWrenchStream () const
+    {
+      return ops_->endWrenchStream(robot_);
+    }
+
+    CanonReturn SetAbsoluteAcceleration (double acceleration) const
+    {
+      return ops_->setAbsoluteAcceleration(robot_, acceleration);
+    }
+
+    CanonReturn SetAbsoluteSpeed (double speed) const
+    {
+      return ops_->setAbsoluteSpeed(robot_, speed);
+    }
+
+    CanonReturn SetAngleUnits (const char *unitName) const
+    {
+      return ops_->setAngleUnits(robot_, unitName);
+    }
+
+    CanonReturn SetAxialSpeeds (double *speeds) const
+    {
+      return ops_->setAxialSpeeds(robot_, speeds);
+    }
+
+    CanonReturn SetAxialUnits (const char **unitNames) const
+    {
+      return ops_->setAxialUnits(robot_, unitNames);
+    }
+
+    CanonReturn SetEndPoseTolerance (robotPose &tolerance) const
+    {
+      return ops_->setEndPoseTolerance(robot_, tolerance);
+    }
+
+    CanonReturn SetIntermediatePoseTolerance (robotPose *tolerances) const
+    {
+      return ops_->setIntermediatePoseTolerance(robot_, tolerances);
+    }
+
+    CanonReturn SetLengthUnits (const char *unitName) const
+    {
+      return ops_->setLengthUnits(robot_, unitName);
+    }
+
+    CanonReturn SetParameter (const char *paramName, void *paramVal) const
+    {
+      return ops_->setParameter(robot_, paramName, paramVal);
+    }
+
+    CanonReturn SetRelativeAcceleration (double percent) const
+    {
+      return ops_->setRelativeAcceleration(robot_, percent);
+    }
+
+    CanonReturn SetRelativeSpeed (double percent) const
+    {
+      return ops_->setRelativeSpeed(robot_, percent);
+    }
+
+    CanonReturn SetRobotIO (robotIO &io) const
+    {
+      return ops_->setRobotIO(robot_, io);
+    }
+
+    CanonReturn SetRobotDO (int dig_out, bool val) const
+    {
+      return ops_->setRobotDO(robot_, dig_out, val);
+    }
+
+    CanonReturn SetTool (double percent) const
+    {
+      return ops_->setTool(robot_, percent);
+    }
+
+    CanonReturn StopMotion (int condition = 2) const
+    {
+      return ops_->stopMotion(robot_, condition);
+    }
+
+    CanonReturn CrclXmlHandler (std::string &str) const
+    {
+      return ops_->crclXmlHandler(robot_, str);
+    }
+
+    CanonReturn CrclXmlResponse (char *str) const
+    {
+      return ops_->crclXmlResponseText(robot_, str);
+    }
+
+    CanonReturn CrclXmlResponse (CrpiXmlWriter &out) const
+    {
+      return ops_->crclXmlResponse(robot_, out);
+    }
+
+    CanonReturn CrpiXmlHandler (std::string &str) const
+    {
+      return ops_->crpiXmlHandler(robot_, str);
+    }
+
+    CanonReturn CrpiXmlResponse (char *str) const
+    {
+      return ops_->crpiXmlResponseText(robot_, str);
+    }
+
+    CanonReturn CrpiXmlResponse (CrpiXmlWriter &out) const
+    {
+      return ops_->crpiXmlResponse(robot_, out);
+    }
+
+    CanonReturn CrpiBinaryHandler (const char *buf, size_t len) const
+    {
+      return ops_->crpiBinaryHandler(robot_, buf, len);
+    }
+
+    CanonReturn CrpiBinaryResponse (char *buf, size_t max, size_t &len) const
+    {
+      return ops_->crpiBinaryResponse(robot_, buf, max, len);
+    }
+
+    CanonReturn LoadProgram (const std::string &xml, CrpiCompiledProgram &program, bool worldFrame = false) const
+    {
+      return ops_->loadProgram(robot_, xml, program, worldFrame);
+    }
+
+    CanonReturn RunProgram (CrpiCompiledProgram &program) const
+    {
+      return ops_->runProgram(robot_, program);
+    }
+
+    CanonReturn CompileNative (CrpiCompiledProgram &program, std::string &text) const
+    {
+      return ops_->compileNative(robot_, program, text);
+    }
+
+    CanonReturn RunNative (CrpiCompiledProgram &program) const
+    {
+      return ops_->runNative(robot_, program);
+    }
+
+    CrpiCompletion MoveToAsync (robotPose &pose) const
+    {
+      return ops_->moveToAsync(robot_, pose);
+    }
+
+    CrpiCompletion MoveStraightToAsync (robotPose &pose) const
+    {
+      return ops_->moveStraightToAsync(robot_, pose);
+    }
+
+    CrpiCompletion MoveToAxisTargetAsync (robotAxes &axes) const
+    {
+      return ops_->moveToAxisTargetAsync(robot_, axes);
+    }
+
+    CrpiCompletion MoveThroughToAsync (robotPose *poses, int numPoses, robotPose *accelerations = NULL, robotPose *speeds = NULL, robotPose *tolerances = NULL) const
+    {
+      return ops_->moveThroughToAsync(robot_, poses, numPoses, accelerations, speeds, tolerances);
+    }
+
+    CrpiCompletion SetToolAsync (double percent) const
+    {
+      return ops_->setToolAsync(robot_, percent);
+    }
+
+    CrpiCompletion SetRobotIOAsync (robotIO &io) const
+    {
+      return ops_->setRobotIOAsync(robot_, io);
+    }
+
+    CrpiCompletion SetRobotDOAsync (int dig_out, bool val) const
+    {
+      return ops_->setRobotDOAsync(robot_, dig_out, val);
+    }
+
+    CrpiCompletion CallAsync (std::function<CanonReturn ()> command) const
+    {
+      return ops_->callAsync(robot_, command);
+    }
+
+    CanonReturn ToWorldMatrix (matrix &R_T_W) const
+    {
+      return ops_->toWorldMatrix(robot_, R_T_W);
+    }
+
+  private:
+
+    //! @brief The robot, as a CrpiRobot<T>
+    //!
+    void *robot_;
+
+    //! @brief Method table of CrpiRobot<T>
+    //!
+    const AnyCrpiRobotOps *ops_;
+  }; // AnyCrpiRobot
+} // crpi_robot
+
+#endif
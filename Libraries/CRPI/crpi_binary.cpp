@@ -0,0 +1,272 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_binary.cpp
+//  Revision:        1.0 - 14 October, 2026
+//
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Binary command protocol class definition file.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_xml.h"
+
+using namespace std;
+
+namespace Xml
+{
+  //! @brief Copy a robotPose into its wire form
+  //!
+  static void packPose (const robotPose &in, CrpiBinaryPose &out)
+  {
+    out.x = in.x;
+    out.y = in.y;
+    out.z = in.z;
+    out.xrot = in.xrot;
+    out.yrot = in.yrot;
+    out.zrot = in.zrot;
+    out.status = in.status;
+    out.turns = in.turns;
+  }
+
+
+  //! @brief Copy the wire form of a pose into a robotPose
+  //!
+  static void unpackPose (const CrpiBinaryPose &in, robotPose &out)
+  {
+    out.x = in.x;
+    out.y = in.y;
+    out.z = in.z;
+    out.xrot = in.xrot;
+    out.yrot = in.yrot;
+    out.zrot = in.zrot;
+    out.status = in.status;
+    out.turns = in.turns;
+  }
+
+
+  //! @brief Copy a robotAxes into its wire form
+  //!
+  static void packAxes (const robotAxes &in, CrpiBinaryAxes &out)
+  {
+    memset(&out, 0, sizeof(out));
+    out.axes = in.axes;
+    for (int i = 0; i < in.axes; ++i)
+    {
+      out.axis[i] = in.axis[i];
+    }
+  }
+
+
+  //! @brief Copy the wire form of a set of axes into a robotAxes
+  //!
+  //! @return False if the axis count is out of range
+  //!
+  static bool unpackAxes (const CrpiBinaryAxes &in, robotAxes &out)
+  {
+    if (in.axes < 0 || in.axes > CRPI_AXES_MAX)
+    {
+      return false;
+    }
+    out.axes = in.axes;
+    for (int i = 0; i < in.axes; ++i)
+    {
+      out.axis[i] = in.axis[i];
+    }
+    return true;
+  }
+
+
+  //! @brief Copy a robotIO into its wire form
+  //!
+  static void packIO (const robotIO &in, CrpiBinaryIO &out)
+  {
+    memset(&out, 0, sizeof(out));
+    out.ndio = in.ndio;
+    out.naio = in.naio;
+    out.dio = (uint32_t)in.dio.to_ulong();
+    for (int i = 0; i < in.naio; ++i)
+    {
+      out.aio[i] = in.aio[i];
+    }
+  }
+
+
+  LIBRARY_API CrpiBinary::CrpiBinary (CrpiXmlParams *params) :
+    params_(params),
+    id_(0)
+  {
+  }
+
+
+  LIBRARY_API CrpiBinary::~CrpiBinary ()
+  {
+    params_ = NULL;
+  }
+
+
+  LIBRARY_API bool CrpiBinary::isBinary (const char *buf, size_t len)
+  {
+    uint32_t magic = CRPI_BINARY_MAGIC;
+    if (len > sizeof(magic))
+    {
+      len = sizeof(magic);
+    }
+    return len > 0 && memcmp(buf, &magic, len) == 0;
+  }
+
+
+  LIBRARY_API long CrpiBinary::frameLength (const char *buf, size_t len)
+  {
+    CrpiBinaryHeader header;
+
+    if (len < sizeof(header))
+    {
+      return (len == 0 || isBinary(buf, len)) ? 0 : -1;
+    }
+
+    memcpy(&header, buf, sizeof(header));
+    if (header.magic != CRPI_BINARY_MAGIC || header.version != CRPI_BINARY_VERSION ||
+        header.length < sizeof(header) || header.length > CRPI_BINARY_MAX_FRAME)
+    {
+      return -1;
+    }
+    return (len < header.length) ? 0 : (long)header.length;
+  }
+
+
+  LIBRARY_API bool CrpiBinary::decode (const char *buf, size_t len)
+  {
+    CrpiBinaryHeader header;
+    CrpiBinaryPose pose;
+    CrpiBinaryAxes axes;
+    CrpiBinaryArgs args;
+    const char *payload = buf + sizeof(header);
+    size_t size;
+
+    if (params_ == NULL || frameLength(buf, len) <= 0)
+    {
+      return false;
+    }
+
+    memcpy(&header, buf, sizeof(header));
+    size = header.length - sizeof(header);
+    id_ = header.id;
+    params_->cmd = (CanonCommand)header.cmd;
+
+    switch (params_->cmd)
+    {
+    case CmdMoveTo:
+    case CmdMoveStraightTo:
+    case CmdMoveAttractor:
+      if (size < sizeof(pose))
+      {
+        return false;
+      }
+      memcpy(&pose, payload, sizeof(pose));
+      unpackPose(pose, *params_->pose);
+      break;
+    case CmdMoveToAxisTarget:
+      if (size < sizeof(axes))
+      {
+        return false;
+      }
+      memcpy(&axes, payload, sizeof(axes));
+      return unpackAxes(axes, *params_->axes);
+    case CmdSetRobotDO:
+    case CmdSetTool:
+    case CmdSetRelativeSpeed:
+    case CmdSetRelativeAcceleration:
+    case CmdSetAbsoluteSpeed:
+    case CmdSetAbsoluteAcceleration:
+      if (size < sizeof(args))
+      {
+        return false;
+      }
+      memcpy(&args, payload, sizeof(args));
+      params_->real = params_->numPositions = args.real;
+      params_->integer = args.integer;
+      params_->boolean = (args.boolean != 0);
+      break;
+    case CmdCouple:
+    case CmdMessage:
+    case CmdSaveConfig:
+    case CmdSetAngleUnits:
+    case CmdSetLengthUnits:
+      params_->str.assign(payload, size);
+      break;
+    default:
+      break;
+    }
+
+    return true;
+  }
+
+
+  LIBRARY_API size_t CrpiBinary::encode (char *buf, size_t max)
+  {
+    CrpiBinaryHeader header;
+    CrpiBinaryStatus status;
+    CrpiBinaryPose pose;
+    CrpiBinaryAxes axes;
+    CrpiBinaryIO io;
+    const void *extra = NULL;
+    size_t extraSize = 0;
+
+    if (params_ == NULL)
+    {
+      return 0;
+    }
+
+    memset(&status, 0, sizeof(status));
+    status.toolVal = params_->toolVal;
+    strncpy(status.toolName, params_->toolName.c_str(), CRPI_BINARY_TOOLNAME - 1);
+    packPose(*params_->pose, status.pose);
+    packAxes(*params_->axes, status.axes);
+
+    if (params_->cmd == CmdGetRobotForces)
+    {
+      packPose(*params_->forces, pose);
+      extra = &pose;
+      extraSize = sizeof(pose);
+    }
+    else if (params_->cmd == CmdGetRobotIO)
+    {
+      packIO(*params_->io, io);
+      extra = &io;
+      extraSize = sizeof(io);
+    }
+    else if (params_->cmd == CmdGetRobotTorques)
+    {
+      packAxes(*params_->torques, axes);
+      extra = &axes;
+      extraSize = sizeof(axes);
+    }
+
+    header.magic = CRPI_BINARY_MAGIC;
+    header.length = (uint32_t)(sizeof(header) + sizeof(status) + extraSize);
+    header.version = CRPI_BINARY_VERSION;
+    header.cmd = (uint16_t)params_->cmd;
+    header.status = (int32_t)params_->status;
+    header.id = id_;
+    header.counter = params_->counter;
+
+    if (header.length > max)
+    {
+      return 0;
+    }
+
+    memcpy(buf, &header, sizeof(header));
+    memcpy(buf + sizeof(header), &status, sizeof(status));
+    if (extra != NULL)
+    {
+      memcpy(buf + sizeof(header) + sizeof(status), extra, extraSize);
+    }
+    return header.length;
+  }
+
+} // Xml namespace
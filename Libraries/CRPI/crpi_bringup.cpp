@@ -0,0 +1,386 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_bringup.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Concurrent, lazy device bring-up definitions.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_bringup.h"
+#include "crpi_metrics.h"
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+namespace crpi_robot
+{
+  struct CrpiBringup::device
+  {
+    //! @brief The CrpiBringup it belongs to, for openThread
+    //!
+    CrpiBringup *owner;
+
+    string name;
+    const void *type;
+    bool lazy;
+
+    //! @brief Opens the device (returning its object, or NULL on failure), makes its first state
+    //!        request (may be empty), and closes it
+    //!
+    function<void *()> create;
+    function<CanonReturn (void *)> probe;
+    function<void (void *)> destroy;
+
+    //! @brief The opened device, its state, and the task opening it (NULL if none was started)
+    //!
+    void *object;
+    CrpiBringupState state;
+    ulapi_task_struct *task;
+
+    //! @brief Timeline (s, ulapi_time, negative until reached)
+    //!
+    double queued;
+    double started;
+    double opened;
+    double responded;
+    CanonReturn probeResult;
+
+    //! @brief Exported time from queued to opened
+    //!
+    CrpiGauge *metric;
+  };
+
+
+  static const char *stateNames[] = {"pending", "opening", "ready", "failed"};
+
+
+  LIBRARY_API CrpiBringup::CrpiBringup () :
+    start_(ulapi_time()),
+    started_(false)
+  {
+    mutex_ = ulapi_mutex_new(0);
+    cond_ = ulapi_cond_new(0);
+  }
+
+
+  LIBRARY_API CrpiBringup::~CrpiBringup ()
+  {
+    size_t i;
+
+    for (i = 0; i < devices_.size(); ++i)
+    {
+      if (devices_[i]->task != NULL)
+      {
+        ulapi_task_join(devices_[i]->task, NULL);
+        ulapi_task_delete(devices_[i]->task);
+      }
+    }
+
+    //! Closed in the reverse of the order registered, so that devices registered after the ones
+    //! they depend on are closed first
+    for (i = devices_.size(); i > 0; --i)
+    {
+      if (devices_[i - 1]->object != NULL && devices_[i - 1]->destroy)
+      {
+        devices_[i - 1]->destroy(devices_[i - 1]->object);
+      }
+    }
+
+    ulapi_cond_delete(cond_);
+    ulapi_mutex_delete(mutex_);
+  }
+
+
+  LIBRARY_API int CrpiBringup::AddDevice (const char *name, function<bool ()> open, function<void ()> close, bool lazy)
+  {
+    static char opened;
+
+    if (!open)
+    {
+      return -1;
+    }
+    //! The device has no object of its own; any non-NULL pointer marks it as opened
+    return add(name, NULL,
+               [open] () -> void * { return open() ? &opened : NULL; },
+               function<CanonReturn (void *)>(),
+               [close] (void *) { if (close) close(); },
+               lazy);
+  }
+
+
+  LIBRARY_API CanonReturn CrpiBringup::Start ()
+  {
+    vector<unique_ptr<device> >::iterator iter;
+    double now = ulapi_time();
+
+    ulapi_mutex_take(mutex_);
+    if (started_)
+    {
+      ulapi_mutex_give(mutex_);
+      return CANON_REJECT;
+    }
+    started_ = true;
+    start_ = now;
+
+    //! Devices already opened through Open keep their timelines
+    for (iter = devices_.begin(); iter != devices_.end(); ++iter)
+    {
+      if ((*iter)->lazy || (*iter)->state != BRINGUP_PENDING)
+      {
+        continue;
+      }
+      (*iter)->state = BRINGUP_OPENING;
+      (*iter)->queued = now;
+      (*iter)->task = ulapi_task_new();
+      if ((*iter)->task == NULL ||
+          ulapi_task_start((*iter)->task, openThread, iter->get(), ulapi_prio_lowest(), 0) != ULAPI_OK)
+      {
+        if ((*iter)->task != NULL)
+        {
+          ulapi_task_delete((*iter)->task);
+          (*iter)->task = NULL;
+        }
+        (*iter)->state = BRINGUP_FAILED;
+      }
+    }
+    ulapi_mutex_give(mutex_);
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiBringup::Wait (double secs)
+  {
+    vector<unique_ptr<device> >::iterator iter;
+    CanonReturn returnMe = CANON_SUCCESS;
+    double deadline = ulapi_time() + secs;
+
+    ulapi_mutex_take(mutex_);
+    if (!started_)
+    {
+      ulapi_mutex_give(mutex_);
+      return CANON_REJECT;
+    }
+    for (iter = devices_.begin(); iter != devices_.end(); ++iter)
+    {
+      if ((*iter)->lazy)
+      {
+        continue;
+      }
+      if (!waitOpened(iter->get(), (secs < 0.0) ? -1.0 : deadline - ulapi_time()))
+      {
+        returnMe = CANON_RUNNING;
+        break;
+      }
+      if ((*iter)->state == BRINGUP_FAILED)
+      {
+        returnMe = CANON_FAILURE;
+      }
+    }
+    ulapi_mutex_give(mutex_);
+    return returnMe;
+  }
+
+
+  LIBRARY_API bool CrpiBringup::Open (const char *name, double secs)
+  {
+    device *dev = find(name);
+    bool ready;
+
+    if (dev == NULL)
+    {
+      return false;
+    }
+
+    ulapi_mutex_take(mutex_);
+    if (dev->state == BRINGUP_PENDING)
+    {
+      //! Opened here; anyone else asking for it meanwhile waits
+      dev->state = BRINGUP_OPENING;
+      dev->queued = ulapi_time();
+      ulapi_mutex_give(mutex_);
+      openDevice(dev);
+      ulapi_mutex_take(mutex_);
+    }
+    ready = waitOpened(dev, secs) && dev->state == BRINGUP_READY;
+    ulapi_mutex_give(mutex_);
+    return ready;
+  }
+
+
+  LIBRARY_API vector<CrpiBringupTimeline> CrpiBringup::Timeline () const
+  {
+    vector<unique_ptr<device> >::const_iterator iter;
+    vector<CrpiBringupTimeline> out;
+    CrpiBringupTimeline line;
+
+    ulapi_mutex_take(mutex_);
+    for (iter = devices_.begin(); iter != devices_.end(); ++iter)
+    {
+      line.name = (*iter)->name;
+      line.lazy = (*iter)->lazy;
+      line.state = (*iter)->state;
+      line.queued = ((*iter)->queued < 0.0) ? -1.0 : (*iter)->queued - start_;
+      line.started = ((*iter)->started < 0.0) ? -1.0 : (*iter)->started - start_;
+      line.opened = ((*iter)->opened < 0.0) ? -1.0 : (*iter)->opened - start_;
+      line.responded = ((*iter)->responded < 0.0) ? -1.0 : (*iter)->responded - start_;
+      line.probe = (*iter)->probeResult;
+      out.push_back(line);
+    }
+    ulapi_mutex_give(mutex_);
+    return out;
+  }
+
+
+  LIBRARY_API string CrpiBringup::Report () const
+  {
+    vector<CrpiBringupTimeline> lines = Timeline();
+    vector<CrpiBringupTimeline>::const_iterator iter;
+    string out;
+    char buffer[256];
+
+    out = "device                 mode   state     queued  started   opened responded\n";
+    for (iter = lines.begin(); iter != lines.end(); ++iter)
+    {
+      snprintf(buffer, sizeof(buffer), "%-22.22s %-6s %-8s %8.3f %8.3f %8.3f %8.3f\n", iter->name.c_str(),
+               iter->lazy ? "lazy" : "start", stateNames[iter->state], iter->queued, iter->started,
+               iter->opened, iter->responded);
+      out += buffer;
+    }
+    return out;
+  }
+
+
+  int CrpiBringup::add (const char *name, const void *type, function<void *()> create,
+                        function<CanonReturn (void *)> probe, function<void (void *)> destroy, bool lazy)
+  {
+    unique_ptr<device> dev(new device);
+
+    if (name == NULL || started_ || find(name) != NULL)
+    {
+      return -1;
+    }
+    dev->owner = this;
+    dev->name = name;
+    dev->type = type;
+    dev->lazy = lazy;
+    dev->create = create;
+    dev->probe = probe;
+    dev->destroy = destroy;
+    dev->object = NULL;
+    dev->state = BRINGUP_PENDING;
+    dev->task = NULL;
+    dev->queued = dev->started = dev->opened = dev->responded = -1.0;
+    dev->probeResult = CANON_REJECT;
+    dev->metric = CrpiMetrics::Gauge("crpi_bringup_seconds", "Time from a device being queued to it being opened",
+                                     CrpiMetrics::Label("device", name));
+
+    devices_.push_back(move(dev));
+    return (int)devices_.size() - 1;
+  }
+
+
+  CrpiBringup::device *CrpiBringup::find (const char *name) const
+  {
+    vector<unique_ptr<device> >::const_iterator iter;
+
+    //! Devices are only added before Start, so the list does not change while devices open
+    for (iter = devices_.begin(); name != NULL && iter != devices_.end(); ++iter)
+    {
+      if ((*iter)->name == name)
+      {
+        return iter->get();
+      }
+    }
+    return NULL;
+  }
+
+
+  bool CrpiBringup::hasType (const char *name, const void *type) const
+  {
+    device *dev = find(name);
+    return dev != NULL && dev->type == type;
+  }
+
+
+  void *CrpiBringup::object (const char *name) const
+  {
+    device *dev = find(name);
+    void *obj;
+
+    if (dev == NULL)
+    {
+      return NULL;
+    }
+    ulapi_mutex_take(mutex_);
+    obj = dev->object;
+    ulapi_mutex_give(mutex_);
+    return obj;
+  }
+
+
+  void CrpiBringup::openDevice (device *dev)
+  {
+    CanonReturn probe = CANON_REJECT;
+    double started, opened, responded = -1.0;
+    void *obj;
+
+    started = ulapi_time();
+    obj = dev->create();
+    opened = ulapi_time();
+
+    //! Time to first feedback, which for most drivers comes some time after the connection
+    if (obj != NULL && dev->probe)
+    {
+      probe = dev->probe(obj);
+      responded = ulapi_time();
+    }
+
+    ulapi_mutex_take(mutex_);
+    dev->object = obj;
+    dev->started = started;
+    dev->opened = opened;
+    dev->responded = responded;
+    dev->probeResult = probe;
+    dev->state = (obj != NULL) ? BRINGUP_READY : BRINGUP_FAILED;
+    ulapi_cond_broadcast(cond_);
+    ulapi_mutex_give(mutex_);
+
+    dev->metric->Set(opened - dev->queued);
+  }
+
+
+  void CrpiBringup::openThread (void *param)
+  {
+    device *dev = (device *)param;
+    dev->owner->openDevice(dev);
+  }
+
+
+  bool CrpiBringup::waitOpened (device *dev, double secs)
+  {
+    double deadline = ulapi_time() + secs, remaining;
+
+    while (dev->state == BRINGUP_OPENING)
+    {
+      if (secs < 0.0)
+      {
+        ulapi_cond_wait(cond_, mutex_);
+        continue;
+      }
+      remaining = deadline - ulapi_time();
+      if (remaining <= 0.0)
+      {
+        return false;
+      }
+      ulapi_cond_timedwait(cond_, mutex_, remaining);
+    }
+    return true;
+  }
+} // namespace crpi_robot
@@ -0,0 +1,241 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_bringup.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Concurrent, lazy bring-up of the devices of a work cell.
+//
+//  Each device's constructor blocks on its connection (UR connectRobot and
+//  its settling waits, the ABB connect, the LWR serial negotiation, the
+//  Vicon connect retries), so constructing them one after another takes the
+//  sum of those waits.  Devices registered here are opened by Start, each
+//  on its own thread, and take as long as the slowest of them.  Devices
+//  registered as lazy are not opened until first asked for.  When each
+//  device was queued, began opening, finished, and first answered a state
+//  request is kept for Timeline and Report, and exported through
+//  CrpiMetrics.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_bringup_H
+#define crpi_bringup_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "crpi_robot.h"
+
+namespace crpi_robot
+{
+  //! @brief Bring-up state of a device
+  //!
+  typedef enum
+  {
+    BRINGUP_PENDING = 0, //! Not yet opened (lazy devices until first use)
+    BRINGUP_OPENING,
+    BRINGUP_READY,
+    BRINGUP_FAILED
+  } CrpiBringupState;
+
+  //! @brief Startup timeline of one device.  Times are seconds since Start (-1 until reached).
+  //!
+  struct CrpiBringupTimeline
+  {
+    std::string name;
+    bool lazy;
+    CrpiBringupState state;
+
+    //! @brief When the device was queued (Start, or first use if lazy), began opening, finished
+    //!        opening, and answered its first state request (robots only)
+    //!
+    double queued;
+    double started;
+    double opened;
+    double responded;
+
+    //! @brief Result of the first state request (GetRobotAxes), or REJECT if there was none
+    //!
+    CanonReturn probe;
+  };
+
+  //! @ingroup Robot
+  //!
+  //! @brief Opens the devices of a cell concurrently, or on first use
+  //!
+  //! @note Register every device, then call Start once.  Devices (robots of any CrpiRobot type
+  //!       or anything with an open function) are opened on their own threads; Robot and Open
+  //!       wait for a device that is opening, and open a lazy one on the calling thread.  Robots
+  //!       constructed here are deleted with the CrpiBringup.
+  //! @note Constructors of different drivers run at the same time, so a driver that keeps
+  //!       unguarded static state should be registered as lazy or opened before Start.
+  //!
+  class LIBRARY_API CrpiBringup
+  {
+  public:
+
+    //! @brief Default constructor
+    //!
+    CrpiBringup ();
+
+    //! @brief Default destructor.  Waits for devices still opening, then closes every device.
+    //!
+    ~CrpiBringup ();
+
+    //! @brief Register a robot
+    //!
+    //! @param name   Label for the robot (unique)
+    //! @param config The robot's configuration file, as given to CrpiRobot<T>
+    //! @param lazy   Open on first use instead of by Start
+    //!
+    //! @return The device's index, or -1 if the name is taken or Start has been called
+    //!
+    template <class T> int AddRobot (const char *name, const char *config, bool lazy = false);
+
+    //! @brief Register another device (e.g., a motion capture system or a sensor)
+    //!
+    //! @param name  Label for the device (unique)
+    //! @param open  Connects the device; returns true on success
+    //! @param close Disconnects the device if it was opened, or an empty function
+    //! @param lazy  Open on first use instead of by Start
+    //!
+    //! @return The device's index, or -1 if the name is taken or Start has been called
+    //!
+    int AddDevice (const char *name, std::function<bool ()> open, std::function<void ()> close,
+                   bool lazy = false);
+
+    //! @brief Open every device that is not lazy, all at once
+    //!
+    //! @return SUCCESS if the devices are opening, REJECT if Start has already been called
+    //!
+    CanonReturn Start ();
+
+    //! @brief Wait for every device started by Start to be opened
+    //!
+    //! @param secs Maximum time to wait (s), or a negative value to wait indefinitely
+    //!
+    //! @return SUCCESS if all are ready, FAILURE if any failed, RUNNING on timeout, and REJECT if
+    //!         Start has not been called
+    //!
+    CanonReturn Wait (double secs = -1.0);
+
+    //! @brief Make sure a device is open:  wait for it if it is opening, open it on this thread
+    //!        if it is lazy and has not been opened
+    //!
+    //! @param name The device's label
+    //! @param secs Maximum time to wait for a device that is opening (s), or negative for no limit
+    //!
+    //! @return True if the device is ready
+    //!
+    bool Open (const char *name, double secs = -1.0);
+
+    //! @brief A robot, opened as by Open
+    //!
+    //! @return The robot, or NULL if it is unknown, of another type, not ready, or timed out
+    //!
+    template <class T> CrpiRobot<T> *Robot (const char *name, double secs = -1.0);
+
+    //! @brief Startup timeline of every device, in the order registered
+    //!
+    std::vector<CrpiBringupTimeline> Timeline () const;
+
+    //! @brief The timelines as a table, one device per line
+    //!
+    std::string Report () const;
+
+  private:
+    struct device;
+
+    //! @brief Register a device built from its open, probe, and close functions
+    //!
+    int add (const char *name, const void *type, std::function<void *()> create,
+             std::function<CanonReturn (void *)> probe, std::function<void (void *)> destroy, bool lazy);
+
+    //! @brief Find a device by name
+    //!
+    //! @return The device, or NULL if there is none
+    //!
+    device *find (const char *name) const;
+
+    //! @brief Whether a device was registered with a type (see typeKey)
+    //!
+    bool hasType (const char *name, const void *type) const;
+
+    //! @brief The object a device's open function created, or NULL
+    //!
+    void *object (const char *name) const;
+
+    //! @brief Open a device (on the calling thread), recording its timeline
+    //!
+    void openDevice (device *dev);
+
+    //! @brief Open the device given, on its own task
+    //!
+    static void openThread (void *param);
+
+    //! @brief Wait for a device to leave BRINGUP_OPENING (mutex_ held)
+    //!
+    //! @return True if it did before the deadline
+    //!
+    bool waitOpened (device *dev, double secs);
+
+    //! @brief Identifies CrpiRobot<T> for Robot's type check
+    //!
+    template <class T> static const void *typeKey ()
+    {
+      static const char key = 0;
+      return &key;
+    }
+
+    //! @brief Registered devices
+    //!
+    std::vector<std::unique_ptr<device> > devices_;
+
+    //! @brief When Start was called, and whether it has been
+    //!
+    double start_;
+    bool started_;
+
+    //! @brief Guards the devices' states and timelines; cond_ is broadcast when one changes
+    //!
+    ulapi_mutex_struct *mutex_;
+    void *cond_;
+
+    CrpiBringup (const CrpiBringup &);
+    CrpiBringup &operator= (const CrpiBringup &);
+  }; // CrpiBringup
+
+
+  template <class T> int CrpiBringup::AddRobot (const char *name, const char *config, bool lazy)
+  {
+    std::string path(config);
+
+    return add(name, typeKey<T>(),
+               [path] () -> void * { return new CrpiRobot<T>(path.c_str()); },
+               [] (void *robot) -> CanonReturn
+               {
+                 robotAxes axes;
+                 return ((CrpiRobot<T> *)robot)->GetRobotAxes(&axes);
+               },
+               [] (void *robot) { delete (CrpiRobot<T> *)robot; },
+               lazy);
+  }
+
+
+  template <class T> CrpiRobot<T> *CrpiBringup::Robot (const char *name, double secs)
+  {
+    if (!hasType(name, typeKey<T>()) || !Open(name, secs))
+    {
+      return NULL;
+    }
+    return (CrpiRobot<T> *)object(name);
+  }
+} // crpi_robot
+
+#endif
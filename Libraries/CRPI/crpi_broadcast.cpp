@@ -0,0 +1,389 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_broadcast.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  UDP multicast state broadcast definitions.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_broadcast.h"
+#include "crpi_log.h"
+
+#include <stdint.h>
+#include <string.h>
+
+using namespace std;
+
+namespace crpi_robot
+{
+  //! @brief Appends little-endian fields to a datagram
+  //!
+  struct broadcastWriter
+  {
+    unsigned char *ptr;
+
+    void u8 (unsigned int value)
+    {
+      *ptr++ = (unsigned char)value;
+    }
+
+    void u16 (unsigned int value)
+    {
+      u8(value & 0xFF);
+      u8((value >> 8) & 0xFF);
+    }
+
+    void u32 (uint32_t value)
+    {
+      u16(value & 0xFFFF);
+      u16((value >> 16) & 0xFFFF);
+    }
+
+    void f64 (double value)
+    {
+      uint64_t bits;
+      memcpy(&bits, &value, sizeof(bits));
+      u32((uint32_t)(bits & 0xFFFFFFFFu));
+      u32((uint32_t)(bits >> 32));
+    }
+  };
+
+
+  //! @brief Reads little-endian fields from a datagram, clearing ok at its end
+  //!
+  struct broadcastReader
+  {
+    const unsigned char *ptr;
+    const unsigned char *end;
+    bool ok;
+
+    bool need (size_t bytes)
+    {
+      ok = ok && (size_t)(end - ptr) >= bytes;
+      return ok;
+    }
+
+    unsigned int u8 ()
+    {
+      return need(1) ? *ptr++ : 0;
+    }
+
+    unsigned int u16 ()
+    {
+      unsigned int lo = u8();
+      return lo | (u8() << 8);
+    }
+
+    uint32_t u32 ()
+    {
+      uint32_t lo = u16();
+      return lo | ((uint32_t)u16() << 16);
+    }
+
+    double f64 ()
+    {
+      uint64_t bits = u32();
+      double value;
+      bits |= (uint64_t)u32() << 32;
+      memcpy(&value, &bits, sizeof(value));
+      return value;
+    }
+  };
+
+
+  //! @brief Encode a state (see crpi_broadcast.h for the layout)
+  //!
+  //! @return Length of the datagram
+  //!
+  static size_t broadcastEncode (const RobotStateSnapshot &state, const string &robot, unsigned long count,
+                                 unsigned char *buffer)
+  {
+    broadcastWriter wr = {buffer};
+    int axes = (state.axes < 0) ? 0 : ((state.axes > CRPI_AXES_MAX) ? CRPI_AXES_MAX : state.axes);
+    int ndio = (state.ndio < 0) ? 0 : ((state.ndio > CRPI_IO_MAX) ? CRPI_IO_MAX : state.ndio);
+    int naio = (state.naio < 0) ? 0 : ((state.naio > CRPI_IO_MAX) ? CRPI_IO_MAX : state.naio);
+    size_t length = (robot.length() < CRPI_STATE_NAME_MAX) ? robot.length() : (CRPI_STATE_NAME_MAX - 1);
+    unsigned int bits;
+    int i;
+
+    wr.u32(CRPI_BROADCAST_MAGIC);
+    wr.u16(CRPI_BROADCAST_VERSION);
+    wr.u16(state.valid);
+    wr.u32((uint32_t)count);
+    wr.u32((uint32_t)state.sequence);
+    wr.f64(state.timestamp);
+    wr.u32((uint32_t)state.robotMode);
+    wr.u32((uint32_t)state.safetyMode);
+    wr.u32((uint32_t)state.programState);
+    wr.u32(state.status);
+    wr.f64(state.pose.x);
+    wr.f64(state.pose.y);
+    wr.f64(state.pose.z);
+    wr.f64(state.pose.xrot);
+    wr.f64(state.pose.yrot);
+    wr.f64(state.pose.zrot);
+
+    wr.u8((unsigned int)length);
+    memcpy(wr.ptr, robot.data(), length);
+    wr.ptr += length;
+
+    wr.u8(axes);
+    for (i = 0; i < axes; ++i)
+    {
+      wr.f64(state.axis[i]);
+    }
+
+    wr.u8(ndio);
+    for (i = 0, bits = 0; i < ndio; ++i)
+    {
+      bits |= (state.dio[i] ? 1u : 0u) << (i % 8);
+      if ((i % 8) == 7 || i == (ndio - 1))
+      {
+        wr.u8(bits);
+        bits = 0;
+      }
+    }
+
+    wr.u8(naio);
+    for (i = 0; i < naio; ++i)
+    {
+      wr.f64(state.aio[i]);
+    }
+
+    return wr.ptr - buffer;
+  }
+
+
+  //! @brief Decode a datagram
+  //!
+  //! @return True if it is a complete state of a known version
+  //!
+  static bool broadcastDecode (const unsigned char *buffer, size_t length, CrpiBroadcastState &msg)
+  {
+    broadcastReader rd = {buffer, buffer + length, true};
+    RobotStateSnapshot &state = msg.state;
+    unsigned int count, bits = 0;
+    unsigned int i;
+
+    if (rd.u32() != CRPI_BROADCAST_MAGIC || rd.u16() != CRPI_BROADCAST_VERSION)
+    {
+      return false;
+    }
+    state.valid = rd.u16();
+    msg.count = rd.u32();
+    state.sequence = rd.u32();
+    state.timestamp = rd.f64();
+    state.robotMode = (int)rd.u32();
+    state.safetyMode = (int)rd.u32();
+    state.programState = (int)rd.u32();
+    state.status = rd.u32();
+    state.pose.x = rd.f64();
+    state.pose.y = rd.f64();
+    state.pose.z = rd.f64();
+    state.pose.xrot = rd.f64();
+    state.pose.yrot = rd.f64();
+    state.pose.zrot = rd.f64();
+
+    count = rd.u8();
+    if (count >= CRPI_STATE_NAME_MAX || !rd.need(count))
+    {
+      return false;
+    }
+    memcpy(msg.robot, rd.ptr, count);
+    msg.robot[count] = '\0';
+    rd.ptr += count;
+
+    count = rd.u8();
+    if (count > CRPI_AXES_MAX)
+    {
+      return false;
+    }
+    state.axes = (int)count;
+    for (i = 0; i < count; ++i)
+    {
+      state.axis[i] = rd.f64();
+    }
+
+    count = rd.u8();
+    if (count > CRPI_IO_MAX)
+    {
+      return false;
+    }
+    state.ndio = (int)count;
+    for (i = 0; i < count; ++i)
+    {
+      if ((i % 8) == 0)
+      {
+        bits = rd.u8();
+      }
+      state.dio[i] = ((bits >> (i % 8)) & 1u) != 0;
+    }
+
+    count = rd.u8();
+    if (count > CRPI_IO_MAX)
+    {
+      return false;
+    }
+    state.naio = (int)count;
+    for (i = 0; i < count; ++i)
+    {
+      state.aio[i] = rd.f64();
+    }
+
+    return rd.ok;
+  }
+
+
+  LIBRARY_API CrpiStateBroadcaster::CrpiStateBroadcaster (int port, const char *group, const char *robot) :
+    robot_((robot != NULL) ? robot : ""),
+    count_(0)
+  {
+    socket_ = ulapi_socket_get_multicaster_id_on_interface(port, (group != NULL && group[0] != '\0') ?
+                                                                 group : CRPI_BROADCAST_GROUP);
+    if (socket_ < 0)
+    {
+      CRPI_LOG(CRPI_LOG_ERROR, "CrpiStateBroadcaster:  cannot open multicast socket on port %d", port);
+      return;
+    }
+    //! The broadcast is sent from the SensorHub timer thread, which must never wait on the network
+    ulapi_socket_set_nonblocking(socket_);
+  }
+
+
+  LIBRARY_API CrpiStateBroadcaster::~CrpiStateBroadcaster ()
+  {
+    if (socket_ >= 0)
+    {
+      ulapi_socket_close(socket_);
+    }
+  }
+
+
+  LIBRARY_API bool CrpiStateBroadcaster::Ready () const
+  {
+    return socket_ >= 0;
+  }
+
+
+  LIBRARY_API bool CrpiStateBroadcaster::Send (const RobotStateSnapshot &state)
+  {
+    unsigned char buffer[CRPI_BROADCAST_MAX];
+    size_t length;
+
+    if (socket_ < 0)
+    {
+      return false;
+    }
+    length = broadcastEncode(state, robot_, ++count_, buffer);
+    return ulapi_socket_write(socket_, (const char*)buffer, (ulapi_integer)length) == (ulapi_integer)length;
+  }
+
+
+  LIBRARY_API unsigned long CrpiStateBroadcaster::Count () const
+  {
+    return count_;
+  }
+
+
+  LIBRARY_API CrpiStateListener::CrpiStateListener (int port, const char *group) :
+    lost_(0)
+  {
+    socket_ = ulapi_socket_get_multicastee_id_on_interface(port, (group != NULL && group[0] != '\0') ?
+                                                                 group : CRPI_BROADCAST_GROUP);
+    if (socket_ < 0)
+    {
+      CRPI_LOG(CRPI_LOG_ERROR, "CrpiStateListener:  cannot join multicast group on port %d", port);
+    }
+  }
+
+
+  LIBRARY_API CrpiStateListener::~CrpiStateListener ()
+  {
+    if (socket_ >= 0)
+    {
+      ulapi_socket_close(socket_);
+    }
+  }
+
+
+  LIBRARY_API bool CrpiStateListener::Ready () const
+  {
+    return socket_ >= 0;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiStateListener::Receive (CrpiBroadcastState *msg, double timeout)
+  {
+    unsigned char buffer[CRPI_BROADCAST_MAX];
+    double until = ulapi_time() + timeout;
+    double remaining = timeout;
+    ulapi_integer ready, length, port;
+    map<string, unsigned long>::iterator last;
+
+    if (socket_ < 0)
+    {
+      return CANON_FAILURE;
+    }
+
+    while (true)
+    {
+      length = ulapi_socket_poll(&socket_, &ready, 1, remaining);
+      if (length < 0)
+      {
+        return CANON_FAILURE;
+      }
+      if (length == 0)
+      {
+        return CANON_REJECT;
+      }
+
+      length = ulapi_socket_read_from(socket_, (char*)buffer, sizeof(buffer), &msg->address, &port);
+      if (length < 0)
+      {
+        return CANON_FAILURE;
+      }
+      msg->state = RobotStateSnapshot();
+      if (broadcastDecode(buffer, (size_t)length, *msg))
+      {
+        msg->received = ulapi_time();
+
+        //! A count that goes back means the sender restarted
+        last = last_.find(msg->robot);
+        if (last == last_.end())
+        {
+          last_[msg->robot] = msg->count;
+        }
+        else
+        {
+          if (msg->count > last->second)
+          {
+            lost_ += msg->count - last->second - 1;
+          }
+          last->second = msg->count;
+        }
+        return CANON_SUCCESS;
+      }
+
+      if (timeout >= 0.0)
+      {
+        remaining = until - ulapi_time();
+        if (remaining <= 0.0)
+        {
+          return CANON_REJECT;
+        }
+      }
+    }
+  }
+
+
+  LIBRARY_API unsigned long CrpiStateListener::Lost () const
+  {
+    return lost_;
+  }
+} // crpi_robot
@@ -0,0 +1,182 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_broadcast.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  UDP multicast broadcast of robot state to dashboards and loggers on the
+//  plant network.
+//
+//  CrpiRobot::BroadcastState (or a <Broadcast> tag in the robot XML) sends
+//  a compact binary copy of the robot's state to a multicast group at a
+//  fixed rate.  Any number of CrpiStateListener objects, on any computer of
+//  the subnet, can receive it without connecting to the driver, so adding a
+//  listener costs the cell PC nothing.  Datagrams are best-effort:  a
+//  listener counts the ones it missed but never asks for them again.
+//
+//  Every field is little-endian.  Sections after the fixed header are only
+//  as long as the robot needs:
+//
+//    offset  size      field
+//         0  4         CRPI_BROADCAST_MAGIC
+//         4  2         CRPI_BROADCAST_VERSION
+//         6  2         valid (CrpiStateField bits)
+//         8  4         datagram count since the broadcast started
+//        12  4         state sequence (low 32 bits)
+//        16  8         state timestamp (s, the sender's ulapi_time)
+//        24  4 x 4     robotMode, safetyMode, programState, status
+//        40  6 x 8     pose x, y, z, xrot, yrot, zrot
+//        88  1 + L     label length L, label (not terminated)
+//            1 + 8 N   axis count N, axes
+//            1 + B     digital I/O count D, D bits packed into B = (D + 7) / 8 bytes
+//            1 + 8 A   analog I/O count A, analog I/O
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_broadcast_H
+#define crpi_broadcast_H
+
+#include "crpi.h"
+#include "crpi_state_shm.h"
+#include <map>
+#include <string>
+
+//! Marks a state datagram ("CRSB")
+#define CRPI_BROADCAST_MAGIC 0x42535243
+
+//! Layout version of the datagram
+#define CRPI_BROADCAST_VERSION 1
+
+//! Default multicast group and port (the group is administratively scoped, so it stays inside
+//! the plant)
+#define CRPI_BROADCAST_GROUP "239.255.0.80"
+#define CRPI_BROADCAST_PORT 30750
+
+//! Largest datagram
+#define CRPI_BROADCAST_MAX 512
+
+namespace crpi_robot
+{
+  //! @brief One received state
+  //!
+  struct CrpiBroadcastState
+  {
+    //! @brief Label the sender gave the robot
+    //!
+    char robot[CRPI_STATE_NAME_MAX];
+
+    //! @brief Sender's address (as returned by ulapi_hostname_to_address)
+    //!
+    ulapi_integer address;
+
+    //! @brief Datagram count since the sender started broadcasting
+    //!
+    unsigned long count;
+
+    //! @brief Time (ulapi_time, s) the datagram was received
+    //!
+    double received;
+
+    //! @brief The state; sequence is the low 32 bits of the sender's
+    //!
+    RobotStateSnapshot state;
+  };
+
+
+  //! @ingroup Robot
+  //!
+  //! @brief Sender of a state broadcast (used by CrpiRobot::BroadcastState)
+  //!
+  class LIBRARY_API CrpiStateBroadcaster
+  {
+  public:
+    //! @brief Default constructor.  Opens the multicast socket.
+    //!
+    //! @param port  UDP port of the broadcast
+    //! @param group Multicast group address (NULL or empty for CRPI_BROADCAST_GROUP)
+    //! @param robot Label for listeners (NULL for none)
+    //!
+    CrpiStateBroadcaster (int port, const char *group, const char *robot);
+
+    //! @brief Default destructor
+    //!
+    ~CrpiStateBroadcaster ();
+
+    //! @brief Whether the socket could be opened
+    //!
+    bool Ready () const;
+
+    //! @brief Send a state.  Never blocks; a datagram the network stack cannot take is dropped.
+    //!
+    //! @return True if the datagram was sent
+    //!
+    bool Send (const RobotStateSnapshot &state);
+
+    //! @brief Number of datagrams sent
+    //!
+    unsigned long Count () const;
+
+  private:
+    ulapi_integer socket_;
+    std::string robot_;
+    unsigned long count_;
+
+    CrpiStateBroadcaster (const CrpiStateBroadcaster &) = delete;
+    CrpiStateBroadcaster &operator= (const CrpiStateBroadcaster &) = delete;
+  }; // CrpiStateBroadcaster
+
+
+  //! @ingroup Robot
+  //!
+  //! @brief Receiver of the state broadcasts of any number of robots sharing a group and port
+  //!
+  class LIBRARY_API CrpiStateListener
+  {
+  public:
+    //! @brief Default constructor.  Joins the multicast group.
+    //!
+    //! @param port  UDP port of the broadcast
+    //! @param group Multicast group address (NULL or empty for CRPI_BROADCAST_GROUP)
+    //!
+    CrpiStateListener (int port = CRPI_BROADCAST_PORT, const char *group = NULL);
+
+    //! @brief Default destructor
+    //!
+    ~CrpiStateListener ();
+
+    //! @brief Whether the group could be joined
+    //!
+    bool Ready () const;
+
+    //! @brief Wait for the next state from any robot
+    //!
+    //! @param msg     Received state to be populated by the method
+    //! @param timeout Longest time (s) to wait; negative to wait indefinitely
+    //!
+    //! @return SUCCESS if a state was received, REJECT on a timeout, FAILURE on a socket error.
+    //!         Datagrams that are not valid states are skipped.
+    //!
+    CanonReturn Receive (CrpiBroadcastState *msg, double timeout);
+
+    //! @brief Number of datagrams missed, over all robots, judged by the gaps in their counts
+    //!
+    unsigned long Lost () const;
+
+  private:
+    ulapi_integer socket_;
+
+    //! @brief Last datagram count received from each robot, by label, and the total missed
+    //!
+    std::map<std::string, unsigned long> last_;
+    unsigned long lost_;
+
+    CrpiStateListener (const CrpiStateListener &) = delete;
+    CrpiStateListener &operator= (const CrpiStateListener &) = delete;
+  }; // CrpiStateListener
+} // crpi_robot
+
+#endif
@@ -0,0 +1,617 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_cell.cpp
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Synchronized command scheduler definitions.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_cell.h"
+
+#include <cmath>
+
+using namespace std;
+
+//! @brief Longest step (mm) between the poses of a straight-line motion that are solved for the
+//!        collision check
+//!
+#define CELL_STRAIGHT_STEP 25.0
+
+namespace crpi_robot
+{
+  //! @brief Start gate shared by the commands of one tick
+  //!
+  struct CrpiCellGate
+  {
+    ulapi_mutex_struct *mutex;
+    void *cond;
+
+    //! @brief Commands in the tick, and how many have reached the gate
+    //!
+    int expected;
+    int arrived;
+
+    //! @brief Set once, by the last command to arrive or the first to time out
+    //!
+    bool released;
+    bool aborted;
+
+    //! @brief Time (s) by which every command must have arrived
+    //!
+    double deadline;
+
+    //! @brief Time each command began, and how many have been recorded
+    //!
+    vector<double> starts;
+    int started;
+
+    CrpiCellGate (int count, double timeout) :
+      expected(count),
+      arrived(0),
+      released(false),
+      aborted(false),
+      deadline(ulapi_time() + timeout),
+      starts(count, 0.0),
+      started(0)
+    {
+      mutex = ulapi_mutex_new(0);
+      cond = ulapi_cond_new(0);
+    }
+
+    ~CrpiCellGate ()
+    {
+      ulapi_cond_delete(cond);
+      ulapi_mutex_delete(mutex);
+    }
+  };
+
+
+  LIBRARY_API CrpiCell::CrpiCell () :
+    collision_(NULL),
+    deferred_(0),
+    lastSkew_(-1.0),
+    maxSkew_(-1.0),
+    sumSkew_(0.0),
+    skewSamples_(0)
+  {
+    statsMutex_ = ulapi_mutex_new(0);
+  }
+
+
+  LIBRARY_API CrpiCell::~CrpiCell ()
+  {
+    //! Queued commands refer back to this cell
+    Barrier();
+    ulapi_mutex_delete(statsMutex_);
+  }
+
+
+  LIBRARY_API int CrpiCell::AddRobot (AnyCrpiRobot robot, const char *name)
+  {
+    robots_.push_back(robot);
+    names_.push_back((name == NULL) ? "" : name);
+    arms_.push_back(-1);
+    expected_.push_back(robotAxes());
+    known_.push_back(false);
+    return (int)robots_.size() - 1;
+  }
+
+
+  LIBRARY_API int CrpiCell::Robots () const
+  {
+    return (int)robots_.size();
+  }
+
+
+  LIBRARY_API const char *CrpiCell::Name (int robot) const
+  {
+    if (robot < 0 || robot >= (int)robots_.size())
+    {
+      return "";
+    }
+    return names_[robot].c_str();
+  }
+
+
+  LIBRARY_API CanonReturn CrpiCell::StageMoveTo (int robot, robotPose &pose)
+  {
+    if (robot < 0 || robot >= (int)robots_.size())
+    {
+      return CANON_REJECT;
+    }
+    robotPose target = pose;
+    AnyCrpiRobot arm = robots_[robot];
+    CanonReturn ret = StageCommand(robot, [arm, target] () mutable { return arm.MoveTo(target, true); });
+    motions_[robot].type = CELL_FREE;
+    motions_[robot].pose = pose;
+    return ret;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiCell::StageMoveStraightTo (int robot, robotPose &pose)
+  {
+    if (robot < 0 || robot >= (int)robots_.size())
+    {
+      return CANON_REJECT;
+    }
+    robotPose target = pose;
+    AnyCrpiRobot arm = robots_[robot];
+    CanonReturn ret = StageCommand(robot, [arm, target] () mutable { return arm.MoveStraightTo(target, true); });
+    motions_[robot].type = CELL_STRAIGHT;
+    motions_[robot].pose = pose;
+    return ret;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiCell::StageMoveToAxisTarget (int robot, robotAxes &axes)
+  {
+    if (robot < 0 || robot >= (int)robots_.size())
+    {
+      return CANON_REJECT;
+    }
+    robotAxes target = axes;
+    AnyCrpiRobot arm = robots_[robot];
+    CanonReturn ret = StageCommand(robot, [arm, target] () mutable { return arm.MoveToAxisTarget(target, true); });
+    motions_[robot].type = CELL_JOINT;
+    motions_[robot].axes = axes;
+    return ret;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiCell::StageSetTool (int robot, double percent)
+  {
+    if (robot < 0 || robot >= (int)robots_.size())
+    {
+      return CANON_REJECT;
+    }
+    AnyCrpiRobot arm = robots_[robot];
+    CanonReturn ret = StageCommand(robot, [arm, percent] () { return arm.SetTool(percent); });
+    motions_[robot].type = CELL_STILL;
+    return ret;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiCell::StageCommand (int robot, std::function<CanonReturn ()> command)
+  {
+    if (robot < 0 || robot >= (int)robots_.size() || !command)
+    {
+      return CANON_REJECT;
+    }
+    staged_.resize(robots_.size());
+    motions_.resize(robots_.size());
+    staged_[robot] = command;
+    motions_[robot] = CrpiCellMotion();
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API void CrpiCell::ClearStaged ()
+  {
+    staged_.clear();
+    motions_.clear();
+  }
+
+
+  LIBRARY_API void CrpiCell::SetCollisionModel (const CrpiCollision *model)
+  {
+    collision_ = model;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiCell::SetCollisionArm (int robot, int arm)
+  {
+    if (robot < 0 || robot >= (int)robots_.size())
+    {
+      return CANON_REJECT;
+    }
+    arms_[robot] = (arm < 0) ? -1 : arm;
+    known_[robot] = false;
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API int CrpiCell::LastDeferred () const
+  {
+    return deferred_;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiCell::Dispatch (double startTimeout)
+  {
+    int count = 0, slot = 0;
+
+    for (unsigned int i = 0; i < staged_.size(); ++i)
+    {
+      if (staged_[i])
+      {
+        ++count;
+      }
+    }
+    if (count == 0)
+    {
+      return CANON_REJECT;
+    }
+
+    vector<vector<int> > waits(robots_.size());
+    deferred_ = 0;
+    if (collision_ != NULL)
+    {
+      resolveConflicts(waits);
+    }
+
+    std::shared_ptr<CrpiCellGate> gate = std::make_shared<CrpiCellGate>(count, startTimeout);
+    last_.assign(robots_.size(), CrpiCompletion());
+
+    for (unsigned int i = 0; i < staged_.size(); ++i)
+    {
+      if (!staged_[i])
+      {
+        continue;
+      }
+      std::function<CanonReturn ()> command = staged_[i];
+      int mine = slot++;
+      if (!waits[i].empty())
+      {
+        //! Held behind the arms it could hit; if one of them failed, it may have stopped anywhere
+        //! along its motion, so this one does not start
+        vector<CrpiCompletion> before;
+        for (unsigned int k = 0; k < waits[i].size(); ++k)
+        {
+          before.push_back(last_[waits[i][k]]);
+        }
+        std::function<CanonReturn ()> inner = command;
+        command = [before, inner] () mutable
+        {
+          for (unsigned int k = 0; k < before.size(); ++k)
+          {
+            if (before[k].get() != CANON_SUCCESS)
+            {
+              return CANON_REJECT;
+            }
+          }
+          return inner();
+        };
+        ++deferred_;
+      }
+      last_[i] = robots_[i].CallAsync([this, gate, mine, command] () mutable
+      {
+        return gated(gate, mine, command);
+      });
+      outstanding_.push_back(last_[i]);
+    }
+
+    staged_.clear();
+    motions_.clear();
+    return CANON_SUCCESS;
+  }
+
+
+  bool CrpiCell::motionPath (int robot, vector<robotAxes> &path) const
+  {
+    const CrpiCellMotion &motion = motions_[robot];
+    const CrpiKinematics *kin = collision_->Kinematics(arms_[robot]);
+    robotAxes start, q;
+
+    if (kin == NULL || motion.type == CELL_UNKNOWN)
+    {
+      return false;
+    }
+    if (known_[robot])
+    {
+      start = expected_[robot];
+    }
+    else if (robots_[robot].GetRobotAxes(&start) != CANON_SUCCESS)
+    {
+      return false;
+    }
+    path.clear();
+    path.push_back(start);
+
+    switch (motion.type)
+    {
+    case CELL_JOINT:
+      path.push_back(motion.axes);
+      break;
+    case CELL_FREE:
+      if (kin->Inverse(motion.pose, start, q) != CANON_SUCCESS)
+      {
+        return false;
+      }
+      path.push_back(q);
+      break;
+    case CELL_STRAIGHT:
+      {
+        //! Solved at short steps along the line, each from the last, with the orientation
+        //! interpolated angle by angle
+        robotPose from, to = motion.pose, at;
+        if (kin->Forward(start, from) != CANON_SUCCESS)
+        {
+          return false;
+        }
+        double dx = to.x - from.x, dy = to.y - from.y, dz = to.z - from.z,
+               dxr = remainder(to.xrot - from.xrot, 360.0),
+               dyr = remainder(to.yrot - from.yrot, 360.0),
+               dzr = remainder(to.zrot - from.zrot, 360.0);
+        int steps = (int)ceil(sqrt((dx * dx) + (dy * dy) + (dz * dz)) / CELL_STRAIGHT_STEP);
+        steps = (steps < 1) ? 1 : steps;
+        for (int k = 1; k <= steps; ++k)
+        {
+          double u = (double)k / steps;
+          at = from;
+          at.x += dx * u;
+          at.y += dy * u;
+          at.z += dz * u;
+          at.xrot += dxr * u;
+          at.yrot += dyr * u;
+          at.zrot += dzr * u;
+          if (kin->Inverse(at, path.back(), q) != CANON_SUCCESS)
+          {
+            return false;
+          }
+          path.push_back(q);
+        }
+      }
+      break;
+    case CELL_STILL:
+    default:
+      break;
+    }
+    return true;
+  }
+
+
+  void CrpiCell::resolveConflicts (vector<vector<int> > &waits)
+  {
+    vector<vector<robotAxes> > paths(staged_.size());
+    vector<bool> valid(staged_.size(), false);
+    unsigned int i, j;
+
+    for (i = 0; i < staged_.size(); ++i)
+    {
+      if (!staged_[i] || arms_[i] < 0)
+      {
+        continue;
+      }
+      valid[i] = motionPath(i, paths[i]);
+
+      //! The next tick starts from where this one leaves the arm, whether or not it has got there
+      known_[i] = valid[i];
+      if (valid[i])
+      {
+        expected_[i] = paths[i].back();
+      }
+    }
+
+    //! An arm waits for every earlier arm it could hit; arms with unknown motions are
+    //! assumed to hit every other checked arm
+    for (j = 0; j < staged_.size(); ++j)
+    {
+      if (!staged_[j] || arms_[j] < 0)
+      {
+        continue;
+      }
+      for (i = 0; i < j; ++i)
+      {
+        if (!staged_[i] || arms_[i] < 0)
+        {
+          continue;
+        }
+        if (!valid[i] || !valid[j] ||
+            collision_->SweptCollides(arms_[i], &paths[i][0], (int)paths[i].size(),
+                                      arms_[j], &paths[j][0], (int)paths[j].size()))
+        {
+          waits[j].push_back(i);
+        }
+      }
+    }
+  }
+
+
+  CanonReturn CrpiCell::gated (std::shared_ptr<CrpiCellGate> gate,
+                               int slot,
+                               std::function<CanonReturn ()> &command)
+  {
+    bool go;
+    double left, skew = -1.0;
+
+    ulapi_mutex_take(gate->mutex);
+    if (!gate->aborted && ++gate->arrived == gate->expected)
+    {
+      gate->released = true;
+      ulapi_cond_broadcast(gate->cond);
+    }
+    while (!gate->released && !gate->aborted)
+    {
+      left = gate->deadline - ulapi_time();
+      if (left <= 0.0)
+      {
+        //! A robot is still busy with earlier commands; drop the whole tick
+        gate->aborted = true;
+        ulapi_cond_broadcast(gate->cond);
+        break;
+      }
+      ulapi_cond_timedwait(gate->cond, gate->mutex, left);
+    }
+    go = gate->released;
+    ulapi_mutex_give(gate->mutex);
+
+    if (!go)
+    {
+      return CANON_REJECT;
+    }
+
+    double now = ulapi_time();
+    ulapi_mutex_take(gate->mutex);
+    gate->starts[slot] = now;
+    if (++gate->started == gate->expected)
+    {
+      double first = gate->starts[0], latest = gate->starts[0];
+      for (int i = 1; i < gate->expected; ++i)
+      {
+        first = (gate->starts[i] < first) ? gate->starts[i] : first;
+        latest = (gate->starts[i] > latest) ? gate->starts[i] : latest;
+      }
+      skew = latest - first;
+    }
+    ulapi_mutex_give(gate->mutex);
+
+    if (skew >= 0.0)
+    {
+      recordSkew(skew);
+    }
+
+    return command();
+  }
+
+
+  void CrpiCell::recordSkew (double skew)
+  {
+    ulapi_mutex_take(statsMutex_);
+    lastSkew_ = skew;
+    maxSkew_ = (skew > maxSkew_) ? skew : maxSkew_;
+    sumSkew_ += skew;
+    ++skewSamples_;
+    ulapi_mutex_give(statsMutex_);
+  }
+
+
+  LIBRARY_API CanonReturn CrpiCell::Join (double secs)
+  {
+    vector<CrpiCompletion> handles;
+
+    for (unsigned int i = 0; i < last_.size(); ++i)
+    {
+      if (last_[i].valid())
+      {
+        handles.push_back(last_[i]);
+      }
+    }
+    if (handles.empty())
+    {
+      return CANON_SUCCESS;
+    }
+    return crpi_wait_all(&handles[0], (int)handles.size(), secs);
+  }
+
+
+  LIBRARY_API int CrpiCell::JoinAny (double secs)
+  {
+    vector<CrpiCompletion> handles;
+    vector<int> robots;
+    int which;
+
+    for (unsigned int i = 0; i < last_.size(); ++i)
+    {
+      if (last_[i].valid())
+      {
+        handles.push_back(last_[i]);
+        robots.push_back(i);
+      }
+    }
+    if (handles.empty())
+    {
+      return -1;
+    }
+    which = crpi_wait_any(&handles[0], (int)handles.size(), secs);
+    return (which < 0) ? -1 : robots[which];
+  }
+
+
+  LIBRARY_API CanonReturn CrpiCell::Barrier (double secs)
+  {
+    CanonReturn val;
+
+    if (outstanding_.empty())
+    {
+      return CANON_SUCCESS;
+    }
+    val = crpi_wait_all(&outstanding_[0], (int)outstanding_.size(), secs);
+    if (val != CANON_RUNNING)
+    {
+      outstanding_.clear();
+    }
+    return val;
+  }
+
+
+  LIBRARY_API CrpiCompletion CrpiCell::Completion (int robot) const
+  {
+    if (robot < 0 || robot >= (int)last_.size())
+    {
+      return CrpiCompletion();
+    }
+    return last_[robot];
+  }
+
+
+  LIBRARY_API CanonReturn CrpiCell::Stop ()
+  {
+    CanonReturn result = CANON_SUCCESS;
+
+    //! Newest first, so that queued ticks are dropped before the running one is stopped
+    for (int i = (int)outstanding_.size() - 1; i >= 0; --i)
+    {
+      if (outstanding_[i].cancel() != CANON_SUCCESS)
+      {
+        result = CANON_REJECT;
+      }
+    }
+    return result;
+  }
+
+
+  LIBRARY_API double CrpiCell::LastStartSkew () const
+  {
+    double val;
+    ulapi_mutex_take(statsMutex_);
+    val = lastSkew_;
+    ulapi_mutex_give(statsMutex_);
+    return val;
+  }
+
+
+  LIBRARY_API double CrpiCell::MaxStartSkew () const
+  {
+    double val;
+    ulapi_mutex_take(statsMutex_);
+    val = maxSkew_;
+    ulapi_mutex_give(statsMutex_);
+    return val;
+  }
+
+
+  LIBRARY_API double CrpiCell::MeanStartSkew () const
+  {
+    double val;
+    ulapi_mutex_take(statsMutex_);
+    val = (skewSamples_ > 0) ? (sumSkew_ / skewSamples_) : -1.0;
+    ulapi_mutex_give(statsMutex_);
+    return val;
+  }
+
+
+  LIBRARY_API int CrpiCell::SkewSamples () const
+  {
+    int val;
+    ulapi_mutex_take(statsMutex_);
+    val = skewSamples_;
+    ulapi_mutex_give(statsMutex_);
+    return val;
+  }
+
+
+  LIBRARY_API void CrpiCell::ResetSkew ()
+  {
+    ulapi_mutex_take(statsMutex_);
+    lastSkew_ = maxSkew_ = -1.0;
+    sumSkew_ = 0.0;
+    skewSamples_ = 0;
+    ulapi_mutex_give(statsMutex_);
+  }
+} // crpi_robot
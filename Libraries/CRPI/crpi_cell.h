@@ -0,0 +1,273 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_cell.h
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Synchronized command scheduler for work cells with several robots.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_cell_H
+#define crpi_cell_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "crpi_any_robot.h"
+#include "crpi_collision.h"
+
+namespace crpi_robot
+{
+  struct CrpiCellGate;
+
+  //! @brief What a staged command does to its arm, for the collision check
+  //!
+  typedef enum
+  {
+    CELL_STILL = 0, //! The arm does not move (e.g., a gripper command)
+    CELL_UNKNOWN,   //! Anything staged with StageCommand
+    CELL_JOINT,     //! Joint motion to a configuration
+    CELL_FREE,      //! Motion to a pose, assumed to be a joint motion to its nearest solution
+    CELL_STRAIGHT   //! Straight-line motion to a pose
+  } CrpiCellMotionType;
+
+  //! @brief Motion of a staged command
+  //!
+  struct CrpiCellMotion
+  {
+    CrpiCellMotionType type;
+    robotAxes axes;
+    robotPose pose;
+
+    CrpiCellMotion () :
+      type(CELL_UNKNOWN)
+    {
+    }
+  };
+
+  //! @ingroup Robot
+  //!
+  //! @brief Issues commands to several robots, of any CrpiRobot type, in the same tick
+  //!
+  //! @note Commands are staged per robot and then dispatched together.  Each dispatched command
+  //!       is queued on its robot's command thread (see CrpiRobot::MoveToAsync), where it waits at
+  //!       a common start gate until every robot in the tick has reached it, so that no arm starts
+  //!       moving before the others are ready.  The spread of the start times is recorded as the
+  //!       tick's start skew.
+  //! @note Robots must outlive the cell.  A robot should not be given other asynchronous
+  //!       commands while a tick is outstanding, or the tick waits behind them.
+  //! @note With a collision model (SetCollisionModel), the motions in a tick are checked pairwise
+  //!       when it is dispatched.  Arms whose swept volumes do not intersect start together; an
+  //!       arm whose motion intersects that of an arm staged before it starts only once that
+  //!       arm's command has finished (and not at all if it failed).
+  //!
+  class LIBRARY_API CrpiCell
+  {
+  public:
+
+    //! @brief Default constructor
+    //!
+    CrpiCell ();
+
+    //! @brief Default destructor, waits for all dispatched commands to finish
+    //!
+    ~CrpiCell ();
+
+    //! @brief Add a robot to the cell
+    //!
+    //! @param robot The robot to schedule; any CrpiRobot<T>* converts to an AnyCrpiRobot
+    //! @param name  Label for the robot
+    //!
+    //! @return The robot's index, used by the Stage* methods
+    //!
+    int AddRobot (AnyCrpiRobot robot, const char *name = NULL);
+
+    //! @brief Number of robots in the cell
+    //!
+    int Robots () const;
+
+    //! @brief Name given to a robot when it was added
+    //!
+    const char *Name (int robot) const;
+
+    //! @brief Stage a command for the next tick, replacing any command already staged for the robot
+    //!
+    //! @return SUCCESS if the command is staged, REJECT if the robot index is not valid
+    //!
+    //! @note Arguments are copied when the command is staged.
+    //!
+    CanonReturn StageMoveTo (int robot, robotPose &pose);
+    CanonReturn StageMoveStraightTo (int robot, robotPose &pose);
+    CanonReturn StageMoveToAxisTarget (int robot, robotAxes &axes);
+    CanonReturn StageSetTool (int robot, double percent);
+
+    //! @brief Stage an arbitrary command, run on the robot's command thread
+    //!
+    //! @param robot   The robot's index
+    //! @param command The command to run; it should block until the robot's motion is complete
+    //!
+    //! @return SUCCESS if the command is staged, REJECT if the robot index is not valid
+    //!
+    CanonReturn StageCommand (int robot, std::function<CanonReturn ()> command);
+
+    //! @brief Discard all staged commands
+    //!
+    void ClearStaged ();
+
+    //! @brief Check the motions of each tick against a collision model (NULL for none), which
+    //!        must outlive the cell
+    //!
+    void SetCollisionModel (const CrpiCollision *model);
+
+    //! @brief Give a robot its arm in the collision model.  Robots without one are not checked.
+    //!
+    //! @param robot The robot's index
+    //! @param arm   The arm's index in the collision model, or -1 for none
+    //!
+    //! @return SUCCESS if the arm is set, REJECT if the robot index is not valid
+    //!
+    CanonReturn SetCollisionArm (int robot, int arm);
+
+    //! @brief Number of robots in the most recent tick that were held back until another's
+    //!        command finished
+    //!
+    int LastDeferred () const;
+
+    //! @brief Issue all staged commands as one tick
+    //!
+    //! @param startTimeout Maximum time (s) to wait for every robot in the tick to become ready.  If
+    //!                     any robot is not ready in time, no command in the tick runs and each
+    //!                     returns REJECT.
+    //!
+    //! @return SUCCESS if the tick was dispatched, REJECT if nothing was staged
+    //!
+    CanonReturn Dispatch (double startTimeout = 1.0);
+
+    //! @brief Wait for every command of the most recent tick to finish
+    //!
+    //! @param secs Maximum time to wait (s), or a negative value to wait indefinitely
+    //!
+    //! @return SUCCESS if all commands succeeded, the first other result otherwise, or RUNNING on
+    //!         timeout
+    //!
+    CanonReturn Join (double secs = -1.0);
+
+    //! @brief Wait for the first command of the most recent tick to finish
+    //!
+    //! @param secs Maximum time to wait (s), or a negative value to wait indefinitely
+    //!
+    //! @return The index of the robot whose command finished, or -1 on timeout
+    //!
+    int JoinAny (double secs = -1.0);
+
+    //! @brief Wait for every command of every tick dispatched so far to finish
+    //!
+    //! @param secs Maximum time to wait (s), or a negative value to wait indefinitely
+    //!
+    //! @return As Join.  Finished ticks are forgotten unless the barrier times out.
+    //!
+    CanonReturn Barrier (double secs = -1.0);
+
+    //! @brief Completion handle of a robot's command in the most recent tick
+    //!
+    //! @return The handle, which is not valid() if the robot had no command in that tick
+    //!
+    CrpiCompletion Completion (int robot) const;
+
+    //! @brief Cancel every outstanding command, stopping robots that are already moving
+    //!
+    //! @return SUCCESS if every outstanding command was cancelled, REJECT if some had finished
+    //!
+    CanonReturn Stop ();
+
+    //! @brief Start skew (s) of the most recent tick whose commands have all started: the time
+    //!        between the first and the last robot beginning its command
+    //!
+    //! @return The skew, or -1 if no tick has started yet
+    //!
+    double LastStartSkew () const;
+
+    //! @brief Largest start skew (s) seen since construction or ResetSkew
+    //!
+    //! @return The skew, or -1 if no tick has started yet
+    //!
+    double MaxStartSkew () const;
+
+    //! @brief Mean start skew (s) since construction or ResetSkew
+    //!
+    //! @return The skew, or -1 if no tick has started yet
+    //!
+    double MeanStartSkew () const;
+
+    //! @brief Number of ticks included in the skew statistics
+    //!
+    int SkewSamples () const;
+
+    //! @brief Clear the skew statistics
+    //!
+    void ResetSkew ();
+
+  private:
+
+    //! @brief Robots in the cell, and their names
+    //!
+    std::vector<AnyCrpiRobot> robots_;
+    std::vector<std::string> names_;
+
+    //! @brief Command staged per robot for the next tick (empty if none)
+    //!
+    std::vector<std::function<CanonReturn ()> > staged_;
+    std::vector<CrpiCellMotion> motions_;
+
+    //! @brief Collision model, each robot's arm in it, and the configuration each robot's
+    //!        dispatched motions end in (if known)
+    //!
+    const CrpiCollision *collision_;
+    std::vector<int> arms_;
+    std::vector<robotAxes> expected_;
+    std::vector<bool> known_;
+    int deferred_;
+
+    //! @brief Completion handles of the most recent tick, one per robot
+    //!
+    std::vector<CrpiCompletion> last_;
+
+    //! @brief Completion handles of every tick not yet cleared by Barrier
+    //!
+    std::vector<CrpiCompletion> outstanding_;
+
+    //! @brief Guards the skew statistics, which are updated from the robots' command threads
+    //!
+    ulapi_mutex_struct *statsMutex_;
+    double lastSkew_;
+    double maxSkew_;
+    double sumSkew_;
+    int skewSamples_;
+
+    //! @brief Called by the last robot of a tick to pass the start gate
+    //!
+    void recordSkew (double skew);
+
+    //! @brief Joint-space path of a staged motion from the robot's expected configuration
+    //!
+    //! @return False if the path is not known
+    //!
+    bool motionPath (int robot, std::vector<robotAxes> &path) const;
+
+    //! @brief Robots in the tick that each staged robot must wait for, from the collision model
+    //!
+    void resolveConflicts (std::vector<std::vector<int> > &waits);
+
+    //! @brief Wait at a tick's start gate, then run the command
+    //!
+    CanonReturn gated (std::shared_ptr<CrpiCellGate> gate, int slot, std::function<CanonReturn ()> &command);
+  }; // CrpiCell
+} // crpi_robot
+
+#endif
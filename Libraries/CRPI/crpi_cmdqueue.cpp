@@ -0,0 +1,226 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_cmdqueue.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Prioritized command writer definitions.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_cmdqueue.h"
+#include "crpi_hub.h"
+#include <deque>
+
+using namespace std;
+
+namespace crpi_robot
+{
+  //! @brief A command waiting in Send.  Lives on the caller's stack; done and ok are set by the
+  //!        writer (or by a stop that drops it) with the queue's mutex held.
+  //!
+  struct cmdQueueEntry
+  {
+    const string *command;
+    CrpiCommandPriority priority;
+    double queued;
+    bool done;
+    bool ok;
+  };
+
+  struct cmdQueueState
+  {
+    CrpiCommandWriter writer;
+    void *context;
+
+    //! @brief Waiting commands, by priority
+    //!
+    deque<cmdQueueEntry*> urgent;
+    deque<cmdQueueEntry*> normal;
+
+    //! @brief Guards everything below; wake is signalled when a command is queued or the queue
+    //!        closes, and done broadcast when commands finish
+    //!
+    ulapi_mutex_struct *mutex;
+    void *wake;
+    void *done;
+    bool run;
+
+    double stopLast;
+    double stopWorst;
+
+    CrpiHistogram *stopMetric;
+    CrpiCounter *droppedMetric;
+
+    void *loop;
+  };
+
+  //! @brief Bounds (s) of the stop latency histogram:  from queueing behind nothing to waiting
+  //!        out a reconnection
+  //!
+  static const double stopBounds[] = {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025,
+                                      0.05, 0.1, 0.25, 0.5, 1.0};
+
+
+  //! @brief Finish every command in a queue without writing it
+  //!
+  static void dropAll (cmdQueueState *cs, deque<cmdQueueEntry*> &queue)
+  {
+    while (!queue.empty())
+    {
+      queue.front()->ok = false;
+      queue.front()->done = true;
+      queue.pop_front();
+      cs->droppedMetric->Inc();
+    }
+  }
+
+
+  LIBRARY_API CrpiCommandQueue::CrpiCommandQueue (const char *name, CrpiCommandWriter writer, void *context) :
+    state_(new cmdQueueState)
+  {
+    string labels = CrpiMetrics::Label("connection", (name == NULL) ? "" : name);
+
+    state_->writer = writer;
+    state_->context = context;
+    state_->mutex = ulapi_mutex_new(0);
+    state_->wake = ulapi_cond_new(0);
+    state_->done = ulapi_cond_new(0);
+    state_->run = true;
+    state_->stopLast = state_->stopWorst = 0.0;
+    state_->stopMetric = CrpiMetrics::Histogram("crpi_stop_latency_seconds",
+                                                "Time from a stop being sent to its command being written",
+                                                labels, stopBounds, sizeof(stopBounds) / sizeof(stopBounds[0]));
+    state_->droppedMetric = CrpiMetrics::Counter("crpi_commands_dropped",
+                                                 "Queued commands dropped by a stop", labels);
+    //! Above the sensor threads, so that a stop is not held up by feedback processing
+    state_->loop = SensorHub::Instance().StartLoop(writerThread, state_, HUB_REALTIME);
+  }
+
+
+  LIBRARY_API CrpiCommandQueue::~CrpiCommandQueue ()
+  {
+    ulapi_mutex_take(state_->mutex);
+    state_->run = false;
+    dropAll(state_, state_->urgent);
+    dropAll(state_, state_->normal);
+    ulapi_cond_broadcast(state_->done);
+    ulapi_cond_signal(state_->wake);
+    ulapi_mutex_give(state_->mutex);
+
+    SensorHub::Instance().JoinLoop(state_->loop);
+    ulapi_cond_delete(state_->done);
+    ulapi_cond_delete(state_->wake);
+    ulapi_mutex_delete(state_->mutex);
+    delete state_;
+  }
+
+
+  LIBRARY_API bool CrpiCommandQueue::Send (const string &command, CrpiCommandPriority priority)
+  {
+    cmdQueueEntry entry;
+
+    entry.command = &command;
+    entry.priority = priority;
+    entry.queued = ulapi_time();
+    entry.done = entry.ok = false;
+
+    ulapi_mutex_take(state_->mutex);
+    if (!state_->run || state_->loop == NULL)
+    {
+      ulapi_mutex_give(state_->mutex);
+      return false;
+    }
+    if (priority == CMDQUEUE_STOP)
+    {
+      dropAll(state_, state_->normal);
+      ulapi_cond_broadcast(state_->done);
+    }
+    if (priority == CMDQUEUE_NORMAL)
+    {
+      state_->normal.push_back(&entry);
+    }
+    else
+    {
+      state_->urgent.push_back(&entry);
+    }
+    ulapi_cond_signal(state_->wake);
+    while (!entry.done)
+    {
+      ulapi_cond_wait(state_->done, state_->mutex);
+    }
+    ulapi_mutex_give(state_->mutex);
+
+    return entry.ok;
+  }
+
+
+  LIBRARY_API void CrpiCommandQueue::GetStopLatency (double &last, double &worst) const
+  {
+    ulapi_mutex_take(state_->mutex);
+    last = state_->stopLast;
+    worst = state_->stopWorst;
+    ulapi_mutex_give(state_->mutex);
+  }
+
+
+  void CrpiCommandQueue::writerThread (void *param)
+  {
+    cmdQueueState *cs = (cmdQueueState*)param;
+    vector<cmdQueueEntry*> batch;
+    string commands;
+    bool ok;
+
+    ulapi_mutex_take(cs->mutex);
+    while (cs->run)
+    {
+      batch.clear();
+      commands.clear();
+      if (!cs->urgent.empty())
+      {
+        //! Urgent commands are written one at a time, so each is on its way as soon as possible
+        batch.push_back(cs->urgent.front());
+        cs->urgent.pop_front();
+        commands = *batch.back()->command;
+      }
+      else if (!cs->normal.empty())
+      {
+        //! Everything queued while the last write was in progress, up to CMDQUEUE_BATCH bytes
+        do
+        {
+          batch.push_back(cs->normal.front());
+          cs->normal.pop_front();
+          commands += *batch.back()->command;
+        } while (!cs->normal.empty() &&
+                 commands.size() + cs->normal.front()->command->size() <= CMDQUEUE_BATCH);
+      }
+      else
+      {
+        ulapi_cond_wait(cs->wake, cs->mutex);
+        continue;
+      }
+      ulapi_mutex_give(cs->mutex);
+
+      ok = cs->writer(cs->context, commands);
+
+      ulapi_mutex_take(cs->mutex);
+      for (size_t i = 0; i < batch.size(); ++i)
+      {
+        if (batch[i]->priority == CMDQUEUE_STOP)
+        {
+          cs->stopLast = ulapi_time() - batch[i]->queued;
+          cs->stopWorst = (cs->stopLast > cs->stopWorst) ? cs->stopLast : cs->stopWorst;
+          cs->stopMetric->Observe(cs->stopLast);
+        }
+        batch[i]->ok = ok;
+        batch[i]->done = true;
+      }
+      ulapi_cond_broadcast(cs->done);
+    }
+    ulapi_mutex_give(cs->mutex);
+  }
+} // crpi_robot
@@ -0,0 +1,103 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_cmdqueue.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Prioritized command writer for the robot interfaces.
+//
+//  Every command a driver sends goes out over one connection, so a stop
+//  sent while another thread holds the connection (or while a batch of
+//  commands is queued for it) waits its turn.  A CrpiCommandQueue gives the
+//  connection a single writer thread:  callers queue commands and wait for
+//  them to be written, urgent commands (stops, speed overrides) are written
+//  ahead of everything queued, and normal commands that queue up while a
+//  write is in progress are written together.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_cmdqueue_H
+#define crpi_cmdqueue_H
+
+#include "crpi.h"
+#include "crpi_metrics.h"
+#include <string>
+
+//! @brief Most bytes of normal commands written together
+//!
+#define CMDQUEUE_BATCH 16384
+
+namespace crpi_robot
+{
+  //! @brief Priority of a queued command
+  //!
+  typedef enum
+  {
+    CMDQUEUE_NORMAL = 0, //! Written in order, batched with the normal commands queued with it
+    CMDQUEUE_URGENT,     //! Written before any queued normal command (e.g., a speed override)
+    CMDQUEUE_STOP        //! As urgent; normal commands queued before it are dropped, since they
+                         //! would set the robot moving again
+  } CrpiCommandPriority;
+
+  //! @brief Writes one or more commands to the connection; true if every byte was written.
+  //!        Called only from the queue's writer thread.
+  //!
+  typedef bool (*CrpiCommandWriter)(void *context, const std::string &commands);
+
+  //! @brief Queued commands and the writer thread (defined in crpi_cmdqueue.cpp)
+  //!
+  struct cmdQueueState;
+
+  //! @ingroup Robot
+  //!
+  //! @brief A driver's outgoing commands, written by one thread in order of priority.  Stop
+  //!        latency (from Send to the stop being written) is exported as the
+  //!        crpi_stop_latency_seconds histogram, labelled with the queue's name.
+  //!
+  class LIBRARY_API CrpiCommandQueue
+  {
+  public:
+    //! @brief Constructor.  Starts the writer thread.
+    //!
+    //! @param name    Name of the connection (e.g., "universal/192.168.1.10"), for the metrics
+    //! @param writer  Function that writes commands to the connection
+    //! @param context Passed to writer
+    //!
+    CrpiCommandQueue (const char *name, CrpiCommandWriter writer, void *context);
+
+    //! @brief Destructor.  Commands still queued are dropped, and the writer thread stopped.
+    //!
+    ~CrpiCommandQueue ();
+
+    //! @brief Queue a command and wait until it has been written
+    //!
+    //! @param command  The command
+    //! @param priority Its priority
+    //!
+    //! @return True if the command was written, false if the write failed or the command was
+    //!         dropped (by a later stop, or because the queue is closing)
+    //!
+    bool Send (const std::string &command, CrpiCommandPriority priority = CMDQUEUE_NORMAL);
+
+    //! @brief Seconds the last stop waited to be written, and the longest such wait (0 if none)
+    //!
+    void GetStopLatency (double &last, double &worst) const;
+
+  private:
+
+    cmdQueueState *state_;
+
+    //! @brief Writer thread
+    //!
+    static void writerThread (void *param);
+
+    CrpiCommandQueue (const CrpiCommandQueue &) = delete;
+    CrpiCommandQueue &operator= (const CrpiCommandQueue &) = delete;
+  }; // CrpiCommandQueue
+} // crpi_robot
+
+#endif
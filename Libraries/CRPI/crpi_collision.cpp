@@ -0,0 +1,473 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_collision.cpp
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Capsule models of arms sharing a work cell, and checks of whether their
+//  configurations or motions intersect.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_collision.h"
+
+#include <cmath>
+#include <cfloat>
+
+using namespace std;
+
+#define COLLISION_DEG (3.14159265358979323846 / 180.0)
+
+namespace crpi_robot
+{
+  struct collisionSweep
+  {
+    //! @brief Links (capsules per configuration) and sampled configurations
+    //!
+    int links;
+    int samples;
+
+    //! @brief Per link and sample (link-major):  the capsule's ends, its radius (grown by half the
+    //!        margin and by its motion to the neighboring samples), and its bounding box (minimum
+    //!        then maximum corner)
+    //!
+    vector<double> ends;
+    vector<double> radius;
+    vector<double> box;
+
+    //! @brief Bounding box of each link over all samples, and of the whole arm
+    //!
+    vector<double> linkBox;
+    double root[6];
+  };
+
+
+  static bool overlap (const double *a, const double *b)
+  {
+    return a[0] <= b[3] && b[0] <= a[3] && a[1] <= b[4] && b[1] <= a[4] && a[2] <= b[5] && b[2] <= a[5];
+  }
+
+
+  static void grow (double *box, const double *other)
+  {
+    for (int i = 0; i < 3; ++i)
+    {
+      box[i] = (other[i] < box[i]) ? other[i] : box[i];
+      box[3 + i] = (other[3 + i] > box[3 + i]) ? other[3 + i] : box[3 + i];
+    }
+  }
+
+
+  //! Distance from a point to a box (0 inside it)
+  static double boxDistance (const double *box, const double *p)
+  {
+    double sum = 0.0, d;
+    for (int i = 0; i < 3; ++i)
+    {
+      d = (p[i] < box[i]) ? (box[i] - p[i]) : ((p[i] > box[3 + i]) ? (p[i] - box[3 + i]) : 0.0);
+      sum += d * d;
+    }
+    return sqrt(sum);
+  }
+
+
+  static double distance (const double *a, const double *b)
+  {
+    double dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+    return sqrt((dx * dx) + (dy * dy) + (dz * dz));
+  }
+
+
+  //! Squared distance between segments p0-p1 and q0-q1 (Ericson, Real-Time Collision Detection)
+  static double segmentDistance2 (const double *p0, const double *p1, const double *q0, const double *q1)
+  {
+    double d1[3], d2[3], r[3], c1[3], c2[3], s, t;
+    int i;
+    for (i = 0; i < 3; ++i)
+    {
+      d1[i] = p1[i] - p0[i];
+      d2[i] = q1[i] - q0[i];
+      r[i] = p0[i] - q0[i];
+    }
+    double a = (d1[0] * d1[0]) + (d1[1] * d1[1]) + (d1[2] * d1[2]),
+           e = (d2[0] * d2[0]) + (d2[1] * d2[1]) + (d2[2] * d2[2]),
+           f = (d2[0] * r[0]) + (d2[1] * r[1]) + (d2[2] * r[2]);
+    if (a <= DBL_EPSILON && e <= DBL_EPSILON)
+    {
+      s = t = 0.0;
+    }
+    else if (a <= DBL_EPSILON)
+    {
+      s = 0.0;
+      t = f / e;
+      t = (t < 0.0) ? 0.0 : ((t > 1.0) ? 1.0 : t);
+    }
+    else
+    {
+      double c = (d1[0] * r[0]) + (d1[1] * r[1]) + (d1[2] * r[2]);
+      if (e <= DBL_EPSILON)
+      {
+        t = 0.0;
+        s = -c / a;
+        s = (s < 0.0) ? 0.0 : ((s > 1.0) ? 1.0 : s);
+      }
+      else
+      {
+        double b = (d1[0] * d2[0]) + (d1[1] * d2[1]) + (d1[2] * d2[2]), denom = (a * e) - (b * b);
+        s = (denom > DBL_EPSILON) ? (((b * f) - (c * e)) / denom) : 0.0;
+        s = (s < 0.0) ? 0.0 : ((s > 1.0) ? 1.0 : s);
+        t = ((b * s) + f) / e;
+        if (t < 0.0)
+        {
+          t = 0.0;
+          s = -c / a;
+          s = (s < 0.0) ? 0.0 : ((s > 1.0) ? 1.0 : s);
+        }
+        else if (t > 1.0)
+        {
+          t = 1.0;
+          s = (b - c) / a;
+          s = (s < 0.0) ? 0.0 : ((s > 1.0) ? 1.0 : s);
+        }
+      }
+    }
+    double sum = 0.0;
+    for (i = 0; i < 3; ++i)
+    {
+      c1[i] = p0[i] + (d1[i] * s);
+      c2[i] = q0[i] + (d2[i] * t);
+      sum += (c1[i] - c2[i]) * (c1[i] - c2[i]);
+    }
+    return sum;
+  }
+
+
+  LIBRARY_API CrpiCollision::CrpiCollision () :
+    margin_(COLLISION_MARGIN),
+    step_(COLLISION_STEP)
+  {
+  }
+
+
+  LIBRARY_API CrpiCollision::~CrpiCollision ()
+  {
+  }
+
+
+  LIBRARY_API int CrpiCollision::AddArm (const CrpiKinematics *kin, const robotPose &base, double radius)
+  {
+    collisionArm arm;
+    double cx = cos(base.xrot * COLLISION_DEG), sx = sin(base.xrot * COLLISION_DEG),
+           cy = cos(base.yrot * COLLISION_DEG), sy = sin(base.yrot * COLLISION_DEG),
+           cz = cos(base.zrot * COLLISION_DEG), sz = sin(base.zrot * COLLISION_DEG);
+
+    arm.kin = kin;
+    arm.base[0] = cz * cy;
+    arm.base[1] = (cz * sy * sx) - (sz * cx);
+    arm.base[2] = (cz * sy * cx) + (sz * sx);
+    arm.base[3] = sz * cy;
+    arm.base[4] = (sz * sy * sx) + (cz * cx);
+    arm.base[5] = (sz * sy * cx) - (cz * sx);
+    arm.base[6] = -sy;
+    arm.base[7] = cy * sx;
+    arm.base[8] = cy * cx;
+    arm.base[9] = base.x;
+    arm.base[10] = base.y;
+    arm.base[11] = base.z;
+
+    if (radius > 0.0)
+    {
+      arm.radius = radius;
+    }
+    else
+    {
+      //! Roughly the half-width of the arms' larger links
+      switch (kin->Model())
+      {
+      case KIN_UR3:
+        arm.radius = 50.0;
+        break;
+      case KIN_UR10:
+        arm.radius = 80.0;
+        break;
+      case KIN_LWR4:
+        arm.radius = 70.0;
+        break;
+      case KIN_IRB14000_LEFT:
+      case KIN_IRB14000_RIGHT:
+        arm.radius = 50.0;
+        break;
+      case KIN_UR5:
+      default:
+        arm.radius = 65.0;
+        break;
+      }
+    }
+    arms_.push_back(arm);
+    return (int)arms_.size() - 1;
+  }
+
+
+  LIBRARY_API int CrpiCollision::Arms () const
+  {
+    return (int)arms_.size();
+  }
+
+
+  LIBRARY_API const CrpiKinematics *CrpiCollision::Kinematics (int arm) const
+  {
+    return (arm < 0 || arm >= (int)arms_.size()) ? NULL : arms_[arm].kin;
+  }
+
+
+  LIBRARY_API void CrpiCollision::SetMargin (double margin)
+  {
+    margin_ = (margin < 0.0) ? 0.0 : margin;
+  }
+
+
+  LIBRARY_API void CrpiCollision::SetStep (double step)
+  {
+    step_ = (step > 0.0) ? step : COLLISION_STEP;
+  }
+
+
+  LIBRARY_API bool CrpiCollision::Collides (int armA, const robotAxes &axesA, int armB, const robotAxes &axesB) const
+  {
+    return SweptCollides(armA, &axesA, 1, armB, &axesB, 1);
+  }
+
+
+  LIBRARY_API bool CrpiCollision::SweptCollides (int armA, const robotAxes *pathA, int countA,
+                                                 int armB, const robotAxes *pathB, int countB) const
+  {
+    collisionSweep a, b;
+    if (!sweep(armA, pathA, countA, a) || !sweep(armB, pathB, countB, b))
+    {
+      return true;
+    }
+    return intersects(a, b);
+  }
+
+
+  LIBRARY_API double CrpiCollision::Separation (int arm, const robotAxes *path, int count,
+                                                const double *points, int numPoints) const
+  {
+    collisionSweep s;
+    double best = DBL_MAX, d;
+    int i, l, k;
+
+    if (points == NULL || numPoints < 1)
+    {
+      return DBL_MAX;
+    }
+    if (!sweep(arm, path, count, s))
+    {
+      return 0.0;
+    }
+    for (i = 0; i < numPoints && best > 0.0; ++i)
+    {
+      const double *p = &points[(size_t)i * 3];
+      if (boxDistance(s.root, p) >= best)
+      {
+        continue;
+      }
+      for (l = 0; l < s.links; ++l)
+      {
+        if (boxDistance(&s.linkBox[(size_t)l * 6], p) >= best)
+        {
+          continue;
+        }
+        for (k = 0; k < s.samples; ++k)
+        {
+          size_t c = ((size_t)l * s.samples) + k;
+          //! The boxes hold the capsules, so none of a box's capsules is nearer than the box
+          if (boxDistance(&s.box[c * 6], p) >= best)
+          {
+            continue;
+          }
+          d = sqrt(segmentDistance2(p, p, &s.ends[c * 6], &s.ends[(c * 6) + 3])) - (s.radius[c] - (margin_ / 2.0));
+          best = (d < best) ? d : best;
+        }
+      }
+    }
+    return (best < 0.0) ? 0.0 : best;
+  }
+
+
+  bool CrpiCollision::sweep (int arm, const robotAxes *path, int count, collisionSweep &out) const
+  {
+    double points[(KIN_JOINTS_MAX + 2) * 3], move;
+    int i, j, k, l, n, s, joints;
+
+    if (arm < 0 || arm >= (int)arms_.size() || path == NULL || count < 1)
+    {
+      return false;
+    }
+    const collisionArm &model = arms_[arm];
+    joints = model.kin->Joints();
+    for (i = 0; i < count; ++i)
+    {
+      if (path[i].axes < joints)
+      {
+        return false;
+      }
+    }
+
+    //! Samples:  every path configuration, and enough in between to keep joint steps short
+    out.samples = 1;
+    for (i = 1; i < count; ++i)
+    {
+      for (move = 0.0, j = 0; j < joints; ++j)
+      {
+        move = (fabs(path[i].axis[j] - path[i - 1].axis[j]) > move) ? fabs(path[i].axis[j] - path[i - 1].axis[j]) : move;
+      }
+      n = (int)ceil(move / step_);
+      out.samples += (n < 1) ? 1 : n;
+    }
+    out.links = joints + 1;
+    out.ends.resize((size_t)out.links * out.samples * 6);
+    out.radius.resize((size_t)out.links * out.samples);
+    out.box.resize((size_t)out.links * out.samples * 6);
+    out.linkBox.resize((size_t)out.links * 6);
+
+    //! Centerline at each sample, in the cell frame
+    robotAxes q = path[0];
+    for (s = 0, i = 0; i < count; ++i)
+    {
+      n = 1;
+      if (i > 0)
+      {
+        for (move = 0.0, j = 0; j < joints; ++j)
+        {
+          move = (fabs(path[i].axis[j] - path[i - 1].axis[j]) > move) ? fabs(path[i].axis[j] - path[i - 1].axis[j]) : move;
+        }
+        n = (int)ceil(move / step_);
+        n = (n < 1) ? 1 : n;
+      }
+      for (k = (i == 0) ? n : 1; k <= n; ++k, ++s)
+      {
+        for (j = 0; j < joints; ++j)
+        {
+          q.axis[j] = (i == 0) ? path[0].axis[j] :
+                      (path[i - 1].axis[j] + ((path[i].axis[j] - path[i - 1].axis[j]) * k / n));
+        }
+        model.kin->Points(q, points);
+        for (l = 0; l < out.links; ++l)
+        {
+          double *e = &out.ends[(((size_t)l * out.samples) + s) * 6];
+          for (j = 0; j < 3; ++j)
+          {
+            const double *p = &points[(l * 3)], *p1 = &points[((l + 1) * 3)];
+            e[j] = (model.base[j * 3] * p[0]) + (model.base[(j * 3) + 1] * p[1]) + (model.base[(j * 3) + 2] * p[2]) + model.base[9 + j];
+            e[3 + j] = (model.base[j * 3] * p1[0]) + (model.base[(j * 3) + 1] * p1[1]) + (model.base[(j * 3) + 2] * p1[2]) + model.base[9 + j];
+          }
+        }
+      }
+    }
+
+    //! Capsules grown by their travel to neighboring samples, and the boxes over them
+    for (l = 0; l < out.links; ++l)
+    {
+      double *lb = &out.linkBox[(size_t)l * 6];
+      for (s = 0; s < out.samples; ++s)
+      {
+        size_t c = ((size_t)l * out.samples) + s;
+        const double *e = &out.ends[c * 6];
+        double r = model.radius + (margin_ / 2.0), travel = 0.0;
+        for (k = -1; k <= 1; k += 2)
+        {
+          if (s + k >= 0 && s + k < out.samples)
+          {
+            const double *o = &out.ends[(c + k) * 6];
+            move = (distance(e, o) > distance(&e[3], &o[3])) ? distance(e, o) : distance(&e[3], &o[3]);
+            travel = (move > travel) ? move : travel;
+          }
+        }
+        r += travel / 2.0;
+        out.radius[c] = r;
+        double *b = &out.box[c * 6];
+        for (j = 0; j < 3; ++j)
+        {
+          b[j] = ((e[j] < e[3 + j]) ? e[j] : e[3 + j]) - r;
+          b[3 + j] = ((e[j] > e[3 + j]) ? e[j] : e[3 + j]) + r;
+        }
+        if (s == 0)
+        {
+          for (j = 0; j < 6; ++j)
+          {
+            lb[j] = b[j];
+          }
+        }
+        else
+        {
+          grow(lb, b);
+        }
+      }
+      if (l == 0)
+      {
+        for (j = 0; j < 6; ++j)
+        {
+          out.root[j] = lb[j];
+        }
+      }
+      else
+      {
+        grow(out.root, lb);
+      }
+    }
+    return true;
+  }
+
+
+  bool CrpiCollision::intersects (const collisionSweep &a, const collisionSweep &b) const
+  {
+    int la, lb, sa, sb;
+
+    if (!overlap(a.root, b.root))
+    {
+      return false;
+    }
+    for (la = 0; la < a.links; ++la)
+    {
+      if (!overlap(&a.linkBox[(size_t)la * 6], b.root))
+      {
+        continue;
+      }
+      for (lb = 0; lb < b.links; ++lb)
+      {
+        if (!overlap(&a.linkBox[(size_t)la * 6], &b.linkBox[(size_t)lb * 6]))
+        {
+          continue;
+        }
+        for (sa = 0; sa < a.samples; ++sa)
+        {
+          size_t ca = ((size_t)la * a.samples) + sa;
+          if (!overlap(&a.box[ca * 6], &b.linkBox[(size_t)lb * 6]))
+          {
+            continue;
+          }
+          for (sb = 0; sb < b.samples; ++sb)
+          {
+            size_t cb = ((size_t)lb * b.samples) + sb;
+            if (!overlap(&a.box[ca * 6], &b.box[cb * 6]))
+            {
+              continue;
+            }
+            double r = a.radius[ca] + b.radius[cb];
+            if (segmentDistance2(&a.ends[ca * 6], &a.ends[(ca * 6) + 3],
+                                 &b.ends[cb * 6], &b.ends[(cb * 6) + 3]) < r * r)
+            {
+              return true;
+            }
+          }
+        }
+      }
+    }
+    return false;
+  }
+} // namespace crpi_robot
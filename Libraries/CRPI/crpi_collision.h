@@ -0,0 +1,141 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_collision.h
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Capsule models of arms sharing a work cell, and checks of whether their
+//  configurations or motions intersect.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_collision_H
+#define crpi_collision_H
+
+#include "crpi_kinematics.h"
+#include <vector>
+
+//! @brief Default clearance (mm) required between arms, and largest joint step (deg) between the
+//!        configurations sampled along a motion
+//!
+#define COLLISION_MARGIN 20.0
+#define COLLISION_STEP 5.0
+
+namespace crpi_robot
+{
+  //! @brief Capsules of one arm over a motion (crpi_collision.cpp)
+  //!
+  struct collisionSweep;
+
+  //! @brief An arm of the model:  its kinematics, where its base is in the cell, and the radius of
+  //!        the capsules around its links
+  //!
+  struct collisionArm
+  {
+    const CrpiKinematics *kin;
+    double base[12];
+    double radius;
+  };
+
+  //! @ingroup Robot
+  //!
+  //! @brief Collision model of the arms in a cell.  Each arm is the chain of capsules around the
+  //!        centerline of its kinematic model (CrpiKinematics::Points).  A motion sweeps each
+  //!        capsule through the configurations sampled along it, and the swept volumes are
+  //!        bounded by a hierarchy of boxes:  the whole arm, each link over the whole motion,
+  //!        and each link at each sample.  Two motions are compared top-down, so arms that stay
+  //!        apart are cleared by a handful of box tests, and only the capsule pairs whose boxes
+  //!        overlap are measured.
+  //!
+  //! @note Motions are compared as swept volumes, without regard to timing, so a pair that
+  //!       passes can run concurrently however either is timed.  Between samples, each capsule is
+  //!       grown by half of how far its ends move, which covers a link's straight-line travel.
+  //! @note Arms are checked against each other, not against themselves or fixtures.
+  //!
+  class LIBRARY_API CrpiCollision
+  {
+  public:
+    //! @brief Default constructor
+    //!
+    CrpiCollision ();
+
+    //! @brief Default destructor
+    //!
+    ~CrpiCollision ();
+
+    //! @brief Add an arm to the model
+    //!
+    //! @param kin    The arm's kinematics (with its tool set), which must outlive the model
+    //! @param base   The arm's base frame in the cell frame (mm, deg)
+    //! @param radius Radius of the capsules around its links (mm), or 0 for the model's default
+    //!
+    //! @return The arm's index
+    //!
+    int AddArm (const CrpiKinematics *kin, const robotPose &base, double radius = 0.0);
+
+    //! @brief Number of arms
+    //!
+    int Arms () const;
+
+    //! @brief Kinematics of an arm
+    //!
+    //! @return The kinematics given to AddArm, or NULL if the index is not valid
+    //!
+    const CrpiKinematics *Kinematics (int arm) const;
+
+    //! @brief Set the clearance (mm) required between arms
+    //!
+    void SetMargin (double margin);
+
+    //! @brief Set the largest joint step (deg) between sampled configurations
+    //!
+    void SetStep (double step);
+
+    //! @brief Whether two arms intersect at the given configurations
+    //!
+    bool Collides (int armA, const robotAxes &axesA, int armB, const robotAxes &axesB) const;
+
+    //! @brief Whether two arms' motions can intersect.  Each motion is a joint-space path through
+    //!        count configurations (1 for an arm that stays put).
+    //!
+    //! @return True if the swept volumes intersect or an arm index or path is not valid
+    //!
+    bool SweptCollides (int armA, const robotAxes *pathA, int countA,
+                        int armB, const robotAxes *pathB, int countB) const;
+
+    //! @brief Least distance from any of a set of points (e.g., the markers on a person) to the
+    //!        volume an arm sweeps over a motion.  The same box hierarchy prunes the search:  a
+    //!        box no nearer than the best distance found so far is not descended into.
+    //!
+    //! @param arm       The arm
+    //! @param path      The arm's joint-space path (1 configuration for an arm that stays put)
+    //! @param count     Number of configurations
+    //! @param points    Positions (mm, cell frame) as x, y, z triples
+    //! @param numPoints Number of positions
+    //!
+    //! @return The distance (mm) to the surface of the nearest capsule, without the margin; 0 if a
+    //!         point is inside one, or the arm or path is not valid, and DBL_MAX if there are no
+    //!         points
+    //!
+    double Separation (int arm, const robotAxes *path, int count, const double *points, int numPoints) const;
+
+  private:
+    //! @brief Capsules of an arm over a path
+    //!
+    bool sweep (int arm, const robotAxes *path, int count, collisionSweep &out) const;
+
+    //! @brief Whether two swept volumes intersect
+    //!
+    bool intersects (const collisionSweep &a, const collisionSweep &b) const;
+
+    std::vector<collisionArm> arms_;
+    double margin_;
+    double step_;
+  }; // CrpiCollision
+} // namespace crpi_robot
+
+#endif
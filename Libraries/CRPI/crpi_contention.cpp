@@ -0,0 +1,261 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_contention.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Lock contention profile definitions.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_contention.h"
+#include "crpi_hub.h"
+#include "crpi_log.h"
+#include "crpi_metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+#if defined(__GNUC__) && !defined(WIN32)
+#include <cxxabi.h>
+#include <dlfcn.h>
+#endif
+
+using namespace std;
+
+namespace crpi_robot
+{
+  //! @brief The profile's periodic task and report schedule.  Allocated once and never freed,
+  //!        like the hub it runs on.
+  //!
+  struct contentionState
+  {
+    ulapi_mutex_struct *mutex;
+    int task;
+    double reportPeriod;
+    double nextReport;
+    vector<ulapi_lock_stats> stats;
+
+    contentionState () :
+      mutex(ulapi_mutex_new(0)),
+      task(-1),
+      reportPeriod(0.0),
+      nextReport(0.0),
+      stats(ULAPI_LOCK_PROFILE_MAX)
+    {
+    }
+  };
+
+  static contentionState &contention ()
+  {
+    static contentionState *state = new contentionState();
+    return *state;
+  }
+
+
+  //! @brief Copy the statistics of every lock taken so far (caller holds the state's mutex)
+  //!
+  static int contentionGather (contentionState &cs)
+  {
+    return (int)ulapi_lock_stats_get(&cs.stats[0], (ulapi_integer)cs.stats.size());
+  }
+
+
+  //! @brief A lock's name, or what is known of it if it was not given one
+  //!
+  static string contentionName (const ulapi_lock_stats &s)
+  {
+    static const char *kinds[] = {"mutex", "fast lock", "rwlock"};
+    char text[64];
+
+    if (s.name[0] != '\0')
+    {
+      return s.name;
+    }
+    if (s.key != 0)
+    {
+      snprintf(text, sizeof(text), "mutex %d", (int)s.key);
+    }
+    else
+    {
+      snprintf(text, sizeof(text), "%s %p", kinds[(s.kind >= 0 && s.kind <= 2) ? s.kind : 0], s.lock);
+    }
+    return text;
+  }
+
+
+  //! @brief Metrics update and report, on the SensorHub timer thread
+  //!
+  static void contentionTick (void *param)
+  {
+    contentionState &cs = contention();
+    double now = ulapi_time();
+    bool report;
+
+    CrpiContention::Refresh();
+
+    ulapi_mutex_take(cs.mutex);
+    report = (cs.reportPeriod > 0.0 && now >= cs.nextReport);
+    if (report)
+    {
+      cs.nextReport = now + cs.reportPeriod;
+    }
+    ulapi_mutex_give(cs.mutex);
+
+    if (report)
+    {
+      CrpiContention::Report();
+    }
+  }
+
+
+  LIBRARY_API void CrpiContention::Start (double reportPeriod)
+  {
+    contentionState &cs = contention();
+
+    ulapi_lock_profile(1);
+    ulapi_mutex_take(cs.mutex);
+    cs.reportPeriod = reportPeriod;
+    cs.nextReport = ulapi_time() + reportPeriod;
+    if (cs.task < 0)
+    {
+      cs.task = SensorHub::Instance().AddPeriodic(contentionTick, NULL, CRPI_CONTENTION_REFRESH, HUB_BACKGROUND);
+    }
+    ulapi_mutex_give(cs.mutex);
+  }
+
+
+  LIBRARY_API void CrpiContention::Stop ()
+  {
+    contentionState &cs = contention();
+    int task;
+
+    ulapi_lock_profile(0);
+    ulapi_mutex_take(cs.mutex);
+    task = cs.task;
+    cs.task = -1;
+    ulapi_mutex_give(cs.mutex);
+    SensorHub::Instance().RemovePeriodic(task);
+  }
+
+
+  LIBRARY_API bool CrpiContention::Running ()
+  {
+    return (ulapi_lock_profiling() != 0);
+  }
+
+
+  LIBRARY_API void CrpiContention::Report (int top)
+  {
+    contentionState &cs = contention();
+    vector<ulapi_lock_stats> sorted;
+    int count, i;
+
+    ulapi_mutex_take(cs.mutex);
+    count = contentionGather(cs);
+    sorted.assign(cs.stats.begin(), cs.stats.begin() + count);
+    ulapi_mutex_give(cs.mutex);
+
+    sort(sorted.begin(), sorted.end(), [](const ulapi_lock_stats &a, const ulapi_lock_stats &b) {
+      return a.wait_total > b.wait_total;
+    });
+
+    CRPI_LOG(CRPI_LOG_INFO, "CrpiContention:  %d locks taken", count);
+    for (i = 0; i < count && i < top; ++i)
+    {
+      const ulapi_lock_stats &s = sorted[i];
+      CRPI_LOG(CRPI_LOG_INFO,
+               "CrpiContention:  %-24s %llu takes, %llu contended (%.1f%%), wait %.6f s (max %.6f s in %s), "
+               "held %.6f s (max %.6f s by %s)",
+               contentionName(s).c_str(), s.takes, s.contended,
+               (s.takes > 0) ? (100.0 * (double)s.contended / (double)s.takes) : 0.0,
+               (double)s.wait_total, (double)s.wait_max, Site(s.wait_max_site).c_str(),
+               (double)s.hold_total, (double)s.hold_max, Site(s.hold_max_site).c_str());
+    }
+  }
+
+
+  LIBRARY_API void CrpiContention::Refresh ()
+  {
+    contentionState &cs = contention();
+    string labels;
+    int count, i;
+
+    ulapi_mutex_take(cs.mutex);
+    count = contentionGather(cs);
+    for (i = 0; i < count; ++i)
+    {
+      const ulapi_lock_stats &s = cs.stats[i];
+      if (s.name[0] == '\0')
+      {
+        continue;
+      }
+      labels = CrpiMetrics::Label("lock", s.name);
+      CrpiMetrics::Gauge("crpi_lock_takes", "Lock takes while profiling", labels)->Set((double)s.takes);
+      CrpiMetrics::Gauge("crpi_lock_contended", "Lock takes that found the lock held",
+                         labels)->Set((double)s.contended);
+      CrpiMetrics::Gauge("crpi_lock_wait_seconds", "Total time spent waiting for the lock",
+                         labels)->Set((double)s.wait_total);
+      CrpiMetrics::Gauge("crpi_lock_wait_max_seconds", "Longest wait for the lock",
+                         labels)->Set((double)s.wait_max);
+      CrpiMetrics::Gauge("crpi_lock_hold_seconds", "Total time the lock was held exclusively",
+                         labels)->Set((double)s.hold_total);
+      CrpiMetrics::Gauge("crpi_lock_hold_max_seconds", "Longest exclusive hold of the lock",
+                         labels)->Set((double)s.hold_max);
+    }
+    ulapi_mutex_give(cs.mutex);
+  }
+
+
+  LIBRARY_API void CrpiContention::Reset ()
+  {
+    ulapi_lock_stats_reset();
+  }
+
+
+  LIBRARY_API string CrpiContention::Site (const void *address)
+  {
+    char text[256];
+
+    if (address == NULL)
+    {
+      return "-";
+    }
+#if defined(__GNUC__) && !defined(WIN32)
+    Dl_info info;
+    if (dladdr(address, &info) != 0 && info.dli_sname != NULL)
+    {
+      int status = 0;
+      char *name = abi::__cxa_demangle(info.dli_sname, NULL, NULL, &status);
+      snprintf(text, sizeof(text), "%s+0x%lx", (status == 0 && name != NULL) ? name : info.dli_sname,
+               (unsigned long)((const char*)address - (const char*)info.dli_saddr));
+      free(name);
+      return text;
+    }
+#endif
+    snprintf(text, sizeof(text), "%p", address);
+    return text;
+  }
+
+
+  //! @brief Reads CRPI_LOCK_PROFILE when the library is loaded
+  //!
+  struct contentionEnvironment
+  {
+    contentionEnvironment ()
+    {
+      const char *setting = getenv("CRPI_LOCK_PROFILE");
+      if (setting != NULL && setting[0] != '\0')
+      {
+        CrpiContention::Start(atof(setting));
+      }
+    }
+  };
+
+  static contentionEnvironment contentionStartup;
+} // namespace crpi_robot
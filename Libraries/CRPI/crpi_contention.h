@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_contention.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Lock contention profile of the drivers and sensors.
+//
+//  ulapi can time every take of its mutexes, fast locks, and reader-writer
+//  locks (ulapi_lock_profile):  how often a lock was found held, how long
+//  its takers waited, how long it was held, and the code that waited or
+//  held it longest.  CrpiContention turns that on and publishes it, as
+//  crpi_lock_* gauges labelled by lock name through CrpiMetrics, and as a
+//  periodic report in the log listing the most contended locks with their
+//  call sites resolved to function names where the platform allows.  The
+//  drivers name their locks (ulapi_lock_name) when they create them; only
+//  named locks are exported as metrics, but every lock is reported.
+//
+//  CRPI_LOCK_PROFILE in the environment starts the profile when the library
+//  is loaded; its value is the period (s) of the log report, 0 for none.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_contention_H
+#define crpi_contention_H
+
+#include "crpi.h"
+#include <string>
+
+//! @brief Time (s) between updates of the crpi_lock_* metrics
+//!
+#define CRPI_CONTENTION_REFRESH 1.0
+
+namespace crpi_robot
+{
+  //! @ingroup Robot
+  //!
+  //! @brief Process-wide lock contention profile
+  //!
+  class LIBRARY_API CrpiContention
+  {
+  public:
+    //! @brief Turn lock profiling on and start publishing it from the SensorHub timer thread
+    //!
+    //! @param reportPeriod Seconds between reports in the log, 0 for none
+    //!
+    static void Start (double reportPeriod = 0.0);
+
+    //! @brief Turn lock profiling off.  The statistics gathered so far are kept.
+    //!
+    static void Stop ();
+
+    //! @brief Whether lock profiling is on
+    //!
+    static bool Running ();
+
+    //! @brief Log the locks with the most waiting, most first
+    //!
+    //! @param top Number of locks to list
+    //!
+    static void Report (int top = 10);
+
+    //! @brief Update the crpi_lock_* metrics now
+    //!
+    static void Refresh ();
+
+    //! @brief Clear the statistics of every lock
+    //!
+    static void Reset ();
+
+    //! @brief A code address as "function+offset" (or the address, if it cannot be resolved)
+    //!
+    static std::string Site (const void *address);
+  }; // CrpiContention
+} // namespace crpi_robot
+
+#endif
@@ -35,7 +35,7 @@ namespace crpi_robot
     delete [] arm_;
   }
 
-  LIBRARY_API CanonReturn CrpiDemoHack::ApplyCartesianForceTorque (robotPose robotForceTorque, vector<bool> activeAxes, vector<bool> manipulator)
+  LIBRARY_API CanonReturn CrpiDemoHack::ApplyCartesianForceTorque (robotPose robotForceTorque, const vector<bool> &activeAxes, const vector<bool> &manipulator)
   {
 
 	return CANON_SUCCESS;
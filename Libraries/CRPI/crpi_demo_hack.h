@@ -56,7 +56,7 @@ namespace crpi_robot
     //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
     //!         not accepted, and FAILURE if the command is accepted but not executed successfully
     //!
-	CanonReturn ApplyCartesianForceTorque (robotPose robotForceTorque, vector<bool> activeAxes, vector<bool> manipulator);
+	CanonReturn ApplyCartesianForceTorque (robotPose robotForceTorque, const vector<bool> &activeAxes, const vector<bool> &manipulator);
 
 	//! @brief Apply joint torques
 	//!
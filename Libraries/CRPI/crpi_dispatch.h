@@ -0,0 +1,204 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_dispatch.h
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Command registry used by CrpiRobot<T>::CrpiDispatch.
+//
+//  Each CanonCommand has one entry, built at compile time and indexed by the
+//  command's value:  the name the command is traced under, and a thunk that
+//  reads the command's arguments from the parser's CrpiXmlParams (by
+//  reference, in the types the CrpiRobot method takes) and calls the method.
+//  A command is added by writing its entry in enum order;  a missing or
+//  misplaced entry fails to compile.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_dispatch_H
+#define crpi_dispatch_H
+
+#include "crpi_robot.h"
+
+namespace crpi_robot
+{
+  template <class T> class CrpiRobot;
+
+  //! @brief One registered command
+  //!
+  template <class T> struct CrpiCommandEntry
+  {
+    //! @brief The command, and the name its dispatch is traced under
+    //!
+    CanonCommand cmd;
+    const char *name;
+
+    //! @brief Decode the command's arguments from params and run it on robot
+    //!
+    CanonReturn (*run) (CrpiRobot<T> &robot, CrpiXmlParams &params);
+  }; // CrpiCommandEntry
+
+
+  //! @brief Compile-time table of the commands CrpiDispatch accepts
+  //!
+  template <class T> struct CrpiCommandRegistry
+  {
+    typedef CrpiRobot<T> robot_type;
+
+    //! @brief Look up the entry of a command
+    //!
+    //! @param cmd The command to look up (commands decoded from a binary frame are not range
+    //!            checked by the decoder)
+    //!
+    //! @return The command's entry, or NULL if cmd is out of range
+    //!
+    static const CrpiCommandEntry<T> *Find (CanonCommand cmd)
+    {
+      static_assert(sizeof(commands) / sizeof(commands[0]) == CmdUpdateWorldTransform + 1,
+                    "CrpiCommandRegistry needs one entry per CanonCommand");
+      static_assert(ordered(0), "CrpiCommandRegistry entries must be in CanonCommand order");
+      return ((int)cmd >= 0 && (int)cmd <= CmdUpdateWorldTransform) ? &commands[cmd] : NULL;
+    }
+
+    //! @brief Argument decoders
+    //!
+    //! Commands that are accepted without action (not yet supported by CrpiRobot)
+    static CanonReturn accept (robot_type &robot, CrpiXmlParams &params)
+    {
+      return CANON_SUCCESS;
+    }
+
+    //! Commands that are not CRPI commands
+    static CanonReturn reject (robot_type &robot, CrpiXmlParams &params)
+    {
+      return CANON_REJECT;
+    }
+
+    //! <String Value="..."/>
+    template <CanonReturn (robot_type::*M) (const char *)>
+    static CanonReturn text (robot_type &robot, CrpiXmlParams &params)
+    {
+      return (robot.*M)(params.str.c_str());
+    }
+
+    //! <Real Value="..."/>
+    template <CanonReturn (robot_type::*M) (double)>
+    static CanonReturn real (robot_type &robot, CrpiXmlParams &params)
+    {
+      return (robot.*M)(params.real);
+    }
+
+    //! Absolute settings, carried in numPositions
+    template <CanonReturn (robot_type::*M) (double)>
+    static CanonReturn absolute (robot_type &robot, CrpiXmlParams &params)
+    {
+      return (robot.*M)(params.numPositions);
+    }
+
+    //! <Pose .../>
+    template <CanonReturn (robot_type::*M) (robotPose &)>
+    static CanonReturn pose (robot_type &robot, CrpiXmlParams &params)
+    {
+      return (robot.*M)(*params.pose);
+    }
+
+    //! <Pose .../> for a blocking motion
+    template <CanonReturn (robot_type::*M) (robotPose &, bool)>
+    static CanonReturn poseMotion (robot_type &robot, CrpiXmlParams &params)
+    {
+      return (robot.*M)(*params.pose, true);
+    }
+
+    //! <Axes .../> for a blocking motion
+    template <CanonReturn (robot_type::*M) (robotAxes &, bool)>
+    static CanonReturn axesMotion (robot_type &robot, CrpiXmlParams &params)
+    {
+      return (robot.*M)(*params.axes, true);
+    }
+
+    //! Feedback, written to the params member that CrpiXmlResponse encodes
+    template <class V, V *CrpiXmlParams::*F, CanonReturn (robot_type::*M) (V *)>
+    static CanonReturn feedback (robot_type &robot, CrpiXmlParams &params)
+    {
+      return (robot.*M)(params.*F);
+    }
+
+    //! <Int Value="..."/> <Boolean Value="..."/>
+    template <CanonReturn (robot_type::*M) (int, bool)>
+    static CanonReturn digital (robot_type &robot, CrpiXmlParams &params)
+    {
+      return (robot.*M)(params.integer, params.boolean);
+    }
+
+    //! @brief Whether entry i onward of commands is in command order
+    //!
+    static constexpr bool ordered (int i)
+    {
+      return (i > CmdUpdateWorldTransform) || ((int)commands[i].cmd == i && ordered(i + 1));
+    }
+
+    static constexpr CrpiCommandEntry<T> commands[] =
+    {
+      { CmdApplyCartesianForceTorque,    "ApplyCartesianForceTorque",    &accept },
+      { CmdApplyJointTorque,             "ApplyJointTorque",             &accept },
+      { CmdCouple,                       "Couple",                       &text<&robot_type::Couple> },
+      { CmdDecouple,                     "Decouple",                     &reject },
+      { CmdDwell,                        "Dwell",                        &reject },
+      { CmdEndCanon,                     "EndCanon",                     &reject },
+      { CmdToWorldMatrix,                "ToWorldMatrix",                &accept },
+      { CmdToSystemMatrix,               "ToSystemMatrix",               &accept },
+      { CmdFromSystem,                   "FromSystem",                   &accept },
+      { CmdFromWorld,                    "FromWorld",                    &accept },
+      { CmdGetRobotAxes,                 "GetRobotAxes",
+        &feedback<robotAxes, &CrpiXmlParams::axes, &robot_type::GetRobotAxes> },
+      { CmdGetRobotForces,               "GetRobotForces",
+        &feedback<robotPose, &CrpiXmlParams::forces, &robot_type::GetRobotForces> },
+      { CmdGetRobotIO,                   "GetRobotIO",
+        &feedback<robotIO, &CrpiXmlParams::io, &robot_type::GetRobotIO> },
+      { CmdGetRobotPose,                 "GetRobotPose",
+        &feedback<robotPose, &CrpiXmlParams::pose, &robot_type::GetRobotPose> },
+      { CmdGetRobotSpeed,                "GetRobotSpeed",                &accept },
+      { CmdGetRobotTorques,              "GetRobotTorques",
+        &feedback<robotAxes, &CrpiXmlParams::torques, &robot_type::GetRobotTorques> },
+      { CmdInitCanon,                    "InitCanon",                    &reject },
+      { CmdMessage,                      "Message",                      &text<&robot_type::Message> },
+      { CmdMoveAttractor,                "MoveAttractor",                &pose<&robot_type::MoveAttractor> },
+      { CmdMoveBase,                     "MoveBase",                     &reject },
+      { CmdMoveStraightTo,               "MoveStraightTo",               &poseMotion<&robot_type::MoveStraightTo> },
+      { CmdMoveThroughTo,                "MoveThroughTo",                &accept },
+      { CmdMoveTo,                       "MoveTo",                       &poseMotion<&robot_type::MoveTo> },
+      { CmdMoveToAxisTarget,             "MoveToAxisTarget",             &axesMotion<&robot_type::MoveToAxisTarget> },
+      { CmdPointAppendage,               "PointAppendage",               &reject },
+      { CmdPointHead,                    "PointHead",                    &reject },
+      { CmdRunProgram,                   "RunProgram",                   &reject },
+      { CmdSaveConfig,                   "SaveConfig",                   &text<&robot_type::SaveConfig> },
+      { CmdSetAbsoluteAcceleration,      "SetAbsoluteAcceleration",      &absolute<&robot_type::SetAbsoluteAcceleration> },
+      { CmdSetAbsoluteSpeed,             "SetAbsoluteSpeed",             &absolute<&robot_type::SetAbsoluteSpeed> },
+      { CmdSetAngleUnits,                "SetAngleUnits",                &text<&robot_type::SetAngleUnits> },
+      { CmdSetAxialSpeeds,               "SetAxialSpeeds",               &accept },
+      { CmdSetAxialUnits,                "SetAxialUnits",                &accept },
+      { CmdSetEndPoseTolerance,          "SetEndPoseTolerance",          &accept },
+      { CmdSetIntermediatePoseTolerance, "SetIntermediatePoseTolerance", &accept },
+      { CmdSetLengthUnits,               "SetLengthUnits",               &text<&robot_type::SetLengthUnits> },
+      { CmdSetParameter,                 "SetParameter",                 &accept },
+      { CmdSetRelativeAcceleration,      "SetRelativeAcceleration",      &real<&robot_type::SetRelativeAcceleration> },
+      { CmdSetRelativeSpeed,             "SetRelativeSpeed",             &real<&robot_type::SetRelativeSpeed> },
+      { CmdSetRobotDO,                   "SetRobotDO",                   &digital<&robot_type::SetRobotDO> },
+      { CmdSetRobotIO,                   "SetRobotIO",                   &accept },
+      { CmdSetTool,                      "SetTool",                      &real<&robot_type::SetTool> },
+      { CmdStopMotion,                   "StopMotion",                   &accept },
+      { CmdToSystem,                     "ToSystem",                     &accept },
+      { CmdToWorld,                      "ToWorld",                      &accept },
+      { CmdUpdateSystemTransform,        "UpdateSystemTransform",        &accept },
+      { CmdUpdateWorldTransform,         "UpdateWorldTransform",         &accept }
+    };
+  }; // CrpiCommandRegistry
+
+  template <class T> constexpr CrpiCommandEntry<T> CrpiCommandRegistry<T>::commands[];
+} // namespace crpi_robot
+
+#endif
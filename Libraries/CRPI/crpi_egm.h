@@ -0,0 +1,457 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_egm.h
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Encoding and decoding of the ABB Externally Guided Motion (EGM) UDP
+//  messages.  Only the EgmRobot and EgmSensor fields used by CRPI are
+//  handled, written directly in the protobuf wire format of egm.proto so
+//  that no protobuf runtime is needed.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef CRPI_EGM_H
+#define CRPI_EGM_H
+
+#include <string.h>
+
+//! @brief Largest EGM datagram handled by CRPI
+//!
+#define EGM_MAX_MESSAGE 1400
+
+//! @brief Most robot joints and external joints carried in one message
+//!
+#define EGM_MAX_JOINTS 12
+
+//! @brief EgmHeader message type of a sensor correction
+//!
+#define EGM_MSGTYPE_CORRECTION 3
+
+//! @brief The EgmRobot fields used by CRPI
+//!
+struct egmRobotFeedback
+{
+  //! @brief Message sequence number and controller time (ms)
+  //!
+  unsigned long seqno;
+  unsigned long tm;
+
+  //! @brief Measured joint positions (deg):  robot joints, then external joints
+  //!
+  double joints[EGM_MAX_JOINTS];
+  int numJoints;
+  double external[EGM_MAX_JOINTS];
+  int numExternal;
+
+  //! @brief Measured TCP position (mm) and orientation quaternion (u0 = scalar part)
+  //!
+  double pos[3];
+  double orient[4];
+  bool hasPose;
+
+  //! @brief EgmMotorState (1 on, 2 off, 0 unknown)
+  //!
+  int motorState;
+};
+
+
+//! @brief Read a protobuf varint
+//!
+inline bool egm_read_varint (const unsigned char *&p, const unsigned char *end, unsigned long long &value)
+{
+  int shift = 0;
+
+  value = 0;
+  while (p < end && shift < 64)
+  {
+    value |= ((unsigned long long)(*p & 0x7F)) << shift;
+    if ((*p++ & 0x80) == 0)
+    {
+      return true;
+    }
+    shift += 7;
+  }
+  return false;
+}
+
+
+//! @brief Read a little-endian protobuf double (wire type 1)
+//!
+inline bool egm_read_double (const unsigned char *&p, const unsigned char *end, double &value)
+{
+  unsigned long long bits = 0;
+
+  if ((end - p) < 8)
+  {
+    return false;
+  }
+  for (int i = 7; i >= 0; --i)
+  {
+    bits = (bits << 8) | p[i];
+  }
+  memcpy(&value, &bits, sizeof(value));
+  p += 8;
+  return true;
+}
+
+
+//! @brief Skip a field of the given wire type
+//!
+inline bool egm_skip (const unsigned char *&p, const unsigned char *end, int wireType)
+{
+  unsigned long long value;
+
+  switch (wireType)
+  {
+  case 0:
+    return egm_read_varint(p, end, value);
+  case 1:
+    if ((end - p) < 8) return false;
+    p += 8;
+    return true;
+  case 2:
+    if (!egm_read_varint(p, end, value) || value > (unsigned long long)(end - p)) return false;
+    p += value;
+    return true;
+  case 5:
+    if ((end - p) < 4) return false;
+    p += 4;
+    return true;
+  default:
+    return false;
+  }
+}
+
+
+//! @brief Read the length of a nested message and return the end of its bytes
+//!
+inline bool egm_sub (const unsigned char *&p, const unsigned char *end, const unsigned char *&subEnd)
+{
+  unsigned long long length;
+
+  if (!egm_read_varint(p, end, length) || length > (unsigned long long)(end - p))
+  {
+    return false;
+  }
+  subEnd = p + length;
+  return true;
+}
+
+
+//! @brief Decode an EgmJoints message (repeated double joints = 1, packed or not)
+//!
+inline bool egm_decode_joints (const unsigned char *p, const unsigned char *end, double *out, int &num)
+{
+  unsigned long long key;
+  const unsigned char *packedEnd;
+
+  num = 0;
+  while (p < end)
+  {
+    if (!egm_read_varint(p, end, key))
+    {
+      return false;
+    }
+    if (key == ((1 << 3) | 1))
+    {
+      if (num >= EGM_MAX_JOINTS || !egm_read_double(p, end, out[num++]))
+      {
+        return false;
+      }
+    }
+    else if (key == ((1 << 3) | 2))
+    {
+      if (!egm_sub(p, end, packedEnd))
+      {
+        return false;
+      }
+      while (p < packedEnd)
+      {
+        if (num >= EGM_MAX_JOINTS || !egm_read_double(p, packedEnd, out[num++]))
+        {
+          return false;
+        }
+      }
+    }
+    else if (!egm_skip(p, end, (int)(key & 7)))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+//! @brief Decode an EgmPose message (pos = 1, orient = 2) into position and quaternion
+//!
+inline bool egm_decode_pose (const unsigned char *p, const unsigned char *end, double *pos, double *orient)
+{
+  unsigned long long key, field;
+  const unsigned char *subEnd;
+  double *target;
+  int count;
+
+  while (p < end)
+  {
+    if (!egm_read_varint(p, end, key))
+    {
+      return false;
+    }
+    if ((key == ((1 << 3) | 2)) || (key == ((2 << 3) | 2)))
+    {
+      //! EgmCartesian (x, y, z) or EgmQuaternion (u0..u3), all doubles numbered from 1
+      target = ((key >> 3) == 1) ? pos : orient;
+      count = ((key >> 3) == 1) ? 3 : 4;
+      if (!egm_sub(p, end, subEnd))
+      {
+        return false;
+      }
+      while (p < subEnd)
+      {
+        if (!egm_read_varint(p, subEnd, field))
+        {
+          return false;
+        }
+        if ((field & 7) == 1 && (field >> 3) >= 1 && (int)(field >> 3) <= count)
+        {
+          if (!egm_read_double(p, subEnd, target[(field >> 3) - 1]))
+          {
+            return false;
+          }
+        }
+        else if (!egm_skip(p, subEnd, (int)(field & 7)))
+        {
+          return false;
+        }
+      }
+    }
+    else if (!egm_skip(p, end, (int)(key & 7)))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+//! @brief Decode an EgmRobot datagram
+//!
+//! @param buf The received datagram
+//! @param len Number of bytes in buf
+//! @param fb  Populated with the header, feedBack, and motorState fields
+//!
+//! @return True if the datagram was well formed, false otherwise
+//!
+inline bool egm_decode_robot (const char *buf, int len, egmRobotFeedback &fb)
+{
+  const unsigned char *p = (const unsigned char*)buf, *end = p + len, *subEnd, *q;
+  unsigned long long key, field, value;
+
+  memset(&fb, 0, sizeof(fb));
+  while (p < end)
+  {
+    if (!egm_read_varint(p, end, key))
+    {
+      return false;
+    }
+    if ((key & 7) != 2 || ((key >> 3) != 1 && (key >> 3) != 2 && (key >> 3) != 4))
+    {
+      if (!egm_skip(p, end, (int)(key & 7)))
+      {
+        return false;
+      }
+      continue;
+    }
+    if (!egm_sub(p, end, subEnd))
+    {
+      return false;
+    }
+
+    while (p < subEnd)
+    {
+      if (!egm_read_varint(p, subEnd, field))
+      {
+        return false;
+      }
+      if ((key >> 3) == 1 && (field & 7) == 0 && ((field >> 3) == 1 || (field >> 3) == 2))
+      {
+        //! EgmHeader:  seqno = 1, tm = 2
+        if (!egm_read_varint(p, subEnd, value))
+        {
+          return false;
+        }
+        ((field >> 3) == 1 ? fb.seqno : fb.tm) = (unsigned long)value;
+      }
+      else if ((key >> 3) == 2 && (field & 7) == 2 && (field >> 3) >= 1 && (field >> 3) <= 3)
+      {
+        //! EgmFeedBack:  joints = 1, cartesian = 2, externalJoints = 3
+        if (!egm_sub(p, subEnd, q))
+        {
+          return false;
+        }
+        if ((field >> 3) == 1)
+        {
+          if (!egm_decode_joints(p, q, fb.joints, fb.numJoints)) return false;
+        }
+        else if ((field >> 3) == 2)
+        {
+          if (!egm_decode_pose(p, q, fb.pos, fb.orient)) return false;
+          fb.hasPose = true;
+        }
+        else if (!egm_decode_joints(p, q, fb.external, fb.numExternal))
+        {
+          return false;
+        }
+        p = q;
+      }
+      else if ((key >> 3) == 4 && field == ((1 << 3) | 0))
+      {
+        //! EgmMotorState:  state = 1
+        if (!egm_read_varint(p, subEnd, value))
+        {
+          return false;
+        }
+        fb.motorState = (int)value;
+      }
+      else if (!egm_skip(p, subEnd, (int)(field & 7)))
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+
+//! @brief Append a varint
+//!
+inline void egm_write_varint (char *buf, int size, int &pos, unsigned long long value)
+{
+  do
+  {
+    if (pos < size)
+    {
+      buf[pos] = (char)((value & 0x7F) | ((value > 0x7F) ? 0x80 : 0));
+    }
+    ++pos;
+    value >>= 7;
+  } while (value != 0);
+}
+
+
+//! @brief Append a double field
+//!
+inline void egm_write_double (char *buf, int size, int &pos, int field, double value)
+{
+  unsigned long long bits;
+
+  egm_write_varint(buf, size, pos, (field << 3) | 1);
+  memcpy(&bits, &value, sizeof(bits));
+  for (int i = 0; i < 8; ++i, ++pos, bits >>= 8)
+  {
+    if (pos < size)
+    {
+      buf[pos] = (char)(bits & 0xFF);
+    }
+  }
+}
+
+
+//! @brief Append a nested message, given its already encoded bytes
+//!
+inline void egm_write_sub (char *buf, int size, int &pos, int field, const char *sub, int length)
+{
+  egm_write_varint(buf, size, pos, (field << 3) | 2);
+  egm_write_varint(buf, size, pos, length);
+  if (pos + length <= size)
+  {
+    memcpy(buf + pos, sub, length);
+  }
+  pos += length;
+}
+
+
+//! @brief Append an EgmJoints message
+//!
+inline void egm_write_joints (char *buf, int size, int &pos, int field, const double *joints, int num)
+{
+  char sub[16 * EGM_MAX_JOINTS];
+  int length = 0;
+
+  for (int i = 0; i < num && i < EGM_MAX_JOINTS; ++i)
+  {
+    egm_write_double(sub, sizeof(sub), length, 1, joints[i]);
+  }
+  egm_write_sub(buf, size, pos, field, sub, length);
+}
+
+
+//! @brief Encode an EgmSensor correction datagram
+//!
+//! @param buf         Destination of the datagram
+//! @param size        Size of buf
+//! @param seqno       Sensor sequence number
+//! @param tm          Sensor time (ms)
+//! @param pos         Planned TCP position (mm), or NULL to send joints
+//! @param orient      Planned orientation quaternion (u0 = scalar part), used with pos
+//! @param joints      Planned robot joints (deg), used when pos is NULL
+//! @param numJoints   Number of robot joints
+//! @param external    Planned external joints (deg), used when pos is NULL
+//! @param numExternal Number of external joints
+//!
+//! @return The length of the datagram, or -1 if it does not fit in buf
+//!
+inline int egm_encode_sensor (char *buf, int size, unsigned long seqno, unsigned long tm,
+                              const double *pos, const double *orient,
+                              const double *joints, int numJoints,
+                              const double *external, int numExternal)
+{
+  char header[32], planned[512], pose[128], part[64];
+  int length = 0, headerLength = 0, plannedLength = 0, poseLength = 0, partLength, i;
+
+  //! EgmHeader:  seqno = 1, tm = 2, mtype = 3
+  egm_write_varint(header, sizeof(header), headerLength, (1 << 3) | 0);
+  egm_write_varint(header, sizeof(header), headerLength, seqno);
+  egm_write_varint(header, sizeof(header), headerLength, (2 << 3) | 0);
+  egm_write_varint(header, sizeof(header), headerLength, tm);
+  egm_write_varint(header, sizeof(header), headerLength, (3 << 3) | 0);
+  egm_write_varint(header, sizeof(header), headerLength, EGM_MSGTYPE_CORRECTION);
+
+  //! EgmPlanned:  joints = 1, cartesian = 2, externalJoints = 3
+  if (pos != NULL)
+  {
+    partLength = 0;
+    for (i = 0; i < 3; ++i)
+    {
+      egm_write_double(part, sizeof(part), partLength, i + 1, pos[i]);
+    }
+    egm_write_sub(pose, sizeof(pose), poseLength, 1, part, partLength);
+    partLength = 0;
+    for (i = 0; i < 4; ++i)
+    {
+      egm_write_double(part, sizeof(part), partLength, i + 1, orient[i]);
+    }
+    egm_write_sub(pose, sizeof(pose), poseLength, 2, part, partLength);
+    egm_write_sub(planned, sizeof(planned), plannedLength, 2, pose, poseLength);
+  }
+  else
+  {
+    egm_write_joints(planned, sizeof(planned), plannedLength, 1, joints, numJoints);
+    if (numExternal > 0)
+    {
+      egm_write_joints(planned, sizeof(planned), plannedLength, 3, external, numExternal);
+    }
+  }
+
+  //! EgmSensor:  header = 1, planned = 2
+  egm_write_sub(buf, size, length, 1, header, headerLength);
+  egm_write_sub(buf, size, length, 2, planned, plannedLength);
+  return ((length <= size) ? length : -1);
+}
+
+#endif
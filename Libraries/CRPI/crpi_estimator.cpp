@@ -0,0 +1,230 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_estimator.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Speed and acceleration estimator definitions.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_estimator.h"
+
+#include <math.h>
+
+namespace crpi_robot
+{
+  LIBRARY_API CrpiRateEstimator::CrpiRateEstimator (int channels, int window, double span) :
+    channels_((channels < 1) ? 1 : ((channels > CRPI_AXES_MAX) ? CRPI_AXES_MAX : channels)),
+    window_((window < 3) ? 3 : ((window > CRPI_RATE_WINDOW_MAX) ? CRPI_RATE_WINDOW_MAX : window)),
+    span_(span),
+    head_(0),
+    count_(0)
+  {
+    for (int i = 0; i < CRPI_AXES_MAX; ++i)
+    {
+      wrap_[i] = 0.0;
+    }
+  }
+
+
+  LIBRARY_API void CrpiRateEstimator::Wrap (int first, int count, double period)
+  {
+    for (int i = first; i < (first + count) && i < channels_; ++i)
+    {
+      if (i >= 0)
+      {
+        wrap_[i] = period;
+      }
+    }
+  }
+
+
+  LIBRARY_API void CrpiRateEstimator::Reset ()
+  {
+    head_ = count_ = 0;
+  }
+
+
+  LIBRARY_API void CrpiRateEstimator::Add (double time, const double *values)
+  {
+    int last = (head_ + window_ - 1) % window_;
+    double value;
+    int i;
+
+    if (count_ > 0)
+    {
+      if (time <= time_[last])
+      {
+        return;
+      }
+      if ((time - time_[last]) > span_)
+      {
+        count_ = 0;
+      }
+    }
+
+    for (i = 0; i < channels_; ++i)
+    {
+      value = values[i];
+      //! Keep wrapping channels continuous with the previous sample
+      if (wrap_[i] > 0.0 && count_ > 0)
+      {
+        value += wrap_[i] * floor(((value_[last][i] - value) / wrap_[i]) + 0.5);
+      }
+      value_[head_][i] = value;
+    }
+    time_[head_] = time;
+    head_ = (head_ + 1) % window_;
+    if (count_ < window_)
+    {
+      ++count_;
+    }
+  }
+
+
+  LIBRARY_API int CrpiRateEstimator::Samples () const
+  {
+    return count_;
+  }
+
+
+  LIBRARY_API double CrpiRateEstimator::Time () const
+  {
+    return (count_ > 0) ? time_[(head_ + window_ - 1) % window_] : 0.0;
+  }
+
+
+  LIBRARY_API bool CrpiRateEstimator::Estimate (double *speed, double *accel) const
+  {
+    int newest = (head_ + window_ - 1) % window_;
+    int slot[CRPI_RATE_WINDOW_MAX];
+    double u[CRPI_RATE_WINDOW_MAX];
+    double s[5] = {0.0, 0.0, 0.0, 0.0, 0.0};
+    double inv[3][3], b[3], c[3];
+    double t0, scale, det, uk;
+    int n, i, j, k;
+
+    //! The samples within the span, newest first
+    t0 = time_[newest];
+    for (n = 0; n < count_; ++n)
+    {
+      slot[n] = (newest + window_ - n) % window_;
+      if ((t0 - time_[slot[n]]) > span_)
+      {
+        break;
+      }
+    }
+    if (n < 2)
+    {
+      return false;
+    }
+
+    //! Fit in time scaled to [-1, 0] over the samples, which keeps the normal equations well
+    //! conditioned at any sample rate
+    scale = t0 - time_[slot[n - 1]];
+    for (i = 0; i < n; ++i)
+    {
+      u[i] = (time_[slot[i]] - t0) / scale;
+      for (k = 0, uk = 1.0; k < 5; ++k, uk *= u[i])
+      {
+        s[k] += uk;
+      }
+    }
+
+    if (n == 2)
+    {
+      for (j = 0; j < channels_; ++j)
+      {
+        speed[j] = (value_[slot[0]][j] - value_[slot[1]][j]) / scale;
+        if (accel != NULL)
+        {
+          accel[j] = 0.0;
+        }
+      }
+      return true;
+    }
+
+    //! Inverse of the (symmetric) normal matrix of the quadratic fit, shared by every channel
+    inv[0][0] = s[2] * s[4] - s[3] * s[3];
+    inv[0][1] = s[2] * s[3] - s[1] * s[4];
+    inv[0][2] = s[1] * s[3] - s[2] * s[2];
+    inv[1][1] = s[0] * s[4] - s[2] * s[2];
+    inv[1][2] = s[1] * s[2] - s[0] * s[3];
+    inv[2][2] = s[0] * s[2] - s[1] * s[1];
+    det = s[0] * inv[0][0] + s[1] * inv[0][1] + s[2] * inv[0][2];
+    if (fabs(det) < 1.0e-12)
+    {
+      return false;
+    }
+    inv[1][0] = inv[0][1];
+    inv[2][0] = inv[0][2];
+    inv[2][1] = inv[1][2];
+
+    for (j = 0; j < channels_; ++j)
+    {
+      b[0] = b[1] = b[2] = 0.0;
+      for (i = 0; i < n; ++i)
+      {
+        //! Relative to the newest value, so that large offsets do not swamp the fit
+        double y = value_[slot[i]][j] - value_[slot[0]][j];
+        b[0] += y;
+        b[1] += y * u[i];
+        b[2] += y * u[i] * u[i];
+      }
+      for (k = 0; k < 3; ++k)
+      {
+        c[k] = (inv[k][0] * b[0] + inv[k][1] * b[1] + inv[k][2] * b[2]) / det;
+      }
+      speed[j] = c[1] / scale;
+      if (accel != NULL)
+      {
+        accel[j] = 2.0 * c[2] / (scale * scale);
+      }
+    }
+    return true;
+  }
+
+
+  //! @brief Time (s) from a sample to the prediction, limited to CRPI_RATE_PREDICT_MAX
+  //!
+  static double predictSpan (double sample, double when)
+  {
+    double dt = when - sample;
+    return (dt < 0.0) ? 0.0 : ((dt > CRPI_RATE_PREDICT_MAX) ? CRPI_RATE_PREDICT_MAX : dt);
+  }
+
+
+  LIBRARY_API bool crpi_predict_state (RobotStateSnapshot &state, const CrpiMotionRates &rates, double when)
+  {
+    double dt, half;
+    int i;
+
+    if ((state.valid & STATE_SPEEDS) == 0)
+    {
+      return false;
+    }
+
+    dt = predictSpan(rates.poseTime, when);
+    half = 0.5 * dt * dt;
+    state.pose.x += state.speeds.x * dt + rates.poseAccel.x * half;
+    state.pose.y += state.speeds.y * dt + rates.poseAccel.y * half;
+    state.pose.z += state.speeds.z * dt + rates.poseAccel.z * half;
+    state.pose.xrot += state.speeds.xrot * dt + rates.poseAccel.xrot * half;
+    state.pose.yrot += state.speeds.yrot * dt + rates.poseAccel.yrot * half;
+    state.pose.zrot += state.speeds.zrot * dt + rates.poseAccel.zrot * half;
+
+    dt = predictSpan(rates.axisTime, when);
+    half = 0.5 * dt * dt;
+    for (i = 0; i < rates.axes && i < state.axes; ++i)
+    {
+      state.axis[i] += rates.axisSpeed[i] * dt + rates.axisAccel[i] * half;
+    }
+    state.timestamp = when;
+    return true;
+  }
+} // crpi_robot
@@ -0,0 +1,171 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_estimator.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Speed and acceleration estimation from timestamped position feedback.
+//
+//  Controllers that do not report speeds (the ABB and KUKA handlers) give
+//  CRPI only a stream of poses and joint angles.  CrpiRateEstimator keeps
+//  the latest samples of such a stream in a fixed-size ring and fits a
+//  quadratic to each channel by least squares, a Savitzky-Golay filter
+//  that tolerates the uneven spacing of polled feedback.  The slope and
+//  curvature of the fit at the newest sample are the speed and the
+//  acceleration.  The drivers publish the estimates with their state, as
+//  RobotStateSnapshot::speeds and in a CrpiMotionRates, which is what
+//  GetRobotSpeed and GetPredictedState return for them, so the predictor
+//  and everything fed from the state snapshots see the same kind of data
+//  from every backend.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_estimator_H
+#define crpi_estimator_H
+
+#include "crpi.h"
+
+//! Most samples an estimator holds
+#define CRPI_RATE_WINDOW_MAX 32
+
+//! Samples fitted by default, and the oldest (s) a sample may be to be fitted
+#define CRPI_RATE_WINDOW 8
+#define CRPI_RATE_SPAN 0.25
+
+//! Longest time (s) a state is extrapolated by crpi_predict_state
+#define CRPI_RATE_PREDICT_MAX 0.1
+
+namespace crpi_robot
+{
+  //! @brief Estimated rates published by a driver alongside each of its states
+  //!
+  struct CrpiMotionRates
+  {
+    //! @brief Cartesian acceleration of the TCP (the speed is in the state's speeds), in the
+    //!        state's units per second squared
+    //!
+    robotPose poseAccel;
+
+    //! @brief Axis speeds and accelerations, and the number of axes used
+    //!
+    double axisSpeed[CRPI_AXES_MAX];
+    double axisAccel[CRPI_AXES_MAX];
+    int axes;
+
+    //! @brief Times (ulapi_time, s) of the newest pose and axis samples the estimates are for
+    //!        (0 if none)
+    //!
+    double poseTime;
+    double axisTime;
+
+    //! @brief RobotStateSnapshot::sequence of the state published with these rates
+    //!
+    unsigned long sequence;
+
+    //! @brief Default constructor
+    //!
+    CrpiMotionRates ()
+    {
+      for (int i = 0; i < CRPI_AXES_MAX; ++i)
+      {
+        axisSpeed[i] = axisAccel[i] = 0.0;
+      }
+      axes = 0;
+      poseTime = axisTime = 0.0;
+      sequence = 0;
+    }
+  };
+
+
+  //! @ingroup Robot
+  //!
+  //! @brief Least-squares (Savitzky-Golay) speed and acceleration estimator for up to
+  //!        CRPI_AXES_MAX channels sampled at the same, possibly uneven, times.  Never allocates.
+  //!
+  class LIBRARY_API CrpiRateEstimator
+  {
+  public:
+    //! @brief Default constructor
+    //!
+    //! @param channels Number of channels of each sample
+    //! @param window   Most samples fitted (3 to CRPI_RATE_WINDOW_MAX)
+    //! @param span     Oldest (s, relative to the newest sample) a sample may be to be fitted
+    //!
+    CrpiRateEstimator (int channels = CRPI_AXES_MAX, int window = CRPI_RATE_WINDOW,
+                       double span = CRPI_RATE_SPAN);
+
+    //! @brief Treat channels as angles that wrap around (e.g., a rotation that jumps from 180
+    //!        to -180 degrees), so that the wrap does not show as a spike in speed
+    //!
+    //! @param first  First channel
+    //! @param count  Number of channels
+    //! @param period The range of the angles (360 or 2 pi); 0 for channels that do not wrap
+    //!
+    void Wrap (int first, int count, double period);
+
+    //! @brief Forget every sample (e.g., after the units of the feedback changed)
+    //!
+    void Reset ();
+
+    //! @brief Add a sample.  Samples that are not newer than the last are ignored, and a gap
+    //!        longer than the span starts the fit over.
+    //!
+    //! @param time   Time (s) of the sample
+    //! @param values The channels' values
+    //!
+    void Add (double time, const double *values);
+
+    //! @brief Number of samples held
+    //!
+    int Samples () const;
+
+    //! @brief Time (s) of the newest sample (0 if none)
+    //!
+    double Time () const;
+
+    //! @brief Estimate the rates at the newest sample.  Two samples give a speed only (the
+    //!        acceleration is 0); three or more give both.
+    //!
+    //! @param speed Per-channel speed to be populated by the method (units per second)
+    //! @param accel Per-channel acceleration to be populated by the method (may be NULL)
+    //!
+    //! @return True if there were enough samples to estimate from
+    //!
+    bool Estimate (double *speed, double *accel) const;
+
+  private:
+    int channels_;
+    int window_;
+    double span_;
+
+    //! @brief Ring of samples:  head_ is the slot of the next sample, count_ the number held
+    //!
+    double time_[CRPI_RATE_WINDOW_MAX];
+    double value_[CRPI_RATE_WINDOW_MAX][CRPI_AXES_MAX];
+    int head_;
+    int count_;
+
+    //! @brief Period of each wrapping channel (0 if it does not wrap)
+    //!
+    double wrap_[CRPI_AXES_MAX];
+  }; // CrpiRateEstimator
+
+
+  //! @brief Extrapolate a state to a later time with its speeds and estimated accelerations
+  //!
+  //! @param state Published state, extrapolated in place; its timestamp becomes the time
+  //!              predicted for
+  //! @param rates Rates published with the state
+  //! @param when  Time (ulapi_time, s) to predict for; extrapolation stops CRPI_RATE_PREDICT_MAX
+  //!              seconds past each sample
+  //!
+  //! @return True if the state had speeds to extrapolate with
+  //!
+  LIBRARY_API bool crpi_predict_state (RobotStateSnapshot &state, const CrpiMotionRates &rates, double when);
+} // crpi_robot
+
+#endif
@@ -0,0 +1,96 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_fusion.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  TCP fusion definitions.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_fusion.h"
+#include "ulapi.h"
+
+using namespace std;
+
+namespace crpi_robot
+{
+  LIBRARY_API CrpiTcpFusion::CrpiTcpFusion (const CrpiFusionParams &params) :
+    params_(params),
+    lock_(ulapi_fastlock_new()),
+    sequence_(0)
+  {
+    encoder_ = fusion_.addSource(params.encoderNoise, params.encoderRotation, params.encoderLatency, true);
+    mocap_ = fusion_.addSource(params.mocapNoise, params.mocapRotation, params.mocapLatency, false);
+    fusion_.setDriftNoise(params.driftInit, params.driftRate);
+    fusion_.setHistory(params.history);
+  }
+
+
+  LIBRARY_API CrpiTcpFusion::~CrpiTcpFusion ()
+  {
+    ulapi_fastlock_delete(lock_);
+  }
+
+
+  LIBRARY_API bool CrpiTcpFusion::AddEncoder (const robotPose &world, bool degrees, double timestamp)
+  {
+    Math::pose p;
+    p.x = world.x;
+    p.y = world.y;
+    p.z = world.z;
+    p.xr = world.xrot;
+    p.yr = world.yrot;
+    p.zr = world.zrot;
+    Math::qpose meas = Math::toQPose(p, degrees);
+
+    ulapi_fastlock_take(lock_);
+    bool used = fusion_.correct(encoder_, meas, timestamp);
+    ulapi_fastlock_give(lock_);
+    return used;
+  }
+
+
+  LIBRARY_API bool CrpiTcpFusion::AddMoCap (const Math::point &position,
+                                            const Math::matrix &rotation,
+                                            double timestamp)
+  {
+    ulapi_fastlock_take(lock_);
+    bool used = fusion_.correct(mocap_, position, rotation, timestamp);
+    ulapi_fastlock_give(lock_);
+    return used;
+  }
+
+
+  LIBRARY_API bool CrpiTcpFusion::Get (robotPose &world, bool degrees, double timestamp) const
+  {
+    Math::pose p;
+
+    ulapi_fastlock_take(lock_);
+    bool tracking = fusion_.tracking();
+    if (tracking)
+    {
+      p = fusion_.predictPose(timestamp, degrees);
+    }
+    ulapi_fastlock_give(lock_);
+
+    if (tracking)
+    {
+      world = p;
+    }
+    return tracking;
+  }
+
+
+  LIBRARY_API Math::point CrpiTcpFusion::Drift () const
+  {
+    ulapi_fastlock_take(lock_);
+    Math::point drift = fusion_.drift();
+    ulapi_fastlock_give(lock_);
+    return drift;
+  }
+} // crpi_robot
@@ -0,0 +1,176 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_fusion.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Fusion of the robot's own TCP feedback with motion capture.
+//
+//  The robot's encoders give the TCP pose at 125-500 Hz with little
+//  latency, but mapped to the world through ToWorld they carry the error of
+//  the robot-to-world registration, which drifts with temperature and load.
+//  A motion capture system sees the TCP in the world directly, more slowly,
+//  later, and with more noise.  CrpiTcpFusion feeds both to a
+//  Math::PoseFusion, which estimates the drift of the encoder poses and
+//  accepts either source late and out of order, and reports one
+//  drift-corrected, extrapolated TCP pose.  CrpiRobot::StartFusion samples
+//  the encoders on the SensorHub; the application passes each motion
+//  capture frame to CrpiRobot::FuseMoCap and reads the result with
+//  CrpiRobot::GetFusedState.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_fusion_H
+#define crpi_fusion_H
+
+#ifdef WIN32
+#include "..\Math\Filters.h"
+#else
+#include "../Math/Filters.h"
+#endif
+
+#include "crpi.h"
+
+namespace crpi_robot
+{
+  //! @brief Noise, latency, and sampling settings of the TCP fusion.  Lengths are in mm,
+  //!        angles in radians, and times in seconds.
+  //!
+  struct CrpiFusionParams
+  {
+    //! @brief Standard deviations of the encoder position and orientation, and the age of an
+    //!        encoder state at its timestamp
+    //!
+    double encoderNoise;
+    double encoderRotation;
+    double encoderLatency;
+
+    //! @brief Standard deviations of the motion capture position and orientation, and the age
+    //!        of a frame when it is passed to FuseMoCap
+    //!
+    double mocapNoise;
+    double mocapRotation;
+    double mocapLatency;
+
+    //! @brief Standard deviation of the registration drift when fusion starts, and the spectral
+    //!        density of its random walk (mm^2 / s)
+    //!
+    double driftInit;
+    double driftRate;
+
+    //! @brief How late a measurement may arrive and still be used
+    //!
+    double history;
+
+    //! @brief Seconds between samples of the encoder state
+    //!
+    double period;
+
+    //! @brief Default constructor
+    //!
+    CrpiFusionParams()
+    {
+      encoderNoise = 0.1;
+      encoderRotation = 0.001;
+      encoderLatency = 0.0;
+      mocapNoise = 0.5;
+      mocapRotation = 0.005;
+      mocapLatency = 0.0;
+      driftInit = 10.0;
+      driftRate = 1.0;
+      history = 0.25;
+      period = 0.001;
+    }
+  };
+
+  //! @ingroup Robot
+  //!
+  //! @brief Fused TCP estimate of one robot.  Poses are in the world frame; the owner
+  //!        (CrpiRobot) maps the encoder poses in with ToWorld and the estimate out with
+  //!        FromWorld.  All methods may be called from any thread.
+  //!
+  class LIBRARY_API CrpiTcpFusion
+  {
+  public:
+    //! @brief Constructor
+    //!
+    //! @param params Noise, latency, and sampling settings
+    //!
+    CrpiTcpFusion (const CrpiFusionParams &params);
+
+    //! @brief Destructor
+    //!
+    ~CrpiTcpFusion ();
+
+    //! @brief Add an encoder pose
+    //!
+    //! @param world     TCP pose from the robot's state, mapped to the world frame
+    //! @param degrees   Whether the pose's angles are in degrees
+    //! @param timestamp The state's timestamp (s, ulapi_time)
+    //!
+    //! @return True if the pose was used
+    //!
+    bool AddEncoder (const robotPose &world, bool degrees, double timestamp);
+
+    //! @brief Add a motion capture frame of the TCP, as reported by MoCapSubject
+    //!
+    //! @param position  TCP position in the world frame (mm)
+    //! @param rotation  TCP orientation in the world frame (3x3 rotation matrix)
+    //! @param timestamp Time the frame was received (s, ulapi_time)
+    //!
+    //! @return True if the frame was used
+    //!
+    bool AddMoCap (const Math::point &position, const Math::matrix &rotation, double timestamp);
+
+    //! @brief The fused TCP pose
+    //!
+    //! @param world     Set to the pose, in the world frame
+    //! @param degrees   Whether the angles are to be in degrees
+    //! @param timestamp Time for which the pose is wanted (s, ulapi_time)
+    //!
+    //! @return False if neither source has reported yet
+    //!
+    bool Get (robotPose &world, bool degrees, double timestamp) const;
+
+    //! @brief Estimated drift of the encoder poses in the world frame (mm)
+    //!
+    Math::point Drift () const;
+
+    //! @brief The settings, and the sequence of the last encoder state added
+    //!
+    const CrpiFusionParams &Params () const
+    {
+      return params_;
+    }
+    unsigned long &Sequence ()
+    {
+      return sequence_;
+    }
+
+  private:
+    CrpiFusionParams params_;
+
+    //! @brief The filter and its sources
+    //!
+    Math::PoseFusion fusion_;
+    int encoder_;
+    int mocap_;
+
+    //! @brief Guards fusion_
+    //!
+    void *lock_;
+
+    //! @brief Used by the sampling task only
+    //!
+    unsigned long sequence_;
+
+    CrpiTcpFusion (const CrpiTcpFusion &) = delete;
+    CrpiTcpFusion &operator= (const CrpiTcpFusion &) = delete;
+  }; // CrpiTcpFusion
+} // namespace crpi_robot
+
+#endif
@@ -0,0 +1,1468 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_gateway.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Gateway that federates the robot servers of many CRPI nodes (e.g., the
+//  XMLInterface of every cell PC) behind a single endpoint.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_gateway.h"
+#include "crpi_hub.h"
+#include "crpi_log.h"
+#include "crpi_metrics.h"
+#include "crpi_xml.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace Xml;
+
+//! @brief Size of the receive buffers (the largest binary frame plus a terminator for XML)
+//!
+#define GATEWAY_BUFFER (CRPI_BINARY_MAX_FRAME + 1)
+
+//! @brief Room reserved in a forwarded XML command for the gateway's ID attribute
+//!
+#define GATEWAY_ID_ROOM 16
+
+//! @brief Fastest status subscription (Hz), as accepted by the robot servers
+//!
+#define GATEWAY_SUBSCRIBE_MAX 1000.0
+
+namespace crpi_robot
+{
+  //! @brief What a socket registered with the poller belongs to
+  //!
+  enum gatewayKind
+  {
+    GatewayClient,
+    GatewayLink
+  };
+
+  //! @brief Wire protocol of a connection
+  //!
+  enum gatewayProtocol
+  {
+    GatewayUnknown,
+    GatewayXml,
+    GatewayBinary
+  };
+
+  struct gatewayNode;
+
+  //! @brief A connection served by the event loop
+  //!
+  struct gatewaySocket
+  {
+    gatewayKind kind;
+
+    //! @brief Socket ID (-1 while a node connection is down)
+    //!
+    ulapi_integer socket;
+
+    //! @brief Bytes received but not yet handled
+    //!
+    CrpiXmlFramer in;
+
+    gatewaySocket (gatewayKind k) :
+      kind(k),
+      socket(-1),
+      in(GATEWAY_BUFFER)
+    {
+    }
+  };
+
+
+  //! @brief Persistent connection to a robot's server, shared by every client of the robot
+  //!
+  struct gatewayLink : public gatewaySocket
+  {
+    gatewayNode *node;
+    gatewayProtocol protocol;
+
+    //! @brief Whether the connector thread is opening the connection, and the earliest time
+    //!        (ulapi_time, s) of the next attempt after one failed
+    //!
+    bool connecting;
+    double retry;
+
+    //! @brief Requests sent while the connection was being opened
+    //!
+    string backlog;
+
+    gatewayLink () :
+      gatewaySocket(GatewayLink),
+      node(NULL),
+      protocol(GatewayXml),
+      connecting(false),
+      retry(0.0)
+    {
+    }
+  };
+
+
+  //! @brief A client subscribed to a robot's status
+  //!
+  struct gatewaySubscriber
+  {
+    unsigned long serial;
+    unsigned int fields;
+    double rate;
+
+    //! @brief Whether the client has had its first update, and the ID of its Subscribe command
+    //!        (for answering it if the subscription is refused)
+    //!
+    bool acknowledged;
+    bool hasId;
+    string id;
+  };
+
+
+  //! @brief A robot, the node serving it, and the connections to it
+  //!
+  struct gatewayNode
+  {
+    string robot;
+    string host;
+    int port;
+
+    gatewayLink xml;
+    gatewayLink bin;
+
+    //! @brief Clients subscribed to the robot's status, and the gateway ID of the last
+    //!        subscription sent to the node (0 if none is active)
+    //!
+    vector<gatewaySubscriber> subscribers;
+    uint32_t subscribeId;
+  };
+
+
+  //! @brief A connected client
+  //!
+  struct gatewayClient : public gatewaySocket
+  {
+    //! @brief Connection number.  Never reused, so responses for a client that has since
+    //!        disconnected are recognized and discarded.
+    //!
+    unsigned long serial;
+
+    gatewayProtocol protocol;
+
+    //! @brief Robot chosen with Route (NULL until one is)
+    //!
+    gatewayNode *route;
+
+    //! @brief Buffer for responses written by the gateway itself
+    //!
+    CrpiXmlWriter out;
+
+    gatewayClient () :
+      gatewaySocket(GatewayClient),
+      serial(0),
+      protocol(GatewayUnknown),
+      route(NULL),
+      out(GATEWAY_BUFFER)
+    {
+    }
+  };
+
+
+  //! @brief A request forwarded to a node and not yet answered
+  //!
+  struct gatewayPending
+  {
+    unsigned long serial;
+    gatewayLink *link;
+
+    //! @brief The client's ID:  the header ID of a binary request, or the ID attribute of an
+    //!        XML command (if it had one)
+    //!
+    uint32_t binaryId;
+    bool hasId;
+    string id;
+
+    //! @brief Command of a binary request (for answering it if the node is lost)
+    //!
+    uint16_t cmd;
+  };
+
+
+  struct gatewayState
+  {
+    vector<gatewayNode*> nodes;
+    unordered_map<string, gatewayNode*> routes;
+    unordered_map<unsigned long, gatewayClient*> clients;
+    unordered_map<uint32_t, gatewayPending> pending;
+    uint32_t nextId;
+    unsigned long serials;
+
+    void *poller;
+    ulapi_integer server;
+    void *loop;
+    void *connector;
+    std::atomic<bool> run;
+
+    //! @brief Links waiting for the connector thread, and the sockets it opened for them
+    //!        (-1 if it could not), guarded by handle
+    //!
+    ulapi_mutex_struct *handle;
+    void *wake;
+    deque<gatewayLink*> connects;
+    deque<pair<gatewayLink*, ulapi_integer> > connected;
+
+    //! @brief Decoders and encoders for the commands the gateway answers itself, and the
+    //!        buffer forwarded messages are rewritten into
+    //!
+    CrpiXmlParams params;
+    CrpiXml xml;
+    CrpiBinary bin;
+    string doc;
+
+    //! @brief Runtime metrics:  connected clients, time taken to forward a message, requests
+    //!        failed because a node could not be reached, and status updates pushed
+    //!
+    CrpiGauge *clientsMetric;
+    CrpiHistogram *forwardMetric;
+    CrpiCounter *failedMetric;
+    CrpiCounter *updatesMetric;
+
+    gatewayState () :
+      nextId(0),
+      serials(0),
+      poller(NULL),
+      server(-1),
+      loop(NULL),
+      connector(NULL),
+      run(false),
+      handle(NULL),
+      wake(NULL),
+      xml(&params),
+      bin(&params)
+    {
+      params.toolName = "Nothing";
+      params.toolVal = 0.0f;
+      params.cmd = CmdGetRobotPose;
+      params.status = CANON_SUCCESS;
+    }
+  };
+
+
+  //! @brief Status fields that can be subscribed to, by name (as accepted by XMLInterface)
+  //!
+  static const struct
+  {
+    const char *name;
+    unsigned int field;
+  } gatewayFields[] =
+  {
+    { "Pose",    STATE_POSE },
+    { "Joints",  STATE_AXES },
+    { "Forces",  STATE_FORCES },
+    { "Speeds",  STATE_SPEEDS },
+    { "IO",      STATE_IO },
+    { "Torques", STATE_TORQUES },
+    { "All",     STATE_POSE | STATE_AXES | STATE_FORCES | STATE_SPEEDS | STATE_IO | STATE_TORQUES }
+  };
+
+  static const size_t gatewayFieldCount = sizeof(gatewayFields) / sizeof(gatewayFields[0]);
+
+
+  //! @brief Decode the fields named in a subscription, separated by spaces or commas
+  //!
+  //! @return The CrpiStateField values named, or 0 if a name is not recognized
+  //!
+  static unsigned int gatewayMask (const string &names)
+  {
+    unsigned int fields = 0;
+    size_t start = 0, end, i;
+
+    while (start < names.size())
+    {
+      end = names.find_first_of(" ,", start);
+      end = (end == string::npos) ? names.size() : end;
+      if (end > start)
+      {
+        for (i = 0; i < gatewayFieldCount; ++i)
+        {
+          if (names.compare(start, end - start, gatewayFields[i].name) == 0)
+          {
+            fields |= gatewayFields[i].field;
+            break;
+          }
+        }
+        if (i == gatewayFieldCount)
+        {
+          return 0;
+        }
+      }
+      start = end + 1;
+    }
+    return fields;
+  }
+
+
+  //! @brief Find the opening tag of the first <CRPICommand> element of a document
+  //!
+  //! @param doc   The document
+  //! @param len   Length of the document in bytes
+  //! @param start Set to the offset of the tag's '<'
+  //!
+  //! @return True if the document has a complete <CRPICommand> tag
+  //!
+  static bool commandTag (const char *doc, size_t len, size_t &start)
+  {
+    static const char tag[] = "<CRPICommand";
+    const char *at = search(doc, doc + len, tag, tag + sizeof(tag) - 1);
+    const char *after = at + sizeof(tag) - 1;
+
+    if (at == doc + len || after >= doc + len || !(isspace((unsigned char)*after) || *after == '>' || *after == '/'))
+    {
+      return false;
+    }
+    start = at - doc;
+    return true;
+  }
+
+
+  //! @brief Find an attribute in the opening tag starting at tag
+  //!
+  //! @param doc        The document
+  //! @param len        Length of the document in bytes
+  //! @param tag        Offset of the tag's '<'
+  //! @param name       The attribute's name
+  //! @param attr       Set to the offset of the whitespace before the attribute's name
+  //! @param valueStart Set to the offset of the attribute's value
+  //! @param valueEnd   Set to the offset of the closing quote
+  //!
+  //! @return True if the tag has the attribute
+  //!
+  static bool tagAttribute (const char *doc, size_t len, size_t tag, const char *name, size_t &attr,
+                            size_t &valueStart, size_t &valueEnd)
+  {
+    const char *end = (const char*)memchr(doc + tag, '>', len - tag);
+    size_t n = strlen(name);
+    const char *at, *quote;
+
+    if (end == NULL)
+    {
+      return false;
+    }
+    for (at = doc + tag + 1; at + n + 2 < end; ++at)
+    {
+      if (isspace((unsigned char)at[0]) && memcmp(at + 1, name, n) == 0 && at[n + 1] == '=' && at[n + 2] == '"')
+      {
+        quote = (const char*)memchr(at + n + 3, '"', end - (at + n + 3));
+        if (quote == NULL)
+        {
+          return false;
+        }
+        attr = at - doc;
+        valueStart = (at + n + 3) - doc;
+        valueEnd = quote - doc;
+        return true;
+      }
+    }
+    return false;
+  }
+
+
+  //! @brief The value of an attribute in the opening tag starting at tag
+  //!
+  //! @return True if the tag has the attribute
+  //!
+  static bool tagValue (const char *doc, size_t len, size_t tag, const char *name, string &value)
+  {
+    size_t attr, start, end;
+
+    if (!tagAttribute(doc, len, tag, name, attr, start, end))
+    {
+      return false;
+    }
+    value.assign(doc + start, end - start);
+    return true;
+  }
+
+
+  //! @brief Copy a document, setting the ID attribute of the opening tag starting at tag
+  //!
+  //! @param doc The document
+  //! @param len Length of the document in bytes
+  //! @param tag Offset of the tag's '<'
+  //! @param id  The new ID, or NULL to remove the attribute
+  //! @param out Set to the rewritten document
+  //!
+  static void setId (const char *doc, size_t len, size_t tag, const char *id, string &out)
+  {
+    size_t attr, start, end, name;
+
+    out.clear();
+    if (tagAttribute(doc, len, tag, "ID", attr, start, end))
+    {
+      if (id != NULL)
+      {
+        out.append(doc, start);
+        out.append(id);
+        out.append(doc + end, len - end);
+      }
+      else
+      {
+        out.append(doc, attr);
+        out.append(doc + end + 1, len - end - 1);
+      }
+      return;
+    }
+    if (id == NULL)
+    {
+      out.assign(doc, len);
+      return;
+    }
+
+    //! No ID yet:  add one after the element name
+    for (name = tag + 1; name < len && !isspace((unsigned char)doc[name]) && doc[name] != '>' && doc[name] != '/'; ++name)
+    {
+    }
+    out.append(doc, name);
+    out.append(" ID=\"");
+    out.append(id);
+    out.append("\"");
+    out.append(doc + name, len - name);
+  }
+
+
+  //! @brief Whether a document's root element is tag
+  //!
+  static bool rootIs (const char *doc, size_t len, const char *tag)
+  {
+    size_t n = strlen(tag);
+    return len > n && memcmp(doc, tag, n) == 0 && (isspace((unsigned char)doc[n]) || doc[n] == '>');
+  }
+
+
+  //! @brief A gateway ID for a new request (never 0, and small enough for the robot servers to
+  //!        read as an int)
+  //!
+  static uint32_t nextRequest (gatewayState *gs)
+  {
+    do
+    {
+      gs->nextId = (gs->nextId >= 0x7FFFFFFFu) ? 1 : gs->nextId + 1;
+    } while (gs->pending.find(gs->nextId) != gs->pending.end());
+    return gs->nextId;
+  }
+
+
+  //! @brief Answer an XML client from the gateway
+  //!
+  //! @param gs     The gateway
+  //! @param c      The client
+  //! @param hasId  Whether the client's command had an ID
+  //! @param id     The ID
+  //! @param status The CanonReturn to report
+  //!
+  static void replyXml (gatewayState *gs, gatewayClient *c, bool hasId, const string &id, CanonReturn status)
+  {
+    gs->params.status = status;
+    gs->params.commandID = 1;
+    gs->params.counter += 1;
+    if (!gs->xml.encode(c->out))
+    {
+      return;
+    }
+    setId(c->out.data(), c->out.size(), 0, hasId ? id.c_str() : NULL, gs->doc);
+    ulapi_socket_write(c->socket, gs->doc.data(), (ulapi_integer)gs->doc.size());
+  }
+
+
+  //! @brief Answer a binary client from the gateway
+  //!
+  //! @param c      The client
+  //! @param cmd    The command being answered
+  //! @param id     The client's header ID
+  //! @param status The CanonReturn to report
+  //!
+  static void replyBinary (gatewayClient *c, uint16_t cmd, uint32_t id, CanonReturn status)
+  {
+    char frame[sizeof(CrpiBinaryHeader) + sizeof(CrpiBinaryStatus)];
+    CrpiBinaryHeader header;
+
+    header.magic = CRPI_BINARY_MAGIC;
+    header.length = (uint32_t)sizeof(frame);
+    header.version = CRPI_BINARY_VERSION;
+    header.cmd = cmd;
+    header.status = (int32_t)status;
+    header.id = id;
+    header.counter = 0;
+    memset(frame, 0, sizeof(frame));
+    memcpy(frame, &header, sizeof(header));
+    ulapi_socket_write(c->socket, frame, (ulapi_integer)sizeof(frame));
+  }
+
+
+  //! @brief Answer a forwarded request that its node can no longer answer
+  //!
+  static void failPending (gatewayState *gs, const gatewayPending &p)
+  {
+    unordered_map<unsigned long, gatewayClient*>::iterator c = gs->clients.find(p.serial);
+
+    gs->failedMetric->Inc();
+    if (c == gs->clients.end())
+    {
+      return;
+    }
+    if (p.link->protocol == GatewayBinary)
+    {
+      replyBinary(c->second, p.cmd, p.binaryId, CANON_FAILURE);
+    }
+    else
+    {
+      replyXml(gs, c->second, p.hasId, p.id, CANON_FAILURE);
+    }
+  }
+
+
+  //! @brief Answer every request waiting on a link with CANON_FAILURE
+  //!
+  static void failLink (gatewayState *gs, gatewayLink *link)
+  {
+    unordered_map<uint32_t, gatewayPending>::iterator p = gs->pending.begin();
+
+    while (p != gs->pending.end())
+    {
+      if (p->second.link == link)
+      {
+        failPending(gs, p->second);
+        p = gs->pending.erase(p);
+      }
+      else
+      {
+        ++p;
+      }
+    }
+  }
+
+
+  //! @brief Refuse the subscribers of a robot still waiting for their first update
+  //!
+  static void refuseSubscribers (gatewayState *gs, gatewayNode *node, CanonReturn status)
+  {
+    vector<gatewaySubscriber>::iterator s = node->subscribers.begin();
+    unordered_map<unsigned long, gatewayClient*>::iterator c;
+
+    while (s != node->subscribers.end())
+    {
+      if (s->acknowledged)
+      {
+        ++s;
+        continue;
+      }
+      c = gs->clients.find(s->serial);
+      if (c != gs->clients.end())
+      {
+        replyXml(gs, c->second, s->hasId, s->id, status);
+      }
+      s = node->subscribers.erase(s);
+    }
+  }
+
+
+  //! @brief Close a node connection and fail the requests waiting on it
+  //!
+  static void dropLink (gatewayState *gs, gatewayLink *link)
+  {
+    if (link->socket >= 0)
+    {
+      ulapi_poller_remove(gs->poller, link->socket);
+      ulapi_socket_close(link->socket);
+      link->socket = -1;
+      CRPI_LOG(CRPI_LOG_WARNING, "CRPI gateway:  lost connection to %s", link->node->robot.c_str());
+    }
+    link->in.clear();
+    link->backlog.clear();
+    failLink(gs, link);
+    if (link == &link->node->xml)
+    {
+      //! Reopened by the event loop while the robot has subscribers
+      link->node->subscribeId = 0;
+    }
+  }
+
+
+  //! @brief Send a message to a node, opening the connection if it is down
+  //!
+  //! @return False if the node cannot be reached
+  //!
+  static bool linkSend (gatewayState *gs, gatewayLink *link, const char *buf, size_t len)
+  {
+    if (link->socket >= 0)
+    {
+      if (ulapi_socket_write(link->socket, buf, (ulapi_integer)len) < 0)
+      {
+        dropLink(gs, link);
+        return false;
+      }
+      return true;
+    }
+
+    if (!link->connecting)
+    {
+      if (ulapi_time() < link->retry)
+      {
+        return false;
+      }
+      link->connecting = true;
+      ulapi_mutex_take(gs->handle);
+      gs->connects.push_back(link);
+      ulapi_cond_signal(gs->wake);
+      ulapi_mutex_give(gs->handle);
+    }
+    if (link->backlog.size() + len > GATEWAY_BACKLOG)
+    {
+      return false;
+    }
+    link->backlog.append(buf, len);
+    return true;
+  }
+
+
+  //! @brief Send a robot the union of its subscribers' fields at the fastest rate any of them
+  //!        asked for (or end its subscription if it has none)
+  //!
+  static void subscribeNode (gatewayState *gs, gatewayNode *node)
+  {
+    unsigned int fields = 0;
+    double rate = 0.0;
+    char value[32];
+    string cmd;
+    size_t i;
+
+    for (i = 0; i < node->subscribers.size(); ++i)
+    {
+      fields |= node->subscribers[i].fields;
+      rate = (node->subscribers[i].rate > rate) ? node->subscribers[i].rate : rate;
+    }
+    if (fields == 0 && (node->subscribeId == 0 || node->xml.socket < 0))
+    {
+      //! Nothing to start, and nothing running to stop
+      node->subscribeId = 0;
+      return;
+    }
+
+    node->subscribeId = nextRequest(gs);
+    snprintf(value, sizeof(value), "%u", node->subscribeId);
+    cmd = "<CRPICommand type=\"Subscribe\" ID=\"";
+    cmd += value;
+    cmd += "\"><String Value=\"";
+    for (i = 0; i + 1 < gatewayFieldCount; ++i)
+    {
+      if (fields & gatewayFields[i].field)
+      {
+        cmd += gatewayFields[i].name;
+        cmd += " ";
+      }
+    }
+    snprintf(value, sizeof(value), "%g", rate);
+    cmd += "\"/><Real Value=\"";
+    cmd += value;
+    cmd += "\"/></CRPICommand>";
+
+    if (!linkSend(gs, &node->xml, cmd.data(), cmd.size()))
+    {
+      node->subscribeId = 0;
+      refuseSubscribers(gs, node, CANON_FAILURE);
+    }
+  }
+
+
+  //! @brief Start, change, or end a client's subscription to a robot's status
+  //!
+  static void subscribe (gatewayState *gs, gatewayClient *c, gatewayNode *node, const char *doc, size_t len,
+                         bool hasId, const string &id)
+  {
+    gatewaySubscriber sub;
+    vector<gatewaySubscriber>::iterator s;
+    unsigned int fields;
+
+    gs->params.str.clear();
+    gs->params.real = 0.0;
+    if (!gs->xml.parse(string(doc, len)))
+    {
+      replyXml(gs, c, hasId, id, CANON_FAILURE);
+      return;
+    }
+    fields = gatewayMask(gs->params.str);
+    if (node == NULL || (gs->params.real > 0.0 && fields == 0))
+    {
+      replyXml(gs, c, hasId, id, CANON_REJECT);
+      return;
+    }
+
+    for (s = node->subscribers.begin(); s != node->subscribers.end(); ++s)
+    {
+      if (s->serial == c->serial)
+      {
+        node->subscribers.erase(s);
+        break;
+      }
+    }
+    if (gs->params.real <= 0.0)
+    {
+      subscribeNode(gs, node);
+      replyXml(gs, c, hasId, id, CANON_SUCCESS);
+      return;
+    }
+
+    //! Acknowledged by the first update, which carries every field
+    sub.serial = c->serial;
+    sub.fields = fields;
+    sub.rate = (gs->params.real > GATEWAY_SUBSCRIBE_MAX) ? GATEWAY_SUBSCRIBE_MAX : gs->params.real;
+    sub.acknowledged = false;
+    sub.hasId = hasId;
+    sub.id = id;
+    node->subscribers.push_back(sub);
+    subscribeNode(gs, node);
+  }
+
+
+  //! @brief Find a robot by name
+  //!
+  static gatewayNode *findNode (gatewayState *gs, const string &robot)
+  {
+    unordered_map<string, gatewayNode*>::iterator n = gs->routes.find(robot);
+    return (n == gs->routes.end()) ? NULL : n->second;
+  }
+
+
+  //! @brief Route, or answer, a complete XML document from a client
+  //!
+  static void clientDocument (gatewayState *gs, gatewayClient *c, const char *doc, size_t len)
+  {
+    double start = ulapi_time();
+    gatewayNode *node = c->route;
+    gatewayPending p;
+    string type, robot, id;
+    char value[16];
+    size_t tag;
+    bool hasId;
+    uint32_t request;
+
+    if (!commandTag(doc, len, tag))
+    {
+      replyXml(gs, c, false, id, CANON_REJECT);
+      return;
+    }
+    hasId = tagValue(doc, len, tag, "ID", id);
+    tagValue(doc, len, tag, "type", type);
+    if (tagValue(doc, len, tag, "Robot", robot))
+    {
+      node = findNode(gs, robot);
+    }
+
+    if (type == "Route")
+    {
+      gs->params.str.clear();
+      gs->xml.parse(string(doc, len));
+      node = findNode(gs, gs->params.str);
+      if (node != NULL)
+      {
+        c->route = node;
+      }
+      replyXml(gs, c, hasId, id, (node != NULL) ? CANON_SUCCESS : CANON_REJECT);
+      return;
+    }
+    if (type == "Subscribe")
+    {
+      subscribe(gs, c, node, doc, len, hasId, id);
+      return;
+    }
+    if (node == NULL || len + GATEWAY_ID_ROOM > CRPI_BINARY_MAX_FRAME)
+    {
+      replyXml(gs, c, hasId, id, CANON_REJECT);
+      return;
+    }
+
+    request = nextRequest(gs);
+    snprintf(value, sizeof(value), "%u", request);
+    setId(doc, len, tag, value, gs->doc);
+    p.serial = c->serial;
+    p.link = &node->xml;
+    p.binaryId = 0;
+    p.hasId = hasId;
+    p.id = id;
+    p.cmd = 0;
+    gs->pending[request] = p;
+    if (!linkSend(gs, &node->xml, gs->doc.data(), gs->doc.size()))
+    {
+      gs->pending.erase(request);
+      failPending(gs, p);
+      return;
+    }
+    gs->forwardMetric->ObserveSince(start);
+  }
+
+
+  //! @brief Route, or answer, a complete binary frame from a client
+  //!
+  static void clientFrame (gatewayState *gs, gatewayClient *c, const char *buf, size_t len)
+  {
+    double start = ulapi_time();
+    CrpiBinaryHeader header;
+    gatewayNode *node;
+    gatewayPending p;
+    uint32_t request;
+
+    memcpy(&header, buf, sizeof(header));
+    if (header.cmd == CRPI_GATEWAY_ROUTE)
+    {
+      node = findNode(gs, string(buf + sizeof(header), len - sizeof(header)));
+      if (node != NULL)
+      {
+        c->route = node;
+      }
+      replyBinary(c, header.cmd, header.id, (node != NULL) ? CANON_SUCCESS : CANON_REJECT);
+      return;
+    }
+    if ((node = c->route) == NULL)
+    {
+      replyBinary(c, header.cmd, header.id, CANON_REJECT);
+      return;
+    }
+
+    request = nextRequest(gs);
+    gs->doc.assign(buf, len);
+    memcpy(&gs->doc[offsetof(CrpiBinaryHeader, id)], &request, sizeof(request));
+    p.serial = c->serial;
+    p.link = &node->bin;
+    p.binaryId = header.id;
+    p.hasId = true;
+    p.cmd = header.cmd;
+    gs->pending[request] = p;
+    if (!linkSend(gs, &node->bin, gs->doc.data(), gs->doc.size()))
+    {
+      gs->pending.erase(request);
+      failPending(gs, p);
+      return;
+    }
+    gs->forwardMetric->ObserveSince(start);
+  }
+
+
+  //! @brief Read from a client and route every complete command received so far
+  //!
+  //! @return False if the client disconnected or sent a malformed command
+  //!
+  static bool clientReceive (gatewayState *gs, gatewayClient *c)
+  {
+    ulapi_integer rec;
+    const char *doc;
+    char *space;
+    size_t room, size;
+    long len = 0;
+    int found = 0;
+
+    space = c->in.space(room);
+    if (room == 0)
+    {
+      return false;
+    }
+    rec = ulapi_socket_read(c->socket, space, (ulapi_integer)room);
+    if (rec <= 0)
+    {
+      return false;
+    }
+    c->in.commit((size_t)rec);
+
+    if (c->protocol == GatewayUnknown)
+    {
+      if (!CrpiBinary::isBinary(c->in.data(), c->in.size()))
+      {
+        c->protocol = GatewayXml;
+      }
+      else if (c->in.size() >= sizeof(CrpiBinaryHeader::magic))
+      {
+        c->protocol = GatewayBinary;
+      }
+      else
+      {
+        return true;
+      }
+    }
+
+    if (c->protocol == GatewayBinary)
+    {
+      while ((len = CrpiBinary::frameLength(c->in.data(), c->in.size())) > 0)
+      {
+        clientFrame(gs, c, c->in.data(), (size_t)len);
+        c->in.consume((size_t)len);
+      }
+      found = (len < 0 || c->in.size() >= GATEWAY_BUFFER) ? -1 : 0;
+    }
+    else
+    {
+      while ((found = c->in.next(doc, size)) > 0)
+      {
+        clientDocument(gs, c, doc, size);
+      }
+    }
+    return found >= 0;
+  }
+
+
+  //! @brief Push a status update from a robot to all of its subscribers
+  //!
+  static void fanOut (gatewayState *gs, gatewayNode *node, const char *doc, size_t len)
+  {
+    static const char root[] = "<CRPIUpdate";
+    vector<gatewaySubscriber>::iterator s = node->subscribers.begin();
+    unordered_map<unsigned long, gatewayClient*>::iterator c;
+
+    gs->doc.assign(root, sizeof(root) - 1);
+    gs->doc += " Robot=\"";
+    gs->doc += node->robot;
+    gs->doc += "\"";
+    gs->doc.append(doc + sizeof(root) - 1, len - (sizeof(root) - 1));
+
+    while (s != node->subscribers.end())
+    {
+      c = gs->clients.find(s->serial);
+      if (c == gs->clients.end())
+      {
+        s = node->subscribers.erase(s);
+        continue;
+      }
+      ulapi_socket_write(c->second->socket, gs->doc.data(), (ulapi_integer)gs->doc.size());
+      s->acknowledged = true;
+      gs->updatesMetric->Inc();
+      ++s;
+    }
+  }
+
+
+  //! @brief Return a node's response to the client that sent the request
+  //!
+  //! @param gs      The gateway
+  //! @param request The gateway ID carried by the response
+  //! @param p       Set to the request
+  //!
+  //! @return The client, or NULL if the request is unknown or its client has disconnected
+  //!
+  static gatewayClient *takePending (gatewayState *gs, uint32_t request, gatewayPending &p)
+  {
+    unordered_map<uint32_t, gatewayPending>::iterator found = gs->pending.find(request);
+    unordered_map<unsigned long, gatewayClient*>::iterator c;
+
+    if (found == gs->pending.end())
+    {
+      return NULL;
+    }
+    p = found->second;
+    gs->pending.erase(found);
+    c = gs->clients.find(p.serial);
+    return (c == gs->clients.end()) ? NULL : c->second;
+  }
+
+
+  //! @brief Handle a complete XML document from a node
+  //!
+  static void linkDocument (gatewayState *gs, gatewayLink *link, const char *doc, size_t len)
+  {
+    double start = ulapi_time();
+    gatewayNode *node = link->node;
+    gatewayClient *c;
+    gatewayPending p;
+    string id;
+    uint32_t request;
+
+    if (rootIs(doc, len, "<CRPIUpdate"))
+    {
+      fanOut(gs, node, doc, len);
+      return;
+    }
+    if (!rootIs(doc, len, "<CRPIStatus") || !tagValue(doc, len, 0, "ID", id))
+    {
+      return;
+    }
+
+    request = (uint32_t)strtoul(id.c_str(), NULL, 10);
+    if (request == node->subscribeId)
+    {
+      //! A subscription answered with a status was refused (or ended)
+      node->subscribeId = 0;
+      refuseSubscribers(gs, node, CANON_REJECT);
+      return;
+    }
+    if ((c = takePending(gs, request, p)) == NULL)
+    {
+      return;
+    }
+    setId(doc, len, 0, p.hasId ? p.id.c_str() : NULL, gs->doc);
+    ulapi_socket_write(c->socket, gs->doc.data(), (ulapi_integer)gs->doc.size());
+    gs->forwardMetric->ObserveSince(start);
+  }
+
+
+  //! @brief Handle a complete binary frame from a node
+  //!
+  static void linkFrame (gatewayState *gs, const char *buf, size_t len)
+  {
+    double start = ulapi_time();
+    CrpiBinaryHeader header;
+    gatewayClient *c;
+    gatewayPending p;
+
+    memcpy(&header, buf, sizeof(header));
+    if ((c = takePending(gs, header.id, p)) == NULL)
+    {
+      return;
+    }
+    gs->doc.assign(buf, len);
+    memcpy(&gs->doc[offsetof(CrpiBinaryHeader, id)], &p.binaryId, sizeof(p.binaryId));
+    ulapi_socket_write(c->socket, gs->doc.data(), (ulapi_integer)gs->doc.size());
+    gs->forwardMetric->ObserveSince(start);
+  }
+
+
+  //! @brief Read from a node and return every complete response received so far
+  //!
+  //! @return False if the node disconnected or sent something malformed
+  //!
+  static bool linkReceive (gatewayState *gs, gatewayLink *link)
+  {
+    ulapi_integer rec;
+    const char *doc;
+    char *space;
+    size_t room, size;
+    long len = 0;
+    int found = 0;
+
+    space = link->in.space(room);
+    if (room == 0)
+    {
+      return false;
+    }
+    rec = ulapi_socket_read(link->socket, space, (ulapi_integer)room);
+    if (rec <= 0)
+    {
+      return false;
+    }
+    link->in.commit((size_t)rec);
+
+    if (link->protocol == GatewayBinary)
+    {
+      while ((len = CrpiBinary::frameLength(link->in.data(), link->in.size())) > 0)
+      {
+        linkFrame(gs, link->in.data(), (size_t)len);
+        link->in.consume((size_t)len);
+      }
+      found = (len < 0) ? -1 : 0;
+    }
+    else
+    {
+      while ((found = link->in.next(doc, size)) > 0)
+      {
+        linkDocument(gs, link, doc, size);
+      }
+    }
+    return found >= 0;
+  }
+
+
+  //! @brief Accept a pending client connection
+  //!
+  static void acceptClient (gatewayState *gs)
+  {
+    ulapi_integer client = ulapi_socket_get_connection_id(gs->server);
+    gatewayClient *c;
+
+    if (client < 0)
+    {
+      return;
+    }
+    ulapi_socket_set_blocking(client);
+    ulapi_socket_set_nodelay(client);
+    c = new gatewayClient;
+    c->socket = client;
+    c->serial = ++gs->serials;
+    if (ulapi_poller_add(gs->poller, client, ULAPI_POLL_READ, c) != ULAPI_OK)
+    {
+      ulapi_socket_close(client);
+      delete c;
+      return;
+    }
+    gs->clients[c->serial] = c;
+    gs->clientsMetric->Set((double)gs->clients.size());
+  }
+
+
+  //! @brief Disconnect a client and end its subscriptions
+  //!
+  static void dropClient (gatewayState *gs, gatewayClient *c)
+  {
+    vector<gatewaySubscriber>::iterator s;
+    size_t i;
+
+    gs->clients.erase(c->serial);
+    ulapi_poller_remove(gs->poller, c->socket);
+    ulapi_socket_close(c->socket);
+    for (i = 0; i < gs->nodes.size(); ++i)
+    {
+      for (s = gs->nodes[i]->subscribers.begin(); s != gs->nodes[i]->subscribers.end(); ++s)
+      {
+        if (s->serial == c->serial)
+        {
+          gs->nodes[i]->subscribers.erase(s);
+          subscribeNode(gs, gs->nodes[i]);
+          break;
+        }
+      }
+    }
+    delete c;
+    gs->clientsMetric->Set((double)gs->clients.size());
+  }
+
+
+  //! @brief Take the connections opened by the connector thread into the event loop, and send
+  //!        what was held for them
+  //!
+  static void finishConnects (gatewayState *gs)
+  {
+    deque<pair<gatewayLink*, ulapi_integer> > opened;
+    gatewayLink *link;
+    string backlog;
+    size_t i;
+
+    ulapi_mutex_take(gs->handle);
+    opened.swap(gs->connected);
+    ulapi_mutex_give(gs->handle);
+
+    for (i = 0; i < opened.size(); ++i)
+    {
+      link = opened[i].first;
+      link->connecting = false;
+      if (opened[i].second < 0)
+      {
+        CRPI_LOG(CRPI_LOG_WARNING, "CRPI gateway:  could not connect to %s at %s:%d",
+                 link->node->robot.c_str(), link->node->host.c_str(), link->node->port);
+        link->retry = ulapi_time() + GATEWAY_RETRY;
+        dropLink(gs, link);
+        if (link == &link->node->xml)
+        {
+          refuseSubscribers(gs, link->node, CANON_FAILURE);
+        }
+        continue;
+      }
+
+      link->socket = opened[i].second;
+      ulapi_socket_set_blocking(link->socket);
+      ulapi_socket_set_nodelay(link->socket);
+      if (ulapi_poller_add(gs->poller, link->socket, ULAPI_POLL_READ, link) != ULAPI_OK)
+      {
+        ulapi_socket_close(link->socket);
+        link->socket = -1;
+        dropLink(gs, link);
+        continue;
+      }
+      backlog.swap(link->backlog);
+      if (!backlog.empty() && ulapi_socket_write(link->socket, backlog.data(), (ulapi_integer)backlog.size()) < 0)
+      {
+        dropLink(gs, link);
+      }
+      backlog.clear();
+    }
+  }
+
+
+  //! @brief Reopen the subscriptions of robots whose connection dropped
+  //!
+  static void resubscribe (gatewayState *gs)
+  {
+    double now = ulapi_time();
+    gatewayNode *node;
+
+    for (size_t i = 0; i < gs->nodes.size(); ++i)
+    {
+      node = gs->nodes[i];
+      if (!node->subscribers.empty() && node->subscribeId == 0 && !node->xml.connecting &&
+          node->xml.socket < 0 && now >= node->xml.retry)
+      {
+        subscribeNode(gs, node);
+      }
+    }
+  }
+
+
+  //! @brief Connector thread:  opens node connections, which may block for as long as the
+  //!        network takes to give up on an unreachable node
+  //!
+  static void gatewayConnect (void *param)
+  {
+    gatewayState *gs = (gatewayState*)param;
+    gatewayLink *link;
+    ulapi_integer socket;
+
+    while (true)
+    {
+      ulapi_mutex_take(gs->handle);
+      while (gs->run && gs->connects.empty())
+      {
+        ulapi_cond_wait(gs->wake, gs->handle);
+      }
+      if (!gs->run)
+      {
+        ulapi_mutex_give(gs->handle);
+        break;
+      }
+      link = gs->connects.front();
+      gs->connects.pop_front();
+      ulapi_mutex_give(gs->handle);
+
+      socket = ulapi_socket_get_client_id(link->node->port, link->node->host.c_str());
+
+      ulapi_mutex_take(gs->handle);
+      gs->connected.push_back(make_pair(link, socket));
+      ulapi_mutex_give(gs->handle);
+      ulapi_poller_wake(gs->poller);
+    }
+  }
+
+
+  //! @brief Event loop:  serves every client and node connection
+  //!
+  static void gatewayServe (void *param)
+  {
+    gatewayState *gs = (gatewayState*)param;
+    ulapi_poll_event events[ULAPI_SOCKET_POLL_MAX];
+    gatewaySocket *s;
+    ulapi_integer n, i;
+    bool accept;
+
+    while (gs->run)
+    {
+      //! The timeout only bounds how long it takes to notice run being cleared and to retry
+      //! dropped subscriptions
+      n = ulapi_poller_wait(gs->poller, events, ULAPI_SOCKET_POLL_MAX, 0.1);
+
+      accept = false;
+      for (i = 0; i < n; ++i)
+      {
+        s = (gatewaySocket*)events[i].data;
+        if (s == NULL)
+        {
+          accept = true;
+        }
+        else if (s->kind == GatewayClient)
+        {
+          if (!clientReceive(gs, (gatewayClient*)s))
+          {
+            dropClient(gs, (gatewayClient*)s);
+          }
+        }
+        else if (s->socket >= 0 && !linkReceive(gs, (gatewayLink*)s))
+        {
+          dropLink(gs, (gatewayLink*)s);
+        }
+      }
+      if (accept)
+      {
+        acceptClient(gs);
+      }
+
+      finishConnects(gs);
+      resubscribe(gs);
+    }
+  }
+
+
+  LIBRARY_API CrpiGateway::CrpiGateway () :
+    state_(new gatewayState)
+  {
+  }
+
+
+  LIBRARY_API CrpiGateway::~CrpiGateway ()
+  {
+    Stop();
+    for (size_t i = 0; i < state_->nodes.size(); ++i)
+    {
+      delete state_->nodes[i];
+    }
+    delete state_;
+  }
+
+
+  LIBRARY_API bool CrpiGateway::AddNode (const char *robot, const char *host, int port)
+  {
+    gatewayNode *node;
+
+    if (state_->run || robot == NULL || host == NULL || state_->routes.find(robot) != state_->routes.end())
+    {
+      return false;
+    }
+    node = new gatewayNode;
+    node->robot = robot;
+    node->host = host;
+    node->port = port;
+    node->xml.node = node->bin.node = node;
+    node->xml.protocol = GatewayXml;
+    node->bin.protocol = GatewayBinary;
+    node->subscribeId = 0;
+    state_->nodes.push_back(node);
+    state_->routes[node->robot] = node;
+    return true;
+  }
+
+
+  LIBRARY_API bool CrpiGateway::LoadNodes (const char *path)
+  {
+    ifstream infile(path);
+    string robot, host;
+    int port;
+    bool flag = infile.is_open();
+
+    while (infile >> robot >> host >> port)
+    {
+      if (!AddNode(robot.c_str(), host.c_str(), port))
+      {
+        CRPI_LOG(CRPI_LOG_ERROR, "CRPI gateway:  could not add %s", robot.c_str());
+        flag = false;
+      }
+    }
+    return flag;
+  }
+
+
+  LIBRARY_API int CrpiGateway::Nodes () const
+  {
+    return (int)state_->nodes.size();
+  }
+
+
+  LIBRARY_API bool CrpiGateway::Start (int port)
+  {
+    gatewayState *gs = state_;
+    char value[16];
+    string labels;
+
+    if (gs->run)
+    {
+      return false;
+    }
+
+    snprintf(value, sizeof(value), "%d", port);
+    labels = CrpiMetrics::Label("port", value);
+    gs->clientsMetric = CrpiMetrics::Gauge("crpi_gateway_clients", "Connected gateway clients", labels);
+    gs->forwardMetric = CrpiMetrics::Histogram("crpi_gateway_forward_seconds",
+                                               "Time the gateway takes to forward a message", labels);
+    gs->failedMetric = CrpiMetrics::Counter("crpi_gateway_failed", "Requests failed because a node could not be reached",
+                                            labels);
+    gs->updatesMetric = CrpiMetrics::Counter("crpi_gateway_updates", "Status updates pushed to subscribers", labels);
+
+    gs->server = ulapi_socket_get_server_id(port);
+    gs->poller = ulapi_poller_new();
+    if (gs->server < 0 || gs->poller == NULL)
+    {
+      if (gs->server >= 0)
+      {
+        ulapi_socket_close(gs->server);
+      }
+      if (gs->poller != NULL)
+      {
+        ulapi_poller_delete(gs->poller);
+      }
+      gs->server = -1;
+      gs->poller = NULL;
+      return false;
+    }
+    ulapi_socket_set_blocking(gs->server);
+    ulapi_poller_add(gs->poller, gs->server, ULAPI_POLL_READ, NULL);
+
+    gs->handle = ulapi_mutex_new(25);
+    ulapi_lock_name(gs->handle, "CrpiGateway session");
+    gs->wake = ulapi_cond_new(26);
+    gs->run = true;
+    gs->connector = SensorHub::Instance().StartLoop(gatewayConnect, gs, HUB_BACKGROUND);
+    gs->loop = SensorHub::Instance().StartLoop(gatewayServe, gs, HUB_SENSOR);
+    if (gs->loop == NULL || gs->connector == NULL)
+    {
+      Stop();
+      return false;
+    }
+    CRPI_LOG(CRPI_LOG_INFO, "CRPI gateway:  routing %d robots on port %d", (int)gs->nodes.size(), port);
+    return true;
+  }
+
+
+  LIBRARY_API void CrpiGateway::Stop ()
+  {
+    gatewayState *gs = state_;
+    unordered_map<unsigned long, gatewayClient*>::iterator c;
+    gatewayNode *node;
+    size_t i;
+
+    if (!gs->run)
+    {
+      return;
+    }
+
+    ulapi_mutex_take(gs->handle);
+    gs->run = false;
+    ulapi_cond_broadcast(gs->wake);
+    ulapi_mutex_give(gs->handle);
+    ulapi_poller_wake(gs->poller);
+    SensorHub::Instance().JoinLoop(gs->loop);
+    SensorHub::Instance().JoinLoop(gs->connector);
+    gs->loop = gs->connector = NULL;
+
+    for (c = gs->clients.begin(); c != gs->clients.end(); ++c)
+    {
+      ulapi_poller_remove(gs->poller, c->second->socket);
+      ulapi_socket_close(c->second->socket);
+      delete c->second;
+    }
+    gs->clients.clear();
+    for (i = 0; i < gs->connected.size(); ++i)
+    {
+      if (gs->connected[i].second >= 0)
+      {
+        ulapi_socket_close(gs->connected[i].second);
+      }
+    }
+    gs->connected.clear();
+    gs->connects.clear();
+    for (i = 0; i < gs->nodes.size(); ++i)
+    {
+      node = gs->nodes[i];
+      dropLink(gs, &node->xml);
+      dropLink(gs, &node->bin);
+      node->xml.connecting = node->bin.connecting = false;
+      node->subscribers.clear();
+    }
+    gs->pending.clear();
+
+    ulapi_poller_remove(gs->poller, gs->server);
+    ulapi_socket_close(gs->server);
+    ulapi_poller_delete(gs->poller);
+    ulapi_cond_delete(gs->wake);
+    ulapi_mutex_delete(gs->handle);
+    gs->server = -1;
+    gs->poller = NULL;
+  }
+} // crpi_robot
@@ -0,0 +1,142 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_gateway.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Gateway that federates the robot servers of many CRPI nodes (e.g., the
+//  XMLInterface of every cell PC) behind a single endpoint.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_gateway_H
+#define crpi_gateway_H
+
+#if defined(_MSC_VER)
+#include "ulapi.h"
+#include "..\..\portable.h"
+#elif defined(__GNUC__)
+#include "../ulapi/src/ulapi.h"
+#include "../../portable.h"
+#endif
+
+//! @brief Binary frame command (outside the CanonCommand range) that selects the robot for the
+//!        frames that follow on a gateway connection.  The payload is the robot's name.
+//!
+#define CRPI_GATEWAY_ROUTE 0xFFFF
+
+//! @brief Seconds between attempts to reach a node that could not be connected to
+//!
+#define GATEWAY_RETRY 2.0
+
+//! @brief Most bytes held for a node while its connection is being opened
+//!
+#define GATEWAY_BACKLOG 65536
+
+namespace crpi_robot
+{
+  //! @brief Nodes, connections, and requests in flight (defined in crpi_gateway.cpp)
+  //!
+  struct gatewayState;
+
+  //! @ingroup Robot
+  //!
+  //! @brief Routes the commands of any number of clients (e.g., the plant MES) to the robots of
+  //!        many CRPI nodes by robot name, so a client connects once instead of once per cell.
+  //!        Each robot is served by a robot server (XMLInterface) on some node; the gateway keeps
+  //!        one persistent connection per robot and protocol, opened on first use and reopened
+  //!        when it drops, and multiplexes every client's requests over it:  each request is
+  //!        given a gateway-wide ID (the binary header ID, or the ID attribute of
+  //!        <CRPICommand>), and the response carrying that ID is returned to the client that
+  //!        sent the request, with the client's own ID restored.
+  //!
+  //!        Clients speak the same protocols as to a robot server, and choose the robot with
+  //!
+  //!          <CRPICommand type="Route"><String Value="cell12_ur5"/></CRPICommand>
+  //!
+  //!        (or a binary frame with command CRPI_GATEWAY_ROUTE carrying the name), which
+  //!        applies to the commands that follow, or per command with the Robot attribute:
+  //!
+  //!          <CRPICommand type="MoveTo" Robot="cell12_ur5">...</CRPICommand>
+  //!
+  //!        Status subscriptions (see XMLInterface) are fanned out:  the gateway holds one
+  //!        subscription per robot, for the fields asked for by any client at the fastest rate
+  //!        asked for, and pushes every <CRPIUpdate> to all of the robot's subscribers, tagged
+  //!        with the robot's name (<CRPIUpdate Robot="...">).  A new subscriber restarts the
+  //!        robot's subscription, so that every subscriber's first update carries all fields.
+  //!
+  //!        All connections are served by one event loop that forwards bytes as received,
+  //!        rewriting only the ID (and, for updates, adding the robot name), so the gateway adds
+  //!        well under a millisecond to each hop.  Connections to nodes are opened by a separate
+  //!        thread, so a node that is down never stalls traffic to the others.  Gateways keep no
+  //!        state beyond their connections, so any number of them can front the same nodes and
+  //!        clients can be spread across them.
+  //!
+  //! @note Requests to a robot that cannot be reached are answered with CANON_FAILURE, and
+  //!       those naming no known robot with CANON_REJECT.  On Windows, a gateway serves at most
+  //!       ULAPI_SOCKET_POLL_MAX connections (clients and nodes together).
+  //!
+  class LIBRARY_API CrpiGateway
+  {
+  public:
+
+    //! @brief Default constructor
+    //!
+    CrpiGateway ();
+
+    //! @brief Default destructor.  Stops the gateway if it is running.
+    //!
+    ~CrpiGateway ();
+
+    //! @brief Add a robot served by a node
+    //!
+    //! @param robot Name clients use for the robot (unique)
+    //! @param host  Host name or address of the node
+    //! @param port  Port of the node's server for the robot
+    //!
+    //! @return True if the robot was added, false if the name is taken or the gateway is
+    //!         running
+    //!
+    bool AddNode (const char *robot, const char *host, int port);
+
+    //! @brief Add the robots listed in a file, one per line as "<robot> <host> <port>"
+    //!
+    //! @param path The file to read
+    //!
+    //! @return True if the file was read and every robot was added, false otherwise
+    //!
+    bool LoadNodes (const char *path);
+
+    //! @brief Number of robots added
+    //!
+    int Nodes () const;
+
+    //! @brief Start serving clients
+    //!
+    //! @param port Port to accept clients on
+    //!
+    //! @return True if the gateway is serving, false if the port could not be opened or it
+    //!         was already running
+    //!
+    bool Start (int port);
+
+    //! @brief Disconnect all clients and nodes, and stop serving
+    //!
+    void Stop ();
+
+  private:
+
+    gatewayState *state_;
+
+    //! @brief Gateways own their connections and are not copied
+    //!
+    CrpiGateway (const CrpiGateway &);
+    CrpiGateway &operator= (const CrpiGateway &);
+  }; // CrpiGateway
+} // crpi_robot
+
+#endif
@@ -0,0 +1,461 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_hub.cpp
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Process-wide scheduler for the background threads of the robot and
+//  sensor interfaces.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_hub.h"
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+
+using namespace std;
+
+namespace crpi_robot
+{
+  //! @brief One periodic task.  Slots are reused once a removed task has been dropped from
+  //!        the wheel.
+  //!
+  struct hubTimer
+  {
+    HubTask task;
+    void *param;
+    unsigned long long period;
+    unsigned long long due;
+    HubPriority cls;
+    bool active;
+    bool used;
+  };
+
+  //! @brief One dedicated loop
+  //!
+  struct hubLoop
+  {
+    HubTask task;
+    void *param;
+    int cpu;
+    ulapi_task_struct *thread;
+  };
+
+  //! @brief Hub state.  Tasks are filed in the wheel slot of their due tick (modulo the wheel
+  //!        size); a slot may hold tasks that are due on later turns of the wheel.
+  //!
+  struct hubState
+  {
+    ulapi_mutex_struct *mutex;
+    void *cond;
+
+    vector<hubTimer> timers;
+    vector<int> wheel[HUB_WHEEL_SLOTS];
+    unsigned long long current;
+    double origin;
+    int running;
+    int periodic;
+    double worst;
+    ulapi_task_struct *timerThread;
+
+    std::atomic<int> affinity[HUB_CLASSES];
+    std::atomic<bool> repin;
+    std::atomic<int> loops;
+  };
+
+
+  //! @brief Tick (of HUB_TICK) that time t falls in
+  //!
+  static unsigned long long hubTick (const hubState *state, double t)
+  {
+    return (t <= state->origin) ? 0 : (unsigned long long)((t - state->origin) / HUB_TICK);
+  }
+
+
+  //! @brief ulapi priority of a class
+  //!
+  static ulapi_prio hubPriority (HubPriority cls)
+  {
+    switch (cls)
+    {
+    case HUB_REALTIME:
+      return ulapi_prio_highest();
+    case HUB_SENSOR:
+      return ulapi_prio_next_lower(ulapi_prio_highest());
+    case HUB_MONITOR:
+      return ulapi_prio_next_higher(ulapi_prio_lowest());
+    default:
+      return ulapi_prio_lowest();
+    }
+  }
+
+
+  //! @brief Whether attributes ask for anything beyond what ulapi_task_attr_init sets
+  //!
+  static bool hubCustom (const ulapi_task_attr *attr)
+  {
+    return (attr != NULL && (attr->policy != ULAPI_SCHED_NORMAL || attr->cpu >= 0 ||
+                             attr->stack_size > 0 || attr->lock_memory));
+  }
+
+
+  //! @brief Start a thread for a class, or with explicit attributes
+  //!
+  static bool hubStart (hubState *state, ulapi_task_struct *thread, HubTask code, void *param,
+                        HubPriority cls, const ulapi_task_attr *attr)
+  {
+    ulapi_task_attr custom;
+    ulapi_result result;
+
+    if (!hubCustom(attr))
+    {
+      return (ulapi_task_start(thread, code, param, hubPriority(cls), 0) == ULAPI_OK);
+    }
+    custom = *attr;
+    if (custom.cpu < 0)
+    {
+      custom.cpu = state->affinity[cls];
+    }
+    result = ulapi_task_start_attr(thread, code, param, &custom);
+    //! ULAPI_IMPL_ERROR:  running, but without the privileges asked for
+    return (result == ULAPI_OK || result == ULAPI_IMPL_ERROR);
+  }
+
+
+  //! @brief Set while a thread is running periodic tasks, so RemovePeriodic can tell when it
+  //!        is called from one
+  //!
+  static thread_local bool onTimerThread = false;
+
+
+  //! @brief Entry point of a loop thread
+  //!
+  static void runLoop (void *param)
+  {
+    hubLoop *loop = (hubLoop*)param;
+
+    if (loop->cpu >= 0)
+    {
+      ulapi_self_set_affinity(loop->cpu);
+    }
+    loop->task(loop->param);
+  }
+
+
+  LIBRARY_API SensorHub &SensorHub::Instance ()
+  {
+    //! Deliberately leaked:  static interface objects may unregister after static destructors
+    static SensorHub *hub = new SensorHub();
+    return *hub;
+  }
+
+
+  SensorHub::SensorHub ()
+  {
+    state_ = new hubState();
+    state_->mutex = ulapi_mutex_new(0);
+    ulapi_lock_name(state_->mutex, "SensorHub");
+    state_->cond = ulapi_cond_new(0);
+    state_->current = 0;
+    state_->origin = ulapi_time();
+    state_->running = -1;
+    state_->periodic = 0;
+    state_->worst = 0.0;
+    state_->timerThread = NULL;
+    for (int i = 0; i < HUB_CLASSES; ++i)
+    {
+      state_->affinity[i] = -1;
+    }
+    state_->repin = false;
+    state_->loops = 0;
+  }
+
+
+  LIBRARY_API bool SensorHub::SetAffinity (HubPriority cls, int cpu)
+  {
+    if (cls < 0 || cls >= HUB_CLASSES || cpu >= ulapi_cpu_count())
+    {
+      return false;
+    }
+    state_->affinity[cls] = (cpu < 0) ? -1 : cpu;
+    if (cls == HUB_MONITOR)
+    {
+      state_->repin = true;
+    }
+    return true;
+  }
+
+
+  LIBRARY_API int SensorHub::GetAffinity (HubPriority cls) const
+  {
+    return (cls < 0 || cls >= HUB_CLASSES) ? -1 : state_->affinity[cls].load();
+  }
+
+
+  LIBRARY_API int SensorHub::AddPeriodic (HubTask task, void *param, double period, HubPriority cls)
+  {
+    hubTimer timer;
+    size_t id;
+
+    if (task == NULL)
+    {
+      return -1;
+    }
+    timer.task = task;
+    timer.param = param;
+    timer.period = (unsigned long long)((period / HUB_TICK) + 0.5);
+    timer.period = (timer.period < 1) ? 1 : timer.period;
+    timer.cls = (cls < 0 || cls >= HUB_CLASSES) ? HUB_BACKGROUND : cls;
+    timer.active = timer.used = true;
+
+    ulapi_mutex_take(state_->mutex);
+    timer.due = max(hubTick(state_, ulapi_time()), state_->current) + timer.period;
+    for (id = 0; id < state_->timers.size() && state_->timers[id].used; ++id);
+    if (id == state_->timers.size())
+    {
+      state_->timers.push_back(timer);
+    }
+    else
+    {
+      state_->timers[id] = timer;
+    }
+    state_->wheel[timer.due % HUB_WHEEL_SLOTS].push_back((int)id);
+    ++state_->periodic;
+
+    if (state_->timerThread == NULL)
+    {
+      state_->timerThread = ulapi_task_new();
+      ulapi_task_start(state_->timerThread, runTimers, state_, hubPriority(HUB_MONITOR), 0);
+    }
+    else
+    {
+      //! The timer thread may be asleep until a later deadline
+      ulapi_cond_broadcast(state_->cond);
+    }
+    ulapi_mutex_give(state_->mutex);
+    return (int)id;
+  }
+
+
+  LIBRARY_API void SensorHub::RemovePeriodic (int id)
+  {
+    if (id < 0)
+    {
+      return;
+    }
+    ulapi_mutex_take(state_->mutex);
+    if ((size_t)id < state_->timers.size() && state_->timers[id].active)
+    {
+      //! The wheel drops the entry (and frees the slot) when it next comes due
+      state_->timers[id].active = false;
+      --state_->periodic;
+      while (state_->running == id && !onTimerThread)
+      {
+        ulapi_cond_wait(state_->cond, state_->mutex);
+      }
+    }
+    ulapi_mutex_give(state_->mutex);
+  }
+
+
+  LIBRARY_API void *SensorHub::StartLoop (HubTask task, void *param, HubPriority cls)
+  {
+    return startLoop(task, param, cls, NULL);
+  }
+
+
+  LIBRARY_API void *SensorHub::StartLoop (HubTask task, void *param, HubPriority cls,
+                                          const ulapi_task_attr &attr)
+  {
+    return startLoop(task, param, cls, &attr);
+  }
+
+
+  LIBRARY_API bool SensorHub::StartTask (ulapi_task_struct *task, HubTask code, void *param,
+                                         HubPriority cls, const ulapi_task_attr *attr)
+  {
+    if (task == NULL || code == NULL)
+    {
+      return false;
+    }
+    cls = (cls < 0 || cls >= HUB_CLASSES) ? HUB_BACKGROUND : cls;
+    return hubStart(state_, task, code, param, cls, attr);
+  }
+
+
+  void *SensorHub::startLoop (HubTask task, void *param, HubPriority cls, const ulapi_task_attr *attr)
+  {
+    hubLoop *loop;
+
+    if (task == NULL)
+    {
+      return NULL;
+    }
+    cls = (cls < 0 || cls >= HUB_CLASSES) ? HUB_BACKGROUND : cls;
+    loop = new hubLoop();
+    loop->task = task;
+    loop->param = param;
+    //! Explicit attributes pin the thread as it starts
+    loop->cpu = hubCustom(attr) ? -1 : state_->affinity[cls].load();
+    loop->thread = ulapi_task_new();
+    if (loop->thread == NULL || !hubStart(state_, loop->thread, runLoop, loop, cls, attr))
+    {
+      if (loop->thread != NULL)
+      {
+        ulapi_task_delete(loop->thread);
+      }
+      delete loop;
+      return NULL;
+    }
+    ++state_->loops;
+    return loop;
+  }
+
+
+  LIBRARY_API void SensorHub::JoinLoop (void *loop)
+  {
+    hubLoop *l = (hubLoop*)loop;
+
+    if (l == NULL)
+    {
+      return;
+    }
+    ulapi_task_join(l->thread, NULL);
+    ulapi_task_delete(l->thread);
+    delete l;
+    --state_->loops;
+  }
+
+
+  LIBRARY_API int SensorHub::Periodic () const
+  {
+    int n;
+
+    ulapi_mutex_take(state_->mutex);
+    n = state_->periodic;
+    ulapi_mutex_give(state_->mutex);
+    return n;
+  }
+
+
+  LIBRARY_API int SensorHub::Loops () const
+  {
+    return state_->loops;
+  }
+
+
+  LIBRARY_API double SensorHub::WorstLateness () const
+  {
+    double worst;
+
+    ulapi_mutex_take(state_->mutex);
+    worst = state_->worst;
+    ulapi_mutex_give(state_->mutex);
+    return worst;
+  }
+
+
+  void SensorHub::runTimers (void *param)
+  {
+    hubState *state = (hubState*)param;
+    vector<pair<int, int> > ready;
+    unsigned long long now, next;
+    double late, wait;
+    size_t i, j;
+    int id;
+
+    onTimerThread = true;
+    ulapi_mutex_take(state->mutex);
+    for (;;)
+    {
+      if (state->repin.exchange(false))
+      {
+        ulapi_self_set_affinity(state->affinity[HUB_MONITOR]);
+      }
+
+      now = hubTick(state, ulapi_time());
+      for (; state->current <= now; ++state->current)
+      {
+        //! Take the tasks due this tick out of the slot, leaving those due on later turns
+        vector<int> &slot = state->wheel[state->current % HUB_WHEEL_SLOTS];
+        ready.clear();
+        for (i = 0, j = 0; i < slot.size(); ++i)
+        {
+          hubTimer &timer = state->timers[slot[i]];
+          if (!timer.active)
+          {
+            timer.used = false;
+          }
+          else if (timer.due <= state->current)
+          {
+            ready.push_back(make_pair((int)timer.cls, slot[i]));
+          }
+          else
+          {
+            slot[j++] = slot[i];
+          }
+        }
+        slot.resize(j);
+        sort(ready.begin(), ready.end());
+
+        for (i = 0; i < ready.size(); ++i)
+        {
+          id = ready[i].second;
+          HubTask task = state->timers[id].task;
+          void *arg = state->timers[id].param;
+          if (!state->timers[id].active)
+          {
+            //! Removed by an earlier task of this tick
+            state->timers[id].used = false;
+            continue;
+          }
+          late = ulapi_time() - (state->origin + (state->timers[id].due * HUB_TICK));
+          state->worst = max(state->worst, late);
+
+          state->running = id;
+          ulapi_mutex_give(state->mutex);
+          task(arg);
+          ulapi_mutex_take(state->mutex);
+          state->running = -1;
+          ulapi_cond_broadcast(state->cond);
+
+          hubTimer &timer = state->timers[id];
+          if (!timer.active)
+          {
+            timer.used = false;
+            continue;
+          }
+          //! Runs missed while this one was late are skipped, not repeated
+          timer.due += timer.period;
+          next = hubTick(state, ulapi_time());
+          if (timer.due <= next)
+          {
+            timer.due = next + 1;
+          }
+          state->wheel[timer.due % HUB_WHEEL_SLOTS].push_back(id);
+        }
+      }
+
+      //! Sleep until the next task is due, or until one is added
+      next = 0;
+      for (i = 0; i < state->timers.size(); ++i)
+      {
+        if (state->timers[i].active && (next == 0 || state->timers[i].due < next))
+        {
+          next = state->timers[i].due;
+        }
+      }
+      wait = (next == 0) ? 1.0 : (state->origin + (next * HUB_TICK)) - ulapi_time();
+      if (wait > 0.0)
+      {
+        ulapi_cond_timedwait(state->cond, state->mutex, wait);
+      }
+    }
+  }
+} // namespace crpi_robot
@@ -0,0 +1,165 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_hub.h
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Process-wide scheduler for the background threads of the robot and
+//  sensor interfaces.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_hub_H
+#define crpi_hub_H
+
+#if defined(_MSC_VER)
+#include "ulapi.h"
+#include "..\..\portable.h"
+#elif defined(__GNUC__)
+#include "../ulapi/src/ulapi.h"
+#include "../../portable.h"
+#endif
+
+//! @brief Number of priority classes, and the resolution (s) and size of the timer wheel
+//!
+#define HUB_CLASSES 4
+#define HUB_TICK 0.001
+#define HUB_WHEEL_SLOTS 512
+
+namespace crpi_robot
+{
+  //! @brief Priority classes of hub work, from most to least urgent
+  //!
+  typedef enum
+  {
+    HUB_REALTIME = 0, //! Control loops that the controller or device times
+    HUB_SENSOR,       //! Sensor acquisition
+    HUB_MONITOR,      //! Keep-alives and status monitors
+    HUB_BACKGROUND    //! Anything that can wait
+  } HubPriority;
+
+  //! @brief Work scheduled on the hub
+  //!
+  typedef void (*HubTask)(void *param);
+
+  //! @brief Timer wheel, loops, and class settings (defined in crpi_hub.cpp)
+  //!
+  struct hubState;
+
+  //! @ingroup Robot
+  //!
+  //! @brief Shared runtime for the interfaces' background work, so that a cell PC running many
+  //!        robots and sensors is not left with a dozen unsynchronized threads.  Periodic work
+  //!        (keep-alives, status polls) is registered on a single timer wheel served by one
+  //!        thread, which runs whatever is due in each tick in priority-class order.  Loops
+  //!        that must block on a device or SDK get a dedicated thread, started with the
+  //!        priority of their class and pinned to the class's processor, if one is set.
+  //!
+  //! @note Periodic tasks share the timer thread, so they should return promptly; anything that
+  //!       waits on I/O for long belongs in a loop.
+  //!
+  class LIBRARY_API SensorHub
+  {
+  public:
+    //! @brief The process's hub (created on first use and never destroyed, so that interfaces
+    //!        torn down during exit can still unregister)
+    //!
+    static SensorHub &Instance ();
+
+    //! @brief Pin a priority class to a processor.  Loops started afterward, and the timer thread
+    //!        (for HUB_MONITOR), run only on that processor.
+    //!
+    //! @param cls The priority class
+    //! @param cpu The processor, numbered from 0 (-1 for any)
+    //!
+    //! @return True if the processor exists, false otherwise
+    //!
+    bool SetAffinity (HubPriority cls, int cpu);
+
+    //! @brief The processor a class is pinned to (-1 for any)
+    //!
+    int GetAffinity (HubPriority cls) const;
+
+    //! @brief Run a task periodically on the timer thread.  A run that falls behind is not
+    //!        repeated to catch up; the next one is scheduled a full period later.
+    //!
+    //! @param task   The work to run
+    //! @param param  Passed to the task
+    //! @param period Seconds between runs (rounded to whole ticks of HUB_TICK)
+    //! @param cls    Order among the tasks due in the same tick
+    //!
+    //! @return Identifier of the task, for RemovePeriodic
+    //!
+    int AddPeriodic (HubTask task, void *param, double period, HubPriority cls = HUB_MONITOR);
+
+    //! @brief Stop running a periodic task.  Waits for a run that is in progress to finish
+    //!        (unless called from the task itself), so the task's data can be freed afterward.
+    //!
+    //! @param id Identifier returned by AddPeriodic (ignored if negative)
+    //!
+    void RemovePeriodic (int id);
+
+    //! @brief Start a dedicated thread for work that blocks (e.g., waiting on a device).  The
+    //!        task runs once and should return when its owner asks it to stop.
+    //!
+    //! @param task  The loop to run
+    //! @param param Passed to the task
+    //! @param cls   Priority class of the thread
+    //!
+    //! @return Handle of the loop, for JoinLoop, or NULL if the thread could not be started
+    //!
+    void *StartLoop (HubTask task, void *param, HubPriority cls = HUB_SENSOR);
+
+    //! @brief Start a loop with explicit task attributes (e.g., the servo-rate thread of a robot
+    //!        configured with a <RealTime> tag).  Attributes left at their defaults (see
+    //!        ulapi_task_attr_init) give the same thread as StartLoop above; a processor of -1
+    //!        takes the class's.  If the real-time scheduling or memory lock is refused, the
+    //!        thread still runs, with normal scheduling.
+    //!
+    void *StartLoop (HubTask task, void *param, HubPriority cls, const ulapi_task_attr &attr);
+
+    //! @brief Start a task the caller owns (and stops, joins, and deletes) with the priority of a
+    //!        class, or with explicit attributes as for StartLoop
+    //!
+    //! @return True if the task was started, false otherwise
+    //!
+    bool StartTask (ulapi_task_struct *task, HubTask code, void *param, HubPriority cls,
+                    const ulapi_task_attr *attr = NULL);
+
+    //! @brief Wait for a loop to return and release it
+    //!
+    //! @param loop Handle returned by StartLoop (ignored if NULL)
+    //!
+    void JoinLoop (void *loop);
+
+    //! @brief Number of registered periodic tasks and running loops
+    //!
+    int Periodic () const;
+    int Loops () const;
+
+    //! @brief Largest delay (s) seen between when a periodic task was due and when it started
+    //!
+    double WorstLateness () const;
+
+  private:
+    SensorHub ();
+    SensorHub (const SensorHub &) = delete;
+    SensorHub &operator= (const SensorHub &) = delete;
+
+    //! @brief Timer thread
+    //!
+    static void runTimers (void *param);
+
+    //! @brief Both forms of StartLoop (attr NULL for the class defaults)
+    //!
+    void *startLoop (HubTask task, void *param, HubPriority cls, const ulapi_task_attr *attr);
+
+    hubState *state_;
+  }; // SensorHub
+} // namespace crpi_robot
+
+#endif
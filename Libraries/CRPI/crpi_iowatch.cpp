@@ -0,0 +1,189 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_iowatch.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Edge-triggered I/O notification definitions.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_iowatch.h"
+
+using namespace std;
+
+namespace crpi_robot
+{
+  LIBRARY_API CrpiIOWatch::CrpiIOWatch () :
+    nextId_(0),
+    seen_(false)
+  {
+    mutex_ = ulapi_mutex_new(27);
+    ulapi_lock_name(mutex_, "CrpiIOWatch");
+    cond_ = ulapi_cond_new(27);
+  }
+
+
+  LIBRARY_API CrpiIOWatch::~CrpiIOWatch ()
+  {
+    ulapi_cond_delete(cond_);
+    ulapi_mutex_delete(mutex_);
+  }
+
+
+  LIBRARY_API void CrpiIOWatch::Update (const RobotStateSnapshot &state)
+  {
+    vector<watch>::iterator iter;
+    CrpiIOEvent event;
+    bool before, after, changed = false;
+    int i;
+
+    ulapi_mutex_take(mutex_);
+    if (seen_ && state.sequence == current_.sequence)
+    {
+      ulapi_mutex_give(mutex_);
+      return;
+    }
+
+    //! The first snapshot is only a baseline
+    if (seen_)
+    {
+      for (i = 0; i < CRPI_IO_MAX && !changed; ++i)
+      {
+        changed = (state.dio[i] != current_.dio[i]) || (state.aio[i] != current_.aio[i]);
+      }
+    }
+
+    event.timestamp = state.timestamp;
+    for (iter = watches_.begin(); changed && iter != watches_.end(); ++iter)
+    {
+      if (iter->analog)
+      {
+        before = current_.aio[iter->channel] > iter->threshold;
+        after = state.aio[iter->channel] > iter->threshold;
+        event.value = state.aio[iter->channel];
+      }
+      else
+      {
+        before = current_.dio[iter->channel];
+        after = state.dio[iter->channel];
+        event.value = after ? 1.0 : 0.0;
+      }
+      if (before == after || !(iter->edges & (after ? IO_RISE : IO_FALL)))
+      {
+        continue;
+      }
+      event.channel = iter->channel;
+      event.analog = iter->analog;
+      event.rising = after;
+      iter->callback(event);
+    }
+
+    //! Waiters are also woken by the baseline, which may already be what they wait for
+    changed = changed || !seen_;
+    current_ = state;
+    seen_ = true;
+    if (changed)
+    {
+      ulapi_cond_broadcast(cond_);
+    }
+    ulapi_mutex_give(mutex_);
+  }
+
+
+  LIBRARY_API int CrpiIOWatch::AddDigital (int channel, int edges, CrpiIOCallback callback)
+  {
+    return add(channel, false, 0.0, edges, callback);
+  }
+
+
+  LIBRARY_API int CrpiIOWatch::AddAnalog (int channel, double threshold, int edges, CrpiIOCallback callback)
+  {
+    return add(channel, true, threshold, edges, callback);
+  }
+
+
+  LIBRARY_API void CrpiIOWatch::Remove (int id)
+  {
+    vector<watch>::iterator iter;
+
+    ulapi_mutex_take(mutex_);
+    for (iter = watches_.begin(); iter != watches_.end(); ++iter)
+    {
+      if (iter->id == id)
+      {
+        watches_.erase(iter);
+        break;
+      }
+    }
+    ulapi_mutex_give(mutex_);
+  }
+
+
+  LIBRARY_API bool CrpiIOWatch::WaitDigital (int channel, bool value, double timeout)
+  {
+    if (channel < 0 || channel >= CRPI_IO_MAX)
+    {
+      return false;
+    }
+    return waitFor([this, channel, value] () { return current_.dio[channel] == value; }, timeout);
+  }
+
+
+  LIBRARY_API bool CrpiIOWatch::WaitAnalog (int channel, double threshold, bool above, double timeout)
+  {
+    if (channel < 0 || channel >= CRPI_IO_MAX)
+    {
+      return false;
+    }
+    return waitFor([this, channel, threshold, above] () { return (current_.aio[channel] > threshold) == above; },
+                   timeout);
+  }
+
+
+  int CrpiIOWatch::add (int channel, bool analog, double threshold, int edges, CrpiIOCallback callback)
+  {
+    watch w;
+
+    if (channel < 0 || channel >= CRPI_IO_MAX || !callback)
+    {
+      return -1;
+    }
+    w.channel = channel;
+    w.analog = analog;
+    w.threshold = threshold;
+    w.edges = edges;
+    w.callback = callback;
+
+    ulapi_mutex_take(mutex_);
+    w.id = nextId_++;
+    watches_.push_back(w);
+    ulapi_mutex_give(mutex_);
+    return w.id;
+  }
+
+
+  bool CrpiIOWatch::waitFor (function<bool ()> ready, double timeout)
+  {
+    double deadline = ulapi_time() + timeout, remaining;
+    bool done;
+
+    ulapi_mutex_take(mutex_);
+    //! Woken by Update when an input changes, so the wait ends within one feedback cycle
+    while (!(done = seen_ && ready()))
+    {
+      remaining = deadline - ulapi_time();
+      if (remaining <= 0.0)
+      {
+        break;
+      }
+      ulapi_cond_timedwait(cond_, mutex_, remaining);
+    }
+    ulapi_mutex_give(mutex_);
+    return done;
+  }
+} // namespace crpi_robot
@@ -0,0 +1,169 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_iowatch.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Edge-triggered I/O notifications for the robot interfaces.
+//
+//  Instead of looping on GetRobotIO, an application registers the inputs it
+//  cares about.  Each new state snapshot from the driver is compared with
+//  the one before, and callbacks are run when a digital input rises or
+//  falls or an analog input crosses a threshold.  Threads blocked in
+//  WaitForDI or WaitForAI are woken on the same change, so they react
+//  within one feedback cycle rather than one polling interval.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_iowatch_H
+#define crpi_iowatch_H
+
+#include "crpi.h"
+#include <functional>
+#include <vector>
+
+namespace crpi_robot
+{
+  //! @brief Edges that trigger a watch (analog inputs "rise" when they go above the threshold)
+  //!
+  typedef enum
+  {
+    IO_RISE = 1,
+    IO_FALL = 2,
+    IO_EDGE = 3 //! Either
+  } CrpiIOEdge;
+
+  //! @brief One change reported to a watch
+  //!
+  struct CrpiIOEvent
+  {
+    //! @brief Input channel, and whether it is analog
+    //!
+    int channel;
+    bool analog;
+
+    //! @brief Whether the input rose (or went above the threshold)
+    //!
+    bool rising;
+
+    //! @brief The input's new value (0 or 1 for digital inputs)
+    //!
+    double value;
+
+    //! @brief Time (s, ulapi_time) of the snapshot in which the change was seen
+    //!
+    double timestamp;
+  };
+
+  typedef std::function<void (const CrpiIOEvent &)> CrpiIOCallback;
+
+  //! @ingroup Robot
+  //!
+  //! @brief Compares consecutive I/O states and reports the changes.  The owner (CrpiRobot)
+  //!        feeds it snapshots from one thread with Update; the other methods are called from
+  //!        any thread.
+  //!
+  class LIBRARY_API CrpiIOWatch
+  {
+  public:
+    //! @brief Default constructor
+    //!
+    CrpiIOWatch ();
+
+    //! @brief Default destructor.  Waiters must have returned.
+    //!
+    ~CrpiIOWatch ();
+
+    //! @brief Compare a new snapshot with the last one, run the callbacks of the inputs that
+    //!        changed, and wake the waiters
+    //!
+    //! @param state The latest state snapshot (ignored if its sequence has been seen)
+    //!
+    void Update (const RobotStateSnapshot &state);
+
+    //! @brief Register a callback on a digital input
+    //!
+    //! @param channel  Input channel
+    //! @param edges    Edges that run the callback (CrpiIOEdge)
+    //! @param callback Run from the thread calling Update; it must not add or remove watches,
+    //!                 or wait
+    //!
+    //! @return An identifier for Remove, or -1 if the channel is out of range
+    //!
+    int AddDigital (int channel, int edges, CrpiIOCallback callback);
+
+    //! @brief Register a callback on an analog input crossing a threshold
+    //!
+    //! @param channel   Input channel
+    //! @param threshold Level whose crossing is reported
+    //! @param edges     Crossings that run the callback (CrpiIOEdge)
+    //! @param callback  As for AddDigital
+    //!
+    //! @return An identifier for Remove, or -1 if the channel is out of range
+    //!
+    int AddAnalog (int channel, double threshold, int edges, CrpiIOCallback callback);
+
+    //! @brief Unregister a callback
+    //!
+    void Remove (int id);
+
+    //! @brief Wait until a digital input has a value
+    //!
+    //! @param channel Input channel
+    //! @param value   The value to wait for
+    //! @param timeout Seconds to wait
+    //!
+    //! @return True if the input has the value (at once if it already does), false on timeout
+    //!
+    bool WaitDigital (int channel, bool value, double timeout);
+
+    //! @brief Wait until an analog input is above (or below) a threshold
+    //!
+    //! @return True if the input is past the threshold, false on timeout
+    //!
+    bool WaitAnalog (int channel, double threshold, bool above, double timeout);
+
+  private:
+    struct watch
+    {
+      int id;
+      int channel;
+      bool analog;
+      double threshold;
+      int edges;
+      CrpiIOCallback callback;
+    };
+
+    //! @brief Register a watch
+    //!
+    int add (int channel, bool analog, double threshold, int edges, CrpiIOCallback callback);
+
+    //! @brief Wait until the current state satisfies a condition
+    //!
+    bool waitFor (std::function<bool ()> ready, double timeout);
+
+    //! @brief Registered watches and the next identifier
+    //!
+    std::vector<watch> watches_;
+    int nextId_;
+
+    //! @brief The last state seen, and whether there has been one
+    //!
+    RobotStateSnapshot current_;
+    bool seen_;
+
+    //! @brief Guards everything above; cond_ is broadcast when the inputs change
+    //!
+    ulapi_mutex_struct *mutex_;
+    void *cond_;
+
+    CrpiIOWatch (const CrpiIOWatch &);
+    CrpiIOWatch &operator= (const CrpiIOWatch &);
+  }; // CrpiIOWatch
+} // namespace crpi_robot
+
+#endif
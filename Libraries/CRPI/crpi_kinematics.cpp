@@ -0,0 +1,1143 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_kinematics.cpp
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Forward and inverse kinematics of the supported arms, for checking
+//  reachability and choosing configurations before commanding a robot.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_kinematics.h"
+
+#include <cmath>
+#include <cfloat>
+
+using namespace std;
+
+#define KIN_PI 3.14159265358979323846
+#define KIN_DEG (KIN_PI / 180.0)
+#define KIN_EPS 1e-9
+
+//! @brief Weight (mm/rad) of orientation error against position error, iterations, and damping
+//!        of the numerical solver
+//!
+#define KIN_ORIENT_WEIGHT 200.0
+#define KIN_ITERATIONS 100
+#define KIN_DAMPING 1e-4
+
+namespace crpi_robot
+{
+  //! Frames are a 3x3 rotation (row-major, f[0] to f[8]) and a position (f[9] to f[11])
+
+  static void identity (double *f)
+  {
+    for (int i = 0; i < 12; ++i)
+    {
+      f[i] = (i == 0 || i == 4 || i == 8) ? 1.0 : 0.0;
+    }
+  }
+
+
+  //! Translation then R = Rz(zr) Ry(yr) Rx(xr), angles in radians
+  static void rpyFrame (double x, double y, double z, double xr, double yr, double zr, double *f)
+  {
+    double cx = cos(xr), sx = sin(xr), cy = cos(yr), sy = sin(yr), cz = cos(zr), sz = sin(zr);
+    f[0] = cz * cy;
+    f[1] = (cz * sy * sx) - (sz * cx);
+    f[2] = (cz * sy * cx) + (sz * sx);
+    f[3] = sz * cy;
+    f[4] = (sz * sy * sx) + (cz * cx);
+    f[5] = (sz * sy * cx) - (cz * sx);
+    f[6] = -sy;
+    f[7] = cy * sx;
+    f[8] = cy * cx;
+    f[9] = x;
+    f[10] = y;
+    f[11] = z;
+  }
+
+
+  //! Denavit-Hartenberg link:  Tz(d) Tx(a) Rx(alpha)
+  static void dhFrame (double d, double a, double alpha, double *f)
+  {
+    rpyFrame(a, 0.0, d, alpha, 0.0, 0.0, f);
+  }
+
+
+  //! Roll-pitch-yaw angles (deg) of a rotation, with the gimbal lock handling of
+  //! Math::quaternionToRPY
+  static void framePose (const double *f, robotPose &pose)
+  {
+    pose.x = f[9];
+    pose.y = f[10];
+    pose.z = f[11];
+    pose.yrot = atan2(-f[6], sqrt((f[0] * f[0]) + (f[3] * f[3])));
+    if (fabs(pose.yrot - (KIN_PI / 2.0)) < 1.0e-4)
+    {
+      pose.xrot = atan2(f[1], f[4]);
+      pose.yrot = KIN_PI / 2.0;
+      pose.zrot = 0.0;
+    }
+    else if (fabs(pose.yrot + (KIN_PI / 2.0)) < 1.0e-4)
+    {
+      pose.xrot = -atan2(f[1], f[4]);
+      pose.yrot = -KIN_PI / 2.0;
+      pose.zrot = 0.0;
+    }
+    else
+    {
+      pose.xrot = atan2(f[7], f[8]);
+      pose.zrot = atan2(f[3], f[0]);
+    }
+    pose.xrot /= KIN_DEG;
+    pose.yrot /= KIN_DEG;
+    pose.zrot /= KIN_DEG;
+  }
+
+
+  //! out = a b (out must not be a or b)
+  static void compose (const double *a, const double *b, double *out)
+  {
+    for (int r = 0; r < 3; ++r)
+    {
+      for (int c = 0; c < 3; ++c)
+      {
+        out[(r * 3) + c] = (a[r * 3] * b[c]) + (a[(r * 3) + 1] * b[3 + c]) + (a[(r * 3) + 2] * b[6 + c]);
+      }
+      out[9 + r] = (a[r * 3] * b[9]) + (a[(r * 3) + 1] * b[10]) + (a[(r * 3) + 2] * b[11]) + a[9 + r];
+    }
+  }
+
+
+  static void invert (const double *f, double *out)
+  {
+    for (int r = 0; r < 3; ++r)
+    {
+      for (int c = 0; c < 3; ++c)
+      {
+        out[(r * 3) + c] = f[(c * 3) + r];
+      }
+    }
+    for (int r = 0; r < 3; ++r)
+    {
+      out[9 + r] = -((out[r * 3] * f[9]) + (out[(r * 3) + 1] * f[10]) + (out[(r * 3) + 2] * f[11]));
+    }
+  }
+
+
+  //! f = f Rz(q), in place
+  static void rotateZ (double *f, double q)
+  {
+    double c = cos(q), s = sin(q);
+    for (int r = 0; r < 3; ++r)
+    {
+      double x = f[r * 3], y = f[(r * 3) + 1];
+      f[r * 3] = (c * x) + (s * y);
+      f[(r * 3) + 1] = (c * y) - (s * x);
+    }
+  }
+
+
+  //! f = f Rz(q) link
+  static void advance (double *f, double q, const double *link)
+  {
+    double t[12];
+    rotateZ(f, q);
+    compose(f, link, t);
+    for (int i = 0; i < 12; ++i)
+    {
+      f[i] = t[i];
+    }
+  }
+
+
+  //! out = R v, or R^T v
+  static void rotate (const double *R, const double *v, double *out)
+  {
+    for (int r = 0; r < 3; ++r)
+    {
+      out[r] = (R[r * 3] * v[0]) + (R[(r * 3) + 1] * v[1]) + (R[(r * 3) + 2] * v[2]);
+    }
+  }
+
+
+  static void rotateT (const double *R, const double *v, double *out)
+  {
+    for (int c = 0; c < 3; ++c)
+    {
+      out[c] = (R[c] * v[0]) + (R[3 + c] * v[1]) + (R[6 + c] * v[2]);
+    }
+  }
+
+
+  static double wrap (double q)
+  {
+    q = fmod(q, 2.0 * KIN_PI);
+    if (q > KIN_PI)
+    {
+      q -= 2.0 * KIN_PI;
+    }
+    else if (q <= -KIN_PI)
+    {
+      q += 2.0 * KIN_PI;
+    }
+    return q;
+  }
+
+
+  //! Solve a cos (q) + b sin (q) = k, returning the number of solutions (any q solves it if a and
+  //! b vanish and k does, in which case free is used)
+  static int cosSin (double a, double b, double k, double free, double *q)
+  {
+    double r = sqrt((a * a) + (b * b));
+    if (r < KIN_EPS)
+    {
+      q[0] = free;
+      return (fabs(k) < 1e-6) ? 1 : 0;
+    }
+    double ratio = k / r;
+    if (fabs(ratio) > 1.0 + 1e-9)
+    {
+      return 0;
+    }
+    ratio = (ratio > 1.0) ? 1.0 : ((ratio < -1.0) ? -1.0 : ratio);
+    double phi = atan2(b, a), d = acos(ratio);
+    q[0] = wrap(phi + d);
+    q[1] = wrap(phi - d);
+    return (d < KIN_EPS) ? 1 : 2;
+  }
+
+
+  //! Solve v = Rz(q1) A Rz(q2) w for the pairs (q1, q2), for a rotation A, returning their
+  //! number.  This is the subproblem of a spherical joint triple:  the shoulder and wrist of the
+  //! LWR 4, and the wrist of the UR arms.
+  static int rotatePair (const double *A, const double *w, const double *v, double *q1, double *q2)
+  {
+    //! A Rz(q2) w keeps the component of w along z, so only q1 decides if it lines up with v
+    double a = (A[2] * v[0]) + (A[5] * v[1]),
+           b = (A[2] * v[1]) - (A[5] * v[0]),
+           k = w[2] - (A[8] * v[2]);
+    int n = cosSin(a, b, k, 0.0, q1);
+    for (int i = 0; i < n; ++i)
+    {
+      double c = cos(q1[i]), s = sin(q1[i]), r[3], m[3];
+      r[0] = (c * v[0]) + (s * v[1]);
+      r[1] = (c * v[1]) - (s * v[0]);
+      r[2] = v[2];
+      rotateT(A, r, m);
+      if (sqrt((m[0] * m[0]) + (m[1] * m[1])) < KIN_EPS || sqrt((w[0] * w[0]) + (w[1] * w[1])) < KIN_EPS)
+      {
+        q2[i] = 0.0;
+      }
+      else
+      {
+        q2[i] = wrap(atan2(m[1], m[0]) - atan2(w[1], w[0]));
+      }
+    }
+    return n;
+  }
+
+
+  //! Solve A x = b for 6 unknowns by elimination with partial pivoting
+  static bool solve6 (double A[6][6], double *b)
+  {
+    int i, j, k, p;
+    for (k = 0; k < 6; ++k)
+    {
+      for (p = k, i = k + 1; i < 6; ++i)
+      {
+        p = (fabs(A[i][k]) > fabs(A[p][k])) ? i : p;
+      }
+      if (fabs(A[p][k]) < DBL_MIN)
+      {
+        return false;
+      }
+      for (j = 0; j < 6; ++j)
+      {
+        double t = A[k][j];
+        A[k][j] = A[p][j];
+        A[p][j] = t;
+      }
+      double t = b[k];
+      b[k] = b[p];
+      b[p] = t;
+      for (i = k + 1; i < 6; ++i)
+      {
+        double f = A[i][k] / A[k][k];
+        for (j = k; j < 6; ++j)
+        {
+          A[i][j] -= f * A[k][j];
+        }
+        b[i] -= f * b[k];
+      }
+    }
+    for (k = 5; k >= 0; --k)
+    {
+      for (j = k + 1; j < 6; ++j)
+      {
+        b[k] -= A[k][j] * b[j];
+      }
+      b[k] /= A[k][k];
+    }
+    return true;
+  }
+
+
+  LIBRARY_API CrpiKinematics::CrpiKinematics (CrpiArmModel model) :
+    model_(model),
+    d1_(0.0),
+    a2_(0.0),
+    a3_(0.0),
+    d4_(0.0),
+    d5_(0.0),
+    d6_(0.0)
+  {
+    int j;
+    identity(base_);
+    identity(tool_);
+    identity(toolInv_);
+    for (j = 0; j < KIN_JOINTS_MAX; ++j)
+    {
+      identity(link_[j]);
+      offset_[j] = 0.0;
+    }
+
+    switch (model_)
+    {
+    case KIN_UR3:
+    case KIN_UR5:
+    case KIN_UR10:
+    default:
+      //! Denavit-Hartenberg parameters published by Universal Robots
+      if (model_ == KIN_UR3)
+      {
+        d1_ = 151.9;
+        a2_ = -243.65;
+        a3_ = -213.25;
+        d4_ = 112.35;
+        d5_ = 85.35;
+        d6_ = 81.9;
+      }
+      else if (model_ == KIN_UR10)
+      {
+        d1_ = 127.3;
+        a2_ = -612.0;
+        a3_ = -572.3;
+        d4_ = 163.941;
+        d5_ = 115.7;
+        d6_ = 92.2;
+      }
+      else
+      {
+        model_ = KIN_UR5;
+        d1_ = 89.159;
+        a2_ = -425.0;
+        a3_ = -392.25;
+        d4_ = 109.15;
+        d5_ = 94.65;
+        d6_ = 82.3;
+      }
+      joints_ = 6;
+      dhFrame(d1_, 0.0, KIN_PI / 2.0, link_[0]);
+      dhFrame(0.0, a2_, 0.0, link_[1]);
+      dhFrame(0.0, a3_, 0.0, link_[2]);
+      dhFrame(d4_, 0.0, KIN_PI / 2.0, link_[3]);
+      dhFrame(d5_, 0.0, -KIN_PI / 2.0, link_[4]);
+      dhFrame(d6_, 0.0, 0.0, link_[5]);
+      for (j = 0; j < joints_; ++j)
+      {
+        lower_[j] = -2.0 * KIN_PI;
+        upper_[j] = 2.0 * KIN_PI;
+      }
+      break;
+    case KIN_LWR4:
+      //! Zero is the arm pointing straight up; shoulder and wrist are spherical
+      joints_ = 7;
+      dhFrame(310.5, 0.0, KIN_PI / 2.0, link_[0]);
+      dhFrame(0.0, 0.0, -KIN_PI / 2.0, link_[1]);
+      dhFrame(400.0, 0.0, -KIN_PI / 2.0, link_[2]);
+      dhFrame(0.0, 0.0, KIN_PI / 2.0, link_[3]);
+      dhFrame(390.0, 0.0, KIN_PI / 2.0, link_[4]);
+      dhFrame(0.0, 0.0, -KIN_PI / 2.0, link_[5]);
+      dhFrame(78.0, 0.0, 0.0, link_[6]);
+      for (j = 0; j < joints_; ++j)
+      {
+        lower_[j] = ((j % 2) ? -120.0 : -170.0) * KIN_DEG;
+        upper_[j] = -lower_[j];
+      }
+      break;
+    case KIN_IRB14000_LEFT:
+    case KIN_IRB14000_RIGHT:
+      {
+        //! Joint frames of ABB's published arm description, in the body (world) frame, in chain
+        //! order (rax_1, rax_2, eax_a, rax_3 to rax_6)
+        static const double lower[7] = { -168.5, -143.5, -168.5, -123.5, -290.0, -88.0, -229.0 };
+        static const double upper[7] = { 168.5, 43.5, 168.5, 80.0, 290.0, 138.0, 229.0 };
+        joints_ = 7;
+        if (model_ == KIN_IRB14000_LEFT)
+        {
+          rpyFrame(53.55, 72.5, 414.92, 0.9781, -0.5716, 2.3180, base_);
+        }
+        else
+        {
+          rpyFrame(53.55, -72.5, 414.92, -0.9795, -0.5682, -2.3155, base_);
+        }
+        rpyFrame(30.0, 0.0, 100.0, KIN_PI / 2.0, 0.0, 0.0, link_[0]);
+        rpyFrame(-30.0, 172.83, 0.0, -KIN_PI / 2.0, 0.0, 0.0, link_[1]);
+        rpyFrame(-41.88, 0.0, 78.73, KIN_PI / 2.0, -KIN_PI / 2.0, 0.0, link_[2]);
+        rpyFrame(40.5, 164.61, 0.0, -KIN_PI / 2.0, 0.0, 0.0, link_[3]);
+        rpyFrame(-27.0, 0.0, 100.39, KIN_PI / 2.0, 0.0, 0.0, link_[4]);
+        rpyFrame(27.0, 29.0, 0.0, -KIN_PI / 2.0, 0.0, 0.0, link_[5]);
+        rpyFrame(0.0, 0.0, 7.0, 0.0, 0.0, 0.0, link_[6]);
+        for (j = 0; j < joints_; ++j)
+        {
+          lower_[j] = lower[j] * KIN_DEG;
+          upper_[j] = upper[j] * KIN_DEG;
+        }
+      }
+      break;
+    }
+  }
+
+
+  LIBRARY_API CrpiKinematics::~CrpiKinematics ()
+  {
+  }
+
+
+  LIBRARY_API CrpiArmModel CrpiKinematics::Model () const
+  {
+    return model_;
+  }
+
+
+  LIBRARY_API int CrpiKinematics::Joints () const
+  {
+    return joints_;
+  }
+
+
+  LIBRARY_API void CrpiKinematics::SetTool (const robotPose &tool)
+  {
+    rpyFrame(tool.x, tool.y, tool.z, tool.xrot * KIN_DEG, tool.yrot * KIN_DEG, tool.zrot * KIN_DEG, tool_);
+    invert(tool_, toolInv_);
+  }
+
+
+  LIBRARY_API bool CrpiKinematics::SetJointLimits (const double *lower, const double *upper)
+  {
+    int j;
+    for (j = 0; j < joints_; ++j)
+    {
+      if (lower[j] > upper[j])
+      {
+        return false;
+      }
+    }
+    for (j = 0; j < joints_; ++j)
+    {
+      lower_[j] = lower[j] * KIN_DEG;
+      upper_[j] = upper[j] * KIN_DEG;
+    }
+    return true;
+  }
+
+
+  LIBRARY_API void CrpiKinematics::GetJointLimits (double *lower, double *upper) const
+  {
+    for (int j = 0; j < joints_; ++j)
+    {
+      lower[j] = lower_[j] / KIN_DEG;
+      upper[j] = upper_[j] / KIN_DEG;
+    }
+  }
+
+
+  LIBRARY_API bool CrpiKinematics::WithinLimits (const robotAxes &axes) const
+  {
+    if (axes.axes < joints_)
+    {
+      return false;
+    }
+    for (int j = 0; j < joints_; ++j)
+    {
+      if (axes.axis[j] * KIN_DEG < lower_[j] - KIN_EPS || axes.axis[j] * KIN_DEG > upper_[j] + KIN_EPS)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiKinematics::Forward (const robotAxes &axes, robotPose &pose) const
+  {
+    double q[KIN_JOINTS_MAX], f[12], t[12];
+    if (axes.axes < joints_)
+    {
+      return CANON_REJECT;
+    }
+    for (int j = 0; j < joints_; ++j)
+    {
+      q[j] = axes.axis[j] * KIN_DEG;
+    }
+    flange(q, f);
+    compose(f, tool_, t);
+    framePose(t, pose);
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API int CrpiKinematics::Points (const robotAxes &axes, double *points) const
+  {
+    double f[12], t[12];
+    int i, j;
+    if (axes.axes < joints_)
+    {
+      return 0;
+    }
+    for (i = 0; i < 12; ++i)
+    {
+      f[i] = base_[i];
+    }
+    for (i = 0; i < 3; ++i)
+    {
+      points[i] = f[9 + i];
+    }
+    for (j = 0; j < joints_; ++j)
+    {
+      advance(f, (axes.axis[j] * KIN_DEG) + offset_[j], link_[j]);
+      for (i = 0; i < 3; ++i)
+      {
+        points[((j + 1) * 3) + i] = f[9 + i];
+      }
+    }
+    compose(f, tool_, t);
+    for (i = 0; i < 3; ++i)
+    {
+      points[((joints_ + 1) * 3) + i] = t[9 + i];
+    }
+    return joints_ + 2;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiKinematics::Jacobian (const robotAxes &axes, double *jacobian, robotPose *pose) const
+  {
+    double f[12], t[12], z[KIN_JOINTS_MAX][3], o[KIN_JOINTS_MAX][3], d[3];
+    int i, j;
+
+    if (axes.axes < joints_)
+    {
+      return CANON_REJECT;
+    }
+
+    //! Forward pass, keeping each joint's axis and origin
+    for (i = 0; i < 12; ++i)
+    {
+      f[i] = base_[i];
+    }
+    for (j = 0; j < joints_; ++j)
+    {
+      for (i = 0; i < 3; ++i)
+      {
+        z[j][i] = f[(i * 3) + 2];
+        o[j][i] = f[9 + i];
+      }
+      advance(f, (axes.axis[j] * KIN_DEG) + offset_[j], link_[j]);
+    }
+    compose(f, tool_, t);
+
+    //! Column j:  (z x (p - o), z) for revolute joint j
+    for (j = 0; j < KIN_JOINTS_MAX; ++j)
+    {
+      if (j >= joints_)
+      {
+        for (i = 0; i < 6; ++i)
+        {
+          jacobian[(i * KIN_JOINTS_MAX) + j] = 0.0;
+        }
+        continue;
+      }
+      d[0] = t[9] - o[j][0];
+      d[1] = t[10] - o[j][1];
+      d[2] = t[11] - o[j][2];
+      jacobian[j] = (z[j][1] * d[2]) - (z[j][2] * d[1]);
+      jacobian[KIN_JOINTS_MAX + j] = (z[j][2] * d[0]) - (z[j][0] * d[2]);
+      jacobian[(2 * KIN_JOINTS_MAX) + j] = (z[j][0] * d[1]) - (z[j][1] * d[0]);
+      jacobian[(3 * KIN_JOINTS_MAX) + j] = z[j][0];
+      jacobian[(4 * KIN_JOINTS_MAX) + j] = z[j][1];
+      jacobian[(5 * KIN_JOINTS_MAX) + j] = z[j][2];
+    }
+
+    if (pose != NULL)
+    {
+      framePose(t, *pose);
+    }
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API int CrpiKinematics::Inverse (const robotPose &pose, robotAxes *solutions, int max, double redundancy) const
+  {
+    double f[12], seed[KIN_JOINTS_MAX], q[KIN_SOLUTIONS_MAX * KIN_JOINTS_MAX];
+    int i, j, n, found = 0;
+
+    target(pose, f);
+    for (j = 0; j < joints_; ++j)
+    {
+      seed[j] = 0.0;
+    }
+    if (joints_ > 6)
+    {
+      seed[2] = redundancy * KIN_DEG;
+    }
+    n = solve(f, seed, redundancy * KIN_DEG, q);
+    for (i = 0; i < n && found < max; ++i)
+    {
+      if (fit(&q[i * KIN_JOINTS_MAX], seed))
+      {
+        solutions[found].axes = joints_;
+        for (j = 0; j < joints_; ++j)
+        {
+          solutions[found].axis[j] = q[(i * KIN_JOINTS_MAX) + j] / KIN_DEG;
+        }
+        ++found;
+      }
+    }
+    return found;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiKinematics::Inverse (const robotPose &pose, const robotAxes &seed, robotAxes &solution) const
+  {
+    double f[12], s[KIN_JOINTS_MAX], q[KIN_SOLUTIONS_MAX * KIN_JOINTS_MAX];
+    double dist, best = DBL_MAX;
+    int i, j, n, pick = -1;
+
+    if (seed.axes < joints_)
+    {
+      return CANON_REJECT;
+    }
+    target(pose, f);
+    for (j = 0; j < joints_; ++j)
+    {
+      s[j] = seed.axis[j] * KIN_DEG;
+    }
+    n = solve(f, s, s[2], q);
+    for (i = 0; i < n; ++i)
+    {
+      double *qi = &q[i * KIN_JOINTS_MAX];
+      if (fit(qi, s))
+      {
+        for (dist = 0.0, j = 0; j < joints_; ++j)
+        {
+          dist += (qi[j] - s[j]) * (qi[j] - s[j]);
+        }
+        if (dist < best)
+        {
+          best = dist;
+          pick = i;
+        }
+      }
+    }
+    if (pick < 0)
+    {
+      return CANON_FAILURE;
+    }
+    solution.axes = joints_;
+    for (j = 0; j < joints_; ++j)
+    {
+      solution.axis[j] = q[(pick * KIN_JOINTS_MAX) + j] / KIN_DEG;
+    }
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API void CrpiKinematics::ForwardBatch (const kinBatch &batch) const
+  {
+    double R[9][KIN_LANES], P[3][KIN_LANES], c[KIN_LANES], s[KIN_LANES], t[12];
+    size_t b;
+    int i, j, l, n;
+    robotPose pose;
+
+    for (b = 0; b < batch.count; b += KIN_LANES)
+    {
+      n = (batch.count - b < KIN_LANES) ? (int)(batch.count - b) : KIN_LANES;
+      for (l = 0; l < n; ++l)
+      {
+        for (i = 0; i < 9; ++i)
+        {
+          R[i][l] = base_[i];
+        }
+        for (i = 0; i < 3; ++i)
+        {
+          P[i][l] = base_[9 + i];
+        }
+      }
+
+      //! Each step is the same arithmetic on every lane:  R = R Rz(q), P += R link.p, R = R link.R
+      for (j = 0; j <= joints_; ++j)
+      {
+        const double *L = (j < joints_) ? link_[j] : tool_;
+        if (j < joints_)
+        {
+          const double *q = batch.q[j] + b;
+          for (l = 0; l < n; ++l)
+          {
+            c[l] = cos((q[l] * KIN_DEG) + offset_[j]);
+            s[l] = sin((q[l] * KIN_DEG) + offset_[j]);
+          }
+          for (i = 0; i < 3; ++i)
+          {
+            for (l = 0; l < n; ++l)
+            {
+              double x = R[i * 3][l], y = R[(i * 3) + 1][l];
+              R[i * 3][l] = (c[l] * x) + (s[l] * y);
+              R[(i * 3) + 1][l] = (c[l] * y) - (s[l] * x);
+            }
+          }
+        }
+        for (i = 0; i < 3; ++i)
+        {
+          for (l = 0; l < n; ++l)
+          {
+            double r0 = R[i * 3][l], r1 = R[(i * 3) + 1][l], r2 = R[(i * 3) + 2][l];
+            P[i][l] += (r0 * L[9]) + (r1 * L[10]) + (r2 * L[11]);
+            R[i * 3][l] = (r0 * L[0]) + (r1 * L[3]) + (r2 * L[6]);
+            R[(i * 3) + 1][l] = (r0 * L[1]) + (r1 * L[4]) + (r2 * L[7]);
+            R[(i * 3) + 2][l] = (r0 * L[2]) + (r1 * L[5]) + (r2 * L[8]);
+          }
+        }
+      }
+
+      for (l = 0; l < n; ++l)
+      {
+        for (i = 0; i < 9; ++i)
+        {
+          t[i] = R[i][l];
+        }
+        for (i = 0; i < 3; ++i)
+        {
+          t[9 + i] = P[i][l];
+        }
+        framePose(t, pose);
+        batch.x[b + l] = pose.x;
+        batch.y[b + l] = pose.y;
+        batch.z[b + l] = pose.z;
+        batch.xrot[b + l] = pose.xrot;
+        batch.yrot[b + l] = pose.yrot;
+        batch.zrot[b + l] = pose.zrot;
+      }
+    }
+  }
+
+
+  LIBRARY_API size_t CrpiKinematics::InverseBatch (const kinBatch &batch, const robotAxes &seed) const
+  {
+    robotPose pose;
+    robotAxes out;
+    size_t i, solved = 0;
+    int j;
+
+    for (i = 0; i < batch.count; ++i)
+    {
+      pose.x = batch.x[i];
+      pose.y = batch.y[i];
+      pose.z = batch.z[i];
+      pose.xrot = batch.xrot[i];
+      pose.yrot = batch.yrot[i];
+      pose.zrot = batch.zrot[i];
+      CanonReturn ret = Inverse(pose, seed, out);
+      if (ret == CANON_SUCCESS)
+      {
+        for (j = 0; j < joints_; ++j)
+        {
+          batch.q[j][i] = out.axis[j];
+        }
+        ++solved;
+      }
+      if (batch.status != NULL)
+      {
+        batch.status[i] = (ret == CANON_SUCCESS) ? CANON_SUCCESS : CANON_FAILURE;
+      }
+    }
+    return solved;
+  }
+
+
+  void CrpiKinematics::flange (const double *q, double *frame) const
+  {
+    for (int i = 0; i < 12; ++i)
+    {
+      frame[i] = base_[i];
+    }
+    for (int j = 0; j < joints_; ++j)
+    {
+      advance(frame, q[j] + offset_[j], link_[j]);
+    }
+  }
+
+
+  void CrpiKinematics::target (const robotPose &pose, double *frame) const
+  {
+    double f[12];
+    rpyFrame(pose.x, pose.y, pose.z, pose.xrot * KIN_DEG, pose.yrot * KIN_DEG, pose.zrot * KIN_DEG, f);
+    compose(f, toolInv_, frame);
+  }
+
+
+  int CrpiKinematics::solve (const double *frame, const double *seed, double redundancy, double *q) const
+  {
+    int i, j, n;
+    if (model_ == KIN_LWR4)
+    {
+      n = solveSRS(frame, redundancy, q);
+    }
+    else if (model_ == KIN_IRB14000_LEFT || model_ == KIN_IRB14000_RIGHT)
+    {
+      double s[KIN_JOINTS_MAX];
+      for (j = 0; j < joints_; ++j)
+      {
+        s[j] = seed[j];
+      }
+      s[2] = redundancy;
+      return solveNumeric(frame, s, q);
+    }
+    else
+    {
+      n = solveUR(frame, q);
+    }
+    for (i = 0; i < n; ++i)
+    {
+      for (j = 0; j < joints_; ++j)
+      {
+        q[(i * KIN_JOINTS_MAX) + j] = wrap(q[(i * KIN_JOINTS_MAX) + j] - offset_[j]);
+      }
+    }
+    return n;
+  }
+
+
+  int CrpiKinematics::solveUR (const double *frame, double *q) const
+  {
+    double f[12], bi[12], t[12], p[2];
+    double q1[2], q5[2], q3[2];
+    int i, k, l, n1, n5, n3, n = 0;
+
+    invert(base_, bi);
+    compose(bi, frame, f);
+
+    //! Shoulder:  the wrist center behind the last link lies d4 off the plane of joints 2 to 4
+    double A = (d6_ * f[5]) - f[10], B = (d6_ * f[2]) - f[9];
+    n1 = cosSin(A, -B, d4_, 0.0, q1);
+
+    for (i = 0; i < n1; ++i)
+    {
+      double c1 = cos(q1[i]), s1 = sin(q1[i]);
+
+      //! Wrist 2 from the flange position across the shoulder plane
+      double ratio = ((f[9] * s1) - (f[10] * c1) - d4_) / d6_;
+      if (fabs(ratio) > 1.0 + 1e-9)
+      {
+        continue;
+      }
+      ratio = (ratio > 1.0) ? 1.0 : ((ratio < -1.0) ? -1.0 : ratio);
+      q5[0] = acos(ratio);
+      q5[1] = -q5[0];
+      n5 = (q5[0] < KIN_EPS) ? 1 : 2;
+
+      for (k = 0; k < n5; ++k)
+      {
+        //! Wrist 3 lines the flange up with the z axis of joints 2 to 4:  with M the flange in
+        //! frame 1, ez^T M L6^T = (L4^T ez)^T Rz(q5) L5 Rz(q6)
+        double f1[12], l1[12], m1[12];
+        identity(l1);
+        rotateZ(l1, q1[i]);
+        compose(l1, link_[0], m1);
+        invert(m1, l1);
+        compose(l1, f, f1);
+        double g[3], h[3], e[3] = { 0.0, 0.0, 1.0 }, r[3];
+        for (l = 0; l < 3; ++l)
+        {
+          g[l] = (f1[6] * link_[5][l * 3]) + (f1[7] * link_[5][(l * 3) + 1]) + (f1[8] * link_[5][(l * 3) + 2]);
+        }
+        rotateT(link_[3], e, r);
+        double c5 = cos(q5[k]), s5 = sin(q5[k]);
+        double rr[3] = { (r[0] * c5) + (r[1] * s5), (r[1] * c5) - (r[0] * s5), r[2] };
+        rotateT(link_[4], rr, h);
+        double q6 = (sqrt((h[0] * h[0]) + (h[1] * h[1])) < KIN_EPS) ? 0.0 :
+                    wrap(atan2(h[1], h[0]) - atan2(g[1], g[0]));
+
+        //! Joints 2 to 4 are a planar arm from frame 1 to frame 4
+        double t46[12], t46i[12], t14[12], l4i[12];
+        identity(t46);
+        advance(t46, q5[k], link_[4]);
+        advance(t46, q6, link_[5]);
+        invert(t46, t46i);
+        compose(f1, t46i, t);
+        invert(link_[3], l4i);
+        compose(t, l4i, t14);
+        p[0] = t14[9];
+        p[1] = t14[10];
+        double c3 = ((p[0] * p[0]) + (p[1] * p[1]) - (a2_ * a2_) - (a3_ * a3_)) / (2.0 * a2_ * a3_);
+        if (fabs(c3) > 1.0 + 1e-9)
+        {
+          continue;
+        }
+        c3 = (c3 > 1.0) ? 1.0 : ((c3 < -1.0) ? -1.0 : c3);
+        q3[0] = acos(c3);
+        q3[1] = -q3[0];
+        n3 = (q3[0] < KIN_EPS) ? 1 : 2;
+        for (l = 0; l < n3; ++l)
+        {
+          double q2 = atan2(p[1], p[0]) - atan2(a3_ * sin(q3[l]), a2_ + (a3_ * c3));
+          double q234 = atan2(t14[3], t14[0]);
+          double *qn = &q[n * KIN_JOINTS_MAX];
+          qn[0] = q1[i];
+          qn[1] = wrap(q2);
+          qn[2] = q3[l];
+          qn[3] = wrap(q234 - q2 - q3[l]);
+          qn[4] = q5[k];
+          qn[5] = q6;
+          ++n;
+        }
+      }
+    }
+    return n;
+  }
+
+
+  int CrpiKinematics::solveSRS (const double *frame, double redundancy, double *q) const
+  {
+    double f[12], bi[12], l7i[12], wf[12], v[3], e[3], g[3], u[3], w[3], t[3];
+    double q1[2], q2[2], q4[2], q5[2], q6[2];
+    int i, k, l, m, n4, n1, n5, n = 0;
+
+    invert(base_, bi);
+    compose(bi, frame, f);
+    invert(link_[6], l7i);
+    compose(f, l7i, wf);
+
+    //! Wrist center from the shoulder
+    for (i = 0; i < 3; ++i)
+    {
+      v[i] = wf[9 + i] - link_[0][9 + i];
+    }
+
+    //! Elbow:  |shoulder to wrist| fixes joint 4.  With e the wrist in the frame after joint 4 and
+    //! p3 the elbow link, |v|^2 = |e|^2 + |p3|^2 + 2 (R3^T p3) . Rz(q4) e
+    rotate(link_[3], &link_[4][9], e);
+    for (i = 0; i < 3; ++i)
+    {
+      e[i] += link_[3][9 + i];
+    }
+    rotateT(link_[2], &link_[2][9], g);
+    double vv = (v[0] * v[0]) + (v[1] * v[1]) + (v[2] * v[2]),
+           ee = (e[0] * e[0]) + (e[1] * e[1]) + (e[2] * e[2]),
+           pp = (link_[2][9] * link_[2][9]) + (link_[2][10] * link_[2][10]) + (link_[2][11] * link_[2][11]);
+    n4 = cosSin((g[0] * e[0]) + (g[1] * e[1]), (g[1] * e[0]) - (g[0] * e[1]),
+                ((vv - ee - pp) / 2.0) - (g[2] * e[2]), 0.0, q4);
+
+    for (i = 0; i < n4; ++i)
+    {
+      //! Shoulder:  v = Rz(q1) L1 Rz(q2) L2 u, for u the wrist in the frame after joint 2
+      double c4 = cos(q4[i]), s4 = sin(q4[i]), c3 = cos(redundancy), s3 = sin(redundancy);
+      t[0] = (c4 * e[0]) - (s4 * e[1]);
+      t[1] = (s4 * e[0]) + (c4 * e[1]);
+      t[2] = e[2];
+      rotate(link_[2], t, u);
+      for (k = 0; k < 3; ++k)
+      {
+        u[k] += link_[2][9 + k];
+      }
+      t[0] = (c3 * u[0]) - (s3 * u[1]);
+      t[1] = (s3 * u[0]) + (c3 * u[1]);
+      t[2] = u[2];
+      rotate(link_[1], t, w);
+      n1 = rotatePair(link_[0], w, v, q1, q2);
+
+      for (k = 0; k < n1; ++k)
+      {
+        //! Wrist:  M = R04^T R7 = Rz(q5) L5 Rz(q6) L6 Rz(q7)
+        double t04[12], M[9], mz[3], lz[3], ez[3] = { 0.0, 0.0, 1.0 };
+        identity(t04);
+        advance(t04, q1[k], link_[0]);
+        advance(t04, q2[k], link_[1]);
+        advance(t04, redundancy, link_[2]);
+        advance(t04, q4[i], link_[3]);
+        for (l = 0; l < 3; ++l)
+        {
+          for (m = 0; m < 3; ++m)
+          {
+            M[(l * 3) + m] = (t04[l] * wf[m]) + (t04[3 + l] * wf[3 + m]) + (t04[6 + l] * wf[6 + m]);
+          }
+        }
+        mz[0] = M[2];
+        mz[1] = M[5];
+        mz[2] = M[8];
+        rotate(link_[5], ez, lz);
+        n5 = rotatePair(link_[4], lz, mz, q5, q6);
+        for (l = 0; l < n5; ++l)
+        {
+          double r[12], c[12];
+          identity(r);
+          advance(r, q5[l], link_[4]);
+          advance(r, q6[l], link_[5]);
+          for (m = 0; m < 9; ++m)
+          {
+            c[m] = M[m];
+          }
+          c[9] = c[10] = c[11] = 0.0;
+          invert(r, bi);
+          compose(bi, c, r);
+          double *qn = &q[n * KIN_JOINTS_MAX];
+          qn[0] = q1[k];
+          qn[1] = q2[k];
+          qn[2] = redundancy;
+          qn[3] = q4[i];
+          qn[4] = q5[l];
+          qn[5] = q6[l];
+          qn[6] = atan2(r[3], r[0]);
+          ++n;
+        }
+      }
+    }
+    return n;
+  }
+
+
+  int CrpiKinematics::solveNumeric (const double *frame, const double *seed, double *q) const
+  {
+    double f[12], J[6][KIN_JOINTS_MAX], err[6], z[KIN_JOINTS_MAX][3], o[KIN_JOINTS_MAX][3];
+    int i, j, k, it;
+
+    for (j = 0; j < joints_; ++j)
+    {
+      q[j] = seed[j];
+    }
+
+    for (it = 0; it < KIN_ITERATIONS; ++it)
+    {
+      //! Forward pass, keeping each joint's axis and origin
+      for (i = 0; i < 12; ++i)
+      {
+        f[i] = base_[i];
+      }
+      for (j = 0; j < joints_; ++j)
+      {
+        for (i = 0; i < 3; ++i)
+        {
+          z[j][i] = f[(i * 3) + 2];
+          o[j][i] = f[9 + i];
+        }
+        advance(f, q[j] + offset_[j], link_[j]);
+      }
+
+      //! Position error (mm) and small-angle orientation error, weighted
+      double ep = 0.0, eo = 0.0;
+      for (i = 0; i < 3; ++i)
+      {
+        err[i] = frame[9 + i] - f[9 + i];
+        ep += err[i] * err[i];
+      }
+      for (i = 0; i < 3; ++i)
+      {
+        int a = (i + 1) % 3, b = (i + 2) % 3;
+        double s = 0.0;
+        for (k = 0; k < 3; ++k)
+        {
+          //! 0.5 sum over columns of (current x target), component i
+          s += (f[(a * 3) + k] * frame[(b * 3) + k]) - (f[(b * 3) + k] * frame[(a * 3) + k]);
+        }
+        err[3 + i] = 0.5 * s;
+        eo += err[3 + i] * err[3 + i];
+        err[3 + i] *= KIN_ORIENT_WEIGHT;
+      }
+      if (sqrt(ep) < 1e-4 && sqrt(eo) < 1e-7)
+      {
+        for (j = 0; j < joints_; ++j)
+        {
+          q[j] = wrap(q[j]);
+        }
+        return 1;
+      }
+
+      //! Jacobian of every joint but the redundant one (column 2), which stays at the seed
+      for (j = 0; j < joints_; ++j)
+      {
+        double d[3] = { f[9] - o[j][0], f[10] - o[j][1], f[11] - o[j][2] };
+        bool used = (joints_ < 7 || j != 2);
+        J[0][j] = used ? ((z[j][1] * d[2]) - (z[j][2] * d[1])) : 0.0;
+        J[1][j] = used ? ((z[j][2] * d[0]) - (z[j][0] * d[2])) : 0.0;
+        J[2][j] = used ? ((z[j][0] * d[1]) - (z[j][1] * d[0])) : 0.0;
+        J[3][j] = used ? (z[j][0] * KIN_ORIENT_WEIGHT) : 0.0;
+        J[4][j] = used ? (z[j][1] * KIN_ORIENT_WEIGHT) : 0.0;
+        J[5][j] = used ? (z[j][2] * KIN_ORIENT_WEIGHT) : 0.0;
+      }
+
+      //! Damped least squares:  dq = J^T (J J^T + lambda I)^-1 err
+      double JJ[6][6], y[6];
+      for (i = 0; i < 6; ++i)
+      {
+        for (k = 0; k < 6; ++k)
+        {
+          double s = (i == k) ? (KIN_DAMPING * KIN_ORIENT_WEIGHT * KIN_ORIENT_WEIGHT) : 0.0;
+          for (j = 0; j < joints_; ++j)
+          {
+            s += J[i][j] * J[k][j];
+          }
+          JJ[i][k] = s;
+        }
+        y[i] = err[i];
+      }
+      if (!solve6(JJ, y))
+      {
+        return 0;
+      }
+      for (j = 0; j < joints_; ++j)
+      {
+        double dq = 0.0;
+        for (i = 0; i < 6; ++i)
+        {
+          dq += J[i][j] * y[i];
+        }
+        //! Steps past a tenth of a turn overshoot far from the solution
+        dq = (dq > 0.6) ? 0.6 : ((dq < -0.6) ? -0.6 : dq);
+        q[j] += dq;
+      }
+    }
+    return 0;
+  }
+
+
+  bool CrpiKinematics::fit (double *q, const double *seed) const
+  {
+    for (int j = 0; j < joints_; ++j)
+    {
+      //! Nearest equivalent angle to the seed, then the nearest one inside the limits
+      double best = DBL_MAX, pick = q[j];
+      double base = q[j] + (2.0 * KIN_PI * floor(((seed[j] - q[j]) / (2.0 * KIN_PI)) + 0.5));
+      for (int k = -1; k <= 1; ++k)
+      {
+        double c = base + (2.0 * KIN_PI * k);
+        if (c >= lower_[j] - KIN_EPS && c <= upper_[j] + KIN_EPS && fabs(c - seed[j]) < best)
+        {
+          best = fabs(c - seed[j]);
+          pick = c;
+        }
+      }
+      if (best == DBL_MAX)
+      {
+        return false;
+      }
+      q[j] = pick;
+    }
+    return true;
+  }
+} // namespace crpi_robot
@@ -0,0 +1,254 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_kinematics.h
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Forward and inverse kinematics of the supported arms, for checking
+//  reachability and choosing configurations before commanding a robot.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_kinematics_H
+#define crpi_kinematics_H
+
+#include "crpi.h"
+
+//! @brief Most joints of a supported arm, most inverse kinematic solutions returned for one pose,
+//!        and number of poses evaluated together by the batch functions
+//!
+#define KIN_JOINTS_MAX 7
+#define KIN_SOLUTIONS_MAX 8
+#define KIN_LANES 8
+
+namespace crpi_robot
+{
+  //! @brief Arms with built-in kinematic models
+  //!
+  typedef enum
+  {
+    KIN_UR3 = 0,        //! Universal Robots UR3 (closed form)
+    KIN_UR5,            //! Universal Robots UR5 (closed form)
+    KIN_UR10,           //! Universal Robots UR10 (closed form)
+    KIN_LWR4,           //! KUKA LWR 4 (closed form, for a given joint 3)
+    KIN_IRB14000_LEFT,  //! ABB IRB 14000 left arm (numerical, for a given eax_a)
+    KIN_IRB14000_RIGHT  //! ABB IRB 14000 right arm (numerical, for a given eax_a)
+  } CrpiArmModel;
+
+  //! @brief Structure-of-arrays poses and joint positions for the batch functions, each array
+  //!        holding count values
+  //!
+  struct kinBatch
+  {
+    //! @brief Number of entries
+    //!
+    size_t count;
+
+    //! @brief Joint positions (deg), one array per joint in CRPI order
+    //!
+    double *q[KIN_JOINTS_MAX];
+
+    //! @brief Flange or tool poses (mm, deg) in the robot's base frame
+    //!
+    double *x;
+    double *y;
+    double *z;
+    double *xrot;
+    double *yrot;
+    double *zrot;
+
+    //! @brief CANON_SUCCESS for each pose that was solved, CANON_FAILURE otherwise (inverse
+    //!        kinematics only)
+    //!
+    CanonReturn *status;
+
+    //! @brief Default constructor
+    //!
+    kinBatch () :
+      count(0),
+      x(NULL),
+      y(NULL),
+      z(NULL),
+      xrot(NULL),
+      yrot(NULL),
+      zrot(NULL),
+      status(NULL)
+    {
+      for (int j = 0; j < KIN_JOINTS_MAX; ++j)
+      {
+        q[j] = NULL;
+      }
+    }
+  };
+
+  //! @ingroup Robot
+  //!
+  //! @brief Kinematic model of one arm.  Poses are in mm and degrees in the controller's base
+  //!        frame, with CRPI's roll-pitch-yaw convention (R = Rz(zrot) Ry(yrot) Rx(xrot)), and
+  //!        joints in degrees in the order the arm's CRPI interface uses.
+  //!
+  //!        The UR arms are solved in closed form (up to 8 configurations per pose).  The LWR 4 is
+  //!        solved in closed form once the redundant joint 3 is fixed (up to 8 configurations per
+  //!        value).  The IRB 14000 arms have offsets at every joint, so there is no closed form;
+  //!        they are solved numerically (damped least squares, with eax_a fixed) from a seed.
+  //!
+  //! @note Models are immutable after setup and nothing is allocated, so one model may be shared
+  //!       by any number of threads.
+  //!
+  class LIBRARY_API CrpiKinematics
+  {
+  public:
+    //! @brief Constructor
+    //!
+    //! @param model The arm, with its nominal geometry and joint limits and no tool
+    //!
+    CrpiKinematics (CrpiArmModel model);
+
+    //! @brief Default destructor
+    //!
+    ~CrpiKinematics ();
+
+    //! @brief The arm
+    //!
+    CrpiArmModel Model () const;
+
+    //! @brief Number of joints
+    //!
+    int Joints () const;
+
+    //! @brief Set the tool, as the tool frame in the flange frame (mm, deg), so that poses refer
+    //!        to the tool and not the flange
+    //!
+    void SetTool (const robotPose &tool);
+
+    //! @brief Set the joint limits (deg) used to accept solutions
+    //!
+    //! @return True if the limits were set, false if one lower limit is above its upper limit
+    //!
+    bool SetJointLimits (const double *lower, const double *upper);
+
+    //! @brief Get the joint limits (deg)
+    //!
+    void GetJointLimits (double *lower, double *upper) const;
+
+    //! @brief Whether every joint of a configuration is within its limits
+    //!
+    bool WithinLimits (const robotAxes &axes) const;
+
+    //! @brief Pose of a configuration
+    //!
+    //! @param axes The joint positions (deg)
+    //! @param pose The pose, populated by this function
+    //!
+    //! @return CANON_SUCCESS, or CANON_REJECT if axes has too few joints
+    //!
+    CanonReturn Forward (const robotAxes &axes, robotPose &pose) const;
+
+    //! @brief Origins of the base, of the frame after each joint, and of the tool, in the base
+    //!        frame:  the centerline of the arm, e.g., for collision models
+    //!
+    //! @param axes   The joint positions (deg)
+    //! @param points Joints() + 2 positions (mm) as x, y, z triples, populated by this function
+    //!
+    //! @return The number of positions, or 0 if axes has too few joints
+    //!
+    int Points (const robotAxes &axes, double *points) const;
+
+    //! @brief Geometric Jacobian of the tool point in the base frame:  the tool's linear and
+    //!        angular velocity per unit of joint velocity
+    //!
+    //! @param axes     The joint positions (deg)
+    //! @param jacobian 6 rows of KIN_JOINTS_MAX values (row-major), populated by this function:
+    //!                 linear velocity (mm/rad) in rows 0 to 2 and angular velocity (rad/rad) in
+    //!                 rows 3 to 5, with the columns past Joints() zero
+    //! @param pose     Populated with the tool pose, if not NULL
+    //!
+    //! @return CANON_SUCCESS, or CANON_REJECT if axes has too few joints
+    //!
+    CanonReturn Jacobian (const robotAxes &axes, double *jacobian, robotPose *pose = NULL) const;
+
+    //! @brief All configurations within the joint limits that reach a pose
+    //!
+    //! @param pose       The pose to reach
+    //! @param solutions  Up to max configurations, populated by this function
+    //! @param max        Size of solutions (at most KIN_SOLUTIONS_MAX are found)
+    //! @param redundancy The redundant joint (deg) of 7-joint arms (joint 3 of the LWR 4, eax_a of
+    //!                   the IRB 14000, which is also solved from there)
+    //!
+    //! @return The number of configurations (0 if the pose is out of reach)
+    //!
+    int Inverse (const robotPose &pose, robotAxes *solutions, int max, double redundancy = 0.0) const;
+
+    //! @brief The configuration within the joint limits that reaches a pose and is closest to a
+    //!        seed (e.g., the current configuration).  The redundant joint of 7-joint arms is kept
+    //!        at the seed's.  Full turns are added to joints where the limits allow and it brings
+    //!        them closer to the seed.
+    //!
+    //! @return CANON_SUCCESS if a configuration was found, CANON_FAILURE if the pose is out of
+    //!         reach, CANON_REJECT if the seed has too few joints
+    //!
+    CanonReturn Inverse (const robotPose &pose, const robotAxes &seed, robotAxes &solution) const;
+
+    //! @brief Poses of a batch of configurations (batch.q to batch.x through batch.zrot).
+    //!        Configurations are evaluated KIN_LANES at a time, across which the loops vectorize.
+    //!
+    void ForwardBatch (const kinBatch &batch) const;
+
+    //! @brief Configurations closest to a seed, as for Inverse, for a batch of poses (batch.x
+    //!        through batch.zrot to batch.q and batch.status)
+    //!
+    //! @return The number of poses that were solved
+    //!
+    size_t InverseBatch (const kinBatch &batch, const robotAxes &seed) const;
+
+  private:
+    //! @brief Flange frame (3x3 rotation, row-major, then position) of a configuration (rad)
+    //!
+    void flange (const double *q, double *frame) const;
+
+    //! @brief Flange frame of a tool or flange pose (frame from pose, less the tool)
+    //!
+    void target (const robotPose &pose, double *frame) const;
+
+    //! @brief Inverse kinematics of a flange frame, into up to KIN_SOLUTIONS_MAX configurations
+    //!        (rad), before joint limits are applied
+    //!
+    int solveUR (const double *frame, double *q) const;
+    int solveSRS (const double *frame, double redundancy, double *q) const;
+    int solveNumeric (const double *frame, const double *seed, double *q) const;
+    int solve (const double *frame, const double *seed, double redundancy, double *q) const;
+
+    //! @brief Shift a solution by full turns toward a seed, within the limits (rad)
+    //!
+    //! @return True if the solution is within the limits
+    //!
+    bool fit (double *q, const double *seed) const;
+
+    CrpiArmModel model_;
+    int joints_;
+
+    //! @brief The chain:  base frame, then for each joint a rotation about z (plus offset_) and
+    //!        link_, then tool_, each frame a 3x3 rotation (row-major) and a position (mm)
+    //!
+    double base_[12];
+    double link_[KIN_JOINTS_MAX][12];
+    double tool_[12];
+    double toolInv_[12];
+    double offset_[KIN_JOINTS_MAX];
+
+    //! @brief Joint limits (rad)
+    //!
+    double lower_[KIN_JOINTS_MAX];
+    double upper_[KIN_JOINTS_MAX];
+
+    //! @brief Denavit-Hartenberg lengths of the UR arms (mm)
+    //!
+    double d1_, a2_, a3_, d4_, d5_, d6_;
+  }; // CrpiKinematics
+} // namespace crpi_robot
+
+#endif
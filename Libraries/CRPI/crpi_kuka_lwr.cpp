@@ -14,31 +14,156 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "crpi_kuka_lwr.h"
+#include "crpi_alloc.h"
+#include "crpi_hub.h"
+#include "crpi_log.h"
+#include "crpi_native.h"
+#include "crpi_trace.h"
+#include <algorithm>
 #include <fstream>
 
 using namespace std;
 
 //#define STATIC_ //! Uncomment this line if you want to hard code the serial port (debugging purposes only)
 
-//#define LWR_NOISY
-
 namespace crpi_robot
 {
+  //! @brief Keep-alive, run every KUKA_KEEPALIVE seconds by the SensorHub
+  //!
   void livemanLWR (void *param)
   {
     keepalive *ka = (keepalive*)param;
     robotPose pose;
-    crpi_timer timer;
 
-    while (ka->runThread)
+    if (ka->runThread)
     {
       ((CrpiKukaLWR*)ka->rob)->GetRobotPose (&pose);
-      //! Don't slam your processor!  You don't need to poll at full speed.
-      timer.waitUntil(5000);
     }
     return;
   }
 
+  //! @brief Publish one state record received by stateLWR
+  //!
+  static void publishLWR (kukaStateStream *ks, kukaStateRecord &record)
+  {
+    record.timestamp = ulapi_time();
+    ks->record.write(record);
+    CrpiRecorder::Record(ks->recordChannel, RECORD_FEEDBACK, record.timestamp, &record, sizeof(record));
+    ks->framesMetric->Inc();
+    ks->rateMetric.Tick(record.timestamp);
+  }
+
+
+  //! @brief Receive the combined state records streamed by the KRL state server.  Records are
+  //!        KUKA_STATE_VALUES space-separated values terminated by ';', or binary records of
+  //!        KUKA_STATE_RECORD bytes if ks->binary is set.
+  //!
+  //! @param param Pointer to the kukaStateStream to populate
+  //!
+  void stateLWR (void *param)
+  {
+    kukaStateStream *ks = (kukaStateStream*)param;
+    kukaStateRecord record;
+    const char *b;
+    char *end;
+    int get, used, i;
+    unsigned int dio;
+    bool connected = false;
+
+    while (ks->runThread)
+    {
+      if (ks->client < 0)
+      {
+        //! Wait for the state server to connect (or reconnect after a controller restart)
+        ks->client = ulapi_socket_get_connection_id(ks->server);
+        ks->held = 0;
+        if (ks->client < 0)
+        {
+#ifdef WIN32
+          Sleep (100);
+#else
+          usleep (100000);
+#endif
+        }
+        else
+        {
+          if (connected)
+          {
+            ks->reconnectMetric->Inc();
+          }
+          connected = true;
+        }
+        continue;
+      }
+
+      get = ulapi_socket_read(ks->client, ks->buffer + ks->held, KUKA_STATE_BUFFER - 1 - ks->held);
+      if (get <= 0)
+      {
+        ulapi_socket_close(ks->client);
+        ks->client = -1;
+        continue;
+      }
+      ks->held += get;
+      ks->buffer[ks->held] = '\0';
+
+      used = 0;
+      while (ks->binary && (ks->held - used) >= KUKA_STATE_RECORD)
+      {
+        b = ks->buffer + used;
+        if (crpi_load_le32(b) != KUKA_STATE_MAGIC)
+        {
+          //! Out of step with the record boundaries; slide forward to the next marker
+          ++used;
+          continue;
+        }
+
+        //! Same value order as the text records
+        record.values[0] = (double)crpi_load_le32(b + 4);
+        for (i = 0; i < 27; ++i)
+        {
+          record.values[1 + i] = crpi_load_le_float(b + 8 + (4 * i));
+        }
+        record.values[28] = (double)(int)crpi_load_le32(b + 116);
+        dio = crpi_load_le32(b + 120);
+        for (i = 0; i < 7; ++i)
+        {
+          record.values[29 + i] = ((dio >> i) & 1) ? 1.0 : 0.0;
+        }
+        publishLWR(ks, record);
+        used += KUKA_STATE_RECORD;
+      }
+
+      while (!ks->binary && (end = (char*)memchr(ks->buffer + used, ';', ks->held - used)) != NULL)
+      {
+        if (crpi_parse_values(ks->buffer + used, end - (ks->buffer + used), " \r\n",
+                              record.values, KUKA_STATE_VALUES) == KUKA_STATE_VALUES)
+        {
+          publishLWR(ks, record);
+        }
+        else
+        {
+          ks->droppedMetric->Inc();
+        }
+        used = (int)(end - ks->buffer) + 1;
+      }
+
+      if (used > 0)
+      {
+        ks->held -= used;
+        memmove(ks->buffer, ks->buffer + used, ks->held);
+      }
+      else if (ks->held >= KUKA_STATE_BUFFER - 1)
+      {
+        //! No terminator (or marker) in a full buffer; discard it and resynchronize on the next
+        //! ';' (or marker)
+        ks->held = 0;
+        ks->droppedMetric->Inc();
+      }
+    }
+    return;
+  }
+
+
   void observerLWR(void *param)
   {
     /*
@@ -111,23 +236,36 @@ namespace crpi_robot
   }
 
 
-  LIBRARY_API CrpiKukaLWR::CrpiKukaLWR (CrpiRobotParams &params)
+  LIBRARY_API CrpiKukaLWR::CrpiKukaLWR (CrpiRobotParams &params) :
+    poseRates_(6),
+    axisRates_(CRPI_AXES_MAX)
   {
     mssgBuffer_ = new char[8192];
+    keepalive_ = -1;
 
 #ifndef OLDSERIAL
     if (ULAPI_OK != ulapi_init())
     {
-#ifdef LWR_NOISY
-      printf("ulapi_init error\n");
-#endif
+      CRPI_LOG(CRPI_LOG_WARNING, "CrpiKukaLWR:  ulapi_init error");
     }
 #endif
 
 #ifndef STATIC_
 
     params_ = params;
-    ka_.handle = ulapi_mutex_new(99);
+    ka_.handle = NULL;
+    ka_.lock = ulapi_fastlock_new();
+    ulapi_lock_name(ka_.lock, "CrpiKukaLWR state");
+
+    useBinary_ = (!params_.use_serial && strcmp(params_.feedback_protocol, "BINARY") == 0);
+    useStateStream_ = (useBinary_ ||
+                       (!params_.use_serial && strcmp(params_.feedback_protocol, "STREAM") == 0));
+    stream_.binary = useBinary_;
+    stream_.runThread = false;
+    stream_.server = -1;
+    stream_.client = -1;
+    stream_.held = 0;
+    stateTask_ = NULL;
 
     if (params_.use_serial)
     {
@@ -136,30 +274,22 @@ namespace crpi_robot
 #else
       if (NULL == (serialID_ = ulapi_serial_new()))
       {
-#ifdef LWR_NOISY
-        printf ("\nCannot create serial object\n");
-#endif
+        CRPI_LOG(CRPI_LOG_WARNING, "CrpiKukaLWR:  Cannot create serial object");
       }
 #endif
 
-#ifdef LWR_NOISY
-        printf ("%s : ", COMChannel_);
-#endif
+        CRPI_LOG(CRPI_LOG_DEBUG, "COM channel %s", COMChannel_);
 
 #ifdef OLDSERIAL
       serialData_.setChannel (params_.serial_port);
 #else
       if (ulapi_serial_open(COMChannel_, serialID_) == ULAPI_OK)
       {
-#ifdef LWR_NOISY
-        printf ("Opened COM channel\n");
-#endif
+        CRPI_LOG(CRPI_LOG_DEBUG, "Opened COM channel");
       }
       else
       {
-#ifdef LWR_NOISY
-        printf ("Could not open COM channel\n");
-#endif
+        CRPI_LOG(CRPI_LOG_WARNING, "CrpiKukaLWR:  Could not open COM channel");
       }
 #endif
 
@@ -168,15 +298,11 @@ namespace crpi_robot
 #else
       if (ulapi_serial_baud(serialID_, val) == ULAPI_OK)
       {
-#ifdef LWR_NOISY
-        printf ("Set BAUD rate successful\n");
-#endif
+        CRPI_LOG(CRPI_LOG_DEBUG, "Set BAUD rate successful");
       }
       else
       {
-#ifdef LWR_NOISY
-        printf ("Could not set BAUD rate\n");
-#endif
+        CRPI_LOG(CRPI_LOG_WARNING, "CrpiKukaLWR:  Could not set BAUD rate");
       }
 #endif
 
@@ -188,28 +314,20 @@ namespace crpi_robot
 #ifdef OLDSERIAL
       if (serial_->attach(serialData_))
       {
-#ifdef LWR_NOISY
-        printf ("serial connection to arm successful\n");
-#endif
+        CRPI_LOG(CRPI_LOG_DEBUG, "serial connection to arm successful");
       }
       else
       {
-#ifdef LWR_NOISY
-        printf ("serial connection to arm failed\n");
-#endif
+        CRPI_LOG(CRPI_LOG_WARNING, "CrpiKukaLWR:  serial connection to arm failed");
       }
 #else
       if (ulapi_serial_set_nonblocking(serialID_) == ULAPI_OK) //set_nonblocking
       {
-#ifdef LWR_NOISY
-        printf ("Set serial port blocking okay\n");
-#endif
+        CRPI_LOG(CRPI_LOG_DEBUG, "Set serial port blocking okay");
       }
       else
       {
-#ifdef LWR_NOISY
-        printf ("Could not set serial port blocking\n");
-#endif
+        CRPI_LOG(CRPI_LOG_WARNING, "CrpiKukaLWR:  Could not set serial port blocking");
       }
       val = ulapi_serial_write(serialID_,
                                 "TBx 1.00000000 0.00000000 0.00000000 0.00000000 0.00000000",
@@ -221,16 +339,33 @@ namespace crpi_robot
       //! Use TCP
 
       //! Wait for connection from LWR
-      printf ("Waiting for connection...\n");
+      CRPI_LOG(CRPI_LOG_INFO, "CrpiKukaLWR:  waiting for connection on port %d", params_.tcp_ip_port);
       server_ = ulapi_socket_get_server_id(params_.tcp_ip_port);
       client_ = ulapi_socket_get_connection_id(server_);
       ulapi_socket_set_blocking(client_);
 
-      task = ulapi_task_new();
       ka_.rob = this;
       ka_.runThread = true;
-
-      ulapi_task_start((ulapi_task_struct*)task, livemanLWR, &ka_, ulapi_prio_lowest(), 0);
+      keepalive_ = SensorHub::Instance().AddPeriodic(livemanLWR, &ka_, KUKA_KEEPALIVE, HUB_MONITOR);
+
+      if (useStateStream_)
+      {
+        //! The KRL state server connects separately once the command connection is up
+        stream_.server = ulapi_socket_get_server_id(params_.tcp_ip_port + KUKA_STATE_PORT_OFFSET);
+        string labels = CrpiMetrics::Label("driver", "kuka_lwr") + "," +
+                        CrpiMetrics::Label("robot", params_.tcp_ip_addr);
+        stream_.framesMetric = CrpiMetrics::Counter("crpi_feedback_frames", "Feedback frames published", labels);
+        stream_.droppedMetric = CrpiMetrics::Counter("crpi_feedback_dropped", "Feedback frames dropped", labels);
+        stream_.rateMetric.gauge = CrpiMetrics::Gauge("crpi_feedback_rate_hz", "Feedback frames published per second",
+                                                      labels);
+        stream_.reconnectMetric = CrpiMetrics::Counter("crpi_reconnects", "Connections re-established",
+                                                       labels + ",link=\"feedback\"");
+        stream_.recordChannel = CrpiRecorder::Channel(string("kuka_lwr/") + params_.tcp_ip_addr);
+        stream_.runThread = true;
+        stateTask_ = ulapi_task_new();
+        SensorHub::Instance().StartTask((ulapi_task_struct*)stateTask_, stateLWR, &stream_, HUB_BACKGROUND,
+                                        &params_.servo_task);
+      }
     }
 #else
     bool test;
@@ -239,18 +374,42 @@ namespace crpi_robot
     serialUsed_ = true;
 #endif
 
-    feedback_ = new double[10];
-    tempData_ = new vector<string>(10, " ");
+    streaming_ = false;
+    wrenchStreaming_ = false;
+    wrenchSelect_ = 0;
+    streamPeriod_ = 0.012;
+    streamLookahead_ = 0.0;
+    streamDeadline_ = 0.5;
 
     angleUnits_ = DEGREE;
     lengthUnits_ = MM;
+    rateLength_ = lengthUnits_;
+    rateAngle_ = angleUnits_;
+    poseRates_.Wrap(3, 3, 360.0);
   }
 
 
   LIBRARY_API CrpiKukaLWR::~CrpiKukaLWR ()
   {
+    //! Waits out a keep-alive in progress before the connection goes away
+    ka_.runThread = false;
+    SensorHub::Instance().RemovePeriodic(keepalive_);
+
+    if (stateTask_ != NULL)
+    {
+      //! The receive thread may be blocked waiting for the controller
+      stream_.runThread = false;
+      ulapi_task_stop((ulapi_task_struct*)stateTask_);
+      ulapi_task_join((ulapi_task_struct*)stateTask_, NULL);
+      ulapi_task_delete((ulapi_task_struct*)stateTask_);
+      if (stream_.client >= 0)
+      {
+        ulapi_socket_close(stream_.client);
+      }
+      ulapi_socket_close(stream_.server);
+    }
+
     delete [] mssgBuffer_;
-    delete [] feedback_;
     if (params_.use_serial)
     {
 #ifdef OLDSERIAL
@@ -267,7 +426,7 @@ namespace crpi_robot
   }
 
 
-  LIBRARY_API CanonReturn CrpiKukaLWR::ApplyCartesianForceTorque (robotPose &robotForceTorque, vector<bool> activeAxes, vector<bool> manipulator)
+  LIBRARY_API CanonReturn CrpiKukaLWR::ApplyCartesianForceTorque (robotPose &robotForceTorque, const vector<bool> &activeAxes, const vector<bool> &manipulator)
   {
     //! TODO
     return CANON_FAILURE;
@@ -283,24 +442,24 @@ namespace crpi_robot
 
   LIBRARY_API CanonReturn CrpiKukaLWR::SetTool (double percent)
   {
-    ulapi_mutex_take(ka_.handle);
+    ulapi_fastlock_take(ka_.lock);
     if (generateTool ('B', percent))
     {
       //! Send message to robot
       if (!send ())
       {
         //! error sending
-        ulapi_mutex_give(ka_.handle);
+        ulapi_fastlock_give(ka_.lock);
         return CANON_FAILURE;
       }
       //! Wait for response from robot
       if (!get ())
       {
         //! error getting
-        ulapi_mutex_give(ka_.handle);
+        ulapi_fastlock_give(ka_.lock);
         return CANON_FAILURE;
       }
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
       if (mssgBuffer_[0] == '1')
       {
         return CANON_SUCCESS;
@@ -313,7 +472,7 @@ namespace crpi_robot
     else
     {
       //! Error generating tool actuation message
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
       return CANON_FAILURE;
     }
   }
@@ -322,39 +481,34 @@ namespace crpi_robot
   LIBRARY_API CanonReturn CrpiKukaLWR::Couple (const char *targetID)
   {
     std::vector<CrpiToolDef>::const_iterator itr;
-    for (itr = params_.tools.begin(); itr != params_.tools.end(); ++itr)
-    {
-      if (strcmp(targetID, itr->toolName.c_str()) == 0)
-      {
-        break;
-      }
-    }
-    if (itr == params_.tools.end())
+    int tool = params_.findTool(targetID);
+    if (tool == CRPI_NO_HANDLE)
     {
       return CANON_FAILURE;
     }
+    itr = params_.tools.begin() + tool;
 
-    ulapi_mutex_take(ka_.handle);
+    ulapi_fastlock_take(ka_.lock);
     if (generateTool('D', itr->toolID))
     {
       //! Send message to robot
       if (!send ())
       {
         //! error sending
-        ulapi_mutex_give(ka_.handle);
+        ulapi_fastlock_give(ka_.lock);
         return CANON_FAILURE;
       }
       //! Wait for response from robot
       if (!get ())
       {
-        ulapi_mutex_give(ka_.handle);
+        ulapi_fastlock_give(ka_.lock);
         return CANON_FAILURE;
       }
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
     }
     else
     {
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
       return CANON_FAILURE;
     }
 
@@ -391,7 +545,7 @@ namespace crpi_robot
     target.push_back (0.0);
     target.push_back (0.0);
 
-    ulapi_mutex_take(ka_.handle);
+    ulapi_fastlock_take(ka_.lock);
     //! LIN, Cartesian, Absolute
     if (generateMove ('L', 'C', 'A', target))
     {
@@ -399,16 +553,16 @@ namespace crpi_robot
       if (!send ())
       {
         //! error sending
-        ulapi_mutex_give(ka_.handle);
+        ulapi_fastlock_give(ka_.lock);
         return CANON_FAILURE;
       }
       //! Wait for response from robot
       if (!get ())
       {
-        ulapi_mutex_give(ka_.handle);
+        ulapi_fastlock_give(ka_.lock);
         return CANON_FAILURE;
       }
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
 
       if (mssgBuffer_[0] == '1')
       {
@@ -422,7 +576,7 @@ namespace crpi_robot
     else
     {
       //! Error generating motion message
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
       return CANON_FAILURE;
     }
   }
@@ -434,19 +588,72 @@ namespace crpi_robot
                                                    robotPose *speeds,
                                                    robotPose *tolerances)
   {
-    bool status = true;
+    if (poses == NULL || numPoses < 1)
+    {
+      return CANON_REJECT;
+    }
+
+    vector<double> radii(numPoses), param(10, 0.0f), target;
+    crpi_blend_radii (poses, numPoses, tolerances, CRPI_DEFAULT_BLEND_MM, &radii[0]);
 
-    //! This is a temporary function definition until the KRL code has been updated to properly handle
-    //! this method
-    for (int x = 0; x < numPoses; ++x)
+    //! 0 keeps $VEL.CP and $ACC.CP unchanged
+    double speed = -1.0f, zone = -1.0f, accel = -1.0f;
+    int start, x;
+
+    ulapi_fastlock_take(ka_.lock);
+    for (start = 0; start < numPoses; start += KUKA_PATH_MAX)
     {
-      status &= (MoveTo (poses[x], true) == CANON_SUCCESS);
-      if (!status)
+      int end = ((start + KUKA_PATH_MAX < numPoses) ? (start + KUKA_PATH_MAX) : numPoses);
+
+      for (x = start; x < end; ++x)
+      {
+        //! mm/s and mm/s^2 to the m/s and m/s^2 used by $VEL.CP and $ACC.CP
+        double v = ((speeds != NULL) ? crpi_translation_norm(speeds[x]) * 0.001f : 0.0f);
+        double a = ((accelerations != NULL) ? crpi_translation_norm(accelerations[x]) * 0.001f : 0.0f);
+        //! The controller stops at the end of each batch
+        double r = ((x == end - 1) ? 0.0f : radii[x]);
+
+        if (v != speed || r != zone || a != accel)
+        {
+          //! Blended path, parameters of the waypoints that follow
+          param.at(0) = speed = v;
+          param.at(1) = zone = r;
+          param.at(2) = accel = a;
+          if (!generateMove ('B', 'P', 'A', param) || !exchange ())
+          {
+            ulapi_fastlock_give(ka_.lock);
+            return CANON_FAILURE;
+          }
+        }
+
+        //! Blended path, queue Cartesian waypoint
+        target.clear();
+        target.push_back (poses[x].x);
+        target.push_back (poses[x].y);
+        target.push_back (poses[x].z);
+        target.push_back (poses[x].zrot);
+        target.push_back (poses[x].yrot);
+        target.push_back (poses[x].xrot);
+        target.push_back (poses[x].status);
+        target.push_back (poses[x].turns);
+        target.push_back (0.0);
+        target.push_back (0.0);
+        if (!generateMove ('B', 'C', 'A', target) || !exchange ())
+        {
+          ulapi_fastlock_give(ka_.lock);
+          return CANON_FAILURE;
+        }
+      }
+
+      //! Blended path, execute.  The controller responds once the last waypoint is reached.
+      param.assign (10, 0.0f);
+      if (!generateMove ('B', 'E', 'A', param) || !exchange ())
       {
-        //! Error when executing multi move
+        ulapi_fastlock_give(ka_.lock);
         return CANON_FAILURE;
       }
     }
+    ulapi_fastlock_give(ka_.lock);
 
     return CANON_SUCCESS;
   }
@@ -469,23 +676,23 @@ namespace crpi_robot
 
     //! PTP, Cartesian, Absolute
     //if (generateMove ('P', 'C', 'R', target)) //! JAM:  for initial testing purposes only
-    ulapi_mutex_take(ka_.handle);
+    ulapi_fastlock_take(ka_.lock);
     if (generateMove ('P', 'C', 'A', target))
     {
       //! Send message to robot
       if (!send())
       {
         //! error sending
-        ulapi_mutex_give(ka_.handle);
+        ulapi_fastlock_give(ka_.lock);
         return CANON_FAILURE;
       }
       //! Wait for response from robot
       if (!get ())
       {
-        ulapi_mutex_give(ka_.handle);
+        ulapi_fastlock_give(ka_.lock);
         return CANON_FAILURE;
       }
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
       if (mssgBuffer_[0] == '1')
       {
         return CANON_SUCCESS;
@@ -498,7 +705,7 @@ namespace crpi_robot
     else
     {
       //! Error generating motion message
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
       return CANON_FAILURE;
     }
   }
@@ -508,32 +715,10 @@ namespace crpi_robot
   {
     //! Construct request for axis information
 
-    ulapi_mutex_take(ka_.handle);
-    if (generateFeedback ('A'))
+    ulapi_fastlock_take(ka_.lock);
+    if (readFeedback ('A', 7))
     {
-      if (!send ())
-      {
-        //! error sending
-        ulapi_mutex_give(ka_.handle);
-        return CANON_FAILURE;
-      }
-      //! Wait for response from robot
-      if (!get ())
-      {
-        //! error receiving
-        ulapi_mutex_give(ka_.handle);
-        return CANON_FAILURE;
-      }
-      
-      //! Parse data
-      if (!parseFeedback (7))
-      {
-        //! Error parsing data
-        ulapi_mutex_give(ka_.handle);
-        return CANON_FAILURE;
-      }
-
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
       try
       {
         for (int i = 0; i < axes->axes; ++i)
@@ -546,13 +731,17 @@ namespace crpi_robot
         //! probably an axis violation due to vector missmatch
         return CANON_FAILURE;
       }
-    } // if generateFeedback ('A')
+    } // if readFeedback ('A', 7)
     else
     {
-      //! Error generating feedback request message
-      ulapi_mutex_give(ka_.handle);
+      //! Error requesting or parsing feedback
+      ulapi_fastlock_give(ka_.lock);
       return CANON_FAILURE;
     }
+    ulapi_fastlock_take(ka_.lock);
+    latest_.setAxes(*axes);
+    publishState(STATE_AXES);
+    ulapi_fastlock_give(ka_.lock);
     return CANON_SUCCESS;
   }
 
@@ -560,30 +749,10 @@ namespace crpi_robot
   LIBRARY_API CanonReturn CrpiKukaLWR::GetRobotForces (robotPose *forces)
   {
     //! Construct request for axis information
-    ulapi_mutex_take(ka_.handle);
-    if (generateFeedback('F'))
+    ulapi_fastlock_take(ka_.lock);
+    if (readFeedback ('F', 6))
     {
-      if (!send())
-      {
-        //! error sending
-        ulapi_mutex_give(ka_.handle);
-        return CANON_FAILURE;
-      }
-      //! Wait for response from robot
-      if (!get())
-      {
-        //! error receiving
-        ulapi_mutex_give(ka_.handle);
-        return CANON_FAILURE;
-      }
-      //! Parse data
-      if (!parseFeedback(6))
-      {
-        //! Error parsing data
-        ulapi_mutex_give(ka_.handle);
-        return CANON_FAILURE;
-      }
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
 
       try
       {
@@ -602,11 +771,15 @@ namespace crpi_robot
     }
     else
     {
-      //! Error generating feedback request message
-      ulapi_mutex_give(ka_.handle);
+      //! Error requesting or parsing feedback
+      ulapi_fastlock_give(ka_.lock);
       return CANON_FAILURE;
     }
 
+    ulapi_fastlock_take(ka_.lock);
+    latest_.forces = *forces;
+    publishState(STATE_FORCES);
+    ulapi_fastlock_give(ka_.lock);
     return CANON_SUCCESS;
   }
 
@@ -614,30 +787,10 @@ namespace crpi_robot
   LIBRARY_API CanonReturn CrpiKukaLWR::GetRobotIO (robotIO *io)
   {
     //! Construct request for axis information
-    ulapi_mutex_take(ka_.handle);
-    if (generateFeedback('S'))
+    ulapi_fastlock_take(ka_.lock);
+    if (readFeedback ('S', 8))
     {
-      if (!send())
-      {
-        //! error sending
-        ulapi_mutex_give(ka_.handle);
-        return CANON_FAILURE;
-      }
-      //! Wait for response from robot
-      if (!get())
-      {
-        //! error receiving
-        ulapi_mutex_give(ka_.handle);
-        return CANON_FAILURE;
-      }
-      //! Parse data
-      if (!parseFeedback(8))
-      {
-        //! Error parsing data
-        ulapi_mutex_give(ka_.handle);
-        return CANON_FAILURE;
-      }
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
 
       try
       {
@@ -657,11 +810,15 @@ namespace crpi_robot
     }
     else
     {
-      //! Error generating feedback request message
-      ulapi_mutex_give(ka_.handle);
+      //! Error requesting or parsing feedback
+      ulapi_fastlock_give(ka_.lock);
       return CANON_FAILURE;
     }
 
+    ulapi_fastlock_take(ka_.lock);
+    latest_.setIO(*io);
+    publishState(STATE_IO);
+    ulapi_fastlock_give(ka_.lock);
     return CANON_SUCCESS;
   }
 
@@ -669,30 +826,10 @@ namespace crpi_robot
   LIBRARY_API CanonReturn CrpiKukaLWR::GetRobotPose (robotPose *pose)
   {
     //! Construct request for axis information
-    ulapi_mutex_take(ka_.handle);
-    if (generateFeedback ('C'))
+    ulapi_fastlock_take(ka_.lock);
+    if (readFeedback ('C', 8))
     {
-      if (!send ())
-      {
-        //! error sending
-        ulapi_mutex_give(ka_.handle);
-        return CANON_FAILURE;
-      }
-      //! Wait for response from robot
-      if (!get ())
-      {
-        //! error receiving
-        ulapi_mutex_give(ka_.handle);
-        return CANON_FAILURE;
-      }
-      //! Parse data
-      if (!parseFeedback (8))
-      {
-        //! Error parsing data
-        ulapi_mutex_give(ka_.handle);
-        return CANON_FAILURE;
-      }
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
 
       try
       {
@@ -733,56 +870,57 @@ namespace crpi_robot
     }
     else
     {
-      //! Error generating feedback request message
-      ulapi_mutex_give(ka_.handle);
+      //! Error requesting or parsing feedback
+      ulapi_fastlock_give(ka_.lock);
       return CANON_FAILURE;
     }
 
+    ulapi_fastlock_take(ka_.lock);
+    latest_.pose = *pose;
+    publishState(STATE_POSE);
+    ulapi_fastlock_give(ka_.lock);
     return CANON_SUCCESS;
   }
 
 
   LIBRARY_API CanonReturn CrpiKukaLWR::GetRobotSpeed (robotPose *speed)
   {
-    //! TODO
-    return CANON_FAILURE;
+    RobotStateSnapshot state;
+
+    //! Estimated from the poses read so far (by the application or the keep-alive thread)
+    if (state_.read(state) == 0 || (state.valid & STATE_SPEEDS) == 0)
+    {
+      return CANON_FAILURE;
+    }
+    *speed = state.speeds;
+    return CANON_SUCCESS;
   }
 
 
   LIBRARY_API CanonReturn CrpiKukaLWR::GetRobotSpeed (robotAxes *speed)
   {
-    //! TODO
-    return CANON_FAILURE;
+    CrpiMotionRates rates;
+
+    ratesPub_.read(rates);
+    if (rates.axes == 0)
+    {
+      return CANON_FAILURE;
+    }
+    for (int i = 0; i < rates.axes && i < speed->axes; ++i)
+    {
+      speed->axis[i] = rates.axisSpeed[i];
+    }
+    return CANON_SUCCESS;
   }
 
 
   LIBRARY_API CanonReturn CrpiKukaLWR::GetRobotTorques (robotAxes *torques)
   {
     //! Construct request for axis information
-    ulapi_mutex_take(ka_.handle);
-    if (generateFeedback('T'))
+    ulapi_fastlock_take(ka_.lock);
+    if (readFeedback ('T', 6))
     {
-      if (!send())
-      {
-        //! error sending
-        ulapi_mutex_give(ka_.handle);
-        return CANON_FAILURE;
-      }
-      //! Wait for response from robot
-      if (!get())
-      {
-        //! error receiving
-        ulapi_mutex_give(ka_.handle);
-        return CANON_FAILURE;
-      }
-      //! Parse data
-      if (!parseFeedback(6))
-      {
-        //! Error parsing data
-        ulapi_mutex_give(ka_.handle);
-        return CANON_FAILURE;
-      }
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
 
       try
       {
@@ -810,15 +948,133 @@ namespace crpi_robot
     }
     else
     {
-      //! Error generating feedback request message
-      ulapi_mutex_give(ka_.handle);
+      //! Error requesting or parsing feedback
+      ulapi_fastlock_give(ka_.lock);
       return CANON_FAILURE;
     }
 
+    ulapi_fastlock_take(ka_.lock);
+    for (int i = 0; i < torques->axes && i < CRPI_AXES_MAX; ++i)
+    {
+      latest_.torque[i] = torques->axis[i];
+    }
+    publishState(STATE_TORQUES);
+    ulapi_fastlock_give(ka_.lock);
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiKukaLWR::GetRobotState (RobotStateSnapshot *state)
+  {
+    if (useStateStream_)
+    {
+      //! Refresh every field from the streamed record; no controller round trips are needed
+      robotPose pose, forces;
+      robotAxes axes(7), torques(7);
+      robotIO io;
+      GetRobotPose(&pose);
+      GetRobotAxes(&axes);
+      GetRobotForces(&forces);
+      GetRobotTorques(&torques);
+      GetRobotIO(&io);
+    }
+
+    //! Holds whatever the most recent Get* calls (including the keep-alive thread's) returned
+    if (state_.read(*state) == 0)
+    {
+      return CANON_REJECT;
+    }
     return CANON_SUCCESS;
   }
 
 
+  LIBRARY_API CanonReturn CrpiKukaLWR::GetPredictedState (RobotStateSnapshot *state, double lead)
+  {
+    CrpiMotionRates rates;
+    int i;
+
+    //! The rates are published just before their state, so a state newer than the rates read
+    //! first was published in between; read both again
+    for (i = 0; i < 3; ++i)
+    {
+      ratesPub_.read(rates);
+      if (state_.read(*state) == 0)
+      {
+        return CANON_REJECT;
+      }
+      if (rates.sequence == state->sequence)
+      {
+        break;
+      }
+    }
+
+    return crpi_predict_state(*state, rates, ulapi_time() + lead) ? CANON_SUCCESS : CANON_REJECT;
+  }
+
+
+  void CrpiKukaLWR::publishState (unsigned int field)
+  {
+    double values[6], accel[6];
+
+    latest_.valid |= field;
+    latest_.timestamp = ulapi_time();
+    ++latest_.sequence;
+
+    //! Samples taken in other units cannot be fitted together
+    if (lengthUnits_ != rateLength_ || angleUnits_ != rateAngle_)
+    {
+      poseRates_.Reset();
+      axisRates_.Reset();
+      poseRates_.Wrap(3, 3, (angleUnits_ == DEGREE) ? 360.0 : (2.0 * 3.141592654));
+      rateLength_ = lengthUnits_;
+      rateAngle_ = angleUnits_;
+      latest_.valid &= ~STATE_SPEEDS;
+      rates_.axes = 0;
+    }
+
+    if (field == STATE_POSE)
+    {
+      values[0] = latest_.pose.x;
+      values[1] = latest_.pose.y;
+      values[2] = latest_.pose.z;
+      values[3] = latest_.pose.xrot;
+      values[4] = latest_.pose.yrot;
+      values[5] = latest_.pose.zrot;
+      poseRates_.Add(latest_.timestamp, values);
+      if (poseRates_.Estimate(values, accel))
+      {
+        latest_.speeds.x = values[0];
+        latest_.speeds.y = values[1];
+        latest_.speeds.z = values[2];
+        latest_.speeds.xrot = values[3];
+        latest_.speeds.yrot = values[4];
+        latest_.speeds.zrot = values[5];
+        latest_.valid |= STATE_SPEEDS;
+        rates_.poseAccel.x = accel[0];
+        rates_.poseAccel.y = accel[1];
+        rates_.poseAccel.z = accel[2];
+        rates_.poseAccel.xrot = accel[3];
+        rates_.poseAccel.yrot = accel[4];
+        rates_.poseAccel.zrot = accel[5];
+        rates_.poseTime = poseRates_.Time();
+      }
+    }
+    else if (field == STATE_AXES)
+    {
+      axisRates_.Add(latest_.timestamp, latest_.axis);
+      if (axisRates_.Estimate(rates_.axisSpeed, rates_.axisAccel))
+      {
+        rates_.axes = latest_.axes;
+        rates_.axisTime = axisRates_.Time();
+      }
+    }
+
+    rates_.sequence = latest_.sequence;
+    ratesPub_.write(rates_);
+    state_.write(latest_);
+  }
+
+
   LIBRARY_API CanonReturn CrpiKukaLWR::MoveAttractor (robotPose &pose)
   {
     //! Construct message
@@ -834,23 +1090,23 @@ namespace crpi_robot
     target.push_back (0.0);
     target.push_back (0.0);
 
-    ulapi_mutex_take(ka_.handle);
+    ulapi_fastlock_take(ka_.lock);
     if (generateMove ('L', 'F', 'A', target))
     {
       //! Send message to robot
       if (!send ())
       {
         //! error sending
-        ulapi_mutex_give(ka_.handle);
+        ulapi_fastlock_give(ka_.lock);
         return CANON_FAILURE;
       }
       //! Wait for response from robot
       if (!get ())
       {
-        ulapi_mutex_give(ka_.handle);
+        ulapi_fastlock_give(ka_.lock);
         return CANON_FAILURE;
       }
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
 
       if (mssgBuffer_[0] == '1')
       {
@@ -864,7 +1120,7 @@ namespace crpi_robot
     else
     {
       //! Error generating motion message
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
       return CANON_FAILURE;
     }
 
@@ -882,28 +1138,28 @@ namespace crpi_robot
     }
 
     //! PTP, Angular, Absolute
-    ulapi_mutex_take(ka_.handle);
+    ulapi_fastlock_take(ka_.lock);
     if (generateMove ('P', 'A', 'A', target))
     {
       //! Send message to robot
       if (!send())
       {
         //! error sending
-        ulapi_mutex_give(ka_.handle);
+        ulapi_fastlock_give(ka_.lock);
         return CANON_FAILURE;
       }
       //! Wait for response from robot
       if (!get ())
       {
-        ulapi_mutex_give(ka_.handle);
+        ulapi_fastlock_give(ka_.lock);
         return CANON_FAILURE;
       }
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
     }
     else
     {
       //! Error generating motion message
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
       return CANON_FAILURE;
     }
 
@@ -911,6 +1167,209 @@ namespace crpi_robot
   }
 
 
+  LIBRARY_API CanonReturn CrpiKukaLWR::BeginStream ()
+  {
+    vector<double> target(10, 0.0);
+    CanonReturn val;
+
+    if (streaming_ || wrenchStreaming_)
+    {
+      return CANON_REJECT;
+    }
+
+    target.at(0) = streamPeriod_;
+    target.at(1) = streamDeadline_;
+    target.at(2) = streamLookahead_;
+
+    if ((val = streamCommand('B', target)) == CANON_SUCCESS)
+    {
+      streaming_ = true;
+    }
+    return val;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiKukaLWR::StreamPose (robotPose &pose)
+  {
+    vector<double> target;
+
+    if (!streaming_)
+    {
+      return CANON_REJECT;
+    }
+
+    target.push_back (pose.x);
+    target.push_back (pose.y);
+    target.push_back (pose.z);
+    target.push_back (pose.zrot);
+    target.push_back (pose.yrot);
+    target.push_back (pose.xrot);
+    target.push_back (pose.status);
+    target.push_back (pose.turns);
+    target.push_back (0.0);
+    target.push_back (0.0);
+
+    return streamCommand('C', target);
+  }
+
+
+  LIBRARY_API CanonReturn CrpiKukaLWR::StreamAxes (robotAxes &axes)
+  {
+    vector<double> target;
+
+    if (!streaming_)
+    {
+      return CANON_REJECT;
+    }
+
+    for (int i = 0; i < axes.axes; ++i)
+    {
+      target.push_back (axes.axis.at(i));
+    }
+
+    return streamCommand('A', target);
+  }
+
+
+  LIBRARY_API CanonReturn CrpiKukaLWR::EndStream ()
+  {
+    vector<double> target(10, 0.0);
+
+    if (!streaming_)
+    {
+      return CANON_REJECT;
+    }
+
+    streaming_ = false;
+    return streamCommand('E', target);
+  }
+
+
+  LIBRARY_API CanonReturn CrpiKukaLWR::BeginWrenchStream ()
+  {
+    robotPose limits;
+    CanonReturn val;
+
+    if (streaming_ || wrenchStreaming_)
+    {
+      return CANON_REJECT;
+    }
+
+    //! Cartesian impedance holding the current pose, with the controller's default limits
+    //! until the first StreamWrench
+    if ((val = wrenchCommand(0, limits)) == CANON_SUCCESS)
+    {
+      wrenchStreaming_ = true;
+    }
+    return val;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiKukaLWR::StreamWrench (robotPose &wrench, const vector<bool> &activeAxes, robotPose &limits)
+  {
+    vector<double> target(10, 0.0);
+    CanonReturn val;
+    int select = 0;
+
+    if (!wrenchStreaming_)
+    {
+      return CANON_REJECT;
+    }
+
+    for (size_t i = 0; i < activeAxes.size() && i < 6; ++i)
+    {
+      if (activeAxes.at(i))
+      {
+        select |= (1 << i);
+      }
+    }
+
+    //! Stiffness changes are only sent when the selection or limits change, so a steady
+    //! stream is one command per target
+    if (select != wrenchSelect_ ||
+        limits.x != wrenchLimits_[0] || limits.y != wrenchLimits_[1] || limits.z != wrenchLimits_[2] ||
+        limits.xrot != wrenchLimits_[3] || limits.yrot != wrenchLimits_[4] || limits.zrot != wrenchLimits_[5])
+    {
+      if ((val = wrenchCommand(select, limits)) != CANON_SUCCESS)
+      {
+        return val;
+      }
+    }
+
+    target.at(0) = wrench.x;
+    target.at(1) = wrench.y;
+    target.at(2) = wrench.z;
+    target.at(3) = wrench.xrot;
+    target.at(4) = wrench.yrot;
+    target.at(5) = wrench.zrot;
+
+    return streamCommand('W', target);
+  }
+
+
+  LIBRARY_API CanonReturn CrpiKukaLWR::EndWrenchStream ()
+  {
+    vector<double> target(10, 0.0);
+
+    if (!wrenchStreaming_)
+    {
+      return CANON_REJECT;
+    }
+
+    wrenchStreaming_ = false;
+    return streamCommand('E', target);
+  }
+
+
+  LIBRARY_API CanonReturn CrpiKukaLWR::wrenchCommand (int select, robotPose &limits)
+  {
+    vector<double> target(10, 0.0);
+    CanonReturn val;
+
+    target.at(0) = select;
+    target.at(1) = limits.x;
+    target.at(2) = limits.y;
+    target.at(3) = limits.z;
+    target.at(4) = limits.xrot;
+    target.at(5) = limits.yrot;
+    target.at(6) = limits.zrot;
+    target.at(7) = streamPeriod_;
+    target.at(8) = streamDeadline_;
+
+    if ((val = streamCommand('I', target)) == CANON_SUCCESS)
+    {
+      wrenchSelect_ = select;
+      wrenchLimits_[0] = limits.x;
+      wrenchLimits_[1] = limits.y;
+      wrenchLimits_[2] = limits.z;
+      wrenchLimits_[3] = limits.xrot;
+      wrenchLimits_[4] = limits.yrot;
+      wrenchLimits_[5] = limits.zrot;
+    }
+    return val;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiKukaLWR::streamCommand (char posType, vector<double> &input)
+  {
+    ulapi_fastlock_take(ka_.lock);
+    if (!generateMove ('S', posType, 'A', input) || !send ())
+    {
+      ulapi_fastlock_give(ka_.lock);
+      return CANON_FAILURE;
+    }
+    //! Acknowledgement only; the controller does not wait for the robot to reach the setpoint
+    if (!get ())
+    {
+      ulapi_fastlock_give(ka_.lock);
+      return CANON_FAILURE;
+    }
+    ulapi_fastlock_give(ka_.lock);
+
+    return ((mssgBuffer_[0] == '1') ? CANON_SUCCESS : CANON_FAILURE);
+  }
+
+
   LIBRARY_API CanonReturn CrpiKukaLWR::SetAbsoluteAcceleration (double tolerance)
   {
     //! Not yet implemented
@@ -996,8 +1455,49 @@ namespace crpi_robot
 
   LIBRARY_API CanonReturn CrpiKukaLWR::SetParameter (const char *paramName, void *paramVal)
   {
-    //! Not yet implemented
-    return CANON_REJECT;
+    //! Tool definitions from CrpiRobot::ReloadConfig, taken even while streaming
+    if (paramVal != NULL && strcmp(paramName, "tools") == 0)
+    {
+      params_.tools = *((std::vector<CrpiToolDef>*)paramVal);
+      params_.reindex();
+      return CANON_SUCCESS;
+    }
+    if (paramVal == NULL || streaming_ || wrenchStreaming_)
+    {
+      return CANON_REJECT;
+    }
+
+    if (strcmp(paramName, "native_program") == 0)
+    {
+      crpiNativeProgram *native = (crpiNativeProgram*)paramVal;
+      if (native->run)
+      {
+        CRPI_LOG(CRPI_LOG_ERROR, "CrpiKukaLWR:  native programs can be translated but not uploaded");
+        return CANON_REJECT;
+      }
+      native->completed = 0;
+      return ((native->program != NULL && generateNative (*native)) ? CANON_SUCCESS : CANON_REJECT);
+    }
+
+    //! Streaming settings take effect on the next BeginStream or BeginWrenchStream
+    if (strcmp(paramName, "stream_period") == 0)
+    {
+      streamPeriod_ = *((double*)paramVal);
+    }
+    else if (strcmp(paramName, "stream_lookahead") == 0)
+    {
+      streamLookahead_ = *((double*)paramVal);
+    }
+    else if (strcmp(paramName, "stream_deadline") == 0)
+    {
+      streamDeadline_ = *((double*)paramVal);
+    }
+    else
+    {
+      //! Not yet implemented
+      return CANON_REJECT;
+    }
+    return CANON_SUCCESS;
   }
 
 
@@ -1030,28 +1530,28 @@ namespace crpi_robot
   LIBRARY_API CanonReturn CrpiKukaLWR::SetRobotDO (int dig_out, bool val)
   {
     //! Construct digital signal output command
-    ulapi_mutex_take(ka_.handle);
+    ulapi_fastlock_take(ka_.lock);
     if (generateIO('D', dig_out, val))
     {
       //! Send message to robot
       if (!send())
       {
         //! error sending
-        ulapi_mutex_give(ka_.handle);
+        ulapi_fastlock_give(ka_.lock);
         return CANON_FAILURE;
       }
       //! Wait for response from robot
       if (!get())
       {
-        ulapi_mutex_give(ka_.handle);
+        ulapi_fastlock_give(ka_.lock);
         return CANON_FAILURE;
       }
-      ulapi_mutex_give(ka_.handle);
+      ulapi_fastlock_give(ka_.lock);
     }
     else
     {
-      //! Error generating feedback request message
-      ulapi_mutex_give(ka_.handle);
+      //! Error requesting or parsing feedback
+      ulapi_fastlock_give(ka_.lock);
       return CANON_FAILURE;
     }
     return CANON_SUCCESS;
@@ -1089,6 +1589,7 @@ namespace crpi_robot
 
   LIBRARY_API bool CrpiKukaLWR::generateMove (char moveType, char posType, char deltaType, vector<double> &input)
   {
+    CrpiTraceSpan span("CrpiKukaLWR::generateMove", CRPI_TRACE_GENERATE);
     bool state = true;
     size_t found;
     int extension = 0,
@@ -1098,9 +1599,17 @@ namespace crpi_robot
 
     //! Check validity of inputs...
     //!   Check movement type
-    state &= (moveType == 'P' || moveType == 'L');
+    state &= (moveType == 'P' || moveType == 'L' || moveType == 'S' || moveType == 'B');
     //!   Check position type
-    state &= (posType == 'C' || posType == 'A' || posType == 'F');
+    if (moveType == 'B')
+    {
+      state &= (posType == 'P' || posType == 'C' || posType == 'E');
+    }
+    else
+    {
+      state &= (posType == 'C' || posType == 'A' || posType == 'F' ||
+                (moveType == 'S' && (posType == 'B' || posType == 'E' || posType == 'I' || posType == 'W')));
+    }
     //!   Check absolute or relative motion
     state &= (deltaType == 'A' || deltaType == 'R');
     //!   Check PTP-only angle movements
@@ -1111,19 +1620,25 @@ namespace crpi_robot
     if (!state)
     {
       //! Invalid arguments generating move
-      return false;
+      return span.End(false);
     }
 
-    //! Clear variables
-    moveMe_.str(string());
-    tempString_.str(string());
-
     if (moveType == 'F')
     {
       //! Overwrite any attempt to do joint angle force motion
       posType = 'C';
     }
 
+    if (useBinary_)
+    {
+      char cmd[3] = {moveType, posType, deltaType};
+      return span.End(generateFrame (cmd, (input.empty() ? NULL : &input[0]), (int)input.size()));
+    }
+
+    //! Clear variables
+    moveMe_.str(string());
+    tempString_.str(string());
+
     if (params_.use_serial)
     {
       moveMe_ << moveType << posType << deltaType;
@@ -1181,19 +1696,172 @@ namespace crpi_robot
       moveMe_ << "</Values></CRPIData>";
     }
 
-    return true;
+    return span.End(true);
+  }
+
+
+  //! @brief Appends the KRL of each step.  Poses are in mm and degrees, with A, B, and C the
+  //!        rotations about Z, Y, and X as in the driver's commands, and output n is $OUT[n + 1]
+  //!        as input n is $IN[n + 1] in the state server.
+  //!
+  class CrpiKukaLWR::nativeWriter : public CrpiNativeWriter
+  {
+  public:
+    nativeWriter (CrpiKukaLWR &robot, ostringstream &src) :
+      CrpiNativeWriter(robot.lengthUnits_, robot.angleUnits_),
+      src_(src),
+      radius_(-1.0)
+    {
+    }
+
+  protected:
+    bool move (CanonCommand cmd, const robotPose &pose, double radius)
+    {
+      double length = crpi_length_scale(length_, MM), angle = crpi_angle_scale(angle_, DEGREE);
+
+      radius *= length;
+      if (radius > 0.0 && radius != radius_)
+      {
+        src_ << "  $APO.CDIS = " << radius << "\r\n";
+        radius_ = radius;
+      }
+      src_ << "  " << ((cmd == CmdMoveTo) ? "PTP" : "LIN") << " {POS: X " << (pose.x * length) << ", Y "
+           << (pose.y * length) << ", Z " << (pose.z * length) << ", A " << (pose.zrot * angle) << ", B "
+           << (pose.yrot * angle) << ", C " << (pose.xrot * angle) << ", S " << pose.status << ", T "
+           << pose.turns << "}" << ((radius > 0.0) ? " C_DIS" : "") << "\r\n";
+      return true;
+    }
+
+    bool axes (const robotAxes &joints)
+    {
+      //! Joints in the order the driver sends them:  A1, A2, E1 (the elbow), A3, A4, A5, A6
+      static const char *names[axisCount] = {"A1", "A2", "E1", "A3", "A4", "A5", "A6"};
+      double scale = crpi_angle_scale(angle_, DEGREE);
+
+      if (joints.axes < axisCount)
+      {
+        return false;
+      }
+      src_ << "  PTP {E6AXIS: ";
+      for (int i = 0; i < axisCount; ++i)
+      {
+        src_ << (i > 0 ? ", " : "") << names[i] << " " << (joints.axis.at(i) * scale);
+      }
+      src_ << "}\r\n";
+      return true;
+    }
+
+    bool output (int signal, bool value)
+    {
+      if (signal < 0)
+      {
+        return false;
+      }
+      src_ << "  $OUT[" << (signal + 1) << "] = " << (value ? "TRUE" : "FALSE") << "\r\n";
+      return true;
+    }
+
+    bool dwell (double seconds)
+    {
+      if (seconds > 0.0)
+      {
+        src_ << "  WAIT SEC " << seconds << "\r\n";
+      }
+      return true;
+    }
+
+    bool message (const string &text)
+    {
+      string line = text;
+      replace(line.begin(), line.end(), '\r', ' ');
+      replace(line.begin(), line.end(), '\n', ' ');
+      src_ << "  ; " << line << "\r\n";
+      return true;
+    }
+
+    bool speed (double value, bool relative)
+    {
+      if (value < 0.0 || (relative && value > 1.0))
+      {
+        return false;
+      }
+      if (relative)
+      {
+        src_ << "  BAS(#VEL_PTP, " << (value * 100.0) << ")\r\n";
+        src_ << "  $VEL.CP = " << value << " * $VEL_MA.CP\r\n";
+      }
+      else
+      {
+        src_ << "  $VEL.CP = " << (value * crpi_length_scale(length_, METER)) << "\r\n";
+      }
+      return true;
+    }
+
+    bool acceleration (double value, bool relative)
+    {
+      if (value < 0.0 || (relative && value > 1.0))
+      {
+        return false;
+      }
+      if (relative)
+      {
+        src_ << "  BAS(#ACC_PTP, " << (value * 100.0) << ")\r\n";
+        src_ << "  $ACC.CP = " << value << " * $ACC_MA.CP\r\n";
+      }
+      else
+      {
+        src_ << "  $ACC.CP = " << (value * crpi_length_scale(length_, METER)) << "\r\n";
+      }
+      return true;
+    }
+
+  private:
+    ostringstream &src_;
+    double radius_;
+  };
+
+
+  LIBRARY_API bool CrpiKukaLWR::generateNative (crpiNativeProgram &native)
+  {
+    CrpiTraceSpan span("CrpiKukaLWR::generateNative", CRPI_TRACE_GENERATE);
+    ostringstream src;
+    nativeWriter writer(*this, src);
+
+    src.precision(9);
+    src << "&ACCESS RVP\r\n";
+    src << "&REL 1\r\n";
+    src << "DEF CRPI_Native()\r\n";
+    src << "  ; Translated by CRPI from a compiled program\r\n";
+    src << "  BAS(#INITMOV, 0)\r\n";
+    src << "  BAS(#VEL_PTP, 20)\r\n";
+    src << "  $VEL.CP = 0.2\r\n";
+    if (!writer.write(*native.program))
+    {
+      return span.End(false);
+    }
+    src << "END\r\n";
+    native.text = src.str();
+
+    return span.End(true);
   }
 
 
   LIBRARY_API bool CrpiKukaLWR::generateTool (char mode, double value)
   {
+    CrpiTraceSpan span("CrpiKukaLWR::generateTool", CRPI_TRACE_GENERATE);
     if (!(mode == 'B' || mode == 'A'  || mode == 'D'))
     {
-      return false;
+      return span.End(false);
     }
     size_t found;
     int currLength, j;
 
+    if (useBinary_)
+    {
+      char cmd[3] = {'T', mode, 'x'};
+      return span.End(generateFrame (cmd, &value, 1));
+    }
+
     moveMe_.str(string());
 
     if (!params_.use_serial)
@@ -1239,19 +1907,24 @@ namespace crpi_robot
     {
       moveMe_ << "</V1><V2>0.00000000</V2><V3>0.00000000</V3><V4>0.00000000</V4><V5>0.00000000</V5><V6>0.00000000</V6><V7>0.00000000</V7><V8>0.00000000</V8><V9>0.00000000</V9><V10>0.00000000</V10></Values></CRPIData>";
     }
-#ifdef LWR_NOISY
-    printf(moveMe_.str().c_str());
-#endif
-    return true;
+    CRPI_LOG(CRPI_LOG_DEBUG, "%s", moveMe_.str().c_str());
+    return span.End(true);
   }
 
 
   LIBRARY_API bool CrpiKukaLWR::generateFeedback (char retType)
   {
+    CrpiTraceSpan span("CrpiKukaLWR::generateFeedback", CRPI_TRACE_GENERATE);
     if (retType != 'C' && retType != 'A' && retType != 'F' && retType != 'T' && retType != 'S')
     {
       //! Unsupported variable
-      return false;
+      return span.End(false);
+    }
+
+    if (useBinary_)
+    {
+      char cmd[3] = {retType, 'x', 'x'};
+      return span.End(generateFrame (cmd, NULL, 0));
     }
 
     moveMe_.str(string());
@@ -1271,7 +1944,7 @@ namespace crpi_robot
     {
       moveMe_ << "xx</CMD><Values><V1>0.00000000</V1><V2>0.00000000</V2><V3>0.00000000</V3><V4>0.00000000</V4><V5>0.00000000</V5><V6>0.00000000</V6><V7>0.00000000</V7><V8>0.00000000</V8><V9>0.00000000</V9><V10>0.00000000</V10></Values></CRPIData>";
     }
-    return true;
+    return span.End(true);
   }
 
 
@@ -1283,6 +1956,13 @@ namespace crpi_robot
       return false;
     }
 
+    if (useBinary_)
+    {
+      char cmd[3] = {'I', sigtype, 'x'};
+      double values[2] = {(double)signum, val};
+      return generateFrame (cmd, values, 2);
+    }
+
     moveMe_.str(string());
 
     if (!params_.use_serial)
@@ -1306,6 +1986,7 @@ namespace crpi_robot
 
   LIBRARY_API bool CrpiKukaLWR::generateParameter (char paramType, char subType, vector<double> &input)
   {
+    CrpiTraceSpan span("CrpiKukaLWR::generateParameter", CRPI_TRACE_GENERATE);
     size_t found;
     int j = 0, currLength = 0;
     
@@ -1324,7 +2005,7 @@ namespace crpi_robot
       }
       else
       {
-        return false;
+        return span.End(false);
       }
       break;
     case 'S':
@@ -1334,7 +2015,7 @@ namespace crpi_robot
         //! Absolute
         if (input[0] > 2.0 || input[0] < 0.0)
         {
-          return false;
+          return span.End(false);
         }
       }
       else if (subType == 'R')
@@ -1342,12 +2023,18 @@ namespace crpi_robot
         //! Relative
         if (input[0] > 100 || input[0] < 0)
         {
-          return false;
+          return span.End(false);
         }
       }
       else
       {
-        return false;
+        return span.End(false);
+      }
+
+      if (useBinary_)
+      {
+        char cmd[3] = {'V', paramType, subType};
+        return span.End(generateFrame (cmd, &input[0], 1));
       }
 
       moveMe_.str (string());
@@ -1395,63 +2082,68 @@ namespace crpi_robot
 
       break;
     default:
-      return false;
+      return span.End(false);
     }
     
-    return true;
+    return span.End(true);
   }
 
   
   LIBRARY_API bool CrpiKukaLWR::send ()
   {
+    CrpiTraceSpan span("CrpiKukaLWR::send", CRPI_TRACE_SEND);
     int x;
     
-#ifdef LWR_NOISY
-    printf ("Sending message %s\n", moveMe_.str().c_str());
-    printf ("fflushhhhhh...\n");
-#endif
+    CRPI_LOG(CRPI_LOG_DEBUG, "Sending message %s", moveMe_.str().c_str());
+    CRPI_LOG(CRPI_LOG_DEBUG, "fflushhhhhh...");
     //fflush(NULL);
-#ifdef LWR_NOISY
-    printf ("flushed\n");
-#endif
+    CRPI_LOG(CRPI_LOG_DEBUG, "flushed");
     if (params_.use_serial)
     {
       //! Use Serial
 #ifdef OLDSERIAL
-#ifdef LWR_NOISY
-    printf ("Sending...\n");
-#endif
+    CRPI_LOG(CRPI_LOG_DEBUG, "Sending...");
       serial_->sendData(moveMe_.str().c_str(), serialData_);
-#ifdef LWR_NOISY
-    printf ("Sent!\n");
-#endif
+    CRPI_LOG(CRPI_LOG_DEBUG, "Sent!");
 #else
       x = ulapi_serial_write(serialID_, moveMe_.str().c_str(), strlen(moveMe_.str().c_str())+1);
-#ifdef LWR_NOISY
-      printf ("%i\n", x);
+      CRPI_LOG(CRPI_LOG_DEBUG, "%i", x);
 #endif
-#endif
-      return true;
+      return span.End(true);
+    }
+    else if (useBinary_)
+    {
+      //! EKI binary frame
+      x = ulapi_socket_write(client_, frame_, KUKA_FRAME_BYTES);
+      CRPI_LOG(CRPI_LOG_DEBUG, "%i", x);
+      return span.End(x == KUKA_FRAME_BYTES);
     }
     else
     {
       //! Use TCP/IP
       x = ulapi_socket_write(client_, moveMe_.str().c_str(), strlen(moveMe_.str().c_str())+1);
-#ifdef LWR_NOISY
-      printf ("%i\n", x);
-#endif
-      return true;
+      CRPI_LOG(CRPI_LOG_DEBUG, "%i", x);
+      return span.End(true);
+    }
+  }
+
+
+  LIBRARY_API bool CrpiKukaLWR::exchange ()
+  {
+    if (!send () || !get ())
+    {
+      return false;
     }
+    return (mssgBuffer_[0] == '1');
   }
 
 
   LIBRARY_API bool CrpiKukaLWR::get ()
   {
+    CrpiTraceSpan span("CrpiKukaLWR::get", CRPI_TRACE_WAIT);
     int x = 0;
 
-#ifdef LWR_NOISY
-      printf ("getting feedback...\n");
-#endif
+      CRPI_LOG(CRPI_LOG_DEBUG, "getting feedback...");
 
     if (params_.use_serial)
     {
@@ -1461,62 +2153,113 @@ namespace crpi_robot
 #else
       x = ulapi_serial_read(serialID_, mssgBuffer_, 8192);
 #endif
-#ifdef LWR_NOISY
-      printf ("%d %s read\n", x, mssgBuffer_);
-#endif
-      return true;
+      CRPI_LOG(CRPI_LOG_DEBUG, "%d %s read", x, mssgBuffer_);
+      return span.End(true);
+    }
+    else if (useBinary_)
+    {
+      //! EKI binary frame:  replies are fixed-length, so read until one is complete
+      int held = 0;
+      while (held < KUKA_FRAME_BYTES)
+      {
+        x = ulapi_socket_read(client_, mssgBuffer_ + held, KUKA_FRAME_BYTES - held);
+        if (x <= 0)
+        {
+          mssgBuffer_[0] = '\0';
+          return span.End(false);
+        }
+        held += x;
+      }
+      return span.End(true);
     }
     else
     {
       //! Use TCP/IP
       x = ulapi_socket_read(client_, mssgBuffer_, 8192);
-#ifdef LWR_NOISY
-      printf ("%d %s read\n", x, mssgBuffer_);
-#endif
-      return true;
+      CRPI_LOG(CRPI_LOG_DEBUG, "%d %s read", x, mssgBuffer_);
+      return span.End(true);
     }
   }
 
 
-  LIBRARY_API bool CrpiKukaLWR::parseFeedback (int num)
+  LIBRARY_API bool CrpiKukaLWR::generateFrame (const char *cmd, const double *values, int num)
   {
-    bool newItem = false;
-    int index = -1, i;
+    int i;
+
+    frame_[0] = cmd[0];
+    frame_[1] = cmd[1];
+    frame_[2] = cmd[2];
+    frame_[3] = '\0';
+    for (i = 0; i < KUKA_FRAME_VALUES; ++i)
+    {
+      crpi_store_le_float(frame_ + 4 + (4 * i), (i < num) ? values[i] : 0.0);
+    }
+    return true;
+  }
 
-    for (i = 0; i < num; ++i)
+
+  LIBRARY_API bool CrpiKukaLWR::parseFeedback (int num)
+  {
+    CRPI_NO_ALLOC_SCOPE("CrpiKukaLWR::parseFeedback");
+    if (useBinary_)
     {
-      tempData_->at(i) = "";
+      //! Values follow the 4-byte status header
+      for (int i = 0; i < num && i < KUKA_FRAME_VALUES; ++i)
+      {
+        feedback_[i] = crpi_load_le_float(mssgBuffer_ + 4 + (4 * i));
+      }
+      return (num <= KUKA_FEEDBACK_MAX && num <= KUKA_FRAME_VALUES);
     }
 
     //! REQUEST_MSG_SIZE is very large, feedback from robot is limited to 80 characters
-    for (i = 0; i < 80; ++i)
+    return (num <= KUKA_FEEDBACK_MAX && crpi_parse_values (mssgBuffer_, 80, " ", feedback_, num) == num);
+  }
+
+
+  LIBRARY_API bool CrpiKukaLWR::readFeedback (char retType, int num)
+  {
+    kukaStateRecord record;
+    int offset = -1, width = 0;
+
+    if (useStateStream_ && stream_.record.read(record) > 0 &&
+        (ulapi_time() - record.timestamp) < KUKA_STATE_STALE)
     {
-      if (mssgBuffer_[i] == ' ')
+      //! Record layout:  sequence, C(8), A(7), F(6), T(6), S(8)
+      switch (retType)
       {
-        newItem = false;
+      case 'C':
+        offset = 1;
+        width = 8;
+        break;
+      case 'A':
+        offset = 9;
+        width = 7;
+        break;
+      case 'F':
+        offset = 16;
+        width = 6;
+        break;
+      case 'T':
+        offset = 22;
+        width = 6;
+        break;
+      case 'S':
+        offset = 28;
+        width = 8;
+        break;
+      default:
+        break;
       }
-      else
+
+      if (offset > 0 && num == width)
       {
-        if (!newItem)
-        {
-          newItem = true;
-          index++;
-          if( index >= num )
-          {
-            break;
-//            return false;
-          }
-        }
-        tempData_->at(index).push_back (mssgBuffer_[i]);
-      } // if (mssgBuffer_[i] == ' ') ... else
-    } //for (int i = 0; i < 65; ++i)
-  
-    //! Convert strings to floats
-    for (i = 0; i < num; ++i)
-    {
-      feedback_[i] = stod (tempData_->at(i));
+        memcpy(feedback_, record.values + offset, num * sizeof(double));
+        return true;
+      }
     }
-    return true;
+
+    return (generateFeedback (retType) && send () && get () && parseFeedback (num));
   }
 
+
 } // crpi_robot
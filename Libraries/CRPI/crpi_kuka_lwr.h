@@ -17,6 +17,58 @@
 
 #define OLDSERIAL
 
+//! @brief Maximum number of waypoints the KRL server queues for one blended path.  Longer
+//!        MoveThroughTo calls are sent in batches that each end in an exact stop.
+//!
+#define KUKA_PATH_MAX 16
+
+//! @brief Maximum number of values in one controller reply
+//!
+#define KUKA_FEEDBACK_MAX 10
+
+//! @brief Number of values in one streamed state record:  a sequence number followed by the
+//!        'C' (8), 'A' (7), 'F' (6), 'T' (6), and 'S' (8) feedback replies, in that order
+//!
+#define KUKA_STATE_VALUES 36
+
+//! @brief The state stream is accepted on the command port plus this offset
+//!
+#define KUKA_STATE_PORT_OFFSET 1
+
+//! @brief Age (s) after which a streamed record is no longer used and getters fall back to
+//!        request/response over the command connection
+//!
+#define KUKA_STATE_STALE 0.1
+
+//! @brief Receive buffer for the state stream (several records)
+//!
+#define KUKA_STATE_BUFFER 2048
+
+//! @brief EKI binary frames (<Feedback Protocol="BINARY"/>).  Commands and replies are a 4-byte
+//!        header followed by KUKA_FRAME_VALUES little-endian REALs.  The header holds the three
+//!        command characters, or the reply's status character ('1' or '0'), padded with NUL.
+//!
+#define KUKA_FRAME_VALUES 10
+#define KUKA_FRAME_BYTES (4 + (4 * KUKA_FRAME_VALUES))
+
+//! @brief Size (bytes) of one binary state record, and the marker at its start ("CRPI" as a
+//!        little-endian INT).  Layout, all little-endian:
+//!          Byte   0  INT   marker
+//!          Byte   4  INT   sequence number
+//!          Byte   8  8 x REAL  'C' reply (X Y Z A B C S T)
+//!          Byte  40  7 x REAL  'A' reply (A1 A2 E1 A3 A4 A5 A6)
+//!          Byte  68  6 x REAL  'F' reply (Fx Fy Fz Tz Ty Tx)
+//!          Byte  92  6 x REAL  'T' reply (T1 ... T6)
+//!          Byte 116  INT   controller time (ms, $ROB_TIMER)
+//!          Byte 120  INT   digital inputs $IN[1]..$IN[7] (bit 0 = $IN[1])
+//!
+#define KUKA_STATE_RECORD 124
+#define KUKA_STATE_MAGIC 0x43525049UL
+
+//! @brief Seconds between keep-alive pose requests
+//!
+#define KUKA_KEEPALIVE 5.0
+
 #ifdef WIN32
 
 #ifdef OLDSERIAL
@@ -40,6 +92,10 @@ using namespace Network;
 #endif //linux compatibility
 
 #include "crpi.h"
+#include "crpi_estimator.h"
+#include "crpi_metrics.h"
+#include "crpi_recorder.h"
+#include "crpi_parse.h"
 
 
 
@@ -53,6 +109,58 @@ using namespace std;
 namespace crpi_robot
 {
 
+  //! @brief One combined state record received from the KRL state server
+  //!
+  struct kukaStateRecord
+  {
+    //! @brief Record values (see KUKA_STATE_VALUES)
+    //!
+    double values[KUKA_STATE_VALUES];
+
+    //! @brief Time (ulapi_time, s) at which the record was received
+    //!
+    double timestamp;
+  };
+
+
+  //! @brief State stream shared between CrpiKukaLWR and its receive thread
+  //!
+  struct LIBRARY_API kukaStateStream
+  {
+    bool runThread;
+
+    //! @brief Listening socket, and the controller's connection (-1 while disconnected)
+    //!
+    ulapi_integer server;
+    ulapi_integer client;
+
+    //! @brief Whether records are binary (KUKA_STATE_RECORD) rather than text
+    //!
+    bool binary;
+
+    //! @brief Raw received characters not yet parsed
+    //!
+    char buffer[KUKA_STATE_BUFFER];
+    int held;
+
+    //! @brief Latest complete record, published for lock-free readers
+    //!
+    crpi_seqlock<kukaStateRecord> record;
+
+    //! @brief Runtime metrics:  records published, records dropped (malformed or overflowing
+    //!        the buffer), the record rate, and reconnections by the state server
+    //!
+    CrpiCounter *framesMetric;
+    CrpiCounter *droppedMetric;
+    CrpiRateMeter rateMetric;
+    CrpiCounter *reconnectMetric;
+
+    //! @brief Recorder channel of the records (see crpi_recorder.h)
+    //!
+    int recordChannel;
+  };
+
+
 
   //! @ingroup Robot
   //!
@@ -61,6 +169,10 @@ namespace crpi_robot
   class LIBRARY_API CrpiKukaLWR
   {
   public:
+    //! @brief Number of axes of the arm (see CrpiAxisCount)
+    //!
+    static constexpr int axisCount = 7;
+
     //! @brief Default constructor
     //!
     //! @param params Configuration parameters for the CRPI instance of this robot
@@ -80,7 +192,7 @@ namespace crpi_robot
     //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
     //!         not accepted, and FAILURE if the command is accepted but not executed successfully
     //!
-    CanonReturn ApplyCartesianForceTorque (robotPose &robotForceTorque, vector<bool> activeAxes, vector<bool> manipulator);
+    CanonReturn ApplyCartesianForceTorque (robotPose &robotForceTorque, const vector<bool> &activeAxes, const vector<bool> &manipulator);
 
     //! @brief Apply joint torques
     //!
@@ -191,7 +303,8 @@ namespace crpi_robot
     //!
     CanonReturn GetRobotPose (robotPose *pose);
 
-    //! @brief Get instantaneous Cartesian velocity
+    //! @brief Get instantaneous Cartesian velocity, as estimated from the pose feedback (see
+    //!        crpi_estimator.h)
     //!
     //! @param speed Cartesian velocities to be populated by the method
     //!
@@ -200,7 +313,7 @@ namespace crpi_robot
     //!
     CanonReturn GetRobotSpeed (robotPose *speed);
 
-    //! @brief Get instantaneous joint speeds
+    //! @brief Get instantaneous joint speeds, as estimated from the joint feedback
     //!
     //! @param speed Joint velocities array to be populated by the method
     //!
@@ -218,6 +331,28 @@ namespace crpi_robot
     //!
     CanonReturn GetRobotTorques (robotAxes *torques);
 
+    //! @brief Get a consistent snapshot of the robot's latest state without waiting on the
+    //!        robot's feedback connection
+    //!
+    //! @param state Snapshot to be populated by the method
+    //!
+    //! @return SUCCESS if a state has been published by the driver, REJECT if no state is
+    //!         available yet or the robot does not publish state snapshots
+    //!
+    CanonReturn GetRobotState (RobotStateSnapshot *state);
+
+    //! @brief Get the robot's latest state extrapolated to compensate for its age, from the speeds
+    //!        in the state
+    //!
+    //! @param state Snapshot to be populated by the method, as by GetRobotState; its timestamp is
+    //!              the time predicted for
+    //! @param lead  Seconds past the current time (ulapi_time) to predict for; 0 for now
+    //!
+    //! @return SUCCESS if a state has been published by the driver, REJECT if no state is
+    //!         available yet or the robot does not publish the speeds to extrapolate from
+    //!
+    CanonReturn GetPredictedState (RobotStateSnapshot *state, double lead = 0.0);
+
     //! @brief Move a virtual attractor to a specified coordinate in Cartesian space for force control
     //!
     //! @param pose The 6DOF destination of the virtual attractor 
@@ -236,6 +371,72 @@ namespace crpi_robot
     //!
     CanonReturn MoveToAxisTarget (robotAxes &axes, bool useBlocking);
 
+    //! @brief Start streaming motion setpoints to the robot at the controller's native rate
+    //!
+    //! @return SUCCESS if the robot is ready to accept setpoints, REJECT if streaming is not
+    //!         supported, and FAILURE if the stream could not be started
+    //!
+    CanonReturn BeginStream ();
+
+    //! @brief Send the next Cartesian setpoint of an active stream without waiting for the motion
+    //!
+    //! @param pose The 6DOF setpoint for the robot's TCP in Cartesian space coordinates
+    //!
+    //! @return SUCCESS if the setpoint was sent, REJECT if no stream is active, and FAILURE if the
+    //!         setpoint could not be sent
+    //!
+    CanonReturn StreamPose (robotPose &pose);
+
+    //! @brief Send the next joint setpoint of an active stream without waiting for the motion
+    //!
+    //! @param axes Target axis values specified in the current axial unit
+    //!
+    //! @return SUCCESS if the setpoint was sent, REJECT if no stream is active, and FAILURE if the
+    //!         setpoint could not be sent
+    //!
+    CanonReturn StreamAxes (robotAxes &axes);
+
+    //! @brief Stop an active stream and bring the robot to rest
+    //!
+    //! @return SUCCESS if the stream was stopped, REJECT if no stream is active, and FAILURE if the
+    //!         robot could not be stopped
+    //!
+    CanonReturn EndStream ();
+
+    //! @brief Start streaming Cartesian force/torque targets to a force controller that stays
+    //!        running on the robot, so each update needs no new program
+    //!
+    //! @return SUCCESS if the robot is ready to accept wrench targets, REJECT if force streaming
+    //!         is not supported or a stream is already active, and FAILURE if the stream could
+    //!         not be started
+    //!
+    //! @note The robot holds its position (no axes selected) until the first StreamWrench.  The
+    //!       "stream_period" and "stream_deadline" settings of BeginStream also apply.
+    //!
+    CanonReturn BeginWrenchStream ();
+
+    //! @brief Send the next force/torque target of an active wrench stream without waiting for
+    //!        the robot to respond
+    //!
+    //! @param wrench     Target forces (N) along and torques (N m) about the tool axes
+    //! @param activeAxes Which tool axes (x, y, z, xrot, yrot, zrot) are force controlled; the
+    //!                   others hold position.  TRUE = ACTIVE, FALSE = INACTIVE
+    //! @param limits     For active axes, the largest TCP speed along or about the axis (length or
+    //!                   angle units per second); for the others, the largest deviation from the
+    //!                   held position (length or angle units)
+    //!
+    //! @return SUCCESS if the target was sent, REJECT if no wrench stream is active, and FAILURE
+    //!         if the target could not be sent
+    //!
+    CanonReturn StreamWrench (robotPose &wrench, const vector<bool> &activeAxes, robotPose &limits);
+
+    //! @brief Stop an active wrench stream, leave force control, and bring the robot to rest
+    //!
+    //! @return SUCCESS if the stream was stopped, REJECT if no wrench stream is active, and
+    //!         FAILURE if the robot could not be stopped
+    //!
+    CanonReturn EndWrenchStream ();
+
     //! @brief Set the accerlation for the controlled pose to the given value in length units per
     //!        second per second
     //!
@@ -319,6 +520,11 @@ namespace crpi_robot
     //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
     //!         not accepted, and FAILURE if the command is accepted but not executed successfully
     //!
+    //! @note "native_program" (a crpiNativeProgram) translates a compiled program into a KRL
+    //!       program (CRPI_Native.src).  The command server takes single commands only, so the
+    //!       program is copied onto the controller by other means; asking to run it is rejected.
+    //!       KRC2 controllers have no simple message instruction, so messages become comments.
+    //!
     CanonReturn SetParameter (const char *paramName, void *paramVal);
 
     //! @brief Set the accerlation for the controlled pose to the given percentage of the robot's
@@ -427,7 +633,9 @@ namespace crpi_robot
     void *serialID_;
 #endif
 
-    void *task;
+    //! @brief Keep-alive registered on the SensorHub timer wheel (-1 if none)
+    //!
+    int keepalive_;
     keepalive ka_;
     char IPAddr_[16];
     ulapi_integer server_;
@@ -449,9 +657,28 @@ namespace crpi_robot
     //!
     char *mssgBuffer_;
 
+    //! @brief Whether commands, replies, and streamed state use EKI binary frames
+    //!        (<Feedback Protocol="BINARY"/> in the robot XML) instead of text
+    //!
+    bool useBinary_;
+
+    //! @brief Binary command frame built by the generate* functions while useBinary_ is set
+    //!
+    char frame_[KUKA_FRAME_BYTES];
+
+    //! @brief Build a binary command frame in frame_
+    //!
+    //! @param cmd    The three command characters (e.g., "LCA")
+    //! @param values Command values; the frame is padded with zeros after num values
+    //! @param num    The number of values, at most KUKA_FRAME_VALUES
+    //!
+    //! @return True
+    //!
+    bool generateFrame (const char *cmd, const double *values, int num);
+
     //! @brief Returned data from the robot
     //!
-    double *feedback_;
+    double feedback_[KUKA_FEEDBACK_MAX];
 
     CanonAngleUnit angleUnits_;
     CanonLengthUnit lengthUnits_;
@@ -460,12 +687,16 @@ namespace crpi_robot
     double defaultSpeed_;
     double axial;
 
-    vector<string> *tempData_;
-
     //! @brief Generate a motion command for the Kuka LWR
     //!
-    //! @param moveType  Specify the movement type, either PTP ('P'), LIN ('L'), or force control ('F')
-    //! @param posType   Specify the position type, either cartesian ('C') or angular ('A')
+    //! @param moveType  Specify the movement type, either PTP ('P'), LIN ('L'), force control ('F'),
+    //!                  streaming ('S'), or blended path ('B')
+    //! @param posType   Specify the position type, either cartesian ('C') or angular ('A'), or for
+    //!                  streaming commands, begin ('B'), impedance ('I'), wrench ('W'), or end
+    //!                  ('E').  Blended paths use
+    //!                  parameters ('P':  V1 $VEL.CP m/s, V2 C_DIS distance mm, V3 $ACC.CP m/s^2,
+    //!                  0 leaves a value unchanged), a queued Cartesian waypoint ('C'), or execute
+    //!                  ('E':  LIN ... C_DIS through the queue, replying at the last waypoint).
     //! @param deltaType Specify the motion delta, either absolute ('A') or relative ('R')
     //! @param input     Vector of 6 position values (note that J3 of the robot is E1, and is thus not
     //!                  used here for angular motion commands)
@@ -474,6 +705,94 @@ namespace crpi_robot
     //!
     bool generateMove (char moveType, char posType, char deltaType, vector<double> &input);
 
+    //! @brief Send a streaming command ('S' move type) and wait for the controller's acknowledgement.
+    //!        The controller acknowledges setpoints on receipt and corrects toward the latest one
+    //!        each interpolation cycle, rather than replying once the motion completes.
+    //!
+    //! @param posType Begin ('B'), Cartesian setpoint ('C'), axis setpoint ('A'), impedance
+    //!                ('I'), wrench ('W'), or end ('E')
+    //! @param input   Vector of 10 values
+    //!
+    //! @return SUCCESS if acknowledged, FAILURE otherwise
+    //!
+    CanonReturn streamCommand (char posType, vector<double> &input);
+
+    //! @brief Send the impedance settings of a wrench stream ("SIA"):  V1 axis selection (bit i
+    //!        for tool axis x, y, z, xrot, yrot, zrot), V2-V7 limits in the same axis order (0 for
+    //!        the controller default), V8 period (s), V9 deadline (s).  The controller runs the
+    //!        LWR's Cartesian impedance mode, with zero stiffness on selected axes, and adds the
+    //!        wrench of each "SWA" command (V1-V3 N, V4-V6 N m about x, y, z) every cycle.
+    //!
+    //! @param select Axis selection bits
+    //! @param limits Speed limits of selected axes and deviation limits of the others
+    //!
+    //! @return SUCCESS if acknowledged, FAILURE otherwise
+    //!
+    CanonReturn wrenchCommand (int select, robotPose &limits);
+
+    //! @brief Translates compiled programs into KRL
+    //!
+    class nativeWriter;
+
+    //! @brief Translate a compiled program into a KRL program (SetParameter "native_program")
+    //!
+    //! @param native The program to translate; its text is set to the program
+    //!
+    //! @return True if the program was translated, false if one of its steps cannot be
+    //!
+    bool generateNative (crpiNativeProgram &native);
+
+    //! @brief Whether a setpoint stream started by BeginStream is active
+    //!
+    bool streaming_;
+
+    //! @brief Whether a wrench stream started by BeginWrenchStream is active
+    //!
+    bool wrenchStreaming_;
+
+    //! @brief Axis selection and limits last acknowledged by the controller in a wrench stream
+    //!
+    int wrenchSelect_;
+    double wrenchLimits_[6];
+
+    //! @brief Stream settings (see SetParameter):  correction cycle (s), lookahead (s), and the
+    //!        deadline (s) after which the controller stops if no setpoint has arrived
+    //!
+    double streamPeriod_, streamLookahead_, streamDeadline_;
+
+    //! @brief Whether the controller streams its state (<Feedback Protocol="STREAM"/> or
+    //!        "BINARY" in the robot XML) rather than answering one feedback request at a time
+    //!
+    bool useStateStream_;
+
+    //! @brief State stream and the thread receiving it
+    //!
+    kukaStateStream stream_;
+    void *stateTask_;
+
+    //! @brief State assembled from the Get* replies (guarded by ka_.lock) and its published copy
+    //!
+    RobotStateSnapshot latest_;
+    crpi_seqlock<RobotStateSnapshot> state_;
+
+    //! @brief Speed and acceleration estimators of the pose and axis feedback and their latest
+    //!        estimates (guarded by ka_.lock), the units the samples were taken in, and the
+    //!        estimates' published copy, written before each state
+    //!
+    CrpiRateEstimator poseRates_;
+    CrpiRateEstimator axisRates_;
+    CrpiMotionRates rates_;
+    CanonLengthUnit rateLength_;
+    CanonAngleUnit rateAngle_;
+    crpi_seqlock<CrpiMotionRates> ratesPub_;
+
+    //! @brief Mark a field of latest_ as valid and publish it to GetRobotState readers.  Must be
+    //!        called with ka_.lock held.
+    //!
+    //! @param field The CrpiStateField that was just updated
+    //!
+    void publishState (unsigned int field);
+
     //! @brief Generate a feedback request for the Kuka LWR
     //!
     //! @param retType Specify the return value, either Cartesian position ('C'), joint position ('A')
@@ -501,6 +820,17 @@ namespace crpi_robot
     //!
     bool parseFeedback (int num);
 
+    //! @brief Populate feedback_ with a feedback reply, taken from the latest streamed state
+    //!        record if one is fresh and requested from the controller otherwise.  Must be called
+    //!        with ka_.lock held.
+    //!
+    //! @param retType The feedback type (see generateFeedback)
+    //! @param num     The number of values in the reply
+    //!
+    //! @return True if feedback_ holds the reply, false otherwise
+    //!
+    bool readFeedback (char retType, int num);
+
     //! @brief Generate a tool activation request for the KUKA LWR
     //!
     //! @param mode  Specify the mode of actuation of the robot output: binary (B), analog (A), definition (D)
@@ -524,13 +854,21 @@ namespace crpi_robot
     //!
     bool generateParameter (char paramType, char subtype, vector<double> &input);
 
-    //! @brief Send content of moveMe_ to robot using whatever communication protocol is defined.  
+    //! @brief Send content of moveMe_ (or frame_, with useBinary_) to robot using whatever
+    //!        communication protocol is defined.
     //!
     bool send ();
 
     //! @brief Store data from robot in mssgBuffer_ using whatever communication protocol is defined
     //!
     bool get ();
+
+    //! @brief Send moveMe_ and wait for the controller's response.  Must be called with ka_.lock
+    //!        held.
+    //!
+    //! @return True if the controller acknowledged the command, false otherwise
+    //!
+    bool exchange ();
   }; // CrpiKukaLWR
 
 } // namespace crpi_robot
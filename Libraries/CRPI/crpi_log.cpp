@@ -0,0 +1,487 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_log.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Asynchronous diagnostic log definitions.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_log.h"
+#include "crpi_hub.h"
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+using namespace std;
+
+//! Time (s) between the log thread's passes over the rings
+#define CRPI_LOG_PERIOD 0.02
+
+namespace crpi_robot
+{
+  //! @brief Ring of messages written by one thread at a time and read by whoever holds the
+  //!        log's lock.  Buffers are never freed; when a thread exits its buffer is handed to
+  //!        the next thread that logs.
+  //!
+  struct logBuffer
+  {
+    crpiLogRecord records[CRPI_LOG_RECORDS];
+    unsigned int threads[CRPI_LOG_RECORDS];
+
+    //! @brief Messages written and messages read since the buffer was created
+    //!
+    std::atomic<unsigned long long> head;
+    std::atomic<unsigned long long> tail;
+
+    //! @brief Whether a thread is writing to the buffer, and the id of the last one that did
+    //!
+    std::atomic<bool> owned;
+    std::atomic<unsigned int> tid;
+
+    logBuffer *next;
+  };
+
+  //! @brief Where messages go.  Allocated once and never freed, so that the log thread can
+  //!        outlive static destruction.
+  //!
+  struct logState
+  {
+    ulapi_mutex_struct *mutex;
+    FILE *file;
+    CrpiLogSink sink;
+    void *param;
+    string line;
+    string message;
+
+    logState () :
+      mutex(ulapi_mutex_new(0)),
+      file(NULL),
+      sink(NULL),
+      param(NULL)
+    {
+    }
+  };
+
+  static logState &logger ()
+  {
+    static logState *state = new logState();
+    return *state;
+  }
+
+  static std::atomic<logBuffer*> logBuffers(NULL);
+  static std::atomic<unsigned int> logThreads(0);
+  static std::atomic<unsigned long long> logDropped(0);
+  static std::atomic<bool> logStarted(false);
+
+  std::atomic<int> CrpiLog::level_(CRPI_LOG_INFO);
+
+  //! @brief Releases the calling thread's buffer when the thread exits
+  //!
+  struct logOwner
+  {
+    logBuffer *buffer;
+
+    logOwner () :
+      buffer(NULL)
+    {
+    }
+
+    ~logOwner ()
+    {
+      if (buffer != NULL)
+      {
+        buffer->owned.store(false, std::memory_order_release);
+      }
+    }
+  };
+
+  static thread_local logOwner logLocal;
+
+
+  //! @brief The calling thread's buffer:  an unowned one if there is one, otherwise a new one
+  //!        pushed onto the list
+  //!
+  static logBuffer *logAcquire ()
+  {
+    logBuffer *buf;
+    for (buf = logBuffers.load(std::memory_order_acquire); buf != NULL; buf = buf->next)
+    {
+      bool expected = false;
+      if (!buf->owned.load(std::memory_order_relaxed) &&
+          buf->owned.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+      {
+        buf->tid.store(logThreads.fetch_add(1) + 1, std::memory_order_relaxed);
+        return buf;
+      }
+    }
+
+    buf = new logBuffer();
+    buf->head.store(0, std::memory_order_relaxed);
+    buf->tail.store(0, std::memory_order_relaxed);
+    buf->owned.store(true, std::memory_order_relaxed);
+    buf->tid.store(logThreads.fetch_add(1) + 1, std::memory_order_relaxed);
+    buf->next = logBuffers.load(std::memory_order_relaxed);
+    while (!logBuffers.compare_exchange_weak(buf->next, buf, std::memory_order_acq_rel))
+    {
+    }
+    return buf;
+  }
+
+
+  //! @brief Format one argument with one conversion specification
+  //!
+  //! @param spec The specification, from '%' through the flags, width, and precision
+  //! @param conv The conversion character
+  //! @param tag  The argument's type tag
+  //! @param arg  The argument's value
+  //! @param out  Receives the text
+  //!
+  static void logConvert (string spec, char conv, unsigned char tag, const unsigned char *arg,
+                          string &out)
+  {
+    char text[CRPI_LOG_STRING + 64], str[CRPI_LOG_STRING + 1];
+    long long i;
+    unsigned long long u;
+    double d;
+    const void *p;
+    int n = -1;
+
+    switch (conv)
+    {
+    case 'd':
+    case 'i':
+    case 'o':
+    case 'u':
+    case 'x':
+    case 'X':
+    case 'c':
+      if (tag != 'i' && tag != 'u')
+      {
+        break;
+      }
+      if (conv == 'c')
+      {
+        memcpy(&i, arg, sizeof(i));
+        spec += conv;
+        n = snprintf(text, sizeof(text), spec.c_str(), (int)i);
+      }
+      else if (tag == 'i')
+      {
+        memcpy(&i, arg, sizeof(i));
+        spec += "ll";
+        spec += conv;
+        n = snprintf(text, sizeof(text), spec.c_str(), i);
+      }
+      else
+      {
+        memcpy(&u, arg, sizeof(u));
+        spec += "ll";
+        spec += conv;
+        n = snprintf(text, sizeof(text), spec.c_str(), u);
+      }
+      break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+      if (tag != 'd')
+      {
+        break;
+      }
+      memcpy(&d, arg, sizeof(d));
+      spec += conv;
+      n = snprintf(text, sizeof(text), spec.c_str(), d);
+      break;
+    case 's':
+      if (tag != 's')
+      {
+        break;
+      }
+      memcpy(str, arg + 1, arg[0]);
+      str[arg[0]] = '\0';
+      spec += conv;
+      n = snprintf(text, sizeof(text), spec.c_str(), str);
+      break;
+    case 'p':
+      if (tag != 'p')
+      {
+        break;
+      }
+      memcpy(&p, arg, sizeof(p));
+      spec += conv;
+      n = snprintf(text, sizeof(text), spec.c_str(), p);
+      break;
+    }
+
+    if (n < 0)
+    {
+      out += '?';
+    }
+    else
+    {
+      out.append(text, ((size_t)n < sizeof(text)) ? (size_t)n : sizeof(text) - 1);
+    }
+  }
+
+
+  //! @brief Expand a message's format with its captured arguments
+  //!
+  static void logFormat (const crpiLogRecord &record, string &out)
+  {
+    const char *f = record.format;
+    const unsigned char *arg = record.args, *end = record.args + record.size;
+    string spec;
+    long long star;
+    char number[24];
+
+    out.clear();
+    while (*f != '\0')
+    {
+      if (*f != '%')
+      {
+        out += *f++;
+        continue;
+      }
+      if (f[1] == '%')
+      {
+        out += '%';
+        f += 2;
+        continue;
+      }
+
+      //! Flags, width, and precision are kept; a '*' is replaced by its argument
+      spec = *f++;
+      while (*f != '\0' && strchr("-+ #0", *f) != NULL)
+      {
+        spec += *f++;
+      }
+      while (*f != '\0' && (strchr("0123456789.", *f) != NULL || *f == '*'))
+      {
+        if (*f == '*')
+        {
+          star = 0;
+          if (arg < end && (*arg == 'i' || *arg == 'u'))
+          {
+            memcpy(&star, arg + 1, sizeof(star));
+            arg += 1 + sizeof(star);
+          }
+          snprintf(number, sizeof(number), "%lld", star);
+          spec += number;
+          ++f;
+        }
+        else
+        {
+          spec += *f++;
+        }
+      }
+
+      //! Length modifiers are dropped, since the arguments were widened when captured
+      while (*f != '\0' && strchr("hljztLq", *f) != NULL)
+      {
+        ++f;
+      }
+      if (*f == '\0')
+      {
+        break;
+      }
+
+      if (arg >= end)
+      {
+        out += '?';
+      }
+      else
+      {
+        logConvert(spec, *f, arg[0], arg + 1, out);
+        arg += 1 + ((arg[0] == 's') ? 1 + arg[1] : (arg[0] == 'p') ? sizeof(void*) : 8);
+      }
+      ++f;
+    }
+  }
+
+
+  //! @brief Write out a formatted message
+  //!
+  static void logEmit (logState &ls, const crpiLogRecord &record, unsigned int thread)
+  {
+    static const char *names[] = {"ERROR", "WARNING", "INFO", "DEBUG"};
+    char prefix[64];
+
+    logFormat(record, ls.message);
+    if (ls.sink != NULL)
+    {
+      ls.sink(ls.param, (CrpiLogLevel)record.level, record.timestamp, thread, ls.message.c_str());
+      return;
+    }
+
+    snprintf(prefix, sizeof(prefix), "%.6f %-7s [%u] ", record.timestamp,
+             names[(record.level <= CRPI_LOG_DEBUG) ? record.level : CRPI_LOG_DEBUG], thread);
+    ls.line = prefix;
+    ls.line += ls.message;
+    ls.line += '\n';
+    fwrite(ls.line.data(), 1, ls.line.size(), (ls.file != NULL) ? ls.file : stdout);
+  }
+
+
+  //! @brief Log thread:  writes out the rings' messages every CRPI_LOG_PERIOD
+  //!
+  static void logLoop (void *param)
+  {
+    while (true)
+    {
+      CrpiLog::Flush();
+      ulapi_sleep(CRPI_LOG_PERIOD);
+    }
+  }
+
+
+  static void logAtExit ()
+  {
+    CrpiLog::Flush();
+  }
+
+
+  LIBRARY_API void CrpiLog::SetLevel (CrpiLogLevel level)
+  {
+    level_.store((int)level, std::memory_order_relaxed);
+  }
+
+
+  LIBRARY_API bool CrpiLog::SetFile (const char *path)
+  {
+    logState &ls = logger();
+    FILE *file = NULL;
+
+    if (path != NULL && (file = fopen(path, "a")) == NULL)
+    {
+      return false;
+    }
+
+    //! Messages already logged go where they were headed
+    Flush();
+    ulapi_mutex_take(ls.mutex);
+    if (ls.file != NULL)
+    {
+      fclose(ls.file);
+    }
+    ls.file = file;
+    ulapi_mutex_give(ls.mutex);
+    return true;
+  }
+
+
+  LIBRARY_API void CrpiLog::SetSink (CrpiLogSink sink, void *param)
+  {
+    logState &ls = logger();
+
+    Flush();
+    ulapi_mutex_take(ls.mutex);
+    ls.sink = sink;
+    ls.param = param;
+    ulapi_mutex_give(ls.mutex);
+  }
+
+
+  LIBRARY_API void CrpiLog::Flush ()
+  {
+    logState &ls = logger();
+    logBuffer *buf;
+    unsigned long long tail, head;
+    bool wrote = false;
+
+    ulapi_mutex_take(ls.mutex);
+    for (buf = logBuffers.load(std::memory_order_acquire); buf != NULL; buf = buf->next)
+    {
+      tail = buf->tail.load(std::memory_order_relaxed);
+      head = buf->head.load(std::memory_order_acquire);
+      for (; tail != head; ++tail)
+      {
+        logEmit(ls, buf->records[tail % CRPI_LOG_RECORDS], buf->threads[tail % CRPI_LOG_RECORDS]);
+        wrote = true;
+      }
+      buf->tail.store(tail, std::memory_order_release);
+    }
+    if (wrote && ls.sink == NULL)
+    {
+      fflush((ls.file != NULL) ? ls.file : stdout);
+    }
+    ulapi_mutex_give(ls.mutex);
+  }
+
+
+  LIBRARY_API unsigned long long CrpiLog::Dropped ()
+  {
+    return logDropped.load(std::memory_order_relaxed);
+  }
+
+
+  LIBRARY_API void CrpiLog::Submit (crpiLogRecord &record)
+  {
+    if (!logStarted.load(std::memory_order_relaxed) && !logStarted.exchange(true))
+    {
+      logger();
+      atexit(logAtExit);
+      SensorHub::Instance().StartLoop(logLoop, NULL, HUB_MONITOR);
+    }
+
+    if (logLocal.buffer == NULL)
+    {
+      logLocal.buffer = logAcquire();
+    }
+    logBuffer *buf = logLocal.buffer;
+
+    unsigned long long head = buf->head.load(std::memory_order_relaxed);
+    if (head - buf->tail.load(std::memory_order_acquire) >= CRPI_LOG_RECORDS)
+    {
+      logDropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    crpiLogRecord &slot = buf->records[head % CRPI_LOG_RECORDS];
+    record.timestamp = ulapi_time();
+    memcpy(&slot, &record, offsetof(crpiLogRecord, args) + record.size);
+    buf->threads[head % CRPI_LOG_RECORDS] = buf->tid.load(std::memory_order_relaxed);
+    buf->head.store(head + 1, std::memory_order_release);
+  }
+
+
+  //! @brief Reads CRPI_LOG and CRPI_LOG_FILE when the library is loaded
+  //!
+  struct logEnvironment
+  {
+    logEnvironment ()
+    {
+      static const char *names[] = {"error", "warning", "info", "debug"};
+      const char *setting = getenv("CRPI_LOG");
+      int i;
+
+      if (setting != NULL)
+      {
+        for (i = CRPI_LOG_ERROR; i <= CRPI_LOG_DEBUG; ++i)
+        {
+          if (strcmp(setting, names[i]) == 0)
+          {
+            CrpiLog::SetLevel((CrpiLogLevel)i);
+          }
+        }
+      }
+
+      setting = getenv("CRPI_LOG_FILE");
+      if (setting != NULL && setting[0] != '\0')
+      {
+        CrpiLog::SetFile(setting);
+      }
+    }
+  };
+
+  static logEnvironment logStartup;
+} // namespace crpi_robot
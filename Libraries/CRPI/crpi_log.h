@@ -0,0 +1,259 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_log.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Asynchronous diagnostic log for CRPI and the sensor libraries.
+//
+//  CRPI_LOG(level, format, ...) takes the place of printf and cout in the
+//  drivers.  The format is checked against its arguments at compile time
+//  (GCC and Clang), and a message below the log level costs one relaxed
+//  load.  Otherwise the format's address and the arguments, in binary, are
+//  copied to a ring owned by the calling thread (no locks, no allocation
+//  after the thread's first message, and the message is dropped rather
+//  than waiting if the ring is full).  A background thread formats the
+//  messages and writes them, so a control loop never waits on the console.
+//
+//  The level and destination can be set without recompiling:  CRPI_LOG in
+//  the environment is "error", "warning", "info" (the default), or "debug",
+//  and CRPI_LOG_FILE names a file to append to instead of the console.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_log_H
+#define crpi_log_H
+
+#include "crpi.h"
+#include <string.h>
+#include <atomic>
+#include <string>
+#include <type_traits>
+
+//! @brief Bytes of arguments kept per message, messages buffered per thread, and longest
+//!        string argument kept (longer strings are truncated)
+//!
+#define CRPI_LOG_ARGS 200
+#define CRPI_LOG_RECORDS 512
+#define CRPI_LOG_STRING 120
+
+//! @brief Compile-time check of a printf-style format against its arguments
+//!
+#if defined(__GNUC__)
+#define CRPI_LOG_FORMAT(f, a) __attribute__((format(printf, f, a)))
+#else
+#define CRPI_LOG_FORMAT(f, a)
+#endif
+
+//! @brief Format and arguments of a robotPose, e.g. CRPI_LOG(level, "at " CRPI_LOG_POSE,
+//!        CRPI_LOG_POSE_ARGS(pose))
+//!
+#define CRPI_LOG_POSE "(%f, %f, %f, %f, %f, %f)"
+#define CRPI_LOG_POSE_ARGS(p) (p).x, (p).y, (p).z, (p).xrot, (p).yrot, (p).zrot
+
+//! @brief Log a message if its level is enabled.  The format must be a string literal.
+//!
+#define CRPI_LOG(level, ...)                                              \
+  do                                                                      \
+  {                                                                       \
+    if (crpi_robot::CrpiLog::Enabled(level))                              \
+    {                                                                     \
+      if (false)                                                          \
+      {                                                                   \
+        crpi_robot::crpiLogCheck(__VA_ARGS__);                            \
+      }                                                                   \
+      crpi_robot::CrpiLog::Write(level, __VA_ARGS__);                     \
+    }                                                                     \
+  } while (false)
+
+namespace crpi_robot
+{
+  //! @brief Message severity, from the most to the least severe
+  //!
+  enum CrpiLogLevel
+  {
+    CRPI_LOG_ERROR = 0,
+    CRPI_LOG_WARNING,
+    CRPI_LOG_INFO,
+    CRPI_LOG_DEBUG
+  };
+
+  //! @brief Receiver of formatted messages, called on the log thread
+  //!
+  //! @param param     The parameter given to CrpiLog::SetSink
+  //! @param level     The message's level
+  //! @param timestamp When the message was logged (s, ulapi_time)
+  //! @param thread    Small integer identifying the logging thread
+  //! @param message   The formatted message, without a trailing newline
+  //!
+  typedef void (*CrpiLogSink) (void *param, CrpiLogLevel level, double timestamp, unsigned int thread,
+                               const char *message);
+
+  //! @brief Never called; gives CRPI_LOG its format check
+  //!
+  inline void crpiLogCheck (const char *format, ...) CRPI_LOG_FORMAT(1, 2);
+  inline void crpiLogCheck (const char *format, ...)
+  {
+  }
+
+  //! @brief One message as it waits in a ring:  the format and the arguments, each a one-byte
+  //!        type tag ('i' signed, 'u' unsigned, 'd' floating point, 'p' pointer, 's' string)
+  //!        followed by its value (a length byte and the characters, for a string)
+  //!
+  struct crpiLogRecord
+  {
+    const char *format;
+    double timestamp;
+    unsigned char level;
+    unsigned char size;
+    unsigned char args[CRPI_LOG_ARGS];
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+    put (T value)
+    {
+      putValue('i', (long long)value);
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type
+    put (T value)
+    {
+      putValue('u', (unsigned long long)value);
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_enum<T>::value>::type put (T value)
+    {
+      putValue('i', (long long)value);
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type put (T value)
+    {
+      putValue('d', (double)value);
+    }
+
+    template <typename T>
+    void put (T *value)
+    {
+      putValue('p', (const void*)value);
+    }
+
+    void put (const char *value)
+    {
+      size_t length = (value == NULL) ? 0 : strlen(value);
+      if (length > CRPI_LOG_STRING)
+      {
+        length = CRPI_LOG_STRING;
+      }
+      if (size + 2 + length > CRPI_LOG_ARGS)
+      {
+        return;
+      }
+      args[size] = 's';
+      args[size + 1] = (unsigned char)length;
+      memcpy(args + size + 2, value, length);
+      size += (unsigned char)(2 + length);
+    }
+
+    void put (char *value)
+    {
+      put((const char*)value);
+    }
+
+    void pack ()
+    {
+    }
+
+    template <typename T, typename... Rest>
+    void pack (const T &first, const Rest &... rest)
+    {
+      put(first);
+      pack(rest...);
+    }
+
+  private:
+    template <typename T>
+    void putValue (unsigned char tag, const T &value)
+    {
+      //! Arguments that do not fit are left out and print as "?"
+      if (size + 1 + sizeof(T) > CRPI_LOG_ARGS)
+      {
+        return;
+      }
+      args[size] = tag;
+      memcpy(args + size + 1, &value, sizeof(T));
+      size += (unsigned char)(1 + sizeof(T));
+    }
+  };
+
+  //! @ingroup Robot
+  //!
+  //! @brief Process-wide log control
+  //!
+  class LIBRARY_API CrpiLog
+  {
+  public:
+    //! @brief Whether messages of a level are logged
+    //!
+    static bool Enabled (CrpiLogLevel level)
+    {
+      return (int)level <= level_.load(std::memory_order_relaxed);
+    }
+
+    //! @brief Log messages of a level and every more severe level
+    //!
+    static void SetLevel (CrpiLogLevel level);
+
+    //! @brief Append messages to a file rather than writing them to the console
+    //!
+    //! @param path The file, or NULL to return to the console
+    //!
+    //! @return True if the file could be opened
+    //!
+    static bool SetFile (const char *path);
+
+    //! @brief Pass messages to a function rather than writing them out
+    //!
+    //! @param sink  The function, or NULL to write them out again
+    //! @param param Passed to sink
+    //!
+    static void SetSink (CrpiLogSink sink, void *param);
+
+    //! @brief Write out every message logged so far, on the calling thread
+    //!
+    static void Flush ();
+
+    //! @brief Number of messages dropped because their thread's ring was full
+    //!
+    static unsigned long long Dropped ();
+
+    //! @brief Capture a message for the log thread (use CRPI_LOG, which checks the level and
+    //!        the format first)
+    //!
+    template <typename... Args>
+    static void Write (CrpiLogLevel level, const char *format, const Args &... args)
+    {
+      crpiLogRecord record;
+      record.format = format;
+      record.level = (unsigned char)level;
+      record.size = 0;
+      record.pack(args...);
+      Submit(record);
+    }
+
+  private:
+    //! @brief Stamp a message and queue it on the calling thread's ring
+    //!
+    static void Submit (crpiLogRecord &record);
+
+    static std::atomic<int> level_;
+  }; // CrpiLog
+} // namespace crpi_robot
+
+#endif
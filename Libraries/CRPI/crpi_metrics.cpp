@@ -0,0 +1,618 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_metrics.cpp
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Runtime metric registry, OpenMetrics rendering, and HTTP endpoint.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_metrics.h"
+#include "crpi_hub.h"
+#include "crpi_log.h"
+#include "crpi_trace.h"
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+//! @brief Largest HTTP request read by the endpoint, and the time (s) a client has to send it
+//!
+#define METRICS_REQUEST_MAX 4096
+#define METRICS_REQUEST_TIMEOUT 2.0
+
+namespace crpi_robot
+{
+  //! @brief Default histogram bounds (s)
+  //!
+  static const double metricsDurations[] = { 0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005,
+                                             0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0 };
+
+  //! @brief Add to an atomic double
+  //!
+  static void metricsAdd (std::atomic<double> &value, double delta)
+  {
+    double current = value.load(std::memory_order_relaxed);
+    while (!value.compare_exchange_weak(current, current + delta, std::memory_order_relaxed))
+    {
+    }
+  }
+
+
+  LIBRARY_API void CrpiGauge::Add (double delta)
+  {
+    metricsAdd(value_, delta);
+  }
+
+
+  LIBRARY_API CrpiHistogram::CrpiHistogram (const double *bounds, int count) :
+    sum_(0.0)
+  {
+    if (bounds == NULL || count <= 0)
+    {
+      bounds = metricsDurations;
+      count = (int)(sizeof(metricsDurations) / sizeof(double));
+    }
+    bounds_ = (count > CRPI_METRICS_BUCKETS) ? CRPI_METRICS_BUCKETS : count;
+    for (int i = 0; i < bounds_; ++i)
+    {
+      bound_[i] = bounds[i];
+    }
+    for (int i = 0; i <= CRPI_METRICS_BUCKETS; ++i)
+    {
+      buckets_[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+
+  LIBRARY_API void CrpiHistogram::Observe (double value)
+  {
+    int i = 0;
+    while (i < bounds_ && value > bound_[i])
+    {
+      ++i;
+    }
+    buckets_[i].fetch_add(1, std::memory_order_relaxed);
+    metricsAdd(sum_, value);
+  }
+
+
+  //! @brief One registered metric.  Filled in before count is advanced past it, and not
+  //!        changed afterward, so Render reads the entries without the lock.
+  //!
+  struct metricEntry
+  {
+    CrpiMetricType type;
+    string name;
+    string help;
+    string labels;
+    void *metric;
+  };
+
+  //! @brief The registry.  Created on first use so that drivers set up during static
+  //!        initialization find it ready.
+  //!
+  struct metricsRegistry
+  {
+    metricEntry entries[CRPI_METRICS_MAX];
+    std::atomic<int> count;
+    void *lock;
+
+    //! @brief Handed out once the registry is full
+    //!
+    CrpiCounter spareCounter;
+    CrpiGauge spareGauge;
+    CrpiHistogram spareHistogram;
+
+    metricsRegistry () :
+      count(0),
+      lock(ulapi_fastlock_new())
+    {
+    }
+  };
+
+  //! @brief Reads CRPI_METRICS_PORT the first time a metric is registered
+  //!
+  static void metricsEnvironment ()
+  {
+    const char *setting = getenv("CRPI_METRICS_PORT");
+    if (setting == NULL || setting[0] == '\0' || strcmp(setting, "0") == 0)
+    {
+      return;
+    }
+    int port = atoi(setting);
+    if (!CrpiMetrics::Serve((port > 0) ? port : CRPI_METRICS_PORT))
+    {
+      CRPI_LOG(CRPI_LOG_ERROR, "CRPI metrics:  could not listen on port %d", (port > 0) ? port : CRPI_METRICS_PORT);
+    }
+  }
+
+  static metricsRegistry &metrics ()
+  {
+    static metricsRegistry registry;
+    return registry;
+  }
+
+
+  //! @brief Find or add a metric
+  //!
+  //! @return The metric, or NULL if the registry is full or the name is taken by another type
+  //!
+  static void *metricsFind (CrpiMetricType type, const char *name, const char *help,
+                            const string &labels, const double *bounds, int count)
+  {
+    static std::atomic<bool> checked(false);
+    metricsRegistry &reg = metrics();
+    void *found = NULL;
+    bool clash = false;
+    int n, i;
+
+    ulapi_fastlock_take(reg.lock);
+    n = reg.count.load(std::memory_order_relaxed);
+    for (i = 0; i < n; ++i)
+    {
+      if (reg.entries[i].name == name)
+      {
+        if (reg.entries[i].type != type)
+        {
+          clash = true;
+        }
+        else if (reg.entries[i].labels == labels)
+        {
+          found = reg.entries[i].metric;
+          break;
+        }
+      }
+    }
+    if (found == NULL && !clash && n < CRPI_METRICS_MAX)
+    {
+      metricEntry &entry = reg.entries[n];
+      entry.type = type;
+      entry.name = name;
+      entry.help = (help == NULL) ? "" : help;
+      entry.labels = labels;
+      switch (type)
+      {
+      case CRPI_METRIC_COUNTER:
+        entry.metric = new CrpiCounter();
+        break;
+      case CRPI_METRIC_GAUGE:
+        entry.metric = new CrpiGauge();
+        break;
+      default:
+        entry.metric = new CrpiHistogram(bounds, count);
+        break;
+      }
+      found = entry.metric;
+      reg.count.store(n + 1, std::memory_order_release);
+    }
+    ulapi_fastlock_give(reg.lock);
+
+    if (!checked.exchange(true))
+    {
+      metricsEnvironment();
+    }
+    return found;
+  }
+
+
+  LIBRARY_API CrpiCounter *CrpiMetrics::Counter (const char *name, const char *help, const string &labels)
+  {
+    void *found = metricsFind(CRPI_METRIC_COUNTER, name, help, labels, NULL, 0);
+    return (found == NULL) ? &metrics().spareCounter : (CrpiCounter*)found;
+  }
+
+
+  LIBRARY_API CrpiGauge *CrpiMetrics::Gauge (const char *name, const char *help, const string &labels)
+  {
+    void *found = metricsFind(CRPI_METRIC_GAUGE, name, help, labels, NULL, 0);
+    return (found == NULL) ? &metrics().spareGauge : (CrpiGauge*)found;
+  }
+
+
+  LIBRARY_API CrpiHistogram *CrpiMetrics::Histogram (const char *name, const char *help, const string &labels,
+                                                     const double *bounds, int count)
+  {
+    void *found = metricsFind(CRPI_METRIC_HISTOGRAM, name, help, labels, bounds, count);
+    return (found == NULL) ? &metrics().spareHistogram : (CrpiHistogram*)found;
+  }
+
+
+  LIBRARY_API string CrpiMetrics::Label (const char *key, const char *value)
+  {
+    string out = key;
+    out += "=\"";
+    for (const char *c = value; c != NULL && *c != '\0'; ++c)
+    {
+      switch (*c)
+      {
+      case '\\':
+        out += "\\\\";
+        break;
+      case '"':
+        out += "\\\"";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      default:
+        out += *c;
+      }
+    }
+    out += "\"";
+    return out;
+  }
+
+
+  //! @brief Append a sample value
+  //!
+  static void metricsNumber (string &out, double value)
+  {
+    char text[32];
+    if (value != value)
+    {
+      out += "NaN";
+      return;
+    }
+    if (value > DBL_MAX || value < -DBL_MAX)
+    {
+      out += (value > 0.0) ? "+Inf" : "-Inf";
+      return;
+    }
+    snprintf(text, sizeof(text), "%.10g", value);
+    out += text;
+  }
+
+  static void metricsNumber (string &out, unsigned long long value)
+  {
+    char text[24];
+    snprintf(text, sizeof(text), "%llu", value);
+    out += text;
+  }
+
+
+  //! @brief Append a sample name with its label set and an optional extra label
+  //!
+  static void metricsSample (string &out, const string &name, const char *suffix, const string &labels,
+                             const char *extra = NULL)
+  {
+    out += name;
+    out += suffix;
+    if (!labels.empty() || extra != NULL)
+    {
+      out += "{";
+      out += labels;
+      if (extra != NULL)
+      {
+        out += labels.empty() ? "" : ",";
+        out += extra;
+      }
+      out += "}";
+    }
+    out += " ";
+  }
+
+
+  //! @brief Append the samples of one metric
+  //!
+  static void metricsWrite (string &out, const metricEntry &entry)
+  {
+    char le[48];
+    unsigned long long total = 0;
+    int i;
+
+    switch (entry.type)
+    {
+    case CRPI_METRIC_COUNTER:
+      metricsSample(out, entry.name, "_total", entry.labels);
+      metricsNumber(out, ((CrpiCounter*)entry.metric)->Value());
+      out += "\n";
+      break;
+    case CRPI_METRIC_GAUGE:
+      metricsSample(out, entry.name, "", entry.labels);
+      metricsNumber(out, ((CrpiGauge*)entry.metric)->Value());
+      out += "\n";
+      break;
+    default:
+    {
+      const CrpiHistogram *hist = (const CrpiHistogram*)entry.metric;
+      //! Buckets are exported cumulatively, and the count is the +Inf bucket, so the bucket
+      //! counts are read once
+      for (i = 0; i <= hist->Bounds(); ++i)
+      {
+        total += hist->Bucket(i);
+        if (i < hist->Bounds())
+        {
+          snprintf(le, sizeof(le), "le=\"%.10g\"", hist->Bound(i));
+        }
+        else
+        {
+          strcpy(le, "le=\"+Inf\"");
+        }
+        metricsSample(out, entry.name, "_bucket", entry.labels, le);
+        metricsNumber(out, total);
+        out += "\n";
+      }
+      metricsSample(out, entry.name, "_sum", entry.labels);
+      metricsNumber(out, hist->Sum());
+      out += "\n";
+      metricsSample(out, entry.name, "_count", entry.labels);
+      metricsNumber(out, total);
+      out += "\n";
+    }
+    }
+  }
+
+
+  //! @brief Append a metric family's TYPE and HELP lines
+  //!
+  static void metricsFamily (string &out, const string &name, const char *type, const string &help)
+  {
+    out += "# TYPE " + name + " " + type + "\n";
+    if (!help.empty())
+    {
+      out += "# HELP " + name + " " + help + "\n";
+    }
+  }
+
+
+  //! @brief Append the CrpiTrace span counters as metric families
+  //!
+  static void metricsSpans (string &out)
+  {
+    CrpiTraceCounter spans[CRPI_TRACE_COUNTERS];
+    string labels;
+    int count = CrpiTrace::Counters(spans, CRPI_TRACE_COUNTERS);
+    int i;
+
+    if (count <= 0)
+    {
+      return;
+    }
+    metricsFamily(out, "crpi_span_calls", "counter", "Traced commands and driver steps");
+    for (i = 0; i < count; ++i)
+    {
+      labels = CrpiMetrics::Label("name", spans[i].name) + "," + CrpiMetrics::Label("category", spans[i].category);
+      metricsSample(out, "crpi_span_calls", "_total", labels);
+      metricsNumber(out, spans[i].calls);
+      out += "\n";
+    }
+    metricsFamily(out, "crpi_span_failures", "counter", "Traced commands and driver steps that did not succeed");
+    for (i = 0; i < count; ++i)
+    {
+      labels = CrpiMetrics::Label("name", spans[i].name) + "," + CrpiMetrics::Label("category", spans[i].category);
+      metricsSample(out, "crpi_span_failures", "_total", labels);
+      metricsNumber(out, spans[i].failures);
+      out += "\n";
+    }
+    metricsFamily(out, "crpi_span_seconds", "counter", "Time spent in traced commands and driver steps");
+    for (i = 0; i < count; ++i)
+    {
+      labels = CrpiMetrics::Label("name", spans[i].name) + "," + CrpiMetrics::Label("category", spans[i].category);
+      metricsSample(out, "crpi_span_seconds", "_total", labels);
+      metricsNumber(out, spans[i].total);
+      out += "\n";
+    }
+  }
+
+
+  LIBRARY_API void CrpiMetrics::Render (string &out)
+  {
+    metricsRegistry &reg = metrics();
+    int n = reg.count.load(std::memory_order_acquire);
+    int i, j;
+    static const char *types[] = { "counter", "gauge", "histogram" };
+
+    out.clear();
+    //! Families in the order their first metric was registered, each with all its label sets
+    for (i = 0; i < n; ++i)
+    {
+      for (j = 0; j < i && reg.entries[j].name != reg.entries[i].name; ++j)
+      {
+      }
+      if (j < i)
+      {
+        continue;
+      }
+      metricsFamily(out, reg.entries[i].name, types[reg.entries[i].type], reg.entries[i].help);
+      for (j = i; j < n; ++j)
+      {
+        if (reg.entries[j].name == reg.entries[i].name)
+        {
+          metricsWrite(out, reg.entries[j]);
+        }
+      }
+    }
+    metricsSpans(out);
+    out += "# EOF\n";
+  }
+
+
+  //! @brief State of the HTTP endpoint
+  //!
+  struct metricsServer
+  {
+    ulapi_integer server;
+    void *poller;
+    void *loop;
+    int port;
+    std::atomic<bool> run;
+  };
+
+  static metricsServer *metricsEndpoint = NULL;
+  static std::atomic<bool> metricsStarting(false);
+
+
+  //! @brief Send all of a response
+  //!
+  static void metricsSend (ulapi_integer client, const string &text)
+  {
+    size_t sent = 0;
+    ulapi_integer put;
+
+    while (sent < text.size())
+    {
+      put = ulapi_socket_write(client, text.c_str() + sent, (ulapi_integer)(text.size() - sent));
+      if (put <= 0)
+      {
+        return;
+      }
+      sent += put;
+    }
+  }
+
+
+  //! @brief Read a client's request and answer it.  The client is given
+  //!        METRICS_REQUEST_TIMEOUT to send the request line and headers.
+  //!
+  static void metricsAnswer (metricsServer *ms, ulapi_integer client)
+  {
+    char request[METRICS_REQUEST_MAX + 1];
+    ulapi_poll_event ev;
+    ulapi_integer got;
+    int held = 0;
+    double deadline = ulapi_time() + METRICS_REQUEST_TIMEOUT;
+    string body, reply;
+    char header[192];
+
+    ulapi_socket_set_nonblocking(client);
+    ulapi_poller_add(ms->poller, client, ULAPI_POLL_READ, NULL);
+    while (ms->run.load(std::memory_order_relaxed) && held < METRICS_REQUEST_MAX)
+    {
+      got = ulapi_socket_read(client, request + held, METRICS_REQUEST_MAX - held);
+      if (got == 0)
+      {
+        break;
+      }
+      if (got > 0)
+      {
+        held += got;
+        request[held] = '\0';
+        if (strstr(request, "\r\n\r\n") != NULL || strstr(request, "\n\n") != NULL)
+        {
+          break;
+        }
+        continue;
+      }
+      if (ulapi_time() > deadline)
+      {
+        break;
+      }
+      ulapi_poller_wait(ms->poller, &ev, 1, deadline - ulapi_time());
+    }
+    ulapi_poller_remove(ms->poller, client);
+    request[held] = '\0';
+
+    if (strncmp(request, "GET /metrics ", 13) == 0 || strncmp(request, "GET /metrics?", 13) == 0 ||
+        strncmp(request, "GET / ", 6) == 0)
+    {
+      CrpiMetrics::Render(body);
+      snprintf(header, sizeof(header), "HTTP/1.0 200 OK\r\n"
+               "Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+               "Content-Length: %lu\r\nConnection: close\r\n\r\n", (unsigned long)body.size());
+    }
+    else
+    {
+      body = "Only GET /metrics is served\n";
+      snprintf(header, sizeof(header), "HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\n"
+               "Content-Length: %lu\r\nConnection: close\r\n\r\n", (unsigned long)body.size());
+    }
+    reply = header;
+    reply += body;
+    ulapi_socket_set_blocking(client);
+    metricsSend(client, reply);
+  }
+
+
+  //! @brief Endpoint loop:  one client at a time, which is plenty for a scraper polling every
+  //!        few seconds
+  //!
+  static void metricsServe (void *param)
+  {
+    metricsServer *ms = (metricsServer*)param;
+    ulapi_poll_event ev;
+    ulapi_integer client;
+
+    while (ms->run.load(std::memory_order_relaxed))
+    {
+      //! Woken by StopServing
+      if (ulapi_poller_wait(ms->poller, &ev, 1, -1.0) <= 0 || ev.id != ms->server)
+      {
+        continue;
+      }
+      client = ulapi_socket_get_connection_id(ms->server);
+      if (client > 0)
+      {
+        metricsAnswer(ms, client);
+        ulapi_socket_close(client);
+      }
+    }
+  }
+
+
+  LIBRARY_API bool CrpiMetrics::Serve (int port)
+  {
+    if (metricsStarting.exchange(true))
+    {
+      //! Already serving (or another thread is starting the endpoint)
+      return true;
+    }
+
+    metricsServer *ms = new metricsServer();
+    ms->port = port;
+    ms->run = true;
+    ms->server = ulapi_socket_get_server_id(port);
+    ms->poller = ulapi_poller_new();
+    if (ms->server <= 0 || ms->poller == NULL)
+    {
+      if (ms->server > 0)
+      {
+        ulapi_socket_close(ms->server);
+      }
+      if (ms->poller != NULL)
+      {
+        ulapi_poller_delete(ms->poller);
+      }
+      delete ms;
+      metricsStarting = false;
+      return false;
+    }
+    ulapi_poller_add(ms->poller, ms->server, ULAPI_POLL_READ, NULL);
+    ms->loop = SensorHub::Instance().StartLoop(metricsServe, ms, HUB_BACKGROUND);
+    if (ms->loop == NULL)
+    {
+      ulapi_socket_close(ms->server);
+      ulapi_poller_delete(ms->poller);
+      delete ms;
+      metricsStarting = false;
+      return false;
+    }
+    metricsEndpoint = ms;
+    return true;
+  }
+
+
+  LIBRARY_API void CrpiMetrics::StopServing ()
+  {
+    metricsServer *ms = metricsEndpoint;
+    if (ms == NULL)
+    {
+      return;
+    }
+    metricsEndpoint = NULL;
+    ms->run = false;
+    ulapi_poller_wake(ms->poller);
+    SensorHub::Instance().JoinLoop(ms->loop);
+    ulapi_socket_close(ms->server);
+    ulapi_poller_delete(ms->poller);
+    delete ms;
+    metricsStarting = false;
+  }
+} // namespace crpi_robot
@@ -0,0 +1,265 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_metrics.h
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Runtime metrics (counters, gauges, and histograms) for the robot and
+//  sensor interfaces, exported in the OpenMetrics text format.
+//
+//  Metrics are registered once, when an interface is set up, and updated
+//  with single atomic operations on the threads that observe them, so they
+//  can sit in feedback loops.  The registry is rendered on request, either
+//  by the application (CrpiMetrics::Render) or by a small HTTP endpoint
+//  that a Prometheus server scrapes (CrpiMetrics::Serve).  Setting
+//  CRPI_METRICS_PORT in the environment starts the endpoint without
+//  recompiling.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_metrics_H
+#define crpi_metrics_H
+
+#include "crpi.h"
+#include <atomic>
+#include <string>
+
+//! @brief Metrics that can be registered, and bucket bounds per histogram (excluding +Inf)
+//!
+#define CRPI_METRICS_MAX 512
+#define CRPI_METRICS_BUCKETS 16
+
+//! @brief Default port of the HTTP endpoint
+//!
+#define CRPI_METRICS_PORT 9464
+
+namespace crpi_robot
+{
+  //! @brief Kinds of metric
+  //!
+  typedef enum
+  {
+    CRPI_METRIC_COUNTER = 0, //! Monotonic count (of frames, reconnects, ...)
+    CRPI_METRIC_GAUGE,       //! Value that goes up and down (rates, ages, queue depths)
+    CRPI_METRIC_HISTOGRAM    //! Distribution of observed values (durations)
+  } CrpiMetricType;
+
+  //! @brief Monotonic counter
+  //!
+  class LIBRARY_API CrpiCounter
+  {
+  public:
+    CrpiCounter () :
+      value_(0)
+    {
+    }
+
+    //! @brief Count events
+    //!
+    void Inc (unsigned long long n = 1)
+    {
+      value_.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    unsigned long long Value () const
+    {
+      return value_.load(std::memory_order_relaxed);
+    }
+
+  private:
+    std::atomic<unsigned long long> value_;
+  }; // CrpiCounter
+
+
+  //! @brief Value that is set, or moved up and down
+  //!
+  class LIBRARY_API CrpiGauge
+  {
+  public:
+    CrpiGauge () :
+      value_(0.0)
+    {
+    }
+
+    void Set (double value)
+    {
+      value_.store(value, std::memory_order_relaxed);
+    }
+
+    //! @brief Move the value by delta (negative to decrease it)
+    //!
+    void Add (double delta);
+
+    double Value () const
+    {
+      return value_.load(std::memory_order_relaxed);
+    }
+
+  private:
+    std::atomic<double> value_;
+  }; // CrpiGauge
+
+
+  //! @brief Distribution of observed values over fixed buckets
+  //!
+  class LIBRARY_API CrpiHistogram
+  {
+  public:
+    //! @brief Constructor
+    //!
+    //! @param bounds Ascending upper bounds of the buckets, or NULL for durations from 50 us to
+    //!               5 s
+    //! @param count  Number of bounds (at most CRPI_METRICS_BUCKETS)
+    //!
+    CrpiHistogram (const double *bounds = NULL, int count = 0);
+
+    //! @brief Add an observation
+    //!
+    void Observe (double value);
+
+    //! @brief Add a duration measured from start to now (s, ulapi_time)
+    //!
+    void ObserveSince (double start)
+    {
+      Observe(ulapi_time() - start);
+    }
+
+    //! @brief Bucket bounds
+    //!
+    int Bounds () const
+    {
+      return bounds_;
+    }
+    double Bound (int i) const
+    {
+      return bound_[i];
+    }
+
+    //! @brief Observations in bucket i (not cumulative); bucket Bounds() holds those above the
+    //!        last bound
+    //!
+    unsigned long long Bucket (int i) const
+    {
+      return buckets_[i].load(std::memory_order_relaxed);
+    }
+
+    double Sum () const
+    {
+      return sum_.load(std::memory_order_relaxed);
+    }
+
+  private:
+    int bounds_;
+    double bound_[CRPI_METRICS_BUCKETS];
+    std::atomic<unsigned long long> buckets_[CRPI_METRICS_BUCKETS + 1];
+    std::atomic<double> sum_;
+  }; // CrpiHistogram
+
+
+  //! @brief Sets a gauge to an event rate (Hz), averaged over windows of at least a second so
+  //!        that events delivered in bursts (e.g., several frames per socket read) still give a
+  //!        steady reading.  Used by one thread.
+  //!
+  struct CrpiRateMeter
+  {
+    CrpiGauge *gauge;
+    double start;
+    unsigned long long count;
+
+    CrpiRateMeter () :
+      gauge(NULL),
+      start(-1.0),
+      count(0)
+    {
+    }
+
+    //! @brief Count an event
+    //!
+    //! @param now Time (s, ulapi_time) of the event
+    //!
+    void Tick (double now)
+    {
+      ++count;
+      if (start < 0.0)
+      {
+        start = now;
+        count = 0;
+      }
+      else if (now - start >= 1.0)
+      {
+        if (gauge != NULL)
+        {
+          gauge->Set(count / (now - start));
+        }
+        start = now;
+        count = 0;
+      }
+    }
+  };
+
+
+  //! @ingroup Robot
+  //!
+  //! @brief Process-wide metric registry and OpenMetrics export
+  //!
+  //! @note Metrics are owned by the registry and live until the process exits.  Registering a
+  //!       name and label set that already exists returns the existing metric, so an
+  //!       interface that is torn down and set up again keeps counting where it left off.
+  //!       Once CRPI_METRICS_MAX metrics exist, further registrations share a scratch metric
+  //!       that is not exported; the returned pointer is never NULL.
+  //!
+  class LIBRARY_API CrpiMetrics
+  {
+  public:
+    //! @brief Register (or find) a metric
+    //!
+    //! @param name   Metric name, e.g. "crpi_ur_frames" (counters are exported with a "_total"
+    //!               suffix, which the name should not include)
+    //! @param help   One-line description
+    //! @param labels Label set in exposition syntax, e.g. "robot=\"ur5\",link=\"feedback\"",
+    //!               or "" for none.  Use Label to build it from untrusted values.
+    //!
+    static CrpiCounter *Counter (const char *name, const char *help, const std::string &labels = "");
+    static CrpiGauge *Gauge (const char *name, const char *help, const std::string &labels = "");
+
+    //! @brief Register (or find) a histogram
+    //!
+    //! @param bounds Bucket bounds as for the CrpiHistogram constructor (ignored if the
+    //!               histogram already exists)
+    //! @param count  Number of bounds
+    //!
+    static CrpiHistogram *Histogram (const char *name, const char *help, const std::string &labels = "",
+                                     const double *bounds = NULL, int count = 0);
+
+    //! @brief Format one label, escaping the value
+    //!
+    //! @return key="value", ready to use (or join with commas) as a label set
+    //!
+    static std::string Label (const char *key, const char *value);
+
+    //! @brief Write every metric, and the CrpiTrace span counters, in the OpenMetrics text
+    //!        format (ending with "# EOF")
+    //!
+    //! @param out Text (replaced)
+    //!
+    static void Render (std::string &out);
+
+    //! @brief Serve the metrics over HTTP (GET /metrics) from a SensorHub background loop
+    //!
+    //! @param port TCP port to listen on
+    //!
+    //! @return True if the endpoint is listening (or already was), false otherwise
+    //!
+    static bool Serve (int port = CRPI_METRICS_PORT);
+
+    //! @brief Stop the HTTP endpoint, if one is running
+    //!
+    static void StopServing ();
+  }; // CrpiMetrics
+} // namespace crpi_robot
+
+#endif
@@ -0,0 +1,464 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_modbus.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Shared Modbus/TCP session definitions.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_modbus.h"
+#include "crpi_hub.h"
+#include <sstream>
+#include <string.h>
+
+//! Longest the polling loop sleeps (s) before checking whether it is to stop
+#define MODBUS_IDLE 1.0
+
+namespace crpi_robot
+{
+  //! @brief Sessions by gateway
+  //!
+  struct modbusRegistry
+  {
+    ulapi_mutex_struct *mutex;
+    std::map<std::string, CrpiModbusSession*> sessions;
+
+    modbusRegistry () :
+      mutex(ulapi_mutex_new(0))
+    {
+    }
+  };
+
+  static modbusRegistry &registry ()
+  {
+    static modbusRegistry reg;
+    return reg;
+  }
+
+
+  LIBRARY_API CrpiModbusSession *CrpiModbusSession::Acquire (const char *address, int port)
+  {
+    modbusRegistry &reg = registry();
+    std::ostringstream key;
+    std::map<std::string, CrpiModbusSession*>::iterator it;
+    CrpiModbusSession *session = NULL;
+    ulapi_integer socket;
+
+    key << address << ":" << port;
+
+    ulapi_mutex_take(reg.mutex);
+    it = reg.sessions.find(key.str());
+    if (it != reg.sessions.end())
+    {
+      session = it->second;
+      ++session->users_;
+    }
+    else
+    {
+      socket = ulapi_socket_get_client_id(port, address);
+      if (socket >= 0)
+      {
+        session = new CrpiModbusSession(key.str(), socket);
+        reg.sessions[key.str()] = session;
+      }
+    }
+    ulapi_mutex_give(reg.mutex);
+
+    return session;
+  }
+
+
+  LIBRARY_API void CrpiModbusSession::Release (CrpiModbusSession *session)
+  {
+    modbusRegistry &reg = registry();
+
+    if (session == NULL)
+    {
+      return;
+    }
+
+    ulapi_mutex_take(reg.mutex);
+    if (--session->users_ > 0)
+    {
+      session = NULL;
+    }
+    else
+    {
+      reg.sessions.erase(session->key_);
+    }
+    ulapi_mutex_give(reg.mutex);
+
+    delete session;
+  }
+
+
+  LIBRARY_API CrpiModbusSession::CrpiModbusSession (const std::string &key, ulapi_integer socket) :
+    key_(key),
+    users_(1),
+    socket_(socket),
+    rxHeld_(0),
+    transaction_(0),
+    nextTicket_(0),
+    reading_(false),
+    run_(true)
+  {
+    mutex_ = ulapi_mutex_new(0);
+    ulapi_lock_name(mutex_, "CrpiModbus session");
+    cond_ = ulapi_cond_new(0);
+    pollCond_ = ulapi_cond_new(0);
+    loop_ = SensorHub::Instance().StartLoop(pollLoop, this, HUB_MONITOR);
+  }
+
+
+  LIBRARY_API CrpiModbusSession::~CrpiModbusSession ()
+  {
+    ulapi_mutex_take(mutex_);
+    run_ = false;
+    ulapi_cond_broadcast(pollCond_);
+    ulapi_mutex_give(mutex_);
+
+    //! The loop exits after at most one round of polls
+    SensorHub::Instance().JoinLoop(loop_);
+    ulapi_socket_close(socket_);
+    ulapi_cond_delete(pollCond_);
+    ulapi_cond_delete(cond_);
+    ulapi_mutex_delete(mutex_);
+  }
+
+
+  LIBRARY_API int CrpiModbusSession::Begin (unsigned char unit,
+                                            unsigned char function,
+                                            const unsigned char *pdu,
+                                            int length)
+  {
+    unsigned char frame[CRPI_MODBUS_FRAME_MAX];
+    unsigned short id;
+    int ticket;
+
+    if (length + 8 > CRPI_MODBUS_FRAME_MAX)
+    {
+      return -1;
+    }
+
+    ulapi_mutex_take(mutex_);
+    id = ++transaction_;
+    ticket = nextTicket_++;
+    if (nextTicket_ < 0)
+    {
+      nextTicket_ = 0;
+    }
+
+    //! MBAP header:  transaction ID, protocol ID (0), length of unit ID + PDU, unit ID
+    frame[0] = (unsigned char)(id >> 8);
+    frame[1] = (unsigned char)(id & 0xFF);
+    frame[2] = 0x00;
+    frame[3] = 0x00;
+    frame[4] = (unsigned char)((length + 2) >> 8);
+    frame[5] = (unsigned char)((length + 2) & 0xFF);
+    frame[6] = unit;
+    frame[7] = function;
+    memcpy(frame + 8, pdu, length);
+
+    //! Register the request before sending it, so that a reader can match a prompt reply;
+    //! the write is made under the lock so that frames from different threads never interleave
+    pending &slot = pending_[ticket];
+    slot.id = id;
+    slot.done = false;
+    slot.length = 0;
+    if (ulapi_socket_write(socket_, (char*)frame, length + 8) != length + 8)
+    {
+      pending_.erase(ticket);
+      ticket = -1;
+    }
+    ulapi_mutex_give(mutex_);
+
+    return ticket;
+  }
+
+
+  LIBRARY_API bool CrpiModbusSession::End (int ticket,
+                                           unsigned char *reply,
+                                           int &replyLength,
+                                           double timeout)
+  {
+    std::map<int, pending>::iterator it;
+    double deadline = ulapi_time() + timeout, remaining;
+    ulapi_integer ready;
+    int get;
+    bool received = false, broken;
+
+    replyLength = 0;
+    ulapi_mutex_take(mutex_);
+    while ((it = pending_.find(ticket)) != pending_.end())
+    {
+      if (it->second.done)
+      {
+        replyLength = it->second.length;
+        memcpy(reply, it->second.reply, replyLength);
+        received = true;
+        pending_.erase(it);
+        break;
+      }
+
+      remaining = deadline - ulapi_time();
+      if (remaining <= 0.0)
+      {
+        pending_.erase(it);
+        break;
+      }
+
+      if (reading_)
+      {
+        //! Another waiter is reading the connection and will deliver this reply if it comes
+        ulapi_cond_timedwait(cond_, mutex_, remaining);
+        continue;
+      }
+
+      //! Read on behalf of every waiter; rx_ belongs to whoever holds reading_
+      reading_ = true;
+      ulapi_mutex_give(mutex_);
+      get = 0;
+      broken = false;
+      if (ulapi_socket_poll(&socket_, &ready, 1, remaining) > 0)
+      {
+        get = ulapi_socket_read(socket_, (char*)rx_ + rxHeld_, CRPI_MODBUS_FRAME_MAX - rxHeld_);
+        broken = (get <= 0);
+      }
+      ulapi_mutex_take(mutex_);
+      if (get > 0)
+      {
+        rxHeld_ += get;
+        deliver();
+      }
+      reading_ = false;
+      ulapi_cond_broadcast(cond_);
+
+      if (broken)
+      {
+        //! The gateway closed the connection; nothing more will arrive
+        it = pending_.find(ticket);
+        if (it != pending_.end() && !it->second.done)
+        {
+          pending_.erase(it);
+          break;
+        }
+      }
+    }
+    ulapi_mutex_give(mutex_);
+
+    return received && (reply[0] & MODBUS_EXCEPTION) == 0;
+  }
+
+
+  LIBRARY_API bool CrpiModbusSession::Transact (unsigned char unit,
+                                                unsigned char function,
+                                                const unsigned char *pdu,
+                                                int length,
+                                                unsigned char *reply,
+                                                int &replyLength,
+                                                double timeout)
+  {
+    int ticket = Begin(unit, function, pdu, length);
+
+    if (ticket < 0)
+    {
+      replyLength = 0;
+      return false;
+    }
+    return End(ticket, reply, replyLength, timeout);
+  }
+
+
+  LIBRARY_API void CrpiModbusSession::deliver ()
+  {
+    std::map<int, pending>::iterator it;
+    int frameLength;
+    unsigned short id;
+
+    while (rxHeld_ >= 7)
+    {
+      frameLength = 6 + ((rx_[4] << 8) | rx_[5]);
+      if (frameLength < 8 || frameLength > CRPI_MODBUS_FRAME_MAX)
+      {
+        //! Lost framing; drop what we have and resynchronize on the next reply
+        rxHeld_ = 0;
+        break;
+      }
+      if (rxHeld_ < frameLength)
+      {
+        break;
+      }
+
+      //! Replies to requests that have timed out match nothing and are dropped
+      id = (unsigned short)((rx_[0] << 8) | rx_[1]);
+      for (it = pending_.begin(); it != pending_.end(); ++it)
+      {
+        if (it->second.id == id && !it->second.done)
+        {
+          it->second.length = frameLength - 7;
+          memcpy(it->second.reply, rx_ + 7, it->second.length);
+          it->second.done = true;
+          break;
+        }
+      }
+      rxHeld_ -= frameLength;
+      memmove(rx_, rx_ + frameLength, rxHeld_);
+    }
+  }
+
+
+  LIBRARY_API int CrpiModbusSession::AddPoll (unsigned char unit,
+                                              unsigned char function,
+                                              const unsigned char *pdu,
+                                              int length,
+                                              CrpiModbusHandler handler,
+                                              void *param,
+                                              double timeout)
+  {
+    size_t id;
+
+    ulapi_mutex_take(mutex_);
+    for (id = 0; id < polls_.size(); ++id)
+    {
+      if (!polls_[id].active && !polls_[id].busy)
+      {
+        break;
+      }
+    }
+    if (id == polls_.size())
+    {
+      polls_.push_back(poll());
+    }
+
+    poll &p = polls_[id];
+    p.active = true;
+    p.busy = false;
+    p.unit = unit;
+    p.function = function;
+    p.pdu.assign(pdu, pdu + length);
+    p.handler = handler;
+    p.param = param;
+    p.timeout = timeout;
+    p.due = 0.0;
+    ulapi_cond_broadcast(pollCond_);
+    ulapi_mutex_give(mutex_);
+
+    return (int)id;
+  }
+
+
+  LIBRARY_API void CrpiModbusSession::Wake (int poll)
+  {
+    ulapi_mutex_take(mutex_);
+    if (poll >= 0 && (size_t)poll < polls_.size() && polls_[poll].active)
+    {
+      polls_[poll].due = 0.0;
+      ulapi_cond_broadcast(pollCond_);
+    }
+    ulapi_mutex_give(mutex_);
+  }
+
+
+  LIBRARY_API void CrpiModbusSession::RemovePoll (int poll)
+  {
+    ulapi_mutex_take(mutex_);
+    if (poll >= 0 && (size_t)poll < polls_.size())
+    {
+      polls_[poll].active = false;
+      while (polls_[poll].busy)
+      {
+        ulapi_cond_timedwait(pollCond_, mutex_, MODBUS_IDLE);
+      }
+    }
+    ulapi_mutex_give(mutex_);
+  }
+
+
+  void CrpiModbusSession::pollLoop (void *param)
+  {
+    CrpiModbusSession *session = (CrpiModbusSession*)param;
+    std::vector<size_t> due;
+    std::vector<poll> work;
+    std::vector<int> tickets;
+    std::vector<double> delays;
+    unsigned char reply[CRPI_MODBUS_FRAME_MAX];
+    double now, next;
+    int length;
+    size_t i;
+
+    ulapi_mutex_take(session->mutex_);
+    while (session->run_)
+    {
+      //! Collect every poll that is due, and when the next one will be
+      now = ulapi_time();
+      next = now + MODBUS_IDLE;
+      due.clear();
+      for (i = 0; i < session->polls_.size(); ++i)
+      {
+        poll &p = session->polls_[i];
+        if (!p.active || p.busy)
+        {
+          continue;
+        }
+        if (p.due <= now)
+        {
+          p.busy = true;
+          due.push_back(i);
+        }
+        else if (p.due < next)
+        {
+          next = p.due;
+        }
+      }
+      if (due.empty())
+      {
+        ulapi_cond_timedwait(session->pollCond_, session->mutex_, next - now);
+        continue;
+      }
+
+      //! Work from copies, since AddPoll may grow polls_ meanwhile; a busy slot is not reused
+      work.clear();
+      for (i = 0; i < due.size(); ++i)
+      {
+        work.push_back(session->polls_[due[i]]);
+      }
+      ulapi_mutex_give(session->mutex_);
+
+      //! Send every request before waiting for any reply, so that the gateway answers them in
+      //! one round trip
+      tickets.resize(work.size());
+      delays.resize(work.size());
+      for (i = 0; i < work.size(); ++i)
+      {
+        tickets[i] = session->Begin(work[i].unit, work[i].function,
+                                    work[i].pdu.empty() ? NULL : &work[i].pdu[0],
+                                    (int)work[i].pdu.size());
+      }
+      for (i = 0; i < work.size(); ++i)
+      {
+        length = 0;
+        if (tickets[i] >= 0)
+        {
+          session->End(tickets[i], reply, length, now + work[i].timeout - ulapi_time());
+        }
+        delays[i] = work[i].handler(work[i].param, (length > 0) ? reply : NULL, length);
+      }
+
+      ulapi_mutex_take(session->mutex_);
+      now = ulapi_time();
+      for (i = 0; i < due.size(); ++i)
+      {
+        session->polls_[due[i]].busy = false;
+        session->polls_[due[i]].due = now + delays[i];
+      }
+      ulapi_cond_broadcast(session->pollCond_);
+    }
+    ulapi_mutex_give(session->mutex_);
+  }
+} // namespace crpi_robot
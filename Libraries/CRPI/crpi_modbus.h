@@ -0,0 +1,214 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_modbus.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Modbus/TCP sessions shared by the devices behind one gateway.
+//
+//  Devices such as Robotiq grippers are reached through a Modbus/TCP
+//  gateway, and an end effector may put several of them, each with its own
+//  unit identifier, behind the same gateway.  CrpiModbusSession::Acquire
+//  returns the one session for a gateway address, however many drivers use
+//  it.  The session multiplexes the devices' requests on one connection:
+//  requests from any number of threads are in flight at once and replies
+//  are matched to them by transaction identifier, and one SensorHub loop
+//  issues the periodic status requests of every device, back-to-back, so
+//  that polling N devices costs one round trip rather than N.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_modbus_H
+#define crpi_modbus_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "crpi.h"
+
+//! @brief Largest Modbus/TCP frame (MBAP header + PDU) in bytes
+//!
+#define CRPI_MODBUS_FRAME_MAX 260
+
+//! @brief Modbus function codes
+//!
+#define MODBUS_READ_INPUT 0x04
+#define MODBUS_WRITE_MULTIPLE 0x10
+#define MODBUS_READ_WRITE_MULTIPLE 0x17
+#define MODBUS_EXCEPTION 0x80
+
+namespace crpi_robot
+{
+  //! @brief Receiver of a periodic request's replies, called on the session's polling thread
+  //!
+  //! @param param  The parameter given to AddPoll
+  //! @param reply  The reply, starting with its function code, or NULL if none arrived in time
+  //! @param length Number of bytes in reply
+  //!
+  //! @return Seconds until the request is to be sent again
+  //!
+  typedef double (*CrpiModbusHandler) (void *param, const unsigned char *reply, int length);
+
+  //! @ingroup Robot
+  //!
+  //! @brief One Modbus/TCP connection, shared by the devices behind a gateway
+  //!
+  class LIBRARY_API CrpiModbusSession
+  {
+  public:
+    //! @brief Get the session for a gateway, connecting to it if no driver uses it yet
+    //!
+    //! @param address The gateway's IPv4 address
+    //! @param port    The gateway's Modbus/TCP port
+    //!
+    //! @return The session (Release it when done), or NULL if the gateway could not be reached
+    //!
+    static CrpiModbusSession *Acquire (const char *address, int port);
+
+    //! @brief Stop using a session; the last user's release closes the connection
+    //!
+    static void Release (CrpiModbusSession *session);
+
+    //! @brief Send a request without waiting for its reply
+    //!
+    //! @param unit     Modbus unit identifier of the device
+    //! @param function Modbus function code
+    //! @param pdu      Request data following the function code
+    //! @param length   Number of bytes in pdu
+    //!
+    //! @return A ticket for End, or -1 if the request could not be sent (End must not be
+    //!         called for it)
+    //!
+    int Begin (unsigned char unit, unsigned char function, const unsigned char *pdu, int length);
+
+    //! @brief Wait for the reply to a request sent with Begin
+    //!
+    //! @param ticket      The request's ticket
+    //! @param reply       Buffer (CRPI_MODBUS_FRAME_MAX bytes) for the reply, starting with its
+    //!                    function code
+    //! @param replyLength Number of bytes written to reply, 0 if no reply arrived
+    //! @param timeout     Maximum time (s) to wait
+    //!
+    //! @return True if a non-exception reply was received, false otherwise.  A reply that
+    //!         arrives after the timeout is discarded.
+    //!
+    bool End (int ticket, unsigned char *reply, int &replyLength, double timeout);
+
+    //! @brief Begin and End
+    //!
+    bool Transact (unsigned char unit, unsigned char function, const unsigned char *pdu, int length,
+                   unsigned char *reply, int &replyLength, double timeout);
+
+    //! @brief Send a request periodically from the session's polling thread
+    //!
+    //! @param unit     Modbus unit identifier of the device
+    //! @param function Modbus function code
+    //! @param pdu      Request data following the function code
+    //! @param length   Number of bytes in pdu
+    //! @param handler  Receiver of the replies, which also sets the period
+    //! @param param    Passed to handler
+    //! @param timeout  Maximum time (s) to wait for each reply
+    //!
+    //! @return The poll's identifier (for Wake and RemovePoll)
+    //!
+    int AddPoll (unsigned char unit, unsigned char function, const unsigned char *pdu, int length,
+                 CrpiModbusHandler handler, void *param, double timeout);
+
+    //! @brief Send a periodic request now rather than when it is next due
+    //!
+    void Wake (int poll);
+
+    //! @brief Stop a periodic request.  On return its handler is not running and will not be
+    //!        called again.
+    //!
+    void RemovePoll (int poll);
+
+    //! @brief The gateway's address, as given to Acquire
+    //!
+    const std::string &Address () const
+    {
+      return key_;
+    }
+
+  private:
+    //! @brief A request waiting for its reply
+    //!
+    struct pending
+    {
+      unsigned short id;
+      bool done;
+      unsigned char reply[CRPI_MODBUS_FRAME_MAX];
+      int length;
+    };
+
+    //! @brief A periodic request
+    //!
+    struct poll
+    {
+      bool active;
+      bool busy;
+      unsigned char unit;
+      unsigned char function;
+      std::vector<unsigned char> pdu;
+      CrpiModbusHandler handler;
+      void *param;
+      double timeout;
+      double due;
+    };
+
+    CrpiModbusSession (const std::string &key, ulapi_integer socket);
+    ~CrpiModbusSession ();
+
+    //! @brief Registry key ("address:port") and number of users
+    //!
+    std::string key_;
+    int users_;
+
+    //! @brief The connection, and bytes read from it that are not a whole frame yet
+    //!
+    ulapi_integer socket_;
+    unsigned char rx_[CRPI_MODBUS_FRAME_MAX];
+    int rxHeld_;
+
+    //! @brief Guards everything below; cond_ is broadcast when replies are delivered and
+    //!        pollCond_ when the polls change
+    //!
+    ulapi_mutex_struct *mutex_;
+    void *cond_;
+    void *pollCond_;
+
+    //! @brief Last transaction identifier, requests in flight (by ticket), and whether a
+    //!        waiter is reading the connection on behalf of the rest
+    //!
+    unsigned short transaction_;
+    std::map<int, pending> pending_;
+    int nextTicket_;
+    bool reading_;
+
+    //! @brief Periodic requests and the loop that sends them
+    //!
+    std::vector<poll> polls_;
+    bool run_;
+    void *loop_;
+
+    //! @brief Move every whole frame in rx_ to the request it answers
+    //!
+    void deliver ();
+
+    //! @brief Polling loop
+    //!
+    //! @param param The session
+    //!
+    static void pollLoop (void *param);
+
+    CrpiModbusSession (const CrpiModbusSession &) = delete;
+    CrpiModbusSession &operator= (const CrpiModbusSession &) = delete;
+  }; // CrpiModbusSession
+} // namespace crpi_robot
+
+#endif
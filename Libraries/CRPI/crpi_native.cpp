@@ -0,0 +1,133 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_native.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Program translation definitions.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_native.h"
+#include "crpi_log.h"
+#include <vector>
+
+using namespace std;
+using namespace Xml;
+
+namespace crpi_robot
+{
+  LIBRARY_API CrpiNativeWriter::CrpiNativeWriter (CanonLengthUnit length, CanonAngleUnit angle) :
+    length_(length),
+    angle_(angle)
+  {
+  }
+
+
+  LIBRARY_API CrpiNativeWriter::~CrpiNativeWriter ()
+  {
+  }
+
+
+  LIBRARY_API void CrpiNativeWriter::progress (size_t done)
+  {
+  }
+
+
+  LIBRARY_API bool CrpiNativeWriter::write (const CrpiCompiledProgram &program)
+  {
+    vector<robotPose> poses;
+    vector<double> radii;
+    size_t i, j, num;
+    bool flag;
+
+    for (i = program.next; i < program.steps.size(); i += num)
+    {
+      const CrpiProgramStep &step = program.steps[i];
+      num = 1;
+      flag = true;
+
+      switch (step.cmd)
+      {
+      case CmdMoveTo:
+      case CmdMoveStraightTo:
+        //! Blend through the following moves of the same type, as RunProgram would, but
+        //! without its lookahead limit
+        poses.clear();
+        for (num = 0; (i + num) < program.steps.size() && program.steps[i + num].cmd == step.cmd; ++num)
+        {
+          poses.push_back (program.steps[i + num].pose);
+        }
+        radii.resize (num);
+        crpi_blend_radii (&poses[0], (int)num, NULL, CRPI_DEFAULT_BLEND_MM * crpi_length_scale (MM, length_),
+                          &radii[0]);
+        for (j = 0; j < num && flag; ++j)
+        {
+          flag = move (step.cmd, poses[j], radii[j]);
+          if (flag && (j + 1) < num)
+          {
+            progress (i + j + 1 - program.next);
+          }
+        }
+        break;
+      case CmdMoveToAxisTarget:
+        flag = axes (program.axes[step.integer]);
+        break;
+      case CmdSetRobotDO:
+        flag = output (step.integer, step.boolean);
+        break;
+      case CmdDwell:
+        flag = dwell (step.real);
+        break;
+      case CmdMessage:
+        flag = message (program.strings[step.integer]);
+        break;
+      case CmdSetAbsoluteSpeed:
+      case CmdSetRelativeSpeed:
+        flag = speed (step.real, (step.cmd == CmdSetRelativeSpeed));
+        break;
+      case CmdSetAbsoluteAcceleration:
+      case CmdSetRelativeAcceleration:
+        flag = acceleration (step.real, (step.cmd == CmdSetRelativeAcceleration));
+        break;
+      case CmdSetLengthUnits:
+        flag = crpi_length_unit (program.strings[step.integer].c_str(), length_);
+        break;
+      case CmdSetAngleUnits:
+        flag = crpi_angle_unit (program.strings[step.integer].c_str(), angle_);
+        break;
+      case CmdEndCanon:
+      case CmdInitCanon:
+      case CmdGetRobotAxes:
+      case CmdGetRobotIO:
+      case CmdGetRobotPose:
+      case CmdSetAxialSpeeds:
+      case CmdSetAxialUnits:
+      case CmdSetEndPoseTolerance:
+      case CmdSetIntermediatePoseTolerance:
+      case CmdSetParameter:
+      case CmdStopMotion:
+        //! Nothing to do on the controller (RunProgram does not act on these either)
+        break;
+      default:
+        CRPI_LOG(CRPI_LOG_ERROR, "CrpiNativeWriter:  step %u (command %d) has no native translation",
+                 (unsigned int)i, (int)step.cmd);
+        return false;
+      }
+
+      if (!flag)
+      {
+        CRPI_LOG(CRPI_LOG_ERROR, "CrpiNativeWriter:  cannot translate step %u (command %d)",
+                 (unsigned int)i, (int)step.cmd);
+        return false;
+      }
+      progress (i + num - program.next);
+    }
+
+    return true;
+  }
+} // namespace crpi_robot
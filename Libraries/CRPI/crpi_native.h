@@ -0,0 +1,105 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_native.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Translation of compiled programs into controller languages.
+//
+//  CrpiNativeWriter walks a compiled program (CrpiRobot::LoadProgram) the
+//  way RunProgram would, and hands each step to a driver's writer, which
+//  appends the equivalent statements of its controller's language:  URScript
+//  for the Universal Robots, a RAPID module for the IRC5 handler, and KRL
+//  for the KUKA KRC2.  Runs of consecutive moves of one type are blended,
+//  with the radii MoveThroughTo would use, and unit changes are tracked so
+//  that every pose is written in the units it was given in.  A step with no
+//  equivalent on the controller (e.g., Couple) fails the translation.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_native_H
+#define crpi_native_H
+
+#include "crpi.h"
+#include "crpi_xml.h"
+#include <string>
+
+namespace crpi_robot
+{
+  //! @ingroup Robot
+  //!
+  //! @brief Translates a compiled program one step at a time (see crpiNativeProgram)
+  //!
+  class LIBRARY_API CrpiNativeWriter
+  {
+  public:
+    //! @brief Constructor
+    //!
+    //! @param length The robot's length units when the program starts
+    //! @param angle  The robot's angle units when the program starts
+    //!
+    CrpiNativeWriter (CanonLengthUnit length, CanonAngleUnit angle);
+
+    //! @brief Default destructor
+    //!
+    virtual ~CrpiNativeWriter ();
+
+    //! @brief Translate a program from its next step
+    //!
+    //! @param program The program to translate
+    //!
+    //! @return True if every step was translated, false otherwise
+    //!
+    bool write (const Xml::CrpiCompiledProgram &program);
+
+  protected:
+    //! @brief One move of a MoveTo (PTP) or MoveStraightTo (LIN) step
+    //!
+    //! @param cmd    CmdMoveTo or CmdMoveStraightTo
+    //! @param pose   The target, in the current units
+    //! @param radius Blend radius (current length units) with the next move, or 0 to stop on
+    //!               the target
+    //!
+    virtual bool move (CanonCommand cmd, const robotPose &pose, double radius) = 0;
+
+    //! @brief A MoveToAxisTarget step, with the joints in the current angle units
+    //!
+    virtual bool axes (const robotAxes &joints) = 0;
+
+    //! @brief A SetRobotDO step
+    //!
+    virtual bool output (int signal, bool value) = 0;
+
+    //! @brief A Dwell step
+    //!
+    virtual bool dwell (double seconds) = 0;
+
+    //! @brief A Message step
+    //!
+    virtual bool message (const std::string &text) = 0;
+
+    //! @brief A Set*Speed step:  an absolute speed in the current length units, or a fraction
+    //!        of the robot's maximum speed
+    //!
+    virtual bool speed (double value, bool relative) = 0;
+
+    //! @brief A Set*Acceleration step, as speed
+    //!
+    virtual bool acceleration (double value, bool relative) = 0;
+
+    //! @brief Called after each step with the number of steps translated so far
+    //!
+    virtual void progress (size_t done);
+
+    //! @brief Units of the step being translated
+    //!
+    CanonLengthUnit length_;
+    CanonAngleUnit angle_;
+  }; // CrpiNativeWriter
+} // namespace crpi_robot
+
+#endif
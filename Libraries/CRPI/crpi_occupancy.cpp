@@ -0,0 +1,536 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_occupancy.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Shared workspace occupancy map definitions.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_occupancy.h"
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define OCCUPANCY_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define OCCUPANCY_NEON
+#endif
+
+using namespace std;
+
+namespace crpi_robot
+{
+  //! @brief Voxel coordinates are kept within +/- voxelLimit, so that brick coordinates pack
+  //!        into 21 bits each; points further out (or not finite) are ignored
+  //!
+  static const int voxelLimit = 1 << 23;
+
+  //! @brief Added before truncation so that it rounds down for negative coordinates too
+  //!
+  static const int voxelBias = 1 << 24;
+
+  static const long long keyMask = (1LL << 21) - 1;
+
+
+  //! @brief Hash key of brick coordinates
+  //!
+  static inline long long brickKey (int bx, int by, int bz)
+  {
+    return ((bx & keyMask) << 42) | ((by & keyMask) << 21) | (bz & keyMask);
+  }
+
+
+  //! @brief Brick coordinate packed in a key at the given shift
+  //!
+  static inline int keyCoordinate (long long key, int shift)
+  {
+    int c = (int)((key >> shift) & keyMask);
+    return (c >= (1 << 20)) ? (c - (1 << 21)) : c;
+  }
+
+
+  //! @brief Whether voxel coordinates are within the map
+  //!
+  static inline bool inRange (int ix, int iy, int iz)
+  {
+    return ((unsigned int)ix + voxelLimit) < (2u * voxelLimit) &&
+           ((unsigned int)iy + voxelLimit) < (2u * voxelLimit) &&
+           ((unsigned int)iz + voxelLimit) < (2u * voxelLimit);
+  }
+
+
+  //! @brief Index of a voxel within its brick; the z layer selects the word of bits, so a brick's
+  //!        words are its layers
+  //!
+  static inline int voxelIndex (int ix, int iy, int iz)
+  {
+    const int m = OCCUPANCY_BRICK - 1;
+    return (ix & m) | ((iy & m) << OCCUPANCY_BRICK_BITS) | ((iz & m) << (2 * OCCUPANCY_BRICK_BITS));
+  }
+
+
+  //! @brief Quantize n coordinates to voxel indices (floor(v * scale)).  Values that are not
+  //!        finite or are out of the int range come out outside voxelLimit.
+  //!
+  static void quantize (const double *v, int *out, int n, double scale)
+  {
+    int i = 0;
+#if defined(OCCUPANCY_SSE2)
+    const __m128d s = _mm_set1_pd(scale), b = _mm_set1_pd((double)voxelBias);
+    const __m128i bi = _mm_set1_epi32(voxelBias);
+    for (; i + 2 <= n; i += 2)
+    {
+      //! Overflow and NaN truncate to INT_MIN, which wraps well away from the map
+      __m128i q = _mm_cvttpd_epi32(_mm_add_pd(_mm_mul_pd(_mm_loadu_pd(v + i), s), b));
+      _mm_storel_epi64((__m128i*)(out + i), _mm_sub_epi32(q, bi));
+    }
+#elif defined(OCCUPANCY_NEON)
+    const float64x2_t s = vdupq_n_f64(scale), b = vdupq_n_f64((double)voxelBias);
+    const int64x2_t bi = vdupq_n_s64(voxelBias);
+    for (; i + 2 <= n; i += 2)
+    {
+      //! Conversions saturate (NaN to 0, hence -voxelBias), and so does the narrowing
+      int64x2_t q = vsubq_s64(vcvtq_s64_f64(vaddq_f64(vmulq_f64(vld1q_f64(v + i), s), b)), bi);
+      vst1_s32(out + i, vqmovn_s64(q));
+    }
+#endif
+    for (; i < n; ++i)
+    {
+      double q = v[i] * scale;
+      out[i] = (q > -voxelLimit && q < voxelLimit) ? (int)floor(q) : voxelLimit;
+    }
+  }
+
+
+  LIBRARY_API CrpiOccupancyMap::CrpiOccupancyMap (double voxel, double decay) :
+    voxel_((voxel > 0.0) ? voxel : 20.0),
+    decay_(decay),
+    epoch_(ulapi_time()),
+    sweep_(0),
+    lock_(ulapi_fastlock_new())
+  {
+    scale_ = 1.0 / voxel_;
+    ix_ = new int[OCCUPANCY_BATCH];
+    iy_ = new int[OCCUPANCY_BATCH];
+    iz_ = new int[OCCUPANCY_BATCH];
+  }
+
+
+  LIBRARY_API CrpiOccupancyMap::~CrpiOccupancyMap ()
+  {
+    for (size_t i = 0; i < bricks_.size(); ++i)
+    {
+      delete bricks_[i];
+    }
+    delete [] ix_;
+    delete [] iy_;
+    delete [] iz_;
+    ulapi_fastlock_delete(lock_);
+  }
+
+
+  LIBRARY_API void CrpiOccupancyMap::Insert (const double *x, const double *y, const double *z, int numPoints,
+                                             double timestamp)
+  {
+    int n;
+
+    if (x == NULL || y == NULL || z == NULL)
+    {
+      return;
+    }
+    ulapi_fastlock_take(lock_);
+    for (int i = 0; i < numPoints; i += n)
+    {
+      n = ((numPoints - i) < OCCUPANCY_BATCH) ? (numPoints - i) : OCCUPANCY_BATCH;
+      quantize(x + i, ix_, n, scale_);
+      quantize(y + i, iy_, n, scale_);
+      quantize(z + i, iz_, n, scale_);
+      mark(ix_, iy_, iz_, n, stamp(timestamp));
+    }
+    //! Keep up with the expiry:  every brick is checked within eight updates
+    expire(timestamp, (int)(bricks_.size() / 8) + 1);
+    ulapi_fastlock_give(lock_);
+  }
+
+
+  LIBRARY_API void CrpiOccupancyMap::Insert (const double *points, int numPoints, double timestamp)
+  {
+    int n;
+
+    if (points == NULL)
+    {
+      return;
+    }
+    ulapi_fastlock_take(lock_);
+    for (int i = 0; i < numPoints; i += n)
+    {
+      n = ((numPoints - i) < OCCUPANCY_BATCH) ? (numPoints - i) : OCCUPANCY_BATCH;
+      //! Tracked points are few; quantize the triples in place of a transpose
+      for (int j = 0; j < n; ++j)
+      {
+        quantize(points + ((size_t)(i + j) * 3), ix_ + j, 1, scale_);
+        quantize(points + ((size_t)(i + j) * 3) + 1, iy_ + j, 1, scale_);
+        quantize(points + ((size_t)(i + j) * 3) + 2, iz_ + j, 1, scale_);
+      }
+      mark(ix_, iy_, iz_, n, stamp(timestamp));
+    }
+    expire(timestamp, (int)(bricks_.size() / 8) + 1);
+    ulapi_fastlock_give(lock_);
+  }
+
+
+  LIBRARY_API void CrpiOccupancyMap::InsertSpheres (const double *points, int numPoints, double radius,
+                                                    double timestamp)
+  {
+    int lower[3], upper[3], n = 0;
+    double d, dx, dy, dz, r2 = radius * radius;
+    float seen = stamp(timestamp);
+
+    if (points == NULL || radius < 0.0)
+    {
+      return;
+    }
+    ulapi_fastlock_take(lock_);
+    for (int i = 0; i < numPoints; ++i)
+    {
+      const double *p = points + ((size_t)i * 3);
+      for (int j = 0; j < 3; ++j)
+      {
+        d = p[j] - radius;
+        quantize(&d, lower + j, 1, scale_);
+        d = p[j] + radius;
+        quantize(&d, upper + j, 1, scale_);
+      }
+      if (!inRange(lower[0], lower[1], lower[2]) || !inRange(upper[0], upper[1], upper[2]))
+      {
+        continue;
+      }
+
+      //! Voxels whose centres are within the radius, and always the voxel holding the point
+      for (int iz = lower[2]; iz <= upper[2]; ++iz)
+      {
+        dz = ((iz + 0.5) * voxel_) - p[2];
+        for (int iy = lower[1]; iy <= upper[1]; ++iy)
+        {
+          dy = ((iy + 0.5) * voxel_) - p[1];
+          for (int ix = lower[0]; ix <= upper[0]; ++ix)
+          {
+            dx = ((ix + 0.5) * voxel_) - p[0];
+            if ((dx * dx) + (dy * dy) + (dz * dz) > r2 &&
+                (ix != (int)floor(p[0] * scale_) || iy != (int)floor(p[1] * scale_) ||
+                 iz != (int)floor(p[2] * scale_)))
+            {
+              continue;
+            }
+            ix_[n] = ix;
+            iy_[n] = iy;
+            iz_[n] = iz;
+            if (++n == OCCUPANCY_BATCH)
+            {
+              mark(ix_, iy_, iz_, n, seen);
+              n = 0;
+            }
+          }
+        }
+      }
+    }
+    mark(ix_, iy_, iz_, n, seen);
+    expire(timestamp, (int)(bricks_.size() / 8) + 1);
+    ulapi_fastlock_give(lock_);
+  }
+
+
+  LIBRARY_API void CrpiOccupancyMap::Expire (double now, int maxBricks)
+  {
+    ulapi_fastlock_take(lock_);
+    expire(now, maxBricks);
+    ulapi_fastlock_give(lock_);
+  }
+
+
+  void CrpiOccupancyMap::expire (double now, int maxBricks)
+  {
+    float cutoff = stamp(now - decay_);
+    size_t count = (maxBricks <= 0 || (size_t)maxBricks > bricks_.size()) ? bricks_.size() : (size_t)maxBricks;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      if (sweep_ >= bricks_.size())
+      {
+        sweep_ = 0;
+      }
+      expireBrick(sweep_++, cutoff);
+    }
+  }
+
+
+  LIBRARY_API void CrpiOccupancyMap::Clear ()
+  {
+    ulapi_fastlock_take(lock_);
+    index_.clear();
+    free_.clear();
+    for (size_t i = 0; i < bricks_.size(); ++i)
+    {
+      if (bricks_[i]->count >= 0)
+      {
+        memset(bricks_[i]->bits, 0, sizeof(bricks_[i]->bits));
+        bricks_[i]->count = -1;
+      }
+      free_.push_back(i);
+    }
+    ulapi_fastlock_give(lock_);
+  }
+
+
+  LIBRARY_API bool CrpiOccupancyMap::Occupied (double x, double y, double z, double now) const
+  {
+    int ix, iy, iz, v;
+    bool occupied = false;
+
+    quantize(&x, &ix, 1, scale_);
+    quantize(&y, &iy, 1, scale_);
+    quantize(&z, &iz, 1, scale_);
+    if (!inRange(ix, iy, iz))
+    {
+      return false;
+    }
+
+    ulapi_fastlock_take(lock_);
+    const occupancyBrick *b = brick(ix, iy, iz);
+    if (b != NULL)
+    {
+      v = voxelIndex(ix, iy, iz);
+      occupied = ((b->bits[v >> 6] >> (v & 63)) & 1ULL) != 0 && b->seen[v] >= stamp(now - decay_);
+    }
+    ulapi_fastlock_give(lock_);
+    return occupied;
+  }
+
+
+  LIBRARY_API bool CrpiOccupancyMap::OccupiedBox (const double *lower, const double *upper, double now) const
+  {
+    int lo[3], hi[3], v;
+    bool occupied = false;
+
+    for (int i = 0; i < 3; ++i)
+    {
+      quantize(lower + i, lo + i, 1, scale_);
+      quantize(upper + i, hi + i, 1, scale_);
+    }
+    if (!inRange(lo[0], lo[1], lo[2]) || !inRange(hi[0], hi[1], hi[2]))
+    {
+      return false;
+    }
+
+    ulapi_fastlock_take(lock_);
+    float cutoff = stamp(now - decay_);
+    //! One lookup per brick, then the bits of the voxels of the brick that are in the box
+    for (int bz = lo[2] >> OCCUPANCY_BRICK_BITS; !occupied && bz <= (hi[2] >> OCCUPANCY_BRICK_BITS); ++bz)
+    {
+      for (int by = lo[1] >> OCCUPANCY_BRICK_BITS; !occupied && by <= (hi[1] >> OCCUPANCY_BRICK_BITS); ++by)
+      {
+        for (int bx = lo[0] >> OCCUPANCY_BRICK_BITS; !occupied && bx <= (hi[0] >> OCCUPANCY_BRICK_BITS); ++bx)
+        {
+          const occupancyBrick *b = brick(bx << OCCUPANCY_BRICK_BITS, by << OCCUPANCY_BRICK_BITS,
+                                          bz << OCCUPANCY_BRICK_BITS);
+          if (b == NULL)
+          {
+            continue;
+          }
+          for (int iz = max(lo[2], bz << OCCUPANCY_BRICK_BITS);
+               !occupied && iz <= min(hi[2], ((bz + 1) << OCCUPANCY_BRICK_BITS) - 1); ++iz)
+          {
+            for (int iy = max(lo[1], by << OCCUPANCY_BRICK_BITS);
+                 !occupied && iy <= min(hi[1], ((by + 1) << OCCUPANCY_BRICK_BITS) - 1); ++iy)
+            {
+              for (int ix = max(lo[0], bx << OCCUPANCY_BRICK_BITS);
+                   !occupied && ix <= min(hi[0], ((bx + 1) << OCCUPANCY_BRICK_BITS) - 1); ++ix)
+              {
+                v = voxelIndex(ix, iy, iz);
+                occupied = ((b->bits[v >> 6] >> (v & 63)) & 1ULL) != 0 && b->seen[v] >= cutoff;
+              }
+            }
+          }
+        }
+      }
+    }
+    ulapi_fastlock_give(lock_);
+    return occupied;
+  }
+
+
+  LIBRARY_API int CrpiOccupancyMap::GetOccupied (vector<double> &centres, double now) const
+  {
+    int ox, oy, oz, v;
+
+    centres.clear();
+    ulapi_fastlock_take(lock_);
+    float cutoff = stamp(now - decay_);
+    for (size_t i = 0; i < bricks_.size(); ++i)
+    {
+      const occupancyBrick *b = bricks_[i];
+      if (b->count <= 0)
+      {
+        continue;
+      }
+      ox = keyCoordinate(b->key, 42) << OCCUPANCY_BRICK_BITS;
+      oy = keyCoordinate(b->key, 21) << OCCUPANCY_BRICK_BITS;
+      oz = keyCoordinate(b->key, 0) << OCCUPANCY_BRICK_BITS;
+      for (int w = 0; w < OCCUPANCY_BRICK_VOXELS / 64; ++w)
+      {
+        for (unsigned long long bits = b->bits[w]; bits != 0; bits &= bits - 1)
+        {
+          //! Index of the lowest set bit
+          v = 0;
+          while (((bits >> v) & 1ULL) == 0)
+          {
+            ++v;
+          }
+          v += w * 64;
+          if (b->seen[v] < cutoff)
+          {
+            continue;
+          }
+          centres.push_back((ox + (v & (OCCUPANCY_BRICK - 1)) + 0.5) * voxel_);
+          centres.push_back((oy + ((v >> OCCUPANCY_BRICK_BITS) & (OCCUPANCY_BRICK - 1)) + 0.5) * voxel_);
+          centres.push_back((oz + (v >> (2 * OCCUPANCY_BRICK_BITS)) + 0.5) * voxel_);
+        }
+      }
+    }
+    ulapi_fastlock_give(lock_);
+    return (int)(centres.size() / 3);
+  }
+
+
+  LIBRARY_API double CrpiOccupancyMap::VoxelSize () const
+  {
+    return voxel_;
+  }
+
+
+  void CrpiOccupancyMap::mark (const int *ix, const int *iy, const int *iz, int count, float seen)
+  {
+    occupancyBrick *b = NULL;
+    long long key = 0;
+    unsigned long long bit;
+    int v;
+
+    for (int i = 0; i < count; ++i)
+    {
+      if (!inRange(ix[i], iy[i], iz[i]))
+      {
+        continue;
+      }
+      //! Neighbouring points (a depth image's rows, a marker's trail) mostly share a brick
+      long long k = brickKey(ix[i] >> OCCUPANCY_BRICK_BITS, iy[i] >> OCCUPANCY_BRICK_BITS,
+                             iz[i] >> OCCUPANCY_BRICK_BITS);
+      if (b == NULL || k != key)
+      {
+        b = brick(ix[i], iy[i], iz[i], true);
+        key = k;
+      }
+      v = voxelIndex(ix[i], iy[i], iz[i]);
+      bit = 1ULL << (v & 63);
+      if ((b->bits[v >> 6] & bit) == 0)
+      {
+        b->bits[v >> 6] |= bit;
+        b->seen[v] = seen;
+        ++b->count;
+      }
+      else if (seen > b->seen[v])
+      {
+        b->seen[v] = seen;
+      }
+    }
+  }
+
+
+  occupancyBrick *CrpiOccupancyMap::brick (int ix, int iy, int iz, bool create)
+  {
+    long long key = brickKey(ix >> OCCUPANCY_BRICK_BITS, iy >> OCCUPANCY_BRICK_BITS, iz >> OCCUPANCY_BRICK_BITS);
+    occupancyBrick *b;
+    size_t i;
+
+    unordered_map<long long, size_t>::const_iterator it = index_.find(key);
+    if (it != index_.end())
+    {
+      return bricks_[it->second];
+    }
+    if (!create)
+    {
+      return NULL;
+    }
+
+    if (!free_.empty())
+    {
+      i = free_.back();
+      free_.pop_back();
+      b = bricks_[i];
+    }
+    else
+    {
+      i = bricks_.size();
+      b = new occupancyBrick;
+      memset(b->bits, 0, sizeof(b->bits));
+      bricks_.push_back(b);
+    }
+    b->key = key;
+    b->count = 0;
+    index_[key] = i;
+    return b;
+  }
+
+
+  const occupancyBrick *CrpiOccupancyMap::brick (int ix, int iy, int iz) const
+  {
+    unordered_map<long long, size_t>::const_iterator it =
+      index_.find(brickKey(ix >> OCCUPANCY_BRICK_BITS, iy >> OCCUPANCY_BRICK_BITS, iz >> OCCUPANCY_BRICK_BITS));
+    return (it == index_.end()) ? NULL : bricks_[it->second];
+  }
+
+
+  void CrpiOccupancyMap::expireBrick (size_t index, float cutoff)
+  {
+    occupancyBrick *b = bricks_[index];
+
+    if (b->count <= 0)
+    {
+      return;
+    }
+    for (int w = 0; w < OCCUPANCY_BRICK_VOXELS / 64; ++w)
+    {
+      if (b->bits[w] == 0)
+      {
+        continue;
+      }
+      for (int j = 0; j < 64; ++j)
+      {
+        if (((b->bits[w] >> j) & 1ULL) != 0 && b->seen[(w * 64) + j] < cutoff)
+        {
+          b->bits[w] &= ~(1ULL << j);
+          --b->count;
+        }
+      }
+    }
+    if (b->count == 0)
+    {
+      index_.erase(b->key);
+      b->count = -1;
+      free_.push_back(index);
+    }
+  }
+
+
+  float CrpiOccupancyMap::stamp (double t) const
+  {
+    return (float)(t - epoch_);
+  }
+} // crpi_robot
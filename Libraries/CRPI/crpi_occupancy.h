@@ -0,0 +1,191 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_occupancy.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Shared workspace occupancy map.
+//
+//  Depth cameras and motion capture each see part of what is in the cell.
+//  The occupancy map merges them into one voxel grid that the collision
+//  checker and the separation monitor can both read:  every measured point
+//  marks its voxel occupied, and voxels that are not seen again within the
+//  decay time are cleared, so the map follows people and objects as they
+//  move without ever being rebuilt.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_occupancy_H
+#define crpi_occupancy_H
+
+#include "crpi.h"
+#include <unordered_map>
+#include <vector>
+
+//! @brief Voxels along each edge of a brick (the unit of allocation), as a power of two
+//!
+#define OCCUPANCY_BRICK_BITS 3
+#define OCCUPANCY_BRICK (1 << OCCUPANCY_BRICK_BITS)
+#define OCCUPANCY_BRICK_VOXELS (OCCUPANCY_BRICK * OCCUPANCY_BRICK * OCCUPANCY_BRICK)
+
+//! @brief Points quantized per batch (bounds the map's scratch memory)
+//!
+#define OCCUPANCY_BATCH 1024
+
+namespace crpi_robot
+{
+  //! @brief An allocated block of voxels:  one occupancy bit and the time last seen per voxel
+  //!
+  struct occupancyBrick
+  {
+    unsigned long long bits[OCCUPANCY_BRICK_VOXELS / 64];
+    float seen[OCCUPANCY_BRICK_VOXELS];
+    long long key;
+    int count;
+  };
+
+  //! @ingroup Robot
+  //!
+  //! @brief Sparse voxel occupancy grid of the cell.  Voxels are grouped into bricks of
+  //!        OCCUPANCY_BRICK^3 that are allocated only where something has been seen, and found
+  //!        through a hash of their brick coordinates, so a lookup costs one hash probe and one
+  //!        bit test regardless of the size of the cell.  Points are quantized in batches with
+  //!        SSE2 or NEON (scalar elsewhere), and consecutive points in the same brick share its
+  //!        lookup, so a depth frame costs little more than reading it.
+  //!
+  //!        A voxel stays occupied until decay seconds after it was last seen.  Expired voxels
+  //!        are cleared a few bricks at a time by each Insert (or by Expire), and a brick whose
+  //!        voxels have all expired is returned to a free list; queries never see an expired
+  //!        voxel, even before it has been cleared.
+  //!
+  //! @note All methods may be called from any thread; updates and queries are serialized by a
+  //!       fast lock (ulapi_fastlock_new) held only for the duration of the call.
+  //!
+  class LIBRARY_API CrpiOccupancyMap
+  {
+  public:
+    //! @brief Constructor
+    //!
+    //! @param voxel Edge length of a voxel (mm)
+    //! @param decay Seconds a voxel stays occupied after it was last seen
+    //!
+    CrpiOccupancyMap (double voxel = 20.0, double decay = 0.5);
+
+    //! @brief Default destructor
+    //!
+    ~CrpiOccupancyMap ();
+
+    //! @brief Mark the voxels of points stored as coordinate arrays (e.g., a Math::PointCloud
+    //!        from a depth camera, transformed into the cell frame)
+    //!
+    //! @param x         X coordinates (mm, cell frame)
+    //! @param y         Y coordinates
+    //! @param z         Z coordinates
+    //! @param numPoints Number of points
+    //! @param timestamp When they were measured (ulapi_time, s)
+    //!
+    void Insert (const double *x, const double *y, const double *z, int numPoints, double timestamp);
+
+    //! @brief Mark the voxels of points stored as x, y, z triples (e.g., MoCap markers)
+    //!
+    void Insert (const double *points, int numPoints, double timestamp);
+
+    //! @brief Mark the voxels within a radius of points stored as x, y, z triples, for tracked
+    //!        points that stand for a volume (e.g., a marker on a forearm)
+    //!
+    //! @param radius Radius (mm) around each point
+    //!
+    void InsertSpheres (const double *points, int numPoints, double radius, double timestamp);
+
+    //! @brief Clear expired voxels, at most maxBricks bricks per call (0 for all of them)
+    //!
+    //! @param now Current time (ulapi_time, s)
+    //!
+    void Expire (double now, int maxBricks = 0);
+
+    //! @brief Clear the whole map
+    //!
+    void Clear ();
+
+    //! @brief Whether the voxel holding a point is occupied
+    //!
+    //! @param now Current time (ulapi_time, s); voxels last seen more than decay before it are free
+    //!
+    bool Occupied (double x, double y, double z, double now) const;
+
+    //! @brief Whether any voxel overlapping an axis-aligned box is occupied
+    //!
+    //! @param lower Least corner (mm, cell frame) as x, y, z
+    //! @param upper Greatest corner
+    //!
+    bool OccupiedBox (const double *lower, const double *upper, double now) const;
+
+    //! @brief Centres of the occupied voxels, as x, y, z triples (e.g., for
+    //!        CrpiSeparationMonitor::Update or CrpiCollision::Separation)
+    //!
+    //! @param centres Replaced by the centres (mm, cell frame)
+    //!
+    //! @return The number of occupied voxels
+    //!
+    int GetOccupied (std::vector<double> &centres, double now) const;
+
+    //! @brief Edge length of a voxel (mm)
+    //!
+    double VoxelSize () const;
+
+  private:
+
+    //! @brief Mark quantized voxel coordinates; lock held
+    //!
+    void mark (const int *ix, const int *iy, const int *iz, int count, float seen);
+
+    //! @brief Brick holding voxel coordinates, allocated if create is set (NULL otherwise); lock held
+    //!
+    occupancyBrick *brick (int ix, int iy, int iz, bool create);
+    const occupancyBrick *brick (int ix, int iy, int iz) const;
+
+    //! @brief Expire without taking the lock; lock held
+    //!
+    void expire (double now, int maxBricks);
+
+    //! @brief Clear the expired voxels of one brick, freeing it if none are left; lock held
+    //!
+    void expireBrick (size_t index, float cutoff);
+
+    //! @brief Time as stored in a brick (seconds since the map was made)
+    //!
+    float stamp (double t) const;
+
+    double voxel_;
+    double scale_;
+    double decay_;
+    double epoch_;
+
+    //! @brief Bricks, indexed by their packed brick coordinates; freed bricks have count < 0
+    //!
+    std::vector<occupancyBrick*> bricks_;
+    std::unordered_map<long long, size_t> index_;
+    std::vector<size_t> free_;
+
+    //! @brief Next brick checked by the incremental expiry
+    //!
+    size_t sweep_;
+
+    //! @brief Quantized coordinates of the current batch
+    //!
+    int *ix_;
+    int *iy_;
+    int *iz_;
+
+    void *lock_;
+
+    CrpiOccupancyMap (const CrpiOccupancyMap &) = delete;
+    CrpiOccupancyMap &operator= (const CrpiOccupancyMap &) = delete;
+  }; // CrpiOccupancyMap
+} // crpi_robot
+
+#endif
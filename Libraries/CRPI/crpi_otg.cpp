@@ -0,0 +1,568 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_otg.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Jerk-limited online trajectory generator definitions.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_otg.h"
+
+#include <math.h>
+
+namespace crpi_robot
+{
+  //! Smallest share of its own limits a synchronized axis moves with (axes with much shorter
+  //! moves than the rest arrive early rather than creep)
+  static const double otgScaleMin = 0.01;
+
+
+  //! @brief Advance a state by a constant jerk
+  //!
+  static void otgIntegrate (double &pos, double &vel, double &acc, double jerk, double time)
+  {
+    pos += time * (vel + time * (acc / 2.0 + time * jerk / 6.0));
+    vel += time * (acc + time * jerk / 2.0);
+    acc += time * jerk;
+  }
+
+
+  //! @brief Distance an axis travels while stopping (to zero velocity and acceleration) as fast
+  //!        as its acceleration and jerk limits allow
+  //!
+  static double otgBrake (double vel, double acc, double maxAcc, double maxJerk)
+  {
+    double pos = 0.0, sign, peak, cruise;
+
+    //! Mirror so that the axis is still moving forward once its acceleration is brought to 0,
+    //! which makes the stop a jerk down to a peak deceleration and a jerk back up
+    sign = ((vel + acc * fabs(acc) / (2.0 * maxJerk)) >= 0.0) ? 1.0 : -1.0;
+    vel *= sign;
+    acc *= sign;
+
+    peak = vel * maxJerk + acc * acc / 2.0;
+    peak = -sqrt((peak > 0.0) ? peak : 0.0);
+    if (peak >= -maxAcc)
+    {
+      otgIntegrate(pos, vel, acc, -maxJerk, (acc - peak) / maxJerk);
+      otgIntegrate(pos, vel, acc, maxJerk, -acc / maxJerk);
+    }
+    else
+    {
+      //! The deceleration limit is reached:  jerk to it, hold it, and jerk back
+      otgIntegrate(pos, vel, acc, (acc > -maxAcc) ? -maxJerk : maxJerk, fabs(acc + maxAcc) / maxJerk);
+      acc = -maxAcc;
+      cruise = (vel - maxAcc * maxAcc / (2.0 * maxJerk)) / maxAcc;
+      if (cruise > 0.0)
+      {
+        otgIntegrate(pos, vel, acc, 0.0, cruise);
+      }
+      otgIntegrate(pos, vel, acc, maxJerk, maxAcc / maxJerk);
+    }
+    return sign * pos;
+  }
+
+
+  //! @brief Time of the fastest rest-to-rest move over a distance
+  //!
+  static double otgRestTime (double dist, double maxVel, double maxAcc, double maxJerk)
+  {
+    double ramp, peak;
+
+    dist = fabs(dist);
+    if (dist <= 0.0)
+    {
+      return 0.0;
+    }
+
+    //! Time to reach full speed from rest; the moves to and from it cover maxVel * ramp
+    ramp = ((maxVel * maxJerk) >= (maxAcc * maxAcc)) ? (maxVel / maxAcc + maxAcc / maxJerk) :
+                                                       (2.0 * sqrt(maxVel / maxJerk));
+    if (dist >= maxVel * ramp)
+    {
+      return ramp + dist / maxVel;
+    }
+
+    //! Full speed is not reached; neither, for short moves, is full acceleration
+    if (dist < (2.0 * maxAcc * maxAcc * maxAcc / (maxJerk * maxJerk)))
+    {
+      return 4.0 * cbrt(dist / (2.0 * maxJerk));
+    }
+    peak = 0.5 * maxAcc * (sqrt((maxAcc * maxAcc) / (maxJerk * maxJerk) + 4.0 * dist / maxAcc) - maxAcc / maxJerk);
+    return 2.0 * (peak / maxAcc + maxAcc / maxJerk);
+  }
+
+
+  //! @brief Whether a jerk held for one period leaves an axis (moving toward its target at
+  //!        err = 0 from err < 0) within its limits and able to stop without overshooting
+  //!
+  //! @param slack Share of the limits (and of one period's full-jerk motion) the check allows
+  //!              beyond them, for rounding
+  //!
+  static bool otgFeasible (double err, double vel, double acc, double jerk, double maxVel,
+                           double maxAcc, double maxJerk, double period, double slack)
+  {
+    otgIntegrate(err, vel, acc, jerk, period);
+    return acc <= maxAcc * (1.0 + slack) &&
+           (vel + acc * fabs(acc) / (2.0 * maxJerk)) <= maxVel * (1.0 + slack) &&
+           (err + otgBrake(vel, acc, maxAcc, maxJerk)) <= slack * maxJerk * period * period * period;
+  }
+
+
+  //! @brief Find the strongest jerk toward the target that keeps an axis within its limits
+  //!
+  //! @param err Position less the target
+  //!
+  //! @return True if such a jerk exists; otherwise jerk is the strongest braking
+  //!
+  static bool otgSearch (double err, double vel, double acc, double maxVel, double maxAcc,
+                         double maxJerk, double period, double &jerk)
+  {
+    double sign, lo, hi, mid;
+    bool found = true;
+    int i;
+
+    //! Mirror so that the target is ahead of where the axis would stop
+    sign = ((err + otgBrake(vel, acc, maxAcc, maxJerk)) <= 0.0) ? 1.0 : -1.0;
+    err *= sign;
+    vel *= sign;
+    acc *= sign;
+
+    //! The search aims exactly at the limits, so that the rounding of one period's choice
+    //! never leaves the next without a way to brake
+    if (otgFeasible(err, vel, acc, maxJerk, maxVel, maxAcc, maxJerk, period, 0.0))
+    {
+      jerk = maxJerk;
+    }
+    else if (!otgFeasible(err, vel, acc, -maxJerk, maxVel, maxAcc, maxJerk, period, 1.0e-6))
+    {
+      jerk = -maxJerk;
+      found = false;
+    }
+    else
+    {
+      lo = -maxJerk;
+      hi = maxJerk;
+      for (i = 0; i < CRPI_OTG_SEARCH; ++i)
+      {
+        mid = 0.5 * (lo + hi);
+        if (otgFeasible(err, vel, acc, mid, maxVel, maxAcc, maxJerk, period, 0.0))
+        {
+          lo = mid;
+        }
+        else
+        {
+          hi = mid;
+        }
+      }
+      jerk = lo;
+    }
+
+    //! Braking never takes the acceleration past its limit either; an axis that cannot stop in
+    //! time overshoots and comes back
+    lo = (-maxAcc - acc) / period;
+    if (jerk < lo)
+    {
+      jerk = (lo < maxJerk) ? lo : maxJerk;
+    }
+    jerk *= sign;
+    return found;
+  }
+
+
+  LIBRARY_API CrpiOnlineTrajectory::CrpiOnlineTrajectory (int dims, double period, const double *maxVel,
+                                                          const double *maxAcc, const double *maxJerk) :
+    dims_((dims < 1) ? 1 : ((dims > CRPI_AXES_MAX) ? CRPI_AXES_MAX : dims)),
+    period_((period > 0.0) ? period : CRPI_OTG_PERIOD),
+    sync_(false),
+    limited_(false),
+    length_(1.0),
+    angle_(1.0)
+  {
+    for (int i = 0; i < CRPI_AXES_MAX; ++i)
+    {
+      angular_[i] = wraps_[i] = false;
+      givenVel_[i] = givenAcc_[i] = givenJerk_[i] = 0.0;
+      vel_[i] = acc_[i] = jerk_[i] = 0.0;
+      pos_[i] = spd_[i] = accel_[i] = target_[i] = 0.0;
+      syncVel_[i] = syncAcc_[i] = syncJerk_[i] = 0.0;
+    }
+    if (maxVel != NULL && maxAcc != NULL)
+    {
+      SetLimits(maxVel, maxAcc, maxJerk);
+    }
+  }
+
+
+  LIBRARY_API CrpiOnlineTrajectory::CrpiOnlineTrajectory (const CrpiRobotParams &params, double period,
+                                                          bool cartesian) :
+    period_((period > 0.0) ? period : CRPI_OTG_PERIOD),
+    sync_(cartesian),
+    limited_(false),
+    length_(1.0),
+    angle_(1.0)
+  {
+    double vel[CRPI_AXES_MAX], acc[CRPI_AXES_MAX], jerk[CRPI_AXES_MAX];
+    const CrpiCartesianLimits &cart = params.cart_limits;
+    size_t n;
+    int i;
+
+    for (i = 0; i < CRPI_AXES_MAX; ++i)
+    {
+      angular_[i] = wraps_[i] = false;
+      givenVel_[i] = givenAcc_[i] = givenJerk_[i] = 0.0;
+      vel_[i] = acc_[i] = jerk_[i] = 0.0;
+      pos_[i] = spd_[i] = accel_[i] = target_[i] = 0.0;
+      syncVel_[i] = syncAcc_[i] = syncJerk_[i] = 0.0;
+    }
+
+    if (cartesian)
+    {
+      dims_ = 6;
+      for (i = 0; i < 3; ++i)
+      {
+        vel[i] = cart.vel;
+        acc[i] = cart.acc;
+        jerk[i] = cart.jerk;
+        vel[i + 3] = cart.angVel;
+        acc[i + 3] = cart.angAcc;
+        jerk[i + 3] = cart.angJerk;
+        angular_[i + 3] = wraps_[i + 3] = true;
+      }
+      if (cart.enabled())
+      {
+        SetLimits(vel, acc, jerk);
+      }
+      return;
+    }
+
+    n = (params.joint_max_vel.size() < params.joint_max_acc.size()) ?
+        params.joint_max_vel.size() : params.joint_max_acc.size();
+    dims_ = (n < 1) ? 1 : ((n > CRPI_AXES_MAX) ? CRPI_AXES_MAX : (int)n);
+    for (i = 0; i < dims_; ++i)
+    {
+      angular_[i] = true;
+      jerk[i] = ((size_t)i < params.joint_max_jerk.size()) ? params.joint_max_jerk[i] : 0.0;
+    }
+    if (n > 0)
+    {
+      SetLimits(&params.joint_max_vel[0], &params.joint_max_acc[0], jerk);
+    }
+  }
+
+
+  LIBRARY_API CrpiOnlineTrajectory::~CrpiOnlineTrajectory ()
+  {
+  }
+
+
+  LIBRARY_API bool CrpiOnlineTrajectory::SetLimits (const double *maxVel, const double *maxAcc,
+                                                    const double *maxJerk)
+  {
+    int i;
+
+    for (i = 0; i < dims_; ++i)
+    {
+      if (!(maxVel[i] > 0.0) || !(maxAcc[i] > 0.0))
+      {
+        return false;
+      }
+    }
+    for (i = 0; i < dims_; ++i)
+    {
+      givenVel_[i] = maxVel[i];
+      givenAcc_[i] = maxAcc[i];
+      givenJerk_[i] = (maxJerk != NULL && maxJerk[i] > 0.0) ? maxJerk[i] : (CRPI_OTG_JERK_RATIO * maxAcc[i]);
+    }
+    limited_ = true;
+    convertLimits();
+    return true;
+  }
+
+
+  LIBRARY_API void CrpiOnlineTrajectory::SetUnits (double length, double angle)
+  {
+    if (length > 0.0 && angle > 0.0)
+    {
+      length_ = length;
+      angle_ = angle;
+      convertLimits();
+    }
+  }
+
+
+  LIBRARY_API void CrpiOnlineTrajectory::SetPeriod (double period)
+  {
+    if (period > 0.0)
+    {
+      period_ = period;
+    }
+  }
+
+
+  LIBRARY_API void CrpiOnlineTrajectory::SetSynchronized (bool sync)
+  {
+    sync_ = sync;
+    synchronize();
+  }
+
+
+  LIBRARY_API bool CrpiOnlineTrajectory::Limited () const
+  {
+    return limited_;
+  }
+
+
+  LIBRARY_API int CrpiOnlineTrajectory::Dims () const
+  {
+    return dims_;
+  }
+
+
+  LIBRARY_API void CrpiOnlineTrajectory::Reset (const double *position, const double *velocity,
+                                                const double *acceleration)
+  {
+    for (int i = 0; i < dims_; ++i)
+    {
+      pos_[i] = target_[i] = position[i];
+      spd_[i] = (velocity != NULL) ? velocity[i] : 0.0;
+      accel_[i] = (acceleration != NULL) ? acceleration[i] : 0.0;
+    }
+    synchronize();
+  }
+
+
+  LIBRARY_API void CrpiOnlineTrajectory::Reset (const robotAxes &axes)
+  {
+    double position[CRPI_AXES_MAX];
+    for (int i = 0; i < dims_; ++i)
+    {
+      position[i] = (i < axes.axes) ? axes.axis[i] : 0.0;
+    }
+    Reset(position);
+  }
+
+
+  LIBRARY_API void CrpiOnlineTrajectory::Reset (const robotPose &pose)
+  {
+    double position[CRPI_AXES_MAX] = {pose.x, pose.y, pose.z, pose.xrot, pose.yrot, pose.zrot};
+    Reset(position);
+  }
+
+
+  LIBRARY_API void CrpiOnlineTrajectory::SetTarget (const double *target)
+  {
+    double value, turn = 360.0 * angle_;
+    bool moved = false;
+
+    for (int i = 0; i < dims_; ++i)
+    {
+      value = target[i];
+      if (wraps_[i])
+      {
+        value += turn * floor((pos_[i] - value) / turn + 0.5);
+      }
+      moved = moved || (value != target_[i]);
+      target_[i] = value;
+    }
+    if (moved)
+    {
+      synchronize();
+    }
+  }
+
+
+  LIBRARY_API void CrpiOnlineTrajectory::SetTarget (const robotAxes &axes)
+  {
+    double target[CRPI_AXES_MAX];
+    for (int i = 0; i < dims_; ++i)
+    {
+      target[i] = (i < axes.axes) ? axes.axis[i] : target_[i];
+    }
+    SetTarget(target);
+  }
+
+
+  LIBRARY_API void CrpiOnlineTrajectory::SetTarget (const robotPose &pose)
+  {
+    double target[CRPI_AXES_MAX] = {pose.x, pose.y, pose.z, pose.xrot, pose.yrot, pose.zrot};
+    SetTarget(target);
+  }
+
+
+  LIBRARY_API bool CrpiOnlineTrajectory::Step (double *position, double *velocity, double *acceleration)
+  {
+    double maxVel, maxAcc, maxJerk, jerk, err, vel, acc;
+    bool arrived = true;
+    int i;
+
+    for (i = 0; i < dims_; ++i)
+    {
+      if (!limited_)
+      {
+        pos_[i] = target_[i];
+        spd_[i] = accel_[i] = 0.0;
+      }
+      else
+      {
+        maxVel = vel_[i];
+        maxAcc = acc_[i];
+        maxJerk = jerk_[i];
+
+        //! Land on the target if one period of jerk within the limit can take out the remaining
+        //! acceleration and leave the axis within what one period of full jerk can change
+        err = pos_[i] - target_[i];
+        vel = spd_[i];
+        acc = accel_[i];
+        jerk = -acc / period_;
+        otgIntegrate(err, vel, acc, jerk, period_);
+        if (fabs(jerk) <= maxJerk && fabs(err) <= maxJerk * period_ * period_ * period_ &&
+            fabs(vel) <= maxJerk * period_ * period_)
+        {
+          pos_[i] = target_[i];
+          spd_[i] = accel_[i] = 0.0;
+        }
+        else
+        {
+          //! An axis the synchronized limits cannot keep on course (its target moved) uses its own
+          if (!otgSearch(pos_[i] - target_[i], spd_[i], accel_[i], syncVel_[i], syncAcc_[i], syncJerk_[i],
+                         period_, jerk) && syncJerk_[i] < maxJerk)
+          {
+            otgSearch(pos_[i] - target_[i], spd_[i], accel_[i], maxVel, maxAcc, maxJerk, period_, jerk);
+          }
+          otgIntegrate(pos_[i], spd_[i], accel_[i], jerk, period_);
+        }
+      }
+      arrived = arrived && pos_[i] == target_[i] && spd_[i] == 0.0 && accel_[i] == 0.0;
+
+      position[i] = pos_[i];
+      if (velocity != NULL)
+      {
+        velocity[i] = spd_[i];
+      }
+      if (acceleration != NULL)
+      {
+        acceleration[i] = accel_[i];
+      }
+    }
+    return arrived;
+  }
+
+
+  LIBRARY_API bool CrpiOnlineTrajectory::Step (robotAxes &axes)
+  {
+    double position[CRPI_AXES_MAX];
+    bool arrived = Step(position);
+    for (int i = 0; i < dims_ && i < axes.axes; ++i)
+    {
+      axes.axis[i] = position[i];
+    }
+    return arrived;
+  }
+
+
+  LIBRARY_API bool CrpiOnlineTrajectory::Step (robotPose &pose)
+  {
+    double position[CRPI_AXES_MAX];
+    bool arrived = Step(position);
+    pose.x = position[0];
+    pose.y = position[1];
+    pose.z = position[2];
+    pose.xrot = position[3];
+    pose.yrot = position[4];
+    pose.zrot = position[5];
+    return arrived;
+  }
+
+
+  LIBRARY_API double CrpiOnlineTrajectory::Remaining () const
+  {
+    double time, longest = 0.0;
+
+    if (!limited_)
+    {
+      return 0.0;
+    }
+    for (int i = 0; i < dims_; ++i)
+    {
+      time = otgRestTime(target_[i] - pos_[i], vel_[i], acc_[i], jerk_[i]);
+      longest = (time > longest) ? time : longest;
+    }
+    return longest;
+  }
+
+
+  void CrpiOnlineTrajectory::convertLimits ()
+  {
+    double factor;
+
+    for (int i = 0; i < dims_; ++i)
+    {
+      factor = angular_[i] ? angle_ : length_;
+      vel_[i] = givenVel_[i] * factor;
+      acc_[i] = givenAcc_[i] * factor;
+      jerk_[i] = givenJerk_[i] * factor;
+    }
+    synchronize();
+  }
+
+
+  void CrpiOnlineTrajectory::synchronize ()
+  {
+    double dist[CRPI_AXES_MAX], vel = 0.0, acc = 0.0, jerk = 0.0, share;
+    bool first = true;
+    int i;
+
+    for (i = 0; i < dims_; ++i)
+    {
+      syncVel_[i] = vel_[i];
+      syncAcc_[i] = acc_[i];
+      syncJerk_[i] = jerk_[i];
+    }
+    if (!sync_ || !limited_)
+    {
+      return;
+    }
+
+    //! Limits of a move of unit length that every moving axis can follow scaled by its distance
+    for (i = 0; i < dims_; ++i)
+    {
+      dist[i] = fabs(target_[i] - pos_[i]);
+      if (dist[i] > 0.0)
+      {
+        vel = (first || vel_[i] / dist[i] < vel) ? (vel_[i] / dist[i]) : vel;
+        acc = (first || acc_[i] / dist[i] < acc) ? (acc_[i] / dist[i]) : acc;
+        jerk = (first || jerk_[i] / dist[i] < jerk) ? (jerk_[i] / dist[i]) : jerk;
+        first = false;
+      }
+    }
+    if (first)
+    {
+      return;
+    }
+
+    //! ...but never below what an axis's current motion already uses, nor so low that it creeps
+    for (i = 0; i < dims_; ++i)
+    {
+      share = dist[i] * vel;
+      share = (share > fabs(spd_[i])) ? share : fabs(spd_[i]);
+      share = (share > otgScaleMin * vel_[i]) ? share : (otgScaleMin * vel_[i]);
+      syncVel_[i] = (share < vel_[i]) ? share : vel_[i];
+
+      share = dist[i] * acc;
+      share = (share > fabs(accel_[i])) ? share : fabs(accel_[i]);
+      share = (share > otgScaleMin * acc_[i]) ? share : (otgScaleMin * acc_[i]);
+      syncAcc_[i] = (share < acc_[i]) ? share : acc_[i];
+
+      share = dist[i] * jerk;
+      share = (share > otgScaleMin * jerk_[i]) ? share : (otgScaleMin * jerk_[i]);
+      syncJerk_[i] = (share < jerk_[i]) ? share : jerk_[i];
+    }
+  }
+} // crpi_robot
@@ -0,0 +1,203 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_otg.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Jerk-limited online trajectory generation for streamed setpoints.
+//
+//  Applications that stream setpoints (a teleoperation device, a visual
+//  servo, a planner running at its own rate) rarely send a sequence the
+//  robot can follow:  targets jump, and the velocity and acceleration
+//  implied by consecutive setpoints are whatever the source happened to
+//  produce.  CrpiOnlineTrajectory sits between such a source and the
+//  streaming backend.  Every control period it takes the newest target and
+//  returns the next setpoint of a motion toward it that keeps each axis
+//  within its velocity, acceleration, and jerk limits, from whatever state
+//  the previous period left it in, so the target may change at any time.
+//
+//  Each period, each axis applies the strongest constant jerk toward its
+//  target for which the axis can still stop on the target (the time-optimal
+//  jerk-limited stopping distance from the state at the end of the period
+//  does not overshoot) without passing the velocity and acceleration limits.
+//  When synchronized, every axis moves with limits in proportion to its
+//  distance from the target (the largest such that no axis exceeds its own),
+//  so from rest the axes follow one profile, arrive together, and straight
+//  moves stay straight.  CrpiRobot uses
+//  one generator for joint streams and one for Cartesian streams when the
+//  "stream_smoothing" parameter is set.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_otg_H
+#define crpi_otg_H
+
+#include "crpi.h"
+
+//! Jerk limit, as a multiple of the acceleration limit, of axes without one
+#define CRPI_OTG_JERK_RATIO 10.0
+
+//! Default control period (s)
+#define CRPI_OTG_PERIOD 0.008
+
+//! Bisection steps of the search for each period's jerk
+#define CRPI_OTG_SEARCH 40
+
+namespace crpi_robot
+{
+  //! @ingroup Robot
+  //!
+  //! @brief Jerk-limited online trajectory generator for up to CRPI_AXES_MAX axes.  Never
+  //!        allocates, so Step can run in a control loop.
+  //!
+  //! @note Targets are reached at rest.  Cartesian generators interpolate the pose's Euler
+  //!       angles, each turned the short way around, which is exact for rotations about one
+  //!       axis and close enough for the small steps between streamed setpoints.
+  //!
+  class LIBRARY_API CrpiOnlineTrajectory
+  {
+  public:
+    //! @brief Constructor
+    //!
+    //! @param dims    Number of axes (1 to CRPI_AXES_MAX)
+    //! @param period  Control period (s) of Step
+    //! @param maxVel  Velocity limit of each axis (units/s), or NULL to set them later
+    //! @param maxAcc  Acceleration limit of each axis (units/s^2), or NULL to set them later
+    //! @param maxJerk Jerk limit of each axis (units/s^3), or NULL for CRPI_OTG_JERK_RATIO times
+    //!                the acceleration limits
+    //!
+    CrpiOnlineTrajectory (int dims, double period = CRPI_OTG_PERIOD, const double *maxVel = NULL,
+                          const double *maxAcc = NULL, const double *maxJerk = NULL);
+
+    //! @brief Constructor with the limits of a robot's configuration
+    //!
+    //! @param params    The robot's configuration
+    //! @param period    Control period (s) of Step
+    //! @param cartesian True for the TCP pose (x, y, z, xrot, yrot, zrot, limited by the
+    //!                  <CartesianLimit> tag, and synchronized), false for the joints (limited by
+    //!                  the <JointLimit> tags)
+    //!
+    CrpiOnlineTrajectory (const CrpiRobotParams &params, double period, bool cartesian);
+
+    //! @brief Default destructor
+    //!
+    ~CrpiOnlineTrajectory ();
+
+    //! @brief Set the limits of every axis
+    //!
+    //! @param maxJerk Jerk limits, or NULL (or 0 for an axis) for CRPI_OTG_JERK_RATIO times the
+    //!                acceleration limits
+    //!
+    //! @return True if the limits were set, false if a velocity or acceleration limit is not
+    //!         positive
+    //!
+    bool SetLimits (const double *maxVel, const double *maxAcc, const double *maxJerk = NULL);
+
+    //! @brief Convert the limits from the units they were given in (mm and degrees for a
+    //!        robot's configuration) to the units of the setpoints
+    //!
+    //! @param length Factor for linear axes (e.g., crpi_length_scale(MM, METER))
+    //! @param angle  Factor for angular axes (every axis of a joint generator)
+    //!
+    void SetUnits (double length, double angle);
+
+    //! @brief Set the control period (s) of Step
+    //!
+    void SetPeriod (double period);
+
+    //! @brief Whether the axes are slowed down to arrive together
+    //!
+    void SetSynchronized (bool sync);
+
+    //! @brief Whether every axis has limits (without, Step goes straight to the target)
+    //!
+    bool Limited () const;
+
+    //! @brief Number of axes
+    //!
+    int Dims () const;
+
+    //! @brief Start from a known state, with the target at the start
+    //!
+    //! @param position     Position of each axis
+    //! @param velocity     Velocity of each axis, or NULL for rest
+    //! @param acceleration Acceleration of each axis, or NULL for none
+    //!
+    void Reset (const double *position, const double *velocity = NULL, const double *acceleration = NULL);
+    void Reset (const robotAxes &axes);
+    void Reset (const robotPose &pose);
+
+    //! @brief Set the target the next steps move toward
+    //!
+    void SetTarget (const double *target);
+    void SetTarget (const robotAxes &axes);
+    void SetTarget (const robotPose &pose);
+
+    //! @brief Advance one control period
+    //!
+    //! @param position     Setpoint of each axis to be populated by the method
+    //! @param velocity     Velocity of each axis to be populated by the method (may be NULL)
+    //! @param acceleration Acceleration of each axis to be populated by the method (may be NULL)
+    //!
+    //! @return True if every axis is at rest on its target
+    //!
+    bool Step (double *position, double *velocity = NULL, double *acceleration = NULL);
+    bool Step (robotAxes &axes);
+    bool Step (robotPose &pose);
+
+    //! @brief Time (s) the slowest axis would take to reach its target from rest at its full
+    //!        limits (an estimate of the time left, exact for moves that start at rest)
+    //!
+    double Remaining () const;
+
+  private:
+    int dims_;
+    double period_;
+    bool sync_;
+    bool limited_;
+
+    //! @brief Whether each axis is angular (converted with the angle factor), and whether it is
+    //!        a Cartesian rotation that turns the short way around
+    //!
+    bool angular_[CRPI_AXES_MAX];
+    bool wraps_[CRPI_AXES_MAX];
+
+    //! @brief Limits as given, and converted to the setpoints' units
+    //!
+    double givenVel_[CRPI_AXES_MAX];
+    double givenAcc_[CRPI_AXES_MAX];
+    double givenJerk_[CRPI_AXES_MAX];
+    double vel_[CRPI_AXES_MAX];
+    double acc_[CRPI_AXES_MAX];
+    double jerk_[CRPI_AXES_MAX];
+    double length_;
+    double angle_;
+
+    //! @brief State and target of each axis
+    //!
+    double pos_[CRPI_AXES_MAX];
+    double spd_[CRPI_AXES_MAX];
+    double accel_[CRPI_AXES_MAX];
+    double target_[CRPI_AXES_MAX];
+
+    //! @brief Limits each axis moves toward its target with (its own, or less when synchronized)
+    //!
+    double syncVel_[CRPI_AXES_MAX];
+    double syncAcc_[CRPI_AXES_MAX];
+    double syncJerk_[CRPI_AXES_MAX];
+
+    //! @brief Convert the given limits to the setpoints' units
+    //!
+    void convertLimits ();
+
+    //! @brief Compute the synchronized limits for the current state and target
+    //!
+    void synchronize ();
+  }; // CrpiOnlineTrajectory
+} // crpi_robot
+
+#endif
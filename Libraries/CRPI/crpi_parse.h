@@ -0,0 +1,335 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_parse.h
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Allocation-free parsing of the delimited numeric replies and binary frames
+//  sent by robot controllers.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef CRPI_PARSE_H
+#define CRPI_PARSE_H
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+//! @brief Longest numeric token accepted by crpi_parse_values
+//!
+#define CRPI_PARSE_TOKEN_MAX 31
+
+//! @brief Whether a character is one of a short set of delimiters
+//!
+//! @param c      The character to test
+//! @param delims NUL-terminated delimiter set
+//!
+inline bool crpi_parse_delim (char c, const char *delims)
+{
+  for (; *delims != '\0'; ++delims)
+  {
+    if (c == *delims)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+//! @brief Convert a decimal token to a double.  Tokens with at most 15 significant digits and a
+//!        small decimal exponent (all controller replies seen in practice) are converted exactly
+//!        with one multiplication or division; anything else falls back to strtod.  Both paths
+//!        give the correctly rounded result, so values match strtod bit for bit.
+//!
+//! @param token NUL-terminated token
+//!
+//! @return The parsed value, or 0 if the token does not start with a number
+//!
+inline double crpi_parse_number (const char *token)
+{
+  static const double pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+                                 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19,
+                                 1e20, 1e21, 1e22};
+  const char *c = token;
+  unsigned long long mantissa = 0;
+  int digits = 0, scale = 0;
+  bool negative = false, any = false;
+
+  if (*c == '-' || *c == '+')
+  {
+    negative = (*c == '-');
+    ++c;
+  }
+  for (; *c >= '0' && *c <= '9'; ++c, any = true)
+  {
+    if (mantissa != 0 || *c != '0')
+    {
+      ++digits;
+    }
+    mantissa = mantissa * 10 + (*c - '0');
+    if (digits > 15)
+    {
+      return strtod(token, NULL);
+    }
+  }
+  if (*c == '.')
+  {
+    for (++c; *c >= '0' && *c <= '9'; ++c, any = true)
+    {
+      if (mantissa != 0 || *c != '0')
+      {
+        ++digits;
+      }
+      mantissa = mantissa * 10 + (*c - '0');
+      --scale;
+      if (digits > 15)
+      {
+        return strtod(token, NULL);
+      }
+    }
+  }
+  if (!any || *c == 'e' || *c == 'E' || *c == 'x' || *c == 'X' || scale < -22)
+  {
+    //! Exponents, hexadecimal, inf/nan, and long fractions are left to strtod
+    return strtod(token, NULL);
+  }
+
+  double value = (double)mantissa;
+  value = ((scale < 0) ? (value / pow10[-scale]) : value);
+  return (negative ? -value : value);
+}
+
+
+//! @brief Parse delimited decimal values directly out of a reply buffer
+//!
+//! @param buf    The reply characters.  Parsing stops at the first NUL or after len characters.
+//! @param len    Maximum number of characters of buf to examine
+//! @param delims The characters that separate values (e.g., " " or ",[]")
+//! @param out    Array populated with the parsed values
+//! @param num    Number of values wanted
+//!
+//! @return The number of values parsed (at most num).  Tokens that do not start with a number,
+//!         or that are longer than CRPI_PARSE_TOKEN_MAX characters, are parsed as 0.
+//!
+//! @note Each token is copied to the stack so that conversion cannot read past len.  Nothing is
+//!       allocated and buf is not modified.
+//!
+inline int crpi_parse_values (const char *buf, size_t len, const char *delims, double *out, int num)
+{
+  char token[CRPI_PARSE_TOKEN_MAX + 1];
+  size_t i = 0, start;
+  int count = 0;
+
+  while (count < num)
+  {
+    //! Skip delimiters
+    while (i < len && buf[i] != '\0' && crpi_parse_delim(buf[i], delims))
+    {
+      ++i;
+    }
+    if (i >= len || buf[i] == '\0')
+    {
+      break;
+    }
+
+    start = i;
+    while (i < len && buf[i] != '\0' && !crpi_parse_delim(buf[i], delims))
+    {
+      ++i;
+    }
+
+    if (i - start > CRPI_PARSE_TOKEN_MAX)
+    {
+      out[count++] = 0.0;
+      continue;
+    }
+    memcpy(token, buf + start, i - start);
+    token[i - start] = '\0';
+    out[count++] = crpi_parse_number(token);
+  }
+
+  return count;
+}
+
+//! @brief Robot state decoded from a feedback frame, ready to be stored in the universalHandler
+//!
+struct urFeedback
+{
+  double pose[6];
+  double axes[6];
+  double forces[6];
+  double speeds[6];
+  double axisSpeeds[6];
+  unsigned int dio;
+
+  //! @brief Controller time (s since the controller started) at which the state was sampled
+  //!
+  double time;
+};
+
+//! @brief Byte offsets of the fields CRPI uses within a real-time interface frame
+//!
+struct urFrameLayout
+{
+  int length;
+  int time;
+  int axes;
+  int axisSpeeds;
+  int pose;
+  int speeds;
+  int forces;
+  int dio;
+};
+
+//! @brief Known real-time interface frame layouts.  Controller versions append fields to the
+//!        end of the frame, so the offsets CRPI needs are shared by both.
+//!
+static const urFrameLayout urLayouts[] =
+{
+  //! length, time, actual q, actual qd, actual TCP pose, actual TCP speed, TCP force, digital inputs
+  {  812, 4, 252, 300, 444, 492, 540, 684 }, //! CB2 (v1.8)
+  { 1044, 4, 252, 300, 444, 492, 540, 684 }  //! CB3 (v3.0 - v3.1)
+};
+
+static const int crpiEndianTest = 0x01234567;
+
+//! @brief Whether the host is little endian (the UR sends big endian).  Evaluated once.
+//!
+static const bool crpi_little_endian = (((const char*)&crpiEndianTest)[0] == 0x67);
+
+//! @brief Read a big-endian 64-bit value without going through intermediate buffers
+//!
+inline unsigned long long crpi_load_be64 (const char *src)
+{
+  unsigned long long v;
+  memcpy(&v, src, sizeof(v));
+  if (crpi_little_endian)
+  {
+#ifdef WIN32
+    v = _byteswap_uint64(v);
+#else
+    v = __builtin_bswap64(v);
+#endif
+  }
+  return v;
+}
+
+//! @brief Read a big-endian double
+//!
+inline double crpi_load_be_double (const char *src)
+{
+  unsigned long long v = crpi_load_be64(src);
+  double d;
+  memcpy(&d, &v, sizeof(d));
+  return d;
+}
+
+//! @brief Swap six consecutive big-endian doubles into dst
+//!
+inline void crpi_load_be_vector6 (const char *src, double *dst)
+{
+  for (int j = 0; j < 6; ++j)
+  {
+    dst[j] = crpi_load_be_double(src + (j * sizeof(double)));
+  }
+}
+
+//! @brief Read a big-endian 32-bit signed value
+//!
+inline int crpi_load_be32 (const char *src)
+{
+  const unsigned char *b = (const unsigned char *)src;
+  return (int)(((unsigned int)b[0] << 24) | ((unsigned int)b[1] << 16) |
+               ((unsigned int)b[2] << 8) | (unsigned int)b[3]);
+}
+
+//! @brief Read a little-endian 32-bit value (KRL INT, RAPID UDINT)
+//!
+inline unsigned int crpi_load_le32 (const char *src)
+{
+  const unsigned char *b = (const unsigned char *)src;
+  return ((unsigned int)b[0]) | ((unsigned int)b[1] << 8) |
+         ((unsigned int)b[2] << 16) | ((unsigned int)b[3] << 24);
+}
+
+//! @brief Read a little-endian IEEE single-precision value (KRL REAL, RAPID Float4)
+//!
+inline double crpi_load_le_float (const char *src)
+{
+  unsigned int u = crpi_load_le32(src);
+  float f;
+  memcpy(&f, &u, sizeof(f));
+  return (double)f;
+}
+
+//! @brief Write a little-endian 32-bit value
+//!
+inline void crpi_store_le32 (char *dst, unsigned int val)
+{
+  unsigned char *b = (unsigned char *)dst;
+  b[0] = (unsigned char)(val & 0xFF);
+  b[1] = (unsigned char)((val >> 8) & 0xFF);
+  b[2] = (unsigned char)((val >> 16) & 0xFF);
+  b[3] = (unsigned char)((val >> 24) & 0xFF);
+}
+
+//! @brief Write a little-endian IEEE single-precision value
+//!
+inline void crpi_store_le_float (char *dst, double val)
+{
+  float f = (float)val;
+  unsigned int u;
+  memcpy(&u, &f, sizeof(u));
+  crpi_store_le32(dst, u);
+}
+
+//! @brief Decode the fields used by CRPI from a real-time interface frame
+//!
+//! @param bytes  Length of the frame (from its header)
+//! @param buffer Frame contents
+//! @param layout Layout of the previous frame (NULL initially).  Frames from one controller
+//!               always share a layout, so the table is only searched when the length changes.
+//! @param fb     Decoded state
+//!
+//! @return True if the frame length matches a known layout, false otherwise
+//!
+inline bool crpi_parse_ur_frame (int bytes, const char *buffer, const urFrameLayout *&layout, urFeedback &fb)
+{
+  if (layout == NULL || bytes != layout->length)
+  {
+    layout = NULL;
+    for (int i = (int)(sizeof(urLayouts) / sizeof(urFrameLayout)) - 1; i >= 0; --i)
+    {
+      if (bytes >= urLayouts[i].length)
+      {
+        layout = &urLayouts[i];
+        break;
+      }
+    }
+    if (layout == NULL)
+    {
+      //! Frame too short to contain the fields used by CRPI
+      return false;
+    }
+  }
+
+  fb.time = crpi_load_be_double(buffer + layout->time);
+  crpi_load_be_vector6(buffer + layout->axes, fb.axes);
+  crpi_load_be_vector6(buffer + layout->axisSpeeds, fb.axisSpeeds);
+  crpi_load_be_vector6(buffer + layout->pose, fb.pose);
+  crpi_load_be_vector6(buffer + layout->speeds, fb.speeds);
+  crpi_load_be_vector6(buffer + layout->forces, fb.forces);
+
+  //! Digital input states are sent as a double holding the bit mask
+  fb.dio = (unsigned int)crpi_load_be_double(buffer + layout->dio);
+
+  return true;
+}
+
+#endif
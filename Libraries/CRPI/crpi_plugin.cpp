@@ -0,0 +1,165 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_plugin.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Run-time robot driver definitions.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_plugin.h"
+#include "crpi_robot_xml.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdlib.h>
+
+using namespace std;
+
+namespace crpi_robot
+{
+  LIBRARY_API CrpiPluginRobot::CrpiPluginRobot (const char *initPath, bool bypass, const char *driver) :
+    module_(NULL),
+    entry_(NULL),
+    robot_(NULL)
+  {
+    char err[256];
+    CrpiDriverEntry entry;
+
+    if (driver != NULL)
+    {
+      driver_ = driver;
+    }
+    else if (!ReadDriver(initPath, driver_))
+    {
+      error_ = string("no <Driver> in ") + ((initPath == NULL) ? "(null)" : initPath);
+      return;
+    }
+
+    //! Driver names become file names; keep them to one path component
+    if (driver_.empty() || driver_.find_first_of("/\\.") != string::npos)
+    {
+      error_ = "invalid driver name \"" + driver_ + "\"";
+      return;
+    }
+
+#ifdef WIN32
+    string file = "crpi_plugin_" + driver_ + ".dll";
+#else
+    string file = "libcrpi_plugin_" + driver_ + ".so";
+#endif
+    const char *dir = getenv("CRPI_PLUGIN_PATH");
+    if (dir != NULL && *dir != '\0')
+    {
+      file = string(dir) + "/" + file;
+    }
+
+    err[0] = '\0';
+    if ((module_ = ulapi_dl_open(file.c_str(), err, sizeof(err))) == NULL)
+    {
+      error_ = "could not load " + file + ": " + err;
+      return;
+    }
+    entry = (CrpiDriverEntry)ulapi_dl_sym(module_, CRPI_PLUGIN_ENTRY, err, sizeof(err));
+    entry_ = (entry == NULL) ? NULL : entry();
+    if (entry_ == NULL || entry_->abi != CRPI_PLUGIN_ABI || entry_->create == NULL ||
+        entry_->destroy == NULL || entry_->ops == NULL)
+    {
+      error_ = file + " is not a CRPI driver module of this version";
+      entry_ = NULL;
+      ulapi_dl_close(module_);
+      module_ = NULL;
+      return;
+    }
+
+    if ((robot_ = entry_->create(initPath, bypass)) == NULL)
+    {
+      error_ = "driver " + driver_ + " could not make the robot";
+    }
+  }
+
+
+  LIBRARY_API CrpiPluginRobot::~CrpiPluginRobot ()
+  {
+    //! The robot's code is in the module, so it goes first
+    if (robot_ != NULL)
+    {
+      entry_->destroy(robot_);
+      robot_ = NULL;
+    }
+    if (module_ != NULL)
+    {
+      ulapi_dl_close(module_);
+      module_ = NULL;
+    }
+  }
+
+
+  LIBRARY_API bool CrpiPluginRobot::valid () const
+  {
+    return robot_ != NULL;
+  }
+
+
+  LIBRARY_API AnyCrpiRobot CrpiPluginRobot::robot () const
+  {
+    return (robot_ == NULL) ? AnyCrpiRobot() : AnyCrpiRobot(robot_, entry_->ops);
+  }
+
+
+  LIBRARY_API const string &CrpiPluginRobot::driver () const
+  {
+    return driver_;
+  }
+
+
+  LIBRARY_API const string &CrpiPluginRobot::error () const
+  {
+    return error_;
+  }
+
+
+  LIBRARY_API bool CrpiPluginRobot::ReadDriver (const char *initPath, string &driver)
+  {
+    if (initPath == NULL)
+    {
+      return false;
+    }
+    ifstream inputs(initPath, ios::in | ios::binary);
+    if (!inputs)
+    {
+      return false;
+    }
+    stringstream contents;
+    contents << inputs.rdbuf();
+    inputs.close();
+
+    //! Lines are joined as CrpiRobot<T> joins them
+    string config = contents.str();
+    config.erase(remove(config.begin(), config.end(), '\n'), config.end());
+    config.erase(remove(config.begin(), config.end(), '\r'), config.end());
+
+    CrpiRobotParams params;
+    {
+      CrpiRobotXml robXML(&params);
+      robXML.parse(config);
+    }
+    driver = params.driver;
+
+    //! CrpiRobotParams has no destructor
+    for (size_t i = 0; i < params.toCoordSystMatrices.size(); ++i)
+    {
+      delete params.toCoordSystMatrices[i];
+    }
+    delete params.mounting;
+    delete params.toWorld;
+    delete params.toWorldMatrix;
+
+    return !driver.empty();
+  }
+} // crpi_robot
@@ -0,0 +1,150 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_plugin.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Robot drivers loaded at run time.
+//
+//  An application that names its robot type at compile time (CrpiRobot<T>)
+//  links that driver and, through the one CRPI library, every other driver
+//  and the SDKs they pull in.  With driver modules, the application links
+//  only the core library and loads the driver named by the robot's
+//  configuration file (<Driver Name="universal"/>) when it opens the robot,
+//  so a process that drives one UR maps, initializes, and keeps in memory
+//  only the UR driver.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_plugin_H
+#define crpi_plugin_H
+
+#include "crpi_any_robot.h"
+#include <string>
+
+//! @brief Version of CrpiDriverModule; a module built for another version is not loaded
+//!
+#define CRPI_PLUGIN_ABI 2
+
+//! @brief Name of the function every driver module exports
+//!
+#define CRPI_PLUGIN_ENTRY "crpi_driver_module"
+
+namespace crpi_robot
+{
+  //! @brief What a driver module provides:  its driver's name and how to make and destroy a
+  //!        CrpiRobot of it
+  //!
+  struct CrpiDriverModule
+  {
+    //! @brief CRPI_PLUGIN_ABI of the module
+    //!
+    int abi;
+
+    //! @brief Driver name, as in <Driver Name="..."/>
+    //!
+    const char *name;
+
+    //! @brief Make a robot (CrpiRobot<T>(initPath, bypass)) and destroy one
+    //!
+    void *(*create) (const char *initPath, bool bypass);
+    void (*destroy) (void *robot);
+
+    //! @brief Method table of the module's CrpiRobot<T>
+    //!
+    const AnyCrpiRobotOps *ops;
+  };
+
+  typedef const CrpiDriverModule *(*CrpiDriverEntry) ();
+
+  //! @ingroup Robot
+  //!
+  //! @brief A robot whose driver is loaded from a module at run time.  The driver is named by
+  //!        the <Driver> tag of the configuration file (or by the caller), and loaded from
+  //!        crpi_plugin_<driver> (libcrpi_plugin_<driver>.so, crpi_plugin_<driver>.dll) in the
+  //!        directory named by the CRPI_PLUGIN_PATH environment variable or, if that is not
+  //!        set, on the system's library search path.  The robot is used through an
+  //!        AnyCrpiRobot handle.
+  //!
+  //! @note Modules stay loaded while any robot made from them exists; each is loaded once
+  //!       however many robots use it.  AnyCrpiRobot::get<T>() cannot be used on the handle,
+  //!       since the module's CrpiRobot<T> is not the application's.
+  //!
+  class LIBRARY_API CrpiPluginRobot
+  {
+  public:
+    //! @brief Constructor.  Loads the driver and makes the robot.
+    //!
+    //! @param initPath Robot configuration file, as for CrpiRobot<T>
+    //! @param bypass   As for CrpiRobot<T>
+    //! @param driver   Driver to load, or NULL for the one named in the configuration file
+    //!
+    CrpiPluginRobot (const char *initPath, bool bypass = false, const char *driver = NULL);
+
+    //! @brief Destructor.  Destroys the robot, then releases the module.
+    //!
+    ~CrpiPluginRobot ();
+
+    //! @brief Whether the robot was made
+    //!
+    bool valid () const;
+
+    //! @brief Handle to the robot (invalid if it was not made)
+    //!
+    AnyCrpiRobot robot () const;
+
+    //! @brief Name of the driver, and why it could not be loaded (empty if it was)
+    //!
+    const std::string &driver () const;
+    const std::string &error () const;
+
+    //! @brief Driver named by a configuration file's <Driver> tag
+    //!
+    //! @param initPath Robot configuration file
+    //! @param driver   Set to the driver's name
+    //!
+    //! @return False if the file could not be read or names no driver
+    //!
+    static bool ReadDriver (const char *initPath, std::string &driver);
+
+  private:
+
+    void *module_;
+    const CrpiDriverModule *entry_;
+    void *robot_;
+    std::string driver_;
+    std::string error_;
+
+    CrpiPluginRobot (const CrpiPluginRobot &) = delete;
+    CrpiPluginRobot &operator= (const CrpiPluginRobot &) = delete;
+  }; // CrpiPluginRobot
+} // crpi_robot
+
+//! @brief Define a driver module's entry point.  Used once, in the module, for the driver it
+//!        holds (crpi_robot.cpp does this for the built-in drivers when CRPI_PLUGIN is
+//!        defined).
+//!
+//! @param T    The driver class
+//! @param name The driver's name
+//!
+#define CRPI_DRIVER_MODULE(T, name) \
+  static void *crpiPluginCreate (const char *initPath, bool bypass) \
+  { \
+    return new crpi_robot::CrpiRobot<T>(initPath, bypass); \
+  } \
+  static void crpiPluginDestroy (void *robot) \
+  { \
+    delete (crpi_robot::CrpiRobot<T>*)robot; \
+  } \
+  extern "C" LIBRARY_API const crpi_robot::CrpiDriverModule *crpi_driver_module () \
+  { \
+    static const crpi_robot::CrpiDriverModule module = \
+      {CRPI_PLUGIN_ABI, name, crpiPluginCreate, crpiPluginDestroy, &crpi_robot::AnyCrpiRobotTable<T>::ops}; \
+    return &module; \
+  }
+
+#endif
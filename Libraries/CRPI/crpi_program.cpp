@@ -0,0 +1,376 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_program.cpp
+//  Revision:        1.0 - 14 October, 2026
+//
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  CRCL and CRPI program compiler class definition file.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_xml.h"
+
+using namespace std;
+
+namespace Xml
+{
+  //! @brief Placeholder command meaning "no CRPI equivalent found yet"
+  //!
+  static const CanonCommand noCommand = (CanonCommand)-1;
+
+
+  LIBRARY_API CrpiProgramCompiler::CrpiProgramCompiler () :
+    crcl_(&params_),
+    crpi_(&params_)
+  {
+    active_ = NULL;
+    program_ = NULL;
+    joint_ = 0;
+    degrees_ = true;
+  }
+
+
+  LIBRARY_API CrpiProgramCompiler::~CrpiProgramCompiler ()
+  {
+    active_ = NULL;
+    program_ = NULL;
+  }
+
+
+  LIBRARY_API bool CrpiProgramCompiler::compile (const string &xml,
+                                                 CrpiCompiledProgram &program,
+                                                 bool degrees)
+  {
+    bool flag;
+
+    program.steps.clear();
+    program.axes.clear();
+    program.strings.clear();
+    program.next = 0;
+
+    program_ = &program;
+    degrees_ = degrees;
+    active_ = NULL;
+    joint_ = 0;
+
+    try
+    {
+      flag = sax_.parse (xml.c_str(), xml.length(), *this);
+    }
+    catch (...)
+    {
+      flag = false;
+    }
+
+    //! A command left open by truncated input is dropped
+    active_ = NULL;
+    program_ = NULL;
+    return flag;
+  }
+
+
+  LIBRARY_API void CrpiProgramCompiler::beginCommand ()
+  {
+    params_.cmd = noCommand;
+    params_.commandID = 0;
+    params_.moveStraight = false;
+    params_.numPositions = params_.setting = 0.0f;
+    params_.real = 0.0f;
+    params_.integer = 0;
+    params_.boolean = false;
+    params_.str.clear();
+    *params_.pose = robotPose();
+    *params_.axes = robotAxes();
+    params_.xaxis.i = 1.0f;
+    params_.xaxis.j = params_.xaxis.k = 0.0f;
+    params_.zaxis.i = params_.zaxis.j = 0.0f;
+    params_.zaxis.k = 1.0f;
+    joint_ = 0;
+  }
+
+
+  LIBRARY_API void CrpiProgramCompiler::finishCommand ()
+  {
+    CrpiProgramStep step;
+    bool crcl = (active_ == &crcl_);
+
+    if (params_.cmd == noCommand)
+    {
+      //! No CRPI equivalent
+      return;
+    }
+
+    step.cmd = params_.cmd;
+    step.commandID = params_.commandID;
+    step.pose = *params_.pose;
+    step.real = params_.real;
+    step.integer = params_.integer;
+    step.boolean = params_.boolean;
+
+    if (crcl)
+    {
+      if (step.cmd == CmdMoveTo || step.cmd == CmdMoveThroughTo)
+      {
+        //! Get the CRPI 6DOF pose from the 2-vector representation CRCL uses
+        //! (matrixRPYConvert only accepts homogeneous matrices)
+        Math::matrix rot(4, 4);
+        Math::pose ptemp;
+        orientVect &v1 = params_.xaxis, &v2 = params_.zaxis;
+
+        rot.at(0, 0) = v1.i;
+        rot.at(1, 0) = v1.j;
+        rot.at(2, 0) = v1.k;
+        rot.at(0, 1) = -((v1.j * v2.k) - (v1.k * v2.j));
+        rot.at(1, 1) = -((v1.k * v2.i) - (v1.i * v2.k));
+        rot.at(2, 1) = -((v1.i * v2.j) - (v1.j * v2.i));
+        rot.at(0, 2) = v2.i;
+        rot.at(1, 2) = v2.j;
+        rot.at(2, 2) = v2.k;
+        rot.at(3, 3) = 1.0f;
+        rot.matrixRPYConvert (ptemp, degrees_);
+
+        step.pose.xrot = ptemp.xr;
+        step.pose.yrot = ptemp.yr;
+        step.pose.zrot = ptemp.zr;
+      }
+
+      switch (step.cmd)
+      {
+      case CmdMoveTo:
+      case CmdMoveThroughTo:
+        step.cmd = params_.moveStraight ? CmdMoveStraightTo : CmdMoveTo;
+        break;
+      case CmdSetTool:
+        step.real = params_.setting;
+        break;
+      case CmdSetAbsoluteAcceleration:
+      case CmdSetAbsoluteSpeed:
+      case CmdSetRelativeAcceleration:
+      case CmdSetRelativeSpeed:
+        step.real = params_.numPositions;
+        break;
+      default:
+        break;
+      }
+    } // if (crcl)
+    else
+    {
+      switch (step.cmd)
+      {
+      case CmdSetAbsoluteAcceleration:
+      case CmdSetAbsoluteSpeed:
+        step.real = params_.numPositions;
+        break;
+      default:
+        break;
+      }
+    } // if (crcl) ... else
+
+    switch (step.cmd)
+    {
+    case CmdSetAngleUnits:
+      //! Later CRCL orientations are converted in the new units
+      if (strcmp (params_.str.c_str(), "degree") == 0)
+      {
+        degrees_ = true;
+      }
+      else if (strcmp (params_.str.c_str(), "radian") == 0)
+      {
+        degrees_ = false;
+      }
+      //! Fall through
+    case CmdCouple:
+    case CmdMessage:
+    case CmdSaveConfig:
+    case CmdSetLengthUnits:
+      step.integer = (int)program_->strings.size();
+      program_->strings.push_back (params_.str);
+      break;
+    case CmdMoveToAxisTarget:
+      step.integer = (int)program_->axes.size();
+      program_->axes.push_back (*params_.axes);
+      break;
+    default:
+      break;
+    }
+
+    program_->steps.push_back (step);
+  }
+
+
+  /*
+    Example CRCL program:
+
+    <CRCLProgram>
+      <InitCanon>
+        <CommandID>1</CommandID>
+      </InitCanon>
+      <MiddleCommand xsi:type="MoveToType">
+        <CommandID>2</CommandID>
+        <MoveStraight>false</MoveStraight>
+        <EndPosition>
+          <Point>
+            <X>2.5</X> <Y>1</Y> <Z>1</Z>
+          </Point>
+          <XAxis>
+            <I>1</I> <J>0</J> <K>0</K>
+          </XAxis>
+          <ZAxis>
+            <I>0</I> <J>0</J> <K>-1</K>
+          </ZAxis>
+        </EndPosition>
+      </MiddleCommand>
+      <MiddleCommand xsi:type="DwellType">
+        <CommandID>3</CommandID>
+        <DwellTime>0.5</DwellTime>
+      </MiddleCommand>
+      <EndCanon>
+        <CommandID>4</CommandID>
+      </EndCanon>
+    </CRCLProgram>
+
+    Example CRPI program:
+
+    <CRPIProgram>
+      <CRPICommand type="MoveTo">
+        <Pose X="2.5" Y="1.0" Z="1.0" XRot="180.0" YRot="0.0" ZRot="0.0" />
+      </CRPICommand>
+      <CRPICommand type="SetTool">
+        <Real Value="1.0" />
+      </CRPICommand>
+    </CRPIProgram>
+  */
+
+  LIBRARY_API bool CrpiProgramCompiler::startElement (const string& tagName,
+                                                      const xmlAttributes& attr)
+  {
+    static const string crclCommand = "CRCLCommand";
+
+    if (active_ != NULL)
+    {
+      if (active_ == &crcl_ && strcmp (tagName.c_str(), "ActuateJoint") == 0)
+      {
+        joint_ = 0;
+      }
+      return active_->startElement (tagName, attr);
+    }
+
+    if (strcmp (tagName.c_str(), "CRPICommand") == 0)
+    {
+      beginCommand();
+      active_ = &crpi_;
+      activeTag_ = tagName;
+      return static_cast<CrpiSaxHandler&>(crpi_).startElement (tagName, attr);
+    }
+    else if (strcmp (tagName.c_str(), "MiddleCommand") == 0 ||
+             strcmp (tagName.c_str(), "CRCLCommand") == 0)
+    {
+      beginCommand();
+      active_ = &crcl_;
+      activeTag_ = tagName;
+      //! Program commands carry the same xsi:type as stand-alone CRCL commands
+      return static_cast<CrpiSaxHandler&>(crcl_).startElement (crclCommand, attr);
+    }
+    else if (strcmp (tagName.c_str(), "InitCanon") == 0 ||
+             strcmp (tagName.c_str(), "EndCanon") == 0)
+    {
+      beginCommand();
+      params_.cmd = (tagName[0] == 'I') ? CmdInitCanon : CmdEndCanon;
+      active_ = &crcl_;
+      activeTag_ = tagName;
+    }
+
+    //! Program wrapper elements are skipped
+    return true;
+  }
+
+
+  LIBRARY_API bool CrpiProgramCompiler::interTagElement (const string& tagName,
+                                                         const vector<string>& vals)
+  {
+    vector<string>::const_iterator valiter = vals.begin();
+
+    if (active_ == NULL)
+    {
+      return true;
+    }
+
+    if (active_ == &crcl_)
+    {
+      //! CRCL program elements the stand-alone command parser does not read
+      if (strcmp (tagName.c_str(), "DwellTime") == 0)
+      {
+        for (; valiter != vals.end(); ++valiter)
+        {
+          params_.real = atof (valiter->c_str ());
+        }
+        return true;
+      }
+      else if (strcmp (tagName.c_str(), "UnitName") == 0 ||
+               strcmp (tagName.c_str(), "Message") == 0)
+      {
+        for (; valiter != vals.end(); ++valiter)
+        {
+          params_.str = valiter->c_str();
+        }
+        return true;
+      }
+      else if (strcmp (tagName.c_str(), "JointNumber") == 0)
+      {
+        for (; valiter != vals.end(); ++valiter)
+        {
+          joint_ = atoi (valiter->c_str ());
+        }
+        return true;
+      }
+      else if (strcmp (tagName.c_str(), "JointPosition") == 0)
+      {
+        for (; valiter != vals.end(); ++valiter)
+        {
+          if (joint_ > 0 && joint_ <= CRPI_AXES_MAX)
+          {
+            params_.axes->axis[joint_ - 1] = atof (valiter->c_str ());
+          }
+        }
+        return true;
+      }
+    } // if (active_ == &crcl_)
+
+    return active_->interTagElement (tagName, vals);
+  }
+
+
+  LIBRARY_API bool CrpiProgramCompiler::endElement (const string& tagName)
+  {
+    static const string crclCommand = "CRCLCommand";
+    bool flag = true;
+
+    if (active_ == NULL)
+    {
+      return true;
+    }
+
+    if (tagName == activeTag_)
+    {
+      if (active_ == &crpi_)
+      {
+        flag = static_cast<CrpiSaxHandler&>(crpi_).endElement (tagName);
+      }
+      else if (activeTag_[0] == 'M' || activeTag_[0] == 'C')
+      {
+        flag = static_cast<CrpiSaxHandler&>(crcl_).endElement (crclCommand);
+      }
+      finishCommand();
+      active_ = NULL;
+      return flag;
+    }
+
+    return active_->endElement (tagName);
+  }
+
+} // Xml
@@ -0,0 +1,1195 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_recorder.cpp
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Binary state recorder for robots and sensors.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_recorder.h"
+#include "crpi_hub.h"
+#include "crpi_log.h"
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+//! @brief LZ4 block format limits:  shortest match, literals that must end a block, and the
+//!        distance back a match may reach
+//!
+#define LZ_MIN_MATCH 4
+#define LZ_LAST_LITERALS 5
+#define LZ_MATCH_LIMIT 12
+#define LZ_WINDOW 65535
+#define LZ_HASH_BITS 12
+
+//! @brief Chunk payload encodings
+//!
+#define RECORD_STORED 0
+#define RECORD_LZ4 1
+
+namespace crpi_robot
+{
+  //! @brief On-disk layouts.  Every field is naturally aligned, so the structures have no
+  //!        padding on the compilers CRPI supports.
+  //!
+  struct recordFileHeader
+  {
+    unsigned int magic;
+    unsigned int version;
+    unsigned int chunkBytes;
+    unsigned int reserved;
+    double start;
+  };
+
+  struct recordChunkHeader
+  {
+    unsigned int magic;
+    unsigned int codec;
+    unsigned int packed;
+    unsigned int raw;
+    unsigned int records;
+    unsigned int checksum;
+    double first;
+    double last;
+  };
+
+  struct recordEntry
+  {
+    double timestamp;
+    unsigned int size;
+    unsigned short channel;
+    unsigned char kind;
+    unsigned char reserved;
+  };
+
+  struct recordTrailer
+  {
+    unsigned long long index;
+    unsigned int chunks;
+    unsigned int channels;
+    unsigned int magic;
+    unsigned int reserved;
+  };
+
+
+  //! @brief FNV-1a checksum of a chunk's payload, so that a chunk torn by a crash is found
+  //!
+  static unsigned int recordChecksum (const unsigned char *data, size_t size)
+  {
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i)
+    {
+      hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+  }
+
+
+  static unsigned int lzRead32 (const unsigned char *p)
+  {
+    unsigned int v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+
+  //! @brief Write a literal or match length beyond the 4 bits held in the token
+  //!
+  static unsigned char *lzLength (unsigned char *op, int length)
+  {
+    while (length >= 255)
+    {
+      *op++ = 255;
+      length -= 255;
+    }
+    *op++ = (unsigned char)length;
+    return op;
+  }
+
+
+  //! @brief Greedy single-probe LZ4 block compressor
+  //!
+  //! @param dst Output, of at least lzBound(size) bytes
+  //!
+  //! @return Length of the compressed block
+  //!
+  static int lzCompress (const unsigned char *src, int size, unsigned char *dst)
+  {
+    int table[1 << LZ_HASH_BITS];
+    int ip = 0, anchor = 0, ref, length, literals;
+    unsigned int seq, hash;
+    unsigned char *op = dst, *token;
+
+    for (int i = 0; i < (1 << LZ_HASH_BITS); ++i)
+    {
+      table[i] = -1;
+    }
+
+    while (size >= LZ_MATCH_LIMIT && ip <= size - LZ_MATCH_LIMIT)
+    {
+      seq = lzRead32(src + ip);
+      hash = (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+      ref = table[hash];
+      table[hash] = ip;
+      if (ref < 0 || ip - ref > LZ_WINDOW || lzRead32(src + ref) != seq)
+      {
+        ++ip;
+        continue;
+      }
+
+      length = LZ_MIN_MATCH;
+      while (ip + length < size - LZ_LAST_LITERALS && src[ref + length] == src[ip + length])
+      {
+        ++length;
+      }
+
+      literals = ip - anchor;
+      token = op++;
+      *token = (unsigned char)(((literals < 15 ? literals : 15) << 4) |
+                               ((length - LZ_MIN_MATCH) < 15 ? (length - LZ_MIN_MATCH) : 15));
+      if (literals >= 15)
+      {
+        op = lzLength(op, literals - 15);
+      }
+      memcpy(op, src + anchor, literals);
+      op += literals;
+      *op++ = (unsigned char)((ip - ref) & 0xFF);
+      *op++ = (unsigned char)((ip - ref) >> 8);
+      if (length - LZ_MIN_MATCH >= 15)
+      {
+        op = lzLength(op, length - LZ_MIN_MATCH - 15);
+      }
+      ip += length;
+      anchor = ip;
+    }
+
+    literals = size - anchor;
+    token = op++;
+    *token = (unsigned char)((literals < 15 ? literals : 15) << 4);
+    if (literals >= 15)
+    {
+      op = lzLength(op, literals - 15);
+    }
+    memcpy(op, src + anchor, literals);
+    op += literals;
+    return (int)(op - dst);
+  }
+
+
+  static int lzBound (int size)
+  {
+    return size + (size / 255) + 16;
+  }
+
+
+  //! @brief Decompress an LZ4 block
+  //!
+  //! @return True if the block decoded to exactly size bytes
+  //!
+  static bool lzDecompress (const unsigned char *src, int packed, unsigned char *dst, int size)
+  {
+    const unsigned char *ip = src, *end = src + packed;
+    unsigned char *op = dst, *limit = dst + size;
+    int literals, length, offset;
+    unsigned char step;
+
+    while (ip < end)
+    {
+      unsigned char token = *ip++;
+      literals = token >> 4;
+      if (literals == 15)
+      {
+        do
+        {
+          if (ip >= end)
+          {
+            return false;
+          }
+          step = *ip++;
+          literals += step;
+        } while (step == 255);
+      }
+      if (literals > end - ip || literals > limit - op)
+      {
+        return false;
+      }
+      memcpy(op, ip, literals);
+      ip += literals;
+      op += literals;
+      if (ip == end)
+      {
+        break;
+      }
+
+      if (end - ip < 2)
+      {
+        return false;
+      }
+      offset = ip[0] | (ip[1] << 8);
+      ip += 2;
+      length = token & 0x0F;
+      if (length == 15)
+      {
+        do
+        {
+          if (ip >= end)
+          {
+            return false;
+          }
+          step = *ip++;
+          length += step;
+        } while (step == 255);
+      }
+      length += LZ_MIN_MATCH;
+      if (offset == 0 || offset > op - dst || length > limit - op)
+      {
+        return false;
+      }
+      //! Byte by byte:  a match may overlap what it copies
+      for (int i = 0; i < length; ++i, ++op)
+      {
+        *op = *(op - offset);
+      }
+    }
+    return op == limit;
+  }
+
+
+  //! @brief Append-only file written through a window mapped into memory.  The file grows a
+  //!        window at a time and is cut back to what was written when it is closed.
+  //!
+  struct recordFile
+  {
+#ifdef WIN32
+    HANDLE file;
+#else
+    int file;
+#endif
+    unsigned char *window;
+    unsigned long long base;
+    unsigned long long pos;
+
+    recordFile () :
+#ifdef WIN32
+      file(INVALID_HANDLE_VALUE),
+#else
+      file(-1),
+#endif
+      window(NULL),
+      base(0),
+      pos(0)
+    {
+    }
+
+    bool open (const char *path)
+    {
+#ifdef WIN32
+      file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+                         FILE_ATTRIBUTE_NORMAL, NULL);
+      if (file == INVALID_HANDLE_VALUE)
+      {
+        return false;
+      }
+#else
+      file = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+      if (file < 0)
+      {
+        return false;
+      }
+#endif
+      base = pos = 0;
+      if (!map(0))
+      {
+        close();
+        return false;
+      }
+      return true;
+    }
+
+    //! @brief Unmap the current window and map the one starting at offset, growing the file
+    //!
+    bool map (unsigned long long offset)
+    {
+      unmap();
+#ifdef WIN32
+      unsigned long long end = offset + CRPI_RECORD_MAP;
+      HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, (DWORD)(end >> 32),
+                                          (DWORD)(end & 0xFFFFFFFF), NULL);
+      if (mapping == NULL)
+      {
+        return false;
+      }
+      window = (unsigned char*)MapViewOfFile(mapping, FILE_MAP_WRITE, (DWORD)(offset >> 32),
+                                             (DWORD)(offset & 0xFFFFFFFF), CRPI_RECORD_MAP);
+      //! The view keeps the mapping alive
+      CloseHandle(mapping);
+      if (window == NULL)
+      {
+        return false;
+      }
+#else
+      if (ftruncate(file, (off_t)(offset + CRPI_RECORD_MAP)) != 0)
+      {
+        return false;
+      }
+      void *view = mmap(NULL, CRPI_RECORD_MAP, PROT_READ | PROT_WRITE, MAP_SHARED, file, (off_t)offset);
+      if (view == MAP_FAILED)
+      {
+        return false;
+      }
+      window = (unsigned char*)view;
+#endif
+      base = offset;
+      return true;
+    }
+
+    void unmap ()
+    {
+      if (window == NULL)
+      {
+        return;
+      }
+#ifdef WIN32
+      UnmapViewOfFile(window);
+#else
+      munmap(window, CRPI_RECORD_MAP);
+#endif
+      window = NULL;
+    }
+
+    bool write (const void *data, size_t size)
+    {
+      const unsigned char *from = (const unsigned char*)data;
+      size_t room, part;
+
+      while (size > 0)
+      {
+        if (pos >= base + CRPI_RECORD_MAP && !map(base + CRPI_RECORD_MAP))
+        {
+          return false;
+        }
+        room = (size_t)(base + CRPI_RECORD_MAP - pos);
+        part = (size < room) ? size : room;
+        memcpy(window + (pos - base), from, part);
+        pos += part;
+        from += part;
+        size -= part;
+      }
+      return true;
+    }
+
+    void close ()
+    {
+      unmap();
+#ifdef WIN32
+      if (file != INVALID_HANDLE_VALUE)
+      {
+        LARGE_INTEGER end;
+        end.QuadPart = (LONGLONG)pos;
+        SetFilePointerEx(file, end, NULL, FILE_BEGIN);
+        SetEndOfFile(file);
+        CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+      }
+#else
+      if (file >= 0)
+      {
+        if (ftruncate(file, (off_t)pos) != 0)
+        {
+          CRPI_LOG(CRPI_LOG_WARNING, "CRPI recorder:  could not trim the recording");
+        }
+        ::close(file);
+        file = -1;
+      }
+#endif
+    }
+  };
+
+
+  //! @brief One queued record.  A producer claims the slot by advancing the queue's tail, and
+  //!        publishes it by storing its position + 1 in seq; the writer frees it by storing
+  //!        the position + CRPI_RECORD_QUEUE.
+  //!
+  struct recordSlot
+  {
+    std::atomic<unsigned long long> seq;
+    double timestamp;
+    int size;
+    unsigned short channel;
+    unsigned char kind;
+    unsigned char data[CRPI_RECORD_PAYLOAD];
+  };
+
+  //! @brief The recorder.  The queue is created with the first recording and kept afterward,
+  //!        so that a producer racing Stop never writes to freed memory.
+  //!
+  struct recorderState
+  {
+    recordSlot *slots;
+    std::atomic<unsigned long long> tail;
+    unsigned long long head;
+
+    //! @brief Channel names.  Filled in before count is advanced past them.
+    //!
+    string names[CRPI_RECORD_CHANNELS];
+    std::atomic<int> channels;
+    void *lock;
+
+    //! @brief The recording:  its file, the chunk being filled, the index so far, which
+    //!        channels have had their names written, and whether the writer should finish
+    //!
+    recordFile file;
+    vector<unsigned char> chunk;
+    vector<unsigned char> packed;
+    unsigned int chunkRecords;
+    double chunkFirst;
+    double chunkLast;
+    double latest;
+    vector<crpiRecordIndex> index;
+    bool announced[CRPI_RECORD_CHANNELS];
+    std::atomic<bool> stop;
+    void *loop;
+
+    std::atomic<unsigned long long> records;
+    std::atomic<unsigned long long> dropped;
+    std::atomic<unsigned long long> chunks;
+    std::atomic<unsigned long long> rawBytes;
+    std::atomic<unsigned long long> fileBytes;
+
+    recorderState () :
+      slots(NULL),
+      tail(0),
+      head(0),
+      channels(0),
+      lock(ulapi_fastlock_new()),
+      chunkRecords(0),
+      chunkFirst(0.0),
+      chunkLast(0.0),
+      latest(0.0),
+      stop(false),
+      loop(NULL),
+      records(0),
+      dropped(0),
+      chunks(0),
+      rawBytes(0),
+      fileBytes(0)
+    {
+    }
+  };
+
+  static recorderState &recorder ()
+  {
+    static recorderState state;
+    return state;
+  }
+
+  std::atomic<bool> CrpiRecorder::recording_(false);
+  std::atomic<unsigned int> CrpiRecorder::generation_(0);
+
+
+  //! @brief Append a record to the chunk being filled
+  //!
+  static void recordAppend (recorderState &rs, int channel, int kind, double timestamp,
+                            const void *data, int size)
+  {
+    recordEntry entry;
+    size_t at = rs.chunk.size();
+
+    entry.timestamp = timestamp;
+    entry.size = (unsigned int)size;
+    entry.channel = (unsigned short)channel;
+    entry.kind = (unsigned char)kind;
+    entry.reserved = 0;
+    rs.chunk.resize(at + sizeof(entry) + size);
+    memcpy(&rs.chunk[at], &entry, sizeof(entry));
+    if (size > 0)
+    {
+      memcpy(&rs.chunk[at + sizeof(entry)], data, size);
+    }
+
+    if (rs.chunkRecords == 0 || timestamp < rs.chunkFirst)
+    {
+      rs.chunkFirst = timestamp;
+    }
+    if (rs.chunkRecords == 0 || timestamp > rs.chunkLast)
+    {
+      rs.chunkLast = timestamp;
+    }
+    ++rs.chunkRecords;
+  }
+
+
+  //! @brief Compress and write the chunk being filled
+  //!
+  static bool recordFlush (recorderState &rs)
+  {
+    recordChunkHeader header;
+    crpiRecordIndex entry;
+    int raw = (int)rs.chunk.size();
+
+    if (rs.chunkRecords == 0)
+    {
+      return true;
+    }
+
+    rs.packed.resize(lzBound(raw));
+    header.magic = CRPI_RECORD_CHUNK_MAGIC;
+    header.raw = (unsigned int)raw;
+    header.packed = (unsigned int)lzCompress(&rs.chunk[0], raw, &rs.packed[0]);
+    header.codec = RECORD_LZ4;
+    const unsigned char *payload = &rs.packed[0];
+    if ((int)header.packed >= raw)
+    {
+      //! Incompressible (e.g., noisy sensor data)
+      header.codec = RECORD_STORED;
+      header.packed = (unsigned int)raw;
+      payload = &rs.chunk[0];
+    }
+    header.records = rs.chunkRecords;
+    header.checksum = recordChecksum(payload, header.packed);
+    header.first = rs.chunkFirst;
+    header.last = rs.chunkLast;
+
+    entry.offset = rs.file.pos;
+    entry.first = rs.chunkFirst;
+    rs.latest = (rs.index.empty() || rs.chunkLast > rs.latest) ? rs.chunkLast : rs.latest;
+    entry.latest = rs.latest;
+
+    bool ok = rs.file.write(&header, sizeof(header)) && rs.file.write(payload, header.packed);
+    if (ok)
+    {
+      rs.index.push_back(entry);
+      rs.records.fetch_add(rs.chunkRecords, std::memory_order_relaxed);
+      rs.chunks.fetch_add(1, std::memory_order_relaxed);
+      rs.rawBytes.fetch_add(raw, std::memory_order_relaxed);
+      rs.fileBytes.store(rs.file.pos, std::memory_order_relaxed);
+    }
+    rs.chunk.clear();
+    rs.chunkRecords = 0;
+    return ok;
+  }
+
+
+  //! @brief Move published records from the queue into chunks
+  //!
+  //! @return The number of records taken
+  //!
+  static int recordDrain (recorderState &rs)
+  {
+    int taken = 0;
+    recordSlot *slot;
+
+    for (;;)
+    {
+      slot = &rs.slots[rs.head & (CRPI_RECORD_QUEUE - 1)];
+      if (slot->seq.load(std::memory_order_acquire) != rs.head + 1)
+      {
+        break;
+      }
+      if (slot->channel < CRPI_RECORD_CHANNELS && !rs.announced[slot->channel])
+      {
+        //! A reader without the index learns the name from the first chunk that uses it
+        const string &name = rs.names[slot->channel];
+        recordAppend(rs, slot->channel, RECORD_CHANNEL, slot->timestamp, name.c_str(), (int)name.size());
+        rs.announced[slot->channel] = true;
+      }
+      recordAppend(rs, slot->channel, slot->kind, slot->timestamp, slot->data, slot->size);
+      slot->seq.store(rs.head + CRPI_RECORD_QUEUE, std::memory_order_release);
+      ++rs.head;
+      ++taken;
+
+      if (rs.chunk.size() >= CRPI_RECORD_CHUNK && !recordFlush(rs))
+      {
+        CRPI_LOG(CRPI_LOG_ERROR, "CRPI recorder:  could not write to the recording");
+      }
+    }
+    return taken;
+  }
+
+
+  //! @brief Write the index and trailer
+  //!
+  static void recordFinish (recorderState &rs)
+  {
+    recordTrailer trailer;
+    unsigned int id, length;
+
+    trailer.index = rs.file.pos;
+    trailer.chunks = (unsigned int)rs.index.size();
+    trailer.channels = (unsigned int)rs.channels.load(std::memory_order_acquire);
+    trailer.magic = CRPI_RECORD_INDEX_MAGIC;
+    trailer.reserved = 0;
+
+    if (!rs.index.empty())
+    {
+      rs.file.write(&rs.index[0], rs.index.size() * sizeof(crpiRecordIndex));
+    }
+    for (id = 0; id < trailer.channels; ++id)
+    {
+      length = (unsigned int)rs.names[id].size();
+      rs.file.write(&id, sizeof(id));
+      rs.file.write(&length, sizeof(length));
+      rs.file.write(rs.names[id].c_str(), length);
+    }
+    rs.file.write(&trailer, sizeof(trailer));
+    rs.fileBytes.store(rs.file.pos, std::memory_order_relaxed);
+  }
+
+
+  //! @brief Writer loop
+  //!
+  static void recordWriter (void *param)
+  {
+    recorderState &rs = *(recorderState*)param;
+    double flushed = ulapi_time();
+    bool stopping;
+    int taken;
+
+    for (;;)
+    {
+      stopping = rs.stop.load(std::memory_order_acquire);
+      taken = recordDrain(rs);
+      if (rs.chunkRecords > 0 && (stopping || ulapi_time() - flushed > CRPI_RECORD_FLUSH))
+      {
+        if (!recordFlush(rs))
+        {
+          CRPI_LOG(CRPI_LOG_ERROR, "CRPI recorder:  could not write to the recording");
+        }
+        flushed = ulapi_time();
+      }
+      if (stopping && taken == 0)
+      {
+        break;
+      }
+      if (taken == 0)
+      {
+        ulapi_sleep(HUB_TICK);
+      }
+    }
+    recordFinish(rs);
+    rs.file.close();
+  }
+
+
+  LIBRARY_API bool CrpiRecorder::Start (const char *path)
+  {
+    recorderState &rs = recorder();
+    recordFileHeader header;
+
+    ulapi_fastlock_take(rs.lock);
+    if (rs.loop != NULL)
+    {
+      ulapi_fastlock_give(rs.lock);
+      return false;
+    }
+    if (rs.slots == NULL)
+    {
+      rs.slots = new recordSlot[CRPI_RECORD_QUEUE];
+      for (unsigned long long i = 0; i < CRPI_RECORD_QUEUE; ++i)
+      {
+        rs.slots[i].seq.store(i, std::memory_order_relaxed);
+      }
+    }
+    if (!rs.file.open(path))
+    {
+      ulapi_fastlock_give(rs.lock);
+      return false;
+    }
+
+    //! Discard what producers racing the last Stop left behind
+    while (rs.slots[rs.head & (CRPI_RECORD_QUEUE - 1)].seq.load(std::memory_order_acquire) == rs.head + 1)
+    {
+      rs.slots[rs.head & (CRPI_RECORD_QUEUE - 1)].seq.store(rs.head + CRPI_RECORD_QUEUE,
+                                                             std::memory_order_release);
+      ++rs.head;
+    }
+
+    header.magic = CRPI_RECORD_MAGIC;
+    header.version = CRPI_RECORD_VERSION;
+    header.chunkBytes = CRPI_RECORD_CHUNK;
+    header.reserved = 0;
+    header.start = ulapi_time();
+    rs.file.write(&header, sizeof(header));
+
+    rs.chunk.clear();
+    rs.chunk.reserve(CRPI_RECORD_CHUNK + sizeof(recordEntry) + CRPI_RECORD_PAYLOAD);
+    rs.chunkRecords = 0;
+    rs.index.clear();
+    for (int i = 0; i < CRPI_RECORD_CHANNELS; ++i)
+    {
+      rs.announced[i] = false;
+    }
+    rs.records.store(0, std::memory_order_relaxed);
+    rs.dropped.store(0, std::memory_order_relaxed);
+    rs.chunks.store(0, std::memory_order_relaxed);
+    rs.rawBytes.store(0, std::memory_order_relaxed);
+    rs.fileBytes.store(rs.file.pos, std::memory_order_relaxed);
+    rs.stop.store(false, std::memory_order_relaxed);
+
+    rs.loop = SensorHub::Instance().StartLoop(recordWriter, &rs, HUB_BACKGROUND);
+    if (rs.loop == NULL)
+    {
+      rs.file.close();
+      ulapi_fastlock_give(rs.lock);
+      return false;
+    }
+    generation_.fetch_add(1, std::memory_order_release);
+    recording_.store(true, std::memory_order_release);
+    ulapi_fastlock_give(rs.lock);
+    return true;
+  }
+
+
+  LIBRARY_API void CrpiRecorder::Stop ()
+  {
+    recorderState &rs = recorder();
+
+    ulapi_fastlock_take(rs.lock);
+    if (rs.loop == NULL)
+    {
+      ulapi_fastlock_give(rs.lock);
+      return;
+    }
+    recording_.store(false, std::memory_order_relaxed);
+    rs.stop.store(true, std::memory_order_release);
+    SensorHub::Instance().JoinLoop(rs.loop);
+    rs.loop = NULL;
+    ulapi_fastlock_give(rs.lock);
+  }
+
+
+  LIBRARY_API int CrpiRecorder::Channel (const string &name)
+  {
+    recorderState &rs = recorder();
+    int count, id = -1;
+
+    ulapi_fastlock_take(rs.lock);
+    count = rs.channels.load(std::memory_order_relaxed);
+    for (int i = 0; i < count && id < 0; ++i)
+    {
+      if (rs.names[i] == name)
+      {
+        id = i;
+      }
+    }
+    if (id < 0 && count < CRPI_RECORD_CHANNELS)
+    {
+      rs.names[count] = name.substr(0, CRPI_RECORD_NAME_MAX - 1);
+      id = count;
+      rs.channels.store(count + 1, std::memory_order_release);
+    }
+    ulapi_fastlock_give(rs.lock);
+    return id;
+  }
+
+
+  LIBRARY_API bool CrpiRecorder::Record (int channel, CrpiRecordKind kind, double timestamp,
+                                         const void *data, int size)
+  {
+    //! Acquire, so that the queue created by the first Start is seen
+    if (!recording_.load(std::memory_order_acquire))
+    {
+      return false;
+    }
+    recorderState &rs = recorder();
+    if (channel < 0 || channel >= CRPI_RECORD_CHANNELS || size < 0 || size > CRPI_RECORD_PAYLOAD)
+    {
+      rs.dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    unsigned long long pos = rs.tail.load(std::memory_order_relaxed), seq;
+    recordSlot *slot;
+    for (;;)
+    {
+      slot = &rs.slots[pos & (CRPI_RECORD_QUEUE - 1)];
+      seq = slot->seq.load(std::memory_order_acquire);
+      if (seq == pos)
+      {
+        if (rs.tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          break;
+        }
+      }
+      else if (seq < pos)
+      {
+        //! The writer has not freed this slot yet:  the queue is full
+        rs.dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      else
+      {
+        pos = rs.tail.load(std::memory_order_relaxed);
+      }
+    }
+
+    slot->timestamp = timestamp;
+    slot->size = size;
+    slot->channel = (unsigned short)channel;
+    slot->kind = (unsigned char)kind;
+    if (size > 0)
+    {
+      memcpy(slot->data, data, size);
+    }
+    slot->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+
+  LIBRARY_API bool CrpiRecorder::RecordName (int channel, int id, const char *name, double timestamp)
+  {
+    crpiRecordName record;
+    size_t length = strlen(name);
+
+    if (length > CRPI_RECORD_NAME_MAX)
+    {
+      length = CRPI_RECORD_NAME_MAX;
+    }
+    record.id = id;
+    memcpy(record.name, name, length);
+    return Record(channel, RECORD_NAME, timestamp, &record, (int)(sizeof(record.id) + length));
+  }
+
+
+  LIBRARY_API void CrpiRecorder::RecordCommand (const char *name, double start, double end,
+                                                CanonReturn result)
+  {
+    if (!Recording())
+    {
+      return;
+    }
+    static int commands = Channel("commands");
+
+    crpiRecordCommand command;
+    command.start = start;
+    command.end = end;
+    command.result = (int)result;
+    strncpy(command.name, name, CRPI_RECORD_NAME_MAX - 1);
+    command.name[CRPI_RECORD_NAME_MAX - 1] = '\0';
+    Record(commands, RECORD_COMMAND, end, &command, sizeof(command));
+  }
+
+
+  LIBRARY_API void CrpiRecorder::Stats (CrpiRecorderStats &stats)
+  {
+    recorderState &rs = recorder();
+    stats.records = rs.records.load(std::memory_order_relaxed);
+    stats.dropped = rs.dropped.load(std::memory_order_relaxed);
+    stats.chunks = rs.chunks.load(std::memory_order_relaxed);
+    stats.rawBytes = rs.rawBytes.load(std::memory_order_relaxed);
+    stats.fileBytes = rs.fileBytes.load(std::memory_order_relaxed);
+  }
+
+
+  //! @brief Files may exceed 2 GB
+  //!
+  static bool readerSeek (FILE *file, unsigned long long offset)
+  {
+#ifdef WIN32
+    return _fseeki64(file, (__int64)offset, SEEK_SET) == 0;
+#else
+    return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+  }
+
+
+  static bool readerRead (FILE *file, unsigned long long offset, void *data, size_t size)
+  {
+    return readerSeek(file, offset) && fread(data, 1, size, file) == size;
+  }
+
+
+  LIBRARY_API CrpiRecordReader::CrpiRecordReader () :
+    file_(NULL),
+    fileSize_(0),
+    current_(-1),
+    pos_(0)
+  {
+  }
+
+
+  LIBRARY_API CrpiRecordReader::~CrpiRecordReader ()
+  {
+    Close();
+  }
+
+
+  LIBRARY_API bool CrpiRecordReader::Open (const char *path)
+  {
+    recordFileHeader header;
+    recordTrailer trailer;
+    unsigned int id, length;
+    bool indexed = false;
+
+    Close();
+    file_ = fopen(path, "rb");
+    if (file_ == NULL)
+    {
+      return false;
+    }
+#ifdef WIN32
+    _fseeki64(file_, 0, SEEK_END);
+    fileSize_ = (unsigned long long)_ftelli64(file_);
+#else
+    fseeko(file_, 0, SEEK_END);
+    fileSize_ = (unsigned long long)ftello(file_);
+#endif
+    if (!readerRead(file_, 0, &header, sizeof(header)) || header.magic != CRPI_RECORD_MAGIC ||
+        header.version != CRPI_RECORD_VERSION)
+    {
+      Close();
+      return false;
+    }
+
+    if (fileSize_ >= sizeof(header) + sizeof(trailer) &&
+        readerRead(file_, fileSize_ - sizeof(trailer), &trailer, sizeof(trailer)) &&
+        trailer.magic == CRPI_RECORD_INDEX_MAGIC &&
+        trailer.index + (unsigned long long)trailer.chunks * sizeof(crpiRecordIndex) <= fileSize_)
+    {
+      index_.resize(trailer.chunks);
+      indexed = (trailer.chunks == 0 ||
+                 readerRead(file_, trailer.index, &index_[0], trailer.chunks * sizeof(crpiRecordIndex)));
+      names_.assign(trailer.channels, string());
+      for (unsigned int i = 0; indexed && i < trailer.channels; ++i)
+      {
+        if (fread(&id, sizeof(id), 1, file_) != 1 || fread(&length, sizeof(length), 1, file_) != 1 ||
+            id >= trailer.channels || length >= CRPI_RECORD_NAME_MAX)
+        {
+          break;
+        }
+        char name[CRPI_RECORD_NAME_MAX];
+        if (fread(name, 1, length, file_) != length)
+        {
+          break;
+        }
+        names_[id].assign(name, length);
+      }
+    }
+    if (!indexed)
+    {
+      scanChunks();
+    }
+    current_ = -1;
+    pos_ = 0;
+    return true;
+  }
+
+
+  LIBRARY_API void CrpiRecordReader::Close ()
+  {
+    if (file_ != NULL)
+    {
+      fclose(file_);
+      file_ = NULL;
+    }
+    index_.clear();
+    names_.clear();
+    chunk_.clear();
+    current_ = -1;
+    pos_ = 0;
+  }
+
+
+  void CrpiRecordReader::scanChunks ()
+  {
+    recordChunkHeader header;
+    crpiRecordIndex entry;
+    unsigned long long offset = sizeof(recordFileHeader);
+    double latest = 0.0;
+
+    index_.clear();
+    names_.clear();
+    while (offset + sizeof(header) <= fileSize_ && readerRead(file_, offset, &header, sizeof(header)) &&
+           header.magic == CRPI_RECORD_CHUNK_MAGIC && offset + sizeof(header) + header.packed <= fileSize_)
+    {
+      entry.offset = offset;
+      entry.first = header.first;
+      latest = (index_.empty() || header.last > latest) ? header.last : latest;
+      entry.latest = latest;
+      index_.push_back(entry);
+      offset += sizeof(header) + header.packed;
+    }
+  }
+
+
+  LIBRARY_API double CrpiRecordReader::Begin () const
+  {
+    double begin = 0.0;
+    for (size_t i = 0; i < index_.size(); ++i)
+    {
+      if (i == 0 || index_[i].first < begin)
+      {
+        begin = index_[i].first;
+      }
+    }
+    return begin;
+  }
+
+
+  LIBRARY_API double CrpiRecordReader::End () const
+  {
+    return index_.empty() ? 0.0 : index_.back().latest;
+  }
+
+
+  LIBRARY_API const char *CrpiRecordReader::ChannelName (int channel) const
+  {
+    return (channel >= 0 && channel < (int)names_.size()) ? names_[channel].c_str() : "";
+  }
+
+
+  bool CrpiRecordReader::loadChunk (int index)
+  {
+    recordChunkHeader header;
+
+    current_ = index;
+    pos_ = 0;
+    chunk_.clear();
+    if (!readerRead(file_, index_[index].offset, &header, sizeof(header)) ||
+        header.magic != CRPI_RECORD_CHUNK_MAGIC)
+    {
+      return false;
+    }
+    packed_.resize(header.packed > 0 ? header.packed : 1);
+    if (fread(&packed_[0], 1, header.packed, file_) != header.packed ||
+        recordChecksum(&packed_[0], header.packed) != header.checksum)
+    {
+      return false;
+    }
+    if (header.codec == RECORD_STORED)
+    {
+      chunk_.assign(packed_.begin(), packed_.begin() + header.packed);
+      return true;
+    }
+    chunk_.resize(header.raw);
+    if (header.codec != RECORD_LZ4 || header.raw == 0 ||
+        !lzDecompress(&packed_[0], (int)header.packed, &chunk_[0], (int)header.raw))
+    {
+      chunk_.clear();
+      return false;
+    }
+    return true;
+  }
+
+
+  LIBRARY_API bool CrpiRecordReader::Seek (double t)
+  {
+    crpiRecordIndex key;
+    CrpiRecord record;
+    size_t at;
+
+    key.latest = t;
+    vector<crpiRecordIndex>::const_iterator found =
+      lower_bound(index_.begin(), index_.end(), key,
+                  [](const crpiRecordIndex &a, const crpiRecordIndex &b) { return a.latest < b.latest; });
+    if (found == index_.end() || !loadChunk((int)(found - index_.begin())))
+    {
+      current_ = (int)index_.size();
+      return false;
+    }
+
+    //! Records in a chunk are in arrival order, which is nearly time order
+    for (;;)
+    {
+      at = pos_;
+      int chunk = current_;
+      if (!Next(record))
+      {
+        return false;
+      }
+      if (record.timestamp >= t)
+      {
+        if (current_ == chunk)
+        {
+          pos_ = at;
+        }
+        else
+        {
+          loadChunk(current_);
+        }
+        return true;
+      }
+    }
+  }
+
+
+  LIBRARY_API bool CrpiRecordReader::Next (CrpiRecord &record)
+  {
+    recordEntry entry;
+
+    if (file_ == NULL)
+    {
+      return false;
+    }
+    while (pos_ + sizeof(entry) > chunk_.size())
+    {
+      if (current_ + 1 >= (int)index_.size() || !loadChunk(current_ + 1))
+      {
+        return false;
+      }
+    }
+    memcpy(&entry, &chunk_[pos_], sizeof(entry));
+    if (pos_ + sizeof(entry) + entry.size > chunk_.size())
+    {
+      return false;
+    }
+    record.timestamp = entry.timestamp;
+    record.channel = entry.channel;
+    record.kind = (CrpiRecordKind)entry.kind;
+    record.data = &chunk_[pos_ + sizeof(entry)];
+    record.size = (int)entry.size;
+    pos_ += sizeof(entry) + entry.size;
+
+    if (record.kind == RECORD_CHANNEL && record.size < CRPI_RECORD_NAME_MAX)
+    {
+      if ((int)names_.size() <= record.channel)
+      {
+        names_.resize(record.channel + 1);
+      }
+      names_[record.channel].assign((const char*)record.data, record.size);
+    }
+    return true;
+  }
+
+
+  //! @brief Starts recording if CRPI_RECORD names a file
+  //!
+  struct recordEnvironment
+  {
+    recordEnvironment ()
+    {
+      const char *setting = getenv("CRPI_RECORD");
+      if (setting == NULL || setting[0] == '\0')
+      {
+        return;
+      }
+      if (CrpiRecorder::Start(setting))
+      {
+        atexit(CrpiRecorder::Stop);
+      }
+      else
+      {
+        CRPI_LOG(CRPI_LOG_ERROR, "CRPI recorder:  could not record to %s", setting);
+      }
+    }
+  };
+
+  static recordEnvironment recordStartup;
+} // namespace crpi_robot
@@ -0,0 +1,313 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_recorder.h
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Binary state recorder for robots and sensors.
+//
+//  Drivers hand each feedback frame, command, and sensor frame to
+//  CrpiRecorder::Record, which copies it into a lock-free queue and returns.
+//  A writer loop on the SensorHub drains the queue into chunks of about
+//  CRPI_RECORD_CHUNK bytes, compresses each chunk with an LZ4-format block
+//  codec, and appends it to a memory-mapped file.  While the recorder is off
+//  Record costs one relaxed load, and while it is on a producer never waits:
+//  a record that finds the queue full is counted as dropped.
+//
+//  File layout (host byte order):
+//
+//    file header    CRPI_RECORD_MAGIC, CRPI_RECORD_VERSION, start time
+//    chunk*         chunk header (sizes, record count, time span), payload
+//    index          one entry per chunk, then the channel names
+//    trailer        offset of the index, counts, CRPI_RECORD_INDEX_MAGIC
+//
+//  Entries in the index hold the latest timestamp of their chunk and of every
+//  chunk before it, so CrpiRecordReader::Seek finds a time with a binary
+//  search.  A file whose writer died before writing the index is still read,
+//  by walking the chunk headers.
+//
+//  Recording can be started without recompiling by setting CRPI_RECORD in
+//  the environment to the path of the file to write.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_recorder_H
+#define crpi_recorder_H
+
+#include "crpi.h"
+#include <stdio.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+//! @brief Marks a recording ("CREC"), a chunk ("CCHK"), and the index trailer ("CIDX")
+//!
+#define CRPI_RECORD_MAGIC 0x43524543
+#define CRPI_RECORD_CHUNK_MAGIC 0x4343484b
+#define CRPI_RECORD_INDEX_MAGIC 0x43494458
+#define CRPI_RECORD_VERSION 1
+
+//! @brief Uncompressed bytes per chunk, longest time (s) a record waits to be written, and
+//!        bytes of the file mapped at a time
+//!
+#define CRPI_RECORD_CHUNK 65536
+#define CRPI_RECORD_FLUSH 0.5
+#define CRPI_RECORD_MAP (16 << 20)
+
+//! @brief Records queued between producers and the writer (a power of 2), longest payload,
+//!        and channels per recording
+//!
+#define CRPI_RECORD_QUEUE 2048
+#define CRPI_RECORD_PAYLOAD 4352
+#define CRPI_RECORD_CHANNELS 256
+
+//! @brief Longest channel name, including the terminator
+//!
+#define CRPI_RECORD_NAME_MAX 64
+
+namespace crpi_robot
+{
+  //! @brief What a record holds
+  //!
+  typedef enum
+  {
+    RECORD_CHANNEL = 0, //! A channel's name, written when the channel is first used
+    RECORD_STATE,       //! A RobotStateSnapshot
+    RECORD_FEEDBACK,    //! A driver's own feedback record
+    RECORD_COMMAND,     //! A crpiRecordCommand
+    RECORD_SENSOR,      //! A sensor frame, in the sensor's own layout
+    RECORD_NAME         //! A crpiRecordName, naming an id used in the channel's other records
+  } CrpiRecordKind;
+
+  //! @brief Payload of a RECORD_COMMAND record
+  //!
+  struct crpiRecordCommand
+  {
+    //! @brief When the command started and ended (s, ulapi_time); the record's timestamp is
+    //!        the end
+    //!
+    double start;
+    double end;
+
+    //! @brief Outcome of the command
+    //!
+    int result;
+
+    //! @brief Name of the command (e.g., "MoveTo")
+    //!
+    char name[CRPI_RECORD_NAME_MAX];
+  };
+
+  //! @brief Payload of a RECORD_NAME record (the name is not terminated; the record's size
+  //!        gives its length)
+  //!
+  struct crpiRecordName
+  {
+    int id;
+    char name[CRPI_RECORD_NAME_MAX];
+  };
+
+  //! @brief One record, as returned by CrpiRecordReader
+  //!
+  struct CrpiRecord
+  {
+    //! @brief Time (s, ulapi_time) the record describes
+    //!
+    double timestamp;
+
+    //! @brief Channel the record was written to, and what it holds
+    //!
+    int channel;
+    CrpiRecordKind kind;
+
+    //! @brief The payload and its length
+    //!
+    const unsigned char *data;
+    int size;
+  };
+
+  //! @brief Counters of a recording in progress
+  //!
+  struct CrpiRecorderStats
+  {
+    //! @brief Records written to the file, and records dropped because the queue was full
+    //!        or the payload too long
+    //!
+    unsigned long long records;
+    unsigned long long dropped;
+
+    //! @brief Chunks written, and bytes before and after compression
+    //!
+    unsigned long long chunks;
+    unsigned long long rawBytes;
+    unsigned long long fileBytes;
+  };
+
+  //! @ingroup Robot
+  //!
+  //! @brief Process-wide recorder.  One recording is written at a time.
+  //!
+  class LIBRARY_API CrpiRecorder
+  {
+  public:
+    //! @brief Start recording to a file, replacing it if it exists
+    //!
+    //! @return True if the file was opened and the writer started, false otherwise (or if a
+    //!         recording is already in progress)
+    //!
+    static bool Start (const char *path);
+
+    //! @brief Write what is queued, then the index, and close the file
+    //!
+    static void Stop ();
+
+    //! @brief Whether a recording is in progress
+    //!
+    static bool Recording ()
+    {
+      return recording_.load(std::memory_order_relaxed);
+    }
+
+    //! @brief Number of recordings started by the process.  A producer that writes names
+    //!        (RECORD_NAME) once per recording writes them again when this changes.
+    //!
+    static unsigned int Generation ()
+    {
+      return generation_.load(std::memory_order_acquire);
+    }
+
+    //! @brief Look up a channel by name, adding it if it is new.  Drivers register their
+    //!        channels once, when they are set up; channels outlive recordings.
+    //!
+    //! @return The channel, or -1 if CRPI_RECORD_CHANNELS are in use
+    //!
+    static int Channel (const std::string &name);
+
+    //! @brief Queue a record (any thread).  Does nothing while no recording is in progress.
+    //!
+    //! @param channel   A channel returned by Channel
+    //! @param kind      What the payload holds
+    //! @param timestamp Time (s, ulapi_time) the record describes
+    //! @param data      The payload (copied before the function returns)
+    //! @param size      Length of the payload, at most CRPI_RECORD_PAYLOAD
+    //!
+    //! @return True if the record was queued
+    //!
+    static bool Record (int channel, CrpiRecordKind kind, double timestamp, const void *data, int size);
+
+    //! @brief Queue a robot's state
+    //!
+    static bool RecordState (int channel, const RobotStateSnapshot &state)
+    {
+      return Recording() && Record(channel, RECORD_STATE, state.timestamp, &state, sizeof(state));
+    }
+
+    //! @brief Queue the name of an id on a channel
+    //!
+    static bool RecordName (int channel, int id, const char *name, double timestamp);
+
+    //! @brief Queue a finished command on the "commands" channel
+    //!
+    static void RecordCommand (const char *name, double start, double end, CanonReturn result);
+
+    //! @brief Copy the counters of the current (or last) recording
+    //!
+    static void Stats (CrpiRecorderStats &stats);
+
+  private:
+    static std::atomic<bool> recording_;
+    static std::atomic<unsigned int> generation_;
+  }; // CrpiRecorder
+
+
+  //! @brief Per-recording chunk index entry
+  //!
+  struct crpiRecordIndex
+  {
+    //! @brief Offset of the chunk header in the file
+    //!
+    unsigned long long offset;
+
+    //! @brief Earliest timestamp in the chunk, and the latest in it or any chunk before it
+    //!
+    double first;
+    double latest;
+  };
+
+  //! @ingroup Robot
+  //!
+  //! @brief Reads a recording in time order of its chunks
+  //!
+  class LIBRARY_API CrpiRecordReader
+  {
+  public:
+    CrpiRecordReader ();
+    ~CrpiRecordReader ();
+
+    //! @brief Open a recording and load its index (rebuilt from the chunk headers if the
+    //!        writer did not finish)
+    //!
+    //! @return True if the file is a recording
+    //!
+    bool Open (const char *path);
+
+    void Close ();
+
+    //! @brief Number of chunks, and the time span of the recording
+    //!
+    int Chunks () const
+    {
+      return (int)index_.size();
+    }
+    double Begin () const;
+    double End () const;
+
+    //! @brief Name of a channel, or an empty string if it is unknown
+    //!
+    const char *ChannelName (int channel) const;
+
+    //! @brief Position the reader at the first chunk that may hold records at or after t, in
+    //!        O(log chunks), and skip the records before t within it
+    //!
+    //! @return True if there is such a record
+    //!
+    bool Seek (double t);
+
+    //! @brief Read the next record.  The record's data stays valid until the next call.
+    //!
+    //! @return True if a record was read, false at the end of the recording (or a damaged
+    //!         chunk)
+    //!
+    bool Next (CrpiRecord &record);
+
+  private:
+    //! @brief Decompress a chunk into chunk_
+    //!
+    bool loadChunk (int index);
+
+    //! @brief Rebuild the index by walking the chunk headers
+    //!
+    void scanChunks ();
+
+    CrpiRecordReader (const CrpiRecordReader &);
+    CrpiRecordReader &operator= (const CrpiRecordReader &);
+
+    FILE *file_;
+    unsigned long long fileSize_;
+    std::vector<crpiRecordIndex> index_;
+    std::vector<std::string> names_;
+
+    //! @brief The decompressed chunk, which chunk it is, and the read position in it
+    //!
+    std::vector<unsigned char> chunk_;
+    std::vector<unsigned char> packed_;
+    int current_;
+    size_t pos_;
+  }; // CrpiRecordReader
+} // namespace crpi_robot
+
+#endif
@@ -0,0 +1,462 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_replay.cpp
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Replay of recorded robot state definitions.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_replay.h"
+#include "crpi_log.h"
+
+#include <iostream>
+
+using namespace std;
+
+//#define REPLAY_NOISY
+
+namespace crpi_robot
+{
+  //! @brief Replay thread:  publishes the recorded states of the channel at their recorded
+  //!        times (scaled by the speed), or back to back
+  //!
+  //! @param param Pointer to the replayHandle being served
+  //!
+  static void replayStates (void *param)
+  {
+    replayHandle *rh = (replayHandle*)param;
+    RobotStateSnapshot snapshot;
+    CrpiRecord record;
+    int channel = -1;
+    double start = 0.0, first = 0.0, due;
+    unsigned long sequence = 0;
+
+    while (rh->runThread && rh->reader.Next(record))
+    {
+      if (record.kind != RECORD_STATE || record.size > (int)sizeof(snapshot))
+      {
+        continue;
+      }
+      if (channel < 0 && (rh->channel.empty() || rh->channel == rh->reader.ChannelName(record.channel)))
+      {
+        channel = record.channel;
+        CRPI_LOG(CRPI_LOG_DEBUG, "replaying %s", rh->reader.ChannelName(channel));
+      }
+      if (record.channel != channel)
+      {
+        continue;
+      }
+      //! Older recordings hold shorter states, without the fields appended since
+      snapshot = RobotStateSnapshot();
+      memcpy(&snapshot, record.data, record.size);
+
+      if (sequence == 0)
+      {
+        start = ulapi_time();
+        first = record.timestamp;
+      }
+      if (rh->speed > 0.0)
+      {
+        //! Deadlines are absolute, so the replay does not drift behind the recording
+        due = start + ((record.timestamp - first) / rh->speed);
+        ulapi_sleep_until(due);
+        snapshot.timestamp = due;
+      }
+      else
+      {
+        snapshot.timestamp = ulapi_time();
+      }
+      snapshot.sequence = ++sequence;
+      rh->state.write(snapshot);
+      rh->published.store(sequence, std::memory_order_release);
+    }
+
+    //! The last state is held until the replay is destroyed
+    rh->finished.store(true, std::memory_order_release);
+  }
+
+
+  LIBRARY_API CrpiReplay::CrpiReplay (CrpiRobotParams &params)
+  {
+    replay_.runThread = true;
+    replay_.channel = params.replay_channel;
+    replay_.speed = (params.replay_speed > 0.0) ? params.replay_speed : 0.0;
+    replay_.published.store(0, std::memory_order_relaxed);
+    replay_.finished.store(false, std::memory_order_relaxed);
+    replayTask_ = NULL;
+
+    if (!replay_.reader.Open(params.replay_file.c_str()))
+    {
+      CRPI_LOG(CRPI_LOG_ERROR, "CrpiReplay:  could not open recording %s", params.replay_file.c_str());
+      replay_.finished.store(true, std::memory_order_release);
+      return;
+    }
+
+    CRPI_LOG(CRPI_LOG_DEBUG, "replaying %s (%d chunks, %f s)", params.replay_file.c_str(),
+             (int)replay_.reader.Chunks(), replay_.reader.End() - replay_.reader.Begin());
+    replayTask_ = ulapi_task_new();
+    ulapi_task_start((ulapi_task_struct*)replayTask_, replayStates, &replay_, ulapi_prio_lowest(), 0);
+  }
+
+
+  LIBRARY_API CrpiReplay::~CrpiReplay ()
+  {
+    replay_.runThread = false;
+    if (replayTask_ != NULL)
+    {
+      ulapi_task_join((ulapi_task_struct*)replayTask_, NULL);
+      ulapi_task_delete((ulapi_task_struct*)replayTask_);
+    }
+  }
+
+
+  bool CrpiReplay::latest (RobotStateSnapshot &state) const
+  {
+    return replay_.state.read(state) != 0;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::ApplyCartesianForceTorque (robotPose &robotForceTorque, const vector<bool> &activeAxes, const vector<bool> &manipulator)
+  {
+    //! Not supported
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::ApplyJointTorque (robotAxes &robotJointTorque)
+  {
+    //! Not supported
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::Couple (const char *targetID)
+  {
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::Message (const char *message)
+  {
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::MoveStraightTo (robotPose &pose, bool useBlocking)
+  {
+    return MoveTo(pose, useBlocking);
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::MoveThroughTo (robotPose *poses,
+                                                     int numPoses,
+                                                     robotPose *accelerations,
+                                                     robotPose *speeds,
+                                                     robotPose *tolerances)
+  {
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::MoveTo (robotPose &pose, bool useBlocking)
+  {
+    //! The recorded motion is replayed whatever is commanded
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::GetRobotAxes (robotAxes *axes)
+  {
+    RobotStateSnapshot state;
+
+    if (!latest(state))
+    {
+      return CANON_FAILURE;
+    }
+    state.getAxes(*axes);
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::GetRobotForces (robotPose *forces)
+  {
+    RobotStateSnapshot state;
+
+    if (!latest(state))
+    {
+      return CANON_FAILURE;
+    }
+    *forces = state.forces;
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::GetRobotIO (robotIO *io)
+  {
+    RobotStateSnapshot state;
+
+    if (!latest(state))
+    {
+      return CANON_FAILURE;
+    }
+    state.getIO(*io);
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::GetRobotPose (robotPose *pose)
+  {
+    RobotStateSnapshot state;
+
+    if (!latest(state))
+    {
+      return CANON_FAILURE;
+    }
+    *pose = state.pose;
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::GetRobotSpeed (robotPose *speed)
+  {
+    RobotStateSnapshot state;
+
+    if (!latest(state))
+    {
+      return CANON_FAILURE;
+    }
+    *speed = state.speeds;
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::GetRobotSpeed (robotAxes *speed)
+  {
+    //! Joint speeds are not part of the recorded state
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::GetRobotTorques (robotAxes *torques)
+  {
+    RobotStateSnapshot state;
+
+    if (!latest(state))
+    {
+      return CANON_FAILURE;
+    }
+    torques->axes = state.axes;
+    for (int i = 0; i < state.axes; ++i)
+    {
+      torques->axis[i] = state.torque[i];
+    }
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::GetRobotState (RobotStateSnapshot *state)
+  {
+    return latest(*state) ? CANON_SUCCESS : CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::GetPredictedState (RobotStateSnapshot *state, double lead)
+  {
+    //! Not supported:  recorded states are replayed as they were
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::MoveAttractor (robotPose &pose)
+  {
+    //! Not supported
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::MoveToAxisTarget (robotAxes &axes, bool useBlocking)
+  {
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::BeginStream ()
+  {
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::StreamPose (robotPose &pose)
+  {
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::StreamAxes (robotAxes &axes)
+  {
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::EndStream ()
+  {
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::BeginWrenchStream ()
+  {
+    //! Not supported
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::StreamWrench (robotPose &wrench, const vector<bool> &activeAxes, robotPose &limits)
+  {
+    //! Not supported
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::EndWrenchStream ()
+  {
+    //! Not supported
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::SetAbsoluteAcceleration (double acceleration)
+  {
+    return (acceleration < 0.0) ? CANON_REJECT : CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::SetAbsoluteSpeed (double speed)
+  {
+    return (speed < 0.0) ? CANON_REJECT : CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::SetAngleUnits (const char *unitName)
+  {
+    //! States are replayed in the units they were recorded in
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::SetAxialSpeeds (double *speeds)
+  {
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::SetAxialUnits (const char **unitNames)
+  {
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::SetEndPoseTolerance (robotPose &tolerance)
+  {
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::SetIntermediatePoseTolerance (robotPose *tolerances)
+  {
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::SetLengthUnits (const char *unitName)
+  {
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::SetParameter (const char *paramName, void *paramVal)
+  {
+    double wait, until;
+
+    if (paramVal == NULL || strcmp(paramName, "replay_wait") != 0)
+    {
+      return CANON_REJECT;
+    }
+    wait = *((double*)paramVal);
+    if (wait < 0.0)
+    {
+      return CANON_REJECT;
+    }
+
+    until = ulapi_time() + wait;
+    while (!replay_.finished.load(std::memory_order_acquire) && ulapi_time() < until)
+    {
+      ulapi_sleep(0.001);
+    }
+    return replay_.finished.load(std::memory_order_acquire) ? CANON_SUCCESS : CANON_FAILURE;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::SetRelativeAcceleration (double percent)
+  {
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::SetTool (double percent)
+  {
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::SetRelativeSpeed (double percent)
+  {
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::SetRobotIO (robotIO &io)
+  {
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::SetRobotDO (int dig_out, bool val)
+  {
+    return (dig_out < 0 || dig_out >= CRPI_IO_MAX) ? CANON_REJECT : CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::StopMotion (int condition)
+  {
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::MoveBase (robotPose &to)
+  {
+    //! Not applicable
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::PointHead (robotPose &to)
+  {
+    //! Not applicable
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiReplay::PointAppendage (CanonRobotAppendage app_ID,
+                                                      robotPose &to)
+  {
+    //! Not applicable
+    return CANON_REJECT;
+  }
+} // crpi_robot
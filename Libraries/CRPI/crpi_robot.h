@@ -19,27 +19,119 @@
 #define crpi_robot_H
 
 #include <stddef.h>
+#include <deque>
+#include <new>
 
 #include "crpi.h"
 #include "crpi_xml.h"
 #include "crpi_robot_xml.h"
+#include "crpi_hub.h"
+#include "crpi_state_shm.h"
+#include "crpi_broadcast.h"
+#include "crpi_watchdog.h"
+#include "crpi_fusion.h"
+#include "crpi_waypoints.h"
+#include "crpi_iowatch.h"
+#include "crpi_otg.h"
+#include "crpi_servo.h"
 #include "vector.h"
+#if defined(_MSC_VER)
+#include "..\Math\RegistrationMap.h"
+#include "..\Math\PointCloud.h"
+#elif defined(__GNUC__)
+#include "../Math/RegistrationMap.h"
+#include "../Math/PointCloud.h"
+#endif
 
 using namespace std;
 using namespace Xml;
 using namespace Math;
 
+//! CrpiRobot is exported from the CRPI library, which instantiates it for each driver, unless
+//! CRPI_HEADER_ONLY is defined, in which case its definitions are compiled into the application
+//! (see crpi_robot_impl.h)
+#ifdef CRPI_HEADER_ONLY
+#define CRPI_ROBOT_API
+#else
+#define CRPI_ROBOT_API LIBRARY_API
+#endif
+
+//! Most coordinate systems mapped by the frame tracking task
+#define CRPI_FRAME_SUBSCRIPTIONS_MAX 8
+
+//! Default period (s) at which the frame tracking task looks for new states
+#define CRPI_FRAME_PERIOD 0.002
+
 namespace crpi_robot
 {
+  //! @brief Parts of the configuration reported by CrpiRobot::ReloadConfig
+  //!
+  typedef enum
+  {
+    CONFIG_TOOLS = 1,
+    CONFIG_SYSTEMS = 2,
+    CONFIG_WORLD = 4,
+    CONFIG_MOUNTING = 8,
+    CONFIG_LIMITS = 16,
+    CONFIG_WATCHDOG = 32,
+    CONFIG_CONNECTION = 64 //! Not applied until the robot is constructed again
+  } CrpiConfigPart;
+
+  //! @brief The robot's TCP pose mapped to the world and to the subscribed coordinate systems,
+  //!        computed once per published state by CrpiRobot::StartFrameTracking
+  //!
+  struct CrpiFramedState
+  {
+    //! @brief Pose in the robot's frame, as published, and in the world frame (valid only if
+    //!        world is set)
+    //!
+    robotPose pose;
+    robotPose world;
+    bool worldValid;
+
+    //! @brief Poses in the subscribed coordinate systems:  system[i] is in systems[i], and is
+    //!        valid only if systemValid[i] is set
+    //!
+    robotPose system[CRPI_FRAME_SUBSCRIPTIONS_MAX];
+    FrameHandle systems[CRPI_FRAME_SUBSCRIPTIONS_MAX];
+    bool systemValid[CRPI_FRAME_SUBSCRIPTIONS_MAX];
+    int count;
+
+    //! @brief RobotStateSnapshot::sequence and timestamp of the state the poses are from
+    //!
+    unsigned long sequence;
+    double timestamp;
+
+    //! @brief Default constructor
+    //!
+    CrpiFramedState ()
+    {
+      for (int i = 0; i < CRPI_FRAME_SUBSCRIPTIONS_MAX; ++i)
+      {
+        systems[i] = CRPI_NO_HANDLE;
+        systemValid[i] = false;
+      }
+      worldValid = false;
+      count = 0;
+      sequence = 0;
+      timestamp = 0.0;
+    }
+  };
 
   //! @ingroup Robot
   //!
   //! @brief Common template interface for the various robot subtypes
   //!
-  template <class T> class LIBRARY_API CrpiRobot
+  template <class T> class CRPI_ROBOT_API CrpiRobot
   {
   public:
 
+    //! @brief Number of axes of the robot (0 if it is only known at run time), and the axis
+    //!        type sized to it:  robotAxesN<Axes>, or robotAxes for robots of no fixed size
+    //!
+    static constexpr int Axes = CrpiAxisCount<T>::value;
+    typedef typename std::conditional<(Axes > 0), robotAxesN<((Axes > 0) ? Axes : 1)>, robotAxes>::type AxesType;
+
     //! @brief Default constructor
     //!
     //! @param initPath Path to the file containing the robot's initialization parameters
@@ -64,8 +156,8 @@ namespace crpi_robot
     //!         not accepted, and FAILURE if the command is accepted but not executed successfully
     //!
     CanonReturn ApplyCartesianForceTorque (robotPose &robotForceTorque,
-                                           vector<bool> activeAxes,
-                                           vector<bool> manipulator);
+                                           const vector<bool> &activeAxes,
+                                           const vector<bool> &manipulator);
 
     //! @brief Apply joint torques
     //!
@@ -85,6 +177,24 @@ namespace crpi_robot
     //!
     CanonReturn Couple (const char *targetID);
 
+    //! @brief Look up a tool defined in the robot's configuration, for use with Couple
+    //!
+    //! @param name The name of the tool
+    //!
+    //! @return The tool's handle, or CRPI_NO_HANDLE if the robot has no such tool
+    //!
+    ToolHandle LookupTool (const char *name);
+
+    //! @brief Dock with a tool previously looked up with LookupTool
+    //!
+    //! @param tool The handle of the tool
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted (e.g., an invalid handle), and FAILURE if the command is accepted but not
+    //!         executed successfully
+    //!
+    CanonReturn Couple (ToolHandle tool);
+
     //! @brief Get feedback from the robot regarding its current axis configuration
     //!
     //! @param axes Axis array to be populated by the method
@@ -148,6 +258,234 @@ namespace crpi_robot
     //!
     CanonReturn GetRobotTorques (robotAxes *torques);
 
+    //! @brief Get a consistent snapshot of the robot's latest state without waiting on the
+    //!        robot's feedback connection
+    //!
+    //! @param state Snapshot to be populated by the method
+    //!
+    //! @return SUCCESS if a state has been published by the driver, REJECT if no state is
+    //!         available yet or the robot does not publish state snapshots
+    //!
+    CanonReturn GetRobotState (RobotStateSnapshot *state);
+
+    //! @brief Get the robot's latest state extrapolated from its speeds to compensate for its
+    //!        age, for loops (visual servoing, tracking) that would otherwise act on feedback
+    //!        that is already several milliseconds old.  GetRobotState and the other Get*
+    //!        methods are unaffected.
+    //!
+    //! @param state Snapshot to be populated by the method, as by GetRobotState; its timestamp is
+    //!              the time predicted for
+    //! @param lead  Seconds past the current time (ulapi_time) to predict for; 0 for now
+    //!
+    //! @return SUCCESS if a state has been published by the driver, REJECT if no state is
+    //!         available yet or the driver cannot predict it
+    //!
+    CanonReturn GetPredictedState (RobotStateSnapshot *state, double lead = 0.0);
+
+    //! @brief Mirror the robot's state (as returned by GetRobotState) into a shared memory
+    //!        segment, so that other processes on this computer (HMIs, loggers, planners) can
+    //!        read it with a CrpiStateReader instead of connecting to the robot themselves.  New
+    //!        states are copied by a task on the SensorHub timer thread.
+    //!
+    //! @param key    Shared memory key of the segment (readers use the same key)
+    //! @param robot  Label for readers (e.g., the robot's name; NULL for none)
+    //! @param period Seconds between checks for a new state
+    //!
+    //! @return SUCCESS if publishing started, REJECT if already publishing (or bypassed),
+    //!         FAILURE if the segment could not be created
+    //!
+    //! @note Readers of a robot that does not publish state snapshots see a published segment
+    //!       with a Count of 0
+    //!
+    CanonReturn PublishState (ulapi_id key, const char *robot = NULL, double period = HUB_TICK);
+
+    //! @brief Stop mirroring the robot's state (readers then see the segment as unpublished)
+    //!
+    void StopPublishing ();
+
+    //! @brief Multicast the robot's state (as returned by GetRobotState) to the plant network,
+    //!        so that dashboards and loggers can follow it with a CrpiStateListener instead of
+    //!        connecting to the driver (see crpi_broadcast.h).  States are sent by a task on the
+    //!        SensorHub timer thread.  Started by the constructor when the robot XML has a
+    //!        <Broadcast> tag.
+    //!
+    //! @param params Port, group, rate, and label of the broadcast; the label defaults to the
+    //!               robot's address
+    //!
+    //! @return SUCCESS if the broadcast started, REJECT if one is already running (or bypassed,
+    //!         or params is not enabled), FAILURE if the socket could not be opened
+    //!
+    //! @note Only for drivers that publish state snapshots; nothing is sent for any other robot
+    //!
+    CanonReturn BroadcastState (const CrpiBroadcastParams &params);
+
+    //! @brief Stop broadcasting the robot's state
+    //!
+    void StopBroadcasting ();
+
+    //! @brief Watch the age and jitter of the robot's state (as returned by GetRobotState) from
+    //!        a task on the SensorHub timer thread, warning, slowing the robot down, or
+    //!        stopping it as the thresholds are crossed (see crpi_watchdog.h).  Started by the
+    //!        constructor when the robot XML has a <Watchdog> tag.
+    //!
+    //! @param params Thresholds and check period
+    //!
+    //! @return SUCCESS if the watchdog started, REJECT if one is already running (or bypassed)
+    //!
+    //! @note Only for drivers that publish state snapshots; the state of any other robot is
+    //!       always stale.  The policies' SetRelativeSpeed and StopMotion calls are made from
+    //!       the timer thread, concurrently with the application's commands.
+    //!
+    CanonReturn StartWatchdog (const CrpiWatchdogParams &params);
+
+    //! @brief Stop watching the robot's state.  A slowed robot is put back to the commanded
+    //!        speed.
+    //!
+    void StopWatchdog ();
+
+    //! @brief The watchdog's current level (WATCHDOG_OK when no watchdog is running)
+    //!
+    CrpiWatchdogLevel WatchdogLevel () const;
+
+    //! @brief Fuse the robot's TCP feedback with motion capture (see crpi_fusion.h).  A task on
+    //!        the SensorHub timer thread maps each new state's pose to the world with ToWorld
+    //!        and adds it to the estimate; FuseMoCap adds the motion capture frames.
+    //!
+    //! @param params Noise, latency, and sampling settings
+    //!
+    //! @return SUCCESS if fusion started, REJECT if it is already running (or bypassed)
+    //!
+    //! @note Only for drivers that publish state snapshots.  The robot-to-world transform is
+    //!       used from the timer thread, so it should not be changed while fusion runs.
+    //!
+    CanonReturn StartFusion (const CrpiFusionParams &params = CrpiFusionParams());
+
+    //! @brief Stop fusing and drop the estimate
+    //!
+    void StopFusion ();
+
+    //! @brief Add a motion capture frame of the TCP to the fused estimate
+    //!
+    //! @param position  TCP position in the world frame (mm), e.g., a MoCapSubject's position
+    //!                  with the marker-to-TCP offset applied
+    //! @param rotation  TCP orientation in the world frame (3x3 rotation matrix)
+    //! @param timestamp Time the frame was received (s, ulapi_time); frames may arrive late and
+    //!                  out of order
+    //!
+    //! @return SUCCESS if the frame was used, REJECT if fusion is not running or the frame is
+    //!         older than the fusion history
+    //!
+    CanonReturn FuseMoCap (const Math::point &position, const Math::matrix &rotation, double timestamp);
+
+    //! @brief The robot's state with the fused TCP pose in place of the reported one
+    //!
+    //! @param state Snapshot to be populated, as by GetRobotState; its pose is the fused pose,
+    //!              mapped back to the robot's frame with FromWorld and extrapolated to, and
+    //!              timestamped with, the current time plus lead
+    //! @param lead  Seconds past the current time (ulapi_time) to predict for
+    //!
+    //! @return SUCCESS if a fused pose is available, REJECT if fusion is not running or has no
+    //!         measurements yet, FAILURE if the pose could not be mapped to the robot's frame
+    //!
+    CanonReturn GetFusedState (RobotStateSnapshot *state, double lead = 0.0);
+
+    //! @brief Map each new state's TCP pose to the world, and to the coordinate systems given to
+    //!        SubscribeSystem, from a task on the SensorHub timer thread.  Each published state
+    //!        is transformed once, however many readers ask for it with GetRobotPoseWorld,
+    //!        GetRobotPoseSystem, or GetFramedState.
+    //!
+    //! @param period Seconds between checks for a new state
+    //!
+    //! @return SUCCESS if tracking started, REJECT if it is already running (or bypassed)
+    //!
+    //! @note Only for drivers that publish state snapshots.  As with StartFusion, the transforms
+    //!       are used from the timer thread, so they should not be changed while tracking runs.
+    //!
+    CanonReturn StartFrameTracking (double period = CRPI_FRAME_PERIOD);
+
+    //! @brief Stop mapping the robot's states (the getters go back to transforming on each call)
+    //!
+    void StopFrameTracking ();
+
+    //! @brief Add a coordinate system to those each new state is mapped to
+    //!
+    //! @param system Handle from LookupSystem
+    //!
+    //! @return SUCCESS if the system is (or already was) subscribed, REJECT if the handle is not
+    //!         valid or CRPI_FRAME_SUBSCRIPTIONS_MAX systems are already subscribed
+    //!
+    CanonReturn SubscribeSystem (FrameHandle system);
+
+    //! @brief Stop mapping new states to a coordinate system
+    //!
+    //! @return SUCCESS if the system was subscribed, REJECT otherwise
+    //!
+    CanonReturn UnsubscribeSystem (FrameHandle system);
+
+    //! @brief Get the robot's TCP pose in the world frame:  the tracked pose of the latest state
+    //!        when frame tracking runs, otherwise GetRobotPose followed by ToWorld
+    //!
+    //! @param pose Pose to be populated by the method
+    //!
+    //! @return SUCCESS if the pose was available and mapped, FAILURE otherwise
+    //!
+    CanonReturn GetRobotPoseWorld (robotPose *pose);
+
+    //! @brief Get the robot's TCP pose in a coordinate system:  the tracked pose of the latest
+    //!        state when the system is subscribed and frame tracking runs, otherwise GetRobotPose
+    //!        followed by ToSystem
+    //!
+    //! @param system Handle from LookupSystem
+    //! @param pose   Pose to be populated by the method
+    //!
+    //! @return SUCCESS if the pose was available and mapped, FAILURE otherwise
+    //!
+    CanonReturn GetRobotPoseSystem (FrameHandle system, robotPose *pose);
+
+    //! @brief Get every tracked pose of the latest state at once
+    //!
+    //! @param state Poses to be populated by the method
+    //!
+    //! @return SUCCESS if a state has been tracked, REJECT if frame tracking is not running or
+    //!         no state has been published since it started
+    //!
+    CanonReturn GetFramedState (CrpiFramedState *state);
+
+    //! @brief Run a callback when a digital input rises or falls, or an analog input crosses a
+    //!        threshold.  Each new state snapshot from the driver is compared with the last.
+    //!
+    //! @param dig_in / ana_in Input channel to watch
+    //! @param threshold       Analog level whose crossing is reported
+    //! @param edges           Edges that run the callback (CrpiIOEdge)
+    //! @param callback        Run from the SensorHub; it must not add or remove watches, or wait
+    //!
+    //! @return An identifier for Unwatch, or -1 if the channel is out of range (or bypassed)
+    //!
+    int WatchDI (int dig_in, int edges, CrpiIOCallback callback);
+    int WatchAI (int ana_in, double threshold, int edges, CrpiIOCallback callback);
+
+    //! @brief Remove a callback added by WatchDI or WatchAI
+    //!
+    void Unwatch (int id);
+
+    //! @brief Wait until a digital input has a value, or an analog input is past a threshold,
+    //!        without polling GetRobotIO.  The wait ends within one feedback cycle of the change.
+    //!
+    //! @param dig_in / ana_in Input channel
+    //! @param val             The digital value to wait for
+    //! @param threshold       The analog level to wait for the input to pass
+    //! @param above           Whether to wait for the input to be above (true) or below the level
+    //! @param timeout         Seconds to wait
+    //!
+    //! @return SUCCESS if the input has the value, REJECT if the channel is out of range, and
+    //!         FAILURE on timeout
+    //!
+    //! @note Only for drivers whose state snapshots carry I/O (UR, ABB, KUKA LWR, and the
+    //!       simulator).
+    //!
+    CanonReturn WaitForDI (int dig_in, bool val, double timeout);
+    CanonReturn WaitForAI (int ana_in, double threshold, bool above, double timeout);
+
     //! @brief Display a message on the operator console
     //!
     //! @param message The plain-text message to be displayed on the operator console
@@ -222,6 +560,101 @@ namespace crpi_robot
     //!
     CanonReturn MoveToAxisTarget (robotAxes &axes, bool useBlocking = true);
 
+    //! @brief Start streaming motion setpoints to the robot at the controller's native rate
+    //!
+    //! @return SUCCESS if the robot is ready to accept setpoints, REJECT if streaming is not
+    //!         supported, and FAILURE if the stream could not be started
+    //!
+    //! @note Servo timing is configured with SetParameter before the stream is started:
+    //!       "stream_period" (s), "stream_lookahead" (s), "stream_gain", and "stream_deadline" (s,
+    //!       the robot stops if no setpoint arrives within this time).  Not all robots use all of
+    //!       them.  Setting "stream_smoothing" (bool) makes CRPI pass every setpoint through a
+    //!       jerk-limited CrpiOnlineTrajectory, with the <JointLimit> and <CartesianLimit> limits
+    //!       of the configuration, stepped once per call at the "stream_period", so that the
+    //!       application may send targets that jump.  Setting "stream_servo" (bool) runs the
+    //!       stream from a CrpiServo task at the "stream_period", with the <RealTime> scheduling
+    //!       of the configuration:  StreamPose and StreamAxes only queue the setpoint, and the
+    //!       task sends the newest one (smoothed, if set) on each of its deadlines.
+    //!       "stream_servo_key" (int) puts the task's rings in ulapi_rtm memory under that key.
+    //!
+    CanonReturn BeginStream ();
+
+    //! @brief Send the next Cartesian setpoint of an active stream without waiting for the motion
+    //!
+    //! @param pose The 6DOF setpoint for the robot's TCP in Cartesian space coordinates
+    //!
+    //! @return SUCCESS if the setpoint was sent, REJECT if no stream is active, and FAILURE if the
+    //!         setpoint could not be sent
+    //!
+    CanonReturn StreamPose (robotPose &pose);
+
+    //! @brief Send the next joint setpoint of an active stream without waiting for the motion
+    //!
+    //! @param axes Target axis values specified in the current axial unit
+    //!
+    //! @return SUCCESS if the setpoint was sent, REJECT if no stream is active, and FAILURE if the
+    //!         setpoint could not be sent
+    //!
+    CanonReturn StreamAxes (robotAxes &axes);
+
+    //! @brief Stop an active stream and bring the robot to rest
+    //!
+    //! @return SUCCESS if the stream was stopped, REJECT if no stream is active, and FAILURE if the
+    //!         robot could not be stopped
+    //!
+    CanonReturn EndStream ();
+
+    //! @brief Get the outcome of the oldest servo cycle not yet taken, when streaming with
+    //!        "stream_servo" (and after the stream, until the next BeginStream)
+    //!
+    //! @param feedback Cycle outcome to be populated by the method
+    //!
+    //! @return SUCCESS if an outcome was waiting, REJECT otherwise
+    //!
+    CanonReturn GetServoFeedback (CrpiServoFeedback *feedback);
+
+    //! @brief Get the timing of the servo task of the current (or last) "stream_servo" stream
+    //!
+    //! @param stats Timing to be populated by the method
+    //!
+    //! @return SUCCESS if a servo task has run, REJECT otherwise
+    //!
+    CanonReturn GetServoStats (CrpiServoStats *stats);
+
+    //! @brief Start streaming Cartesian force/torque targets to a force controller that stays
+    //!        running on the robot, so each update needs no new program
+    //!
+    //! @return SUCCESS if the robot is ready to accept wrench targets, REJECT if force streaming
+    //!         is not supported or a stream is already active, and FAILURE if the stream could
+    //!         not be started
+    //!
+    //! @note The robot holds its position (no axes selected) until the first StreamWrench.  The
+    //!       "stream_period" and "stream_deadline" settings of BeginStream also apply.
+    //!
+    CanonReturn BeginWrenchStream ();
+
+    //! @brief Send the next force/torque target of an active wrench stream without waiting for
+    //!        the robot to respond
+    //!
+    //! @param wrench     Target forces (N) along and torques (N m) about the tool axes
+    //! @param activeAxes Which tool axes (x, y, z, xrot, yrot, zrot) are force controlled; the
+    //!                   others hold position.  TRUE = ACTIVE, FALSE = INACTIVE
+    //! @param limits     For active axes, the largest TCP speed along or about the axis (length or
+    //!                   angle units per second); for the others, the largest deviation from the
+    //!                   held position (length or angle units)
+    //!
+    //! @return SUCCESS if the target was sent, REJECT if no wrench stream is active, and FAILURE
+    //!         if the target could not be sent
+    //!
+    CanonReturn StreamWrench (robotPose &wrench, const vector<bool> &activeAxes, robotPose &limits);
+
+    //! @brief Stop an active wrench stream, leave force control, and bring the robot to rest
+    //!
+    //! @return SUCCESS if the stream was stopped, REJECT if no wrench stream is active, and
+    //!         FAILURE if the robot could not be stopped
+    //!
+    CanonReturn EndWrenchStream ();
+
     //! @brief Set the accerlation for the controlled pose to the given value in length units per
     //!        second per second
     //!
@@ -344,8 +777,42 @@ namespace crpi_robot
     //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
     //!         not accepted, and FAILURE if the command is accepted but not executed successfully
     //!
+    //! @note With the "io_coalesce" setting (s, set with SetParameter; 0, the default, turns it
+    //!       off), the output is staged instead, and every output staged within the window is
+    //!       written in one SetRobotIO when it closes (or before the next motion command).  The
+    //!       return value then only reports whether the output was staged.
+    //!
     CanonReturn SetRobotDO (int dig_out, bool val);
 
+    //! @brief Open an I/O transaction.  Outputs set with SetDO and SetAO are staged, and written
+    //!        together in one SetRobotIO (one message on most controllers) by CommitIO.
+    //!
+    //! @return SUCCESS if the transaction was opened, REJECT if one is already open
+    //!
+    CanonReturn BeginIO ();
+
+    //! @brief Stage a digital or analog output in the open transaction.  Without one, the output
+    //!        is coalesced (see SetRobotDO) or written at once.
+    //!
+    //! @param dig_out / ana_out Output channel to set
+    //! @param val               Value to set the output
+    //!
+    //! @return SUCCESS if the output was staged (or written), REJECT if the channel is out of
+    //!         range, and FAILURE if it was written and the write failed
+    //!
+    CanonReturn SetDO (int dig_out, bool val);
+    CanonReturn SetAO (int ana_out, double val);
+
+    //! @brief Write the outputs staged since BeginIO and close the transaction
+    //!
+    //! @return The result of the write (SUCCESS if nothing was staged), or REJECT if no
+    //!         transaction is open
+    //!
+    //! @note Outputs that have not been written through this object are written as off, as with
+    //!       SetRobotIO.
+    //!
+    CanonReturn CommitIO ();
+
     //! @brief Set the attached tool to a defined output rate.
     //!
     //! @param percent The desired output rate for the robot's tool as a percentage of maximum output.
@@ -384,12 +851,23 @@ namespace crpi_robot
     //!
     CanonReturn CrclXmlResponse (char *str);
 
+    //! @brief Generate a status message for a CRCL client in a reusable writer
+    //!
+    //! @param out Writer receiving the response CRCL XML message.  Its data and size can be
+    //!            passed to the socket directly.
+    //!
+    //! @return SUCCESS if the response was encoded, FAILURE otherwise
+    //!
+    CanonReturn CrclXmlResponse (CrpiXmlWriter &out);
+
     //! @brief Convert CRPI XML to CRPI function calls
     //!
-    //! @param str CRPI XML string to be interpreted as a function call
+    //! @param str CRPI XML string holding one or more CRPICommand elements, run in order
     //!
-    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
-    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //! @return SUCCESS if every command is accepted and is executed successfully, otherwise the
+    //!         result of the first command that is not:  REJECT if the command is not accepted,
+    //!         and FAILURE if the command is accepted but not executed successfully.  Commands
+    //!         after it are not run.
     //!
     CanonReturn CrpiXmlHandler (std::string &str);
 
@@ -402,6 +880,114 @@ namespace crpi_robot
     //!
     CanonReturn CrpiXmlResponse (char *str);
 
+    //! @brief Generate a status message for a CRPI XML client in a reusable writer
+    //!
+    //! @param out Writer receiving the response CRPI XML message.  Its data and size can be
+    //!            passed to the socket directly.
+    //!
+    //! @return SUCCESS if the response was encoded, FAILURE otherwise
+    //!
+    CanonReturn CrpiXmlResponse (CrpiXmlWriter &out);
+
+    //! @brief Decode a binary command frame and execute it through the same dispatcher as
+    //!        CrpiXmlHandler
+    //!
+    //! @param buf Start of one complete binary frame (see CrpiBinary::frameLength)
+    //! @param len Length of the frame in bytes
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn CrpiBinaryHandler (const char *buf, size_t len);
+
+    //! @brief Generate a binary status frame for a binary protocol client
+    //!
+    //! @param buf Output buffer for the response frame
+    //! @param max Capacity of buf in bytes
+    //! @param len Length of the encoded response frame
+    //!
+    //! @return SUCCESS if the response was encoded, FAILURE if buf is too small
+    //!
+    CanonReturn CrpiBinaryResponse (char *buf, size_t max, size_t &len);
+
+    //! @brief Compile a CRCL or CRPI program into a list of commands that can be run without
+    //!        further XML parsing
+    //!
+    //! @param xml        The program text (a CRCLProgram, or a root element holding CRPICommand
+    //!                   elements)
+    //! @param program    The compiled program
+    //! @param worldFrame Whether the program's poses are given in world coordinates.  If so, they
+    //!                   are projected into the robot's coordinate frame here, once, instead of at
+    //!                   every move.
+    //!
+    //! @return SUCCESS if the program was compiled, REJECT if it could not be parsed, and FAILURE
+    //!         if its poses could not be converted
+    //!
+    CanonReturn LoadProgram (const std::string &xml, CrpiCompiledProgram &program, bool worldFrame = false);
+
+    //! @brief Execute a compiled program, starting from its next step
+    //!
+    //! @param program The program to run.  Runs of up to CRPI_PROGRAM_LOOKAHEAD consecutive moves
+    //!                of the same type are sent to the robot as one MoveThroughTo.
+    //!
+    //! @return SUCCESS if every step succeeded.  Otherwise the result of the first step that did
+    //!         not succeed, with program.next left at that step so the program can be resumed.
+    //!
+    CanonReturn RunProgram (CrpiCompiledProgram &program);
+
+    //! @brief Translate a compiled program, from its next step, into the controller's own language
+    //!        (see crpiNativeProgram)
+    //!
+    //! @param program The program to translate
+    //! @param text    The translated program (URScript, a RAPID module, or a KRL program)
+    //!
+    //! @return SUCCESS if the program was translated, REJECT if the robot cannot translate it
+    //!         or one of its steps
+    //!
+    CanonReturn CompileNative (CrpiCompiledProgram &program, std::string &text);
+
+    //! @brief Execute a compiled program, from its next step, as one program uploaded to and run
+    //!        by the controller.  The controller reports the steps it has finished through the
+    //!        robot's state channel; the command ID reported by the robot follows them.
+    //!
+    //! @param program The program to run
+    //!
+    //! @return SUCCESS if the whole program ran, REJECT if the robot cannot run native programs
+    //!         or translate this one, and FAILURE otherwise, with program.next left at the first
+    //!         step the controller did not finish so the program can be resumed
+    //!
+    CanonReturn RunNative (CrpiCompiledProgram &program);
+
+    //! @brief Queue a command on this robot's command thread and return without waiting for it
+    //!
+    //! @return A handle that reports the command's result when it finishes.  Cancelling it stops
+    //!         the robot (StopMotion) if the command has already started.
+    //!
+    //! @note Commands queued on one robot run in order, one at a time, with the same arguments
+    //!       and blocking behaviour as their synchronous versions.  Commands on different robots
+    //!       run in parallel; use crpi_wait_all or crpi_wait_any to join them.
+    //! @note Arguments are copied when the command is queued.
+    //!
+    CrpiCompletion MoveToAsync (robotPose &pose);
+    CrpiCompletion MoveStraightToAsync (robotPose &pose);
+    CrpiCompletion MoveToAxisTargetAsync (robotAxes &axes);
+    CrpiCompletion MoveThroughToAsync (robotPose *poses,
+                                       int numPoses,
+                                       robotPose *accelerations = NULL,
+                                       robotPose *speeds = NULL,
+                                       robotPose *tolerances = NULL);
+    CrpiCompletion SetToolAsync (double percent);
+    CrpiCompletion SetRobotIOAsync (robotIO &io);
+    CrpiCompletion SetRobotDOAsync (int dig_out, bool val);
+
+    //! @brief Queue an arbitrary command on this robot's command thread (see MoveToAsync)
+    //!
+    //! @param command The command to run, usually one or more blocking calls on this robot
+    //!
+    //! @return The command's completion handle
+    //!
+    CrpiCompletion CallAsync (std::function<CanonReturn ()> command);
+
     //! @brief Populates a reference to a matrix object with the transformation matrix from robot to world
     //!
     //! @param R_T_W Matrix object representing the transformation from the robot coordinate system to
@@ -465,6 +1051,112 @@ namespace crpi_robot
     //!
     CanonReturn FromSystem(const char *name, robotPose *in, robotPose *out);
 
+    //! @brief Look up a coordinate system of the robot, so that repeated conversions need not
+    //!        search for it by name
+    //!
+    //! @param name The name of the coordinate system
+    //!
+    //! @return The system's handle, or CRPI_NO_HANDLE if the robot has no such system
+    //!
+    //! @note Handles stay valid for the life of the robot:  systems added by UpdateSystemTransform
+    //!       get new handles, and never change those of existing systems
+    //!
+    FrameHandle LookupSystem (const char *name);
+
+    //! @brief ToSystem and FromSystem for a coordinate system previously looked up with
+    //!        LookupSystem
+    //!
+    CanonReturn ToSystem (FrameHandle system, robotPose *in, robotPose *out);
+    CanonReturn FromSystem (FrameHandle system, robotPose *in, robotPose *out);
+
+    //! @brief Project a batch of robot poses into world coordinates
+    //!
+    //! @param in    The poses in the robot's coordinate frame
+    //! @param out   The poses in the world coordinate frame (may be the same array as in)
+    //! @param count The number of poses in in and out
+    //!
+    //! @return SUCCESS if all poses were converted, FAILURE otherwise
+    //!
+    //! @note The composed transform is cached until UpdateWorldTransform is called
+    //!
+    CanonReturn ToWorldBatch (const robotPose *in, robotPose *out, size_t count);
+
+    //! @brief Project a batch of world coordinate frame poses into the robot's coordinate frame
+    //!
+    //! @param in    The poses in the world coordinate frame
+    //! @param out   The poses in the robot's base coordinate frame (may be the same array as in)
+    //! @param count The number of poses in in and out
+    //!
+    //! @return SUCCESS if all poses were converted, FAILURE otherwise
+    //!
+    CanonReturn FromWorldBatch (const robotPose *in, robotPose *out, size_t count);
+
+    //! @brief Project a batch of points (no orientation) from the robot's frame into world coordinates
+    //!
+    //! @param in    The points in the robot's coordinate frame
+    //! @param out   The points in the world coordinate frame (may be the same array as in)
+    //! @param count The number of points in in and out
+    //!
+    //! @return SUCCESS if the transform is valid, FAILURE otherwise
+    //!
+    CanonReturn ToWorldPoints (const Math::point *in, Math::point *out, size_t count);
+
+    //! @brief Project a batch of points (no orientation) from world coordinates into the robot's frame
+    //!
+    //! @param in    The points in the world coordinate frame
+    //! @param out   The points in the robot's base coordinate frame (may be the same array as in)
+    //! @param count The number of points in in and out
+    //!
+    //! @return SUCCESS if the transform is valid, FAILURE otherwise
+    //!
+    CanonReturn FromWorldPoints (const Math::point *in, Math::point *out, size_t count);
+
+    //! @brief As ToWorldPoints above, for points stored as coordinate arrays
+    //!
+    //! @param in  The points in the robot's coordinate frame
+    //! @param out Resized to and populated with the points in the world coordinate frame (may be
+    //!            the cloud viewed by in)
+    //!
+    //! @return SUCCESS if the transform is valid, FAILURE otherwise
+    //!
+    CanonReturn ToWorldPoints (const Math::PointCloudView &in, Math::PointCloud &out);
+
+    //! @brief As FromWorldPoints above, for points stored as coordinate arrays
+    //!
+    //! @return SUCCESS if the transform is valid, FAILURE otherwise
+    //!
+    CanonReturn FromWorldPoints (const Math::PointCloudView &in, Math::PointCloud &out);
+
+    //! @brief Project a batch of robot poses into a specified coordinate system's coordinates
+    //!
+    //! @param name  The name of the specified coordinate system
+    //! @param in    The poses in the robot's coordinate frame
+    //! @param out   The poses in the specified coordinate system (may be the same array as in)
+    //! @param count The number of poses in in and out
+    //!
+    //! @return SUCCESS if all poses were converted, FAILURE otherwise
+    //!
+    //! @note The composed transforms are cached until UpdateSystemTransform is called
+    //!
+    CanonReturn ToSystemBatch (const char *name, const robotPose *in, robotPose *out, size_t count);
+
+    //! @brief Project a batch of poses from a specified coordinate system into the robot's coordinate frame
+    //!
+    //! @param name  The name of the specified coordinate system
+    //! @param in    The poses in the specified coordinate system
+    //! @param out   The poses in the robot's base coordinate frame (may be the same array as in)
+    //! @param count The number of poses in in and out
+    //!
+    //! @return SUCCESS if all poses were converted, FAILURE otherwise
+    //!
+    CanonReturn FromSystemBatch (const char *name, const robotPose *in, robotPose *out, size_t count);
+
+    //! @brief ToSystemBatch and FromSystemBatch for a coordinate system previously looked up with
+    //!        LookupSystem
+    //!
+    CanonReturn ToSystemBatch (FrameHandle system, const robotPose *in, robotPose *out, size_t count);
+    CanonReturn FromSystemBatch (FrameHandle system, const robotPose *in, robotPose *out, size_t count);
+
     //! @brief Overwrite the transformation from the robot's coordinate frame to the world coordinate frame
     //!
     //! @param newToSystem The updated transformation from robot to world
@@ -483,6 +1175,19 @@ namespace crpi_robot
     //!
     CanonReturn UpdateWorldTransform (matrix &newToSystem);
 
+    //! @brief Use precompiled, spatially varying registrations (see Math::RegistrationMap) in
+    //!        place of the rigid world transform
+    //!
+    //! @param toWorld   Map file used by ToWorld and its batch forms, indexed by position in the
+    //!                  robot's frame (NULL to use the rigid transform)
+    //! @param fromWorld Map file used by FromWorld and its batch forms, indexed by position in
+    //!                  the world frame (NULL to use the rigid transform)
+    //!
+    //! @return SUCCESS if every named file was loaded, FAILURE otherwise (a map that could not
+    //!         be loaded falls back to the rigid transform)
+    //!
+    CanonReturn LoadWorldMaps (const char *toWorld, const char *fromWorld);
+
     //! @brief Overwrite the transformation from the robot's coordinate frame to a specified coordinate system
     //!
     //! @param newToWorld The updated transformation from robot to world
@@ -508,6 +1213,56 @@ namespace crpi_robot
     //!
     CanonReturn UpdateSystemTransform(const char *name, matrix &newToWorld);
 
+    //! @brief UpdateSystemTransform for an existing coordinate system previously looked up with
+    //!        LookupSystem
+    //!
+    //! @return REJECT for an invalid handle, and otherwise as for the named forms
+    //!
+    CanonReturn UpdateSystemTransform (FrameHandle system, robotPose &newToWorld);
+    CanonReturn UpdateSystemTransform (FrameHandle system, matrix &newToWorld);
+
+    //! @brief Add the named waypoints of an XML or binary waypoint file (see crpi_waypoints.h)
+    //!
+    //! @param path The waypoint file
+    //!
+    //! @return SUCCESS if the file was read, FAILURE otherwise
+    //!
+    CanonReturn LoadWaypoints (const char *path);
+
+    //! @brief The robot's waypoint table, to add waypoints to or save
+    //!
+    CrpiWaypoints &Waypoints ();
+
+    //! @brief Look up a waypoint, so that repeated uses need not search for it by name
+    //!
+    //! @return The waypoint's handle, or CRPI_NO_HANDLE if there is no such waypoint
+    //!
+    WaypointHandle LookupWaypoint (const char *name);
+
+    //! @brief Get a waypoint in the robot's base frame, converted from the frame it was given in
+    //!
+    //! @param wp   The waypoint's handle
+    //! @param pose Populated with the waypoint in the robot's coordinate frame
+    //!
+    //! @return SUCCESS if the pose was found, REJECT for an unknown waypoint or frame, and
+    //!         FAILURE if the frame's transform could not be applied
+    //!
+    //! @note The converted table of each frame is cached until its transform is updated
+    //!
+    CanonReturn GetWaypoint (WaypointHandle wp, robotPose &pose);
+
+    //! @brief Get a waypoint in the robot's base frame, taking it as given in a specified frame
+    //!
+    //! @param wp     The waypoint's handle
+    //! @param system CRPI_FRAME_ROBOT, CRPI_FRAME_WORLD, or a handle from LookupSystem
+    //! @param pose   Populated with the waypoint in the robot's coordinate frame
+    //!
+    CanonReturn GetWaypoint (WaypointHandle wp, FrameHandle system, robotPose &pose);
+
+    //! @brief GetWaypoint by name
+    //!
+    CanonReturn GetWaypoint (const char *name, robotPose &pose);
+
     //! @brief Save the robot configuration parameters to disk
     //!
     //! @param file The destination location for the new configuration file
@@ -517,6 +1272,22 @@ namespace crpi_robot
     //!
     CanonReturn SaveConfig (const char *file);
 
+    //! @brief Re-read the robot configuration and apply what changed without reconnecting
+    //!
+    //! @param path    The configuration file (normally the one the robot was constructed with)
+    //! @param changed Populated with the parts that differed (CrpiConfigPart flags), or NULL
+    //!
+    //! @return SUCCESS if the file was read and its changes applied, FAILURE if it could not be
+    //!         read (nothing is changed)
+    //!
+    //! @note Tools, coordinate systems, the world transform, the mounting, joint limits, and the
+    //!       watchdog are replaced; the docked tool is coupled again if its definition changed.
+    //!       Connection settings are only reported, since the connections stay open.  Call it
+    //!       from the thread that commands the robot.  ToolHandles, and FrameHandles if systems
+    //!       were added, removed, or reordered, must be looked up again.
+    //!
+    CanonReturn ReloadConfig (const char *path, unsigned int *changed = NULL);
+
     //! @brief Calculate a pose to point the end effector toward the pose specified
     //!
     //! @param to  Target location that the robot is to point toward
@@ -584,6 +1355,10 @@ namespace crpi_robot
     //!
     CrpiXml *crpixml_;
 
+    //! @brief Handler for interpreting binary protocol frames as C++ function calls
+    //!
+    CrpiBinary *crpibin_;
+
     //! @brief Variables used (and abused) throughout the CrpiRobot class for rotation representation
     //!        conversions.  Added here for memory efficiency.
     matrix *rotMatrix_;
@@ -591,6 +1366,29 @@ namespace crpi_robot
     vector3D *v2_;
     vector3D *v3_;
 
+    //! @brief Storage for the objects above and the world maps, allocated in one block at
+    //!        construction.  What every command and feedback call touches (the command
+    //!        parameters, the rotation scratch, and the driver) comes first, each group starting
+    //!        a cache line; the configuration and the command decoders follow.
+    //!
+    struct arena
+    {
+      alignas(CRPI_CACHE_LINE) typename std::aligned_storage<sizeof(CrpiXmlParams), alignof(CrpiXmlParams)>::type crpiparams;
+      typename std::aligned_storage<sizeof(matrix), alignof(matrix)>::type rotMatrix;
+      typename std::aligned_storage<sizeof(vector3D), alignof(vector3D)>::type vectors[3];
+      alignas(CRPI_CACHE_LINE) typename std::aligned_storage<sizeof(T), alignof(T)>::type driver;
+      alignas(CRPI_CACHE_LINE) typename std::aligned_storage<sizeof(CrpiRobotParams), alignof(CrpiRobotParams)>::type robotparams;
+      typename std::aligned_storage<sizeof(CrclXml), alignof(CrclXml)>::type crclxml;
+      typename std::aligned_storage<sizeof(CrpiXml), alignof(CrpiXml)>::type crpixml;
+      typename std::aligned_storage<sizeof(CrpiBinary), alignof(CrpiBinary)>::type crpibin;
+      typename std::aligned_storage<sizeof(Math::RegistrationMap), alignof(Math::RegistrationMap)>::type maps[2];
+    };
+
+    //! @brief The allocated block, and the arena aligned to a cache line within it
+    //!
+    void *arenaBlock_;
+    arena *arena_;
+
     //! @brief Units by which orientations are reported
     //!
     CanonAngleUnit angleUnits_;
@@ -602,7 +1400,265 @@ namespace crpi_robot
     //! @brief Whether or not to run this in bypass mode
     //!
     bool bypass_;
+
+    //! @brief Composed robot-to-world and world-to-robot transforms used by ToWorld and FromWorld
+    //!        (and their batch forms), valid until UpdateWorldTransform is called
+    //!
+    Math::Mat4 toWorldCache_, fromWorldCache_;
+    bool worldCacheValid_;
+
+    //! @brief Registration maps used instead of the cached world transforms when loaded
+    //!
+    Math::RegistrationMap *toWorldMap_;
+    Math::RegistrationMap *fromWorldMap_;
+
+    //! @brief Composed transforms for each named coordinate system (same order as coordSystNames),
+    //!        valid until UpdateSystemTransform is called
+    //!
+    vector<Math::Mat4> toSystemCache_, fromSystemCache_;
+    bool systemCacheValid_;
+
+    //! @brief Read and parse a configuration file (through its compiled cache when it is current)
+    //!
+    //! @param path   The configuration file
+    //! @param params Populated with the configuration
+    //!
+    //! @return True if the file was read, false if it could not be opened
+    //!
+    bool loadConfig (const char *path, CrpiRobotParams *params);
+
+    //! @brief Rebuild the cached world and system transforms if they have been invalidated
+    //!
+    //! @return True if all cached transforms are valid, false if a transform could not be inverted
+    //!
+    bool updateTransformCache ();
+
+    //! @brief Look up the index of a named coordinate system
+    //!
+    //! @return The index into coordSystNames, or -1 if the named system does not exist
+    //!
+    int findSystem (const char *name);
+
+    //! @brief Whether a handle refers to a coordinate system with a transform
+    //!
+    bool validSystem (FrameHandle system) const;
+
+    //! @brief Execute the command described by crpiparams_, as populated by either the XML or
+    //!        the binary command decoder, through its CrpiCommandRegistry entry
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn CrpiDispatch ();
+
+    //! @brief Execute one non-motion step of a compiled program
+    //!
+    //! @param step    The step to execute
+    //! @param program The program holding the step's joint and text arguments
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn RunProgramStep (const CrpiProgramStep &step, CrpiCompiledProgram &program);
+
+    //! @brief Commands queued by the *Async methods, run in order by asyncThread
+    //!
+    std::deque<std::pair<std::function<CanonReturn ()>, CrpiCompletion> > asyncQueue_;
+
+    //! @brief Guards asyncQueue_ and asyncRun_; asyncCond_ is signalled when either changes
+    //!
+    ulapi_mutex_struct *asyncMutex_;
+    void *asyncCond_;
+
+    //! @brief Command thread, started by the first *Async call
+    //!
+    ulapi_task_struct *asyncTask_;
+    bool asyncRun_;
+
+    //! @brief Queue a command for asyncThread
+    //!
+    //! @param command The command to run
+    //!
+    //! @return The command's completion handle
+    //!
+    CrpiCompletion enqueue (std::function<CanonReturn ()> command);
+
+    //! @brief Run queued commands until asyncRun_ is cleared
+    //!
+    //! @param param The CrpiRobot whose queue is served
+    //!
+    static void asyncThread (void *param);
+
+    //! @brief Shared memory mirror of the state, its SensorHub task, and the count of the last
+    //!        state copied to it
+    //!
+    CrpiStatePublisher *publisher_;
+    int publishTask_;
+    unsigned long publishedSeq_;
+
+    //! @brief Copy the robot's state to publisher_ if it has changed
+    //!
+    //! @param param The CrpiRobot being published
+    //!
+    static void publishTick (void *param);
+
+    //! @brief State broadcast and its SensorHub task
+    //!
+    CrpiStateBroadcaster *broadcaster_;
+    int broadcastTask_;
+
+    //! @brief Send the robot's latest state to broadcaster_
+    //!
+    //! @param param The CrpiRobot being broadcast
+    //!
+    static void broadcastTick (void *param);
+
+    //! @brief Feedback watchdog, its SensorHub task, and whether it has slowed the robot down
+    //!
+    CrpiWatchdog *watchdog_;
+    int watchdogTask_;
+    bool watchdogSlowed_;
+
+    //! @brief Check the robot's state and apply the watchdog's policies
+    //!
+    //! @param param The CrpiRobot being watched
+    //!
+    static void watchdogTick (void *param);
+
+    //! @brief TCP fusion and its SensorHub task
+    //!
+    CrpiTcpFusion *fusion_;
+    int fusionTask_;
+
+    //! @brief Add the robot's state to fusion_ if it has changed
+    //!
+    //! @param param The CrpiRobot being fused
+    //!
+    static void fusionTick (void *param);
+
+    //! @brief Named waypoints and their cached base-frame poses
+    //!
+    CrpiWaypoints *waypoints_;
+
+    //! @brief Outputs as last written through this object, and the channels changed in them
+    //!        since (by a transaction or the coalescing window)
+    //!
+    robotIO ioShadow_;
+    std::bitset<CRPI_IO_MAX> doStaged_;
+    std::bitset<CRPI_IO_MAX> aoStaged_;
+
+    //! @brief Whether a transaction is open, the coalescing window (s, 0 for none), and the
+    //!        SensorHub task that closes the window
+    //!
+    bool ioOpen_;
+    double ioWindow_;
+    int ioTask_;
+
+    //! @brief Guards the staged outputs, which the SensorHub task also writes
+    //!
+    ulapi_mutex_struct *ioMutex_;
+
+    //! @brief Stage an output, and write it at once unless it is being transacted or coalesced
+    //!
+    //! @param analog  Whether the channel is analog
+    //! @param channel Output channel
+    //! @param val     Value of the output
+    //!
+    CanonReturn stageIO (bool analog, int channel, double val);
+
+    //! @brief Write the staged outputs in one SetRobotIO (ioMutex_ held)
+    //!
+    CanonReturn writeIO ();
+
+    //! @brief Write any outputs staged by coalescing before a motion command
+    //!
+    void flushIO ();
+
+    //! @brief Close the coalescing window
+    //!
+    //! @param param The CrpiRobot whose outputs are coalesced
+    //!
+    static void ioTick (void *param);
+
+    //! @brief Input change notifications and their SensorHub task, started by the first watch
+    //!        or wait
+    //!
+    CrpiIOWatch *ioWatch_;
+    int ioWatchTask_;
+
+    //! @brief Start the input notifications if they are not running (ioMutex_ guards the start)
+    //!
+    CrpiIOWatch *startIOWatch ();
+
+    //! @brief Give ioWatch_ the robot's latest state
+    //!
+    //! @param param The CrpiRobot being watched
+    //!
+    static void ioWatchTick (void *param);
+
+    //! @brief Poses of the latest state in the world and subscribed systems, the SensorHub task
+    //!        that maps them, and the subscribed systems (frameMutex_ guards the list, which the
+    //!        task copies)
+    //!
+    crpi_seqlock<CrpiFramedState> frames_;
+    int frameTask_;
+    FrameHandle frameSystems_[CRPI_FRAME_SUBSCRIPTIONS_MAX];
+    int frameSystemCount_;
+    ulapi_mutex_struct *frameMutex_;
+
+    //! @brief Map the robot's latest state to the world and subscribed systems if it is new
+    //!
+    //! @param param The CrpiRobot being tracked
+    //!
+    static void frameTick (void *param);
+
+    //! @brief Jerk-limited generators of smoothed joint and Cartesian stream setpoints, whether
+    //!        streams are smoothed, the period they are stepped at, and whether each generator
+    //!        has been started from the robot's position since BeginStream
+    //!
+    CrpiOnlineTrajectory *axisOtg_;
+    CrpiOnlineTrajectory *poseOtg_;
+    bool streamSmooth_;
+    double streamPeriod_;
+    bool axisPrimed_;
+    bool posePrimed_;
+
+    //! @brief (Re)create the stream generators from the configured limits
+    //!
+    void makeStreamGenerators ();
+
+    //! @brief Send a stream setpoint to the robot, through the generator if streams are
+    //!        smoothed
+    //!
+    //! @param settled If not NULL, set to whether the generator has reached the setpoint (always
+    //!                true without smoothing)
+    //!
+    CanonReturn sendStreamPose (robotPose &pose, bool *settled);
+    CanonReturn sendStreamAxes (robotAxes &axes, bool *settled);
+
+    //! @brief Servo task of "stream_servo" streams, whether streams use one and the ulapi_rtm
+    //!        key of its rings, and (used only by the task) the setpoint it follows, whether
+    //!        that setpoint is new, and whether the generator has reached it
+    //!
+    CrpiServo *servo_;
+    bool servoEnabled_;
+    int servoKey_;
+    CrpiServoSetpoint servoTarget_;
+    bool servoHasTarget_;
+    bool servoFresh_;
+    bool servoSettled_;
+
+    //! @brief One cycle of the servo task:  send the newest setpoint, or keep stepping the
+    //!        generator toward it, and report the robot's state
+    //!
+    //! @param param The CrpiRobot streaming
+    //!
+    static bool servoCycle (void *param, const CrpiServoSetpoint *setpoint, CrpiServoFeedback &feedback);
   }; // CrpiRobot
 } // crpi_robot
 
+#ifdef CRPI_HEADER_ONLY
+#include "crpi_robot_impl.h"
+#endif
+
 #endif
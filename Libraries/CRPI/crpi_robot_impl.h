@@ -0,0 +1,3464 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_robot_impl.h
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Robot interface definitions (the members of CrpiRobot<T>).
+//
+//  Compiled into the CRPI library by crpi_robot.cpp, which instantiates
+//  CrpiRobot for each driver.  An application built with CRPI_HEADER_ONLY
+//  gets these definitions through crpi_robot.h instead, so that calls such
+//  as GetRobotPose can be inlined into its control loop; it then links the
+//  core CRPI library and the libraries of the drivers it uses.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_robot_impl_H
+#define crpi_robot_impl_H
+
+#include "crpi_robot.h"
+#include "crpi_robot_xml.h"
+#include "crpi_alloc.h"
+#include "crpi_log.h"
+#include "crpi_trace.h"
+#include "crpi_dispatch.h"
+
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+using namespace std;
+
+//#define NOISY
+
+
+//! @brief Determine if two double precision floating point numbers are approximately equal
+//!        to one another within 0.00001
+//!
+inline bool approxEqual(double v1, double v2)
+{
+  double error = 0.00001;
+  return (fabs(v1 - v2) <= error);
+}
+
+
+namespace crpi_robot
+{
+  template <class T> CRPI_ROBOT_API CrpiRobot<T>::CrpiRobot (const char *initPath, bool bypass)
+  {
+    //! One allocation for the interpreter and driver state; nothing below allocates it again
+    arenaBlock_ = ::operator new(sizeof(arena) + CRPI_CACHE_LINE - 1);
+    arena_ = (arena *)(((size_t)arenaBlock_ + CRPI_CACHE_LINE - 1) & ~(size_t)(CRPI_CACHE_LINE - 1));
+    robotparams_ = new (&arena_->robotparams) CrpiRobotParams();
+    crpiparams_ = new (&arena_->crpiparams) CrpiXmlParams();
+    crclxml_ = new (&arena_->crclxml) CrclXml(crpiparams_);
+    crpixml_ = new (&arena_->crpixml) CrpiXml(crpiparams_);
+    crpibin_ = new (&arena_->crpibin) CrpiBinary(crpiparams_);
+    rotMatrix_ = new (&arena_->rotMatrix) matrix(3, 3);
+    v1_ = new (&arena_->vectors[0]) vector3D;
+    v2_ = new (&arena_->vectors[1]) vector3D;
+    v3_ = new (&arena_->vectors[2]) vector3D;
+    toWorldMap_ = new (&arena_->maps[0]) Math::RegistrationMap();
+    fromWorldMap_ = new (&arena_->maps[1]) Math::RegistrationMap();
+    robInterface_ = NULL;
+
+    bypass_ = bypass;
+    asyncMutex_ = ulapi_mutex_new(25);
+    ulapi_lock_name(asyncMutex_, "CrpiRobot async");
+    asyncCond_ = ulapi_cond_new(25);
+    asyncTask_ = NULL;
+    asyncRun_ = false;
+    publisher_ = NULL;
+    publishTask_ = -1;
+    publishedSeq_ = 0;
+    broadcaster_ = NULL;
+    broadcastTask_ = -1;
+    watchdog_ = NULL;
+    watchdogTask_ = -1;
+    watchdogSlowed_ = false;
+    fusion_ = NULL;
+    fusionTask_ = -1;
+    ioOpen_ = false;
+    ioWindow_ = 0.0;
+    ioTask_ = -1;
+    ioMutex_ = ulapi_mutex_new(26);
+    ulapi_lock_name(ioMutex_, "CrpiRobot IO");
+    ioWatch_ = NULL;
+    ioWatchTask_ = -1;
+    frameTask_ = -1;
+    frameSystemCount_ = 0;
+    frameMutex_ = ulapi_mutex_new(28);
+    ulapi_lock_name(frameMutex_, "CrpiRobot frames");
+    waypoints_ = new CrpiWaypoints();
+    angleUnits_ = DEGREE;
+    lengthUnits_ = MM;
+    axisOtg_ = poseOtg_ = NULL;
+    streamSmooth_ = false;
+    streamPeriod_ = CRPI_OTG_PERIOD;
+    axisPrimed_ = posePrimed_ = false;
+    servo_ = NULL;
+    servoEnabled_ = false;
+    servoKey_ = 0;
+    servoHasTarget_ = servoFresh_ = false;
+    servoSettled_ = true;
+
+    if (!loadConfig(initPath, robotparams_))
+    {
+      CRPI_LOG(CRPI_LOG_ERROR, "Could not open file %s.  Robot not initialized.", initPath);
+      return;
+    }
+
+    robInterface_ = (bypass_ ? NULL : new (&arena_->driver) T(*robotparams_));
+    makeStreamGenerators();
+    worldCacheValid_ = systemCacheValid_ = false;
+    crpiparams_->toolName = "Nothing";
+    crpiparams_->toolVal = 0.0f;
+    crpiparams_->status = CANON_REJECT;
+
+    if (!bypass_ && robotparams_->watchdog.enabled())
+    {
+      StartWatchdog(robotparams_->watchdog);
+    }
+    if (!bypass_ && robotparams_->broadcast.enabled())
+    {
+      BroadcastState(robotparams_->broadcast);
+    }
+  }
+
+
+  template <class T> CRPI_ROBOT_API CrpiRobot<T>::~CrpiRobot ()
+  {
+    StopWatchdog();
+    StopFusion();
+    StopFrameTracking();
+    StopPublishing();
+    StopBroadcasting();
+    if (ioTask_ >= 0)
+    {
+      SensorHub::Instance().RemovePeriodic(ioTask_);
+      ioTask_ = -1;
+    }
+    if (ioWatchTask_ >= 0)
+    {
+      SensorHub::Instance().RemovePeriodic(ioWatchTask_);
+      ioWatchTask_ = -1;
+    }
+    delete ioWatch_;
+    delete waypoints_;
+    delete servo_;
+    delete axisOtg_;
+    delete poseOtg_;
+
+    //! Let the command that is running finish, and drop the rest
+    if (asyncTask_ != NULL)
+    {
+      ulapi_mutex_take(asyncMutex_);
+      asyncRun_ = false;
+      ulapi_cond_broadcast(asyncCond_);
+      ulapi_mutex_give(asyncMutex_);
+      ulapi_task_join(asyncTask_, NULL);
+      ulapi_task_delete(asyncTask_);
+    }
+    while (!asyncQueue_.empty())
+    {
+      asyncQueue_.front().second.finish(CANON_REJECT);
+      asyncQueue_.pop_front();
+    }
+    ulapi_cond_delete(asyncCond_);
+    ulapi_mutex_delete(asyncMutex_);
+    ulapi_mutex_delete(ioMutex_);
+    ulapi_mutex_delete(frameMutex_);
+
+    //! The arena's objects are destroyed in place, the driver first
+    if (robInterface_ != NULL)
+    {
+      robInterface_->~T();
+    }
+    fromWorldMap_->~RegistrationMap();
+    toWorldMap_->~RegistrationMap();
+    v3_->~vector3D();
+    v2_->~vector3D();
+    v1_->~vector3D();
+    rotMatrix_->~matrix();
+    crpibin_->~CrpiBinary();
+    crpixml_->~CrpiXml();
+    crclxml_->~CrclXml();
+    crpiparams_->~CrpiXmlParams();
+
+    //! CrpiRobotParams does not own its transforms; the robot's copy does
+    for (size_t i = 0; i < robotparams_->toCoordSystMatrices.size(); ++i)
+    {
+      delete robotparams_->toCoordSystMatrices[i];
+    }
+    delete robotparams_->mounting;
+    delete robotparams_->toWorld;
+    delete robotparams_->toWorldMatrix;
+    robotparams_->~CrpiRobotParams();
+    ::operator delete(arenaBlock_);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::SetTool (double percent)
+  {
+    CrpiTraceSpan span("SetTool");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    flushIO();
+
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    crpiparams_->toolVal = percent;
+    val = robInterface_->SetTool (percent);
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::ApplyCartesianForceTorque (robotPose &robotForceTorque, const vector<bool> &activeAxes, const vector<bool> &manipulator)
+  {
+    CrpiTraceSpan span("ApplyCartesianForceTorque");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->ApplyCartesianForceTorque (robotForceTorque, activeAxes, manipulator);
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::ApplyJointTorque (robotAxes &robotJointTorque)
+  {
+    return CANON_SUCCESS;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::Couple (const char *targetID)
+  {
+    CrpiTraceSpan span("Couple");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    crpiparams_->toolName = targetID;
+    val = robInterface_->Couple(targetID);
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API ToolHandle CrpiRobot<T>::LookupTool (const char *name)
+  {
+    return robotparams_->findTool (name);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::Couple (ToolHandle tool)
+  {
+    if (tool < 0 || tool >= (int)robotparams_->tools.size())
+    {
+      return CANON_REJECT;
+    }
+    return Couple (robotparams_->tools[tool].toolName.c_str());
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::GetRobotAxes (robotAxes *axes)
+  {
+    CrpiTraceSpan span("GetRobotAxes");
+    CRPI_NO_ALLOC_SCOPE("GetRobotAxes");
+    if (bypass_)
+    {
+      robotAxes temp;
+      *axes = temp;
+      *crpiparams_->axes = temp;
+      return CANON_SUCCESS;
+    }
+
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->GetRobotAxes (axes);
+    *crpiparams_->axes = *axes;
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::GetRobotForces (robotPose *forces)
+  {
+    CrpiTraceSpan span("GetRobotForces");
+    CRPI_NO_ALLOC_SCOPE("GetRobotForces");
+    if (bypass_)
+    {
+      robotPose temp;
+      *forces = temp;
+      *crpiparams_->forces = temp;
+      return CANON_SUCCESS;
+    }
+
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->GetRobotForces (forces);
+    *crpiparams_->forces = *forces;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::GetRobotIO (robotIO *io)
+  {
+    CrpiTraceSpan span("GetRobotIO");
+    CRPI_NO_ALLOC_SCOPE("GetRobotIO");
+    if (bypass_)
+    {
+      robotIO temp;
+      *io = temp;
+      *crpiparams_->io = temp;
+      return CANON_SUCCESS;
+    }
+
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->GetRobotIO (io);
+    *crpiparams_->io = *io;
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::GetRobotPose (robotPose *pose)
+  {
+    CrpiTraceSpan span("GetRobotPose");
+    CRPI_NO_ALLOC_SCOPE("GetRobotPose");
+    if (bypass_)
+    {
+      robotPose temp;
+      *pose = temp;
+      *crpiparams_->pose = temp;
+      return CANON_SUCCESS;
+    }
+
+    CanonReturn val;
+    //! The rotation is worked on the stack:  the shared rotMatrix_ is resized (reallocated) by
+    //! the conversion, which is not safe from concurrent callers
+    Math::Mat3 rot;
+    crpiparams_->status = CANON_RUNNING;
+    //cout << "robot: get pose" << endl;
+    val = robInterface_->GetRobotPose (pose);
+    //cout << "robot: do math" << endl;
+    Math::pose ptemp = pose->pose();
+    rot.RPYMatrixConvert (ptemp, (angleUnits_ == DEGREE));
+    crpiparams_->xaxis.i = rot.at (0, 0);
+    crpiparams_->xaxis.j = rot.at (1, 0);
+    crpiparams_->xaxis.k = rot.at (2, 0);
+
+    crpiparams_->zaxis.i = rot.at (0, 2);
+    crpiparams_->zaxis.j = rot.at (1, 2);
+    crpiparams_->zaxis.k = rot.at (2, 2);
+    crpiparams_->status = val;
+    *crpiparams_->pose = ptemp;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::GetRobotSpeed (robotAxes *speed)
+  {
+    CrpiTraceSpan span("GetRobotSpeed");
+    CRPI_NO_ALLOC_SCOPE("GetRobotSpeed");
+    if (bypass_)
+    {
+      robotAxes temp;
+      *speed = temp;
+      return CANON_SUCCESS;
+    }
+
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->GetRobotSpeed (speed);
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::GetRobotSpeed (robotPose *speed)
+  {
+    CrpiTraceSpan span("GetRobotSpeed");
+    CRPI_NO_ALLOC_SCOPE("GetRobotSpeed");
+    if (bypass_)
+    {
+      robotPose temp;
+      *speed = temp;
+      return CANON_SUCCESS;
+    }
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->GetRobotSpeed (speed);
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::GetRobotTorques (robotAxes *torques)
+  {
+    CrpiTraceSpan span("GetRobotTorques");
+    CRPI_NO_ALLOC_SCOPE("GetRobotTorques");
+    if (bypass_)
+    {
+      robotAxes temp;
+      *torques = temp;
+      *crpiparams_->torques = temp;
+      return CANON_SUCCESS;
+    }
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->GetRobotTorques (torques);
+    *crpiparams_->torques = *torques;
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::GetRobotState (RobotStateSnapshot *state)
+  {
+    CrpiTraceSpan span("GetRobotState");
+    CRPI_NO_ALLOC_SCOPE("GetRobotState");
+    if (bypass_)
+    {
+      RobotStateSnapshot temp;
+      *state = temp;
+      return CANON_SUCCESS;
+    }
+    //! Snapshots are read without blocking, so the command status is left untouched
+    return span.End(robInterface_->GetRobotState (state));
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::GetPredictedState (RobotStateSnapshot *state,
+                                                                             double lead)
+  {
+    CrpiTraceSpan span("GetPredictedState");
+    if (bypass_)
+    {
+      RobotStateSnapshot temp;
+      *state = temp;
+      return CANON_SUCCESS;
+    }
+    return span.End(robInterface_->GetPredictedState (state, lead));
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::PublishState (ulapi_id key,
+                                                                        const char *robot,
+                                                                        double period)
+  {
+    if (bypass_ || publisher_ != NULL)
+    {
+      return CANON_REJECT;
+    }
+
+    publisher_ = new CrpiStatePublisher(key, robot);
+    if (!publisher_->Ready())
+    {
+      delete publisher_;
+      publisher_ = NULL;
+      return CANON_FAILURE;
+    }
+    publishedSeq_ = 0;
+    publishTask_ = SensorHub::Instance().AddPeriodic(publishTick, this, period, HUB_SENSOR);
+    return CANON_SUCCESS;
+  }
+
+
+  template <class T> CRPI_ROBOT_API void CrpiRobot<T>::StopPublishing ()
+  {
+    if (publisher_ == NULL)
+    {
+      return;
+    }
+    //! Waits for a copy in progress
+    SensorHub::Instance().RemovePeriodic(publishTask_);
+    publishTask_ = -1;
+    delete publisher_;
+    publisher_ = NULL;
+  }
+
+
+  template <class T> void CrpiRobot<T>::publishTick (void *param)
+  {
+    CrpiRobot<T> *robot = (CrpiRobot<T>*)param;
+    RobotStateSnapshot state;
+
+    if (robot->robInterface_->GetRobotState(&state) == CANON_SUCCESS &&
+        state.sequence != robot->publishedSeq_)
+    {
+      robot->publishedSeq_ = state.sequence;
+      robot->publisher_->Publish(state);
+    }
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::BroadcastState (const CrpiBroadcastParams &params)
+  {
+    if (bypass_ || broadcaster_ != NULL || !params.enabled())
+    {
+      return CANON_REJECT;
+    }
+
+    broadcaster_ = new CrpiStateBroadcaster(params.port, params.group.c_str(),
+                                            params.name.empty() ? robotparams_->tcp_ip_addr : params.name.c_str());
+    if (!broadcaster_->Ready())
+    {
+      delete broadcaster_;
+      broadcaster_ = NULL;
+      return CANON_FAILURE;
+    }
+    broadcastTask_ = SensorHub::Instance().AddPeriodic(broadcastTick, this, 1.0 / params.rate, HUB_BACKGROUND);
+    return CANON_SUCCESS;
+  }
+
+
+  template <class T> CRPI_ROBOT_API void CrpiRobot<T>::StopBroadcasting ()
+  {
+    if (broadcaster_ == NULL)
+    {
+      return;
+    }
+    //! Waits for a send in progress
+    SensorHub::Instance().RemovePeriodic(broadcastTask_);
+    broadcastTask_ = -1;
+    delete broadcaster_;
+    broadcaster_ = NULL;
+  }
+
+
+  template <class T> void CrpiRobot<T>::broadcastTick (void *param)
+  {
+    CrpiRobot<T> *robot = (CrpiRobot<T>*)param;
+    RobotStateSnapshot state;
+
+    //! Sent on every tick, changed or not, so that listeners can tell a quiet robot from a
+    //! lost one
+    if (robot->robInterface_->GetRobotState(&state) == CANON_SUCCESS)
+    {
+      robot->broadcaster_->Send(state);
+    }
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::StartWatchdog (const CrpiWatchdogParams &params)
+  {
+    if (bypass_ || watchdog_ != NULL)
+    {
+      return CANON_REJECT;
+    }
+
+    watchdog_ = new CrpiWatchdog(params, CrpiMetrics::Label("robot", robotparams_->tcp_ip_addr));
+    watchdogSlowed_ = false;
+    watchdogTask_ = SensorHub::Instance().AddPeriodic(watchdogTick, this, watchdog_->Period(), HUB_MONITOR);
+    return CANON_SUCCESS;
+  }
+
+
+  template <class T> CRPI_ROBOT_API void CrpiRobot<T>::StopWatchdog ()
+  {
+    if (watchdog_ == NULL)
+    {
+      return;
+    }
+    //! Waits for a check in progress
+    SensorHub::Instance().RemovePeriodic(watchdogTask_);
+    watchdogTask_ = -1;
+    if (watchdogSlowed_)
+    {
+      robInterface_->SetRelativeSpeed(watchdog_->Commanded());
+    }
+    delete watchdog_;
+    watchdog_ = NULL;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CrpiWatchdogLevel CrpiRobot<T>::WatchdogLevel () const
+  {
+    return (watchdog_ == NULL) ? WATCHDOG_OK : watchdog_->Level();
+  }
+
+
+  template <class T> CRPI_ROBOT_API int CrpiRobot<T>::WatchDI (int dig_in, int edges, CrpiIOCallback callback)
+  {
+    CrpiIOWatch *watch = startIOWatch();
+    return (watch == NULL) ? -1 : watch->AddDigital(dig_in, edges, callback);
+  }
+
+
+  template <class T> CRPI_ROBOT_API int CrpiRobot<T>::WatchAI (int ana_in, double threshold, int edges,
+                                                               CrpiIOCallback callback)
+  {
+    CrpiIOWatch *watch = startIOWatch();
+    return (watch == NULL) ? -1 : watch->AddAnalog(ana_in, threshold, edges, callback);
+  }
+
+
+  template <class T> CRPI_ROBOT_API void CrpiRobot<T>::Unwatch (int id)
+  {
+    if (ioWatch_ != NULL)
+    {
+      ioWatch_->Remove(id);
+    }
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::WaitForDI (int dig_in, bool val, double timeout)
+  {
+    CrpiTraceSpan span("WaitForDI");
+    CrpiIOWatch *watch;
+
+    if (dig_in < 0 || dig_in >= CRPI_IO_MAX || (watch = startIOWatch()) == NULL)
+    {
+      return CANON_REJECT;
+    }
+    return span.End(watch->WaitDigital(dig_in, val, timeout) ? CANON_SUCCESS : CANON_FAILURE);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::WaitForAI (int ana_in, double threshold, bool above,
+                                                                        double timeout)
+  {
+    CrpiTraceSpan span("WaitForAI");
+    CrpiIOWatch *watch;
+
+    if (ana_in < 0 || ana_in >= CRPI_IO_MAX || (watch = startIOWatch()) == NULL)
+    {
+      return CANON_REJECT;
+    }
+    return span.End(watch->WaitAnalog(ana_in, threshold, above, timeout) ? CANON_SUCCESS : CANON_FAILURE);
+  }
+
+
+  template <class T> CrpiIOWatch *CrpiRobot<T>::startIOWatch ()
+  {
+    if (bypass_)
+    {
+      return NULL;
+    }
+    ulapi_mutex_take(ioMutex_);
+    if (ioWatch_ == NULL)
+    {
+      ioWatch_ = new CrpiIOWatch();
+      //! Every hub tick:  snapshots already seen are skipped, so the reaction time is set by the
+      //! driver's feedback rate
+      ioWatchTask_ = SensorHub::Instance().AddPeriodic(ioWatchTick, this, HUB_TICK, HUB_SENSOR);
+    }
+    ulapi_mutex_give(ioMutex_);
+    return ioWatch_;
+  }
+
+
+  template <class T> void CrpiRobot<T>::ioWatchTick (void *param)
+  {
+    CrpiRobot<T> *robot = (CrpiRobot<T>*)param;
+    RobotStateSnapshot state;
+
+    if (robot->robInterface_->GetRobotState(&state) == CANON_SUCCESS && (state.valid & STATE_IO))
+    {
+      robot->ioWatch_->Update(state);
+    }
+  }
+
+
+  template <class T> void CrpiRobot<T>::makeStreamGenerators ()
+  {
+    delete axisOtg_;
+    delete poseOtg_;
+    axisOtg_ = new CrpiOnlineTrajectory(*robotparams_, streamPeriod_, false);
+    poseOtg_ = new CrpiOnlineTrajectory(*robotparams_, streamPeriod_, true);
+    axisPrimed_ = posePrimed_ = false;
+  }
+
+
+  template <class T> void CrpiRobot<T>::watchdogTick (void *param)
+  {
+    CrpiRobot<T> *robot = (CrpiRobot<T>*)param;
+    CrpiWatchdog *watchdog = robot->watchdog_;
+    RobotStateSnapshot state;
+    CrpiWatchdogLevel before, after;
+    bool valid;
+
+    valid = (robot->robInterface_->GetRobotState(&state) == CANON_SUCCESS);
+    before = watchdog->Level();
+    after = watchdog->Check(state, valid, ulapi_time());
+    if (after == before)
+    {
+      return;
+    }
+
+    //! Slowing also covers a stop, so that a motion commanded before the feedback recovers is
+    //! not run at full speed
+    if ((after >= WATCHDOG_SLOW) != robot->watchdogSlowed_)
+    {
+      robot->watchdogSlowed_ = (after >= WATCHDOG_SLOW);
+      robot->robInterface_->SetRelativeSpeed(watchdog->Speed());
+      if (robot->watchdogSlowed_)
+      {
+        watchdog->CountAction(WATCHDOG_SLOW);
+      }
+    }
+    if (after == WATCHDOG_STOP)
+    {
+      robot->robInterface_->StopMotion();
+      watchdog->CountAction(WATCHDOG_STOP);
+    }
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::StartFusion (const CrpiFusionParams &params)
+  {
+    if (bypass_ || fusion_ != NULL)
+    {
+      return CANON_REJECT;
+    }
+
+    fusion_ = new CrpiTcpFusion(params);
+    fusionTask_ = SensorHub::Instance().AddPeriodic(fusionTick, this, params.period, HUB_SENSOR);
+    return CANON_SUCCESS;
+  }
+
+
+  template <class T> CRPI_ROBOT_API void CrpiRobot<T>::StopFusion ()
+  {
+    if (fusion_ == NULL)
+    {
+      return;
+    }
+    //! Waits for a sample in progress
+    SensorHub::Instance().RemovePeriodic(fusionTask_);
+    fusionTask_ = -1;
+    delete fusion_;
+    fusion_ = NULL;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::FuseMoCap (const Math::point &position,
+                                                                      const Math::matrix &rotation,
+                                                                      double timestamp)
+  {
+    if (fusion_ == NULL)
+    {
+      return CANON_REJECT;
+    }
+    return fusion_->AddMoCap(position, rotation, timestamp) ? CANON_SUCCESS : CANON_REJECT;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::GetFusedState (RobotStateSnapshot *state,
+                                                                          double lead)
+  {
+    CrpiTraceSpan span("GetFusedState");
+    robotPose world;
+
+    if (fusion_ == NULL || robInterface_->GetRobotState(state) != CANON_SUCCESS)
+    {
+      return span.End(CANON_REJECT);
+    }
+    //! Keep the reported configuration for the inverse kinematics
+    world = state->pose;
+    state->timestamp = ulapi_time() + lead;
+    if (!fusion_->Get(world, (angleUnits_ == DEGREE), state->timestamp))
+    {
+      return span.End(CANON_REJECT);
+    }
+    if (FromWorld(&world, &state->pose) != CANON_SUCCESS)
+    {
+      return span.End(CANON_FAILURE);
+    }
+    state->valid |= STATE_POSE;
+    return span.End(CANON_SUCCESS);
+  }
+
+
+  template <class T> void CrpiRobot<T>::fusionTick (void *param)
+  {
+    CrpiRobot<T> *robot = (CrpiRobot<T>*)param;
+    CrpiTcpFusion *fusion = robot->fusion_;
+    RobotStateSnapshot state;
+    robotPose world;
+
+    if (robot->robInterface_->GetRobotState(&state) != CANON_SUCCESS ||
+        !(state.valid & STATE_POSE) || state.sequence == fusion->Sequence())
+    {
+      return;
+    }
+    fusion->Sequence() = state.sequence;
+    if (robot->ToWorld(&state.pose, &world) == CANON_SUCCESS)
+    {
+      fusion->AddEncoder(world, (robot->angleUnits_ == DEGREE), state.timestamp);
+    }
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::StartFrameTracking (double period)
+  {
+    if (bypass_ || frameTask_ >= 0)
+    {
+      return CANON_REJECT;
+    }
+    //! Built here, so that the timer thread finds the transforms ready
+    updateTransformCache();
+    frameTask_ = SensorHub::Instance().AddPeriodic(frameTick, this, period, HUB_SENSOR);
+    return CANON_SUCCESS;
+  }
+
+
+  template <class T> CRPI_ROBOT_API void CrpiRobot<T>::StopFrameTracking ()
+  {
+    if (frameTask_ < 0)
+    {
+      return;
+    }
+    //! Waits for a mapping in progress
+    SensorHub::Instance().RemovePeriodic(frameTask_);
+    frameTask_ = -1;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::SubscribeSystem (FrameHandle system)
+  {
+    CanonReturn val = CANON_SUCCESS;
+    int i;
+
+    if (!validSystem(system))
+    {
+      return CANON_REJECT;
+    }
+    ulapi_mutex_take(frameMutex_);
+    for (i = 0; i < frameSystemCount_; ++i)
+    {
+      if (frameSystems_[i] == system)
+      {
+        break;
+      }
+    }
+    if (i == frameSystemCount_)
+    {
+      if (frameSystemCount_ < CRPI_FRAME_SUBSCRIPTIONS_MAX)
+      {
+        frameSystems_[frameSystemCount_++] = system;
+      }
+      else
+      {
+        val = CANON_REJECT;
+      }
+    }
+    ulapi_mutex_give(frameMutex_);
+    return val;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::UnsubscribeSystem (FrameHandle system)
+  {
+    CanonReturn val = CANON_REJECT;
+
+    ulapi_mutex_take(frameMutex_);
+    for (int i = 0; i < frameSystemCount_; ++i)
+    {
+      if (frameSystems_[i] == system)
+      {
+        for (--frameSystemCount_; i < frameSystemCount_; ++i)
+        {
+          frameSystems_[i] = frameSystems_[i + 1];
+        }
+        val = CANON_SUCCESS;
+        break;
+      }
+    }
+    ulapi_mutex_give(frameMutex_);
+    return val;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::GetRobotPoseWorld (robotPose *pose)
+  {
+    CrpiTraceSpan span("GetRobotPoseWorld");
+    CrpiFramedState frames;
+    robotPose robot;
+
+    if (frameTask_ >= 0 && frames_.read(frames) > 0 && frames.worldValid)
+    {
+      *pose = frames.world;
+      return span.End(CANON_SUCCESS);
+    }
+    if (GetRobotPose(&robot) != CANON_SUCCESS || ToWorld(&robot, pose) != CANON_SUCCESS)
+    {
+      return span.End(CANON_FAILURE);
+    }
+    return span.End(CANON_SUCCESS);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::GetRobotPoseSystem (FrameHandle system,
+                                                                               robotPose *pose)
+  {
+    CrpiTraceSpan span("GetRobotPoseSystem");
+    CrpiFramedState frames;
+    robotPose robot;
+
+    if (frameTask_ >= 0 && frames_.read(frames) > 0)
+    {
+      for (int i = 0; i < frames.count; ++i)
+      {
+        if (frames.systems[i] == system && frames.systemValid[i])
+        {
+          *pose = frames.system[i];
+          return span.End(CANON_SUCCESS);
+        }
+      }
+    }
+    if (GetRobotPose(&robot) != CANON_SUCCESS || ToSystem(system, &robot, pose) != CANON_SUCCESS)
+    {
+      return span.End(CANON_FAILURE);
+    }
+    return span.End(CANON_SUCCESS);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::GetFramedState (CrpiFramedState *state)
+  {
+    if (frameTask_ < 0 || frames_.read(*state) == 0)
+    {
+      return CANON_REJECT;
+    }
+    return CANON_SUCCESS;
+  }
+
+
+  template <class T> void CrpiRobot<T>::frameTick (void *param)
+  {
+    CrpiRobot<T> *robot = (CrpiRobot<T>*)param;
+    RobotStateSnapshot state;
+    CrpiFramedState frames, last;
+    unsigned long published;
+    bool same;
+    int i;
+
+    if (robot->robInterface_->GetRobotState(&state) != CANON_SUCCESS || !(state.valid & STATE_POSE))
+    {
+      return;
+    }
+
+    ulapi_mutex_take(robot->frameMutex_);
+    frames.count = robot->frameSystemCount_;
+    for (i = 0; i < frames.count; ++i)
+    {
+      frames.systems[i] = robot->frameSystems_[i];
+    }
+    ulapi_mutex_give(robot->frameMutex_);
+
+    //! A state is mapped again only if the subscriptions changed since
+    published = robot->frames_.read(last);
+    same = (published > 0 && last.sequence == state.sequence && last.count == frames.count);
+    for (i = 0; same && i < frames.count; ++i)
+    {
+      same = (last.systems[i] == frames.systems[i]);
+    }
+    if (same)
+    {
+      return;
+    }
+
+    frames.pose = state.pose;
+    frames.sequence = state.sequence;
+    frames.timestamp = state.timestamp;
+    frames.worldValid = (robot->ToWorld(&state.pose, &frames.world) == CANON_SUCCESS);
+    for (i = 0; i < frames.count; ++i)
+    {
+      frames.systemValid[i] = (robot->ToSystem(frames.systems[i], &state.pose, &frames.system[i]) == CANON_SUCCESS);
+    }
+    robot->frames_.write(frames);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::Message (const char *message)
+  {
+    CrpiTraceSpan span("Message");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->Message (message);
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::MoveStraightTo (robotPose &pose, bool useBlocking)
+  {
+    CrpiTraceSpan span("MoveStraightTo");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    flushIO();
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->MoveStraightTo (pose, useBlocking);
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::MoveThroughTo (robotPose *poses,
+                                                                          int numPoses,
+                                                                          robotPose *accelerations,
+                                                                          robotPose *speeds,
+                                                                          robotPose *tolerances)
+  {
+    CrpiTraceSpan span("MoveThroughTo");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    flushIO();
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->MoveThroughTo (poses, numPoses, accelerations, speeds, tolerances);
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::MoveTo (robotPose &pose, bool useBlocking)
+  {
+    CrpiTraceSpan span("MoveTo");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    flushIO();
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->MoveTo (pose, useBlocking);
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::MoveAttractor (robotPose &pose)
+  {
+    CrpiTraceSpan span("MoveAttractor");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->MoveAttractor (pose);
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::MoveToAxisTarget (robotAxes &axes, bool useBlocking)
+  {
+    CrpiTraceSpan span("MoveToAxisTarget");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    flushIO();
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->MoveToAxisTarget (axes, useBlocking);
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::BeginStream ()
+  {
+    CrpiTraceSpan span("BeginStream");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    flushIO();
+    CanonReturn val;
+    axisPrimed_ = posePrimed_ = false;
+    if (servo_ != NULL && servo_->Running())
+    {
+      return span.End(CANON_REJECT);
+    }
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->BeginStream ();
+    if (val == CANON_SUCCESS && servoEnabled_)
+    {
+      delete servo_;
+      servo_ = new CrpiServo(streamPeriod_, robotparams_->servo_task, (ulapi_id)servoKey_);
+      servoHasTarget_ = servoFresh_ = false;
+      servoSettled_ = true;
+      if (!servo_->Start(servoCycle, this))
+      {
+        delete servo_;
+        servo_ = NULL;
+        robInterface_->EndStream ();
+        val = CANON_FAILURE;
+      }
+    }
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::StreamPose (robotPose &pose)
+  {
+    CrpiTraceSpan span("StreamPose");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    CanonReturn val;
+    if (servo_ != NULL && servo_->Running())
+    {
+      //! The servo task sends it on its next deadline
+      CrpiServoSetpoint setpoint;
+      setpoint.kind = SERVO_POSE;
+      setpoint.time = ulapi_time();
+      setpoint.pose = pose;
+      return span.End(servo_->Push(setpoint) ? CANON_SUCCESS : CANON_FAILURE);
+    }
+    crpiparams_->status = CANON_RUNNING;
+    val = sendStreamPose (pose, NULL);
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CanonReturn CrpiRobot<T>::sendStreamPose (robotPose &pose, bool *settled)
+  {
+    if (settled != NULL)
+    {
+      *settled = true;
+    }
+    if (streamSmooth_ && poseOtg_ != NULL && poseOtg_->Limited())
+    {
+      robotPose setpoint = pose;
+      if (!posePrimed_)
+      {
+        //! Start from where the robot is, with the limits in the units it is working in
+        robotPose start;
+        if (robInterface_->GetRobotPose (&start) != CANON_SUCCESS)
+        {
+          return CANON_FAILURE;
+        }
+        poseOtg_->SetUnits(crpi_length_scale(MM, lengthUnits_), crpi_angle_scale(DEGREE, angleUnits_));
+        poseOtg_->Reset(start);
+        posePrimed_ = true;
+      }
+      poseOtg_->SetTarget(pose);
+      if (poseOtg_->Step(setpoint) == false && settled != NULL)
+      {
+        *settled = false;
+      }
+      return robInterface_->StreamPose (setpoint);
+    }
+    return robInterface_->StreamPose (pose);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::StreamAxes (robotAxes &axes)
+  {
+    CrpiTraceSpan span("StreamAxes");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    CanonReturn val;
+    if (servo_ != NULL && servo_->Running())
+    {
+      CrpiServoSetpoint setpoint;
+      setpoint.kind = SERVO_AXES;
+      setpoint.time = ulapi_time();
+      setpoint.axes = axes;
+      return span.End(servo_->Push(setpoint) ? CANON_SUCCESS : CANON_FAILURE);
+    }
+    crpiparams_->status = CANON_RUNNING;
+    val = sendStreamAxes (axes, NULL);
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CanonReturn CrpiRobot<T>::sendStreamAxes (robotAxes &axes, bool *settled)
+  {
+    if (settled != NULL)
+    {
+      *settled = true;
+    }
+    if (streamSmooth_ && axisOtg_ != NULL && axisOtg_->Limited())
+    {
+      robotAxes setpoint = axes;
+      if (!axisPrimed_)
+      {
+        robotAxes start;
+        if (robInterface_->GetRobotAxes (&start) != CANON_SUCCESS)
+        {
+          return CANON_FAILURE;
+        }
+        axisOtg_->SetUnits(1.0, crpi_angle_scale(DEGREE, angleUnits_));
+        axisOtg_->Reset(start);
+        axisPrimed_ = true;
+      }
+      axisOtg_->SetTarget(axes);
+      if (axisOtg_->Step(setpoint) == false && settled != NULL)
+      {
+        *settled = false;
+      }
+      return robInterface_->StreamAxes (setpoint);
+    }
+    return robInterface_->StreamAxes (axes);
+  }
+
+
+  template <class T> bool CrpiRobot<T>::servoCycle (void *param, const CrpiServoSetpoint *setpoint,
+                                                    CrpiServoFeedback &feedback)
+  {
+    CrpiRobot<T> *robot = (CrpiRobot<T>*)param;
+    CanonReturn val;
+    bool settled = true;
+
+    if (setpoint != NULL)
+    {
+      robot->servoTarget_ = *setpoint;
+      robot->servoHasTarget_ = robot->servoFresh_ = true;
+    }
+
+    //! A setpoint is sent when it is new, and again each cycle while the generator is still
+    //! moving toward it; otherwise the robot's own deadline sees that setpoints have stopped
+    if (robot->servoHasTarget_ && (robot->servoFresh_ || !robot->servoSettled_))
+    {
+      if (robot->servoTarget_.kind == SERVO_POSE)
+      {
+        val = robot->sendStreamPose (robot->servoTarget_.pose, &settled);
+      }
+      else
+      {
+        val = robot->sendStreamAxes (robot->servoTarget_.axes, &settled);
+      }
+      feedback.sent = true;
+      feedback.accepted = (val == CANON_SUCCESS);
+      robot->servoSettled_ = settled;
+      robot->servoFresh_ = false;
+    }
+
+    if (robot->robInterface_->GetRobotState (&feedback.state) != CANON_SUCCESS)
+    {
+      feedback.state.valid = 0;
+    }
+    return robot->servoHasTarget_;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::EndStream ()
+  {
+    CrpiTraceSpan span("EndStream");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    CanonReturn val;
+    if (servo_ != NULL)
+    {
+      //! Setpoints still queued are dropped; the robot is brought to rest below.  The task is
+      //! kept for its feedback and timing until the next stream.
+      servo_->Stop();
+    }
+    axisPrimed_ = posePrimed_ = false;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->EndStream ();
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::GetServoFeedback (CrpiServoFeedback *feedback)
+  {
+    if (servo_ == NULL || feedback == NULL)
+    {
+      return CANON_REJECT;
+    }
+    return (servo_->Pop(*feedback) ? CANON_SUCCESS : CANON_REJECT);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::GetServoStats (CrpiServoStats *stats)
+  {
+    if (servo_ == NULL || stats == NULL)
+    {
+      return CANON_REJECT;
+    }
+    servo_->Stats(*stats);
+    return CANON_SUCCESS;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::BeginWrenchStream ()
+  {
+    CrpiTraceSpan span("BeginWrenchStream");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->BeginWrenchStream ();
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::StreamWrench (robotPose &wrench, const vector<bool> &activeAxes, robotPose &limits)
+  {
+    CrpiTraceSpan span("StreamWrench");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->StreamWrench (wrench, activeAxes, limits);
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::EndWrenchStream ()
+  {
+    CrpiTraceSpan span("EndWrenchStream");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->EndWrenchStream ();
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::SetAbsoluteAcceleration (double tolerance)
+  {
+    CrpiTraceSpan span("SetAbsoluteAcceleration");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->SetAbsoluteAcceleration (tolerance);
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::SetAbsoluteSpeed (double speed)
+  {
+    CrpiTraceSpan span("SetAbsoluteSpeed");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->SetAbsoluteSpeed (speed);
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::SetAngleUnits (const char *unitName)
+  {
+    CrpiTraceSpan span("SetAngleUnits");
+    if (strcmp(unitName, "degree") == 0)
+    {
+      angleUnits_ = DEGREE;
+    }
+    else if (strcmp(unitName, "radian") == 0)
+    {
+      angleUnits_ = RADIAN;
+    }
+    else
+    {
+      return span.End(CANON_FAILURE);
+    }
+
+
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->SetAngleUnits (unitName);
+    crpiparams_->status = val;
+
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::SetAxialSpeeds (double *speeds)
+  {
+    CrpiTraceSpan span("SetAxialSpeeds");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->SetAxialSpeeds (speeds);
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::SetAxialUnits (const char **unitNames)
+  {
+    CrpiTraceSpan span("SetAxialUnits");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->SetAxialUnits (unitNames);
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::SetEndPoseTolerance (robotPose &tolerance)
+  {
+    CrpiTraceSpan span("SetEndPoseTolerance");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->SetEndPoseTolerance (tolerance);
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::SetIntermediatePoseTolerance (robotPose *tolerances)
+  {
+    CrpiTraceSpan span("SetIntermediatePoseTolerance");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->SetIntermediatePoseTolerance (tolerances);
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::SetLengthUnits (const char *unitName)
+  {
+    CrpiTraceSpan span("SetLengthUnits");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->SetLengthUnits (unitName);
+    crpiparams_->status = val;
+
+    if (strcmp(unitName, "meter") == 0)
+    {
+      lengthUnits_ = METER;
+    }
+    else if (strcmp(unitName, "mm") == 0)
+    {
+      lengthUnits_ = MM;
+    }
+    else if (strcmp(unitName, "inch") == 0)
+    {
+      lengthUnits_ = INCH;
+    }
+    else
+    {
+      CANON_FAILURE;
+    }
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::SetParameter (const char *paramName, void *paramVal)
+  {
+    CrpiTraceSpan span("SetParameter");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    if (strcmp(paramName, "io_coalesce") == 0)
+    {
+      //! Handled here for every robot:  outputs already staged are written under the old window
+      if (ioTask_ >= 0)
+      {
+        SensorHub::Instance().RemovePeriodic(ioTask_);
+        ioTask_ = -1;
+      }
+      ulapi_mutex_take(ioMutex_);
+      ioWindow_ = (*((double*)paramVal) > 0.0) ? *((double*)paramVal) : 0.0;
+      if (!ioOpen_)
+      {
+        writeIO();
+      }
+      ulapi_mutex_give(ioMutex_);
+      if (ioWindow_ > 0.0)
+      {
+        ioTask_ = SensorHub::Instance().AddPeriodic(ioTick, this, ioWindow_, HUB_MONITOR);
+      }
+      return span.End(CANON_SUCCESS);
+    }
+    if ((strncmp(paramName, "stream_", 7) == 0) && servo_ != NULL && servo_->Running())
+    {
+      //! The servo task uses the stream settings without a lock
+      return span.End(CANON_REJECT);
+    }
+    if (strcmp(paramName, "stream_servo") == 0)
+    {
+      servoEnabled_ = *((bool*)paramVal);
+      return span.End(CANON_SUCCESS);
+    }
+    if (strcmp(paramName, "stream_servo_key") == 0)
+    {
+      servoKey_ = *((int*)paramVal);
+      return span.End(CANON_SUCCESS);
+    }
+    if (strcmp(paramName, "stream_smoothing") == 0)
+    {
+      //! Handled here for every robot that streams; the limits come from the configuration
+      streamSmooth_ = *((bool*)paramVal);
+      axisPrimed_ = posePrimed_ = false;
+      if (streamSmooth_ && !(axisOtg_ != NULL && axisOtg_->Limited()) && !(poseOtg_ != NULL && poseOtg_->Limited()))
+      {
+        CRPI_LOG(CRPI_LOG_WARNING, "stream_smoothing:  no <JointLimit> or <CartesianLimit> limits configured");
+        streamSmooth_ = false;
+        return span.End(CANON_REJECT);
+      }
+      return span.End(CANON_SUCCESS);
+    }
+    if (strcmp(paramName, "stream_period") == 0 && *((double*)paramVal) > 0.0)
+    {
+      //! Also the step of the smoothing generators; the robot still gets the setting
+      streamPeriod_ = *((double*)paramVal);
+      if (axisOtg_ != NULL)
+      {
+        axisOtg_->SetPeriod(streamPeriod_);
+      }
+      if (poseOtg_ != NULL)
+      {
+        poseOtg_->SetPeriod(streamPeriod_);
+      }
+    }
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->SetParameter (paramName, paramVal);
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::SetRelativeAcceleration (double percent)
+  {
+    CrpiTraceSpan span("SetRelativeAcceleration");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->SetRelativeAcceleration (percent);
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::SetRelativeSpeed (double percent)
+  {
+    CrpiTraceSpan span("SetRelativeSpeed");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    if (watchdog_ != NULL)
+    {
+      //! While the watchdog has the robot slowed down, the new speed is scaled the same way
+      watchdog_->SetCommanded(percent);
+      val = robInterface_->SetRelativeSpeed (watchdog_->Speed());
+    }
+    else
+    {
+      val = robInterface_->SetRelativeSpeed (percent);
+    }
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::SetRobotIO (robotIO &io)
+  {
+    CrpiTraceSpan span("SetRobotIO");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    CanonReturn val;
+    ulapi_mutex_take(ioMutex_);
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->SetRobotIO (io);
+    crpiparams_->status = val;
+    if (val == CANON_SUCCESS)
+    {
+      //! Every output is set, so nothing staged is left to write
+      ioShadow_ = io;
+      doStaged_.reset();
+      aoStaged_.reset();
+    }
+    ulapi_mutex_give(ioMutex_);
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::SetRobotDO (int dig_out, bool val)
+  {
+    CrpiTraceSpan span("SetRobotDO");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    CanonReturn retval;
+    if (ioWindow_ > 0.0)
+    {
+      return span.End(stageIO(false, dig_out, val ? 1.0 : 0.0));
+    }
+    crpiparams_->status = CANON_RUNNING;
+    retval = robInterface_->SetRobotDO (dig_out, val);
+    crpiparams_->status = retval;
+    if (retval == CANON_SUCCESS && dig_out >= 0 && dig_out < CRPI_IO_MAX)
+    {
+      ulapi_mutex_take(ioMutex_);
+      ioShadow_.dio[dig_out] = val;
+      ulapi_mutex_give(ioMutex_);
+    }
+    return span.End(retval);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::BeginIO ()
+  {
+    CanonReturn val = CANON_SUCCESS;
+
+    ulapi_mutex_take(ioMutex_);
+    if (ioOpen_)
+    {
+      val = CANON_REJECT;
+    }
+    ioOpen_ = true;
+    ulapi_mutex_give(ioMutex_);
+    return val;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::SetDO (int dig_out, bool val)
+  {
+    return stageIO(false, dig_out, val ? 1.0 : 0.0);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::SetAO (int ana_out, double val)
+  {
+    return stageIO(true, ana_out, val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::CommitIO ()
+  {
+    CrpiTraceSpan span("CommitIO");
+    CanonReturn val;
+
+    ulapi_mutex_take(ioMutex_);
+    if (!ioOpen_)
+    {
+      ulapi_mutex_give(ioMutex_);
+      return CANON_REJECT;
+    }
+    ioOpen_ = false;
+    val = bypass_ ? CANON_SUCCESS : writeIO();
+    ulapi_mutex_give(ioMutex_);
+    return span.End(val);
+  }
+
+
+  template <class T> CanonReturn CrpiRobot<T>::stageIO (bool analog, int channel, double val)
+  {
+    CanonReturn returnMe = CANON_SUCCESS;
+
+    if (channel < 0 || channel >= CRPI_IO_MAX)
+    {
+      return CANON_REJECT;
+    }
+
+    ulapi_mutex_take(ioMutex_);
+    if (analog)
+    {
+      ioShadow_.aio[channel] = val;
+      aoStaged_.set(channel);
+    }
+    else
+    {
+      ioShadow_.dio[channel] = (val != 0.0);
+      doStaged_.set(channel);
+    }
+    if (!bypass_ && !ioOpen_ && ioWindow_ <= 0.0)
+    {
+      returnMe = writeIO();
+    }
+    ulapi_mutex_give(ioMutex_);
+    return returnMe;
+  }
+
+
+  template <class T> CanonReturn CrpiRobot<T>::writeIO ()
+  {
+    CanonReturn val;
+
+    if (bypass_ || (doStaged_.none() && aoStaged_.none()))
+    {
+      return CANON_SUCCESS;
+    }
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->SetRobotIO (ioShadow_);
+    crpiparams_->status = val;
+    doStaged_.reset();
+    aoStaged_.reset();
+    return val;
+  }
+
+
+  template <class T> void CrpiRobot<T>::flushIO ()
+  {
+    if (ioWindow_ <= 0.0)
+    {
+      return;
+    }
+    ulapi_mutex_take(ioMutex_);
+    if (!ioOpen_)
+    {
+      writeIO();
+    }
+    ulapi_mutex_give(ioMutex_);
+  }
+
+
+  template <class T> void CrpiRobot<T>::ioTick (void *param)
+  {
+    CrpiRobot<T> *robot = (CrpiRobot<T>*)param;
+
+    ulapi_mutex_take(robot->ioMutex_);
+    if (!robot->ioOpen_)
+    {
+      robot->writeIO();
+    }
+    ulapi_mutex_give(robot->ioMutex_);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::StopMotion (int condition)
+  {
+    CrpiTraceSpan span("StopMotion");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->StopMotion (condition);
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+  template <class T> CRPI_ROBOT_API CrpiCompletion CrpiRobot<T>::enqueue (std::function<CanonReturn ()> command)
+  {
+    CrpiCompletion done = CrpiCompletion::create([this] () { return StopMotion(); });
+
+    ulapi_mutex_take(asyncMutex_);
+    if (asyncTask_ == NULL)
+    {
+      asyncRun_ = true;
+      asyncTask_ = ulapi_task_new();
+      ulapi_task_start(asyncTask_, asyncThread, this, ulapi_prio_lowest(), 0);
+    }
+    asyncQueue_.push_back(std::make_pair(command, done));
+    ulapi_cond_signal(asyncCond_);
+    ulapi_mutex_give(asyncMutex_);
+
+    return done;
+  }
+
+
+  template <class T> void CrpiRobot<T>::asyncThread (void *param)
+  {
+    CrpiRobot<T> *robot = (CrpiRobot<T>*)param;
+
+    ulapi_mutex_take(robot->asyncMutex_);
+    while (robot->asyncRun_)
+    {
+      if (robot->asyncQueue_.empty())
+      {
+        ulapi_cond_wait(robot->asyncCond_, robot->asyncMutex_);
+        continue;
+      }
+      std::pair<std::function<CanonReturn ()>, CrpiCompletion> next = robot->asyncQueue_.front();
+      robot->asyncQueue_.pop_front();
+      ulapi_mutex_give(robot->asyncMutex_);
+
+      //! Commands cancelled while queued are skipped
+      if (next.second.start())
+      {
+        next.second.finish(next.first());
+      }
+
+      ulapi_mutex_take(robot->asyncMutex_);
+    }
+    ulapi_mutex_give(robot->asyncMutex_);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CrpiCompletion CrpiRobot<T>::CallAsync (std::function<CanonReturn ()> command)
+  {
+    return enqueue(command);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CrpiCompletion CrpiRobot<T>::MoveToAsync (robotPose &pose)
+  {
+    robotPose target = pose;
+    return enqueue([this, target] () mutable { return MoveTo(target, true); });
+  }
+
+
+  template <class T> CRPI_ROBOT_API CrpiCompletion CrpiRobot<T>::MoveStraightToAsync (robotPose &pose)
+  {
+    robotPose target = pose;
+    return enqueue([this, target] () mutable { return MoveStraightTo(target, true); });
+  }
+
+
+  template <class T> CRPI_ROBOT_API CrpiCompletion CrpiRobot<T>::MoveToAxisTargetAsync (robotAxes &axes)
+  {
+    robotAxes target = axes;
+    return enqueue([this, target] () mutable { return MoveToAxisTarget(target, true); });
+  }
+
+
+  template <class T> CRPI_ROBOT_API CrpiCompletion CrpiRobot<T>::MoveThroughToAsync (robotPose *poses,
+                                                                                 int numPoses,
+                                                                                 robotPose *accelerations,
+                                                                                 robotPose *speeds,
+                                                                                 robotPose *tolerances)
+  {
+    if (poses == NULL || numPoses < 1)
+    {
+      return enqueue([] () { return CANON_REJECT; });
+    }
+
+    //! Optional arrays stay empty (passed on as NULL) when not given
+    vector<robotPose> p(poses, poses + numPoses), a, s, t;
+    if (accelerations != NULL)
+    {
+      a.assign(accelerations, accelerations + numPoses);
+    }
+    if (speeds != NULL)
+    {
+      s.assign(speeds, speeds + numPoses);
+    }
+    if (tolerances != NULL)
+    {
+      t.assign(tolerances, tolerances + numPoses);
+    }
+
+    return enqueue([this, p, a, s, t] () mutable {
+      return MoveThroughTo(&p[0], (int)p.size(),
+                           a.empty() ? NULL : &a[0],
+                           s.empty() ? NULL : &s[0],
+                           t.empty() ? NULL : &t[0]);
+    });
+  }
+
+
+  template <class T> CRPI_ROBOT_API CrpiCompletion CrpiRobot<T>::SetToolAsync (double percent)
+  {
+    return enqueue([this, percent] () { return SetTool(percent); });
+  }
+
+
+  template <class T> CRPI_ROBOT_API CrpiCompletion CrpiRobot<T>::SetRobotIOAsync (robotIO &io)
+  {
+    robotIO target = io;
+    return enqueue([this, target] () mutable { return SetRobotIO(target); });
+  }
+
+
+  template <class T> CRPI_ROBOT_API CrpiCompletion CrpiRobot<T>::SetRobotDOAsync (int dig_out, bool val)
+  {
+    return enqueue([this, dig_out, val] () { return SetRobotDO(dig_out, val); });
+  }
+
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::Orient (robotPose &to, robotPose *out)
+  {
+    CrpiTraceSpan span("Orient");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    CanonReturn val;
+
+    robotPose *curPose = new robotPose();
+    if (GetRobotPose(curPose) != CANON_SUCCESS)
+    {
+      //! Could not get current pose
+      return span.End(CANON_FAILURE);
+    }
+
+    Math::point p0, p1, c;
+    double d, np0, nc, den;
+    Math::matrix z(3, 3);
+    Math::matrix r(3, 3);
+    Math::matrix i(3, 3);
+    Math::matrix num(3, 3);
+
+    i.identity(3);
+
+    p0.x = curPose->x;
+    p0.y = curPose->y;
+    p0.z = curPose->z;
+
+    p1.x = to.x;
+    p1.y = to.y;
+    p1.z = to.z;
+
+    c = p0.cross(p1);
+    d = p0.dot(p1);
+    np0 = p0.norm();
+    nc = c.norm();
+
+    bool is0 = approxEqual(c.x, 0.0f) && approxEqual(c.y, 0.0f) && approxEqual(c.z, 0.0f);
+
+    if (!is0)
+    {
+      try {
+        z.at(0, 0) = 0.0f;
+        z.at(0, 1) = -(c.z);
+        z.at(0, 2) = c.y;
+
+        z.at(1, 0) = c.z;
+        z.at(1, 1) = 0.0f;
+        z.at(1, 2) = -(c.x);
+
+        z.at(2, 0) = -(c.y);
+        z.at(2, 1) = c.x;
+        z.at(2, 2) = 0.0f;
+
+        num = i + z + (z * ((1.0f - d) / (nc * nc)));
+        den = np0 * np0;
+
+        r = num / (np0 * np0);
+      }
+      catch (...)
+      {
+        //! Just in case there's division by zero somewhere
+        return span.End(CANON_FAILURE);
+      }
+    }
+    else
+    {
+      //! Vectors are colinear, probably already pointing in the correct location
+      return span.End(CANON_FAILURE);
+    }
+
+    vector<double> e;
+    r.rotMatrixEulerConvert(e);
+    out->x = curPose->x;
+    out->y = curPose->y;
+    out->z = curPose->z;
+
+    out->xrot = e.at(0);
+    out->yrot = e.at(1);
+    out->zrot = e.at(2);
+
+    return CANON_SUCCESS;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::MoveBase (robotPose &to)
+  {
+    CrpiTraceSpan span("MoveBase");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->MoveBase (to);
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::PointHead (robotPose &to)
+  {
+    CrpiTraceSpan span("PointHead");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    robotPose *toPrime = new robotPose();
+    Orient(to, toPrime);
+    val = robInterface_->PointHead (*toPrime);
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::PointAppendage (CanonRobotAppendage app_ID, 
+                                                                           robotPose &to)
+  {
+    CrpiTraceSpan span("PointAppendage");
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    CanonReturn val;
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->PointAppendage (app_ID, to);
+    crpiparams_->status = val;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::CrclXmlHandler (std::string& str)
+  {
+    CrpiTraceSpan span("CrclXmlHandler");
+    crclxml_->parse(str); //! Populate the params_ structure based on the XML string
+
+    //! Get the CRPI 6DOF pose from the 2-vector representation CRCL uses
+    v1_->i = crpiparams_->xaxis.i;
+    v1_->j = crpiparams_->xaxis.j;
+    v1_->k = crpiparams_->xaxis.k;
+
+    v2_->i = crpiparams_->zaxis.i;
+    v2_->j = crpiparams_->zaxis.j;
+    v2_->k = crpiparams_->zaxis.k;
+
+    v3_->i = -((v1_->j * v2_->k) - (v1_->k * v2_->j));
+    v3_->j = -((v1_->k * v2_->i) - (v1_->i * v2_->k));
+    v3_->k = -((v1_->i * v2_->j) - (v1_->j * v2_->i));
+
+    rotMatrix_->at(0, 0) = v1_->i;
+    rotMatrix_->at(1, 0) = v1_->j;
+    rotMatrix_->at(2, 0) = v1_->k;
+    rotMatrix_->at(0, 1) = v3_->i;
+    rotMatrix_->at(1, 1) = v3_->j;
+    rotMatrix_->at(2, 1) = v3_->k;
+    rotMatrix_->at(0, 2) = v2_->i;
+    rotMatrix_->at(1, 2) = v2_->j;
+    rotMatrix_->at(2, 2) = v2_->k;
+
+    Math::pose ptemp;
+    rotMatrix_->matrixRPYConvert (ptemp, (angleUnits_ == DEGREE));
+    *crpiparams_->pose = ptemp;
+
+    switch (crpiparams_->cmd)
+    {
+    case CmdCouple:
+      return span.End(Couple (crpiparams_->str.c_str()));
+      break;
+    case CmdDwell:
+      //! No equivalent in CRPI
+      return span.End(CANON_REJECT);
+      break;
+    case CmdEndCanon:
+      //! No equivalence in CRPI
+      return span.End(CANON_REJECT);
+      break;
+    case CmdGetRobotAxes:
+      return span.End(GetRobotAxes (crpiparams_->axes));
+      break;
+    case CmdGetRobotIO:
+      return span.End(GetRobotIO(crpiparams_->io));
+      break;
+    case CmdGetRobotPose:
+      return span.End(GetRobotPose (crpiparams_->pose));
+      break;
+    case CmdInitCanon:
+      //! No equivalence in CRPI
+      return span.End(CANON_REJECT);
+      break;
+    case CmdMessage:
+      return span.End(Message (crpiparams_->str.c_str()));
+      break;
+    case CmdMoveAttractor:
+      return span.End(MoveAttractor (*crpiparams_->pose));
+      break;
+    case CmdMoveStraightTo:
+      return span.End(MoveStraightTo (*crpiparams_->pose));
+      break;
+    case CmdMoveThroughTo:
+      break;
+    case CmdMoveTo:
+      if (crpiparams_->moveStraight)
+      {
+        return span.End(MoveStraightTo (*crpiparams_->pose));
+      }
+      else
+      {
+        return span.End(MoveTo (*crpiparams_->pose));
+      }
+      break;
+    case CmdMoveToAxisTarget:
+      return span.End(MoveToAxisTarget (*crpiparams_->axes));
+      break;
+    case CmdRunProgram:
+      //! JAM: No CRPI equivalent
+      return span.End(CANON_REJECT);
+      break;
+    case CmdSetAbsoluteAcceleration:
+      return span.End(SetAbsoluteAcceleration (crpiparams_->numPositions));
+      break;
+    case CmdSetAbsoluteSpeed:
+      return span.End(SetAbsoluteSpeed (crpiparams_->numPositions));
+      break;
+    case CmdSetAngleUnits:
+      return span.End(SetAngleUnits (crpiparams_->str.c_str()));
+      break;
+    case CmdSetAxialSpeeds:
+      //! JAM: TODO
+      break;
+    case CmdSetAxialUnits:
+      //! JAM: TODO
+      break;
+    case CmdSetEndPoseTolerance:
+      break;
+    case CmdSetIntermediatePoseTolerance:
+      break;
+    case CmdSetLengthUnits:
+      return span.End(SetLengthUnits (crpiparams_->str.c_str()));
+      break;
+    case CmdSetParameter:
+      //! TODO
+//      SetParameter (params_->str.c_str(), *(crpiparams_->numPositions));
+      break;
+    case CmdSetRelativeAcceleration:
+      return span.End(SetRelativeAcceleration (crpiparams_->numPositions));
+      break;
+    case CmdSetRelativeSpeed:
+      return span.End(SetRelativeSpeed (crpiparams_->numPositions));
+      break;
+    case CmdSetRobotIO:
+      break;
+    case CmdSetTool:
+      return span.End(SetTool (crpiparams_->setting));
+      break;
+    case CmdStopMotion:
+      //! JAM: TODO
+      break;
+    default:
+      return span.End(CANON_REJECT);
+      break;
+    }
+     return CANON_SUCCESS;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::CrclXmlResponse (char *str)
+  {
+    crpiparams_->counter += 1;
+    crclxml_->encode(str);
+    return CANON_SUCCESS;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::CrclXmlResponse (CrpiXmlWriter &out)
+  {
+    crpiparams_->counter += 1;
+    if (crclxml_->encode(out))
+    {
+      return CANON_SUCCESS;
+    }
+    return CANON_FAILURE;
+  }
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::CrpiXmlHandler (std::string& str)
+  {
+    CrpiTraceSpan span("CrpiXmlHandler");
+    CanonReturn result = CANON_SUCCESS;
+    int dispatched = 0;
+
+    //! Populate the params_ structure based on the XML string, running each command as it
+    //! closes.  The batch stops at the first command that does not succeed.
+    crpixml_->parse(str, [&] () -> bool
+    {
+      ++dispatched;
+      result = CrpiDispatch();
+      return (result == CANON_SUCCESS);
+    });
+
+    if (dispatched == 0)
+    {
+      //! A self-closing or unterminated command
+      result = CrpiDispatch();
+    }
+    return span.End(result);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::CrpiBinaryHandler (const char *buf, size_t len)
+  {
+    CrpiTraceSpan span("CrpiBinaryHandler");
+    //! Populate the params_ structure based on the binary frame
+    if (!crpibin_->decode(buf, len))
+    {
+      crpiparams_->status = CANON_REJECT;
+      return span.End(CANON_REJECT);
+    }
+    return span.End(CrpiDispatch());
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::CrpiDispatch ()
+  {
+    const CrpiCommandEntry<T> *entry = CrpiCommandRegistry<T>::Find(crpiparams_->cmd);
+    if (entry == NULL)
+    {
+      return CANON_REJECT;
+    }
+
+    CrpiTraceSpan span(entry->name, CRPI_TRACE_DISPATCH);
+    return span.End(entry->run(*this, *crpiparams_));
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::CrpiXmlResponse (char *str)
+  {
+    crpiparams_->counter += 1;
+    if (crpixml_->encode(str))
+    {
+      return CANON_SUCCESS;
+    }
+    return CANON_FAILURE;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::CrpiXmlResponse (CrpiXmlWriter &out)
+  {
+    crpiparams_->counter += 1;
+    if (crpixml_->encode(out))
+    {
+      return CANON_SUCCESS;
+    }
+    return CANON_FAILURE;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::CrpiBinaryResponse (char *buf, size_t max, size_t &len)
+  {
+    crpiparams_->counter += 1;
+    len = crpibin_->encode(buf, max);
+    return (len > 0) ? CANON_SUCCESS : CANON_FAILURE;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::LoadProgram (const std::string &xml,
+                                                                         CrpiCompiledProgram &program,
+                                                                         bool worldFrame)
+  {
+    CrpiTraceSpan span("LoadProgram");
+    CrpiProgramCompiler compiler;
+    CanonAngleUnit units = angleUnits_;
+    vector<robotPose> poses;
+    vector<size_t> index;
+    size_t i, j;
+    bool flag = true;
+
+    if (!compiler.compile (xml, program, (angleUnits_ == DEGREE)))
+    {
+      return span.End(CANON_REJECT);
+    }
+
+    if (!worldFrame)
+    {
+      return CANON_SUCCESS;
+    }
+
+    //! Project the motion targets into the robot frame in batches, one batch for each run of
+    //! steps sharing the same angle units
+    for (i = 0; i <= program.steps.size(); ++i)
+    {
+      if (i == program.steps.size() || program.steps[i].cmd == CmdSetAngleUnits)
+      {
+        if (!poses.empty())
+        {
+          flag &= (FromWorldBatch (&poses[0], &poses[0], poses.size()) == CANON_SUCCESS);
+          for (j = 0; j < index.size(); ++j)
+          {
+            program.steps[index[j]].pose = poses[j];
+          }
+          poses.clear();
+          index.clear();
+        }
+
+        if (i < program.steps.size())
+        {
+          const std::string &unitName = program.strings[program.steps[i].integer];
+          if (strcmp (unitName.c_str(), "degree") == 0)
+          {
+            angleUnits_ = DEGREE;
+          }
+          else if (strcmp (unitName.c_str(), "radian") == 0)
+          {
+            angleUnits_ = RADIAN;
+          }
+        }
+      }
+      else if (program.steps[i].cmd == CmdMoveTo ||
+               program.steps[i].cmd == CmdMoveStraightTo ||
+               program.steps[i].cmd == CmdMoveAttractor)
+      {
+        poses.push_back (program.steps[i].pose);
+        index.push_back (i);
+      }
+    }
+    angleUnits_ = units;
+
+    return span.End(flag ? CANON_SUCCESS : CANON_FAILURE);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::RunProgram (CrpiCompiledProgram &program)
+  {
+    CrpiTraceSpan span("RunProgram");
+    robotPose window[CRPI_PROGRAM_LOOKAHEAD];
+    CanonReturn val;
+    size_t num;
+
+    while (program.next < program.steps.size())
+    {
+      const CrpiProgramStep &step = program.steps[program.next];
+
+      if (step.cmd == CmdMoveTo || step.cmd == CmdMoveStraightTo)
+      {
+        //! Look ahead for following moves of the same type so the robot can blend through them
+        for (num = 0; num < CRPI_PROGRAM_LOOKAHEAD &&
+                      (program.next + num) < program.steps.size() &&
+                      program.steps[program.next + num].cmd == step.cmd; ++num)
+        {
+          window[num] = program.steps[program.next + num].pose;
+        }
+        crpiparams_->commandID = program.steps[program.next + num - 1].commandID;
+
+        if (num == 1)
+        {
+          val = (step.cmd == CmdMoveTo) ? MoveTo (window[0]) : MoveStraightTo (window[0]);
+        }
+        else
+        {
+          val = MoveThroughTo (window, (int)num, NULL, NULL, NULL);
+        }
+      }
+      else
+      {
+        num = 1;
+        crpiparams_->commandID = step.commandID;
+        val = RunProgramStep (step, program);
+      }
+
+      if (val != CANON_SUCCESS)
+      {
+        return span.End(val);
+      }
+      program.next += num;
+    }
+
+    return CANON_SUCCESS;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::CompileNative (CrpiCompiledProgram &program,
+                                                                           std::string &text)
+  {
+    CrpiTraceSpan span("CompileNative");
+    crpiNativeProgram native;
+    CanonReturn val;
+
+    native.program = &program;
+    val = robInterface_->SetParameter ("native_program", &native);
+    text = native.text;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::RunNative (CrpiCompiledProgram &program)
+  {
+    CrpiTraceSpan span("RunNative");
+    crpiNativeProgram native;
+    size_t start = program.next;
+    CanonReturn val;
+
+    if (bypass_)
+    {
+      return CANON_SUCCESS;
+    }
+    flushIO();
+
+    native.program = &program;
+    native.run = true;
+    native.progress = [this, &program, start] (size_t done)
+    {
+      program.next = start + done;
+      if (done > 0)
+      {
+        crpiparams_->commandID = program.steps[start + done - 1].commandID;
+      }
+    };
+
+    crpiparams_->status = CANON_RUNNING;
+    val = robInterface_->SetParameter ("native_program", &native);
+    crpiparams_->status = val;
+    program.next = start + native.completed;
+    return span.End(val);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::RunProgramStep (const CrpiProgramStep &step,
+                                                                            CrpiCompiledProgram &program)
+  {
+    robotPose pose;
+    crpi_timer timer;
+
+    switch (step.cmd)
+    {
+    case CmdCouple:
+      return Couple (program.strings[step.integer].c_str());
+      break;
+    case CmdDwell:
+      timer.waitUntil (step.real * 1000.0f);
+      break;
+    case CmdEndCanon:
+    case CmdInitCanon:
+      //! No equivalent in CRPI
+      break;
+    case CmdGetRobotAxes:
+      return GetRobotAxes (crpiparams_->axes);
+      break;
+    case CmdGetRobotIO:
+      return GetRobotIO (crpiparams_->io);
+      break;
+    case CmdGetRobotPose:
+      return GetRobotPose (crpiparams_->pose);
+      break;
+    case CmdMessage:
+      return Message (program.strings[step.integer].c_str());
+      break;
+    case CmdMoveAttractor:
+      pose = step.pose;
+      return MoveAttractor (pose);
+      break;
+    case CmdMoveStraightTo:
+      pose = step.pose;
+      return MoveStraightTo (pose);
+      break;
+    case CmdMoveTo:
+      pose = step.pose;
+      return MoveTo (pose);
+      break;
+    case CmdMoveToAxisTarget:
+      return MoveToAxisTarget (program.axes[step.integer]);
+      break;
+    case CmdSaveConfig:
+      return SaveConfig (program.strings[step.integer].c_str());
+      break;
+    case CmdSetAbsoluteAcceleration:
+      return SetAbsoluteAcceleration (step.real);
+      break;
+    case CmdSetAbsoluteSpeed:
+      return SetAbsoluteSpeed (step.real);
+      break;
+    case CmdSetAngleUnits:
+      return SetAngleUnits (program.strings[step.integer].c_str());
+      break;
+    case CmdSetLengthUnits:
+      return SetLengthUnits (program.strings[step.integer].c_str());
+      break;
+    case CmdSetRelativeAcceleration:
+      return SetRelativeAcceleration (step.real);
+      break;
+    case CmdSetRelativeSpeed:
+      return SetRelativeSpeed (step.real);
+      break;
+    case CmdSetRobotDO:
+      return SetRobotDO (step.integer, step.boolean);
+      break;
+    case CmdSetTool:
+      return SetTool (step.real);
+      break;
+    case CmdSetAxialSpeeds:
+    case CmdSetAxialUnits:
+    case CmdSetEndPoseTolerance:
+    case CmdSetIntermediatePoseTolerance:
+    case CmdSetParameter:
+    case CmdStopMotion:
+      //! TODO: same as the interactive command handlers
+      break;
+    default:
+      return CANON_REJECT;
+      break;
+    }
+    return CANON_SUCCESS;
+  }
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::ToWorldMatrix (matrix & R_T_W)
+  {
+    R_T_W.resize(4,4);
+
+    for (int iterator1=0; iterator1<4; ++iterator1)
+    {
+      for (int iterator2=0; iterator2<4; ++iterator2)
+      {
+        R_T_W.at(iterator1,iterator2) = robotparams_->toWorldMatrix->at(iterator1,iterator2);
+      }
+    }
+
+    return CANON_SUCCESS;
+  }
+
+
+  //! @brief Apply a homogeneous transform to a batch of poses
+  //!
+  //! @param t          The 4x4 homogeneous transform to apply
+  //! @param in         The poses to be transformed
+  //! @param out        The transformed poses (may be the same array as in)
+  //! @param count      The number of poses in in and out
+  //! @param degrees    Whether pose orientations are given in degrees
+  //! @param keepConfig Whether to copy the status and turns of each input pose (otherwise cleared)
+  //!
+  static inline bool transformPoses (const Math::Mat4 &t,
+                                     const robotPose *in,
+                                     robotPose *out,
+                                     size_t count,
+                                     bool degrees,
+                                     bool keepConfig)
+  {
+    Math::Mat4 inm, outm;
+    Math::pose ptemp;
+    bool flag = true;
+    int status, turns;
+
+    inm.at(3,3) = 1;
+    for (size_t i = 0; i < count; ++i)
+    {
+      ptemp.x = in[i].x;
+      ptemp.y = in[i].y;
+      ptemp.z = in[i].z;
+      ptemp.xr = in[i].xrot;
+      ptemp.yr = in[i].yrot;
+      ptemp.zr = in[i].zrot;
+      status = in[i].status;
+      turns = in[i].turns;
+
+      flag &= inm.RPYMatrixConvert(ptemp, degrees);
+      inm.at(0,3) = in[i].x;
+      inm.at(1,3) = in[i].y;
+      inm.at(2,3) = in[i].z;
+      outm = t * inm;
+      flag &= outm.matrixRPYConvert(ptemp, degrees);
+      out[i] = ptemp;
+      if (keepConfig)
+      {
+        out[i].status = status;
+        out[i].turns = turns;
+      }
+    }
+    return flag;
+  }
+
+
+  template <class T> bool CrpiRobot<T>::updateTransformCache ()
+  {
+    bool flag = true;
+    size_t i;
+
+    if (!worldCacheValid_)
+    {
+      Math::Mat4 w(*robotparams_->toWorldMatrix), winv;
+      flag &= w.inv(winv);
+#ifdef DOITRIGHTTHISTIME
+      toWorldCache_ = w;
+      fromWorldCache_ = winv;
+#else
+      toWorldCache_ = winv;
+      fromWorldCache_ = w;
+#endif
+      worldCacheValid_ = flag;
+    }
+
+    if (!systemCacheValid_)
+    {
+      bool sysflag = true;
+      toSystemCache_.resize(robotparams_->toCoordSystMatrices.size());
+      fromSystemCache_.resize(robotparams_->toCoordSystMatrices.size());
+      for (i = 0; i < robotparams_->toCoordSystMatrices.size(); ++i)
+      {
+        Math::Mat4 s(*robotparams_->toCoordSystMatrices.at(i)), sinv;
+        sysflag &= s.inv(sinv);
+#ifdef DOITRIGHTTHISTIME
+        toSystemCache_[i] = s;
+        fromSystemCache_[i] = sinv;
+#else
+        toSystemCache_[i] = sinv;
+        fromSystemCache_[i] = s;
+#endif
+      }
+      systemCacheValid_ = sysflag;
+      flag &= sysflag;
+    }
+
+    return flag;
+  }
+
+
+  template <class T> int CrpiRobot<T>::findSystem (const char *name)
+  {
+    FrameHandle pos = robotparams_->findSystem (name);
+    return validSystem (pos) ? pos : -1;
+  }
+
+
+  template <class T> bool CrpiRobot<T>::validSystem (FrameHandle system) const
+  {
+    return (system >= 0 && system < (int)robotparams_->coordSystNames.size() &&
+            system < (int)robotparams_->toCoordSystMatrices.size());
+  }
+
+
+  template <class T> CRPI_ROBOT_API FrameHandle CrpiRobot<T>::LookupSystem (const char *name)
+  {
+    return findSystem (name);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::ToWorld (robotPose *in, robotPose *out)
+  {
+    CRPI_NO_ALLOC_SCOPE("ToWorld");
+    return ToWorldBatch (in, out, 1);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::FromWorld (robotPose *in, robotPose *out)
+  {
+    return FromWorldBatch (in, out, 1);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::ToSystem (const char *name,
+                                                                     robotPose *in,
+                                                                     robotPose *out)
+  {
+    return ToSystemBatch (name, in, out, 1);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::FromSystem (const char *name,
+                                                                       robotPose *in,
+                                                                       robotPose *out)
+  {
+    return FromSystemBatch (name, in, out, 1);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::ToSystem (FrameHandle system,
+                                                                     robotPose *in,
+                                                                     robotPose *out)
+  {
+    return ToSystemBatch (system, in, out, 1);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::FromSystem (FrameHandle system,
+                                                                       robotPose *in,
+                                                                       robotPose *out)
+  {
+    return FromSystemBatch (system, in, out, 1);
+  }
+
+
+  //! @brief Apply a registration map to a batch of poses, each with the transform at its position
+  //!
+  static inline bool transformPosesMapped (const Math::RegistrationMap &map,
+                                           const robotPose *in,
+                                           robotPose *out,
+                                           size_t count,
+                                           bool degrees,
+                                           bool keepConfig)
+  {
+    Math::Mat4 t;
+    Math::point pos;
+    bool flag = true;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      pos.x = in[i].x;
+      pos.y = in[i].y;
+      pos.z = in[i].z;
+      flag &= map.lookup(pos, t);
+      flag &= transformPoses(t, &in[i], &out[i], 1, degrees, keepConfig);
+    }
+    return flag;
+  }
+
+
+  //! @brief Apply a registration map to a batch of points
+  //!
+  static inline void transformPointsMapped (const Math::RegistrationMap &map,
+                                            const Math::point *in,
+                                            Math::point *out,
+                                            size_t count)
+  {
+    Math::Mat4 t;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      map.lookup(in[i], t);
+      Math::transformPoints(t, &in[i], &out[i], 1);
+    }
+  }
+
+
+  //! @brief Apply a registration map to a point cloud (out may be the cloud viewed by in)
+  //!
+  static inline void transformPointsMapped (const Math::RegistrationMap &map,
+                                            const Math::PointCloudView &in,
+                                            Math::PointCloud &out)
+  {
+    Math::Mat4 t;
+    Math::point pt;
+
+    if (out.x() != in.x)
+    {
+      out.resize(in.count);
+    }
+    for (size_t i = 0; i < in.count; ++i)
+    {
+      pt = in[i];
+      map.lookup(pt, t);
+      Math::transformPoints(t, &pt, &pt, 1);
+      out.set(i, pt);
+    }
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::ToWorldBatch (const robotPose *in,
+                                                                         robotPose *out,
+                                                                         size_t count)
+  {
+    if (toWorldMap_->valid())
+    {
+      return transformPosesMapped(*toWorldMap_, in, out, count, (angleUnits_ == DEGREE), false) ?
+             CANON_SUCCESS : CANON_FAILURE;
+    }
+    if (!updateTransformCache () && !worldCacheValid_)
+    {
+      return CANON_FAILURE;
+    }
+    if (transformPoses(toWorldCache_, in, out, count, (angleUnits_ == DEGREE), false))
+    {
+      return CANON_SUCCESS;
+    }
+    return CANON_FAILURE;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::FromWorldBatch (const robotPose *in,
+                                                                           robotPose *out,
+                                                                           size_t count)
+  {
+    if (fromWorldMap_->valid())
+    {
+      return transformPosesMapped(*fromWorldMap_, in, out, count, (angleUnits_ == DEGREE), true) ?
+             CANON_SUCCESS : CANON_FAILURE;
+    }
+    if (!updateTransformCache () && !worldCacheValid_)
+    {
+      return CANON_FAILURE;
+    }
+    if (transformPoses(fromWorldCache_, in, out, count, (angleUnits_ == DEGREE), true))
+    {
+      return CANON_SUCCESS;
+    }
+    return CANON_FAILURE;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::ToWorldPoints (const Math::point *in,
+                                                                          Math::point *out,
+                                                                          size_t count)
+  {
+    if (toWorldMap_->valid())
+    {
+      transformPointsMapped(*toWorldMap_, in, out, count);
+      return CANON_SUCCESS;
+    }
+    if (!updateTransformCache () && !worldCacheValid_)
+    {
+      return CANON_FAILURE;
+    }
+    Math::transformPoints(toWorldCache_, in, out, count);
+    return CANON_SUCCESS;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::FromWorldPoints (const Math::point *in,
+                                                                            Math::point *out,
+                                                                            size_t count)
+  {
+    if (fromWorldMap_->valid())
+    {
+      transformPointsMapped(*fromWorldMap_, in, out, count);
+      return CANON_SUCCESS;
+    }
+    if (!updateTransformCache () && !worldCacheValid_)
+    {
+      return CANON_FAILURE;
+    }
+    Math::transformPoints(fromWorldCache_, in, out, count);
+    return CANON_SUCCESS;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::ToWorldPoints (const Math::PointCloudView &in,
+                                                                          Math::PointCloud &out)
+  {
+    if (toWorldMap_->valid())
+    {
+      transformPointsMapped(*toWorldMap_, in, out);
+      return CANON_SUCCESS;
+    }
+    if (!updateTransformCache () && !worldCacheValid_)
+    {
+      return CANON_FAILURE;
+    }
+    Math::transformPoints(toWorldCache_, in, out);
+    return CANON_SUCCESS;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::FromWorldPoints (const Math::PointCloudView &in,
+                                                                            Math::PointCloud &out)
+  {
+    if (fromWorldMap_->valid())
+    {
+      transformPointsMapped(*fromWorldMap_, in, out);
+      return CANON_SUCCESS;
+    }
+    if (!updateTransformCache () && !worldCacheValid_)
+    {
+      return CANON_FAILURE;
+    }
+    Math::transformPoints(fromWorldCache_, in, out);
+    return CANON_SUCCESS;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::ToSystemBatch (const char *name,
+                                                                          const robotPose *in,
+                                                                          robotPose *out,
+                                                                          size_t count)
+  {
+    return ToSystemBatch (findSystem (name), in, out, count);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::FromSystemBatch (const char *name,
+                                                                            const robotPose *in,
+                                                                            robotPose *out,
+                                                                            size_t count)
+  {
+    return FromSystemBatch (findSystem (name), in, out, count);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::ToSystemBatch (FrameHandle system,
+                                                                          const robotPose *in,
+                                                                          robotPose *out,
+                                                                          size_t count)
+  {
+    if (!validSystem (system) || (!updateTransformCache () && !systemCacheValid_))
+    {
+      return CANON_FAILURE;
+    }
+    if (transformPoses(toSystemCache_.at(system), in, out, count, (angleUnits_ == DEGREE), false))
+    {
+      return CANON_SUCCESS;
+    }
+    return CANON_FAILURE;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::FromSystemBatch (FrameHandle system,
+                                                                            const robotPose *in,
+                                                                            robotPose *out,
+                                                                            size_t count)
+  {
+    if (!validSystem (system) || (!updateTransformCache () && !systemCacheValid_))
+    {
+      return CANON_FAILURE;
+    }
+    if (transformPoses(fromSystemCache_.at(system), in, out, count, (angleUnits_ == DEGREE), false))
+    {
+      return CANON_SUCCESS;
+    }
+    return CANON_FAILURE;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::ToSystemMatrix(const char *name, matrix & R_T_W)
+  {
+    R_T_W.resize(4, 4);
+
+    int pos = findSystem (name);
+    if (pos < 0)
+    {
+      return CANON_FAILURE;
+    }
+
+    for (int iterator1 = 0; iterator1<4; ++iterator1)
+    {
+      for (int iterator2 = 0; iterator2<4; ++iterator2)
+      {
+        R_T_W.at(iterator1, iterator2) = robotparams_->toCoordSystMatrices.at(pos)->at(iterator1, iterator2);
+      }
+    }
+
+    return CANON_SUCCESS;
+  }
+
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::UpdateWorldTransform(robotPose &newToWorld)
+  {
+    worldCacheValid_ = false;
+    waypoints_->Invalidate(CRPI_FRAME_WORLD);
+    *(robotparams_->toWorld) = newToWorld;
+    Math::pose ptemp = newToWorld.pose();
+    if (robotparams_->toWorldMatrix->RPYMatrixConvert(ptemp, (angleUnits_ == DEGREE)))
+    {
+      return CANON_SUCCESS;
+    }
+
+    return CANON_FAILURE;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::UpdateWorldTransform (matrix &newToWorld)
+  {
+    worldCacheValid_ = false;
+    waypoints_->Invalidate(CRPI_FRAME_WORLD);
+    *(robotparams_->toWorldMatrix) = newToWorld;
+    Math::pose ptemp;
+    if (robotparams_->toWorldMatrix->matrixRPYConvert(ptemp, (angleUnits_ == DEGREE)))
+    {
+      *robotparams_->toWorld = ptemp;
+      return CANON_SUCCESS;
+    }
+    return CANON_FAILURE;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::LoadWorldMaps (const char *toWorld,
+                                                                          const char *fromWorld)
+  {
+    bool state = true;
+
+    toWorldMap_->clear();
+    fromWorldMap_->clear();
+    waypoints_->Invalidate(CRPI_FRAME_WORLD);
+    if (toWorld != NULL)
+    {
+      state &= toWorldMap_->load(toWorld);
+    }
+    if (fromWorld != NULL)
+    {
+      state &= fromWorldMap_->load(fromWorld);
+    }
+    return state ? CANON_SUCCESS : CANON_FAILURE;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::UpdateSystemTransform (const char *name,
+                                                                                  robotPose &newToSystem)
+  {
+    FrameHandle pos = robotparams_->findSystem (name);
+    string newname;
+    Math::matrix *newmatrix;
+
+    if (pos != CRPI_NO_HANDLE)
+    {
+      //! Update existing coordinate system transformation
+      return UpdateSystemTransform (pos, newToSystem);
+    }
+    else
+    {
+      //! Could not find specified system.  A new one is added to the list of heterogeneous transforms.
+      systemCacheValid_ = false;
+      newname = name;
+      robotparams_->coordSystNames.push_back(newname);
+      newmatrix = new Math::matrix(4, 4);
+      robotparams_->toCoordSystPoses.push_back(newToSystem);
+      Math::pose ptemp = newToSystem.pose();
+      if (newmatrix->RPYMatrixConvert(ptemp, (angleUnits_ == DEGREE)))
+      {
+        robotparams_->toCoordSystMatrices.push_back(newmatrix);
+        return CANON_SUCCESS;
+      }
+      return CANON_FAILURE;
+    }
+  }
+
+  
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::UpdateSystemTransform (const char *name,
+                                                                                  Math::matrix &newToSystem)
+  {
+    FrameHandle pos = robotparams_->findSystem (name);
+    string newname;
+    robotPose newpose;
+    Math::matrix *newmatrix;
+
+    if (pos != CRPI_NO_HANDLE)
+    {
+      //! Update existing coordinate system transformation
+      return UpdateSystemTransform (pos, newToSystem);
+    }
+    else
+    {
+      //! Could not find specified system.  A new one is added to the list of heterogeneous transforms.
+      systemCacheValid_ = false;
+      newname = name;
+      robotparams_->coordSystNames.push_back(newname);
+      newmatrix = new Math::matrix(4, 4);
+      *newmatrix = newToSystem;
+      robotparams_->toCoordSystMatrices.push_back(newmatrix);
+      Math::pose ptemp;
+      if (newmatrix->matrixRPYConvert(ptemp, (angleUnits_ == DEGREE)))
+      {
+        newpose = ptemp;
+        robotparams_->toCoordSystPoses.push_back(newpose);
+        return CANON_SUCCESS;
+      }
+      return CANON_FAILURE;
+    }
+  }
+  
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::UpdateSystemTransform (FrameHandle system,
+                                                                                  robotPose &newToSystem)
+  {
+    if (!validSystem (system))
+    {
+      return CANON_REJECT;
+    }
+    systemCacheValid_ = false;
+    waypoints_->Invalidate(system);
+    robotparams_->toCoordSystPoses.at(system) = newToSystem;
+    Math::pose ptemp = newToSystem.pose();
+    if (robotparams_->toCoordSystMatrices.at(system)->RPYMatrixConvert(ptemp, (angleUnits_ == DEGREE)))
+    {
+      return CANON_SUCCESS;
+    }
+    return CANON_FAILURE;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::UpdateSystemTransform (FrameHandle system,
+                                                                                  Math::matrix &newToSystem)
+  {
+    if (!validSystem (system))
+    {
+      return CANON_REJECT;
+    }
+    systemCacheValid_ = false;
+    waypoints_->Invalidate(system);
+    *(robotparams_->toCoordSystMatrices.at(system)) = newToSystem;
+    Math::pose ptemp;
+    if (robotparams_->toCoordSystMatrices.at(system)->matrixRPYConvert(ptemp, (angleUnits_ == DEGREE)))
+    {
+      robotparams_->toCoordSystPoses.at(system) = ptemp;
+      return CANON_SUCCESS;
+    }
+    return CANON_FAILURE;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::LoadWaypoints (const char *path)
+  {
+    return waypoints_->Load(path) ? CANON_SUCCESS : CANON_FAILURE;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CrpiWaypoints &CrpiRobot<T>::Waypoints ()
+  {
+    return *waypoints_;
+  }
+
+
+  template <class T> CRPI_ROBOT_API WaypointHandle CrpiRobot<T>::LookupWaypoint (const char *name)
+  {
+    return waypoints_->Find(name);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::GetWaypoint (WaypointHandle wp,
+                                                                        robotPose &pose)
+  {
+    if (!waypoints_->Valid(wp))
+    {
+      return CANON_REJECT;
+    }
+    FrameHandle &frame = waypoints_->frame(wp);
+    if (frame == CRPI_NO_HANDLE)
+    {
+      //! Resolved once; the system may have been added since the waypoint was
+      frame = findSystem(waypoints_->Frame(wp));
+    }
+    return (frame == CRPI_NO_HANDLE) ? CANON_REJECT : GetWaypoint(wp, frame, pose);
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::GetWaypoint (WaypointHandle wp,
+                                                                        FrameHandle system,
+                                                                        robotPose &pose)
+  {
+    CanonReturn state = CANON_SUCCESS;
+    bool valid;
+
+    if (!waypoints_->Valid(wp) ||
+        (system != CRPI_FRAME_ROBOT && system != CRPI_FRAME_WORLD && !validSystem(system)))
+    {
+      return CANON_REJECT;
+    }
+    if (system == CRPI_FRAME_ROBOT)
+    {
+      pose = waypoints_->Pose(wp);
+      return CANON_SUCCESS;
+    }
+
+    //! The whole table is converted at once, the first time any of it is needed
+    robotPose *column = waypoints_->cache(system, valid);
+    if (!valid)
+    {
+      state = (system == CRPI_FRAME_WORLD) ?
+              FromWorldBatch(waypoints_->poses(), column, waypoints_->Size()) :
+              FromSystemBatch(system, waypoints_->poses(), column, waypoints_->Size());
+      if (state == CANON_SUCCESS)
+      {
+        waypoints_->validate(system);
+      }
+    }
+    if (state == CANON_SUCCESS)
+    {
+      pose = column[wp];
+    }
+    return state;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::GetWaypoint (const char *name,
+                                                                        robotPose &pose)
+  {
+    return GetWaypoint(waypoints_->Find(name), pose);
+  }
+
+
+  template <class T> bool CrpiRobot<T>::loadConfig (const char *path, CrpiRobotParams *params)
+  {
+    ifstream inputs(path, ios::in | ios::binary);
+    if (!inputs)
+    {
+      return false;
+    }
+    stringstream grabbyGrabby;
+    grabbyGrabby << inputs.rdbuf();
+    inputs.close();
+
+    //! Lines are joined as if they had been read one at a time
+    string config = grabbyGrabby.str();
+    config.erase(remove(config.begin(), config.end(), '\n'), config.end());
+    config.erase(remove(config.begin(), config.end(), '\r'), config.end());
+
+    CRPI_LOG(CRPI_LOG_DEBUG, "%s", config.c_str());
+
+    //! Parsing is skipped when the compiled cache of this exact configuration is available
+    CrpiRobotCache cache(params);
+    if (!cache.load(path, config))
+    {
+      CrpiRobotXml robXML(params);
+      robXML.parse(config);
+
+      if (!params->usedMatrix)
+      {
+        CRPI_LOG(CRPI_LOG_DEBUG, "no matrix used");
+        //! Update to matrix representation.  The converted matrix is kept in the cache rather
+        //! than written back into the configuration file.
+        Math::pose ptemp = params->toWorld->pose();
+        params->toWorldMatrix->RPYMatrixConvert(ptemp, true);
+      }
+
+      //! Failing to write the cache (e.g., a read-only directory) only costs a parse next time
+      cache.save(path, config);
+    }
+    return true;
+  }
+
+
+  //! @brief Whether two poses are the same to within approxEqual
+  //!
+  inline bool samePose (const robotPose &a, const robotPose &b)
+  {
+    return approxEqual(a.x, b.x) && approxEqual(a.y, b.y) && approxEqual(a.z, b.z) &&
+           approxEqual(a.xrot, b.xrot) && approxEqual(a.yrot, b.yrot) && approxEqual(a.zrot, b.zrot);
+  }
+
+
+  //! @brief Whether two matrices are the same to within approxEqual
+  //!
+  inline bool sameMatrix (Math::matrix &a, Math::matrix &b)
+  {
+    int r, c;
+    if (a.rows != b.rows || a.cols != b.cols)
+    {
+      return false;
+    }
+    for (r = 0; r < a.rows; ++r)
+    {
+      for (c = 0; c < a.cols; ++c)
+      {
+        if (!approxEqual(a.at(r, c), b.at(r, c)))
+        {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::ReloadConfig (const char *path, unsigned int *changed)
+  {
+    CrpiRobotParams fresh;
+    unsigned int parts = 0;
+    bool same;
+    size_t i;
+
+    if (changed != NULL)
+    {
+      *changed = 0;
+    }
+
+    //! Everything is parsed before anything is applied, so a missing file changes nothing
+    if (!loadConfig(path, &fresh))
+    {
+      for (i = 0; i < fresh.toCoordSystMatrices.size(); ++i)
+      {
+        delete fresh.toCoordSystMatrices[i];
+      }
+      delete fresh.mounting;
+      delete fresh.toWorld;
+      delete fresh.toWorldMatrix;
+      return CANON_FAILURE;
+    }
+
+    //! Connections are only made by the constructor:  reported, not applied
+    if (strcmp(fresh.tcp_ip_addr, robotparams_->tcp_ip_addr) != 0 || fresh.tcp_ip_port != robotparams_->tcp_ip_port ||
+        fresh.tcp_ip_client != robotparams_->tcp_ip_client || fresh.tcp_ip_unit != robotparams_->tcp_ip_unit ||
+        strcmp(fresh.obs_tcp_ip_addr, robotparams_->obs_tcp_ip_addr) != 0 ||
+        fresh.obs_tcp_ip_port != robotparams_->obs_tcp_ip_port ||
+        fresh.obs_tcp_ip_client != robotparams_->obs_tcp_ip_client ||
+        strcmp(fresh.serial_port, robotparams_->serial_port) != 0 || fresh.serial_rate != robotparams_->serial_rate ||
+        fresh.use_serial != robotparams_->use_serial ||
+        strcmp(fresh.feedback_protocol, robotparams_->feedback_protocol) != 0 ||
+        fresh.feedback_rate != robotparams_->feedback_rate)
+    {
+      parts |= CONFIG_CONNECTION;
+    }
+
+    //! Tools
+    same = (fresh.tools.size() == robotparams_->tools.size());
+    for (i = 0; same && i < fresh.tools.size(); ++i)
+    {
+      same = fresh.tools[i].toolName == robotparams_->tools[i].toolName &&
+             fresh.tools[i].toolID == robotparams_->tools[i].toolID &&
+             samePose(fresh.tools[i].TCP, robotparams_->tools[i].TCP) &&
+             samePose(fresh.tools[i].centerMass, robotparams_->tools[i].centerMass) &&
+             approxEqual(fresh.tools[i].mass, robotparams_->tools[i].mass);
+    }
+    if (!same)
+    {
+      parts |= CONFIG_TOOLS;
+      robotparams_->tools = fresh.tools;
+      robotparams_->reindex();
+      if (!bypass_)
+      {
+        //! Drivers that keep their own copy of the tools take the new ones, and the docked tool
+        //! is coupled again so that a changed TCP or load reaches the controller
+        robInterface_->SetParameter("tools", &robotparams_->tools);
+        if (robotparams_->findTool(crpiparams_->toolName.c_str()) != CRPI_NO_HANDLE)
+        {
+          robInterface_->Couple(crpiparams_->toolName.c_str());
+        }
+      }
+    }
+
+    //! Coordinate systems:  updated in place when only their transforms changed, so that
+    //! FrameHandles stay valid
+    if (fresh.coordSystNames == robotparams_->coordSystNames &&
+        fresh.toCoordSystMatrices.size() == robotparams_->toCoordSystMatrices.size())
+    {
+      for (i = 0; i < fresh.toCoordSystMatrices.size(); ++i)
+      {
+        if (!sameMatrix(*fresh.toCoordSystMatrices[i], *robotparams_->toCoordSystMatrices[i]))
+        {
+          parts |= CONFIG_SYSTEMS;
+          *robotparams_->toCoordSystMatrices[i] = *fresh.toCoordSystMatrices[i];
+          if (i < fresh.toCoordSystPoses.size() && i < robotparams_->toCoordSystPoses.size())
+          {
+            robotparams_->toCoordSystPoses[i] = fresh.toCoordSystPoses[i];
+          }
+        }
+        delete fresh.toCoordSystMatrices[i];
+      }
+    }
+    else
+    {
+      parts |= CONFIG_SYSTEMS;
+      for (i = 0; i < robotparams_->toCoordSystMatrices.size(); ++i)
+      {
+        delete robotparams_->toCoordSystMatrices[i];
+      }
+      robotparams_->coordSystNames = fresh.coordSystNames;
+      robotparams_->toCoordSystPoses = fresh.toCoordSystPoses;
+      robotparams_->toCoordSystMatrices = fresh.toCoordSystMatrices;
+      robotparams_->reindex();
+    }
+    fresh.toCoordSystMatrices.clear();
+    if (parts & CONFIG_SYSTEMS)
+    {
+      systemCacheValid_ = false;
+      //! Systems may have been renumbered
+      waypoints_->Invalidate(CRPI_NO_HANDLE);
+    }
+
+    //! World transform
+    if (!sameMatrix(*fresh.toWorldMatrix, *robotparams_->toWorldMatrix))
+    {
+      parts |= CONFIG_WORLD;
+      *robotparams_->toWorldMatrix = *fresh.toWorldMatrix;
+      *robotparams_->toWorld = *fresh.toWorld;
+      robotparams_->usedMatrix = fresh.usedMatrix;
+      worldCacheValid_ = false;
+      waypoints_->Invalidate(CRPI_FRAME_WORLD);
+    }
+
+    if (!samePose(*fresh.mounting, *robotparams_->mounting))
+    {
+      parts |= CONFIG_MOUNTING;
+      *robotparams_->mounting = *fresh.mounting;
+    }
+
+    if (fresh.joint_max_vel != robotparams_->joint_max_vel || fresh.joint_max_acc != robotparams_->joint_max_acc ||
+        fresh.joint_max_jerk != robotparams_->joint_max_jerk ||
+        memcmp(&fresh.cart_limits, &robotparams_->cart_limits, sizeof(CrpiCartesianLimits)) != 0)
+    {
+      parts |= CONFIG_LIMITS;
+      robotparams_->joint_max_vel = fresh.joint_max_vel;
+      robotparams_->joint_max_acc = fresh.joint_max_acc;
+      robotparams_->joint_max_jerk = fresh.joint_max_jerk;
+      robotparams_->cart_limits = fresh.cart_limits;
+      makeStreamGenerators();
+    }
+
+    //! The watchdog is restarted with the new thresholds (or stopped, if they are all 0)
+    if (fresh.watchdog.warnAge != robotparams_->watchdog.warnAge ||
+        fresh.watchdog.slowAge != robotparams_->watchdog.slowAge ||
+        fresh.watchdog.stopAge != robotparams_->watchdog.stopAge ||
+        fresh.watchdog.slowSpeed != robotparams_->watchdog.slowSpeed ||
+        fresh.watchdog.jitterWarn != robotparams_->watchdog.jitterWarn ||
+        fresh.watchdog.period != robotparams_->watchdog.period)
+    {
+      parts |= CONFIG_WATCHDOG;
+      robotparams_->watchdog = fresh.watchdog;
+      StopWatchdog();
+      if (!bypass_ && robotparams_->watchdog.enabled())
+      {
+        StartWatchdog(robotparams_->watchdog);
+      }
+    }
+
+    delete fresh.mounting;
+    delete fresh.toWorld;
+    delete fresh.toWorldMatrix;
+
+    if (changed != NULL)
+    {
+      *changed = parts;
+    }
+    return CANON_SUCCESS;
+  }
+
+
+  template <class T> CRPI_ROBOT_API CanonReturn CrpiRobot<T>::SaveConfig (const char *file)
+  {
+    string line;
+    CrpiRobotXml robXML(robotparams_);
+    if (!robXML.encode(line))
+    {
+      return CANON_FAILURE;
+    }
+
+    //! Replaced in one step so that robots saving at the same time never interleave their output
+    return crpi_replace_file(file, line.data(), line.length()) ? CANON_SUCCESS : CANON_FAILURE;
+  }
+
+} // Robot
+
+#endif
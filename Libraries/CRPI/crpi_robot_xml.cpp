@@ -16,6 +16,8 @@
 #include "crpi_robot_xml.h"
 #include <iostream>
 #include <sstream>
+#include <stdio.h>
+#include <stdint.h>
 
 using namespace std;
 
@@ -49,328 +51,30 @@ namespace Xml
 
   LIBRARY_API bool CrpiRobotXml::parse (const string &line)
   {
-    static char buff[1024];
-    bool readTags = false;
-    bool state = true;
-    bool error = false;
-
-    xmlAttributes attr;
-    vector<string> chars;
-
-    int marker = 0;
-    int openTags = 0;
-    bool tagActive = false;
-    bool start = false;
-    bool single = false;
-    bool validXML = false;
-
-    int strLength = line.length();
-    int count;
-    string temp;
-    string name;
-    string attrname;
-    string attrval;
     try
     {
-      //! JAM:  TODO, STRIP OFF WHITE SPACE:  Carriage returns, tabs, etc.
-
-      while (marker < strLength && !error && line[marker] != '\0')
-      {
-        if (line[marker] == '<')
-        {
-          //! ***** Handle tags *****
-          tagActive = true;
-          for (int i = 0; i < 20; i++)
-          {
-            buff[i] = ' ';
-          }
-
-          name = "";
-          ++marker;
-
-          //! Skip white space
-          while (line[marker] == ' ' || line[marker] == '\t' || line[marker] == '?')
-          {
-            ++marker;
-            if (marker >= (strLength - 1))
-            {
-              break;
-            }
-          }
-
-          if (marker >= (strLength - 1))
-          {
-            //! Ill-formed XML string (end encountered before closing tags
-            error = true;
-            break;
-          }
-
-          if (line[marker] == '/')
-          {
-            start = false;
-            marker++;
-          }
-          else
-          {
-            start = true;
-          }
-
-          int count = 0;
-          while (line[marker] != ' ' && line[marker] != '\t' &&
-                 line[marker] != '/' && line[marker] != '>' &&
-                 line[marker] != '?' && marker <= (strLength - 1))
-          {
-            buff[count] = line[marker];
-            count++;
-            marker++;
-            if (marker >= (strLength - 1))
-            {
-              break;
-            }
-          }
-          if (marker > (strLength - 1))
-          {
-            //! Ill-formed XML string (end encountered before closing tags
-            error = true;
-            break;
-          }
-
-          buff[count] = '\0';
-          name = buff;
-          name = name.substr(0, count);
-
-          if (start)
-          {
-            //! Look for attributes of opening tags
-            while (line[marker] != '/' && line[marker] != '>' &&
-                   line[marker] != '?' && marker <= (strLength -1))
-            {
-              if (line[marker] != ' ' && line[marker] != '\t' &&
-                  line[marker] != '?' && line[marker] != '\n')
-              {
-                //! Non-white-space character & non-terminating element
-                //! Ergo, an attribute
-                count = 0;
-
-                //! grab the attribute name
-                while (line[marker] != '=' && line[marker] != ' ' && line[marker] != '?')
-                {
-                  buff[count++] = line[marker++];
-                  if (marker >= strLength - 1)
-                  {
-                    break;
-                  }
-                }
-                if (marker >= strLength - 1)
-                {
-                  break;
-                }
-                buff[count] = '\0';
-                attrname = buff;
-                attrname = attrname.substr(0, count);
-                attr.name.push_back(attrname);
-
-                //! grab the attribute value
-                while (line[marker] != '\"')
-                {
-                  marker++;
-                  if (marker >= strLength - 1)
-                  {
-                    break;
-                  }
-                }
-                marker++;
-                if (marker >= strLength - 1)
-                {
-                  break;
-                }
-
-                count = 0;
-                while (line[marker] != '\"')
-                {
-                  buff[count++] = line[marker++];
-                  if (marker >= strLength - 1)
-                  {
-                    break;
-                  }
-                }
-                buff[count] = '\0';
-                attrval = buff;
-                attrval = attrval.substr(0, count);
-                attr.val.push_back(attrval);
-              } // if (line[marker] != ' ' && line[marker] != '\t' && line[marker] != '\n' && line[marker] != '?')
-              marker++;
-              if (marker > strLength - 1)
-              {
-                break;
-              }
-            } // while (line[marker] != '/' && line[marker] != '>' && line[marker] != '?')
-
-            if (marker > (strLength - 1))
-            {
-              //! Ill-formed XML string (end encountered before closing tags
-              error = true;
-              break;
-            } // if (marker > (strLength - 1))
-
-            //! Test for single-tag XML lines (ex. <tag/>
-            if (line[marker] == '/')
-            {
-              single = true;
-            }
-            while (line[marker] != '>')
-            {
-              marker++;
-              if (marker >= strLength - 1)
-              {
-                break;
-              }
-            } // while (line[marker] != '>')
-          } // if (start)
-
-          if (error)
-          {
-            break;
-          }
-
-          //! Pass tag information for data structure assignment
-          if (start)
-          {
-            if (state && startElement (name, attr))
-            {
-              state = true;
-              attr.name.clear();
-              attr.val.clear();
-            }
-            else
-            {
-              state = false;
-            }
-
-            validXML = false;
-            openTags++;
-            readTags = true;
-            if (single)
-            {
-              tagActive = false;
-              validXML = true;
-              if (state && endElement (name))
-              {
-                state = true;
-              }
-              else
-              {
-                state = false;
-              }
-              openTags--;
-              start = false;
-            }
-          } // if (start)
-          else
-          {
-            tagActive = false;
-            validXML = true;
-            if (state && endElement (name))
-            {
-              state = true;
-            }
-            else
-            {
-              state = false;
-            }
-            openTags--;
-          } // if (start) ... else
-        } // if (line[marker] == '<')
-        else if (tagActive)
-        {
-          //! ***** Handle text between tags *****
-          while(start)
-          {
-            if (marker > strLength || line[marker] == '<')
-            {
-              marker--;
-              break;
-            }
-
-            //! Skip white space
-            while (line[marker] == ' ' || line[marker] == '\t' ||
-                   line[marker] == '\n' || line[marker] == ',' ||
-                   line[marker] == '?')
-            {
-              marker++;
-              if (marker >= strLength)
-              {
-                break;
-              }
-            }
-
-            if (marker > strLength || line[marker] == '<')
-            {
-              marker--;
-              break;
-            }
-
-            count = 0;
-            while (line[marker] != ',' && line[marker] != '<')
-            {
-              buff[count++] = line[marker++];
-              if (marker >= strLength - 1)
-              {
-                break;
-              }
-            }
-            if (marker >= (strLength - 1))
-            {
-              //! Ill-formed XML string (end encountered before closing tags
-              error = true;
-              break;
-            }
-            if (count > 0)
-            {
-              temp = buff;
-              temp = temp.substr (0, count);
-              chars.push_back (temp);
-            }
-          } // while(start)
-          if (start)
-          {
-            if (state && interTagElement (name, chars))
-            {
-              state = true;
-            }
-            else
-            {
-              state = false;
-            }
-            chars.clear ();
-          }
-          start = false;
-        } // else if (tagActive)
-
-        ++marker;
-        if (openTags < 1 && readTags)
-        {
-//          break;
-        }
-      } // while (marker < strLength && marker < 1024)
-    } // try
+      return sax_.parse (line.c_str(), line.length(), *this);
+    }
     catch (...)
     {
       return false;
     }
-
-    if (error)
-    {
-      //! Exiting with errors
-    }
-    return state;
   }
 
+
   /*
   <Robot>
     <TCP_IP Address="127.0.0.1" Port="6007" Client="false"/>
     <Serial Port="COM7" Rate="57600" Parity="Even" SBits="1" Handshake="None"/>
     <ComType Val="Serial"/>
+    <Feedback Protocol="RTDE" Rate="500"/>
+    <Replay File="cell.crec" Channel="universal/192.168.1.10" Speed="1"/>
+    <Driver Name="universal"/>
+    <RealTime Policy="FIFO" Priority="80" CPU="2" StackSize="262144" LockMemory="true"/>
+    <JointLimit Axis="0" Velocity="180.0" Acceleration="720.0" Jerk="7200.0"/>
+    <CartesianLimit Velocity="250" Acceleration="1000" Jerk="10000" AngularVelocity="90" AngularAcceleration="360" AngularJerk="3600"/>
+    <Watchdog Warn="0.05" Slow="0.1" Stop="0.5" Speed="0.25" Jitter="0.004" Period="0.005"/>
+    <Broadcast Port="30750" Group="239.255.0.80" Rate="10" Name="cell1_ur5"/>
     <Observer Address="169.254.152.3" Port="1025" Client="true"/>
     <Mounting X="0.0" Y="0.0" Z="0.0" XR="0.0" YR="0.0" ZR="0.0"/>
     <ToWorld X="2335.14" Y="471.0" Z="661.0" XR="0.0" YR="0.0" ZR="90.0" M00="0.0" M01="0.0" M02="0.0" M03="0.0" M10="0.0" M11="0.0" M12="0.0" M13="0.0" M20="0.0" M21="0.0" M22="0.0" M23="0.0" M30="0.0" M31="0.0" M32="0.0" M33="0.0"/>
@@ -413,6 +117,10 @@ namespace Xml
           {
             params_->tcp_ip_client = (strcmp (valiter->c_str(), "true") == 0);
           }
+          else if (strcmp (nameiter->c_str(), "Unit") == 0)
+          {
+            params_->tcp_ip_unit = atoi (valiter->c_str ());
+          }
           else
           {
             //! Unknown tag
@@ -488,6 +196,244 @@ namespace Xml
           }
         } //for (; nameiter != attr.name.end(); ++nameiter, ++valiter)
       } //else if (strcmp (tagName.c_str(), "ComType") == 0)
+      else if (strcmp (tagName.c_str(), "Feedback") == 0)
+      {
+        //! <Feedback Protocol="RTDE" Rate="500"/>
+        for (nameiter = attr.name.begin(), valiter = attr.val.begin(); nameiter != attr.name.end(); ++nameiter, ++valiter)
+        {
+          if (strcmp (nameiter->c_str(), "Protocol") == 0)
+          {
+            strncpy (params_->feedback_protocol, valiter->c_str(), sizeof(params_->feedback_protocol) - 1);
+            params_->feedback_protocol[sizeof(params_->feedback_protocol) - 1] = '\0';
+          }
+          else if (strcmp (nameiter->c_str(), "Rate") == 0)
+          {
+            params_->feedback_rate = atof (valiter->c_str());
+          }
+          else
+          {
+            //! Unknown tag
+          }
+        } //for (; nameiter != attr.name.end(); ++nameiter, ++valiter)
+      } //else if (strcmp (tagName.c_str(), "Feedback") == 0)
+      else if (strcmp (tagName.c_str(), "Replay") == 0)
+      {
+        //! <Replay File="cell.crec" Channel="universal/192.168.1.10" Speed="1"/>
+        for (nameiter = attr.name.begin(), valiter = attr.val.begin(); nameiter != attr.name.end(); ++nameiter, ++valiter)
+        {
+          if (strcmp (nameiter->c_str(), "File") == 0)
+          {
+            params_->replay_file = *valiter;
+          }
+          else if (strcmp (nameiter->c_str(), "Channel") == 0)
+          {
+            params_->replay_channel = *valiter;
+          }
+          else if (strcmp (nameiter->c_str(), "Speed") == 0)
+          {
+            params_->replay_speed = atof (valiter->c_str());
+          }
+          else
+          {
+            //! Unknown tag
+          }
+        } //for (; nameiter != attr.name.end(); ++nameiter, ++valiter)
+      } //else if (strcmp (tagName.c_str(), "Replay") == 0)
+      else if (strcmp (tagName.c_str(), "Driver") == 0)
+      {
+        //! <Driver Name="universal"/>
+        for (nameiter = attr.name.begin(), valiter = attr.val.begin(); nameiter != attr.name.end(); ++nameiter, ++valiter)
+        {
+          if (strcmp (nameiter->c_str(), "Name") == 0)
+          {
+            params_->driver = *valiter;
+          }
+          else
+          {
+            //! Unknown tag
+          }
+        } //for (; nameiter != attr.name.end(); ++nameiter, ++valiter)
+      } //else if (strcmp (tagName.c_str(), "Driver") == 0)
+      else if (strcmp (tagName.c_str(), "RealTime") == 0)
+      {
+        //! <RealTime Policy="FIFO" Priority="80" CPU="2" StackSize="262144" LockMemory="true"/>
+        for (nameiter = attr.name.begin(), valiter = attr.val.begin(); nameiter != attr.name.end(); ++nameiter, ++valiter)
+        {
+          if (strcmp (nameiter->c_str(), "Policy") == 0)
+          {
+            if (strcmp (valiter->c_str(), "FIFO") == 0)
+            {
+              params_->servo_task.policy = ULAPI_SCHED_FIFO;
+            }
+            else if (strcmp (valiter->c_str(), "RR") == 0)
+            {
+              params_->servo_task.policy = ULAPI_SCHED_RR;
+            }
+            else
+            {
+              params_->servo_task.policy = ULAPI_SCHED_NORMAL;
+            }
+          }
+          else if (strcmp (nameiter->c_str(), "Priority") == 0)
+          {
+            params_->servo_task.priority = atoi (valiter->c_str());
+          }
+          else if (strcmp (nameiter->c_str(), "CPU") == 0)
+          {
+            params_->servo_task.cpu = atoi (valiter->c_str());
+          }
+          else if (strcmp (nameiter->c_str(), "StackSize") == 0)
+          {
+            params_->servo_task.stack_size = atoi (valiter->c_str());
+          }
+          else if (strcmp (nameiter->c_str(), "LockMemory") == 0)
+          {
+            params_->servo_task.lock_memory = (strcmp (valiter->c_str(), "true") == 0) ? 1 : 0;
+          }
+          else
+          {
+            //! Unknown tag
+          }
+        } //for (; nameiter != attr.name.end(); ++nameiter, ++valiter)
+      } //else if (strcmp (tagName.c_str(), "RealTime") == 0)
+      else if (strcmp (tagName.c_str(), "JointLimit") == 0)
+      {
+        //! <JointLimit Axis="0" Velocity="180.0" Acceleration="720.0" Jerk="7200.0"/>
+        int axis = -1;
+        double vel = 0.0, acc = 0.0, jerk = 0.0;
+        for (nameiter = attr.name.begin(), valiter = attr.val.begin(); nameiter != attr.name.end(); ++nameiter, ++valiter)
+        {
+          if (strcmp (nameiter->c_str(), "Axis") == 0)
+          {
+            axis = atoi (valiter->c_str());
+          }
+          else if (strcmp (nameiter->c_str(), "Velocity") == 0)
+          {
+            vel = atof (valiter->c_str());
+          }
+          else if (strcmp (nameiter->c_str(), "Acceleration") == 0)
+          {
+            acc = atof (valiter->c_str());
+          }
+          else if (strcmp (nameiter->c_str(), "Jerk") == 0)
+          {
+            jerk = atof (valiter->c_str());
+          }
+          else
+          {
+            //! Unknown tag
+          }
+        } //for (; nameiter != attr.name.end(); ++nameiter, ++valiter)
+        if (axis >= 0 && axis < CRPI_AXES_MAX)
+        {
+          if ((int)params_->joint_max_vel.size() <= axis)
+          {
+            params_->joint_max_vel.resize(axis + 1, 0.0);
+            params_->joint_max_acc.resize(axis + 1, 0.0);
+            params_->joint_max_jerk.resize(axis + 1, 0.0);
+          }
+          params_->joint_max_vel[axis] = vel;
+          params_->joint_max_acc[axis] = acc;
+          params_->joint_max_jerk[axis] = jerk;
+        }
+      } //else if (strcmp (tagName.c_str(), "JointLimit") == 0)
+      else if (strcmp (tagName.c_str(), "CartesianLimit") == 0)
+      {
+        //! <CartesianLimit Velocity="250" Acceleration="1000" Jerk="10000" AngularVelocity="90" AngularAcceleration="360" AngularJerk="3600"/>
+        for (nameiter = attr.name.begin(), valiter = attr.val.begin(); nameiter != attr.name.end(); ++nameiter, ++valiter)
+        {
+          if (strcmp (nameiter->c_str(), "Velocity") == 0)
+          {
+            params_->cart_limits.vel = atof (valiter->c_str());
+          }
+          else if (strcmp (nameiter->c_str(), "Acceleration") == 0)
+          {
+            params_->cart_limits.acc = atof (valiter->c_str());
+          }
+          else if (strcmp (nameiter->c_str(), "Jerk") == 0)
+          {
+            params_->cart_limits.jerk = atof (valiter->c_str());
+          }
+          else if (strcmp (nameiter->c_str(), "AngularVelocity") == 0)
+          {
+            params_->cart_limits.angVel = atof (valiter->c_str());
+          }
+          else if (strcmp (nameiter->c_str(), "AngularAcceleration") == 0)
+          {
+            params_->cart_limits.angAcc = atof (valiter->c_str());
+          }
+          else if (strcmp (nameiter->c_str(), "AngularJerk") == 0)
+          {
+            params_->cart_limits.angJerk = atof (valiter->c_str());
+          }
+          else
+          {
+            //! Unknown tag
+          }
+        } //for (; nameiter != attr.name.end(); ++nameiter, ++valiter)
+      } //else if (strcmp (tagName.c_str(), "CartesianLimit") == 0)
+      else if (strcmp (tagName.c_str(), "Watchdog") == 0)
+      {
+        //! <Watchdog Warn="0.05" Slow="0.1" Stop="0.5" Speed="0.25" Jitter="0.004" Period="0.005"/>
+        for (nameiter = attr.name.begin(), valiter = attr.val.begin(); nameiter != attr.name.end(); ++nameiter, ++valiter)
+        {
+          if (strcmp (nameiter->c_str(), "Warn") == 0)
+          {
+            params_->watchdog.warnAge = atof (valiter->c_str());
+          }
+          else if (strcmp (nameiter->c_str(), "Slow") == 0)
+          {
+            params_->watchdog.slowAge = atof (valiter->c_str());
+          }
+          else if (strcmp (nameiter->c_str(), "Stop") == 0)
+          {
+            params_->watchdog.stopAge = atof (valiter->c_str());
+          }
+          else if (strcmp (nameiter->c_str(), "Speed") == 0)
+          {
+            params_->watchdog.slowSpeed = atof (valiter->c_str());
+          }
+          else if (strcmp (nameiter->c_str(), "Jitter") == 0)
+          {
+            params_->watchdog.jitterWarn = atof (valiter->c_str());
+          }
+          else if (strcmp (nameiter->c_str(), "Period") == 0)
+          {
+            params_->watchdog.period = atof (valiter->c_str());
+          }
+          else
+          {
+            //! Unknown tag
+          }
+        } //for (; nameiter != attr.name.end(); ++nameiter, ++valiter)
+      } //else if (strcmp (tagName.c_str(), "Watchdog") == 0)
+      else if (strcmp (tagName.c_str(), "Broadcast") == 0)
+      {
+        //! <Broadcast Port="30750" Group="239.255.0.80" Rate="10" Name="cell1_ur5"/>
+        for (nameiter = attr.name.begin(), valiter = attr.val.begin(); nameiter != attr.name.end(); ++nameiter, ++valiter)
+        {
+          if (strcmp (nameiter->c_str(), "Port") == 0)
+          {
+            params_->broadcast.port = atoi (valiter->c_str());
+          }
+          else if (strcmp (nameiter->c_str(), "Group") == 0)
+          {
+            params_->broadcast.group = *valiter;
+          }
+          else if (strcmp (nameiter->c_str(), "Rate") == 0)
+          {
+            params_->broadcast.rate = atof (valiter->c_str());
+          }
+          else if (strcmp (nameiter->c_str(), "Name") == 0)
+          {
+            params_->broadcast.name = *valiter;
+          }
+          else
+          {
+            //! Unknown tag
+          }
+        } //for (; nameiter != attr.name.end(); ++nameiter, ++valiter)
+      } //else if (strcmp (tagName.c_str(), "Broadcast") == 0)
       else if (strcmp (tagName.c_str(), "Mounting") == 0)
       {
         //! <Mounting X="0.0" Y="0.0" Z="0.0" XR="0.0" YR="0.0" ZR="0.0"/>
@@ -1030,6 +976,18 @@ namespace Xml
   </ROBOT>
   */
   LIBRARY_API bool CrpiRobotXml::encode (char *line)
+  {
+    std::string str;
+    if (!encode(str))
+    {
+      return false;
+    }
+    sprintf(line, "%s", str.c_str());
+    return true;
+  }
+
+
+  LIBRARY_API bool CrpiRobotXml::encode (std::string &line)
   {
     std::stringstream strm;
     vector<CrpiToolDef>::iterator titer;
@@ -1040,7 +998,12 @@ namespace Xml
     if (params_ != NULL)
     {
       strm << "<ROBOT>\n <TCP_IP Address=\"" << params_->tcp_ip_addr << "\" Port=\"" << params_->tcp_ip_port
-           << "\" Client=\"" << (params_->tcp_ip_client ? "true" : "false") << "\"/>\n  <ComType Val=\""
+           << "\" Client=\"" << (params_->tcp_ip_client ? "true" : "false") << "\"";
+      if (params_->tcp_ip_unit != 0)
+      {
+        strm << " Unit=\"" << params_->tcp_ip_unit << "\"";
+      }
+      strm << "/>\n  <ComType Val=\""
            << (params_->use_serial ? "SERIAL" : "TCP_IP") << "\"/>\n  <Mounting X=\"" << params_->mounting->x
            << "\" Y=\"" << params_->mounting->y << "\" Z=\"" << params_->mounting->z << "\" XR=\""
            << params_->mounting->xrot << "\" YR=\"" << params_->mounting->yrot << "\" ZR=\"" << params_->mounting->zrot
@@ -1085,9 +1048,453 @@ namespace Xml
       }           
       strm << "</ROBOT>\n";
 
-      sprintf(line, "%s", strm.str().c_str());
+      line = strm.str();
     } //if (params_ != NULL)
     return true;
   }
 
+
+  //! @brief Leading bytes of a robot configuration cache ("CRPC" in little-endian byte order)
+  //!
+  static const uint32_t cacheMagic = 0x43505243u;
+
+  //! @brief Revision of the cache layout.  Increment whenever CrpiRobotParams gains a field, or
+  //!        the transforms computed from the configuration change.
+  //!
+  static const uint32_t cacheVersion = 10;
+
+  //! @brief Fixed header at the start of a cache file
+  //!
+  struct cacheHeader
+  {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceHash;
+    uint64_t sourceSize;
+    uint64_t payloadHash;
+    uint64_t payloadSize;
+  };
+
+
+  //! @brief 64-bit FNV-1a hash of a block of bytes
+  //!
+  static uint64_t cacheHash (const char *data, size_t length)
+  {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < length; ++i)
+    {
+      hash = (hash ^ (unsigned char)data[i]) * 1099511628211ull;
+    }
+    return hash;
+  }
+
+
+  //! @brief Appends fields to a cache payload
+  //!
+  struct cacheWriter
+  {
+    std::string data;
+
+    template <class V> void put (const V &value)
+    {
+      data.append((const char*)&value, sizeof(value));
+    }
+
+    void putString (const char *str)
+    {
+      uint32_t length = (uint32_t)strlen(str);
+      put(length);
+      data.append(str, length);
+    }
+
+    void putPose (const robotPose &pose)
+    {
+      put(pose.x);
+      put(pose.y);
+      put(pose.z);
+      put(pose.xrot);
+      put(pose.yrot);
+      put(pose.zrot);
+      put((int32_t)pose.status);
+      put((int32_t)pose.turns);
+    }
+
+    void putMatrix (Math::matrix &mat)
+    {
+      for (int r = 0; r < 4; ++r)
+      {
+        for (int c = 0; c < 4; ++c)
+        {
+          put(mat.at(r, c));
+        }
+      }
+    }
+  };
+
+
+  //! @brief Reads fields back from a cache payload.  Every read is bounds-checked; once a read
+  //!        fails, ok stays false and all following reads fail.
+  //!
+  struct cacheReader
+  {
+    const char *ptr;
+    const char *end;
+    bool ok;
+
+    cacheReader (const char *data, size_t length) :
+      ptr(data),
+      end(data + length),
+      ok(true)
+    {
+    }
+
+    template <class V> void get (V &value)
+    {
+      if (!ok || (size_t)(end - ptr) < sizeof(value))
+      {
+        ok = false;
+        return;
+      }
+      memcpy(&value, ptr, sizeof(value));
+      ptr += sizeof(value);
+    }
+
+    void getString (std::string &str)
+    {
+      uint32_t length = 0;
+      get(length);
+      if (!ok || (size_t)(end - ptr) < length)
+      {
+        ok = false;
+        return;
+      }
+      str.assign(ptr, length);
+      ptr += length;
+    }
+
+    //! @brief Read a string into a fixed-size character array
+    //!
+    void getString (char *str, size_t size)
+    {
+      std::string temp;
+      getString(temp);
+      if (!ok || temp.length() >= size)
+      {
+        ok = false;
+        return;
+      }
+      strcpy(str, temp.c_str());
+    }
+
+    void getPose (robotPose &pose)
+    {
+      int32_t status = 0, turns = 0;
+      get(pose.x);
+      get(pose.y);
+      get(pose.z);
+      get(pose.xrot);
+      get(pose.yrot);
+      get(pose.zrot);
+      get(status);
+      get(turns);
+      pose.status = status;
+      pose.turns = turns;
+    }
+
+    void getMatrix (Math::matrix &mat)
+    {
+      for (int r = 0; r < 4; ++r)
+      {
+        for (int c = 0; c < 4; ++c)
+        {
+          get(mat.at(r, c));
+        }
+      }
+    }
+  };
+
+
+  LIBRARY_API CrpiRobotCache::CrpiRobotCache (CrpiRobotParams *params) :
+    params_(params)
+  {
+  }
+
+
+  LIBRARY_API CrpiRobotCache::~CrpiRobotCache ()
+  {
+    params_ = NULL;
+  }
+
+
+  LIBRARY_API bool CrpiRobotCache::load (const char *source, const std::string &xml)
+  {
+    std::string path(source), file;
+    cacheHeader header;
+    char block[4096];
+    size_t got;
+    FILE *in;
+
+    path += ".cache";
+    if (params_ == NULL || (in = fopen(path.c_str(), "rb")) == NULL)
+    {
+      return false;
+    }
+    while ((got = fread(block, 1, sizeof(block), in)) > 0)
+    {
+      file.append(block, got);
+    }
+    fclose(in);
+
+    if (file.length() < sizeof(header))
+    {
+      return false;
+    }
+    memcpy(&header, file.data(), sizeof(header));
+    if (header.magic != cacheMagic || header.version != cacheVersion ||
+        header.sourceSize != xml.length() || header.sourceHash != cacheHash(xml.data(), xml.length()) ||
+        header.payloadSize != file.length() - sizeof(header) ||
+        header.payloadHash != cacheHash(file.data() + sizeof(header), (size_t)header.payloadSize))
+    {
+      //! Stale, truncated, or from another revision
+      return false;
+    }
+
+    //! Decode into a scratch copy so a malformed payload leaves the parameters untouched
+    CrpiRobotParams temp;
+    cacheReader rd(file.data() + sizeof(header), (size_t)header.payloadSize);
+    uint32_t count = 0, i;
+    int32_t ival = 0;
+    uint8_t bval = 0;
+
+    rd.getString(temp.tcp_ip_addr, sizeof(temp.tcp_ip_addr));
+    rd.get(ival);
+    temp.tcp_ip_port = ival;
+    rd.get(bval);
+    temp.tcp_ip_client = (bval != 0);
+    rd.get(ival);
+    temp.tcp_ip_unit = ival;
+    rd.getString(temp.obs_tcp_ip_addr, sizeof(temp.obs_tcp_ip_addr));
+    rd.get(ival);
+    temp.obs_tcp_ip_port = ival;
+    rd.get(bval);
+    temp.obs_tcp_ip_client = (bval != 0);
+    rd.getString(temp.serial_port, sizeof(temp.serial_port));
+    rd.get(ival);
+    temp.serial_rate = ival;
+    rd.get(bval);
+    temp.serial_parity_even = (bval != 0);
+    rd.get(ival);
+    temp.serial_sbits = ival;
+    rd.getString(temp.serial_handshake, sizeof(temp.serial_handshake));
+    rd.get(bval);
+    temp.use_serial = (bval != 0);
+    rd.getString(temp.feedback_protocol, sizeof(temp.feedback_protocol));
+    rd.get(temp.feedback_rate);
+    rd.getString(temp.replay_file);
+    rd.getString(temp.replay_channel);
+    rd.get(temp.replay_speed);
+    rd.getString(temp.driver);
+    rd.get(ival);
+    temp.servo_task.policy = (ulapi_sched)ival;
+    rd.get(ival);
+    temp.servo_task.priority = ival;
+    rd.get(ival);
+    temp.servo_task.cpu = ival;
+    rd.get(ival);
+    temp.servo_task.stack_size = ival;
+    rd.get(bval);
+    temp.servo_task.lock_memory = bval;
+    rd.getPose(*temp.mounting);
+    rd.getPose(*temp.toWorld);
+    rd.get(bval);
+    temp.usedMatrix = (bval != 0);
+    rd.getMatrix(*temp.toWorldMatrix);
+
+    rd.get(count);
+    for (i = 0; rd.ok && i < count; ++i)
+    {
+      std::string name;
+      robotPose pose;
+      Math::matrix mat(4, 4);
+      rd.getString(name);
+      rd.getPose(pose);
+      rd.getMatrix(mat);
+      temp.coordSystNames.push_back(name);
+      temp.toCoordSystPoses.push_back(pose);
+      temp.toCoordSystMatrices.push_back(NULL);
+      if (rd.ok)
+      {
+        temp.toCoordSystMatrices.back() = new Math::matrix(mat);
+      }
+    }
+
+    rd.get(count);
+    for (i = 0; rd.ok && i < count; ++i)
+    {
+      CrpiToolDef tool;
+      rd.getString(tool.toolName);
+      rd.get(ival);
+      tool.toolID = ival;
+      rd.getPose(tool.TCP);
+      rd.getPose(tool.centerMass);
+      rd.get(tool.mass);
+      temp.tools.push_back(tool);
+    }
+
+    rd.get(count);
+    for (i = 0; rd.ok && i < count && i < CRPI_AXES_MAX; ++i)
+    {
+      double vel = 0.0, acc = 0.0, jerk = 0.0;
+      rd.get(vel);
+      rd.get(acc);
+      rd.get(jerk);
+      temp.joint_max_vel.push_back(vel);
+      temp.joint_max_acc.push_back(acc);
+      temp.joint_max_jerk.push_back(jerk);
+    }
+
+    rd.get(temp.watchdog.warnAge);
+    rd.get(temp.watchdog.slowAge);
+    rd.get(temp.watchdog.stopAge);
+    rd.get(temp.watchdog.slowSpeed);
+    rd.get(temp.watchdog.jitterWarn);
+    rd.get(temp.watchdog.period);
+
+    rd.get(ival);
+    temp.broadcast.port = ival;
+    rd.getString(temp.broadcast.group);
+    rd.get(temp.broadcast.rate);
+    rd.getString(temp.broadcast.name);
+
+    rd.get(temp.cart_limits.vel);
+    rd.get(temp.cart_limits.acc);
+    rd.get(temp.cart_limits.jerk);
+    rd.get(temp.cart_limits.angVel);
+    rd.get(temp.cart_limits.angAcc);
+    rd.get(temp.cart_limits.angJerk);
+
+    if (!rd.ok || rd.ptr != rd.end)
+    {
+      for (i = 0; i < temp.toCoordSystMatrices.size(); ++i)
+      {
+        delete temp.toCoordSystMatrices[i];
+      }
+      return false;
+    }
+
+    //! CrpiRobotParams::operator= does not carry the matrices or coordinate systems
+    *params_ = temp;
+    *params_->toWorldMatrix = *temp.toWorldMatrix;
+    params_->usedMatrix = temp.usedMatrix;
+    params_->coordSystNames = temp.coordSystNames;
+    params_->toCoordSystPoses = temp.toCoordSystPoses;
+    params_->toCoordSystMatrices = temp.toCoordSystMatrices;
+
+    //! CrpiRobotParams has no destructor; the coordinate system matrices now belong to params_
+    delete temp.mounting;
+    delete temp.toWorld;
+    delete temp.toWorldMatrix;
+    return true;
+  }
+
+
+  LIBRARY_API bool CrpiRobotCache::save (const char *source, const std::string &xml)
+  {
+    std::string path(source);
+    cacheHeader header;
+    cacheWriter wr;
+    size_t i;
+
+    if (params_ == NULL || params_->coordSystNames.size() != params_->toCoordSystMatrices.size() ||
+        params_->coordSystNames.size() != params_->toCoordSystPoses.size())
+    {
+      return false;
+    }
+
+    wr.putString(params_->tcp_ip_addr);
+    wr.put((int32_t)params_->tcp_ip_port);
+    wr.put((uint8_t)params_->tcp_ip_client);
+    wr.put((int32_t)params_->tcp_ip_unit);
+    wr.putString(params_->obs_tcp_ip_addr);
+    wr.put((int32_t)params_->obs_tcp_ip_port);
+    wr.put((uint8_t)params_->obs_tcp_ip_client);
+    wr.putString(params_->serial_port);
+    wr.put((int32_t)params_->serial_rate);
+    wr.put((uint8_t)params_->serial_parity_even);
+    wr.put((int32_t)params_->serial_sbits);
+    wr.putString(params_->serial_handshake);
+    wr.put((uint8_t)params_->use_serial);
+    wr.putString(params_->feedback_protocol);
+    wr.put(params_->feedback_rate);
+    wr.putString(params_->replay_file.c_str());
+    wr.putString(params_->replay_channel.c_str());
+    wr.put(params_->replay_speed);
+    wr.putString(params_->driver.c_str());
+    wr.put((int32_t)params_->servo_task.policy);
+    wr.put((int32_t)params_->servo_task.priority);
+    wr.put((int32_t)params_->servo_task.cpu);
+    wr.put((int32_t)params_->servo_task.stack_size);
+    wr.put((uint8_t)params_->servo_task.lock_memory);
+    wr.putPose(*params_->mounting);
+    wr.putPose(*params_->toWorld);
+    wr.put((uint8_t)params_->usedMatrix);
+    wr.putMatrix(*params_->toWorldMatrix);
+
+    wr.put((uint32_t)params_->coordSystNames.size());
+    for (i = 0; i < params_->coordSystNames.size(); ++i)
+    {
+      wr.putString(params_->coordSystNames[i].c_str());
+      wr.putPose(params_->toCoordSystPoses[i]);
+      wr.putMatrix(*params_->toCoordSystMatrices[i]);
+    }
+
+    wr.put((uint32_t)params_->tools.size());
+    for (i = 0; i < params_->tools.size(); ++i)
+    {
+      wr.putString(params_->tools[i].toolName.c_str());
+      wr.put((int32_t)params_->tools[i].toolID);
+      wr.putPose(params_->tools[i].TCP);
+      wr.putPose(params_->tools[i].centerMass);
+      wr.put(params_->tools[i].mass);
+    }
+
+    wr.put((uint32_t)params_->joint_max_vel.size());
+    for (i = 0; i < params_->joint_max_vel.size(); ++i)
+    {
+      wr.put(params_->joint_max_vel[i]);
+      wr.put(params_->joint_max_acc[i]);
+      wr.put(params_->joint_max_jerk[i]);
+    }
+
+    wr.put(params_->watchdog.warnAge);
+    wr.put(params_->watchdog.slowAge);
+    wr.put(params_->watchdog.stopAge);
+    wr.put(params_->watchdog.slowSpeed);
+    wr.put(params_->watchdog.jitterWarn);
+    wr.put(params_->watchdog.period);
+
+    wr.put((int32_t)params_->broadcast.port);
+    wr.putString(params_->broadcast.group.c_str());
+    wr.put(params_->broadcast.rate);
+    wr.putString(params_->broadcast.name.c_str());
+
+    wr.put(params_->cart_limits.vel);
+    wr.put(params_->cart_limits.acc);
+    wr.put(params_->cart_limits.jerk);
+    wr.put(params_->cart_limits.angVel);
+    wr.put(params_->cart_limits.angAcc);
+    wr.put(params_->cart_limits.angJerk);
+
+    header.magic = cacheMagic;
+    header.version = cacheVersion;
+    header.sourceHash = cacheHash(xml.data(), xml.length());
+    header.sourceSize = xml.length();
+    header.payloadHash = cacheHash(wr.data.data(), wr.data.length());
+    header.payloadSize = wr.data.length();
+    wr.data.insert(0, (const char*)&header, sizeof(header));
+
+    path += ".cache";
+    return crpi_replace_file(path.c_str(), wr.data.data(), wr.data.length());
+  }
+
 } // XML
\ No newline at end of file
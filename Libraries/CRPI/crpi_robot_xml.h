@@ -26,7 +26,7 @@ namespace Xml
   //!
   //! @brief XML parsing class based on the SAX structure
   //!
-  class LIBRARY_API CrpiRobotXml
+  class LIBRARY_API CrpiRobotXml : public CrpiSaxHandler
   {
   public:
 
@@ -58,9 +58,21 @@ namespace Xml
     //!
     bool encode (char* line);
 
+    //! @brief Encode an XML string from an input schema
+    //!
+    //! @param line The output XML string, sized to fit the whole configuration
+    //!
+    //! @return True if encoding was successful, false otherwise
+    //!
+    bool encode (std::string& line);
+
   private:
 
     CrpiRobotParams *params_;
+
+    //! @brief Tokenizer whose buffers are reused by each call to parse
+    //!
+    CrpiSaxParser sax_;
     CrpiToolDef *toolTmp;
 
     //! @brief Parse the text between the tag pair
@@ -100,6 +112,55 @@ namespace Xml
     bool endElement (const std::string& tagName);
 
   }; // CrpiRobotXml
+
+
+  //! @ingroup Xml
+  //!
+  //! @brief Compiled copy of a robot configuration, kept beside the XML configuration file
+  //!        (with ".cache" appended to its name) so that later starts can skip parsing it
+  //!
+  //! The cache stores every field of CrpiRobotParams, including the world transformation
+  //! matrix derived from older configuration files, along with a hash of the XML it was
+  //! built from.  It is ignored and rebuilt whenever the XML changes, and is rejected if
+  //! it is truncated, corrupted, or written by a different library revision.
+  //!
+  class LIBRARY_API CrpiRobotCache
+  {
+  public:
+
+    //! @brief Constructor
+    //!
+    //! @param params The robot parameters loaded from or saved to the cache
+    //!
+    CrpiRobotCache (CrpiRobotParams *params);
+
+    //! @brief Default destructor
+    //!
+    ~CrpiRobotCache ();
+
+    //! @brief Populate the robot parameters from the cache of a configuration file
+    //!
+    //! @param source Path of the XML configuration file
+    //! @param xml    Current contents of the XML configuration file
+    //!
+    //! @return True if the cache matched the XML and was loaded, false if the XML must be
+    //!         parsed instead (the parameters are left untouched)
+    //!
+    bool load (const char *source, const std::string &xml);
+
+    //! @brief Write the robot parameters to the cache of a configuration file
+    //!
+    //! @param source Path of the XML configuration file
+    //! @param xml    Contents of the XML configuration file the parameters were parsed from
+    //!
+    //! @return True if the cache was written, false otherwise
+    //!
+    bool save (const char *source, const std::string &xml);
+
+  private:
+
+    CrpiRobotParams *params_;
+  }; // CrpiRobotCache
 } // Xml namespace
 
 #endif
\ No newline at end of file
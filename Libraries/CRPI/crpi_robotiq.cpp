@@ -13,30 +13,34 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "crpi_robotiq.h"
+#include "crpi_hub.h"
+#include "crpi_log.h"
+#include "crpi_modbus.h"
+#include "crpi_trace.h"
 #include <iostream>
 
-//#define NOISY
+//! Minimum spacing (s) between status requests while someone is waiting on the gripper
+#define ROBOTIQ_POLL 0.02
 
-using namespace std;
+//! Spacing (s) between keep-alive status requests while nobody is waiting
+#define ROBOTIQ_KEEPALIVE 5.0
 
-namespace crpi_robot
-{
-  void livemanRobotiq (void *param)
-  {
-    keepalive *ka = (keepalive*)param;
-    int val;
-    crpi_timer timer;
+//! Time (s) to wait for a Modbus reply before giving up on the request
+#define ROBOTIQ_TIMEOUT 1.0
 
-    while (ka->runThread)
-    {
-      ((CrpiRobotiq*)ka->rob)->SetParameter("STATUS", &val);
+//! Time (s) allowed for activation, reset, and mode changes
+#define ROBOTIQ_ACTIVATE_TIMEOUT 20.0
 
-      //! Don't slam your processor!  You don't need to poll at full speed.
-      timer.waitUntil(5000);
-    }
-    return;
-  }
+//! Time (s) allowed for a GoTo motion to finish
+#define ROBOTIQ_MOTION_TIMEOUT 5.0
+
+//! Default Modbus unit identifier of the gripper (TCP_IP Unit in the configuration file)
+#define ROBOTIQ_UNIT 0x02
+
+using namespace std;
 
+namespace crpi_robot
+{
   LIBRARY_API CrpiRobotiq::CrpiRobotiq (CrpiRobotParams &params)
   {
     params_ = new CrpiRobotParams();
@@ -45,51 +49,60 @@ namespace crpi_robot
     action_request = new bitset<8>;
     gripper_options = new bitset<8>;
 
-    for (int i=0; i<43; i++)
+    for (int i = 0; i < ROBOTIQ_REGISTERS * 2; ++i)
     {
       commandRegister_[i] = 0x00;
+      statusRegister_[i] = 0x00;
     }
-    commandRegister_[0] = 0x00; // Start Trans ID @ 1
-    commandRegister_[1] = 0x01;
-    commandRegister_[2] = 0x00; // Protocol ID
-    commandRegister_[3] = 0x00;
-    commandRegister_[4] = 0x00;  // Use fixed message size to support both 
-    commandRegister_[5] = 0x25;
-    commandRegister_[6] = 0x02;  // Slave ID
-    commandRegister_[7] = 0x10;  // Function code 16 (Preset Multiple Registers)
-    commandRegister_[8] = 0x00;  // Address of first register
-    commandRegister_[9] = 0x00;
-    commandRegister_[10] = 0x00;  // Write all 15 registers
-    commandRegister_[11] = 0x0F; 
-    commandRegister_[12] = 0x1E;  // Consisting of 30 bytes of data
-
-    statusRegister_[0] = 0x00; // 
-    statusRegister_[1] = 0x01;
-    statusRegister_[2] = 0x00; // 
-    statusRegister_[3] = 0x00;
-    statusRegister_[4] = 0x00;  //  
-    statusRegister_[5] = 0x06;
-    statusRegister_[6] = 0x02;  // 
-    statusRegister_[7] = 0x04;  // 
-    statusRegister_[8] = 0x00;  // 
-    statusRegister_[9] = 0x00;
-    statusRegister_[10] = 0x00;  // 
-    statusRegister_[11] = 0x0F; 
-
-    //! Establish socket connection
-    //clientID_ = ulapi_socket_get_client_id (502, "129.6.35.31"); //"169.254.152.31");
-    clientID_ = ulapi_socket_get_client_id (params_->tcp_ip_port, params_->tcp_ip_addr);
-
-#ifdef NOISY
-    if (clientID_ < 0)
+    useReadWrite_ = true;
+    streamID_ = -1;
+    streamTask_ = -1;
+    streamPeriod_ = 0.02;
+    streamTransaction_ = 0;
+    streamResync_ = false;
+    streamReadPending_ = false;
+    streamReadSent_ = 0.0;
+    streamHeld_ = 0;
+    streamLock_ = ulapi_fastlock_new();
+    stateLock_ = ulapi_fastlock_new();
+    ulapi_lock_name(streamLock_, "CrpiRobotiq stream");
+    ulapi_lock_name(stateLock_, "CrpiRobotiq state");
+    stateCount_ = 0;
+    gACT = gMOD = gGTO = gIMC = gSTA = 0;
+    gDTA = gDTB = gDTC = gDTS = gFLT = 0;
+    ReqEcho_PosFingerA = ReqEcho_PosFingerB = ReqEcho_PosFingerC = ReqEcho_PosScissor = 0;
+
+    //! Connect to the gateway, or share the connection of grippers already behind it
+    unit_ = (params_->tcp_ip_unit > 0) ? (unsigned char)params_->tcp_ip_unit : ROBOTIQ_UNIT;
+    modbus_ = CrpiModbusSession::Acquire(params_->tcp_ip_addr, params_->tcp_ip_port);
+
+    if (modbus_ == NULL)
     {
-      cout << "no connection" << endl;
+      CRPI_LOG(CRPI_LOG_ERROR, "CrpiRobotiq:  no connection to %s:%d", params_->tcp_ip_addr,
+               params_->tcp_ip_port);
     }
     else
     {
-      cout << "connection success" << endl;
+      CRPI_LOG(CRPI_LOG_INFO, "CrpiRobotiq:  connection success (unit %d)", (int)unit_);
+    }
+
+    //! The status poll drives the status updates that activation waits on, so start it first
+    monitor_.handle = ulapi_mutex_new(99);
+    ulapi_lock_name(monitor_.handle, "CrpiRobotiq monitor");
+    monitor_.statusCond = ulapi_cond_new(97);
+    monitor_.waiters = 0;
+    monitor_.statusCount = 0;
+    monitor_.lastStatus = 0.0;
+
+    statusPoll_ = -1;
+    if (modbus_ != NULL)
+    {
+      unsigned char pdu[4] = {0x00, 0x00, 0x00, ROBOTIQ_REGISTERS};
+      statusPoll_ = modbus_->AddPoll(unit_, MODBUS_READ_INPUT, pdu, 4, statusPolled, this,
+                                     ROBOTIQ_TIMEOUT);
     }
-#endif
+
+    ulapi_mutex_take(monitor_.handle);
     setHandParam (1, 0);  //Reset Gripper
     
     setHandParam (1, 1);  //Activate Gripper
@@ -100,23 +113,32 @@ namespace crpi_robot
     PrevFingerB = ReqEcho_PosFingerB;
     PrevFingerC = ReqEcho_PosFingerC;
     PrevScissor = ReqEcho_PosScissor;
+    ulapi_mutex_give(monitor_.handle);
     
     grasped_ = false;
-
-    task = ulapi_task_new();
-    ka_.handle = ulapi_mutex_new(99);
-    ka_.rob = this;
-    ka_.runThread = true;
-
-    ulapi_task_start((ulapi_task_struct*)task, livemanRobotiq, &ka_, ulapi_prio_lowest(), 0);
   }
 
   LIBRARY_API CrpiRobotiq::~CrpiRobotiq ()
   {
-    ka_.runThread = false;
+    EndStream();
+
+    //! Once RemovePoll returns the session no longer calls back into this gripper
+    if (modbus_ != NULL)
+    {
+      modbus_->RemovePoll(statusPoll_);
+      CrpiModbusSession::Release(modbus_);
+    }
+    ulapi_cond_delete(monitor_.statusCond);
+    ulapi_mutex_delete(monitor_.handle);
+    ulapi_fastlock_delete(streamLock_);
+    ulapi_fastlock_delete(stateLock_);
+
+    delete action_request;
+    delete gripper_options;
+    delete params_;
   }
 
-  LIBRARY_API CanonReturn CrpiRobotiq::ApplyCartesianForceTorque (robotPose &robotForceTorque, vector<bool> activeAxes, vector<bool> manipulator)
+  LIBRARY_API CanonReturn CrpiRobotiq::ApplyCartesianForceTorque (robotPose &robotForceTorque, const vector<bool> &activeAxes, const vector<bool> &manipulator)
   {
     //! TODO
     return CANON_FAILURE;
@@ -142,7 +164,9 @@ namespace crpi_robot
       grasped_ = true;
     }
 
+    ulapi_mutex_take(monitor_.handle);
     setGrip (param);
+    ulapi_mutex_give(monitor_.handle);
     return CANON_SUCCESS;
   }
 
@@ -397,6 +421,20 @@ namespace crpi_robot
   }
 
 
+  LIBRARY_API CanonReturn CrpiRobotiq::GetRobotState (RobotStateSnapshot *state)
+  {
+    //! Published from the status replies of either session
+    return (state_.read(*state) > 0) ? CANON_SUCCESS : CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiRobotiq::GetPredictedState (RobotStateSnapshot *state, double lead)
+  {
+    //! Not applicable
+    return CANON_REJECT;
+  }
+
+
   LIBRARY_API CanonReturn CrpiRobotiq::MoveAttractor (robotPose &pose)
   {
     return CANON_SUCCESS;
@@ -409,6 +447,111 @@ namespace crpi_robot
   }
 
 
+  LIBRARY_API CanonReturn CrpiRobotiq::BeginStream ()
+  {
+    if (streamTask_ >= 0)
+    {
+      return CANON_REJECT;
+    }
+    streamID_ = ulapi_socket_get_client_id(params_->tcp_ip_port, params_->tcp_ip_addr);
+    if (streamID_ < 0)
+    {
+      return CANON_FAILURE;
+    }
+
+    //! Start from the registers the regular session last wrote, with GoTo set so that the
+    //! fingers follow every change of target
+    ulapi_mutex_take(monitor_.handle);
+    memcpy(streamWritten_, commandRegister_, ROBOTIQ_REGISTERS * 2);
+    ulapi_mutex_give(monitor_.handle);
+    memcpy(streamTarget_, streamWritten_, ROBOTIQ_REGISTERS * 2);
+    streamTarget_[0] |= 0x08;
+    streamResync_ = false;
+    streamReadPending_ = false;
+    streamHeld_ = 0;
+
+    streamTask_ = SensorHub::Instance().AddPeriodic(streamTick, this, streamPeriod_, HUB_REALTIME);
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiRobotiq::StreamPose (robotPose &pose)
+  {
+    //! Not applicable
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiRobotiq::StreamAxes (robotAxes &axes)
+  {
+    //! Position, then force, register of fingers A, B, C, and the scissor
+    static const int position[4] = {3, 6, 9, 12};
+    double val;
+    int i;
+
+    if (streamTask_ < 0)
+    {
+      return CANON_REJECT;
+    }
+
+    ulapi_fastlock_take(streamLock_);
+    for (i = 0; i < 4 && i < axes.axes; ++i)
+    {
+      val = axes.axis[i];
+      streamTarget_[position[i]] = (unsigned char)((val < 0.0) ? 0 : ((val > 255.0) ? 255 : val));
+    }
+    for (i = 0; i < 4 && i + 4 < axes.axes; ++i)
+    {
+      val = axes.axis[i + 4];
+      streamTarget_[position[i] + 2] = (unsigned char)((val < 0.0) ? 0 : ((val > 255.0) ? 255 : val));
+    }
+    ulapi_fastlock_give(streamLock_);
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiRobotiq::EndStream ()
+  {
+    if (streamTask_ < 0)
+    {
+      return CANON_REJECT;
+    }
+    //! Waits for a period in progress
+    SensorHub::Instance().RemovePeriodic(streamTask_);
+    streamTask_ = -1;
+    ulapi_socket_close(streamID_);
+    streamID_ = -1;
+
+    //! The regular session carries on from what the stream last wrote
+    ulapi_mutex_take(monitor_.handle);
+    memcpy(commandRegister_, streamWritten_, ROBOTIQ_REGISTERS * 2);
+    action_request->set(3, (streamWritten_[0] & 0x08) != 0);
+    ulapi_mutex_give(monitor_.handle);
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiRobotiq::BeginWrenchStream ()
+  {
+    //! Not applicable
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiRobotiq::StreamWrench (robotPose &wrench, const vector<bool> &activeAxes, robotPose &limits)
+  {
+    //! Not applicable
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiRobotiq::EndWrenchStream ()
+  {
+    //! Not applicable
+    return CANON_REJECT;
+  }
+
+
   LIBRARY_API CanonReturn CrpiRobotiq::SetAbsoluteAcceleration (double tolerance)
   {
     return CANON_SUCCESS;
@@ -460,8 +603,16 @@ namespace crpi_robot
  LIBRARY_API CanonReturn CrpiRobotiq::SetParameter (const char *paramName, void *paramVal)
   {
     int *temp_int = (int*) paramVal;
+    CanonReturn val = CANON_SUCCESS;
+
+    if (strcmp (paramName, "stream_period") == 0)
+    {
+      //! Takes effect at the next BeginStream
+      streamPeriod_ = *((double*)paramVal);
+      return (streamPeriod_ > 0.0) ? CANON_SUCCESS : CANON_FAILURE;
+    }
 
-    ulapi_mutex_take(ka_.handle);
+    ulapi_mutex_take(monitor_.handle);
 
     if ((strcmp (paramName, "ACTIVATE") == 0))
     {
@@ -543,14 +694,30 @@ namespace crpi_robot
     {
       getStatusRegisters ();
     }
+    else if (strcmp (paramName, "WAIT_MOTION") == 0)
+    {
+      if (!waitForStatus(&CrpiRobotiq::statusMotionDone, *temp_int / 1000.0))
+      {
+        val = CANON_FAILURE;
+      }
+    }
+    else if (strcmp (paramName, "WAIT_OBJECT") == 0)
+    {
+      if (!waitForStatus(&CrpiRobotiq::statusContact, *temp_int / 1000.0))
+      {
+        val = CANON_FAILURE;
+      }
+      *temp_int = (statusCommandSeen() &&
+                   (gDTA == 1 || gDTA == 2 || gDTB == 1 || gDTB == 2 || gDTC == 1 || gDTC == 2)) ? 1 : 0;
+    }
     else
     {
-      return CANON_FAILURE;
+      val = CANON_FAILURE;
     }
 
-    ulapi_mutex_give(ka_.handle);
+    ulapi_mutex_give(monitor_.handle);
 
-    return CANON_SUCCESS;
+    return val;
   }
 
 
@@ -608,37 +775,109 @@ namespace crpi_robot
   }
 
   
+  LIBRARY_API bool CrpiRobotiq::modbusTransact (unsigned char function,
+                                                const unsigned char *pdu,
+                                                int length,
+                                                unsigned char *reply,
+                                                int &replyLength)
+  {
+    if (modbus_ == NULL)
+    {
+      replyLength = 0;
+      return false;
+    }
+    return modbus_->Transact(unit_, function, pdu, length, reply, replyLength, ROBOTIQ_TIMEOUT);
+  }
+
+
+  LIBRARY_API double CrpiRobotiq::statusPolled (void *param, const unsigned char *reply, int length)
+  {
+    CrpiRobotiq *rob = (CrpiRobotiq*)param;
+    double next;
+
+    ulapi_mutex_take(rob->monitor_.handle);
+    if (reply != NULL && reply[0] == MODBUS_READ_INPUT && length >= 2 + ROBOTIQ_REGISTERS * 2)
+    {
+      rob->parseStatus(reply + 2);
+    }
+
+    //! Back-to-back while a caller is waiting on the gripper, otherwise only to keep the
+    //! connection alive
+    next = (rob->monitor_.waiters > 0) ? ROBOTIQ_POLL : ROBOTIQ_KEEPALIVE;
+    ulapi_mutex_give(rob->monitor_.handle);
+    return next;
+  }
+
+
   LIBRARY_API void CrpiRobotiq::sendCommand()
   {
-    int sent = ulapi_socket_write (clientID_, commandRegister_, 43);
-    int get;
+    unsigned char pdu[9 + ROBOTIQ_REGISTERS * 2], reply[ROBOTIQ_FRAME_MAX];
+    int length;
 
-    get = ulapi_socket_read(clientID_, inbuffer, 8192);
-    for (int x = 0; x < get; ++x)
+    if (useReadWrite_)
     {
-      ackCommand_[x] = (int)inbuffer[x];
-      ackCommand_[x] = (ackCommand_[x] < 0)?(ackCommand_[x]+256):(ackCommand_[x]);
+      //! Read the status registers back in the same round trip as the write
+      pdu[0] = 0x00;  // Address of first status register
+      pdu[1] = 0x00;
+      pdu[2] = 0x00;  // Read all 15 registers
+      pdu[3] = ROBOTIQ_REGISTERS;
+      pdu[4] = 0x00;  // Address of first command register
+      pdu[5] = 0x00;
+      pdu[6] = 0x00;  // Write all 15 registers
+      pdu[7] = ROBOTIQ_REGISTERS;
+      pdu[8] = ROBOTIQ_REGISTERS * 2;  // Consisting of 30 bytes of data
+      memcpy(pdu + 9, commandRegister_, ROBOTIQ_REGISTERS * 2);
+
+      if (modbusTransact(MODBUS_READ_WRITE_MULTIPLE, pdu, 9 + ROBOTIQ_REGISTERS * 2, reply, length))
+      {
+        if (length >= 2 + ROBOTIQ_REGISTERS * 2)
+        {
+          parseStatus(reply + 2);
+        }
+        return;
+      }
+      if (length == 0 || reply[0] != (MODBUS_READ_WRITE_MULTIPLE | MODBUS_EXCEPTION))
+      {
+        return;
+      }
+
+      //! Function code 23 is not supported by this gripper; fall back to a write and a read
+      useReadWrite_ = false;
     }
 
+    pdu[0] = 0x00;  // Address of first register
+    pdu[1] = 0x00;
+    pdu[2] = 0x00;  // Write all 15 registers
+    pdu[3] = ROBOTIQ_REGISTERS;
+    pdu[4] = ROBOTIQ_REGISTERS * 2;  // Consisting of 30 bytes of data
+    memcpy(pdu + 5, commandRegister_, ROBOTIQ_REGISTERS * 2);
+    modbusTransact(MODBUS_WRITE_MULTIPLE, pdu, 5 + ROBOTIQ_REGISTERS * 2, reply, length);
 
     getStatusRegisters ();
   }
 
   LIBRARY_API void CrpiRobotiq::getStatusRegisters()
   {
-    crpi_timer timer;
-    timer.waitUntil(200);
-    int sent = ulapi_socket_write(clientID_, statusRegister_, 12), get;
+    unsigned char pdu[4], reply[ROBOTIQ_FRAME_MAX];
+    int length;
 
-    get = ulapi_socket_read (clientID_, inbuffer, 8192);
-    {
-    for (int i = 0; i < get; ++i)
+    pdu[0] = 0x00;  // Address of first register
+    pdu[1] = 0x00;
+    pdu[2] = 0x00;  // Read all 15 registers
+    pdu[3] = ROBOTIQ_REGISTERS;
+
+    if (modbusTransact(MODBUS_READ_INPUT, pdu, 4, reply, length) &&
+        length >= 2 + ROBOTIQ_REGISTERS * 2)
     {
-      ackStatus_[i] = (int)inbuffer[i];
-      ackStatus_[i] = (ackStatus_[i] < 0)?(ackStatus_[i]+256):(ackStatus_[i]);
+      parseStatus(reply + 2);
     }
+  }
+
+  LIBRARY_API void CrpiRobotiq::parseStatus (const unsigned char *data)
+  {
+    memcpy(statusRegister_, data, ROBOTIQ_REGISTERS * 2);
 
-    bitset<8> gripper_status(ackStatus_[9]);
+    bitset<8> gripper_status(statusRegister_[0]);
 
     //extract Initialization Status
     if(gripper_status.test(0)) gACT = true;
@@ -666,7 +905,7 @@ namespace crpi_robot
     else if(!gripper_status.test(6) && gripper_status.test(7)) gSTA = 2;
     else  gSTA = 3;
 
-    bitset<8> object_status(ackStatus_[10]);
+    bitset<8> object_status(statusRegister_[1]);
 
     //extract FingerA status
     if(!object_status.test(0) && !object_status.test(1)) gDTA = 0;
@@ -704,28 +943,257 @@ namespace crpi_robot
     else allFingersAtPos_ = false;
 
     //extract Fault Status
-    gFLT = ackStatus_[11];
+    gFLT = statusRegister_[2];
 
     //extract FingerA Stats
-    ReqEcho_PosFingerA = ackStatus_[12];
-    PosFingerA = ackStatus_[13];
-    CurFingerA = ackStatus_[14];
+    ReqEcho_PosFingerA = statusRegister_[3];
+    PosFingerA = statusRegister_[4];
+    CurFingerA = statusRegister_[5];
 
     //extract FingerB Stats
-    ReqEcho_PosFingerB = ackStatus_[15];
-    PosFingerB = ackStatus_[16];
-    CurFingerB = ackStatus_[17];
+    ReqEcho_PosFingerB = statusRegister_[6];
+    PosFingerB = statusRegister_[7];
+    CurFingerB = statusRegister_[8];
 
     //extract FingerC Stats
-    ReqEcho_PosFingerC = ackStatus_[18];
-    PosFingerC = ackStatus_[19];
-    CurFingerC = ackStatus_[20];
+    ReqEcho_PosFingerC = statusRegister_[9];
+    PosFingerC = statusRegister_[10];
+    CurFingerC = statusRegister_[11];
 
     //extract Scissor Stats
-    ReqEcho_PosScissor = ackStatus_[21];
-    PosScissor = ackStatus_[22];
-    CurScissor = ackStatus_[23];
+    ReqEcho_PosScissor = statusRegister_[12];
+    PosScissor = statusRegister_[13];
+    CurScissor = statusRegister_[14];
+
+    monitor_.lastStatus = ulapi_time();
+    ++monitor_.statusCount;
+    ulapi_cond_broadcast(monitor_.statusCond);
+    publishState(data);
+  }
+
+
+  LIBRARY_API void CrpiRobotiq::publishState (const unsigned char *data)
+  {
+    RobotStateSnapshot snap;
+    int i;
+
+    //! Fingers A, B, C, and the scissor:  position as the axis, current as the torque, and
+    //! object detection (stopped on contact while opening or closing) as a digital input
+    snap.axes = 4;
+    snap.ndio = 4;
+    for (i = 0; i < 4; ++i)
+    {
+      snap.axis[i] = data[4 + (i * 3)];
+      snap.torque[i] = data[5 + (i * 3)];
+      snap.dio[i] = (((data[1] >> (i * 2)) & 0x03) == 1) || (((data[1] >> (i * 2)) & 0x03) == 2);
+    }
+    snap.valid = STATE_AXES | STATE_TORQUES | STATE_IO;
+    snap.timestamp = ulapi_time();
+
+    ulapi_fastlock_take(stateLock_);
+    snap.sequence = ++stateCount_;
+    state_.write(snap);
+    ulapi_fastlock_give(stateLock_);
+  }
+
+
+  LIBRARY_API bool CrpiRobotiq::streamSend (unsigned char function, const unsigned char *pdu, int length)
+  {
+    unsigned char frame[ROBOTIQ_FRAME_MAX];
+    unsigned short id = ++streamTransaction_;
+
+    if (streamID_ < 0 || length + 8 > ROBOTIQ_FRAME_MAX)
+    {
+      return false;
+    }
+
+    //! MBAP header as in CrpiModbusSession::Begin
+    frame[0] = (unsigned char)(id >> 8);
+    frame[1] = (unsigned char)(id & 0xFF);
+    frame[2] = 0x00;
+    frame[3] = 0x00;
+    frame[4] = (unsigned char)((length + 2) >> 8);
+    frame[5] = (unsigned char)((length + 2) & 0xFF);
+    frame[6] = unit_;
+    frame[7] = function;
+    memcpy(frame + 8, pdu, length);
+
+    return ulapi_socket_write(streamID_, (char*)frame, length + 8) == length + 8;
+  }
+
+
+  LIBRARY_API void CrpiRobotiq::streamReceive ()
+  {
+    ulapi_integer ready;
+    int get, frameLength;
+    unsigned char function;
+
+    while (streamHeld_ < ROBOTIQ_FRAME_MAX && ulapi_socket_poll(&streamID_, &ready, 1, 0.0) > 0)
+    {
+      get = ulapi_socket_read(streamID_, (char*)streamRx_ + streamHeld_, ROBOTIQ_FRAME_MAX - streamHeld_);
+      if (get <= 0)
+      {
+        return;
+      }
+      streamHeld_ += get;
+
+      while (streamHeld_ >= 8)
+      {
+        frameLength = 6 + ((streamRx_[4] << 8) | streamRx_[5]);
+        if (frameLength < 8 || frameLength > ROBOTIQ_FRAME_MAX)
+        {
+          streamHeld_ = 0;
+          break;
+        }
+        if (streamHeld_ < frameLength)
+        {
+          break;
+        }
+
+        function = streamRx_[7];
+        if (function == MODBUS_READ_INPUT && frameLength >= 9 + (ROBOTIQ_REGISTERS * 2))
+        {
+          publishState(streamRx_ + 9);
+          streamReadPending_ = false;
+        }
+        else if (function == (MODBUS_WRITE_MULTIPLE | MODBUS_EXCEPTION))
+        {
+          //! The gripper's registers are unknown:  write them all next period
+          streamResync_ = true;
+        }
+        else if (function == (MODBUS_READ_INPUT | MODBUS_EXCEPTION))
+        {
+          streamReadPending_ = false;
+        }
+        streamHeld_ -= frameLength;
+        memmove(streamRx_, streamRx_ + frameLength, streamHeld_);
+      }
+    }
+  }
+
+
+  void CrpiRobotiq::streamTick (void *param)
+  {
+    CrpiRobotiq *rob = (CrpiRobotiq*)param;
+    unsigned char target[ROBOTIQ_REGISTERS * 2], pdu[5 + (ROBOTIQ_REGISTERS * 2)];
+    int first = -1, last = -1, count, i;
+    double now;
+
+    rob->streamReceive();
+
+    ulapi_fastlock_take(rob->streamLock_);
+    memcpy(target, rob->streamTarget_, ROBOTIQ_REGISTERS * 2);
+    ulapi_fastlock_give(rob->streamLock_);
+
+    //! Only the registers spanning the bytes that changed since the last write
+    for (i = 0; i < ROBOTIQ_REGISTERS * 2; ++i)
+    {
+      if (rob->streamResync_ || target[i] != rob->streamWritten_[i])
+      {
+        first = (first < 0) ? i : first;
+        last = i;
+      }
+    }
+    if (first >= 0)
+    {
+      first /= 2;
+      count = (last / 2) - first + 1;
+      pdu[0] = 0x00;  // Address of first register
+      pdu[1] = (unsigned char)first;
+      pdu[2] = 0x00;  // Number of registers
+      pdu[3] = (unsigned char)count;
+      pdu[4] = (unsigned char)(count * 2);
+      memcpy(pdu + 5, target + (first * 2), count * 2);
+      if (rob->streamSend(MODBUS_WRITE_MULTIPLE, pdu, 5 + (count * 2)))
+      {
+        memcpy(rob->streamWritten_, target, ROBOTIQ_REGISTERS * 2);
+        rob->streamResync_ = false;
+      }
     }
+
+    //! Status is requested without waiting; the reply is parsed on a later period.  A request
+    //! whose reply never came is replaced after ROBOTIQ_TIMEOUT.
+    now = ulapi_time();
+    if (!rob->streamReadPending_ || (now - rob->streamReadSent_) > ROBOTIQ_TIMEOUT)
+    {
+      pdu[0] = 0x00;  // Address of first register
+      pdu[1] = 0x00;
+      pdu[2] = 0x00;  // Read all 15 registers
+      pdu[3] = ROBOTIQ_REGISTERS;
+      if (rob->streamSend(MODBUS_READ_INPUT, pdu, 4))
+      {
+        rob->streamReadPending_ = true;
+        rob->streamReadSent_ = now;
+      }
+    }
+  }
+
+
+  LIBRARY_API bool CrpiRobotiq::waitForStatus (bool (CrpiRobotiq::*done)(), double timeout)
+  {
+    CrpiTraceSpan span("CrpiRobotiq::waitForStatus", CRPI_TRACE_WAIT);
+    bool met;
+    double deadline = ulapi_time() + timeout, remaining;
+
+    //! Let the status poll know someone is waiting so it requests status at full rate
+    ++monitor_.waiters;
+    if (modbus_ != NULL)
+    {
+      modbus_->Wake(statusPoll_);
+    }
+    while (!(met = (this->*done)()))
+    {
+      remaining = deadline - ulapi_time();
+      if (remaining <= 0.0)
+      {
+        break;
+      }
+      ulapi_cond_timedwait(monitor_.statusCond, monitor_.handle, remaining);
+    }
+    --monitor_.waiters;
+
+    return span.End(met);
+  }
+
+
+  LIBRARY_API bool CrpiRobotiq::statusCommandSeen ()
+  {
+    //! The status echoes the requested position once the gripper has taken the last command
+    return (gGTO == (action_request->test(3) ? 1 : 0)) &&
+           (ReqEcho_PosFingerA == commandRegister_[3]);
+  }
+
+
+  LIBRARY_API bool CrpiRobotiq::statusActivated ()
+  {
+    return gACT && gIMC == 3;
+  }
+
+
+  LIBRARY_API bool CrpiRobotiq::statusReset ()
+  {
+    return !gACT && gIMC == 0;
+  }
+
+
+  LIBRARY_API bool CrpiRobotiq::statusModeSet ()
+  {
+    int mode = (action_request->test(1) ? 2 : 0) + (action_request->test(2) ? 1 : 0);
+    return gIMC == 3 && gMOD == mode;
+  }
+
+
+  LIBRARY_API bool CrpiRobotiq::statusMotionDone ()
+  {
+    return statusCommandSeen() && gSTA != 0;
+  }
+
+
+  LIBRARY_API bool CrpiRobotiq::statusContact ()
+  {
+    return statusCommandSeen() &&
+           (gSTA != 0 ||
+            gDTA == 1 || gDTA == 2 || gDTB == 1 || gDTB == 2 || gDTC == 1 || gDTC == 2);
   }
 
 
@@ -743,14 +1211,16 @@ namespace crpi_robot
       case ACTIVATE: //set rACT to 0:RESET or 1:ACTIVATE
         action_request->set(0,value);  
         request = (unsigned char)action_request->to_ulong();
-        commandRegister_[13]=request;
+        commandRegister_[0]=request;
         sendCommand ();
         if (value)
         {
-              while (gIMC != 3) getStatusRegisters();
+          waitForStatus(&CrpiRobotiq::statusActivated, ROBOTIQ_ACTIVATE_TIMEOUT);
         }
         else
-          while (gIMC != 0) getStatusRegisters();
+        {
+          waitForStatus(&CrpiRobotiq::statusReset, ROBOTIQ_ACTIVATE_TIMEOUT);
+        }
       break;
 
       case GRIP: 
@@ -780,41 +1250,41 @@ namespace crpi_robot
           default:   ;
         }
       request = (unsigned char)action_request->to_ulong();
-        commandRegister_[13]=request;
+        commandRegister_[0]=request;
       sendCommand();
-          while (gIMC != 3) getStatusRegisters();
+        waitForStatus(&CrpiRobotiq::statusModeSet, ROBOTIQ_ACTIVATE_TIMEOUT);
             break;
 
       case MOVE: //set rGTO 0:STOP or 1:GO
         action_request->set(3,value);
         request = (unsigned char)action_request->to_ulong();
-          commandRegister_[13]=request;
+          commandRegister_[0]=request;
         sendCommand();
       break;
 
       case AUTO_RELEASE: //set rSTR 0:NORMAL or 1:AUTO RELEASE
         action_request->set(4,value);
         request = (unsigned char)action_request->to_ulong();
-          commandRegister_[13]=request;
+          commandRegister_[0]=request;
         sendCommand();
       break;
 
       case AUTO_CENTER: //set rAAC 0:NORMAL or 1:AUTO CENTERING
         gripper_options->set(1,value);
         request = (unsigned char)gripper_options->to_ulong();
-          commandRegister_[14]=request;
+          commandRegister_[1]=request;
       break;
 
       case ADVANCED_CONTROL: //set rICF 0:NORMAL or 1:Enable Indvidual Control of Fingers A, B and C
         gripper_options->set(2,value);
         request = (unsigned char)gripper_options->to_ulong();
-          commandRegister_[14]=request;
+          commandRegister_[1]=request;
       break;
 
       case SCISSOR_CONTROL: //set rICS 0:NORMAL 1:Individual SCISSOR Control
         gripper_options->set(3,value);
         request = (unsigned char)gripper_options->to_ulong();
-          commandRegister_[14]=request;
+          commandRegister_[1]=request;
       break;
 
             default:   ;
@@ -827,9 +1297,10 @@ namespace crpi_robot
     int status = 0;
     getStatusRegisters ();
 
-#ifdef NOISY
-    writeStatus();
-#endif
+    if (CrpiLog::Enabled(CRPI_LOG_DEBUG))
+    {
+      writeStatus();
+    }
 
     if(param == 1)
     { 
@@ -842,35 +1313,17 @@ namespace crpi_robot
       //writeStatus();
 
       setHandParam (3,1); //GoTo
-      sendCommand();
-
-      clock_t startTime = clock();
-      clock_t currentTime;
-      double time;
 
-      while (true)
+      if (waitForStatus(&CrpiRobotiq::statusMotionDone, ROBOTIQ_MOTION_TIMEOUT))
       {
-        getStatusRegisters();
         if (gDTA == 3 && gDTB == 3 && gDTC == 3)
         {
           status = 3;
-          getStatusRegisters();
           //writeStatus();
-          break;
         }
         else if (gDTA == 2 && gDTB == 2 && gDTC == 2)
         {
           status = 2;
-          getStatusRegisters();
-          break;
-        }
-        currentTime = clock();
-        time = (currentTime-startTime)/(double) CLOCKS_PER_SEC;
-        
-        if (time > 5) 
-        {
-          status = 0;
-          break;
         }
       }
       //cout << "save: " << PrevFingerA << " " << PrevFingerB << " " << PrevFingerC << endl;
@@ -891,12 +1344,8 @@ namespace crpi_robot
       PrevScissor = ReqEcho_PosScissor;
 
       setHandParam (3,1);
-      sendCommand();
 
-      while (gDTA != 3 && gDTB != 3 && gDTC != 3)
-      {
-        getStatusRegisters();
-      }
+      waitForStatus(&CrpiRobotiq::statusMotionDone, ROBOTIQ_MOTION_TIMEOUT);
       //getStatusRegisters();
       //writeStatus();
     }
@@ -905,233 +1354,60 @@ namespace crpi_robot
   }
 
 
-  LIBRARY_API void CrpiRobotiq::writeStatus ()
+  //! @brief Text of a status field's value, or "" if it has none
+  //!
+  static const char *robotiqStatusText (const char *const *table, int count, int value)
   {
-    cout << endl << "GRIPPER STATUS" << endl;
-
-    cout << "  Initialization: ";
-
-    /*cout << "gACT = " << gACT  << endl;
-    cout << "gMOD = " << gMOD  << endl;
-    cout << "gGTO = " << gGTO  << endl;
-    cout << "gIMC = " << gIMC  << endl;
-    cout << "gSTA = " << gSTA  << endl;
-    cout << "gDTA = " << gDTA  << endl;
-    cout << "gDTB = " << gDTB  << endl;
-    cout << "gDTC = " << gDTC  << endl;
-    cout << "gDTS = " << gDTS  << endl;
-    cout << "gFLT = " << gFLT  << endl;*/
-
-    switch(gACT)
-    {  
-      case 0: 
-        cout << "Gripper reset"<< endl;
-      break;
-      case 1: 
-              cout << "Gripper activation"<< endl;
-      break;
-      default:   ;
-    }
-
-    cout << "  Grasp Mode: ";
-    switch(gMOD)
-    {  
-      case 0:
-        cout << "Basic"<< endl;
-      break;
-      case 1: 
-              cout << "Pinch"<< endl;
-      break;
-      case 2:
-        cout << "Wide" << endl;
-      break;
-      case 3:
-        cout << "Scissor" << endl;
-      break;
-      default:   ;
-    }
-
-    cout << "  Stop/Goto: ";
-    switch(gGTO)
-    {  
-      case 0: 
-        cout << "Stopped"<< endl;
-      break;
-      case 1: 
-              cout << "GoTo Request"<< endl;
-      break;
-      default:   ;
-    }
-
-    cout << "  Setup: ";
-    switch(gIMC)
-    {  
-      case 0:
-        cout << "Reset or auto-release state"<< endl;
-      break;
-      case 1: 
-              cout << "Activation in progress"<< endl;
-      break;
-      case 2:
-        cout << "Mode change in progress" << endl;
-        break;
-      case 3:
-        cout << "Activation/Mode change complete" << endl;
-        break;
-      default:   
-        break;
-    }
-
-    cout << "  Motion: ";
-    switch(gSTA)
-    {  
-      case 0:
-        cout << "Moving to goal pos"<< endl;
-        break;
-      case 1: 
-        cout << "Stopped (1 or 2 fingers stopped before goal pose)"<< endl;
-        break;
-      case 2:
-        cout << "Stopped (all fingers stopped before goal pose)" << endl;
-        break;
-      case 3:
-        cout << "Stopped (all fingers reached goal pose" << endl;
-        break;
-      default:
-        break;
-    }
-
-    cout << endl << "OBJECT STATUS" << endl;
-
-    cout << "  FingerA: ";
-    switch(gDTA)
-    {  
-      case 0:
-        cout << "in motion"<< endl;
-      break;
-      case 1: 
-              cout << "stopped (contact on open)"<< endl;
-      break;
-      case 2:
-        cout << "stopped (contact on close)" << endl;
-      break;
-      case 3:
-        cout << "at requested position" << endl;
-      break;
-      default:   ;
-    }
-
-    cout << "  FingerB: ";
-    switch(gDTB)
-    {  
-      case 0:
-        cout << "in motion"<< endl;
-      break;
-      case 1: 
-              cout << "stopped (contact on open)"<< endl;
-      break;
-      case 2:
-        cout << "stopped (contact on close)" << endl;
-      break;
-      case 3:
-        cout << "at requested position" << endl;
-      break;
-      default:   ;
-    }
-
-    cout << "  FingerC: ";
-    switch(gDTC)
-    {  
-      case 0:
-        cout << "in motion"<< endl;
-      break;
-      case 1: 
-              cout << "stopped (contact on open)"<< endl;
-      break;
-      case 2:
-        cout << "stopped (contact on close)" << endl;
-      break;
-      case 3:
-        cout << "at requested position" << endl;
-      break;
-      default:   ;
-    }
-
-    cout << "  Scissor: ";
-    switch(gDTS)
-    {  
-      case 0:
-        cout << "in motion"<< endl;
-      break;
-      case 1: 
-              cout << "stopped (contact on open)"<< endl;
-      break;
-      case 2:
-        cout << "stopped (contact on close)" << endl;
-      break;
-      case 3:
-        cout << "at requested position" << endl;
-      break;
-      default:   ;
-    }
-
-    cout << endl << "OBJECT STATUS" << endl;
-
-    switch(gFLT)
-    {  
-      case 0:
-        cout << "  No Fault"<< endl;
-      break;
-      case 5: 
-              cout << "  Priority Fault: Action delayed, activation(reactivation) must be completed prior to action"<< endl;
-      break;
-      case 6:
-        cout << "  Priority Fault: Action delayed, mode change must be completed prior to action" << endl;
-      break;
-      case 7:
-        cout << "  Priority Fault: The activation bit must be set prior to action" << endl;
-      break;
-      case 9:
-        cout << "  Minor Fault: The communicatin chip is not ready (may be booting)" << endl;
-      break;
-      case 10:
-        cout << "  Minor Fault: Changing mode fault, interferences detected on Scissor (for less than 20 seconds)" << endl;
-      break;
-      case 11:
-        cout << "  Minor Fault: Automatic release in progress" << endl;
-      break;
-      case 13:
-        cout << "  Major Fault: Activation fault, verify that no interference or other error occured" << endl;
-      break;
-      case 14:
-        cout << "  Major Fault: Changing mode fault, interferences detected on Scissor (for more than 20 seconds)" << endl;
-      break;
-      case 15:
-        cout << "  Major Fault: Automatic  release completed.  Reset and activation is required." << endl;
-      break;
-      default:   ;
-    }
-
-    cout << endl << "GRIPPER DATA" << endl;
-    cout << "  Finger A" << endl;
-    cout << "    Req Echo = " << ReqEcho_PosFingerA << endl;
-    cout << "    Position = " << PosFingerA << endl;
-    cout << "    Current  = " << CurFingerA << endl;
-
-    cout << "  Finger B" << endl;
-    cout << "    Req Echo = " << ReqEcho_PosFingerB << endl;
-    cout << "    Position = " << PosFingerB << endl;
-    cout << "    Current  = " << CurFingerB << endl;
+    return (value >= 0 && value < count) ? table[value] : "";
+  }
 
-    cout << "  Finger C" << endl;
-    cout << "    Req Echo = " << ReqEcho_PosFingerC << endl;
-    cout << "    Position = " << PosFingerC << endl;
-    cout << "    Current  = " << CurFingerC << endl;
 
-    cout << "  Scissor" << endl;
-    cout << "    Req Echo = " << ReqEcho_PosScissor << endl;
-    cout << "    Position = " << PosScissor << endl;
-    cout << "    Current  = " << CurScissor << endl;
+  LIBRARY_API void CrpiRobotiq::writeStatus ()
+  {
+    static const char *activation[] = {"Gripper reset", "Gripper activation"};
+    static const char *mode[] = {"Basic", "Pinch", "Wide", "Scissor"};
+    static const char *goTo[] = {"Stopped", "GoTo Request"};
+    static const char *setup[] = {"Reset or auto-release state", "Activation in progress",
+                                  "Mode change in progress", "Activation/Mode change complete"};
+    static const char *motion[] = {"Moving to goal pos", "Stopped (1 or 2 fingers stopped before goal pose)",
+                                   "Stopped (all fingers stopped before goal pose)",
+                                   "Stopped (all fingers reached goal pose)"};
+    static const char *object[] = {"in motion", "stopped (contact on open)", "stopped (contact on close)",
+                                   "at requested position"};
+    static const char *fault[] = {"No Fault", "", "", "", "",
+                                  "Priority Fault: Action delayed, activation(reactivation) must be completed prior to action",
+                                  "Priority Fault: Action delayed, mode change must be completed prior to action",
+                                  "Priority Fault: The activation bit must be set prior to action", "",
+                                  "Minor Fault: The communication chip is not ready (may be booting)",
+                                  "Minor Fault: Changing mode fault, interferences detected on Scissor (for less than 20 seconds)",
+                                  "Minor Fault: Automatic release in progress", "",
+                                  "Major Fault: Activation fault, verify that no interference or other error occured",
+                                  "Major Fault: Changing mode fault, interferences detected on Scissor (for more than 20 seconds)",
+                                  "Major Fault: Automatic release completed.  Reset and activation is required."};
+
+    CRPI_LOG(CRPI_LOG_DEBUG, "GRIPPER STATUS");
+    CRPI_LOG(CRPI_LOG_DEBUG, "  Initialization: %s", robotiqStatusText(activation, 2, gACT));
+    CRPI_LOG(CRPI_LOG_DEBUG, "  Grasp Mode: %s", robotiqStatusText(mode, 4, gMOD));
+    CRPI_LOG(CRPI_LOG_DEBUG, "  Stop/Goto: %s", robotiqStatusText(goTo, 2, gGTO));
+    CRPI_LOG(CRPI_LOG_DEBUG, "  Setup: %s", robotiqStatusText(setup, 4, gIMC));
+    CRPI_LOG(CRPI_LOG_DEBUG, "  Motion: %s", robotiqStatusText(motion, 4, gSTA));
+
+    CRPI_LOG(CRPI_LOG_DEBUG, "OBJECT STATUS");
+    CRPI_LOG(CRPI_LOG_DEBUG, "  FingerA: %s", robotiqStatusText(object, 4, gDTA));
+    CRPI_LOG(CRPI_LOG_DEBUG, "  FingerB: %s", robotiqStatusText(object, 4, gDTB));
+    CRPI_LOG(CRPI_LOG_DEBUG, "  FingerC: %s", robotiqStatusText(object, 4, gDTC));
+    CRPI_LOG(CRPI_LOG_DEBUG, "  Scissor: %s", robotiqStatusText(object, 4, gDTS));
+    CRPI_LOG(CRPI_LOG_DEBUG, "  %s", robotiqStatusText(fault, 16, gFLT));
+
+    CRPI_LOG(CRPI_LOG_DEBUG, "GRIPPER DATA");
+    CRPI_LOG(CRPI_LOG_DEBUG, "  Finger A:  Req Echo = %d, Position = %d, Current = %d", ReqEcho_PosFingerA,
+             PosFingerA, CurFingerA);
+    CRPI_LOG(CRPI_LOG_DEBUG, "  Finger B:  Req Echo = %d, Position = %d, Current = %d", ReqEcho_PosFingerB,
+             PosFingerB, CurFingerB);
+    CRPI_LOG(CRPI_LOG_DEBUG, "  Finger C:  Req Echo = %d, Position = %d, Current = %d", ReqEcho_PosFingerC,
+             PosFingerC, CurFingerC);
+    CRPI_LOG(CRPI_LOG_DEBUG, "  Scissor:  Req Echo = %d, Position = %d, Current = %d", ReqEcho_PosScissor,
+             PosScissor, CurScissor);
   }
 
     void LIBRARY_API CrpiRobotiq::setPositionFingerA(int pose)
@@ -1139,7 +1415,7 @@ namespace crpi_robot
     if (pose < 0) pose = 0; // no negative positions
     else if (pose > 255) pose = 255; // max position
     unsigned char y = pose;
-    commandRegister_[16]=y;
+    commandRegister_[3]=y;
   }
 
   void LIBRARY_API CrpiRobotiq::setSpeedFingerA(int speed)
@@ -1147,7 +1423,7 @@ namespace crpi_robot
     if (speed < 0) speed = 0; // no negative speeds
     else if (speed > 255) speed = 255; // max speed
     unsigned char y = speed;
-    commandRegister_[17]=y;
+    commandRegister_[4]=y;
   }
 
   void LIBRARY_API CrpiRobotiq::setForceFingerA(int force)
@@ -1155,7 +1431,7 @@ namespace crpi_robot
     if (force < 0) force = 0; // no negative force
     else if (force > 255) force = 255; // max force
     unsigned char y = force;
-    commandRegister_[18]=y;
+    commandRegister_[5]=y;
   }
 
   void LIBRARY_API CrpiRobotiq::setPositionFingerB(int pose)
@@ -1163,7 +1439,7 @@ namespace crpi_robot
     if (pose < 0) pose = 0; // no negative positions
     else if (pose > 255) pose = 255; // max position
     unsigned char y = pose;
-    commandRegister_[19]=y;
+    commandRegister_[6]=y;
   }
 
   void LIBRARY_API CrpiRobotiq::setSpeedFingerB(int speed)
@@ -1171,7 +1447,7 @@ namespace crpi_robot
     if (speed < 0) speed = 0; // no negative speeds
     else if (speed > 255) speed = 255; // max speed
     unsigned char y = speed;
-    commandRegister_[20]=y;
+    commandRegister_[7]=y;
   }
 
   void LIBRARY_API CrpiRobotiq::setForceFingerB(int force)
@@ -1179,7 +1455,7 @@ namespace crpi_robot
     if (force < 0) force = 0; // no negative force
     else if (force > 255) force = 255; // max force
     unsigned char y = force;
-    commandRegister_[21]=y;
+    commandRegister_[8]=y;
   }
 
   void LIBRARY_API CrpiRobotiq::setPositionFingerC(int pose)
@@ -1187,7 +1463,7 @@ namespace crpi_robot
     if (pose < 0) pose = 0; // no negative positions
     else if (pose > 255) pose = 255; // max position
     unsigned char y = pose;
-    commandRegister_[22]=y;
+    commandRegister_[9]=y;
   }
 
   void LIBRARY_API CrpiRobotiq::setSpeedFingerC(int speed)
@@ -1195,7 +1471,7 @@ namespace crpi_robot
     if (speed < 0) speed = 0; // no negative speeds
     else if (speed > 255) speed = 255; // max speed
     unsigned char y = speed;
-    commandRegister_[23]=y;
+    commandRegister_[10]=y;
   }
 
   void LIBRARY_API CrpiRobotiq::setForceFingerC(int force)
@@ -1203,7 +1479,7 @@ namespace crpi_robot
     if (force < 0) force = 0; // no negative force
     else if (force > 255) force = 255; // max force
     unsigned char y = force;
-    commandRegister_[24]=y;
+    commandRegister_[11]=y;
   }
 
   void LIBRARY_API CrpiRobotiq::setPositionScissor(int pose)
@@ -1211,7 +1487,7 @@ namespace crpi_robot
     if (pose < 0) pose = 0; // no negative positions
     else if (pose > 255) pose = 255; // max position
     unsigned char y = pose;
-    commandRegister_[25]=y;
+    commandRegister_[12]=y;
   }
 
   LIBRARY_API void CrpiRobotiq::setSpeedScissor(int speed)
@@ -1219,7 +1495,7 @@ namespace crpi_robot
     if (speed < 0) speed = 0; // no negative speeds
     else if (speed > 255) speed = 255; // max speed
     unsigned char y = speed;
-    commandRegister_[26]=y;
+    commandRegister_[13]=y;
   }
 
   LIBRARY_API void CrpiRobotiq::setForceScissor(int force)
@@ -1227,7 +1503,7 @@ namespace crpi_robot
     if (force < 0) force = 0; // no negative speeds
     else if (force > 255) force = 255; // max speed
     unsigned char y = force;
-    commandRegister_[27]=y;
+    commandRegister_[14]=y;
   }
 
 } // Robot
@@ -26,10 +26,45 @@
 
 #include <time.h>
 
+//! Number of 16-bit registers in each of the gripper's command and status blocks
+#define ROBOTIQ_REGISTERS 15
+
+//! Largest Modbus/TCP frame (MBAP header + PDU) in bytes
+#define ROBOTIQ_FRAME_MAX 260
+
 using namespace std;
 
 namespace crpi_robot 
 {
+  class CrpiModbusSession;
+
+  //! @ingroup crpi_robot
+  //!
+  //! @brief State shared between a CrpiRobotiq instance and its status poll
+  //!
+  struct robotiqMonitor
+  {
+    //! @brief Serializes Modbus traffic and protects the decoded status fields
+    //!
+    ulapi_mutex_struct *handle;
+
+    //! @brief Broadcast after every status update
+    //!
+    void *statusCond;
+
+    //! @brief Number of callers blocked waiting on a status condition
+    //!
+    int waiters;
+
+    //! @brief Number of status updates received so far
+    //!
+    unsigned long statusCount;
+
+    //! @brief Time (ulapi_time, s) of the last status update
+    //!
+    double lastStatus;
+  };
+
   enum parameter
   {
     ACTIVATE=1,
@@ -67,7 +102,7 @@ namespace crpi_robot
     //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
     //!         not accepted, and FAILURE if the command is accepted but not executed successfully
     //!
-    CanonReturn ApplyCartesianForceTorque (robotPose &robotForceTorque, vector<bool> activeAxes, vector<bool> manipulator);
+    CanonReturn ApplyCartesianForceTorque (robotPose &robotForceTorque, const vector<bool> &activeAxes, const vector<bool> &manipulator);
 
     //! @brief Apply joint torques
     //!
@@ -205,6 +240,28 @@ namespace crpi_robot
     //!
     CanonReturn GetRobotTorques (robotAxes *torques);
 
+    //! @brief Get a consistent snapshot of the robot's latest state without waiting on the
+    //!        robot's feedback connection
+    //!
+    //! @param state Snapshot to be populated by the method
+    //!
+    //! @return SUCCESS if a state has been published by the driver, REJECT if no state is
+    //!         available yet or the robot does not publish state snapshots
+    //!
+    CanonReturn GetRobotState (RobotStateSnapshot *state);
+
+    //! @brief Get the robot's latest state extrapolated to compensate for its age, from the speeds
+    //!        in the state
+    //!
+    //! @param state Snapshot to be populated by the method, as by GetRobotState; its timestamp is
+    //!              the time predicted for
+    //! @param lead  Seconds past the current time (ulapi_time) to predict for; 0 for now
+    //!
+    //! @return SUCCESS if a state has been published by the driver, REJECT if no state is
+    //!         available yet or the robot does not publish the speeds to extrapolate from
+    //!
+    CanonReturn GetPredictedState (RobotStateSnapshot *state, double lead = 0.0);
+
     //! @brief Move a virtual attractor to a specified coordinate in Cartesian space for force control
     //!
     //! @param pose The 6DOF destination of the virtual attractor 
@@ -224,6 +281,80 @@ namespace crpi_robot
     //!
     CanonReturn MoveToAxisTarget (robotAxes &axes, bool useBlocking);
 
+    //! @brief Start streaming finger targets on a second Modbus session
+    //!
+    //! @return SUCCESS if the gripper is ready to accept setpoints, REJECT if a stream is already
+    //!         active, and FAILURE if the session could not be opened
+    //!
+    //! @note Every "stream_period" (s, default 0.02) the stream writes only the command registers
+    //!       that changed since its last write, and requests the status without waiting for it;
+    //!       replies are read on later periods.  Positions, currents, and object detection are
+    //!       published for GetRobotState, so CrpiRobot::WatchDI reports contacts (inputs 0-3:
+    //!       fingers A, B, C, and the scissor).
+    //!
+    CanonReturn BeginStream ();
+
+    //! @brief Send the next Cartesian setpoint of an active stream without waiting for the motion
+    //!
+    //! @param pose The 6DOF setpoint for the robot's TCP in Cartesian space coordinates
+    //!
+    //! @return SUCCESS if the setpoint was sent, REJECT if no stream is active, and FAILURE if the
+    //!         setpoint could not be sent
+    //!
+    CanonReturn StreamPose (robotPose &pose);
+
+    //! @brief Send the next joint setpoint of an active stream without waiting for the motion
+    //!
+    //! @param axes Target positions (0-255) of fingers A, B, C, and the scissor, then (if given)
+    //!             their forces (0-255).  B, C, and the scissor follow their own targets only
+    //!             with ADVANCED_CONTROL and SCISSOR_CONTROL set.
+    //!
+    //! @return SUCCESS if the setpoint was sent, REJECT if no stream is active, and FAILURE if the
+    //!         setpoint could not be sent
+    //!
+    CanonReturn StreamAxes (robotAxes &axes);
+
+    //! @brief Stop an active stream and bring the robot to rest
+    //!
+    //! @return SUCCESS if the stream was stopped, REJECT if no stream is active, and FAILURE if the
+    //!         robot could not be stopped
+    //!
+    CanonReturn EndStream ();
+
+    //! @brief Start streaming Cartesian force/torque targets to a force controller that stays
+    //!        running on the robot, so each update needs no new program
+    //!
+    //! @return SUCCESS if the robot is ready to accept wrench targets, REJECT if force streaming
+    //!         is not supported or a stream is already active, and FAILURE if the stream could
+    //!         not be started
+    //!
+    //! @note The robot holds its position (no axes selected) until the first StreamWrench.  The
+    //!       "stream_period" and "stream_deadline" settings of BeginStream also apply.
+    //!
+    CanonReturn BeginWrenchStream ();
+
+    //! @brief Send the next force/torque target of an active wrench stream without waiting for
+    //!        the robot to respond
+    //!
+    //! @param wrench     Target forces (N) along and torques (N m) about the tool axes
+    //! @param activeAxes Which tool axes (x, y, z, xrot, yrot, zrot) are force controlled; the
+    //!                   others hold position.  TRUE = ACTIVE, FALSE = INACTIVE
+    //! @param limits     For active axes, the largest TCP speed along or about the axis (length or
+    //!                   angle units per second); for the others, the largest deviation from the
+    //!                   held position (length or angle units)
+    //!
+    //! @return SUCCESS if the target was sent, REJECT if no wrench stream is active, and FAILURE
+    //!         if the target could not be sent
+    //!
+    CanonReturn StreamWrench (robotPose &wrench, const vector<bool> &activeAxes, robotPose &limits);
+
+    //! @brief Stop an active wrench stream, leave force control, and bring the robot to rest
+    //!
+    //! @return SUCCESS if the stream was stopped, REJECT if no wrench stream is active, and
+    //!         FAILURE if the robot could not be stopped
+    //!
+    CanonReturn EndWrenchStream ();
+
     //! @brief Set the accerlation for the controlled pose to the given value in length units per
     //!        second per second
     //!
@@ -307,6 +438,11 @@ namespace crpi_robot
     //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
     //!         not accepted, and FAILURE if the command is accepted but not executed successfully
     //!
+    //! @note "WAIT_MOTION" and "WAIT_OBJECT" take an int timeout in ms and block until the last
+    //!       GoTo has finished (or, for "WAIT_OBJECT", a finger reports contact).  "WAIT_OBJECT"
+    //!       overwrites the timeout with 1 if an object was detected, 0 otherwise.  Both return
+    //!       FAILURE if the condition was not reached in time.
+    //!
     CanonReturn SetParameter (const char *paramName, void *paramVal);
 
     //! @brief Set the accerlation for the controlled pose to the given percentage of the robot's
@@ -405,12 +541,29 @@ namespace crpi_robot
 
   private:
     CrpiRobotParams *params_;
-    ulapi_integer clientID_;
 
-    char commandRegister_[43];
-    int ackCommand_[12];
-    char statusRegister_[12];
-    int ackStatus_[128];
+    //! @brief Connection to the gateway, shared with the other devices behind it, and the
+    //!        gripper's Modbus unit identifier there
+    //!
+    CrpiModbusSession *modbus_;
+    unsigned char unit_;
+
+    //! @brief The session's periodic status request for this gripper
+    //!
+    int statusPoll_;
+
+    //! @brief Gripper command registers (action request, options, and per-finger position,
+    //!        speed, and force), written in one block
+    //!
+    unsigned char commandRegister_[ROBOTIQ_REGISTERS * 2];
+
+    //! @brief Gripper status registers from the last status update
+    //!
+    unsigned char statusRegister_[ROBOTIQ_REGISTERS * 2];
+
+    //! @brief Whether the gripper accepts function code 23 (read/write multiple registers)
+    //!
+    bool useReadWrite_;
 
     int  ReqEcho_PosFingerA, ReqEcho_PosFingerB, ReqEcho_PosFingerC, ReqEcho_PosScissor, gripperMode;
     int PosFingerA, PosFingerB, PosFingerC, PosScissor;
@@ -424,15 +577,66 @@ namespace crpi_robot
   
     bool graspedOnClose_, graspedOnOpen_, allFingersAtPos_;
 
-    char inbuffer[8192];
     int option;
 
     void setHandParam (int param, int val);
 
+    //! @brief Send one Modbus request on the shared session and wait for its reply; replies to
+    //!        earlier requests that timed out are discarded
+    //!
+    //! @param function    Modbus function code
+    //! @param pdu         Request data following the function code
+    //! @param length      Number of bytes in pdu
+    //! @param reply       Buffer (ROBOTIQ_FRAME_MAX bytes) for the reply, starting with its function code
+    //! @param replyLength Number of bytes written to reply, 0 if no reply arrived
+    //!
+    //! @return True if a non-exception reply was received, false otherwise
+    //!
+    bool modbusTransact (unsigned char function,
+                         const unsigned char *pdu,
+                         int length,
+                         unsigned char *reply,
+                         int &replyLength);
+
+    //! @brief Write the command registers, reading back the status registers in the same
+    //!        transaction when the gripper supports it
+    //!
     void sendCommand ();
 
     void getStatusRegisters();
 
+    //! @brief Receiver of the session's status polls (CrpiModbusHandler)
+    //!
+    //! @return ROBOTIQ_POLL while a caller is waiting on the gripper, ROBOTIQ_KEEPALIVE otherwise
+    //!
+    static double statusPolled (void *param, const unsigned char *reply, int length);
+
+    //! @brief Decode a status register block and wake anyone waiting on the gripper
+    //!
+    //! @param data ROBOTIQ_REGISTERS * 2 bytes of status registers
+    //!
+    void parseStatus (const unsigned char *data);
+
+    //! @brief Block until a status predicate holds, woken by each status update
+    //!
+    //! @param done    Status predicate to wait for
+    //! @param timeout Maximum time to wait (s)
+    //!
+    //! @return True if the predicate held before the timeout
+    //!
+    //! @note Must be called with monitor_.handle held; it is released while waiting
+    //!
+    bool waitForStatus (bool (CrpiRobotiq::*done)(), double timeout);
+
+    //! @brief Status predicates for waitForStatus
+    //!
+    bool statusCommandSeen ();
+    bool statusActivated ();
+    bool statusReset ();
+    bool statusModeSet ();
+    bool statusMotionDone ();
+    bool statusContact ();
+
     int setGrip(int param);
 
     void setPositionFingerA(int);
@@ -461,9 +665,62 @@ namespace crpi_robot
 
     void writeStatus ();
 
+    //! @brief Streaming session (BeginStream):  its own Modbus connection, so that it never waits
+    //!        behind a blocking request on the shared session, and the SensorHub task that serves it
+    //!
+    ulapi_integer streamID_;
+    int streamTask_;
+    double streamPeriod_;
+    unsigned short streamTransaction_;
+
+    //! @brief Command registers set by StreamAxes, and as last written by the stream (resent
+    //!        whole after a rejected write)
+    //!
+    unsigned char streamTarget_[ROBOTIQ_REGISTERS * 2];
+    unsigned char streamWritten_[ROBOTIQ_REGISTERS * 2];
+    bool streamResync_;
+    void *streamLock_;
+
+    //! @brief Whether a status request is in flight on the stream session, and when it was sent
+    //!
+    bool streamReadPending_;
+    double streamReadSent_;
+
+    //! @brief Bytes received on the stream session that have not been parsed yet
+    //!
+    unsigned char streamRx_[ROBOTIQ_FRAME_MAX];
+    int streamHeld_;
+
+    //! @brief Gripper state for GetRobotState, written by whichever session read the status
+    //!
+    crpi_seqlock<RobotStateSnapshot> state_;
+    void *stateLock_;
+    unsigned long stateCount_;
+
+    //! @brief Send one Modbus request on the stream session without waiting for the reply
+    //!
+    //! @return True if the request was sent
+    //!
+    bool streamSend (unsigned char function, const unsigned char *pdu, int length);
+
+    //! @brief Parse every reply already received on the stream session, without blocking
+    //!
+    void streamReceive ();
+
+    //! @brief Publish a status register block for GetRobotState
+    //!
+    //! @param data ROBOTIQ_REGISTERS * 2 bytes of status registers
+    //!
+    void publishState (const unsigned char *data);
+
+    //! @brief One period of the stream:  read replies, write changed registers, request status
+    //!
+    //! @param param The CrpiRobotiq being streamed
+    //!
+    static void streamTick (void *param);
+
     bool grasped_;
-    void *task;
-    keepalive ka_;
+    robotiqMonitor monitor_;
     unsigned long threadID_;
 
     //! @brief The name of the gripper configuration
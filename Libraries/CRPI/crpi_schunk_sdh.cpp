@@ -13,35 +13,292 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "crpi_schunk_sdh.h"
+#include "crpi_log.h"
+#include "crpi_parse.h"
 #include <fstream>
 #include <iostream>
 #include <string.h>
 #include <sstream>
 
+//! Default SDH joint controller baud rate
+#define SDH_BAUD 115200
+
 using namespace std;
 
 namespace crpi_robot
 {
+  //! @brief Read one reply line from the SDH joint controller
+  //!
+  //! @param sh   Shared cycle state
+  //! @param line Destination of the line (SDH_LINE_MAX bytes), without its terminator
+  //!
+  //! @return False if the serial port failed
+  //!
+  static bool sdhReadLine (sdhHandle *sh, char *line)
+  {
+    char *end;
+    int len, get;
+
+    while (true)
+    {
+      end = (char*)memchr(sh->rx, '\n', sh->held);
+      if (end != NULL)
+      {
+        len = (int)(end - sh->rx);
+        if (len > 0 && sh->rx[len - 1] == '\r')
+        {
+          --len;
+        }
+        memcpy(line, sh->rx, len);
+        line[len] = '\0';
+        sh->held -= (int)(end - sh->rx) + 1;
+        memmove(sh->rx, end + 1, sh->held);
+        return true;
+      }
+      if (sh->held >= SDH_LINE_MAX - 1)
+      {
+        //! Overlong line; drop it
+        sh->held = 0;
+      }
+      get = ulapi_serial_read(sh->serial, sh->rx + sh->held, SDH_LINE_MAX - 1 - sh->held);
+      if (get <= 0)
+      {
+        return false;
+      }
+      sh->held += get;
+    }
+  }
+
+
+  //! @brief Serial cycle thread:  sends any pending joint targets and command together with the
+  //!        position query in a single write, then reads replies until the positions arrive, so
+  //!        each cycle is one round trip at the joint controller's own rate
+  //!
+  void cycleSDH (void *param)
+  {
+    sdhHandle *sh = (sdhHandle*)param;
+    char out[SDH_LINE_MAX * 3], line[SDH_LINE_MAX];
+    int len;
+    sdhStateRecord rec;
+
+    while (sh->runThread)
+    {
+      len = 0;
+      ulapi_mutex_take(sh->handle);
+      if (sh->hasTarget)
+      {
+        //! All seven targets in one command, then start the motion
+        len += sprintf(out + len, "p=%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\r\nm\r\n",
+                       sh->target[0], sh->target[1], sh->target[2], sh->target[3],
+                       sh->target[4], sh->target[5], sh->target[6]);
+        sh->hasTarget = false;
+      }
+      if (sh->hasCommand)
+      {
+        len += sprintf(out + len, "%s\r\n", sh->command);
+        sh->hasCommand = false;
+      }
+      ulapi_mutex_give(sh->handle);
+      len += sprintf(out + len, "pos\r\n");
+
+      if (ulapi_serial_write(sh->serial, out, len) != len)
+      {
+        break;
+      }
+
+      //! Replies arrive in order; the position reply is last
+      while (sh->runThread)
+      {
+        if (!sdhReadLine(sh, line))
+        {
+          return;
+        }
+        if (strncmp(line, "POS=", 4) == 0)
+        {
+          if (crpi_parse_values(line + 4, strlen(line + 4), ",", rec.angles, SDH_AXES) == SDH_AXES)
+          {
+            rec.timestamp = ulapi_time();
+            sh->record.write(rec);
+          }
+          break;
+        }
+      }
+    }
+  }
+
 
   LIBRARY_API CrpiSchunkSDH::CrpiSchunkSDH (CrpiRobotParams &params)
   {
+    char port[16];
+
+    server = server_feedback = -1;
+    cycleTask_ = NULL;
+    tactile_ = NULL;
+    sdh_.runThread = false;
+    sdh_.serial = NULL;
+    sdh_.handle = NULL;
+    sdh_.hasTarget = false;
+    sdh_.hasCommand = false;
+    sdh_.held = 0;
+
+    useNative_ = (strcmp(params.feedback_protocol, "NATIVE") == 0);
+    if (useNative_)
+    {
+      //! "COMn" (and "USBn" on Linux) name the serial port of the SDH joint controller
+#ifdef WIN32
+      strcpy(port, params.serial_port);
+#else
+      if (strncmp(params.serial_port, "COM", 3) == 0)
+      {
+        sprintf(port, "/dev/ttyS%d", atoi(params.serial_port + 3) - 1);
+      }
+      else if (strncmp(params.serial_port, "USB", 3) == 0)
+      {
+        sprintf(port, "/dev/ttyUSB%d", atoi(params.serial_port + 3));
+      }
+      else
+      {
+        strcpy(port, params.serial_port);
+      }
+#endif
+
+      sdh_.serial = ulapi_serial_new();
+      if (sdh_.serial == NULL ||
+          ulapi_serial_open(port, sdh_.serial) != ULAPI_OK ||
+          ulapi_serial_baud(sdh_.serial, (params.serial_rate > 0) ? params.serial_rate : SDH_BAUD) != ULAPI_OK)
+      {
+        CRPI_LOG(CRPI_LOG_ERROR, "CrpiSchunkSDH:  no connection to %s", port);
+        return;
+      }
+      ulapi_serial_set_blocking(sdh_.serial);
+      CRPI_LOG(CRPI_LOG_INFO, "CrpiSchunkSDH:  connection success");
+
+      //! Enable all axis controllers with the first cycle
+      sdh_.handle = ulapi_mutex_new(95);
+      ulapi_lock_name(sdh_.handle, "CrpiSchunkSDH state");
+      strcpy(sdh_.command, "power=1,1,1,1,1,1,1");
+      sdh_.hasCommand = true;
+      sdh_.runThread = true;
+      cycleTask_ = ulapi_task_new();
+      ulapi_task_start((ulapi_task_struct*)cycleTask_, cycleSDH, &sdh_, ulapi_prio_highest(), 0);
+      return;
+    }
+
     server = ulapi_socket_get_client_id (6009, "127.0.0.1");
 
     if (server < 0)
     {
-      cout << "no connection" << endl;
+      CRPI_LOG(CRPI_LOG_ERROR, "CrpiSchunkSDH:  no connection");
     }
     else
     {
-      cout << "connection success" << endl;
+      CRPI_LOG(CRPI_LOG_INFO, "CrpiSchunkSDH:  connection success");
     }
   }
 
   LIBRARY_API CrpiSchunkSDH::~CrpiSchunkSDH ()
   {
+    delete tactile_;
+    if (cycleTask_ != NULL)
+    {
+      //! The cycle thread may be blocked waiting for the controller
+      sdh_.runThread = false;
+      ulapi_task_stop((ulapi_task_struct*)cycleTask_);
+      ulapi_task_join((ulapi_task_struct*)cycleTask_, NULL);
+      ulapi_task_delete((ulapi_task_struct*)cycleTask_);
+      ulapi_mutex_delete(sdh_.handle);
+    }
+    if (sdh_.serial != NULL)
+    {
+      ulapi_serial_close(sdh_.serial);
+      ulapi_serial_delete(sdh_.serial);
+    }
+    if (server >= 0)
+    {
+      ulapi_socket_close(server);
+    }
   }
 
-  LIBRARY_API CanonReturn CrpiSchunkSDH::ApplyCartesianForceTorque (robotPose &robotForceTorque, vector<bool> activeAxes, vector<bool> manipulator)
+
+  LIBRARY_API bool CrpiSchunkSDH::queueCommand (const char *command)
+  {
+    bool queued = false;
+
+    if (cycleTask_ == NULL)
+    {
+      return false;
+    }
+
+    ulapi_mutex_take(sdh_.handle);
+    if (!sdh_.hasCommand)
+    {
+      strncpy(sdh_.command, command, SDH_LINE_MAX - 1);
+      sdh_.command[SDH_LINE_MAX - 1] = '\0';
+      sdh_.hasCommand = true;
+      queued = true;
+    }
+    ulapi_mutex_give(sdh_.handle);
+
+    return queued;
+  }
+
+  LIBRARY_API CanonReturn CrpiSchunkSDH::setTactile (const char *paramName, void *paramVal)
+  {
+    if (strcmp(paramName, "tactile_start") == 0)
+    {
+      if (paramVal == NULL || tactile_ != NULL)
+      {
+        return CANON_REJECT;
+      }
+      tactile_ = new CrpiTactileSensor(*((CrpiTactileConfig*)paramVal));
+      if (!tactile_->Ready() || !tactile_->Start())
+      {
+        delete tactile_;
+        tactile_ = NULL;
+        return CANON_FAILURE;
+      }
+      return CANON_SUCCESS;
+    }
+
+    if (tactile_ == NULL)
+    {
+      return CANON_REJECT;
+    }
+    if (strcmp(paramName, "tactile_stop") == 0)
+    {
+      delete tactile_;
+      tactile_ = NULL;
+      return CANON_SUCCESS;
+    }
+    if (paramVal == NULL)
+    {
+      return CANON_REJECT;
+    }
+    if (strcmp(paramName, "tactile_threshold") == 0)
+    {
+      return tactile_->SetThreshold(*((int*)paramVal)) ? CANON_SUCCESS : CANON_REJECT;
+    }
+    if (strcmp(paramName, "tactile_frame") == 0)
+    {
+      return (tactile_->Frame(*((CrpiTactileFrame*)paramVal)) > 0) ? CANON_SUCCESS : CANON_FAILURE;
+    }
+    if (strcmp(paramName, "tactile_latest") == 0)
+    {
+      return tactile_->Latest(*((CrpiTactileContacts*)paramVal)) ? CANON_SUCCESS : CANON_FAILURE;
+    }
+    if (strcmp(paramName, "tactile_contacts") == 0)
+    {
+      return tactile_->Next(*((CrpiTactileContacts*)paramVal)) ? CANON_SUCCESS : CANON_FAILURE;
+    }
+    if (strcmp(paramName, "tactile_stats") == 0)
+    {
+      tactile_->Stats(*((CrpiTactileStats*)paramVal));
+      return CANON_SUCCESS;
+    }
+    return CANON_REJECT;
+  }
+
+  LIBRARY_API CanonReturn CrpiSchunkSDH::ApplyCartesianForceTorque (robotPose &robotForceTorque, const vector<bool> &activeAxes, const vector<bool> &manipulator)
   {
     //! Not supported
     return CANON_REJECT;
@@ -55,6 +312,16 @@ namespace crpi_robot
 
   LIBRARY_API CanonReturn CrpiSchunkSDH::SetTool (double percent)
   {
+    if (useNative_)
+    {
+      //! Grasp planning lives in the hand server; natively only stopping is available
+      if (percent == 0 || percent == -1)
+      {
+        return queueCommand("stop") ? CANON_SUCCESS : CANON_FAILURE;
+      }
+      return CANON_REJECT;
+    }
+
     strcpy(outbuffer,"");
     strcpy(inbuffer,"");
 
@@ -141,8 +408,17 @@ namespace crpi_robot
 
   LIBRARY_API CanonReturn CrpiSchunkSDH::GetRobotAxes (robotAxes *axes)
   {
-    //! TODO
-    return CANON_FAILURE;
+    sdhStateRecord rec;
+
+    if (!useNative_ || sdh_.record.read(rec) == 0)
+    {
+      return CANON_FAILURE;
+    }
+    for (int i = 0; i < SDH_AXES; ++i)
+    {
+      axes->axis.at(i) = rec.angles[i];
+    }
+    return CANON_SUCCESS;
   }
 
  
@@ -157,6 +433,12 @@ namespace crpi_robot
   {
   //readSDH();
 
+  if (useNative_)
+  {
+    //! Grasp status is reported by the hand server only
+    return CANON_REJECT;
+  }
+
   strcpy(inbuffer,"");
 
   get = ulapi_socket_read(server, inbuffer, MSG_SIZE);
@@ -197,6 +479,20 @@ namespace crpi_robot
   }
 
 
+  LIBRARY_API CanonReturn CrpiSchunkSDH::GetRobotState (RobotStateSnapshot *state)
+  {
+    //! Not applicable:  state is only available by polling the hand directly
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSchunkSDH::GetPredictedState (RobotStateSnapshot *state, double lead)
+  {
+    //! Not applicable
+    return CANON_REJECT;
+  }
+
+
   LIBRARY_API CanonReturn CrpiSchunkSDH::MoveAttractor (robotPose &pose)
   {
     //! Not supported
@@ -206,6 +502,24 @@ namespace crpi_robot
 
   LIBRARY_API CanonReturn CrpiSchunkSDH::MoveToAxisTarget (robotAxes &axes, bool useBlocking)
   {
+    if (useNative_)
+    {
+      if (cycleTask_ == NULL)
+      {
+        return CANON_FAILURE;
+      }
+
+      //! Picked up by the next serial cycle; a newer target replaces one not yet sent
+      ulapi_mutex_take(sdh_.handle);
+      for (int i = 0; i < SDH_AXES; ++i)
+      {
+        sdh_.target[i] = axes.axis.at(i);
+      }
+      sdh_.hasTarget = true;
+      ulapi_mutex_give(sdh_.handle);
+      return CANON_SUCCESS;
+    }
+
     std::ostringstream sstream;
     std::string AngleAsString;
 
@@ -234,6 +548,55 @@ namespace crpi_robot
   }
 
 
+  LIBRARY_API CanonReturn CrpiSchunkSDH::BeginStream ()
+  {
+    //! Not applicable
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSchunkSDH::StreamPose (robotPose &pose)
+  {
+    //! Not applicable
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSchunkSDH::StreamAxes (robotAxes &axes)
+  {
+    //! Not applicable
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSchunkSDH::EndStream ()
+  {
+    //! Not applicable
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSchunkSDH::BeginWrenchStream ()
+  {
+    //! Not applicable
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSchunkSDH::StreamWrench (robotPose &wrench, const vector<bool> &activeAxes, robotPose &limits)
+  {
+    //! Not applicable
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSchunkSDH::EndWrenchStream ()
+  {
+    //! Not applicable
+    return CANON_REJECT;
+  }
+
+
   LIBRARY_API CanonReturn CrpiSchunkSDH::SetAbsoluteAcceleration (double tolerance)
   {
     //! TODO
@@ -292,9 +655,21 @@ namespace crpi_robot
 
   LIBRARY_API CanonReturn CrpiSchunkSDH::SetParameter (const char *paramName, void *paramVal)
   {
+    //! The DSACON32m has a port of its own, so tactile sensing works with either protocol
+    if (strncmp(paramName, "tactile_", 8) == 0)
+    {
+      return setTactile(paramName, paramVal);
+    }
+
     int *temp_int = (int*) paramVal;
     int val = *temp_int;
 
+    if (useNative_)
+    {
+      //! Grip types and finger counts are hand server settings
+      return CANON_REJECT;
+    }
+
     strcpy(outbuffer,"");
 
     if ((strcmp (paramName, "GRIP_TYPE") == 0))
@@ -318,7 +693,7 @@ namespace crpi_robot
 
       get = ulapi_socket_read(server, inbuffer, MSG_SIZE);
 
-      cout << inbuffer << endl;
+      CRPI_LOG(CRPI_LOG_DEBUG, "%s", inbuffer);
     }
 
   if ((strcmp (paramName, "NUM_FINGERS") == 0))
@@ -24,10 +24,70 @@
 #endif
 
 #include "crpi.h"
+#include "crpi_tactile.h"
+
+//! Number of SDH joint axes
+#define SDH_AXES 7
+
+//! Longest SDH firmware command or reply line
+#define SDH_LINE_MAX 256
 
 
 namespace crpi_robot
 {
+  //! @ingroup Robot
+  //!
+  //! @brief Joint state read back from the SDH firmware in one cycle
+  //!
+  struct sdhStateRecord
+  {
+    //! @brief Actual joint angles (degrees)
+    //!
+    double angles[SDH_AXES];
+
+    //! @brief Time (ulapi_time, s) the angles were received
+    //!
+    double timestamp;
+  };
+
+  //! @ingroup Robot
+  //!
+  //! @brief Shared state between CrpiSchunkSDH and its serial cycle thread
+  //!
+  struct sdhHandle
+  {
+    //! @brief Terminator signal from the main thread to the cycle thread
+    //!
+    bool runThread;
+
+    //! @brief ulapi serial port to the SDH joint controller
+    //!
+    void *serial;
+
+    //! @brief Protects the pending target and command
+    //!
+    ulapi_mutex_struct *handle;
+
+    //! @brief Joint targets (degrees) to send with the next cycle
+    //!
+    double target[SDH_AXES];
+    bool hasTarget;
+
+    //! @brief Firmware command to send with the next cycle
+    //!
+    char command[SDH_LINE_MAX];
+    bool hasCommand;
+
+    //! @brief Received bytes not yet consumed as a reply line
+    //!
+    char rx[SDH_LINE_MAX];
+    int held;
+
+    //! @brief Latest joint state
+    //!
+    crpi_seqlock<sdhStateRecord> record;
+  };
+
   //! @ingroup Robot
   //!
   //! @brief CRPI interface for the Schunk dexterous hand
@@ -35,6 +95,10 @@ namespace crpi_robot
   class LIBRARY_API CrpiSchunkSDH
   {
   public:
+    //! @brief Number of axes of the hand (see CrpiAxisCount)
+    //!
+    static constexpr int axisCount = SDH_AXES;
+
     int ii;
     //! @brief Default constructor
     //!
@@ -55,7 +119,7 @@ namespace crpi_robot
     //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
     //!         not accepted, and FAILURE if the command is accepted but not executed successfully
     //!
-    CanonReturn ApplyCartesianForceTorque (robotPose &robotForceTorque, vector<bool> activeAxes, vector<bool> manipulator);
+    CanonReturn ApplyCartesianForceTorque (robotPose &robotForceTorque, const vector<bool> &activeAxes, const vector<bool> &manipulator);
 
     //! @brief Apply joint torques
     //!
@@ -193,6 +257,28 @@ namespace crpi_robot
     //!
     CanonReturn GetRobotTorques (robotAxes *torques);
 
+    //! @brief Get a consistent snapshot of the robot's latest state without waiting on the
+    //!        robot's feedback connection
+    //!
+    //! @param state Snapshot to be populated by the method
+    //!
+    //! @return SUCCESS if a state has been published by the driver, REJECT if no state is
+    //!         available yet or the robot does not publish state snapshots
+    //!
+    CanonReturn GetRobotState (RobotStateSnapshot *state);
+
+    //! @brief Get the robot's latest state extrapolated to compensate for its age, from the speeds
+    //!        in the state
+    //!
+    //! @param state Snapshot to be populated by the method, as by GetRobotState; its timestamp is
+    //!              the time predicted for
+    //! @param lead  Seconds past the current time (ulapi_time) to predict for; 0 for now
+    //!
+    //! @return SUCCESS if a state has been published by the driver, REJECT if no state is
+    //!         available yet or the robot does not publish the speeds to extrapolate from
+    //!
+    CanonReturn GetPredictedState (RobotStateSnapshot *state, double lead = 0.0);
+
     //! @brief Move a virtual attractor to a specified coordinate in Cartesian space for force control
     //!
     //! @param pose The 6DOF destination of the virtual attractor 
@@ -212,6 +298,72 @@ namespace crpi_robot
     //!
     CanonReturn MoveToAxisTarget (robotAxes &axes, bool useBlocking);
 
+    //! @brief Start streaming motion setpoints to the robot at the controller's native rate
+    //!
+    //! @return SUCCESS if the robot is ready to accept setpoints, REJECT if streaming is not
+    //!         supported, and FAILURE if the stream could not be started
+    //!
+    CanonReturn BeginStream ();
+
+    //! @brief Send the next Cartesian setpoint of an active stream without waiting for the motion
+    //!
+    //! @param pose The 6DOF setpoint for the robot's TCP in Cartesian space coordinates
+    //!
+    //! @return SUCCESS if the setpoint was sent, REJECT if no stream is active, and FAILURE if the
+    //!         setpoint could not be sent
+    //!
+    CanonReturn StreamPose (robotPose &pose);
+
+    //! @brief Send the next joint setpoint of an active stream without waiting for the motion
+    //!
+    //! @param axes Target axis values specified in the current axial unit
+    //!
+    //! @return SUCCESS if the setpoint was sent, REJECT if no stream is active, and FAILURE if the
+    //!         setpoint could not be sent
+    //!
+    CanonReturn StreamAxes (robotAxes &axes);
+
+    //! @brief Stop an active stream and bring the robot to rest
+    //!
+    //! @return SUCCESS if the stream was stopped, REJECT if no stream is active, and FAILURE if the
+    //!         robot could not be stopped
+    //!
+    CanonReturn EndStream ();
+
+    //! @brief Start streaming Cartesian force/torque targets to a force controller that stays
+    //!        running on the robot, so each update needs no new program
+    //!
+    //! @return SUCCESS if the robot is ready to accept wrench targets, REJECT if force streaming
+    //!         is not supported or a stream is already active, and FAILURE if the stream could
+    //!         not be started
+    //!
+    //! @note The robot holds its position (no axes selected) until the first StreamWrench.  The
+    //!       "stream_period" and "stream_deadline" settings of BeginStream also apply.
+    //!
+    CanonReturn BeginWrenchStream ();
+
+    //! @brief Send the next force/torque target of an active wrench stream without waiting for
+    //!        the robot to respond
+    //!
+    //! @param wrench     Target forces (N) along and torques (N m) about the tool axes
+    //! @param activeAxes Which tool axes (x, y, z, xrot, yrot, zrot) are force controlled; the
+    //!                   others hold position.  TRUE = ACTIVE, FALSE = INACTIVE
+    //! @param limits     For active axes, the largest TCP speed along or about the axis (length or
+    //!                   angle units per second); for the others, the largest deviation from the
+    //!                   held position (length or angle units)
+    //!
+    //! @return SUCCESS if the target was sent, REJECT if no wrench stream is active, and FAILURE
+    //!         if the target could not be sent
+    //!
+    CanonReturn StreamWrench (robotPose &wrench, const vector<bool> &activeAxes, robotPose &limits);
+
+    //! @brief Stop an active wrench stream, leave force control, and bring the robot to rest
+    //!
+    //! @return SUCCESS if the stream was stopped, REJECT if no wrench stream is active, and
+    //!         FAILURE if the robot could not be stopped
+    //!
+    CanonReturn EndWrenchStream ();
+
     //! @brief Set the accerlation for the controlled pose to the given value in length units per
     //!        second per second
     //!
@@ -295,6 +447,14 @@ namespace crpi_robot
     //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
     //!         not accepted, and FAILURE if the command is accepted but not executed successfully
     //!
+    //! @note Tactile sensing, with either protocol:  "tactile_start" (CrpiTactileConfig*) opens
+    //!       the DSACON32m and starts acquisition, "tactile_stop" (NULL) ends it,
+    //!       "tactile_threshold" (int*) sets the texel threshold, "tactile_frame"
+    //!       (CrpiTactileFrame*) and "tactile_latest" (CrpiTactileContacts*) copy the newest
+    //!       frame and its contacts, "tactile_contacts" (CrpiTactileContacts*) takes the contacts
+    //!       of the oldest frame not yet taken (FAILURE if there is none), and "tactile_stats"
+    //!       (CrpiTactileStats*) copies the counters
+    //!
     CanonReturn SetParameter (const char *paramName, void *paramVal);
 
     //! @brief Set the accerlation for the controlled pose to the given percentage of the robot's
@@ -395,6 +555,29 @@ namespace crpi_robot
 
     ulapi_integer server, server_feedback;
 
+    //! @brief Whether the driver talks to the SDH firmware directly over RS-232 (Feedback
+    //!        Protocol="NATIVE") instead of through the hand server
+    //!
+    bool useNative_;
+    sdhHandle sdh_;
+    void *cycleTask_;
+
+    //! @brief Queue a firmware command for the next serial cycle
+    //!
+    //! @param command Command text without the line terminator
+    //!
+    //! @return True if the command was queued, false if the previous command has not been sent yet
+    //!
+    bool queueCommand (const char *command);
+
+    //! @brief Handle the "tactile_*" parameters of SetParameter
+    //!
+    CanonReturn setTactile (const char *paramName, void *paramVal);
+
+    //! @brief DSA tactile acquisition (NULL until "tactile_start")
+    //!
+    CrpiTactileSensor *tactile_;
+
     void *task;
     keepalive ka_;
     unsigned long threadID_;
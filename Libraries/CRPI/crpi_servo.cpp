@@ -0,0 +1,235 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_servo.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Real-time servo task definitions.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_servo.h"
+#include "crpi_hub.h"
+#include "crpi_log.h"
+
+#include <new>
+
+namespace crpi_robot
+{
+  LIBRARY_API CrpiServo::CrpiServo (double period, const ulapi_task_attr &attr, ulapi_id key) :
+    period_((period > 0.0) ? period : CRPI_SERVO_PERIOD),
+    attr_(attr),
+    rtm_(NULL),
+    shared_(NULL),
+    task_(NULL),
+    running_(false),
+    realtime_(false),
+    cycle_(NULL),
+    param_(NULL),
+    droppedSetpoints_(0)
+  {
+    void *addr;
+
+    if (key != 0)
+    {
+      rtm_ = ulapi_rtm_new(key, sizeof(crpiServoShared));
+      addr = (rtm_ == NULL) ? NULL : ulapi_rtm_addr(rtm_);
+    }
+    else
+    {
+      addr = ::operator new(sizeof(crpiServoShared), std::nothrow);
+    }
+    if (addr == NULL)
+    {
+      CRPI_LOG(CRPI_LOG_ERROR, "CrpiServo:  could not create the servo segment (key %d)", (int)key);
+      return;
+    }
+
+    //! Zeroed first, so that a task attached to the key sees no magic until the rings are ready
+    memset(addr, 0, sizeof(crpiServoShared));
+    shared_ = (crpiServoShared*)addr;
+    shared_->version = CRPI_SERVO_VERSION;
+    shared_->period = period_;
+  }
+
+
+  LIBRARY_API CrpiServo::~CrpiServo ()
+  {
+    Stop();
+    if (rtm_ != NULL)
+    {
+      ulapi_rtm_delete(rtm_);
+    }
+    else if (shared_ != NULL)
+    {
+      ::operator delete((void*)shared_);
+    }
+  }
+
+
+  LIBRARY_API bool CrpiServo::Ready () const
+  {
+    return (shared_ != NULL);
+  }
+
+
+  LIBRARY_API bool CrpiServo::Start (CrpiServoCycle cycle, void *param)
+  {
+    ulapi_task_attr attr = attr_;
+    ulapi_result result;
+
+    if (shared_ == NULL || cycle == NULL || running_.load())
+    {
+      return false;
+    }
+
+    cycle_ = cycle;
+    param_ = param;
+    shared_->commands.clear();
+    shared_->feedback.clear();
+    droppedSetpoints_.store(0);
+    shared_->magic.store(CRPI_SERVO_SHM_MAGIC, std::memory_order_release);
+
+    //! Scheduled as the hub would schedule its real-time class, so that a processor reserved for
+    //! control loops with SensorHub::SetAffinity is used when <RealTime> names none
+    if (attr.cpu < 0)
+    {
+      attr.cpu = SensorHub::Instance().GetAffinity(HUB_REALTIME);
+    }
+    running_.store(true);
+    task_ = ulapi_task_new();
+    result = (task_ == NULL) ? ULAPI_ERROR : ulapi_task_start_attr((ulapi_task_struct*)task_, run, this, &attr);
+    if (result != ULAPI_OK && result != ULAPI_IMPL_ERROR)
+    {
+      CRPI_LOG(CRPI_LOG_ERROR, "CrpiServo:  could not start the servo task");
+      running_.store(false);
+      if (task_ != NULL)
+      {
+        ulapi_task_delete((ulapi_task_struct*)task_);
+        task_ = NULL;
+      }
+      shared_->magic.store(0, std::memory_order_release);
+      return false;
+    }
+
+    //! ULAPI_IMPL_ERROR:  running, but without the priority or memory lock asked for
+    realtime_ = (result == ULAPI_OK && attr.policy != ULAPI_SCHED_NORMAL);
+    if (result == ULAPI_IMPL_ERROR)
+    {
+      CRPI_LOG(CRPI_LOG_WARNING, "CrpiServo:  real-time scheduling refused; servo jitter is not bounded");
+    }
+    return true;
+  }
+
+
+  LIBRARY_API void CrpiServo::Stop ()
+  {
+    if (task_ == NULL)
+    {
+      return;
+    }
+    running_.store(false);
+    ulapi_task_join((ulapi_task_struct*)task_, NULL);
+    ulapi_task_delete((ulapi_task_struct*)task_);
+    task_ = NULL;
+    shared_->magic.store(0, std::memory_order_release);
+  }
+
+
+  LIBRARY_API bool CrpiServo::Running () const
+  {
+    return running_.load();
+  }
+
+
+  LIBRARY_API bool CrpiServo::Push (const CrpiServoSetpoint &setpoint)
+  {
+    if (!running_.load())
+    {
+      return false;
+    }
+    if (!shared_->commands.push(setpoint))
+    {
+      droppedSetpoints_.fetch_add(1);
+      return false;
+    }
+    return true;
+  }
+
+
+  LIBRARY_API bool CrpiServo::Pop (CrpiServoFeedback &feedback)
+  {
+    return (shared_ != NULL && shared_->feedback.pop(feedback));
+  }
+
+
+  LIBRARY_API void CrpiServo::Stats (CrpiServoStats &stats) const
+  {
+    memset(&stats, 0, sizeof(stats));
+    if (shared_ != NULL)
+    {
+      shared_->stats.read(stats);
+    }
+    stats.period = period_;
+    stats.droppedSetpoints = droppedSetpoints_.load();
+  }
+
+
+  void CrpiServo::run (void *param)
+  {
+    CrpiServo *servo = (CrpiServo*)param;
+    crpiServoShared *sh = servo->shared_;
+    CrpiServoSetpoint setpoint;
+    CrpiServoFeedback feedback;
+    CrpiServoStats stats;
+    double due, now, done, total = 0.0;
+    long missed;
+    unsigned int taken;
+    bool following = false;
+
+    memset(&stats, 0, sizeof(stats));
+    stats.period = servo->period_;
+    stats.realtime = servo->realtime_;
+
+    //! Cycles start on absolute deadlines, so neither the cycle's work nor a late wake-up makes
+    //! the rate drift
+    crpi_periodic cycle (servo->period_);
+    due = ulapi_time() + servo->period_;
+
+    while (servo->running_.load(std::memory_order_relaxed))
+    {
+      missed = cycle.wait();
+      now = ulapi_time();
+
+      memset(&feedback, 0, sizeof(feedback));
+      feedback.cycle = ++stats.cycles;
+      feedback.lateness = (now > due) ? (now - due) : 0.0;
+      due += servo->period_ * ((missed > 0) ? missed : 1);
+      stats.overruns += (missed > 0) ? (unsigned long)missed : 0;
+
+      //! Only the newest setpoint matters; older ones were overtaken before the robot saw them
+      taken = sh->commands.drain(setpoint);
+      if (taken == 0 && following)
+      {
+        ++stats.starved;
+      }
+      following = servo->cycle_(servo->param_, (taken > 0) ? &setpoint : NULL, feedback);
+
+      if (!sh->feedback.push(feedback))
+      {
+        ++stats.droppedFeedback;
+      }
+
+      done = ulapi_time();
+      total += feedback.lateness;
+      stats.meanLateness = total / stats.cycles;
+      stats.worstLateness = cycle.worst();
+      stats.worstCycle = ((done - now) > stats.worstCycle) ? (done - now) : stats.worstCycle;
+      sh->stats.write(stats);
+    }
+  }
+} // crpi_robot
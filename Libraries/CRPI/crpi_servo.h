@@ -0,0 +1,345 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_servo.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Real-time servo task for streamed setpoints.
+//
+//  Without it, every StreamPose or StreamAxes goes to the robot from the
+//  application's own thread, so the servo rate seen by the controller has
+//  whatever jitter that thread has.  A CrpiServo instead runs the servo
+//  cycle on a task of its own, at a fixed period on absolute deadlines, with
+//  the scheduling of the robot's <RealTime> tag (SCHED_FIFO, a pinned
+//  processor, and memory locked and prefaulted, which on PREEMPT_RT or the
+//  Xenomai POSIX skin bounds the jitter to tens of microseconds).  The
+//  front end and the task never share a lock:  setpoints go to the task,
+//  and the state each cycle saw comes back, through single-producer,
+//  single-consumer rings in one ulapi_rtm segment.  The task takes the
+//  newest setpoint each cycle, so a late application costs a repeated
+//  setpoint rather than a missed deadline.
+//
+//  The segment is RTAI shared memory when ulapi is built with HAVE_RTAI, so
+//  that a kernel task can serve the same rings through rtapi_rtm_new with
+//  the key given to CrpiServo.  Its layout:
+//
+//    crpiServoShared
+//      magic, version              CRPI_SERVO_SHM_MAGIC, CRPI_SERVO_VERSION
+//      period                      servo period (s)
+//      commands                    crpi_spsc_ring<CrpiServoSetpoint, CRPI_SERVO_RING>
+//      feedback                    crpi_spsc_ring<CrpiServoFeedback, CRPI_SERVO_RING>
+//      stats                       crpi_seqlock<CrpiServoStats>
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_servo_H
+#define crpi_servo_H
+
+#include "crpi.h"
+
+//! Marks an initialized servo segment ("CRSV")
+#define CRPI_SERVO_SHM_MAGIC 0x56535243
+
+//! Layout version of crpiServoShared
+#define CRPI_SERVO_VERSION 1
+
+//! Slots in each ring (a power of two)
+#define CRPI_SERVO_RING 64
+
+//! Default servo period (s)
+#define CRPI_SERVO_PERIOD 0.002
+
+namespace crpi_robot
+{
+  //! @brief Lock-free ring between one producer and one consumer, which may be different
+  //!        processes (or an RTAI task) when the ring is in shared memory
+  //!
+  //! @note T must not own heap memory, and N must be a power of two
+  //!
+  template <class T, unsigned int N> class crpi_spsc_ring
+  {
+  public:
+    //! @brief Empty the ring.  Neither side may be using it.
+    //!
+    void clear ()
+    {
+      head_.store(0, std::memory_order_relaxed);
+      tail_.store(0, std::memory_order_relaxed);
+    }
+
+    //! @brief Add a value (producer only)
+    //!
+    //! @return False if the ring is full
+    //!
+    bool push (const T &value)
+    {
+      unsigned int head = head_.load(std::memory_order_relaxed);
+
+      if ((head - tail_.load(std::memory_order_acquire)) >= N)
+      {
+        return false;
+      }
+      memcpy((void*)&slot_[head & (N - 1)], (const void*)&value, sizeof(T));
+      head_.store(head + 1, std::memory_order_release);
+      return true;
+    }
+
+    //! @brief Take the oldest value (consumer only)
+    //!
+    //! @return False if the ring is empty
+    //!
+    bool pop (T &value)
+    {
+      unsigned int tail = tail_.load(std::memory_order_relaxed);
+
+      if (tail == head_.load(std::memory_order_acquire))
+      {
+        return false;
+      }
+      memcpy((void*)&value, (const void*)&slot_[tail & (N - 1)], sizeof(T));
+      tail_.store(tail + 1, std::memory_order_release);
+      return true;
+    }
+
+    //! @brief Take every value, keeping the newest (consumer only)
+    //!
+    //! @return The number of values taken
+    //!
+    unsigned int drain (T &newest)
+    {
+      unsigned int tail = tail_.load(std::memory_order_relaxed);
+      unsigned int head = head_.load(std::memory_order_acquire);
+
+      if (tail == head)
+      {
+        return 0;
+      }
+      memcpy((void*)&newest, (const void*)&slot_[(head - 1) & (N - 1)], sizeof(T));
+      tail_.store(head, std::memory_order_release);
+      return head - tail;
+    }
+
+    //! @brief Number of values waiting
+    //!
+    unsigned int size () const
+    {
+      return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+  private:
+    std::atomic<unsigned int> head_;
+    std::atomic<unsigned int> tail_;
+    T slot_[N];
+  };
+
+
+  //! @brief What a servo setpoint holds
+  //!
+  typedef enum
+  {
+    SERVO_AXES = 0, //! Joint setpoint (the robot's axis units)
+    SERVO_POSE      //! TCP setpoint (the robot's length and angle units)
+  } CrpiServoKind;
+
+
+  //! @brief A setpoint for the servo task
+  //!
+  struct CrpiServoSetpoint
+  {
+    //! @brief SERVO_AXES or SERVO_POSE; only the matching member is used
+    //!
+    int kind;
+
+    //! @brief Time (ulapi_time, s) the setpoint was sent
+    //!
+    double time;
+
+    robotAxes axes;
+    robotPose pose;
+  };
+
+
+  //! @brief The outcome of one servo cycle
+  //!
+  struct CrpiServoFeedback
+  {
+    //! @brief Cycle number, from 1
+    //!
+    unsigned long cycle;
+
+    //! @brief How late (s) the cycle started after its deadline
+    //!
+    double lateness;
+
+    //! @brief Whether the cycle sent a setpoint to the robot, and whether the robot took it
+    //!
+    bool sent;
+    bool accepted;
+
+    //! @brief The robot's state when the cycle ran
+    //!
+    RobotStateSnapshot state;
+  };
+
+
+  //! @brief Timing of a servo task
+  //!
+  struct CrpiServoStats
+  {
+    //! @brief Servo period (s)
+    //!
+    double period;
+
+    //! @brief Cycles run, deadlines overrun (and skipped), cycles that found no new setpoint
+    //!        while one was still being followed, and setpoints and feedback dropped because a
+    //!        ring was full
+    //!
+    unsigned long cycles;
+    unsigned long overruns;
+    unsigned long starved;
+    unsigned long droppedSetpoints;
+    unsigned long droppedFeedback;
+
+    //! @brief Lateness (s) of the cycles' starts after their deadlines:  mean and worst
+    //!
+    double meanLateness;
+    double worstLateness;
+
+    //! @brief Longest time (s) a cycle took
+    //!
+    double worstCycle;
+
+    //! @brief Whether the task got the real-time scheduling it was configured with
+    //!
+    bool realtime;
+  };
+
+
+  //! @brief Layout of a servo segment
+  //!
+  struct crpiServoShared
+  {
+    //! @brief CRPI_SERVO_SHM_MAGIC while the task is running, 0 otherwise
+    //!
+    std::atomic<unsigned int> magic;
+
+    //! @brief CRPI_SERVO_VERSION
+    //!
+    unsigned int version;
+
+    //! @brief Servo period (s)
+    //!
+    double period;
+
+    //! @brief Front end to task, and task to front end
+    //!
+    crpi_spsc_ring<CrpiServoSetpoint, CRPI_SERVO_RING> commands;
+    crpi_spsc_ring<CrpiServoFeedback, CRPI_SERVO_RING> feedback;
+
+    //! @brief Published by the task every cycle
+    //!
+    crpi_seqlock<CrpiServoStats> stats;
+  };
+
+
+  //! @brief Work done by a servo task each cycle
+  //!
+  //! @param param    As given to CrpiServo::Start
+  //! @param setpoint The newest setpoint since the last cycle, or NULL if none arrived
+  //! @param feedback To be populated with the cycle's outcome (cycle and lateness are filled
+  //!                 in by the task)
+  //!
+  //! @return True if the cycle is still following a stream (so that a cycle without a new
+  //!         setpoint counts as starved)
+  //!
+  typedef bool (*CrpiServoCycle)(void *param, const CrpiServoSetpoint *setpoint, CrpiServoFeedback &feedback);
+
+
+  //! @ingroup Robot
+  //!
+  //! @brief Periodic real-time task fed by a setpoint ring (used by CrpiRobot when the
+  //!        "stream_servo" parameter is set)
+  //!
+  class LIBRARY_API CrpiServo
+  {
+  public:
+    //! @brief Default constructor.  Creates the segment; the task starts with Start.
+    //!
+    //! @param period Servo period (s)
+    //! @param attr   Scheduling of the task (e.g., the robot's servo_task)
+    //! @param key    ulapi_rtm key of the segment, for a task in another process or in RTAI (0
+    //!               for memory private to this process)
+    //!
+    CrpiServo (double period, const ulapi_task_attr &attr, ulapi_id key = 0);
+
+    //! @brief Default destructor.  Stops the task.
+    //!
+    ~CrpiServo ();
+
+    //! @brief Whether the segment could be created
+    //!
+    bool Ready () const;
+
+    //! @brief Start the task, with empty rings
+    //!
+    //! @param cycle The work of each cycle
+    //! @param param Passed to the cycle
+    //!
+    //! @return True if the task was started
+    //!
+    bool Start (CrpiServoCycle cycle, void *param);
+
+    //! @brief Stop the task and wait for its current cycle to finish
+    //!
+    void Stop ();
+
+    //! @brief Whether the task is running
+    //!
+    bool Running () const;
+
+    //! @brief Send a setpoint to the task (front end only).  Never blocks.
+    //!
+    //! @return False if the task is not running or the ring is full
+    //!
+    bool Push (const CrpiServoSetpoint &setpoint);
+
+    //! @brief Take the oldest cycle outcome not yet taken (front end only).  Outcomes are
+    //!        dropped when CRPI_SERVO_RING of them are waiting.
+    //!
+    //! @return False if there is none
+    //!
+    bool Pop (CrpiServoFeedback &feedback);
+
+    //! @brief Copy the task's timing
+    //!
+    void Stats (CrpiServoStats &stats) const;
+
+  private:
+    //! @brief The task
+    //!
+    static void run (void *param);
+
+    double period_;
+    ulapi_task_attr attr_;
+    void *rtm_;
+    crpiServoShared *shared_;
+    void *task_;
+    std::atomic<bool> running_;
+    bool realtime_;
+    CrpiServoCycle cycle_;
+    void *param_;
+
+    //! @brief Drops counted by the front end, folded into the task's statistics
+    //!
+    std::atomic<unsigned long> droppedSetpoints_;
+
+    CrpiServo (const CrpiServo &) = delete;
+    CrpiServo &operator= (const CrpiServo &) = delete;
+  }; // CrpiServo
+} // crpi_robot
+
+#endif
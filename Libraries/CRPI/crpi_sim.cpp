@@ -0,0 +1,796 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_sim.cpp
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Simulated robot interface definitions.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_sim.h"
+#include "crpi_log.h"
+
+#include <iostream>
+
+using namespace std;
+
+//#define SIM_NOISY
+
+namespace crpi_robot
+{
+  //! @brief Advance the simulated motion by one time step.  Must be called with sh->handle held.
+  //!
+  //! @param sh Simulated controller
+  //! @param dt Time step (s).  With a zero time step only motions with a speed of 0 advance.
+  //!
+  static void simStep (simHandle *sh, double dt)
+  {
+    double d[6], dist, turn, f;
+    int i;
+
+    if (sh->poseMoving)
+    {
+      d[0] = sh->poseTarget.x - sh->pose.x;
+      d[1] = sh->poseTarget.y - sh->pose.y;
+      d[2] = sh->poseTarget.z - sh->pose.z;
+      d[3] = sh->poseTarget.xrot - sh->pose.xrot;
+      d[4] = sh->poseTarget.yrot - sh->pose.yrot;
+      d[5] = sh->poseTarget.zrot - sh->pose.zrot;
+      dist = sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+      turn = 0.0;
+      for (i = 3; i < 6; ++i)
+      {
+        turn = (fabs(d[i]) > turn) ? fabs(d[i]) : turn;
+      }
+
+      //! Position and orientation arrive together, limited by whichever is slower
+      f = 1.0;
+      if (sh->linearSpeed > 0.0 && dist > 0.0)
+      {
+        f = min(f, sh->linearSpeed * sh->speedScale * dt / dist);
+      }
+      if (sh->angularSpeed > 0.0 && turn > 0.0)
+      {
+        f = min(f, sh->angularSpeed * sh->speedScale * dt / turn);
+      }
+
+      sh->pose.x += f * d[0];
+      sh->pose.y += f * d[1];
+      sh->pose.z += f * d[2];
+      sh->pose.xrot += f * d[3];
+      sh->pose.yrot += f * d[4];
+      sh->pose.zrot += f * d[5];
+      if (dt > 0.0)
+      {
+        sh->poseSpeed.x = f * d[0] / dt;
+        sh->poseSpeed.y = f * d[1] / dt;
+        sh->poseSpeed.z = f * d[2] / dt;
+        sh->poseSpeed.xrot = f * d[3] / dt;
+        sh->poseSpeed.yrot = f * d[4] / dt;
+        sh->poseSpeed.zrot = f * d[5] / dt;
+      }
+      if (f >= 1.0)
+      {
+        sh->pose = sh->poseTarget;
+        sh->poseMoving = false;
+      }
+    }
+    else if (dt > 0.0)
+    {
+      sh->poseSpeed = robotPose();
+    }
+
+    if (sh->axesMoving)
+    {
+      turn = 0.0;
+      for (i = 0; i < sh->axes.axes; ++i)
+      {
+        dist = fabs(sh->axesTarget.axis[i] - sh->axes.axis[i]);
+        turn = (dist > turn) ? dist : turn;
+      }
+
+      //! Joint motion is coordinated:  every axis finishes with the one that has furthest to go
+      f = 1.0;
+      if (sh->jointSpeed > 0.0 && turn > 0.0)
+      {
+        f = min(f, sh->jointSpeed * sh->speedScale * dt / turn);
+      }
+
+      for (i = 0; i < sh->axes.axes; ++i)
+      {
+        dist = f * (sh->axesTarget.axis[i] - sh->axes.axis[i]);
+        sh->axes.axis[i] += dist;
+        if (dt > 0.0)
+        {
+          sh->axesSpeed.axis[i] = dist / dt;
+        }
+      }
+      if (f >= 1.0)
+      {
+        sh->axes = sh->axesTarget;
+        sh->axesMoving = false;
+      }
+    }
+    else if (dt > 0.0)
+    {
+      sh->axesSpeed.axis.fill(0.0);
+    }
+  }
+
+
+  //! @brief Publish the simulated state to GetRobotState readers.  Must be called with
+  //!        sh->handle held.
+  //!
+  static void simPublish (simHandle *sh)
+  {
+    sh->latest.pose = sh->pose;
+    sh->latest.speeds = sh->poseSpeed;
+    sh->latest.setAxes(sh->axes);
+    sh->latest.setIO(sh->io);
+    sh->latest.valid = STATE_POSE | STATE_AXES | STATE_FORCES | STATE_SPEEDS | STATE_IO | STATE_TORQUES;
+    sh->latest.timestamp = ulapi_time();
+    ++sh->latest.sequence;
+    sh->state.write(sh->latest);
+  }
+
+
+  //! @brief Control thread of the simulated controller
+  //!
+  //! @param param Pointer to the simHandle to run
+  //!
+  void simulateSim (void *param)
+  {
+    simHandle *sh = (simHandle*)param;
+    double last = ulapi_time(), now, period;
+
+    ulapi_mutex_take(sh->handle);
+    period = sh->period;
+    ulapi_mutex_give(sh->handle);
+
+    //! Cycles are scheduled on absolute deadlines so that the rate does not drift
+    crpi_periodic cycle (period);
+
+    while (sh->runThread)
+    {
+      cycle.wait();
+
+      now = ulapi_time();
+      ulapi_mutex_take(sh->handle);
+      if (sh->streaming && sh->streamDeadline > 0.0 && (now - sh->lastSetpoint) > sh->streamDeadline)
+      {
+        //! Setpoints stopped arriving; hold position as the real controllers do
+        sh->poseTarget = sh->pose;
+        sh->axesTarget = sh->axes;
+      }
+      simStep(sh, now - last);
+      simPublish(sh);
+      ulapi_cond_broadcast(sh->moved);
+      if (sh->period != period)
+      {
+        period = sh->period;
+        cycle.reset(period);
+      }
+      ulapi_mutex_give(sh->handle);
+      last = now;
+    }
+  }
+
+
+  LIBRARY_API CrpiSim::CrpiSim (CrpiRobotParams &params)
+  {
+    double rate = SIM_RATE;
+    int axes = SIM_AXES;
+
+    latency_ = jitter_ = 0.0;
+    seed_ = 88172645463325252ULL;
+
+    //! Timing of the CRPI driver being imitated:  RTDE, the IRC5 state server, and the KRC
+    //! interpolation cycle
+    if (strcmp(params.feedback_protocol, "UR") == 0)
+    {
+      rate = 500.0;
+      latency_ = 0.002;
+      axes = 6;
+    }
+    else if (strcmp(params.feedback_protocol, "ABB") == 0)
+    {
+      rate = 250.0;
+      latency_ = 0.004;
+      axes = 7;
+    }
+    else if (strcmp(params.feedback_protocol, "KUKA") == 0)
+    {
+      rate = 83.3;
+      latency_ = 0.012;
+      axes = 7;
+    }
+    if (params.feedback_rate > 0.0)
+    {
+      rate = params.feedback_rate;
+    }
+
+    sim_.runThread = true;
+    sim_.handle = ulapi_mutex_new(0);
+    ulapi_lock_name(sim_.handle, "CrpiSim state");
+    sim_.moved = ulapi_cond_new(0);
+    sim_.period = 1.0 / rate;
+    sim_.linearSpeed = SIM_LINEAR_SPEED;
+    sim_.angularSpeed = SIM_ANGULAR_SPEED;
+    sim_.jointSpeed = SIM_JOINT_SPEED;
+    sim_.speedScale = 1.0;
+    sim_.pose.status = sim_.pose.turns = 0;
+    sim_.poseTarget = sim_.pose;
+    sim_.poseMoving = false;
+    sim_.axes = sim_.axesTarget = sim_.axesSpeed = robotAxes(axes);
+    sim_.axesMoving = false;
+    sim_.stops = 0;
+    sim_.tool = 0.0;
+    sim_.streaming = false;
+    sim_.lastSetpoint = 0.0;
+    sim_.streamDeadline = 0.0;
+
+    ulapi_mutex_take(sim_.handle);
+    simPublish(&sim_);
+    ulapi_mutex_give(sim_.handle);
+
+    simTask_ = ulapi_task_new();
+    ulapi_task_start((ulapi_task_struct*)simTask_, simulateSim, &sim_, ulapi_prio_lowest(), 0);
+
+    CRPI_LOG(CRPI_LOG_DEBUG, "simulating %d axes at %f Hz", (int)axes, (double)rate);
+  }
+
+
+  LIBRARY_API CrpiSim::~CrpiSim ()
+  {
+    sim_.runThread = false;
+    ulapi_task_join((ulapi_task_struct*)simTask_, NULL);
+    ulapi_task_delete((ulapi_task_struct*)simTask_);
+    ulapi_cond_delete(sim_.moved);
+    ulapi_mutex_delete(sim_.handle);
+  }
+
+
+  void CrpiSim::delay ()
+  {
+    double wait;
+
+    ulapi_mutex_take(sim_.handle);
+    //! xorshift64; uniform in [0, 1)
+    seed_ ^= seed_ << 13;
+    seed_ ^= seed_ >> 7;
+    seed_ ^= seed_ << 17;
+    wait = latency_ + jitter_ * ((double)(seed_ >> 11) / 9007199254740992.0);
+    ulapi_mutex_give(sim_.handle);
+
+    if (wait > 0.0)
+    {
+      ulapi_sleep(wait);
+    }
+  }
+
+
+  CanonReturn CrpiSim::waitMotion (bool joints)
+  {
+    CanonReturn val;
+    unsigned long stops;
+
+    ulapi_mutex_take(sim_.handle);
+    stops = sim_.stops;
+    while ((joints ? sim_.axesMoving : sim_.poseMoving) && sim_.stops == stops)
+    {
+      ulapi_cond_wait(sim_.moved, sim_.handle);
+    }
+    val = (sim_.stops == stops) ? CANON_SUCCESS : CANON_FAILURE;
+    ulapi_mutex_give(sim_.handle);
+    return val;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::ApplyCartesianForceTorque (robotPose &robotForceTorque, const vector<bool> &activeAxes, const vector<bool> &manipulator)
+  {
+    //! Not supported
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::ApplyJointTorque (robotAxes &robotJointTorque)
+  {
+    //! Not supported
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::Couple (const char *targetID)
+  {
+    delay();
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::Message (const char *message)
+  {
+    delay();
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::MoveStraightTo (robotPose &pose, bool useBlocking)
+  {
+    //! Without a kinematic model every Cartesian motion is a straight line
+    return MoveTo(pose, useBlocking);
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::MoveThroughTo (robotPose *poses,
+                                                  int numPoses,
+                                                  robotPose *accelerations,
+                                                  robotPose *speeds,
+                                                  robotPose *tolerances)
+  {
+    CanonReturn val = CANON_SUCCESS;
+
+    //! Waypoints are passed through exactly; the optional parameters are not simulated
+    for (int i = 0; i < numPoses && val == CANON_SUCCESS; ++i)
+    {
+      val = MoveTo(poses[i], true);
+    }
+    return val;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::MoveTo (robotPose &pose, bool useBlocking)
+  {
+    delay();
+
+    ulapi_mutex_take(sim_.handle);
+    if (sim_.streaming)
+    {
+      ulapi_mutex_give(sim_.handle);
+      return CANON_REJECT;
+    }
+    sim_.poseTarget = pose;
+    sim_.poseMoving = true;
+    simStep(&sim_, 0.0);
+    simPublish(&sim_);
+    ulapi_mutex_give(sim_.handle);
+
+    return useBlocking ? waitMotion(false) : CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::GetRobotAxes (robotAxes *axes)
+  {
+    RobotStateSnapshot state;
+
+    if (sim_.state.read(state) == 0)
+    {
+      return CANON_FAILURE;
+    }
+    state.getAxes(*axes);
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::GetRobotForces (robotPose *forces)
+  {
+    RobotStateSnapshot state;
+
+    if (sim_.state.read(state) == 0)
+    {
+      return CANON_FAILURE;
+    }
+    *forces = state.forces;
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::GetRobotIO (robotIO *io)
+  {
+    RobotStateSnapshot state;
+
+    if (sim_.state.read(state) == 0)
+    {
+      return CANON_FAILURE;
+    }
+    state.getIO(*io);
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::GetRobotPose (robotPose *pose)
+  {
+    RobotStateSnapshot state;
+
+    if (sim_.state.read(state) == 0)
+    {
+      return CANON_FAILURE;
+    }
+    *pose = state.pose;
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::GetRobotSpeed (robotPose *speed)
+  {
+    RobotStateSnapshot state;
+
+    if (sim_.state.read(state) == 0)
+    {
+      return CANON_FAILURE;
+    }
+    *speed = state.speeds;
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::GetRobotSpeed (robotAxes *speed)
+  {
+    ulapi_mutex_take(sim_.handle);
+    *speed = sim_.axesSpeed;
+    ulapi_mutex_give(sim_.handle);
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::GetRobotTorques (robotAxes *torques)
+  {
+    RobotStateSnapshot state;
+
+    if (sim_.state.read(state) == 0)
+    {
+      return CANON_FAILURE;
+    }
+    torques->axes = state.axes;
+    for (int i = 0; i < state.axes; ++i)
+    {
+      torques->axis[i] = state.torque[i];
+    }
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::GetRobotState (RobotStateSnapshot *state)
+  {
+    return (sim_.state.read(*state) == 0) ? CANON_REJECT : CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::GetPredictedState (RobotStateSnapshot *state, double lead)
+  {
+    //! Not supported:  the simulated state is never late
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::MoveAttractor (robotPose &pose)
+  {
+    //! Not supported
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::MoveToAxisTarget (robotAxes &axes, bool useBlocking)
+  {
+    delay();
+
+    ulapi_mutex_take(sim_.handle);
+    if (sim_.streaming)
+    {
+      ulapi_mutex_give(sim_.handle);
+      return CANON_REJECT;
+    }
+    for (int i = 0; i < sim_.axesTarget.axes && i < axes.axes; ++i)
+    {
+      sim_.axesTarget.axis[i] = axes.axis[i];
+    }
+    sim_.axesMoving = true;
+    simStep(&sim_, 0.0);
+    simPublish(&sim_);
+    ulapi_mutex_give(sim_.handle);
+
+    return useBlocking ? waitMotion(true) : CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::BeginStream ()
+  {
+    delay();
+
+    ulapi_mutex_take(sim_.handle);
+    if (sim_.streaming)
+    {
+      ulapi_mutex_give(sim_.handle);
+      return CANON_REJECT;
+    }
+    sim_.streaming = true;
+    sim_.lastSetpoint = ulapi_time();
+    ulapi_mutex_give(sim_.handle);
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::StreamPose (robotPose &pose)
+  {
+    //! Setpoints are one-way, so they see no round trip
+    ulapi_mutex_take(sim_.handle);
+    if (!sim_.streaming)
+    {
+      ulapi_mutex_give(sim_.handle);
+      return CANON_REJECT;
+    }
+    sim_.poseTarget = pose;
+    sim_.poseMoving = true;
+    sim_.lastSetpoint = ulapi_time();
+    ulapi_mutex_give(sim_.handle);
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::StreamAxes (robotAxes &axes)
+  {
+    ulapi_mutex_take(sim_.handle);
+    if (!sim_.streaming)
+    {
+      ulapi_mutex_give(sim_.handle);
+      return CANON_REJECT;
+    }
+    for (int i = 0; i < sim_.axesTarget.axes && i < axes.axes; ++i)
+    {
+      sim_.axesTarget.axis[i] = axes.axis[i];
+    }
+    sim_.axesMoving = true;
+    sim_.lastSetpoint = ulapi_time();
+    ulapi_mutex_give(sim_.handle);
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::EndStream ()
+  {
+    delay();
+
+    ulapi_mutex_take(sim_.handle);
+    if (!sim_.streaming)
+    {
+      ulapi_mutex_give(sim_.handle);
+      return CANON_REJECT;
+    }
+    sim_.streaming = false;
+    sim_.poseTarget = sim_.pose;
+    sim_.axesTarget = sim_.axes;
+    sim_.poseMoving = sim_.axesMoving = false;
+    ulapi_cond_broadcast(sim_.moved);
+    ulapi_mutex_give(sim_.handle);
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::BeginWrenchStream ()
+  {
+    //! Not supported
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::StreamWrench (robotPose &wrench, const vector<bool> &activeAxes, robotPose &limits)
+  {
+    //! Not supported
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::EndWrenchStream ()
+  {
+    //! Not supported
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::SetAbsoluteAcceleration (double acceleration)
+  {
+    //! Accelerations are not simulated; accepted so that applications run unchanged
+    delay();
+    return (acceleration < 0.0) ? CANON_REJECT : CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::SetAbsoluteSpeed (double speed)
+  {
+    if (speed < 0.0)
+    {
+      return CANON_REJECT;
+    }
+    delay();
+    ulapi_mutex_take(sim_.handle);
+    sim_.linearSpeed = speed;
+    ulapi_mutex_give(sim_.handle);
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::SetAngleUnits (const char *unitName)
+  {
+    //! Values are simulated in whatever units they are given in
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::SetAxialSpeeds (double *speeds)
+  {
+    //! Not yet implemented
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::SetAxialUnits (const char **unitNames)
+  {
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::SetEndPoseTolerance (robotPose &tolerance)
+  {
+    //! Targets are always reached exactly
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::SetIntermediatePoseTolerance (robotPose *tolerances)
+  {
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::SetLengthUnits (const char *unitName)
+  {
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::SetParameter (const char *paramName, void *paramVal)
+  {
+    double val;
+
+    if (paramVal == NULL)
+    {
+      return CANON_REJECT;
+    }
+    val = *((double*)paramVal);
+    if (val < 0.0)
+    {
+      return CANON_REJECT;
+    }
+
+    ulapi_mutex_take(sim_.handle);
+    if (strcmp(paramName, "sim_latency") == 0)
+    {
+      latency_ = val;
+    }
+    else if (strcmp(paramName, "sim_jitter") == 0)
+    {
+      jitter_ = val;
+    }
+    else if (strcmp(paramName, "sim_rate") == 0 && val > 0.0)
+    {
+      sim_.period = 1.0 / val;
+    }
+    else if (strcmp(paramName, "sim_linear_speed") == 0)
+    {
+      sim_.linearSpeed = val;
+    }
+    else if (strcmp(paramName, "sim_angular_speed") == 0)
+    {
+      sim_.angularSpeed = val;
+    }
+    else if (strcmp(paramName, "sim_joint_speed") == 0)
+    {
+      sim_.jointSpeed = val;
+    }
+    else if (strcmp(paramName, "stream_deadline") == 0)
+    {
+      sim_.streamDeadline = val;
+    }
+    else
+    {
+      ulapi_mutex_give(sim_.handle);
+      return CANON_REJECT;
+    }
+    ulapi_mutex_give(sim_.handle);
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::SetRelativeAcceleration (double percent)
+  {
+    //! Accelerations are not simulated
+    delay();
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::SetTool (double percent)
+  {
+    delay();
+    ulapi_mutex_take(sim_.handle);
+    sim_.tool = percent;
+    ulapi_mutex_give(sim_.handle);
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::SetRelativeSpeed (double percent)
+  {
+    delay();
+    ulapi_mutex_take(sim_.handle);
+    sim_.speedScale = (percent < 0.005) ? 0.005 : ((percent > 1.0) ? 1.0 : percent);
+    ulapi_mutex_give(sim_.handle);
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::SetRobotIO (robotIO &io)
+  {
+    delay();
+    ulapi_mutex_take(sim_.handle);
+    sim_.io = io;
+    simPublish(&sim_);
+    ulapi_mutex_give(sim_.handle);
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::SetRobotDO (int dig_out, bool val)
+  {
+    if (dig_out < 0 || dig_out >= CRPI_IO_MAX)
+    {
+      return CANON_REJECT;
+    }
+    delay();
+    ulapi_mutex_take(sim_.handle);
+    sim_.io.dio[dig_out] = val;
+    simPublish(&sim_);
+    ulapi_mutex_give(sim_.handle);
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::StopMotion (int condition)
+  {
+    ulapi_mutex_take(sim_.handle);
+    sim_.poseTarget = sim_.pose;
+    sim_.axesTarget = sim_.axes;
+    sim_.poseMoving = sim_.axesMoving = false;
+    ++sim_.stops;
+    simPublish(&sim_);
+    ulapi_cond_broadcast(sim_.moved);
+    ulapi_mutex_give(sim_.handle);
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::MoveBase (robotPose &to)
+  {
+    //! Not applicable
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::PointHead (robotPose &to)
+  {
+    //! Not applicable
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiSim::PointAppendage (CanonRobotAppendage app_ID,
+                                                   robotPose &to)
+  {
+    //! Not applicable
+    return CANON_REJECT;
+  }
+} // crpi_robot
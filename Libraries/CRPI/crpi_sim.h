@@ -0,0 +1,596 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_sim.h
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Simulated robot interface declarations, for load testing CRPI applications
+//  without hardware.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef SIM_H
+#define SIM_H
+
+#include "crpi.h"
+
+#pragma warning (disable: 4251)
+
+#include <vector>
+
+using namespace std;
+
+//! @brief Default feedback rate (Hz) and number of axes when no controller profile is named
+//!
+#define SIM_RATE 500.0
+#define SIM_AXES 6
+
+//! @brief Default motion speeds:  TCP (mm/s), TCP rotation (deg/s), and joints (deg/s)
+//!
+#define SIM_LINEAR_SPEED 250.0
+#define SIM_ANGULAR_SPEED 90.0
+#define SIM_JOINT_SPEED 60.0
+
+namespace crpi_robot
+{
+  //! @brief Simulated controller state shared between CrpiSim and its control thread
+  //!
+  struct LIBRARY_API simHandle
+  {
+    bool runThread;
+
+    //! @brief Guards every field below except state; moved is broadcast after every control
+    //!        cycle and whenever a motion ends
+    //!
+    ulapi_mutex_struct *handle;
+    void *moved;
+
+    //! @brief Control (and feedback) cycle (s)
+    //!
+    double period;
+
+    //! @brief Motion speeds (see SIM_LINEAR_SPEED); a speed of 0 reaches the target at once
+    //!
+    double linearSpeed, angularSpeed, jointSpeed;
+
+    //! @brief Commanded speed scale (SetRelativeSpeed)
+    //!
+    double speedScale;
+
+    //! @brief Current and target Cartesian pose, and whether the pose is moving to its target
+    //!
+    robotPose pose, poseTarget;
+    bool poseMoving;
+
+    //! @brief Current and target joints, and whether the joints are moving to their target
+    //!
+    robotAxes axes, axesTarget;
+    bool axesMoving;
+
+    //! @brief Number of StopMotion calls, so that blocked moves can tell they were interrupted
+    //!
+    unsigned long stops;
+
+    //! @brief Speeds over the last control cycle
+    //!
+    robotPose poseSpeed;
+    robotAxes axesSpeed;
+
+    //! @brief I/O values (outputs read back as set) and tool command
+    //!
+    robotIO io;
+    double tool;
+
+    //! @brief Whether a setpoint stream is active, the time of its last setpoint, and the time
+    //!        (s) after which the simulated controller stops if no setpoint arrives
+    //!
+    bool streaming;
+    double lastSetpoint;
+    double streamDeadline;
+
+    //! @brief State published at the end of every control cycle
+    //!
+    RobotStateSnapshot latest;
+    crpi_seqlock<RobotStateSnapshot> state;
+  };
+
+
+  //! @ingroup Robot
+  //!
+  //! @brief Simulated robot, for exercising CRPI applications (XMLInterface, the streaming API,
+  //!        CrpiCell) without hardware
+  //!
+  //! @note The simulated controller moves the TCP pose and the joints toward their targets at
+  //!       fixed speeds, publishing a RobotStateSnapshot at the feedback rate.  There is no
+  //!       kinematic model:  Cartesian and joint motions are simulated independently.
+  //! @note <Feedback Protocol="UR"/>, "ABB", or "KUKA" in the robot XML selects the timing of
+  //!       the CRPI driver being imitated (feedback rate, command round trip, axis count);
+  //!       <Feedback Rate="..."/> overrides the rate.  Every command is delayed by the round
+  //!       trip latency plus a uniform random jitter before it takes effect.  The Get* methods
+  //!       answer from the last published state, as the streaming drivers do.
+  //! @note SetParameter accepts "sim_latency" (s), "sim_jitter" (s), "sim_rate" (Hz),
+  //!       "sim_linear_speed", "sim_angular_speed", "sim_joint_speed", and "stream_deadline"
+  //!       (s), all as double.
+  //!
+  class LIBRARY_API CrpiSim
+  {
+  public:
+    //! @brief Default constructor
+    //!
+    //! @param params Configuration parameters for the CRPI instance of this robot
+    //!
+    CrpiSim (CrpiRobotParams &params);
+
+    //! @brief Default destructor
+    //!
+    ~CrpiSim ();
+
+    //! @brief Apply a Cartesian Force/Torque at the TCP, expressed in robot base coordinate system
+    //!
+    //! @param robotForceTorque are the Cartesian command forces and torques applied at the end-effector
+    //!        activeAxes is used to toggle which axes will be slated for active force control. TRUE = ACTIVE, FALSE = INACTIVE
+    //!       manipulator is used to toggle which manipulators will be slated for active force control. TRUE = ACTIVE, FALSE = INACTIVE (useful for hands)
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn ApplyCartesianForceTorque (robotPose &robotForceTorque, const vector<bool> &activeAxes, const vector<bool> &manipulator);
+
+    //! @brief Apply joint torques
+    //!
+    //! @param robotJointTorque are the command torques for the respective joint axes
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn ApplyJointTorque (robotAxes &robotJointTorque);
+
+    //! @brief Dock with a specified target object
+    //!
+    //! @param targetID The name of the object with which the robot should dock
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn Couple (const char *targetID);
+
+    //! @brief Display a message on the operator console
+    //!
+    //! @param message The plain-text message to be displayed on the operator console
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn Message (const char *message);
+
+    //! @brief Move the robot in a straight line from the current pose to a new pose and stop there
+    //!
+    //! @param pose        The target 6DOF pose for the robot
+    //! @param useBlocking Whether or not to use additional code to ensure blocking on motion commands
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn MoveStraightTo (robotPose &pose, bool useBlocking);
+
+    //! @brief Move the controlled point along a trajectory passing through or near all but the last
+    //!        of a series of poses, and then stop at the last pose
+    //!
+    //! @param poses         An array of 6DOF poses through/near which the robot is expected to pass
+    //! @param numPoses      The number of sub-poses in the submitted array
+    //! @param accelerations (optional) An array of 6DOF accelaration profiles for each motion
+    //!                      associated with the target poses
+    //! @param speeds        (optional) An array of 6DOF speed profiles for each motion assiciated
+    //!                      with the target poses
+    //! @param tolerances    (optional) An array of 6DOF tolerances in length and angle units for the
+    //!                      specified target poses
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    //! @note The length of the optional parameter arrays, if provided, must be equal to numPoses.
+    //! @note Defining accerlations, speeds, and tolerances does not overwrite the defined default
+    //!       values
+    //!
+    CanonReturn MoveThroughTo (robotPose *poses,
+                               int numPoses,
+                               robotPose *accelerations = NULL,
+                               robotPose *speeds = NULL,
+                               robotPose *tolerances = NULL);
+
+    //! @brief Move the controlled pose along any convenient trajectory from the current pose to the
+    //!        target pose, and then stop.
+    //!
+    //! @param pose        The target 6DOF Cartesian pose for the robot's TCP in Cartesian space coordinates
+    //! @param useBlocking Whether or not to use additional code to ensure blocking on motion commands
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn MoveTo (robotPose &pose, bool useBlocking);
+
+    //! @brief Get feedback from the robot regarding its current axis configuration
+    //!
+    //! @param axes Axis array to be populated by the method
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn GetRobotAxes (robotAxes *axes);
+
+    //! @brief Get the measured Cartesian forces from the robot
+    //!
+    //! @param forces Cartesian force data structure to be populated by the method
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn GetRobotForces (robotPose *forces);
+
+    //! @brief Get I/O feedback from the robot
+    //!
+    //! @Param io Digital and analog I/O data structure to be populated by the method
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn GetRobotIO (robotIO *io);
+
+    //! @brief Get feedback from the robot regarding its current position in Cartesian space
+    //!
+    //! @param pose Cartesian pose data structure to be populated by the method
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn GetRobotPose (robotPose *pose);
+
+    //! @brief Get instantaneous Cartesian velocity
+    //!
+    //! @param speed Cartesian velocities to be populated by the method
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn GetRobotSpeed (robotPose *speed);
+
+    //! @brief Get instantaneous joint speeds
+    //!
+    //! @param speed Joint velocities array to be populated by the method
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn GetRobotSpeed (robotAxes *speed);
+
+    //! @brief Get joint torques from the robot regarding
+    //!
+    //! @param torques Axis array to be populated by the method
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn GetRobotTorques (robotAxes *torques);
+
+    //! @brief Get a consistent snapshot of the robot's latest state without waiting on the
+    //!        robot's feedback connection
+    //!
+    //! @param state Snapshot to be populated by the method
+    //!
+    //! @return SUCCESS if a state has been published by the driver, REJECT if no state is
+    //!         available yet or the robot does not publish state snapshots
+    //!
+    CanonReturn GetRobotState (RobotStateSnapshot *state);
+
+    //! @brief Get the robot's latest state extrapolated to compensate for its age, from the speeds
+    //!        in the state
+    //!
+    //! @param state Snapshot to be populated by the method, as by GetRobotState; its timestamp is
+    //!              the time predicted for
+    //! @param lead  Seconds past the current time (ulapi_time) to predict for; 0 for now
+    //!
+    //! @return SUCCESS if a state has been published by the driver, REJECT if no state is
+    //!         available yet or the robot does not publish the speeds to extrapolate from
+    //!
+    CanonReturn GetPredictedState (RobotStateSnapshot *state, double lead = 0.0);
+
+    //! @brief Move a virtual attractor to a specified coordinate in Cartesian space for force control
+    //!
+    //! @param pose The 6DOF destination of the virtual attractor 
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn MoveAttractor (robotPose &pose);
+
+    //! @brief Move the robot axes to the specified target values
+    //!
+    //! @param axes        An array of target axis values specified in the current axial unit
+    //! @param useBlocking Whether or not to use additional code to ensure blocking on motion commands
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn MoveToAxisTarget (robotAxes &axes, bool useBlocking);
+
+    //! @brief Start streaming motion setpoints to the robot at the controller's native rate
+    //!
+    //! @return SUCCESS if the robot is ready to accept setpoints, REJECT if streaming is not
+    //!         supported, and FAILURE if the stream could not be started
+    //!
+    CanonReturn BeginStream ();
+
+    //! @brief Send the next Cartesian setpoint of an active stream without waiting for the motion
+    //!
+    //! @param pose The 6DOF setpoint for the robot's TCP in Cartesian space coordinates
+    //!
+    //! @return SUCCESS if the setpoint was sent, REJECT if no stream is active, and FAILURE if the
+    //!         setpoint could not be sent
+    //!
+    CanonReturn StreamPose (robotPose &pose);
+
+    //! @brief Send the next joint setpoint of an active stream without waiting for the motion
+    //!
+    //! @param axes Target axis values specified in the current axial unit
+    //!
+    //! @return SUCCESS if the setpoint was sent, REJECT if no stream is active, and FAILURE if the
+    //!         setpoint could not be sent
+    //!
+    CanonReturn StreamAxes (robotAxes &axes);
+
+    //! @brief Stop an active stream and bring the robot to rest
+    //!
+    //! @return SUCCESS if the stream was stopped, REJECT if no stream is active, and FAILURE if the
+    //!         robot could not be stopped
+    //!
+    CanonReturn EndStream ();
+
+    //! @brief Start streaming Cartesian force/torque targets to a force controller that stays
+    //!        running on the robot, so each update needs no new program
+    //!
+    //! @return SUCCESS if the robot is ready to accept wrench targets, REJECT if force streaming
+    //!         is not supported or a stream is already active, and FAILURE if the stream could
+    //!         not be started
+    //!
+    //! @note The robot holds its position (no axes selected) until the first StreamWrench.  The
+    //!       "stream_period" and "stream_deadline" settings of BeginStream also apply.
+    //!
+    CanonReturn BeginWrenchStream ();
+
+    //! @brief Send the next force/torque target of an active wrench stream without waiting for
+    //!        the robot to respond
+    //!
+    //! @param wrench     Target forces (N) along and torques (N m) about the tool axes
+    //! @param activeAxes Which tool axes (x, y, z, xrot, yrot, zrot) are force controlled; the
+    //!                   others hold position.  TRUE = ACTIVE, FALSE = INACTIVE
+    //! @param limits     For active axes, the largest TCP speed along or about the axis (length or
+    //!                   angle units per second); for the others, the largest deviation from the
+    //!                   held position (length or angle units)
+    //!
+    //! @return SUCCESS if the target was sent, REJECT if no wrench stream is active, and FAILURE
+    //!         if the target could not be sent
+    //!
+    CanonReturn StreamWrench (robotPose &wrench, const vector<bool> &activeAxes, robotPose &limits);
+
+    //! @brief Stop an active wrench stream, leave force control, and bring the robot to rest
+    //!
+    //! @return SUCCESS if the stream was stopped, REJECT if no wrench stream is active, and
+    //!         FAILURE if the robot could not be stopped
+    //!
+    CanonReturn EndWrenchStream ();
+
+    //! @brief Set the accerlation for the controlled pose to the given value in length units per
+    //!        second per second
+    //!
+    //! @param acceleration The target TCP acceleration 
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn SetAbsoluteAcceleration (double acceleration);
+
+    //! @brief Set the speed for the controlled pose to the given value in length units per second
+    //!
+    //! @param speed The target Cartesian speed
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn SetAbsoluteSpeed (double speed);
+
+    //! @brief Set angel units to the unit specified
+    //!
+    //! @param unitName The name of the angle units in plain text ("degree" or "radian")
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn SetAngleUnits (const char *unitName);
+
+    //! @brief Set the axis-specific speeds for the motion of axis-space motions
+    //!
+    //! @param speeds Array of target axial motion speeds
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn SetAxialSpeeds (double *speeds);
+
+    //! @brief Set specific axial units to the specified values
+    //!
+    //! @param unitNames Array of axis-specific names of the axis units in plain text
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn SetAxialUnits (const char **unitNames);
+
+    //! @brief Set the default 6DOF tolerances for the pose of the robot in current length and angle
+    //!        units
+    //!
+    //! @param tolerances Tolerances of the 6DOF end pose during Cartesian motion commands
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn SetEndPoseTolerance (robotPose &tolerance);
+
+    //! @brief Set the default 6DOF tolerance for smooth motion near intermediate points
+    //!
+    //! @param tolerances Tolerances of the 6DOF poses during multi-pose motions
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn SetIntermediatePoseTolerance (robotPose *tolerances);
+
+    //! @brief Set length units to the unit specified
+    //!
+    //! @param unitName The name of the length units in plain text ("inch," "mm," and "meter")
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn SetLengthUnits (const char *unitName);
+    
+    //! @brief Set a robot-specific parameter (handling of parameter type casting to be handled by the
+    //!        robot interface)
+    //!
+    //! @param paramName The name of the parameter variable to set
+    //! @param paramVal  The value to be set to the specified robot parameter
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn SetParameter (const char *paramName, void *paramVal);
+
+    //! @brief Set the accerlation for the controlled pose to the given percentage of the robot's
+    //!        maximum acceleration
+    //!
+    //! @param percent The percentage of the robot's maximum acceration in the range of [0, 1]
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn SetRelativeAcceleration (double percent);
+
+    //! @brief Set the attached tool to a defined output rate
+    //!
+    //! @param percent The desired output rate for the robot's tool as a percentage of maximum output
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn SetTool (double percent);
+
+    //! @brief Set the speed for the controlled point to the given percentage of the robot's maximum
+    //!        speed
+    //!
+    //! @param percent The percentage of the robot's maximum speed in the range of [0, 1]
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn SetRelativeSpeed (double percent);
+
+    //! @brief Set the digital and analog outputs
+    //!
+    //! @Param io Digital and analog I/O outputs to set.  Currently only supports digital outputs.
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn SetRobotIO (robotIO &io);
+
+    //! @brief Set a specific digital output
+    //!
+    //! @param dig_out Digital output channel to set
+    //! @param val     Value to set the digital output
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn SetRobotDO (int dig_out, bool val);
+
+    //! @brief Stop the robot's motions based on robot stopping rules
+    //!
+    //! @param condition The rule by which the robot is expected to stop (Estop category 0, 1, or 2);
+    //!                  Estop category 2 is default
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    CanonReturn StopMotion (int condition = 2);
+
+    //! @brief Move the base to a specified position and orientation on a horizontal plane
+    //!
+    //! @param to Target position in the robot's world frame toward which the robot will attempt to move
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    //! @note This function only uses the x, y, and zrot components of the pose object
+    //!
+    CanonReturn MoveBase(robotPose &to);
+
+    //! @brief Point the head at an location relative to the robots base coordinate frame
+    //!
+    //! @param to Target pose toward which the head is attempting to point
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    //! @note This function only uses the x, y, and z components of the pose object
+    //!
+    CanonReturn PointHead(robotPose &to);
+
+    //! @brief Point the appendage at a location relative to the robots base coordinate frame
+    //!
+    //! @param app_ID Identifier of which appendage is being pointed
+    //! @param to     Target pose toward which the appendage is attempting to point
+    //!
+    //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
+    //!         not accepted, and FAILURE if the command is accepted but not executed successfully
+    //!
+    //! @note This function only uses the x, y, and z components of the pose object
+    //! @note It is not always possible for the indicated appendage to point exactly along the vector
+    //!       specified.  The robot should attempt to get as close as possible.
+    //!
+    CanonReturn PointAppendage(CanonRobotAppendage app_ID, robotPose &to);
+
+  private:
+
+    //! @brief Simulated controller and its control thread
+    //!
+    simHandle sim_;
+    void *simTask_;
+
+    //! @brief Command round trip (s) and the range of the random delay added to it (s)
+    //!
+    double latency_;
+    double jitter_;
+
+    //! @brief State of the jitter generator (guarded by sim_.handle)
+    //!
+    unsigned long long seed_;
+
+    //! @brief Wait for a command's round trip to the simulated controller
+    //!
+    void delay ();
+
+    //! @brief Wait until the pose (or joints) are no longer moving
+    //!
+    //! @param joints Whether to wait for the joints rather than the pose
+    //!
+    //! @return SUCCESS once the target is reached, FAILURE if motion was stopped first
+    //!
+    CanonReturn waitMotion (bool joints);
+  }; // CrpiSim
+
+} // namespace crpi_robot
+
+#endif
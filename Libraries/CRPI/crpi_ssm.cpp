@@ -0,0 +1,254 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_ssm.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Speed and separation monitoring definitions.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_ssm.h"
+#include "crpi_hub.h"
+#include <cfloat>
+#include <stdio.h>
+
+using namespace std;
+
+namespace crpi_robot
+{
+  struct ssmRobot
+  {
+    AnyCrpiRobot robot;
+    int arm;
+
+    //! @brief Relative speed with no one near; latest separation (mm) and allowed fraction of the
+    //!        nominal speed, read from any thread
+    //!
+    atomic<double> nominal;
+    atomic<double> separation;
+    atomic<double> speed;
+
+    //! @brief Fraction and nominal speed last set (-1 if none), and whether the robot has been
+    //!        stopped (checking thread only)
+    //!
+    double applied;
+    double appliedNominal;
+    bool stopped;
+
+    CrpiGauge *separationMetric;
+    CrpiGauge *speedMetric;
+    CrpiCounter *stopMetric;
+  };
+
+
+  LIBRARY_API CrpiSeparationMonitor::CrpiSeparationMonitor (const CrpiCollision &model, const CrpiSsmParams &params) :
+    model_(model),
+    params_(params),
+    pointsTime_(0.0),
+    pointsLock_(ulapi_fastlock_new()),
+    loop_(NULL),
+    run_(false)
+  {
+  }
+
+
+  LIBRARY_API CrpiSeparationMonitor::~CrpiSeparationMonitor ()
+  {
+    Stop();
+    for (size_t i = 0; i < robots_.size(); ++i)
+    {
+      delete robots_[i];
+    }
+    ulapi_fastlock_delete(pointsLock_);
+  }
+
+
+  LIBRARY_API int CrpiSeparationMonitor::AddRobot (AnyCrpiRobot robot, int arm, double nominal)
+  {
+    char label[16];
+
+    if (loop_ != NULL || !robot.valid() || model_.Kinematics(arm) == NULL)
+    {
+      return -1;
+    }
+    ssmRobot *sr = new ssmRobot;
+    sr->robot = robot;
+    sr->arm = arm;
+    sr->nominal = (nominal > 0.0 && nominal <= 1.0) ? nominal : 1.0;
+    sr->separation = 0.0;
+    sr->speed = 0.0;
+    sr->applied = sr->appliedNominal = -1.0;
+    sr->stopped = false;
+
+    sprintf(label, "%d", arm);
+    string labels = CrpiMetrics::Label("arm", label);
+    sr->separationMetric = CrpiMetrics::Gauge("crpi_ssm_separation_mm",
+                                              "Least distance from a person to the volume the arm will sweep",
+                                              labels);
+    sr->speedMetric = CrpiMetrics::Gauge("crpi_ssm_speed_fraction",
+                                         "Fraction of the arm's nominal speed allowed by its separation",
+                                         labels);
+    sr->stopMetric = CrpiMetrics::Counter("crpi_ssm_stops", "Arms stopped for lack of separation", labels);
+    robots_.push_back(sr);
+    return (int)robots_.size() - 1;
+  }
+
+
+  LIBRARY_API void CrpiSeparationMonitor::SetNominal (int robot, double nominal)
+  {
+    if (robot >= 0 && robot < (int)robots_.size() && nominal > 0.0 && nominal <= 1.0)
+    {
+      robots_[robot]->nominal = nominal;
+    }
+  }
+
+
+  LIBRARY_API void CrpiSeparationMonitor::Update (const double *points, int numPoints, double timestamp)
+  {
+    ulapi_fastlock_take(pointsLock_);
+    if (points == NULL || numPoints < 1)
+    {
+      points_.clear();
+    }
+    else
+    {
+      points_.assign(points, points + ((size_t)numPoints * 3));
+    }
+    pointsTime_ = timestamp;
+    ulapi_fastlock_give(pointsLock_);
+  }
+
+
+  LIBRARY_API bool CrpiSeparationMonitor::Start ()
+  {
+    if (loop_ != NULL || robots_.empty())
+    {
+      return false;
+    }
+    run_ = true;
+    loop_ = SensorHub::Instance().StartLoop(loop, this, HUB_MONITOR);
+    return loop_ != NULL;
+  }
+
+
+  LIBRARY_API void CrpiSeparationMonitor::Stop ()
+  {
+    if (loop_ == NULL)
+    {
+      return;
+    }
+    run_ = false;
+    SensorHub::Instance().JoinLoop(loop_);
+    loop_ = NULL;
+    for (size_t i = 0; i < robots_.size(); ++i)
+    {
+      robots_[i]->robot.SetRelativeSpeed(robots_[i]->nominal);
+      robots_[i]->applied = robots_[i]->appliedNominal = -1.0;
+      robots_[i]->stopped = false;
+    }
+  }
+
+
+  LIBRARY_API double CrpiSeparationMonitor::Separation (int robot) const
+  {
+    return (robot < 0 || robot >= (int)robots_.size()) ? 0.0 : robots_[robot]->separation.load();
+  }
+
+
+  LIBRARY_API double CrpiSeparationMonitor::Speed (int robot) const
+  {
+    return (robot < 0 || robot >= (int)robots_.size()) ? 0.0 : robots_[robot]->speed.load();
+  }
+
+
+  void CrpiSeparationMonitor::loop (void *param)
+  {
+    CrpiSeparationMonitor *sm = (CrpiSeparationMonitor*)param;
+    double next = ulapi_time(), measured;
+    bool stale;
+
+    while (sm->run_)
+    {
+      ulapi_fastlock_take(sm->pointsLock_);
+      sm->checked_ = sm->points_;
+      measured = sm->pointsTime_;
+      ulapi_fastlock_give(sm->pointsLock_);
+
+      stale = (measured <= 0.0 || (ulapi_time() - measured) > sm->params_.timeout);
+      for (size_t i = 0; i < sm->robots_.size(); ++i)
+      {
+        sm->check(*sm->robots_[i], sm->checked_, stale);
+      }
+
+      //! Fixed rate; a check that overran starts the next one at once
+      next += sm->params_.period;
+      if (next < ulapi_time())
+      {
+        next = ulapi_time();
+      }
+      ulapi_sleep_until(next);
+    }
+  }
+
+
+  void CrpiSeparationMonitor::check (ssmRobot &robot, const vector<double> &points, bool stale)
+  {
+    RobotStateSnapshot now, ahead;
+    robotAxes path[2];
+    double separation = 0.0, allowed, fraction;
+
+    //! Robots whose configuration is unknown are treated as touching the people
+    if (!stale && robot.robot.GetRobotState(&now) == CANON_SUCCESS && now.axes > 0)
+    {
+      now.getAxes(path[0]);
+      path[1] = path[0];
+      //! Where the robot will be by the time a slower speed takes effect
+      if (robot.robot.GetPredictedState(&ahead, params_.reactionTime) == CANON_SUCCESS && ahead.axes == now.axes)
+      {
+        ahead.getAxes(path[1]);
+      }
+      separation = model_.Separation(robot.arm, path, 2, points.empty() ? NULL : &points[0],
+                                     (int)(points.size() / 3));
+    }
+
+    allowed = (separation - (params_.humanSpeed * (params_.reactionTime + params_.stoppingTime)) -
+               params_.intrusion - params_.uncertainty) / (params_.reactionTime + (params_.stoppingTime / 2.0));
+    fraction = (params_.maxSpeed > 0.0) ? (allowed / params_.maxSpeed) : 1.0;
+    fraction = (fraction < 0.0) ? 0.0 : ((fraction > 1.0) ? 1.0 : fraction);
+
+    robot.separation = (separation == DBL_MAX) ? -1.0 : separation;
+    robot.speed = fraction;
+    robot.separationMetric->Set((separation == DBL_MAX) ? -1.0 : separation);
+    robot.speedMetric->Set(fraction);
+
+    if (fraction < params_.minSpeed)
+    {
+      if (!robot.stopped)
+      {
+        //! Whatever the robot does next starts at the slowest speed
+        robot.robot.StopMotion();
+        robot.applied = params_.minSpeed;
+        robot.appliedNominal = robot.nominal;
+        robot.robot.SetRelativeSpeed(robot.appliedNominal * robot.applied);
+        robot.stopped = true;
+        robot.stopMetric->Inc();
+      }
+      return;
+    }
+    robot.stopped = false;
+
+    //! Slow down at once; speed up only by a clear margin, or all the way back
+    if (robot.applied < 0.0 || fraction < robot.applied || robot.nominal != robot.appliedNominal ||
+        fraction >= robot.applied + params_.resume || (fraction == 1.0 && robot.applied < 1.0))
+    {
+      robot.applied = fraction;
+      robot.appliedNominal = robot.nominal;
+      robot.robot.SetRelativeSpeed(robot.appliedNominal * robot.applied);
+    }
+  }
+} // crpi_robot
@@ -0,0 +1,208 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_ssm.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Speed and separation monitoring (ISO/TS 15066) of robots sharing a cell
+//  with people.
+//
+//  Static speed limits have to assume that a person may be next to the
+//  robot at any time.  The monitor instead takes the positions of the
+//  people in the cell (e.g., Vicon or OptiTrack markers, or LeapMotion
+//  hands), measures their least distance to the volume each robot will
+//  sweep before it could react, and sets each robot's relative speed to the
+//  fastest that still lets it stop before the separation runs out.  Robots
+//  are slowed only while someone is actually near them.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_ssm_H
+#define crpi_ssm_H
+
+#include "crpi_any_robot.h"
+#include "crpi_collision.h"
+#include "crpi_metrics.h"
+#include <atomic>
+#include <vector>
+
+namespace crpi_robot
+{
+  //! @brief Terms of the protective separation distance (ISO/TS 15066, 5.5.4) and how the
+  //!        monitor acts on it
+  //!
+  struct CrpiSsmParams
+  {
+    //! @brief Speed (mm/s) at which a person is assumed to approach the robot
+    //!
+    double humanSpeed;
+
+    //! @brief Time (s) from a person moving to the robot starting to slow (tracking, the monitor's
+    //!        period, and the command's latency), and time (s) the robot takes to stop
+    //!
+    double reactionTime;
+    double stoppingTime;
+
+    //! @brief Intrusion distance (mm) of a body part past the tracked points (e.g., a hand past
+    //!        the wrist marker), and the position uncertainty (mm) of the tracker and the robot
+    //!
+    double intrusion;
+    double uncertainty;
+
+    //! @brief TCP speed (mm/s) of the robot at a relative speed of 1
+    //!
+    double maxSpeed;
+
+    //! @brief Relative speed (fraction of the nominal) below which the robot is stopped
+    //!        (StopMotion) rather than slowed
+    //!
+    double minSpeed;
+
+    //! @brief Increase of the allowed fraction needed before the robot is sped up again, so that
+    //!        tracking noise does not keep changing its speed (slowing down is never delayed)
+    //!
+    double resume;
+
+    //! @brief Seconds without new points after which the people are treated as touching every
+    //!        robot, and seconds between checks
+    //!
+    double timeout;
+    double period;
+
+    //! @brief Default constructor
+    //!
+    CrpiSsmParams ()
+    {
+      humanSpeed = 1600.0;
+      reactionTime = 0.1;
+      stoppingTime = 0.3;
+      intrusion = 0.0;
+      uncertainty = 50.0;
+      maxSpeed = 1000.0;
+      minSpeed = 0.05;
+      resume = 0.1;
+      timeout = 0.1;
+      period = 0.01;
+    }
+  };
+
+  //! @brief A monitored robot (defined in crpi_ssm.cpp)
+  //!
+  struct ssmRobot;
+
+  //! @ingroup Robot
+  //!
+  //! @brief Speed and separation monitor.  The people in the cell are given as points (Update),
+  //!        from whatever tracks them, in the cell frame of the collision model.  Every period,
+  //!        each robot's volume is swept from its current configuration to the one predicted
+  //!        (GetPredictedState) a reaction time ahead, the least distance S from any point to it
+  //!        is found (CrpiCollision::Separation), and the robot's TCP speed is limited to
+  //!
+  //!          v = (S - vh (Tr + Ts) - C - Z) / (Tr + Ts / 2)
+  //!
+  //!        the speed at which the protective separation distance vh (Tr + Ts) + v Tr + v Ts / 2
+  //!        + C + Z just equals S (for a robot that decelerates uniformly).  v / maxSpeed of the
+  //!        robot's nominal relative speed is set with SetRelativeSpeed; below minSpeed, the
+  //!        robot is stopped.  Separations and speeds are exported as metrics, labelled with the
+  //!        robot's arm in the collision model.
+  //!
+  //! @note The monitor owns the robots' relative speed while it runs; set the nominal speed with
+  //!       AddRobot or SetNominal rather than with SetRelativeSpeed.  A stopped motion is not
+  //!       resumed.
+  //! @note Until the first points arrive, and whenever they stop arriving, the robots are
+  //!       stopped:  the people could be anywhere.  Pass an empty set of points for an empty
+  //!       cell.
+  //!
+  class LIBRARY_API CrpiSeparationMonitor
+  {
+  public:
+    //! @brief Constructor
+    //!
+    //! @param model  Collision model of the cell's arms, which must outlive the monitor
+    //! @param params Separation terms
+    //!
+    CrpiSeparationMonitor (const CrpiCollision &model, const CrpiSsmParams &params = CrpiSsmParams());
+
+    //! @brief Default destructor.  Stops the monitor if it is running.
+    //!
+    ~CrpiSeparationMonitor ();
+
+    //! @brief Monitor a robot (before Start)
+    //!
+    //! @param robot   The robot, which must outlive the monitor
+    //! @param arm     The robot's arm in the collision model
+    //! @param nominal Relative speed of the robot when no one is near, in (0, 1]
+    //!
+    //! @return The robot's index, or -1 if the arm is not in the model or the monitor is running
+    //!
+    int AddRobot (AnyCrpiRobot robot, int arm, double nominal = 1.0);
+
+    //! @brief Change a robot's nominal relative speed; applied at the next check
+    //!
+    void SetNominal (int robot, double nominal);
+
+    //! @brief Give the positions of the people in the cell (from any thread, e.g., at each
+    //!        tracker frame)
+    //!
+    //! @param points    Positions (mm, cell frame) as x, y, z triples
+    //! @param numPoints Number of positions (0 for an empty cell)
+    //! @param timestamp When they were measured (ulapi_time, s)
+    //!
+    void Update (const double *points, int numPoints, double timestamp);
+
+    //! @brief Start checking every period, on a thread of the monitor's own (a robot that is
+    //!        busy with a command can hold up its speed change, which must not hold up anything
+    //!        else on the SensorHub)
+    //!
+    //! @return True if the monitor is running, false if it has no robots or was already running
+    //!
+    bool Start ();
+
+    //! @brief Stop checking and put every robot back to its nominal speed
+    //!
+    void Stop ();
+
+    //! @brief Latest separation (mm) of a robot (-1 while no one is in the cell), and the fraction
+    //!        of its nominal speed allowed
+    //!
+    double Separation (int robot) const;
+    double Speed (int robot) const;
+
+  private:
+
+    //! @brief Check every robot each period until stopped
+    //!
+    static void loop (void *param);
+
+    //! @brief Check one robot against the points
+    //!
+    void check (ssmRobot &robot, const std::vector<double> &points, bool stale);
+
+    const CrpiCollision &model_;
+    CrpiSsmParams params_;
+    std::vector<ssmRobot*> robots_;
+
+    //! @brief Latest points and when they were measured, guarded by a fast lock
+    //!        (ulapi_fastlock_new)
+    //!
+    std::vector<double> points_;
+    double pointsTime_;
+    void *pointsLock_;
+
+    //! @brief Points copied out by the checking task, so that Update never waits for a check
+    //!
+    std::vector<double> checked_;
+
+    void *loop_;
+    std::atomic<bool> run_;
+
+    CrpiSeparationMonitor (const CrpiSeparationMonitor &) = delete;
+    CrpiSeparationMonitor &operator= (const CrpiSeparationMonitor &) = delete;
+  }; // CrpiSeparationMonitor
+} // crpi_robot
+
+#endif
@@ -0,0 +1,146 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_state_shm.cpp
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Shared-memory publication of robot state to other processes on the same
+//  computer.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_state_shm.h"
+
+#include <string.h>
+
+namespace crpi_robot
+{
+  LIBRARY_API CrpiStatePublisher::CrpiStatePublisher (ulapi_id key, const char *robot)
+  {
+    shmHandle_ = ulapi_shm_new(key, sizeof(crpiStateShared));
+    shm_ = (shmHandle_ != NULL) ? (crpiStateShared*)ulapi_shm_addr(shmHandle_) : NULL;
+    if (shm_ == NULL)
+    {
+      return;
+    }
+
+    //! Readers ignore the segment until magic is stored, after everything else
+    shm_->magic.store(0, std::memory_order_release);
+    memset((void*)&shm_->state, 0, sizeof(shm_->state));
+    memset(shm_->robot, 0, sizeof(shm_->robot));
+    if (robot != NULL)
+    {
+      strncpy(shm_->robot, robot, CRPI_STATE_NAME_MAX - 1);
+    }
+    shm_->version = CRPI_STATE_SHM_VERSION;
+    shm_->snapshotSize = sizeof(RobotStateSnapshot);
+    shm_->magic.store(CRPI_STATE_SHM_MAGIC, std::memory_order_release);
+  }
+
+
+  LIBRARY_API CrpiStatePublisher::~CrpiStatePublisher ()
+  {
+    if (shm_ != NULL)
+    {
+      shm_->magic.store(0, std::memory_order_release);
+    }
+    if (shmHandle_ != NULL)
+    {
+      ulapi_shm_delete(shmHandle_);
+    }
+  }
+
+
+  LIBRARY_API bool CrpiStatePublisher::Ready () const
+  {
+    return shm_ != NULL;
+  }
+
+
+  LIBRARY_API void CrpiStatePublisher::Publish (const RobotStateSnapshot &state)
+  {
+    if (shm_ != NULL)
+    {
+      shm_->state.write(state);
+    }
+  }
+
+
+  LIBRARY_API CrpiStateReader::CrpiStateReader (ulapi_id key)
+  {
+    //! Mapping the key before the driver has created it creates an empty segment, which the
+    //! driver then initializes in place
+    shmHandle_ = ulapi_shm_new(key, sizeof(crpiStateShared));
+    shm_ = (shmHandle_ != NULL) ? (crpiStateShared*)ulapi_shm_addr(shmHandle_) : NULL;
+  }
+
+
+  LIBRARY_API CrpiStateReader::~CrpiStateReader ()
+  {
+    if (shmHandle_ != NULL)
+    {
+      ulapi_shm_delete(shmHandle_);
+    }
+  }
+
+
+  LIBRARY_API bool CrpiStateReader::Published () const
+  {
+    return (shm_ != NULL &&
+            shm_->magic.load(std::memory_order_acquire) == CRPI_STATE_SHM_MAGIC &&
+            shm_->version == CRPI_STATE_SHM_VERSION &&
+            shm_->snapshotSize == sizeof(RobotStateSnapshot));
+  }
+
+
+  LIBRARY_API const char *CrpiStateReader::Robot () const
+  {
+    return Published() ? shm_->robot : "";
+  }
+
+
+  LIBRARY_API unsigned long CrpiStateReader::Count () const
+  {
+    return Published() ? shm_->state.count() : 0;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiStateReader::GetRobotState (RobotStateSnapshot *state) const
+  {
+    unsigned long count;
+
+    if (!Published() || !shm_->state.tryRead(*state, count, CRPI_STATE_READ_TRIES) || count == 0)
+    {
+      return CANON_REJECT;
+    }
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiStateReader::WaitForState (RobotStateSnapshot *state,
+                                                         unsigned long after,
+                                                         double timeout) const
+  {
+    double until = ulapi_time() + timeout;
+    unsigned long count;
+
+    while (true)
+    {
+      //! The count starts over if the driver restarts, so any change is a newer state
+      count = Count();
+      if (count != 0 && count != after && GetRobotState(state) == CANON_SUCCESS)
+      {
+        return CANON_SUCCESS;
+      }
+      if (ulapi_time() >= until)
+      {
+        return CANON_REJECT;
+      }
+      ulapi_sleep(0.0005);
+    }
+  }
+} // crpi_robot
@@ -0,0 +1,160 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_state_shm.h
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Shared-memory publication of robot state to other processes on the same
+//  computer.
+//
+//  The driver process owns the segment:  CrpiRobot::PublishState creates it
+//  with the caller's key and size sizeof(crpiStateShared), zeroes it, and
+//  stores CRPI_STATE_SHM_MAGIC in magic last.  Each new state is then written
+//  through the segment's sequence lock, and magic is cleared again when the
+//  driver stops publishing.  Readers map the same key and copy the latest
+//  state without any contact with the driver or the robot.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_state_shm_H
+#define crpi_state_shm_H
+
+#include "crpi.h"
+
+//! Marks a segment that has been initialized by a publishing driver ("CRST")
+#define CRPI_STATE_SHM_MAGIC 0x43525354
+
+//! Layout version of crpiStateShared
+#define CRPI_STATE_SHM_VERSION 1
+
+//! Longest robot label, including the terminator
+#define CRPI_STATE_NAME_MAX 64
+
+//! Attempts a reader makes to get a copy that no write overlapped
+#define CRPI_STATE_READ_TRIES 64
+
+namespace crpi_robot
+{
+  //! @brief Layout of a published state segment
+  //!
+  struct crpiStateShared
+  {
+    //! @brief CRPI_STATE_SHM_MAGIC while a driver is publishing, 0 otherwise
+    //!
+    std::atomic<unsigned int> magic;
+
+    //! @brief CRPI_STATE_SHM_VERSION, and sizeof(RobotStateSnapshot) in the publisher's build
+    //!
+    unsigned int version;
+    unsigned int snapshotSize;
+
+    //! @brief Label the publisher gave the robot
+    //!
+    char robot[CRPI_STATE_NAME_MAX];
+
+    //! @brief The latest state
+    //!
+    crpi_seqlock<RobotStateSnapshot> state;
+  };
+
+
+  //! @ingroup Robot
+  //!
+  //! @brief Writer of a state segment (used by CrpiRobot::PublishState)
+  //!
+  class LIBRARY_API CrpiStatePublisher
+  {
+  public:
+    //! @brief Default constructor.  Creates (or reuses) the segment and marks it published.
+    //!
+    //! @param key   Shared memory key of the segment
+    //! @param robot Label for readers (e.g., the robot's name; NULL for none)
+    //!
+    CrpiStatePublisher (ulapi_id key, const char *robot);
+
+    //! @brief Default destructor.  Marks the segment unpublished and detaches from it.
+    //!
+    ~CrpiStatePublisher ();
+
+    //! @brief Whether the segment could be mapped
+    //!
+    bool Ready () const;
+
+    //! @brief Publish a new state
+    //!
+    void Publish (const RobotStateSnapshot &state);
+
+  private:
+    void *shmHandle_;
+    crpiStateShared *shm_;
+
+    CrpiStatePublisher (const CrpiStatePublisher &) = delete;
+    CrpiStatePublisher &operator= (const CrpiStatePublisher &) = delete;
+  }; // CrpiStatePublisher
+
+
+  //! @ingroup Robot
+  //!
+  //! @brief Read-only view of the state a driver process publishes with CrpiRobot::PublishState.
+  //!        Any number of readers can attach to a segment; reading never blocks the driver and
+  //!        puts no load on the robot controller.  A reader may be created before the driver
+  //!        starts publishing, and keeps working across restarts of the driver.
+  //!
+  class LIBRARY_API CrpiStateReader
+  {
+  public:
+    //! @brief Default constructor
+    //!
+    //! @param key Shared memory key passed to PublishState by the driver
+    //!
+    CrpiStateReader (ulapi_id key);
+
+    //! @brief Default destructor
+    //!
+    ~CrpiStateReader ();
+
+    //! @brief Whether a compatible driver is currently publishing to the segment
+    //!
+    bool Published () const;
+
+    //! @brief Label the driver gave the robot (empty if not published)
+    //!
+    const char *Robot () const;
+
+    //! @brief Number of states published since the driver started publishing (0 if none)
+    //!
+    unsigned long Count () const;
+
+    //! @brief Copy the latest state
+    //!
+    //! @param state Snapshot to be populated by the method
+    //!
+    //! @return SUCCESS if a state was copied, REJECT if nothing is published, or if the driver
+    //!         stopped in the middle of a write
+    //!
+    CanonReturn GetRobotState (RobotStateSnapshot *state) const;
+
+    //! @brief Wait for a state newer than one already read
+    //!
+    //! @param state   Snapshot to be populated by the method
+    //! @param after   Count() when the last state was read (0 for any state)
+    //! @param timeout Longest time (s) to wait
+    //!
+    //! @return SUCCESS if a newer state was copied, REJECT on a timeout
+    //!
+    CanonReturn WaitForState (RobotStateSnapshot *state, unsigned long after, double timeout) const;
+
+  private:
+    void *shmHandle_;
+    crpiStateShared *shm_;
+
+    CrpiStateReader (const CrpiStateReader &) = delete;
+    CrpiStateReader &operator= (const CrpiStateReader &) = delete;
+  }; // CrpiStateReader
+} // crpi_robot
+
+#endif
@@ -0,0 +1,637 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_tactile.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Tactile array acquisition and contact detection definitions.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_tactile.h"
+#include "crpi_log.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define TACTILE_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define TACTILE_NEON
+#endif
+
+using namespace std;
+
+namespace crpi_robot
+{
+  //! @brief Mark the texels at or above a threshold (0xFF, else 0) and sum their values
+  //!
+  //! @param cells     Texels, zero-padded to a multiple of 8
+  //! @param n         Texels to test (a multiple of 8)
+  //! @param threshold Lowest value in contact (at least 1, so padding is never marked)
+  //! @param mask      Marks to be populated by the function
+  //!
+  //! @return Sum of the marked values
+  //!
+  static uint32_t thresholdCells (const uint16_t *cells, int n, uint16_t threshold, unsigned char *mask)
+  {
+    uint32_t sum = 0;
+    int i = 0;
+#if defined(TACTILE_SSE2)
+    const __m128i t = _mm_set1_epi16((short)threshold), zero = _mm_setzero_si128(), one = _mm_set1_epi16(1);
+    __m128i acc = zero;
+    uint32_t lanes[4];
+    for (; i + 8 <= n; i += 8)
+    {
+      //! v >= t exactly when t - v saturates to 0; texels are 12-bit, so madd's signed pairs
+      //! cannot overflow
+      __m128i v = _mm_loadu_si128((const __m128i*)(cells + i));
+      __m128i m = _mm_cmpeq_epi16(_mm_subs_epu16(t, v), zero);
+      _mm_storel_epi64((__m128i*)(mask + i), _mm_packs_epi16(m, m));
+      acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_and_si128(v, m), one));
+    }
+    _mm_storeu_si128((__m128i*)lanes, acc);
+    sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(TACTILE_NEON)
+    const uint16x8_t t = vdupq_n_u16(threshold);
+    uint32x4_t acc = vdupq_n_u32(0);
+    for (; i + 8 <= n; i += 8)
+    {
+      uint16x8_t v = vld1q_u16(cells + i);
+      uint16x8_t m = vcgeq_u16(v, t);
+      vst1_u8(mask + i, vmovn_u16(m));
+      acc = vpadalq_u16(acc, vandq_u16(v, m));
+    }
+    sum = vaddvq_u32(acc);
+#endif
+    for (; i < n; ++i)
+    {
+      mask[i] = (cells[i] >= threshold) ? 0xFF : 0;
+      sum += mask[i] ? cells[i] : 0;
+    }
+    return sum;
+  }
+
+
+  LIBRARY_API CrpiTactileConfig::CrpiTactileConfig ()
+  {
+    strcpy(port, "COM2");
+    baud = CRPI_TACTILE_BAUD;
+    rate = CRPI_TACTILE_RATE;
+    rle = true;
+    threshold = CRPI_TACTILE_THRESHOLD;
+    minCells = 2;
+    pressure = CRPI_TACTILE_PRESSURE;
+    pads = 6;
+    for (int i = 0; i < CRPI_TACTILE_PADS_MAX; ++i)
+    {
+      rows[i] = (i & 1) ? 13 : 14;
+      cols[i] = 6;
+      pitch[i] = 3.4;
+    }
+  }
+
+
+  LIBRARY_API int crpi_tactile_pad_contacts (const uint16_t *cells, int rows, int cols, double pitch,
+                                             const CrpiTactileConfig &config, int pad,
+                                             CrpiTactileContact *contact, int max,
+                                             float &padForce, bool &truncated)
+  {
+    unsigned char mask[CRPI_TACTILE_CELLS_MAX];
+    int stack[CRPI_TACTILE_CELLS_MAX];
+    const int n = rows * cols;
+    const uint16_t threshold = (uint16_t)((config.threshold < 1) ? 1 : config.threshold);
+    const double scale = config.pressure * pitch * pitch;
+    uint32_t total, noise = 0;
+    int i, j, r, c, dr, dc, rr, cc, top, count = 0;
+
+    padForce = 0.0f;
+    if (n <= 0 || n > CRPI_TACTILE_CELLS_MAX)
+    {
+      return 0;
+    }
+
+    //! Every texel is tested, eight at a time; only pads with contact go on to labeling
+    total = thresholdCells(cells, (n + 7) & ~7, threshold, mask);
+    if (total == 0)
+    {
+      return 0;
+    }
+
+    //! 8-connected components, by flood fill; marks are cleared as texels are taken
+    for (i = 0; i < n; ++i)
+    {
+      if (mask[i] == 0)
+      {
+        continue;
+      }
+
+      uint32_t weight = 0, peak = 0, cells_in = 0;
+      double sumR = 0.0, sumC = 0.0;
+
+      mask[i] = 0;
+      stack[0] = i;
+      top = 1;
+      while (top > 0)
+      {
+        j = stack[--top];
+        r = j / cols;
+        c = j - (r * cols);
+        weight += cells[j];
+        sumR += (double)cells[j] * r;
+        sumC += (double)cells[j] * c;
+        peak = (cells[j] > peak) ? cells[j] : peak;
+        ++cells_in;
+
+        for (dr = -1; dr <= 1; ++dr)
+        {
+          rr = r + dr;
+          if (rr < 0 || rr >= rows)
+          {
+            continue;
+          }
+          for (dc = -1; dc <= 1; ++dc)
+          {
+            cc = c + dc;
+            if (cc < 0 || cc >= cols || mask[(rr * cols) + cc] == 0)
+            {
+              continue;
+            }
+            mask[(rr * cols) + cc] = 0;
+            stack[top++] = (rr * cols) + cc;
+          }
+        }
+      }
+
+      if ((int)cells_in < config.minCells)
+      {
+        noise += weight;
+        continue;
+      }
+      if (count >= max)
+      {
+        truncated = true;
+        continue;
+      }
+      contact[count].pad = (unsigned char)pad;
+      contact[count].cells = (unsigned char)cells_in;
+      contact[count].peak = (unsigned short)peak;
+      contact[count].x = (float)(((sumC / weight) + 0.5) * pitch);
+      contact[count].y = (float)(((sumR / weight) + 0.5) * pitch);
+      contact[count].force = (float)(weight * scale);
+      ++count;
+    }
+
+    padForce = (float)((total - noise) * scale);
+    return count;
+  }
+
+
+  LIBRARY_API int crpi_tactile_contacts (const CrpiTactileFrame &frame, const CrpiTactileConfig &config,
+                                         CrpiTactileContacts &contacts)
+  {
+    int pad;
+
+    contacts.sequence = frame.sequence;
+    contacts.timestamp = frame.timestamp;
+    contacts.total = 0.0f;
+    contacts.count = 0;
+    contacts.truncated = false;
+    for (pad = 0; pad < CRPI_TACTILE_PADS_MAX; ++pad)
+    {
+      contacts.padForce[pad] = 0.0f;
+    }
+
+    for (pad = 0; pad < frame.pads && pad < CRPI_TACTILE_PADS_MAX; ++pad)
+    {
+      contacts.count += crpi_tactile_pad_contacts(frame.cells[pad], frame.rows[pad], frame.cols[pad],
+                                                  frame.pitch[pad], config, pad,
+                                                  contacts.contact + contacts.count,
+                                                  CRPI_TACTILE_CONTACTS_MAX - contacts.count,
+                                                  contacts.padForce[pad], contacts.truncated);
+      contacts.total += contacts.padForce[pad];
+    }
+    return contacts.count;
+  }
+
+
+  //! @brief CRC-16 of a DSACON32m packet (reflected 0x8005, from 0xFFFF)
+  //!
+  static uint16_t tactileCrc (const unsigned char *data, int len)
+  {
+    uint16_t crc = 0xFFFF;
+
+    for (int i = 0; i < len; ++i)
+    {
+      crc ^= data[i];
+      for (int b = 0; b < 8; ++b)
+      {
+        crc = (crc & 1) ? ((crc >> 1) ^ 0xA001) : (crc >> 1);
+      }
+    }
+    return crc;
+  }
+
+
+  LIBRARY_API CrpiTactileSensor::CrpiTactileSensor (const CrpiTactileConfig &config) :
+    config_(config),
+    serial_(NULL),
+    task_(NULL),
+    running_(false),
+    threshold_(config.threshold),
+    held_(0),
+    used_(0),
+    size_(0)
+  {
+    char port[40];
+    int total = 0;
+
+    memset(&counters_, 0, sizeof(counters_));
+    ring_.clear();
+    if (config_.pads < 1 || config_.pads > CRPI_TACTILE_PADS_MAX)
+    {
+      CRPI_LOG(CRPI_LOG_ERROR, "CrpiTactileSensor:  %d pads are not supported", config_.pads);
+      return;
+    }
+    for (int i = 0; i < config_.pads; ++i)
+    {
+      if (config_.rows[i] < 1 || config_.cols[i] < 1 || (config_.rows[i] * config_.cols[i]) > CRPI_TACTILE_CELLS_MAX)
+      {
+        CRPI_LOG(CRPI_LOG_ERROR, "CrpiTactileSensor:  pad %d is not supported", i);
+        return;
+      }
+      total += config_.rows[i] * config_.cols[i];
+    }
+    if (!SetThreshold(config_.threshold))
+    {
+      threshold_.store(CRPI_TACTILE_THRESHOLD);
+    }
+
+    //! Named as the SDH's own port is
+#ifdef WIN32
+    strcpy(port, config_.port);
+#else
+    if (strncmp(config_.port, "COM", 3) == 0)
+    {
+      sprintf(port, "/dev/ttyS%d", atoi(config_.port + 3) - 1);
+    }
+    else if (strncmp(config_.port, "USB", 3) == 0)
+    {
+      sprintf(port, "/dev/ttyUSB%d", atoi(config_.port + 3));
+    }
+    else
+    {
+      strcpy(port, config_.port);
+    }
+#endif
+
+    serial_ = ulapi_serial_new();
+    if (serial_ == NULL ||
+        ulapi_serial_open(port, serial_) != ULAPI_OK ||
+        ulapi_serial_baud(serial_, (config_.baud > 0) ? config_.baud : CRPI_TACTILE_BAUD) != ULAPI_OK)
+    {
+      CRPI_LOG(CRPI_LOG_ERROR, "CrpiTactileSensor:  no connection to %s", port);
+      if (serial_ != NULL)
+      {
+        ulapi_serial_delete(serial_);
+        serial_ = NULL;
+      }
+      return;
+    }
+    ulapi_serial_set_blocking(serial_);
+    CRPI_LOG(CRPI_LOG_INFO, "CrpiTactileSensor:  %d texels on %d pads at %s", total, config_.pads, port);
+  }
+
+
+  LIBRARY_API CrpiTactileSensor::~CrpiTactileSensor ()
+  {
+    Stop();
+    if (serial_ != NULL)
+    {
+      ulapi_serial_close(serial_);
+      ulapi_serial_delete(serial_);
+    }
+  }
+
+
+  LIBRARY_API bool CrpiTactileSensor::Ready () const
+  {
+    return (serial_ != NULL);
+  }
+
+
+  LIBRARY_API bool CrpiTactileSensor::Start ()
+  {
+    unsigned char rate[3];
+    int hz = (config_.rate > 0) ? config_.rate : CRPI_TACTILE_RATE;
+
+    if (serial_ == NULL || running_.load())
+    {
+      return false;
+    }
+
+    rate[0] = CRPI_TACTILE_FLAG_ACQUIRE | (config_.rle ? CRPI_TACTILE_FLAG_RLE : 0);
+    rate[1] = (unsigned char)(hz & 0xFF);
+    rate[2] = (unsigned char)((hz >> 8) & 0xFF);
+    held_ = used_ = 0;
+    if (!writePacket(CRPI_TACTILE_ID_RATE, rate, 3))
+    {
+      CRPI_LOG(CRPI_LOG_ERROR, "CrpiTactileSensor:  could not start the frames");
+      return false;
+    }
+
+    running_.store(true);
+    task_ = ulapi_task_new();
+    if (task_ == NULL ||
+        ulapi_task_start((ulapi_task_struct*)task_, run, this, ulapi_prio_highest(), 0) != ULAPI_OK)
+    {
+      CRPI_LOG(CRPI_LOG_ERROR, "CrpiTactileSensor:  could not start the acquisition task");
+      running_.store(false);
+      if (task_ != NULL)
+      {
+        ulapi_task_delete((ulapi_task_struct*)task_);
+        task_ = NULL;
+      }
+      return false;
+    }
+    return true;
+  }
+
+
+  LIBRARY_API void CrpiTactileSensor::Stop ()
+  {
+    unsigned char rate[3] = {0, 0, 0};
+
+    if (task_ == NULL)
+    {
+      return;
+    }
+
+    //! The task may be blocked waiting for the controller
+    running_.store(false);
+    ulapi_task_stop((ulapi_task_struct*)task_);
+    ulapi_task_join((ulapi_task_struct*)task_, NULL);
+    ulapi_task_delete((ulapi_task_struct*)task_);
+    task_ = NULL;
+    writePacket(CRPI_TACTILE_ID_RATE, rate, 3);
+  }
+
+
+  LIBRARY_API bool CrpiTactileSensor::Running () const
+  {
+    return running_.load();
+  }
+
+
+  LIBRARY_API unsigned long CrpiTactileSensor::Frame (CrpiTactileFrame &frame) const
+  {
+    return frame_.read(frame);
+  }
+
+
+  LIBRARY_API bool CrpiTactileSensor::Latest (CrpiTactileContacts &contacts) const
+  {
+    if (latest_.count() == 0)
+    {
+      return false;
+    }
+    latest_.read(contacts);
+    return true;
+  }
+
+
+  LIBRARY_API bool CrpiTactileSensor::Next (CrpiTactileContacts &contacts)
+  {
+    return ring_.pop(contacts);
+  }
+
+
+  LIBRARY_API bool CrpiTactileSensor::SetThreshold (int threshold)
+  {
+    if (threshold < 1 || threshold > CRPI_TACTILE_FULL_SCALE)
+    {
+      return false;
+    }
+    threshold_.store(threshold);
+    return true;
+  }
+
+
+  LIBRARY_API void CrpiTactileSensor::Stats (CrpiTactileStats &stats) const
+  {
+    memset(&stats, 0, sizeof(stats));
+    if (stats_.count() > 0)
+    {
+      stats_.read(stats);
+    }
+  }
+
+
+  bool CrpiTactileSensor::writePacket (int id, const unsigned char *payload, int size)
+  {
+    unsigned char out[16];
+    uint16_t crc;
+    int len = 0;
+
+    out[len++] = 0xAA;
+    out[len++] = 0xAA;
+    out[len++] = 0xAA;
+    out[len++] = (unsigned char)id;
+    out[len++] = (unsigned char)(size & 0xFF);
+    out[len++] = (unsigned char)((size >> 8) & 0xFF);
+    memcpy(out + len, payload, size);
+    len += size;
+    if (size > 0)
+    {
+      crc = tactileCrc(out + 3, len - 3);
+      out[len++] = (unsigned char)(crc & 0xFF);
+      out[len++] = (unsigned char)(crc >> 8);
+    }
+    return (ulapi_serial_write(serial_, (const char*)out, len) == len);
+  }
+
+
+  int CrpiTactileSensor::readPacket ()
+  {
+    int i, get, total;
+
+    //! Drop the previous packet
+    held_ -= used_;
+    memmove(rx_, rx_ + used_, held_);
+    used_ = 0;
+
+    while (running_.load(std::memory_order_relaxed))
+    {
+      //! Resynchronize on the preamble; bytes before it are noise or a partial packet
+      for (i = 0; i + 2 < held_; ++i)
+      {
+        if (rx_[i] == 0xAA && rx_[i + 1] == 0xAA && rx_[i + 2] == 0xAA)
+        {
+          break;
+        }
+      }
+      if (i > 0)
+      {
+        held_ -= i;
+        memmove(rx_, rx_ + i, held_);
+      }
+
+      if (held_ >= 6)
+      {
+        size_ = rx_[4] | (rx_[5] << 8);
+        total = 6 + size_ + ((size_ > 0) ? 2 : 0);
+        if (total > (int)sizeof(rx_))
+        {
+          //! Not a header after all
+          ++counters_.errors;
+          held_ -= 1;
+          memmove(rx_, rx_ + 1, held_);
+          continue;
+        }
+        if (held_ >= total)
+        {
+          if (size_ > 0 && tactileCrc(rx_ + 3, 3 + size_) != (rx_[6 + size_] | (rx_[7 + size_] << 8)))
+          {
+            ++counters_.errors;
+            held_ -= 1;
+            memmove(rx_, rx_ + 1, held_);
+            continue;
+          }
+          used_ = total;
+          return rx_[3];
+        }
+      }
+
+      get = ulapi_serial_read(serial_, (char*)rx_ + held_, (int)sizeof(rx_) - held_);
+      if (get <= 0)
+      {
+        return -1;
+      }
+      held_ += get;
+    }
+    return -1;
+  }
+
+
+  bool CrpiTactileSensor::decodeFrame (CrpiTactileFrame &frame)
+  {
+    const unsigned char *p = rx_ + 6;
+    int i = 5, pad = 0, cell = 0, left, unit, count;
+    bool rle;
+
+    if (size_ < 5)
+    {
+      return false;
+    }
+    frame.sensorTime = p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+    rle = (p[4] & CRPI_TACTILE_FLAG_RLE) != 0;
+    frame.pads = config_.pads;
+    for (pad = 0; pad < config_.pads; ++pad)
+    {
+      frame.rows[pad] = config_.rows[pad];
+      frame.cols[pad] = config_.cols[pad];
+      frame.pitch[pad] = config_.pitch[pad];
+    }
+    memset(frame.cells, 0, sizeof(frame.cells));
+
+    //! Texels run on from one pad to the next
+    pad = 0;
+    left = frame.rows[0] * frame.cols[0];
+    while (pad < frame.pads)
+    {
+      if (i + 2 > size_)
+      {
+        return false;
+      }
+      unit = p[i] | (p[i + 1] << 8);
+      i += 2;
+      count = 1;
+      if (rle && (unit & 0x1000))
+      {
+        if (i >= size_)
+        {
+          return false;
+        }
+        count = p[i++];
+      }
+      unit &= 0x0FFF;
+
+      for (; count > 0; --count)
+      {
+        if (pad >= frame.pads)
+        {
+          //! A run past the last texel
+          return false;
+        }
+        frame.cells[pad][cell++] = (uint16_t)unit;
+        if (--left == 0)
+        {
+          ++pad;
+          cell = 0;
+          left = (pad < frame.pads) ? frame.rows[pad] * frame.cols[pad] : 0;
+        }
+      }
+    }
+    return (i == size_);
+  }
+
+
+  void CrpiTactileSensor::run (void *param)
+  {
+    CrpiTactileSensor *sensor = (CrpiTactileSensor*)param;
+    CrpiTactileConfig detect = sensor->config_;
+    CrpiTactileContacts contacts;
+    double received, latency;
+    int id;
+
+    while (sensor->running_.load(std::memory_order_relaxed))
+    {
+      id = sensor->readPacket();
+      if (id < 0)
+      {
+        break;
+      }
+      if (id != CRPI_TACTILE_ID_FRAME)
+      {
+        //! E.g., the acknowledgement of the rate packet
+        continue;
+      }
+      received = ulapi_time();
+
+      //! Decoded in place into the copy readers are not using
+      CrpiTactileFrame &frame = sensor->frame_.begin();
+      if (!sensor->decodeFrame(frame))
+      {
+        sensor->frame_.abandon();
+        ++sensor->counters_.errors;
+        sensor->stats_.write(sensor->counters_);
+        continue;
+      }
+      frame.sequence = ++sensor->counters_.frames;
+      frame.timestamp = received;
+      sensor->frame_.commit();
+
+      detect.threshold = sensor->threshold_.load(std::memory_order_relaxed);
+      crpi_tactile_contacts(sensor->frame_.front(), detect, contacts);
+      sensor->latest_.write(contacts);
+      if (!sensor->ring_.push(contacts))
+      {
+        ++sensor->counters_.dropped;
+      }
+
+      latency = ulapi_time() - received;
+      if (latency > sensor->counters_.worstLatency)
+      {
+        sensor->counters_.worstLatency = latency;
+      }
+      sensor->stats_.write(sensor->counters_);
+    }
+    sensor->running_.store(false);
+  }
+} // crpi_robot
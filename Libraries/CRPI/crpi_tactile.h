@@ -0,0 +1,474 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_tactile.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Tactile array acquisition and contact detection for the Schunk SDH.
+//
+//  The SDH's DSA tactile pads (a proximal and a distal pad on each of the
+//  three fingers) are read by their own DSACON32m controller on a serial
+//  port of its own, which pushes a full pressure image of every pad at a
+//  fixed frame rate.  A CrpiTactileSensor reads those frames on a task of
+//  its own and decodes each one straight into the back half of a double
+//  buffer, so readers of the latest frame never wait on the port nor hold
+//  up the decoder.  Each frame is then reduced to a few contact records:
+//  texels are thresholded (with SSE2 or NEON, eight at a time), joined into
+//  8-connected components, and each component's pressure-weighted centroid
+//  and force are computed.  The records of every frame go through a ring to
+//  one consumer (e.g., an assembly terminator or a grasp controller that
+//  must see each frame), and the newest are also published to any number of
+//  readers.
+//
+//  DSACON32m packets, all little-endian:
+//
+//    AA AA AA                    preamble
+//    id                          packet id (CRPI_TACTILE_ID_*)
+//    size                        payload length (2 bytes)
+//    payload                     size bytes
+//    crc                         CRC-16 (0xA001, from 0xFFFF) of id, size,
+//                                and payload; only present if size > 0
+//
+//  A frame payload is the controller's timestamp (ms, 4 bytes), a flags
+//  byte, and the texels of every pad in order, row by row, as 12-bit values
+//  (2 bytes each), or run-length encoded when the flags' low bit is set
+//  (units with bit 12 set are followed by a repeat count byte).  Frames are
+//  pushed after a CRPI_TACTILE_ID_RATE packet of a flags byte (acquisition
+//  and encoding) and the frame rate (2 bytes).
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_tactile_H
+#define crpi_tactile_H
+
+#include "crpi.h"
+#include "crpi_servo.h"
+
+#include <stdint.h>
+
+//! Most pads in a frame
+#define CRPI_TACTILE_PADS_MAX 6
+
+//! Most texels of one pad (a multiple of 8, so that each pad is whole SIMD vectors)
+#define CRPI_TACTILE_CELLS_MAX 96
+
+//! Most contact records of one frame
+#define CRPI_TACTILE_CONTACTS_MAX 24
+
+//! Frames of contact records held for the consumer (a power of two)
+#define CRPI_TACTILE_RING 64
+
+//! Largest texel value
+#define CRPI_TACTILE_FULL_SCALE 4095
+
+//! Default texel threshold of a contact (counts)
+#define CRPI_TACTILE_THRESHOLD 150
+
+//! Default pressure (N/mm^2) of one count (250 kPa at full scale)
+#define CRPI_TACTILE_PRESSURE (0.25 / CRPI_TACTILE_FULL_SCALE)
+
+//! Default DSACON32m baud rate
+#define CRPI_TACTILE_BAUD 115200
+
+//! Default frame rate (Hz) requested from the DSACON32m
+#define CRPI_TACTILE_RATE 30
+
+//! DSACON32m packet ids
+#define CRPI_TACTILE_ID_FRAME 0x00
+#define CRPI_TACTILE_ID_RATE  0x03
+
+//! DSACON32m flags:  frames are run-length encoded, and frames are acquired (rate packets only)
+#define CRPI_TACTILE_FLAG_RLE     0x01
+#define CRPI_TACTILE_FLAG_ACQUIRE 0x80
+
+namespace crpi_robot
+{
+  //! @brief Fixed-size value published by one writer to any number of readers through two
+  //!        copies:  the writer fills the back copy while readers copy the front one, and the
+  //!        two swap when the write is done.  Readers retry only if the writer laps them (two
+  //!        writes during one copy).
+  //!
+  //! @note T must not own heap memory
+  //!
+  template <class T> class crpi_double_buffer
+  {
+  public:
+    //! @brief Default constructor
+    //!
+    crpi_double_buffer () :
+      front_(0),
+      count_(0)
+    {
+      seq_[0].store(0);
+      seq_[1].store(0);
+    }
+
+    //! @brief Start a write (writer only)
+    //!
+    //! @return The back copy, to be filled in place
+    //!
+    T &begin ()
+    {
+      const int b = 1 - front_.load(std::memory_order_relaxed);
+
+      //! Odd sequence marks a write in progress
+      seq_[b].store(seq_[b].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      return data_[b];
+    }
+
+    //! @brief Finish a write and make it the front copy (writer only)
+    //!
+    void commit ()
+    {
+      const int b = 1 - front_.load(std::memory_order_relaxed);
+
+      seq_[b].store(seq_[b].load(std::memory_order_relaxed) + 1, std::memory_order_release);
+      front_.store(b, std::memory_order_release);
+      count_.fetch_add(1, std::memory_order_release);
+    }
+
+    //! @brief Give up a write, leaving the front copy as it was (writer only)
+    //!
+    void abandon ()
+    {
+      const int b = 1 - front_.load(std::memory_order_relaxed);
+
+      seq_[b].store(seq_[b].load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    //! @brief The front copy (writer only, e.g., to process what was just committed)
+    //!
+    const T &front () const
+    {
+      return data_[front_.load(std::memory_order_relaxed)];
+    }
+
+    //! @brief Copy the front copy
+    //!
+    //! @param value Destination of the copy
+    //!
+    //! @return Number of writes committed so far (0 if none, and value is untouched)
+    //!
+    unsigned long read (T &value) const
+    {
+      unsigned long s1, s2, n;
+      int f;
+
+      do
+      {
+        n = count_.load(std::memory_order_acquire);
+        if (n == 0)
+        {
+          return 0;
+        }
+        f = front_.load(std::memory_order_acquire);
+        s1 = seq_[f].load(std::memory_order_acquire);
+        memcpy((void*)&value, (const void*)&data_[f], sizeof(T));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        s2 = seq_[f].load(std::memory_order_relaxed);
+      } while ((s1 & 1) || (s1 != s2));
+
+      return n;
+    }
+
+  private:
+    T data_[2];
+    std::atomic<unsigned long> seq_[2];
+    std::atomic<int> front_;
+    std::atomic<unsigned long> count_;
+  };
+
+
+  //! @brief One pressure image of every pad
+  //!
+  struct CrpiTactileFrame
+  {
+    //! @brief Frame number, from 1
+    //!
+    unsigned long sequence;
+
+    //! @brief Time (ulapi_time, s) the frame was received, and the controller's own timestamp
+    //!        (ms)
+    //!
+    double timestamp;
+    unsigned int sensorTime;
+
+    //! @brief Number of pads, and the rows and columns of each
+    //!
+    int pads;
+    int rows[CRPI_TACTILE_PADS_MAX];
+    int cols[CRPI_TACTILE_PADS_MAX];
+
+    //! @brief Texel spacing (mm) of each pad
+    //!
+    double pitch[CRPI_TACTILE_PADS_MAX];
+
+    //! @brief Texels of each pad, row by row (rows * cols used, the rest 0)
+    //!
+    uint16_t cells[CRPI_TACTILE_PADS_MAX][CRPI_TACTILE_CELLS_MAX];
+  };
+
+
+  //! @brief One contact on a pad (16 bytes)
+  //!
+  struct CrpiTactileContact
+  {
+    //! @brief Pad of the contact (finger pad / 2, distal if odd, on the SDH)
+    //!
+    unsigned char pad;
+
+    //! @brief Texels in contact
+    //!
+    unsigned char cells;
+
+    //! @brief Largest texel value in the contact
+    //!
+    unsigned short peak;
+
+    //! @brief Pressure-weighted centroid (mm) on the pad, across the columns (x) and along the
+    //!        rows (y) from the corner of texel 0
+    //!
+    float x;
+    float y;
+
+    //! @brief Normal force (N)
+    //!
+    float force;
+  };
+
+
+  //! @brief The contacts of one frame
+  //!
+  struct CrpiTactileContacts
+  {
+    //! @brief Frame number and time of receipt (ulapi_time, s), as in the frame
+    //!
+    unsigned long sequence;
+    double timestamp;
+
+    //! @brief Normal force (N) over the contacts of each pad, and of every pad
+    //!
+    float padForce[CRPI_TACTILE_PADS_MAX];
+    float total;
+
+    //! @brief Number of contacts, and whether some were left out because there were more than
+    //!        CRPI_TACTILE_CONTACTS_MAX
+    //!
+    int count;
+    bool truncated;
+
+    CrpiTactileContact contact[CRPI_TACTILE_CONTACTS_MAX];
+  };
+
+
+  //! @brief Settings of a CrpiTactileSensor (and of contact detection)
+  //!
+  struct LIBRARY_API CrpiTactileConfig
+  {
+    //! @brief Serial port of the DSACON32m ("COMn", "USBn", or a device path), and its baud rate
+    //!
+    char port[32];
+    int baud;
+
+    //! @brief Frame rate (Hz) requested from the controller
+    //!
+    int rate;
+
+    //! @brief Whether the controller run-length encodes frames (fewer bytes for sparse contact)
+    //!
+    bool rle;
+
+    //! @brief Lowest texel value (counts, at least 1) that is in contact
+    //!
+    int threshold;
+
+    //! @brief Fewest texels of a contact (smaller components are noise)
+    //!
+    int minCells;
+
+    //! @brief Pressure (N/mm^2) of one count
+    //!
+    double pressure;
+
+    //! @brief Pads, with their rows, columns, and texel spacing (mm)
+    //!
+    int pads;
+    int rows[CRPI_TACTILE_PADS_MAX];
+    int cols[CRPI_TACTILE_PADS_MAX];
+    double pitch[CRPI_TACTILE_PADS_MAX];
+
+    //! @brief Default constructor:  the six pads of the SDH-2 (proximal pads of 14 x 6 texels
+    //!        and distal pads of 13 x 6, 3.4 mm apart, finger by finger)
+    //!
+    CrpiTactileConfig ();
+  };
+
+
+  //! @brief Find the contacts on one pad
+  //!
+  //! @param cells     Texels of the pad, row by row, zero-padded to a multiple of 8
+  //! @param rows      Rows of the pad
+  //! @param cols      Columns of the pad (rows * cols <= CRPI_TACTILE_CELLS_MAX)
+  //! @param pitch     Texel spacing (mm)
+  //! @param config    Threshold, smallest contact, and pressure scale
+  //! @param pad       Pad number written to the records
+  //! @param contact   Records to be populated by the function
+  //! @param max       Most records to write
+  //! @param padForce  Force (N) over every contact of the pad (including any left out), populated
+  //!                  by the function
+  //! @param truncated Set if the pad has more than max contacts
+  //!
+  //! @return Number of records written
+  //!
+  LIBRARY_API int crpi_tactile_pad_contacts (const uint16_t *cells, int rows, int cols, double pitch,
+                                             const CrpiTactileConfig &config, int pad,
+                                             CrpiTactileContact *contact, int max,
+                                             float &padForce, bool &truncated);
+
+  //! @brief Find the contacts of every pad of a frame
+  //!
+  //! @param frame    The frame
+  //! @param config   Threshold, smallest contact, and pressure scale
+  //! @param contacts Records to be populated by the function
+  //!
+  //! @return Number of contacts
+  //!
+  LIBRARY_API int crpi_tactile_contacts (const CrpiTactileFrame &frame, const CrpiTactileConfig &config,
+                                         CrpiTactileContacts &contacts);
+
+
+  //! @brief Counters of a CrpiTactileSensor
+  //!
+  struct CrpiTactileStats
+  {
+    //! @brief Frames decoded, packets with a bad CRC or an undecodable frame, and frames of
+    //!        contact records dropped because the consumer's ring was full
+    //!
+    unsigned long frames;
+    unsigned long errors;
+    unsigned long dropped;
+
+    //! @brief Longest time (s) from a frame's last byte to its contacts being published
+    //!
+    double worstLatency;
+  };
+
+
+  //! @ingroup Robot
+  //!
+  //! @brief Tactile acquisition from a DSACON32m (used by CrpiSchunkSDH with the "tactile_*"
+  //!        parameters)
+  //!
+  class LIBRARY_API CrpiTactileSensor
+  {
+  public:
+    //! @brief Default constructor.  Opens the port; frames are read once Start is called.
+    //!
+    //! @param config Port, frame rate, pad layout, and detection settings
+    //!
+    CrpiTactileSensor (const CrpiTactileConfig &config);
+
+    //! @brief Default destructor.  Stops acquisition and closes the port.
+    //!
+    ~CrpiTactileSensor ();
+
+    //! @brief Whether the port could be opened
+    //!
+    bool Ready () const;
+
+    //! @brief Ask the controller to push frames, and start the acquisition task
+    //!
+    //! @return True if acquisition was started
+    //!
+    bool Start ();
+
+    //! @brief Stop the acquisition task, then the controller's frames
+    //!
+    void Stop ();
+
+    //! @brief Whether the acquisition task is running
+    //!
+    bool Running () const;
+
+    //! @brief Copy the latest frame
+    //!
+    //! @return Frames received so far (0 if none, and frame is untouched)
+    //!
+    unsigned long Frame (CrpiTactileFrame &frame) const;
+
+    //! @brief Copy the contacts of the latest frame
+    //!
+    //! @return False if no frame has been received
+    //!
+    bool Latest (CrpiTactileContacts &contacts) const;
+
+    //! @brief Take the contacts of the oldest frame not yet taken (one consumer only).  Frames
+    //!        are dropped when CRPI_TACTILE_RING of them are waiting.
+    //!
+    //! @return False if there is none
+    //!
+    bool Next (CrpiTactileContacts &contacts);
+
+    //! @brief Change the texel threshold (counts) from the next frame on
+    //!
+    //! @return False if the threshold is out of range
+    //!
+    bool SetThreshold (int threshold);
+
+    //! @brief Copy the counters
+    //!
+    void Stats (CrpiTactileStats &stats) const;
+
+  private:
+    //! @brief The acquisition task
+    //!
+    static void run (void *param);
+
+    //! @brief Read one packet into rx_
+    //!
+    //! @return The packet id, or -1 if the port failed or the task was stopped
+    //!
+    int readPacket ();
+
+    //! @brief Send a packet
+    //!
+    bool writePacket (int id, const unsigned char *payload, int size);
+
+    //! @brief Decode the frame packet in rx_ into the back buffer
+    //!
+    bool decodeFrame (CrpiTactileFrame &frame);
+
+    CrpiTactileConfig config_;
+    void *serial_;
+    void *task_;
+    std::atomic<bool> running_;
+    std::atomic<int> threshold_;
+
+    //! @brief Received bytes, how many of them the current packet takes, and its payload size
+    //!        (the payload starts at rx_ + 6)
+    //!
+    unsigned char rx_[4096];
+    int held_;
+    int used_;
+    int size_;
+
+    //! @brief Counters, kept by the task and published to stats_
+    //!
+    CrpiTactileStats counters_;
+
+    crpi_double_buffer<CrpiTactileFrame> frame_;
+    crpi_seqlock<CrpiTactileContacts> latest_;
+    crpi_spsc_ring<CrpiTactileContacts, CRPI_TACTILE_RING> ring_;
+    crpi_seqlock<CrpiTactileStats> stats_;
+
+    CrpiTactileSensor (const CrpiTactileSensor &) = delete;
+    CrpiTactileSensor &operator= (const CrpiTactileSensor &) = delete;
+  }; // CrpiTactileSensor
+} // crpi_robot
+
+#endif
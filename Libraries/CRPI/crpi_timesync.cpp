@@ -0,0 +1,328 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_timesync.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Clock offset and drift estimation definitions.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_timesync.h"
+#include <math.h>
+#include <vector>
+
+using namespace std;
+
+namespace crpi_robot
+{
+  //! @brief The best sample of a block:  source time, local estimate, and cost (delay for
+  //!        one-way stamps, round trip for probes)
+  //!
+  struct timeSyncBlock
+  {
+    double source;
+    double local;
+    double cost;
+  };
+
+  //! @brief Named sources.  Created on first use so that drivers set up during static
+  //!        initialization find it ready.
+  //!
+  struct timeSyncRegistry
+  {
+    vector<CrpiTimeSync*> sources;
+    void *lock;
+
+    timeSyncRegistry () :
+      lock(ulapi_fastlock_new())
+    {
+    }
+  };
+
+  static timeSyncRegistry &timeSyncSources ()
+  {
+    static timeSyncRegistry registry;
+    return registry;
+  }
+
+
+  LIBRARY_API CrpiTimeSync::CrpiTimeSync (const char *name) :
+    name_((name == NULL) ? "" : name),
+    blocks_(new timeSyncBlock[TIMESYNC_BLOCKS]),
+    offsetMetric_(NULL),
+    driftMetric_(NULL),
+    uncertaintyMetric_(NULL)
+  {
+    Reset();
+
+    if (!name_.empty())
+    {
+      timeSyncRegistry &reg = timeSyncSources();
+      ulapi_fastlock_take(reg.lock);
+      reg.sources.push_back(this);
+      ulapi_fastlock_give(reg.lock);
+
+      string labels = CrpiMetrics::Label("source", name_.c_str());
+      offsetMetric_ = CrpiMetrics::Gauge("crpi_clock_offset_seconds",
+                                         "Offset of the host clock from a source's clock", labels);
+      driftMetric_ = CrpiMetrics::Gauge("crpi_clock_drift_ppm",
+                                        "Rate error of a source's clock", labels);
+      uncertaintyMetric_ = CrpiMetrics::Gauge("crpi_clock_uncertainty_seconds",
+                                              "Estimated error of times mapped from a source's clock",
+                                              labels);
+    }
+  }
+
+
+  LIBRARY_API CrpiTimeSync::~CrpiTimeSync ()
+  {
+    if (!name_.empty())
+    {
+      timeSyncRegistry &reg = timeSyncSources();
+      ulapi_fastlock_take(reg.lock);
+      for (vector<CrpiTimeSync*>::iterator iter = reg.sources.begin(); iter != reg.sources.end(); ++iter)
+      {
+        if (*iter == this)
+        {
+          reg.sources.erase(iter);
+          break;
+        }
+      }
+      ulapi_fastlock_give(reg.lock);
+    }
+    delete [] blocks_;
+  }
+
+
+  LIBRARY_API void CrpiTimeSync::AddOneWay (double source, double received)
+  {
+    //! The delay includes the offset, but the offset barely changes within a block, so the
+    //! least of them is still the least delayed sample
+    add(source, received, received - source, false);
+  }
+
+
+  LIBRARY_API void CrpiTimeSync::AddRoundTrip (double sent, double source, double received)
+  {
+    if (received < sent)
+    {
+      return;
+    }
+    add(source, 0.5 * (sent + received), received - sent, true);
+  }
+
+
+  LIBRARY_API bool CrpiTimeSync::Synced () const
+  {
+    CrpiClockFit fit;
+    fit_.read(fit);
+    return fit.samples >= TIMESYNC_MIN_SAMPLES;
+  }
+
+
+  LIBRARY_API double CrpiTimeSync::ToLocal (double source) const
+  {
+    CrpiClockFit fit;
+    fit_.read(fit);
+    if (fit.samples < TIMESYNC_MIN_SAMPLES)
+    {
+      return source;
+    }
+    return fit.local0 + (fit.rate * (source - fit.source0));
+  }
+
+
+  LIBRARY_API double CrpiTimeSync::ToSource (double local) const
+  {
+    CrpiClockFit fit;
+    fit_.read(fit);
+    if (fit.samples < TIMESYNC_MIN_SAMPLES)
+    {
+      return local;
+    }
+    return fit.source0 + ((local - fit.local0) / fit.rate);
+  }
+
+
+  LIBRARY_API double CrpiTimeSync::Offset () const
+  {
+    double now = ulapi_time();
+    return now - ToSource(now);
+  }
+
+
+  LIBRARY_API double CrpiTimeSync::Drift () const
+  {
+    CrpiClockFit fit;
+    fit_.read(fit);
+    return (fit.rate - 1.0) * 1.0e6;
+  }
+
+
+  LIBRARY_API double CrpiTimeSync::Uncertainty () const
+  {
+    CrpiClockFit fit;
+    fit_.read(fit);
+    return fit.uncertainty;
+  }
+
+
+  LIBRARY_API void CrpiTimeSync::GetFit (CrpiClockFit &fit) const
+  {
+    fit_.read(fit);
+  }
+
+
+  LIBRARY_API void CrpiTimeSync::Reset ()
+  {
+    CrpiClockFit empty;
+
+    newest_ = TIMESYNC_BLOCKS - 1;
+    used_ = 0;
+    blockEnd_ = 0.0;
+    probes_ = false;
+    lastSource_ = lastLocal_ = 0.0;
+    samples_ = 0;
+    fit_.write(empty);
+  }
+
+
+  LIBRARY_API const char *CrpiTimeSync::Name () const
+  {
+    return name_.c_str();
+  }
+
+
+  LIBRARY_API CrpiTimeSync *CrpiTimeSync::Find (const char *name)
+  {
+    timeSyncRegistry &reg = timeSyncSources();
+    CrpiTimeSync *found = NULL;
+
+    if (name == NULL)
+    {
+      return NULL;
+    }
+    ulapi_fastlock_take(reg.lock);
+    for (size_t i = 0; i < reg.sources.size(); ++i)
+    {
+      if (reg.sources[i]->name_ == name)
+      {
+        found = reg.sources[i];
+        break;
+      }
+    }
+    ulapi_fastlock_give(reg.lock);
+    return found;
+  }
+
+
+  void CrpiTimeSync::add (double source, double local, double cost, bool probe)
+  {
+    timeSyncBlock *block;
+
+    if (samples_ > 0)
+    {
+      //! A source clock that went backwards, or moved much more or less than ours, was
+      //! restarted or stepped; the old samples no longer describe it.  Mixing one-way and
+      //! probe samples would compare delays with round trips.
+      double advance = source - lastSource_;
+      if (advance < 0.0 || fabs(advance - (local - lastLocal_)) > TIMESYNC_STEP || probe != probes_)
+      {
+        Reset();
+      }
+    }
+    probes_ = probe;
+    lastSource_ = source;
+    lastLocal_ = local;
+    ++samples_;
+
+    block = &blocks_[newest_];
+    if (used_ == 0 || source >= blockEnd_)
+    {
+      newest_ = (newest_ + 1) & (TIMESYNC_BLOCKS - 1);
+      used_ = (used_ < TIMESYNC_BLOCKS) ? (used_ + 1) : used_;
+      blockEnd_ = source + TIMESYNC_BLOCK;
+      block = &blocks_[newest_];
+    }
+    else if (cost >= block->cost)
+    {
+      //! No better than the block's best.  The fit only changes while the source is still
+      //! being synchronized.
+      if (samples_ <= TIMESYNC_MIN_SAMPLES)
+      {
+        refit();
+      }
+      return;
+    }
+    block->source = source;
+    block->local = local;
+    block->cost = cost;
+    refit();
+  }
+
+
+  void CrpiTimeSync::refit ()
+  {
+    CrpiClockFit fit;
+    double meanSource = 0.0, meanOffset = 0.0, sxx = 0.0, sxy = 0.0, slope = 0.0;
+    double residual, rms = 0.0, best;
+    double maxSlope = TIMESYNC_MAX_DRIFT * 1.0e-6;
+    int i, k;
+
+    //! Fit offset = local - source against source time, centred on the mean source time so
+    //! that the large absolute times cancel before they are multiplied
+    for (i = 0; i < used_; ++i)
+    {
+      k = (newest_ - i) & (TIMESYNC_BLOCKS - 1);
+      meanSource += blocks_[k].source;
+      meanOffset += blocks_[k].local - blocks_[k].source;
+    }
+    meanSource /= used_;
+    meanOffset /= used_;
+
+    //! Drift is only fitted across a few blocks; over less time, the jitter left in the block
+    //! minima would dominate it
+    if (used_ >= 4)
+    {
+      for (i = 0; i < used_; ++i)
+      {
+        k = (newest_ - i) & (TIMESYNC_BLOCKS - 1);
+        double x = blocks_[k].source - meanSource;
+        sxx += x * x;
+        sxy += x * ((blocks_[k].local - blocks_[k].source) - meanOffset);
+      }
+      slope = (sxx > 0.0) ? (sxy / sxx) : 0.0;
+      slope = (slope > maxSlope) ? maxSlope : ((slope < -maxSlope) ? -maxSlope : slope);
+    }
+
+    best = blocks_[newest_].cost;
+    for (i = 0; i < used_; ++i)
+    {
+      k = (newest_ - i) & (TIMESYNC_BLOCKS - 1);
+      residual = (blocks_[k].local - blocks_[k].source) - (meanOffset + (slope * (blocks_[k].source - meanSource)));
+      rms += residual * residual;
+      best = (blocks_[k].cost < best) ? blocks_[k].cost : best;
+    }
+    rms = sqrt(rms / used_);
+
+    fit.source0 = meanSource;
+    fit.local0 = meanSource + meanOffset;
+    fit.rate = 1.0 + slope;
+    //! A probe's midpoint is off by at most half its round trip
+    fit.uncertainty = rms + (probes_ ? (0.5 * best) : 0.0);
+    fit.samples = samples_;
+    fit_.write(fit);
+
+    if (offsetMetric_ != NULL)
+    {
+      offsetMetric_->Set(fit.local0 - fit.source0);
+      driftMetric_->Set(slope * 1.0e6);
+      uncertaintyMetric_->Set(fit.uncertainty);
+    }
+  }
+} // crpi_robot
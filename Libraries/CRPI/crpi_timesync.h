@@ -0,0 +1,229 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_timesync.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Clock offset and drift estimation for robot controllers and sensors.
+//
+//  Every controller and tracker keeps its own clock.  Stamping data with
+//  ulapi_time when it arrives ties it to the host's monotonic clock, but
+//  adds the network and scheduling jitter of every packet.  A CrpiTimeSync
+//  follows one data source's clock instead, from the source's own time
+//  stamps (e.g., the UR's Time field) or from request/response probes, and
+//  maps source times onto the ulapi_time clock, so the data of every source
+//  can be fused and logged on one timebase.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_timesync_H
+#define crpi_timesync_H
+
+#include "crpi.h"
+#include "crpi_metrics.h"
+#include <string>
+
+//! @brief Source time (s) covered by each block of samples; the sample with the least delay in
+//!        each block is kept
+//!
+#define TIMESYNC_BLOCK 1.0
+
+//! @brief Blocks fitted (a power of 2), so drift is estimated over the last minute or so
+//!
+#define TIMESYNC_BLOCKS 64
+
+//! @brief Samples before a source counts as synchronized
+//!
+#define TIMESYNC_MIN_SAMPLES 16
+
+//! @brief Largest drift (ppm) believed; crystal oscillators are within about 100 ppm
+//!
+#define TIMESYNC_MAX_DRIFT 500.0
+
+//! @brief Disagreement (s) between the source's clock and the host's after which the source is
+//!        taken to have restarted (or stepped its clock), and the estimate starts over
+//!
+#define TIMESYNC_STEP 1.0
+
+namespace crpi_robot
+{
+  //! @brief A fitted clock mapping:  local = local0 + rate * (source - source0)
+  //!
+  struct CrpiClockFit
+  {
+    //! @brief Reference points of the fit on the source and local (ulapi_time) clocks
+    //!
+    double source0;
+    double local0;
+
+    //! @brief Local seconds per source second (1 + drift)
+    //!
+    double rate;
+
+    //! @brief Estimated error (s) of a mapped time
+    //!
+    double uncertainty;
+
+    //! @brief Samples taken since the estimate (re)started
+    //!
+    unsigned long samples;
+
+    CrpiClockFit () :
+      source0(0.0),
+      local0(0.0),
+      rate(1.0),
+      uncertainty(0.0),
+      samples(0)
+    {
+    }
+  };
+
+  //! @brief Best sample of one block (crpi_timesync.cpp)
+  //!
+  struct timeSyncBlock;
+
+  //! @ingroup Robot
+  //!
+  //! @brief Estimates the offset and drift of one data source's clock relative to ulapi_time.
+  //!        Samples come either from time stamps the source embeds in its data (AddOneWay), or
+  //!        from probes that note when a request left and its response arrived (AddRoundTrip,
+  //!        as in NTP).  In each TIMESYNC_BLOCK of source time only the sample with the least
+  //!        delay (or, for probes, the shortest round trip) is kept, since delay only ever adds
+  //!        to the true offset, and a line is fitted through the last TIMESYNC_BLOCKS of those.
+  //!
+  //!        With one-way stamps the mapped time is when the data would have arrived with the
+  //!        least delay seen:  the jitter is removed, but the fixed part of the transport delay
+  //!        cannot be told apart from the offset.  Probes measure it (assuming the two
+  //!        directions take equally long).
+  //!
+  //!        Sources are named (e.g., "universal/192.168.1.10") and can be looked up by name, so
+  //!        that fusion and logging code can map the times of any source.  Samples are added by
+  //!        one thread (the source's receive thread); the estimate is read from any thread
+  //!        without locking.
+  //!
+  class LIBRARY_API CrpiTimeSync
+  {
+  public:
+    //! @brief Default constructor
+    //!
+    //! @param name Name of the data source, unique in the process (NULL or empty for a source
+    //!             that is not registered); also labels the source's metrics
+    //!
+    CrpiTimeSync (const char *name = NULL);
+
+    //! @brief Default destructor
+    //!
+    ~CrpiTimeSync ();
+
+    //! @brief Add a sample from a time stamp embedded in the source's data
+    //!
+    //! @param source   The source's time stamp (s, on its own clock)
+    //! @param received When the data arrived (s, ulapi_time; e.g., a kernel receive stamp)
+    //!
+    void AddOneWay (double source, double received);
+
+    //! @brief Add a sample from a probe
+    //!
+    //! @param sent     When the request was sent (s, ulapi_time)
+    //! @param source   The source's time stamp in the response (s, on its own clock)
+    //! @param received When the response arrived (s, ulapi_time)
+    //!
+    void AddRoundTrip (double sent, double source, double received);
+
+    //! @brief Whether enough samples have been taken to map times
+    //!
+    bool Synced () const;
+
+    //! @brief Map a source time onto the ulapi_time clock
+    //!
+    //! @param source A time on the source's clock
+    //!
+    //! @return The same instant on the ulapi_time clock (the source time itself if not synced)
+    //!
+    double ToLocal (double source) const;
+
+    //! @brief Map a ulapi_time onto the source's clock (the inverse of ToLocal)
+    //!
+    double ToSource (double local) const;
+
+    //! @brief Current offset (s) of the local clock from the source's (local - source)
+    //!
+    double Offset () const;
+
+    //! @brief Rate error (ppm) of the source's clock:  positive if it runs slow
+    //!
+    double Drift () const;
+
+    //! @brief Estimated error (s) of a mapped time
+    //!
+    double Uncertainty () const;
+
+    //! @brief Copy the current fit
+    //!
+    void GetFit (CrpiClockFit &fit) const;
+
+    //! @brief Discard every sample (e.g., when the source was replaced).  Called from the
+    //!        thread that adds samples.
+    //!
+    void Reset ();
+
+    //! @brief Name of the source (empty if none)
+    //!
+    const char *Name () const;
+
+    //! @brief Look up a registered source
+    //!
+    //! @param name The source's name
+    //!
+    //! @return The source, or NULL if none has that name
+    //!
+    static CrpiTimeSync *Find (const char *name);
+
+  private:
+
+    std::string name_;
+
+    //! @brief Kept samples (written by the sampling thread only):  a ring of TIMESYNC_BLOCKS
+    //!        blocks, the newest of which is still open
+    //!
+    timeSyncBlock *blocks_;
+    int newest_;
+    int used_;
+    double blockEnd_;
+
+    //! @brief Whether the samples are probes, and the last sample's times (to notice steps)
+    //!
+    bool probes_;
+    double lastSource_;
+    double lastLocal_;
+    unsigned long samples_;
+
+    //! @brief The published estimate
+    //!
+    crpi_seqlock<CrpiClockFit> fit_;
+
+    //! @brief Metrics labelled with the source's name (NULL if unnamed)
+    //!
+    CrpiGauge *offsetMetric_;
+    CrpiGauge *driftMetric_;
+    CrpiGauge *uncertaintyMetric_;
+
+    //! @brief Add a sample:  the source time, its local estimate, and its cost (delay or round
+    //!        trip; smaller is better)
+    //!
+    void add (double source, double local, double cost, bool probe);
+
+    //! @brief Fit the kept samples and publish the estimate
+    //!
+    void refit ();
+
+    CrpiTimeSync (const CrpiTimeSync &) = delete;
+    CrpiTimeSync &operator= (const CrpiTimeSync &) = delete;
+  }; // CrpiTimeSync
+} // crpi_robot
+
+#endif
@@ -0,0 +1,393 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_trace.cpp
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Per-command tracing and latency counters.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_trace.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace crpi_robot
+{
+  //! @brief One recorded span.  The writer marks the slot odd while filling it and stamps it
+  //!        with 2 * (index + 1) when done, so readers can tell a finished span from one being
+  //!        overwritten.  The fields are relaxed atomics so that a reader racing the writer
+  //!        is well defined; the sequence check discards what it read.
+  //!
+  struct traceSlot
+  {
+    std::atomic<unsigned long long> seq;
+    std::atomic<const char*> name;
+    std::atomic<const char*> category;
+    std::atomic<double> start;
+    std::atomic<double> end;
+    std::atomic<int> result;
+  };
+
+  //! @brief Ring of spans written by one thread at a time.  Buffers are never freed; when a
+  //!        thread exits its buffer is handed to the next thread that traces.
+  //!
+  struct traceBuffer
+  {
+    traceSlot slots[CRPI_TRACE_EVENTS];
+
+    //! @brief Spans written since the buffer was created, and the first of them to export
+    //!
+    std::atomic<unsigned long long> head;
+    std::atomic<unsigned long long> floor;
+
+    //! @brief Whether a thread is writing to the buffer, and the id of the last one that did
+    //!
+    std::atomic<bool> owned;
+    std::atomic<unsigned int> tid;
+
+    traceBuffer *next;
+  };
+
+  //! @brief Counter of one span name
+  //!
+  struct traceCount
+  {
+    std::atomic<const char*> name;
+    std::atomic<const char*> category;
+    std::atomic<unsigned long long> calls;
+    std::atomic<unsigned long long> failures;
+    std::atomic<unsigned long long> totalNs;
+    std::atomic<unsigned long long> maxNs;
+  };
+
+  static std::atomic<traceBuffer*> traceBuffers(NULL);
+  static std::atomic<unsigned int> traceThreads(0);
+  static traceCount traceCounts[CRPI_TRACE_COUNTERS];
+
+  std::atomic<bool> CrpiTrace::enabled_(false);
+
+  //! @brief Releases the calling thread's buffer when the thread exits
+  //!
+  struct traceOwner
+  {
+    traceBuffer *buffer;
+
+    traceOwner () :
+      buffer(NULL)
+    {
+    }
+
+    ~traceOwner ()
+    {
+      if (buffer != NULL)
+      {
+        buffer->owned.store(false, std::memory_order_release);
+      }
+    }
+  };
+
+  static thread_local traceOwner traceLocal;
+
+
+  //! @brief The calling thread's buffer:  an unowned one if there is one, otherwise a new one
+  //!        pushed onto the list
+  //!
+  static traceBuffer *traceAcquire ()
+  {
+    traceBuffer *buf;
+    for (buf = traceBuffers.load(std::memory_order_acquire); buf != NULL; buf = buf->next)
+    {
+      bool expected = false;
+      if (!buf->owned.load(std::memory_order_relaxed) &&
+          buf->owned.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+      {
+        buf->tid.store(traceThreads.fetch_add(1) + 1, std::memory_order_relaxed);
+        return buf;
+      }
+    }
+
+    buf = new traceBuffer();
+    for (int i = 0; i < CRPI_TRACE_EVENTS; ++i)
+    {
+      buf->slots[i].seq.store(0, std::memory_order_relaxed);
+    }
+    buf->head.store(0, std::memory_order_relaxed);
+    buf->floor.store(0, std::memory_order_relaxed);
+    buf->owned.store(true, std::memory_order_relaxed);
+    buf->tid.store(traceThreads.fetch_add(1) + 1, std::memory_order_relaxed);
+    buf->next = traceBuffers.load(std::memory_order_relaxed);
+    while (!traceBuffers.compare_exchange_weak(buf->next, buf, std::memory_order_acq_rel))
+    {
+    }
+    return buf;
+  }
+
+
+  //! @brief The counter of a span name, claiming a free entry for a new name
+  //!
+  //! @return The counter, or NULL if the table is full
+  //!
+  static traceCount *traceCounter (const char *name, const char *category)
+  {
+    //! Literals with the same text may have different addresses in different modules, so
+    //! names are hashed and compared by value
+    unsigned int h = 2166136261u;
+    for (const char *c = name; *c != '\0'; ++c)
+    {
+      h = (h ^ (unsigned char)*c) * 16777619u;
+    }
+
+    for (int probe = 0; probe < CRPI_TRACE_COUNTERS; ++probe)
+    {
+      traceCount &tc = traceCounts[(h + probe) % CRPI_TRACE_COUNTERS];
+      const char *stored = tc.name.load(std::memory_order_acquire);
+      if (stored == NULL)
+      {
+        if (tc.name.compare_exchange_strong(stored, name, std::memory_order_acq_rel))
+        {
+          tc.category.store(category, std::memory_order_release);
+          return &tc;
+        }
+        //! Another thread claimed it first; stored now holds its name
+      }
+      if (stored == name || strcmp(stored, name) == 0)
+      {
+        return &tc;
+      }
+    }
+    return NULL;
+  }
+
+
+  LIBRARY_API void CrpiTrace::Enable (bool on)
+  {
+    enabled_.store(on, std::memory_order_relaxed);
+  }
+
+
+  LIBRARY_API void CrpiTrace::Record (const char *name, const char *category, double start, double end,
+                                      CanonReturn result)
+  {
+    if (traceLocal.buffer == NULL)
+    {
+      traceLocal.buffer = traceAcquire();
+    }
+    traceBuffer *buf = traceLocal.buffer;
+
+    unsigned long long index = buf->head.load(std::memory_order_relaxed);
+    traceSlot &slot = buf->slots[index % CRPI_TRACE_EVENTS];
+    slot.seq.store((2 * index) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.category.store(category, std::memory_order_relaxed);
+    slot.start.store(start, std::memory_order_relaxed);
+    slot.end.store(end, std::memory_order_relaxed);
+    slot.result.store((int)result, std::memory_order_relaxed);
+    slot.seq.store(2 * (index + 1), std::memory_order_release);
+    buf->head.store(index + 1, std::memory_order_release);
+
+    traceCount *tc = traceCounter(name, category);
+    if (tc != NULL)
+    {
+      unsigned long long ns = (end > start) ? (unsigned long long)((end - start) * 1e9) : 0;
+      unsigned long long longest = tc->maxNs.load(std::memory_order_relaxed);
+      tc->calls.fetch_add(1, std::memory_order_relaxed);
+      tc->totalNs.fetch_add(ns, std::memory_order_relaxed);
+      if (result != CANON_SUCCESS)
+      {
+        tc->failures.fetch_add(1, std::memory_order_relaxed);
+      }
+      while (ns > longest && !tc->maxNs.compare_exchange_weak(longest, ns, std::memory_order_relaxed))
+      {
+      }
+    }
+  }
+
+
+  //! @brief A span copied out of a buffer
+  //!
+  struct traceCopy
+  {
+    const char *name;
+    const char *category;
+    double start;
+    double end;
+    CanonReturn result;
+  };
+
+
+  //! @brief Copy the finished spans of a buffer that have not been overwritten
+  //!
+  static void traceCollect (traceBuffer *buf, vector<traceCopy> &out)
+  {
+    unsigned long long head = buf->head.load(std::memory_order_acquire);
+    unsigned long long first = buf->floor.load(std::memory_order_relaxed);
+    first = (head > CRPI_TRACE_EVENTS && head - CRPI_TRACE_EVENTS > first) ? (head - CRPI_TRACE_EVENTS) : first;
+
+    for (unsigned long long i = first; i < head; ++i)
+    {
+      traceSlot &slot = buf->slots[i % CRPI_TRACE_EVENTS];
+      traceCopy copy;
+      if (slot.seq.load(std::memory_order_acquire) != 2 * (i + 1))
+      {
+        continue;
+      }
+      copy.name = slot.name.load(std::memory_order_relaxed);
+      copy.category = slot.category.load(std::memory_order_relaxed);
+      copy.start = slot.start.load(std::memory_order_relaxed);
+      copy.end = slot.end.load(std::memory_order_relaxed);
+      copy.result = (CanonReturn)slot.result.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.seq.load(std::memory_order_relaxed) == 2 * (i + 1))
+      {
+        out.push_back(copy);
+      }
+    }
+  }
+
+
+  static const char *traceResult (CanonReturn result)
+  {
+    switch (result)
+    {
+    case CANON_SUCCESS:
+      return "success";
+    case CANON_FAILURE:
+      return "failure";
+    case CANON_REJECT:
+      return "reject";
+    case CANON_RUNNING:
+      return "running";
+    default:
+      return "unknown";
+    }
+  }
+
+
+  LIBRARY_API bool CrpiTrace::ExportChrome (const char *path)
+  {
+    vector<vector<traceCopy> > threads;
+    vector<unsigned int> tids;
+    double epoch = -1.0;
+    bool first = true;
+    size_t t, i;
+
+    for (traceBuffer *buf = traceBuffers.load(std::memory_order_acquire); buf != NULL; buf = buf->next)
+    {
+      threads.push_back(vector<traceCopy>());
+      tids.push_back(buf->tid.load(std::memory_order_relaxed));
+      traceCollect(buf, threads.back());
+      for (i = 0; i < threads.back().size(); ++i)
+      {
+        epoch = (epoch < 0.0 || threads.back()[i].start < epoch) ? threads.back()[i].start : epoch;
+      }
+    }
+
+    FILE *out = fopen(path, "w");
+    if (out == NULL)
+    {
+      return false;
+    }
+
+    //! Complete ("X") events in microseconds from the earliest span, one track per thread
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (t = 0; t < threads.size(); ++t)
+    {
+      fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"CRPI thread %u\"}}",
+              first ? "" : ",\n", tids[t], tids[t]);
+      first = false;
+      for (i = 0; i < threads[t].size(); ++i)
+      {
+        const traceCopy &c = threads[t][i];
+        fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u,"
+                "\"args\":{\"result\":\"%s\"}}", c.name, (c.category == NULL) ? "" : c.category,
+                (c.start - epoch) * 1e6, (c.end - c.start) * 1e6, tids[t], traceResult(c.result));
+      }
+    }
+    fprintf(out, "\n]}\n");
+    fclose(out);
+    return true;
+  }
+
+
+  LIBRARY_API int CrpiTrace::Counters (CrpiTraceCounter *out, int max)
+  {
+    int count = 0;
+    for (int i = 0; i < CRPI_TRACE_COUNTERS && count < max; ++i)
+    {
+      const char *name = traceCounts[i].name.load(std::memory_order_acquire);
+      if (name == NULL)
+      {
+        continue;
+      }
+      out[count].name = name;
+      out[count].category = traceCounts[i].category.load(std::memory_order_acquire);
+      out[count].calls = traceCounts[i].calls.load(std::memory_order_relaxed);
+      out[count].failures = traceCounts[i].failures.load(std::memory_order_relaxed);
+      out[count].total = 1e-9 * (double)traceCounts[i].totalNs.load(std::memory_order_relaxed);
+      out[count].max = 1e-9 * (double)traceCounts[i].maxNs.load(std::memory_order_relaxed);
+      ++count;
+    }
+    return count;
+  }
+
+
+  LIBRARY_API void CrpiTrace::Reset ()
+  {
+    for (traceBuffer *buf = traceBuffers.load(std::memory_order_acquire); buf != NULL; buf = buf->next)
+    {
+      buf->floor.store(buf->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+    for (int i = 0; i < CRPI_TRACE_COUNTERS; ++i)
+    {
+      traceCounts[i].calls.store(0, std::memory_order_relaxed);
+      traceCounts[i].failures.store(0, std::memory_order_relaxed);
+      traceCounts[i].totalNs.store(0, std::memory_order_relaxed);
+      traceCounts[i].maxNs.store(0, std::memory_order_relaxed);
+    }
+  }
+
+
+  //! @brief File named by CRPI_TRACE, written at exit
+  //!
+  static string traceExitPath;
+
+  static void traceAtExit ()
+  {
+    if (!traceExitPath.empty())
+    {
+      CrpiTrace::ExportChrome(traceExitPath.c_str());
+    }
+  }
+
+  //! @brief Reads CRPI_TRACE when the library is loaded
+  //!
+  struct traceEnvironment
+  {
+    traceEnvironment ()
+    {
+      const char *setting = getenv("CRPI_TRACE");
+      if (setting == NULL || setting[0] == '\0' || strcmp(setting, "0") == 0)
+      {
+        return;
+      }
+      CrpiTrace::Enable(true);
+      if (strcmp(setting, "1") != 0)
+      {
+        traceExitPath = setting;
+        atexit(traceAtExit);
+      }
+    }
+  };
+
+  static traceEnvironment traceStartup;
+} // namespace crpi_robot
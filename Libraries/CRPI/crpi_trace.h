@@ -0,0 +1,192 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_trace.h
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Per-command tracing and latency counters for CrpiRobot and the drivers.
+//
+//  Every public CrpiRobot command, and the generate/send/wait steps of the
+//  socket drivers, is bracketed by a CrpiTraceSpan.  While tracing is off a
+//  span costs one relaxed load.  While it is on, each span is written to a
+//  ring owned by the calling thread (no locks, no allocation after the
+//  thread's first span) and folded into process-wide counters.  Traces are
+//  exported in the Chrome trace event format, which chrome://tracing and
+//  Perfetto (ui.perfetto.dev) open directly.
+//
+//  Tracing can be turned on without recompiling by setting CRPI_TRACE in the
+//  environment:  "1" enables it, and any other value also names the file the
+//  trace is written to when the process exits.
+//
+//  While CrpiRecorder is recording, spans of the "command" category are also
+//  written to the recording, whether or not tracing is on.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_trace_H
+#define crpi_trace_H
+
+#include "crpi.h"
+#include "crpi_recorder.h"
+#include <string.h>
+#include <atomic>
+
+//! @brief Spans kept per thread (older spans are overwritten) and distinct span names counted
+//!
+#define CRPI_TRACE_EVENTS 8192
+#define CRPI_TRACE_COUNTERS 256
+
+//! @brief Span categories:  public commands, commands dispatched from XML or binary frames, and
+//!        the drivers' message generation, socket writes, and waits for replies or motion
+//!
+#define CRPI_TRACE_COMMAND "command"
+#define CRPI_TRACE_DISPATCH "dispatch"
+#define CRPI_TRACE_GENERATE "generate"
+#define CRPI_TRACE_SEND "send"
+#define CRPI_TRACE_WAIT "wait"
+
+namespace crpi_robot
+{
+  //! @brief Accumulated latency of one span name
+  //!
+  struct CrpiTraceCounter
+  {
+    //! @brief Span name and category
+    //!
+    const char *name;
+    const char *category;
+
+    //! @brief Spans recorded, and how many of them did not succeed
+    //!
+    unsigned long long calls;
+    unsigned long long failures;
+
+    //! @brief Total and longest duration (s)
+    //!
+    double total;
+    double max;
+  };
+
+  //! @ingroup Robot
+  //!
+  //! @brief Process-wide trace control and export
+  //!
+  //! @note Span names and categories must be string literals (or otherwise outlive the
+  //!       process's tracing):  only their addresses are stored.
+  //!
+  class LIBRARY_API CrpiTrace
+  {
+  public:
+    //! @brief Turn tracing on or off.  Spans already recorded are kept.
+    //!
+    static void Enable (bool on);
+
+    //! @brief Whether tracing is on
+    //!
+    static bool Enabled ()
+    {
+      return enabled_.load(std::memory_order_relaxed);
+    }
+
+    //! @brief Record a finished span on the calling thread
+    //!
+    //! @param name     What was timed (e.g., "MoveTo")
+    //! @param category One of the CRPI_TRACE_* categories
+    //! @param start    Start time (s, ulapi_time)
+    //! @param end      End time (s, ulapi_time)
+    //! @param result   Outcome of the span
+    //!
+    static void Record (const char *name, const char *category, double start, double end,
+                        CanonReturn result);
+
+    //! @brief Write every thread's recorded spans to a Chrome trace event file
+    //!
+    //! @return True if the file was written
+    //!
+    static bool ExportChrome (const char *path);
+
+    //! @brief Copy the counters
+    //!
+    //! @param out Up to max counters, populated by this function
+    //! @param max Size of out
+    //!
+    //! @return The number of counters copied
+    //!
+    static int Counters (CrpiTraceCounter *out, int max);
+
+    //! @brief Discard the recorded spans and zero the counters.  Spans being recorded by
+    //!        other threads at the same time may survive.
+    //!
+    static void Reset ();
+
+  private:
+    static std::atomic<bool> enabled_;
+  }; // CrpiTrace
+
+
+  //! @brief Times a scope as a span.  Nothing is timed if neither tracing nor the recorder was
+  //!        on when the span began.
+  //!
+  //! @note Spans that end with a return value report it with End; others report success.
+  //!
+  class CrpiTraceSpan
+  {
+  public:
+    CrpiTraceSpan (const char *name, const char *category = CRPI_TRACE_COMMAND) :
+      name_(name),
+      category_(category),
+      start_((CrpiTrace::Enabled() || CrpiRecorder::Recording()) ? ulapi_time() : -1.0),
+      result_(CANON_SUCCESS)
+    {
+    }
+
+    ~CrpiTraceSpan ()
+    {
+      if (start_ >= 0.0)
+      {
+        double end = ulapi_time();
+        if (CrpiTrace::Enabled())
+        {
+          CrpiTrace::Record(name_, category_, start_, end, result_);
+        }
+        if (CrpiRecorder::Recording() && strcmp(category_, CRPI_TRACE_COMMAND) == 0)
+        {
+          CrpiRecorder::RecordCommand(name_, start_, end, result_);
+        }
+      }
+    }
+
+    //! @brief Set the span's result
+    //!
+    //! @return The result, so that "return span.End(val);" ends a command
+    //!
+    CanonReturn End (CanonReturn result)
+    {
+      result_ = result;
+      return result;
+    }
+
+    //! @brief Set the span's result from a driver step's success
+    //!
+    bool End (bool ok)
+    {
+      result_ = (ok ? CANON_SUCCESS : CANON_FAILURE);
+      return ok;
+    }
+
+  private:
+    CrpiTraceSpan (const CrpiTraceSpan &);
+    CrpiTraceSpan &operator= (const CrpiTraceSpan &);
+
+    const char *name_;
+    const char *category_;
+    double start_;
+    CanonReturn result_;
+  }; // CrpiTraceSpan
+} // namespace crpi_robot
+
+#endif
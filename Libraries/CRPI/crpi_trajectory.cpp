@@ -0,0 +1,588 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_trajectory.cpp
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Time-optimal parameterization of waypoint paths under per-axis velocity
+//  and acceleration limits, for streaming and blending motion in CRPI.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_trajectory.h"
+
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+//! @brief Lengths and derivatives below this are treated as zero
+//!
+#define TRAJ_EPS 1e-12
+#define TRAJ_PI 3.14159265358979323846
+
+//! @brief Largest turn (rad) between grid points on a blend arc
+//!
+#define TRAJ_ARC_STEP (TRAJ_PI / 90.0)
+
+namespace crpi_robot
+{
+  //! @brief A line (p + s u) or a circular arc (p + r (u cos (s / r) + y sin (s / r))), for s
+  //!        from 0 to length
+  //!
+  struct trajSegment
+  {
+    bool arc;
+    bool stopAfter;
+    double s0;
+    double length;
+    double radius;
+    double p[CRPI_AXES_MAX];
+    double u[CRPI_AXES_MAX];
+    double y[CRPI_AXES_MAX];
+  };
+
+
+  static double dot (const double *a, const double *b, int n)
+  {
+    double sum = 0.0;
+    for (int j = 0; j < n; ++j)
+    {
+      sum += a[j] * b[j];
+    }
+    return sum;
+  }
+
+
+  //! Unit vector from a to b into out, returning the distance
+  static double direction (const double *a, const double *b, double *out, int n)
+  {
+    int j;
+    for (j = 0; j < n; ++j)
+    {
+      out[j] = b[j] - a[j];
+    }
+    double len = sqrt(dot(out, out, n));
+    for (j = 0; j < n && len > TRAJ_EPS; ++j)
+    {
+      out[j] /= len;
+    }
+    return len;
+  }
+
+
+  LIBRARY_API CrpiTrajectory::CrpiTrajectory (int dims, const double *maxVel, const double *maxAcc) :
+    grid_(CRPI_TRAJ_GRID),
+    limited_(false),
+    length_(0.0)
+  {
+    dims_ = (dims < 1) ? 1 : ((dims > CRPI_AXES_MAX) ? CRPI_AXES_MAX : dims);
+    if (maxVel != NULL && maxAcc != NULL)
+    {
+      SetLimits(maxVel, maxAcc);
+    }
+  }
+
+
+  LIBRARY_API CrpiTrajectory::CrpiTrajectory (const CrpiRobotParams &params) :
+    grid_(CRPI_TRAJ_GRID),
+    limited_(false),
+    length_(0.0)
+  {
+    size_t n = (params.joint_max_vel.size() < params.joint_max_acc.size()) ?
+               params.joint_max_vel.size() : params.joint_max_acc.size();
+    dims_ = (n < 1) ? 1 : ((n > CRPI_AXES_MAX) ? CRPI_AXES_MAX : (int)n);
+    if (n > 0)
+    {
+      SetLimits(&params.joint_max_vel[0], &params.joint_max_acc[0]);
+    }
+  }
+
+
+  LIBRARY_API CrpiTrajectory::~CrpiTrajectory ()
+  {
+  }
+
+
+  LIBRARY_API bool CrpiTrajectory::SetLimits (const double *maxVel, const double *maxAcc)
+  {
+    for (int j = 0; j < dims_; ++j)
+    {
+      if (!(maxVel[j] > 0.0) || !(maxAcc[j] > 0.0))
+      {
+        return false;
+      }
+    }
+    for (int j = 0; j < dims_; ++j)
+    {
+      maxVel_[j] = maxVel[j];
+      maxAcc_[j] = maxAcc[j];
+    }
+    limited_ = true;
+    return true;
+  }
+
+
+  LIBRARY_API void CrpiTrajectory::SetGrid (int points)
+  {
+    grid_ = (points < 2) ? 2 : points;
+  }
+
+
+  LIBRARY_API int CrpiTrajectory::Dims () const
+  {
+    return dims_;
+  }
+
+
+  LIBRARY_API double CrpiTrajectory::Duration () const
+  {
+    return t_.empty() ? 0.0 : t_.back();
+  }
+
+
+  LIBRARY_API double CrpiTrajectory::Length () const
+  {
+    return length_;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiTrajectory::Plan (const robotAxes *waypoints, int count, double blend, double startSpeed)
+  {
+    if (waypoints == NULL || count < 2)
+    {
+      return CANON_REJECT;
+    }
+    flat_.resize((size_t)count * dims_);
+    for (int i = 0; i < count; ++i)
+    {
+      for (int j = 0; j < dims_; ++j)
+      {
+        flat_[(size_t)i * dims_ + j] = (j < waypoints[i].axes) ? waypoints[i].axis[j] : 0.0;
+      }
+    }
+    return Plan(&flat_[0], count, blend, startSpeed);
+  }
+
+
+  LIBRARY_API CanonReturn CrpiTrajectory::Plan (const double *waypoints, int count, double blend, double startSpeed)
+  {
+    double dq[CRPI_AXES_MAX], ddq[CRPI_AXES_MAX], q[CRPI_AXES_MAX], xm, lim, d, h, v0, v1;
+    int g, i, j, k, n, points;
+
+    t_.clear();
+    if (!limited_ || waypoints == NULL || count < 2 || !buildPath(waypoints, count, blend))
+    {
+      return CANON_REJECT;
+    }
+
+    //! Grid:  every segment gets points in proportion to its length, and its own first point,
+    //! so corners taken at rest fall on a grid point.  Arcs also get a point every TRAJ_ARC_STEP
+    //! of turn, since the direction of motion, and with it the limits, changes along them.
+    s_.clear();
+    seg_.clear();
+    xMax_.clear();
+    for (g = 0; g < (int)segs_.size(); ++g)
+    {
+      n = (int)ceil(grid_ * segs_[g].length / length_);
+      n = (n < 2) ? 2 : n;
+      if (segs_[g].arc)
+      {
+        k = (int)ceil(segs_[g].length / (segs_[g].radius * TRAJ_ARC_STEP));
+        n = (k > n) ? k : n;
+      }
+      for (k = 0; k < n; ++k)
+      {
+        s_.push_back(segs_[g].s0 + (segs_[g].length * k / n));
+        seg_.push_back(g);
+        xMax_.push_back((k == 0 && g > 0 && segs_[g - 1].stopAfter) ? 0.0 : DBL_MAX);
+      }
+    }
+    s_.push_back(length_);
+    seg_.push_back((int)segs_.size() - 1);
+    xMax_.push_back(0.0);
+    points = (int)s_.size();
+
+    //! Constraints at each point, from the segment that leaves it:  |dq u + ddq x| <= a bounds
+    //! u by two parallel lines in x, |dq| sqrt(x) <= v bounds x, and an axis that does not move
+    //! along the path but curves bounds x by a / |ddq|
+    lo0_.resize((size_t)points * dims_);
+    lo1_.resize((size_t)points * dims_);
+    up0_.resize((size_t)points * dims_);
+    up1_.resize((size_t)points * dims_);
+    active_.resize(points);
+    for (i = 0; i < points; ++i)
+    {
+      g = seg_[i];
+      geometry(g, s_[i] - segs_[g].s0, q, dq, ddq);
+      double *l0 = &lo0_[(size_t)i * dims_], *l1 = &lo1_[(size_t)i * dims_],
+             *u0 = &up0_[(size_t)i * dims_], *u1 = &up1_[(size_t)i * dims_];
+      xm = xMax_[i];
+      for (n = 0, j = 0; j < dims_; ++j)
+      {
+        if (fabs(dq[j]) > TRAJ_EPS)
+        {
+          lim = maxVel_[j] / dq[j];
+          xm = (lim * lim < xm) ? lim * lim : xm;
+          l0[n] = -maxAcc_[j] / fabs(dq[j]);
+          u0[n] = maxAcc_[j] / fabs(dq[j]);
+          l1[n] = u1[n] = -ddq[j] / dq[j];
+          ++n;
+        }
+        else if (fabs(ddq[j]) > TRAJ_EPS)
+        {
+          lim = maxAcc_[j] / fabs(ddq[j]);
+          xm = (lim < xm) ? lim : xm;
+        }
+      }
+      active_[i] = n;
+
+      //! Some u must lie between every lower and every upper line
+      for (j = 0; j < n; ++j)
+      {
+        for (k = 0; k < n; ++k)
+        {
+          d = l1[j] - u1[k];
+          if (d > TRAJ_EPS)
+          {
+            lim = (u0[k] - l0[j]) / d;
+            xm = (lim < xm) ? lim : xm;
+          }
+        }
+      }
+      xMax_[i] = xm;
+    }
+
+    //! Backward pass:  hi_[i] is the largest x at point i from which the end can still be
+    //! reached at rest.  Each condition is an upper bound on x, since x = 0 always has a way on.
+    hi_.resize(points);
+    hi_[points - 1] = 0.0;
+    for (i = points - 2; i >= 0; --i)
+    {
+      h = 2.0 * (s_[i + 1] - s_[i]);
+      const double *l0 = &lo0_[(size_t)i * dims_], *l1 = &lo1_[(size_t)i * dims_],
+                   *u0 = &up0_[(size_t)i * dims_], *u1 = &up1_[(size_t)i * dims_];
+      xm = xMax_[i];
+      for (j = 0; j < active_[i]; ++j)
+      {
+        //! The slowest allowed u still lands at or under hi_[i + 1]:  x + h lo (x) <= hi
+        d = 1.0 + (h * l1[j]);
+        if (d > TRAJ_EPS)
+        {
+          lim = (hi_[i + 1] - (h * l0[j])) / d;
+          xm = (lim < xm) ? lim : xm;
+        }
+        //! The fastest allowed u does not land below 0:  x + h up (x) >= 0
+        d = 1.0 + (h * u1[j]);
+        if (d < -TRAJ_EPS)
+        {
+          lim = (h * u0[j]) / -d;
+          xm = (lim < xm) ? lim : xm;
+        }
+      }
+      if (xm < 0.0)
+      {
+        return CANON_FAILURE;
+      }
+      hi_[i] = xm;
+    }
+
+    //! Forward pass:  the largest u that keeps the next point controllable
+    x_.resize(points);
+    u_.resize(points);
+    t_.resize(points);
+    x_[0] = (startSpeed * startSpeed < hi_[0]) ? startSpeed * startSpeed : hi_[0];
+    t_[0] = 0.0;
+    for (i = 0; i < points - 1; ++i)
+    {
+      h = 2.0 * (s_[i + 1] - s_[i]);
+      const double *u0 = &up0_[(size_t)i * dims_], *u1 = &up1_[(size_t)i * dims_];
+      d = (hi_[i + 1] - x_[i]) / h;
+      for (j = 0; j < active_[i]; ++j)
+      {
+        lim = u0[j] + (u1[j] * x_[i]);
+        d = (lim < d) ? lim : d;
+      }
+      x_[i + 1] = x_[i] + (h * d);
+      x_[i + 1] = (x_[i + 1] < 0.0) ? 0.0 : x_[i + 1];
+      v0 = sqrt(x_[i]);
+      v1 = sqrt(x_[i + 1]);
+      if (v0 + v1 <= TRAJ_EPS)
+      {
+        t_.clear();
+        return CANON_FAILURE;
+      }
+      //! Constant u over the stage, consistent with the speeds at both ends
+      u_[i] = (x_[i + 1] - x_[i]) / h;
+      t_[i + 1] = t_[i] + (h / (v0 + v1));
+    }
+    u_[points - 1] = 0.0;
+    return CANON_SUCCESS;
+  }
+
+
+  bool CrpiTrajectory::buildPath (const double *waypoints, int count, double blend)
+  {
+    double in[CRPI_AXES_MAX], out[CRPI_AXES_MAX], start[CRPI_AXES_MAX], dinc, dout, alpha, l, r,
+           cdir[CRPI_AXES_MAX], cn, cosHalf;
+    const double *prev, *cur, *next;
+    vector<int> &keep = keep_;
+    trajSegment seg;
+    int i, j;
+
+    //! Repeated waypoints add nothing
+    segs_.clear();
+    length_ = 0.0;
+    keep.clear();
+    keep.push_back(0);
+    for (i = 1; i < count; ++i)
+    {
+      if (direction(&waypoints[keep.back() * dims_], &waypoints[i * dims_], in, dims_) > TRAJ_EPS)
+      {
+        keep.push_back(i);
+      }
+    }
+    if (keep.size() < 2)
+    {
+      return false;
+    }
+
+    memcpy(start, &waypoints[0], sizeof(double) * dims_);
+    for (i = 1; i < (int)keep.size(); ++i)
+    {
+      prev = &waypoints[keep[i - 1] * dims_];
+      cur = &waypoints[keep[i] * dims_];
+      direction(prev, cur, in, dims_);
+      dinc = direction(start, cur, cdir, dims_);
+
+      seg.arc = false;
+      seg.stopAfter = true;
+      seg.radius = 0.0;
+      l = 0.0;
+      alpha = 0.0;
+      if (i + 1 < (int)keep.size())
+      {
+        next = &waypoints[keep[i + 1] * dims_];
+        dout = direction(cur, next, out, dims_);
+        cn = dot(in, out, dims_);
+        alpha = acos((cn > 1.0) ? 1.0 : ((cn < -1.0) ? -1.0 : cn));
+        if (alpha < 1e-9)
+        {
+          //! Straight on
+          seg.stopAfter = false;
+        }
+        else if (blend > 0.0 && alpha < TRAJ_PI - 1e-6)
+        {
+          //! Kunz and Stilman (2012):  the arc tangent to both lines, at most blend from the
+          //! corner, and using no more than half of either line
+          l = blend * sin(alpha / 2.0) / (1.0 - cos(alpha / 2.0));
+          l = (l < dinc) ? l : dinc;
+          l = (l < dout / 2.0) ? l : dout / 2.0;
+          seg.stopAfter = false;
+        }
+      }
+
+      //! The line up to the corner, or to where its blend starts
+      direction(start, cur, seg.u, dims_);
+      memcpy(seg.p, start, sizeof(double) * dims_);
+      seg.length = dinc - l;
+      if (seg.length > TRAJ_EPS)
+      {
+        seg.s0 = length_;
+        length_ += seg.length;
+        segs_.push_back(seg);
+      }
+      else if (!segs_.empty() && seg.stopAfter)
+      {
+        segs_.back().stopAfter = true;
+      }
+
+      if (l > TRAJ_EPS)
+      {
+        //! Center, unit vector from it to the start of the arc, and tangent there
+        cosHalf = cos(alpha / 2.0);
+        r = l / tan(alpha / 2.0);
+        double mid[CRPI_AXES_MAX];
+        for (j = 0; j < dims_; ++j)
+        {
+          mid[j] = out[j] - in[j];
+        }
+        cn = sqrt(dot(mid, mid, dims_));
+        for (j = 0; j < dims_; ++j)
+        {
+          seg.p[j] = cur[j] + (mid[j] / cn) * (r / cosHalf);
+          seg.u[j] = ((cur[j] - (l * in[j])) - seg.p[j]) / r;
+          seg.y[j] = in[j];
+        }
+        seg.arc = true;
+        seg.stopAfter = false;
+        seg.radius = r;
+        seg.length = r * alpha;
+        seg.s0 = length_;
+        length_ += seg.length;
+        segs_.push_back(seg);
+        for (j = 0; j < dims_; ++j)
+        {
+          start[j] = cur[j] + (l * out[j]);
+        }
+      }
+      else
+      {
+        memcpy(start, cur, sizeof(double) * dims_);
+      }
+    }
+    if (segs_.empty())
+    {
+      return false;
+    }
+    segs_.back().stopAfter = true;
+    return true;
+  }
+
+
+  void CrpiTrajectory::geometry (int seg, double s, double *q, double *dq, double *ddq) const
+  {
+    const trajSegment &g = segs_[seg];
+    int j;
+
+    if (!g.arc)
+    {
+      for (j = 0; j < dims_; ++j)
+      {
+        q[j] = g.p[j] + (s * g.u[j]);
+        dq[j] = g.u[j];
+        ddq[j] = 0.0;
+      }
+      return;
+    }
+
+    double phi = s / g.radius, c = cos(phi), sn = sin(phi);
+    for (j = 0; j < dims_; ++j)
+    {
+      q[j] = g.p[j] + (g.radius * ((g.u[j] * c) + (g.y[j] * sn)));
+      dq[j] = (g.y[j] * c) - (g.u[j] * sn);
+      ddq[j] = -((g.u[j] * c) + (g.y[j] * sn)) / g.radius;
+    }
+  }
+
+
+  int CrpiTrajectory::segmentAt (double s) const
+  {
+    int lo = 0, hi = (int)segs_.size() - 1, mid;
+    while (lo < hi)
+    {
+      mid = (lo + hi + 1) / 2;
+      if (segs_[mid].s0 <= s)
+      {
+        lo = mid;
+      }
+      else
+      {
+        hi = mid - 1;
+      }
+    }
+    return lo;
+  }
+
+
+  int CrpiTrajectory::stageAt (double t) const
+  {
+    vector<double>::const_iterator iter = upper_bound(t_.begin(), t_.end(), t);
+    int i = (int)(iter - t_.begin()) - 1;
+    return (i < 0) ? 0 : ((i > (int)t_.size() - 2) ? (int)t_.size() - 2 : i);
+  }
+
+
+  void CrpiTrajectory::evaluate (int i, double t, double *pos, double *vel, double *acc) const
+  {
+    double dq[CRPI_AXES_MAX], ddq[CRPI_AXES_MAX], tau, sd, s;
+    int g, j;
+
+    tau = t - t_[i];
+    tau = (tau < 0.0) ? 0.0 : ((tau > t_[i + 1] - t_[i]) ? t_[i + 1] - t_[i] : tau);
+    sd = sqrt(x_[i]);
+    s = s_[i] + (sd * tau) + (0.5 * u_[i] * tau * tau);
+    s = (s > s_[i + 1]) ? s_[i + 1] : s;
+    sd += u_[i] * tau;
+    sd = (sd < 0.0) ? 0.0 : sd;
+
+    g = segmentAt(s);
+    geometry(g, s - segs_[g].s0, pos, dq, ddq);
+    for (j = 0; j < dims_; ++j)
+    {
+      if (vel != NULL)
+      {
+        vel[j] = dq[j] * sd;
+      }
+      if (acc != NULL)
+      {
+        acc[j] = (dq[j] * u_[i]) + (ddq[j] * sd * sd);
+      }
+    }
+  }
+
+
+  LIBRARY_API void CrpiTrajectory::Evaluate (double t, double *pos, double *vel, double *acc) const
+  {
+    if (t_.size() < 2)
+    {
+      for (int j = 0; j < dims_; ++j)
+      {
+        pos[j] = 0.0;
+        if (vel != NULL)
+        {
+          vel[j] = 0.0;
+        }
+        if (acc != NULL)
+        {
+          acc[j] = 0.0;
+        }
+      }
+      return;
+    }
+    evaluate(stageAt(t), t, pos, vel, acc);
+  }
+
+
+  LIBRARY_API int CrpiTrajectory::Sample (double period, vector<double> &pos, vector<double> *vel) const
+  {
+    int count, k, i = 0;
+    double t;
+
+    if (t_.size() < 2 || !(period > 0.0))
+    {
+      pos.clear();
+      if (vel != NULL)
+      {
+        vel->clear();
+      }
+      return 0;
+    }
+
+    //! One sample at every multiple of the period, and one at the end
+    count = (int)floor(Duration() / period) + 1;
+    count += ((count - 1) * period < Duration()) ? 1 : 0;
+    pos.resize((size_t)count * dims_);
+    if (vel != NULL)
+    {
+      vel->resize((size_t)count * dims_);
+    }
+    for (k = 0; k < count; ++k)
+    {
+      t = (k * period < Duration()) ? k * period : Duration();
+      //! Times only increase, so the stage is found by walking forward
+      while (i < (int)t_.size() - 2 && t_[i + 1] <= t)
+      {
+        ++i;
+      }
+      evaluate(i, t, &pos[(size_t)k * dims_], (vel != NULL) ? &(*vel)[(size_t)k * dims_] : NULL, NULL);
+    }
+    return count;
+  }
+} // namespace crpi_robot
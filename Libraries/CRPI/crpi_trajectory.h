@@ -0,0 +1,189 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_trajectory.h
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Time-optimal parameterization of waypoint paths under per-axis velocity
+//  and acceleration limits, for streaming and blending motion in CRPI.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_trajectory_H
+#define crpi_trajectory_H
+
+#include "crpi.h"
+#include <vector>
+
+//! @brief Default number of grid points along a path (more for a closer approach to the limits
+//!        between grid points, fewer for faster planning)
+//!
+#define CRPI_TRAJ_GRID 400
+
+namespace crpi_robot
+{
+  //! @brief Piece of the geometric path (crpi_trajectory.cpp)
+  //!
+  struct trajSegment;
+
+  //! @ingroup Robot
+  //!
+  //! @brief Turns a list of waypoints into a timed trajectory that is as fast as the axes'
+  //!        velocity and acceleration limits allow.  The path is the polyline through the
+  //!        waypoints, with each corner either rounded by a circular blend that stays within a
+  //!        given distance of the waypoint or, if blending is off, passed at rest.  It is then
+  //!        time-parameterized by reachability analysis (TOPP-RA) over a grid along the path, and
+  //!        can be sampled at any time or at a fixed period.
+  //!
+  //! @note All buffers are kept between plans, so replanning a path of similar size allocates
+  //!       nothing.  Limits hold at the grid points; jerk is not limited.
+  //!
+  class LIBRARY_API CrpiTrajectory
+  {
+  public:
+    //! @brief Constructor
+    //!
+    //! @param dims   Number of axes (1 to CRPI_AXES_MAX)
+    //! @param maxVel Velocity limit of each axis (units/s), or NULL to set them later
+    //! @param maxAcc Acceleration limit of each axis (units/s^2), or NULL to set them later
+    //!
+    CrpiTrajectory (int dims, const double *maxVel = NULL, const double *maxAcc = NULL);
+
+    //! @brief Constructor for joint-space trajectories with the joint limits of a robot's
+    //!        configuration (its <JointLimit> tags)
+    //!
+    CrpiTrajectory (const CrpiRobotParams &params);
+
+    //! @brief Default destructor
+    //!
+    ~CrpiTrajectory ();
+
+    //! @brief Set the limits of every axis
+    //!
+    //! @return True if the limits were set, false if one is not positive
+    //!
+    bool SetLimits (const double *maxVel, const double *maxAcc);
+
+    //! @brief Set the number of grid points along the path (at least 2 per path segment are
+    //!        always used)
+    //!
+    void SetGrid (int points);
+
+    //! @brief Plan a trajectory through waypoints
+    //!
+    //! @param waypoints  count points of dims values, one after another
+    //! @param count      Number of waypoints (at least 2)
+    //! @param blend      Largest distance at which the path may pass each intermediate
+    //!                   waypoint without stopping (0 to stop at every waypoint)
+    //! @param startSpeed Speed along the path at the first waypoint, e.g., when replanning
+    //!                   during a motion (reduced if the limits do not allow it)
+    //!
+    //! @return CANON_SUCCESS if the trajectory was planned, CANON_REJECT if the waypoints are
+    //!         not valid or the limits are not set, CANON_FAILURE if no trajectory satisfies the
+    //!         limits
+    //!
+    CanonReturn Plan (const double *waypoints, int count, double blend = 0.0, double startSpeed = 0.0);
+    CanonReturn Plan (const robotAxes *waypoints, int count, double blend = 0.0, double startSpeed = 0.0);
+
+    //! @brief Duration of the planned trajectory (s)
+    //!
+    double Duration () const;
+
+    //! @brief Length of the planned path
+    //!
+    double Length () const;
+
+    //! @brief State of the trajectory at a time (clamped to the trajectory)
+    //!
+    //! @param t   Time since the start (s)
+    //! @param pos dims positions, populated by this function
+    //! @param vel dims velocities, populated by this function (may be NULL)
+    //! @param acc dims accelerations, populated by this function (may be NULL)
+    //!
+    void Evaluate (double t, double *pos, double *vel = NULL, double *acc = NULL) const;
+
+    //! @brief Sample the trajectory every period seconds, from 0 through its end
+    //!
+    //! @param period Time between samples (s)
+    //! @param pos    dims positions per sample, one after another, populated by this function
+    //! @param vel    dims velocities per sample (may be NULL)
+    //!
+    //! @return The number of samples
+    //!
+    //! @note The vectors are resized, not reallocated, so passing the same ones to every call
+    //!       keeps replanning free of allocations
+    //!
+    int Sample (double period, std::vector<double> &pos, std::vector<double> *vel = NULL) const;
+
+    //! @brief Number of axes
+    //!
+    int Dims () const;
+
+  private:
+    CrpiTrajectory (const CrpiTrajectory &) = delete;
+    CrpiTrajectory &operator= (const CrpiTrajectory &) = delete;
+
+    //! @brief Build segs_ and length_ from the waypoints
+    //!
+    bool buildPath (const double *waypoints, int count, double blend);
+
+    //! @brief Position, first, and second derivative with respect to path length at s in a
+    //!        segment
+    //!
+    void geometry (int seg, double s, double *q, double *dq, double *ddq) const;
+
+    //! @brief Segment holding path length s
+    //!
+    int segmentAt (double s) const;
+
+    //! @brief Grid stage holding time t
+    //!
+    int stageAt (double t) const;
+
+    //! @brief State at time t, in stage i
+    //!
+    void evaluate (int i, double t, double *pos, double *vel, double *acc) const;
+
+    int dims_;
+    int grid_;
+    double maxVel_[CRPI_AXES_MAX];
+    double maxAcc_[CRPI_AXES_MAX];
+    bool limited_;
+
+    //! @brief The path:  its segments and total length
+    //!
+    std::vector<trajSegment> segs_;
+    double length_;
+
+    //! @brief The grid:  path length, segment, squared path speed bounds and choices, and time
+    //!        at each point, and the path acceleration from each point to the next
+    //!
+    std::vector<double> s_;
+    std::vector<int> seg_;
+    std::vector<double> xMax_;
+    std::vector<double> hi_;
+    std::vector<double> x_;
+    std::vector<double> t_;
+    std::vector<double> u_;
+
+    //! @brief Bounds on the path acceleration at each grid point, as lines in the squared path
+    //!        speed x:  lo0 + lo1 x <= u <= up0 + up1 x, for each of the axes that is moving
+    //!
+    std::vector<double> lo0_;
+    std::vector<double> lo1_;
+    std::vector<double> up0_;
+    std::vector<double> up1_;
+    std::vector<int> active_;
+
+    //! @brief Waypoints left after dropping repeats, and robotAxes waypoints repacked for Plan
+    //!
+    std::vector<int> keep_;
+    std::vector<double> flat_;
+  }; // CrpiTrajectory
+} // namespace crpi_robot
+
+#endif
@@ -13,39 +13,135 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "crpi_universal.h"
+#include "crpi_alloc.h"
+#include "crpi_hub.h"
+#include "crpi_log.h"
+#include "crpi_native.h"
+#include "crpi_trace.h"
+#include "crpi_parse.h"
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <stdio.h>
 
 #define VERIFY_MOVING
 #define USE_TIMEOUT
 
-#define NEWTCPIP
-
-//#define UNIVERSAL_NOISY
 #define distthresh 0.01f
 #define angthresh 7.0f
 #define timethresh 40
 
+//! Accumulated time (s) a blocking move may go without closing on its target
+//! before it is considered stalled (previously 30 samples at 10 Hz)
+#define stallthresh 3.0
+
+//! Upper bound (s) on a single wait for a new state frame; keeps the timeout
+//! and stall checks alive if the feedback connection drops
+#define UR_STATE_WAIT 0.1
+
+//! Minimum interval (s) between attempts to re-establish a dropped command connection
+#define UR_RECONNECT_PERIOD 1.0
+
+//! Interval (s) at which the command connection is drained and checked
+#define UR_KEEPALIVE 5.0
+
+//! TCP speed (m/s) above which the robot is taken to be moving, and the weight of each new
+//! sample in the command latency estimate used for early release
+#define UR_MOVING_SPEED 0.002
+#define UR_LATENCY_GAIN 0.25
+
 using namespace std;
 
 namespace crpi_robot
 {
+  //! @brief (Re)open the persistent command connection.  Must be called with TCPIPhandle held.
+  //!
+  //! @param uh The robot handler whose clientID is replaced
+  //!
+  //! @return True if connected, false otherwise
+  //!
+  bool commandConnect (universalHandler *uh)
+  {
+    if (uh->clientID > 0)
+    {
+      ulapi_socket_close(uh->clientID);
+      ++uh->reconnects;
+      uh->commandReconnectMetric->Inc();
+    }
+    uh->connectTime = ulapi_time();
+    uh->clientID = ulapi_socket_get_client_id(uh->params.tcp_ip_port, uh->params.tcp_ip_addr);
+    if (uh->clientID <= 0)
+    {
+      uh->clientID = -1;
+      return false;
+    }
+    ulapi_socket_set_nonblocking(uh->clientID);
+    //! Scripts are short and latency-sensitive; do not wait to coalesce them
+    ulapi_socket_set_nodelay(uh->clientID);
+    return true;
+  }
+
+
+  //! @brief Write scripts to the command connection (the command queue's writer), with one retry
+  //!        on a fresh connection if the controller dropped the old one
+  //!
+  static bool writeCommands (void *context, const string &commands)
+  {
+    universalHandler *uh = (universalHandler*)context;
+    int length = (int) commands.size(), sent = -1;
+    double start = ulapi_time();
+
+    ulapi_fastlock_take(uh->TCPIPhandle);
+    uh->lockWaitMetric->ObserveSince(start);
+    for (int attempt = 0; attempt < 2 && sent != length; ++attempt)
+    {
+      if ((uh->clientID <= 0 || attempt > 0) && !commandConnect(uh))
+      {
+        break;
+      }
+      sent = ulapi_socket_write(uh->clientID, commands.c_str(), length);
+    }
+    if (sent == length)
+    {
+      uh->sendLatency = ulapi_time() - start;
+      if (uh->sendLatency > uh->worstLatency)
+      {
+        uh->worstLatency = uh->sendLatency;
+      }
+    }
+    ulapi_fastlock_give(uh->TCPIPhandle);
+
+    CRPI_LOG(CRPI_LOG_DEBUG, "send %d of %d bytes in %f s", sent, length, uh->sendLatency);
+    return (sent == length);
+  }
+
+
+  //! @brief Connection monitor, run every UR_KEEPALIVE seconds by the SensorHub
+  //!
   void livemanUniversal(void *param)
   {
     universalHandler *uh = (universalHandler*)param;
-    robotPose pose;
-    crpi_timer timer;
     ulapi_integer get;
     char buffer[4];
 
-    while (uh->runThread)
+    if (uh->runThread)
     {
-      ulapi_mutex_take(uh->TCPIPhandle);
-      get = ulapi_socket_read(uh->clientID, buffer, 4);
-      ulapi_mutex_give(uh->TCPIPhandle);
-
-      //! Don't slam your processor!  You don't need to poll at full speed.
-      timer.waitUntil(5000);
+      ulapi_fastlock_take(uh->TCPIPhandle);
+      if (uh->clientID > 0)
+      {
+        //! Drain the controller's status messages; a zero-length read means the peer closed
+        get = ulapi_socket_read(uh->clientID, buffer, 4);
+        if (get == 0)
+        {
+          ulapi_socket_close(uh->clientID);
+          uh->clientID = -1;
+        }
+      }
+      if (uh->clientID <= 0 && (ulapi_time() - uh->connectTime) > UR_RECONNECT_PERIOD)
+      {
+        commandConnect(uh);
+      }
+      ulapi_fastlock_give(uh->TCPIPhandle);
     }
     return;
   }
@@ -98,265 +194,297 @@ namespace crpi_robot
     return returnMe;
   }
 
-  bool parseFeedback (int bytes, char *buffer, robotPose &pose, robotAxes &axes, robotIO &io, robotPose &forces, robotPose &speeds)
+  //! @brief Store decoded state in the handler.  Copies element-wise into the existing
+  //!        containers so nothing is allocated while the lock is held, and publishes the
+  //!        same values as a snapshot for the Get* methods.
+  //!
+  void publishFeedback (universalHandler *uH, const urFeedback &fb, double stamp)
   {
-    double dval;
-    int ival;
-    bool little = false;
-
-    //! JAM:  Note that the UR sends feedback in big endian format.  Test for endianess.
-    int i = 0x01234567;
     int j;
-    char* c = (char*)&i;
-    little = (c[0] == 'g');
-    //for (j = 0; j < sizeof(int); j++)
-    //{
-    //  printf(" %.2x", c[j]);
-    //}
-    //printf("\n");
-       
-    //! If big endian:  01 23 45 67
-    //! If little endian: 67 45 23 01
-    
-    //cout << bytes << endl;
-    if (bytes != 1044 && bytes != 812)
-    {
-      //! unknown byte length
-      return false;
-    }
-
-    int index = 0;
-    //! Number of bytes sent
-    ival = readInt(buffer, index, little);
-
-    //! Time
-    dval = readDouble(buffer, index, little);
-
-    //! Target joint positions
-    for (j = 0; j < 6; ++j)
-    {
-      dval = readDouble(buffer, index, little);
-    }
-
-    //! Target joint velocities
-    for (j = 0; j < 6; ++j)
-    {
-      dval = readDouble(buffer, index, little);
-    }
-
-    //! Target joint accelerations
-    for (j = 0; j < 6; ++j)
-    {
-      dval = readDouble(buffer, index, little);
-    }
-
-    //! Target joint current
-    for (j = 0; j < 6; ++j)
-    {
-      dval = readDouble(buffer, index, little);
-    }
+    RobotStateSnapshot snap;
+    urAxisSpeeds axisSpeeds;
+    urStatus status;
+    double forces[6];
 
-    //! Target joint moments
-    for (j = 0; j < 6; ++j)
+    //! Stamp the state with the controller's own sample time once its clock is followed
+    uH->clock->AddOneWay(fb.time, stamp);
+    if (uH->clock->Synced())
     {
-      dval = readDouble(buffer, index, little);
+      stamp = uH->clock->ToLocal(fb.time);
     }
 
-    //! Actual joint positions
+    //! Compensate and filter the wrench here, so readers get it at no cost
     for (j = 0; j < 6; ++j)
     {
-      axes.axis.at(j) = readDouble(buffer, index, little);
-//      cout << axes.axis.at(j) << endl;
-//      dval = readDouble(buffer, index, little);
-    }
-
-    //! Actual joint velocities
+      forces[j] = fb.forces[j];
+    }
+    uH->wrench.Process(fb.pose, fb.speeds, stamp, forces);
+
+    snap.pose.x = fb.pose[0];
+    snap.pose.y = fb.pose[1];
+    snap.pose.z = fb.pose[2];
+    snap.pose.xrot = fb.pose[3];
+    snap.pose.yrot = fb.pose[4];
+    snap.pose.zrot = fb.pose[5];
+    snap.forces.x = forces[0];
+    snap.forces.y = forces[1];
+    snap.forces.z = forces[2];
+    snap.forces.xrot = forces[3];
+    snap.forces.yrot = forces[4];
+    snap.forces.zrot = forces[5];
+    snap.speeds.x = fb.speeds[0];
+    snap.speeds.y = fb.speeds[1];
+    snap.speeds.z = fb.speeds[2];
+    snap.speeds.xrot = fb.speeds[3];
+    snap.speeds.yrot = fb.speeds[4];
+    snap.speeds.zrot = fb.speeds[5];
+    snap.axes = 6;
     for (j = 0; j < 6; ++j)
     {
-      dval = readDouble(buffer, index, little);
+      snap.axis[j] = fb.axes[j];
+      axisSpeeds.speeds[j] = fb.axisSpeeds[j];
     }
-
-    //! Actual joint currents
-    for (j = 0; j < 6; ++j)
+    snap.ndio = CRPI_IO_MAX;
+    for (j = 0; j < CRPI_IO_MAX; ++j)
     {
-      dval = readDouble(buffer, index, little);
+      snap.dio[j] = ((fb.dio >> j) & 1) != 0;
     }
+    snap.valid = STATE_POSE | STATE_AXES | STATE_FORCES | STATE_SPEEDS | STATE_IO;
+    snap.timestamp = stamp;
 
-    //! Joint control currents
-    for (j = 0; j < 6; ++j)
+    //! The status arrives at only 10 Hz on its own connection; every state carries the latest
+    uH->status.read(status);
+    if (status.valid)
     {
-      dval = readDouble(buffer, index, little);
-    }
-
-    //! Actual Cartesian coordinates of TCP
- //   for (j = 0; j < 6; ++j)
- //   {
- //     dval = readDouble(buffer, index, little);
- //     cout << dval << endl;
- //   }
-    pose.x = readDouble(buffer, index, little);
-    pose.y = readDouble(buffer, index, little);
-    pose.z = readDouble(buffer, index, little);
-    pose.xrot = readDouble(buffer, index, little);
-    pose.yrot = readDouble(buffer, index, little);
-    pose.zrot = readDouble(buffer, index, little);
-//    cout << "raw: " << pose.x << " " << pose.y << " " << pose.z << " " << pose.xrot << " " << pose.yrot << " " << pose.zrot << endl;
-
-
-    //! Actual speed of TCP in Cartesian space
-//    for (j = 0; j < 6; ++j)
-//    {
-//      dval = readDouble(buffer, index, little);
-//    }
-    speeds.x = readDouble(buffer, index, little);
-    speeds.y = readDouble(buffer, index, little);
-    speeds.z = readDouble(buffer, index, little);
-    speeds.xrot = readDouble(buffer, index, little);
-    speeds.yrot = readDouble(buffer, index, little);
-    speeds.zrot = readDouble(buffer, index, little);
-
-    //! Forces at TCP
-    /*
-    for (j = 0; j < 6; ++j)
-    {
-      dval = readDouble(buffer, index, little);
+      snap.robotMode = status.robotMode;
+      snap.safetyMode = status.safetyMode;
+      snap.programState = status.programState;
+      snap.status = status.status;
+      snap.valid |= STATE_STATUS;
     }
-    */
-    forces.x = readDouble(buffer, index, little);
-    forces.y = readDouble(buffer, index, little);
-    forces.z = readDouble(buffer, index, little);
-    forces.xrot = readDouble(buffer, index, little);
-    forces.yrot = readDouble(buffer, index, little);
-    forces.zrot = readDouble(buffer, index, little);
 
-    //! TCP target coordinates
+    ulapi_rwlock_write_take(uH->handle);
+    uH->curPose.x = fb.pose[0];
+    uH->curPose.y = fb.pose[1];
+    uH->curPose.z = fb.pose[2];
+    uH->curPose.xrot = fb.pose[3];
+    uH->curPose.yrot = fb.pose[4];
+    uH->curPose.zrot = fb.pose[5];
     for (j = 0; j < 6; ++j)
     {
-      dval = readDouble(buffer, index, little);
-    }
+      uH->curAxes.axis[j] = fb.axes[j];
+      uH->curAxisSpeeds.axis[j] = fb.axisSpeeds[j];
+    }
+    uH->curForces.x = forces[0];
+    uH->curForces.y = forces[1];
+    uH->curForces.z = forces[2];
+    uH->curForces.xrot = forces[3];
+    uH->curForces.yrot = forces[4];
+    uH->curForces.zrot = forces[5];
+    uH->curSpeeds.x = fb.speeds[0];
+    uH->curSpeeds.y = fb.speeds[1];
+    uH->curSpeeds.z = fb.speeds[2];
+    uH->curSpeeds.xrot = fb.speeds[3];
+    uH->curSpeeds.yrot = fb.speeds[4];
+    uH->curSpeeds.zrot = fb.speeds[5];
+    for (j = 0; j < CRPI_IO_MAX; ++j)
+    {
+      uH->curIO.dio[j] = ((fb.dio >> j) & 1) != 0;
+    }
+    uH->poseGood = true;
+    uH->stateTime = stamp;
+    //! Only this thread advances stateCount, so it can read it without stateMutex
+    snap.sequence = uH->stateCount + 1;
+    axisSpeeds.sequence = snap.sequence;
+    uH->axisSpeeds.write(axisSpeeds);
+    uH->state.write(snap);
+    CrpiRecorder::RecordState(uH->recordChannel, snap);
+    uH->framesMetric->Inc();
+    uH->rateMetric.Tick(stamp);
+    ulapi_mutex_take(uH->stateMutex);
+    ++uH->stateCount;
+    ulapi_cond_broadcast(uH->stateCond);
+    ulapi_mutex_give(uH->stateMutex);
+    ulapi_rwlock_write_give(uH->handle);
+  }
 
-    //! TCP target speed
-    for (j = 0; j < 6; ++j)
-    {
-      dval = readDouble(buffer, index, little);
-    }
-  
-    //! Digital input states
-    ival = (int)(readDouble(buffer, index, little));
-    for (j = (CRPI_IO_MAX-1); j >= 0; j--)
-    {
-      io.dio[j] = (ival >= (1 << j));
-      if (io.dio[j])
-      {
-        ival -= (int)(1 << j);
-      }
-    }
+//! @brief Keep a single connection to the real-time port open and consume every frame the
+//!        controller streams, rather than connecting, reading one packet, and disconnecting
+//!
+#define KEEP_CONNECTION
+
+//! @brief Largest real-time interface frame accepted by the reassembly buffer
+//!
+#define UR_MAX_FRAME 2048
+
+//! @brief Smallest real-time interface frame containing all fields used by CRPI
+//!
+#define UR_MIN_FRAME 812
+
+//! @brief Reconnection back off limits (ms) when the controller cannot be reached
+//!
+#define UR_BACKOFF_MIN 50
+#define UR_BACKOFF_MAX 2000
+
+//! @brief Time (s) without receiving any data before the connection is considered dead
+//!
+#define UR_STALE_TIMEOUT 1.0
+
+  //! @brief Sleep until the controller sends more on a feedback connection, or until the
+  //!        connection has been silent for UR_STALE_TIMEOUT
+  //!
+  //! @param poller Poller holding the connection
+  //! @param lastRx Time the connection last delivered data
+  //!
+  static void waitForFeedback (void *poller, double lastRx)
+  {
+    ulapi_poll_event ev;
+    double left = UR_STALE_TIMEOUT - (ulapi_time() - lastRx);
 
-    //! Motor temperatures
-    for (j = 0; j < 6; ++j)
+    if (poller == NULL || ulapi_poller_wait(poller, &ev, 1, (left > 0.0) ? left : 0.0) < 0)
     {
-      dval = readDouble(buffer, index, little);
+      //! No poller.  The next frame is at most 8 ms away, so check back shortly.
+      ulapi_sleep(0.001);
     }
+  }
 
-    //! Controller timer
-    dval = readDouble(buffer, index, little);
 
-    //! Test value
-    dval = readDouble(buffer, index, little);
+  void feedbackThread (void *param)
+  {
+    universalHandler *uH = (universalHandler*)param;
+    char *buffer;
+    int get;
+    urFeedback fb;
+    const urFrameLayout *layout = NULL;
 
-    //! Robot mode
-    dval = readDouble(buffer, index, little);
+#ifdef KEEP_CONNECTION
+    //! Frames are length-prefixed (big endian), so bytes are accumulated until a complete frame
+    //! is available regardless of how the TCP stream was segmented
+    int held = 0, index, frameLen;
+    int backoff = UR_BACKOFF_MIN;
+    double lastRx = 0.0, arrived;
+    bool connected = false;
+    int test = 0x01234567;
+    bool little = (((char*)&test)[0] == 0x67);
 
-    //! Joint modes
-    for (j = 0; j < 6; ++j)
-    {
-      dval = readDouble(buffer, index, little);
-    }
+    buffer = new char[2 * UR_MAX_FRAME];
+    void *poller = ulapi_poller_new();
 
-    //! 1044 bytes beyond this point
-    if (ival > 812)
+    ulapi_integer client = 0;
+    while (uH->runThread)
     {
-      //! Safety mode
-      dval = readDouble(buffer, index, little);
-
-      //! Reserved
-      for (j = 0; j < 6; ++j)
+      /*
+      HOST = "169.254.152.50" //! The remote host
+      PORT = 30003            //! 125 Hz (CB) / 500 Hz (e-Series) update of robot state
+      PORT = 30002            //! Control port
+      */
+      if (client <= 0)
       {
-        dval = readDouble(buffer, index, little);
+        client = ulapi_socket_get_client_id (30003, uH->params.tcp_ip_addr);
+        if (client <= 0)
+        {
+          //! Controller unavailable.  Back off before trying again.
+#ifdef WIN32
+          Sleep (backoff);
+#else
+          usleep (backoff * 1000);
+#endif
+          backoff = ((backoff * 2) > UR_BACKOFF_MAX) ? UR_BACKOFF_MAX : (backoff * 2);
+          continue;
+        }
+        ulapi_socket_set_nonblocking(client);
+        ulapi_socket_set_timestamps(client, ULAPI_STAMP_KERNEL);
+        ulapi_poller_add(poller, client, ULAPI_POLL_READ, NULL);
+        held = 0;
+        lastRx = ulapi_time();
+        if (connected)
+        {
+          uH->feedbackReconnectMetric->Inc();
+        }
+        connected = true;
       }
 
-      //! Tool accelerometer
-      for (j = 0; j < 3; ++j)
+      //! The stamp is when the bytes reached the host, so feedback age excludes this thread's
+      //! scheduling delay
+      get = ulapi_socket_read_stamped(client, buffer + held, (2 * UR_MAX_FRAME) - held, &arrived);
+
+      if (get == 0 || (get < 0 && (ulapi_time() - lastRx) > UR_STALE_TIMEOUT))
       {
-        dval = readDouble(buffer, index, little);
+        //! Connection closed by the controller, or nothing heard for too long.  Start over.
+        ulapi_poller_remove(poller, client);
+        ulapi_socket_close(client);
+        client = 0;
+        continue;
       }
 
-      //! Reserved
-      for (j = 0; j < 6; ++j)
+      if (get < 0)
       {
-        dval = readDouble(buffer, index, little);
+        //! Nothing waiting.  Sleep until the next frame arrives.
+        waitForFeedback(poller, lastRx);
+        continue;
       }
 
-      //! Speed scaling
-      dval = readDouble(buffer, index, little);
+      held += get;
+      lastRx = arrived;
 
-      //! Linear momentum norm
-      dval = readDouble(buffer, index, little);
-
-      //! Reserved
-      dval = readDouble(buffer, index, little);
-
-      //! Reserved
-      dval = readDouble(buffer, index, little);
-
-      //! Main voltage
-      dval = readDouble(buffer, index, little);
-
-      //! Robot voltage
-      dval = readDouble(buffer, index, little);
-
-      //! Robot current
-      dval = readDouble(buffer, index, little);
-
-      //! Joint voltages
-      for (j = 0; j < 6; ++j)
+      //! Publish every complete frame held in the buffer
+      while (held >= (int)sizeof(int))
       {
-        dval = readDouble(buffer, index, little);
-      }
-    } // if (ival > 812)
+        index = 0;
+        frameLen = readInt(buffer, index, little);
+        if (frameLen < UR_MIN_FRAME || frameLen > UR_MAX_FRAME)
+        {
+          //! Lost framing.  Drop what we have and reconnect to resynchronize on a frame boundary.
+          uH->droppedMetric->Inc();
+          ulapi_poller_remove(poller, client);
+          ulapi_socket_close(client);
+          client = 0;
+          held = 0;
+          break;
+        }
 
-    return true;
-  }
+        if (held < frameLen)
+        {
+          //! Remainder of the frame has not arrived yet
+          break;
+        }
 
-//#define KEEP_CONNECTION
+        CRPI_NO_ALLOC_SCOPE("CrpiUniversal feedback frame");
+        if (crpi_parse_ur_frame(frameLen, buffer, layout, fb))
+        {
+          //! Store feedback from robot
+          publishFeedback(uH, fb, lastRx);
+          backoff = UR_BACKOFF_MIN;
+        }
+        else
+        {
+          uH->droppedMetric->Inc();
+        }
 
-  void feedbackThread (void *param)
-  {
-    static crpi_timer timer;
-    universalHandler *uH = (universalHandler*)param;
-    bool connected = false;
-    char *buffer;
-    int get;
-    robotPose pose;
-    robotAxes axes;
-    robotPose force;
-    robotPose speed;
-    robotIO io;
+        held -= frameLen;
+        if (held > 0)
+        {
+          memmove(buffer, buffer + frameLen, held);
+        }
+      } // while (held >= sizeof(int))
+    } // while (uH->runThread)
 
+    if (client > 0)
+    {
+      ulapi_poller_remove(poller, client);
+      ulapi_socket_close(client);
+    }
+    ulapi_poller_delete(poller);
+#else
     buffer = new char[1044];
 
     ulapi_integer client = 0;
+    //! Don't slam your processor!  You don't need to poll at full speed. 30 Hz
+    crpi_periodic poll (1.0 / 30.0);
     while (uH->runThread)
     {
-//      cout << "running... " << endl;
-      /*
-      HOST = "169.254.152.50" //! The remote host
-      PORT = 30003            //! 125 Hz update of robot state
-      PORT = 30002            //! Control port
-      */
       if (client <= 0)
       {
-//        cout << "No client.  Restarting" << endl;
         client = ulapi_socket_get_client_id (30003, uH->params.tcp_ip_addr);
         if (client > 0)
         {
@@ -368,1339 +496,3483 @@ namespace crpi_robot
       {
         //! Read feedback from robot
         get = ulapi_socket_read(client, buffer, 1044);
-
-#ifndef KEEP_CONNECTION
         ulapi_socket_close(client);
         client = 0;
-#endif
 
         if (get == 812 || get == 1044)
         {
+          CRPI_NO_ALLOC_SCOPE("CrpiUniversal feedback frame");
           //! Parse feedback from robot
-          if (parseFeedback(get, buffer, pose, axes, io, force, speed))
+          if (crpi_parse_ur_frame(get, buffer, layout, fb))
           {
-            ulapi_mutex_take(uH->handle);
             //! Store feedback from robot
-            uH->curPose = pose;
-            uH->poseGood = true;
-            uH->curAxes = axes;
-            uH->curForces = force;
-            uH->curSpeeds = speed;
-            uH->curIO = io;
-            ulapi_mutex_give(uH->handle);
-
-            //cout << "(" << pose.x << ", " << pose.y << ", " << pose.z << ", " << pose.xrot << ", " << pose.yrot << ", " << pose.zrot << ")" << endl;
-            //cout << "(" << axes.axis.at(0) << ", " << axes.axis.at(1) << ", " << axes.axis.at(2) << ", " << axes.axis.at(3) << ", " << axes.axis.at(4) << ", " << axes.axis.at(5) << ")" << endl;
+            publishFeedback(uH, fb, ulapi_time());
+          }
+          else
+          {
+            uH->droppedMetric->Inc();
           }
         } // if (get == 812 || 1044)
         else
         {
-          //! Error reading
-#ifdef KEEP_CONNECTION
-//          cout << "Bad read.  Restart connection." << endl;
-          ulapi_socket_close(client);
-          client = 0;
-#endif
-
+          uH->droppedMetric->Inc();
         }
       } // if (client > 0)
 
-      //! Don't slam your processor!  You don't need to poll at full speed. 30 Hz
-      //timer.waitUntil(100);//Sleep (100);
-#ifdef WIN32
-    Sleep (33);
-#else
-    usleep(33000);
-#endif 
-      //Sleep(33);
+      poll.wait();
     } // while (uH->runThread)
-    cout << "Quitting thread" << endl;
+#endif
+    CRPI_LOG(CRPI_LOG_DEBUG, "CrpiUniversal:  feedback thread quitting");
     delete [] buffer;
     return;
   }
 
 
-  LIBRARY_API CrpiUniversal::CrpiUniversal (CrpiRobotParams &params) :
-    firstIO_(true)
+//! @brief Secondary interface message types used:  robot state (a series of packages) and
+//!        robot messages, of which the version message is the first sent on each connection
+//!
+#define UR_MSG_ROBOT_STATE 16
+#define UR_MSG_ROBOT_MESSAGE 20
+#define UR_MSG_VERSION 3
+
+//! @brief Robot state package types used
+//!
+#define UR_PACKAGE_ROBOT_MODE 0
+#define UR_PACKAGE_MASTERBOARD 3
+
+  //! @brief Decode a secondary interface message into the controller's status
+  //!
+  //! @param msg    The message, starting with its length and type
+  //! @param length Length of the message
+  //! @param major  Major software version of the controller, set by the version message (0
+  //!               until then)
+  //! @param status Status to update
+  //!
+  //! @return True if the message held the robot mode package (sent with every robot state)
+  //!
+  static bool parseSecondary (const char *msg, int length, int &major, urStatus &status)
   {
-    double Xtheta, Ytheta, Ztheta;
-    params_ = params;
-    handle_.params = params_;
-    
-    maxSpeed_ = 1.0f;
-    maxAccel_ = 3.0f;
-
-    //! These are nominal values defined by trial and error.  Use the SetAbsoluteSpeed and
-    //! SetAbsoluteAcceleration commands to override
-    speed_ = 1.0f;
-    acceleration_ = 0.2f;
-
-    mssgBuffer_ = new char[8192];
-    ulapi_init();
+    const char *pkg;
+    int index = 5, size, name;
+    bool mode = false, protective = false, emergency = false;
 
-    angleUnits_ = RADIAN;
-    lengthUnits_ = METER;
-    for (int i = 0; i < 6; ++i)
+    if ((unsigned char)msg[4] == UR_MSG_ROBOT_MESSAGE)
     {
-      axialUnits_[i] = RADIAN;
+      //! Time stamp (8), source (1), and message type (1), then for the version message the
+      //! length-prefixed project name and the major version
+      if (length > 15 && (unsigned char)msg[14] == UR_MSG_VERSION)
+      {
+        name = (unsigned char)msg[15];
+        if ((16 + name) < length)
+        {
+          major = (unsigned char)msg[16 + name];
+        }
+      }
+      return false;
+    }
+    if ((unsigned char)msg[4] != UR_MSG_ROBOT_STATE)
+    {
+      return false;
     }
 
-    task = ulapi_task_new();
-    handle_.handle = ulapi_mutex_new(19);
-    handle_.TCPIPhandle = ulapi_mutex_new(17);
-    handle_.rob = this;
-    handle_.runThread = true;
-    handle_.poseGood = false;
-    handle_.curTool = -1;
+    while ((index + 5) <= length)
+    {
+      pkg = msg + index;
+      size = crpi_load_be32(pkg);
+      if (size < 5 || (index + size) > length)
+      {
+        break;
+      }
 
-    //! Connect to UR server
-#ifdef NEWTCPIP
-    handle_.clientID = ulapi_socket_get_client_id(params_.tcp_ip_port, params_.tcp_ip_addr);
-    ulapi_socket_set_nonblocking(handle_.clientID);
-#endif
-    ulapi_task_start((ulapi_task_struct*)task, feedbackThread, &handle_, ulapi_prio_lowest(), 0);
+      if ((unsigned char)pkg[4] == UR_PACKAGE_ROBOT_MODE && size > 20)
+      {
+        //! Time stamp (8), then the flags:  real robot connected, real robot enabled, power
+        //! on, emergency stopped, protective stopped, program running, program paused; then
+        //! the robot mode.  Shared by every software version.
+        protective = (pkg[17] != 0);
+        emergency = (pkg[16] != 0);
+        status.status = ((pkg[13] != 0) ? STATUS_REAL_ROBOT : 0) |
+                        ((pkg[15] != 0) ? STATUS_POWER_ON : 0) |
+                        (emergency ? STATUS_EMERGENCY_STOP : 0) |
+                        (protective ? STATUS_PROTECTIVE_STOP : 0);
+        status.programState = (pkg[19] != 0) ? PROGRAM_PAUSED :
+                              ((pkg[18] != 0) ? PROGRAM_PLAYING : PROGRAM_STOPPED);
+        status.robotMode = (signed char)pkg[20];
+        mode = true;
+      }
+      else if ((unsigned char)pkg[4] == UR_PACKAGE_MASTERBOARD && major >= 3 && size > 65)
+      {
+        //! I/O bits (2 x 4), analog input ranges and values (2 + 16), analog output domains and
+        //! values (2 + 16), and four floats (16) precede the safety mode
+        status.safetyMode = (unsigned char)pkg[65];
+      }
+      index += size;
+    }
 
-    while (handle_.poseGood != true)
+    if (mode && major < 3)
     {
-#ifdef WIN32
-    Sleep (100);
-#else
-    usleep(100000);
-#endif 
-      //Sleep(100);
+      //! Software 1.x reports no safety mode; take it from the stop flags
+      status.safetyMode = emergency ? UR_SAFETY_ROBOT_EMERGENCY_STOP :
+                          (protective ? UR_SAFETY_PROTECTIVE_STOP : UR_SAFETY_NORMAL);
     }
+    if (status.safetyMode == UR_SAFETY_PROTECTIVE_STOP)
+    {
+      status.status |= STATUS_PROTECTIVE_STOP;
+    }
+    return mode;
+  }
 
-#ifdef NEWTCPIP
-    ulapi_task_start((ulapi_task_struct*)task, livemanUniversal, &handle_, ulapi_prio_lowest(), 0);
-#endif
-
-    pin_ = new matrix(3,1);
-    pout_ = new matrix(3,1);
 
-    forward_ = new matrix(4, 4);
-    backward_ = new matrix(4, 4);
-    matrix r(3, 3);
+  //! @brief Publish the controller's status, and run the status watches if it changed
+  //!
+  static void publishStatus (universalHandler *uH, const urStatus &after)
+  {
+    urStatus before;
 
-    Xtheta = params_.mounting->xrot * (3.141592654 / 180.0f);
-    Ytheta = params_.mounting->yrot * (3.141592654 / 180.0f);
-    Ztheta = params_.mounting->zrot * (3.141592654 / 180.0f);
-        
-    vector<double> vtemp;
-    vtemp.push_back(Xtheta);
-    vtemp.push_back(Ytheta);
-    vtemp.push_back(Ztheta);
+    uH->status.read(before);
+    if (before == after)
+    {
+      return;
+    }
+    uH->status.write(after);
 
-    r.rotEulerMatrixConvert(vtemp);
-    //! Copy rotation matrix to homogeneous transformation matrix
-    for (int x = 0; x < 3; ++x)
+    ulapi_fastlock_take(uH->watchLock);
+    for (size_t i = 0; i < uH->statusWatches.size(); ++i)
     {
-      for (int y = 0; y < 3; ++y)
-      {
-        forward_->at(x, y) = r.at(x, y);
-      }
+      uH->statusWatches[i].second(before, after);
     }
-    forward_->at(0, 3) = params_.mounting->x;
-    forward_->at(1, 3) = params_.mounting->y;
-    forward_->at(2, 3) = params_.mounting->z;
-    forward_->at(3, 3) = 1.0f;
-    *backward_ = forward_->inv(); //JAM forward_->matrixInv(*forward_, *backward_); // 
+    ulapi_fastlock_give(uH->watchLock);
   }
 
 
-  LIBRARY_API CrpiUniversal::~CrpiUniversal ()
+  //! @brief Keep a connection to the secondary client interface, which pushes the robot state
+  //!        at 10 Hz, and publish the controller's status from it
+  //!
+  void statusThread (void *param)
   {
-    handle_.runThread = false;
-    delete forward_;
-    delete backward_;
-    delete pin_;
-    delete pout_;
-  }
+    universalHandler *uH = (universalHandler*)param;
+    char *buffer = new char[UR_SECONDARY_MAX];
+    int held = 0, length, get, major = 0;
+    int backoff = UR_BACKOFF_MIN;
+    double lastRx = 0.0;
+    ulapi_integer client = 0;
+    ulapi_poll_event ev;
+    urStatus status;
 
-  LIBRARY_API CanonReturn CrpiUniversal::ApplyCartesianForceTorque (robotPose &robotForceTorque, vector<bool> activeAxes, vector<bool> manipulator)
-  {
-    //! TODO
-    return CANON_FAILURE;
+    while (uH->runThread)
+    {
+      if (client <= 0)
+      {
+        client = ulapi_socket_get_client_id (UR_SECONDARY_PORT, uH->params.tcp_ip_addr);
+        if (client <= 0)
+        {
+          //! Controller unavailable.  Back off (on the poller, so that stopping is not delayed)
+          //! before trying again.
+          client = 0;
+          ulapi_poller_wait(uH->statusPoller, &ev, 1, backoff / 1000.0);
+          backoff = ((backoff * 2) > UR_BACKOFF_MAX) ? UR_BACKOFF_MAX : (backoff * 2);
+          continue;
+        }
+        ulapi_socket_set_nonblocking(client);
+        ulapi_poller_add(uH->statusPoller, client, ULAPI_POLL_READ, NULL);
+        held = 0;
+        major = 0;
+        lastRx = ulapi_time();
+      }
+
+      get = ulapi_socket_read(client, buffer + held, UR_SECONDARY_MAX - held);
+      if (get == 0 || (get < 0 && (ulapi_time() - lastRx) > UR_STALE_TIMEOUT))
+      {
+        //! Connection closed by the controller, or nothing heard for too long.  The status is
+        //! unknown until it is reported again.
+        ulapi_poller_remove(uH->statusPoller, client);
+        ulapi_socket_close(client);
+        client = 0;
+        publishStatus(uH, urStatus());
+        continue;
+      }
+      if (get < 0)
+      {
+        ulapi_poller_wait(uH->statusPoller, &ev, 1, UR_STALE_TIMEOUT);
+        continue;
+      }
+      held += get;
+      lastRx = ulapi_time();
+
+      //! Decode every complete message held in the buffer
+      while (held >= 5)
+      {
+        length = crpi_load_be32(buffer);
+        if (length < 5 || length > UR_SECONDARY_MAX)
+        {
+          //! Lost framing.  Reconnect to resynchronize on a message boundary.
+          ulapi_poller_remove(uH->statusPoller, client);
+          ulapi_socket_close(client);
+          client = 0;
+          held = 0;
+          break;
+        }
+        if (held < length)
+        {
+          break;
+        }
+
+        uH->status.read(status);
+        if (parseSecondary(buffer, length, major, status))
+        {
+          status.valid = true;
+          publishStatus(uH, status);
+          backoff = UR_BACKOFF_MIN;
+        }
+
+        held -= length;
+        if (held > 0)
+        {
+          memmove(buffer, buffer + length, held);
+        }
+      } // while (held >= 5)
+    } // while (uH->runThread)
+
+    if (client > 0)
+    {
+      ulapi_poller_remove(uH->statusPoller, client);
+      ulapi_socket_close(client);
+    }
+    delete [] buffer;
+  }
+
+
+//! @brief RTDE (Real-Time Data Exchange) interface port
+//!
+#define UR_RTDE_PORT 30004
+
+//! @brief RTDE protocol version negotiated with the controller
+//!
+#define RTDE_PROTOCOL_VERSION 2
+
+//! @brief RTDE package types
+//!
+#define RTDE_REQUEST_PROTOCOL_VERSION 86
+#define RTDE_TEXT_MESSAGE 77
+#define RTDE_DATA_PACKAGE 85
+#define RTDE_CONTROL_PACKAGE_SETUP_OUTPUTS 79
+#define RTDE_CONTROL_PACKAGE_SETUP_INPUTS 73
+#define RTDE_CONTROL_PACKAGE_START 83
+#define RTDE_CONTROL_PACKAGE_PAUSE 80
+
+//! @brief Largest RTDE package handled by CRPI
+//!
+#define RTDE_MAX_PACKAGE 1024
+
+//! @brief Time (s) allowed for the controller to answer a control request
+//!
+#define RTDE_REQUEST_TIMEOUT 2.0
+
+//! @brief Default and maximum output rates (Hz).  CB-series controllers are limited to 125 Hz.
+//!
+#define RTDE_DEFAULT_RATE 125.0
+#define RTDE_MAX_RATE 500.0
+
+//! @brief Output recipe:  only the fields CRPI stores in the universalHandler, in the order
+//!        they are unpacked in rtdeThread
+//!
+#define RTDE_OUTPUTS "actual_TCP_pose,actual_q,actual_TCP_force,actual_TCP_speed,actual_digital_input_bits,timestamp,actual_qd"
+
+//! @brief First input register used for setpoints.  The upper range (24-47) is set aside by
+//!        the controller for RTDE clients, so fieldbus adapters using 0-23 are not disturbed.
+//!        Layout:  int[R] = mode (UR_SETPOINT_*), int[R+1] = sequence, int[R+2] = force mode axis
+//!        selection (bit i = axis i), double[R..R+5] = target, double[R+6..R+11] = force mode
+//!        limits
+//!
+#define UR_RTDE_REGISTER 24
+
+//! @brief Setpoint modes written to the first RTDE input integer register
+//!
+#define UR_SETPOINT_STOP 0
+#define UR_SETPOINT_SERVOJ 1
+#define UR_SETPOINT_SERVOL 2
+#define UR_SETPOINT_SPEEDJ 3
+#define UR_SETPOINT_WRENCH 4
+
+//! @brief Number of doubles in the setpoint input registers:  target and force mode limits
+//!
+#define UR_SETPOINT_VALUES 12
+
+//! @brief Size of the output data package payload:  recipe ID, 4 x VECTOR6D, UINT64, DOUBLE,
+//!        VECTOR6D
+//!
+#define RTDE_OUTPUT_BYTES (1 + (24 * sizeof(double)) + 8 + sizeof(double) + (6 * sizeof(double)))
+
+//! @brief Guarded search results, in a second output recipe:  int[R] = ending condition
+//!        (CrpiSearchEnd), int[R+1] = run, double[R..R+5] = TCP pose when the condition was met.
+//!        Native programs report the number of steps finished in int[R].  Payload:  recipe ID,
+//!        2 x INT32, 6 x DOUBLE.
+//!
+#define RTDE_SEARCH_BYTES (1 + (2 * 4) + (6 * sizeof(double)))
+
+//! @brief Most waypoints in a guarded search program (the program text grows with each)
+//!
+#define UR_SEARCH_MAX_POINTS 4096
+
+//! @brief Time (s) a native program has to report its start before it is taken to have been
+//!        refused by the controller, and time (s) the controller must report no program running
+//!        before a native program that has not finished is taken to have stopped
+//!
+#define UR_NATIVE_START 5.0
+#define UR_NATIVE_STOPPED 0.5
+
+  //! @brief Write a big-endian 16-bit value, as used by the RTDE package header
+  //!
+  void writeU16 (char *buffer, int &index, int val)
+  {
+    buffer[index++] = (char)((val >> 8) & 0xFF);
+    buffer[index++] = (char)(val & 0xFF);
+  }
+
+
+  //! @brief Read a big-endian 16-bit value
+  //!
+  int readU16 (char *buffer, int index)
+  {
+    return (((unsigned char)buffer[index]) << 8) | ((unsigned char)buffer[index + 1]);
+  }
+
+
+  void writeInt (char *buffer, int &index, int val, bool little)
+  {
+    char *src = (char*)&val;
+
+    for (int x = 0; x < (int)sizeof(int); ++x)
+    {
+      buffer[index + x] = (little ? src[sizeof(int) - (x+1)] : src[x]);
+    }
+    index += sizeof(int);
+  }
+
+
+  void writeDouble (char *buffer, int &index, double val, bool little)
+  {
+    char *src = (char*)&val;
+
+    for (int x = 0; x < (int)sizeof(double); ++x)
+    {
+      buffer[index + x] = (little ? src[sizeof(double) - (x+1)] : src[x]);
+    }
+    index += sizeof(double);
+  }
+
+
+  //! @brief Send an RTDE package
+  //!
+  //! @param client  Socket connected to the RTDE server
+  //! @param type    Package type
+  //! @param payload Package contents (may be NULL if length is 0)
+  //! @param length  Number of bytes in payload
+  //!
+  //! @return True if the whole package was written, false otherwise
+  //!
+  bool rtdeSend (ulapi_integer client, char type, const char *payload, int length)
+  {
+    char buffer[RTDE_MAX_PACKAGE];
+    int index = 0;
+
+    if ((length + 3) > RTDE_MAX_PACKAGE)
+    {
+      return false;
+    }
+
+    writeU16(buffer, index, length + 3);
+    buffer[index++] = type;
+    if (length > 0)
+    {
+      memcpy(buffer + index, payload, length);
+    }
+    return (ulapi_socket_write(client, buffer, length + 3) == (length + 3));
+  }
+
+
+  //! @brief Size of the complete RTDE package at the front of buffer
+  //!
+  //! @return Package size in bytes, 0 if it has not fully arrived, -1 if the header is invalid
+  //!
+  int rtdeFrame (char *buffer, int held)
+  {
+    int size;
+
+    if (held < 3)
+    {
+      return 0;
+    }
+    size = readU16(buffer, 0);
+    if (size < 3 || size > RTDE_MAX_PACKAGE)
+    {
+      return -1;
+    }
+    return (held >= size) ? size : 0;
+  }
+
+
+  //! @brief Send an RTDE control request and wait for the controller's reply of the same type
+  //!
+  //! @param client  Socket connected to the RTDE server (non-blocking)
+  //! @param type    Request type
+  //! @param payload Request contents
+  //! @param length  Number of bytes in payload
+  //! @param reply   Buffer to hold the reply payload (RTDE_MAX_PACKAGE bytes)
+  //! @param buffer  Receive buffer of 2 x RTDE_MAX_PACKAGE bytes.  Bytes that follow the reply
+  //!                (e.g., the first data package after a start request) are left in it.
+  //! @param held    Number of bytes held in buffer
+  //!
+  //! @return Size of the reply payload, or -1 if no reply arrived
+  //!
+  int rtdeRequest (ulapi_integer client, char type, const char *payload, int length, char *reply, char *buffer, int &held)
+  {
+    int get, size, replySize;
+    double deadline = ulapi_time() + RTDE_REQUEST_TIMEOUT;
+
+    if (!rtdeSend(client, type, payload, length))
+    {
+      return -1;
+    }
+
+    ulapi_integer ready;
+
+    while (ulapi_time() < deadline)
+    {
+      get = ulapi_socket_read(client, buffer + held, (2 * RTDE_MAX_PACKAGE) - held);
+      if (get == 0)
+      {
+        //! Connection closed
+        return -1;
+      }
+      if (get < 0)
+      {
+        //! Sleep until the reply arrives (a negative timeout would wait indefinitely)
+        ulapi_socket_poll(&client, &ready, 1, max(deadline - ulapi_time(), 0.0));
+        continue;
+      }
+      held += get;
+
+      while ((size = rtdeFrame(buffer, held)) > 0)
+      {
+        if (buffer[2] == type)
+        {
+          replySize = size - 3;
+          memcpy(reply, buffer + 3, replySize);
+          held -= size;
+          memmove(buffer, buffer + size, held);
+          return replySize;
+        }
+        if (buffer[2] == RTDE_TEXT_MESSAGE)
+        {
+          CRPI_LOG(CRPI_LOG_INFO, "RTDE:  %.*s", (int)(size - 3), buffer + 3);
+        }
+        //! Not the reply we're waiting for (e.g., a text message).  Discard it.
+        held -= size;
+        memmove(buffer, buffer + size, held);
+      }
+      if (size < 0)
+      {
+        return -1;
+      }
+    }
+    return -1;
+  }
+
+
+  //! @brief Negotiate the RTDE session:  protocol version, output and input recipes, and start
+  //!
+  //! @param uH     Handler holding the robot parameters and receiving the input recipe ID
+  //! @param client Socket connected to the RTDE server
+  //! @param recipe Output recipe ID assigned by the controller
+  //! @param buffer Receive buffer (2 x RTDE_MAX_PACKAGE bytes), emptied before use
+  //! @param held   Number of bytes left in buffer once streaming has started
+  //!
+  //! @return True if the controller is streaming the output recipe, false otherwise
+  //!
+  bool rtdeSetup (universalHandler *uH, ulapi_integer client, int &recipe, bool little, char *buffer, int &held)
+  {
+    char payload[RTDE_MAX_PACKAGE], reply[RTDE_MAX_PACKAGE];
+    int index = 0, size, inRecipe = -1, searchRecipe = -1;
+    double rate = uH->params.feedback_rate;
+    stringstream inputs, results;
+
+    held = 0;
+
+    //! Protocol version
+    writeU16(payload, index, RTDE_PROTOCOL_VERSION);
+    size = rtdeRequest(client, RTDE_REQUEST_PROTOCOL_VERSION, payload, index, reply, buffer, held);
+    if (size < 1 || reply[0] != 1)
+    {
+      return false;
+    }
+
+    //! Output recipe
+    if (rate <= 0.0)
+    {
+      rate = RTDE_DEFAULT_RATE;
+    }
+    else if (rate > RTDE_MAX_RATE)
+    {
+      rate = RTDE_MAX_RATE;
+    }
+    index = 0;
+    writeDouble(payload, index, rate, little);
+    memcpy(payload + index, RTDE_OUTPUTS, strlen(RTDE_OUTPUTS));
+    index += (int)strlen(RTDE_OUTPUTS);
+    size = rtdeRequest(client, RTDE_CONTROL_PACKAGE_SETUP_OUTPUTS, payload, index, reply, buffer, held);
+    if (size < 2 || string(reply + 1, size - 1).find("NOT_FOUND") != string::npos)
+    {
+      return false;
+    }
+    recipe = (unsigned char)reply[0];
+
+    //! Output recipe for guarded search results.  Not fatal if refused (controllers before 3.4
+    //! have no output registers); only guarded searches are unavailable.
+    results << "output_int_register_" << UR_RTDE_REGISTER << ",output_int_register_" << (UR_RTDE_REGISTER + 1);
+    for (int i = 0; i < 6; ++i)
+    {
+      results << ",output_double_register_" << (UR_RTDE_REGISTER + i);
+    }
+    index = 0;
+    writeDouble(payload, index, rate, little);
+    memcpy(payload + index, results.str().c_str(), results.str().length());
+    index += (int)results.str().length();
+    size = rtdeRequest(client, RTDE_CONTROL_PACKAGE_SETUP_OUTPUTS, payload, index, reply, buffer, held);
+    if (size >= 2 && reply[0] != 0 && string(reply + 1, size - 1).find("NOT_FOUND") == string::npos)
+    {
+      searchRecipe = (unsigned char)reply[0];
+    }
+
+    //! Input recipe for setpoints.  Not fatal if refused (e.g., registers claimed by another
+    //! client); state feedback still works, only register streaming is unavailable.
+    inputs << "input_int_register_" << UR_RTDE_REGISTER << ",input_int_register_" << (UR_RTDE_REGISTER + 1)
+           << ",input_int_register_" << (UR_RTDE_REGISTER + 2);
+    for (int i = 0; i < UR_SETPOINT_VALUES; ++i)
+    {
+      inputs << ",input_double_register_" << (UR_RTDE_REGISTER + i);
+    }
+    size = rtdeRequest(client, RTDE_CONTROL_PACKAGE_SETUP_INPUTS, inputs.str().c_str(), (int)inputs.str().length(), reply, buffer, held);
+    if (size >= 2 && reply[0] != 0)
+    {
+      string types(reply + 1, size - 1);
+      if (types.find("IN_USE") == string::npos && types.find("NOT_FOUND") == string::npos)
+      {
+        inRecipe = (unsigned char)reply[0];
+      }
+    }
+
+    //! Start streaming
+    size = rtdeRequest(client, RTDE_CONTROL_PACKAGE_START, NULL, 0, reply, buffer, held);
+    if (size < 1 || reply[0] != 1)
+    {
+      return false;
+    }
+
+    ulapi_rwlock_write_take(uH->handle);
+    uH->rtdeClient = client;
+    uH->rtdeInputRecipe = inRecipe;
+    uH->rtdeSearchRecipe = searchRecipe;
+    ulapi_rwlock_write_give(uH->handle);
+
+    return true;
+  }
+
+
+  //! @brief Unpack an RTDE output data package holding RTDE_OUTPUTS
+  //!
+  bool parseRTDE (char *payload, int length, int recipe, urFeedback &fb)
+  {
+    const char *src = payload + 1;
+
+    if (length < (int)RTDE_OUTPUT_BYTES || (unsigned char)payload[0] != recipe)
+    {
+      return false;
+    }
+
+    crpi_load_be_vector6(src, fb.pose);
+    crpi_load_be_vector6(src + (6 * sizeof(double)), fb.axes);
+    crpi_load_be_vector6(src + (12 * sizeof(double)), fb.forces);
+    crpi_load_be_vector6(src + (18 * sizeof(double)), fb.speeds);
+
+    //! Digital input bits (UINT64).  Only the low CRPI_IO_MAX bits are used.
+    fb.dio = (unsigned int)(crpi_load_be64(src + (24 * sizeof(double))) & 0xFFFFFFFF);
+
+    //! Controller time (s since the controller started)
+    fb.time = crpi_load_be_double(src + (25 * sizeof(double)));
+
+    //! Joint speeds
+    crpi_load_be_vector6(src + (26 * sizeof(double)), fb.axisSpeeds);
+
+    return true;
+  }
+
+
+  //! @brief Unpack an RTDE output data package of guarded search results into the handler
+  //!
+  bool parseSearch (char *payload, int length, universalHandler *uH)
+  {
+    const char *src = payload + 1;
+
+    if (uH->rtdeSearchRecipe < 0 || length < (int)RTDE_SEARCH_BYTES ||
+        (unsigned char)payload[0] != uH->rtdeSearchRecipe)
+    {
+      return false;
+    }
+
+    ulapi_rwlock_write_take(uH->handle);
+    uH->searchReason = crpi_load_be32(src);
+    uH->searchRun = crpi_load_be32(src + 4);
+    crpi_load_be_vector6(src + 8, uH->searchPose);
+    ulapi_rwlock_write_give(uH->handle);
+
+    return true;
+  }
+
+
+  //! @brief Alternative to feedbackThread that receives robot state over RTDE at the configured rate
+  //!
+  void rtdeThread (void *param)
+  {
+    universalHandler *uH = (universalHandler*)param;
+    char *buffer;
+    int get, size, recipe = -1;
+    int held = 0;
+    int backoff = UR_BACKOFF_MIN;
+    double lastRx = 0.0, arrived;
+    bool connected = false;
+    urFeedback fb;
+    int test = 0x01234567;
+    bool little = (((char*)&test)[0] == 0x67);
+
+    buffer = new char[2 * RTDE_MAX_PACKAGE];
+    void *poller = ulapi_poller_new();
+
+    ulapi_integer client = 0;
+    while (uH->runThread)
+    {
+      if (client <= 0)
+      {
+        client = ulapi_socket_get_client_id (UR_RTDE_PORT, uH->params.tcp_ip_addr);
+        if (client > 0)
+        {
+          ulapi_socket_set_nonblocking(client);
+          if (!rtdeSetup(uH, client, recipe, little, buffer, held))
+          {
+            ulapi_socket_close(client);
+            client = 0;
+          }
+        }
+        if (client <= 0)
+        {
+          //! Controller unavailable or refused the session.  Back off before trying again.
+#ifdef WIN32
+          Sleep (backoff);
+#else
+          usleep (backoff * 1000);
+#endif
+          backoff = ((backoff * 2) > UR_BACKOFF_MAX) ? UR_BACKOFF_MAX : (backoff * 2);
+          continue;
+        }
+        ulapi_socket_set_timestamps(client, ULAPI_STAMP_KERNEL);
+        ulapi_poller_add(poller, client, ULAPI_POLL_READ, NULL);
+        lastRx = ulapi_time();
+        if (connected)
+        {
+          uH->feedbackReconnectMetric->Inc();
+        }
+        connected = true;
+      }
+
+      get = ulapi_socket_read_stamped(client, buffer + held, (2 * RTDE_MAX_PACKAGE) - held, &arrived);
+
+      if (get == 0 || (get < 0 && (ulapi_time() - lastRx) > UR_STALE_TIMEOUT))
+      {
+        //! Connection closed by the controller, or nothing heard for too long.  Start over.
+        ulapi_rwlock_write_take(uH->handle);
+        uH->rtdeClient = 0;
+        uH->rtdeInputRecipe = -1;
+        uH->rtdeSearchRecipe = -1;
+        ulapi_rwlock_write_give(uH->handle);
+        ulapi_poller_remove(poller, client);
+        ulapi_socket_close(client);
+        client = 0;
+        continue;
+      }
+
+      if (get < 0)
+      {
+        waitForFeedback(poller, lastRx);
+        continue;
+      }
+
+      held += get;
+      lastRx = arrived;
+
+      while ((size = rtdeFrame(buffer, held)) > 0)
+      {
+        CRPI_NO_ALLOC_SCOPE("CrpiUniversal RTDE frame");
+        if (buffer[2] == RTDE_DATA_PACKAGE &&
+            parseRTDE(buffer + 3, size - 3, recipe, fb))
+        {
+          //! Store feedback from robot
+          publishFeedback(uH, fb, lastRx);
+          backoff = UR_BACKOFF_MIN;
+        }
+        else if (buffer[2] == RTDE_DATA_PACKAGE)
+        {
+          parseSearch(buffer + 3, size - 3, uH);
+        }
+
+        held -= size;
+        if (held > 0)
+        {
+          memmove(buffer, buffer + size, held);
+        }
+      }
+
+      if (size < 0)
+      {
+        //! Lost framing.  Reconnect to resynchronize.
+        uH->droppedMetric->Inc();
+        ulapi_rwlock_write_take(uH->handle);
+        uH->rtdeClient = 0;
+        uH->rtdeInputRecipe = -1;
+        uH->rtdeSearchRecipe = -1;
+        ulapi_rwlock_write_give(uH->handle);
+        ulapi_poller_remove(poller, client);
+        ulapi_socket_close(client);
+        client = 0;
+        held = 0;
+      }
+    } // while (uH->runThread)
+
+    if (client > 0)
+    {
+      rtdeSend(client, RTDE_CONTROL_PACKAGE_PAUSE, NULL, 0);
+      ulapi_poller_remove(poller, client);
+      ulapi_socket_close(client);
+    }
+    ulapi_poller_delete(poller);
+    delete [] buffer;
+    return;
+  }
+
+
+  LIBRARY_API UrScriptTemplate::UrScriptTemplate ()
+  {
+    text_.push_back (string());
+  }
+
+
+  LIBRARY_API void UrScriptTemplate::compile (const char *text)
+  {
+    const char *start = text, *slot;
+
+    text_.clear();
+    while ((slot = strchr(start, '$')) != NULL)
+    {
+      text_.push_back (string(start, slot - start));
+      start = slot + 1;
+    }
+    text_.push_back (string(start));
+  }
+
+
+  LIBRARY_API int UrScriptTemplate::slots () const
+  {
+    return (int) text_.size() - 1;
+  }
+
+
+  LIBRARY_API void UrScriptTemplate::render (const double *values, string &out) const
+  {
+    char number[32];
+    int length;
+
+    out.clear();
+    for (size_t i = 0; i + 1 < text_.size(); ++i)
+    {
+      out += text_[i];
+      //! %g with the default precision of 6 matches operator<< on a default stringstream
+#ifdef WIN32
+      length = _snprintf(number, sizeof(number), "%g", values[i]);
+#else
+      length = snprintf(number, sizeof(number), "%g", values[i]);
+#endif
+      out.append (number, (length > 0 && length < (int) sizeof(number)) ? length : 0);
+    }
+    out += text_.back();
+  }
+
+
+  //! @brief Rotation matrix of Euler angles (xr, yr, zr), as matrix::rotEulerMatrixConvert
+  //!
+  static void eulerToMatrix (double xr, double yr, double zr, Mat<3, 3> &m)
+  {
+    double sa, sb, sg;
+    double ca, cb, cg;
+
+    sinCos(zr, sa, ca);
+    sinCos(yr, sb, cb);
+    sinCos(xr, sg, cg);
+
+    m.at(0, 0) = ca * cb;
+    m.at(0, 1) = ca * sb * sg - sa * cg;
+    m.at(0, 2) = ca * sb * cg + sa * sg;
+    m.at(1, 0) = sa * cb;
+    m.at(1, 1) = sa * sb * sg + ca * cg;
+    m.at(1, 2) = sa * sb * cg - ca * sg;
+    m.at(2, 0) = -sb;
+    m.at(2, 1) = cb * sg;
+    m.at(2, 2) = cb * cg;
+  }
+
+
+  //! @brief Euler angles of a rotation matrix, as matrix::rotMatrixEulerConvert
+  //!
+  static void matrixToEuler (const Mat<3, 3> &m, double &xr, double &yr, double &zr)
+  {
+    yr = atan2(-(m.at(2, 0)), sqrt((m.at(0, 0) * m.at(0, 0)) + (m.at(1, 0) * m.at(1, 0))));
+
+    if (fabs(yr - 1.57079632679489661923f) < 1.0e-4)
+    {
+      xr = atan2 (m.at(0, 1), m.at(1, 1));
+      yr = 1.57079632679489661923f;
+      zr = 0.0f;
+    }
+    else if (fabs(yr + 1.57079632679489661923f) < 1.0e-4)
+    {
+      xr = -atan2(m.at(0, 1), m.at(1, 1));
+      yr = -1.57079632679489661923f;
+      zr = 0.0f;
+    }
+    else
+    {
+      xr = atan2(m.at(2, 1), m.at(2, 2));
+      zr = atan2(m.at(1, 0), m.at(0, 0));
+    }
+  }
+
+
+  //! @brief Rotation matrix of an axis-angle vector, as matrix::rotAxisAngleMatrixConvert
+  //!
+  static void axisAngleToMatrix (double x, double y, double z, Mat<3, 3> &m)
+  {
+    double d = sqrt((x * x) + (y * y) + (z * z));
+    double c, s, bigC;
+
+    x /= d;
+    y /= d;
+    z /= d;
+    sinCos(d, s, c);
+    bigC = 1.0f - c;
+
+    m.at(0,0) = (x * x * bigC) + c;
+    m.at(0,1) = (x * y * bigC) - (z * s);
+    m.at(0,2) = (x * z * bigC) + (y * s);
+    m.at(1,0) = (y * x * bigC) + (z * s);
+    m.at(1,1) = (y * y * bigC) + c;
+    m.at(1,2) = (y * z * bigC) - (x * s);
+    m.at(2,0) = (z * x * bigC) - (y * s);
+    m.at(2,1) = (z * y * bigC) + (x * s);
+    m.at(2,2) = (z * z * bigC) + c;
+  }
+
+
+  //! @brief Axis-angle vector of a rotation matrix, as matrix::rotMatrixAxisAngleConvert
+  //!
+  static void matrixToAxisAngle (const Mat<3, 3> &m, double &x, double &y, double &z)
+  {
+    double angle = acos((m.at(0, 0) + m.at(1, 1) + m.at(2, 2) - 1.0f) / 2.0f);
+    double v1 = m.at(2,1) - m.at(1,2),
+           v2 = m.at(0,2) - m.at(2,0),
+           v3 = m.at(1,0) - m.at(0,1);
+    double div = sqrt((v1 * v1) + (v2 * v2) + (v3 * v3));
+
+    x = (v1 / div) * angle;
+    y = (v2 / div) * angle;
+    z = (v3 / div) * angle;
+  }
+
+
+  //! @brief Fill the members of a mount transform from a homogeneous mount matrix
+  //!
+  //! @param m      The mount matrix (forward_ or backward_)
+  //! @param scale  Factor applied to the matrix's positions:  output length units per input
+  //!               length unit
+  //! @param offset Factor applied to the matrix's offset:  output length units per meter
+  //! @param angle  Factor applied to angles on the client's side of the transform
+  //! @param rot    The transform's rot, pos, offset, and angle, populated by this function
+  //!
+  static void buildMountTransform (matrix &m, double scale, double offset, double angle,
+                                   Mat<3, 3> &rot, Mat<3, 3> &pos, double *off, double &ang)
+  {
+    for (int x = 0; x < 3; ++x)
+    {
+      for (int y = 0; y < 3; ++y)
+      {
+        rot.at(x, y) = m.at(x, y);
+        pos.at(x, y) = m.at(x, y) * scale;
+      }
+      off[x] = m.at(x, 3) * offset;
+    }
+    ang = angle;
+  }
+
+
+  LIBRARY_API CrpiUniversal::CrpiUniversal (CrpiRobotParams &params) :
+    mountActive_(0),
+    firstIO_(true)
+  {
+    double Xtheta, Ytheta, Ztheta;
+    params_ = params;
+    handle_.params = params_;
+    
+    maxSpeed_ = 1.0f;
+    maxAccel_ = 3.0f;
+
+    //! These are nominal values defined by trial and error.  Use the SetAbsoluteSpeed and
+    //! SetAbsoluteAcceleration commands to override
+    speed_ = 1.0f;
+    acceleration_ = 0.2f;
+
+    mssgBuffer_ = new char[8192];
+    ulapi_init();
+
+    //! Poses were always converted from degrees, whatever the angle units, before the mount
+    //! transform honored SetAngleUnits
+    angleUnits_ = DEGREE;
+    lengthUnits_ = METER;
+    for (int i = 0; i < 6; ++i)
+    {
+      axialUnits_[i] = RADIAN;
+    }
+
+    keepalive_ = -1;
+    handle_.handle = ulapi_rwlock_new();
+    handle_.TCPIPhandle = ulapi_fastlock_new();
+    handle_.stateMutex = ulapi_mutex_new(19);
+    ulapi_lock_name(handle_.handle, "CrpiUniversal state");
+    ulapi_lock_name(handle_.TCPIPhandle, "CrpiUniversal command");
+    ulapi_lock_name(handle_.stateMutex, "CrpiUniversal feedback");
+    handle_.rob = this;
+    handle_.runThread = true;
+    handle_.poseGood = false;
+    handle_.stateTime = 0.0;
+    handle_.stateCount = 0;
+    handle_.stateCond = ulapi_cond_new(21);
+    handle_.rtdeClient = 0;
+    handle_.rtdeInputRecipe = -1;
+    handle_.rtdeSearchRecipe = -1;
+    handle_.nextWatch = 0;
+    handle_.watchLock = ulapi_fastlock_new();
+    ulapi_lock_name(handle_.watchLock, "CrpiUniversal watches");
+    handle_.statusPoller = ulapi_poller_new();
+    dashboard_ = 0;
+    dashboardLock_ = ulapi_fastlock_new();
+    ulapi_lock_name(dashboardLock_, "CrpiUniversal dashboard");
+    handle_.searchReason = SEARCH_RUNNING;
+    handle_.searchRun = 0;
+    for (int i = 0; i < 6; ++i)
+    {
+      handle_.searchPose[i] = 0.0;
+    }
+    searchRun_ = 0;
+    setpointSeq_ = 0;
+    streaming_ = false;
+    wrenchStreaming_ = false;
+    streamPeriod_ = 0.008;
+    streamLookahead_ = 0.1;
+    streamGain_ = 300.0;
+    streamDeadline_ = 0.5;
+    streamVelocity_ = false;
+    earlyRelease_ = false;
+    commandLatency_ = 0.0;
+    useRTDE_ = (strcmp(params_.feedback_protocol, "RTDE") == 0);
+    handle_.curTool = -1;
+
+    //! Fixed program text, filled with the numeric values of each command
+    moveTemplate_[0].compile ("def myProg():\nmovej(p[$, $, $, $, $, $], v=$)\nend\n");
+    moveTemplate_[1].compile ("def myProg():\nmovej([$, $, $, $, $, $], v=$)\nend\n");
+    moveTemplate_[2].compile ("def myProg():\nmovel(p[$, $, $, $, $, $], v=$)\nend\n");
+    tcpTemplate_.compile ("def myProg():\nset_tcp(p[$, $, $, $, $, $])\nend\n");
+    payloadTemplate_.compile ("def myProg():\nset_payload($, ($, $, $))\nend\n");
+    string force = "def myProg():\n"
+                   "def myFunk():\n"
+                   "  thread Force_properties_calculation_thread_1():\n"
+                   "    while (True):\n"
+                   "      force_mode(tool_pose(), [0, 0, 1, 0, 0, 0], [0.0, 0.0, 30.0, 0.0, 0.0, 0.0], 2, [0.2, 0.2, 0.2, 0.17453292519943295, 0.17453292519943295, 0.17453292519943295])\n"
+                   "      sync()\n"
+                   "    end\n"
+                   "  end\n"
+                   "  global thread_handler_1 = run Force_properties_calculation_thread_1()\n"
+                   "  global X = $\n"
+                   "  global Y = $\n"
+                   "  global Z = $\n"
+                   "  global XR = $\n"
+                   "  global YR = $\n"
+                   "  global ZR = $\n";
+    forceTemplate_.compile ((force + "  kill thread_handler_1\nend\nend\n").c_str());
+    forceMoveTemplate_.compile ((force + "  movej(p[X, Y, Z, XR, YR, ZR], a=0.39, v=0.25)\n"
+                                         "  kill thread_handler_1\nend\nend\n").c_str());
+
+    //! Connect to UR server
+    handle_.clientID = -1;
+    handle_.connectTime = 0.0;
+    handle_.sendLatency = handle_.worstLatency = 0.0;
+    handle_.reconnects = 0;
+    string labels = CrpiMetrics::Label("driver", "universal") + "," +
+                    CrpiMetrics::Label("robot", params_.tcp_ip_addr);
+    handle_.framesMetric = CrpiMetrics::Counter("crpi_feedback_frames", "Feedback frames published", labels);
+    handle_.droppedMetric = CrpiMetrics::Counter("crpi_feedback_dropped", "Feedback frames dropped", labels);
+    handle_.rateMetric.gauge = CrpiMetrics::Gauge("crpi_feedback_rate_hz", "Feedback frames published per second",
+                                                  labels);
+    handle_.feedbackReconnectMetric = CrpiMetrics::Counter("crpi_reconnects", "Connections re-established",
+                                                           labels + ",link=\"feedback\"");
+    handle_.commandReconnectMetric = CrpiMetrics::Counter("crpi_reconnects", "Connections re-established",
+                                                          labels + ",link=\"command\"");
+    handle_.lockWaitMetric = CrpiMetrics::Histogram("crpi_lock_wait_seconds", "Time spent waiting for a lock",
+                                                    labels + ",lock=\"command\"");
+    earlyReleaseMetric_ = CrpiMetrics::Counter("crpi_early_releases",
+                                               "Blocking moves returned before arrival to hide the next command's latency",
+                                               labels);
+    handle_.recordChannel = CrpiRecorder::Channel(string("universal/") + params_.tcp_ip_addr);
+    handle_.clock = new CrpiTimeSync((string("universal/") + params_.tcp_ip_addr).c_str());
+    ulapi_fastlock_take(handle_.TCPIPhandle);
+    commandConnect(&handle_);
+    ulapi_fastlock_give(handle_.TCPIPhandle);
+    handle_.commands = new CrpiCommandQueue((string("universal/") + params_.tcp_ip_addr).c_str(),
+                                            writeCommands, &handle_);
+    task = SensorHub::Instance().StartLoop((useRTDE_ ? rtdeThread : feedbackThread), &handle_, HUB_SENSOR,
+                                           params_.servo_task);
+    statusTask_ = SensorHub::Instance().StartLoop(statusThread, &handle_, HUB_MONITOR);
+
+    while (handle_.poseGood != true)
+    {
+#ifdef WIN32
+    Sleep (100);
+#else
+    usleep(100000);
+#endif 
+      //Sleep(100);
+    }
+
+    keepalive_ = SensorHub::Instance().AddPeriodic(livemanUniversal, &handle_, UR_KEEPALIVE, HUB_MONITOR);
+
+    pin_ = new matrix(3,1);
+    pout_ = new matrix(3,1);
+
+    forward_ = new matrix(4, 4);
+    backward_ = new matrix(4, 4);
+    matrix r(3, 3);
+
+    Xtheta = params_.mounting->xrot * (3.141592654 / 180.0f);
+    Ytheta = params_.mounting->yrot * (3.141592654 / 180.0f);
+    Ztheta = params_.mounting->zrot * (3.141592654 / 180.0f);
+        
+    vector<double> vtemp;
+    vtemp.push_back(Xtheta);
+    vtemp.push_back(Ytheta);
+    vtemp.push_back(Ztheta);
+
+    r.rotEulerMatrixConvert(vtemp);
+    //! Copy rotation matrix to homogeneous transformation matrix
+    for (int x = 0; x < 3; ++x)
+    {
+      for (int y = 0; y < 3; ++y)
+      {
+        forward_->at(x, y) = r.at(x, y);
+      }
+    }
+    forward_->at(0, 3) = params_.mounting->x;
+    forward_->at(1, 3) = params_.mounting->y;
+    forward_->at(2, 3) = params_.mounting->z;
+    forward_->at(3, 3) = 1.0f;
+    *backward_ = forward_->inv(); //JAM forward_->matrixInv(*forward_, *backward_); // 
+
+    buildMountTransform(*backward_, 1.0f, 1.0f, 1.0f,
+                        toMountRaw_.rot, toMountRaw_.pos, toMountRaw_.offset, toMountRaw_.angle);
+    buildMountTransform(*forward_, 1.0f, 1.0f, 1.0f,
+                        fromMountRaw_.rot, fromMountRaw_.pos, fromMountRaw_.offset, fromMountRaw_.angle);
+    updateMountCache();
+  }
+
+
+  LIBRARY_API CrpiUniversal::~CrpiUniversal ()
+  {
+    handle_.runThread = false;
+    SensorHub::Instance().RemovePeriodic(keepalive_);
+    ulapi_poller_wake(handle_.statusPoller);
+    SensorHub::Instance().JoinLoop(statusTask_);
+    ulapi_poller_delete(handle_.statusPoller);
+    if (dashboard_ > 0)
+    {
+      ulapi_socket_close(dashboard_);
+    }
+    delete handle_.commands;
+    ulapi_fastlock_take(handle_.TCPIPhandle);
+    if (handle_.clientID > 0)
+    {
+      ulapi_socket_close(handle_.clientID);
+      handle_.clientID = -1;
+    }
+    ulapi_fastlock_give(handle_.TCPIPhandle);
+    delete forward_;
+    delete backward_;
+    delete pin_;
+    delete pout_;
+    delete handle_.clock;
+  }
+
+  LIBRARY_API CanonReturn CrpiUniversal::ApplyCartesianForceTorque (robotPose &robotForceTorque, const vector<bool> &activeAxes, const vector<bool> &manipulator)
+  {
+    //! TODO
+    return CANON_FAILURE;
+  }
+
+  LIBRARY_API CanonReturn CrpiUniversal::ApplyJointTorque (robotAxes &robotJointTorque)
+  {
+    //! TODO
+    return CANON_FAILURE;
+  }
+
+  LIBRARY_API CanonReturn CrpiUniversal::SetTool (double percent)
+  {
+    //! There is no automatic handler on the UR side for generic tool actuation.  Use the digital output
+    //! command for binary controller-based actuation (e.g., pneumatic parallel).
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiUniversal::Couple (const char *targetID)
+  {
+    std::vector<CrpiToolDef>::const_iterator itr;
+    int tool = params_.findTool(targetID);
+    double com[3] = {0.0, 0.0, 0.0}, tcp[6];
+    if (tool == CRPI_NO_HANDLE)
+    {
+      handle_.curTool = -1;
+      handle_.wrench.SetTool(0.0, com);
+      return CANON_FAILURE;
+    }
+    itr = params_.tools.begin() + tool;
+    handle_.curTool = tool;
+    vector<double> target;
+
+    //! Tool load for wrench compensation, in the same units as below
+    com[0] = itr->centerMass.x / 1000.0f;
+    com[1] = itr->centerMass.y / 1000.0f;
+    com[2] = itr->centerMass.z / 1000.0f;
+    tcp[0] = itr->TCP.x / 1000.0f;
+    tcp[1] = itr->TCP.y / 1000.0f;
+    tcp[2] = itr->TCP.z / 1000.0f;
+    tcp[3] = itr->TCP.xrot;
+    tcp[4] = itr->TCP.yrot;
+    tcp[5] = itr->TCP.zrot;
+    handle_.wrench.SetTool(itr->mass, com, tcp);
+
+    //! TODO:  Fix this to use the correct units instead of assuming values in mm
+    target.push_back (itr->TCP.x / 1000.0f);
+    target.push_back (itr->TCP.y / 1000.0f);
+    target.push_back (itr->TCP.z / 1000.0f);
+    target.push_back (itr->TCP.xrot);
+    target.push_back (itr->TCP.yrot);
+    target.push_back (itr->TCP.zrot);
+
+
+    //! Tool definition found
+    if (generateParameter('T', 'D', target))
+    {
+      //cout << "sending..." << endl;
+      //cout << handle_.moveMe.str().c_str();
+      if (send())
+      {
+        //! Okay
+      }
+      else
+      {
+        //! Oops
+        return CANON_FAILURE;
+      }
+    }
+
+#ifdef WIN32
+    Sleep(500);
+#else
+    usleep(500000);
+#endif
+
+    target.clear();
+    target.push_back (itr->mass);
+    target.push_back (itr->centerMass.x / 1000.0f);
+    target.push_back (itr->centerMass.y / 1000.0f);
+    target.push_back (itr->centerMass.z / 1000.0f);
+    
+    //! Tool definition found
+    if (generateParameter('T', 'C', target))
+    {
+      if (send())
+      {
+        //! Okay
+        
+      }
+      else
+      {
+        //! Oops
+        return CANON_FAILURE;
+      }
+    }
+
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiUniversal::Message (const char *message)
+  {
+    ulapi_rwlock_write_take(handle_.handle);
+    handle_.moveMe.str(string());
+    handle_.moveMe << "def myProg():\n";
+    handle_.moveMe << "popup(\"" << message << "\", title='CRPI Message', warning=False, error=False)\n";
+    handle_.moveMe << "end\n";
+    ulapi_rwlock_write_give(handle_.handle);
+
+    //! Send message to robot
+    if (!send())
+    {
+      //! error sending
+      return CANON_FAILURE;
+    }
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiUniversal::MoveStraightTo (robotPose &pose, bool useBlocking)
+  {
+    //! Construct message
+    vector<double> target;
+    robotPose temp;
+
+    transformToMount(pose, temp);
+    target.push_back (temp.x);
+    target.push_back (temp.y);
+    target.push_back (temp.z);
+    target.push_back (temp.xrot);
+    target.push_back (temp.yrot);
+    target.push_back (temp.zrot);
+    CRPI_LOG(CRPI_LOG_DEBUG, "MoveStraightTo " CRPI_LOG_POSE, CRPI_LOG_POSE_ARGS(pose));
+
+    //! LIN, Cartesian, Absolute
+    double sent = ulapi_time();
+    if (generateMove ('L', 'C', 'A', target))
+    {
+      //! Send message to robot
+      if (!send())
+      {
+        //! error sending
+        return CANON_FAILURE;
+      }
+      //! ROBOT DOES NOT BLOCK:  WAIT FOR RESPONSE
+      if (useBlocking && !waitForPose (temp, true, sent))
+      {
+        return CANON_FAILURE;
+      }
+    }
+    else
+    {
+      //! Error generating motion message
+      return CANON_FAILURE;
+    }
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiUniversal::MoveThroughTo (robotPose *poses,
+                                                        int numPoses,
+                                                        robotPose *accelerations,
+                                                        robotPose *speeds,
+                                                        robotPose *tolerances)
+  {
+    vector<double> targets, accels, vels, radii;
+    robotPose temp;
+    double scale = 1.0f, val;
+    int x;
+
+    if (poses == NULL || numPoses < 1)
+    {
+      return CANON_REJECT;
+    }
+
+    //! URScript lengths are in meters
+    if (lengthUnits_ == MM)
+    {
+      scale = 0.001f;
+    }
+    else if (lengthUnits_ == INCH)
+    {
+      scale = 1.0f / 39.3701f;
+    }
+
+    radii.resize (numPoses);
+    crpi_blend_radii (poses, numPoses, tolerances, (CRPI_DEFAULT_BLEND_MM * 0.001f) / scale, &radii[0]);
+
+    for (x = 0; x < numPoses; ++x)
+    {
+      transformToMount(poses[x], temp);
+      targets.push_back (temp.x);
+      targets.push_back (temp.y);
+      targets.push_back (temp.z);
+      targets.push_back (temp.xrot);
+      targets.push_back (temp.yrot);
+      targets.push_back (temp.zrot);
+
+      //! Per-waypoint profiles apply to this move only; the defaults are left unchanged
+      val = (accelerations != NULL) ? (crpi_translation_norm (accelerations[x]) * scale) : 0.0f;
+      accels.push_back ((val > 0.0f) ? val : acceleration_);
+      val = (speeds != NULL) ? (crpi_translation_norm (speeds[x]) * scale) : 0.0f;
+      vels.push_back ((val > 0.0f) ? val : speed_);
+      radii.at(x) *= scale;
+    }
+
+    if (!generateBlendedMove (targets, accels, vels, radii))
+    {
+      //! Error generating motion message
+      return CANON_FAILURE;
+    }
+
+    //! Send message to robot
+    if (!send())
+    {
+      //! error sending
+      return CANON_FAILURE;
+    }
+
+    //! ROBOT DOES NOT BLOCK:  WAIT FOR THE FINAL POSE ONLY
+    return waitForPose (temp, true) ? CANON_SUCCESS : CANON_FAILURE;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiUniversal::MoveTo (robotPose &pose, bool useBlocking)
+  {
+    //! Construct message
+    vector<double> target;
+    robotPose temp = pose;
+
+    transformToMount(pose, temp);
+    target.push_back (temp.x);
+    target.push_back (temp.y);
+    target.push_back (temp.z);
+    target.push_back (temp.xrot);
+    target.push_back (temp.yrot);
+    target.push_back (temp.zrot);
+
+/*
+    if (lengthUnits_ == MM)
+    {
+      temp.x *= 0.001f;
+      temp.y *= 0.001f;
+      temp.z *= 0.001f;
+    }
+    else if (lengthUnits_ == INCH)
+    {
+      //! TODO: CONVERT TO METERS
+    }
+
+    if (angleUnits_ == DEGREE)
+    {
+      temp.xrot *= (3.141592654f / 180.0f);
+      temp.yrot *= (3.141592654f / 180.0f);
+      temp.zrot *= (3.141592654f / 180.0f);
+    }
+
+    pin_->at(0,0) = temp.x;
+    pin_->at(1,0) = temp.y;
+    pin_->at(2,0) = temp.z;
+    pin_->matrixMult (*backward_, *pin_, *pout_);
+    temp.x = pout_->at(0,0);
+    temp.y = pout_->at(1,0);
+    temp.z = pout_->at(2,0);
+
+    target.push_back (temp.x);
+    target.push_back (temp.y);
+    target.push_back (temp.z);
+    target.push_back (temp.xrot);
+    target.push_back (temp.yrot);
+    target.push_back (temp.zrot);
+*/
+    //! PTP, Cartesian, Absolute
+    //if (generateMove ('P', 'C', 'R', target))
+    double sent = ulapi_time();
+    if (generateMove ('P', 'C', 'A', target))
+    {
+      //! Send message to robot
+      if (!send())
+      {
+        //! error sending
+        return CANON_FAILURE;
+      }
+      //! ROBOT DOES NOT BLOCK:  WAIT FOR RESPONSE
+      if (useBlocking && !waitForPose (temp, false, sent))
+      {
+        return CANON_FAILURE;
+      }
+    }
+    else
+    {
+      //! Error generating motion message
+      return CANON_FAILURE;
+    }
+
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiUniversal::GetRobotAxes (robotAxes *axes)
+  {
+    RobotStateSnapshot snap;
+
+    handle_.state.read(snap);
+    snap.getAxes(*axes);
+
+    for (int i = 0; i < 6; ++i)
+    {
+//      if (axialUnits_[i] == DEGREE)
+      {
+        axes->axis.at(i) *= (180.0f / 3.141592654f);
+      }
+    }
+
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiUniversal::GetRobotForces (robotPose *forces)
+  {
+    robotPose temp;
+
+    RobotStateSnapshot snap;
+
+    handle_.state.read(snap);
+    *forces = snap.forces;
+    
+    transformFromMount(snap.forces, temp, false);
+
+    forces->x = temp.x;
+    forces->y = temp.y;
+    forces->z = temp.z;
+    forces->xrot = temp.xrot;
+    forces->yrot = temp.yrot;
+    forces->zrot = temp.zrot;
+
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiUniversal::GetRobotIO (robotIO *io)
+  {
+    RobotStateSnapshot snap;
+
+    handle_.state.read(snap);
+    snap.getIO(*io);
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiUniversal::GetRobotPose (robotPose *pose)
+  {
+    robotPose temp;
+
+    RobotStateSnapshot snap;
+
+    handle_.state.read(snap);
+    *pose = snap.pose;
+
+    CRPI_LOG(CRPI_LOG_DEBUG, "raw: " CRPI_LOG_POSE, CRPI_LOG_POSE_ARGS(snap.pose));
+    
+    transformFromMount(snap.pose, temp);
+  
+    pose->x = temp.x;
+    pose->y = temp.y;
+    pose->z = temp.z;
+    pose->xrot = temp.xrot;
+    pose->yrot = temp.yrot;
+    pose->zrot = temp.zrot;
+
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiUniversal::GetRobotSpeed (robotPose *speed)
+  {    
+    robotPose temp;
+    
+    RobotStateSnapshot snap;
+
+    handle_.state.read(snap);
+    *speed = snap.speeds;
+    
+    transformFromMount(snap.speeds, temp);
+   
+    speed->x = temp.x;
+    speed->y = temp.y;
+    speed->z = temp.z;
+    speed->xrot = temp.xrot;
+    speed->yrot = temp.yrot;
+    speed->zrot = temp.zrot;
+
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiUniversal::GetRobotSpeed (robotAxes *speed)
+  {
+    urAxisSpeeds axisSpeeds;
+
+    handle_.axisSpeeds.read(axisSpeeds);
+    speed->axes = 6;
+    for (int i = 0; i < 6; ++i)
+    {
+      speed->axis.at(i) = axisSpeeds.speeds[i] * (180.0f / 3.141592654f);
+    }
+
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiUniversal::GetRobotTorques (robotAxes *torques)
+  {
+    RobotStateSnapshot snap;
+
+    handle_.state.read(snap);
+    snap.getAxes(*torques);
+
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiUniversal::GetRobotState (RobotStateSnapshot *state)
+  {
+    if (handle_.state.read(*state) == 0)
+    {
+      return CANON_REJECT;
+    }
+    convertState(state);
+
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiUniversal::GetPredictedState (RobotStateSnapshot *state, double lead)
+  {
+    urAxisSpeeds axisSpeeds;
+    Mat<3, 3> r, turn;
+    double dt, rx, ry, rz;
+    int i;
+
+    //! The joint speeds are published just before their state, so a state newer than the
+    //! speeds read first was published in between; read both again
+    for (i = 0; i < 3; ++i)
+    {
+      handle_.axisSpeeds.read(axisSpeeds);
+      if (handle_.state.read(*state) == 0)
+      {
+        return CANON_REJECT;
+      }
+      if (axisSpeeds.sequence == state->sequence)
+      {
+        break;
+      }
+    }
+
+    dt = (ulapi_time() + lead) - state->timestamp;
+    dt = (dt < 0.0) ? 0.0 : ((dt > UR_PREDICT_MAX) ? UR_PREDICT_MAX : dt);
+
+    //! Extrapolate in the controller's units (m, rad) before converting:  the TCP speed is the
+    //! linear and angular velocity in the base frame, so the orientation is turned about the
+    //! angular velocity
+    state->pose.x += state->speeds.x * dt;
+    state->pose.y += state->speeds.y * dt;
+    state->pose.z += state->speeds.z * dt;
+    rx = state->speeds.xrot * dt;
+    ry = state->speeds.yrot * dt;
+    rz = state->speeds.zrot * dt;
+    if (((rx * rx) + (ry * ry) + (rz * rz)) > 1.0e-18)
+    {
+      axisAngleToMatrix(rx, ry, rz, turn);
+      axisAngleToMatrix(state->pose.xrot, state->pose.yrot, state->pose.zrot, r);
+      r = turn * r;
+      matrixToAxisAngle(r, state->pose.xrot, state->pose.yrot, state->pose.zrot);
+    }
+
+    for (i = 0; i < state->axes && i < 6; ++i)
+    {
+      state->axis[i] += axisSpeeds.speeds[i] * dt;
+    }
+    state->timestamp += dt;
+    convertState(state);
+
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiUniversal::MoveAttractor (robotPose &pose)
+  {
+    robotPose temp, temp2, temp3;
+    robotPose curPose;
+    vector<double> target;
+    CRPI_LOG(CRPI_LOG_DEBUG, "target: " CRPI_LOG_POSE, CRPI_LOG_POSE_ARGS(pose));
+
+    GetRobotPose(&curPose);
+    CRPI_LOG(CRPI_LOG_DEBUG, "current: " CRPI_LOG_POSE, CRPI_LOG_POSE_ARGS(curPose));
+
+    transformToMount(curPose, temp2);
+    CRPI_LOG(CRPI_LOG_DEBUG, "current at base: " CRPI_LOG_POSE, CRPI_LOG_POSE_ARGS(temp2));
+
+    //! Get target pose relative to current pose, these become the X, Y and Z offsets used during force control
+    transformToMount(pose, temp3);
+    CRPI_LOG(CRPI_LOG_DEBUG, "target at base: " CRPI_LOG_POSE, CRPI_LOG_POSE_ARGS(temp3));
+    temp = temp2 - temp3;
+    CRPI_LOG(CRPI_LOG_DEBUG, "offset: " CRPI_LOG_POSE, CRPI_LOG_POSE_ARGS(temp));
+
+    target.push_back (temp3.x);
+    target.push_back (temp3.y);
+    target.push_back (temp3.z);
+    target.push_back (temp3.xrot);
+    target.push_back (temp3.yrot);
+    target.push_back (temp3.zrot);
+
+    if (generateParameter ('F', 'E', target))
+    {
+      if (send())
+      {
+        //! Okay
+        
+      }
+      else
+      {
+        //! Oops
+      }
+    }
+    else
+    {
+      CRPI_LOG(CRPI_LOG_WARNING, "CrpiUniversal:  bad force command");
+    }
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiUniversal::MoveToAxisTarget (robotAxes &axes, bool useBlocking)
+  {
+    robotAxes cur;
+    double dist, dist2, stall, last, now;
+    unsigned long seen;
+    ulapi_real tim;
+
+    //! Construct message, with the axes in the correct units
+    robotAxesN<axisCount> joints(axes);
+    const double scale = (angleUnits_ == DEGREE) ? (3.141592654f/180.0f) : 1.0;
+
+    for (int i = 0; i < axisCount; ++i)
+    {
+      joints.axis[i] *= scale;
+    }
+    vector<double> target(joints.axis.begin(), joints.axis.end());
+
+    //! PTP, Angular, Absolute
+    if (generateMove('P', 'A', 'A', target))
+    {
+      //! Send message to robot
+      if (!send())
+      {
+        //! Error sending
+        return CANON_FAILURE;
+      }
+
+      if (useBlocking)
+      {
+        //! ROBOT DOES NOT BLOCK:  WAIT FOR RESPONSE
+        dist2 = 1000.0;
+        stall = 0.0;
+        tim = last = ulapi_time();
+        ulapi_mutex_take(handle_.stateMutex);
+        seen = handle_.stateCount;
+        ulapi_mutex_give(handle_.stateMutex);
+        while (true)
+        {
+          now = ulapi_time();
+
+          GetRobotAxes(&cur);
+          dist = cur.distance(axes);
+          //cout << dist << endl;
+
+#ifdef VERIFY_MOVING
+          if (dist >= dist2)
+          {
+            stall += (now - last);
+
+            if (stall >= stallthresh)
+            {
+              //! Robot is not moving.  Retry.
+              return CANON_FAILURE;
+            }
+          }
+#endif
+
+#ifdef USE_TIMEOUT
+          if ((now - tim) > timethresh)
+          {
+            return CANON_FAILURE;
+          }
+#endif
+          //printf("d %f\n", dist);
+          if (dist <= distthresh)
+          {
+            break;
+          }
+
+          //! Wake on the next state frame rather than polling
+          waitForState(seen, UR_STATE_WAIT);
+          last = now;
+          dist2 = dist;
+        }
+      } // if (useBlocking)
+    }
+    else
+    {
+      //! Error generating motion message
+      return CANON_FAILURE;
+    }
+    return CANON_SUCCESS;
   }
 
-  LIBRARY_API CanonReturn CrpiUniversal::ApplyJointTorque (robotAxes &robotJointTorque)
+
+  LIBRARY_API CanonReturn CrpiUniversal::BeginStream ()
   {
-    //! TODO
-    return CANON_FAILURE;
+    vector<double> hold;
+
+    if (streaming_ || wrenchStreaming_ || !useRTDE_)
+    {
+      //! Register streaming needs the RTDE input registers; without them every step would
+      //! require uploading a new program
+      return CANON_REJECT;
+    }
+
+    //! Seed the registers with the current joint positions so the robot holds still until the
+    //! first setpoint arrives
+    ulapi_rwlock_read_take(handle_.handle);
+    for (int i = 0; i < 6; ++i)
+    {
+      hold.push_back(handle_.curAxes.axis.at(i));
+    }
+    ulapi_rwlock_read_give(handle_.handle);
+
+    if (!writeSetpoint(UR_SETPOINT_SERVOJ, hold))
+    {
+      return CANON_FAILURE;
+    }
+
+    if (!generateRegisterServo(streamPeriod_, streamLookahead_, streamGain_, streamDeadline_) || !send())
+    {
+      return CANON_FAILURE;
+    }
+
+    streaming_ = true;
+    return CANON_SUCCESS;
   }
 
-  LIBRARY_API CanonReturn CrpiUniversal::SetTool (double percent)
+
+  LIBRARY_API CanonReturn CrpiUniversal::StreamPose (robotPose &pose)
   {
-    //! There is no automatic handler on the UR side for generic tool actuation.  Use the digital output
-    //! command for binary controller-based actuation (e.g., pneumatic parallel).
-    return CANON_REJECT;
+    vector<double> target;
+    robotPose temp;
+
+    if (!streaming_)
+    {
+      return CANON_REJECT;
+    }
+
+    transformToMount(pose, temp);
+    target.push_back (temp.x);
+    target.push_back (temp.y);
+    target.push_back (temp.z);
+    target.push_back (temp.xrot);
+    target.push_back (temp.yrot);
+    target.push_back (temp.zrot);
+
+    return (writeSetpoint(UR_SETPOINT_SERVOL, target) ? CANON_SUCCESS : CANON_FAILURE);
   }
 
 
-  LIBRARY_API CanonReturn CrpiUniversal::Couple (const char *targetID)
+  LIBRARY_API CanonReturn CrpiUniversal::StreamAxes (robotAxes &axes)
   {
-    std::vector<CrpiToolDef>::const_iterator itr;
-    int tool = 0;
-    for (itr = params_.tools.begin(); itr != params_.tools.end(); ++itr, ++tool)
+    vector<double> target;
+
+    if (!streaming_)
+    {
+      return CANON_REJECT;
+    }
+
+    for (int i = 0; i < 6; ++i)
     {
-      if (strcmp(targetID, itr->toolName.c_str()) == 0)
+      //! Set axes to correct units
+      if (angleUnits_ == DEGREE)
       {
-        break;
+        target.push_back (axes.axis.at(i) * (3.141592654f/180.0f));
+      }
+      else
+      {
+        target.push_back (axes.axis.at(i));
       }
     }
-    if (itr == params_.tools.end())
+
+    return (writeSetpoint((streamVelocity_ ? UR_SETPOINT_SPEEDJ : UR_SETPOINT_SERVOJ), target) ? CANON_SUCCESS : CANON_FAILURE);
+  }
+
+
+  LIBRARY_API CanonReturn CrpiUniversal::EndStream ()
+  {
+    vector<double> target(6, 0.0);
+
+    if (!streaming_)
+    {
+      return CANON_REJECT;
+    }
+
+    streaming_ = false;
+    //! The resident program exits and decelerates the robot when it reads the stop mode
+    return (writeSetpoint(UR_SETPOINT_STOP, target) ? CANON_SUCCESS : CANON_FAILURE);
+  }
+
+
+  LIBRARY_API CanonReturn CrpiUniversal::BeginWrenchStream ()
+  {
+    //! Zero wrench, no axes selected, and the limits of the fixed force mode program
+    vector<double> hold(UR_SETPOINT_VALUES, 0.0);
+
+    if (streaming_ || wrenchStreaming_ || !useRTDE_)
+    {
+      return CANON_REJECT;
+    }
+
+    for (int i = 0; i < 3; ++i)
+    {
+      hold.at(6 + i) = 0.2;
+      hold.at(9 + i) = 0.17453292519943295;
+    }
+
+    if (!writeSetpoint(UR_SETPOINT_WRENCH, hold, 0))
     {
-      handle_.curTool = -1;
       return CANON_FAILURE;
     }
-    handle_.curTool = tool;
+
+    if (!generateRegisterForce(streamPeriod_, streamDeadline_) || !send())
+    {
+      return CANON_FAILURE;
+    }
+
+    wrenchStreaming_ = true;
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiUniversal::StreamWrench (robotPose &wrench, const vector<bool> &activeAxes, robotPose &limits)
+  {
     vector<double> target;
+    double length = 1.0f, angle = 1.0f;
+    int select = 0;
 
-    //! TODO:  Fix this to use the correct units instead of assuming values in mm
-    target.push_back (itr->TCP.x / 1000.0f);
-    target.push_back (itr->TCP.y / 1000.0f);
-    target.push_back (itr->TCP.z / 1000.0f);
-    target.push_back (itr->TCP.xrot);
-    target.push_back (itr->TCP.yrot);
-    target.push_back (itr->TCP.zrot);
+    if (!wrenchStreaming_)
+    {
+      return CANON_REJECT;
+    }
 
+    //! force_mode limits are in m and rad
+    if (lengthUnits_ == MM)
+    {
+      length = 0.001f;
+    }
+    else if (lengthUnits_ == INCH)
+    {
+      length = 1.0f / 39.3701f;
+    }
+    if (angleUnits_ == DEGREE)
+    {
+      angle = 3.141592654f / 180.0f;
+    }
 
-    //! Tool definition found
-    if (generateParameter('T', 'D', target))
+    for (size_t i = 0; i < activeAxes.size() && i < 6; ++i)
     {
-      //cout << "sending..." << endl;
-      //cout << handle_.moveMe.str().c_str();
-      if (send())
+      if (activeAxes.at(i))
+      {
+        select |= (1 << i);
+      }
+    }
+
+    target.push_back (wrench.x);
+    target.push_back (wrench.y);
+    target.push_back (wrench.z);
+    target.push_back (wrench.xrot);
+    target.push_back (wrench.yrot);
+    target.push_back (wrench.zrot);
+    target.push_back (limits.x * length);
+    target.push_back (limits.y * length);
+    target.push_back (limits.z * length);
+    target.push_back (limits.xrot * angle);
+    target.push_back (limits.yrot * angle);
+    target.push_back (limits.zrot * angle);
+
+    return (writeSetpoint(UR_SETPOINT_WRENCH, target, select) ? CANON_SUCCESS : CANON_FAILURE);
+  }
+
+
+  LIBRARY_API CanonReturn CrpiUniversal::EndWrenchStream ()
+  {
+    vector<double> target(UR_SETPOINT_VALUES, 0.0);
+
+    if (!wrenchStreaming_)
+    {
+      return CANON_REJECT;
+    }
+
+    wrenchStreaming_ = false;
+    //! The resident program leaves force mode and stops the robot when it reads the stop mode
+    return (writeSetpoint(UR_SETPOINT_STOP, target, 0) ? CANON_SUCCESS : CANON_FAILURE);
+  }
+
+
+  LIBRARY_API CanonReturn CrpiUniversal::SetAbsoluteAcceleration (double acceleration)
+  {
+    if (acceleration > maxAccel_ || acceleration < 0.0f)
+    {
+      return CANON_REJECT;
+    }
+
+    acceleration_ = acceleration;
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiUniversal::SetAbsoluteSpeed (double speed)
+  {
+    if (speed > maxSpeed_ || speed < 0.0f)
+    {
+      return CANON_FAILURE;
+    }
+
+    speed_ = speed;
+    return CANON_SUCCESS;
+  }
+
+  //  ("degree" or "radian")
+  LIBRARY_API CanonReturn CrpiUniversal::SetAngleUnits (const char *unitName)
+  {
+    if (strcmp(unitName, "degree") == 0)
+    {
+      angleUnits_ = DEGREE;
+    }
+    else if (strcmp(unitName, "radian") == 0)
+    {
+      angleUnits_ = RADIAN;
+    }
+    else
+    {
+      CANON_FAILURE;
+    }
+
+    updateMountCache();
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiUniversal::SetAxialSpeeds (double *speeds)
+  {
+    //! TODO
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiUniversal::SetAxialUnits (const char **unitNames)
+  {
+    //! Not yet implemented
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiUniversal::SetEndPoseTolerance (robotPose &tolerances)
+  {
+    //! Not yet implemented
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiUniversal::SetIntermediatePoseTolerance (robotPose *tolerances)
+  {
+    //! Not yet implemented
+    return CANON_REJECT;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiUniversal::SetLengthUnits (const char *unitName)
+  {
+    if (strcmp(unitName, "meter") == 0)
+    {
+      lengthUnits_ = METER;
+    }
+    else if (strcmp(unitName, "mm") == 0)
+    {
+      lengthUnits_ = MM;
+    }
+    else if (strcmp(unitName, "inch") == 0)
+    {
+      lengthUnits_ = INCH;
+    }
+    else
+    {
+      CANON_FAILURE;
+    }
+
+    updateMountCache();
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API CanonReturn CrpiUniversal::SetParameter (const char *paramName, void *paramVal)
+  {
+    if (strcmp(paramName, "guarded_search") == 0)
+    {
+      if (paramVal == NULL || streaming_ || wrenchStreaming_)
+      {
+        return CANON_REJECT;
+      }
+      return runGuardedSearch(*((crpiGuardedSearch*)paramVal));
+    }
+
+    if (strcmp(paramName, "native_program") == 0)
+    {
+      if (paramVal == NULL || ((crpiNativeProgram*)paramVal)->program == NULL || streaming_ || wrenchStreaming_)
+      {
+        return CANON_REJECT;
+      }
+      return runNative(*((crpiNativeProgram*)paramVal));
+    }
+
+    //! Tool definitions from CrpiRobot::ReloadConfig
+    if (strcmp(paramName, "tools") == 0)
+    {
+      if (paramVal == NULL)
+      {
+        return CANON_REJECT;
+      }
+      params_.tools = *((std::vector<CrpiToolDef>*)paramVal);
+      params_.reindex();
+      return CANON_SUCCESS;
+    }
+
+    //! Streaming settings take effect on the next BeginStream or BeginWrenchStream
+    if (strncmp(paramName, "stream_", 7) == 0)
+    {
+      if (paramVal == NULL || streaming_ || wrenchStreaming_)
+      {
+        return CANON_REJECT;
+      }
+      if (strcmp(paramName, "stream_period") == 0)
+      {
+        streamPeriod_ = *((double*)paramVal);
+      }
+      else if (strcmp(paramName, "stream_lookahead") == 0)
       {
-        //! Okay
+        streamLookahead_ = *((double*)paramVal);
+      }
+      else if (strcmp(paramName, "stream_gain") == 0)
+      {
+        streamGain_ = *((double*)paramVal);
+      }
+      else if (strcmp(paramName, "stream_deadline") == 0)
+      {
+        streamDeadline_ = *((double*)paramVal);
+      }
+      else if (strcmp(paramName, "stream_velocity") == 0)
+      {
+        streamVelocity_ = *((bool*)paramVal);
       }
       else
       {
-        //! Oops
-        return CANON_FAILURE;
+        return CANON_REJECT;
       }
+      return CANON_SUCCESS;
     }
 
-    Sleep(500);
+    //! Early release of blocking moves takes effect on the next move
+    if (strcmp(paramName, "early_release") == 0)
+    {
+      if (paramVal == NULL)
+      {
+        return CANON_REJECT;
+      }
+      earlyRelease_ = *((bool*)paramVal);
+      return CANON_SUCCESS;
+    }
+    if (strcmp(paramName, "command_latency") == 0)
+    {
+      if (paramVal == NULL || *((double*)paramVal) < 0.0)
+      {
+        return CANON_REJECT;
+      }
+      commandLatency_ = *((double*)paramVal);
+      return CANON_SUCCESS;
+    }
 
-    target.clear();
-    target.push_back (itr->mass);
-    target.push_back (itr->centerMass.x / 1000.0f);
-    target.push_back (itr->centerMass.y / 1000.0f);
-    target.push_back (itr->centerMass.z / 1000.0f);
-    
-    //! Tool definition found
-    if (generateParameter('T', 'C', target))
+    //! Wrench processing takes effect on the next feedback sample
+    if (strncmp(paramName, "wrench_", 7) == 0)
     {
-      if (send())
+      CrpiWrenchSettings settings;
+
+      if (paramVal == NULL)
       {
-        //! Okay
-        
+        return CANON_REJECT;
+      }
+      handle_.wrench.Settings(settings);
+      if (strcmp(paramName, "wrench_gravity") == 0)
+      {
+        handle_.wrench.SetCompensation(*((bool*)paramVal), settings.inertiaComp);
+      }
+      else if (strcmp(paramName, "wrench_inertia") == 0)
+      {
+        handle_.wrench.SetCompensation(settings.gravityComp, *((bool*)paramVal));
+      }
+      else if (strcmp(paramName, "wrench_lowpass") == 0)
+      {
+        handle_.wrench.SetLowPass(*((double*)paramVal));
+      }
+      else if (strcmp(paramName, "wrench_kalman") == 0)
+      {
+        handle_.wrench.SetKalman(*((double*)paramVal), settings.kalmanProcess);
+      }
+      else if (strcmp(paramName, "wrench_kalman_process") == 0)
+      {
+        handle_.wrench.SetKalman(settings.kalmanNoise, *((double*)paramVal));
+      }
+      else if (strcmp(paramName, "wrench_tare") == 0)
+      {
+        handle_.wrench.Tare(*((int*)paramVal));
       }
       else
       {
-        //! Oops
-        return CANON_FAILURE;
+        return CANON_REJECT;
       }
+      return CANON_SUCCESS;
     }
 
-    return CANON_SUCCESS;
-  }
+    if (strcmp(paramName, "freedrive") != 0 && strcmp(paramName, "endfreedrive") != 0)
+    {
+      return CANON_REJECT;
+    }
 
+    bool changed = false;
 
-  LIBRARY_API CanonReturn CrpiUniversal::Message (const char *message)
-  {
-    ulapi_mutex_take(handle_.handle);
     handle_.moveMe.str(string());
     handle_.moveMe << "def myProg():\n";
-    handle_.moveMe << "popup(\"" << message << "\", title='CRPI Message', warning=False, error=False)\n";
-    handle_.moveMe << "end\n";
-    ulapi_mutex_give(handle_.handle);
+    if (strcmp(paramName, "freedrive") == 0)
+    {
+      handle_.moveMe << "def myFunk():\n";
+      handle_.moveMe << "\twhile(True):\n";
+      handle_.moveMe << "\t\tfreedrive_mode()\n";
+      handle_.moveMe << "\t\tsync()\n";
+      handle_.moveMe << "\tend\n";
+      handle_.moveMe << "end\n";
+
+    }
+    else
+    {
+      //! Disable force mode
+      handle_.moveMe << "end_freedrive_mode()\n";
+    }
+    handle_.moveMe << "end\n";    
 
-    //! Send message to robot
     if (!send())
     {
       //! error sending
       return CANON_FAILURE;
     }
+
     return CANON_SUCCESS;
   }
 
 
-  LIBRARY_API CanonReturn CrpiUniversal::MoveStraightTo (robotPose &pose, bool useBlocking)
+  LIBRARY_API CanonReturn CrpiUniversal::SetRelativeAcceleration (double percent)
   {
-    //! Construct message
-    vector<double> target;
-    robotPose temp;
-    double dist, dist2, tim, dist_rot;
-    int count;
-
-    transformToMount(pose, temp);
-    target.push_back (temp.x);
-    target.push_back (temp.y);
-    target.push_back (temp.z);
-    target.push_back (temp.xrot);
-    target.push_back (temp.yrot);
-    target.push_back (temp.zrot);
-    pose.print();
-
-    //! LIN, Cartesian, Absolute
-    if (generateMove ('L', 'C', 'A', target))
-    {
-      //! Send message to robot
-      if (!send())
-      {
-        //! error sending
-        return CANON_FAILURE;
-      }
-      if (useBlocking)
-      {
-        //! ROBOT DOES NOT BLOCK:  WAIT FOR RESPONSE
-        dist2 = 1000.0;
-        count = 0;
-        tim = ulapi_time();
-        while (true)
-        {
-          ulapi_mutex_take(handle_.handle);
-          dist = handle_.curPose.distance(temp);
-          dist_rot = handle_.curPose.distance_rot(temp);
-          ulapi_mutex_give(handle_.handle);
-          //cout << "Distance:  Ang:  " << dist_rot << " New: " << dist << " Previous: " << dist2 << " Counter: " << count << " Timer: " << (ulapi_time() - tim) << endl;
-#ifdef VERIFY_MOVING
-          if (dist >= dist2)
-          {
-            ++count;
-
-            if (count >= 30)
-            {
-              //! Robot is not moving.  Retry.
-              return CANON_FAILURE;
-            }
-          }
-#endif
-
-#ifdef USE_TIMEOUT
-          if ((ulapi_time() - tim) > timethresh)
-          {
-            return CANON_FAILURE;
-          }
-#endif
-          //cout << "distance rot: " << dist_rot << endl;
-          //printf("d %f a %f\n", dist, dist_rot);
-          if (dist <= distthresh && fabs(dist_rot) <= angthresh)
-          {
-            break;
-          }
-          //Sleep(100);
-#ifdef WIN32
-          Sleep(100);
-#else
-          usleep(100000);
-#endif 
-          //        ulapi_wait(200000);
-          dist2 = dist;
-        }
-      } // if (useBlocking)  
-    }
-    else
+    if (percent > 1.0f || percent < 0.0f)
     {
-      //! Error generating motion message
       return CANON_FAILURE;
     }
+
+    acceleration_ = maxAccel_ * percent;
     return CANON_SUCCESS;
   }
 
 
-  LIBRARY_API CanonReturn CrpiUniversal::MoveThroughTo (robotPose *poses,
-                                                        int numPoses,
-                                                        robotPose *accelerations,
-                                                        robotPose *speeds,
-                                                        robotPose *tolerances)
+  LIBRARY_API CanonReturn CrpiUniversal::SetRelativeSpeed (double percent)
   {
-    bool status = true;
-
-    //! This is a temporary function definition
-    for (int x = 0; x < numPoses; ++x)
+    if (percent > 1.0f || percent < 0.0f)
     {
-      status &= (MoveTo (poses[x], true) == CANON_SUCCESS);
-      if (!status)
-      {
-        //! Error when executing multi move
-        return CANON_FAILURE;
-      }
+      return CANON_FAILURE;
     }
 
+    speed_ = maxSpeed_ * percent;
     return CANON_SUCCESS;
   }
 
 
-  LIBRARY_API CanonReturn CrpiUniversal::MoveTo (robotPose &pose, bool useBlocking)
+  LIBRARY_API CanonReturn CrpiUniversal::SetRobotIO (robotIO &io)
   {
-    //! Construct message
-    vector<double> target;
-    robotPose temp = pose;
-    double dist, dist2, tim;
-    int count;
-
-    transformToMount(pose, temp);
-    target.push_back (temp.x);
-    target.push_back (temp.y);
-    target.push_back (temp.z);
-    target.push_back (temp.xrot);
-    target.push_back (temp.yrot);
-    target.push_back (temp.zrot);
+    bool changed = false;
 
-/*
-    if (lengthUnits_ == MM)
-    {
-      temp.x *= 0.001f;
-      temp.y *= 0.001f;
-      temp.z *= 0.001f;
-    }
-    else if (lengthUnits_ == INCH)
+    handle_.moveMe.str(string());
+    handle_.moveMe << "def myProg():\n";
+    for (int x = 0; x < io.ndio; ++x)
     {
-      //! TODO: CONVERT TO METERS
+      if (firstIO_ || (curIO_.dio[x] != io.dio[x]))
+      {
+        handle_.moveMe << "set_digital_out(" << x << ", ";
+        handle_.moveMe << (io.dio[x] ? "True" : "False") << ")\n";
+        changed = true;
+      }
     }
-
-    if (angleUnits_ == DEGREE)
+    //! The control box has two analog outputs; only changes are written, in the same program
+    for (int x = 0; x < io.naio && x < 2; ++x)
     {
-      temp.xrot *= (3.141592654f / 180.0f);
-      temp.yrot *= (3.141592654f / 180.0f);
-      temp.zrot *= (3.141592654f / 180.0f);
+      if (curIO_.aio[x] != io.aio[x])
+      {
+        handle_.moveMe << "set_analog_out(" << x << ", " << io.aio[x] << ")\n";
+        changed = true;
+      }
     }
-
-    pin_->at(0,0) = temp.x;
-    pin_->at(1,0) = temp.y;
-    pin_->at(2,0) = temp.z;
-    pin_->matrixMult (*backward_, *pin_, *pout_);
-    temp.x = pout_->at(0,0);
-    temp.y = pout_->at(1,0);
-    temp.z = pout_->at(2,0);
-
-    target.push_back (temp.x);
-    target.push_back (temp.y);
-    target.push_back (temp.z);
-    target.push_back (temp.xrot);
-    target.push_back (temp.yrot);
-    target.push_back (temp.zrot);
-*/
-    //! PTP, Cartesian, Absolute
-    //if (generateMove ('P', 'C', 'R', target))
-    if (generateMove ('P', 'C', 'A', target))
+    handle_.moveMe << "end\n";
+    //! Send message to robot
+    if (changed)
     {
-      //! Send message to robot
       if (!send())
       {
         //! error sending
         return CANON_FAILURE;
       }
-      if (useBlocking)
-      {
-        //! ROBOT DOES NOT BLOCK:  WAIT FOR RESPONSE
-        dist2 = 1000.0;
-        count = 0;
-        tim = ulapi_time();
-        while (true)
-        {
-          ulapi_mutex_take(handle_.handle);
-          dist = handle_.curPose.distance(temp);
-          ulapi_mutex_give(handle_.handle);
+    }
+    //timer_.waitUntil(10);
 
-#ifdef VERIFY_MOVING
-          if (dist >= dist2)
-          {
-            ++count;
+    curIO_ = io;
+    firstIO_ = false;
 
-            if (count >= 30)
-            {
-              //! Robot is not moving.  Retry.
-              return CANON_FAILURE;
-            }
-          }
-#endif
+    return CANON_SUCCESS;
+  }
 
-#ifdef USE_TIMEOUT
-          if ((ulapi_time() - tim) > timethresh)
-          {
-            return CANON_FAILURE;
-          }
-#endif
-          //printf("d %f\n", dist);
-          if (dist <= distthresh)
-          {
-            break;
-          }
 
-#ifdef WIN32
-          Sleep(100);
-#else
-          usleep(100000);
-#endif 
-          //Sleep(100);
-  //        ulapi_wait(200000);
-          dist2 = dist;
-        }
-      } // if (useBlocking)
+  LIBRARY_API CanonReturn CrpiUniversal::SetRobotDO (int dig_out, bool val)
+  {
+    if (dig_out < 0 || dig_out >= curIO_.ndio)
+    {
+      return CANON_REJECT;
     }
-    else
+
+    handle_.moveMe.str(string());
+    handle_.moveMe << "def myProg():\n";
+    handle_.moveMe << "set_digital_out(" << dig_out << ", ";
+    handle_.moveMe << (val ? "True" : "False") << ")\n";
+    handle_.moveMe << "end\n";
+    //! Send message to robot
+    if (!send())
     {
-      //! Error generating motion message
+      //! error sending
       return CANON_FAILURE;
     }
+    curIO_.dio[dig_out] = val;
+    firstIO_ = false;
 
     return CANON_SUCCESS;
   }
 
 
-  LIBRARY_API CanonReturn CrpiUniversal::GetRobotAxes (robotAxes *axes)
+  LIBRARY_API CanonReturn CrpiUniversal::StopMotion (int condition)
   {
-    ulapi_mutex_take(handle_.handle);
-    *axes = handle_.curAxes;
+    //! stopl(acceleration).  Built apart from moveMe, so that a stop from another thread neither
+    //! waits for nor overwrites a script being built; written ahead of any queued script.
+    string script = "def myProg():\nstopl(3.0)\nend\n";
 
-    for (int i = 0; i < 6; ++i)
+    //! Send message to robot
+    if (!send(script, CMDQUEUE_STOP))
     {
-//      if (axialUnits_[i] == DEGREE)
-      {
-        axes->axis.at(i) *= (180.0f / 3.141592654f);
-      }
+      //! error sending
+      return CANON_FAILURE;
     }
-
-    ulapi_mutex_give(handle_.handle);
-
     return CANON_SUCCESS;
   }
 
 
-  LIBRARY_API CanonReturn CrpiUniversal::GetRobotForces (robotPose *forces)
+  LIBRARY_API CanonReturn CrpiUniversal::MoveBase (robotPose &to)
   {
-    robotPose temp;
-    matrix pintemp(4,4), r(3,3);
-    matrix pouttemp(4, 4);
-
-    ulapi_mutex_take(handle_.handle);
-    *forces = handle_.curForces;
-    ulapi_mutex_give(handle_.handle);
-    
-    transformFromMount(handle_.curForces, temp, false);
-
-    forces->x = temp.x;
-    forces->y = temp.y;
-    forces->z = temp.z;
-    forces->xrot = temp.xrot;
-    forces->yrot = temp.yrot;
-    forces->zrot = temp.zrot;
-
-    return CANON_SUCCESS;
+    //! Not applicable
+    return CANON_REJECT;
   }
 
 
-  LIBRARY_API CanonReturn CrpiUniversal::GetRobotIO (robotIO *io)
+  LIBRARY_API CanonReturn CrpiUniversal::PointHead (robotPose &to)
   {
-    ulapi_mutex_take(handle_.handle);
-    *io = handle_.curIO;
-    ulapi_mutex_give(handle_.handle);
-    return CANON_SUCCESS;
+    //! Not applicable
+    return CANON_REJECT;
   }
 
 
-  LIBRARY_API CanonReturn CrpiUniversal::GetRobotPose (robotPose *pose)
+  LIBRARY_API CanonReturn CrpiUniversal::PointAppendage (CanonRobotAppendage app_ID,
+                                                         robotPose &to)
   {
-    robotPose temp;
-    matrix pintemp(4,4), r(3,3), rtmp1(3,3);
-    matrix pouttemp(4, 4);
-
-    ulapi_mutex_take(handle_.handle);
-    *pose = handle_.curPose;
-    ulapi_mutex_give(handle_.handle);
-
-#ifdef UNIVERSAL_NOISY
-    cout << "raw: (" << handle_.curPose.x << ", " << handle_.curPose.y << ", " << handle_.curPose.z << ", " << handle_.curPose.xrot << ", " << handle_.curPose.yrot << ", " << handle_.curPose.zrot << ")" << endl;
-#endif
-    
-    transformFromMount(handle_.curPose, temp);
+    //! Not applicable
+    return CANON_REJECT;
+  }
   
-    pose->x = temp.x;
-    pose->y = temp.y;
-    pose->z = temp.z;
-    pose->xrot = temp.xrot;
-    pose->yrot = temp.yrot;
-    pose->zrot = temp.zrot;
 
-    return CANON_SUCCESS;
-  }
+  LIBRARY_API bool CrpiUniversal::generateMove (char moveType, char posType, char deltaType, vector<double> &input)
+  {
+    CrpiTraceSpan span("CrpiUniversal::generateMove", CRPI_TRACE_GENERATE);
+    bool state = true;
 
+    //! Check validity of inputs...
+    //!   Check movement type
+    state &= (moveType == 'P' || moveType == 'L' || moveType == 'F');
+    //!   Check position type
+    state &= (posType == 'C' || posType == 'A');
+    //!   Check absolute or relative motion
+    state &= (deltaType == 'A' || deltaType == 'R');
+    //!   Check PTP-only angle movements
+    state &= !(posType == 'A' && moveType == 'L');
+    //!   Check for proper amount of input arguments
+    //state &= (input.size() == 6);
 
-  LIBRARY_API CanonReturn CrpiUniversal::GetRobotSpeed (robotPose *speed)
-  {    
-    robotPose temp;
-    matrix pintemp(4,4), r(3,3);
-    matrix pouttemp(4, 4);
-    
-    ulapi_mutex_take(handle_.handle);
-    *speed = handle_.curSpeeds;
-    ulapi_mutex_give(handle_.handle);
+    if (!state)
+    {
+      //! Invalid arguments generating move
+      return span.End(false);
+    }
     
-    transformFromMount(handle_.curSpeeds, temp);
-   
-    speed->x = temp.x;
-    speed->y = temp.y;
-    speed->z = temp.z;
-    speed->xrot = temp.xrot;
-    speed->yrot = temp.yrot;
-    speed->zrot = temp.zrot;
+    double values[7];
+    for (int i = 0; i < 6; ++i)
+    {
+      values[i] = (deltaType == 'A' ? 0.0f : curPose_[i]) + input.at(i);
+    }
+    values[6] = speed_;
 
-    return CANON_SUCCESS;
+    ulapi_rwlock_write_take(handle_.handle);
+    moveTemplate_[(moveType == 'P') ? ((posType == 'C') ? 0 : 1) : 2].render (values, script_);
+    handle_.moveMe.str(script_);
+    ulapi_rwlock_write_give(handle_.handle);
+
+    return span.End(true);
   }
 
 
-  LIBRARY_API CanonReturn CrpiUniversal::GetRobotSpeed (robotAxes *speed)
+  LIBRARY_API bool CrpiUniversal::generateBlendedMove (vector<double> &targets,
+                                                       vector<double> &accelerations,
+                                                       vector<double> &speeds,
+                                                       vector<double> &radii)
   {
-    //! TODO
-    return CANON_FAILURE;
-  }
+    CrpiTraceSpan span("CrpiUniversal::generateBlendedMove", CRPI_TRACE_GENERATE);
+    size_t num = radii.size(), i;
 
+    if (num == 0 || targets.size() != (6 * num) || accelerations.size() != num || speeds.size() != num)
+    {
+      //! Invalid arguments generating move
+      return span.End(false);
+    }
 
-  LIBRARY_API CanonReturn CrpiUniversal::GetRobotTorques (robotAxes *torques)
-  {
-    ulapi_mutex_take(handle_.handle);
-    *torques = handle_.curAxes;
-    ulapi_mutex_give(handle_.handle);
+    ulapi_rwlock_write_take(handle_.handle);
+    handle_.moveMe.str(string());
 
-    return CANON_SUCCESS;
+    //! One program for the whole path so the controller blends between the waypoints
+    handle_.moveMe << "def myProg():\n";
+    for (i = 0; i < num; ++i)
+    {
+      handle_.moveMe << "movel(p[" << targets.at(6 * i) << ", " << targets.at((6 * i) + 1) << ", "
+                     << targets.at((6 * i) + 2) << ", " << targets.at((6 * i) + 3) << ", "
+                     << targets.at((6 * i) + 4) << ", " << targets.at((6 * i) + 5) << "], a="
+                     << accelerations.at(i) << ", v=" << speeds.at(i) << ", r=" << radii.at(i) << ")\n";
+    }
+    handle_.moveMe << "end\n";
+    ulapi_rwlock_write_give(handle_.handle);
+
+    return span.End(true);
   }
 
 
-  LIBRARY_API CanonReturn CrpiUniversal::MoveAttractor (robotPose &pose)
+  LIBRARY_API bool CrpiUniversal::waitForPose (robotPose &target, bool checkRot, double sent)
   {
-    robotPose temp, temp2, temp3;
-    robotPose curPose;
-    vector<double> target;
-#ifdef UNIVERSAL_NOISY
-    cout << "target: " << endl;
-    pose.print();
-#endif
+    CrpiTraceSpan span("CrpiUniversal::waitForPose", CRPI_TRACE_WAIT);
+    double dist, dist2, tim, dist_rot = 0.0f, stall, last, now, speed, stamp;
+    unsigned long seen;
+    bool first = true, rested = false, moving = false;
+
+    dist2 = 1000.0;
+    stall = 0.0;
+    tim = last = ulapi_time();
+    ulapi_mutex_take(handle_.stateMutex);
+    seen = handle_.stateCount;
+    ulapi_mutex_give(handle_.stateMutex);
+    while (true)
+    {
+      now = ulapi_time();
+      ulapi_rwlock_read_take(handle_.handle);
+      dist = handle_.curPose.distance(target);
+      if (checkRot)
+      {
+        dist_rot = handle_.curPose.distance_rot(target);
+      }
+      speed = crpi_translation_norm(handle_.curSpeeds);
+      stamp = handle_.stateTime;
+      ulapi_rwlock_read_give(handle_.handle);
 
-    GetRobotPose(&curPose);
-#ifdef UNIVERSAL_NOISY
-    cout << "current: " << endl;
-    curPose.print();
-#endif
+      //! Time from generating the command to the robot starting to move, for moves that start
+      //! from rest
+      if (sent > 0.0 && !moving)
+      {
+        rested |= (first && speed <= UR_MOVING_SPEED);
+        if (speed > UR_MOVING_SPEED)
+        {
+          moving = true;
+          if (rested && stamp > sent)
+          {
+            commandLatency_ = (commandLatency_ <= 0.0) ? (stamp - sent) :
+                              (commandLatency_ + (UR_LATENCY_GAIN * ((stamp - sent) - commandLatency_)));
+          }
+        }
+      }
+      first = false;
 
-    transformToMount(curPose, temp2);
-#ifdef UNIVERSAL_NOISY
-    cout << "current at base: " << endl;
-    temp2.print();
-#endif
+      //! Early release:  the next command, sent now, starts as this move arrives
+      if (earlyRelease_ && moving && commandLatency_ > 0.0 && speed > UR_MOVING_SPEED &&
+          (dist / speed) <= commandLatency_ && (!checkRot || fabs(dist_rot) <= angthresh))
+      {
+        earlyReleaseMetric_->Inc();
+        break;
+      }
 
-    //! Get target pose relative to current pose, these become the X, Y and Z offsets used during force control
-    transformToMount(pose, temp3);
-#ifdef UNIVERSAL_NOISY
-    cout << "target at base: " << endl;
-    temp3.print();
-#endif
-    temp = temp2 - temp3;
-#ifdef UNIVERSAL_NOISY
-    cout << "offset: " << endl;
-    temp.print();
-#endif
+#ifdef VERIFY_MOVING
+      if (dist >= dist2)
+      {
+        stall += (now - last);
 
-    target.push_back (temp3.x);
-    target.push_back (temp3.y);
-    target.push_back (temp3.z);
-    target.push_back (temp3.xrot);
-    target.push_back (temp3.yrot);
-    target.push_back (temp3.zrot);
+        if (stall >= stallthresh)
+        {
+          //! Robot is not moving.  Retry.
+          return span.End(false);
+        }
+      }
+#endif
 
-    if (generateParameter ('F', 'E', target))
-    {
-      if (send())
+#ifdef USE_TIMEOUT
+      if ((now - tim) > timethresh)
       {
-        //! Okay
-        
+        return span.End(false);
       }
-      else
+#endif
+      if (dist <= distthresh && fabs(dist_rot) <= angthresh)
       {
-        //! Oops
+        break;
       }
+
+      //! Wake on the next state frame rather than polling
+      waitForState(seen, UR_STATE_WAIT);
+      last = now;
+      dist2 = dist;
     }
-    else
-    {
-      cout << "Bad force command" << endl;
-    }
-    return CANON_SUCCESS;
+
+    return span.End(true);
   }
 
 
-  LIBRARY_API CanonReturn CrpiUniversal::MoveToAxisTarget (robotAxes &axes, bool useBlocking)
+  LIBRARY_API bool CrpiUniversal::generateTool (char mode, double value)
   {
-    robotAxes cur;
-    double dist, dist2;
-    int count;
-    ulapi_real tim;
-
-    //! Construct message
-    vector<double> target;
-
-    for (int i = 0; i < axes.axes; ++i)
+    CrpiTraceSpan span("CrpiUniversal::generateTool", CRPI_TRACE_GENERATE);
+    if (!(mode == 'B' || mode == 'A'  || mode == 'D'))
     {
-      //! Set axes to correct units
-      if (angleUnits_ == DEGREE)
-      {
-        target.push_back (axes.axis.at(i) * (3.141592654f/180.0f));
-      }
-      else
-      {
-        target.push_back (axes.axis.at(i));
-      }
+      //! Value must be between 0 and 1
+      return span.End(false);
     }
 
-    //! PTP, Angular, Absolute
-    if (generateMove('P', 'A', 'A', target))
-    {
-      //! Send message to robot
-      if (!send())
-      {
-        //! Error sending
-        return CANON_FAILURE;
-      }
 
-      if (useBlocking)
-      {
-        //! ROBOT DOES NOT BLOCK:  WAIT FOR RESPONSE
-        dist2 = 1000.0;
-        count = 0;
-        tim = ulapi_time();
-        while (true)
-        {
 
-          GetRobotAxes(&cur);
-          dist = cur.distance(axes);
-          //cout << dist << endl;
+    //! TODO:  Populate variables 
+    //moveMe_.str(string());
+    //moveMe_ << "(0.00000000, 0.00000000, 0.00000000, 0.00000000, 0.00000000, 0.00000000)";
+    return span.End(true);
+  }
 
-#ifdef VERIFY_MOVING
-          if (dist >= dist2)
-          {
-            ++count;
 
-            if (count >= 30)
-            {
-              //! Robot is not moving.  Retry.
-              return CANON_FAILURE;
-            }
-          }
-#endif
+  LIBRARY_API bool CrpiUniversal::generateParameter (char paramType, char subType, vector<double> &input)
+  {
+    CrpiTraceSpan span("CrpiUniversal::generateParameter", CRPI_TRACE_GENERATE);
+    bool state = true;
 
-#ifdef USE_TIMEOUT
-          if ((ulapi_time() - tim) > timethresh)
-          {
-            return CANON_FAILURE;
-          }
-#endif
-          //printf("d %f\n", dist);
-          if (dist <= distthresh)
-          {
-            break;
-          }
+    //! Check validity of inputs...
+    //!   Check movement type
+    state &= (paramType == 'A' || paramType == 'S' || paramType == 'F' || paramType == 'T');
+    //!   Check position type
+    state &= (subType == 'A' || subType == 'R' || subType == 'E' || subType == 'D' || subType == 'C');
 
-#ifdef WIN32
-          Sleep(100);
-#else
-          usleep(100000);
-#endif 
-          //Sleep(100);
-  //        ulapi_wait(200000);
-          dist2 = dist;
-        }
-      } // if (useBlocking)
+    if (paramType == 'F')
+    {
+      state &= (subType == 'E' || subType == 'D');
+    }
+    else if (paramType == 'T')
+    {
+      state &= (subType == 'D' || subType == 'C');
+    }
+    else
+    {
+      state &= (subType == 'A' || subType == 'R');
+    }
+
+    if (!state)
+    {
+      //! Invalid arguments generating move
+      return span.End(false);
+    }
+
+    if (paramType == 'F' && handle_.curTool < 0)
+    {
+      //! Cannot initiate force control without tool definition
+      return span.End(false);
     }
-    else
+
+    UrScriptTemplate *program = NULL;
+    if (paramType == 'T')
     {
-      //! Error generating motion message
-      return CANON_FAILURE;
+      //! Define TCP, or center of mass
+      program = ((subType == 'D') ? &tcpTemplate_ : &payloadTemplate_);
     }
-    return CANON_SUCCESS;
+    else if (paramType == 'F' && subType == 'E')
+    {
+      //! Enable force mode
+      program = ((input.size() == 6) ? &forceMoveTemplate_ : &forceTemplate_);
+    }
+    if (program != NULL && input.size() < (size_t) program->slots())
+    {
+      return span.End(false);
+    }
+
+    ulapi_rwlock_write_take(handle_.handle);
+    switch (paramType)
+    {
+    case 'T':
+    case 'F':
+      if (program != NULL)
+      {
+        program->render (&input[0], script_);
+      }
+      else
+      {
+        //! Disable force mode
+        script_ = "def myProg():\n  end_force_mode()\nend\nend\n";
+      }
+      break;
+    default:
+      //! Acceleration and speed are applied to each motion command
+      script_ = "def myProg():\nend\n";
+      break;
+    }
+    handle_.moveMe.str(script_);
+
+    ulapi_rwlock_write_give(handle_.handle);
+    
+    return span.End(true);
   }
 
 
-  LIBRARY_API CanonReturn CrpiUniversal::SetAbsoluteAcceleration (double acceleration)
+  LIBRARY_API bool CrpiUniversal::writeSetpoint (int mode, vector<double> &target, int select)
   {
-    if (acceleration > maxAccel_ || acceleration < 0.0f)
+    char payload[1 + (3 * sizeof(int)) + (UR_SETPOINT_VALUES * sizeof(double))];
+    int index = 0;
+    bool state;
+    int test = 0x01234567;
+    bool little = (((char*)&test)[0] == 0x67);
+
+    if (target.size() < 6)
     {
-      return CANON_REJECT;
+      return false;
     }
 
-    acceleration_ = acceleration;
-    return CANON_SUCCESS;
+    ulapi_rwlock_write_take(handle_.handle);
+    if (handle_.rtdeClient <= 0 || handle_.rtdeInputRecipe < 0)
+    {
+      //! RTDE not selected, not connected, or the input registers were refused
+      ulapi_rwlock_write_give(handle_.handle);
+      return false;
+    }
+
+    payload[index++] = (char)handle_.rtdeInputRecipe;
+    writeInt(payload, index, mode, little);
+    writeInt(payload, index, ++setpointSeq_, little);
+    writeInt(payload, index, select, little);
+    for (int i = 0; i < UR_SETPOINT_VALUES; ++i)
+    {
+      writeDouble(payload, index, ((i < (int)target.size()) ? target.at(i) : 0.0), little);
+    }
+    state = rtdeSend(handle_.rtdeClient, RTDE_DATA_PACKAGE, payload, index);
+    ulapi_rwlock_write_give(handle_.handle);
+
+    return state;
   }
 
 
-  LIBRARY_API CanonReturn CrpiUniversal::SetAbsoluteSpeed (double speed)
+  LIBRARY_API bool CrpiUniversal::generateRegisterServo (double period, double lookahead, double gain, double deadline)
   {
-    if (speed > maxSpeed_ || speed < 0.0f)
+    int r = UR_RTDE_REGISTER;
+    stringstream target;
+
+    if (!useRTDE_)
     {
-      return CANON_FAILURE;
+      return false;
     }
 
-    speed_ = speed;
-    return CANON_SUCCESS;
+    target << "read_input_float_register(" << r << "), read_input_float_register(" << (r + 1)
+           << "), read_input_float_register(" << (r + 2) << "), read_input_float_register(" << (r + 3)
+           << "), read_input_float_register(" << (r + 4) << "), read_input_float_register(" << (r + 5) << ")";
+
+    ulapi_rwlock_write_take(handle_.handle);
+    handle_.moveMe.str(string());
+
+    //! Program stays resident and follows the setpoint registers until mode is set to stop
+    handle_.moveMe << "def crpiServo():\n";
+    handle_.moveMe << "  last = read_input_integer_register(" << (r + 1) << ")\n";
+    handle_.moveMe << "  idle = 0\n";
+    handle_.moveMe << "  while (True):\n";
+    if (deadline > 0.0)
+    {
+      //! Stop if the client stops sending setpoints (sequence number no longer changes)
+      handle_.moveMe << "    seq = read_input_integer_register(" << (r + 1) << ")\n";
+      handle_.moveMe << "    if (seq != last):\n";
+      handle_.moveMe << "      last = seq\n";
+      handle_.moveMe << "      idle = 0\n";
+      handle_.moveMe << "    else:\n";
+      handle_.moveMe << "      idle = idle + " << period << "\n";
+      handle_.moveMe << "    end\n";
+      handle_.moveMe << "    if (idle > " << deadline << "):\n";
+      handle_.moveMe << "      break\n";
+      handle_.moveMe << "    end\n";
+    }
+    handle_.moveMe << "    mode = read_input_integer_register(" << r << ")\n";
+    handle_.moveMe << "    if (mode == " << UR_SETPOINT_SERVOJ << "):\n";
+    handle_.moveMe << "      servoj([" << target.str() << "], 0, 0, " << period << ", " << lookahead << ", " << gain << ")\n";
+    handle_.moveMe << "    elif (mode == " << UR_SETPOINT_SERVOL << "):\n";
+    handle_.moveMe << "      servoj(get_inverse_kin(p[" << target.str() << "]), 0, 0, " << period << ", " << lookahead << ", " << gain << ")\n";
+    handle_.moveMe << "    elif (mode == " << UR_SETPOINT_SPEEDJ << "):\n";
+    handle_.moveMe << "      speedj([" << target.str() << "], " << acceleration_ << ", " << period << ")\n";
+    handle_.moveMe << "    else:\n";
+    handle_.moveMe << "      break\n";
+    handle_.moveMe << "    end\n";
+    handle_.moveMe << "  end\n";
+    handle_.moveMe << "  stopj(" << acceleration_ << ")\n";
+    handle_.moveMe << "end\n";
+    ulapi_rwlock_write_give(handle_.handle);
+
+    return true;
   }
 
-  //  ("degree" or "radian")
-  LIBRARY_API CanonReturn CrpiUniversal::SetAngleUnits (const char *unitName)
+
+  LIBRARY_API bool CrpiUniversal::generateRegisterForce (double period, double deadline)
   {
-    if (strcmp(unitName, "degree") == 0)
-    {
-      angleUnits_ = DEGREE;
-    }
-    else if (strcmp(unitName, "radian") == 0)
+    int r = UR_RTDE_REGISTER;
+    stringstream select, wrench, limits;
+
+    if (!useRTDE_)
     {
-      angleUnits_ = RADIAN;
+      return false;
     }
-    else
+
+    //! Bit i of the selection register, as the 0 or 1 force_mode expects
+    for (int i = 0; i < 6; ++i)
     {
-      CANON_FAILURE;
+      select << ((i > 0) ? ", " : "") << "floor(sel / " << (1 << i) << ") - 2 * floor(sel / " << (2 << i) << ")";
+      wrench << ((i > 0) ? ", " : "") << "read_input_float_register(" << (r + i) << ")";
+      limits << ((i > 0) ? ", " : "") << "read_input_float_register(" << (r + 6 + i) << ")";
     }
 
-    return CANON_SUCCESS;
-  }
+    ulapi_rwlock_write_take(handle_.handle);
+    handle_.moveMe.str(string());
 
+    //! Program stays resident in force mode, following the setpoint registers until mode is
+    //! set to stop
+    handle_.moveMe << "def crpiForce():\n";
+    handle_.moveMe << "  last = read_input_integer_register(" << (r + 1) << ")\n";
+    handle_.moveMe << "  idle = 0\n";
+    handle_.moveMe << "  while (True):\n";
+    if (deadline > 0.0)
+    {
+      //! Leave force mode if the client stops sending targets
+      handle_.moveMe << "    seq = read_input_integer_register(" << (r + 1) << ")\n";
+      handle_.moveMe << "    if (seq != last):\n";
+      handle_.moveMe << "      last = seq\n";
+      handle_.moveMe << "      idle = 0\n";
+      handle_.moveMe << "    else:\n";
+      handle_.moveMe << "      idle = idle + " << period << "\n";
+      handle_.moveMe << "    end\n";
+      handle_.moveMe << "    if (idle > " << deadline << "):\n";
+      handle_.moveMe << "      break\n";
+      handle_.moveMe << "    end\n";
+    }
+    handle_.moveMe << "    if (read_input_integer_register(" << r << ") != " << UR_SETPOINT_WRENCH << "):\n";
+    handle_.moveMe << "      break\n";
+    handle_.moveMe << "    end\n";
+    handle_.moveMe << "    sel = read_input_integer_register(" << (r + 2) << ")\n";
+    handle_.moveMe << "    force_mode(tool_pose(), [" << select.str() << "], [" << wrench.str() << "], 2, [" << limits.str() << "])\n";
+    handle_.moveMe << "    sync()\n";
+    handle_.moveMe << "  end\n";
+    handle_.moveMe << "  end_force_mode()\n";
+    handle_.moveMe << "  stopl(" << acceleration_ << ")\n";
+    handle_.moveMe << "end\n";
+    ulapi_rwlock_write_give(handle_.handle);
 
-  LIBRARY_API CanonReturn CrpiUniversal::SetAxialSpeeds (double *speeds)
-  {
-    //! TODO
-    return CANON_SUCCESS;
+    return true;
   }
 
 
-  LIBRARY_API CanonReturn CrpiUniversal::SetAxialUnits (const char **unitNames)
+  LIBRARY_API bool CrpiUniversal::generateGuardedSearch (crpiGuardedSearch &search, int run)
   {
-    //! Not yet implemented
-    return CANON_REJECT;
-  }
+    int r = UR_RTDE_REGISTER, points = search.prefix + search.cycle, i, j;
+    double scale = 1.0;
+    vector<robotPose> path;
+    robotPose temp;
+    const char *axes[6] = {"px", "py", "pz", "prx", "pry", "prz"};
 
+    if (search.path == NULL || search.cycle < 1 || search.prefix < 0 ||
+        points > UR_SEARCH_MAX_POINTS || search.step <= 0.0)
+    {
+      return false;
+    }
 
-  LIBRARY_API CanonReturn CrpiUniversal::SetEndPoseTolerance (robotPose &tolerances)
-  {
-    //! Not yet implemented
-    return CANON_REJECT;
-  }
+    if (lengthUnits_ == MM)
+    {
+      scale = 1000.0f;
+    }
+    else if (lengthUnits_ == INCH)
+    {
+      scale = 39.3701f;
+    }
 
+    //! Waypoints in the robot's frame (m, rotation vector)
+    for (i = 0; i < points; ++i)
+    {
+      robotPose in = search.path[i];
+      transformToMount(in, temp);
+      path.push_back(temp);
+    }
 
-  LIBRARY_API CanonReturn CrpiUniversal::SetIntermediatePoseTolerance (robotPose *tolerances)
-  {
-    //! Not yet implemented
-    return CANON_REJECT;
+    ulapi_rwlock_write_take(handle_.handle);
+    handle_.moveMe.str(string());
+    handle_.moveMe << "def crpiSearch():\n";
+    handle_.moveMe << "  write_output_integer_register(" << r << ", " << SEARCH_RUNNING << ")\n";
+    handle_.moveMe << "  write_output_integer_register(" << (r + 1) << ", " << run << ")\n";
+    handle_.moveMe << "  global start = get_actual_tcp_pose()\n";
+    handle_.moveMe << "  global hit = start\n";
+    handle_.moveMe << "  global reason = " << SEARCH_RUNNING << "\n";
+    for (j = 0; j < 6; ++j)
+    {
+      handle_.moveMe << "  " << axes[j] << " = [";
+      for (i = 0; i < points; ++i)
+      {
+        double *v = (j == 0) ? &path[i].x : (j == 1) ? &path[i].y : (j == 2) ? &path[i].z :
+                    (j == 3) ? &path[i].xrot : (j == 4) ? &path[i].yrot : &path[i].zrot;
+        handle_.moveMe << (i > 0 ? ", " : "") << *v;
+      }
+      handle_.moveMe << "]\n";
+    }
+
+    //! Same skeleton as the force-mode programs:  a thread that runs once per controller cycle
+    handle_.moveMe << "  thread Search_guard_thread_1():\n";
+    handle_.moveMe << "    elapsed = 0\n";
+    handle_.moveMe << "    while (reason == " << SEARCH_RUNNING << "):\n";
+    handle_.moveMe << "      tcp = get_actual_tcp_pose()\n";
+    handle_.moveMe << "      f = get_tcp_force()\n";
+    handle_.moveMe << "      elapsed = elapsed + get_steptime()\n";
+    if (search.contact > 0.0)
+    {
+      handle_.moveMe << "      if (norm(f[2]) >= " << search.contact << "):\n";
+      handle_.moveMe << "        reason = " << SEARCH_CONTACT << "\n";
+      handle_.moveMe << "      end\n";
+    }
+    if (search.zDelta > 0.0)
+    {
+      handle_.moveMe << "      if (norm(tcp[2] - start[2]) >= " << (search.zDelta / scale) << "):\n";
+      handle_.moveMe << "        reason = " << SEARCH_DISTANCE << "\n";
+      handle_.moveMe << "      end\n";
+    }
+    if (search.distance > 0.0)
+    {
+      handle_.moveMe << "      if (point_dist(tcp, start) >= " << (search.distance / scale) << "):\n";
+      handle_.moveMe << "        reason = " << SEARCH_DISTANCE << "\n";
+      handle_.moveMe << "      end\n";
+    }
+    if (search.signal >= 0)
+    {
+      handle_.moveMe << "      if (get_standard_digital_in(" << search.signal << ")):\n";
+      handle_.moveMe << "        reason = " << SEARCH_SIGNAL << "\n";
+      handle_.moveMe << "      end\n";
+    }
+    if (search.timeout > 0.0)
+    {
+      handle_.moveMe << "      if (elapsed >= " << search.timeout << "):\n";
+      handle_.moveMe << "        reason = " << SEARCH_TIMEOUT << "\n";
+      handle_.moveMe << "      end\n";
+    }
+    handle_.moveMe << "      if (reason != " << SEARCH_RUNNING << "):\n";
+    handle_.moveMe << "        hit = tcp\n";
+    handle_.moveMe << "      end\n";
+    handle_.moveMe << "      sync()\n";
+    handle_.moveMe << "    end\n";
+    handle_.moveMe << "  end\n";
+    handle_.moveMe << "  thread_handler_1 = run Search_guard_thread_1()\n";
+
+    //! One servoj per controller cycle, so the motion stops in the cycle after a condition is met
+    handle_.moveMe << "  dt = get_steptime()\n";
+    handle_.moveMe << "  n = floor(" << search.step << " / dt)\n";
+    handle_.moveMe << "  if (n < 1):\n";
+    handle_.moveMe << "    n = 1\n";
+    handle_.moveMe << "  end\n";
+    handle_.moveMe << "  prev = start\n";
+    handle_.moveMe << "  i = 0\n";
+    handle_.moveMe << "  while (reason == " << SEARCH_RUNNING << "):\n";
+    if (search.prefix > 0)
+    {
+      handle_.moveMe << "    k = " << search.prefix << " + (i % " << search.cycle << ")\n";
+      handle_.moveMe << "    if (i < " << search.prefix << "):\n";
+      handle_.moveMe << "      k = i\n";
+      handle_.moveMe << "    end\n";
+    }
+    else
+    {
+      handle_.moveMe << "    k = i % " << search.cycle << "\n";
+    }
+    handle_.moveMe << "    target = p[px[k], py[k], pz[k], prx[k], pry[k], prz[k]]\n";
+    handle_.moveMe << "    s = 1\n";
+    handle_.moveMe << "    while (s <= n and reason == " << SEARCH_RUNNING << "):\n";
+    handle_.moveMe << "      servoj(get_inverse_kin(interpolate_pose(prev, target, s / (n * 1.0))), 0, 0, dt, "
+                   << streamLookahead_ << ", " << streamGain_ << ")\n";
+    handle_.moveMe << "      s = s + 1\n";
+    handle_.moveMe << "    end\n";
+    handle_.moveMe << "    prev = target\n";
+    handle_.moveMe << "    i = i + 1\n";
+    handle_.moveMe << "  end\n";
+    handle_.moveMe << "  stopl(" << acceleration_ << ")\n";
+    handle_.moveMe << "  join thread_handler_1\n";
+    for (j = 0; j < 6; ++j)
+    {
+      handle_.moveMe << "  write_output_float_register(" << (r + j) << ", hit[" << j << "])\n";
+    }
+    handle_.moveMe << "  write_output_integer_register(" << r << ", reason)\n";
+    handle_.moveMe << "end\n";
+    ulapi_rwlock_write_give(handle_.handle);
+
+    return true;
   }
 
 
-  LIBRARY_API CanonReturn CrpiUniversal::SetLengthUnits (const char *unitName)
+  LIBRARY_API CanonReturn CrpiUniversal::runGuardedSearch (crpiGuardedSearch &search)
   {
-    if (strcmp(unitName, "meter") == 0)
+    unsigned long count = 0;
+    robotPose hit, temp;
+    bool ready;
+    int run;
+
+    ulapi_rwlock_read_take(handle_.handle);
+    ready = (useRTDE_ && handle_.rtdeClient > 0 && handle_.rtdeSearchRecipe >= 0);
+    ulapi_rwlock_read_give(handle_.handle);
+    if (!ready)
     {
-      lengthUnits_ = METER;
+      //! The result could not be read back
+      return CANON_REJECT;
     }
-    else if (strcmp(unitName, "mm") == 0)
+
+    run = ++searchRun_;
+    search.reason = SEARCH_RUNNING;
+    if (!generateGuardedSearch(search, run))
     {
-      lengthUnits_ = MM;
+      return CANON_REJECT;
     }
-    else if (strcmp(unitName, "inch") == 0)
+    if (!send())
     {
-      lengthUnits_ = INCH;
+      return CANON_FAILURE;
     }
-    else
+
+    while (true)
     {
-      CANON_FAILURE;
+      waitForState(count, UR_STATE_WAIT);
+      ulapi_rwlock_read_take(handle_.handle);
+      if (handle_.rtdeClient <= 0)
+      {
+        //! Lost the feedback connection, so the result would never be seen
+        ulapi_rwlock_read_give(handle_.handle);
+        return CANON_FAILURE;
+      }
+      if (handle_.searchRun == run && handle_.searchReason != SEARCH_RUNNING)
+      {
+        search.reason = (CrpiSearchEnd)handle_.searchReason;
+        hit.x = handle_.searchPose[0];
+        hit.y = handle_.searchPose[1];
+        hit.z = handle_.searchPose[2];
+        hit.xrot = handle_.searchPose[3];
+        hit.yrot = handle_.searchPose[4];
+        hit.zrot = handle_.searchPose[5];
+        ulapi_rwlock_read_give(handle_.handle);
+        break;
+      }
+      ulapi_rwlock_read_give(handle_.handle);
     }
 
+    transformFromMount(hit, temp);
+    search.pose = temp;
     return CANON_SUCCESS;
   }
 
 
-  LIBRARY_API CanonReturn CrpiUniversal::SetParameter (const char *paramName, void *paramVal)
+  //! @brief Appends the URScript of each step, with the speeds and accelerations of the driver's
+  //!        own commands, and the number of steps finished after each
+  //!
+  class CrpiUniversal::nativeWriter : public CrpiNativeWriter
   {
-    if (strcmp(paramName, "freedrive") != 0 && strcmp(paramName, "endfreedrive") != 0)
+  public:
+    nativeWriter (CrpiUniversal &robot, ostringstream &script, int run) :
+      CrpiNativeWriter(robot.lengthUnits_, robot.angleUnits_),
+      robot_(robot),
+      script_(script),
+      run_(run),
+      speed_(robot.speed_),
+      acceleration_(robot.acceleration_)
+    {
+    }
+
+  protected:
+    bool move (CanonCommand cmd, const robotPose &pose, double radius)
+    {
+      //! In the driver's units, for its mount transform (m, rotation vector)
+      double length = crpi_length_scale(length_, robot_.lengthUnits_),
+             angle = crpi_angle_scale(angle_, robot_.angleUnits_);
+      robotPose in = pose, out;
+
+      in.x *= length;
+      in.y *= length;
+      in.z *= length;
+      in.xrot *= angle;
+      in.yrot *= angle;
+      in.zrot *= angle;
+      robot_.transformToMount(in, out);
+
+      script_ << "  " << ((cmd == CmdMoveTo) ? "movej" : "movel") << "(p[" << out.x << ", " << out.y << ", "
+              << out.z << ", " << out.xrot << ", " << out.yrot << ", " << out.zrot << "], a=" << acceleration_
+              << ", v=" << speed_ << ", r=" << (radius * crpi_length_scale(length_, METER)) << ")\n";
+      return true;
+    }
+
+    bool axes (const robotAxes &joints)
     {
-      return CANON_REJECT;
+      double scale = crpi_angle_scale(angle_, RADIAN);
+
+      if (joints.axes < axisCount)
+      {
+        return false;
+      }
+      script_ << "  movej([";
+      for (int i = 0; i < axisCount; ++i)
+      {
+        script_ << (i > 0 ? ", " : "") << (joints.axis.at(i) * scale);
+      }
+      script_ << "], a=" << acceleration_ << ", v=" << speed_ << ")\n";
+      return true;
     }
 
-    bool changed = false;
+    bool output (int signal, bool value)
+    {
+      if (signal < 0 || signal >= robot_.curIO_.ndio)
+      {
+        return false;
+      }
+      script_ << "  set_digital_out(" << signal << ", " << (value ? "True" : "False") << ")\n";
+      return true;
+    }
 
-    handle_.moveMe.str(string());
-    handle_.moveMe << "def myProg():\n";
-    if (strcmp(paramName, "freedrive") == 0)
+    bool dwell (double seconds)
     {
-      handle_.moveMe << "def myFunk():\n";
-      handle_.moveMe << "\twhile(True):\n";
-      handle_.moveMe << "\t\tfreedrive_mode()\n";
-      handle_.moveMe << "\t\tsync()\n";
-      handle_.moveMe << "\tend\n";
-      handle_.moveMe << "end\n";
+      if (seconds > 0.0)
+      {
+        script_ << "  sleep(" << seconds << ")\n";
+      }
+      return true;
+    }
 
+    bool message (const string &text)
+    {
+      string quoted = text;
+      replace(quoted.begin(), quoted.end(), '"', '\'');
+      script_ << "  textmsg(\"" << quoted << "\")\n";
+      return true;
     }
-    else
+
+    //! Same limits and units as SetAbsoluteSpeed and SetRelativeSpeed
+    bool speed (double value, bool relative)
     {
-      //! Disable force mode
-      handle_.moveMe << "end_freedrive_mode()\n";
+      if (value < 0.0 || value > (relative ? 1.0 : robot_.maxSpeed_))
+      {
+        return false;
+      }
+      speed_ = relative ? (robot_.maxSpeed_ * value) : value;
+      return true;
     }
-    handle_.moveMe << "end\n";    
 
-    if (!send())
+    bool acceleration (double value, bool relative)
     {
-      //! error sending
-      return CANON_FAILURE;
+      if (value < 0.0 || value > (relative ? 1.0 : robot_.maxAccel_))
+      {
+        return false;
+      }
+      acceleration_ = relative ? (robot_.maxAccel_ * value) : value;
+      return true;
     }
 
-    return CANON_SUCCESS;
-  }
+    void progress (size_t done)
+    {
+      if (run_ > 0)
+      {
+        script_ << "  write_output_integer_register(" << UR_RTDE_REGISTER << ", " << done << ")\n";
+      }
+    }
 
+  private:
+    CrpiUniversal &robot_;
+    ostringstream &script_;
+    int run_;
+    double speed_, acceleration_;
+  };
 
-  LIBRARY_API CanonReturn CrpiUniversal::SetRelativeAcceleration (double percent)
+
+  LIBRARY_API bool CrpiUniversal::generateNative (crpiNativeProgram &native, int run)
   {
-    if (percent > 1.0f || percent < 0.0f)
+    CrpiTraceSpan span("CrpiUniversal::generateNative", CRPI_TRACE_GENERATE);
+    ostringstream script;
+    nativeWriter writer(*this, script, run);
+
+    script.precision(9);
+    script << "def crpiProgram():\n";
+    if (run > 0)
     {
-      return CANON_FAILURE;
+      script << "  write_output_integer_register(" << UR_RTDE_REGISTER << ", 0)\n";
+      script << "  write_output_integer_register(" << (UR_RTDE_REGISTER + 1) << ", " << run << ")\n";
+    }
+    if (!writer.write(*native.program))
+    {
+      return span.End(false);
     }
+    script << "end\n";
+    native.text = script.str();
 
-    acceleration_ = maxAccel_ * percent;
-    return CANON_SUCCESS;
+    ulapi_rwlock_write_take(handle_.handle);
+    handle_.moveMe.str(native.text);
+    ulapi_rwlock_write_give(handle_.handle);
+
+    return span.End(true);
   }
 
 
-  LIBRARY_API CanonReturn CrpiUniversal::SetRelativeSpeed (double percent)
+  LIBRARY_API CanonReturn CrpiUniversal::runNative (crpiNativeProgram &native)
   {
-    if (percent > 1.0f || percent < 0.0f)
+    size_t total = native.program->steps.size() - native.program->next;
+    unsigned long count = 0;
+    double start, stopped = 0.0, now;
+    bool ready, started = false;
+    int run, done;
+
+    native.completed = 0;
+    if (!native.run)
     {
-      return CANON_FAILURE;
+      return (generateNative(native, 0) ? CANON_SUCCESS : CANON_REJECT);
     }
 
-    speed_ = maxSpeed_ * percent;
-    return CANON_SUCCESS;
-  }
-
+    ulapi_rwlock_read_take(handle_.handle);
+    ready = (useRTDE_ && handle_.rtdeClient > 0 && handle_.rtdeSearchRecipe >= 0);
+    ulapi_rwlock_read_give(handle_.handle);
+    if (!ready)
+    {
+      //! Progress could not be read back
+      return CANON_REJECT;
+    }
 
-  LIBRARY_API CanonReturn CrpiUniversal::SetRobotIO (robotIO &io)
-  {
-    bool changed = false;
+    run = ++searchRun_;
+    if (!generateNative(native, run))
+    {
+      return CANON_REJECT;
+    }
+    if (total == 0)
+    {
+      return CANON_SUCCESS;
+    }
+    if (!send())
+    {
+      return CANON_FAILURE;
+    }
 
-    handle_.moveMe.str(string());
-    handle_.moveMe << "def myProg():\n";
-    for (int x = 0; x < io.ndio; ++x)
+    start = ulapi_time();
+    while (native.completed < total)
     {
-      if (firstIO_ || (curIO_.dio[x] != io.dio[x]))
+      waitForState(count, UR_STATE_WAIT);
+      now = ulapi_time();
+      ulapi_rwlock_read_take(handle_.handle);
+      if (handle_.rtdeClient <= 0)
       {
-        handle_.moveMe << "set_digital_out(" << x << ", ";
-        handle_.moveMe << (io.dio[x] ? "True" : "False") << ")\n";
-        changed = true;
+        //! Lost the feedback connection, so the end would never be seen
+        ulapi_rwlock_read_give(handle_.handle);
+        return CANON_FAILURE;
       }
-    }
-    handle_.moveMe << "end\n";
-    //! Send message to robot
-    if (changed)
-    {
-      if (!send())
+      done = ((handle_.searchRun == run) ? handle_.searchReason : -1);
+      ulapi_rwlock_read_give(handle_.handle);
+
+      if (done >= 0)
+      {
+        started = true;
+        if ((size_t)done > native.completed)
+        {
+          native.completed = (size_t)done;
+          CRPI_LOG(CRPI_LOG_DEBUG, "CrpiUniversal:  native program at step %u of %u",
+                   (unsigned int)native.completed, (unsigned int)total);
+          if (native.progress)
+          {
+            native.progress(native.completed);
+          }
+          continue;
+        }
+      }
+
+      if (!started && (now - start) > UR_NATIVE_START)
+      {
+        CRPI_LOG(CRPI_LOG_ERROR, "CrpiUniversal:  native program did not start");
+        return CANON_FAILURE;
+      }
+
+      //! Stopped by the controller (e.g., a protective stop) or replaced by another program
+      //! before its last step
+      if (started && GetProgramState() == PROGRAM_STOPPED)
+      {
+        if (stopped <= 0.0)
+        {
+          stopped = now;
+        }
+        else if ((now - stopped) > UR_NATIVE_STOPPED)
+        {
+          CRPI_LOG(CRPI_LOG_ERROR, "CrpiUniversal:  native program stopped after step %u of %u",
+                   (unsigned int)native.completed, (unsigned int)total);
+          return CANON_FAILURE;
+        }
+      }
+      else
       {
-        //! error sending
-        return CANON_FAILURE;
+        stopped = 0.0;
       }
     }
-    //timer_.waitUntil(10);
-
-    curIO_ = io;
-    firstIO_ = false;
 
     return CANON_SUCCESS;
   }
 
 
-  LIBRARY_API CanonReturn CrpiUniversal::SetRobotDO (int dig_out, bool val)
+  LIBRARY_API bool CrpiUniversal::waitForState (unsigned long &lastCount, double timeout)
   {
-    if (dig_out < 0 || dig_out >= curIO_.ndio)
-    {
-      return CANON_REJECT;
-    }
+    CrpiTraceSpan span("CrpiUniversal::waitForState", CRPI_TRACE_WAIT);
+    bool fresh;
+    double deadline = ulapi_time() + timeout, remaining;
 
-    handle_.moveMe.str(string());
-    handle_.moveMe << "def myProg():\n";
-    handle_.moveMe << "set_digital_out(" << dig_out << ", ";
-    handle_.moveMe << (val ? "True" : "False") << ")\n";
-    handle_.moveMe << "end\n";
-    //! Send message to robot
-    if (!send())
+    ulapi_mutex_take(handle_.stateMutex);
+    while (handle_.stateCount == lastCount)
     {
-      //! error sending
-      return CANON_FAILURE;
+      remaining = deadline - ulapi_time();
+      if (remaining <= 0.0 || handle_.stateCond == NULL)
+      {
+        break;
+      }
+      ulapi_cond_timedwait(handle_.stateCond, handle_.stateMutex, remaining);
     }
-    curIO_.dio[dig_out] = val;
-    firstIO_ = false;
+    fresh = (handle_.stateCount != lastCount);
+    lastCount = handle_.stateCount;
+    ulapi_mutex_give(handle_.stateMutex);
 
-    return CANON_SUCCESS;
+    return span.End(fresh);
   }
 
 
-  LIBRARY_API CanonReturn CrpiUniversal::StopMotion (int condition)
+  LIBRARY_API bool CrpiUniversal::send ()
   {
-    ulapi_mutex_take(handle_.handle);
-    handle_.moveMe.str(string());
+    CrpiTraceSpan span("CrpiUniversal::send", CRPI_TRACE_SEND);
+    ulapi_rwlock_read_take(handle_.handle);
+    string script = handle_.moveMe.str();
+    ulapi_rwlock_read_give(handle_.handle);
+    CRPI_LOG(CRPI_LOG_DEBUG, "%s", script.c_str());
 
-    //! stopl(acceleration)
-    handle_.moveMe << "def myProg():\n";
-    handle_.moveMe << "stopl(3.0)\n";
-    handle_.moveMe << "end\n";
-    ulapi_mutex_give(handle_.handle);
+    return span.End(send(script, CMDQUEUE_NORMAL));
+  }
 
-    //! Send message to robot
-    if (!send())
+
+  LIBRARY_API bool CrpiUniversal::send (const string &script, CrpiCommandPriority priority)
+  {
+    //! Scripts are written with their terminating null
+    if (!handle_.commands->Send(string(script.c_str(), script.size() + 1), priority))
     {
-      //! error sending
-      return CANON_FAILURE;
+      CRPI_LOG(CRPI_LOG_ERROR, "CrpiUniversal:  cannot connect");
+      return false;
     }
-    return CANON_SUCCESS;
+    return true;
   }
 
 
-  LIBRARY_API CanonReturn CrpiUniversal::MoveBase (robotPose &to)
+  LIBRARY_API void CrpiUniversal::GetSendLatency (double &last, double &worst, unsigned long &reconnects)
   {
-    //! Not applicable
-    return CANON_REJECT;
+    ulapi_fastlock_take(handle_.TCPIPhandle);
+    last = handle_.sendLatency;
+    worst = handle_.worstLatency;
+    reconnects = handle_.reconnects;
+    ulapi_fastlock_give(handle_.TCPIPhandle);
   }
 
 
-  LIBRARY_API CanonReturn CrpiUniversal::PointHead (robotPose &to)
+  LIBRARY_API void CrpiUniversal::GetStopLatency (double &last, double &worst)
   {
-    //! Not applicable
-    return CANON_REJECT;
+    handle_.commands->GetStopLatency(last, worst);
   }
 
 
-  LIBRARY_API CanonReturn CrpiUniversal::PointAppendage (CanonRobotAppendage app_ID,
-                                                         robotPose &to)
+  LIBRARY_API bool CrpiUniversal::GetStatus (urStatus &status) const
   {
-    //! Not applicable
-    return CANON_REJECT;
+    handle_.status.read(status);
+    return status.valid;
   }
-  
 
-  LIBRARY_API bool CrpiUniversal::generateMove (char moveType, char posType, char deltaType, vector<double> &input)
+
+  LIBRARY_API int CrpiUniversal::GetRobotMode () const
   {
-    bool state = true;
+    urStatus status;
 
-    //! Check validity of inputs...
-    //!   Check movement type
-    state &= (moveType == 'P' || moveType == 'L' || moveType == 'F');
-    //!   Check position type
-    state &= (posType == 'C' || posType == 'A');
-    //!   Check absolute or relative motion
-    state &= (deltaType == 'A' || deltaType == 'R');
-    //!   Check PTP-only angle movements
-    state &= !(posType == 'A' && moveType == 'L');
-    //!   Check for proper amount of input arguments
-    //state &= (input.size() == 6);
+    handle_.status.read(status);
+    return status.robotMode;
+  }
 
-    if (!state)
-    {
-      //! Invalid arguments generating move
-      return false;
-    }
-    
-    ulapi_mutex_take(handle_.handle);
-    handle_.moveMe.str(string());
-  
-    handle_.moveMe << "def myProg():\n";
-    handle_.moveMe << "move" << (moveType == 'P' ? "j(" : "l(");
-    handle_.moveMe << (posType == 'C' ? "p[" : "[") << ((deltaType == 'A' ? 0.0f : curPose_[0]) + input.at(0)) << ", "
-                   << ((deltaType == 'A' ? 0.0f : curPose_[1]) + input.at(1)) << ", " 
-                   << ((deltaType == 'A' ? 0.0f : curPose_[2]) + input.at(2)) << ", "
-                   << ((deltaType == 'A' ? 0.0f : curPose_[3]) + input.at(3)) << ", "
-                   << ((deltaType == 'A' ? 0.0f : curPose_[4]) + input.at(4)) << ", "
-                   << ((deltaType == 'A' ? 0.0f : curPose_[5]) + input.at(5))
-                   << "]" << ", v=" << speed_ << ")\n";
-    handle_.moveMe << "end\n";
-    //cout << handle_.moveMe.str().c_str() << endl;
-    /*
-    handle_.moveMe << "while(True):\nforcem" << (moveType == 'P' ? "j(" : "l(");
-    handle_.moveMe << (posType == 'C' ? "p[" : "[") << ((deltaType == 'A' ? 0.0f : curPose_[0]) + input.at(0)) << ", "
-                   << ((deltaType == 'A' ? 0.0f : curPose_[1]) + input.at(1)) << ", " 
-                   << ((deltaType == 'A' ? 0.0f : curPose_[2]) + input.at(2)) << ", "
-                   << ((deltaType == 'A' ? 0.0f : curPose_[3]) + input.at(3)) << ", "
-                   << ((deltaType == 'A' ? 0.0f : curPose_[4]) + input.at(4)) << ", "
-                   << ((deltaType == 'A' ? 0.0f : curPose_[5]) + input.at(5))
-                   << "], a=" << acceleration_ << ", v=" << speed_ << ")\nsync()\nend\n";
-    */
-    ulapi_mutex_give(handle_.handle);
 
-    return true;
+  LIBRARY_API int CrpiUniversal::GetSafetyMode () const
+  {
+    urStatus status;
+
+    handle_.status.read(status);
+    return status.safetyMode;
   }
 
 
-  LIBRARY_API bool CrpiUniversal::generateTool (char mode, double value)
+  LIBRARY_API CrpiProgramState CrpiUniversal::GetProgramState () const
   {
-    if (!(mode == 'B' || mode == 'A'  || mode == 'D'))
-    {
-      //! Value must be between 0 and 1
-      return false;
-    }
+    urStatus status;
 
+    handle_.status.read(status);
+    return (CrpiProgramState)status.programState;
+  }
 
 
-    //! TODO:  Populate variables 
-    //moveMe_.str(string());
-    //moveMe_ << "(0.00000000, 0.00000000, 0.00000000, 0.00000000, 0.00000000, 0.00000000)";
-    return true;
+  LIBRARY_API bool CrpiUniversal::IsProtectiveStopped () const
+  {
+    urStatus status;
+
+    handle_.status.read(status);
+    return (status.status & STATUS_PROTECTIVE_STOP) != 0;
   }
 
 
-  LIBRARY_API bool CrpiUniversal::generateParameter (char paramType, char subType, vector<double> &input)
+  LIBRARY_API int CrpiUniversal::WatchStatus (UrStatusCallback callback)
   {
-    bool state = true;
+    int id;
 
-    //! Check validity of inputs...
-    //!   Check movement type
-    state &= (paramType == 'A' || paramType == 'S' || paramType == 'F' || paramType == 'T');
-    //!   Check position type
-    state &= (subType == 'A' || subType == 'R' || subType == 'E' || subType == 'D' || subType == 'C');
+    ulapi_fastlock_take(handle_.watchLock);
+    id = handle_.nextWatch++;
+    handle_.statusWatches.push_back(make_pair(id, callback));
+    ulapi_fastlock_give(handle_.watchLock);
+    return id;
+  }
 
-    if (paramType == 'F')
-    {
-      state &= (subType == 'E' || subType == 'D');
-    }
-    else if (paramType == 'T')
-    {
-      state &= (subType == 'D' || subType == 'C');
-    }
-    else
-    {
-      state &= (subType == 'A' || subType == 'R');
-    }
 
-    if (!state)
+  LIBRARY_API void CrpiUniversal::UnwatchStatus (int id)
+  {
+    ulapi_fastlock_take(handle_.watchLock);
+    for (vector<pair<int, UrStatusCallback> >::iterator iter = handle_.statusWatches.begin();
+         iter != handle_.statusWatches.end(); ++iter)
     {
-      //! Invalid arguments generating move
-      return false;
+      if (iter->first == id)
+      {
+        handle_.statusWatches.erase(iter);
+        break;
+      }
     }
+    ulapi_fastlock_give(handle_.watchLock);
+  }
 
-    ulapi_mutex_take(handle_.handle);
-    handle_.moveMe.str(string());
-    handle_.moveMe << "def myProg():\n";
-    switch (paramType)
+
+  LIBRARY_API CanonReturn CrpiUniversal::Dashboard (const char *command, string &reply)
+  {
+    string text = string(command) + "\n";
+    CanonReturn val = CANON_FAILURE;
+    int got;
+
+    reply.clear();
+    ulapi_fastlock_take(dashboardLock_);
+    for (int attempt = 0; attempt < 2; ++attempt)
     {
-    case 'A':
-      break;
-    case 'S':
-      break;
-    case 'T':
-      if (subType == 'D')
+      if (dashboard_ <= 0 && !dashboardConnect())
       {
-        //! Define TCP
-        handle_.moveMe << "set_tcp(p[" << input.at(0) << ", " << input.at(1) << ", " << input.at(2)
-                       << ", " << input.at(3) << ", " << input.at(4) << ", " << input.at(5) << "])\n";
+        break;
+      }
+
+      if (ulapi_socket_write(dashboard_, text.c_str(), (ulapi_integer)text.length()) == (ulapi_integer)text.length())
+      {
+        got = dashboardLine(reply, UR_DASHBOARD_TIMEOUT);
       }
       else
       {
-        //! Center of mass
-        handle_.moveMe << "set_payload(" << input.at(0) << ", (" << input.at(1) << ", " << input.at(2)
-                       << ", " << input.at(3) << "))\n";
+        got = 0;
       }
-      break;
-    case 'F':
-      if (handle_.curTool < 0)
+      if (got == 1)
       {
-        //! Cannot initiate force control without tool definition
-        return false;
+        val = CANON_SUCCESS;
+        break;
       }
 
-      if (subType == 'E')
-      {
-        handle_.moveMe << "def myFunk():\n";
-        //handle_.moveMe << "  set_payload(" << params_.tools.at(handle_.curTool).mass << ", ("
-        //               << (params_.tools.at(handle_.curTool).centerMass.x / 1000.0f) << ", "
-        //               << (params_.tools.at(handle_.curTool).centerMass.y / 1000.0f) << ", "
-        //               << (params_.tools.at(handle_.curTool).centerMass.z / 1000.0f) << "))\n";
-        matrix rot(3, 3);
-        vector<double> euler;
-        euler.push_back(params_.mounting->xrot);
-        euler.push_back(params_.mounting->yrot);
-        euler.push_back(params_.mounting->zrot);
-        rot.rotEulerMatrixConvert(euler);
-        //handle_.moveMe << "  set_gravity([" << (9.82f * rot.at(2, 0)) << ", " << (9.82f * rot.at(2, 1)) << ", "
-        //               << (9.82f * rot.at(2, 2)) << "])\n";
-        handle_.moveMe << "  thread Force_properties_calculation_thread_1():\n";
-        handle_.moveMe << "    while (True):\n";
-        //handle_.moveMe << "      force_mode(p[0.0, 0.0, 0.0, 0.0, 0.0, 0.0], [0, 0, 1, 0, 0, 0], [0.0, 0.0, 30.0, 0.0, 0.0, 0.0], 3, [0.15, 0.15, 0.25, 0.17, 0.17, 0.17])\n";
-        handle_.moveMe << "      force_mode(tool_pose(), [0, 0, 1, 0, 0, 0], [0.0, 0.0, 30.0, 0.0, 0.0, 0.0], 2, [0.2, 0.2, 0.2, 0.17453292519943295, 0.17453292519943295, 0.17453292519943295])\n";
-//        handle_.moveMe << "      force_mode(p[0.0, 0.0, 0.0, 0.0, 0.0, 0.0], [0, 0, 1, 0, 0, 0], [0.0, 0.0, 20.0, 0.0, 0.0, 0.0], 2, [0.1, 0.1, 0.015, 0.17453292519943295, 0.17453292519943295, 0.17453292519943295])\n";
-        handle_.moveMe << "      sync()\n";
-        handle_.moveMe << "    end\n";
-        handle_.moveMe << "  end\n";
-        handle_.moveMe << "  global thread_handler_1 = run Force_properties_calculation_thread_1()\n";
-
-        //handle_.moveMe << "  global cloud = tool_pose()\n";// p[0.0000, 0.00000, 0.00000, 0.00000, 0.00000, 0.00000]\n";
-        handle_.moveMe << "  global X = " << input.at(0) << "\n";
-        handle_.moveMe << "  global Y = " << input.at(1) << "\n";
-        handle_.moveMe << "  global Z = " << input.at(2) << "\n";
-        handle_.moveMe << "  global XR = " << input.at(3) << "\n";
-        handle_.moveMe << "  global YR = " << input.at(4) << "\n";
-        handle_.moveMe << "  global ZR = " << input.at(5) << "\n";
-
-        //! Enable force mode
-        if (input.size() == 6)
-        {
-          //handle_.moveMe << "  global pt = pose_trans(cloud, p[X,Y,Z,0,0,0])\n";
-//          handle_.moveMe << "    movel(pose_trans(p[0.0, 0.0, 0.0, 0.0, 0.0, 0.0], pt), a=1.39, v=1.04)\n";
-          handle_.moveMe << "  movej(p[X, Y, Z, XR, YR, ZR], a=0.39, v=0.25)\n";
-//          handle_.moveMe << "    movel(p[" << input.at(0) << ", " << input.at(1) << ", " << input.at(2) << ", " << input.at(3)
-//                         << ", " << input.at(4) << ", " << input.at(5) << "], a=0.39, v=0.25)\n";
-        }
-        handle_.moveMe << "  kill thread_handler_1\n";
-        //handle_.moveMe << "    end_force_mode()\n";
-  //      handle_.moveMe << "  end\n"; //! "Walk()"
-        //! Program begins here
-//        handle_.moveMe << "  Walk()\n";
-      }
-      else
+      ulapi_socket_close(dashboard_);
+      dashboard_ = 0;
+      if (got < 0)
       {
-        //! Disable force mode
-        handle_.moveMe << "  end_force_mode()\n";
+        //! The command may have run without its answer arriving, so it is not sent again.
+        //! Only a connection the server had already closed is retried.
+        break;
       }
-      handle_.moveMe << "end\n";
-
-      break;
-    default:
-      //! Shouldn't get here.  We checked for this already.
-      break;
     }
-    handle_.moveMe << "end\n";
-
-    ulapi_mutex_give(handle_.handle);
-    
-    return true;
+    ulapi_fastlock_give(dashboardLock_);
+    return val;
   }
 
 
-  LIBRARY_API bool CrpiUniversal::send ()
+  bool CrpiUniversal::dashboardConnect ()
   {
-#ifndef NEWTCPIP
-    ulapi_mutex_take(handle_.handle);
-    ulapi_integer client = ulapi_socket_get_client_id (handle_.params.tcp_ip_port, handle_.params.tcp_ip_addr);
-    ulapi_socket_set_nonblocking(client);
-    ulapi_mutex_give(handle_.handle);
-#endif
+    string greeting;
 
-    int sent;
-#ifndef NEWTCPIP
-    if (client > 0)
-#else
-    if (handle_.clientID > 0)
-#endif
+    dashboard_ = ulapi_socket_get_client_id(UR_DASHBOARD_PORT, params_.tcp_ip_addr);
+    if (dashboard_ <= 0)
     {
-      ulapi_mutex_take(handle_.handle);
-#ifdef UNIVERSAL_NOISY
-      cout << handle_.moveMe.str().c_str() << endl;
-#endif
+      dashboard_ = 0;
+      return false;
+    }
+    ulapi_socket_set_nonblocking(dashboard_);
+    dashboardHeld_.clear();
 
+    //! The server greets each connection ("Connected: Universal Robots Dashboard Server")
+    if (dashboardLine(greeting, UR_DASHBOARD_TIMEOUT) != 1)
+    {
+      ulapi_socket_close(dashboard_);
+      dashboard_ = 0;
+      return false;
+    }
+    return true;
+  }
 
-      //cout << handle_.moveMe.str().c_str() << endl;
-#ifndef NEWTCPIP
-      sent = ulapi_socket_write (client, handle_.moveMe.str().c_str(), strlen(handle_.moveMe.str().c_str()) + 1);
-#else
-      sent = ulapi_socket_write(handle_.clientID, handle_.moveMe.str().c_str(), strlen(handle_.moveMe.str().c_str()) + 1);
-#endif
 
-      ulapi_mutex_give(handle_.handle);
-    }
-    else
+  int CrpiUniversal::dashboardLine (string &line, double timeout)
+  {
+    char chunk[512];
+    double deadline = ulapi_time() + timeout, left;
+    ulapi_integer ready;
+    size_t end;
+    int get;
+
+    while ((end = dashboardHeld_.find('\n')) == string::npos)
     {
-      cout << endl << "cannot connect" << endl;
-      return false;
+      left = deadline - ulapi_time();
+      if (left <= 0.0 || ulapi_socket_poll(&dashboard_, &ready, 1, left) <= 0)
+      {
+        return -1;
+      }
+      get = ulapi_socket_read(dashboard_, chunk, sizeof(chunk));
+      if (get == 0)
+      {
+        return 0;
+      }
+      if (get > 0)
+      {
+        dashboardHeld_.append(chunk, get);
+      }
     }
-#ifndef NEWTCPIP
-    ulapi_socket_close(client);
-#endif
 
-    return true;
+    line.assign(dashboardHeld_, 0, end);
+    if (!line.empty() && line[line.length() - 1] == '\r')
+    {
+      line.erase(line.length() - 1);
+    }
+    dashboardHeld_.erase(0, end + 1);
+    return 1;
   }
 
 
   LIBRARY_API bool CrpiUniversal::get ()
   {
+    CrpiTraceSpan span("CrpiUniversal::get", CRPI_TRACE_WAIT);
     int x = 0;
     if (serialUsed_)
     {
 //      printf ("getting feedback...\n");
       x = ulapi_serial_read(serialID_, mssgBuffer_, 8192);
 //      printf ("%d read\n", x);
-      return true;
+      return span.End(true);
     }
     else
     {
       //! TODO
-      return false;
+      return span.End(false);
     }
   }
 
-  LIBRARY_API bool CrpiUniversal::transformToMount(robotPose &in, robotPose &out, bool scale)
+  LIBRARY_API void CrpiUniversal::updateMountCache ()
   {
-    matrix pintemp(4,4), r(3,3), rtmp1(3,3);
-    matrix pouttemp(4, 4);
-    vector<double> vtemp;
-    robotPose tmp = in;
+    //! Client length units per meter, and client angle units per radian
+    double length = 1.0f, angle = 1.0f;
+    int next = 1 - mountActive_.load();
 
-    if (scale)
+    if (lengthUnits_ == MM)
     {
-      if (lengthUnits_ == MM)
-      {
-        //! Convert units from mm
-        tmp.x /= 1000.0f;
-        tmp.y /= 1000.0f;
-        tmp.z /= 1000.0f;
-      }
-      else if (lengthUnits_ == INCH)
-      {
-        //! Convert units from inches
-        tmp.x /= 39.3701f;
-        tmp.y /= 39.3701f;
-        tmp.z /= 39.3701f;
-      }
-    
-      if (angleUnits_ = DEGREE)
-      {
-        tmp.xrot /= (180.0f / 3.141592654f);
-        tmp.yrot /= (180.0f / 3.141592654f);
-        tmp.zrot /= (180.0f / 3.141592654f);
-      }
+      length = 1000.0f;
     }
-
-    vtemp.push_back(tmp.xrot);
-    vtemp.push_back(tmp.yrot);
-    vtemp.push_back(tmp.zrot);
-    r.rotEulerMatrixConvert(vtemp);
-    //! Copy rotation matrix to homogeneous transformation matrix
-    for (int x = 0; x < 3; ++x)
+    else if (lengthUnits_ == INCH)
     {
-      for (int y = 0; y < 3; ++y)
-      {
-        pintemp.at(x, y) = r.at(x, y);
-      }
+      length = 39.3701f;
     }
-    pintemp.at(0, 3) = tmp.x;
-    pintemp.at(1, 3) = tmp.y;
-    pintemp.at(2, 3) = tmp.z;
-    pintemp.at(3, 3) = 1.0f;
-    pouttemp = *backward_ * pintemp; //JAM pouttemp.matrixMult(*backward_, pintemp, pouttemp); // 
-
-    out.x = pouttemp.at(0,3);
-    out.y = pouttemp.at(1,3);
-    out.z = pouttemp.at(2,3);
-    for (int x = 0; x < 3; ++x)
+    if (angleUnits_ == DEGREE)
     {
-      for (int y = 0; y < 3; ++y)
-      {
-        r.at(x, y) = pouttemp.at(x, y);
-      }
+      angle = 180.0f / 3.141592654f;
     }
-    
-    r.rotMatrixAxisAngleConvert(vtemp);
-    out.xrot = vtemp.at(0);
-    out.yrot = vtemp.at(1);
-    out.zrot = vtemp.at(2);
+
+    mountTransform &to = toMount_[next], &from = fromMount_[next];
+    buildMountTransform(*backward_, 1.0f / length, 1.0f, 1.0f / angle,
+                        to.rot, to.pos, to.offset, to.angle);
+    buildMountTransform(*forward_, length, length, angle,
+                        from.rot, from.pos, from.offset, from.angle);
+    mountActive_.store(next);
+  }
+
+
+  LIBRARY_API bool CrpiUniversal::transformToMount(robotPose &in, robotPose &out, bool scale)
+  {
+    const mountTransform &t = scale ? toMount_[mountActive_.load()] : toMountRaw_;
+    Mat<3, 3> r;
+
+    eulerToMatrix(in.xrot * t.angle, in.yrot * t.angle, in.zrot * t.angle, r);
+    r = t.rot * r;
+
+    double x = in.x, y = in.y, z = in.z;
+    out.x = (t.pos.at(0, 0) * x) + (t.pos.at(0, 1) * y) + (t.pos.at(0, 2) * z) + t.offset[0];
+    out.y = (t.pos.at(1, 0) * x) + (t.pos.at(1, 1) * y) + (t.pos.at(1, 2) * z) + t.offset[1];
+    out.z = (t.pos.at(2, 0) * x) + (t.pos.at(2, 1) * y) + (t.pos.at(2, 2) * z) + t.offset[2];
+    matrixToAxisAngle(r, out.xrot, out.yrot, out.zrot);
 
     return true;
   }
@@ -1708,70 +3980,57 @@ namespace crpi_robot
 
   LIBRARY_API bool CrpiUniversal::transformFromMount(robotPose &in, robotPose &out, bool scale)
   {
-    matrix pintemp(4,4), r(3,3), rtmp1(3,3);
-    matrix pouttemp(4, 4);
-    vector<double> vtemp;
+    const mountTransform &t = scale ? fromMount_[mountActive_.load()] : fromMountRaw_;
+    Mat<3, 3> r;
 
-    vtemp.push_back (in.xrot);
-    vtemp.push_back (in.yrot);
-    vtemp.push_back (in.zrot);
-    rtmp1.rotAxisAngleMatrixConvert (vtemp);
+    axisAngleToMatrix(in.xrot, in.yrot, in.zrot, r);
+    r = t.rot * r;
 
-    //! Copy rotation matrix to homogeneous transformation matrix
-    for (int x = 0; x < 3; ++x)
-    {
-      for (int y = 0; y < 3; ++y)
-      {
-        pintemp.at(x, y) = rtmp1.at(x, y);
-      }
-    }
+    double x = in.x, y = in.y, z = in.z;
+    out.x = (t.pos.at(0, 0) * x) + (t.pos.at(0, 1) * y) + (t.pos.at(0, 2) * z) + t.offset[0];
+    out.y = (t.pos.at(1, 0) * x) + (t.pos.at(1, 1) * y) + (t.pos.at(1, 2) * z) + t.offset[1];
+    out.z = (t.pos.at(2, 0) * x) + (t.pos.at(2, 1) * y) + (t.pos.at(2, 2) * z) + t.offset[2];
+    matrixToEuler(r, out.xrot, out.yrot, out.zrot);
+    out.xrot *= t.angle;
+    out.yrot *= t.angle;
+    out.zrot *= t.angle;
 
-    pintemp.at(0, 3) = in.x;
-    pintemp.at(1, 3) = in.y;
-    pintemp.at(2, 3) = in.z;
-    pintemp.at(3, 3) = 1.0f;
-    pouttemp = (*forward_ * pintemp); //JAM pouttemp.matrixMult(*forward_, pintemp, pouttemp); // 
-    out.x = pouttemp.at(0,3);
-    out.y = pouttemp.at(1,3);
-    out.z = pouttemp.at(2,3);
-    for (int x = 0; x < 3; ++x)
-    {
-      for (int y = 0; y < 3; ++y)
-      {
-        r.at(x, y) = pouttemp.at(x, y);
-      }
-    }
-    r.rotMatrixEulerConvert(vtemp);
-    out.xrot = vtemp.at(0);
-    out.yrot = vtemp.at(1);
-    out.zrot = vtemp.at(2);
+    return true;
+  }
 
-    if (scale)
-    {
-      if (lengthUnits_ == MM)
-      {
-        //! Convert units to mm
-        out.x *= 1000.0f;
-        out.y *= 1000.0f;
-        out.z *= 1000.0f;
-      }
-      else if (lengthUnits_ == INCH)
-      {
-        //! Convert units to inches
-        out.x *= 39.3701f;
-        out.y *= 39.3701f;
-        out.z *= 39.3701f;
-      }
-    
-      if (angleUnits_ = DEGREE)
-      {
-        out.xrot *= (180.0f / 3.141592654f);
-        out.yrot *= (180.0f / 3.141592654f);
-        out.zrot *= (180.0f / 3.141592654f);
-      }
-    }
 
-    return true;
+  LIBRARY_API void CrpiUniversal::convertState (RobotStateSnapshot *state)
+  {
+    robotPose temp;
+
+    transformFromMount(state->pose, temp);
+    state->pose.x = temp.x;
+    state->pose.y = temp.y;
+    state->pose.z = temp.z;
+    state->pose.xrot = temp.xrot;
+    state->pose.yrot = temp.yrot;
+    state->pose.zrot = temp.zrot;
+
+    transformFromMount(state->speeds, temp);
+    state->speeds.x = temp.x;
+    state->speeds.y = temp.y;
+    state->speeds.z = temp.z;
+    state->speeds.xrot = temp.xrot;
+    state->speeds.yrot = temp.yrot;
+    state->speeds.zrot = temp.zrot;
+
+    transformFromMount(state->forces, temp, false);
+    state->forces.x = temp.x;
+    state->forces.y = temp.y;
+    state->forces.z = temp.z;
+    state->forces.xrot = temp.xrot;
+    state->forces.yrot = temp.yrot;
+    state->forces.zrot = temp.zrot;
+
+    for (int i = 0; i < axisCount; ++i)
+    {
+      state->axis[i] *= (180.0f / 3.141592654f);
+    }
   }
 
 } // crpi_robot
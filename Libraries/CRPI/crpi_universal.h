@@ -24,12 +24,37 @@
 #endif
 
 #include "crpi.h"
+#include "crpi_cmdqueue.h"
+#include "crpi_metrics.h"
+#include "crpi_recorder.h"
+#include "crpi_timesync.h"
+#include "crpi_wrench.h"
 
 
 #pragma warning (disable: 4251)
 
 #include <vector>
 #include <sstream>
+#include <functional>
+
+//! @brief Longest extrapolation (s) of GetPredictedState.  Older feedback has stopped rather than
+//!        lagged, and carrying its speeds further would only move the prediction further off.
+//!
+#define UR_PREDICT_MAX 0.1
+
+//! @brief Secondary client interface port, which pushes the controller's status at 10 Hz, and
+//!        dashboard server port
+//!
+#define UR_SECONDARY_PORT 30002
+#define UR_DASHBOARD_PORT 29999
+
+//! @brief Largest secondary interface message accepted by the reassembly buffer
+//!
+#define UR_SECONDARY_MAX 16384
+
+//! @brief Seconds to wait for the dashboard server to answer a command
+//!
+#define UR_DASHBOARD_TIMEOUT 2.0
 
 using namespace std;
 using namespace Math;
@@ -37,21 +62,259 @@ using namespace Math;
 
 namespace crpi_robot
 {
+  //! @brief URScript program text split once into fixed segments and numeric slots, so that each
+  //!        command only formats its numbers instead of rebuilding the whole program
+  //!
+  class LIBRARY_API UrScriptTemplate
+  {
+  public:
+    //! @brief Default constructor
+    //!
+    UrScriptTemplate ();
+
+    //! @brief Split program text into fixed segments
+    //!
+    //! @param text Program text, with each '$' marking a numeric slot
+    //!
+    void compile (const char *text);
+
+    //! @brief Get the number of numeric slots in the compiled text
+    //!
+    int slots () const;
+
+    //! @brief Fill the numeric slots and write the resulting program
+    //!
+    //! @param values Array of slots() values, formatted as a default stringstream would
+    //! @param out    Program text (replaced, its capacity is reused)
+    //!
+    void render (const double *values, string &out) const;
+
+  private:
+    //! @brief Fixed text before each slot, then the text after the last slot
+    //!
+    vector<string> text_;
+  };
+
+
+  //! @brief Robot modes reported by the controller (RobotStateSnapshot::robotMode)
+  //!
+  typedef enum
+  {
+    UR_MODE_NO_CONTROLLER = -1,
+    UR_MODE_DISCONNECTED = 0,
+    UR_MODE_CONFIRM_SAFETY,
+    UR_MODE_BOOTING,
+    UR_MODE_POWER_OFF,
+    UR_MODE_POWER_ON,
+    UR_MODE_IDLE,
+    UR_MODE_BACKDRIVE,
+    UR_MODE_RUNNING,
+    UR_MODE_UPDATING_FIRMWARE
+  } UrRobotMode;
+
+  //! @brief Safety modes reported by the controller (RobotStateSnapshot::safetyMode)
+  //!
+  typedef enum
+  {
+    UR_SAFETY_NORMAL = 1,
+    UR_SAFETY_REDUCED,
+    UR_SAFETY_PROTECTIVE_STOP,
+    UR_SAFETY_RECOVERY,
+    UR_SAFETY_SAFEGUARD_STOP,
+    UR_SAFETY_SYSTEM_EMERGENCY_STOP,
+    UR_SAFETY_ROBOT_EMERGENCY_STOP,
+    UR_SAFETY_VIOLATION,
+    UR_SAFETY_FAULT,
+    UR_SAFETY_VALIDATE_JOINT_ID,
+    UR_SAFETY_UNDEFINED,
+    UR_SAFETY_AUTOMATIC_MODE_SAFEGUARD_STOP,
+    UR_SAFETY_SYSTEM_THREE_POSITION_ENABLING_STOP
+  } UrSafetyMode;
+
+  //! @brief Controller status, as decoded from the secondary interface
+  //!
+  struct urStatus
+  {
+    //! @brief UrRobotMode, UrSafetyMode, CrpiProgramState, and CrpiStatusFlag values
+    //!
+    int robotMode;
+    int safetyMode;
+    int programState;
+    unsigned int status;
+
+    //! @brief Whether the controller has reported its status since the connection was opened
+    //!
+    bool valid;
+
+    urStatus () :
+      robotMode(UR_MODE_NO_CONTROLLER),
+      safetyMode(UR_SAFETY_UNDEFINED),
+      programState(PROGRAM_UNKNOWN),
+      status(0),
+      valid(false)
+    {
+    }
+
+    bool operator== (const urStatus &other) const
+    {
+      return robotMode == other.robotMode && safetyMode == other.safetyMode &&
+             programState == other.programState && status == other.status && valid == other.valid;
+    }
+  };
+
+  //! @brief Run by the status thread when the controller's status changes, with the status
+  //!        before and after the change
+  //!
+  typedef std::function<void (const urStatus &, const urStatus &)> UrStatusCallback;
+
+  //! @brief Joint speeds (rad/s) of one published state
+  //!
+  struct urAxisSpeeds
+  {
+    double speeds[6];
+    unsigned long sequence;
+
+    urAxisSpeeds () :
+      sequence(0)
+    {
+      for (int i = 0; i < 6; ++i)
+      {
+        speeds[i] = 0.0;
+      }
+    }
+  };
+
+
   struct LIBRARY_API universalHandler
   {
-    ulapi_mutex_struct *handle;
-    ulapi_mutex_struct *TCPIPhandle;
+    //! @brief Reader-writer lock (ulapi_rwlock_new) on the robot state and the motion script;
+    //!        the feedback thread and the script builders write, the motion waits read
+    //!
+    void *handle;
+
+    //! @brief Fast lock (ulapi_fastlock_new) on the command connection
+    //!
+    void *TCPIPhandle;
+
     CrpiRobotParams params;
     bool runThread;
     void *rob;
+    //! @brief Persistent command connection to the controller (-1 while disconnected), guarded
+    //!        by TCPIPhandle and re-established by the keep-alive thread or on a failed send
+    //!
     ulapi_integer clientID;
+
+    //! @brief Time (ulapi_time, s) of the last connection attempt
+    //!
+    double connectTime;
+
+    //! @brief Duration (s) of the last successful command write, and the longest one
+    //!
+    double sendLatency, worstLatency;
+
+    //! @brief Number of times the command connection has been re-established
+    //!
+    unsigned long reconnects;
+
+    //! @brief Writer of the command connection; every script goes through it, so a stop is
+    //!        written ahead of any queued script
+    //!
+    CrpiCommandQueue *commands;
+
+    //! @brief Runtime metrics, labelled with the controller's address:  feedback frames
+    //!        published and dropped (truncated, unparsable, or lost to a framing error), the
+    //!        feedback rate, reconnections of each connection, and time spent waiting for
+    //!        TCPIPhandle to send a script
+    //!
+    CrpiCounter *framesMetric;
+    CrpiCounter *droppedMetric;
+    CrpiRateMeter rateMetric;
+    CrpiCounter *feedbackReconnectMetric;
+    CrpiCounter *commandReconnectMetric;
+    CrpiHistogram *lockWaitMetric;
+
+    //! @brief Recorder channel of the published states (see crpi_recorder.h)
+    //!
+    int recordChannel;
+
+    //! @brief Processing applied to each wrench before it is published (see SetParameter)
+    //!
+    CrpiWrenchFilter wrench;
+
     stringstream moveMe;
     bool poseGood;
     robotPose curPose;
     robotAxes curAxes;
     robotPose curForces;
     robotPose curSpeeds;
+    robotAxes curAxisSpeeds;
     robotIO curIO;
+
+    //! @brief Time (ulapi_time, s) at which the current state was received from the controller
+    //!
+    double stateTime;
+
+    //! @brief The controller's clock, followed through the Time (real-time interface) or
+    //!        timestamp (RTDE) field of each frame, and registered as "universal/<address>"
+    //!        (see crpi_timesync.h).  Once it is synchronized, states are stamped with the
+    //!        controller's sample time mapped onto ulapi_time, without the network jitter.
+    //!
+    CrpiTimeSync *clock;
+
+    //! @brief Number of state frames published by the feedback thread
+    //!
+    unsigned long stateCount;
+
+    //! @brief Condition variable broadcast (with stateMutex held) each time stateCount advances.
+    //!        stateCount is changed and read only with stateMutex held.
+    //!
+    void *stateCond;
+    ulapi_mutex_struct *stateMutex;
+
+    //! @brief Latest state, published by the feedback thread for lock-free readers
+    //!
+    crpi_seqlock<RobotStateSnapshot> state;
+
+    //! @brief Joint speeds (rad/s) of the state with the same sequence, which has no room for
+    //!        them; published just before it
+    //!
+    crpi_seqlock<urAxisSpeeds> axisSpeeds;
+
+    //! @brief Controller status, published by the status thread from the secondary interface
+    //!        and copied into every state published after it
+    //!
+    crpi_seqlock<urStatus> status;
+
+    //! @brief Callbacks run by the status thread when the status changes, their next ID, and a
+    //!        fast lock (ulapi_fastlock_new) on both
+    //!
+    vector<pair<int, UrStatusCallback> > statusWatches;
+    int nextWatch;
+    void *watchLock;
+
+    //! @brief Poller the status thread waits on (woken to stop it)
+    //!
+    void *statusPoller;
+
+    //! @brief RTDE connection carrying the setpoint input registers (0 if not connected)
+    //!
+    ulapi_integer rtdeClient;
+
+    //! @brief Controller-assigned ID of the setpoint input recipe (-1 if unavailable)
+    //!
+    int rtdeInputRecipe;
+
+    //! @brief Controller-assigned ID of the output recipe carrying guarded search results (-1 if
+    //!        unavailable), and the latest results:  the ending condition (CrpiSearchEnd), the run
+    //!        it belongs to, and the TCP pose (m, rotation vector) when the condition was met.  A
+    //!        native program reports the number of steps it has finished in place of the ending
+    //!        condition.
+    //!
+    int rtdeSearchRecipe;
+    int searchReason;
+    int searchRun;
+    double searchPose[6];
+
     int curTool;
     double DIO;
 
@@ -66,6 +329,10 @@ namespace crpi_robot
   class LIBRARY_API CrpiUniversal
   {
   public:
+    //! @brief Number of axes of the arm (see CrpiAxisCount)
+    //!
+    static constexpr int axisCount = 6;
+
     //! @brief Default constructor
     //!
     //! @param params Configuration parameters for the CRPI instance of this robot
@@ -85,7 +352,7 @@ namespace crpi_robot
     //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
     //!         not accepted, and FAILURE if the command is accepted but not executed successfully
     //!
-    CanonReturn ApplyCartesianForceTorque (robotPose &robotForceTorque, vector<bool> activeAxes, vector<bool> manipulator);
+    CanonReturn ApplyCartesianForceTorque (robotPose &robotForceTorque, const vector<bool> &activeAxes, const vector<bool> &manipulator);
 
     //! @brief Apply joint torques
     //!
@@ -223,6 +490,98 @@ namespace crpi_robot
     //!
     CanonReturn GetRobotTorques (robotAxes *torques);
 
+    //! @brief Get a consistent snapshot of the robot's latest state without waiting on the
+    //!        robot's feedback connection
+    //!
+    //! @param state Snapshot to be populated by the method
+    //!
+    //! @return SUCCESS if a state has been published by the driver, REJECT if no state is
+    //!         available yet or the robot does not publish state snapshots
+    //!
+    CanonReturn GetRobotState (RobotStateSnapshot *state);
+
+    //! @brief Get the robot's latest state extrapolated to compensate for its age:  the TCP pose
+    //!        is advanced by the TCP speed, and the axes by the joint speeds, from the time the
+    //!        state was sampled to the time requested
+    //!
+    //! @param state Snapshot to be populated by the method, as by GetRobotState; its timestamp is
+    //!              the time predicted for
+    //! @param lead  Seconds past the current time (ulapi_time) to predict for; 0 for now
+    //!
+    //! @return SUCCESS if a state has been published by the driver, REJECT if no state is
+    //!         available yet
+    //!
+    //! @note States are not extrapolated more than UR_PREDICT_MAX seconds, so the prediction of
+    //!       stale feedback is held there.  The age is measured from the controller's sample time
+    //!       once its clock is followed (see crpi_timesync.h), which still leaves out the least
+    //!       transport delay seen (typically well under a millisecond).
+    //!
+    CanonReturn GetPredictedState (RobotStateSnapshot *state, double lead = 0.0);
+
+    //! @brief Get timing statistics of the persistent command connection
+    //!
+    //! @param last       Duration (s) of the most recent successful command write
+    //! @param worst      Longest write (s) since the robot was constructed
+    //! @param reconnects Number of times the connection has been re-established
+    //!
+    void GetSendLatency (double &last, double &worst, unsigned long &reconnects);
+
+    //! @brief Get the time StopMotion waited for its script to be written
+    //!
+    //! @param last  Wait (s) of the most recent stop
+    //! @param worst Longest wait (s) since the robot was constructed
+    //!
+    void GetStopLatency (double &last, double &worst);
+
+    //! @brief Get the controller's status, as last pushed on the secondary interface (10 Hz).
+    //!        The same fields are in every state snapshot (STATE_STATUS).
+    //!
+    //! @param status Status to be populated by the method
+    //!
+    //! @return True if the controller has reported its status, false if it has not yet
+    //!
+    bool GetStatus (urStatus &status) const;
+
+    //! @brief Get one part of the controller's status without locking (see GetStatus)
+    //!
+    //! @return The UrRobotMode, the UrSafetyMode, the CrpiProgramState, or whether the arm is
+    //!         in a protective stop
+    //!
+    int GetRobotMode () const;
+    int GetSafetyMode () const;
+    CrpiProgramState GetProgramState () const;
+    bool IsProtectiveStopped () const;
+
+    //! @brief Run a callback whenever the controller's status changes (e.g., on a protective
+    //!        stop, or when a program stops)
+    //!
+    //! @param callback Run from the status thread with the status before and after the change;
+    //!                 it must not add or remove watches, or wait
+    //!
+    //! @return An identifier for UnwatchStatus
+    //!
+    int WatchStatus (UrStatusCallback callback);
+
+    //! @brief Stop running a callback added by WatchStatus
+    //!
+    //! @param id Identifier returned by WatchStatus
+    //!
+    void UnwatchStatus (int id);
+
+    //! @brief Send a command to the dashboard server (e.g., "unlock protective stop", "play",
+    //!        "programState") over a connection that is kept open between commands, so that
+    //!        supervisors need not open their own
+    //!
+    //! @param command The command, without the trailing newline
+    //! @param reply   The server's one-line answer, without the newline
+    //!
+    //! @return SUCCESS if the server answered, FAILURE if it could not be reached or did not
+    //!         answer within UR_DASHBOARD_TIMEOUT
+    //!
+    //! @note Commands from different threads are serialized
+    //!
+    CanonReturn Dashboard (const char *command, string &reply);
+
     //! @brief Move a virtual attractor to a specified coordinate in Cartesian space for force control
     //!
     //! @param pose The 6DOF destination of the virtual attractor 
@@ -242,6 +601,72 @@ namespace crpi_robot
     //!
     CanonReturn MoveToAxisTarget (robotAxes &axes, bool useBlocking);
 
+    //! @brief Start streaming motion setpoints to the robot at the controller's native rate
+    //!
+    //! @return SUCCESS if the robot is ready to accept setpoints, REJECT if streaming is not
+    //!         supported, and FAILURE if the stream could not be started
+    //!
+    CanonReturn BeginStream ();
+
+    //! @brief Send the next Cartesian setpoint of an active stream without waiting for the motion
+    //!
+    //! @param pose The 6DOF setpoint for the robot's TCP in Cartesian space coordinates
+    //!
+    //! @return SUCCESS if the setpoint was sent, REJECT if no stream is active, and FAILURE if the
+    //!         setpoint could not be sent
+    //!
+    CanonReturn StreamPose (robotPose &pose);
+
+    //! @brief Send the next joint setpoint of an active stream without waiting for the motion
+    //!
+    //! @param axes Target axis values specified in the current axial unit
+    //!
+    //! @return SUCCESS if the setpoint was sent, REJECT if no stream is active, and FAILURE if the
+    //!         setpoint could not be sent
+    //!
+    CanonReturn StreamAxes (robotAxes &axes);
+
+    //! @brief Stop an active stream and bring the robot to rest
+    //!
+    //! @return SUCCESS if the stream was stopped, REJECT if no stream is active, and FAILURE if the
+    //!         robot could not be stopped
+    //!
+    CanonReturn EndStream ();
+
+    //! @brief Start streaming Cartesian force/torque targets to a force controller that stays
+    //!        running on the robot, so each update needs no new program
+    //!
+    //! @return SUCCESS if the robot is ready to accept wrench targets, REJECT if force streaming
+    //!         is not supported or a stream is already active, and FAILURE if the stream could
+    //!         not be started
+    //!
+    //! @note The robot holds its position (no axes selected) until the first StreamWrench.  The
+    //!       "stream_period" and "stream_deadline" settings of BeginStream also apply.
+    //!
+    CanonReturn BeginWrenchStream ();
+
+    //! @brief Send the next force/torque target of an active wrench stream without waiting for
+    //!        the robot to respond
+    //!
+    //! @param wrench     Target forces (N) along and torques (N m) about the tool axes
+    //! @param activeAxes Which tool axes (x, y, z, xrot, yrot, zrot) are force controlled; the
+    //!                   others hold position.  TRUE = ACTIVE, FALSE = INACTIVE
+    //! @param limits     For active axes, the largest TCP speed along or about the axis (length or
+    //!                   angle units per second); for the others, the largest deviation from the
+    //!                   held position (length or angle units)
+    //!
+    //! @return SUCCESS if the target was sent, REJECT if no wrench stream is active, and FAILURE
+    //!         if the target could not be sent
+    //!
+    CanonReturn StreamWrench (robotPose &wrench, const vector<bool> &activeAxes, robotPose &limits);
+
+    //! @brief Stop an active wrench stream, leave force control, and bring the robot to rest
+    //!
+    //! @return SUCCESS if the stream was stopped, REJECT if no wrench stream is active, and
+    //!         FAILURE if the robot could not be stopped
+    //!
+    CanonReturn EndWrenchStream ();
+
     //! @brief Set the accerlation for the controlled pose to the given value in length units per
     //!        second per second
     //!
@@ -325,6 +750,29 @@ namespace crpi_robot
     //! @return SUCCESS if command is accepted and is executed successfully, REJECT if the command is
     //!         not accepted, and FAILURE if the command is accepted but not executed successfully
     //!
+    //! @note "guarded_search" (a crpiGuardedSearch) runs a search on the controller and returns
+    //!       when it ends.  This requires RTDE feedback, since the result is read from the RTDE
+    //!       output registers.  The waypoints are followed with servoj, using the
+    //!       "stream_lookahead" and "stream_gain" settings.
+    //! @note "native_program" (a crpiNativeProgram) translates a compiled program into one
+    //!       URScript program and, if asked, runs it.  Running requires RTDE feedback:  the
+    //!       program reports the steps it has finished in the same output registers.
+    //! @note The wrench returned by GetRobotForces is processed on the feedback thread (see
+    //!       crpi_wrench.h), set up with:  "wrench_gravity" and "wrench_inertia" (bool, remove the
+    //!       weight and inertial load of the tool given to Couple), "wrench_lowpass" (double,
+    //!       cutoff Hz), "wrench_kalman" and "wrench_kalman_process" (double, measurement and
+    //!       process noise variances, N^2), and "wrench_tare" (int, samples to average into the
+    //!       bias).  A value of 0 turns a stage off.  Controllers that already remove the
+    //!       payload Couple sets from their own wrench estimate should not also use
+    //!       "wrench_gravity".
+    //! @note "early_release" (bool) lets blocking MoveTo and MoveStraightTo calls return once
+    //!       the robot's time to arrival (remaining distance over TCP speed) is below the
+    //!       command latency, so that the next command is generated and sent during the tail of
+    //!       the motion and starts as this one arrives.  The latency, from generating a move to
+    //!       the robot starting to move, is measured on moves that start from rest;
+    //!       "command_latency" (double, s) seeds or overrides the estimate.  URScript replaces
+    //!       the running program, so an overestimated latency cuts the end of a move short.
+    //!
     CanonReturn SetParameter (const char *paramName, void *paramVal);
 
     //! @brief Set the accerlation for the controlled pose to the given percentage of the robot's
@@ -425,11 +873,68 @@ namespace crpi_robot
     matrix *pin_, *pout_;
     matrix *forward_, *backward_;
 
+    //! @brief A mount transform with unit conversions folded in
+    //!
+    struct mountTransform
+    {
+      //! @brief Mount rotation, applied to orientations
+      //!
+      Mat<3, 3> rot;
+
+      //! @brief Mount rotation and offset in the output length units, applied to positions
+      //!
+      Mat<3, 3> pos;
+      double offset[3];
+
+      //! @brief Factor applied to angles on the client's side of the transform
+      //!
+      double angle;
+    };
+
+    //! @brief Transforms to and from the mount in the client's units, and in robot units (meters
+    //!        and radians, used for forces).  The client-unit transforms are kept twice so that
+    //!        updateMountCache can rebuild one while feedback is read through the other.
+    //!
+    mountTransform toMount_[2], fromMount_[2];
+    mountTransform toMountRaw_, fromMountRaw_;
+    std::atomic<int> mountActive_;
+
     CrpiRobotParams params_;
 
     void *task;
     unsigned long threadID_;
 
+    //! @brief Connection monitor registered on the SensorHub timer wheel
+    //!
+    int keepalive_;
+
+    //! @brief Secondary interface thread (SensorHub loop) that decodes the controller's status
+    //!
+    void *statusTask_;
+
+    //! @brief Persistent dashboard server connection (0 while disconnected), bytes received
+    //!        past the last answer, and a fast lock (ulapi_fastlock_new) on both
+    //!
+    ulapi_integer dashboard_;
+    string dashboardHeld_;
+    void *dashboardLock_;
+
+    //! @brief Open the dashboard connection and consume the server's greeting
+    //!
+    //! @return True if the server is connected
+    //!
+    bool dashboardConnect ();
+
+    //! @brief Read one line from the dashboard server
+    //!
+    //! @param line    The line, without the newline
+    //! @param timeout Seconds to wait for it
+    //!
+    //! @return 1 if a line was read, 0 if the server closed the connection, -1 on timeout or
+    //!         error
+    //!
+    int dashboardLine (string &line, double timeout);
+
     bool connectRobot();
 
     universalHandler handle_;
@@ -451,6 +956,40 @@ namespace crpi_robot
     bool firstIO_;
     robotIO curIO_;
 
+    //! @brief Whether robot state is received over RTDE (port 30004) rather than the real-time
+    //!        interface (port 30003).  Selected with <Feedback Protocol="RTDE"/> in the robot XML.
+    //!
+    bool useRTDE_;
+
+    //! @brief Sequence number of the last setpoint written to the RTDE input registers
+    //!
+    int setpointSeq_;
+
+    //! @brief Whether a setpoint stream started by BeginStream is active
+    //!
+    bool streaming_;
+
+    //! @brief Whether a wrench stream started by BeginWrenchStream is active
+    //!
+    bool wrenchStreaming_;
+
+    //! @brief Stream settings (see SetParameter):  servoj period (s), lookahead time (s), gain,
+    //!        setpoint deadline (s), and whether StreamAxes values are joint speeds (speedj)
+    //!
+    double streamPeriod_, streamLookahead_, streamGain_, streamDeadline_;
+    bool streamVelocity_;
+
+    //! @brief Whether blocking moves are released early (see SetParameter), the estimated
+    //!        command latency (s, 0 until measured), and the count of early releases
+    //!
+    bool earlyRelease_;
+    double commandLatency_;
+    CrpiCounter *earlyReleaseMetric_;
+
+    //! @brief Identifier of the last guarded search or native program sent to the controller
+    //!
+    int searchRun_;
+
     crpi_timer timer_;
 
     //! @brief Acceleration profile of motions
@@ -465,6 +1004,19 @@ namespace crpi_robot
     //!
     stringstream tempString_;
 
+    //! @brief Programs compiled once per session:  movej to a pose, movej to axes, movel to a pose
+    //!
+    UrScriptTemplate moveTemplate_[3];
+
+    //! @brief Programs compiled once per session:  set_tcp, set_payload, and force-mode moves with
+    //!        and without the final movej
+    //!
+    UrScriptTemplate tcpTemplate_, payloadTemplate_, forceTemplate_, forceMoveTemplate_;
+
+    //! @brief Rendered program text, reused between commands
+    //!
+    string script_;
+
     //! @brief Message buffer for serial and socket communications
     //!
     char *mssgBuffer_;
@@ -485,6 +1037,21 @@ namespace crpi_robot
     //!
     bool generateMove (char moveType, char posType, char deltaType, vector<double> &input);
 
+    //! @brief Generate a single program moving linearly through a series of Cartesian targets,
+    //!        blending past each target within its radius
+    //!
+    //! @param targets       6 position values for each waypoint, in robot units
+    //! @param accelerations Tool acceleration of each move (m/s^2)
+    //! @param speeds        Tool speed of each move (m/s)
+    //! @param radii         Blend radius at each waypoint (m), 0 to stop on the waypoint
+    //!
+    //! @return True if motion string generation was successful, false otherwise
+    //!
+    bool generateBlendedMove (vector<double> &targets,
+                              vector<double> &accelerations,
+                              vector<double> &speeds,
+                              vector<double> &radii);
+
     //! @brief Generate a tool activation request for the UR robot
     //!
     //! @param mode  Specify the mode of actuation of the robot output: binary (B), analog (A), definition (D)
@@ -513,13 +1080,122 @@ namespace crpi_robot
     //!
     bool send ();
 
+    //! @brief Send a script through the command queue and wait until it is written
+    //!
+    //! @param script   The script
+    //! @param priority Its priority (CMDQUEUE_STOP for StopMotion)
+    //!
+    //! @return True if the script was written, false otherwise
+    //!
+    bool send (const string &script, CrpiCommandPriority priority);
+
     //! @brief Store data from robot in mssgBuffer_ using whatever communication protocol is defined
     //!
     bool get ();
 
+    //! @brief Block until the feedback thread publishes a state newer than lastCount
+    //!
+    //! @param lastCount Sequence number of the last state seen; updated on return
+    //! @param timeout   Maximum time to wait (s)
+    //!
+    //! @return True if a new state arrived, false if the wait timed out
+    //!
+    bool waitForState (unsigned long &lastCount, double timeout);
+
+    //! @brief Block until the robot reaches a target pose
+    //!
+    //! @param target   The target, in robot units
+    //! @param checkRot Whether the orientation must also be reached
+    //! @param sent     When the move was generated (ulapi_time), to measure the command latency
+    //!                 and allow early release; 0 for neither
+    //!
+    //! @return True if the target was reached (or released early), false if the robot stalled
+    //!         or timed out
+    //!
+    bool waitForPose (robotPose &target, bool checkRot, double sent = 0.0);
+
+    //! @brief Write a setpoint to the RTDE input registers read by the generateRegisterServo program
+    //!
+    //! @param mode   One of the UR_SETPOINT_* modes
+    //! @param target Six joint positions (rad), TCP pose (m, rotation vector), or joint speeds
+    //!               (rad/s); or a wrench (N, N m) followed by six force mode limits (m, rad).
+    //!               Missing values are sent as 0.
+    //! @param select Force mode axis selection, bit i for axis i
+    //!
+    //! @return True if the setpoint was sent, false if RTDE inputs are not available
+    //!
+    bool writeSetpoint (int mode, vector<double> &target, int select = 0);
+
+    //! @brief Generate a resident URScript program in moveMe that follows the RTDE setpoint
+    //!        registers, so streamed motion needs a single upload rather than one per step
+    //!
+    //! @param period    Control period of each servoj/speedj call (s)
+    //! @param lookahead servoj lookahead time (s), 0.03 to 0.2
+    //! @param gain      servoj proportional gain, 100 to 2000
+    //! @param deadline  Time (s) without a new setpoint sequence number after which the program
+    //!                  stops the robot and exits, or 0 to wait indefinitely
+    //!
+    //! @return True if the program was generated, false if RTDE is not in use
+    //!
+    bool generateRegisterServo (double period, double lookahead, double gain, double deadline);
+
+    //! @brief Generate a resident URScript program in moveMe that runs force_mode with the wrench,
+    //!        axis selection, and limits in the RTDE setpoint registers, updated every cycle
+    //!
+    //! @param period   Controller cycle time (s), used to measure the deadline
+    //! @param deadline Time (s) without a new setpoint sequence number after which the program
+    //!                 leaves force mode and stops the robot, or 0 to wait indefinitely
+    //!
+    //! @return True if the program was generated, false if RTDE is not in use
+    //!
+    bool generateRegisterForce (double period, double deadline);
+
+    //! @brief Generate a URScript program in moveMe that runs a guarded search, with a thread
+    //!        testing its conditions every controller cycle, and reports the result in the RTDE
+    //!        output registers
+    //!
+    //! @param search The search, in CRPI units
+    //! @param run    Identifier reported with the result
+    //!
+    //! @return True if the program was generated, false if the search cannot be run this way
+    //!
+    bool generateGuardedSearch (crpiGuardedSearch &search, int run);
+
+    //! @brief Run a guarded search and wait for its result (SetParameter "guarded_search")
+    //!
+    CanonReturn runGuardedSearch (crpiGuardedSearch &search);
+
+    //! @brief Translates compiled programs into URScript
+    //!
+    class nativeWriter;
+
+    //! @brief Translate a compiled program into one URScript program in moveMe
+    //!
+    //! @param native The program to translate; its text is set to the URScript
+    //! @param run    Identifier reported with the number of steps finished in the RTDE output
+    //!               registers (as a guarded search reports its result), or 0 to report nothing
+    //!
+    //! @return True if the program was translated, false if one of its steps cannot be
+    //!
+    bool generateNative (crpiNativeProgram &native, int run);
+
+    //! @brief Translate a compiled program and, if asked, run it on the controller and wait for
+    //!        it to end (SetParameter "native_program")
+    //!
+    CanonReturn runNative (crpiNativeProgram &native);
+
+    //! @brief Rebuild the client-unit mount transforms from backward_, forward_, and the current
+    //!        length and angle units
+    //!
+    void updateMountCache ();
+
     bool transformToMount(robotPose &in, robotPose &out, bool scale = true);
     bool transformFromMount(robotPose &in, robotPose &out, bool scale = true);
 
+    //! @brief Apply the conversions of the individual Get* methods to a raw state snapshot
+    //!
+    void convertState (RobotStateSnapshot *state);
+
   }; // CrpiUniversal
 
 } // namespace crpi_robot
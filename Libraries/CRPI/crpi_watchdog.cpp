@@ -0,0 +1,148 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_watchdog.cpp
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Feedback watchdog definitions.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_watchdog.h"
+#include "crpi_hub.h"
+#include "crpi_log.h"
+#include <math.h>
+#include <stdio.h>
+
+using namespace std;
+
+namespace crpi_robot
+{
+  LIBRARY_API CrpiWatchdog::CrpiWatchdog (const CrpiWatchdogParams &params, const string &labels) :
+    params_(params),
+    start_(ulapi_time()),
+    lastSeq_(0),
+    lastStamp_(0.0),
+    lastInterval_(-1.0),
+    seen_(false),
+    level_(WATCHDOG_OK),
+    age_(0.0),
+    jitter_(0.0),
+    commanded_(1.0),
+    labels_(labels)
+  {
+    if (params_.slowSpeed <= 0.0 || params_.slowSpeed > 1.0)
+    {
+      params_.slowSpeed = 1.0;
+    }
+    if (params_.period < HUB_TICK)
+    {
+      params_.period = HUB_TICK;
+    }
+
+    ageMetric_ = CrpiMetrics::Gauge("crpi_feedback_age_seconds", "Age of the latest robot state", labels);
+    jitterMetric_ = CrpiMetrics::Gauge("crpi_feedback_jitter_seconds",
+                                       "Inter-arrival jitter of robot states (RFC 3550 estimator)", labels);
+    levelMetric_ = CrpiMetrics::Gauge("crpi_watchdog_level", "Watchdog level (0 ok, 1 warn, 2 slow, 3 stop)",
+                                      labels);
+    intervalMetric_ = CrpiMetrics::Histogram("crpi_feedback_interval_seconds", "Time between robot states",
+                                             labels);
+    warnMetric_ = CrpiMetrics::Counter("crpi_watchdog_actions", "Watchdog policies applied",
+                                       labels + "," + CrpiMetrics::Label("policy", "warn"));
+    slowMetric_ = CrpiMetrics::Counter("crpi_watchdog_actions", "Watchdog policies applied",
+                                       labels + "," + CrpiMetrics::Label("policy", "slow"));
+    stopMetric_ = CrpiMetrics::Counter("crpi_watchdog_actions", "Watchdog policies applied",
+                                       labels + "," + CrpiMetrics::Label("policy", "stop"));
+  }
+
+
+  LIBRARY_API CrpiWatchdogLevel CrpiWatchdog::Check (const RobotStateSnapshot &state, bool valid, double now)
+  {
+    double age, interval, jitter = jitter_.load(std::memory_order_relaxed);
+    int level = WATCHDOG_OK, current = level_.load(std::memory_order_relaxed);
+
+    if (valid && (!seen_ || state.sequence != lastSeq_))
+    {
+      if (seen_)
+      {
+        interval = state.timestamp - lastStamp_;
+        intervalMetric_->Observe(interval);
+        if (lastInterval_ >= 0.0)
+        {
+          jitter += (fabs(interval - lastInterval_) - jitter) / 16.0;
+        }
+        lastInterval_ = interval;
+      }
+      lastSeq_ = state.sequence;
+      lastStamp_ = state.timestamp;
+      seen_ = true;
+    }
+    age = now - (seen_ ? lastStamp_ : start_);
+
+    if ((params_.warnAge > 0.0 && age >= params_.warnAge) ||
+        (params_.jitterWarn > 0.0 && jitter >= params_.jitterWarn))
+    {
+      level = WATCHDOG_WARN;
+    }
+    if (params_.slowAge > 0.0 && age >= params_.slowAge)
+    {
+      level = WATCHDOG_SLOW;
+    }
+    if (params_.stopAge > 0.0 && age >= params_.stopAge)
+    {
+      level = WATCHDOG_STOP;
+    }
+
+    //! A slowed or stopped robot stays so until its feedback is fresh again, rather than
+    //! stepping down a level at a time as the age crosses each threshold
+    if (level < current && current >= WATCHDOG_SLOW && level > WATCHDOG_OK)
+    {
+      level = current;
+    }
+
+    if (level > current)
+    {
+      if (level == WATCHDOG_WARN)
+      {
+        warnMetric_->Inc();
+      }
+      CRPI_LOG(CRPI_LOG_WARNING, "CRPI watchdog:  {%s} feedback %.3f s old, jitter %.4f s:  %s", labels_.c_str(),
+               age, jitter, (level == WATCHDOG_STOP) ? "stopping" : ((level == WATCHDOG_SLOW) ? "slowing" : "warning"));
+    }
+    else if (level == WATCHDOG_OK && current != WATCHDOG_OK)
+    {
+      CRPI_LOG(CRPI_LOG_INFO, "CRPI watchdog:  {%s} feedback recovered", labels_.c_str());
+    }
+
+    age_.store(age, std::memory_order_relaxed);
+    jitter_.store(jitter, std::memory_order_relaxed);
+    level_.store(level, std::memory_order_release);
+    ageMetric_->Set(age);
+    jitterMetric_->Set(jitter);
+    levelMetric_->Set(level);
+    return (CrpiWatchdogLevel)level;
+  }
+
+
+  LIBRARY_API double CrpiWatchdog::Speed () const
+  {
+    return (Level() >= WATCHDOG_SLOW) ? Commanded() * params_.slowSpeed : Commanded();
+  }
+
+
+  LIBRARY_API void CrpiWatchdog::CountAction (CrpiWatchdogLevel level)
+  {
+    if (level == WATCHDOG_STOP)
+    {
+      stopMetric_->Inc();
+    }
+    else if (level == WATCHDOG_SLOW)
+    {
+      slowMetric_->Inc();
+    }
+  }
+} // namespace crpi_robot
@@ -0,0 +1,143 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_watchdog.h
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Feedback watchdog for the robot interfaces.
+//
+//  A streaming driver keeps answering from its last good state when its
+//  feedback stops, so nothing above it can tell the data has gone stale.
+//  The watchdog samples the driver's state snapshots on the SensorHub,
+//  tracks their age and inter-arrival jitter, and escalates through the
+//  policies configured by CrpiWatchdogParams:  warn, slow the robot down
+//  (SetRelativeSpeed), and stop it (StopMotion).  The robot's speed is put
+//  back once fresh feedback returns; a stopped motion is not resumed.  Ages,
+//  jitter, intervals, the current level, and the actions taken are exported
+//  as metrics (see crpi_metrics.h).
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_watchdog_H
+#define crpi_watchdog_H
+
+#include "crpi.h"
+#include "crpi_metrics.h"
+#include <atomic>
+#include <string>
+
+namespace crpi_robot
+{
+  //! @brief Escalation levels of the watchdog, in increasing order of severity
+  //!
+  typedef enum
+  {
+    WATCHDOG_OK = 0, //! Feedback is fresh
+    WATCHDOG_WARN,   //! Feedback is late, or arriving with too much jitter
+    WATCHDOG_SLOW,   //! The robot has been slowed down
+    WATCHDOG_STOP    //! The robot has been stopped
+  } CrpiWatchdogLevel;
+
+  //! @ingroup Robot
+  //!
+  //! @brief Tracks the age and jitter of a robot's state snapshots and decides the level.  The
+  //!        owner (CrpiRobot) samples the robot and applies the policies; Check is called from
+  //!        one thread, the other methods from any.
+  //!
+  class LIBRARY_API CrpiWatchdog
+  {
+  public:
+    //! @brief Constructor
+    //!
+    //! @param params Thresholds and check period
+    //! @param labels Metric labels of the robot (see CrpiMetrics::Label)
+    //!
+    CrpiWatchdog (const CrpiWatchdogParams &params, const std::string &labels);
+
+    //! @brief Update the watchdog with the robot's latest state
+    //!
+    //! @param state The latest state snapshot
+    //! @param valid Whether the robot has returned a state (false until its first feedback)
+    //! @param now   Current time (s, ulapi_time)
+    //!
+    //! @return The new level
+    //!
+    CrpiWatchdogLevel Check (const RobotStateSnapshot &state, bool valid, double now);
+
+    //! @brief The current level, feedback age (s), and inter-arrival jitter (s)
+    //!
+    CrpiWatchdogLevel Level () const
+    {
+      return (CrpiWatchdogLevel)level_.load(std::memory_order_acquire);
+    }
+    double Age () const
+    {
+      return age_.load(std::memory_order_relaxed);
+    }
+    double Jitter () const
+    {
+      return jitter_.load(std::memory_order_relaxed);
+    }
+
+    //! @brief Remember the relative speed the application commanded
+    //!
+    void SetCommanded (double percent)
+    {
+      commanded_.store(percent, std::memory_order_relaxed);
+    }
+    double Commanded () const
+    {
+      return commanded_.load(std::memory_order_relaxed);
+    }
+
+    //! @brief The relative speed to send to the robot for the commanded speed at the current
+    //!        level
+    //!
+    double Speed () const;
+
+    //! @brief Count an action taken on the robot
+    //!
+    //! @param level WATCHDOG_SLOW for a slow-down, WATCHDOG_STOP for a stop
+    //!
+    void CountAction (CrpiWatchdogLevel level);
+
+    //! @brief Seconds between checks
+    //!
+    double Period () const
+    {
+      return params_.period;
+    }
+
+  private:
+    CrpiWatchdogParams params_;
+
+    //! @brief When the watchdog started (the age of a robot that has never reported), and the
+    //!        sequence, timestamp, and interval of the last new state
+    //!
+    double start_;
+    unsigned long lastSeq_;
+    double lastStamp_;
+    double lastInterval_;
+    bool seen_;
+
+    std::atomic<int> level_;
+    std::atomic<double> age_;
+    std::atomic<double> jitter_;
+    std::atomic<double> commanded_;
+
+    CrpiGauge *ageMetric_;
+    CrpiGauge *jitterMetric_;
+    CrpiGauge *levelMetric_;
+    CrpiHistogram *intervalMetric_;
+    CrpiCounter *warnMetric_;
+    CrpiCounter *slowMetric_;
+    CrpiCounter *stopMetric_;
+    std::string labels_;
+  }; // CrpiWatchdog
+} // namespace crpi_robot
+
+#endif
@@ -0,0 +1,468 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_waypoints.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Waypoint table definitions.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_waypoints.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace crpi_robot
+{
+  //! @brief Header of a binary waypoint file, followed by count crpiWaypointRecords
+  //!
+  struct waypointFileHeader
+  {
+    unsigned int magic;
+    unsigned int version;
+    unsigned int count;
+    unsigned int recordSize;
+  };
+
+  static const unsigned int waypointMagic = 0x43525750;
+  static const unsigned int waypointVersion = 1;
+
+  //! @brief A waypoint as read from a file
+  //!
+  struct waypointEntry
+  {
+    string name;
+    string frame;
+    robotPose pose;
+  };
+
+  //! @brief Collects the Waypoint elements of an XML waypoint file
+  //!
+  class waypointXml : public CrpiSaxHandler
+  {
+  public:
+    waypointXml (vector<waypointEntry> &entries) :
+      entries_(entries)
+    {
+    }
+
+    bool startElement (const string &tagName, const xmlAttributes &attr)
+    {
+      if (tagName != "Waypoint")
+      {
+        return true;
+      }
+
+      waypointEntry entry;
+      entry.frame = "Robot";
+      for (size_t i = 0; i < attr.name.size() && i < attr.val.size(); ++i)
+      {
+        const string &n = attr.name[i];
+        double v = atof(attr.val[i].c_str());
+        if (n == "Name")
+        {
+          entry.name = attr.val[i];
+        }
+        else if (n == "Frame")
+        {
+          entry.frame = attr.val[i];
+        }
+        else if (n == "X")
+        {
+          entry.pose.x = v;
+        }
+        else if (n == "Y")
+        {
+          entry.pose.y = v;
+        }
+        else if (n == "Z")
+        {
+          entry.pose.z = v;
+        }
+        else if (n == "XR")
+        {
+          entry.pose.xrot = v;
+        }
+        else if (n == "YR")
+        {
+          entry.pose.yrot = v;
+        }
+        else if (n == "ZR")
+        {
+          entry.pose.zrot = v;
+        }
+      }
+      //! A waypoint must be named to be looked up
+      if (entry.name.empty())
+      {
+        return false;
+      }
+      entries_.push_back(entry);
+      return true;
+    }
+
+    bool interTagElement (const string &, const vector<string> &)
+    {
+      return true;
+    }
+
+    bool endElement (const string &)
+    {
+      return true;
+    }
+
+  private:
+    vector<waypointEntry> &entries_;
+  };
+
+
+  //! @brief Copy the records of a mapped binary waypoint file
+  //!
+  static bool readRecords (const unsigned char *data, size_t size, vector<waypointEntry> &entries)
+  {
+    waypointFileHeader header;
+
+    if (size < sizeof(header))
+    {
+      return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != waypointMagic || header.version != waypointVersion ||
+        header.recordSize != sizeof(crpiWaypointRecord) ||
+        (size - sizeof(header)) / sizeof(crpiWaypointRecord) < header.count)
+    {
+      return false;
+    }
+
+    const crpiWaypointRecord *records = (const crpiWaypointRecord *)(data + sizeof(header));
+    entries.resize(header.count);
+    for (unsigned int i = 0; i < header.count; ++i)
+    {
+      const crpiWaypointRecord &r = records[i];
+      entries[i].name.assign(r.name, strnlen(r.name, CRPI_WAYPOINT_NAME));
+      entries[i].frame.assign(r.frame, strnlen(r.frame, CRPI_WAYPOINT_NAME));
+      entries[i].pose.x = r.pose[0];
+      entries[i].pose.y = r.pose[1];
+      entries[i].pose.z = r.pose[2];
+      entries[i].pose.xrot = r.pose[3];
+      entries[i].pose.yrot = r.pose[4];
+      entries[i].pose.zrot = r.pose[5];
+      if (entries[i].name.empty())
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+
+  //! @brief Read a binary waypoint file through a read-only mapping
+  //!
+  //! @return True if the file is a binary waypoint file and was read; false with isBinary
+  //!         cleared if it is not one
+  //!
+  static bool loadBinary (const char *path, vector<waypointEntry> &entries, bool &isBinary)
+  {
+    unsigned int magic = 0;
+    bool ok;
+    FILE *probe = fopen(path, "rb");
+
+    isBinary = false;
+    if (probe == NULL)
+    {
+      return false;
+    }
+    isBinary = (fread(&magic, sizeof(magic), 1, probe) == 1 && magic == waypointMagic);
+    fclose(probe);
+    if (!isBinary)
+    {
+      return false;
+    }
+
+#ifdef WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+      return false;
+    }
+    LARGE_INTEGER size;
+    HANDLE mapping = GetFileSizeEx(file, &size) ?
+                     CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+    CloseHandle(file);
+    if (mapping == NULL)
+    {
+      return false;
+    }
+    const unsigned char *view = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    //! The view keeps the mapping alive
+    CloseHandle(mapping);
+    if (view == NULL)
+    {
+      return false;
+    }
+    ok = readRecords(view, (size_t)size.QuadPart, entries);
+    UnmapViewOfFile(view);
+#else
+    struct stat st;
+    int file = open(path, O_RDONLY);
+    if (file < 0)
+    {
+      return false;
+    }
+    if (fstat(file, &st) != 0 || st.st_size < (off_t)sizeof(waypointFileHeader))
+    {
+      close(file);
+      return false;
+    }
+    void *view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (view == MAP_FAILED)
+    {
+      return false;
+    }
+    ok = readRecords((const unsigned char*)view, (size_t)st.st_size, entries);
+    munmap(view, (size_t)st.st_size);
+#endif
+    return ok;
+  }
+
+
+  LIBRARY_API CrpiWaypoints::CrpiWaypoints ()
+  {
+  }
+
+
+  LIBRARY_API CrpiWaypoints::~CrpiWaypoints ()
+  {
+  }
+
+
+  LIBRARY_API bool CrpiWaypoints::Load (const char *path)
+  {
+    vector<waypointEntry> entries;
+    bool isBinary;
+
+    if (!loadBinary(path, entries, isBinary))
+    {
+      if (isBinary)
+      {
+        return false;
+      }
+
+      string text;
+      char block[4096];
+      size_t got;
+      FILE *in = fopen(path, "rb");
+      if (in == NULL)
+      {
+        return false;
+      }
+      while ((got = fread(block, 1, sizeof(block), in)) > 0)
+      {
+        text.append(block, got);
+      }
+      fclose(in);
+
+      CrpiSaxParser sax;
+      waypointXml handler(entries);
+      if (!sax.parse(text.c_str(), text.length(), handler))
+      {
+        return false;
+      }
+    }
+
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+      Add(entries[i].name.c_str(), entries[i].pose, entries[i].frame.c_str());
+    }
+    return true;
+  }
+
+
+  LIBRARY_API bool CrpiWaypoints::Save (const char *path, bool binary) const
+  {
+    FILE *out = fopen(path, binary ? "wb" : "w");
+    bool ok = true;
+    size_t i;
+
+    if (out == NULL)
+    {
+      return false;
+    }
+
+    if (binary)
+    {
+      waypointFileHeader header;
+      header.magic = waypointMagic;
+      header.version = waypointVersion;
+      header.count = (unsigned int)names_.size();
+      header.recordSize = sizeof(crpiWaypointRecord);
+      ok = (fwrite(&header, sizeof(header), 1, out) == 1);
+      for (i = 0; ok && i < names_.size(); ++i)
+      {
+        crpiWaypointRecord r;
+        memset(&r, 0, sizeof(r));
+        if (names_[i].length() >= CRPI_WAYPOINT_NAME || frameNames_[i].length() >= CRPI_WAYPOINT_NAME)
+        {
+          ok = false;
+          break;
+        }
+        strcpy(r.name, names_[i].c_str());
+        strcpy(r.frame, frameNames_[i].c_str());
+        r.pose[0] = poses_[i].x;
+        r.pose[1] = poses_[i].y;
+        r.pose[2] = poses_[i].z;
+        r.pose[3] = poses_[i].xrot;
+        r.pose[4] = poses_[i].yrot;
+        r.pose[5] = poses_[i].zrot;
+        ok = (fwrite(&r, sizeof(r), 1, out) == 1);
+      }
+    }
+    else
+    {
+      fprintf(out, "<Waypoints>\n");
+      for (i = 0; i < names_.size(); ++i)
+      {
+        fprintf(out, "  <Waypoint Name=\"%s\" Frame=\"%s\" X=\"%.17g\" Y=\"%.17g\" Z=\"%.17g\" "
+                "XR=\"%.17g\" YR=\"%.17g\" ZR=\"%.17g\"/>\n", names_[i].c_str(), frameNames_[i].c_str(),
+                poses_[i].x, poses_[i].y, poses_[i].z, poses_[i].xrot, poses_[i].yrot, poses_[i].zrot);
+      }
+      fprintf(out, "</Waypoints>\n");
+    }
+
+    ok = (fclose(out) == 0) && ok;
+    return ok;
+  }
+
+
+  LIBRARY_API WaypointHandle CrpiWaypoints::Add (const char *name, const robotPose &pose, const char *frame)
+  {
+    FrameHandle handle = CRPI_NO_HANDLE;
+    int wp;
+
+    if (frame == NULL || *frame == '\0' || strcmp(frame, "Robot") == 0)
+    {
+      frame = "Robot";
+      handle = CRPI_FRAME_ROBOT;
+    }
+    else if (strcmp(frame, "World") == 0)
+    {
+      handle = CRPI_FRAME_WORLD;
+    }
+
+    unordered_map<string, int>::const_iterator itr = index_.find(name);
+    if (itr == index_.end())
+    {
+      wp = (int)names_.size();
+      names_.push_back(name);
+      poses_.push_back(pose);
+      frameNames_.push_back(frame);
+      frames_.push_back(handle);
+      index_.insert(make_pair(names_.back(), wp));
+      for (size_t c = 0; c < columns_.size(); ++c)
+      {
+        columns_[c].resize(names_.size());
+      }
+    }
+    else
+    {
+      wp = itr->second;
+      poses_[wp] = pose;
+      frameNames_[wp] = frame;
+      frames_[wp] = handle;
+    }
+
+    //! The new pose is converted with the rest of its column
+    columnValid_.assign(columnValid_.size(), 0);
+    return wp;
+  }
+
+
+  LIBRARY_API WaypointHandle CrpiWaypoints::Find (const char *name) const
+  {
+    unordered_map<string, int>::const_iterator itr = index_.find(name);
+    return (itr == index_.end()) ? CRPI_NO_HANDLE : itr->second;
+  }
+
+
+  LIBRARY_API void CrpiWaypoints::Clear ()
+  {
+    names_.clear();
+    index_.clear();
+    poses_.clear();
+    frameNames_.clear();
+    frames_.clear();
+    columns_.clear();
+    columnValid_.clear();
+  }
+
+
+  LIBRARY_API void CrpiWaypoints::Invalidate (FrameHandle frame)
+  {
+    if (frame == CRPI_NO_HANDLE)
+    {
+      columnValid_.assign(columnValid_.size(), 0);
+      for (size_t i = 0; i < frames_.size(); ++i)
+      {
+        if (frames_[i] >= 0)
+        {
+          frames_[i] = CRPI_NO_HANDLE;
+        }
+      }
+      return;
+    }
+
+    size_t column = (frame == CRPI_FRAME_WORLD) ? 0 : (size_t)(frame + 1);
+    if ((frame == CRPI_FRAME_WORLD || frame >= 0) && column < columnValid_.size())
+    {
+      columnValid_[column] = 0;
+    }
+  }
+
+
+  LIBRARY_API robotPose *CrpiWaypoints::cache (FrameHandle frame, bool &valid)
+  {
+    size_t column = (frame == CRPI_FRAME_WORLD) ? 0 : (size_t)(frame + 1);
+
+    if (column >= columns_.size())
+    {
+      columns_.resize(column + 1);
+      columnValid_.resize(column + 1, 0);
+    }
+    if (columns_[column].size() != names_.size())
+    {
+      columns_[column].resize(names_.size());
+      columnValid_[column] = 0;
+    }
+    valid = (columnValid_[column] != 0);
+    return columns_[column].empty() ? NULL : &columns_[column][0];
+  }
+
+
+  LIBRARY_API void CrpiWaypoints::validate (FrameHandle frame)
+  {
+    size_t column = (frame == CRPI_FRAME_WORLD) ? 0 : (size_t)(frame + 1);
+
+    if (column < columnValid_.size())
+    {
+      columnValid_[column] = 1;
+    }
+  }
+} // namespace crpi_robot
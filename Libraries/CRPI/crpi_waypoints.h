@@ -0,0 +1,206 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_waypoints.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Named waypoints of a robot, with their poses in the robot's base frame
+//  cached for each coordinate system.
+//
+//  Waypoints are read from an XML file,
+//
+//    <Waypoints>
+//      <Waypoint Name="bin_approach" Frame="Table1" X="120.0" Y="45.0" Z="80.0" XR="180.0" YR="0.0" ZR="90.0"/>
+//      <Waypoint Name="home" X="400.0" Y="0.0" Z="500.0" XR="180.0" YR="0.0" ZR="0.0"/>
+//    </Waypoints>
+//
+//  where Frame is "Robot" (the default), "World", or the name of one of the
+//  robot's coordinate systems, or from a binary waypoint file written by
+//  Save, which is memory-mapped rather than parsed.  CrpiRobot::GetWaypoint
+//  returns a waypoint in the robot's base frame, converting the whole table
+//  for a frame with one batch transform the first time it is asked for and
+//  again only after UpdateWorldTransform or UpdateSystemTransform changes
+//  that frame.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_waypoints_H
+#define crpi_waypoints_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "crpi.h"
+
+//! @brief Interned handle of a waypoint:  its index in CrpiWaypoints, or CRPI_NO_HANDLE
+//!
+typedef int WaypointHandle;
+
+//! @brief Frames other than the coordinate systems in which a waypoint may be given
+//!
+#define CRPI_FRAME_ROBOT -2
+#define CRPI_FRAME_WORLD -3
+
+//! @brief Longest waypoint or frame name (including the terminating null) in a binary waypoint
+//!        file
+//!
+#define CRPI_WAYPOINT_NAME 64
+
+namespace crpi_robot
+{
+  //! @brief One waypoint of a binary waypoint file
+  //!
+  struct crpiWaypointRecord
+  {
+    char name[CRPI_WAYPOINT_NAME];
+    char frame[CRPI_WAYPOINT_NAME];
+    double pose[6];
+  };
+
+  //! @ingroup Robot
+  //!
+  //! @brief Waypoint table of a robot, owned by CrpiRobot.  Like the robot's cached transforms,
+  //!        it is used from the thread that commands the robot.
+  //!
+  class LIBRARY_API CrpiWaypoints
+  {
+  public:
+    //! @brief Constructor
+    //!
+    CrpiWaypoints ();
+
+    //! @brief Destructor
+    //!
+    ~CrpiWaypoints ();
+
+    //! @brief Add the waypoints of an XML or binary waypoint file.  A waypoint with the name of
+    //!        one already in the table replaces it and keeps its handle.
+    //!
+    //! @param path The file
+    //!
+    //! @return True if the file was read, false if it could not be opened or is malformed (the
+    //!         table is left as it was)
+    //!
+    bool Load (const char *path);
+
+    //! @brief Write the table to a file
+    //!
+    //! @param path   The file
+    //! @param binary Whether to write a binary waypoint file (memory-mapped when loaded) rather
+    //!               than XML
+    //!
+    //! @return True if the file was written
+    //!
+    bool Save (const char *path, bool binary = true) const;
+
+    //! @brief Add a waypoint, or replace the one of the same name
+    //!
+    //! @param name  The waypoint's name
+    //! @param pose  The waypoint, in the robot's length and angle units
+    //! @param frame "Robot", "World", or the name of a coordinate system of the robot
+    //!
+    //! @return The waypoint's handle
+    //!
+    WaypointHandle Add (const char *name, const robotPose &pose, const char *frame = "Robot");
+
+    //! @brief Look up a waypoint by name
+    //!
+    //! @return The waypoint's handle, or CRPI_NO_HANDLE if there is no such waypoint
+    //!
+    WaypointHandle Find (const char *name) const;
+
+    //! @brief Remove every waypoint.  Existing handles become invalid.
+    //!
+    void Clear ();
+
+    //! @brief Number of waypoints
+    //!
+    size_t Size () const
+    {
+      return names_.size();
+    }
+
+    //! @brief Whether a handle refers to a waypoint
+    //!
+    bool Valid (WaypointHandle wp) const
+    {
+      return wp >= 0 && (size_t)wp < names_.size();
+    }
+
+    //! @brief The name, pose as given, and frame name of a waypoint
+    //!
+    const char *Name (WaypointHandle wp) const
+    {
+      return names_[wp].c_str();
+    }
+    const robotPose &Pose (WaypointHandle wp) const
+    {
+      return poses_[wp];
+    }
+    const char *Frame (WaypointHandle wp) const
+    {
+      return frameNames_[wp].c_str();
+    }
+
+    //! @brief Mark the cached poses of a frame stale
+    //!
+    //! @param frame CRPI_FRAME_WORLD, a coordinate system's handle, or CRPI_NO_HANDLE for every
+    //!              frame (the systems may have been renumbered, so their names are looked up
+    //!              again as well)
+    //!
+    void Invalidate (FrameHandle frame);
+
+    //! @brief The frame in which a waypoint is given:  CRPI_FRAME_ROBOT, CRPI_FRAME_WORLD, or
+    //!        the handle of its coordinate system (CRPI_NO_HANDLE until CrpiRobot looks it up)
+    //!
+    FrameHandle &frame (WaypointHandle wp)
+    {
+      return frames_[wp];
+    }
+
+    //! @brief The poses as given, in handle order
+    //!
+    const robotPose *poses () const
+    {
+      return poses_.empty() ? NULL : &poses_[0];
+    }
+
+    //! @brief Cached base-frame poses of every waypoint taken as given in a frame, in handle
+    //!        order
+    //!
+    //! @param frame CRPI_FRAME_WORLD or a coordinate system's handle
+    //! @param valid Set to whether the poses are current; CrpiRobot recomputes them if not,
+    //!              then calls validate
+    //!
+    robotPose *cache (FrameHandle frame, bool &valid);
+    void validate (FrameHandle frame);
+
+  private:
+    //! @brief Waypoint names and their handles
+    //!
+    std::vector<std::string> names_;
+    std::unordered_map<std::string, int> index_;
+
+    //! @brief Poses as given, their frames' names, and the frames' handles
+    //!
+    std::vector<robotPose> poses_;
+    std::vector<std::string> frameNames_;
+    std::vector<FrameHandle> frames_;
+
+    //! @brief Cached base-frame poses:  column 0 for the world, column s + 1 for coordinate
+    //!        system s
+    //!
+    std::vector<std::vector<robotPose> > columns_;
+    std::vector<char> columnValid_;
+
+    CrpiWaypoints (const CrpiWaypoints &) = delete;
+    CrpiWaypoints &operator= (const CrpiWaypoints &) = delete;
+  }; // CrpiWaypoints
+} // namespace crpi_robot
+
+#endif
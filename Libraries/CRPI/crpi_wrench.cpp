@@ -0,0 +1,285 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_wrench.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Force/torque feedback processing for the robot drivers.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "crpi_wrench.h"
+#include <math.h>
+#include <string.h>
+
+using namespace std;
+
+namespace crpi_robot
+{
+  //! @brief Rotate a vector by a rotation vector (Rodrigues' formula)
+  //!
+  static void rotateVector (const double *rv, const double *in, double *out)
+  {
+    double angle = sqrt((rv[0] * rv[0]) + (rv[1] * rv[1]) + (rv[2] * rv[2]));
+    double k[3], kxv[3], kdv, c, s;
+
+    if (angle < 1.0e-12)
+    {
+      out[0] = in[0];
+      out[1] = in[1];
+      out[2] = in[2];
+      return;
+    }
+
+    k[0] = rv[0] / angle;
+    k[1] = rv[1] / angle;
+    k[2] = rv[2] / angle;
+    c = cos(angle);
+    s = sin(angle);
+    kxv[0] = (k[1] * in[2]) - (k[2] * in[1]);
+    kxv[1] = (k[2] * in[0]) - (k[0] * in[2]);
+    kxv[2] = (k[0] * in[1]) - (k[1] * in[0]);
+    kdv = (k[0] * in[0]) + (k[1] * in[1]) + (k[2] * in[2]);
+
+    for (int i = 0; i < 3; ++i)
+    {
+      out[i] = (in[i] * c) + (kxv[i] * s) + (k[i] * kdv * (1.0 - c));
+    }
+  }
+
+
+  LIBRARY_API CrpiWrenchFilter::CrpiWrenchFilter () :
+    kalman_(6)
+  {
+    memset(&settings_, 0, sizeof(settings_));
+    settings_.gravity[2] = -9.81;
+    writeLock_ = ulapi_fastlock_new();
+    published_.write(settings_);
+    restart(settings_);
+  }
+
+
+  LIBRARY_API CrpiWrenchFilter::~CrpiWrenchFilter ()
+  {
+    ulapi_fastlock_delete(writeLock_);
+  }
+
+
+  LIBRARY_API void CrpiWrenchFilter::SetTool (double mass, const double *com, const double *tcp)
+  {
+    double offset[3], inverse[3];
+    int i;
+
+    for (i = 0; i < 3; ++i)
+    {
+      offset[i] = com[i] - ((tcp != NULL) ? tcp[i] : 0.0);
+    }
+
+    ulapi_fastlock_take(writeLock_);
+    settings_.mass = mass;
+    if (tcp != NULL)
+    {
+      //! Express the offset in the TCP frame
+      for (i = 0; i < 3; ++i)
+      {
+        inverse[i] = -tcp[i + 3];
+      }
+      rotateVector(inverse, offset, settings_.com);
+    }
+    else
+    {
+      for (i = 0; i < 3; ++i)
+      {
+        settings_.com[i] = offset[i];
+      }
+    }
+    publish();
+    ulapi_fastlock_give(writeLock_);
+  }
+
+
+  LIBRARY_API void CrpiWrenchFilter::SetGravity (const double *gravity)
+  {
+    ulapi_fastlock_take(writeLock_);
+    for (int i = 0; i < 3; ++i)
+    {
+      settings_.gravity[i] = gravity[i];
+    }
+    publish();
+    ulapi_fastlock_give(writeLock_);
+  }
+
+
+  LIBRARY_API void CrpiWrenchFilter::SetCompensation (bool gravity, bool inertia)
+  {
+    ulapi_fastlock_take(writeLock_);
+    settings_.gravityComp = gravity;
+    settings_.inertiaComp = inertia;
+    publish();
+    ulapi_fastlock_give(writeLock_);
+  }
+
+
+  LIBRARY_API void CrpiWrenchFilter::SetLowPass (double cutoff)
+  {
+    ulapi_fastlock_take(writeLock_);
+    settings_.cutoff = (cutoff > 0.0) ? cutoff : 0.0;
+    publish();
+    ulapi_fastlock_give(writeLock_);
+  }
+
+
+  LIBRARY_API void CrpiWrenchFilter::SetKalman (double noise, double process)
+  {
+    ulapi_fastlock_take(writeLock_);
+    settings_.kalmanNoise = (noise > 0.0) ? noise : 0.0;
+    settings_.kalmanProcess = (process > 0.0) ? process : 0.0;
+    publish();
+    ulapi_fastlock_give(writeLock_);
+  }
+
+
+  LIBRARY_API void CrpiWrenchFilter::Tare (int samples)
+  {
+    ulapi_fastlock_take(writeLock_);
+    //! A negative count clears the bias without starting a new average
+    settings_.tare = (samples > 0) ? samples : -1;
+    publish();
+    settings_.tare = 0;
+    ulapi_fastlock_give(writeLock_);
+  }
+
+
+  LIBRARY_API void CrpiWrenchFilter::Settings (CrpiWrenchSettings &settings) const
+  {
+    published_.read(settings);
+  }
+
+
+  LIBRARY_API void CrpiWrenchFilter::Process (const double *pose, const double *speeds, double stamp, double *wrench)
+  {
+    CrpiWrenchSettings latest;
+    double load[3], arm[3], moment[3], dt;
+    int i;
+
+    //! Pick up changed settings; the copy is a few cache lines and never waits
+    published_.read(latest);
+    if (latest.version != active_.version)
+    {
+      restart(latest);
+    }
+
+    dt = (lastStamp_ > 0.0) ? (stamp - lastStamp_) : 0.0;
+
+    if (active_.gravityComp && active_.mass > 0.0)
+    {
+      //! The sensor carries the tool's load, m (g - a), at its center of mass
+      for (i = 0; i < 3; ++i)
+      {
+        load[i] = active_.gravity[i];
+        if (active_.inertiaComp && dt > 0.0)
+        {
+          load[i] -= (speeds[i] - lastSpeed_[i]) / dt;
+        }
+        load[i] *= active_.mass;
+      }
+      rotateVector(pose + 3, active_.com, arm);
+      moment[0] = (arm[1] * load[2]) - (arm[2] * load[1]);
+      moment[1] = (arm[2] * load[0]) - (arm[0] * load[2]);
+      moment[2] = (arm[0] * load[1]) - (arm[1] * load[0]);
+      for (i = 0; i < 3; ++i)
+      {
+        wrench[i] -= load[i];
+        wrench[i + 3] -= moment[i];
+      }
+    }
+
+    for (i = 0; i < 3; ++i)
+    {
+      lastSpeed_[i] = speeds[i];
+    }
+
+    if (tareCount_ < active_.tare)
+    {
+      for (i = 0; i < 6; ++i)
+      {
+        tareSum_[i] += wrench[i];
+      }
+      if (++tareCount_ == active_.tare)
+      {
+        for (i = 0; i < 6; ++i)
+        {
+          bias_[i] = tareSum_[i] / tareCount_;
+        }
+      }
+    }
+
+    for (i = 0; i < 6; ++i)
+    {
+      wrench[i] -= bias_[i];
+    }
+
+    if (active_.kalmanNoise > 0.0)
+    {
+      kalman_.updateEstimate(wrench, wrench);
+    }
+    else if (active_.cutoff > 0.0)
+    {
+      if (!primed_)
+      {
+        //! Start from the first sample rather than from zero
+        memcpy(filtered_, wrench, sizeof(filtered_));
+        primed_ = true;
+      }
+      else if (dt > 0.0)
+      {
+        double alpha = dt / (dt + (1.0 / (2.0 * 3.141592654 * active_.cutoff)));
+        for (i = 0; i < 6; ++i)
+        {
+          filtered_[i] += alpha * (wrench[i] - filtered_[i]);
+        }
+      }
+      memcpy(wrench, filtered_, sizeof(filtered_));
+    }
+
+    lastStamp_ = stamp;
+  }
+
+
+  void CrpiWrenchFilter::publish ()
+  {
+    ++settings_.version;
+    published_.write(settings_);
+  }
+
+
+  void CrpiWrenchFilter::restart (const CrpiWrenchSettings &settings)
+  {
+    if (settings.tare != 0 || settings.version == 0)
+    {
+      memset(bias_, 0, sizeof(bias_));
+    }
+    memset(tareSum_, 0, sizeof(tareSum_));
+    tareCount_ = 0;
+    memset(filtered_, 0, sizeof(filtered_));
+    memset(lastSpeed_, 0, sizeof(lastSpeed_));
+    lastStamp_ = 0.0;
+    primed_ = false;
+
+    active_ = settings;
+    if (active_.tare < 0)
+    {
+      active_.tare = 0;
+    }
+    if (active_.kalmanNoise > 0.0)
+    {
+      kalman_.setNoise(active_.kalmanNoise);
+      kalman_.setProcessNoise(active_.kalmanProcess);
+    }
+    kalman_.reset();
+  }
+} // crpi_robot
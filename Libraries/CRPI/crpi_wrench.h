@@ -0,0 +1,181 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Robot Interface
+//  Workfile:        crpi_wrench.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Force/torque feedback processing for the robot drivers.
+//
+//  A driver's feedback thread hands each raw wrench to
+//  CrpiWrenchFilter::Process before publishing it, so that GetRobotForces
+//  and GetRobotState return the processed wrench without any work on the
+//  caller's side.  Each sample passes through, in order:
+//
+//    compensation   removes the load of the coupled tool, m (g - a), and
+//                   its moment about the TCP, where a is the TCP
+//                   acceleration taken from successive speed samples
+//    bias           subtracts the average of the samples taken by Tare
+//    filter         a first-order low-pass or a per-axis Kalman filter
+//
+//  Settings are changed from any thread and reach the feedback thread
+//  through a crpi_seqlock, so Process never waits on a lock.  Changing a
+//  setting restarts the filter; the bias is kept until the next Tare.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef crpi_wrench_H
+#define crpi_wrench_H
+
+#ifdef WIN32
+#include "..\Math\Filters.h"
+#else
+#include "../Math/Filters.h"
+#endif
+
+#include "crpi.h"
+
+namespace crpi_robot
+{
+  //! @brief Wrench processing settings, as published to the feedback thread
+  //!
+  struct CrpiWrenchSettings
+  {
+    //! @brief Incremented by every change
+    //!
+    unsigned long version;
+
+    //! @brief Tool mass (kg) and the offset of its center of mass from the TCP, in the TCP frame
+    //!        (m)
+    //!
+    double mass;
+    double com[3];
+
+    //! @brief Gravity in the frame of the wrench (m/s^2)
+    //!
+    double gravity[3];
+
+    //! @brief Whether to remove the tool's static load, and its inertial load
+    //!
+    bool gravityComp;
+    bool inertiaComp;
+
+    //! @brief Low-pass cutoff frequency (Hz), or 0 for none
+    //!
+    double cutoff;
+
+    //! @brief Kalman measurement and process noise variances (N^2), or a measurement noise of 0
+    //!        for none.  Takes the place of the low-pass filter when set.
+    //!
+    double kalmanNoise;
+    double kalmanProcess;
+
+    //! @brief Samples to average into the bias, counted from this version (0 keeps the bias)
+    //!
+    int tare;
+  };
+
+
+  //! @brief Force/torque feedback processing:  tool compensation, bias removal, and filtering
+  //!
+  class LIBRARY_API CrpiWrenchFilter
+  {
+  public:
+    //! @brief Default constructor.  Everything is off, and gravity is (0, 0, -9.81).
+    //!
+    CrpiWrenchFilter ();
+
+    //! @brief Default destructor
+    //!
+    ~CrpiWrenchFilter ();
+
+    //! @brief Set the tool whose load is compensated
+    //!
+    //! @param mass Tool mass (kg), or 0 for no tool
+    //! @param com  The tool's center of mass in the flange frame (m)
+    //! @param tcp  The TCP relative to the flange:  position (m) and rotation vector (rad), or
+    //!             NULL if the TCP is the flange
+    //!
+    void SetTool (double mass, const double *com, const double *tcp = NULL);
+
+    //! @brief Set gravity in the frame of the wrench (defaults to (0, 0, -9.81) m/s^2)
+    //!
+    void SetGravity (const double *gravity);
+
+    //! @brief Select which tool loads are removed
+    //!
+    //! @param gravity Remove the tool's weight and its moment about the TCP
+    //! @param inertia Also remove the force needed to accelerate the tool
+    //!
+    void SetCompensation (bool gravity, bool inertia);
+
+    //! @brief Use a first-order low-pass filter
+    //!
+    //! @param cutoff Cutoff frequency (Hz), or 0 to turn the filter off
+    //!
+    void SetLowPass (double cutoff);
+
+    //! @brief Use a Kalman filter per axis in place of the low-pass filter
+    //!
+    //! @param noise   Measurement noise variance (N^2), or 0 to turn the filter off
+    //! @param process Process noise variance (N^2) added each sample, which sets how quickly the
+    //!                estimate follows changes
+    //!
+    void SetKalman (double noise, double process);
+
+    //! @brief Average the next samples (after compensation) and subtract the average from every
+    //!        later sample.  The robot should be still and free of contact meanwhile.
+    //!
+    //! @param samples The number of samples to average, or 0 to clear the bias
+    //!
+    void Tare (int samples);
+
+    //! @brief Get the current settings
+    //!
+    void Settings (CrpiWrenchSettings &settings) const;
+
+    //! @brief Process one feedback sample.  Called only by the driver's feedback thread.
+    //!
+    //! @param pose   TCP pose:  position (m) and rotation vector (rad)
+    //! @param speeds TCP speed:  linear (m/s) and angular (rad/s)
+    //! @param stamp  Time the sample was received (s, ulapi_time)
+    //! @param wrench The raw wrench (N, N m), replaced with the processed wrench
+    //!
+    void Process (const double *pose, const double *speeds, double stamp, double *wrench);
+
+  private:
+    //! @brief Publish settings_ (with writeLock_ held)
+    //!
+    void publish ();
+
+    //! @brief Start from a new version of the settings on the feedback thread
+    //!
+    void restart (const CrpiWrenchSettings &settings);
+
+    //! @brief Lock serializing changes to settings_, the copy the setters change
+    //!
+    void *writeLock_;
+    CrpiWrenchSettings settings_;
+
+    //! @brief Settings as seen by the feedback thread
+    //!
+    crpi_seqlock<CrpiWrenchSettings> published_;
+
+    //! @brief The feedback thread's copy of the settings and its filter state
+    //!
+    CrpiWrenchSettings active_;
+    double bias_[6];
+    double tareSum_[6];
+    int tareCount_;
+    double filtered_[6];
+    double lastSpeed_[3];
+    double lastStamp_;
+    bool primed_;
+    Math::BatchKalman kalman_;
+  }; // CrpiWrenchFilter
+} // crpi_robot
+
+#endif
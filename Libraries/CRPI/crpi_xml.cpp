@@ -20,350 +20,316 @@ using namespace std;
 
 namespace Xml
 {
-  LIBRARY_API CrpiXml::CrpiXml (CrpiXmlParams *params) :
-    params_(params)
+  LIBRARY_API CrpiXmlWriter::CrpiXmlWriter (size_t capacity) :
+    cap_(capacity),
+    len_(0),
+    overflow_(false)
   {
-    //xaxisactive = zaxisactive = false;
+    buf_ = new char[cap_ > 0 ? cap_ : 1];
   }
 
 
-  LIBRARY_API CrpiXml::~CrpiXml ()
+  LIBRARY_API CrpiXmlWriter::~CrpiXmlWriter ()
   {
-    params_ = NULL;
+    delete [] buf_;
+    buf_ = NULL;
   }
 
 
-  LIBRARY_API bool CrpiXml::characters(const vector<string>& ch)
+  LIBRARY_API void CrpiXmlWriter::clear ()
   {
-    vector<string>::const_iterator chIter = ch.begin();
+    len_ = 0;
+    overflow_ = false;
+  }
 
-    for (; chIter != ch.end(); ++chIter)
+
+  LIBRARY_API bool CrpiXmlWriter::append (const char *text, size_t len)
+  {
+    //! Once an append is refused all later ones are too, so a response is never missing
+    //! pieces from its middle
+    if (overflow_ || len > (cap_ - len_))
     {
+      overflow_ = true;
+      return false;
     }
+    memcpy (buf_ + len_, text, len);
+    len_ += len;
+    return true;
+  }
+
+
+  LIBRARY_API bool CrpiXmlWriter::append (const string &text)
+  {
+    return append (text.data(), text.length());
+  }
+
 
+  LIBRARY_API bool CrpiXmlWriter::appendUnsigned (unsigned long val)
+  {
+    char digits[24];
+    size_t i = sizeof(digits);
+
+    do
+    {
+      digits[--i] = (char)('0' + (val % 10));
+      val /= 10;
+    } while (val > 0);
+
+    return append (digits + i, sizeof(digits) - i);
+  }
+
+
+  LIBRARY_API bool CrpiXmlWriter::appendInt (long val)
+  {
+    if (val < 0)
+    {
+      //! Negate as unsigned so the most negative value does not overflow
+      return append ("-") && appendUnsigned (0UL - (unsigned long)val);
+    }
+    return appendUnsigned ((unsigned long)val);
+  }
+
+
+  LIBRARY_API bool CrpiXmlWriter::appendReal (double val, bool fixed)
+  {
+    size_t avail = cap_ - len_;
+    int num;
+
+    if (overflow_)
+    {
+      return false;
+    }
+
+    //! Formatted in place; neither call writes more than avail bytes
+#ifdef WIN32
+    num = _snprintf (buf_ + len_, avail, fixed ? "%f" : "%g", val);
+#else
+    num = snprintf (buf_ + len_, avail, fixed ? "%f" : "%g", val);
+#endif
+
+    if (num < 0 || (size_t)num >= avail)
+    {
+      overflow_ = true;
+      return false;
+    }
+    len_ += num;
     return true;
   }
 
 
-  LIBRARY_API bool CrpiXml::parse (const string &line)
+  LIBRARY_API CrpiXmlFramer::CrpiXmlFramer (size_t capacity) :
+    cap_(capacity > 0 ? capacity : 1),
+    start_(0),
+    end_(0)
   {
-    static char buff[1024];
-    bool readTags = false;
-    bool state = true;
-    bool error = false;
-
-    xmlAttributes attr;
-    vector<string> chars;
-
-    int marker = 0;
-    int openTags = 0;
-    bool tagActive = false;
-    bool start = false;
-    bool single = false;
-    bool validXML = false;
-
-    int strLength = line.length();
-    int count;
-    string temp;
-    string name;
-    string attrname;
-    string attrval;
-    try
+    buf_ = new char[cap_];
+    rescan ();
+  }
+
+
+  LIBRARY_API CrpiXmlFramer::~CrpiXmlFramer ()
+  {
+    delete [] buf_;
+    buf_ = NULL;
+  }
+
+
+  LIBRARY_API char *CrpiXmlFramer::space (size_t &room)
+  {
+    if (start_ > 0)
+    {
+      //! Only the unfinished tail is moved, once per read
+      memmove (buf_, buf_ + start_, end_ - start_);
+      scan_ -= start_;
+      end_ -= start_;
+      start_ = 0;
+    }
+    room = cap_ - end_;
+    return buf_ + end_;
+  }
+
+
+  LIBRARY_API void CrpiXmlFramer::commit (size_t count)
+  {
+    end_ += (count > cap_ - end_) ? (cap_ - end_) : count;
+  }
+
+
+  LIBRARY_API int CrpiXmlFramer::next (const char *&doc, size_t &len)
+  {
+    char ch;
+
+    for (; scan_ < end_; ++scan_)
     {
-      //! JAM:  TODO, STRIP OFF WHITE SPACE:  Carriage returns, tabs, etc.
+      ch = buf_[scan_];
 
-      while (marker < strLength && !error && line[marker] != '\0')
+      if (!inTag_)
       {
-        if (line[marker] == '<')
+        if (ch == '<')
+        {
+          inTag_ = true;
+          kind_ = 0;
+          quote_ = 0;
+          last_ = 0;
+        }
+        else if (!root_)
         {
-          //! ***** Handle tags *****
-          tagActive = true;
-          for (int i = 0; i < 20; i++)
+          //! Separators between documents
+          if (!isspace ((unsigned char)ch) && ch != '\0')
           {
-            buff[i] = ' ';
+            return -1;
           }
+          start_ = scan_ + 1;
+        }
+        continue;
+      }
 
-          name = "";
-          ++marker;
+      if (kind_ == 0)
+      {
+        //! First character of the tag:  closing, declaration or comment, or opening
+        kind_ = (ch == '/' || ch == '?' || ch == '!') ? ch : '<';
+        last_ = ch;
+        continue;
+      }
+      if (quote_ != 0)
+      {
+        quote_ = (ch == quote_) ? 0 : quote_;
+        continue;
+      }
+      if (ch == '"' || ch == '\'')
+      {
+        quote_ = ch;
+        continue;
+      }
+      if (ch != '>')
+      {
+        last_ = isspace ((unsigned char)ch) ? last_ : ch;
+        continue;
+      }
 
-          //! Skip white space
-          while (line[marker] == ' ' || line[marker] == '\t' || line[marker] == '?')
-          {
-            ++marker;
-            if (marker >= (strLength - 1))
-            {
-              break;
-            }
-          }
+      //! End of a tag
+      inTag_ = false;
+      if (kind_ == '/')
+      {
+        --depth_;
+      }
+      else if (kind_ == '<')
+      {
+        root_ = true;
+        depth_ += (last_ == '/') ? 0 : 1;
+      }
+      if (root_ && depth_ <= 0)
+      {
+        doc = buf_ + start_;
+        len = scan_ + 1 - start_;
+        start_ = scan_ + 1;
+        rescan ();
+        return 1;
+      }
+    }
 
-          if (marker >= (strLength - 1))
-          {
-            //! Ill-formed XML string (end encountered before closing tags
-            error = true;
-            break;
-          }
+    if (end_ - start_ >= cap_)
+    {
+      //! The document cannot be completed in the space available
+      return -1;
+    }
+    return 0;
+  }
 
-          if (line[marker] == '/')
-          {
-            start = false;
-            marker++;
-          }
-          else
-          {
-            start = true;
-          }
 
-          int count = 0;
-          while (line[marker] != ' ' && line[marker] != '\t' &&
-                 line[marker] != '/' && line[marker] != '>' &&
-                 line[marker] != '?' && marker <= (strLength - 1))
-          {
-            buff[count] = line[marker];
-            count++;
-            marker++;
-            if (marker >= (strLength - 1))
-            {
-              break;
-            }
-          }
-          if (marker > (strLength - 1))
-          {
-            //! Ill-formed XML string (end encountered before closing tags
-            error = true;
-            break;
-          }
+  LIBRARY_API void CrpiXmlFramer::consume (size_t count)
+  {
+    start_ += (count > end_ - start_) ? (end_ - start_) : count;
+    rescan ();
+  }
 
-          buff[count] = '\0';
-          name = buff;
-          name = name.substr(0, count);
 
-          if (start)
-          {
-            //! Look for attributes of opening tags
-            while (line[marker] != '/' && line[marker] != '>' &&
-                   line[marker] != '?' && marker <= (strLength -1))
-            {
-              if (line[marker] != ' ' && line[marker] != '\t' &&
-                  line[marker] != '?' && line[marker] != '\n')
-              {
-                //! Non-white-space character & non-terminating element
-                //! Ergo, an attribute
-                count = 0;
-
-                //! grab the attribute name
-                while (line[marker] != '=' && line[marker] != ' ' && line[marker] != '?')
-                {
-                  buff[count++] = line[marker++];
-                  if (marker >= strLength - 1)
-                  {
-                    break;
-                  }
-                }
-                if (marker >= strLength - 1)
-                {
-                  break;
-                }
-                buff[count] = '\0';
-                attrname = buff;
-                attrname = attrname.substr(0, count);
-                attr.name.push_back(attrname);
-
-                //! grab the attribute value
-                while (line[marker] != '\"')
-                {
-                  marker++;
-                  if (marker >= strLength - 1)
-                  {
-                    break;
-                  }
-                }
-                marker++;
-                if (marker >= strLength - 1)
-                {
-                  break;
-                }
-
-                count = 0;
-                while (line[marker] != '\"')
-                {
-                  buff[count++] = line[marker++];
-                  if (marker >= strLength - 1)
-                  {
-                    break;
-                  }
-                }
-                buff[count] = '\0';
-                attrval = buff;
-                attrval = attrval.substr(0, count);
-                attr.val.push_back(attrval);
-              } // if (line[marker] != ' ' && line[marker] != '\t' && line[marker] != '\n' && line[marker] != '?')
-              marker++;
-              if (marker > strLength - 1)
-              {
-                break;
-              }
-            } // while (line[marker] != '/' && line[marker] != '>' && line[marker] != '?')
-
-            if (marker > (strLength - 1))
-            {
-              //! Ill-formed XML string (end encountered before closing tags
-              error = true;
-              break;
-            } // if (marker > (strLength - 1))
+  LIBRARY_API void CrpiXmlFramer::clear ()
+  {
+    start_ = end_ = 0;
+    rescan ();
+  }
 
-            //! Test for single-tag XML lines (ex. <tag/>
-            if (line[marker] == '/')
-            {
-              single = true;
-            }
-            while (line[marker] != '>')
-            {
-              marker++;
-              if (marker >= strLength - 1)
-              {
-                break;
-              }
-            } // while (line[marker] != '>')
-          } // if (start)
-
-          if (error)
-          {
-            break;
-          }
 
-          //! Pass tag information for data structure assignment
-          if (start)
-          {
-            if (state && startElement (name, attr))
-            {
-              state = true;
-              attr.name.clear();
-              attr.val.clear();
-            }
-            else
-            {
-              state = false;
-            }
+  void CrpiXmlFramer::rescan ()
+  {
+    scan_ = start_;
+    depth_ = 0;
+    inTag_ = false;
+    kind_ = 0;
+    quote_ = 0;
+    last_ = 0;
+    root_ = false;
+  }
 
-            validXML = false;
-            openTags++;
-            readTags = true;
-            if (single)
-            {
-              tagActive = false;
-              validXML = true;
-              if (state && endElement (name))
-              {
-                state = true;
-              }
-              else
-              {
-                state = false;
-              }
-              openTags--;
-              start = false;
-            }
-          } // if (start)
-          else
-          {
-            tagActive = false;
-            validXML = true;
-            if (state && endElement (name))
-            {
-              state = true;
-            }
-            else
-            {
-              state = false;
-            }
-            openTags--;
-          } // if (start) ... else
-        } // if (line[marker] == '<')
-        else if (tagActive)
-        {
-          //! ***** Handle text between tags *****
-          while(start)
-          {
-            if (marker > strLength || line[marker] == '<')
-            {
-              marker--;
-              break;
-            }
 
-            //! Skip white space
-            while (line[marker] == ' ' || line[marker] == '\t' ||
-                   line[marker] == '\n' || line[marker] == ',' ||
-                   line[marker] == '?')
-            {
-              marker++;
-              if (marker >= strLength)
-              {
-                break;
-              }
-            }
+  LIBRARY_API bool crpi_xml_state (CrpiXmlWriter &out, CanonReturn status)
+  {
+    switch (status)
+    {
+    case CANON_SUCCESS:
+      return out.append ("Done");
+    case CANON_REJECT:
+    case CANON_FAILURE:
+      return out.append ("Error");
+    case CANON_RUNNING:
+      return out.append ("Working");
+    default:
+      return false;
+    }
+  }
 
-            if (marker > strLength || line[marker] == '<')
-            {
-              marker--;
-              break;
-            }
 
-            count = 0;
-            while (line[marker] != ',' && line[marker] != '<')
-            {
-              buff[count++] = line[marker++];
-              if (marker >= strLength - 1)
-              {
-                break;
-              }
-            }
-            if (marker >= (strLength - 1))
-            {
-              //! Ill-formed XML string (end encountered before closing tags
-              error = true;
-              break;
-            }
-            if (count > 0)
-            {
-              temp = buff;
-              temp = temp.substr (0, count);
-              chars.push_back (temp);
-            }
-          } // while(start)
-          if (start)
-          {
-            if (state && interTagElement (name, chars))
-            {
-              state = true;
-            }
-            else
-            {
-              state = false;
-            }
-            chars.clear ();
-          }
-          start = false;
-        } // else if (tagActive)
+  LIBRARY_API CrpiXml::CrpiXml (CrpiXmlParams *params) :
+    params_(params),
+    command_(NULL)
+  {
+    //xaxisactive = zaxisactive = false;
+  }
 
-        ++marker;
-        if (openTags < 1 && readTags)
-        {
-//          break;
-        }
-      } // while (marker < strLength && marker < 1024)
-    } // try
-    catch (...)
+
+  LIBRARY_API CrpiXml::~CrpiXml ()
+  {
+    params_ = NULL;
+  }
+
+
+  LIBRARY_API bool CrpiXml::characters(const vector<string>& ch)
+  {
+    vector<string>::const_iterator chIter = ch.begin();
+
+    for (; chIter != ch.end(); ++chIter)
     {
-      return false;
     }
 
-    if (error)
+    return true;
+  }
+
+
+  LIBRARY_API bool CrpiXml::parse (const string &line)
+  {
+    params_->commandID = 0;
+    try
+    {
+      return sax_.parse (line.c_str(), line.length(), *this);
+    }
+    catch (...)
     {
-      //! Exiting with errors
+      return false;
     }
-    return state;
   }
 
+
+  LIBRARY_API bool CrpiXml::parse (const string &line, const std::function<bool ()> &command)
+  {
+    bool flag;
+    command_ = &command;
+    flag = parse (line);
+    command_ = NULL;
+    return flag;
+  }
+
+
   /*
     Example commands for robot motion:
 
@@ -409,6 +375,52 @@ namespace Xml
     </CRPICommand>
   */
 
+  //! @brief CRPICommand type attribute values and the commands they select
+  //!
+  static const xmlName crpiCommandNames[] =
+  {
+    CRPI_XML_NAME("ApplyCartesianForceTorque",    CmdApplyCartesianForceTorque),
+    CRPI_XML_NAME("ApplyJointTorque",             CmdApplyJointTorque),
+    CRPI_XML_NAME("Couple",                       CmdCouple),
+    CRPI_XML_NAME("GetRobotAxes",                 CmdGetRobotAxes),
+    CRPI_XML_NAME("GetRobotForces",               CmdGetRobotForces),
+    CRPI_XML_NAME("GetRobotIO",                   CmdGetRobotIO),
+    CRPI_XML_NAME("GetRobotPose",                 CmdGetRobotPose),
+    CRPI_XML_NAME("GetRobotSpeed",                CmdGetRobotSpeed),
+    CRPI_XML_NAME("GetRobotTorques",              CmdGetRobotTorques),
+    CRPI_XML_NAME("Message",                      CmdMessage),
+    CRPI_XML_NAME("MoveAttractor",                CmdMoveAttractor),
+    CRPI_XML_NAME("MoveStraightTo",               CmdMoveStraightTo),
+    CRPI_XML_NAME("MoveThroughTo",                CmdMoveThroughTo),
+    CRPI_XML_NAME("MoveTo",                       CmdMoveTo),
+    CRPI_XML_NAME("MoveToAxisTarget",             CmdMoveToAxisTarget),
+    CRPI_XML_NAME("SetAbsoluteAcceleration",      CmdSetAbsoluteAcceleration),
+    CRPI_XML_NAME("SetAbsoluteSpeed",             CmdSetAbsoluteSpeed),
+    CRPI_XML_NAME("SetAngleUnits",                CmdSetAngleUnits),
+    CRPI_XML_NAME("SetAxialSpeeds",               CmdSetAxialSpeeds),
+    CRPI_XML_NAME("SetAxialUnits",                CmdSetAxialUnits),
+    CRPI_XML_NAME("SetEndPoseTolerance",          CmdSetEndPoseTolerance),
+    CRPI_XML_NAME("SetIntermediatePoseTolerance", CmdSetIntermediatePoseTolerance),
+    CRPI_XML_NAME("SetLengthUnits",               CmdSetLengthUnits),
+    CRPI_XML_NAME("SetParameter",                 CmdSetParameter),
+    CRPI_XML_NAME("SetRelativeAcceleration",      CmdSetRelativeAcceleration),
+    CRPI_XML_NAME("SetRelativeSpeed",             CmdSetRelativeSpeed),
+    CRPI_XML_NAME("SetRobotIO",                   CmdSetRobotIO),
+    CRPI_XML_NAME("SetRobotDO",                   CmdSetRobotDO),
+    CRPI_XML_NAME("SetTool",                      CmdSetTool),
+    CRPI_XML_NAME("StopMotion",                   CmdStopMotion),
+    CRPI_XML_NAME("ToWorldMatrix",                CmdToWorldMatrix),
+    CRPI_XML_NAME("ToSystemMatrix",               CmdToSystemMatrix),
+    CRPI_XML_NAME("ToWorld",                      CmdToWorld),
+    CRPI_XML_NAME("FromWorld",                    CmdFromWorld),
+    CRPI_XML_NAME("ToSystem",                     CmdToSystem),
+    CRPI_XML_NAME("FromSystem",                   CmdFromSystem),
+    CRPI_XML_NAME("UpdateWorldTransform",         CmdUpdateWorldTransform),
+    CRPI_XML_NAME("UpdateSystemTransform",        CmdUpdateSystemTransform),
+    CRPI_XML_NAME("SaveConfig",                   CmdSaveConfig)
+  };
+
+
   LIBRARY_API bool CrpiXml::startElement (const string& tagName, 
                                           const xmlAttributes& attr)
   {
@@ -424,203 +436,17 @@ namespace Xml
         {
           if (strcmp (nameiter->c_str(), "type") == 0)
           {
-            if (strcmp(valiter->c_str(), "ApplyCartesianForceTorque") == 0)
-            {
-              //CanonReturn ApplyCartesianForceTorque (robotPose robotForceTorque, vector<bool> activeAxes, vector<bool> manipulator);
-              params_->cmd = CmdApplyCartesianForceTorque;
-            }
-            else if (strcmp(valiter->c_str(), "ApplyJointTorque") == 0)
-            {
-              //CanonReturn ApplyJointTorque(robotAxes robotJointTorque);
-              params_->cmd = CmdApplyJointTorque;
-            }
-            else if (strcmp(valiter->c_str(), "Couple") == 0)
-            {
-              //CanonReturn Couple (const char *targetID);
-              params_->cmd = CmdCouple;
-            }
-            else if (strcmp(valiter->c_str(), "GetRobotAxes") == 0)
-            {
-              //CanonReturn GetRobotAxes (robotAxes *axes);
-              params_->cmd = CmdGetRobotAxes;
-            }
-            else if (strcmp(valiter->c_str(), "GetRobotForces") == 0)
-            {
-              //CanonReturn GetRobotForces (robotPose *forces);
-              params_->cmd = CmdGetRobotForces;
-            }
-            else if (strcmp(valiter->c_str(), "GetRobotIO") == 0)
-            {
-              //CanonReturn GetRobotIO (robotIO *io);
-              params_->cmd = CmdGetRobotIO;
-            }
-            else if (strcmp(valiter->c_str(), "GetRobotPose") == 0)
-            {
-              //CanonReturn GetRobotPose (robotPose *pose);
-              params_->cmd = CmdGetRobotPose;
-            }
-            else if (strcmp(valiter->c_str(), "GetRobotSpeed") == 0)
-            {
-              //CanonReturn GetRobotSpeed(robotPose *speed);
-              params_->cmd = CmdGetRobotSpeed;
-            }
-            else if (strcmp(valiter->c_str(), "GetRobotTorques") == 0)
-            {
-              //CanonReturn GetRobotTorques(robotAxes *torques);
-              params_->cmd = CmdGetRobotTorques;
-            }
-            else if (strcmp(valiter->c_str(), "Message") == 0)
-            {
-              //CanonReturn Message(const char *message);
-              params_->cmd = CmdMessage;
-            }
-            else if (strcmp(valiter->c_str(), "MoveAttractor") == 0)
-            {
-              //CanonReturn MoveAttractor(robotPose pose);
-              params_->cmd = CmdMoveAttractor;
-            }
-            else if (strcmp(valiter->c_str(), "MoveStraightTo") == 0)
-            {
-              //CanonReturn MoveStraightTo(robotPose pose);
-              params_->cmd = CmdMoveStraightTo;
-            }
-            else if (strcmp(valiter->c_str(), "MoveThroughTo") == 0)
-            {
-              //CanonReturn MoveThroughTo(robotPose *poses, int numPoses, robotPose *accelerations = NULL, robotPose *speeds = NULL, robotPose *tolerances = NULL);
-              params_->cmd = CmdMoveThroughTo;
-            }
-            else if (strcmp(valiter->c_str(), "MoveTo") == 0)
-            {
-              //CanonReturn MoveTo(robotPose pose);
-              params_->cmd = CmdMoveTo;
-            }
-            else if (strcmp(valiter->c_str(), "MoveToAxisTarget") == 0)
-            {
-              //CanonReturn MoveToAxisTarget(robotAxes axes);
-             params_->cmd = CmdMoveToAxisTarget;
-            }
-            else if (strcmp(valiter->c_str(), "SetAbsoluteAcceleration") == 0)
-            {
-              //CanonReturn SetAbsoluteAcceleration (double acceleration);
-              params_->cmd = CmdSetAbsoluteAcceleration;
-            }
-            else if (strcmp(valiter->c_str(), "SetAbsoluteSpeed") == 0)
-            {
-              //CanonReturn SetAbsoluteSpeed(double speed);
-              params_->cmd = CmdSetAbsoluteSpeed;
-            }
-            else if (strcmp(valiter->c_str(), "SetAngleUnits") == 0)
-            {
-              //CanonReturn SetAngleUnits (const char *unitName);
-              params_->cmd = CmdSetAngleUnits;
-            }
-            else if (strcmp(valiter->c_str(), "SetAxialSpeeds") == 0)
-            {
-              //CanonReturn SetAxialSpeeds(double *speeds);
-              params_->cmd = CmdSetAxialSpeeds;
-            }
-            else if (strcmp(valiter->c_str(), "SetAxialUnits") == 0)
-            {
-              //CanonReturn SetAxialUnits(const char **unitNames);
-              params_->cmd = CmdSetAxialUnits;
-            }
-            else if (strcmp(valiter->c_str(), "SetEndPoseTolerance") == 0)
-            {
-              //CanonReturn SetEndPoseTolerance(robotPose tolerance);
-              params_->cmd = CmdSetEndPoseTolerance;
-            }
-            else if (strcmp(valiter->c_str(), "SetIntermediatePoseTolerance") == 0)
-            {
-              //CanonReturn SetIntermediatePoseTolerance(robotPose *tolerances);
-              params_->cmd = CmdSetIntermediatePoseTolerance;
-            }
-            else if (strcmp(valiter->c_str(), "SetLengthUnits") == 0)
+            int cmd;
+            if (crpi_xml_lookup (crpiCommandNames, sizeof(crpiCommandNames) / sizeof(xmlName), valiter->c_str(), cmd) && cmd >= 0)
             {
-              //CanonReturn SetLengthUnits(const char *unitName);
-              params_->cmd = CmdSetLengthUnits;
-            }
-            else if (strcmp(valiter->c_str(), "SetParameter") == 0)
-            {
-              //CanonReturn SetParameter(const char *paramName, void *paramVal);
-              params_->cmd = CmdSetParameter;
-            }
-            else if (strcmp(valiter->c_str(), "SetRelativeAcceleration") == 0)
-            {
-              //CanonReturn SetRelativeAcceleration(double percent);
-              params_->cmd = CmdSetRelativeAcceleration;
-            }
-            else if (strcmp(valiter->c_str(), "SetRelativeSpeed") == 0)
-            {
-              //CanonReturn SetRelativeSpeed(double percent);
-              params_->cmd = CmdSetRelativeSpeed;
-            }
-            else if (strcmp(valiter->c_str(), "SetRobotIO") == 0)
-            {
-              // CanonReturn SetRobotIO(robotIO io);
-              params_->cmd = CmdSetRobotIO;
-            }
-            else if (strcmp(valiter->c_str(), "SetRobotDO") == 0)
-            {
-              //CanonReturn SetRobotDO(int dig_out, bool val);
-              params_->cmd = CmdSetRobotDO;
-            }
-            else if (strcmp(valiter->c_str(), "SetTool") == 0)
-            {
-              //CanonReturn SetTool (double percent);
-              params_->cmd = CmdSetTool;
-            }
-            else if (strcmp(valiter->c_str(), "StopMotion") == 0)
-            {
-              //CanonReturn StopMotion(int condition = 2);
-              params_->cmd = CmdStopMotion;
-            }
-            else if (strcmp(valiter->c_str(), "ToWorldMatrix") == 0)
-            {
-              //CanonReturn ToWorldMatrix(matrix & R_T_W);
-              params_->cmd = CmdToWorldMatrix;
-            }
-            else if (strcmp(valiter->c_str(), "ToSystemMatrix") == 0)
-            {
-              //CanonReturn ToCoordSystemMatrix(const char *name, matrix &R_T_S);
-              params_->cmd = CmdToSystemMatrix;
-            }
-            else if (strcmp(valiter->c_str(), "ToWorld") == 0)
-            {
-              //CanonReturn ToWorld(robotPose *in, robotPose *out);
-              params_->cmd = CmdToWorld;
-            }
-            else if (strcmp(valiter->c_str(), "FromWorld") == 0)
-            {
-              //CanonReturn FromWorld(robotPose *in, robotPose *out);
-              params_->cmd = CmdFromWorld;
-            }
-            else if (strcmp(valiter->c_str(), "ToSystem") == 0)
-            {
-              //CanonReturn ToSystem(const char *name, robotPose *in, robotPose *out);
-              params_->cmd = CmdToSystem;
-            }
-            else if (strcmp(valiter->c_str(), "FromSystem") == 0)
-            {
-              //CanonReturn FromSystem(const char *name, robotPose *in, robotPose *out);
-              params_->cmd = CmdFromSystem;
-            }
-            else if (strcmp(valiter->c_str(), "UpdateWorldTransform") == 0)
-            {
-              //CanonReturn UpdateWorldTransform(robotPose &newToSystem);
-              //CanonReturn UpdateWorldTransform(matrix &newToSystem);
-              params_->cmd = CmdUpdateWorldTransform;
-            }
-            else if (strcmp(valiter->c_str(), "UpdateSystemTransform") == 0)
-            {
-              //CanonReturn UpdateSystemTransform(const char *name, robotPose &newToWorld);
-              params_->cmd = CmdUpdateSystemTransform;
-            }
-            else if (strcmp(valiter->c_str(), "SaveConfig") == 0)
-            {
-              //CanonReturn SaveConfig(const char *file);
-              params_->cmd = CmdSaveConfig;
+              params_->cmd = (CanonCommand)cmd;
             }
           } //if (strcmp (nameiter->c_str(), "type") == 0)
+          else if (strcmp (nameiter->c_str(), "ID") == 0)
+          {
+            //! Client-chosen identifier, echoed back in the response
+            params_->commandID = atoi (valiter->c_str ());
+          }
         } //for (; nameiter != attr.name.end(); ++nameiter, ++valiter)
       } //if (strcmp (tagName.c_str(), "CRPICommand") == 0)
       else if (strcmp(tagName.c_str(), "String") == 0)
@@ -972,6 +798,12 @@ namespace Xml
 
   LIBRARY_API bool CrpiXml::endElement(const string& tagName)
   {
+    if (command_ != NULL && strcmp (tagName.c_str(), "CRPICommand") == 0)
+    {
+      //! One command of a batch is complete
+      return (*command_)();
+    }
+
     /*
     if (strcmp (tagName.c_str(), "XAxis") == 0)
     {
@@ -995,86 +827,89 @@ namespace Xml
 
   LIBRARY_API bool CrpiXml::encode (char *line)
   {
-    std::string str;
-    stringstream ss;
-    ss.str(string());
+    if (!encode (out_))
+    {
+      return false;
+    }
+    memcpy (line, out_.data(), out_.size());
+    line[out_.size()] = '\0';
+    return true;
+  }
+
+
+  LIBRARY_API bool CrpiXml::encode (CrpiXmlWriter &out)
+  {
     int i;
 
-    switch (params_->status)
+    out.clear();
+    if (params_ == NULL)
     {
-    case CANON_SUCCESS:
-      str = "Done";
-      break;
-    case CANON_REJECT:
-      str = "Error";
-      break;
-    case CANON_FAILURE:
-      str = "Error";
-      break;
-    case CANON_RUNNING:
-      str = "Working";
-      break;
-    default:
-      return CANON_FAILURE;
+      return false;
     }
 
-    if (params_ != NULL)
+    if (params_->commandID != 0)
     {
-      ss << "<CRPIStatus>";
-      ss << "<StatusID>" << params_->counter << "</StatusID><CommandState>" << str.c_str() << "</CommandState>";
-      ss << "<Tool><Name>" << params_->toolName.c_str() << "</Name><Value>" << params_->toolVal << "</Value></Tool>";
-      ss << "<Pose>" << "<X>" << params_->pose->x << "</X><Y>" << params_->pose->y << "</Y><Z>" << params_->pose->z
-         << "</Z><XRot>" << params_->pose->xrot << "</XRot><YRot>" << params_->pose->yrot << "</YRot><ZRot>"
-         << params_->pose->zrot << "</ZRot></Pose>";
-      ss << "<Joints>";
-      for (i = 0; i < params_->axes->axes; ++i)
-      {
-        ss << "<J" << i << ">" << params_->axes->axis.at(i) << "</J" << i << ">";
-      }
-      ss << "</Joints>";
+      out.append ("<CRPIStatus ID=\"");
+      out.appendInt (params_->commandID);
+      out.append ("\"><StatusID>");
+    }
+    else
+    {
+      out.append ("<CRPIStatus><StatusID>");
+    }
+    out.appendUnsigned (params_->counter);
+    out.append ("</StatusID><CommandState>");
+    if (!crpi_xml_state (out, params_->status))
+    {
+      return false;
+    }
+    out.append ("</CommandState><Tool><Name>");
+    out.append (params_->toolName);
+    out.append ("</Name><Value>");
+    out.appendReal (params_->toolVal, false);
+    out.append ("</Value></Tool><Pose><X>");
+    out.appendReal (params_->pose->x, false);
+    out.append ("</X><Y>");
+    out.appendReal (params_->pose->y, false);
+    out.append ("</Y><Z>");
+    out.appendReal (params_->pose->z, false);
+    out.append ("</Z><XRot>");
+    out.appendReal (params_->pose->xrot, false);
+    out.append ("</XRot><YRot>");
+    out.appendReal (params_->pose->yrot, false);
+    out.append ("</YRot><ZRot>");
+    out.appendReal (params_->pose->zrot, false);
+    out.append ("</ZRot></Pose><Joints>");
+    for (i = 0; i < params_->axes->axes; ++i)
+    {
+      out.append ("<J");
+      out.appendInt (i);
+      out.append (">");
+      out.appendReal (params_->axes->axis.at(i), false);
+      out.append ("</J");
+      out.appendInt (i);
+      out.append (">");
+    }
+    out.append ("</Joints>");
 
-      if (params_->cmd == CmdGetRobotForces)
-      {
+    if (params_->cmd == CmdGetRobotForces)
+    {
 
-      }
-      else if (params_->cmd == CmdGetRobotIO)
-      {
+    }
+    else if (params_->cmd == CmdGetRobotIO)
+    {
 
-      }
-      else if (params_->cmd == CmdGetRobotSpeed)
-      {
+    }
+    else if (params_->cmd == CmdGetRobotSpeed)
+    {
 
-      }
-      else if (params_->cmd == CmdGetRobotTorques)
-      {
-      }
-      ss << "</CRPIStatus>";
-
-/*
-      //! Include gripper status if a tool has been defined using the couple command
-      sprintf (line, "<CRPIStatus><StatusID>%d</StatusID><CommandState>%s</CommandState></CommandStatus><Tool><Name>%s</Name><Value>%f</Value></Gripper><Pose><X>%f</X><Y>%f</Y><Z>%f</Z><XRot>%f</XRot><YRot>%f</YRot><ZRot>%f</ZRot></Pose><Joints></Joints></CRPIStatus>\0",
-                params_->counter,      
-                str.c_str(),
-                params_->toolName.c_str(),
-                params_->toolVal,
-                params_->pose->x,
-                params_->pose->y,
-                params_->pose->z,
-                params_->pose->xrot,
-                params_->pose->yrot,
-                params_->pose->zrot,
-                params_->axes->axis.at(0),
-                params_->axes->axis.at(1),
-                params_->axes->axis.at(2),
-                params_->axes->axis.at(3),
-                params_->axes->axis.at(4),
-                params_->axes->axis.at(5),
-                params_->axes->axis.at(6));
-*/
-    } //if (params_ != NULL)
-
-    sprintf(line, "%s", ss.str().c_str());
-    return true;
+    }
+    else if (params_->cmd == CmdGetRobotTorques)
+    {
+    }
+    out.append ("</CRPIStatus>");
+
+    return !out.overflowed();
   }
 
-} // XML
\ No newline at end of file
+} // XML
\ No newline at end of file
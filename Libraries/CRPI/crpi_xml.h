@@ -20,6 +20,8 @@
 
 #include <string>
 #include <sstream>
+#include <functional>
+#include <stdint.h>
 #include "crpi.h"
 #include "..\Math\MatrixMath.h"
 
@@ -115,6 +117,9 @@ namespace Xml
     //!
     std::string toolName;
 
+    //! @brief The ID attribute of the command being answered (0 if it had none), echoed as
+    //!        the ID attribute of <CRPIStatus> so that clients can match responses to commands
+    //!
     int commandID;
 
     //! @brief The commanded value for the tool
@@ -125,31 +130,42 @@ namespace Xml
     //!
     unsigned int counter;
 
+    //! @brief Storage behind pose, forces, axes, torques, io, and matrx, kept in the structure
+    //!        so that the command decoders and the dispatcher touch one block
+    //!
+    robotPose poseData;
+    robotPose forcesData;
+    robotAxes axesData;
+    robotAxes torquesData;
+    robotIO ioData;
+    Math::matrix matrxData;
+
     //! @brief Default constructor
     //!
-    CrpiXmlParams()
+    CrpiXmlParams() :
+      matrxData(4, 4)
     {
-      pose = new robotPose();
-      axes = new robotAxes();
-      forces = new robotPose();
-      torques = new robotAxes();
-      io = new robotIO();
+      pose = &poseData;
+      axes = &axesData;
+      forces = &forcesData;
+      torques = &torquesData;
+      io = &ioData;
       moveStraight = true;
       setting = numPositions = 0.0f;
       counter = 0;
-      matrx = new Math::matrix(4, 4);
+      matrx = &matrxData;
     }
 
     //! @brief Default destructor
     //!
     ~CrpiXmlParams()
     {
-      delete[] pose;
-      delete[] axes;
-      delete[] forces;
-      delete[] torques;
-      delete[] io;
     }
+
+  private:
+    //! The pointers refer to this instance's own storage
+    CrpiXmlParams(const CrpiXmlParams &);
+    CrpiXmlParams &operator=(const CrpiXmlParams &);
   };
 
 
@@ -709,11 +725,232 @@ namespace Xml
   };
 
 
+  //! @brief Default capacity of a CrpiXmlWriter in bytes
+  //!
+#define CRPI_XML_RESPONSE_MAX 8192
+
+  //! @ingroup Xml
+  //!
+  //! @brief Bounded output buffer for encoding XML responses.  The storage is allocated once
+  //!        and reused by every response, and appends never write past the capacity.
+  //!
+  class LIBRARY_API CrpiXmlWriter
+  {
+  public:
+
+    //! @brief Constructor
+    //!
+    //! @param capacity Largest response, in bytes, this writer can hold
+    //!
+    CrpiXmlWriter (size_t capacity = CRPI_XML_RESPONSE_MAX);
+
+    //! @brief Default destructor
+    //!
+    ~CrpiXmlWriter ();
+
+    //! @brief Discard the current contents, keeping the storage
+    //!
+    void clear ();
+
+    //! @brief Append raw text
+    //!
+    //! @param text The text to append
+    //! @param len  Number of bytes of text
+    //!
+    //! @return True if the text fit, false otherwise (nothing is appended)
+    //!
+    bool append (const char *text, size_t len);
+
+    //! @brief Append a string literal, with its length known at compile time
+    //!
+    template <size_t N> bool append (const char (&text)[N])
+    {
+      return append (text, N - 1);
+    }
+
+    //! @brief Append a string
+    //!
+    bool append (const std::string &text);
+
+    //! @brief Append a signed integer in decimal
+    //!
+    bool appendInt (long val);
+
+    //! @brief Append an unsigned integer in decimal
+    //!
+    bool appendUnsigned (unsigned long val);
+
+    //! @brief Append a real number
+    //!
+    //! @param val   The number to append
+    //! @param fixed Whether to use fixed notation with 6 decimals (printf %f) or the shortest of
+    //!              fixed and scientific notation with 6 significant digits (printf %g, the
+    //!              iostream default)
+    //!
+    bool appendReal (double val, bool fixed);
+
+    //! @brief Start of the encoded text (not NUL-terminated)
+    //!
+    const char *data () const
+    {
+      return buf_;
+    }
+
+    //! @brief Length of the encoded text in bytes
+    //!
+    size_t size () const
+    {
+      return len_;
+    }
+
+    //! @brief Whether an append was refused since the last call to clear
+    //!
+    bool overflowed () const
+    {
+      return overflow_;
+    }
+
+  private:
+
+    //! @brief Storage for the encoded text
+    //!
+    char *buf_;
+
+    //! @brief Capacity of buf_ in bytes
+    //!
+    size_t cap_;
+
+    //! @brief Number of bytes used in buf_
+    //!
+    size_t len_;
+
+    //! @brief Whether an append did not fit
+    //!
+    bool overflow_;
+
+    //! @brief Writers own their storage and are not copied
+    //!
+    CrpiXmlWriter (const CrpiXmlWriter &);
+    CrpiXmlWriter &operator= (const CrpiXmlWriter &);
+  }; // CrpiXmlWriter
+
+
+  //! @ingroup Xml
+  //!
+  //! @brief Splits a byte stream into complete XML documents.  Bytes are read straight into
+  //!        the framer's buffer, and each call to next returns one whole document (a root
+  //!        element, e.g., <CRPICommand>...</CRPICommand> or <CRPIStatus>...</CRPIStatus>),
+  //!        however the stream was cut into reads:  several documents in one read are all
+  //!        returned, and a partial document is kept until the rest arrives.  Every byte is
+  //!        scanned once, with the element depth carried between reads.
+  //!
+  //! @note Text between documents may only be whitespace (or NUL terminators sent by some
+  //!       clients).  Declarations and comments (<?...?>, <!...>) are skipped.
+  //!
+  class LIBRARY_API CrpiXmlFramer
+  {
+  public:
+
+    //! @brief Constructor
+    //!
+    //! @param capacity Largest document, in bytes, the framer can hold
+    //!
+    CrpiXmlFramer (size_t capacity = CRPI_XML_RESPONSE_MAX);
+
+    //! @brief Default destructor
+    //!
+    ~CrpiXmlFramer ();
+
+    //! @brief Free space to read into, after the bytes held.  Documents already returned by
+    //!        next are discarded to make room.
+    //!
+    //! @param room Populated with the number of bytes that may be written
+    //!
+    //! @return Where to write
+    //!
+    char *space (size_t &room);
+
+    //! @brief Add bytes written to the space returned by space
+    //!
+    void commit (size_t count);
+
+    //! @brief Take the next complete document
+    //!
+    //! @param doc Set to the start of the document, valid until the next call to space
+    //! @param len Set to the length of the document
+    //!
+    //! @return 1 if a document was taken, 0 if more bytes are needed, and -1 if the stream
+    //!         is not XML or a document is larger than the capacity
+    //!
+    int next (const char *&doc, size_t &len);
+
+    //! @brief Bytes held but not yet taken, for streams that are framed another way
+    //!
+    const char *data () const
+    {
+      return buf_ + start_;
+    }
+
+    size_t size () const
+    {
+      return end_ - start_;
+    }
+
+    //! @brief Drop bytes from the front of those held (resets the document scan)
+    //!
+    void consume (size_t count);
+
+    //! @brief Drop everything held
+    //!
+    void clear ();
+
+  private:
+
+    //! @brief Restart the scan at start_
+    //!
+    void rescan ();
+
+    //! @brief Storage, and the bytes held in it:  [start_, end_)
+    //!
+    char *buf_;
+    size_t cap_;
+    size_t start_;
+    size_t end_;
+
+    //! @brief Scan state:  next byte to look at, element depth, whether the scan is inside a
+    //!        tag (and its kind, quote, and last character), and whether the root element
+    //!        has started
+    //!
+    size_t scan_;
+    int depth_;
+    bool inTag_;
+    char kind_;
+    char quote_;
+    char last_;
+    bool root_;
+
+    //! @brief Framers own their storage and are not copied
+    //!
+    CrpiXmlFramer (const CrpiXmlFramer &);
+    CrpiXmlFramer &operator= (const CrpiXmlFramer &);
+  }; // CrpiXmlFramer
+
+
+  //! @brief Append the CommandState text of a command status
+  //!
+  //! @param out    The writer receiving the text
+  //! @param status The status to describe
+  //!
+  //! @return True if the text was appended, false if status is unknown or out is full
+  //!
+  LIBRARY_API bool crpi_xml_state (CrpiXmlWriter &out, CanonReturn status);
+
+
   //! @ingroup Xml
   //!
   //! @brief XML parsing class based on the SAX structure
   //!
-  class LIBRARY_API CrpiXml
+  class LIBRARY_API CrpiXml : public CrpiSaxHandler
   {
   public:
 
@@ -737,6 +974,18 @@ namespace Xml
     //!
     bool parse (const std::string& line);
 
+    //! @brief Parse a document holding one or more CRPICommand elements
+    //!
+    //! @param line    The input string to be parsed
+    //! @param command Called as each </CRPICommand> is reached, with the params holding that
+    //!                command's arguments; returning false stops the parse
+    //!
+    //! @return True if parsing was successful and no call to command returned false
+    //!
+    //! @note A self-closing <CRPICommand .../> does not reach command
+    //!
+    bool parse (const std::string& line, const std::function<bool ()>& command);
+
     //! @brief Encode an XML string from an input schema
     //!
     //! @param line The output XML string
@@ -745,10 +994,31 @@ namespace Xml
     //!
     bool encode (char* line);
 
+    //! @brief Encode an XML response from an input schema
+    //!
+    //! @param out The writer receiving the response, cleared first
+    //!
+    //! @return True if encoding was successful, false if the status is unknown or the response
+    //!         does not fit in out
+    //!
+    bool encode (CrpiXmlWriter &out);
+
   private:
 
     CrpiXmlParams *params_;
 
+    //! @brief Per-command callback of the parse in progress, or NULL
+    //!
+    const std::function<bool ()> *command_;
+
+    //! @brief Tokenizer whose buffers are reused by each call to parse
+    //!
+    CrpiSaxParser sax_;
+
+    //! @brief Writer reused by encode (char*)
+    //!
+    CrpiXmlWriter out_;
+
     bool vectoractive;
     bool matrixactive;
     bool stringactive;
@@ -800,7 +1070,7 @@ namespace Xml
   //!
   //! @brief XML parsing class based on the SAX structure
   //!
-  class LIBRARY_API CrclXml
+  class LIBRARY_API CrclXml : public CrpiSaxHandler
   {
   public:
 
@@ -832,10 +1102,27 @@ namespace Xml
     //!
     bool encode (char* line);
 
+    //! @brief Encode an XML response from an input schema
+    //!
+    //! @param out The writer receiving the response, cleared first
+    //!
+    //! @return True if encoding was successful, false if the status is unknown or the response
+    //!         does not fit in out
+    //!
+    bool encode (CrpiXmlWriter &out);
+
   private:
 
     CrpiXmlParams *params_;
 
+    //! @brief Tokenizer whose buffers are reused by each call to parse
+    //!
+    CrpiSaxParser sax_;
+
+    //! @brief Writer reused by encode (char*)
+    //!
+    CrpiXmlWriter out_;
+
     bool xaxisactive;
     bool zaxisactive;
 
@@ -883,7 +1170,7 @@ namespace Xml
   //!
   //! @brief XML parsing of collaborative robot program representations
   //!
-  class LIBRARY_API CrpiProgramXml
+  class LIBRARY_API CrpiProgramXml : public CrpiSaxHandler
   {
   public:
 
@@ -919,6 +1206,10 @@ namespace Xml
 
     CrpiXmlProgramParams *params_;
 
+    //! @brief Tokenizer whose buffers are reused by each call to parse
+    //!
+    CrpiSaxParser sax_;
+
     //! @brief Parse the text between the tag pair
     //!
     //! @param ch The string of character located between the tag pair
@@ -958,6 +1249,340 @@ namespace Xml
   }; // CrclProgramXml
 
 
+  //! @brief Largest number of consecutive moves passed to the robot as one blended batch
+  //!
+#define CRPI_PROGRAM_LOOKAHEAD 16
+
+  //! @brief One command of a compiled program, with its arguments already decoded
+  //!
+  struct CrpiProgramStep
+  {
+    //! @brief The CRPI command to execute
+    //!
+    CanonCommand cmd;
+
+    //! @brief Command ID assigned by the program (CRCL CommandID), or 0
+    //!
+    int commandID;
+
+    //! @brief Target pose of MoveTo, MoveStraightTo, and MoveAttractor
+    //!
+    robotPose pose;
+
+    //! @brief Scalar argument (speed, acceleration, tool setting, or dwell time in seconds)
+    //!
+    double real;
+
+    //! @brief Signal number of SetRobotDO, or the index into CrpiCompiledProgram::axes or
+    //!        CrpiCompiledProgram::strings for commands that take joints or text
+    //!
+    int integer;
+
+    //! @brief Boolean argument of SetRobotDO
+    //!
+    bool boolean;
+  };
+
+  //! @brief A CRCL or CRPI program parsed once into a flat array of commands
+  //!
+  struct CrpiCompiledProgram
+  {
+    //! @brief The program's commands in execution order
+    //!
+    vector<CrpiProgramStep> steps;
+
+    //! @brief Joint targets referenced by MoveToAxisTarget steps
+    //!
+    vector<robotAxes> axes;
+
+    //! @brief Text arguments referenced by Couple, Message, SaveConfig, and Set*Units steps
+    //!
+    vector<std::string> strings;
+
+    //! @brief Index of the next step to execute.  Execution stops at a failed step and can
+    //!        be resumed from it.
+    //!
+    size_t next;
+
+    //! @brief Default constructor
+    //!
+    CrpiCompiledProgram()
+    {
+      next = 0;
+    }
+  };
+
+
+  //! @ingroup Xml
+  //!
+  //! @brief Compiles a whole program into a CrpiCompiledProgram in a single pass.  Each
+  //!        command is decoded by the same CrclXml or CrpiXml parser used for individual
+  //!        commands, so programs and interactive commands accept the same syntax.
+  //!
+  //! Accepts either a CRCL program (a CRCLProgram element holding InitCanon, MiddleCommand,
+  //! and EndCanon elements) or a CRPI program (any root element holding CRPICommand
+  //! elements).
+  //!
+  class LIBRARY_API CrpiProgramCompiler : public CrpiSaxHandler
+  {
+  public:
+
+    //! @brief Constructor
+    //!
+    CrpiProgramCompiler ();
+
+    //! @brief Default destructor
+    //!
+    ~CrpiProgramCompiler ();
+
+    //! @brief Compile a program
+    //!
+    //! @param xml     The program text
+    //! @param program The compiled program, replaced by this call
+    //! @param degrees Whether CRCL orientations are converted to degrees (true) or radians
+    //!                (false) until the program changes the angle units itself
+    //!
+    //! @return True if the program was parsed, false otherwise.  Commands with no CRPI
+    //!         equivalent are left out of the compiled program.
+    //!
+    bool compile (const std::string &xml, CrpiCompiledProgram &program, bool degrees);
+
+  private:
+
+    //! @brief Decoded arguments of the command being compiled
+    //!
+    CrpiXmlParams params_;
+
+    //! @brief Parsers for the two command syntaxes, both writing into params_
+    //!
+    CrclXml crcl_;
+    CrpiXml crpi_;
+
+    //! @brief Tokenizer for the whole program
+    //!
+    CrpiSaxParser sax_;
+
+    //! @brief Parser receiving the callbacks of the command being compiled, or NULL between
+    //!        commands
+    //!
+    CrpiSaxHandler *active_;
+
+    //! @brief Tag that opened the command being compiled
+    //!
+    std::string activeTag_;
+
+    //! @brief Joint addressed by the CRCL ActuateJoint element being parsed (1-based), or 0
+    //!
+    int joint_;
+
+    //! @brief Program being filled
+    //!
+    CrpiCompiledProgram *program_;
+
+    //! @brief Angle units used when converting CRCL orientations
+    //!
+    bool degrees_;
+
+    //! @brief Reset the command parameters before a command is parsed
+    //!
+    void beginCommand ();
+
+    //! @brief Append the command just parsed to the program
+    //!
+    void finishCommand ();
+
+    bool startElement (const std::string& tagName,
+                       const xmlAttributes& attr);
+
+    bool interTagElement (const std::string& tagName,
+                          const std::vector<std::string>& vals);
+
+    bool endElement (const std::string& tagName);
+  }; // CrpiProgramCompiler
+
+
+
+  //! @brief Leading bytes of every binary frame ("CRPB" in little-endian byte order).  A
+  //!        connection whose first bytes match this value talks the binary protocol;
+  //!        anything else is treated as CRPI XML
+  //!
+#define CRPI_BINARY_MAGIC 0x42505243u
+
+  //! @brief Revision of the binary frame layout
+  //!
+#define CRPI_BINARY_VERSION 1
+
+  //! @brief Size of the fixed tool name field carried in a binary status frame
+  //!
+#define CRPI_BINARY_TOOLNAME 32
+
+  //! @brief Largest binary frame accepted from a client
+  //!
+#define CRPI_BINARY_MAX_FRAME 8192
+
+  //! @brief Header at the start of every binary command and response frame
+  //!
+  //! @note All binary fields are little-endian and naturally aligned, so frames can be
+  //!       copied straight into these structures on the supported (x86 and ARM) hosts
+  //!
+  struct CrpiBinaryHeader
+  {
+    //! @brief Always CRPI_BINARY_MAGIC
+    //!
+    uint32_t magic;
+
+    //! @brief Length of the whole frame in bytes, header included
+    //!
+    uint32_t length;
+
+    //! @brief Frame layout revision (CRPI_BINARY_VERSION)
+    //!
+    uint16_t version;
+
+    //! @brief The CanonCommand being issued, or being answered in a response
+    //!
+    uint16_t cmd;
+
+    //! @brief CanonReturn of the command in a response, 0 in a command
+    //!
+    int32_t status;
+
+    //! @brief Client-chosen identifier, echoed back in the matching response
+    //!
+    uint32_t id;
+
+    //! @brief Response counter (the XML StatusID), 0 in a command
+    //!
+    uint32_t counter;
+  };
+
+  //! @brief Wire form of robotPose
+  //!
+  struct CrpiBinaryPose
+  {
+    double x, y, z, xrot, yrot, zrot;
+    int32_t status;
+    int32_t turns;
+  };
+
+  //! @brief Wire form of robotAxes
+  //!
+  struct CrpiBinaryAxes
+  {
+    int32_t axes;
+    int32_t reserved;
+    double axis[CRPI_AXES_MAX];
+  };
+
+  //! @brief Wire form of robotIO (digital signal i is bit i of dio)
+  //!
+  struct CrpiBinaryIO
+  {
+    int32_t ndio;
+    int32_t naio;
+    uint32_t dio;
+    uint32_t reserved;
+    double aio[CRPI_IO_MAX];
+  };
+
+  //! @brief Scalar arguments of SetRobotDO, SetTool, and the speed and acceleration commands
+  //!
+  struct CrpiBinaryArgs
+  {
+    double real;
+    int32_t integer;
+    uint8_t boolean;
+    uint8_t reserved[3];
+  };
+
+  //! @brief Body of every binary response, mirroring the contents of <CRPIStatus>
+  //!
+  //! @note GetRobotIO, GetRobotForces, and GetRobotTorques responses append a
+  //!       CrpiBinaryIO, CrpiBinaryPose, or CrpiBinaryAxes respectively
+  //!
+  struct CrpiBinaryStatus
+  {
+    double toolVal;
+    char toolName[CRPI_BINARY_TOOLNAME];
+    CrpiBinaryPose pose;
+    CrpiBinaryAxes axes;
+  };
+
+  static_assert(CRPI_IO_MAX <= 32, "CrpiBinaryIO packs the digital signals into 32 bits");
+  static_assert(sizeof(CrpiBinaryHeader) == 24, "binary header layout changed");
+  static_assert(sizeof(CrpiBinaryPose) == 56, "binary pose layout changed");
+  static_assert(sizeof(CrpiBinaryArgs) == 16, "binary argument layout changed");
+
+
+  //! @brief Length-prefixed binary alternative to CrpiXml.  Fills and reads the same
+  //!        CrpiXmlParams structure, so both protocols share one command dispatcher
+  //!
+  //! A command frame is a CrpiBinaryHeader followed by a payload selected by the command:
+  //!   - MoveTo, MoveStraightTo, MoveAttractor:            CrpiBinaryPose
+  //!   - MoveToAxisTarget:                                 CrpiBinaryAxes
+  //!   - SetRobotDO, SetTool, Set*Speed, Set*Acceleration: CrpiBinaryArgs
+  //!   - Couple, Message, SaveConfig, Set*Units:           raw characters of the string
+  //!   - everything else (e.g. the Get* queries):          nothing
+  //!
+  class LIBRARY_API CrpiBinary
+  {
+  public:
+
+    //! @brief Constructor
+    //!
+    CrpiBinary (CrpiXmlParams *params);
+
+    //! @brief Default destructor
+    //!
+    ~CrpiBinary ();
+
+    //! @brief Check whether the first bytes received on a connection open a binary frame
+    //!
+    //! @param buf Received bytes
+    //! @param len Number of bytes in buf
+    //!
+    //! @return True if the bytes received so far match CRPI_BINARY_MAGIC
+    //!
+    static bool isBinary (const char *buf, size_t len);
+
+    //! @brief Determine the length of the frame at the start of a receive buffer
+    //!
+    //! @param buf Received bytes
+    //! @param len Number of bytes in buf
+    //!
+    //! @return The frame length if the whole frame has arrived, 0 if more bytes are
+    //!         needed, or -1 if the buffer does not start with a valid frame header
+    //!
+    static long frameLength (const char *buf, size_t len);
+
+    //! @brief Decode one complete command frame into the parameter structure
+    //!
+    //! @param buf Start of the frame
+    //! @param len Length of the frame as reported by frameLength
+    //!
+    //! @return True if decoding was successful, false otherwise
+    //!
+    bool decode (const char *buf, size_t len);
+
+    //! @brief Encode a response frame for the most recently decoded command
+    //!
+    //! @param buf Output buffer
+    //! @param max Capacity of buf in bytes
+    //!
+    //! @return The length of the encoded frame, or 0 if buf is too small
+    //!
+    size_t encode (char *buf, size_t max);
+
+  private:
+
+    CrpiXmlParams *params_;
+
+    //! @brief Identifier of the most recently decoded command
+    //!
+    uint32_t id_;
+  }; // CrpiBinary
+
+
 } // Xml namespace
 
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
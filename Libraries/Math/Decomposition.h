@@ -0,0 +1,1117 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Math
+//  Workfile:        Decomposition.h
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Matrix decompositions (LU with partial pivoting, Householder QR, Cholesky,
+//  and one-sided Jacobi SVD) with solve functions that never form an explicit
+//  inverse.  Each decomposition works on one contiguous row-major array, and
+//  every inner loop runs along a row.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef DECOMPOSITION_H
+#define DECOMPOSITION_H
+
+#include <vector>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+namespace Math
+{
+  //! @brief Number of columns eliminated per panel in the blocked LU factorization
+  //!
+  static const int decompBlock = 32;
+
+
+  //! @brief LU factorization with partial pivoting (P A = L U) of a square matrix
+  //!
+  class LUDecomp
+  {
+  public:
+    //! @brief Default constructor
+    //!
+    LUDecomp () :
+      n_(0),
+      sign_(1),
+      valid_(false)
+    {
+    }
+
+    //! @brief Factor a square matrix.  Columns are eliminated in panels of decompBlock, and the
+    //!        rest of the matrix is updated once per panel instead of once per column.
+    //!
+    //! @param a         Row-major values of the matrix
+    //! @param n         Number of rows and columns
+    //! @param tolerance Smallest pivot magnitude accepted (the same limit as matrix::inv)
+    //!
+    //! @return True if the matrix is nonsingular, false otherwise
+    //!
+    bool factor (const double *a, int n, double tolerance = 1.0e-8)
+    {
+      int i, j, k, c, p, k0, k1;
+      double big, v, l, inv;
+      double *ri, *rj;
+      const double *rk;
+
+      n_ = n;
+      sign_ = 1;
+      valid_ = false;
+      if (n < 1)
+      {
+        return false;
+      }
+
+      lu_.assign(a, a + ((size_t)n * n));
+      perm_.resize(n);
+      for (i = 0; i < n; ++i)
+      {
+        perm_[i] = i;
+      }
+
+      for (k0 = 0; k0 < n; k0 += decompBlock)
+      {
+        k1 = std::min(k0 + decompBlock, n);
+
+        //! Panel:  unblocked elimination of columns k0..k1-1, swapping whole rows
+        for (j = k0; j < k1; ++j)
+        {
+          p = j;
+          big = fabs(lu_[((size_t)j * n) + j]);
+          for (i = j + 1; i < n; ++i)
+          {
+            v = fabs(lu_[((size_t)i * n) + j]);
+            if (v > big)
+            {
+              big = v;
+              p = i;
+            }
+          }
+          if (big < tolerance)
+          {
+            return false;
+          }
+          if (p != j)
+          {
+            std::swap_ranges(&lu_[(size_t)p * n], &lu_[(size_t)p * n] + n, &lu_[(size_t)j * n]);
+            std::swap(perm_[p], perm_[j]);
+            sign_ = -sign_;
+          }
+
+          rj = &lu_[(size_t)j * n];
+          inv = 1.0 / rj[j];
+          for (i = j + 1; i < n; ++i)
+          {
+            ri = &lu_[(size_t)i * n];
+            l = (ri[j] *= inv);
+            for (c = j + 1; c < k1; ++c)
+            {
+              ri[c] -= l * rj[c];
+            }
+          }
+        }
+
+        if (k1 == n)
+        {
+          break;
+        }
+
+        //! U12 = L11^-1 A12
+        for (i = k0 + 1; i < k1; ++i)
+        {
+          ri = &lu_[(size_t)i * n];
+          for (k = k0; k < i; ++k)
+          {
+            l = ri[k];
+            rk = &lu_[(size_t)k * n];
+            for (c = k1; c < n; ++c)
+            {
+              ri[c] -= l * rk[c];
+            }
+          }
+        }
+
+        //! A22 = A22 - L21 U12
+        for (i = k1; i < n; ++i)
+        {
+          ri = &lu_[(size_t)i * n];
+          for (k = k0; k < k1; ++k)
+          {
+            l = ri[k];
+            rk = &lu_[(size_t)k * n];
+            for (c = k1; c < n; ++c)
+            {
+              ri[c] -= l * rk[c];
+            }
+          }
+        }
+      }
+
+      valid_ = true;
+      return true;
+    }
+
+    //! @brief Solve A X = B
+    //!
+    //! @param b    Row-major right-hand sides (n x nrhs)
+    //! @param nrhs Number of right-hand sides
+    //! @param x    Row-major solution (n x nrhs); may be the same array as b
+    //!
+    //! @return True if successful, false if no matrix has been factored
+    //!
+    bool solve (const double *b, int nrhs, double *x) const
+    {
+      int i, k, c, n = n_;
+      double l;
+      double *ri;
+      const double *rk;
+
+      if (!valid_ || nrhs < 1)
+      {
+        return false;
+      }
+
+      std::vector<double> y((size_t)n * nrhs);
+      for (i = 0; i < n; ++i)
+      {
+        std::copy(b + ((size_t)perm_[i] * nrhs), b + ((size_t)perm_[i] * nrhs) + nrhs, &y[(size_t)i * nrhs]);
+      }
+
+      //! L y = P b
+      for (i = 1; i < n; ++i)
+      {
+        ri = &y[(size_t)i * nrhs];
+        for (k = 0; k < i; ++k)
+        {
+          l = lu_[((size_t)i * n) + k];
+          rk = &y[(size_t)k * nrhs];
+          for (c = 0; c < nrhs; ++c)
+          {
+            ri[c] -= l * rk[c];
+          }
+        }
+      }
+
+      //! U x = y
+      for (i = n - 1; i >= 0; --i)
+      {
+        ri = &y[(size_t)i * nrhs];
+        for (k = i + 1; k < n; ++k)
+        {
+          l = lu_[((size_t)i * n) + k];
+          rk = &y[(size_t)k * nrhs];
+          for (c = 0; c < nrhs; ++c)
+          {
+            ri[c] -= l * rk[c];
+          }
+        }
+        l = 1.0 / lu_[((size_t)i * n) + i];
+        for (c = 0; c < nrhs; ++c)
+        {
+          ri[c] *= l;
+        }
+      }
+
+      std::copy(y.begin(), y.end(), x);
+      return true;
+    }
+
+    //! @brief Determinant of the factored matrix
+    //!
+    double determinant () const
+    {
+      double det = valid_ ? (double)sign_ : 0.0;
+      for (int i = 0; valid_ && i < n_; ++i)
+      {
+        det *= lu_[((size_t)i * n_) + i];
+      }
+      return det;
+    }
+
+    //! @brief Whether the last factorization succeeded
+    //!
+    bool valid () const
+    {
+      return valid_;
+    }
+
+  private:
+    //! @brief Combined unit lower (L) and upper (U) factors, row-major
+    //!
+    std::vector<double> lu_;
+
+    //! @brief Row permutation:  row i of P A is row perm_[i] of A
+    //!
+    std::vector<int> perm_;
+
+    //! @brief Matrix size, sign of the permutation, and factorization status
+    //!
+    int n_;
+    int sign_;
+    bool valid_;
+  };
+
+
+  //! @brief Cholesky factorization (A = L L') of a symmetric positive definite matrix
+  //!
+  class CholeskyDecomp
+  {
+  public:
+    //! @brief Default constructor
+    //!
+    CholeskyDecomp () :
+      n_(0),
+      valid_(false)
+    {
+    }
+
+    //! @brief Factor a symmetric positive definite matrix
+    //!
+    //! @param a Row-major values of the matrix (only the lower triangle is read)
+    //! @param n Number of rows and columns
+    //!
+    //! @return True if the matrix is positive definite, false otherwise
+    //!
+    bool factor (const double *a, int n)
+    {
+      int i, j, k;
+      double sum;
+      const double *ri, *rj;
+
+      n_ = n;
+      valid_ = false;
+      if (n < 1)
+      {
+        return false;
+      }
+      l_.assign((size_t)n * n, 0.0);
+
+      for (i = 0; i < n; ++i)
+      {
+        ri = &l_[(size_t)i * n];
+        for (j = 0; j <= i; ++j)
+        {
+          rj = &l_[(size_t)j * n];
+          sum = a[((size_t)i * n) + j];
+          for (k = 0; k < j; ++k)
+          {
+            sum -= ri[k] * rj[k];
+          }
+          if (i == j)
+          {
+            if (!(sum > 0.0))
+            {
+              return false;
+            }
+            l_[((size_t)i * n) + i] = sqrt(sum);
+          }
+          else
+          {
+            l_[((size_t)i * n) + j] = sum / rj[j];
+          }
+        }
+      }
+
+      valid_ = true;
+      return true;
+    }
+
+    //! @brief Solve A X = B
+    //!
+    //! @param b    Row-major right-hand sides (n x nrhs)
+    //! @param nrhs Number of right-hand sides
+    //! @param x    Row-major solution (n x nrhs); may be the same array as b
+    //!
+    //! @return True if successful, false if no matrix has been factored
+    //!
+    bool solve (const double *b, int nrhs, double *x) const
+    {
+      int i, k, c, n = n_;
+      double l;
+      double *ri, *rk;
+
+      if (!valid_ || nrhs < 1)
+      {
+        return false;
+      }
+
+      std::vector<double> y(b, b + ((size_t)n * nrhs));
+
+      //! L y = b
+      for (i = 0; i < n; ++i)
+      {
+        ri = &y[(size_t)i * nrhs];
+        for (k = 0; k < i; ++k)
+        {
+          l = l_[((size_t)i * n) + k];
+          rk = &y[(size_t)k * nrhs];
+          for (c = 0; c < nrhs; ++c)
+          {
+            ri[c] -= l * rk[c];
+          }
+        }
+        l = 1.0 / l_[((size_t)i * n) + i];
+        for (c = 0; c < nrhs; ++c)
+        {
+          ri[c] *= l;
+        }
+      }
+
+      //! L' x = y, finishing one row of x at a time and removing it from the rows above
+      for (i = n - 1; i >= 0; --i)
+      {
+        ri = &y[(size_t)i * nrhs];
+        l = 1.0 / l_[((size_t)i * n) + i];
+        for (c = 0; c < nrhs; ++c)
+        {
+          ri[c] *= l;
+        }
+        for (k = 0; k < i; ++k)
+        {
+          l = l_[((size_t)i * n) + k];
+          rk = &y[(size_t)k * nrhs];
+          for (c = 0; c < nrhs; ++c)
+          {
+            rk[c] -= l * ri[c];
+          }
+        }
+      }
+
+      std::copy(y.begin(), y.end(), x);
+      return true;
+    }
+
+    //! @brief Whether the last factorization succeeded
+    //!
+    bool valid () const
+    {
+      return valid_;
+    }
+
+  private:
+    //! @brief Lower triangular factor, row-major
+    //!
+    std::vector<double> l_;
+
+    //! @brief Matrix size and factorization status
+    //!
+    int n_;
+    bool valid_;
+  };
+
+
+  //! @brief Householder QR factorization (A = Q R) of a matrix with at least as many rows as
+  //!        columns, for least squares problems
+  //!
+  class QRDecomp
+  {
+  public:
+    //! @brief Default constructor
+    //!
+    QRDecomp () :
+      m_(0),
+      n_(0),
+      rank_(0),
+      valid_(false)
+    {
+    }
+
+    //! @brief Factor a matrix
+    //!
+    //! @param a Row-major values of the matrix
+    //! @param m Number of rows
+    //! @param n Number of columns (no more than m)
+    //!
+    //! @return True if the factorization completed, false if the dimensions are invalid
+    //!
+    bool factor (const double *a, int m, int n)
+    {
+      int i, j, k;
+      double alpha, beta, norm, scale, big = 0.0;
+      double *ri;
+
+      m_ = m;
+      n_ = n;
+      rank_ = 0;
+      valid_ = false;
+      if (m < 1 || n < 1 || m < n)
+      {
+        return false;
+      }
+
+      qr_.assign(a, a + ((size_t)m * n));
+      tau_.assign(n, 0.0);
+      std::vector<double> w(n);
+
+      for (k = 0; k < n; ++k)
+      {
+        //! Reflector zeroing column k below the diagonal
+        alpha = qr_[((size_t)k * n) + k];
+        norm = 0.0;
+        for (i = k; i < m; ++i)
+        {
+          norm += qr_[((size_t)i * n) + k] * qr_[((size_t)i * n) + k];
+        }
+        norm = sqrt(norm);
+        if (norm == 0.0)
+        {
+          continue;
+        }
+        beta = (alpha > 0.0) ? -norm : norm;
+        scale = 1.0 / (alpha - beta);
+        for (i = k + 1; i < m; ++i)
+        {
+          qr_[((size_t)i * n) + k] *= scale;
+        }
+        tau_[k] = (beta - alpha) / beta;
+        qr_[((size_t)k * n) + k] = beta;
+
+        //! Apply to the remaining columns:  w = v' A, A = A - tau v w
+        std::fill(w.begin() + k + 1, w.end(), 0.0);
+        for (i = k; i < m; ++i)
+        {
+          ri = &qr_[(size_t)i * n];
+          double v = (i == k) ? 1.0 : ri[k];
+          for (j = k + 1; j < n; ++j)
+          {
+            w[j] += v * ri[j];
+          }
+        }
+        for (i = k; i < m; ++i)
+        {
+          ri = &qr_[(size_t)i * n];
+          double v = tau_[k] * ((i == k) ? 1.0 : ri[k]);
+          for (j = k + 1; j < n; ++j)
+          {
+            ri[j] -= v * w[j];
+          }
+        }
+      }
+
+      //! Numerical rank from the diagonal of R
+      for (k = 0; k < n; ++k)
+      {
+        big = std::max(big, fabs(qr_[((size_t)k * n) + k]));
+      }
+      for (k = 0; k < n; ++k)
+      {
+        if (fabs(qr_[((size_t)k * n) + k]) > (m * DBL_EPSILON * big))
+        {
+          ++rank_;
+        }
+      }
+
+      valid_ = true;
+      return true;
+    }
+
+    //! @brief Least squares solution of A X = B (minimizes |A X - B|)
+    //!
+    //! @param b    Row-major right-hand sides (m x nrhs)
+    //! @param nrhs Number of right-hand sides
+    //! @param x    Row-major solution (n x nrhs)
+    //!
+    //! @return True if successful, false if no matrix has been factored or it is not of full
+    //!         column rank (use SVDDecomp for rank-deficient problems)
+    //!
+    bool solve (const double *b, int nrhs, double *x) const
+    {
+      int i, k, c, m = m_, n = n_;
+      double v, l;
+      double *ri, *rk;
+
+      if (!fullRank() || nrhs < 1)
+      {
+        return false;
+      }
+
+      std::vector<double> y(b, b + ((size_t)m * nrhs)), w(nrhs);
+
+      //! y = Q' b
+      for (k = 0; k < n; ++k)
+      {
+        if (tau_[k] == 0.0)
+        {
+          continue;
+        }
+        std::fill(w.begin(), w.end(), 0.0);
+        for (i = k; i < m; ++i)
+        {
+          v = (i == k) ? 1.0 : qr_[((size_t)i * n) + k];
+          ri = &y[(size_t)i * nrhs];
+          for (c = 0; c < nrhs; ++c)
+          {
+            w[c] += v * ri[c];
+          }
+        }
+        for (i = k; i < m; ++i)
+        {
+          v = tau_[k] * ((i == k) ? 1.0 : qr_[((size_t)i * n) + k]);
+          ri = &y[(size_t)i * nrhs];
+          for (c = 0; c < nrhs; ++c)
+          {
+            ri[c] -= v * w[c];
+          }
+        }
+      }
+
+      //! R x = y (first n rows)
+      for (i = n - 1; i >= 0; --i)
+      {
+        ri = &y[(size_t)i * nrhs];
+        for (k = i + 1; k < n; ++k)
+        {
+          l = qr_[((size_t)i * n) + k];
+          rk = &y[(size_t)k * nrhs];
+          for (c = 0; c < nrhs; ++c)
+          {
+            ri[c] -= l * rk[c];
+          }
+        }
+        l = 1.0 / qr_[((size_t)i * n) + i];
+        for (c = 0; c < nrhs; ++c)
+        {
+          ri[c] *= l;
+        }
+      }
+
+      std::copy(y.begin(), y.begin() + ((size_t)n * nrhs), x);
+      return true;
+    }
+
+    //! @brief Pseudo inverse (R^-1 Q1', where Q1 is the first n columns of Q)
+    //!
+    //! @param out Row-major pseudo inverse (n x m)
+    //!
+    //! @return True if successful, false if no matrix has been factored or it is not of full
+    //!         column rank
+    //!
+    bool pseudoInverse (double *out) const
+    {
+      int i, j, k, m = m_, n = n_;
+      double v, l;
+      double *ri;
+      const double *rk;
+
+      if (!fullRank())
+      {
+        return false;
+      }
+
+      //! Q1 = H0 H1 ... Hn-1 [I; 0]
+      std::vector<double> y((size_t)m * n, 0.0), w(n);
+      for (i = 0; i < n; ++i)
+      {
+        y[((size_t)i * n) + i] = 1.0;
+      }
+      for (k = n - 1; k >= 0; --k)
+      {
+        if (tau_[k] == 0.0)
+        {
+          continue;
+        }
+        std::fill(w.begin(), w.end(), 0.0);
+        for (i = k; i < m; ++i)
+        {
+          v = (i == k) ? 1.0 : qr_[((size_t)i * n) + k];
+          ri = &y[(size_t)i * n];
+          for (j = 0; j < n; ++j)
+          {
+            w[j] += v * ri[j];
+          }
+        }
+        for (i = k; i < m; ++i)
+        {
+          v = tau_[k] * ((i == k) ? 1.0 : qr_[((size_t)i * n) + k]);
+          ri = &y[(size_t)i * n];
+          for (j = 0; j < n; ++j)
+          {
+            ri[j] -= v * w[j];
+          }
+        }
+      }
+
+      //! out' = Q1 R'^-1:  solve R z = q for each row q of Q1, then out = Z'
+      for (i = 0; i < m; ++i)
+      {
+        ri = &y[(size_t)i * n];
+        for (j = n - 1; j >= 0; --j)
+        {
+          rk = &qr_[(size_t)j * n];
+          l = ri[j];
+          for (k = j + 1; k < n; ++k)
+          {
+            l -= rk[k] * ri[k];
+          }
+          ri[j] = l / rk[j];
+        }
+        for (j = 0; j < n; ++j)
+        {
+          out[((size_t)j * m) + i] = ri[j];
+        }
+      }
+      return true;
+    }
+
+    //! @brief Numerical rank of the factored matrix
+    //!
+    int rank () const
+    {
+      return rank_;
+    }
+
+    //! @brief Whether the factored matrix has full column rank
+    //!
+    bool fullRank () const
+    {
+      return valid_ && rank_ == n_;
+    }
+
+  private:
+    //! @brief R on and above the diagonal, Householder vectors below it (leading 1 implied)
+    //!
+    std::vector<double> qr_;
+
+    //! @brief Householder scalars
+    //!
+    std::vector<double> tau_;
+
+    //! @brief Matrix size, numerical rank, and factorization status
+    //!
+    int m_;
+    int n_;
+    int rank_;
+    bool valid_;
+  };
+
+
+  //! @brief Singular value decomposition (A = U S V') by one-sided Jacobi rotations, for
+  //!        rank-deficient and underdetermined problems
+  //!
+  class SVDDecomp
+  {
+  public:
+    //! @brief Default constructor
+    //!
+    SVDDecomp () :
+      m_(0),
+      n_(0),
+      rank_(0),
+      valid_(false)
+    {
+    }
+
+    //! @brief Factor a matrix of any shape
+    //!
+    //! @param a         Row-major values of the matrix
+    //! @param m         Number of rows
+    //! @param n         Number of columns
+    //! @param maxSweeps Largest number of rotation sweeps over all column pairs
+    //!
+    //! @return True if the rotations converged, false otherwise
+    //!
+    bool factor (const double *a, int m, int n, int maxSweeps = 60)
+    {
+      int i, j, p, q, sweep;
+      double alpha, beta, gamma, zeta, t, c, s, big, tiny = 0.0;
+      double *wp, *wq, *vp, *vq;
+      bool rotated = true;
+
+      m_ = m;
+      n_ = n;
+      rank_ = 0;
+      valid_ = false;
+      if (m < 1 || n < 1)
+      {
+        return false;
+      }
+
+      //! Columns of A (and of V) are kept as rows so that every rotation runs on contiguous data
+      ut_.resize((size_t)n * m);
+      for (i = 0; i < m; ++i)
+      {
+        for (j = 0; j < n; ++j)
+        {
+          ut_[((size_t)j * m) + i] = a[((size_t)i * n) + j];
+        }
+      }
+      for (i = 0; i < m * n; ++i)
+      {
+        tiny += a[i] * a[i];
+      }
+      tiny *= DBL_EPSILON * DBL_EPSILON;
+      vt_.assign((size_t)n * n, 0.0);
+      for (j = 0; j < n; ++j)
+      {
+        vt_[((size_t)j * n) + j] = 1.0;
+      }
+
+      for (sweep = 0; rotated && sweep < maxSweeps; ++sweep)
+      {
+        rotated = false;
+        for (p = 0; p < n - 1; ++p)
+        {
+          for (q = p + 1; q < n; ++q)
+          {
+            wp = &ut_[(size_t)p * m];
+            wq = &ut_[(size_t)q * m];
+            alpha = beta = gamma = 0.0;
+            for (i = 0; i < m; ++i)
+            {
+              alpha += wp[i] * wp[i];
+              beta += wq[i] * wq[i];
+              gamma += wp[i] * wq[i];
+            }
+            //! Orthogonal already, or one of the columns is zero to working precision (any matrix
+            //! with more columns than rows has some)
+            if (fabs(gamma) <= (DBL_EPSILON * sqrt(alpha * beta)) || alpha <= tiny || beta <= tiny)
+            {
+              continue;
+            }
+            rotated = true;
+
+            zeta = (beta - alpha) / (2.0 * gamma);
+            t = ((zeta >= 0.0) ? 1.0 : -1.0) / (fabs(zeta) + sqrt(1.0 + (zeta * zeta)));
+            c = 1.0 / sqrt(1.0 + (t * t));
+            s = c * t;
+            for (i = 0; i < m; ++i)
+            {
+              double x = wp[i];
+              wp[i] = (c * x) - (s * wq[i]);
+              wq[i] = (s * x) + (c * wq[i]);
+            }
+            vp = &vt_[(size_t)p * n];
+            vq = &vt_[(size_t)q * n];
+            for (i = 0; i < n; ++i)
+            {
+              double x = vp[i];
+              vp[i] = (c * x) - (s * vq[i]);
+              vq[i] = (s * x) + (c * vq[i]);
+            }
+          }
+        }
+      }
+
+      //! Singular values are the column norms; normalizing the columns gives U
+      s_.resize(n);
+      big = 0.0;
+      for (j = 0; j < n; ++j)
+      {
+        wp = &ut_[(size_t)j * m];
+        alpha = 0.0;
+        for (i = 0; i < m; ++i)
+        {
+          alpha += wp[i] * wp[i];
+        }
+        s_[j] = sqrt(alpha);
+        big = std::max(big, s_[j]);
+        if (s_[j] > 0.0)
+        {
+          for (i = 0; i < m; ++i)
+          {
+            wp[i] /= s_[j];
+          }
+        }
+      }
+      for (j = 0; j < n; ++j)
+      {
+        if (s_[j] > (std::max(m, n) * DBL_EPSILON * big))
+        {
+          ++rank_;
+        }
+      }
+      tolerance_ = std::max(m, n) * DBL_EPSILON * big;
+
+      valid_ = !rotated;
+      return valid_;
+    }
+
+    //! @brief Minimum norm least squares solution of A X = B, ignoring singular values below
+    //!        the numerical rank threshold
+    //!
+    //! @param b    Row-major right-hand sides (m x nrhs)
+    //! @param nrhs Number of right-hand sides
+    //! @param x    Row-major solution (n x nrhs)
+    //!
+    //! @return True if successful, false if no matrix has been factored
+    //!
+    bool solve (const double *b, int nrhs, double *x) const
+    {
+      int i, j, c, m = m_, n = n_;
+      double u;
+      const double *bi, *yj, *uj, *vj;
+      double *xi;
+
+      if (!valid_ || nrhs < 1)
+      {
+        return false;
+      }
+
+      //! y = S^-1 U' b
+      std::vector<double> y((size_t)n * nrhs, 0.0), out((size_t)n * nrhs, 0.0);
+      for (j = 0; j < n; ++j)
+      {
+        if (s_[j] <= tolerance_)
+        {
+          continue;
+        }
+        uj = &ut_[(size_t)j * m];
+        double *ry = &y[(size_t)j * nrhs];
+        for (i = 0; i < m; ++i)
+        {
+          u = uj[i] / s_[j];
+          bi = b + ((size_t)i * nrhs);
+          for (c = 0; c < nrhs; ++c)
+          {
+            ry[c] += u * bi[c];
+          }
+        }
+      }
+
+      //! x = V y
+      for (j = 0; j < n; ++j)
+      {
+        if (s_[j] <= tolerance_)
+        {
+          continue;
+        }
+        vj = &vt_[(size_t)j * n];
+        yj = &y[(size_t)j * nrhs];
+        for (i = 0; i < n; ++i)
+        {
+          xi = &out[(size_t)i * nrhs];
+          for (c = 0; c < nrhs; ++c)
+          {
+            xi[c] += vj[i] * yj[c];
+          }
+        }
+      }
+
+      std::copy(out.begin(), out.end(), x);
+      return true;
+    }
+
+    //! @brief Pseudo inverse (V S^-1 U', ignoring singular values below the rank threshold)
+    //!
+    //! @param out Row-major pseudo inverse (n x m)
+    //!
+    //! @return True if successful, false if no matrix has been factored
+    //!
+    bool pseudoInverse (double *out) const
+    {
+      int i, j, r, m = m_, n = n_;
+      double v;
+      const double *uj, *vj;
+      double *outr;
+
+      if (!valid_)
+      {
+        return false;
+      }
+
+      std::fill(out, out + ((size_t)n * m), 0.0);
+      for (j = 0; j < n; ++j)
+      {
+        if (s_[j] <= tolerance_)
+        {
+          continue;
+        }
+        uj = &ut_[(size_t)j * m];
+        vj = &vt_[(size_t)j * n];
+        for (r = 0; r < n; ++r)
+        {
+          v = vj[r] / s_[j];
+          outr = out + ((size_t)r * m);
+          for (i = 0; i < m; ++i)
+          {
+            outr[i] += v * uj[i];
+          }
+        }
+      }
+      return true;
+    }
+
+    //! @brief Singular values, in column order of the factored matrix (not sorted)
+    //!
+    const std::vector<double> &singularValues () const
+    {
+      return s_;
+    }
+
+    //! @brief Numerical rank of the factored matrix
+    //!
+    int rank () const
+    {
+      return rank_;
+    }
+
+    //! @brief Whether the last factorization succeeded
+    //!
+    bool valid () const
+    {
+      return valid_;
+    }
+
+  private:
+    //! @brief U' (n x m) and V' (n x n), row-major
+    //!
+    std::vector<double> ut_;
+    std::vector<double> vt_;
+
+    //! @brief Singular values
+    //!
+    std::vector<double> s_;
+
+    //! @brief Singular values at or below this are treated as zero
+    //!
+    double tolerance_;
+
+    //! @brief Matrix size, numerical rank, and factorization status
+    //!
+    int m_;
+    int n_;
+    int rank_;
+    bool valid_;
+  };
+
+
+  //! @brief Singular value decomposition of a 3x3 matrix (A = U S V') by one-sided Jacobi
+  //!        rotations on fixed-size arrays, with no allocation (e.g., for the cross-covariance
+  //!        of a point set registration).  Singular values are returned in decreasing order.
+  //!        When A is rank deficient, the missing columns of U are completed to an orthonormal,
+  //!        right-handed basis.
+  //!
+  //! @param a Row-major values of A
+  //! @param u Row-major 3x3 output; the columns are the left singular vectors
+  //! @param s The three singular values
+  //! @param v Row-major 3x3 output; the columns are the right singular vectors
+  //!
+  //! @return True if the rotations converged, false otherwise
+  //!
+  inline bool svd3 (const double *a, double *u, double *s, double *v)
+  {
+    double w[3][3], vt[3][3], norm[3], tiny = 0.0;
+    double alpha, beta, gamma, zeta, t, c, sn, x;
+    int i, j, p, q, sweep, order[3] = {0, 1, 2};
+    bool rotated = true;
+
+    //! Columns of A (and of V) are kept as rows
+    for (i = 0; i < 3; ++i)
+    {
+      for (j = 0; j < 3; ++j)
+      {
+        w[j][i] = a[(i * 3) + j];
+        vt[j][i] = (i == j) ? 1.0 : 0.0;
+        tiny += a[(i * 3) + j] * a[(i * 3) + j];
+      }
+    }
+    tiny *= DBL_EPSILON * DBL_EPSILON;
+
+    for (sweep = 0; rotated && sweep < 30; ++sweep)
+    {
+      rotated = false;
+      for (p = 0; p < 2; ++p)
+      {
+        for (q = p + 1; q < 3; ++q)
+        {
+          alpha = (w[p][0] * w[p][0]) + (w[p][1] * w[p][1]) + (w[p][2] * w[p][2]);
+          beta = (w[q][0] * w[q][0]) + (w[q][1] * w[q][1]) + (w[q][2] * w[q][2]);
+          gamma = (w[p][0] * w[q][0]) + (w[p][1] * w[q][1]) + (w[p][2] * w[q][2]);
+          if (fabs(gamma) <= (DBL_EPSILON * sqrt(alpha * beta)) || alpha <= tiny || beta <= tiny)
+          {
+            continue;
+          }
+          rotated = true;
+
+          zeta = (beta - alpha) / (2.0 * gamma);
+          t = ((zeta >= 0.0) ? 1.0 : -1.0) / (fabs(zeta) + sqrt(1.0 + (zeta * zeta)));
+          c = 1.0 / sqrt(1.0 + (t * t));
+          sn = c * t;
+          for (i = 0; i < 3; ++i)
+          {
+            x = w[p][i];
+            w[p][i] = (c * x) - (sn * w[q][i]);
+            w[q][i] = (sn * x) + (c * w[q][i]);
+            x = vt[p][i];
+            vt[p][i] = (c * x) - (sn * vt[q][i]);
+            vt[q][i] = (sn * x) + (c * vt[q][i]);
+          }
+        }
+      }
+    }
+
+    for (j = 0; j < 3; ++j)
+    {
+      norm[j] = sqrt((w[j][0] * w[j][0]) + (w[j][1] * w[j][1]) + (w[j][2] * w[j][2]));
+    }
+
+    //! Sort by decreasing singular value
+    for (i = 0; i < 2; ++i)
+    {
+      for (j = i + 1; j < 3; ++j)
+      {
+        if (norm[order[j]] > norm[order[i]])
+        {
+          std::swap(order[i], order[j]);
+        }
+      }
+    }
+
+    for (j = 0; j < 3; ++j)
+    {
+      p = order[j];
+      s[j] = norm[p];
+      for (i = 0; i < 3; ++i)
+      {
+        v[(i * 3) + j] = vt[p][i];
+        u[(i * 3) + j] = (norm[p] > 0.0) ? w[p][i] / norm[p] : 0.0;
+      }
+    }
+
+    //! Complete U where singular values vanish (relative to the largest)
+    {
+      double eps = 3.0 * DBL_EPSILON * s[0];
+      if (s[1] <= eps)
+      {
+        //! Any unit vector orthogonal to the first column
+        double u0[3] = {u[0], u[3], u[6]}, e[3] = {0.0, 0.0, 0.0}, m;
+        e[(fabs(u0[0]) < 0.5) ? 0 : ((fabs(u0[1]) < 0.5) ? 1 : 2)] = 1.0;
+        if (s[0] <= 0.0)
+        {
+          u0[0] = 1.0;
+          u0[1] = u0[2] = 0.0;
+          u[0] = 1.0;
+          u[3] = u[6] = 0.0;
+          e[0] = 0.0;
+          e[1] = 1.0;
+        }
+        x = (e[0] * u0[0]) + (e[1] * u0[1]) + (e[2] * u0[2]);
+        for (i = 0; i < 3; ++i)
+        {
+          e[i] -= x * u0[i];
+        }
+        m = sqrt((e[0] * e[0]) + (e[1] * e[1]) + (e[2] * e[2]));
+        for (i = 0; i < 3; ++i)
+        {
+          u[(i * 3) + 1] = e[i] / m;
+        }
+      }
+      if (s[2] <= eps)
+      {
+        u[2] = (u[3] * u[7]) - (u[6] * u[4]);
+        u[5] = (u[6] * u[1]) - (u[0] * u[7]);
+        u[8] = (u[0] * u[4]) - (u[3] * u[1]);
+      }
+    }
+
+    return !rotated;
+  }
+} // namespace Math
+
+#endif
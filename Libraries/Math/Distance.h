@@ -0,0 +1,670 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Math
+//  Workfile:        Distance.h
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Distance kernels (L1, L2, squared L2, cosine) between contiguous arrays of
+//  doubles (or floats), one pair at a time or one-to-many and many-to-many.
+//  On x86 the AVX2 kernels are chosen at run time when the processor supports
+//  them (SSE2 otherwise); on ARM64 the NEON kernels are always used.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MATH_DISTANCE_H
+#define MATH_DISTANCE_H
+
+#include <cstddef>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#define DISTANCE_X86
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define DISTANCE_NEON
+#endif
+
+//! GCC and Clang only emit AVX2 instructions in functions that are marked for them
+#if defined(DISTANCE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define DISTANCE_AVX2_TARGET __attribute__((target("avx2,fma")))
+#else
+#define DISTANCE_AVX2_TARGET
+#endif
+
+namespace Math
+{
+  //! @brief Distance measures provided by the kernels
+  //!
+  //! DISTANCE_L1:         Sum of absolute differences
+  //! DISTANCE_L2:         Euclidean distance
+  //! DISTANCE_L2_SQUARED: Squared Euclidean distance (same nearest neighbor, no square root)
+  //! DISTANCE_COSINE:     1 - cos(angle between the vectors); 1 if either vector is zero
+  //!
+  typedef enum
+  {
+    DISTANCE_L1 = 0,
+    DISTANCE_L2,
+    DISTANCE_L2_SQUARED,
+    DISTANCE_COSINE
+  } distanceMetric;
+
+  //! @brief Arrays shorter than this are measured with inline scalar code; the dispatched
+  //!        kernels only pay off on longer ones
+  //!
+  static const size_t distanceSimdMin = 16;
+
+  //! @brief Dot product and squared norms, the terms of the cosine distance
+  //!
+  struct distanceDot
+  {
+    double ab;
+    double aa;
+    double bb;
+  };
+
+  //! @brief One implementation of each kernel
+  //!
+  struct distanceKernels
+  {
+    double (*l1) (const double *a, const double *b, size_t n);
+    double (*l2Squared) (const double *a, const double *b, size_t n);
+    distanceDot (*dot) (const double *a, const double *b, size_t n);
+  };
+
+  //! @brief One implementation of each single precision kernel.  These accumulate in float,
+  //!        so each vector register holds twice as many terms as the double kernels.
+  //!
+  struct distanceKernelsF
+  {
+    float (*l1) (const float *a, const float *b, size_t n);
+    float (*l2Squared) (const float *a, const float *b, size_t n);
+    distanceDot (*dot) (const float *a, const float *b, size_t n);
+  };
+
+  inline double distanceL1Scalar (const double *a, const double *b, size_t n)
+  {
+    double sum = 0.0;
+    for (size_t i = 0; i < n; ++i)
+    {
+      sum += fabs(a[i] - b[i]);
+    }
+    return sum;
+  }
+
+  inline double distanceL2SquaredScalar (const double *a, const double *b, size_t n)
+  {
+    double sum = 0.0;
+    for (size_t i = 0; i < n; ++i)
+    {
+      double d = a[i] - b[i];
+      sum += d * d;
+    }
+    return sum;
+  }
+
+  inline distanceDot distanceDotScalar (const double *a, const double *b, size_t n)
+  {
+    distanceDot out = { 0.0, 0.0, 0.0 };
+    for (size_t i = 0; i < n; ++i)
+    {
+      out.ab += a[i] * b[i];
+      out.aa += a[i] * a[i];
+      out.bb += b[i] * b[i];
+    }
+    return out;
+  }
+
+  inline float distanceL1Scalar (const float *a, const float *b, size_t n)
+  {
+    float sum = 0.0f;
+    for (size_t i = 0; i < n; ++i)
+    {
+      float d = a[i] - b[i];
+      sum += (d < 0.0f) ? -d : d;
+    }
+    return sum;
+  }
+
+  inline float distanceL2SquaredScalar (const float *a, const float *b, size_t n)
+  {
+    float sum = 0.0f;
+    for (size_t i = 0; i < n; ++i)
+    {
+      float d = a[i] - b[i];
+      sum += d * d;
+    }
+    return sum;
+  }
+
+  inline distanceDot distanceDotScalar (const float *a, const float *b, size_t n)
+  {
+    float ab = 0.0f, aa = 0.0f, bb = 0.0f;
+    for (size_t i = 0; i < n; ++i)
+    {
+      ab += a[i] * b[i];
+      aa += a[i] * a[i];
+      bb += b[i] * b[i];
+    }
+    distanceDot out = { ab, aa, bb };
+    return out;
+  }
+
+#if defined(DISTANCE_X86)
+  inline double distanceSum2 (__m128d v)
+  {
+    return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+  }
+
+  inline double distanceL1Sse2 (const double *a, const double *b, size_t n)
+  {
+    const __m128d mask = _mm_castsi128_pd(_mm_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+      s0 = _mm_add_pd(s0, _mm_and_pd(mask, _mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i))));
+      s1 = _mm_add_pd(s1, _mm_and_pd(mask, _mm_sub_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2))));
+    }
+    return distanceSum2(_mm_add_pd(s0, s1)) + distanceL1Scalar(a + i, b + i, n - i);
+  }
+
+  inline double distanceL2SquaredSse2 (const double *a, const double *b, size_t n)
+  {
+    __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+      __m128d d0 = _mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)),
+              d1 = _mm_sub_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2));
+      s0 = _mm_add_pd(s0, _mm_mul_pd(d0, d0));
+      s1 = _mm_add_pd(s1, _mm_mul_pd(d1, d1));
+    }
+    return distanceSum2(_mm_add_pd(s0, s1)) + distanceL2SquaredScalar(a + i, b + i, n - i);
+  }
+
+  inline distanceDot distanceDotSse2 (const double *a, const double *b, size_t n)
+  {
+    __m128d ab = _mm_setzero_pd(), aa = _mm_setzero_pd(), bb = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+    {
+      __m128d va = _mm_loadu_pd(a + i), vb = _mm_loadu_pd(b + i);
+      ab = _mm_add_pd(ab, _mm_mul_pd(va, vb));
+      aa = _mm_add_pd(aa, _mm_mul_pd(va, va));
+      bb = _mm_add_pd(bb, _mm_mul_pd(vb, vb));
+    }
+    distanceDot out = distanceDotScalar(a + i, b + i, n - i);
+    out.ab += distanceSum2(ab);
+    out.aa += distanceSum2(aa);
+    out.bb += distanceSum2(bb);
+    return out;
+  }
+
+  DISTANCE_AVX2_TARGET inline double distanceSum4 (__m256d v)
+  {
+    __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+  }
+
+  DISTANCE_AVX2_TARGET inline double distanceL1Avx2 (const double *a, const double *b, size_t n)
+  {
+    const __m256d mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+      s0 = _mm256_add_pd(s0, _mm256_and_pd(mask, _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i))));
+      s1 = _mm256_add_pd(s1, _mm256_and_pd(mask, _mm256_sub_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4))));
+    }
+    if (i + 4 <= n)
+    {
+      s0 = _mm256_add_pd(s0, _mm256_and_pd(mask, _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i))));
+      i += 4;
+    }
+    return distanceSum4(_mm256_add_pd(s0, s1)) + distanceL1Scalar(a + i, b + i, n - i);
+  }
+
+  DISTANCE_AVX2_TARGET inline double distanceL2SquaredAvx2 (const double *a, const double *b, size_t n)
+  {
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+      __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)),
+              d1 = _mm256_sub_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4));
+      s0 = _mm256_fmadd_pd(d0, d0, s0);
+      s1 = _mm256_fmadd_pd(d1, d1, s1);
+    }
+    if (i + 4 <= n)
+    {
+      __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i));
+      s0 = _mm256_fmadd_pd(d0, d0, s0);
+      i += 4;
+    }
+    return distanceSum4(_mm256_add_pd(s0, s1)) + distanceL2SquaredScalar(a + i, b + i, n - i);
+  }
+
+  DISTANCE_AVX2_TARGET inline distanceDot distanceDotAvx2 (const double *a, const double *b, size_t n)
+  {
+    __m256d ab = _mm256_setzero_pd(), aa = _mm256_setzero_pd(), bb = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+      __m256d va = _mm256_loadu_pd(a + i), vb = _mm256_loadu_pd(b + i);
+      ab = _mm256_fmadd_pd(va, vb, ab);
+      aa = _mm256_fmadd_pd(va, va, aa);
+      bb = _mm256_fmadd_pd(vb, vb, bb);
+    }
+    distanceDot out = distanceDotScalar(a + i, b + i, n - i);
+    out.ab += distanceSum4(ab);
+    out.aa += distanceSum4(aa);
+    out.bb += distanceSum4(bb);
+    return out;
+  }
+
+  inline float distanceSum4 (__m128 v)
+  {
+    __m128 s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+  }
+
+  inline float distanceL1Sse2 (const float *a, const float *b, size_t n)
+  {
+    const __m128 mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+      s0 = _mm_add_ps(s0, _mm_and_ps(mask, _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i))));
+      s1 = _mm_add_ps(s1, _mm_and_ps(mask, _mm_sub_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4))));
+    }
+    return distanceSum4(_mm_add_ps(s0, s1)) + distanceL1Scalar(a + i, b + i, n - i);
+  }
+
+  inline float distanceL2SquaredSse2 (const float *a, const float *b, size_t n)
+  {
+    __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+      __m128 d0 = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)),
+             d1 = _mm_sub_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4));
+      s0 = _mm_add_ps(s0, _mm_mul_ps(d0, d0));
+      s1 = _mm_add_ps(s1, _mm_mul_ps(d1, d1));
+    }
+    return distanceSum4(_mm_add_ps(s0, s1)) + distanceL2SquaredScalar(a + i, b + i, n - i);
+  }
+
+  inline distanceDot distanceDotSse2 (const float *a, const float *b, size_t n)
+  {
+    __m128 ab = _mm_setzero_ps(), aa = _mm_setzero_ps(), bb = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+      __m128 va = _mm_loadu_ps(a + i), vb = _mm_loadu_ps(b + i);
+      ab = _mm_add_ps(ab, _mm_mul_ps(va, vb));
+      aa = _mm_add_ps(aa, _mm_mul_ps(va, va));
+      bb = _mm_add_ps(bb, _mm_mul_ps(vb, vb));
+    }
+    distanceDot out = distanceDotScalar(a + i, b + i, n - i);
+    out.ab += distanceSum4(ab);
+    out.aa += distanceSum4(aa);
+    out.bb += distanceSum4(bb);
+    return out;
+  }
+
+  DISTANCE_AVX2_TARGET inline float distanceSum8 (__m256 v)
+  {
+    return distanceSum4(_mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+  }
+
+  DISTANCE_AVX2_TARGET inline float distanceL1Avx2 (const float *a, const float *b, size_t n)
+  {
+    const __m256 mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+      s0 = _mm256_add_ps(s0, _mm256_and_ps(mask, _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i))));
+      s1 = _mm256_add_ps(s1, _mm256_and_ps(mask, _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8))));
+    }
+    if (i + 8 <= n)
+    {
+      s0 = _mm256_add_ps(s0, _mm256_and_ps(mask, _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i))));
+      i += 8;
+    }
+    return distanceSum8(_mm256_add_ps(s0, s1)) + distanceL1Scalar(a + i, b + i, n - i);
+  }
+
+  DISTANCE_AVX2_TARGET inline float distanceL2SquaredAvx2 (const float *a, const float *b, size_t n)
+  {
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+      __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)),
+             d1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+      s0 = _mm256_fmadd_ps(d0, d0, s0);
+      s1 = _mm256_fmadd_ps(d1, d1, s1);
+    }
+    if (i + 8 <= n)
+    {
+      __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+      s0 = _mm256_fmadd_ps(d0, d0, s0);
+      i += 8;
+    }
+    return distanceSum8(_mm256_add_ps(s0, s1)) + distanceL2SquaredScalar(a + i, b + i, n - i);
+  }
+
+  DISTANCE_AVX2_TARGET inline distanceDot distanceDotAvx2 (const float *a, const float *b, size_t n)
+  {
+    __m256 ab = _mm256_setzero_ps(), aa = _mm256_setzero_ps(), bb = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+      __m256 va = _mm256_loadu_ps(a + i), vb = _mm256_loadu_ps(b + i);
+      ab = _mm256_fmadd_ps(va, vb, ab);
+      aa = _mm256_fmadd_ps(va, va, aa);
+      bb = _mm256_fmadd_ps(vb, vb, bb);
+    }
+    distanceDot out = distanceDotScalar(a + i, b + i, n - i);
+    out.ab += distanceSum8(ab);
+    out.aa += distanceSum8(aa);
+    out.bb += distanceSum8(bb);
+    return out;
+  }
+
+  //! @brief Whether the processor and operating system support AVX2 and FMA
+  //!
+  inline bool distanceHasAvx2 ()
+  {
+#if defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 0);
+    if (regs[0] < 7)
+    {
+      return false;
+    }
+    __cpuid(regs, 1);
+    bool fma = (regs[2] & (1 << 12)) != 0, osxsave = (regs[2] & (1 << 27)) != 0;
+    if (!fma || !osxsave || (_xgetbv(0) & 6) != 6)
+    {
+      return false;
+    }
+    __cpuidex(regs, 7, 0);
+    return (regs[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+  }
+#endif
+
+#if defined(DISTANCE_NEON)
+  inline double distanceL1Neon (const double *a, const double *b, size_t n)
+  {
+    float64x2_t s0 = vdupq_n_f64(0.0), s1 = vdupq_n_f64(0.0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+      s0 = vaddq_f64(s0, vabdq_f64(vld1q_f64(a + i), vld1q_f64(b + i)));
+      s1 = vaddq_f64(s1, vabdq_f64(vld1q_f64(a + i + 2), vld1q_f64(b + i + 2)));
+    }
+    return vaddvq_f64(vaddq_f64(s0, s1)) + distanceL1Scalar(a + i, b + i, n - i);
+  }
+
+  inline double distanceL2SquaredNeon (const double *a, const double *b, size_t n)
+  {
+    float64x2_t s0 = vdupq_n_f64(0.0), s1 = vdupq_n_f64(0.0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+      float64x2_t d0 = vsubq_f64(vld1q_f64(a + i), vld1q_f64(b + i)),
+                  d1 = vsubq_f64(vld1q_f64(a + i + 2), vld1q_f64(b + i + 2));
+      s0 = vfmaq_f64(s0, d0, d0);
+      s1 = vfmaq_f64(s1, d1, d1);
+    }
+    return vaddvq_f64(vaddq_f64(s0, s1)) + distanceL2SquaredScalar(a + i, b + i, n - i);
+  }
+
+  inline distanceDot distanceDotNeon (const double *a, const double *b, size_t n)
+  {
+    float64x2_t ab = vdupq_n_f64(0.0), aa = vdupq_n_f64(0.0), bb = vdupq_n_f64(0.0);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+    {
+      float64x2_t va = vld1q_f64(a + i), vb = vld1q_f64(b + i);
+      ab = vfmaq_f64(ab, va, vb);
+      aa = vfmaq_f64(aa, va, va);
+      bb = vfmaq_f64(bb, vb, vb);
+    }
+    distanceDot out = distanceDotScalar(a + i, b + i, n - i);
+    out.ab += vaddvq_f64(ab);
+    out.aa += vaddvq_f64(aa);
+    out.bb += vaddvq_f64(bb);
+    return out;
+  }
+
+  inline float distanceL1Neon (const float *a, const float *b, size_t n)
+  {
+    float32x4_t s0 = vdupq_n_f32(0.0f), s1 = vdupq_n_f32(0.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+      s0 = vaddq_f32(s0, vabdq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+      s1 = vaddq_f32(s1, vabdq_f32(vld1q_f32(a + i + 4), vld1q_f32(b + i + 4)));
+    }
+    return vaddvq_f32(vaddq_f32(s0, s1)) + distanceL1Scalar(a + i, b + i, n - i);
+  }
+
+  inline float distanceL2SquaredNeon (const float *a, const float *b, size_t n)
+  {
+    float32x4_t s0 = vdupq_n_f32(0.0f), s1 = vdupq_n_f32(0.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+      float32x4_t d0 = vsubq_f32(vld1q_f32(a + i), vld1q_f32(b + i)),
+                  d1 = vsubq_f32(vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+      s0 = vfmaq_f32(s0, d0, d0);
+      s1 = vfmaq_f32(s1, d1, d1);
+    }
+    return vaddvq_f32(vaddq_f32(s0, s1)) + distanceL2SquaredScalar(a + i, b + i, n - i);
+  }
+
+  inline distanceDot distanceDotNeon (const float *a, const float *b, size_t n)
+  {
+    float32x4_t ab = vdupq_n_f32(0.0f), aa = vdupq_n_f32(0.0f), bb = vdupq_n_f32(0.0f);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+      float32x4_t va = vld1q_f32(a + i), vb = vld1q_f32(b + i);
+      ab = vfmaq_f32(ab, va, vb);
+      aa = vfmaq_f32(aa, va, va);
+      bb = vfmaq_f32(bb, vb, vb);
+    }
+    distanceDot out = distanceDotScalar(a + i, b + i, n - i);
+    out.ab += vaddvq_f32(ab);
+    out.aa += vaddvq_f32(aa);
+    out.bb += vaddvq_f32(bb);
+    return out;
+  }
+#endif
+
+  //! @brief The kernels for this processor, chosen on first use
+  //!
+  inline const distanceKernels &distanceDispatch ()
+  {
+#if defined(DISTANCE_X86)
+    static const distanceKernels sse2 = { distanceL1Sse2, distanceL2SquaredSse2, distanceDotSse2 };
+    static const distanceKernels avx2 = { distanceL1Avx2, distanceL2SquaredAvx2, distanceDotAvx2 };
+    static const distanceKernels &best = distanceHasAvx2() ? avx2 : sse2;
+#elif defined(DISTANCE_NEON)
+    static const distanceKernels best = { distanceL1Neon, distanceL2SquaredNeon, distanceDotNeon };
+#else
+    static const distanceKernels best = { distanceL1Scalar, distanceL2SquaredScalar, distanceDotScalar };
+#endif
+    return best;
+  }
+
+  //! @brief The single precision kernels for this processor, chosen on first use
+  //!
+  inline const distanceKernelsF &distanceDispatchF ()
+  {
+#if defined(DISTANCE_X86)
+    static const distanceKernelsF sse2 = { distanceL1Sse2, distanceL2SquaredSse2, distanceDotSse2 };
+    static const distanceKernelsF avx2 = { distanceL1Avx2, distanceL2SquaredAvx2, distanceDotAvx2 };
+    static const distanceKernelsF &best = distanceHasAvx2() ? avx2 : sse2;
+#elif defined(DISTANCE_NEON)
+    static const distanceKernelsF best = { distanceL1Neon, distanceL2SquaredNeon, distanceDotNeon };
+#else
+    static const distanceKernelsF best = { distanceL1Scalar, distanceL2SquaredScalar, distanceDotScalar };
+#endif
+    return best;
+  }
+
+  //! @brief Sum of absolute differences of two arrays
+  //!
+  inline double distanceL1 (const double *a, const double *b, size_t n)
+  {
+    return (n < distanceSimdMin) ? distanceL1Scalar(a, b, n) : distanceDispatch().l1(a, b, n);
+  }
+
+  //! @brief Squared Euclidean distance between two arrays
+  //!
+  inline double distanceL2Squared (const double *a, const double *b, size_t n)
+  {
+    return (n < distanceSimdMin) ? distanceL2SquaredScalar(a, b, n) :
+                                   distanceDispatch().l2Squared(a, b, n);
+  }
+
+  //! @brief Euclidean distance between two arrays
+  //!
+  inline double distanceL2 (const double *a, const double *b, size_t n)
+  {
+    return sqrt(distanceL2Squared(a, b, n));
+  }
+
+  //! @brief Cosine distance (1 - cosine similarity) between two arrays
+  //!
+  inline double distanceCosine (const double *a, const double *b, size_t n)
+  {
+    distanceDot d = (n < distanceSimdMin) ? distanceDotScalar(a, b, n) : distanceDispatch().dot(a, b, n);
+    double norms = d.aa * d.bb;
+    return (norms > 0.0) ? 1.0 - (d.ab / sqrt(norms)) : 1.0;
+  }
+
+  //! @brief Single precision versions of the above
+  //!
+  inline float distanceL1 (const float *a, const float *b, size_t n)
+  {
+    return (n < distanceSimdMin) ? distanceL1Scalar(a, b, n) : distanceDispatchF().l1(a, b, n);
+  }
+
+  inline float distanceL2Squared (const float *a, const float *b, size_t n)
+  {
+    return (n < distanceSimdMin) ? distanceL2SquaredScalar(a, b, n) :
+                                   distanceDispatchF().l2Squared(a, b, n);
+  }
+
+  inline float distanceL2 (const float *a, const float *b, size_t n)
+  {
+    return std::sqrt(distanceL2Squared(a, b, n));
+  }
+
+  inline float distanceCosine (const float *a, const float *b, size_t n)
+  {
+    distanceDot d = (n < distanceSimdMin) ? distanceDotScalar(a, b, n) : distanceDispatchF().dot(a, b, n);
+    double norms = d.aa * d.bb;
+    return (float)((norms > 0.0) ? 1.0 - (d.ab / sqrt(norms)) : 1.0);
+  }
+
+  //! @brief Distance between two arrays in the chosen metric (T is double or float)
+  //!
+  template <class T> inline T distance (distanceMetric metric, const T *a, const T *b, size_t n)
+  {
+    switch (metric)
+    {
+    case DISTANCE_L1:
+      return distanceL1(a, b, n);
+    case DISTANCE_L2:
+      return distanceL2(a, b, n);
+    case DISTANCE_L2_SQUARED:
+      return distanceL2Squared(a, b, n);
+    default:
+      return distanceCosine(a, b, n);
+    }
+  }
+
+  //! @brief Distances from one array to each of a set of arrays
+  //!
+  //! @param metric The distance measure
+  //! @param query  The array being compared (n values)
+  //! @param points The arrays compared against, row-major (count x n)
+  //! @param count  The number of arrays in points
+  //! @param n      The length of every array
+  //! @param out    The count distances
+  //!
+  template <class T> inline void distanceOneToMany (distanceMetric metric, const T *query,
+                                                    const T *points, size_t count, size_t n,
+                                                    T *out)
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      out[i] = distance(metric, query, points + (i * n), n);
+    }
+  }
+
+  //! @brief Distances between every pair of arrays from two sets
+  //!
+  //! @param metric The distance measure
+  //! @param a      The first set, row-major (na x n)
+  //! @param na     The number of arrays in a
+  //! @param b      The second set, row-major (nb x n)
+  //! @param nb     The number of arrays in b
+  //! @param n      The length of every array
+  //! @param out    Row-major (na x nb); out[i * nb + j] is the distance from a[i] to b[j]
+  //!
+  template <class T> inline void distanceManyToMany (distanceMetric metric, const T *a, size_t na,
+                                                     const T *b, size_t nb, size_t n, T *out)
+  {
+    for (size_t i = 0; i < na; ++i)
+    {
+      distanceOneToMany(metric, a + (i * n), b, nb, n, out + (i * nb));
+    }
+  }
+
+  //! @brief Index of the array in a set nearest to a query array (squared L2), or -1 if the set
+  //!        is empty
+  //!
+  //! @param dist Set to the squared distance of the nearest array, if not NULL
+  //!
+  template <class T> inline int distanceNearest (const T *query, const T *points, size_t count,
+                                                 size_t n, T *dist = NULL)
+  {
+    int best = -1;
+    T bestDist = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+      T d = distanceL2Squared(query, points + (i * n), n);
+      if (best < 0 || d < bestDist)
+      {
+        best = (int)i;
+        bestDist = d;
+      }
+    }
+    if (dist != NULL)
+    {
+      *dist = bestDist;
+    }
+    return best;
+  }
+} // namespace Math
+
+#endif
@@ -98,6 +98,172 @@ namespace Math
 
 
 
+  ///////////////////////////////////////////////////////////////////////////////
+  //!                 Batched Structure-of-Arrays Scalar Kalman               !//
+  ///////////////////////////////////////////////////////////////////////////////
+
+  //! @brief Alignment (bytes) and length (doubles) of the widest SIMD register used
+  //!
+  static const size_t batchAlign = 32;
+  static const int batchWidth = 4;
+
+  LIBRARY_API BatchKalman::BatchKalman(int channels)
+  {
+    channels_ = (channels < 0) ? 0 : channels;
+    padded_ = ((channels_ + batchWidth - 1) / batchWidth) * batchWidth;
+
+    //! Four arrays, plus slack to align the first
+    storage_.assign((4 * padded_) + (batchAlign / sizeof(double)), 0.0);
+    size_t base = (size_t)storage_.data();
+    size_t offset = ((batchAlign - (base % batchAlign)) % batchAlign) / sizeof(double);
+    estimate_ = storage_.data() + offset;
+    covariance_ = estimate_ + padded_;
+    noise_ = covariance_ + padded_;
+    procNoise_ = noise_ + padded_;
+
+    setNoise(0.1);
+    setProcessNoise(0.0);
+    reset();
+  }
+
+
+  LIBRARY_API BatchKalman::~BatchKalman()
+  {
+  }
+
+
+  LIBRARY_API int BatchKalman::channels() const
+  {
+    return channels_;
+  }
+
+
+  LIBRARY_API void BatchKalman::setNoise(double noise)
+  {
+    //! Padding lanes get valid values too, so they never produce NaNs
+    for (int i = 0; i < padded_; ++i)
+    {
+      noise_[i] = noise;
+    }
+  }
+
+
+  LIBRARY_API void BatchKalman::setNoise(const double *noise)
+  {
+    for (int i = 0; i < channels_; ++i)
+    {
+      noise_[i] = noise[i];
+    }
+  }
+
+
+  LIBRARY_API void BatchKalman::setProcessNoise(double noise)
+  {
+    for (int i = 0; i < padded_; ++i)
+    {
+      procNoise_[i] = noise;
+    }
+  }
+
+
+  LIBRARY_API void BatchKalman::updateEstimate(double *newEst, const double *curReading)
+  {
+    int i = 0;
+
+    //! Per channel:  P = P + q,  K = P / (P + r),  x = x + K (z - x),  P = (1 - K) P
+#if defined(__AVX__)
+    __m256d one = _mm256_set1_pd(1.0);
+    for (; i + 4 <= channels_; i += 4)
+    {
+      __m256d p = _mm256_add_pd(_mm256_load_pd(covariance_ + i), _mm256_load_pd(procNoise_ + i));
+      __m256d k = _mm256_div_pd(p, _mm256_add_pd(p, _mm256_load_pd(noise_ + i)));
+      __m256d x = _mm256_load_pd(estimate_ + i);
+      x = _mm256_add_pd(x, _mm256_mul_pd(k, _mm256_sub_pd(_mm256_loadu_pd(curReading + i), x)));
+      _mm256_store_pd(estimate_ + i, x);
+      _mm256_store_pd(covariance_ + i, _mm256_mul_pd(_mm256_sub_pd(one, k), p));
+      _mm256_storeu_pd(newEst + i, x);
+    }
+#elif defined(MATH_USE_SSE2)
+    __m128d one = _mm_set1_pd(1.0);
+    for (; i + 2 <= channels_; i += 2)
+    {
+      __m128d p = _mm_add_pd(_mm_load_pd(covariance_ + i), _mm_load_pd(procNoise_ + i));
+      __m128d k = _mm_div_pd(p, _mm_add_pd(p, _mm_load_pd(noise_ + i)));
+      __m128d x = _mm_load_pd(estimate_ + i);
+      x = _mm_add_pd(x, _mm_mul_pd(k, _mm_sub_pd(_mm_loadu_pd(curReading + i), x)));
+      _mm_store_pd(estimate_ + i, x);
+      _mm_store_pd(covariance_ + i, _mm_mul_pd(_mm_sub_pd(one, k), p));
+      _mm_storeu_pd(newEst + i, x);
+    }
+#elif defined(MATH_USE_NEON)
+    float64x2_t one = vdupq_n_f64(1.0);
+    for (; i + 2 <= channels_; i += 2)
+    {
+      float64x2_t p = vaddq_f64(vld1q_f64(covariance_ + i), vld1q_f64(procNoise_ + i));
+      float64x2_t k = vdivq_f64(p, vaddq_f64(p, vld1q_f64(noise_ + i)));
+      float64x2_t x = vld1q_f64(estimate_ + i);
+      x = vfmaq_f64(x, k, vsubq_f64(vld1q_f64(curReading + i), x));
+      vst1q_f64(estimate_ + i, x);
+      vst1q_f64(covariance_ + i, vmulq_f64(vsubq_f64(one, k), p));
+      vst1q_f64(newEst + i, x);
+    }
+#endif
+    for (; i < channels_; ++i)
+    {
+      double p = covariance_[i] + procNoise_[i];
+      double k = p / (p + noise_[i]);
+      estimate_[i] += k * (curReading[i] - estimate_[i]);
+      covariance_[i] = (1.0 - k) * p;
+      newEst[i] = estimate_[i];
+    }
+  }
+
+
+  LIBRARY_API bool BatchKalman::updateEstimate(vector<double> &newEst, const vector<double> &curReading)
+  {
+    if ((int)curReading.size() != channels_)
+    {
+      return false;
+    }
+    newEst.resize(channels_);
+    if (channels_ > 0)
+    {
+      updateEstimate(newEst.data(), curReading.data());
+    }
+    return true;
+  }
+
+
+  LIBRARY_API bool BatchKalman::reset()
+  {
+    for (int i = 0; i < padded_; ++i)
+    {
+      estimate_[i] = 0.0;
+      covariance_[i] = 1.0;
+    }
+    return true;
+  }
+
+
+  LIBRARY_API bool BatchKalman::reset(const vector<bool> &mask)
+  {
+    if ((int)mask.size() != channels_)
+    {
+      return false;
+    }
+    for (int i = 0; i < channels_; ++i)
+    {
+      if (mask[i])
+      {
+        estimate_[i] = 0.0;
+        covariance_[i] = 1.0;
+      }
+    }
+    return true;
+  }
+
+
+
   ///////////////////////////////////////////////////////////////////////////////
   //!                        Discrete Kalman Filter                           !//
   ///////////////////////////////////////////////////////////////////////////////
@@ -262,5 +428,634 @@ namespace Math
 
 
 
+  ///////////////////////////////////////////////////////////////////////////////
+  //!                     Multiplicative EKF Pose Tracker                     !//
+  ///////////////////////////////////////////////////////////////////////////////
+
+  //! @brief Quaternion of the rotation vector (x, y, z) * scale
+  //!
+  static quaternion rotationVectorQuaternion(double x, double y, double z, double scale)
+  {
+    x *= scale;
+    y *= scale;
+    z *= scale;
+    double angle = sqrt((x * x) + (y * y) + (z * z)), s, c;
+    if (angle < 1.0e-12)
+    {
+      quaternion q(1.0, 0.5 * x, 0.5 * y, 0.5 * z);
+      q.normalize();
+      return q;
+    }
+    sinCos(0.5 * angle, s, c);
+    s /= angle;
+    return quaternion(c, x * s, y * s, z * s);
+  }
+
+
+  //! @brief Rotation vector of a quaternion (shortest rotation)
+  //!
+  static point quaternionRotationVector(const quaternion &q)
+  {
+    double sign = (q.w < 0.0) ? -1.0 : 1.0;
+    double v = sqrt((q.x * q.x) + (q.y * q.y) + (q.z * q.z));
+    double scale = (v < 1.0e-12) ? 2.0 : (2.0 * atan2(v, sign * q.w) / v);
+    scale *= sign;
+    return point(q.x * scale, q.y * scale, q.z * scale);
+  }
+
+
+  LIBRARY_API PoseTracker::PoseTracker()
+  {
+    posNoise_ = 0.5;
+    rotNoise_ = 0.005;
+    linNoise_ = 1.0e5;
+    angNoise_ = 10.0;
+    linRate_ = 1000.0;
+    angRate_ = 3.14159265358979323846;
+    latency_ = 0.0;
+    maxGap_ = 0.5;
+    reset();
+  }
+
+
+  LIBRARY_API PoseTracker::~PoseTracker()
+  {
+  }
+
+
+  LIBRARY_API void PoseTracker::setMeasurementNoise(double position, double rotation)
+  {
+    posNoise_ = position;
+    rotNoise_ = rotation;
+  }
+
+
+  LIBRARY_API void PoseTracker::setProcessNoise(double linear, double angular)
+  {
+    linNoise_ = linear;
+    angNoise_ = angular;
+  }
+
+
+  LIBRARY_API void PoseTracker::setInitialRates(double linear, double angular)
+  {
+    linRate_ = linear;
+    angRate_ = angular;
+  }
+
+
+  LIBRARY_API void PoseTracker::setLatency(double seconds)
+  {
+    latency_ = seconds;
+  }
+
+
+  LIBRARY_API void PoseTracker::setMaxGap(double seconds)
+  {
+    maxGap_ = seconds;
+  }
+
+
+  LIBRARY_API void PoseTracker::start(const qpose &meas, double time)
+  {
+    position_ = meas.position;
+    orientation_ = meas.orientation;
+    orientation_.normalize();
+    velocity_ = point(0.0, 0.0, 0.0);
+    angVel_ = point(0.0, 0.0, 0.0);
+    time_ = time;
+    tracking_ = true;
+
+    covariance_.setAll(0.0);
+    for (int i = 0; i < 3; ++i)
+    {
+      covariance_.at(i, i) = posNoise_ * posNoise_;
+      covariance_.at(i + 3, i + 3) = linRate_ * linRate_;
+      covariance_.at(i + 6, i + 6) = rotNoise_ * rotNoise_;
+      covariance_.at(i + 9, i + 9) = angRate_ * angRate_;
+    }
+  }
+
+
+  LIBRARY_API void PoseTracker::propagate(double dt)
+  {
+    if (dt <= 0.0)
+    {
+      return;
+    }
+
+    //! Nominal state
+    quaternion dq = rotationVectorQuaternion(angVel_.x, angVel_.y, angVel_.z, dt);
+    position_ = point(position_.x + (velocity_.x * dt),
+                      position_.y + (velocity_.y * dt),
+                      position_.z + (velocity_.z * dt));
+    orientation_ = dq * orientation_;
+    orientation_.normalize();
+
+    //! Error state transition:  the orientation error is carried through the rotation over dt
+    Mat<12, 12> F = Mat<12, 12>::identity(), Q;
+    Mat<3, 3> rot;
+    quaternionToMatrix(dq, rot);
+    double dt2 = dt * dt, dt3 = dt2 * dt;
+    for (int i = 0; i < 3; ++i)
+    {
+      F.at(i, i + 3) = dt;
+      F.at(i + 6, i + 9) = dt;
+      for (int j = 0; j < 3; ++j)
+      {
+        F.at(i + 6, j + 6) = rot.at(i, j);
+      }
+
+      //! Discretized white acceleration noise
+      Q.at(i, i) = linNoise_ * dt3 / 3.0;
+      Q.at(i, i + 3) = Q.at(i + 3, i) = linNoise_ * dt2 / 2.0;
+      Q.at(i + 3, i + 3) = linNoise_ * dt;
+      Q.at(i + 6, i + 6) = angNoise_ * dt3 / 3.0;
+      Q.at(i + 6, i + 9) = Q.at(i + 9, i + 6) = angNoise_ * dt2 / 2.0;
+      Q.at(i + 9, i + 9) = angNoise_ * dt;
+    }
+    covariance_ = (F * covariance_ * F.trans()) + Q;
+  }
+
+
+  LIBRARY_API bool PoseTracker::correct(const qpose &meas, double timestamp)
+  {
+    double time = timestamp - latency_;
+
+    if (!tracking_ || (time - time_) > maxGap_)
+    {
+      start(meas, time);
+      return true;
+    }
+    if (time < time_)
+    {
+      return false;
+    }
+
+    propagate(time - time_);
+    time_ = time;
+
+    //! Residual:  position difference and the rotation taking the estimate to the measurement
+    Mat<6, 1> y;
+    point dtheta = quaternionRotationVector(meas.orientation * orientation_.conjugate());
+    y.at(0, 0) = meas.position.x - position_.x;
+    y.at(1, 0) = meas.position.y - position_.y;
+    y.at(2, 0) = meas.position.z - position_.z;
+    y.at(3, 0) = dtheta.x;
+    y.at(4, 0) = dtheta.y;
+    y.at(5, 0) = dtheta.z;
+
+    Mat<6, 12> H;
+    Mat<6, 6> R;
+    for (int i = 0; i < 3; ++i)
+    {
+      H.at(i, i) = 1.0;
+      H.at(i + 3, i + 6) = 1.0;
+      R.at(i, i) = posNoise_ * posNoise_;
+      R.at(i + 3, i + 3) = rotNoise_ * rotNoise_;
+    }
+
+    //! K = P H' S^-1, found by solving S K' = H P with S = H P H' + R
+    Mat<6, 12> HP = H * covariance_, Kt;
+    Mat<6, 6> S = (HP * H.trans()) + R;
+    if (!S.ldltSolve(HP, Kt))
+    {
+      return false;
+    }
+    Mat<12, 6> K = Kt.trans();
+    Mat<12, 1> dx = K * y;
+
+    //! Joseph form keeps the covariance symmetric and positive definite
+    Mat<12, 12> IKH = Mat<12, 12>::identity() - (K * H);
+    covariance_ = (IKH * covariance_ * IKH.trans()) + (K * R * Kt);
+
+    //! Fold the error state into the nominal state
+    position_ = point(position_.x + dx.at(0, 0), position_.y + dx.at(1, 0), position_.z + dx.at(2, 0));
+    velocity_ = point(velocity_.x + dx.at(3, 0), velocity_.y + dx.at(4, 0), velocity_.z + dx.at(5, 0));
+    orientation_ = rotationVectorQuaternion(dx.at(6, 0), dx.at(7, 0), dx.at(8, 0), 1.0) * orientation_;
+    orientation_.normalize();
+    angVel_ = point(angVel_.x + dx.at(9, 0), angVel_.y + dx.at(10, 0), angVel_.z + dx.at(11, 0));
+
+    return true;
+  }
+
+
+  LIBRARY_API bool PoseTracker::correct(const point &position, const matrix &rotation, double timestamp)
+  {
+    if (rotation.rows != 3 || rotation.cols != 3)
+    {
+      return false;
+    }
+    qpose meas;
+    meas.position = position;
+    meas.orientation = matrixToQuaternion(Mat<3, 3>(rotation));
+    return correct(meas, timestamp);
+  }
+
+
+  LIBRARY_API qpose PoseTracker::predict(double timestamp) const
+  {
+    qpose out;
+    double dt = timestamp - time_;
+    out.position = point(position_.x + (velocity_.x * dt),
+                         position_.y + (velocity_.y * dt),
+                         position_.z + (velocity_.z * dt));
+    out.orientation = rotationVectorQuaternion(angVel_.x, angVel_.y, angVel_.z, dt) * orientation_;
+    out.orientation.normalize();
+    return out;
+  }
+
+
+  LIBRARY_API pose PoseTracker::predictPose(double timestamp, bool useDegrees) const
+  {
+    return fromQPose(predict(timestamp), useDegrees);
+  }
+
+
+  LIBRARY_API point PoseTracker::velocity() const
+  {
+    return velocity_;
+  }
+
+
+  LIBRARY_API point PoseTracker::angularVelocity() const
+  {
+    return angVel_;
+  }
+
+
+  LIBRARY_API const Mat<12, 12> &PoseTracker::covariance() const
+  {
+    return covariance_;
+  }
+
+
+  LIBRARY_API bool PoseTracker::tracking() const
+  {
+    return tracking_;
+  }
+
+
+  LIBRARY_API bool PoseTracker::reset()
+  {
+    tracking_ = false;
+    time_ = 0.0;
+    position_ = point(0.0, 0.0, 0.0);
+    velocity_ = point(0.0, 0.0, 0.0);
+    orientation_ = quaternion();
+    angVel_ = point(0.0, 0.0, 0.0);
+    covariance_.setAll(0.0);
+    return true;
+  }
+
+
+
+  ///////////////////////////////////////////////////////////////////////////////
+  //!                     Multi-Rate Pose Fusion                              !//
+  ///////////////////////////////////////////////////////////////////////////////
+
+  LIBRARY_API PoseFusion::PoseFusion()
+  {
+    linNoise_ = 1.0e5;
+    angNoise_ = 10.0;
+    linRate_ = 1000.0;
+    angRate_ = 3.14159265358979323846;
+    driftInit_ = 10.0;
+    driftRate_ = 1.0;
+    history_ = 0.25;
+    maxGap_ = 0.5;
+    reset();
+  }
+
+
+  LIBRARY_API PoseFusion::~PoseFusion()
+  {
+  }
+
+
+  LIBRARY_API int PoseFusion::addSource(double position, double rotation, double latency, bool drifts)
+  {
+    fusionSource source;
+    source.posNoise = position;
+    source.rotNoise = rotation;
+    source.latency = latency;
+    source.drifts = drifts;
+    sources_.push_back(source);
+    return (int)sources_.size() - 1;
+  }
+
+
+  LIBRARY_API void PoseFusion::setProcessNoise(double linear, double angular)
+  {
+    linNoise_ = linear;
+    angNoise_ = angular;
+  }
+
+
+  LIBRARY_API void PoseFusion::setDriftNoise(double initial, double rate)
+  {
+    driftInit_ = initial;
+    driftRate_ = rate;
+  }
+
+
+  LIBRARY_API void PoseFusion::setHistory(double seconds)
+  {
+    history_ = seconds;
+  }
+
+
+  LIBRARY_API void PoseFusion::setMaxGap(double seconds)
+  {
+    maxGap_ = seconds;
+  }
+
+
+  LIBRARY_API void PoseFusion::start(fusionState &state, const fusionMeasurement &meas) const
+  {
+    const fusionSource &source = sources_[meas.source];
+    double pos2 = source.posNoise * source.posNoise, drift2 = driftInit_ * driftInit_;
+
+    //! The bias starts at zero, so a drifting source's position is taken as the true one
+    state.position = meas.pose.position;
+    state.orientation = meas.pose.orientation;
+    state.orientation.normalize();
+    state.velocity = point(0.0, 0.0, 0.0);
+    state.angVel = point(0.0, 0.0, 0.0);
+    state.bias = point(0.0, 0.0, 0.0);
+    state.time = meas.time;
+    state.tracking = true;
+
+    state.covariance.setAll(0.0);
+    for (int i = 0; i < 3; ++i)
+    {
+      state.covariance.at(i, i) = pos2;
+      state.covariance.at(i + 3, i + 3) = linRate_ * linRate_;
+      state.covariance.at(i + 6, i + 6) = source.rotNoise * source.rotNoise;
+      state.covariance.at(i + 9, i + 9) = angRate_ * angRate_;
+      state.covariance.at(i + 12, i + 12) = drift2;
+      if (source.drifts)
+      {
+        //! position = measurement - bias, so the bias' uncertainty is the position's too
+        state.covariance.at(i, i) += drift2;
+        state.covariance.at(i, i + 12) = state.covariance.at(i + 12, i) = -drift2;
+      }
+    }
+  }
+
+
+  LIBRARY_API void PoseFusion::propagate(fusionState &state, double dt) const
+  {
+    if (dt <= 0.0)
+    {
+      return;
+    }
+
+    //! Nominal state (the bias is a random walk and keeps its value)
+    quaternion dq = rotationVectorQuaternion(state.angVel.x, state.angVel.y, state.angVel.z, dt);
+    state.position = point(state.position.x + (state.velocity.x * dt),
+                           state.position.y + (state.velocity.y * dt),
+                           state.position.z + (state.velocity.z * dt));
+    state.orientation = dq * state.orientation;
+    state.orientation.normalize();
+
+    //! Error state transition, as for PoseTracker
+    Mat<15, 15> F = Mat<15, 15>::identity(), Q;
+    Mat<3, 3> rot;
+    quaternionToMatrix(dq, rot);
+    double dt2 = dt * dt, dt3 = dt2 * dt;
+    for (int i = 0; i < 3; ++i)
+    {
+      F.at(i, i + 3) = dt;
+      F.at(i + 6, i + 9) = dt;
+      for (int j = 0; j < 3; ++j)
+      {
+        F.at(i + 6, j + 6) = rot.at(i, j);
+      }
+
+      Q.at(i, i) = linNoise_ * dt3 / 3.0;
+      Q.at(i, i + 3) = Q.at(i + 3, i) = linNoise_ * dt2 / 2.0;
+      Q.at(i + 3, i + 3) = linNoise_ * dt;
+      Q.at(i + 6, i + 6) = angNoise_ * dt3 / 3.0;
+      Q.at(i + 6, i + 9) = Q.at(i + 9, i + 6) = angNoise_ * dt2 / 2.0;
+      Q.at(i + 9, i + 9) = angNoise_ * dt;
+      Q.at(i + 12, i + 12) = driftRate_ * dt;
+    }
+    state.covariance = (F * state.covariance * F.trans()) + Q;
+    state.time += dt;
+  }
+
+
+  LIBRARY_API bool PoseFusion::apply(fusionState &state, const fusionMeasurement &meas) const
+  {
+    const fusionSource &source = sources_[meas.source];
+
+    if (!state.tracking || (meas.time - state.time) > maxGap_)
+    {
+      start(state, meas);
+      return true;
+    }
+
+    fusionState next = state;
+    propagate(next, meas.time - next.time);
+    next.time = meas.time;
+
+    //! Residual:  a drifting source sees the position plus the bias
+    point expected = next.position;
+    if (source.drifts)
+    {
+      expected = point(expected.x + next.bias.x, expected.y + next.bias.y, expected.z + next.bias.z);
+    }
+    Mat<6, 1> y;
+    point dtheta = quaternionRotationVector(meas.pose.orientation * next.orientation.conjugate());
+    y.at(0, 0) = meas.pose.position.x - expected.x;
+    y.at(1, 0) = meas.pose.position.y - expected.y;
+    y.at(2, 0) = meas.pose.position.z - expected.z;
+    y.at(3, 0) = dtheta.x;
+    y.at(4, 0) = dtheta.y;
+    y.at(5, 0) = dtheta.z;
+
+    Mat<6, 15> H;
+    Mat<6, 6> R;
+    for (int i = 0; i < 3; ++i)
+    {
+      H.at(i, i) = 1.0;
+      H.at(i + 3, i + 6) = 1.0;
+      if (source.drifts)
+      {
+        H.at(i, i + 12) = 1.0;
+      }
+      R.at(i, i) = source.posNoise * source.posNoise;
+      R.at(i + 3, i + 3) = source.rotNoise * source.rotNoise;
+    }
+
+    Mat<6, 15> HP = H * next.covariance, Kt;
+    Mat<6, 6> S = (HP * H.trans()) + R;
+    if (!S.ldltSolve(HP, Kt))
+    {
+      return false;
+    }
+    Mat<15, 6> K = Kt.trans();
+    Mat<15, 1> dx = K * y;
+
+    Mat<15, 15> IKH = Mat<15, 15>::identity() - (K * H);
+    next.covariance = (IKH * next.covariance * IKH.trans()) + (K * R * Kt);
+
+    next.position = point(next.position.x + dx.at(0, 0), next.position.y + dx.at(1, 0), next.position.z + dx.at(2, 0));
+    next.velocity = point(next.velocity.x + dx.at(3, 0), next.velocity.y + dx.at(4, 0), next.velocity.z + dx.at(5, 0));
+    next.orientation = rotationVectorQuaternion(dx.at(6, 0), dx.at(7, 0), dx.at(8, 0), 1.0) * next.orientation;
+    next.orientation.normalize();
+    next.angVel = point(next.angVel.x + dx.at(9, 0), next.angVel.y + dx.at(10, 0), next.angVel.z + dx.at(11, 0));
+    next.bias = point(next.bias.x + dx.at(12, 0), next.bias.y + dx.at(13, 0), next.bias.z + dx.at(14, 0));
+
+    state = next;
+    return true;
+  }
+
+
+  LIBRARY_API bool PoseFusion::correct(int source, const qpose &meas, double timestamp)
+  {
+    if (source < 0 || source >= (int)sources_.size())
+    {
+      return false;
+    }
+
+    fusionMeasurement m;
+    m.source = source;
+    m.pose = meas;
+    m.time = timestamp - sources_[source].latency;
+
+    //! Anything before the state the history starts from can no longer be applied
+    if (base_.tracking && m.time < base_.time)
+    {
+      return false;
+    }
+
+    //! Insert after any measurement of the same time, starting from the state before it
+    size_t at = measurements_.size();
+    while (at > 0 && measurements_[at - 1].time > m.time)
+    {
+      --at;
+    }
+    fusionState state = (at == 0) ? base_ : states_[at - 1];
+    if (!apply(state, m))
+    {
+      return false;
+    }
+    measurements_.insert(measurements_.begin() + at, m);
+    states_.insert(states_.begin() + at, state);
+
+    //! Roll the later measurements forward again
+    for (size_t i = at + 1; i < measurements_.size(); ++i)
+    {
+      state = states_[i - 1];
+      apply(state, measurements_[i]);
+      states_[i] = state;
+    }
+
+    //! Keep the newest measurement, and those within the history of it
+    double oldest = measurements_.back().time - history_;
+    while (measurements_.size() > 1 && measurements_.front().time < oldest)
+    {
+      base_ = states_.front();
+      measurements_.pop_front();
+      states_.pop_front();
+    }
+    return true;
+  }
+
+
+  LIBRARY_API bool PoseFusion::correct(int source, const point &position, const matrix &rotation, double timestamp)
+  {
+    if (rotation.rows != 3 || rotation.cols != 3)
+    {
+      return false;
+    }
+    qpose meas;
+    meas.position = position;
+    meas.orientation = matrixToQuaternion(Mat<3, 3>(rotation));
+    return correct(source, meas, timestamp);
+  }
+
+
+  LIBRARY_API const PoseFusion::fusionState &PoseFusion::latest() const
+  {
+    return states_.empty() ? base_ : states_.back();
+  }
+
+
+  LIBRARY_API qpose PoseFusion::predict(double timestamp) const
+  {
+    const fusionState &state = latest();
+    qpose out;
+    double dt = timestamp - state.time;
+    out.position = point(state.position.x + (state.velocity.x * dt),
+                         state.position.y + (state.velocity.y * dt),
+                         state.position.z + (state.velocity.z * dt));
+    out.orientation = rotationVectorQuaternion(state.angVel.x, state.angVel.y, state.angVel.z, dt) * state.orientation;
+    out.orientation.normalize();
+    return out;
+  }
+
+
+  LIBRARY_API pose PoseFusion::predictPose(double timestamp, bool useDegrees) const
+  {
+    return fromQPose(predict(timestamp), useDegrees);
+  }
+
+
+  LIBRARY_API point PoseFusion::velocity() const
+  {
+    return latest().velocity;
+  }
+
+
+  LIBRARY_API point PoseFusion::angularVelocity() const
+  {
+    return latest().angVel;
+  }
+
+
+  LIBRARY_API point PoseFusion::drift() const
+  {
+    return latest().bias;
+  }
+
+
+  LIBRARY_API double PoseFusion::time() const
+  {
+    return latest().time;
+  }
+
+
+  LIBRARY_API const Mat<15, 15> &PoseFusion::covariance() const
+  {
+    return latest().covariance;
+  }
+
+
+  LIBRARY_API bool PoseFusion::tracking() const
+  {
+    return latest().tracking;
+  }
+
+
+  LIBRARY_API bool PoseFusion::reset()
+  {
+    measurements_.clear();
+    states_.clear();
+    base_.position = point(0.0, 0.0, 0.0);
+    base_.velocity = point(0.0, 0.0, 0.0);
+    base_.orientation = quaternion();
+    base_.angVel = point(0.0, 0.0, 0.0);
+    base_.bias = point(0.0, 0.0, 0.0);
+    base_.covariance.setAll(0.0);
+    base_.time = 0.0;
+    base_.tracking = false;
+    return true;
+  }
+
+
+
 }
 
@@ -18,6 +18,8 @@
 //#include "../../portable.h"
 #include "NumericalMath.h"
 #include "MatrixMath.h"
+#include "RotationMath.h"
+#include <deque>
 
 using namespace std;
 
@@ -76,6 +78,100 @@ namespace Math
 
 
 
+  //! @ingroup Math
+  //!
+  //! @brief Many independent scalar (posterior, controlless) Kalman filters updated together,
+  //!        e.g., one per EMG channel or marker coordinate.  The channel estimates, covariances,
+  //!        and noise values are stored as separate aligned arrays so that each sample updates
+  //!        all channels in one SIMD pass (AVX, SSE2, or NEON when available).
+  //!
+  //! @note Same per-channel equations as SimpleKalman, with two differences:  the estimate is
+  //!       carried from one sample to the next, and an optional process noise keeps the gain
+  //!       from decaying to zero on long runs (it defaults to 0, as in SimpleKalman).
+  //!
+  class LIBRARY_API BatchKalman
+  {
+  public:
+    //! @brief Default constructor
+    //!
+    //! @param channels The number of independent channels
+    //!
+    BatchKalman(int channels);
+
+    //! @brief Default destructor
+    //!
+    ~BatchKalman();
+
+    //! @brief The number of channels
+    //!
+    int channels() const;
+
+    //! @brief Set the measurement noise variance of every channel (defaults to 0.1)
+    //!
+    void setNoise(double noise);
+
+    //! @brief Set the measurement noise variance of each channel
+    //!
+    //! @param noise One value per channel
+    //!
+    void setNoise(const double *noise);
+
+    //! @brief Set the process noise variance added to every channel's covariance per sample
+    //!
+    void setProcessNoise(double noise);
+
+    //! @brief Add a new sample (one reading per channel) and present the updated estimates
+    //!
+    //! @param newEst     Output of the function, one estimate per channel (may be the same
+    //!                   array as curReading)
+    //! @param curReading The current (noisy) readings, one per channel
+    //!
+    void updateEstimate(double *newEst, const double *curReading);
+
+    //! @brief Add a new sample; vector form of updateEstimate
+    //!
+    //! @param newEst     Output of the function providing the updated estimates
+    //! @param curReading The current (noisy) readings
+    //!
+    //! @return True if successful, false if curReading does not have one value per channel
+    //!
+    bool updateEstimate(vector<double> &newEst, const vector<double> &curReading);
+
+    //! @brief Restart every channel
+    //!
+    //! @return True if the reset was completed successfully, false otherwise
+    //!
+    bool reset();
+
+    //! @brief Restart the channels selected by a mask
+    //!
+    //! @param mask One flag per channel; channels whose flag is set are restarted
+    //!
+    //! @return True if the reset was completed successfully, false if the mask does not have one
+    //!         flag per channel
+    //!
+    bool reset(const vector<bool> &mask);
+
+  private:
+    //! @brief Number of channels, and the array length rounded up to a whole SIMD register
+    //!
+    int channels_;
+    int padded_;
+
+    //! @brief Backing storage for the arrays below (over-allocated for alignment)
+    //!
+    vector<double> storage_;
+
+    //! @brief Per-channel estimate, covariance, measurement noise, and process noise
+    //!
+    double *estimate_;
+    double *covariance_;
+    double *noise_;
+    double *procNoise_;
+  };
+
+
+
   //! @ingroup Math
   //!
   //! @brief   Discrete (linear) Kalman Filter 
@@ -158,6 +254,543 @@ namespace Math
     //!
     matrix *noise_;
   }; // Kalman
+
+
+  //! @ingroup Math
+  //!
+  //! @brief Discrete (linear) Kalman filter on fixed-size storage, for filtering on hot paths
+  //!        (e.g., one filter per tracked MoCap body at 120-240 Hz).  Same model as Kalman:
+  //!          x_k = (F * x_k-1) + (B * u_k) + w,  w ~ N(0, Q)
+  //!          z_k = (H * x_k) + v,                v ~ N(0, R)
+  //!        Updates never allocate.  The gain comes from an LDL' solve of the innovation
+  //!        covariance rather than an explicit inverse, and the covariance is updated in Joseph
+  //!        form so that it stays symmetric and positive definite.
+  //!
+  //! @note For a model without control inputs, leave NCtrl at 1 and B at zero
+  //! @note T is the element type; FixedKalman<..., float> suits measurements that carry no
+  //!       more than single precision (e.g., EMG features)
+  //!
+  template <int NState, int NMeas, int NCtrl = 1, class T = double> class FixedKalman
+  {
+  public:
+    //! @brief Default constructor.  Starts with F = I, B = 0, Q = 0.1 I, H = [I 0], R = I,
+    //!        and a zero state with unit covariance.
+    //!
+    FixedKalman ()
+    {
+      init(Mat<NState, NState, T>::identity(),
+           Mat<NState, NCtrl, T>(),
+           Mat<NState, NState, T>::identity() * (T)0.1,
+           Mat<NMeas, NState, T>::identity(),
+           Mat<NMeas, NMeas, T>::identity());
+      initial_ = Mat<NState, NState, T>::identity();
+      reset();
+    }
+
+    //! @brief Define the filter model
+    //!
+    //! @param prediction Prediction matrix (F)
+    //! @param control    Control matrix (B)
+    //! @param noise      Process noise covariance (Q)
+    //! @param stateMes   Transformation matrix mapping state vectors to the measurement domain (H)
+    //! @param measNoise  Measurement noise covariance (R)
+    //!
+    void init (const Mat<NState, NState, T> &prediction,
+               const Mat<NState, NCtrl, T> &control,
+               const Mat<NState, NState, T> &noise,
+               const Mat<NMeas, NState, T> &stateMes,
+               const Mat<NMeas, NMeas, T> &measNoise)
+    {
+      prediction_ = prediction;
+      control_ = control;
+      noise_ = noise;
+      stateMes_ = stateMes;
+      measNoise_ = measNoise;
+    }
+
+    //! @brief Set the state estimate and its covariance.  The covariance is also used by
+    //!        reset().
+    //!
+    void setState (const Mat<NState, 1, T> &state, const Mat<NState, NState, T> &covariance)
+    {
+      state_ = state;
+      covariance_ = initial_ = covariance;
+    }
+
+    //! @brief Compute the a priori state estimate and covariance
+    //!
+    //! @param control The control vector (u)
+    //!
+    void predict (const Mat<NCtrl, 1, T> &control)
+    {
+      state_ = (prediction_ * state_) + (control_ * control);
+      covariance_ = (prediction_ * covariance_ * prediction_.trans()) + noise_;
+    }
+
+    void predict ()
+    {
+      state_ = prediction_ * state_;
+      covariance_ = (prediction_ * covariance_ * prediction_.trans()) + noise_;
+    }
+
+    //! @brief Blend a sensor reading into the a priori estimate
+    //!
+    //! @param curReading The current (noisy) sensor reading (z)
+    //!
+    //! @return True if successful, false if the innovation covariance is not positive definite
+    //!         (the estimate is then left unchanged)
+    //!
+    bool correct (const Mat<NMeas, 1, T> &curReading)
+    {
+      Mat<NState, NMeas, T> PHt = covariance_ * stateMes_.trans();
+      Mat<NMeas, NMeas, T> S = (stateMes_ * PHt) + measNoise_;
+      Mat<NMeas, NState, T> Kt;
+
+      //! K = P H' S^-1, found as S K' = H P (P and S are symmetric)
+      if (!S.ldltSolve(PHt.trans(), Kt))
+      {
+        return false;
+      }
+      Mat<NState, NMeas, T> K = Kt.trans();
+
+      state_ = state_ + (K * (curReading - (stateMes_ * state_)));
+
+      //! Joseph form:  P = (I - K H) P (I - K H)' + K R K'
+      Mat<NState, NState, T> IKH = Mat<NState, NState, T>::identity() - (K * stateMes_);
+      covariance_ = (IKH * covariance_ * IKH.trans()) + (K * measNoise_ * Kt);
+      return true;
+    }
+
+    //! @brief Add a new time-series reading to the filter (predict, then correct), and present
+    //!        an updated estimate of the new state
+    //!
+    //! @param newEst     Output of the function providing an updated state estimate
+    //! @param curReading The current (noisy) sensor reading
+    //! @param control    The control vector
+    //!
+    //! @return True if the state estimation function completes successfully and provides a valid
+    //!         value, false otherwise
+    //!
+    bool updateEstimate (Mat<NState, 1, T> &newEst,
+                         const Mat<NMeas, 1, T> &curReading,
+                         const Mat<NCtrl, 1, T> &control)
+    {
+      predict(control);
+      bool val = correct(curReading);
+      newEst = state_;
+      return val;
+    }
+
+    bool updateEstimate (Mat<NState, 1, T> &newEst, const Mat<NMeas, 1, T> &curReading)
+    {
+      predict();
+      bool val = correct(curReading);
+      newEst = state_;
+      return val;
+    }
+
+    //! @brief The current state estimate and its covariance
+    //!
+    const Mat<NState, 1, T> &state () const
+    {
+      return state_;
+    }
+
+    const Mat<NState, NState, T> &covariance () const
+    {
+      return covariance_;
+    }
+
+    //! @brief Clear the state estimate and restore the initial covariance
+    //!
+    //! @return True if the reset was completed successfully, false otherwise
+    //!
+    bool reset ()
+    {
+      state_.setAll(0);
+      covariance_ = initial_;
+      return true;
+    }
+
+  private:
+    //! @brief Model matrices (F, B, Q, H, R)
+    //!
+    Mat<NState, NState, T> prediction_;
+    Mat<NState, NCtrl, T> control_;
+    Mat<NState, NState, T> noise_;
+    Mat<NMeas, NState, T> stateMes_;
+    Mat<NMeas, NMeas, T> measNoise_;
+
+    //! @brief State estimate and its covariance
+    //!
+    Mat<NState, 1, T> state_;
+    Mat<NState, NState, T> covariance_;
+
+    //! @brief Covariance restored by reset()
+    //!
+    Mat<NState, NState, T> initial_;
+  }; // FixedKalman
+
+
+  //! @ingroup Math
+  //!
+  //! @brief Rigid-body pose tracker for motion capture subjects.  Multiplicative extended Kalman
+  //!        filter with a constant-velocity, constant-angular-rate model:  the nominal state is
+  //!        position, velocity, a unit quaternion orientation, and angular velocity; the 12
+  //!        element error state carries the orientation error as a small rotation vector, so the
+  //!        filter never goes through roll-pitch-yaw angles and has no gimbal lock.
+  //!
+  //! @note Feed one tracker per MoCapSubject with the subject's position (pose.x, .y, .z) and
+  //!       rotation matrix, and call predict with the time the robot command will execute to
+  //!       look past the motion capture latency.  Lengths are in the units of the measurements
+  //!       (mm for the CRPI motion capture interfaces), angles in radians, times in seconds.
+  //!
+  class LIBRARY_API PoseTracker
+  {
+  public:
+    //! @brief Default constructor
+    //!
+    PoseTracker();
+
+    //! @brief Default destructor
+    //!
+    ~PoseTracker();
+
+    //! @brief Set the measurement noise
+    //!
+    //! @param position Standard deviation of the measured position
+    //! @param rotation Standard deviation of the measured orientation (radians)
+    //!
+    void setMeasurementNoise(double position, double rotation);
+
+    //! @brief Set the process noise (white acceleration model)
+    //!
+    //! @param linear  Spectral density of the linear acceleration (units^2 / s^3)
+    //! @param angular Spectral density of the angular acceleration (rad^2 / s^3)
+    //!
+    void setProcessNoise(double linear, double angular);
+
+    //! @brief Set the standard deviation of the velocities assumed when a track (re)starts
+    //!
+    //! @param linear  Linear speed (units / s)
+    //! @param angular Angular speed (rad / s)
+    //!
+    void setInitialRates(double linear, double angular);
+
+    //! @brief Set the capture latency subtracted from every measurement timestamp
+    //!
+    //! @param seconds Time between a frame being captured and it being passed to correct
+    //!
+    void setLatency(double seconds);
+
+    //! @brief Set the longest gap between measurements before the track is restarted
+    //!
+    //! @param seconds Maximum time between measurements
+    //!
+    void setMaxGap(double seconds);
+
+    //! @brief Add a new measurement
+    //!
+    //! @param meas      Measured pose
+    //! @param timestamp Time the measurement was received (seconds)
+    //!
+    //! @return True if the measurement was used, false if it is older than the current estimate
+    //!
+    bool correct(const qpose &meas, double timestamp);
+
+    //! @brief Add a new measurement in the form reported by MoCapSubject
+    //!
+    //! @param position  Measured position
+    //! @param rotation  Measured orientation (3x3 rotation matrix)
+    //! @param timestamp Time the measurement was received (seconds)
+    //!
+    //! @return True if the measurement was used, false if it is older than the current estimate
+    //!         or the rotation matrix is not 3x3
+    //!
+    bool correct(const point &position, const matrix &rotation, double timestamp);
+
+    //! @brief Extrapolate the estimated pose without changing the filter state
+    //!
+    //! @param timestamp Time for which the pose is wanted (seconds, same clock as correct)
+    //!
+    //! @return The estimated pose at that time
+    //!
+    qpose predict(double timestamp) const;
+
+    //! @brief Extrapolate the estimated pose as a roll-pitch-yaw pose
+    //!
+    //! @param timestamp  Time for which the pose is wanted (seconds, same clock as correct)
+    //! @param useDegrees Whether the angles are reported in degrees (true) or radians (false)
+    //!
+    //! @return The estimated pose at that time
+    //!
+    pose predictPose(double timestamp, bool useDegrees) const;
+
+    //! @brief Estimated linear velocity (units / s) and angular velocity (rad / s, world frame)
+    //!
+    point velocity() const;
+    point angularVelocity() const;
+
+    //! @brief Error state covariance (position, velocity, orientation, angular velocity)
+    //!
+    const Mat<12, 12> &covariance() const;
+
+    //! @brief Whether a measurement has started the track
+    //!
+    bool tracking() const;
+
+    //! @brief Drop the track; the next measurement starts a new one
+    //!
+    //! @return True if the reset was completed successfully, false otherwise
+    //!
+    bool reset();
+
+  private:
+    //! @brief Start a new track at a measurement
+    //!
+    void start(const qpose &meas, double time);
+
+    //! @brief Propagate the state and covariance forward
+    //!
+    void propagate(double dt);
+
+    //! @brief Nominal state
+    //!
+    point position_;
+    point velocity_;
+    quaternion orientation_;
+    point angVel_;
+
+    //! @brief Error state covariance
+    //!
+    Mat<12, 12> covariance_;
+
+    //! @brief Capture time of the last measurement used
+    //!
+    double time_;
+
+    //! @brief Whether a track has been started
+    //!
+    bool tracking_;
+
+    //! @brief Tuning (see the setters)
+    //!
+    double posNoise_;
+    double rotNoise_;
+    double linNoise_;
+    double angNoise_;
+    double linRate_;
+    double angRate_;
+    double latency_;
+    double maxGap_;
+  }; // PoseTracker
+
+
+  //! @ingroup Math
+  //!
+  //! @brief Fusion of several asynchronous pose sources into one estimate.  The multiplicative
+  //!        EKF of PoseTracker, extended with a position bias shared by the sources marked as
+  //!        drifting:  a source such as the robot's encoders mapped through ToWorld reports the
+  //!        true pose plus a slowly wandering registration error, while a motion capture system
+  //!        reports the true pose with more noise and latency but no drift.  Fusing both gives
+  //!        the encoders' rate and latency with the motion capture system's accuracy.
+  //!
+  //! @note Measurements from different sources arrive late and out of order.  The filter keeps
+  //!       the measurements of the last setHistory seconds, each with the state after it; a
+  //!       measurement older than the newest is inserted in time order and the later ones are
+  //!       applied again from the state before it.  Measurements older than the history are
+  //!       dropped.  Units are as for PoseTracker.
+  //!
+  class LIBRARY_API PoseFusion
+  {
+  public:
+    //! @brief Default constructor
+    //!
+    PoseFusion();
+
+    //! @brief Default destructor
+    //!
+    ~PoseFusion();
+
+    //! @brief Add a measurement source
+    //!
+    //! @param position Standard deviation of the measured position
+    //! @param rotation Standard deviation of the measured orientation (radians)
+    //! @param latency  Capture latency subtracted from the source's timestamps (seconds)
+    //! @param drifts   Whether the source's positions carry the drift bias
+    //!
+    //! @return Index of the source, passed to correct
+    //!
+    int addSource(double position, double rotation, double latency, bool drifts);
+
+    //! @brief Set the process noise (white acceleration model, as for PoseTracker)
+    //!
+    //! @param linear  Spectral density of the linear acceleration (units^2 / s^3)
+    //! @param angular Spectral density of the angular acceleration (rad^2 / s^3)
+    //!
+    void setProcessNoise(double linear, double angular);
+
+    //! @brief Set the drift model (random walk of the bias)
+    //!
+    //! @param initial Standard deviation of the bias when a track starts (units)
+    //! @param rate    Spectral density of the bias random walk (units^2 / s)
+    //!
+    void setDriftNoise(double initial, double rate);
+
+    //! @brief Set how far back late measurements are accepted
+    //!
+    //! @param seconds Length of the measurement history
+    //!
+    void setHistory(double seconds);
+
+    //! @brief Set the longest gap between measurements before the track is restarted
+    //!
+    //! @param seconds Maximum time between measurements
+    //!
+    void setMaxGap(double seconds);
+
+    //! @brief Add a new measurement
+    //!
+    //! @param source    Source index returned by addSource
+    //! @param meas      Measured pose
+    //! @param timestamp Time the measurement was received (seconds)
+    //!
+    //! @return True if the measurement was used, false if the source is unknown or the
+    //!         measurement is older than the history
+    //!
+    bool correct(int source, const qpose &meas, double timestamp);
+
+    //! @brief Add a new measurement in the form reported by MoCapSubject
+    //!
+    //! @param source    Source index returned by addSource
+    //! @param position  Measured position
+    //! @param rotation  Measured orientation (3x3 rotation matrix)
+    //! @param timestamp Time the measurement was received (seconds)
+    //!
+    //! @return As above; also false if the rotation matrix is not 3x3
+    //!
+    bool correct(int source, const point &position, const matrix &rotation, double timestamp);
+
+    //! @brief Extrapolate the estimated pose without changing the filter state
+    //!
+    //! @param timestamp Time for which the pose is wanted (seconds, same clock as correct)
+    //!
+    //! @return The estimated (bias-free) pose at that time
+    //!
+    qpose predict(double timestamp) const;
+
+    //! @brief Extrapolate the estimated pose as a roll-pitch-yaw pose
+    //!
+    //! @param timestamp  Time for which the pose is wanted (seconds, same clock as correct)
+    //! @param useDegrees Whether the angles are reported in degrees (true) or radians (false)
+    //!
+    //! @return The estimated pose at that time
+    //!
+    pose predictPose(double timestamp, bool useDegrees) const;
+
+    //! @brief Estimated linear velocity (units / s) and angular velocity (rad / s, world frame)
+    //!
+    point velocity() const;
+    point angularVelocity() const;
+
+    //! @brief Estimated bias of the drifting sources (their position minus the true position)
+    //!
+    point drift() const;
+
+    //! @brief Capture time of the newest measurement used (seconds)
+    //!
+    double time() const;
+
+    //! @brief Error state covariance (position, velocity, orientation, angular velocity, bias)
+    //!
+    const Mat<15, 15> &covariance() const;
+
+    //! @brief Whether a measurement has started the track
+    //!
+    bool tracking() const;
+
+    //! @brief Drop the track and the history; the next measurement starts a new track
+    //!
+    //! @return True if the reset was completed successfully, false otherwise
+    //!
+    bool reset();
+
+  private:
+    //! @brief Nominal state and error state covariance at a measurement time
+    //!
+    struct fusionState
+    {
+      point position;
+      point velocity;
+      quaternion orientation;
+      point angVel;
+      point bias;
+      Mat<15, 15> covariance;
+      double time;
+      bool tracking;
+    };
+
+    //! @brief A buffered measurement (capture time, latency already removed)
+    //!
+    struct fusionMeasurement
+    {
+      int source;
+      qpose pose;
+      double time;
+    };
+
+    //! @brief Noise and latency of a source
+    //!
+    struct fusionSource
+    {
+      double posNoise;
+      double rotNoise;
+      double latency;
+      bool drifts;
+    };
+
+    //! @brief Start a new track at a measurement
+    //!
+    void start(fusionState &state, const fusionMeasurement &meas) const;
+
+    //! @brief Propagate a state and its covariance forward
+    //!
+    void propagate(fusionState &state, double dt) const;
+
+    //! @brief Apply a measurement to a state
+    //!
+    //! @return False if the update could not be computed (the state is then unchanged)
+    //!
+    bool apply(fusionState &state, const fusionMeasurement &meas) const;
+
+    //! @brief State after the newest measurement
+    //!
+    const fusionState &latest() const;
+
+    //! @brief Measurements of the history in time order, and the state after each
+    //!
+    std::deque<fusionMeasurement> measurements_;
+    std::deque<fusionState> states_;
+
+    //! @brief State before the oldest buffered measurement
+    //!
+    fusionState base_;
+
+    //! @brief Registered sources
+    //!
+    std::vector<fusionSource> sources_;
+
+    //! @brief Tuning (see the setters)
+    //!
+    double linNoise_;
+    double angNoise_;
+    double linRate_;
+    double angRate_;
+    double driftInit_;
+    double driftRate_;
+    double history_;
+    double maxGap_;
+  }; // PoseFusion
 } // namespace Math
 
 
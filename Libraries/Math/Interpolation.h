@@ -0,0 +1,532 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Math
+//  Workfile:        Interpolation.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Pose interpolation through sequences of waypoints:  spherical linear
+//  (SLERP), spherical cubic (SQUAD), and dual quaternion blending of rigid
+//  transformations.  Roll-pitch-yaw angles cannot be interpolated directly
+//  (the path depends on the angle convention, and wraps at +/-180 degrees),
+//  so waypoints are converted to quaternion poses once, the coefficients of
+//  each segment (hemisphere-aligned end points, arc angles, SQUAD control
+//  points, position tangents) are computed when the waypoints are set, and
+//  evaluation over many samples is a table lookup and a few products per
+//  sample.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef INTERPOLATION_H
+#define INTERPOLATION_H
+
+#include <cstddef>
+#include <vector>
+#include "VectorMath.h"
+#include "RotationMath.h"
+#include "PointCloud.h"
+
+namespace Math
+{
+  //! @brief Logarithm of a unit quaternion:  (0, axis * angle / 2)
+  //!
+  inline quaternion quaternionLog (const quaternion &q)
+  {
+    double s = sqrt((q.x * q.x) + (q.y * q.y) + (q.z * q.z)), k;
+
+    k = (s > 1.0e-12) ? (atan2(s, q.w) / s) : 1.0;
+    return quaternion(0.0, q.x * k, q.y * k, q.z * k);
+  }
+
+
+  //! @brief Exponential of a pure quaternion (inverse of quaternionLog)
+  //!
+  inline quaternion quaternionExp (const quaternion &v)
+  {
+    double a = sqrt((v.x * v.x) + (v.y * v.y) + (v.z * v.z)), s, c, k;
+
+    sinCos(a, s, c);
+    k = (a > 1.0e-12) ? (s / a) : 1.0;
+    return quaternion(c, v.x * k, v.y * k, v.z * k);
+  }
+
+
+  //! @brief SQUAD control point of a waypoint, from its neighbours (which should already be on
+  //!        its hemisphere)
+  //!
+  //! @param prev The waypoint before q
+  //! @param q    The waypoint
+  //! @param next The waypoint after q
+  //!
+  //! @return s = q exp(-(log(q' prev) + log(q' next)) / 4)
+  //!
+  inline quaternion squadControl (const quaternion &prev, const quaternion &q, const quaternion &next)
+  {
+    quaternion inv = q.conjugate(), a = quaternionLog(inv * prev), b = quaternionLog(inv * next);
+    quaternion s = q * quaternionExp(quaternion(0.0, -(a.x + b.x) / 4.0, -(a.y + b.y) / 4.0,
+                                                -(a.z + b.z) / 4.0));
+    s.normalize();
+    return s;
+  }
+
+
+  //! @brief Arc between two unit quaternions, for slerpArc.  b is not flipped onto a's
+  //!        hemisphere; do that beforehand if the shorter arc is wanted.
+  //!
+  struct slerpArc
+  {
+    quaternion a;
+    quaternion b;
+
+    //! @brief Angle between a and b, and 1 / sin(theta) (0 when they are too close for the
+    //!        spherical weights, which are then linear)
+    //!
+    double theta;
+    double invSin;
+
+    slerpArc () :
+      theta(0.0),
+      invSin(0.0)
+    {
+    }
+
+    slerpArc (const quaternion &from, const quaternion &to) :
+      a(from),
+      b(to)
+    {
+      double d = (a.w * b.w) + (a.x * b.x) + (a.y * b.y) + (a.z * b.z);
+      d = (d > 1.0) ? 1.0 : ((d < -1.0) ? -1.0 : d);
+      theta = acos(d);
+      invSin = (fabs(d) > 0.9995) ? 0.0 : (1.0 / sin(theta));
+    }
+
+    //! @brief The quaternion a fraction u of the way along the arc
+    //!
+    quaternion at (double u) const
+    {
+      double wa, wb;
+      quaternion q;
+
+      if (invSin == 0.0)
+      {
+        wa = 1.0 - u;
+        wb = u;
+      }
+      else
+      {
+        wa = sin((1.0 - u) * theta) * invSin;
+        wb = sin(u * theta) * invSin;
+      }
+      q.w = (wa * a.w) + (wb * b.w);
+      q.x = (wa * a.x) + (wb * b.x);
+      q.y = (wa * a.y) + (wb * b.y);
+      q.z = (wa * a.z) + (wb * b.z);
+      q.normalize();
+      return q;
+    }
+  };
+
+
+  //! @brief Spherical cubic interpolation between q0 and q1 with control points s0 and s1
+  //!        (see squadControl)
+  //!
+  inline quaternion squad (const quaternion &q0, const quaternion &q1, const quaternion &s0,
+                           const quaternion &s1, double u)
+  {
+    return slerpArc(slerpArc(q0, q1).at(u), slerpArc(s0, s1).at(u)).at(2.0 * u * (1.0 - u));
+  }
+
+
+  //! @brief Unit dual quaternion (real + e dual), representing a rigid transformation
+  //!
+  struct dualQuaternion
+  {
+    quaternion real;
+    quaternion dual;
+
+    //! @brief Default constructor (identity transformation)
+    //!
+    dualQuaternion () :
+      dual(0.0, 0.0, 0.0, 0.0)
+    {
+    }
+
+    //! @brief Conversion from a quaternion pose:  dual = t real / 2
+    //!
+    explicit dualQuaternion (const qpose &p) :
+      real(p.orientation),
+      dual(quaternion(0.0, p.position.x / 2.0, p.position.y / 2.0, p.position.z / 2.0) * p.orientation)
+    {
+    }
+
+    //! @brief Conversion to a quaternion pose (t = 2 dual real')
+    //!
+    qpose toQPose () const
+    {
+      quaternion t = dual * real.conjugate();
+      return qpose(point(2.0 * t.x, 2.0 * t.y, 2.0 * t.z), real);
+    }
+  };
+
+
+  //! @brief Weighted blend of rigid transformations (dual quaternion linear blending).  Unlike
+  //!        blending positions and orientations separately, rotation and translation stay
+  //!        coupled, so blending two poses moves along (close to) the screw between them.
+  //!
+  //! @param poses   The poses to blend
+  //! @param weights Their weights (need not sum to one)
+  //! @param count   The number of poses
+  //!
+  //! @return The blended pose (the identity if every weight is zero)
+  //!
+  inline qpose blendPoses (const qpose *poses, const double *weights, size_t count)
+  {
+    dualQuaternion sum, d;
+    double w, n;
+    size_t i;
+
+    sum.real = quaternion(0.0, 0.0, 0.0, 0.0);
+    for (i = 0; i < count; ++i)
+    {
+      d = dualQuaternion(poses[i]);
+
+      //! Every rotation onto the first one's hemisphere
+      w = weights[i];
+      if (i > 0 && ((d.real.w * poses[0].orientation.w) + (d.real.x * poses[0].orientation.x) +
+                    (d.real.y * poses[0].orientation.y) + (d.real.z * poses[0].orientation.z)) < 0.0)
+      {
+        w = -w;
+      }
+      sum.real = quaternion(sum.real.w + (w * d.real.w), sum.real.x + (w * d.real.x),
+                            sum.real.y + (w * d.real.y), sum.real.z + (w * d.real.z));
+      sum.dual = quaternion(sum.dual.w + (w * d.dual.w), sum.dual.x + (w * d.dual.x),
+                            sum.dual.y + (w * d.dual.y), sum.dual.z + (w * d.dual.z));
+    }
+
+    n = sqrt((sum.real.w * sum.real.w) + (sum.real.x * sum.real.x) + (sum.real.y * sum.real.y) +
+             (sum.real.z * sum.real.z));
+    if (n <= 0.0)
+    {
+      return qpose();
+    }
+    sum.real = quaternion(sum.real.w / n, sum.real.x / n, sum.real.y / n, sum.real.z / n);
+    sum.dual = quaternion(sum.dual.w / n, sum.dual.x / n, sum.dual.y / n, sum.dual.z / n);
+    return sum.toQPose();
+  }
+
+
+  //! @brief Blend of two rigid transformations already on the same hemisphere (the two-pose
+  //!        case of blendPoses, without the conversions)
+  //!
+  inline qpose blendPoses (const dualQuaternion &a, const dualQuaternion &b, double u)
+  {
+    dualQuaternion d;
+    double v = 1.0 - u, n;
+
+    d.real = quaternion((v * a.real.w) + (u * b.real.w), (v * a.real.x) + (u * b.real.x),
+                        (v * a.real.y) + (u * b.real.y), (v * a.real.z) + (u * b.real.z));
+    d.dual = quaternion((v * a.dual.w) + (u * b.dual.w), (v * a.dual.x) + (u * b.dual.x),
+                        (v * a.dual.y) + (u * b.dual.y), (v * a.dual.z) + (u * b.dual.z));
+    n = sqrt((d.real.w * d.real.w) + (d.real.x * d.real.x) + (d.real.y * d.real.y) + (d.real.z * d.real.z));
+    d.real = quaternion(d.real.w / n, d.real.x / n, d.real.y / n, d.real.z / n);
+    d.dual = quaternion(d.dual.w / n, d.dual.x / n, d.dual.y / n, d.dual.z / n);
+    return d.toQPose();
+  }
+
+
+  //! @brief Interpolation methods for PoseInterpolator
+  //!
+  typedef enum
+  {
+    INTERP_SLERP = 0, //! Linear in position, SLERP in orientation (continuous, with corners)
+    INTERP_SQUAD,     //! Cubic Hermite (Catmull-Rom) in position, SQUAD in orientation (smooth)
+    INTERP_DUALQUAT   //! Dual quaternion blend of each pair of waypoints (screw-like motion)
+  } InterpMethod;
+
+
+  //! @brief Pose trajectory through timed waypoints
+  //!
+  //! @note Times outside the waypoints' are clamped to the first or last waypoint.  Batch
+  //!       evaluation is fastest with the times in increasing order, but any order works.
+  //!
+  class PoseInterpolator
+  {
+  public:
+    //! @brief Default constructor (no waypoints)
+    //!
+    PoseInterpolator () :
+      method_(INTERP_SLERP)
+    {
+    }
+
+    //! @brief Set the waypoints and precompute the coefficients of each segment
+    //!
+    //! @param poses  The waypoints
+    //! @param times  The time of each waypoint, strictly increasing, or NULL for 0, 1, 2, ...
+    //! @param count  The number of waypoints
+    //! @param method How to interpolate between them
+    //!
+    //! @return False (and no waypoints) if count is zero or the times are not increasing
+    //!
+    bool setWaypoints (const qpose *poses, const double *times, size_t count, InterpMethod method)
+    {
+      std::vector<quaternion> q(count);
+      double tPrev, tNext;
+      point m0, m1;
+      size_t i;
+
+      segments_.clear();
+      method_ = method;
+      if (count == 0)
+      {
+        return false;
+      }
+      for (i = 1; times != NULL && i < count; ++i)
+      {
+        if (!(times[i] > times[i - 1]))
+        {
+          return false;
+        }
+      }
+
+      //! Each orientation onto the previous one's hemisphere, so every segment takes the shorter
+      //! arc and SQUAD's neighbours are consistent
+      q[0] = poses[0].orientation;
+      for (i = 1; i < count; ++i)
+      {
+        q[i] = poses[i].orientation;
+        if (((q[i].w * q[i - 1].w) + (q[i].x * q[i - 1].x) + (q[i].y * q[i - 1].y) + (q[i].z * q[i - 1].z)) < 0.0)
+        {
+          q[i] = quaternion(-q[i].w, -q[i].x, -q[i].y, -q[i].z);
+        }
+      }
+
+      //! A single waypoint is a zero-length segment
+      segments_.resize((count > 1) ? count - 1 : 1);
+      for (i = 0; i < segments_.size(); ++i)
+      {
+        size_t j = (count > 1) ? i + 1 : i;
+        segment &seg = segments_[i];
+
+        seg.t0 = (times == NULL) ? (double)i : times[i];
+        seg.t1 = (times == NULL) ? (double)j : times[j];
+        seg.invDt = (seg.t1 > seg.t0) ? (1.0 / (seg.t1 - seg.t0)) : 0.0;
+        seg.p0 = poses[i].position;
+        seg.p1 = poses[j].position;
+        seg.arc = slerpArc(q[i], q[j]);
+
+        if (method == INTERP_SQUAD)
+        {
+          seg.ctrl = slerpArc(squadControl(q[(i > 0) ? i - 1 : i], q[i], q[j]),
+                              squadControl(q[i], q[j], q[(j + 1 < count) ? j + 1 : j]));
+
+          //! Catmull-Rom tangents (per unit of u), from the neighbouring waypoints' times
+          tPrev = (i > 0) ? ((times == NULL) ? (double)(i - 1) : times[i - 1]) : seg.t0;
+          tNext = (j + 1 < count) ? ((times == NULL) ? (double)(j + 1) : times[j + 1]) : seg.t1;
+          m0 = m1 = seg.p1 - seg.p0;
+          if (i > 0)
+          {
+            m0 = (poses[j].position - poses[i - 1].position) * ((seg.t1 - seg.t0) / (seg.t1 - tPrev));
+          }
+          if (j + 1 < count)
+          {
+            m1 = (poses[j + 1].position - poses[i].position) * ((seg.t1 - seg.t0) / (tNext - seg.t0));
+          }
+
+          //! p(u) = p0 + c1 u + c2 u^2 + c3 u^3
+          seg.c1 = m0;
+          seg.c2 = ((seg.p1 - seg.p0) * 3.0) - (m0 * 2.0) - m1;
+          seg.c3 = ((seg.p0 - seg.p1) * 2.0) + m0 + m1;
+        }
+        else if (method == INTERP_DUALQUAT)
+        {
+          seg.d0 = dualQuaternion(qpose(seg.p0, q[i]));
+          seg.d1 = dualQuaternion(qpose(seg.p1, q[j]));
+        }
+      }
+      return true;
+    }
+
+    //! @brief As setWaypoints above, for roll-pitch-yaw waypoints
+    //!
+    bool setWaypoints (const pose *poses, const double *times, size_t count, bool useDegrees, InterpMethod method)
+    {
+      std::vector<qpose> q(count);
+      RPYToQuaternionBatch(poses, count > 0 ? &q[0] : NULL, count, useDegrees);
+      return setWaypoints(count > 0 ? &q[0] : NULL, times, count, method);
+    }
+
+    //! @brief Whether there are waypoints
+    //!
+    bool valid () const
+    {
+      return !segments_.empty();
+    }
+
+    //! @brief Time of the first and last waypoints
+    //!
+    double startTime () const
+    {
+      return segments_.empty() ? 0.0 : segments_.front().t0;
+    }
+
+    double endTime () const
+    {
+      return segments_.empty() ? 0.0 : segments_.back().t1;
+    }
+
+    //! @brief The pose at a time
+    //!
+    qpose evaluate (double t) const
+    {
+      size_t hint = 0;
+      return segments_.empty() ? qpose() : evaluate(t, hint);
+    }
+
+    //! @brief The poses at many times
+    //!
+    //! @param times The times to sample
+    //! @param count The number of samples
+    //! @param out   The poses, one per time
+    //!
+    void evaluate (const double *times, size_t count, qpose *out) const
+    {
+      size_t hint = 0;
+
+      for (size_t i = 0; i < count; ++i)
+      {
+        out[i] = segments_.empty() ? qpose() : evaluate(times[i], hint);
+      }
+    }
+
+    //! @brief As evaluate above, into a pose batch (resized to count)
+    //!
+    void evaluate (const double *times, size_t count, PoseBatch &out) const
+    {
+      size_t hint = 0;
+
+      out.resize(count);
+      for (size_t i = 0; i < count; ++i)
+      {
+        out.set(i, segments_.empty() ? qpose() : evaluate(times[i], hint));
+      }
+    }
+
+    //! @brief Sample the whole trajectory at a fixed period, starting at the first waypoint
+    //!
+    //! @param period Time between samples (s)
+    //! @param out    The poses (the last one at or just before the final waypoint)
+    //!
+    void sample (double period, std::vector<qpose> &out) const
+    {
+      size_t n, i, hint = 0;
+
+      out.clear();
+      if (segments_.empty() || period <= 0.0)
+      {
+        return;
+      }
+      n = (size_t)((endTime() - startTime()) / period) + 1;
+      out.resize(n);
+      for (i = 0; i < n; ++i)
+      {
+        out[i] = evaluate(startTime() + (i * period), hint);
+      }
+    }
+
+  private:
+    //! @brief Precomputed coefficients of the trajectory between two waypoints
+    //!
+    struct segment
+    {
+      //! @brief Start and end times, and 1 / (t1 - t0)
+      //!
+      double t0;
+      double t1;
+      double invDt;
+
+      //! @brief End positions, and for SQUAD the cubic's coefficients
+      //!
+      point p0;
+      point p1;
+      point c1;
+      point c2;
+      point c3;
+
+      //! @brief Orientation arc, and for SQUAD the arc between the control points
+      //!
+      slerpArc arc;
+      slerpArc ctrl;
+
+      //! @brief End transformations, for INTERP_DUALQUAT
+      //!
+      dualQuaternion d0;
+      dualQuaternion d1;
+    };
+
+    //! @brief The pose at t, starting the segment search at hint (updated to the segment used)
+    //!
+    qpose evaluate (double t, size_t &hint) const
+    {
+      size_t lo, hi, mid;
+      double u;
+      qpose out;
+
+      //! Consecutive samples usually fall in the same or the next segment
+      if (hint >= segments_.size() || t < segments_[hint].t0)
+      {
+        hint = 0;
+      }
+      if (t > segments_[hint].t1 && hint + 1 < segments_.size() && t <= segments_[hint + 1].t1)
+      {
+        ++hint;
+      }
+      else if (t > segments_[hint].t1)
+      {
+        lo = hint;
+        hi = segments_.size() - 1;
+        while (lo < hi)
+        {
+          mid = (lo + hi) / 2;
+          if (t > segments_[mid].t1)
+          {
+            lo = mid + 1;
+          }
+          else
+          {
+            hi = mid;
+          }
+        }
+        hint = lo;
+      }
+
+      const segment &seg = segments_[hint];
+      u = (t - seg.t0) * seg.invDt;
+      u = (u < 0.0) ? 0.0 : ((u > 1.0) ? 1.0 : u);
+
+      switch (method_)
+      {
+      case INTERP_SQUAD:
+        out.position = seg.p0 + ((seg.c1 + ((seg.c2 + (seg.c3 * u)) * u)) * u);
+        out.orientation = slerpArc(seg.arc.at(u), seg.ctrl.at(u)).at(2.0 * u * (1.0 - u));
+        break;
+      case INTERP_DUALQUAT:
+        out = blendPoses(seg.d0, seg.d1, u);
+        break;
+      default:
+        out.position = seg.p0 + ((seg.p1 - seg.p0) * u);
+        out.orientation = seg.arc.at(u);
+        break;
+      }
+      return out;
+    }
+
+    std::vector<segment> segments_;
+    InterpMethod method_;
+  };
+}
+
+#endif
@@ -0,0 +1,489 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Math
+//  Workfile:        KDTree.h
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Static k-d tree over a fixed set of points (e.g., cluster centroids,
+//  registration kernels or point clouds) answering nearest, second-nearest
+//  and k-nearest queries.  Header only, so that libraries which do not link
+//  Math can use it.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MATH_KDTREE_H
+#define MATH_KDTREE_H
+
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace Math
+{
+  //! @ingroup Math
+  //!
+  //! @brief Balanced k-d tree stored implicitly in an array:  the node for the index range
+  //!        [lo, hi) is the median at (lo + hi) / 2, split along the axis of widest spread.
+  //!        Points are copied in tree order so that a query walks contiguous memory.  Ties are
+  //!        broken toward the lower original index, matching a linear scan.
+  //!
+  class KDTree
+  {
+  public:
+    //! @brief Default constructor (empty tree)
+    //!
+    KDTree () :
+      dims_(0),
+      count_(0)
+    {
+    }
+
+    //! @brief (Re)build the tree
+    //!
+    //! @param points count points of dims values each, one after another
+    //! @param count  The number of points
+    //! @param dims   The number of values in each point
+    //!
+    void build (const double *points, int count, int dims)
+    {
+      std::vector<int> order;
+      int i, j;
+
+      clear();
+      if (points == NULL || count < 1 || dims < 1)
+      {
+        return;
+      }
+      dims_ = dims;
+      count_ = count;
+
+      order.resize(count_);
+      for (i = 0; i < count_; ++i)
+      {
+        order[i] = i;
+      }
+      axis_.resize(count_);
+      buildRange(points, order, 0, count_);
+
+      points_.resize(count_ * dims_);
+      index_ = order;
+      for (i = 0; i < count_; ++i)
+      {
+        for (j = 0; j < dims_; ++j)
+        {
+          points_[i * dims_ + j] = points[order[i] * dims_ + j];
+        }
+      }
+    }
+
+    //! @brief Remove all points
+    //!
+    void clear ()
+    {
+      dims_ = count_ = 0;
+      points_.clear();
+      index_.clear();
+      axis_.clear();
+    }
+
+    //! @brief The number of points in the tree
+    //!
+    int size () const
+    {
+      return count_;
+    }
+
+    //! @brief The number of values in each point
+    //!
+    int dims () const
+    {
+      return dims_;
+    }
+
+    //! @brief The tree's layout:  the original index of each point in tree order, and the
+    //!        splitting axis of each node (count values each), for saving with the points
+    //!
+    const std::vector<int> &order () const
+    {
+      return index_;
+    }
+
+    const std::vector<unsigned char> &axes () const
+    {
+      return axis_;
+    }
+
+    //! @brief Rebuild the tree from a saved layout (see order and axes) without repeating the
+    //!        median splits
+    //!
+    //! @param points The points the layout was built over (as for build)
+    //! @param order  The original index of each point in tree order
+    //! @param axes   The splitting axis of each node
+    //! @param count  The number of points
+    //! @param dims   The number of values in each point
+    //!
+    //! @return True if the layout is a valid one for the points, false (leaving the tree
+    //!         empty) otherwise
+    //!
+    bool restore (const double *points, const int *order, const unsigned char *axes, int count, int dims)
+    {
+      std::vector<bool> seen;
+      int i, j;
+
+      clear();
+      if (points == NULL || order == NULL || axes == NULL || count < 1 || dims < 1)
+      {
+        return false;
+      }
+      seen.assign(count, false);
+      for (i = 0; i < count; ++i)
+      {
+        if (order[i] < 0 || order[i] >= count || seen[order[i]] || axes[i] >= dims)
+        {
+          return false;
+        }
+        seen[order[i]] = true;
+      }
+
+      dims_ = dims;
+      count_ = count;
+      index_.assign(order, order + count);
+      axis_.assign(axes, axes + count);
+      points_.resize(count_ * dims_);
+      for (i = 0; i < count_; ++i)
+      {
+        for (j = 0; j < dims_; ++j)
+        {
+          points_[i * dims_ + j] = points[order[i] * dims_ + j];
+        }
+      }
+      return true;
+    }
+
+    //! @brief Find the point nearest a query
+    //!
+    //! @param query dims() values
+    //! @param dist  Set to the Euclidean distance of the nearest point, if not NULL
+    //!
+    //! @return The index (as passed to build) of the nearest point, or -1 if the tree is empty
+    //!
+    int nearest (const double *query, double *dist = NULL) const
+    {
+      searchState state;
+      search(query, 0, count_, 1, state);
+      if (dist != NULL)
+      {
+        *dist = (state.first < 0) ? DBL_MAX : sqrt(state.firstDist);
+      }
+      return state.first;
+    }
+
+    //! @brief Find the two points nearest a query (e.g., to blend between local models)
+    //!
+    //! @param query      dims() values
+    //! @param second     Set to the index of the second nearest point (-1 if there is none)
+    //! @param dist       Set to the Euclidean distance of the nearest point, if not NULL
+    //! @param secondDist Set to the Euclidean distance of the second nearest point, if not NULL
+    //!
+    //! @return The index of the nearest point, or -1 if the tree is empty
+    //!
+    int nearestTwo (const double *query, int &second, double *dist = NULL,
+                    double *secondDist = NULL) const
+    {
+      searchState state;
+      search(query, 0, count_, 2, state);
+      second = state.second;
+      if (dist != NULL)
+      {
+        *dist = (state.first < 0) ? DBL_MAX : sqrt(state.firstDist);
+      }
+      if (secondDist != NULL)
+      {
+        *secondDist = (state.second < 0) ? DBL_MAX : sqrt(state.secondDist);
+      }
+      return state.first;
+    }
+
+    //! @brief Batch query
+    //!
+    //! @param queries    count queries of dims() values each, one after another
+    //! @param count      The number of queries
+    //! @param first      Filled with the nearest point to each query
+    //! @param second     If not NULL, filled with the second nearest point to each query
+    //! @param dist       If not NULL, filled with the distances to the nearest points
+    //! @param secondDist If not NULL, filled with the distances to the second nearest points
+    //!
+    void nearestBatch (const double *queries, int count, int *first, int *second = NULL,
+                       double *dist = NULL, double *secondDist = NULL) const
+    {
+      int i, other;
+
+      for (i = 0; i < count; ++i)
+      {
+        if (second == NULL && secondDist == NULL)
+        {
+          first[i] = nearest(queries + i * dims_, (dist == NULL) ? NULL : &dist[i]);
+        }
+        else
+        {
+          first[i] = nearestTwo(queries + i * dims_, other, (dist == NULL) ? NULL : &dist[i],
+                                (secondDist == NULL) ? NULL : &secondDist[i]);
+          if (second != NULL)
+          {
+            second[i] = other;
+          }
+        }
+      }
+    }
+
+    //! @brief Find the k points nearest a query (e.g., a point's neighbourhood, to estimate the
+    //!        surface normal there)
+    //!
+    //! @param query   dims() values
+    //! @param k       The number of points wanted
+    //! @param indices Filled with the indices of the nearest points, nearest first
+    //! @param dists   Filled with the Euclidean distances of the nearest points (k values)
+    //!
+    //! @return The number of points found:  k, or size() if that is smaller
+    //!
+    int nearestK (const double *query, int k, int *indices, double *dists) const
+    {
+      int found = 0, i;
+
+      k = (k < count_) ? k : count_;
+      if (k < 1)
+      {
+        return 0;
+      }
+      searchK(query, 0, count_, k, indices, dists, found);
+      for (i = 0; i < found; ++i)
+      {
+        dists[i] = sqrt(dists[i]);
+      }
+      return found;
+    }
+
+  private:
+    //! @brief Best candidates found so far in a query (squared distances)
+    //!
+    struct searchState
+    {
+      int first;
+      int second;
+      double firstDist;
+      double secondDist;
+
+      searchState () :
+        first(-1),
+        second(-1),
+        firstDist(DBL_MAX),
+        secondDist(DBL_MAX)
+      {
+      }
+    };
+
+    //! @brief Orders point indices by one coordinate
+    //!
+    struct axisLess
+    {
+      const double *points;
+      int dims;
+      int axis;
+
+      bool operator() (int a, int b) const
+      {
+        double va = points[a * dims + axis], vb = points[b * dims + axis];
+        return (va < vb) || (va == vb && a < b);
+      }
+    };
+
+    //! @brief Arrange order[lo, hi) into a subtree
+    //!
+    void buildRange (const double *points, std::vector<int> &order, int lo, int hi)
+    {
+      int mid, i, j, axis = 0;
+      double lowest, highest, spread, widest = -1.0;
+      axisLess cmp;
+
+      if (hi - lo < 1)
+      {
+        return;
+      }
+      mid = (lo + hi) / 2;
+
+      //! Split along the axis with the widest spread of values in this range
+      for (j = 0; j < dims_; ++j)
+      {
+        lowest = highest = points[order[lo] * dims_ + j];
+        for (i = lo + 1; i < hi; ++i)
+        {
+          double v = points[order[i] * dims_ + j];
+          lowest = (v < lowest) ? v : lowest;
+          highest = (v > highest) ? v : highest;
+        }
+        spread = highest - lowest;
+        if (spread > widest)
+        {
+          widest = spread;
+          axis = j;
+        }
+      }
+
+      cmp.points = points;
+      cmp.dims = dims_;
+      cmp.axis = axis;
+      std::nth_element(order.begin() + lo, order.begin() + mid, order.begin() + hi, cmp);
+      axis_[mid] = (unsigned char)axis;
+
+      buildRange(points, order, lo, mid);
+      buildRange(points, order, mid + 1, hi);
+    }
+
+    //! @brief Offer a candidate to the search state
+    //!
+    void consider (int id, double d, int keep, searchState &state) const
+    {
+      if (d < state.firstDist || (d == state.firstDist && id < state.first))
+      {
+        if (keep > 1)
+        {
+          state.second = state.first;
+          state.secondDist = state.firstDist;
+        }
+        state.first = id;
+        state.firstDist = d;
+      }
+      else if (keep > 1 && (d < state.secondDist || (d == state.secondDist && id < state.second)))
+      {
+        state.second = id;
+        state.secondDist = d;
+      }
+    }
+
+    //! @brief Search the subtree over [lo, hi) for the keep (1 or 2) nearest points
+    //!
+    void search (const double *query, int lo, int hi, int keep, searchState &state) const
+    {
+      int mid, axis, j;
+      double d = 0.0, diff, bound;
+      const double *p;
+
+      if (hi - lo < 1)
+      {
+        return;
+      }
+      mid = (lo + hi) / 2;
+      p = &points_[mid * dims_];
+      for (j = 0; j < dims_; ++j)
+      {
+        diff = query[j] - p[j];
+        d += diff * diff;
+      }
+      consider(index_[mid], d, keep, state);
+
+      //! Nearer side first; the far side only if the splitting plane is within the bound
+      //! (<= so that equally distant points with lower indexes are still found)
+      axis = axis_[mid];
+      diff = query[axis] - p[axis];
+      if (diff < 0.0)
+      {
+        search(query, lo, mid, keep, state);
+        bound = (keep > 1) ? state.secondDist : state.firstDist;
+        if (diff * diff <= bound)
+        {
+          search(query, mid + 1, hi, keep, state);
+        }
+      }
+      else
+      {
+        search(query, mid + 1, hi, keep, state);
+        bound = (keep > 1) ? state.secondDist : state.firstDist;
+        if (diff * diff <= bound)
+        {
+          search(query, lo, mid, keep, state);
+        }
+      }
+    }
+
+    //! @brief Search the subtree over [lo, hi) for the k nearest points, kept sorted (squared
+    //!        distances) in indices and dists
+    //!
+    void searchK (const double *query, int lo, int hi, int k, int *indices, double *dists,
+                  int &found) const
+    {
+      int mid, axis, id, j;
+      double d = 0.0, diff;
+      const double *p;
+
+      if (hi - lo < 1)
+      {
+        return;
+      }
+      mid = (lo + hi) / 2;
+      p = &points_[mid * dims_];
+      for (j = 0; j < dims_; ++j)
+      {
+        diff = query[j] - p[j];
+        d += diff * diff;
+      }
+
+      //! Insertion into the sorted candidates, ties toward the lower index
+      id = index_[mid];
+      if (found < k || d < dists[k - 1] || (d == dists[k - 1] && id < indices[k - 1]))
+      {
+        j = (found < k) ? found++ : k - 1;
+        for (; j > 0 && (dists[j - 1] > d || (dists[j - 1] == d && indices[j - 1] > id)); --j)
+        {
+          dists[j] = dists[j - 1];
+          indices[j] = indices[j - 1];
+        }
+        dists[j] = d;
+        indices[j] = id;
+      }
+
+      axis = axis_[mid];
+      diff = query[axis] - p[axis];
+      if (diff < 0.0)
+      {
+        searchK(query, lo, mid, k, indices, dists, found);
+        if (found < k || diff * diff <= dists[k - 1])
+        {
+          searchK(query, mid + 1, hi, k, indices, dists, found);
+        }
+      }
+      else
+      {
+        searchK(query, mid + 1, hi, k, indices, dists, found);
+        if (found < k || diff * diff <= dists[k - 1])
+        {
+          searchK(query, lo, mid, k, indices, dists, found);
+        }
+      }
+    }
+
+    //! @brief Values per point and number of points
+    //!
+    int dims_;
+    int count_;
+
+    //! @brief Points in tree order
+    //!
+    std::vector<double> points_;
+
+    //! @brief Original index of each point in tree order
+    //!
+    std::vector<int> index_;
+
+    //! @brief Splitting axis of each node
+    //!
+    std::vector<unsigned char> axis_;
+  }; // KDTree
+} // namespace Math
+
+#endif
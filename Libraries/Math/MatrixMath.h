@@ -16,13 +16,244 @@
 #define MATRIX_MATH_H
 
 #include <vector>
+#include <cstddef>
+#include <algorithm>
 #include "VectorMath.h"
+#include "Decomposition.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MATH_USE_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define MATH_USE_NEON
+#endif
+
+//! Define MATH_USE_BLAS (and link a CBLAS library) to hand large matrix products to dgemm.  The
+//! choice must be the same for every file of a build, since matrixGemm is defined inline.
+#if defined(MATH_USE_BLAS)
+#include <cblas.h>
+#endif
 #pragma warning (disable: 4018)
 
 using namespace std;
 
 namespace Math
 {
+  //! @brief Depth and column tile sizes of matrixGemm.  A 64 x 256 tile of the second operand
+  //!        (128 KB) stays in cache while every row of the first operand passes over it.
+  //!
+  static const int gemmTileK = 64;
+  static const int gemmTileN = 256;
+
+  //! @brief Smallest product (rows * depth * columns) that matrix::operator* packs into
+  //!        contiguous arrays for matrixGemm; below this the copies cost more than they save
+  //!
+  static const double gemmPackMin = 4096.0;
+
+  //! @brief Smallest product (rows * depth * columns) handed to BLAS when MATH_USE_BLAS is
+  //!        defined; below this the library call overhead outweighs its faster kernel
+  //!
+  static const double gemmBlasMin = 262144.0;
+
+
+  //! @brief Accumulate c += a * b over rows i0..i1-1, columns j0..j1-1, and depth k0..k1-1
+  //!
+  //! @param a Row-major first operand (m x k)
+  //! @param b Row-major second operand (k x n)
+  //! @param c Row-major product (m x n)
+  //!
+  inline void gemmEdge (const double *a, const double *b, double *c, int k, int n,
+                        int i0, int i1, int j0, int j1, int k0, int k1)
+  {
+    for (int i = i0; i < i1; ++i)
+    {
+      double *ci = c + ((size_t)i * n);
+      for (int p = k0; p < k1; ++p)
+      {
+        double aip = a[((size_t)i * k) + p];
+        const double *bp = b + ((size_t)p * n);
+        for (int j = j0; j < j1; ++j)
+        {
+          ci[j] += aip * bp[j];
+        }
+      }
+    }
+  }
+
+
+#if defined(__AVX__)
+  //! @brief Columns of c updated per call of gemmKernel
+  //!
+  static const int gemmKernelCols = 8;
+
+  //! @brief Accumulate a 4 x 8 block of c += a * b over depth k0..k1-1, holding the block in
+  //!        registers for the whole depth
+  //!
+  //! @param a   First of the four rows of the first operand
+  //! @param lda Row stride of a
+  //! @param b   First of the eight columns of the second operand
+  //! @param ldb Row stride of b
+  //! @param c   Top left element of the block
+  //! @param ldc Row stride of c
+  //!
+  inline void gemmKernel (const double *a, int lda, const double *b, int ldb, double *c, int ldc,
+                          int k0, int k1)
+  {
+#if defined(__FMA__)
+#define MATH_GEMM_FMA(x, y, acc) _mm256_fmadd_pd(x, y, acc)
+#else
+#define MATH_GEMM_FMA(x, y, acc) _mm256_add_pd(acc, _mm256_mul_pd(x, y))
+#endif
+    __m256d c00 = _mm256_loadu_pd(c), c01 = _mm256_loadu_pd(c + 4),
+            c10 = _mm256_loadu_pd(c + ldc), c11 = _mm256_loadu_pd(c + ldc + 4),
+            c20 = _mm256_loadu_pd(c + (2 * ldc)), c21 = _mm256_loadu_pd(c + (2 * ldc) + 4),
+            c30 = _mm256_loadu_pd(c + (3 * ldc)), c31 = _mm256_loadu_pd(c + (3 * ldc) + 4);
+    for (int p = k0; p < k1; ++p)
+    {
+      const double *bp = b + ((size_t)p * ldb);
+      __m256d b0 = _mm256_loadu_pd(bp), b1 = _mm256_loadu_pd(bp + 4), x;
+      x = _mm256_broadcast_sd(a + p);
+      c00 = MATH_GEMM_FMA(x, b0, c00);
+      c01 = MATH_GEMM_FMA(x, b1, c01);
+      x = _mm256_broadcast_sd(a + lda + p);
+      c10 = MATH_GEMM_FMA(x, b0, c10);
+      c11 = MATH_GEMM_FMA(x, b1, c11);
+      x = _mm256_broadcast_sd(a + (2 * lda) + p);
+      c20 = MATH_GEMM_FMA(x, b0, c20);
+      c21 = MATH_GEMM_FMA(x, b1, c21);
+      x = _mm256_broadcast_sd(a + (3 * lda) + p);
+      c30 = MATH_GEMM_FMA(x, b0, c30);
+      c31 = MATH_GEMM_FMA(x, b1, c31);
+    }
+#undef MATH_GEMM_FMA
+    _mm256_storeu_pd(c, c00);
+    _mm256_storeu_pd(c + 4, c01);
+    _mm256_storeu_pd(c + ldc, c10);
+    _mm256_storeu_pd(c + ldc + 4, c11);
+    _mm256_storeu_pd(c + (2 * ldc), c20);
+    _mm256_storeu_pd(c + (2 * ldc) + 4, c21);
+    _mm256_storeu_pd(c + (3 * ldc), c30);
+    _mm256_storeu_pd(c + (3 * ldc) + 4, c31);
+  }
+#elif defined(MATH_USE_SSE2) || defined(MATH_USE_NEON)
+  //! @brief Columns of c updated per call of gemmKernel
+  //!
+  static const int gemmKernelCols = 4;
+
+  //! @brief Accumulate a 4 x 4 block of c += a * b over depth k0..k1-1, holding the block in
+  //!        registers for the whole depth
+  //!
+  //! @param a   First of the four rows of the first operand
+  //! @param lda Row stride of a
+  //! @param b   First of the four columns of the second operand
+  //! @param ldb Row stride of b
+  //! @param c   Top left element of the block
+  //! @param ldc Row stride of c
+  //!
+  inline void gemmKernel (const double *a, int lda, const double *b, int ldb, double *c, int ldc,
+                          int k0, int k1)
+  {
+#if defined(MATH_USE_SSE2)
+#define MATH_GEMM_VEC __m128d
+#define MATH_GEMM_LOAD(p) _mm_loadu_pd(p)
+#define MATH_GEMM_STORE(p, v) _mm_storeu_pd(p, v)
+#define MATH_GEMM_SPLAT(p) _mm_set1_pd(*(p))
+#define MATH_GEMM_FMA(x, y, acc) _mm_add_pd(acc, _mm_mul_pd(x, y))
+#else
+#define MATH_GEMM_VEC float64x2_t
+#define MATH_GEMM_LOAD(p) vld1q_f64(p)
+#define MATH_GEMM_STORE(p, v) vst1q_f64(p, v)
+#define MATH_GEMM_SPLAT(p) vdupq_n_f64(*(p))
+#define MATH_GEMM_FMA(x, y, acc) vfmaq_f64(acc, x, y)
+#endif
+    MATH_GEMM_VEC c00 = MATH_GEMM_LOAD(c), c01 = MATH_GEMM_LOAD(c + 2),
+                  c10 = MATH_GEMM_LOAD(c + ldc), c11 = MATH_GEMM_LOAD(c + ldc + 2),
+                  c20 = MATH_GEMM_LOAD(c + (2 * ldc)), c21 = MATH_GEMM_LOAD(c + (2 * ldc) + 2),
+                  c30 = MATH_GEMM_LOAD(c + (3 * ldc)), c31 = MATH_GEMM_LOAD(c + (3 * ldc) + 2);
+    for (int p = k0; p < k1; ++p)
+    {
+      const double *bp = b + ((size_t)p * ldb);
+      MATH_GEMM_VEC b0 = MATH_GEMM_LOAD(bp), b1 = MATH_GEMM_LOAD(bp + 2), x;
+      x = MATH_GEMM_SPLAT(a + p);
+      c00 = MATH_GEMM_FMA(x, b0, c00);
+      c01 = MATH_GEMM_FMA(x, b1, c01);
+      x = MATH_GEMM_SPLAT(a + lda + p);
+      c10 = MATH_GEMM_FMA(x, b0, c10);
+      c11 = MATH_GEMM_FMA(x, b1, c11);
+      x = MATH_GEMM_SPLAT(a + (2 * lda) + p);
+      c20 = MATH_GEMM_FMA(x, b0, c20);
+      c21 = MATH_GEMM_FMA(x, b1, c21);
+      x = MATH_GEMM_SPLAT(a + (3 * lda) + p);
+      c30 = MATH_GEMM_FMA(x, b0, c30);
+      c31 = MATH_GEMM_FMA(x, b1, c31);
+    }
+    MATH_GEMM_STORE(c, c00);
+    MATH_GEMM_STORE(c + 2, c01);
+    MATH_GEMM_STORE(c + ldc, c10);
+    MATH_GEMM_STORE(c + ldc + 2, c11);
+    MATH_GEMM_STORE(c + (2 * ldc), c20);
+    MATH_GEMM_STORE(c + (2 * ldc) + 2, c21);
+    MATH_GEMM_STORE(c + (3 * ldc), c30);
+    MATH_GEMM_STORE(c + (3 * ldc) + 2, c31);
+#undef MATH_GEMM_VEC
+#undef MATH_GEMM_LOAD
+#undef MATH_GEMM_STORE
+#undef MATH_GEMM_SPLAT
+#undef MATH_GEMM_FMA
+  }
+#endif
+
+
+  //! @brief Matrix product c = a * b of contiguous row-major arrays.  The second operand is
+  //!        walked in cache-sized tiles, and each 4-row block of the product is accumulated in
+  //!        SIMD registers (AVX/FMA, SSE2, or NEON when available).  With MATH_USE_BLAS
+  //!        defined, large products are computed by dgemm instead.
+  //!
+  //! @param a Row-major first operand (m x k)
+  //! @param b Row-major second operand (k x n)
+  //! @param c Row-major product (m x n); must not overlap a or b
+  //! @param m Rows of a
+  //! @param k Columns of a, rows of b
+  //! @param n Columns of b
+  //!
+  inline void matrixGemm (const double *a, const double *b, double *c, int m, int k, int n)
+  {
+    int i, j, j0, j1, k0, k1;
+
+#if defined(MATH_USE_BLAS)
+    if (((double)m * k * n) >= gemmBlasMin)
+    {
+      cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, m, n, k, 1.0, a, k, b, n, 0.0, c, n);
+      return;
+    }
+#endif
+
+    std::fill(c, c + ((size_t)m * n), 0.0);
+    for (j0 = 0; j0 < n; j0 += gemmTileN)
+    {
+      j1 = std::min(j0 + gemmTileN, n);
+      for (k0 = 0; k0 < k; k0 += gemmTileK)
+      {
+        k1 = std::min(k0 + gemmTileK, k);
+        i = 0;
+#if defined(__AVX__) || defined(MATH_USE_SSE2) || defined(MATH_USE_NEON)
+        for (; i + 4 <= m; i += 4)
+        {
+          for (j = j0; j + gemmKernelCols <= j1; j += gemmKernelCols)
+          {
+            gemmKernel(a + ((size_t)i * k), k, b + j, n, c + ((size_t)i * n) + j, n, k0, k1);
+          }
+          gemmEdge(a, b, c, k, n, i, i + 4, j, j1, k0, k1);
+        }
+#endif
+        gemmEdge(a, b, c, k, n, i, m, j0, j1, k0, k1);
+      }
+    }
+  }
+
 
   struct matrix
   {
@@ -202,6 +433,8 @@ namespace Math
     //!
     //! @return True if the covariance matrix was created successfully, false otherwise
     //!
+    //! @note For the covariance of a stream of samples, see RunningStats (Statistics.h)
+    //!
     bool covariance(vector<double> &v1, vector<double> &v2)
     {
       double avgV1 = 0.0f,
@@ -371,6 +604,17 @@ namespace Math
         return out;
       }
 
+      if (((double)m1 * n1 * n2) >= gemmPackMin)
+      {
+        vector<double> a, b, c((size_t)m1 * n2);
+        toArray (a);
+        val.toArray (b);
+        matrixGemm (a.data(), b.data(), c.data(), m1, n1, n2);
+        out.fromArray (c.data(), m1, n2);
+        out.valid = true;
+        return out;
+      }
+
       for (y1 = 0; y1 < m1; ++y1)
       {
         for (x2 = 0; x2 < n2; ++x2)
@@ -659,137 +903,121 @@ namespace Math
     }
 
 
-    //! @brief Produce the inverse of the matrix
+    //! @brief Copy the matrix values into one contiguous row-major array
     //!
-    //! @return The inverse of the current matrix (if it exists)
-    //!
-    //! @note:  Based on gaussj from "Numerical Recipes in C"
+    //! @param out The array to populate (resized to rows * cols)
     //!
-    matrix inv()
+    void toArray (vector<double> &out) const
     {
-      matrix out;
-      out.resize(rows, cols);
-
-      vector<int> indxc, indxr, ipiv;
-      int i, icol, irow, j, k, l, ll;
-      int x, y, n = rows;
-      double big, dum, pivinv, temp;
-
-      if (rows < 1 || rows != cols)
+      out.resize((size_t)rows * cols);
+      for (int y = 0; y < rows; ++y)
       {
-        out.valid = false;
-        return out;
+        for (int x = 0; x < cols; ++x)
+        {
+          out[((size_t)y * cols) + x] = data_m[y][x];
+        }
       }
+    }
 
-      //! Index and pivot tables
-      indxc.resize(n);
-      indxr.resize(n);
-      ipiv.resize(n);
 
-      //! Create a copy of our input vector for in-line inversion
-      for (y = 0; y < n; ++y)
+    //! @brief Replace the matrix values with those of a contiguous row-major array
+    //!
+    //! @param in Row-major values
+    //! @param r  The number of rows of the array
+    //! @param c  The number of columns of the array
+    //!
+    void fromArray (const double *in, int r, int c)
+    {
+      resize (r, c);
+      for (int y = 0; y < rows; ++y)
       {
-        for (x = 0; x < n; ++x)
+        for (int x = 0; x < cols; ++x)
         {
-          temp = data_m[y][x];
-          out.data_m[y][x] = temp;
+          data_m[y][x] = in[((size_t)y * cols) + x];
         }
       }
+    }
+
 
-      for (j = 0; j < n; ++j)
+    //! @brief Solve this * x = b without forming an inverse.  Square matrices are solved by LU
+    //!        factorization; matrices with more rows than columns by Householder QR (least
+    //!        squares), falling back to the SVD if they are rank deficient; matrices with more
+    //!        columns than rows by the SVD (minimum norm solution).
+    //!
+    //! @param b The right-hand side(s), one per column
+    //! @param x The solution, one column per column of b
+    //!
+    //! @return True if the function completed successfully, False otherwise (including a
+    //!         singular square matrix)
+    //!
+    bool solve (const matrix &b, matrix &x) const
+    {
+      vector<double> a, rhs, sol((size_t)cols * b.cols);
+      bool state;
+
+      if (!valid || !b.valid || rows < 1 || b.rows != rows)
       {
-        ipiv[j] = 0;
+        return false;
       }
+      toArray (a);
+      b.toArray (rhs);
 
-      for (i = 0; i < n; ++i)
+      if (rows == cols)
       {
-        big = 0.0f;
-        for (j = 0; j < n; ++j)
-        {
-          if (ipiv[j] != 1)
-          {
-            for (k = 0;k < n; ++k)
-            {
-              if (ipiv[k] == 0)
-              {
-                if (fabs(out.data_m[j][k]) >= big)
-                {
-                  big = fabs(out.data_m[j][k]);
-                  irow = j;
-                  icol = k;
-                }      
-              } // if (ipiv[k] == 0)
-              else if (ipiv[k] > 1)
-              {
-                 out.valid = false;
-                 return out;
-              }
-            } // for (k=1;k<=n;k++)
-          } // if (ipiv[j] != 1)
-        } // for (j=1;j<=n;j++)
-
-        ++(ipiv[icol]);
-        if (irow != icol)
-        {
-          for (l = 0; l < n; ++l)
-          {
-            temp = out.data_m[irow][l];
-            out.data_m[irow][l] = out.data_m[icol][l];
-            out.data_m[icol][l] = temp;
-          }
-        }
-
-        indxr[i] = irow;
-        indxc[i] = icol;
-        temp = fabs(out.data_m[icol][icol]);
-        if (temp < 0.00000001)
+        LUDecomp lu;
+        state = lu.factor (a.data(), rows) && lu.solve (rhs.data(), b.cols, sol.data());
+      }
+      else
+      {
+        QRDecomp qr;
+        state = (rows > cols) && qr.factor (a.data(), rows, cols) && qr.solve (rhs.data(), b.cols, sol.data());
+        if (!state)
         {
-           out.valid = false;
-           return out;
+          SVDDecomp svd;
+          state = svd.factor (a.data(), rows, cols) && svd.solve (rhs.data(), b.cols, sol.data());
         }
+      }
 
-        pivinv = 1.0 / out.data_m[icol][icol];
-        out.data_m[icol][icol] = 1.0;
-
-        for (l = 0; l < n; ++l)
-        {
-          temp = out.data_m[icol][l] * pivinv;
-          out.data_m[icol][l] = temp;
-        }
+      if (state)
+      {
+        x.fromArray (sol.data(), cols, b.cols);
+      }
+      return state;
+    }
 
-        for (ll = 0; ll < n; ++ll)
-        {
-          if (ll != icol) 
-          {
-            dum = out.data_m[ll][icol];
-            out.data_m[ll][icol] = 0.0f;
 
-            for (l = 0; l < n; ++l)
-            {
-              temp = out.data_m[ll][l] - (out.data_m[icol][l] * dum);
-              out.data_m[ll][l] = temp;
-            }
-          }
-        } // for (ll = 0; ll < n; ++ll)
-      } // for (i = 0; i < n; ++i)
+    //! @brief Produce the inverse of the matrix
+    //!
+    //! @return The inverse of the current matrix (if it exists)
+    //!
+    //! @note:  LU factorization with partial pivoting.  Prefer solve() when the inverse is only
+    //!         going to be multiplied by another matrix.
+    //!
+    matrix inv()
+    {
+      matrix out;
+      out.resize(rows, cols);
 
-      for (l = n-1; l >= 0; --l)
+      if (rows < 1 || rows != cols)
       {
-        if (indxr[l] != indxc[l])
-        {
-          for (k = 0; k < n; ++k)
-          {
-            temp = out.data_m[k][indxr[l]];
-            out.data_m[k][indxr[l]] = out.data_m[k][indxc[l]];
-            out.data_m[k][indxc[l]] = temp;
-          }
-        } // if (indxr[l] != indxc[l])
-      } //for (l = n-1; l >= 0; --l)
+        out.valid = false;
+        return out;
+      }
 
-      //! Garbage collection
-      ipiv.clear();
-      indxr.clear();
-      indxc.clear();
+      vector<double> a, id((size_t)rows * rows, 0.0);
+      LUDecomp lu;
+      toArray (a);
+      if (!lu.factor (a.data(), rows))
+      {
+        out.valid = false;
+        return out;
+      }
+      for (int i = 0; i < rows; ++i)
+      {
+        id[((size_t)i * rows) + i] = 1.0;
+      }
+      lu.solve (id.data(), rows, id.data());
+      out.fromArray (id.data(), rows, cols);
 
       out.valid = true;
       return out;
@@ -800,29 +1028,34 @@ namespace Math
     //!
     //! @return A matrix containing the pseudo inverse of the original matrix
     //!
+    //! @note:  Found from a QR factorization when the matrix has full column rank, and from
+    //!         the SVD otherwise, rather than by inverting (A'A).  Least squares problems should
+    //!         call solve() instead, which never forms the pseudo inverse.
+    //!
     matrix pseudoInv ()
     {
-      matrix in_T, inTin, inTinInv;
       matrix out;
-      in_T = this->trans();
-      if (!in_T.valid)
+      vector<double> a, p((size_t)cols * rows);
+      QRDecomp qr;
+      SVDDecomp svd;
+      bool state;
+
+      if (!valid || rows < 1)
       {
         out.valid = false;
         return out;
       }
-      inTin = in_T * (*this);
-      if (!inTin.valid)
+      toArray (a);
+      state = (rows >= cols) && qr.factor (a.data(), rows, cols) && qr.pseudoInverse (p.data());
+      if (!state)
       {
-        out.valid = false;
-        return out;
+        state = svd.factor (a.data(), rows, cols) && svd.pseudoInverse (p.data());
       }
-      inTinInv = inTin.inv();
-      if (!inTinInv.valid)
+      if (state)
       {
-        out.valid = false;
-        return out;
+        out.fromArray (p.data(), cols, rows);
       }
-      out = inTinInv * in_T;
+      out.valid = state;
       return out;
     }
 
@@ -894,13 +1127,9 @@ namespace Math
         return false;
       }
 
-      sa = sin(v.at(2));
-      sb = sin(v.at(1));
-      sg = sin(v.at(0));
-
-      ca = cos(v.at(2));
-      cb = cos(v.at(1));
-      cg = cos(v.at(0));
+      sinCos(v.at(2), sa, ca);
+      sinCos(v.at(1), sb, cb);
+      sinCos(v.at(0), sg, cg);
 
       at(0, 0) = ca * cb;
       at(0, 1) = ca * sb * sg - sa * cg;
@@ -975,9 +1204,9 @@ namespace Math
       y /= d;
       z /= d;
 
-      double c = cos (d),
-             s = sin (d),
-             bigC = 1.0f - c;
+      double c, s, bigC;
+      sinCos(d, s, c);
+      bigC = 1.0f - c;
     
       at(0,0) = (x * x * bigC) + c;
       at(0,1) = (x * y * bigC) - (z * s);
@@ -1140,13 +1369,9 @@ namespace Math
         temp.zr *= (3.141592654f / 180.0f);
       }
 
-      sa = sin(temp.zr);
-      sb = sin(temp.yr);
-      sg = sin(temp.xr);
-
-      ca = cos(temp.zr);
-      cb = cos(temp.yr);
-      cg = cos(temp.xr);
+      sinCos(temp.zr, sa, ca);
+      sinCos(temp.yr, sb, cb);
+      sinCos(temp.xr, sg, cg);
 
       //! Currently there is no check for gymbal lock.  This is where it should go.
 
@@ -1162,6 +1387,13 @@ namespace Math
       at(2, 1) = cb * sg;
       at(2, 2) = cb * cg;
 
+      //! The translation and the homogeneous row, the inverse of matrixRPYConvert's reading
+      at(0, 3) = temp.x;
+      at(1, 3) = temp.y;
+      at(2, 3) = temp.z;
+      at(3, 0) = at(3, 1) = at(3, 2) = 0.0;
+      at(3, 3) = 1.0;
+
       return true;
     }
 
@@ -1179,5 +1411,529 @@ namespace Math
       }
     } // void print()
   };
+
+  //! @brief Fixed-size matrix with contiguous, row-major storage.  Intended for the 3x3 rotations
+  //!        and 4x4 homogeneous transforms used on hot paths, where the dynamic matrix type's
+  //!        nested vectors would allocate on every product, transpose, or inverse.  All loop
+  //!        bounds are compile-time constants so the compiler can unroll them.
+  //!
+  //!        The element type defaults to double; Mat<R, C, float> halves the storage and lets
+  //!        the compiler put twice as many elements in each vector register, for filters and
+  //!        point transforms whose inputs carry no more than single precision.
+  //!
+  //! @note:  at() does not verify that row and col are valid values
+  //!
+  template <int R, int C, class T = double> struct Mat
+  {
+    //! @brief The matrix values, stored row by row
+    //!
+    alignas(16) T data_m[R * C];
+
+    //! @brief Default constructor (all elements zero)
+    //!
+    Mat ()
+    {
+      setAll(0);
+    }
+
+    //! @brief Conversion from a matrix of another element type
+    //!
+    //! @param source The matrix to be copied
+    //!
+    template <class U> explicit Mat (const Mat<R, C, U> &source)
+    {
+      for (int i = 0; i < R * C; ++i)
+      {
+        data_m[i] = (T)source.data_m[i];
+      }
+    }
+
+    //! @brief Conversion from a dynamic matrix.  Elements outside the source matrix are set
+    //!        to zero.
+    //!
+    //! @param source The matrix to be copied
+    //!
+    explicit Mat (const matrix &source)
+    {
+      setAll(0);
+      for (int y = 0; y < R && y < source.rows && y < (int)source.data_m.size(); ++y)
+      {
+        for (int x = 0; x < C && x < source.cols && x < (int)source.data_m[y].size(); ++x)
+        {
+          data_m[(y * C) + x] = (T)source.data_m[y][x];
+        }
+      }
+    }
+
+    //! @brief Conversion to a dynamic matrix
+    //!
+    matrix toMatrix () const
+    {
+      matrix out(R, C);
+      for (int y = 0; y < R; ++y)
+      {
+        for (int x = 0; x < C; ++x)
+        {
+          out.data_m[y][x] = data_m[(y * C) + x];
+        }
+      }
+      return out;
+    }
+
+    //! @brief Data accessor
+    //!
+    //! @param row The row of the matrix to access
+    //! @param col The column of the matrix to access
+    //!
+    T& at (int row, int col)
+    {
+      return data_m[(row * C) + col];
+    }
+
+    T at (int row, int col) const
+    {
+      return data_m[(row * C) + col];
+    }
+
+    //! @brief Assign all elements in the matrix to be a specified value
+    //!
+    void setAll (T val)
+    {
+      for (int i = 0; i < R * C; ++i)
+      {
+        data_m[i] = val;
+      }
+    }
+
+    //! @brief Produce an identity matrix
+    //!
+    static Mat identity ()
+    {
+      Mat out;
+      for (int i = 0; i < R && i < C; ++i)
+      {
+        out.at(i, i) = 1;
+      }
+      return out;
+    }
+
+    //! @brief Matrix multiplication
+    //!
+    template <int K> Mat<R, K, T> operator* (const Mat<C, K, T> &val) const
+    {
+      Mat<R, K, T> out;
+      for (int i = 0; i < R; ++i)
+      {
+        for (int j = 0; j < K; ++j)
+        {
+          T sum = 0;
+          for (int k = 0; k < C; ++k)
+          {
+            sum += data_m[(i * C) + k] * val.data_m[(k * K) + j];
+          }
+          out.data_m[(i * K) + j] = sum;
+        }
+      }
+      return out;
+    }
+
+    //! @brief Scalar multiplication
+    //!
+    Mat operator* (const T val) const
+    {
+      Mat out;
+      for (int i = 0; i < R * C; ++i)
+      {
+        out.data_m[i] = data_m[i] * val;
+      }
+      return out;
+    }
+
+    //! @brief Element-wise addition
+    //!
+    Mat operator+ (const Mat &val) const
+    {
+      Mat out;
+      for (int i = 0; i < R * C; ++i)
+      {
+        out.data_m[i] = data_m[i] + val.data_m[i];
+      }
+      return out;
+    }
+
+    //! @brief Element-wise subtraction
+    //!
+    Mat operator- (const Mat &val) const
+    {
+      Mat out;
+      for (int i = 0; i < R * C; ++i)
+      {
+        out.data_m[i] = data_m[i] - val.data_m[i];
+      }
+      return out;
+    }
+
+    //! @brief Produce the transpose of the matrix
+    //!
+    Mat<C, R, T> trans () const
+    {
+      Mat<C, R, T> out;
+      for (int y = 0; y < R; ++y)
+      {
+        for (int x = 0; x < C; ++x)
+        {
+          out.data_m[(x * R) + y] = data_m[(y * C) + x];
+        }
+      }
+      return out;
+    }
+
+    //! @brief Produce the inverse of the matrix
+    //!
+    //! @param out The inverse of the current matrix (if it exists)
+    //!
+    //! @return True if the matrix is invertible, false otherwise
+    //!
+    //! @note:  Same algorithm (gaussj, full pivoting) as matrix::inv()
+    //!
+    bool inv (Mat &out) const
+    {
+      static_assert(R == C, "Only square matrices can be inverted");
+      int indxc[R], indxr[R], ipiv[R];
+      int i, icol = 0, irow = 0, j, k, l, ll;
+      T big, dum, pivinv, temp;
+
+      out = *this;
+      for (j = 0; j < R; ++j)
+      {
+        ipiv[j] = 0;
+      }
+
+      for (i = 0; i < R; ++i)
+      {
+        big = 0;
+        for (j = 0; j < R; ++j)
+        {
+          if (ipiv[j] != 1)
+          {
+            for (k = 0; k < R; ++k)
+            {
+              if (ipiv[k] == 0)
+              {
+                if (fabs(out.at(j, k)) >= big)
+                {
+                  big = fabs(out.at(j, k));
+                  irow = j;
+                  icol = k;
+                }
+              }
+              else if (ipiv[k] > 1)
+              {
+                return false;
+              }
+            }
+          }
+        }
+
+        ++(ipiv[icol]);
+        if (irow != icol)
+        {
+          for (l = 0; l < R; ++l)
+          {
+            temp = out.at(irow, l);
+            out.at(irow, l) = out.at(icol, l);
+            out.at(icol, l) = temp;
+          }
+        }
+
+        indxr[i] = irow;
+        indxc[i] = icol;
+        if (fabs(out.at(icol, icol)) < 0.00000001)
+        {
+          return false;
+        }
+
+        pivinv = 1 / out.at(icol, icol);
+        out.at(icol, icol) = 1;
+        for (l = 0; l < R; ++l)
+        {
+          out.at(icol, l) *= pivinv;
+        }
+
+        for (ll = 0; ll < R; ++ll)
+        {
+          if (ll != icol)
+          {
+            dum = out.at(ll, icol);
+            out.at(ll, icol) = 0;
+            for (l = 0; l < R; ++l)
+            {
+              out.at(ll, l) -= out.at(icol, l) * dum;
+            }
+          }
+        }
+      } // for (i = 0; i < R; ++i)
+
+      for (l = R - 1; l >= 0; --l)
+      {
+        if (indxr[l] != indxc[l])
+        {
+          for (k = 0; k < R; ++k)
+          {
+            temp = out.at(k, indxr[l]);
+            out.at(k, indxr[l]) = out.at(k, indxc[l]);
+            out.at(k, indxc[l]) = temp;
+          }
+        }
+      }
+
+      return true;
+    }
+
+    //! @brief Fill the rotation block from roll-pitch-yaw angles (same convention as
+    //!        matrix::RPYMatrixConvert).  Other elements are left unchanged.
+    //!
+    //! @param poseIn     The pose whose rotation is converted
+    //! @param useDegrees Whether the rotation is given in degrees (true) or radians (false)
+    //!
+    //! @return True if the conversion was successful, false otherwise
+    //!
+    bool RPYMatrixConvert (const pose &poseIn, bool useDegrees)
+    {
+      static_assert(R >= 3 && C >= 3, "Rotation requires at least a 3x3 matrix");
+      double xr = poseIn.xr, yr = poseIn.yr, zr = poseIn.zr;
+      double sa, sb, sg, ca, cb, cg;
+
+      if (useDegrees)
+      {
+        xr *= (3.141592654f / 180.0f);
+        yr *= (3.141592654f / 180.0f);
+        zr *= (3.141592654f / 180.0f);
+      }
+
+      sinCos(zr, sa, ca);
+      sinCos(yr, sb, cb);
+      sinCos(xr, sg, cg);
+
+      at(0, 0) = ca * cb;
+      at(0, 1) = ca * sb * sg - sa * cg;
+      at(0, 2) = ca * sb * cg + sa * sg;
+
+      at(1, 0) = sa * cb;
+      at(1, 1) = sa * sb * sg + ca * cg;
+      at(1, 2) = sa * sb * cg - ca * sg;
+
+      at(2, 0) = -sb;
+      at(2, 1) = cb * sg;
+      at(2, 2) = cb * cg;
+
+      return true;
+    }
+
+    //! @brief Extract roll-pitch-yaw angles and translation from a homogeneous transform
+    //!        (same convention as matrix::matrixRPYConvert)
+    //!
+    //! @param poseOut    The resulting pose
+    //! @param useDegrees Whether the rotation is reported in degrees (true) or radians (false)
+    //!
+    //! @return True if the conversion was successful, false otherwise
+    //!
+    bool matrixRPYConvert (pose &poseOut, bool useDegrees) const
+    {
+      static_assert(R == 4 && C == 4, "Pose extraction requires a 4x4 homogeneous transform");
+
+      poseOut.yr = atan2(-(at(2, 0)), sqrt((at(0, 0) * at(0, 0)) + (at(1, 0) * at(1, 0))));
+
+      if (fabs(poseOut.yr - 1.57079632679489661923f) < 1.0e-4)
+      {
+        poseOut.xr = atan2(at(0, 1), at(1, 1));
+        poseOut.yr = 1.57079632679489661923f;
+        poseOut.zr = 0.0f;
+      }
+      else if (fabs(poseOut.yr + 1.57079632679489661923f) < 1.0e-4)
+      {
+        poseOut.xr = -atan2(at(0, 1), at(1, 1));
+        poseOut.yr = -1.57079632679489661923f;
+        poseOut.zr = 0.0f;
+      }
+      else
+      {
+        poseOut.xr = atan2(at(2, 1), at(2, 2));
+        poseOut.zr = atan2(at(1, 0), at(0, 0));
+      }
+
+      if (useDegrees)
+      {
+        poseOut.xr *= (180.0f / 3.141592654);
+        poseOut.yr *= (180.0f / 3.141592654);
+        poseOut.zr *= (180.0f / 3.141592654);
+      }
+
+      poseOut.x = at(0, 3);
+      poseOut.y = at(1, 3);
+      poseOut.z = at(2, 3);
+
+      return true;
+    }
+
+    //! @brief Solve (this * x = b) for a symmetric positive definite matrix by LDL'
+    //!        factorization, without forming the inverse
+    //!
+    //! @param b Right-hand side, one system per column
+    //! @param x The solution (may be the same object as b)
+    //!
+    //! @return True if the matrix is positive definite, false otherwise
+    //!
+    //! @note:  Only the lower triangle of the matrix is read
+    //!
+    template <int K> bool ldltSolve (const Mat<R, K, T> &b, Mat<R, K, T> &x) const
+    {
+      static_assert(R == C, "Only square matrices can be factored");
+      T L[R * R], D[R], sum;
+      int i, j, k;
+
+      for (j = 0; j < R; ++j)
+      {
+        sum = at(j, j);
+        for (k = 0; k < j; ++k)
+        {
+          sum -= L[(j * R) + k] * L[(j * R) + k] * D[k];
+        }
+        if (!(sum > 0))
+        {
+          return false;
+        }
+        D[j] = sum;
+
+        for (i = j + 1; i < R; ++i)
+        {
+          sum = at(i, j);
+          for (k = 0; k < j; ++k)
+          {
+            sum -= L[(i * R) + k] * L[(j * R) + k] * D[k];
+          }
+          L[(i * R) + j] = sum / D[j];
+        }
+      }
+
+      x = b;
+      for (int c = 0; c < K; ++c)
+      {
+        //! Forward substitution (L), scaling (D), then back substitution (L')
+        for (i = 0; i < R; ++i)
+        {
+          sum = x.at(i, c);
+          for (k = 0; k < i; ++k)
+          {
+            sum -= L[(i * R) + k] * x.at(k, c);
+          }
+          x.at(i, c) = sum;
+        }
+        for (i = 0; i < R; ++i)
+        {
+          x.at(i, c) /= D[i];
+        }
+        for (i = R - 1; i >= 0; --i)
+        {
+          sum = x.at(i, c);
+          for (k = i + 1; k < R; ++k)
+          {
+            sum -= L[(k * R) + i] * x.at(k, c);
+          }
+          x.at(i, c) = sum;
+        }
+      }
+      return true;
+    }
+
+    void print () const
+    {
+      for (int i = 0; i < R; ++i)
+      {
+        printf ("| ");
+        for (int j = 0; j < C; ++j)
+        {
+          printf ("%f ", at(i, j));
+        }
+        printf ("|\n");
+      }
+    }
+  };
+
+  typedef Mat<3, 3> Mat3;
+  typedef Mat<4, 4> Mat4;
+  typedef Mat<3, 1> Vec3;
+  typedef Mat<3, 3, float> Mat3f;
+  typedef Mat<4, 4, float> Mat4f;
+  typedef Mat<3, 1, float> Vec3f;
+
+
+  //! @brief Apply a homogeneous transform to a batch of points (out = t * [in 1]).  Uses AVX, SSE2,
+  //!        or NEON when available, and a scalar loop otherwise.
+  //!
+  //! @param t     The 4x4 homogeneous transform to apply
+  //! @param in    The points to be transformed
+  //! @param out   The transformed points (may be the same array as in)
+  //! @param count The number of points in in and out
+  //!
+  inline void transformPoints (const Mat4 &t, const point *in, point *out, size_t count)
+  {
+    size_t i;
+#if defined(__AVX__)
+    //! Columns of the upper 3x4 block, one point per pass
+    __m256d c0 = _mm256_set_pd(0.0, t.at(2, 0), t.at(1, 0), t.at(0, 0));
+    __m256d c1 = _mm256_set_pd(0.0, t.at(2, 1), t.at(1, 1), t.at(0, 1));
+    __m256d c2 = _mm256_set_pd(0.0, t.at(2, 2), t.at(1, 2), t.at(0, 2));
+    __m256d c3 = _mm256_set_pd(0.0, t.at(2, 3), t.at(1, 3), t.at(0, 3));
+
+    for (i = 0; i < count; ++i)
+    {
+      __m256d r = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(c0, _mm256_set1_pd(in[i].x)),
+                                              _mm256_mul_pd(c1, _mm256_set1_pd(in[i].y))),
+                                _mm256_add_pd(_mm256_mul_pd(c2, _mm256_set1_pd(in[i].z)), c3));
+      _mm_storeu_pd(&out[i].x, _mm256_castpd256_pd128(r));
+      _mm_store_sd(&out[i].z, _mm256_extractf128_pd(r, 1));
+    }
+#elif defined(MATH_USE_SSE2)
+    //! (x, y) and (z, -) halves of each column
+    __m128d c0a = _mm_set_pd(t.at(1, 0), t.at(0, 0)), c0b = _mm_set_sd(t.at(2, 0));
+    __m128d c1a = _mm_set_pd(t.at(1, 1), t.at(0, 1)), c1b = _mm_set_sd(t.at(2, 1));
+    __m128d c2a = _mm_set_pd(t.at(1, 2), t.at(0, 2)), c2b = _mm_set_sd(t.at(2, 2));
+    __m128d c3a = _mm_set_pd(t.at(1, 3), t.at(0, 3)), c3b = _mm_set_sd(t.at(2, 3));
+
+    for (i = 0; i < count; ++i)
+    {
+      __m128d x = _mm_set1_pd(in[i].x), y = _mm_set1_pd(in[i].y), z = _mm_set1_pd(in[i].z);
+      __m128d ra = _mm_add_pd(_mm_add_pd(_mm_mul_pd(c0a, x), _mm_mul_pd(c1a, y)),
+                              _mm_add_pd(_mm_mul_pd(c2a, z), c3a));
+      __m128d rb = _mm_add_sd(_mm_add_sd(_mm_mul_sd(c0b, x), _mm_mul_sd(c1b, y)),
+                              _mm_add_sd(_mm_mul_sd(c2b, z), c3b));
+      _mm_storeu_pd(&out[i].x, ra);
+      _mm_store_sd(&out[i].z, rb);
+    }
+#elif defined(MATH_USE_NEON)
+    //! (x, y) halves of each column; z is computed in scalar
+    float64x2_t c0 = { t.at(0, 0), t.at(1, 0) };
+    float64x2_t c1 = { t.at(0, 1), t.at(1, 1) };
+    float64x2_t c2 = { t.at(0, 2), t.at(1, 2) };
+    float64x2_t c3 = { t.at(0, 3), t.at(1, 3) };
+
+    for (i = 0; i < count; ++i)
+    {
+      double px = in[i].x, py = in[i].y, pz = in[i].z;
+      float64x2_t r = vfmaq_n_f64(vfmaq_n_f64(vfmaq_n_f64(c3, c0, px), c1, py), c2, pz);
+      out[i].z = (t.at(2, 0) * px) + (t.at(2, 1) * py) + (t.at(2, 2) * pz) + t.at(2, 3);
+      vst1q_f64(&out[i].x, r);
+    }
+#else
+    for (i = 0; i < count; ++i)
+    {
+      double px = in[i].x, py = in[i].y, pz = in[i].z;
+      out[i].x = (t.at(0, 0) * px) + (t.at(0, 1) * py) + (t.at(0, 2) * pz) + t.at(0, 3);
+      out[i].y = (t.at(1, 0) * px) + (t.at(1, 1) * py) + (t.at(1, 2) * pz) + t.at(1, 3);
+      out[i].z = (t.at(2, 0) * px) + (t.at(2, 1) * py) + (t.at(2, 2) * pz) + t.at(2, 3);
+    }
+#endif
+  }
 }
 #endif
\ No newline at end of file
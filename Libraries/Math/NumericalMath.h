@@ -43,11 +43,16 @@ namespace Math
 {
   //! @brief Generate a random Gaussian number with 0.0 mean and 1.0 variance
   //!
-  //! @param idum
+  //! @param idum Negative to reseed the calling thread's stream (set positive on return)
+  //!
+  //! @note Each thread draws from its own stream; see Random.h for per-object generators
+  //!
   LIBRARY_API double gRand (long *idum);
 
   //! @brief Generate a random linear number between -1.0 and 1.0
   //!
+  //! @param seed Non-negative to reseed the calling thread's stream
+  //!
   LIBRARY_API double lRand (long seed = -1);
 }
 
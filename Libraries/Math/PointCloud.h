@@ -0,0 +1,688 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Math
+//  Workfile:        PointCloud.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Structure-of-arrays containers for batches of points and poses.
+//
+//  A PointCloud keeps the X, Y, and Z coordinates of its points in three
+//  separate arrays, aligned to 32 bytes, so that transforms, centroids, and
+//  bounds run two (SSE2, NEON) or four (AVX) points per instruction without
+//  gathering coordinates out of point structures.  A PoseBatch adds four
+//  quaternion arrays for the orientations.  PointCloudView refers to (part
+//  of) either one without copying, and is what the registration, motion
+//  capture, and robot batch-transform functions take.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef POINT_CLOUD_H
+#define POINT_CLOUD_H
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <vector>
+#include "VectorMath.h"
+#include "MatrixMath.h"
+#include "RotationMath.h"
+
+namespace Math
+{
+  //! @brief Read-only view of points stored as coordinate arrays.  Does not own the arrays, and
+  //!        is invalidated by anything that reallocates them.
+  //!
+  struct PointCloudView
+  {
+    const double *x;
+    const double *y;
+    const double *z;
+    size_t count;
+
+    PointCloudView () :
+      x(NULL),
+      y(NULL),
+      z(NULL),
+      count(0)
+    {
+    }
+
+    PointCloudView (const double *px, const double *py, const double *pz, size_t n) :
+      x(px),
+      y(py),
+      z(pz),
+      count(n)
+    {
+    }
+
+    size_t size () const
+    {
+      return count;
+    }
+
+    point operator[] (size_t i) const
+    {
+      return point(x[i], y[i], z[i]);
+    }
+
+    //! @brief View of n points starting at first (clipped to the view)
+    //!
+    PointCloudView slice (size_t first, size_t n) const
+    {
+      first = (first > count) ? count : first;
+      n = (n > count - first) ? count - first : n;
+      return PointCloudView(x + first, y + first, z + first, n);
+    }
+  };
+
+
+  //! @brief N coordinate arrays of equal length in one allocation, each aligned to 32 bytes and
+  //!        padded to a multiple of four elements
+  //!
+  template <int N> class SoaArrays
+  {
+  public:
+    SoaArrays () :
+      block_(NULL),
+      size_(0),
+      capacity_(0)
+    {
+      for (int k = 0; k < N; ++k)
+      {
+        array_[k] = NULL;
+      }
+    }
+
+    SoaArrays (const SoaArrays &source) :
+      block_(NULL),
+      size_(0),
+      capacity_(0)
+    {
+      for (int k = 0; k < N; ++k)
+      {
+        array_[k] = NULL;
+      }
+      *this = source;
+    }
+
+    ~SoaArrays ()
+    {
+      ::operator delete(block_);
+    }
+
+    SoaArrays &operator= (const SoaArrays &source)
+    {
+      if (this != &source)
+      {
+        resize(source.size_);
+        for (int k = 0; k < N && size_ > 0; ++k)
+        {
+          memcpy(array_[k], source.array_[k], size_ * sizeof(double));
+        }
+      }
+      return *this;
+    }
+
+    size_t size () const
+    {
+      return size_;
+    }
+
+    size_t capacity () const
+    {
+      return capacity_;
+    }
+
+    double *array (int k) const
+    {
+      return array_[k];
+    }
+
+    //! @brief Make room for n elements; existing elements are kept
+    //!
+    void reserve (size_t n)
+    {
+      void *block;
+      double *base;
+      size_t stride;
+
+      if (n <= capacity_)
+      {
+        return;
+      }
+      n = (n < 2 * capacity_) ? 2 * capacity_ : n;
+      stride = (n + 3) & ~(size_t)3;
+      block = ::operator new((N * stride * sizeof(double)) + 31);
+      base = (double *)(((size_t)block + 31) & ~(size_t)31);
+      for (int k = 0; k < N; ++k)
+      {
+        if (size_ > 0)
+        {
+          memcpy(base + (k * stride), array_[k], size_ * sizeof(double));
+        }
+        array_[k] = base + (k * stride);
+      }
+      ::operator delete(block_);
+      block_ = block;
+      capacity_ = stride;
+    }
+
+    //! @brief Set the number of elements; new elements are zero
+    //!
+    void resize (size_t n)
+    {
+      reserve(n);
+      for (int k = 0; k < N && n > size_; ++k)
+      {
+        memset(array_[k] + size_, 0, (n - size_) * sizeof(double));
+      }
+      size_ = n;
+    }
+
+  private:
+    void *block_;
+    double *array_[N];
+    size_t size_;
+    size_t capacity_;
+  };
+
+
+  //! @brief Points stored as X, Y, and Z arrays
+  //!
+  class PointCloud
+  {
+  public:
+    PointCloud ()
+    {
+    }
+
+    explicit PointCloud (size_t n)
+    {
+      data_.resize(n);
+    }
+
+    PointCloud (const point *points, size_t n)
+    {
+      assign(points, n);
+    }
+
+    explicit PointCloud (const vector<point> &points)
+    {
+      assign(points.empty() ? NULL : &points[0], points.size());
+    }
+
+    explicit PointCloud (const PointCloudView &points)
+    {
+      assign(points);
+    }
+
+    size_t size () const
+    {
+      return data_.size();
+    }
+
+    bool empty () const
+    {
+      return data_.size() == 0;
+    }
+
+    //! @brief Make room for n points, so that adding up to n does not allocate
+    //!
+    void reserve (size_t n)
+    {
+      data_.reserve(n);
+    }
+
+    //! @brief Set the number of points (new points are at the origin).  Shrinking never
+    //!        reallocates.
+    //!
+    void resize (size_t n)
+    {
+      data_.resize(n);
+    }
+
+    void clear ()
+    {
+      data_.resize(0);
+    }
+
+    void push_back (const point &p)
+    {
+      size_t i = data_.size();
+      data_.resize(i + 1);
+      set(i, p);
+    }
+
+    void assign (const point *points, size_t n)
+    {
+      data_.resize(n);
+      for (size_t i = 0; i < n; ++i)
+      {
+        set(i, points[i]);
+      }
+    }
+
+    void assign (const PointCloudView &points)
+    {
+      data_.resize(points.count);
+      if (points.count > 0)
+      {
+        memmove(x(), points.x, points.count * sizeof(double));
+        memmove(y(), points.y, points.count * sizeof(double));
+        memmove(z(), points.z, points.count * sizeof(double));
+      }
+    }
+
+    //! @brief Copy the points into an array of point structures
+    //!
+    void copyTo (vector<point> &out) const
+    {
+      out.resize(size());
+      for (size_t i = 0; i < size(); ++i)
+      {
+        out[i] = (*this)[i];
+      }
+    }
+
+    point operator[] (size_t i) const
+    {
+      return point(data_.array(0)[i], data_.array(1)[i], data_.array(2)[i]);
+    }
+
+    void set (size_t i, const point &p)
+    {
+      data_.array(0)[i] = p.x;
+      data_.array(1)[i] = p.y;
+      data_.array(2)[i] = p.z;
+    }
+
+    double *x () { return data_.array(0); }
+    double *y () { return data_.array(1); }
+    double *z () { return data_.array(2); }
+    const double *x () const { return data_.array(0); }
+    const double *y () const { return data_.array(1); }
+    const double *z () const { return data_.array(2); }
+
+    PointCloudView view () const
+    {
+      return PointCloudView(x(), y(), z(), size());
+    }
+
+    PointCloudView view (size_t first, size_t n) const
+    {
+      return view().slice(first, n);
+    }
+
+    operator PointCloudView () const
+    {
+      return view();
+    }
+
+  private:
+    SoaArrays<3> data_;
+  };
+
+
+  //! @brief Poses stored as position (X, Y, Z) and quaternion (W, X, Y, Z) arrays
+  //!
+  class PoseBatch
+  {
+  public:
+    PoseBatch ()
+    {
+    }
+
+    explicit PoseBatch (size_t n)
+    {
+      resize(n);
+    }
+
+    size_t size () const
+    {
+      return data_.size();
+    }
+
+    bool empty () const
+    {
+      return data_.size() == 0;
+    }
+
+    void reserve (size_t n)
+    {
+      data_.reserve(n);
+    }
+
+    //! @brief Set the number of poses (new poses are the identity)
+    //!
+    void resize (size_t n)
+    {
+      size_t old = data_.size();
+      data_.resize(n);
+      for (size_t i = old; i < n; ++i)
+      {
+        data_.array(3)[i] = 1.0;
+      }
+    }
+
+    void clear ()
+    {
+      data_.resize(0);
+    }
+
+    void push_back (const qpose &p)
+    {
+      size_t i = data_.size();
+      data_.resize(i + 1);
+      set(i, p);
+    }
+
+    //! @brief Add a roll-pitch-yaw pose, converted to a quaternion
+    //!
+    void push_back (const pose &p, bool useDegrees)
+    {
+      push_back(toQPose(p, useDegrees));
+    }
+
+    qpose operator[] (size_t i) const
+    {
+      return qpose(point(data_.array(0)[i], data_.array(1)[i], data_.array(2)[i]),
+                   quaternion(data_.array(3)[i], data_.array(4)[i], data_.array(5)[i], data_.array(6)[i]));
+    }
+
+    //! @brief A pose as roll-pitch-yaw angles
+    //!
+    pose get (size_t i, bool useDegrees) const
+    {
+      return fromQPose((*this)[i], useDegrees);
+    }
+
+    void set (size_t i, const qpose &p)
+    {
+      data_.array(0)[i] = p.position.x;
+      data_.array(1)[i] = p.position.y;
+      data_.array(2)[i] = p.position.z;
+      data_.array(3)[i] = p.orientation.w;
+      data_.array(4)[i] = p.orientation.x;
+      data_.array(5)[i] = p.orientation.y;
+      data_.array(6)[i] = p.orientation.z;
+    }
+
+    double *x () { return data_.array(0); }
+    double *y () { return data_.array(1); }
+    double *z () { return data_.array(2); }
+    double *qw () { return data_.array(3); }
+    double *qx () { return data_.array(4); }
+    double *qy () { return data_.array(5); }
+    double *qz () { return data_.array(6); }
+    const double *x () const { return data_.array(0); }
+    const double *y () const { return data_.array(1); }
+    const double *z () const { return data_.array(2); }
+    const double *qw () const { return data_.array(3); }
+    const double *qx () const { return data_.array(4); }
+    const double *qy () const { return data_.array(5); }
+    const double *qz () const { return data_.array(6); }
+
+    //! @brief The positions, as a point cloud view
+    //!
+    PointCloudView positions () const
+    {
+      return PointCloudView(x(), y(), z(), size());
+    }
+
+  private:
+    SoaArrays<7> data_;
+  };
+
+
+  //! @brief Apply a homogeneous transform to coordinate arrays (o = t * [i 1]).  The output may
+  //!        be the input.
+  //!
+  inline void transformPoints (const Mat4 &t, const double *ix, const double *iy, const double *iz,
+                               double *ox, double *oy, double *oz, size_t count)
+  {
+    size_t i = 0;
+#if defined(__AVX__)
+    const __m256d t00 = _mm256_set1_pd(t.at(0, 0)), t01 = _mm256_set1_pd(t.at(0, 1)), t02 = _mm256_set1_pd(t.at(0, 2)), t03 = _mm256_set1_pd(t.at(0, 3));
+    const __m256d t10 = _mm256_set1_pd(t.at(1, 0)), t11 = _mm256_set1_pd(t.at(1, 1)), t12 = _mm256_set1_pd(t.at(1, 2)), t13 = _mm256_set1_pd(t.at(1, 3));
+    const __m256d t20 = _mm256_set1_pd(t.at(2, 0)), t21 = _mm256_set1_pd(t.at(2, 1)), t22 = _mm256_set1_pd(t.at(2, 2)), t23 = _mm256_set1_pd(t.at(2, 3));
+
+    for (; i + 4 <= count; i += 4)
+    {
+      __m256d px = _mm256_loadu_pd(ix + i), py = _mm256_loadu_pd(iy + i), pz = _mm256_loadu_pd(iz + i);
+      _mm256_storeu_pd(ox + i, _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(t00, px), _mm256_mul_pd(t01, py)),
+                                             _mm256_add_pd(_mm256_mul_pd(t02, pz), t03)));
+      _mm256_storeu_pd(oy + i, _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(t10, px), _mm256_mul_pd(t11, py)),
+                                             _mm256_add_pd(_mm256_mul_pd(t12, pz), t13)));
+      _mm256_storeu_pd(oz + i, _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(t20, px), _mm256_mul_pd(t21, py)),
+                                             _mm256_add_pd(_mm256_mul_pd(t22, pz), t23)));
+    }
+#elif defined(MATH_USE_SSE2)
+    const __m128d t00 = _mm_set1_pd(t.at(0, 0)), t01 = _mm_set1_pd(t.at(0, 1)), t02 = _mm_set1_pd(t.at(0, 2)), t03 = _mm_set1_pd(t.at(0, 3));
+    const __m128d t10 = _mm_set1_pd(t.at(1, 0)), t11 = _mm_set1_pd(t.at(1, 1)), t12 = _mm_set1_pd(t.at(1, 2)), t13 = _mm_set1_pd(t.at(1, 3));
+    const __m128d t20 = _mm_set1_pd(t.at(2, 0)), t21 = _mm_set1_pd(t.at(2, 1)), t22 = _mm_set1_pd(t.at(2, 2)), t23 = _mm_set1_pd(t.at(2, 3));
+
+    for (; i + 2 <= count; i += 2)
+    {
+      __m128d px = _mm_loadu_pd(ix + i), py = _mm_loadu_pd(iy + i), pz = _mm_loadu_pd(iz + i);
+      _mm_storeu_pd(ox + i, _mm_add_pd(_mm_add_pd(_mm_mul_pd(t00, px), _mm_mul_pd(t01, py)),
+                                       _mm_add_pd(_mm_mul_pd(t02, pz), t03)));
+      _mm_storeu_pd(oy + i, _mm_add_pd(_mm_add_pd(_mm_mul_pd(t10, px), _mm_mul_pd(t11, py)),
+                                       _mm_add_pd(_mm_mul_pd(t12, pz), t13)));
+      _mm_storeu_pd(oz + i, _mm_add_pd(_mm_add_pd(_mm_mul_pd(t20, px), _mm_mul_pd(t21, py)),
+                                       _mm_add_pd(_mm_mul_pd(t22, pz), t23)));
+    }
+#elif defined(MATH_USE_NEON)
+    const float64x2_t t03 = vdupq_n_f64(t.at(0, 3)), t13 = vdupq_n_f64(t.at(1, 3)), t23 = vdupq_n_f64(t.at(2, 3));
+
+    for (; i + 2 <= count; i += 2)
+    {
+      float64x2_t px = vld1q_f64(ix + i), py = vld1q_f64(iy + i), pz = vld1q_f64(iz + i);
+      vst1q_f64(ox + i, vfmaq_n_f64(vfmaq_n_f64(vfmaq_n_f64(t03, px, t.at(0, 0)), py, t.at(0, 1)), pz, t.at(0, 2)));
+      vst1q_f64(oy + i, vfmaq_n_f64(vfmaq_n_f64(vfmaq_n_f64(t13, px, t.at(1, 0)), py, t.at(1, 1)), pz, t.at(1, 2)));
+      vst1q_f64(oz + i, vfmaq_n_f64(vfmaq_n_f64(vfmaq_n_f64(t23, px, t.at(2, 0)), py, t.at(2, 1)), pz, t.at(2, 2)));
+    }
+#endif
+
+    //! The rest (all of it without SIMD)
+    for (; i < count; ++i)
+    {
+      double px = ix[i], py = iy[i], pz = iz[i];
+      ox[i] = (t.at(0, 0) * px) + (t.at(0, 1) * py) + (t.at(0, 2) * pz) + t.at(0, 3);
+      oy[i] = (t.at(1, 0) * px) + (t.at(1, 1) * py) + (t.at(1, 2) * pz) + t.at(1, 3);
+      oz[i] = (t.at(2, 0) * px) + (t.at(2, 1) * py) + (t.at(2, 2) * pz) + t.at(2, 3);
+    }
+  }
+
+
+  //! @brief Apply a homogeneous transform to a point cloud
+  //!
+  //! @param t   The 4x4 homogeneous transform to apply
+  //! @param in  The points to be transformed
+  //! @param out Resized to and populated with the transformed points (may be the cloud viewed by
+  //!            in, which is then transformed in place)
+  //!
+  inline void transformPoints (const Mat4 &t, const PointCloudView &in, PointCloud &out)
+  {
+    if (out.x() != in.x)
+    {
+      out.resize(in.count);
+    }
+    transformPoints(t, in.x, in.y, in.z, out.x(), out.y(), out.z(), in.count);
+  }
+
+
+  //! @brief Sum of each coordinate array
+  //!
+  inline point sumPoints (const PointCloudView &in)
+  {
+    double s[3] = {0.0, 0.0, 0.0};
+    const double *arrays[3] = {in.x, in.y, in.z};
+    size_t i;
+
+    for (int k = 0; k < 3; ++k)
+    {
+      const double *a = arrays[k];
+      i = 0;
+#if defined(__AVX__)
+      __m256d acc = _mm256_setzero_pd();
+      double lanes[4];
+      for (; i + 4 <= in.count; i += 4)
+      {
+        acc = _mm256_add_pd(acc, _mm256_loadu_pd(a + i));
+      }
+      _mm256_storeu_pd(lanes, acc);
+      s[k] = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(MATH_USE_SSE2)
+      __m128d acc = _mm_setzero_pd();
+      double lanes[2];
+      for (; i + 2 <= in.count; i += 2)
+      {
+        acc = _mm_add_pd(acc, _mm_loadu_pd(a + i));
+      }
+      _mm_storeu_pd(lanes, acc);
+      s[k] = lanes[0] + lanes[1];
+#elif defined(MATH_USE_NEON)
+      float64x2_t acc = vdupq_n_f64(0.0);
+      for (; i + 2 <= in.count; i += 2)
+      {
+        acc = vaddq_f64(acc, vld1q_f64(a + i));
+      }
+      s[k] = vaddvq_f64(acc);
+#endif
+      for (; i < in.count; ++i)
+      {
+        s[k] += a[i];
+      }
+    }
+    return point(s[0], s[1], s[2]);
+  }
+
+
+  //! @brief Mean of the points (the origin for an empty cloud)
+  //!
+  inline point centroid (const PointCloudView &in)
+  {
+    point s = sumPoints(in);
+    double n = (in.count > 0) ? (double)in.count : 1.0;
+    return point(s.x / n, s.y / n, s.z / n);
+  }
+
+
+  //! @brief Axis-aligned bounding box of the points
+  //!
+  //! @param in The points
+  //! @param lo Populated with the smallest coordinates
+  //! @param hi Populated with the largest coordinates
+  //!
+  //! @return False (and lo and hi untouched) for an empty cloud
+  //!
+  inline bool bounds (const PointCloudView &in, point &lo, point &hi)
+  {
+    double mn[3], mx[3];
+    const double *arrays[3] = {in.x, in.y, in.z};
+    size_t i;
+
+    if (in.count == 0)
+    {
+      return false;
+    }
+    for (int k = 0; k < 3; ++k)
+    {
+      const double *a = arrays[k];
+      mn[k] = mx[k] = a[0];
+      i = 0;
+#if defined(__AVX__)
+      __m256d vmn = _mm256_set1_pd(a[0]), vmx = vmn;
+      double lanes[4];
+      for (; i + 4 <= in.count; i += 4)
+      {
+        __m256d v = _mm256_loadu_pd(a + i);
+        vmn = _mm256_min_pd(vmn, v);
+        vmx = _mm256_max_pd(vmx, v);
+      }
+      _mm256_storeu_pd(lanes, vmn);
+      mn[k] = std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+      _mm256_storeu_pd(lanes, vmx);
+      mx[k] = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#elif defined(MATH_USE_SSE2)
+      __m128d vmn = _mm_set1_pd(a[0]), vmx = vmn;
+      double lanes[2];
+      for (; i + 2 <= in.count; i += 2)
+      {
+        __m128d v = _mm_loadu_pd(a + i);
+        vmn = _mm_min_pd(vmn, v);
+        vmx = _mm_max_pd(vmx, v);
+      }
+      _mm_storeu_pd(lanes, vmn);
+      mn[k] = std::min(lanes[0], lanes[1]);
+      _mm_storeu_pd(lanes, vmx);
+      mx[k] = std::max(lanes[0], lanes[1]);
+#elif defined(MATH_USE_NEON)
+      float64x2_t vmn = vdupq_n_f64(a[0]), vmx = vmn;
+      for (; i + 2 <= in.count; i += 2)
+      {
+        float64x2_t v = vld1q_f64(a + i);
+        vmn = vminq_f64(vmn, v);
+        vmx = vmaxq_f64(vmx, v);
+      }
+      mn[k] = vminvq_f64(vmn);
+      mx[k] = vmaxvq_f64(vmx);
+#endif
+      for (; i < in.count; ++i)
+      {
+        mn[k] = (a[i] < mn[k]) ? a[i] : mn[k];
+        mx[k] = (a[i] > mx[k]) ? a[i] : mx[k];
+      }
+    }
+    lo = point(mn[0], mn[1], mn[2]);
+    hi = point(mx[0], mx[1], mx[2]);
+    return true;
+  }
+
+
+  //! @brief Compose a rigid transformation with every pose of a batch (out[i] = t * in[i])
+  //!
+  //! @param t   The transformation, applied in the parent frame
+  //! @param in  The poses
+  //! @param out Resized to and populated with the transformed poses (may be in)
+  //!
+  inline void transformPoses (const qpose &t, const PoseBatch &in, PoseBatch &out)
+  {
+    Mat4 m;
+    const quaternion &a = t.orientation;
+    double bw, bx, by, bz;
+    size_t i;
+
+    quaternionToMatrix(a, m);
+    m.at(0, 3) = t.position.x;
+    m.at(1, 3) = t.position.y;
+    m.at(2, 3) = t.position.z;
+    m.at(3, 3) = 1.0;
+
+    if (&out != &in)
+    {
+      out.resize(in.size());
+    }
+    transformPoints(m, in.x(), in.y(), in.z(), out.x(), out.y(), out.z(), in.size());
+
+    //! Quaternion product with a constant left operand; each output array is a fixed mix of the
+    //! four input arrays, which compilers vectorize
+    for (i = 0; i < in.size(); ++i)
+    {
+      bw = in.qw()[i];
+      bx = in.qx()[i];
+      by = in.qy()[i];
+      bz = in.qz()[i];
+      out.qw()[i] = (a.w * bw) - (a.x * bx) - (a.y * by) - (a.z * bz);
+      out.qx()[i] = (a.w * bx) + (a.x * bw) + (a.y * bz) - (a.z * by);
+      out.qy()[i] = (a.w * by) - (a.x * bz) + (a.y * bw) + (a.z * bx);
+      out.qz()[i] = (a.w * bz) + (a.x * by) - (a.y * bx) + (a.z * bw);
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,796 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Math
+//  Workfile:        Random.h
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Per-instance random number generators (xoshiro256** and PCG32), a
+//  four-stream xoshiro256** for bulk fills, a counter-based generator for
+//  random access, and Sobol and Halton low-discrepancy sequence generators.
+//  No generator has global state, so every thread or object can own its own
+//  stream.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MATH_RANDOM_H
+#define MATH_RANDOM_H
+
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+#include <stdint.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RANDOM_USE_SSE2
+#endif
+
+namespace Math
+{
+  //! @brief Expand a 64-bit seed into well-mixed state words (splitmix64)
+  //!
+  //! @param state Seed state, advanced by this function
+  //!
+  //! @return The next state word
+  //!
+  inline uint64_t splitMix64 (uint64_t &state)
+  {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+  }
+
+
+  //! @brief Random bits at any position of a stream, without generating the ones before it (the
+  //!        splitmix64 output for that position), so a sequence can be resumed from an index
+  //!
+  //! @param seed  Selects the stream
+  //! @param index Position in the stream
+  //!
+  inline uint64_t randomAt (uint64_t seed, uint64_t index)
+  {
+    uint64_t state = seed + (index * 0x9E3779B97F4A7C15ULL);
+    return splitMix64(state);
+  }
+
+
+  //! @brief Map 64 random bits to a double on [0, 1) with 52 bits of resolution, without an
+  //!        integer to floating point conversion (the form used by the SIMD fills)
+  //!
+  inline double bitsToUnit (uint64_t bits)
+  {
+    double out;
+    bits = (bits >> 12) | 0x3FF0000000000000ULL;
+    memcpy(&out, &bits, sizeof(double));
+    return out - 1.0;
+  }
+
+
+  //! @brief Distributions shared by the generators.  Engine provides next(), returning 64
+  //!        uniformly distributed bits.
+  //!
+  template <class Engine> class RandomDist
+  {
+  public:
+    //! @brief Default constructor
+    //!
+    RandomDist () :
+      haveSpare_(false),
+      spare_(0.0)
+    {
+    }
+
+    //! @brief Uniform double on [0, 1)
+    //!
+    double uniform ()
+    {
+      return (double)(self().next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    //! @brief Uniform double on [lo, hi)
+    //!
+    double uniform (double lo, double hi)
+    {
+      return lo + ((hi - lo) * uniform());
+    }
+
+    //! @brief Uniform integer on [0, n), without modulo bias
+    //!
+    //! @param n Number of possible values (must be greater than 0)
+    //!
+    uint64_t below (uint64_t n)
+    {
+      uint64_t threshold = (0 - n) % n, r;
+      do
+      {
+        r = self().next();
+      } while (r < threshold);
+      return r % n;
+    }
+
+    //! @brief Gaussian number with 0.0 mean and 1.0 variance (Marsaglia polar method)
+    //!
+    double gaussian ()
+    {
+      double v1, v2, rsq, fac;
+
+      if (haveSpare_)
+      {
+        haveSpare_ = false;
+        return spare_;
+      }
+      do
+      {
+        v1 = (2.0 * uniform()) - 1.0;
+        v2 = (2.0 * uniform()) - 1.0;
+        rsq = (v1 * v1) + (v2 * v2);
+      } while (rsq >= 1.0 || rsq == 0.0);
+
+      fac = sqrt(-2.0 * log(rsq) / rsq);
+      spare_ = v1 * fac;
+      haveSpare_ = true;
+      return v2 * fac;
+    }
+
+    //! @brief Gaussian number with the given mean and standard deviation
+    //!
+    double gaussian (double mean, double stddev)
+    {
+      return mean + (stddev * gaussian());
+    }
+
+    //! @brief Fill an array with uniform doubles on [lo, hi)
+    //!
+    void fillUniform (double *out, size_t count, double lo = 0.0, double hi = 1.0)
+    {
+      for (size_t i = 0; i < count; ++i)
+      {
+        out[i] = uniform(lo, hi);
+      }
+    }
+
+    //! @brief Fill an array with Gaussian numbers
+    //!
+    void fillGaussian (double *out, size_t count, double mean = 0.0, double stddev = 1.0)
+    {
+      for (size_t i = 0; i < count; ++i)
+      {
+        out[i] = gaussian(mean, stddev);
+      }
+    }
+
+  protected:
+    //! @brief Drop the cached Gaussian number (called when the engine is reseeded)
+    //!
+    void clearSpare ()
+    {
+      haveSpare_ = false;
+    }
+
+  private:
+    Engine &self ()
+    {
+      return *static_cast<Engine *>(this);
+    }
+
+    //! @brief Second number of the last Gaussian pair
+    //!
+    bool haveSpare_;
+    double spare_;
+  };
+
+
+  //! @brief xoshiro256** generator:  256 bits of state, period 2^256 - 1
+  //!
+  class Xoshiro256 : public RandomDist<Xoshiro256>
+  {
+  public:
+    //! @brief Constructor
+    //!
+    //! @param seed Any 64-bit value; equal seeds give equal streams
+    //!
+    explicit Xoshiro256 (uint64_t seed = 0x853C49E6748FEA9BULL)
+    {
+      this->seed(seed);
+    }
+
+    //! @brief Restart the stream from a seed
+    //!
+    void seed (uint64_t seed)
+    {
+      for (int i = 0; i < 4; ++i)
+      {
+        s_[i] = splitMix64(seed);
+      }
+      clearSpare();
+    }
+
+    //! @brief Next 64 random bits
+    //!
+    uint64_t next ()
+    {
+      uint64_t result = rotl(s_[1] * 5, 7) * 9, t = s_[1] << 17;
+      s_[2] ^= s_[0];
+      s_[3] ^= s_[1];
+      s_[1] ^= s_[2];
+      s_[0] ^= s_[3];
+      s_[2] ^= t;
+      s_[3] = rotl(s_[3], 45);
+      return result;
+    }
+
+    //! @brief Advance the stream by 2^128 values.  Jumping copies of one generator different
+    //!        numbers of times gives non-overlapping streams for parallel workers.
+    //!
+    void jump ()
+    {
+      static const uint64_t poly[4] = { 0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL,
+                                        0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL };
+      uint64_t t[4] = { 0, 0, 0, 0 };
+      for (int i = 0; i < 4; ++i)
+      {
+        for (int b = 0; b < 64; ++b)
+        {
+          if (poly[i] & (1ULL << b))
+          {
+            for (int j = 0; j < 4; ++j)
+            {
+              t[j] ^= s_[j];
+            }
+          }
+          next();
+        }
+      }
+      memcpy(s_, t, sizeof(s_));
+      clearSpare();
+    }
+
+    //! @brief Copy of the state words
+    //!
+    void state (uint64_t out[4]) const
+    {
+      memcpy(out, s_, sizeof(s_));
+    }
+
+  private:
+    static uint64_t rotl (uint64_t x, int k)
+    {
+      return (x << k) | (x >> (64 - k));
+    }
+
+    uint64_t s_[4];
+  };
+
+
+  //! @brief PCG32 (XSH RR) generator:  64 bits of state, 2^63 selectable streams
+  //!
+  class Pcg32 : public RandomDist<Pcg32>
+  {
+  public:
+    //! @brief Constructor
+    //!
+    //! @param seed   Starting state
+    //! @param stream Stream selector; generators with different streams never overlap
+    //!
+    explicit Pcg32 (uint64_t seed = 0x853C49E6748FEA9BULL, uint64_t stream = 0xDA3E39CB94B95BDBULL)
+    {
+      this->seed(seed, stream);
+    }
+
+    //! @brief Restart the stream
+    //!
+    void seed (uint64_t seed, uint64_t stream = 0xDA3E39CB94B95BDBULL)
+    {
+      state_ = 0;
+      inc_ = (stream << 1) | 1;
+      next32();
+      state_ += seed;
+      next32();
+      clearSpare();
+    }
+
+    //! @brief Next 32 random bits
+    //!
+    uint32_t next32 ()
+    {
+      uint64_t old = state_;
+      state_ = (old * 6364136223846793005ULL) + inc_;
+      uint32_t xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+      uint32_t rot = (uint32_t)(old >> 59);
+      return (xorshifted >> rot) | (xorshifted << ((0 - rot) & 31));
+    }
+
+    //! @brief Next 64 random bits (two 32-bit outputs, high word first)
+    //!
+    uint64_t next ()
+    {
+      uint64_t hi = next32();
+      return (hi << 32) | next32();
+    }
+
+  private:
+    uint64_t state_;
+    uint64_t inc_;
+  };
+
+
+  //! @brief Four interleaved xoshiro256** streams, advanced together in SIMD registers (AVX2 or
+  //!        SSE2 when available) to fill large arrays.  The lanes are one seeded stream jumped
+  //!        0, 1, 2, and 3 times, so they never overlap.
+  //!
+  class Xoshiro256x4
+  {
+  public:
+    //! @brief Constructor
+    //!
+    //! @param seed Any 64-bit value; equal seeds give equal fills
+    //!
+    explicit Xoshiro256x4 (uint64_t seed = 0x853C49E6748FEA9BULL)
+    {
+      this->seed(seed);
+    }
+
+    //! @brief Restart the streams from a seed
+    //!
+    void seed (uint64_t seed)
+    {
+      Xoshiro256 base(seed);
+      uint64_t words[4];
+      for (int lane = 0; lane < 4; ++lane)
+      {
+        base.state(words);
+        for (int w = 0; w < 4; ++w)
+        {
+          s_[w][lane] = words[w];
+        }
+        base.jump();
+      }
+    }
+
+    //! @brief Next 64 random bits of each lane
+    //!
+    //! @param out Four values, lane order
+    //!
+    void next (uint64_t out[4])
+    {
+#if defined(__AVX2__)
+      __m256i s0 = _mm256_loadu_si256((const __m256i *)s_[0]),
+              s1 = _mm256_loadu_si256((const __m256i *)s_[1]),
+              s2 = _mm256_loadu_si256((const __m256i *)s_[2]),
+              s3 = _mm256_loadu_si256((const __m256i *)s_[3]);
+
+      //! rotl(s1 * 5, 7) * 9, with the multiplies as shifts and adds
+      __m256i r = _mm256_add_epi64(s1, _mm256_slli_epi64(s1, 2));
+      r = _mm256_or_si256(_mm256_slli_epi64(r, 7), _mm256_srli_epi64(r, 57));
+      r = _mm256_add_epi64(r, _mm256_slli_epi64(r, 3));
+
+      __m256i t = _mm256_slli_epi64(s1, 17);
+      s2 = _mm256_xor_si256(s2, s0);
+      s3 = _mm256_xor_si256(s3, s1);
+      s1 = _mm256_xor_si256(s1, s2);
+      s0 = _mm256_xor_si256(s0, s3);
+      s2 = _mm256_xor_si256(s2, t);
+      s3 = _mm256_or_si256(_mm256_slli_epi64(s3, 45), _mm256_srli_epi64(s3, 19));
+
+      _mm256_storeu_si256((__m256i *)s_[0], s0);
+      _mm256_storeu_si256((__m256i *)s_[1], s1);
+      _mm256_storeu_si256((__m256i *)s_[2], s2);
+      _mm256_storeu_si256((__m256i *)s_[3], s3);
+      _mm256_storeu_si256((__m256i *)out, r);
+#elif defined(RANDOM_USE_SSE2)
+      for (int h = 0; h < 4; h += 2)
+      {
+        __m128i s0 = _mm_loadu_si128((const __m128i *)(s_[0] + h)),
+                s1 = _mm_loadu_si128((const __m128i *)(s_[1] + h)),
+                s2 = _mm_loadu_si128((const __m128i *)(s_[2] + h)),
+                s3 = _mm_loadu_si128((const __m128i *)(s_[3] + h));
+
+        __m128i r = _mm_add_epi64(s1, _mm_slli_epi64(s1, 2));
+        r = _mm_or_si128(_mm_slli_epi64(r, 7), _mm_srli_epi64(r, 57));
+        r = _mm_add_epi64(r, _mm_slli_epi64(r, 3));
+
+        __m128i t = _mm_slli_epi64(s1, 17);
+        s2 = _mm_xor_si128(s2, s0);
+        s3 = _mm_xor_si128(s3, s1);
+        s1 = _mm_xor_si128(s1, s2);
+        s0 = _mm_xor_si128(s0, s3);
+        s2 = _mm_xor_si128(s2, t);
+        s3 = _mm_or_si128(_mm_slli_epi64(s3, 45), _mm_srli_epi64(s3, 19));
+
+        _mm_storeu_si128((__m128i *)(s_[0] + h), s0);
+        _mm_storeu_si128((__m128i *)(s_[1] + h), s1);
+        _mm_storeu_si128((__m128i *)(s_[2] + h), s2);
+        _mm_storeu_si128((__m128i *)(s_[3] + h), s3);
+        _mm_storeu_si128((__m128i *)(out + h), r);
+      }
+#else
+      for (int lane = 0; lane < 4; ++lane)
+      {
+        uint64_t x = s_[1][lane] * 5, t = s_[1][lane] << 17;
+        x = (x << 7) | (x >> 57);
+        out[lane] = x * 9;
+        s_[2][lane] ^= s_[0][lane];
+        s_[3][lane] ^= s_[1][lane];
+        s_[1][lane] ^= s_[2][lane];
+        s_[0][lane] ^= s_[3][lane];
+        s_[2][lane] ^= t;
+        s_[3][lane] = (s_[3][lane] << 45) | (s_[3][lane] >> 19);
+      }
+#endif
+    }
+
+    //! @brief Fill an array with uniform doubles on [lo, hi) (52 bits of resolution)
+    //!
+    void fillUniform (double *out, size_t count, double lo = 0.0, double hi = 1.0)
+    {
+      uint64_t bits[4];
+      double scale = hi - lo;
+      size_t i = 0;
+
+      for (; i + 4 <= count; i += 4)
+      {
+        next(bits);
+        for (int lane = 0; lane < 4; ++lane)
+        {
+          out[i + lane] = lo + (scale * bitsToUnit(bits[lane]));
+        }
+      }
+      if (i < count)
+      {
+        next(bits);
+        for (int lane = 0; i < count; ++i, ++lane)
+        {
+          out[i] = lo + (scale * bitsToUnit(bits[lane]));
+        }
+      }
+    }
+
+    //! @brief Fill an array with Gaussian numbers (Box-Muller on pairs of uniform fills)
+    //!
+    void fillGaussian (double *out, size_t count, double mean = 0.0, double stddev = 1.0)
+    {
+      size_t i;
+      double r, s, c;
+
+      fillUniform(out, count);
+      for (i = 0; i + 1 < count; i += 2)
+      {
+        r = stddev * sqrt(-2.0 * log(1.0 - out[i]));
+        s = sin(6.283185307179586 * out[i + 1]);
+        c = cos(6.283185307179586 * out[i + 1]);
+        out[i] = mean + (r * c);
+        out[i + 1] = mean + (r * s);
+      }
+      if (i < count)
+      {
+        double extra;
+        fillUniform(&extra, 1);
+        r = stddev * sqrt(-2.0 * log(1.0 - out[i]));
+        out[i] = mean + (r * cos(6.283185307179586 * extra));
+      }
+    }
+
+  private:
+    //! @brief State words, s_[word][lane]
+    //!
+    uint64_t s_[4][4];
+  };
+
+
+  //! @brief Sobol low-discrepancy sequence in up to Sobol::maxDims dimensions (Joe-Kuo direction
+  //!        numbers, Gray code order).  The all-zero first point is skipped, so the sequence
+  //!        starts at (0.5, 0.5, ...).
+  //!
+  class Sobol
+  {
+  public:
+    //! @brief Largest supported number of dimensions
+    //!
+    static const int maxDims = 10;
+
+    //! @brief Constructor
+    //!
+    //! @param dims     Number of dimensions (1 to maxDims)
+    //! @param scramble 0 for the plain sequence; any other value applies a random digital shift
+    //!                 derived from it, so differently scrambled instances give independent
+    //!                 sequences with the same uniformity
+    //!
+    explicit Sobol (int dims = 2, uint64_t scramble = 0)
+    {
+      //! Degree, polynomial coefficients, and initial direction numbers of dimensions 2..10
+      static const int degree[maxDims - 1] = { 1, 2, 3, 3, 4, 4, 5, 5, 5 };
+      static const uint32_t poly[maxDims - 1] = { 0, 1, 1, 2, 1, 4, 2, 4, 7 };
+      static const uint32_t init[maxDims - 1][5] = { { 1 }, { 1, 3 }, { 1, 3, 1 }, { 1, 1, 1 },
+                                                     { 1, 1, 3, 3 }, { 1, 3, 5, 13 },
+                                                     { 1, 1, 5, 5, 17 }, { 1, 1, 5, 5, 5 },
+                                                     { 1, 1, 7, 11, 19 } };
+      int d, k, i, s;
+
+      dims_ = (dims < 1) ? 1 : ((dims > maxDims) ? maxDims : dims);
+
+      for (k = 0; k < 32; ++k)
+      {
+        v_[0][k] = 1U << (31 - k);
+      }
+      for (d = 1; d < dims_; ++d)
+      {
+        s = degree[d - 1];
+        for (k = 0; k < s; ++k)
+        {
+          v_[d][k] = init[d - 1][k] << (31 - k);
+        }
+        for (k = s; k < 32; ++k)
+        {
+          v_[d][k] = v_[d][k - s] ^ (v_[d][k - s] >> s);
+          for (i = 1; i < s; ++i)
+          {
+            if ((poly[d - 1] >> (s - 1 - i)) & 1)
+            {
+              v_[d][k] ^= v_[d][k - i];
+            }
+          }
+        }
+      }
+
+      Xoshiro256 rng(scramble);
+      for (d = 0; d < dims_; ++d)
+      {
+        shift_[d] = (scramble == 0) ? 0 : (uint32_t)(rng.next() >> 32);
+      }
+      reset();
+    }
+
+    //! @brief Restart the sequence
+    //!
+    void reset ()
+    {
+      index_ = 0;
+      for (int d = 0; d < dims_; ++d)
+      {
+        x_[d] = 0;
+      }
+    }
+
+    //! @brief Continue the sequence from a point, e.g., one saved when a search was interrupted.
+    //!        Costs as much as 32 calls to next, however far into the sequence the point is.
+    //!
+    //! @param index Number of points to skip from the start (the next call to next returns
+    //!              this point)
+    //!
+    void seek (uint32_t index)
+    {
+      //! After index points, x_ holds the direction numbers of the set bits of gray(index)
+      uint32_t gray = index ^ (index >> 1);
+      index_ = index;
+      for (int d = 0; d < dims_; ++d)
+      {
+        x_[d] = 0;
+        for (int k = 0; gray >> k; ++k)
+        {
+          if ((gray >> k) & 1)
+          {
+            x_[d] ^= v_[d][k];
+          }
+        }
+      }
+    }
+
+    //! @brief Index of the point the next call to next returns
+    //!
+    uint32_t index () const
+    {
+      return index_;
+    }
+
+    //! @brief Next point of the sequence
+    //!
+    //! @param out dims() values on [0, 1)
+    //!
+    void next (double *out)
+    {
+      //! Gray code:  flip the direction number of the lowest zero bit of the index
+      int c = 0;
+      uint32_t i = index_++;
+      while (i & 1)
+      {
+        i >>= 1;
+        ++c;
+      }
+      c = (c > 31) ? 31 : c;
+      for (int d = 0; d < dims_; ++d)
+      {
+        x_[d] ^= v_[d][c];
+        out[d] = (double)(x_[d] ^ shift_[d]) * (1.0 / 4294967296.0);
+      }
+    }
+
+    //! @brief Next points of the sequence
+    //!
+    //! @param out   count * dims() values on [0, 1), one point after another
+    //! @param count Number of points
+    //!
+    void fill (double *out, size_t count)
+    {
+      uint32_t x[maxDims], i;
+      int c, d;
+
+      //! The same Gray code updates as next, with the state kept local for the whole run
+      memcpy(x, x_, sizeof(x));
+      for (size_t n = 0; n < count; ++n, out += dims_)
+      {
+        for (c = 0, i = index_++; (i & 1) && c < 31; i >>= 1)
+        {
+          ++c;
+        }
+        for (d = 0; d < dims_; ++d)
+        {
+          x[d] ^= v_[d][c];
+          out[d] = (double)(x[d] ^ shift_[d]) * (1.0 / 4294967296.0);
+        }
+      }
+      memcpy(x_, x, sizeof(x));
+    }
+
+    //! @brief Number of dimensions
+    //!
+    int dims () const
+    {
+      return dims_;
+    }
+
+  private:
+    //! @brief Dimensions, points generated, current point, per-dimension shift, and direction
+    //!        numbers
+    //!
+    int dims_;
+    uint32_t index_;
+    uint32_t x_[maxDims];
+    uint32_t shift_[maxDims];
+    uint32_t v_[maxDims][32];
+  };
+
+
+  //! @brief Halton low-discrepancy sequence in up to Halton::maxDims dimensions (the radical
+  //!        inverses of the index in the first prime bases).  As for Sobol, the all-zero first
+  //!        point is skipped.
+  //!
+  //! @note Even dimensions of larger bases correlate over short runs; keep to a few dimensions,
+  //!       or use Sobol, when the sequence is not long.
+  //!
+  class Halton
+  {
+  public:
+    //! @brief Largest supported number of dimensions, and the most base-2 digits of an index
+    //!
+    static const int maxDims = 10;
+    static const int maxDigits = 32;
+
+    //! @brief Constructor
+    //!
+    //! @param dims Number of dimensions (1 to maxDims)
+    //!
+    explicit Halton (int dims = 2)
+    {
+      static const uint32_t primes[maxDims] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29 };
+      int d, k;
+
+      dims_ = (dims < 1) ? 1 : ((dims > maxDims) ? maxDims : dims);
+      for (d = 0; d < dims_; ++d)
+      {
+        base_[d] = primes[d];
+        scale_[d][0] = 1.0 / base_[d];
+        for (k = 1; k < maxDigits; ++k)
+        {
+          scale_[d][k] = scale_[d][k - 1] / base_[d];
+        }
+      }
+      reset();
+    }
+
+    //! @brief Restart the sequence
+    //!
+    void reset ()
+    {
+      seek(0);
+    }
+
+    //! @brief Continue the sequence from a point
+    //!
+    //! @param index Number of points to skip from the start (the next call to next returns
+    //!              this point)
+    //!
+    void seek (uint32_t index)
+    {
+      uint32_t n;
+      int d, k;
+
+      //! The sequence proper starts at 1; next steps to the point it returns
+      index_ = index;
+      for (d = 0; d < dims_; ++d)
+      {
+        x_[d] = 0.0;
+        for (n = index, k = 0; k < maxDigits; ++k, n /= base_[d])
+        {
+          digit_[d][k] = n % base_[d];
+          x_[d] += digit_[d][k] * scale_[d][k];
+        }
+      }
+    }
+
+    //! @brief Index of the point the next call to next returns
+    //!
+    uint32_t index () const
+    {
+      return index_;
+    }
+
+    //! @brief Next point of the sequence
+    //!
+    //! @param out dims() values on [0, 1)
+    //!
+    void next (double *out)
+    {
+      fill(out, 1);
+    }
+
+    //! @brief Next points of the sequence
+    //!
+    //! @param out   count * dims() values on [0, 1), one point after another
+    //! @param count Number of points
+    //!
+    void fill (double *out, size_t count)
+    {
+      int d, k;
+
+      for (size_t n = 0; n < count; ++n, out += dims_)
+      {
+        ++index_;
+        for (d = 0; d < dims_; ++d)
+        {
+          //! Add one to the digits, least significant first; the value changes only by the
+          //! digits that carry, so a point costs one digit update on average
+          for (k = 0; k < maxDigits && digit_[d][k] == base_[d] - 1; ++k)
+          {
+            digit_[d][k] = 0;
+            x_[d] -= (base_[d] - 1) * scale_[d][k];
+          }
+          if (k < maxDigits)
+          {
+            ++digit_[d][k];
+            x_[d] += scale_[d][k];
+          }
+          //! Rounding in the running sum must not reach 1
+          x_[d] = (x_[d] < 0.0) ? 0.0 : x_[d];
+          out[d] = (x_[d] < 1.0) ? x_[d] : 0.9999999999999999;
+        }
+      }
+    }
+
+    //! @brief Number of dimensions
+    //!
+    int dims () const
+    {
+      return dims_;
+    }
+
+  private:
+    //! @brief Dimensions, points generated, current point, its digits, and the weight of each
+    //!        digit place
+    //!
+    int dims_;
+    uint32_t index_;
+    double x_[maxDims];
+    uint32_t base_[maxDims];
+    uint32_t digit_[maxDims][maxDigits];
+    double scale_[maxDims][maxDigits];
+  };
+} // namespace Math
+
+#endif
@@ -0,0 +1,362 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Math
+//  Workfile:        RegistrationMap.cpp
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Precompiled, spatially varying registration lookup table.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RegistrationMap.h"
+#include "KDTree.h"
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <stdint.h>
+#ifndef WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Math
+{
+  //! @brief File tag and header size (tag, four uint32, four doubles)
+  //!
+  static const char registrationMapTag[8] = {'C', 'R', 'P', 'I', 'M', 'A', 'P', '1'};
+  static const size_t registrationMapHeader = 8 + (4 * sizeof(uint32_t)) + (4 * sizeof(double));
+
+  //! @brief Limit on the number of grid vertices (12 doubles each)
+  //!
+  static const uint64_t registrationMapMaxVertices = 1ULL << 26;
+
+
+  LIBRARY_API RegistrationMap::RegistrationMap () :
+    spacing_(0.0),
+    cells_(NULL),
+    mapped_(NULL),
+    mappedSize_(0)
+  {
+    counts_[0] = counts_[1] = counts_[2] = 0;
+    origin_[0] = origin_[1] = origin_[2] = 0.0;
+  }
+
+
+  LIBRARY_API RegistrationMap::~RegistrationMap ()
+  {
+    unmap();
+  }
+
+
+  LIBRARY_API bool RegistrationMap::build (vector<point> &kernels, vector<matrix> &transforms,
+                                           const point &lower, const point &upper,
+                                           double spacing)
+  {
+    double lo[3] = {lower.x, lower.y, lower.z}, hi[3] = {upper.x, upper.y, upper.z};
+    double pos[3], dist, secondDist, w, *cell;
+    vector<double> centers;
+    uint64_t vertices = 1;
+    int i, j, k, n, first, second;
+    KDTree index;
+
+    clear();
+    n = (int)kernels.size();
+    if (n < 1 || transforms.size() != kernels.size() || !(spacing > 0.0))
+    {
+      return false;
+    }
+    for (i = 0; i < n; ++i)
+    {
+      if (transforms[i].rows != 4 || transforms[i].cols != 4)
+      {
+        return false;
+      }
+      centers.push_back(kernels[i].x);
+      centers.push_back(kernels[i].y);
+      centers.push_back(kernels[i].z);
+    }
+    for (j = 0; j < 3; ++j)
+    {
+      if (!(hi[j] >= lo[j]))
+      {
+        return false;
+      }
+      counts_[j] = (int)ceil((hi[j] - lo[j]) / spacing) + 1;
+      vertices *= (uint64_t)counts_[j];
+      origin_[j] = lo[j];
+    }
+    if (vertices > registrationMapMaxVertices)
+    {
+      counts_[0] = counts_[1] = counts_[2] = 0;
+      return false;
+    }
+    spacing_ = spacing;
+    index.build(&centers[0], n, 3);
+
+    //! Each vertex blends its two nearest registrations by inverse distance
+    owned_.resize((size_t)vertices * 12);
+    cell = &owned_[0];
+    for (k = 0; k < counts_[2]; ++k)
+    {
+      pos[2] = origin_[2] + (k * spacing_);
+      for (j = 0; j < counts_[1]; ++j)
+      {
+        pos[1] = origin_[1] + (j * spacing_);
+        for (i = 0; i < counts_[0]; ++i, cell += 12)
+        {
+          pos[0] = origin_[0] + (i * spacing_);
+          first = index.nearestTwo(pos, second, &dist, &secondDist);
+          w = (second < 0 || (dist + secondDist) <= 0.0) ? 1.0 : secondDist / (dist + secondDist);
+          for (int r = 0; r < 3; ++r)
+          {
+            for (int c = 0; c < 4; ++c)
+            {
+              cell[(r * 4) + c] = w * transforms[first].at(r, c);
+              if (second >= 0)
+              {
+                cell[(r * 4) + c] += (1.0 - w) * transforms[second].at(r, c);
+              }
+            }
+          }
+        }
+      }
+    }
+    cells_ = &owned_[0];
+    return true;
+  }
+
+
+  LIBRARY_API bool RegistrationMap::save (const char *fname) const
+  {
+    uint32_t dims[4];
+    double geometry[4] = {origin_[0], origin_[1], origin_[2], spacing_};
+    size_t values;
+    bool state;
+    FILE *out;
+
+    if (!valid() || (out = fopen(fname, "wb")) == NULL)
+    {
+      return false;
+    }
+    dims[0] = (uint32_t)counts_[0];
+    dims[1] = (uint32_t)counts_[1];
+    dims[2] = (uint32_t)counts_[2];
+    dims[3] = 0;
+    values = (size_t)counts_[0] * counts_[1] * counts_[2] * 12;
+
+    state = (fwrite(registrationMapTag, 1, sizeof(registrationMapTag), out) == sizeof(registrationMapTag));
+    state = state && (fwrite(dims, sizeof(uint32_t), 4, out) == 4);
+    state = state && (fwrite(geometry, sizeof(double), 4, out) == 4);
+    state = state && (fwrite(cells_, sizeof(double), values, out) == values);
+    state = (fclose(out) == 0) && state;
+    return state;
+  }
+
+
+  LIBRARY_API bool RegistrationMap::load (const char *fname)
+  {
+    const char *data = NULL;
+    size_t size = 0;
+    uint32_t dims[4];
+    double geometry[4];
+    uint64_t vertices;
+
+    clear();
+#ifdef WIN32
+    LARGE_INTEGER length;
+    HANDLE file, mapping;
+    file = CreateFileA(fname, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+      return false;
+    }
+    if (GetFileSizeEx(file, &length) && length.QuadPart > 0)
+    {
+      mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+      if (mapping != NULL)
+      {
+        //! The view keeps the mapping alive once the handles are closed
+        data = (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        size = (data == NULL) ? 0 : (size_t)length.QuadPart;
+        CloseHandle(mapping);
+      }
+    }
+    CloseHandle(file);
+#else
+    struct stat info;
+    void *ptr;
+    int file = open(fname, O_RDONLY);
+    if (file < 0)
+    {
+      return false;
+    }
+    if (fstat(file, &info) == 0 && info.st_size > 0)
+    {
+      //! The mapping outlives the descriptor
+      ptr = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+      if (ptr != MAP_FAILED)
+      {
+        data = (const char *)ptr;
+        size = (size_t)info.st_size;
+      }
+    }
+    close(file);
+#endif
+    if (data == NULL)
+    {
+      return false;
+    }
+    mapped_ = data;
+    mappedSize_ = size;
+
+    if (size < registrationMapHeader || memcmp(data, registrationMapTag, sizeof(registrationMapTag)) != 0)
+    {
+      unmap();
+      return false;
+    }
+    memcpy(dims, data + 8, sizeof(dims));
+    memcpy(geometry, data + 8 + sizeof(dims), sizeof(geometry));
+    vertices = (uint64_t)dims[0] * dims[1] * dims[2];
+    if (vertices == 0 || vertices > registrationMapMaxVertices || !(geometry[3] > 0.0) ||
+        (size - registrationMapHeader) / (12 * sizeof(double)) < vertices)
+    {
+      unmap();
+      return false;
+    }
+
+    counts_[0] = (int)dims[0];
+    counts_[1] = (int)dims[1];
+    counts_[2] = (int)dims[2];
+    origin_[0] = geometry[0];
+    origin_[1] = geometry[1];
+    origin_[2] = geometry[2];
+    spacing_ = geometry[3];
+
+    //! The header is a multiple of 8 bytes, so the values are aligned within the page
+    cells_ = (const double *)(data + registrationMapHeader);
+    return true;
+  }
+
+
+  LIBRARY_API void RegistrationMap::clear ()
+  {
+    unmap();
+    owned_.clear();
+    cells_ = NULL;
+    counts_[0] = counts_[1] = counts_[2] = 0;
+    spacing_ = 0.0;
+  }
+
+
+  LIBRARY_API bool RegistrationMap::valid () const
+  {
+    return cells_ != NULL;
+  }
+
+
+  LIBRARY_API bool RegistrationMap::lookup (const point &pos, Mat4 &t) const
+  {
+    double p[3] = {pos.x, pos.y, pos.z}, f[3], blend[12], w, len, dot;
+    size_t cell[3], step[3];
+    int j, c, corner;
+
+    if (!valid())
+    {
+      return false;
+    }
+
+    //! Cell containing the (clamped) position, and the position within it
+    for (j = 0; j < 3; ++j)
+    {
+      double u = (p[j] - origin_[j]) / spacing_;
+      double top = (double)(counts_[j] - 1);
+      u = (u < 0.0) ? 0.0 : ((u > top) ? top : u);
+      cell[j] = (size_t)u;
+      if (cell[j] + 1 >= (size_t)counts_[j])
+      {
+        cell[j] = (counts_[j] > 1) ? (size_t)(counts_[j] - 2) : 0;
+      }
+      f[j] = u - (double)cell[j];
+      step[j] = (counts_[j] > 1) ? 1 : 0;
+    }
+
+    //! Trilinear blend of the eight surrounding vertices
+    for (c = 0; c < 12; ++c)
+    {
+      blend[c] = 0.0;
+    }
+    for (corner = 0; corner < 8; ++corner)
+    {
+      size_t ix = cell[0] + ((corner & 1) ? step[0] : 0);
+      size_t iy = cell[1] + ((corner & 2) ? step[1] : 0);
+      size_t iz = cell[2] + ((corner & 4) ? step[2] : 0);
+      const double *v = cells_ + ((((iz * counts_[1]) + iy) * counts_[0]) + ix) * 12;
+      w = ((corner & 1) ? f[0] : 1.0 - f[0]) *
+          ((corner & 2) ? f[1] : 1.0 - f[1]) *
+          ((corner & 4) ? f[2] : 1.0 - f[2]);
+      for (c = 0; c < 12; ++c)
+      {
+        blend[c] += w * v[c];
+      }
+    }
+
+    //! Blending rotations leaves them slightly non-orthogonal:  Gram-Schmidt the first two
+    //! rows and take the third as their cross product
+    len = sqrt((blend[0] * blend[0]) + (blend[1] * blend[1]) + (blend[2] * blend[2]));
+    if (len > 0.0)
+    {
+      blend[0] /= len;
+      blend[1] /= len;
+      blend[2] /= len;
+    }
+    dot = (blend[0] * blend[4]) + (blend[1] * blend[5]) + (blend[2] * blend[6]);
+    blend[4] -= dot * blend[0];
+    blend[5] -= dot * blend[1];
+    blend[6] -= dot * blend[2];
+    len = sqrt((blend[4] * blend[4]) + (blend[5] * blend[5]) + (blend[6] * blend[6]));
+    if (len > 0.0)
+    {
+      blend[4] /= len;
+      blend[5] /= len;
+      blend[6] /= len;
+    }
+    blend[8] = (blend[1] * blend[6]) - (blend[2] * blend[5]);
+    blend[9] = (blend[2] * blend[4]) - (blend[0] * blend[6]);
+    blend[10] = (blend[0] * blend[5]) - (blend[1] * blend[4]);
+
+    for (j = 0; j < 3; ++j)
+    {
+      for (c = 0; c < 4; ++c)
+      {
+        t.at(j, c) = blend[(j * 4) + c];
+      }
+    }
+    t.at(3, 0) = t.at(3, 1) = t.at(3, 2) = 0.0;
+    t.at(3, 3) = 1.0;
+    return true;
+  }
+
+
+  void RegistrationMap::unmap ()
+  {
+    if (mapped_ == NULL)
+    {
+      return;
+    }
+#ifdef WIN32
+    UnmapViewOfFile(mapped_);
+#else
+    munmap((void *)mapped_, mappedSize_);
+#endif
+    mapped_ = NULL;
+    mappedSize_ = 0;
+    cells_ = NULL;
+  }
+} // namespace Math
@@ -0,0 +1,126 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Math
+//  Workfile:        RegistrationMap.h
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Precompiled, spatially varying registration:  a regular grid of blended
+//  local transformations, interpolated trilinearly and stored in a file that
+//  is memory mapped at load time.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MATH_REGISTRATIONMAP_H
+#define MATH_REGISTRATIONMAP_H
+
+#include "../../portable.h"
+#include <vector>
+#include "MatrixMath.h"
+
+using namespace std;
+
+namespace Math
+{
+  //! @ingroup Math
+  //!
+  //! @brief Lookup table of local registrations (e.g., the kernels and matrices produced by
+  //!        Registration::reg2targetML) sampled on a regular grid over the work volume.  Each
+  //!        grid vertex holds the upper 3x4 block of a transformation blended from the two
+  //!        nearest local registrations; a query interpolates the eight vertices around it and
+  //!        re-orthonormalizes the rotation, so the cost per query is constant and no kernel
+  //!        search (or clustering library) is needed at runtime.
+  //!
+  //!        File layout (native byte order):  the 8-byte tag "CRPIMAP1", uint32 grid counts
+  //!        along x, y, and z, a uint32 0, the double grid origin (x, y, z) and spacing, and
+  //!        then 12 doubles per vertex with x varying fastest.
+  //!
+  class LIBRARY_API RegistrationMap
+  {
+  public:
+    //! @brief Default constructor (empty map)
+    //!
+    RegistrationMap ();
+
+    //! @brief Default destructor
+    //!
+    ~RegistrationMap ();
+
+    //! @brief Sample a set of local registrations over a box
+    //!
+    //! @param kernels    The centers of the local registrations, in the input frame of the
+    //!                   transformations
+    //! @param transforms The 4x4 local transformations (same order as kernels)
+    //! @param lower      The lower corner of the box to cover
+    //! @param upper      The upper corner of the box to cover
+    //! @param spacing    The distance between grid vertices
+    //!
+    //! @return True if the map was built, false if the arguments are inconsistent or the
+    //!         grid would be too large
+    //!
+    bool build (vector<point> &kernels, vector<matrix> &transforms, const point &lower,
+                const point &upper, double spacing);
+
+    //! @brief Write the map to disk
+    //!
+    //! @return True if the file was written, false otherwise
+    //!
+    bool save (const char *fname) const;
+
+    //! @brief Map a file written by save
+    //!
+    //! @return True if the file is a valid map, false otherwise (the map is left empty)
+    //!
+    bool load (const char *fname);
+
+    //! @brief Discard the map
+    //!
+    void clear ();
+
+    //! @brief Whether the map holds any registrations
+    //!
+    bool valid () const;
+
+    //! @brief Interpolate the registration at a position.  Positions outside the grid use the
+    //!        nearest point on its boundary.
+    //!
+    //! @param pos The query position (in the input frame)
+    //! @param t   The interpolated rigid transformation
+    //!
+    //! @return True if the map is valid, false otherwise
+    //!
+    bool lookup (const point &pos, Mat4 &t) const;
+
+  private:
+    RegistrationMap (const RegistrationMap &) = delete;
+    RegistrationMap &operator= (const RegistrationMap &) = delete;
+
+    //! @brief Release a file mapping (if any)
+    //!
+    void unmap ();
+
+    //! @brief Grid counts along each axis
+    //!
+    int counts_[3];
+
+    //! @brief Position of vertex (0, 0, 0) and distance between vertices
+    //!
+    double origin_[3];
+    double spacing_;
+
+    //! @brief 12 values per vertex, in owned_ or in the mapped file
+    //!
+    const double *cells_;
+    vector<double> owned_;
+
+    //! @brief Mapped file (NULL when the map was built in memory)
+    //!
+    const char *mapped_;
+    size_t mappedSize_;
+  };
+} // namespace Math
+
+#endif
@@ -0,0 +1,439 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Math
+//  Workfile:        RotationMath.h
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Conversions between roll-pitch-yaw, quaternion, and rotation matrix
+//  representations, using fixed-size storage and fused sine/cosine calls.
+//  Roll-pitch-yaw angles follow the same convention as
+//  matrix::RPYMatrixConvert (R = Rz(zr) * Ry(yr) * Rx(xr)).
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef ROTATION_MATH_H
+#define ROTATION_MATH_H
+
+#include <cstddef>
+#include "VectorMath.h"
+#include "MatrixMath.h"
+
+namespace Math
+{
+  //! @brief Unit quaternion (w, x, y, z)
+  //!
+  struct quaternion
+  {
+    double w;
+    double x;
+    double y;
+    double z;
+
+    //! @brief Default constructor (identity rotation)
+    //!
+    constexpr quaternion () :
+      w(1.0),
+      x(0.0),
+      y(0.0),
+      z(0.0)
+    {
+    }
+
+    //! @brief Assignment constructor
+    //!
+    constexpr quaternion (double qw, double qx, double qy, double qz) :
+      w(qw),
+      x(qx),
+      y(qy),
+      z(qz)
+    {
+    }
+
+    //! @brief Quaternion product (this rotation followed by q, expressed in this frame)
+    //!
+    constexpr quaternion operator* (const quaternion &q) const
+    {
+      return quaternion ((w * q.w) - (x * q.x) - (y * q.y) - (z * q.z),
+                         (w * q.x) + (x * q.w) + (y * q.z) - (z * q.y),
+                         (w * q.y) - (x * q.z) + (y * q.w) + (z * q.x),
+                         (w * q.z) + (x * q.y) - (y * q.x) + (z * q.w));
+    }
+
+    //! @brief Inverse rotation
+    //!
+    constexpr quaternion conjugate () const
+    {
+      return quaternion (w, -x, -y, -z);
+    }
+
+    //! @brief Rescale to unit length
+    //!
+    void normalize ()
+    {
+      double n = sqrt((w * w) + (x * x) + (y * y) + (z * z));
+      if (n > 0.0)
+      {
+        w /= n;
+        x /= n;
+        y /= n;
+        z /= n;
+      }
+    }
+
+    //! @brief Rotate a point by this quaternion
+    //!
+    point rotate (const point &p) const
+    {
+      //! v' = v + 2w(q x v) + 2q x (q x v)
+      double tx = 2.0 * ((y * p.z) - (z * p.y)),
+             ty = 2.0 * ((z * p.x) - (x * p.z)),
+             tz = 2.0 * ((x * p.y) - (y * p.x));
+      return point (p.x + (w * tx) + ((y * tz) - (z * ty)),
+                    p.y + (w * ty) + ((z * tx) - (x * tz)),
+                    p.z + (w * tz) + ((x * ty) - (y * tx)));
+    }
+  };
+
+
+  //! @brief Pose with a quaternion orientation (a rigid transformation).  Composing and
+  //!        inverting poses in this form avoids converting through roll-pitch-yaw angles at
+  //!        every step; convert a pose once, chain the transformations, and convert back.
+  //!
+  struct qpose
+  {
+    //! @brief Cartesian position
+    //!
+    point position;
+
+    //! @brief Orientation
+    //!
+    quaternion orientation;
+
+    //! @brief Default constructor (identity transformation)
+    //!
+    qpose ()
+    {
+    }
+
+    //! @brief Assignment constructor
+    //!
+    qpose (const point &p, const quaternion &q) :
+      position(p),
+      orientation(q)
+    {
+    }
+
+    //! @brief Convert a roll-pitch-yaw pose (see toQPose)
+    //!
+    qpose (const pose &in, bool useDegrees);
+
+    //! @brief Convert to a roll-pitch-yaw pose (see fromQPose)
+    //!
+    pose toPose (bool useDegrees) const;
+
+    //! @brief Transform a point from this pose's frame to the parent frame
+    //!
+    point operator* (const point &p) const
+    {
+      return position + orientation.rotate(p);
+    }
+
+    //! @brief Pose composition (apply p in the frame of this pose)
+    //!
+    qpose operator* (const qpose &p) const
+    {
+      return qpose(position + orientation.rotate(p.position), orientation * p.orientation);
+    }
+
+    //! @brief Inverse pose
+    //!
+    qpose inverse () const
+    {
+      quaternion inv = orientation.conjugate();
+      return qpose(inv.rotate(position) * -1.0, inv);
+    }
+  };
+
+
+  //! @brief Convert roll-pitch-yaw angles to a quaternion
+  //!
+  //! @param xr         Rotation about X
+  //! @param yr         Rotation about Y
+  //! @param zr         Rotation about Z
+  //! @param useDegrees Whether the angles are given in degrees (true) or radians (false)
+  //!
+  //! @return The equivalent unit quaternion
+  //!
+  inline quaternion RPYToQuaternion (double xr, double yr, double zr, bool useDegrees)
+  {
+    double sr, cr, sp, cp, sy, cy;
+    double half = useDegrees ? (3.14159265358979323846 / 360.0) : 0.5;
+
+    sinCos(xr * half, sr, cr);
+    sinCos(yr * half, sp, cp);
+    sinCos(zr * half, sy, cy);
+
+    return quaternion ((cr * cp * cy) + (sr * sp * sy),
+                       (sr * cp * cy) - (cr * sp * sy),
+                       (cr * sp * cy) + (sr * cp * sy),
+                       (cr * cp * sy) - (sr * sp * cy));
+  }
+
+
+  //! @brief Convert a quaternion to roll-pitch-yaw angles, with the same gimbal lock handling as
+  //!        matrix::matrixRPYConvert
+  //!
+  //! @param q          The unit quaternion to convert
+  //! @param xr         Rotation about X
+  //! @param yr         Rotation about Y
+  //! @param zr         Rotation about Z
+  //! @param useDegrees Whether the angles are reported in degrees (true) or radians (false)
+  //!
+  inline void quaternionToRPY (const quaternion &q, double &xr, double &yr, double &zr, bool useDegrees)
+  {
+    //! Only the rotation matrix elements used by the extraction are formed
+    double r00 = 1.0 - 2.0 * ((q.y * q.y) + (q.z * q.z)),
+           r10 = 2.0 * ((q.x * q.y) + (q.w * q.z)),
+           r20 = 2.0 * ((q.x * q.z) - (q.w * q.y)),
+           r21 = 2.0 * ((q.y * q.z) + (q.w * q.x)),
+           r22 = 1.0 - 2.0 * ((q.x * q.x) + (q.y * q.y)),
+           r01 = 2.0 * ((q.x * q.y) - (q.w * q.z)),
+           r11 = 1.0 - 2.0 * ((q.x * q.x) + (q.z * q.z));
+
+    yr = atan2(-r20, sqrt((r00 * r00) + (r10 * r10)));
+
+    if (fabs(yr - 1.57079632679489661923) < 1.0e-4)
+    {
+      xr = atan2(r01, r11);
+      yr = 1.57079632679489661923;
+      zr = 0.0;
+    }
+    else if (fabs(yr + 1.57079632679489661923) < 1.0e-4)
+    {
+      xr = -atan2(r01, r11);
+      yr = -1.57079632679489661923;
+      zr = 0.0;
+    }
+    else
+    {
+      xr = atan2(r21, r22);
+      zr = atan2(r10, r00);
+    }
+
+    if (useDegrees)
+    {
+      xr *= (180.0 / 3.14159265358979323846);
+      yr *= (180.0 / 3.14159265358979323846);
+      zr *= (180.0 / 3.14159265358979323846);
+    }
+  }
+
+
+  //! @brief Convert a quaternion to a rotation matrix (upper 3x3 block of out)
+  //!
+  template <int R, int C, class T> inline void quaternionToMatrix (const quaternion &q, Mat<R, C, T> &out)
+  {
+    out.at(0, 0) = 1.0 - 2.0 * ((q.y * q.y) + (q.z * q.z));
+    out.at(0, 1) = 2.0 * ((q.x * q.y) - (q.w * q.z));
+    out.at(0, 2) = 2.0 * ((q.x * q.z) + (q.w * q.y));
+    out.at(1, 0) = 2.0 * ((q.x * q.y) + (q.w * q.z));
+    out.at(1, 1) = 1.0 - 2.0 * ((q.x * q.x) + (q.z * q.z));
+    out.at(1, 2) = 2.0 * ((q.y * q.z) - (q.w * q.x));
+    out.at(2, 0) = 2.0 * ((q.x * q.z) - (q.w * q.y));
+    out.at(2, 1) = 2.0 * ((q.y * q.z) + (q.w * q.x));
+    out.at(2, 2) = 1.0 - 2.0 * ((q.x * q.x) + (q.y * q.y));
+  }
+
+
+  //! @brief Convert a rotation matrix (upper 3x3 block of m) to a quaternion.  Picks the largest
+  //!        diagonal term so that rotations near 180 degrees stay well conditioned.
+  //!
+  template <int R, int C, class T> inline quaternion matrixToQuaternion (const Mat<R, C, T> &m)
+  {
+    quaternion q;
+    double t = m.at(0, 0) + m.at(1, 1) + m.at(2, 2), s;
+
+    if (t > 0.0)
+    {
+      s = 0.5 / sqrt(t + 1.0);
+      q.w = 0.25 / s;
+      q.x = (m.at(2, 1) - m.at(1, 2)) * s;
+      q.y = (m.at(0, 2) - m.at(2, 0)) * s;
+      q.z = (m.at(1, 0) - m.at(0, 1)) * s;
+    }
+    else if (m.at(0, 0) > m.at(1, 1) && m.at(0, 0) > m.at(2, 2))
+    {
+      s = 2.0 * sqrt(1.0 + m.at(0, 0) - m.at(1, 1) - m.at(2, 2));
+      q.w = (m.at(2, 1) - m.at(1, 2)) / s;
+      q.x = 0.25 * s;
+      q.y = (m.at(0, 1) + m.at(1, 0)) / s;
+      q.z = (m.at(0, 2) + m.at(2, 0)) / s;
+    }
+    else if (m.at(1, 1) > m.at(2, 2))
+    {
+      s = 2.0 * sqrt(1.0 + m.at(1, 1) - m.at(0, 0) - m.at(2, 2));
+      q.w = (m.at(0, 2) - m.at(2, 0)) / s;
+      q.x = (m.at(0, 1) + m.at(1, 0)) / s;
+      q.y = 0.25 * s;
+      q.z = (m.at(1, 2) + m.at(2, 1)) / s;
+    }
+    else
+    {
+      s = 2.0 * sqrt(1.0 + m.at(2, 2) - m.at(0, 0) - m.at(1, 1));
+      q.w = (m.at(1, 0) - m.at(0, 1)) / s;
+      q.x = (m.at(0, 2) + m.at(2, 0)) / s;
+      q.y = (m.at(1, 2) + m.at(2, 1)) / s;
+      q.z = 0.25 * s;
+    }
+    return q;
+  }
+
+
+  //! @brief Spherical linear interpolation between two unit quaternions, along the shorter arc
+  //!
+  //! @param a The orientation at u = 0
+  //! @param b The orientation at u = 1
+  //! @param u The interpolation parameter (values outside [0, 1] extrapolate)
+  //!
+  //! @return The interpolated unit quaternion
+  //!
+  inline quaternion slerp (const quaternion &a, const quaternion &b, double u)
+  {
+    double d = (a.w * b.w) + (a.x * b.x) + (a.y * b.y) + (a.z * b.z);
+    double sign = (d < 0.0) ? -1.0 : 1.0, wa, wb, theta, s;
+    quaternion q;
+
+    //! q and -q are the same rotation:  flip b onto a's hemisphere
+    d *= sign;
+    if (d > 0.9995)
+    {
+      //! Nearly parallel:  sin(theta) vanishes, so blend linearly and renormalize
+      wa = 1.0 - u;
+      wb = u * sign;
+    }
+    else
+    {
+      theta = acos(d);
+      s = sin(theta);
+      wa = sin((1.0 - u) * theta) / s;
+      wb = sign * sin(u * theta) / s;
+    }
+    q.w = (wa * a.w) + (wb * b.w);
+    q.x = (wa * a.x) + (wb * b.x);
+    q.y = (wa * a.y) + (wb * b.y);
+    q.z = (wa * a.z) + (wb * b.z);
+    q.normalize();
+    return q;
+  }
+
+
+  //! @brief Interpolate between two poses:  linearly in position, spherically in orientation
+  //!
+  //! @param a The pose at u = 0
+  //! @param b The pose at u = 1
+  //! @param u The interpolation parameter
+  //!
+  inline qpose interpolate (const qpose &a, const qpose &b, double u)
+  {
+    return qpose(a.position + ((b.position - a.position) * u),
+                 slerp(a.orientation, b.orientation, u));
+  }
+
+
+  //! @brief Convert a roll-pitch-yaw pose to a quaternion pose
+  //!
+  inline qpose toQPose (const pose &in, bool useDegrees)
+  {
+    qpose out;
+    out.position = point(in.x, in.y, in.z);
+    out.orientation = RPYToQuaternion(in.xr, in.yr, in.zr, useDegrees);
+    return out;
+  }
+
+
+  //! @brief Convert a quaternion pose to a roll-pitch-yaw pose
+  //!
+  inline pose fromQPose (const qpose &in, bool useDegrees)
+  {
+    pose out;
+    out.x = in.position.x;
+    out.y = in.position.y;
+    out.z = in.position.z;
+    quaternionToRPY(in.orientation, out.xr, out.yr, out.zr, useDegrees);
+    return out;
+  }
+
+
+  inline qpose::qpose (const pose &in, bool useDegrees) :
+    position(in.x, in.y, in.z),
+    orientation(RPYToQuaternion(in.xr, in.yr, in.zr, useDegrees))
+  {
+  }
+
+
+  inline pose qpose::toPose (bool useDegrees) const
+  {
+    return fromQPose(*this, useDegrees);
+  }
+
+
+  //! @brief Convert a batch of roll-pitch-yaw poses to quaternion poses.  The loop body has no
+  //!        branches, so it vectorizes where the compiler provides vector sin/cos.
+  //!
+  //! @param in         The poses to convert
+  //! @param out        The converted poses
+  //! @param count      The number of poses in in and out
+  //! @param useDegrees Whether the angles are given in degrees (true) or radians (false)
+  //!
+  inline void RPYToQuaternionBatch (const pose *in, qpose *out, size_t count, bool useDegrees)
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      out[i].position = point(in[i].x, in[i].y, in[i].z);
+      out[i].orientation = RPYToQuaternion(in[i].xr, in[i].yr, in[i].zr, useDegrees);
+    }
+  }
+
+
+  //! @brief Convert a batch of quaternion poses to roll-pitch-yaw poses
+  //!
+  //! @param in         The poses to convert
+  //! @param out        The converted poses
+  //! @param count      The number of poses in in and out
+  //! @param useDegrees Whether the angles are reported in degrees (true) or radians (false)
+  //!
+  inline void quaternionToRPYBatch (const qpose *in, pose *out, size_t count, bool useDegrees)
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      out[i] = fromQPose(in[i], useDegrees);
+    }
+  }
+
+
+  //! @brief Convert a batch of roll-pitch-yaw poses to homogeneous transforms
+  //!
+  //! @param in         The poses to convert
+  //! @param out        The resulting transforms
+  //! @param count      The number of poses in in and out
+  //! @param useDegrees Whether the angles are given in degrees (true) or radians (false)
+  //!
+  inline void RPYMatrixBatch (const pose *in, Mat4 *out, size_t count, bool useDegrees)
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      out[i].RPYMatrixConvert(in[i], useDegrees);
+      out[i].at(0, 3) = in[i].x;
+      out[i].at(1, 3) = in[i].y;
+      out[i].at(2, 3) = in[i].z;
+      out[i].at(3, 0) = out[i].at(3, 1) = out[i].at(3, 2) = 0.0;
+      out[i].at(3, 3) = 1.0;
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,232 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Math
+//  Workfile:        Statistics.cpp
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Streaming (single pass) statistics of multivariate samples.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Statistics.h"
+#include <cfloat>
+
+namespace Math
+{
+  LIBRARY_API RunningStats::RunningStats (int dims) :
+    dims_(0),
+    count_(0)
+  {
+    reset((dims < 1) ? 1 : dims);
+  }
+
+
+  LIBRARY_API RunningStats::~RunningStats ()
+  {
+  }
+
+
+  LIBRARY_API void RunningStats::reset (int dims)
+  {
+    if (dims > 0)
+    {
+      dims_ = dims;
+    }
+    count_ = 0;
+    mean_.assign(dims_, 0.0);
+    comoment_.assign(dims_ * dims_, 0.0);
+    min_.assign(dims_, DBL_MAX);
+    max_.assign(dims_, -DBL_MAX);
+    delta_.assign(dims_, 0.0);
+  }
+
+
+  LIBRARY_API void RunningStats::add (const double *sample)
+  {
+    int i, j;
+    double n;
+
+    ++count_;
+    n = (double)count_;
+
+    //! Welford:  M2 += (x - old mean) (x - new mean)
+    for (i = 0; i < dims_; ++i)
+    {
+      delta_[i] = sample[i] - mean_[i];
+      mean_[i] += delta_[i] / n;
+      min_[i] = (sample[i] < min_[i]) ? sample[i] : min_[i];
+      max_[i] = (sample[i] > max_[i]) ? sample[i] : max_[i];
+    }
+    for (i = 0; i < dims_; ++i)
+    {
+      double *row = &comoment_[i * dims_];
+      for (j = i; j < dims_; ++j)
+      {
+        row[j] += delta_[i] * (sample[j] - mean_[j]);
+      }
+    }
+  }
+
+
+  LIBRARY_API bool RunningStats::add (const vector<double> &sample)
+  {
+    if ((int)sample.size() != dims_)
+    {
+      return false;
+    }
+    add(&sample[0]);
+    return true;
+  }
+
+
+  LIBRARY_API bool RunningStats::merge (const RunningStats &other)
+  {
+    int i, j;
+    double na, nb, n;
+
+    if (other.dims_ != dims_)
+    {
+      return false;
+    }
+    if (other.count_ == 0)
+    {
+      return true;
+    }
+    if (count_ == 0)
+    {
+      *this = other;
+      return true;
+    }
+
+    //! Chan et al.:  M2 = M2a + M2b + (mean_b - mean_a)(mean_b - mean_a)' na nb / n
+    na = (double)count_;
+    nb = (double)other.count_;
+    n = na + nb;
+    for (i = 0; i < dims_; ++i)
+    {
+      delta_[i] = other.mean_[i] - mean_[i];
+    }
+    for (i = 0; i < dims_; ++i)
+    {
+      for (j = i; j < dims_; ++j)
+      {
+        comoment_[i * dims_ + j] += other.comoment_[i * dims_ + j] +
+                                    (delta_[i] * delta_[j] * na * nb / n);
+      }
+      mean_[i] += delta_[i] * nb / n;
+      min_[i] = (other.min_[i] < min_[i]) ? other.min_[i] : min_[i];
+      max_[i] = (other.max_[i] > max_[i]) ? other.max_[i] : max_[i];
+    }
+    count_ += other.count_;
+    return true;
+  }
+
+
+  LIBRARY_API int RunningStats::dims () const
+  {
+    return dims_;
+  }
+
+
+  LIBRARY_API long long RunningStats::count () const
+  {
+    return count_;
+  }
+
+
+  LIBRARY_API double RunningStats::mean (int i) const
+  {
+    return mean_.at(i);
+  }
+
+
+  LIBRARY_API void RunningStats::mean (vector<double> &means) const
+  {
+    means = mean_;
+  }
+
+
+  LIBRARY_API double RunningStats::variance (int i, bool sample) const
+  {
+    return covariance(i, i, sample);
+  }
+
+
+  LIBRARY_API double RunningStats::stddev (int i, bool sample) const
+  {
+    return sqrt(variance(i, sample));
+  }
+
+
+  LIBRARY_API double RunningStats::covariance (int i, int j, bool sample) const
+  {
+    long long dof = sample ? count_ - 1 : count_;
+    return (dof > 0) ? comoment(i, j) / (double)dof : 0.0;
+  }
+
+
+  LIBRARY_API bool RunningStats::covariance (matrix &cov, bool sample) const
+  {
+    long long dof = sample ? count_ - 1 : count_;
+    int i, j;
+
+    cov.resize(dims_, dims_);
+    if (dof < 1)
+    {
+      cov.setAll(0.0);
+      return false;
+    }
+    for (i = 0; i < dims_; ++i)
+    {
+      for (j = i; j < dims_; ++j)
+      {
+        cov.at(i, j) = cov.at(j, i) = comoment_[i * dims_ + j] / (double)dof;
+      }
+    }
+    return true;
+  }
+
+
+  LIBRARY_API bool RunningStats::correlation (matrix &corr) const
+  {
+    int i, j;
+
+    corr.resize(dims_, dims_);
+    if (count_ < 2)
+    {
+      corr.setAll(0.0);
+      return false;
+    }
+    for (i = 0; i < dims_; ++i)
+    {
+      for (j = i; j < dims_; ++j)
+      {
+        double scale = comoment_[i * dims_ + i] * comoment_[j * dims_ + j];
+        corr.at(i, j) = corr.at(j, i) = (scale > 0.0) ? comoment_[i * dims_ + j] / sqrt(scale) : 0.0;
+      }
+    }
+    return true;
+  }
+
+
+  LIBRARY_API double RunningStats::minimum (int i) const
+  {
+    return min_.at(i);
+  }
+
+
+  LIBRARY_API double RunningStats::maximum (int i) const
+  {
+    return max_.at(i);
+  }
+
+
+  LIBRARY_API double RunningStats::comoment (int i, int j) const
+  {
+    return (i <= j) ? comoment_.at(i * dims_ + j) : comoment_.at(j * dims_ + i);
+  }
+} // namespace Math
@@ -0,0 +1,165 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Math
+//  Workfile:        Statistics.h
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Streaming (single pass) statistics of multivariate samples:  mean,
+//  variance, covariance, correlation, and range, without storing the
+//  sample history.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MATH_STATISTICS_H
+#define MATH_STATISTICS_H
+
+#include "../../portable.h"
+#include <vector>
+#include "MatrixMath.h"
+
+using namespace std;
+
+namespace Math
+{
+  //! @ingroup Math
+  //!
+  //! @brief Running statistics of a stream of fixed-length samples (e.g., force/torque readings
+  //!        or EMG frames), updated one sample at a time with Welford's method.  Accumulators
+  //!        filled separately (e.g., one per thread) can be combined with merge, giving the same
+  //!        result as a single accumulator that saw every sample.
+  //!
+  class LIBRARY_API RunningStats
+  {
+  public:
+    //! @brief Constructor
+    //!
+    //! @param dims The number of values in each sample
+    //!
+    RunningStats (int dims = 1);
+
+    //! @brief Default destructor
+    //!
+    ~RunningStats ();
+
+    //! @brief Discard all samples
+    //!
+    //! @param dims The new number of values in each sample (unchanged if less than 1)
+    //!
+    void reset (int dims = 0);
+
+    //! @brief Add a sample
+    //!
+    //! @param sample dims() values
+    //!
+    void add (const double *sample);
+
+    //! @brief Add a sample
+    //!
+    //! @param sample The sample values
+    //!
+    //! @return True if the sample has dims() values and was added, false otherwise
+    //!
+    bool add (const vector<double> &sample);
+
+    //! @brief Fold in the samples of another accumulator
+    //!
+    //! @param other An accumulator with the same number of values per sample
+    //!
+    //! @return True if the two were combined, false if their dimensions differ
+    //!
+    bool merge (const RunningStats &other);
+
+    //! @brief The number of values in each sample
+    //!
+    int dims () const;
+
+    //! @brief The number of samples added
+    //!
+    long long count () const;
+
+    //! @brief The mean of one value
+    //!
+    double mean (int i) const;
+
+    //! @brief The means of all values
+    //!
+    void mean (vector<double> &means) const;
+
+    //! @brief The variance of one value
+    //!
+    //! @param i      The value index
+    //! @param sample Divide by n - 1 (sample variance) instead of n (population variance)
+    //!
+    //! @return The variance, or 0 if there are too few samples
+    //!
+    double variance (int i, bool sample = true) const;
+
+    //! @brief The standard deviation of one value
+    //!
+    double stddev (int i, bool sample = true) const;
+
+    //! @brief The covariance of two values
+    //!
+    double covariance (int i, int j, bool sample = true) const;
+
+    //! @brief The covariance matrix (dims() x dims())
+    //!
+    //! @param cov    Output covariance matrix
+    //! @param sample Divide by n - 1 instead of n
+    //!
+    //! @return True if at least two samples (one for the population form) have been added
+    //!
+    bool covariance (matrix &cov, bool sample = true) const;
+
+    //! @brief The correlation matrix (dims() x dims()); values with no variance have 0
+    //!        correlation with every other value
+    //!
+    //! @return True if at least two samples have been added
+    //!
+    bool correlation (matrix &corr) const;
+
+    //! @brief The smallest value seen
+    //!
+    double minimum (int i) const;
+
+    //! @brief The largest value seen
+    //!
+    double maximum (int i) const;
+
+  private:
+    //! @brief Sum of squared deviation products of values i and j (j >= i), at i * dims_ + j
+    //!
+    double comoment (int i, int j) const;
+
+    //! @brief Number of values per sample
+    //!
+    int dims_;
+
+    //! @brief Number of samples added
+    //!
+    long long count_;
+
+    //! @brief Running means
+    //!
+    vector<double> mean_;
+
+    //! @brief Sums of deviation products (upper triangle, row-major dims_ x dims_)
+    //!
+    vector<double> comoment_;
+
+    //! @brief Range of each value
+    //!
+    vector<double> min_;
+    vector<double> max_;
+
+    //! @brief Deviations of the current sample from the previous means
+    //!
+    vector<double> delta_;
+  };
+} // namespace Math
+
+#endif
@@ -13,253 +13,475 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "VectorMath.h"
+#include <algorithm>
+#include <cstddef>
+#include <thread>
 
 namespace Math
 {
-  void merge (double *in1, double *in2,
-              int *indx1, int *indx2,
-              int size1, int size2)
+  //! @brief A value and its position in the input, ordered by value and then by position so that
+  //!        every ordering is strict and the parallel and serial sorts agree exactly
+  //!
+  struct sortKey
+  {
+    double val;
+    int index;
+  };
 
+  struct sortKeyLess
   {
-    double dTemp;
-    double *inTemp1, *inTemp2;
-    int *indxTemp1, *indxTemp2, sizeTemp1, sizeTemp2;
-    int iTemp, id1, id2, x;
+    bool operator() (const sortKey &a, const sortKey &b) const
+    {
+      return (a.val < b.val) || (a.val == b.val && a.index < b.index);
+    }
+  };
 
-    if (size1 == 1)
+  struct sortKeyGreater
+  {
+    bool operator() (const sortKey &a, const sortKey &b) const
     {
-      //! Cease breaking down & return values
-      if (size2 > 1)
-      {
-        //! In the event that indx1 == 1 && indx2 == 2
-        if (in2[0] > in2[1])
-        {
-          dTemp = in2[0];
-          iTemp = indx2[0];
-          in2[0] = in2[1];
-          indx2[0] = indx2[1];
-          in2[1] = dTemp;
-          indx2[1] = iTemp;
-        }
-      }
+      return (a.val > b.val) || (a.val == b.val && a.index < b.index);
     }
-    else
+  };
+
+  //! @brief Ranges shorter than this are insertion sorted
+  //!
+  static const ptrdiff_t sortInsertion = 24;
+
+  //! @brief Ranges longer than this take the pivot from a ninther
+  //!
+  static const ptrdiff_t sortNinther = 128;
+
+  //! @brief Inputs at least this long are split across threads
+  //!
+  static const size_t sortParallelMin = 65536;
+
+  template <class C> static void sort2 (sortKey *a, sortKey *b, C comp)
+  {
+    if (comp(*b, *a))
     {
-      //! Break the two vectors in half and sort
-      //! Vector1
-      sizeTemp1 = size1 / 2;
-      sizeTemp2 = size1 - sizeTemp1;
+      swap(*a, *b);
+    }
+  }
 
-      inTemp1 = new double[sizeTemp1];
-      indxTemp1 = new int[sizeTemp1];
-      inTemp2 = new double[sizeTemp2];
-      indxTemp2 = new int[sizeTemp2];
+  template <class C> static void sort3 (sortKey *a, sortKey *b, sortKey *c, C comp)
+  {
+    sort2(a, b, comp);
+    sort2(b, c, comp);
+    sort2(a, b, comp);
+  }
 
-      for (x = 0; x < sizeTemp1; ++x)
+  //! @brief Insertion sort of [begin, end); unguarded assumes *(begin - 1) orders before every key
+  //!
+  template <class C> static void insertionSort (sortKey *begin, sortKey *end, C comp, bool guarded)
+  {
+    for (sortKey *cur = begin + 1; cur < end; ++cur)
+    {
+      sortKey *sift = cur, *prev = cur - 1;
+      if (comp(*sift, *prev))
       {
-        inTemp1[x] = in1[x];
-        indxTemp1[x] = indx1[x];
+        sortKey tmp = *sift;
+        do
+        {
+          *sift-- = *prev;
+        } while ((!guarded || sift != begin) && comp(tmp, *--prev));
+        *sift = tmp;
       }
-      for (x = 0; x < sizeTemp2; ++x)
+    }
+  }
+
+  //! @brief Insertion sort that gives up after moving more than 8 keys
+  //!
+  //! @return True if [begin, end) is now sorted
+  //!
+  template <class C> static bool partialInsertionSort (sortKey *begin, sortKey *end, C comp)
+  {
+    ptrdiff_t moved = 0;
+    for (sortKey *cur = begin + 1; cur < end; ++cur)
+    {
+      if (moved > 8)
       {
-        inTemp2[x] = in1[x + sizeTemp1];
-        indxTemp2[x] = indx1[x + sizeTemp1];
+        return false;
       }
-
-      merge (inTemp1, inTemp2, indxTemp1, indxTemp2, sizeTemp1, sizeTemp2);
-
-      id1 = id2 = 0;
-      for (x = 0; x < size1; ++x)
+      sortKey *sift = cur, *prev = cur - 1;
+      if (comp(*sift, *prev))
       {
-        if (id1 >= sizeTemp1)
-        {
-          in1[x] = inTemp2[id2];
-          indx1[x] = indxTemp2[id2];
-          ++id2;
-        }
-        else if (id2 >= sizeTemp2)
+        sortKey tmp = *sift;
+        do
         {
-          in1[x] = inTemp1[id1];
-          indx1[x] = indxTemp1[id1];
-          ++id1;
-        }
-        else if (inTemp1[id1] < inTemp2[id2])
-        {
-          in1[x] = inTemp1[id1];
-          indx1[x] = indxTemp1[id1];
-          ++id1;
-        }
-        else
-        {
-          in1[x] = inTemp2[id2];
-          indx1[x] = indxTemp2[id2];
-          ++id2;
-        }
+          *sift-- = *prev;
+        } while (sift != begin && comp(tmp, *--prev));
+        *sift = tmp;
+        moved += cur - sift;
       }
+    }
+    return true;
+  }
 
-      delete [] inTemp1;
-      delete [] inTemp2;
-      delete [] indxTemp1;
-      delete [] indxTemp2;
+  //! @brief Partition around *begin, keys ordering before it to the left
+  //!
+  //! @param partitioned Set if no keys had to be swapped
+  //!
+  //! @return The final position of the pivot
+  //!
+  template <class C> static sortKey *partitionRight (sortKey *begin, sortKey *end, C comp,
+                                                     bool &partitioned)
+  {
+    sortKey pivot = *begin, *first = begin, *last = end;
+
+    while (comp(*++first, pivot));
+    if (first - 1 == begin)
+    {
+      while (first < last && !comp(*--last, pivot));
+    }
+    else
+    {
+      while (!comp(*--last, pivot));
+    }
+
+    partitioned = first >= last;
+    while (first < last)
+    {
+      swap(*first, *last);
+      while (comp(*++first, pivot));
+      while (!comp(*--last, pivot));
+    }
+
+    sortKey *pos = first - 1;
+    *begin = *pos;
+    *pos = pivot;
+    return pos;
+  }
+
+  //! @brief Partition around *begin, keys equal to it to the left (used when the pivot equals
+  //!        the key before the range, so the whole left side is already in place)
+  //!
+  template <class C> static sortKey *partitionLeft (sortKey *begin, sortKey *end, C comp)
+  {
+    sortKey pivot = *begin, *first = begin, *last = end;
+
+    while (comp(pivot, *--last));
+    if (last + 1 == end)
+    {
+      while (first < last && !comp(pivot, *++first));
+    }
+    else
+    {
+      while (!comp(pivot, *++first));
+    }
 
+    while (first < last)
+    {
+      swap(*first, *last);
+      while (comp(pivot, *--last));
+      while (!comp(pivot, *++first));
+    }
 
-      //! Vector2
-      sizeTemp1 = size2 / 2;
-      sizeTemp2 = size2 - sizeTemp1;
+    *begin = *last;
+    *last = pivot;
+    return last;
+  }
 
-      inTemp1 = new double[sizeTemp1];
-      indxTemp1 = new int[sizeTemp1];
-      inTemp2 = new double[sizeTemp2];
-      indxTemp2 = new int[sizeTemp2];
+  //! @brief Pattern-defeating quicksort (O. Peters):  introsort with ninther pivots, shuffles of
+  //!        unbalanced partitions, a heapsort fallback, and early exit on presorted runs
+  //!
+  template <class C> static void pdqSort (sortKey *begin, sortKey *end, C comp, int badAllowed,
+                                          bool leftmost)
+  {
+    while (true)
+    {
+      ptrdiff_t size = end - begin;
+      if (size < sortInsertion)
+      {
+        insertionSort(begin, end, comp, leftmost);
+        return;
+      }
 
-      for (x = 0; x < sizeTemp1; ++x)
+      ptrdiff_t half = size / 2;
+      if (size > sortNinther)
       {
-        inTemp1[x] = in2[x];
-        indxTemp1[x] = indx2[x];
+        sort3(begin, begin + half, end - 1, comp);
+        sort3(begin + 1, begin + (half - 1), end - 2, comp);
+        sort3(begin + 2, begin + (half + 1), end - 3, comp);
+        sort3(begin + (half - 1), begin + half, begin + (half + 1), comp);
+        swap(*begin, *(begin + half));
       }
-      for (x = 0; x < sizeTemp2; ++x)
+      else
       {
-        inTemp2[x] = in2[x + sizeTemp1];
-        indxTemp2[x] = indx2[x + sizeTemp1];
+        sort3(begin + half, begin, end - 1, comp);
       }
 
-      merge (inTemp1, inTemp2, indxTemp1, indxTemp2, sizeTemp1, sizeTemp2);
+      if (!leftmost && !comp(*(begin - 1), *begin))
+      {
+        begin = partitionLeft(begin, end, comp) + 1;
+        continue;
+      }
+
+      bool partitioned;
+      sortKey *pivot = partitionRight(begin, end, comp, partitioned);
+      ptrdiff_t lsize = pivot - begin, rsize = end - (pivot + 1);
 
-      id1 = id2 = 0;
-      for (x = 0; x < size2; ++x)
+      if (lsize < size / 8 || rsize < size / 8)
       {
-        if (id1 >= sizeTemp1)
+        if (--badAllowed == 0)
         {
-          in2[x] = inTemp2[id2];
-          indx2[x] = indxTemp2[id2];
-          ++id2;
+          make_heap(begin, end, comp);
+          sort_heap(begin, end, comp);
+          return;
         }
-        else if (id2 >= sizeTemp2)
+
+        if (lsize >= sortInsertion)
         {
-          in2[x] = inTemp1[id1];
-          indx2[x] = indxTemp1[id1];
-          ++id1;
+          swap(*begin, *(begin + lsize / 4));
+          swap(*(pivot - 1), *(pivot - lsize / 4));
+          if (lsize > sortNinther)
+          {
+            swap(*(begin + 1), *(begin + (lsize / 4 + 1)));
+            swap(*(begin + 2), *(begin + (lsize / 4 + 2)));
+            swap(*(pivot - 2), *(pivot - (lsize / 4 + 1)));
+            swap(*(pivot - 3), *(pivot - (lsize / 4 + 2)));
+          }
         }
-        else if (inTemp1[id1] < inTemp2[id2])
+        if (rsize >= sortInsertion)
         {
-          in2[x] = inTemp1[id1];
-          indx2[x] = indxTemp1[id1];
-          ++id1;
-        }
-        else
-        {
-          in2[x] = inTemp2[id2];
-          indx2[x] = indxTemp2[id2];
-          ++id2;
+          swap(*(pivot + 1), *(pivot + (1 + rsize / 4)));
+          swap(*(end - 1), *(end - rsize / 4));
+          if (rsize > sortNinther)
+          {
+            swap(*(pivot + 2), *(pivot + (2 + rsize / 4)));
+            swap(*(pivot + 3), *(pivot + (3 + rsize / 4)));
+            swap(*(end - 2), *(end - (1 + rsize / 4)));
+            swap(*(end - 3), *(end - (2 + rsize / 4)));
+          }
         }
       }
+      else if (partitioned && partialInsertionSort(begin, pivot, comp) &&
+               partialInsertionSort(pivot + 1, end, comp))
+      {
+        return;
+      }
 
-      delete [] inTemp1;
-      delete [] inTemp2;
-      delete [] indxTemp1;
-      delete [] indxTemp2;
-    } // if (size1 == 1) ... else
+      pdqSort(begin, pivot, comp, badAllowed, leftmost);
+      begin = pivot + 1;
+      leftmost = false;
+    }
   }
 
+  template <class C> static void pdqSort (sortKey *begin, sortKey *end, C comp)
+  {
+    int badAllowed = 1;
+    for (ptrdiff_t n = end - begin; n > 1; n >>= 1)
+    {
+      ++badAllowed;
+    }
+    pdqSort(begin, end, comp, badAllowed, true);
+  }
 
-  LIBRARY_API void mergeSort (vector<double> &vals, vector<int> &indexes)
+  //! @brief Merge the sorted ranges a and b, writing output positions [d0, d1) of the merged
+  //!        sequence to out
+  //!
+  static void mergeRange (const sortKey *a, size_t na, const sortKey *b, size_t nb,
+                          size_t d0, size_t d1, sortKey *out)
   {
-    double *in1, *in2;
-    int *indx1, *indx2;
-    unsigned int half1, half2;
-    unsigned int id1, id2;
-    unsigned int x;
+    sortKeyLess comp;
+    size_t split[2], d[2] = { d0, d1 };
 
-    if (vals.size() <= 1)
+    //! Co-rank:  the number of keys taken from a in the first d outputs
+    for (int s = 0; s < 2; ++s)
     {
-      for (x = 0; x < vals.size(); ++x)
+      size_t lo = (d[s] > nb) ? d[s] - nb : 0, hi = (d[s] < na) ? d[s] : na;
+      while (lo < hi)
       {
-        indexes.at (x) = x;
+        size_t mid = (lo + hi) / 2;
+        if (comp(b[d[s] - mid - 1], a[mid]))
+        {
+          hi = mid;
+        }
+        else
+        {
+          lo = mid + 1;
+        }
       }
-      return;
+      split[s] = lo;
     }
 
-    half1 = vals.size () / 2;
-    half2 = vals.size () - half1;
-    in1 = new double[half1];
-    indx1 = new int[half1];
-    in2 = new double[half2];
-    indx2 = new int[half2];
+    merge(a + split[0], a + split[1], b + (d0 - split[0]), b + (d1 - split[1]), out + d0, comp);
+  }
+
+  //! @brief Sort keys with one pdqsort per thread, then merge the runs pairwise, each merge
+  //!        divided among the threads along the merge path
+  //!
+  static void parallelSort (sortKey *keys, size_t n, int threads)
+  {
+    vector<size_t> bounds(threads + 1);
+    vector<thread> workers;
+    vector<sortKey> buffer(n);
+    sortKey *src = keys, *dst = &buffer[0];
+    int t;
 
-    for (x = 0; x < half1; ++x)
+    for (t = 0; t <= threads; ++t)
     {
-      in1[x] = vals.at(x);
-      indx1[x] = x;
+      bounds[t] = (n * t) / threads;
     }
-    for (x = 0; x < half2; ++x)
+    for (t = 0; t < threads; ++t)
     {
-      in2[x] = vals.at(half1+x);
-      indx2[x] = half1+x;
+      workers.push_back(thread([=]() { pdqSort(keys + bounds[t], keys + bounds[t + 1], sortKeyLess()); }));
+    }
+    for (t = 0; t < threads; ++t)
+    {
+      workers[t].join();
     }
 
-//    vals.clear();
-//    indexes.clear();
-
-    merge (in1, in2, indx1, indx2, half1, half2);
-
-    //! bring the two sorted halfs together
-    id1 = id2 = x = 0;
-    while (id1 < half1 || id2 < half2)
+    for (int width = 1; width < threads; width *= 2)
     {
-      if (id1 >= half1)
+      workers.clear();
+      for (t = 0; t < threads; t += 2 * width)
       {
-        vals.at (x) = in2[id2];
-        indexes.at (x) = indx2[id2];
-//        vals.push_back (in2[id2]);
-//        indexes.push_back (indx2[id2]);
-        ++id2;
+        size_t begin = bounds[t], mid = bounds[min(t + width, threads)],
+               end = bounds[min(t + 2 * width, threads)], len = end - begin;
+        size_t parts = max((size_t)1, (threads * len) / n);
+        for (size_t p = 0; p < parts; ++p)
+        {
+          size_t d0 = (len * p) / parts, d1 = (len * (p + 1)) / parts;
+          workers.push_back(thread(mergeRange, src + begin, mid - begin, src + mid, end - mid,
+                                   d0, d1, dst + begin));
+        }
       }
-      else if (id2 >= half2)
+      for (size_t w = 0; w < workers.size(); ++w)
       {
-        vals.at (x) = in1[id1];
-        indexes.at (x) = indx1[id1];
-//        vals.push_back (in1[id1]);
-//        indexes.push_back (indx1[id1]);
-        ++id1;
+        workers[w].join();
       }
-      else if (in1[id1] < in2[id2])
+      swap(src, dst);
+    }
+
+    if (src != keys)
+    {
+      copy(src, src + n, keys);
+    }
+  }
+
+  //! @brief Load the keys of vals, NaNs last
+  //!
+  //! @return The number of keys that are not NaN
+  //!
+  static size_t loadKeys (const vector<double> &vals, vector<sortKey> &keys)
+  {
+    size_t n = vals.size(), front = 0, back = n;
+
+    keys.resize(n);
+    for (size_t x = 0; x < n; ++x)
+    {
+      if (vals[x] != vals[x])
       {
-        vals.at (x) = in1[id1];
-        indexes.at (x) = indx1[id1];
-//        vals.push_back (in1[id1]);
-//        indexes.push_back (indx1[id1]);
-        ++id1;
+        keys[--back].val = vals[x];
+        keys[back].index = (int)x;
       }
       else
       {
-        vals.at (x) = in2[id2];
-        indexes.at (x) = indx2[id2];
-//        vals.push_back (in2[id2]);
-//        indexes.push_back (indx2[id2]);
-        ++id2;
+        keys[front].val = vals[x];
+        keys[front++].index = (int)x;
       }
-      ++x;
-    } // while (id1 < half1 && id2 < half2)
+    }
+    //! NaNs were filled from the back; restore their input order
+    reverse(keys.begin() + front, keys.end());
+    return front;
+  }
+
+
+  LIBRARY_API void argSort (const vector<double> &vals, vector<int> &indexes, int threads)
+  {
+    vector<sortKey> keys;
+    size_t n = loadKeys(vals, keys);
+
+    if (threads <= 0)
+    {
+      threads = (int)thread::hardware_concurrency();
+    }
+    if (threads > 1 && n >= sortParallelMin)
+    {
+      parallelSort(&keys[0], n, threads);
+    }
+    else if (n > 1)
+    {
+      pdqSort(&keys[0], &keys[0] + n, sortKeyLess());
+    }
+
+    indexes.resize(keys.size());
+    for (size_t x = 0; x < keys.size(); ++x)
+    {
+      indexes[x] = keys[x].index;
+    }
+  }
+
+
+  //! @brief Shared body of argSmallest and argLargest
+  //!
+  template <class C> static void argSelect (const vector<double> &vals, int k,
+                                            vector<int> &indexes, C comp)
+  {
+    vector<sortKey> keys;
+    size_t n = loadKeys(vals, keys), count = (k < 0) ? 0 : min((size_t)k, keys.size());
+
+    if (count < n)
+    {
+      nth_element(keys.begin(), keys.begin() + count, keys.begin() + n, comp);
+    }
+    if (count > 1)
+    {
+      pdqSort(&keys[0], &keys[0] + min(count, n), comp);
+    }
+
+    indexes.resize(count);
+    for (size_t x = 0; x < count; ++x)
+    {
+      indexes[x] = keys[x].index;
+    }
+  }
+
+
+  LIBRARY_API void argSmallest (const vector<double> &vals, int k, vector<int> &indexes)
+  {
+    argSelect(vals, k, indexes, sortKeyLess());
+  }
+
+
+  LIBRARY_API void argLargest (const vector<double> &vals, int k, vector<int> &indexes)
+  {
+    argSelect(vals, k, indexes, sortKeyGreater());
+  }
+
+
+  LIBRARY_API void mergeSort (vector<double> &vals, vector<int> &indexes)
+  {
+    vector<double> sorted(vals.size());
+
+    argSort(vals, indexes);
+    for (size_t x = 0; x < vals.size(); ++x)
+    {
+      sorted[x] = vals[indexes[x]];
+    }
+    vals.swap(sorted);
   }
 
 
   LIBRARY_API double eucDist (vector<double> &val1, vector<double> &val2)
   {
-    double temp = 0.0f;
-    vector<double>::iterator iter1, iter2;
-    int s1 = val1.size(), s2 = val2.size();
     if (val1.size() != val2.size() || val1.size() < 1 || val2.size() < 1)
     {
       return -1.0;
     }
 
-    iter1 = val1.begin();
-    iter2 = val2.begin();
-    for (; iter1 != val1.end(); ++iter1, ++iter2)
+    return distanceL2(&val1[0], &val2[0], val1.size());
+  }
+
+  LIBRARY_API float eucDist (vector<float> &val1, vector<float> &val2)
+  {
+    if (val1.size() != val2.size() || val1.size() < 1 || val2.size() < 1)
     {
-      temp += ((*iter1 - *iter2) * (*iter1 - *iter2));
+      return -1.0f;
     }
-    return sqrt(temp);
+
+    return distanceL2(&val1[0], &val2[0], val1.size());
   }
 
   LIBRARY_API int maxElement (double *val1, int dim)
@@ -17,6 +17,7 @@
 
 #include "../../portable.h"
 #include <vector>
+#include "Distance.h"
 #if defined(_MSC_VER)
 #include "math.h"
 #elif defined(__GNUC__)
@@ -30,9 +31,180 @@ using namespace std;
 
 namespace Math
 {
+  //! @brief Compute the sine and cosine of an angle with a single call (one range reduction)
+  //!
+  //! @param angle The angle (radians)
+  //! @param s     The sine of angle
+  //! @param c     The cosine of angle
+  //!
+  inline void sinCos (double angle, double &s, double &c)
+  {
+#if defined(__GNUC__)
+    __builtin_sincos(angle, &s, &c);
+#else
+    s = sin(angle);
+    c = cos(angle);
+#endif
+  }
+
+  struct point;
+  struct pose;
+
+  //! @brief The type an expression of N components evaluates to
+  //!
+  template <int N> struct vecResult;
+
+  template <> struct vecResult<3>
+  {
+    typedef point type;
+  };
+
+  template <> struct vecResult<6>
+  {
+    typedef pose type;
+  };
+
+  //! @brief Lazy element-wise arithmetic on points and poses.  A sum, difference, or scaled
+  //!        term only records its operands; assigning the whole expression to a point or pose
+  //!        computes each component in a single pass, with no intermediate point or pose.
+  //!
+  //! @note Expressions refer to the points and poses they were built from, so an expression
+  //!       kept in a variable (e.g., with auto) must not outlive its operands.
+  //!
+  template <class E, int N> struct vecExpr
+  {
+    //! @brief The expression being evaluated
+    //!
+    const E &self () const
+    {
+      return static_cast<const E &>(*this);
+    }
+
+    //! @brief Evaluate the expression, e.g., to call a point method on a sum:
+    //!        (a - b).eval().magnitude()
+    //!
+    typename vecResult<N>::type eval () const
+    {
+      return typename vecResult<N>::type(self());
+    }
+  };
+
+  //! @brief How expressions hold their operands:  points and poses by reference, nested
+  //!        expressions (which are temporaries) by value
+  //!
+  template <class E> struct vecOperand
+  {
+    typedef E type;
+  };
+
+  template <> struct vecOperand<point>
+  {
+    typedef const point &type;
+  };
+
+  template <> struct vecOperand<pose>
+  {
+    typedef const pose &type;
+  };
+
+  template <class A, class B, int N> struct vecSum : public vecExpr<vecSum<A, B, N>, N>
+  {
+    typename vecOperand<A>::type a;
+    typename vecOperand<B>::type b;
+
+    vecSum (const A &ea, const B &eb) :
+      a(ea),
+      b(eb)
+    {
+    }
+
+    double value (int i) const
+    {
+      return a.value(i) + b.value(i);
+    }
+  };
+
+  template <class A, class B, int N> struct vecDiff : public vecExpr<vecDiff<A, B, N>, N>
+  {
+    typename vecOperand<A>::type a;
+    typename vecOperand<B>::type b;
+
+    vecDiff (const A &ea, const B &eb) :
+      a(ea),
+      b(eb)
+    {
+    }
+
+    double value (int i) const
+    {
+      return a.value(i) - b.value(i);
+    }
+  };
+
+  template <class A, int N> struct vecScaled : public vecExpr<vecScaled<A, N>, N>
+  {
+    typename vecOperand<A>::type a;
+    double s;
+
+    vecScaled (const A &ea, double scale) :
+      a(ea),
+      s(scale)
+    {
+    }
+
+    double value (int i) const
+    {
+      return a.value(i) * s;
+    }
+  };
+
+  template <class A, int N> struct vecQuotient : public vecExpr<vecQuotient<A, N>, N>
+  {
+    typename vecOperand<A>::type a;
+    double s;
+
+    vecQuotient (const A &ea, double divisor) :
+      a(ea),
+      s(divisor)
+    {
+    }
+
+    double value (int i) const
+    {
+      return a.value(i) / s;
+    }
+  };
+
+  template <class A, class B, int N>
+  inline vecSum<A, B, N> operator+ (const vecExpr<A, N> &a, const vecExpr<B, N> &b)
+  {
+    return vecSum<A, B, N>(a.self(), b.self());
+  }
+
+  template <class A, class B, int N>
+  inline vecDiff<A, B, N> operator- (const vecExpr<A, N> &a, const vecExpr<B, N> &b)
+  {
+    return vecDiff<A, B, N>(a.self(), b.self());
+  }
+
+  template <class A, int N> inline vecScaled<A, N> operator* (const vecExpr<A, N> &a, double s)
+  {
+    return vecScaled<A, N>(a.self(), s);
+  }
+
+  template <class A, int N> inline vecScaled<A, N> operator* (double s, const vecExpr<A, N> &a)
+  {
+    return vecScaled<A, N>(a.self(), s);
+  }
+
+  template <class A, int N> inline vecQuotient<A, N> operator/ (const vecExpr<A, N> &a, double s)
+  {
+    return vecQuotient<A, N>(a.self(), s);
+  }
+
   //! @brief Cartesian point structure
   //!
-  struct point
+  struct point : public vecExpr<point, 3>
   {
     //! @brief Cartesian X axis coordinate
     //!
@@ -48,82 +220,69 @@ namespace Math
 
     //! @brief Default constructor
     //!
-    point()
-    {
-      x = y = z = 0.0;
-    }
-
-    //! @brief Copy constructor
-    //!
-    point(const point& source)
+    constexpr point() :
+      x(0.0),
+      y(0.0),
+      z(0.0)
     {
-      x = source.x;
-      y = source.y;
-      z = source.z;
     }
 
     //! @brief Assignmet constructor
     //!
-    point(double px, double py, double pz) :
+    constexpr point(double px, double py, double pz) :
       x(px),
       y(py),
       z(pz)
     {
     }
 
-    //! @brief Point assignment function
+    //! @brief Evaluate a point expression (e.g., a + (b - c) * 0.5)
     //!
-    //! @param source An existing point that will be used to populate this point
-    //!               instance
+    template <class E> point(const vecExpr<E, 3> &expr) :
+      x(expr.self().value(0)),
+      y(expr.self().value(1)),
+      z(expr.self().value(2))
+    {
+    }
+
+    //! @brief Assign a point expression.  Each component only depends on the same component
+    //!        of the operands, so the expression may refer to this point.
     //!
-    point & operator=(const point &source)
+    template <class E> point & operator=(const vecExpr<E, 3> &expr)
     {
-      if (this != &source)
-      {
-        x = source.x;
-        y = source.y;
-        z = source.z;
-      }
+      x = expr.self().value(0);
+      y = expr.self().value(1);
+      z = expr.self().value(2);
       return *this;
     }
 
-    point operator/(double &val)
+    //! @brief In-place sum, difference, and scaling
+    //!
+    template <class E> point & operator+=(const vecExpr<E, 3> &expr)
     {
-      point pC;
-      pC.x = x / val;
-      pC.y = y / val;
-      pC.z = z / val;
-      return pC;
+      return *this = *this + expr;
     }
 
-    //! @brief Point vector summation
-    //!
-    //! @param pB The source additive point vector
-    //!
-    //! @return The sum of the two point vectors
-    //!
-    point operator+(const point &pB)
+    template <class E> point & operator-=(const vecExpr<E, 3> &expr)
     {
-      point pC;
-      pC.x = x + pB.x;
-      pC.y = y + pB.y;
-      pC.z = z + pB.z;
-      return pC;
+      return *this = *this - expr;
     }
 
-    //! @brief Point vector difference
-    //!
-    //! @param pB The source subtractive point vector
-    //!
-    //! @return The difference of the two point vectors
+    point & operator*=(double val)
+    {
+      return *this = *this * val;
+    }
+
+    point & operator/=(double val)
+    {
+      return *this = *this / val;
+    }
+
+    //! @brief Component i (x, y, z) of the point, for expression evaluation
     //!
-    point operator-(const point &pB)
+    double value(int i) const
     {
-      point pC;
-      pC.x = x - pB.x;
-      pC.y = y - pB.y;
-      pC.z = z - pB.z;
-      return pC;
+      return (i == 0) ? x : ((i == 1) ? y : z);
     }
 
     //! @brief Point vector magnitude
@@ -147,10 +306,8 @@ namespace Math
     //!
     double distance(const point &dest, bool root = false)
     {
-      static double temp;
-      temp = (dest.x - x) * (dest.x - x);
-      temp += (dest.y - y) * (dest.y - y);
-      temp += (dest.z - z) * (dest.z - z);
+      double a[3] = { x, y, z }, b[3] = { dest.x, dest.y, dest.z };
+      double temp = distanceL2Squared(a, b, 3);
       return (root ? sqrt(temp) : temp);
     }
 
@@ -235,7 +392,7 @@ namespace Math
 
   //! @brief Cartesian pose structure
   //!
-  struct pose
+  struct pose : public vecExpr<pose, 6>
   {
     //! @brief Cartesian X axis coordinate
     //!
@@ -263,26 +420,19 @@ namespace Math
 
     //! @brief Default constructor
     //!
-    pose()
-    {
-      x = y = z = xr = yr = zr = 0.0f;
-    }
-
-    //! @brief Copy constructor
-    //!
-    pose(const pose& source)
+    constexpr pose() :
+      x(0.0),
+      y(0.0),
+      z(0.0),
+      xr(0.0),
+      yr(0.0),
+      zr(0.0)
     {
-      x = source.x;
-      y = source.y;
-      z = source.z;
-      xr = source.xr;
-      yr = source.yr;
-      zr = source.zr;
     }
 
     //! @brief Assignmet constructor
     //!
-    pose(double px, double py, double pz, double pxr, double pyr, double pzr) :
+    constexpr pose(double px, double py, double pz, double pxr, double pyr, double pzr) :
       x(px),
       y(py),
       z(pz),
@@ -292,83 +442,74 @@ namespace Math
     {
     }
 
-    //! @brief Point assignment function
-    //!
-    //! @param source An existing point that will be used to populate this point
-    //!               instance
+    //! @brief Evaluate a pose expression.  All six components are combined element-wise, as
+    //!        in a sum of offsets; to chain poses as transformations, use qpose
+    //!        (RotationMath.h).
+    //!
+    template <class E> pose(const vecExpr<E, 6> &expr) :
+      x(expr.self().value(0)),
+      y(expr.self().value(1)),
+      z(expr.self().value(2)),
+      xr(expr.self().value(3)),
+      yr(expr.self().value(4)),
+      zr(expr.self().value(5))
+    {
+    }
+
+    //! @brief Assign a pose expression (which may refer to this pose)
     //!
-    pose & operator=(const pose &source)
+    template <class E> pose & operator=(const vecExpr<E, 6> &expr)
     {
-      if (this != &source)
-      {
-        x = source.x;
-        y = source.y;
-        z = source.z;
-        xr = source.xr;
-        yr = source.yr;
-        zr = source.zr;
-      }
+      x = expr.self().value(0);
+      y = expr.self().value(1);
+      z = expr.self().value(2);
+      xr = expr.self().value(3);
+      yr = expr.self().value(4);
+      zr = expr.self().value(5);
       return *this;
     }
 
-    pose operator/(double &val)
+    //! @brief In-place sum, difference, and scaling
+    //!
+    template <class E> pose & operator+=(const vecExpr<E, 6> &expr)
     {
-      pose pC;
-      pC.x = x / val;
-      pC.y = y / val;
-      pC.z = z / val;
-      pC.xr = xr / val;
-      pC.yr = yr / val;
-      pC.zr = zr / val;
-      return pC;
+      return *this = *this + expr;
     }
 
-    pose operator*(double &val)
+    template <class E> pose & operator-=(const vecExpr<E, 6> &expr)
     {
-      pose pC;
-      pC.x = x * val;
-      pC.y = y * val;
-      pC.z = z * val;
-      pC.xr = xr * val;
-      pC.yr = yr * val;
-      pC.zr = zr * val;
-      return pC;
+      return *this = *this - expr;
     }
 
-    //! @brief Point vector summation
-    //!
-    //! @param pB The source additive point vector
-    //!
-    //! @return The sum of the two point vectors
-    //!
-    pose operator+(const pose &pB)
+    pose & operator*=(double val)
     {
-      pose pC;
-      pC.x = x + pB.x;
-      pC.y = y + pB.y;
-      pC.z = z + pB.z;
-      pC.xr = xr + pB.xr;
-      pC.yr = yr + pB.yr;
-      pC.zr = zr + pB.zr;
-      return pC;
+      return *this = *this * val;
     }
 
-    //! @brief Point vector difference
-    //!
-    //! @param pB The source subtractive point vector
-    //!
-    //! @return The difference of the two point vectors
+    pose & operator/=(double val)
+    {
+      return *this = *this / val;
+    }
+
+    //! @brief Component i (x, y, z, xr, yr, zr) of the pose, for expression evaluation
     //!
-    pose operator-(const pose &pB)
+    double value(int i) const
     {
-      pose pC;
-      pC.x = x - pB.x;
-      pC.y = y - pB.y;
-      pC.z = z - pB.z;
-      pC.xr = xr - pB.xr;
-      pC.yr = yr - pB.yr;
-      pC.zr = zr - pB.zr;
-      return pC;
+      switch (i)
+      {
+      case 0:
+        return x;
+      case 1:
+        return y;
+      case 2:
+        return z;
+      case 3:
+        return xr;
+      case 4:
+        return yr;
+      default:
+        return zr;
+      }
     }
 
     //! @brief Print out the point to the screen
@@ -380,15 +521,45 @@ namespace Math
   };
 
 
-  //! @brief Perform an in-place merge-sort on a vector of floating point
-  //!        numbers
+  //! @brief Sort a vector of floating point numbers in place (ascending); a wrapper around
+  //!        argSort
   //!
   //! @param vals    The vector of values to be sorted
   //! @param indexes The vector of index values corresponding to the original
-  //!                order of the elements in the input vector
+  //!                order of the elements in the input vector (resized to fit)
   //!
   LIBRARY_API void mergeSort (vector<double> &vals, vector<int> &indexes);
 
+  //! @brief Compute the ascending order of a vector of floating point numbers without moving
+  //!        them.  Equal values keep their input order and NaNs are placed last, so the result
+  //!        does not depend on the number of threads.
+  //!
+  //! @param vals    The values to be ranked
+  //! @param indexes The positions in vals of the smallest, second smallest, ... values
+  //!                (resized to fit)
+  //! @param threads The number of threads used on large inputs (0 for one per core, 1 to sort
+  //!                on the calling thread)
+  //!
+  LIBRARY_API void argSort (const vector<double> &vals, vector<int> &indexes, int threads = 0);
+
+  //! @brief Find the k smallest values of a vector without sorting the rest
+  //!
+  //! @param vals    The values to be ranked
+  //! @param k       The number of values wanted
+  //! @param indexes The positions in vals of the k smallest values, in ascending order
+  //!                (fewer if vals is shorter than k; NaNs are only returned to make up k)
+  //!
+  LIBRARY_API void argSmallest (const vector<double> &vals, int k, vector<int> &indexes);
+
+  //! @brief Find the k largest values of a vector without sorting the rest
+  //!
+  //! @param vals    The values to be ranked
+  //! @param k       The number of values wanted
+  //! @param indexes The positions in vals of the k largest values, in descending order
+  //!                (fewer if vals is shorter than k; NaNs are only returned to make up k)
+  //!
+  LIBRARY_API void argLargest (const vector<double> &vals, int k, vector<int> &indexes);
+
   //! @brief Compute the Euclidean distance between two point vectors
   //!
   //! @param val1 The first vector of numbers to be distanced (origin)
@@ -398,6 +569,7 @@ namespace Math
   //!         two vectors are not equally lengthed or are of illegal length
   //!
   LIBRARY_API double eucDist (vector<double> &val1, vector<double> &val2);
+  LIBRARY_API float eucDist (vector<float> &val1, vector<float> &val2);
 
   //! @brief Return the index of the maximum value in a vector
   //!
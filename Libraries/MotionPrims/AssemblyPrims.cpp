@@ -12,9 +12,9 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "AssemblyPrims.h"
+#include <algorithm>
 #include <iostream>
 //#include <stdio.h>
-#define MAXBIT 30  //parameter defined for the Sobel sequence function
 ///////////////////////////////////////////////////////////////////////////////
 
 double decimal (double val)
@@ -38,92 +38,85 @@ bool even(int val)
   return (decimal((double)val/2.0f) < 0.01f);
 }
 
-//! @brief Generates a Sobol sequence of random numbers;
-//!
-//! @param x    Array of pseudo-random numbers generated by this function
-//! @param n    Number of pseudo-random numbers to generate
-//! @param init TODO
-//!
-//! @note Modified from "Numerical Recipes in C" (https://www2.units.it/ipl/students_area/imm2/files/Numerical_Recipes.pdf)
-//!
-void sobseq(double *x, double *y, int init)
+//! Whole steps in a search cycle (at least one)
+int steps (double val)
 {
-  int j, k, l;
-  unsigned long i, im, ipp;
-  static float fac;
-  static unsigned long in, ix[3], *iu[MAXBIT + 1];
-  static unsigned long mdeg[3] = {0,1,2};
-  static unsigned long ip[3] = { 0,0,1};
-  static unsigned long iv[2*MAXBIT + 1] = {0,1,1,1,1,1,1,3,1,3,3,1,1,5,7,7,3,3,5,15,11,5,15,13,9};
-  
-  if (init==0) 
-  {  //Initialize the genereator the first time the function is called
-    for (k = 1; k <= 2; k++)
-    {
-      ix[k] = 0;
-    }
-    in = 0;
-    if (iv[1] != 1)
+  int n = (int)val;
+  return (n < 1) ? 1 : n;
+}
+
+int gcd (int a, int b)
+{
+  while (b != 0)
+  {
+    int r = a % b;
+    a = b;
+    b = r;
+  }
+  return a;
+}
+
+//! Smallest number of steps of delta degrees that returns a sinusoid to its start, or 0 if it
+//! takes more than ASSEMBLY_MAX_POINTS
+int sinePeriod (double delta)
+{
+  for (int steps = 1; steps <= ASSEMBLY_MAX_POINTS; ++steps)
+  {
+    double turns = (steps * delta) / 360.0f;
+    if (fabs(turns - floor(turns + 0.5f)) * 360.0f < 1e-6)
     {
-      return;
+      return steps;
     }
-    fac = 1.0 / (1L << MAXBIT);
-    for (j = 1, k = 0; j <= MAXBIT; j++, k += 2)
+  }
+  return 0;
+}
+
+//! Samples tested together by firstMatch before it looks for the one that matched, so that
+//! each block is a loop without branches that the compiler can vectorize
+#define TERM_BLOCK 16
+
+//! First i on [0, count) for which test (i) holds, or -1
+template <class Test> int firstMatch (int count, Test test)
+{
+  int start, end, any, i;
+
+  for (start = 0; start < count; start += TERM_BLOCK)
+  {
+    end = (start + TERM_BLOCK < count) ? start + TERM_BLOCK : count;
+    any = 0;
+    for (i = start; i < end; ++i)
     {
-      iu[j] = &iv[k];
+      any |= test(i) ? 1 : 0;
     }
-    //To allow both 1D and 2D addressing.
-    for (k = 1; k <= 2; k++) 
+    if (any)
     {
-      for (j = 1; j <= mdeg[k]; j++)
-      {
-        iu[j][k] <<= (MAXBIT - j);
-      }
-      //Stored values only require normalization.
-      for (j = mdeg[k] + 1; j <= MAXBIT; j++) 
+      for (i = start; i < end; ++i)
       {
-        //Use the recurrence to get other values.
-        ipp = ip[k];
-        i = iu[j - mdeg[k]][k];
-        i ^= (i >> mdeg[k]);
-        for (l = mdeg[k] - 1; l >= 1; l--)
+        if (test(i))
         {
-          if (ipp & 1) 
-            i ^= iu[j - l][k];
-          ipp >>= 1;
+          return i;
         }
-          iu[j][k] = i;
       }
     }
   }
-  //Calculate the pair of numbers in the 2D Sobel Sequence
-  im = in++;
-  for (j = 1; j <= MAXBIT; j++)
-  { //Find the rightmost zero bit.
-    if (!(im & 1)) break;
-    im >>= 1;
-  }
-  if (j > MAXBIT)
-  {
-    printf("MAXBIT too small in sobseq");
-  }
-  im = (j - 1)*2;
-  ix[1] ^= iv[im + 1];
-  ix[2] ^= iv[im + 2];
-  *x = (double)(ix[1] * fac);
-  *y = (double)(ix[2] * fac);
+  return -1;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
 namespace MotionPrims
 {
-  LIBRARY_API Assembly::Assembly ()
+  LIBRARY_API Assembly::Assembly () :
+    sobol_(2)
   {
     curFreq_ = 10.0f;
     newSearch = true;
-    sqs_x = 0;
-    sqs_y = 0;
+    sensing_ = false;
+    pathPrefix_ = 0;
+    pathCycle_ = 1;
+    randSeed_ = 0;
+    started_ = false;
+    lastStep_ = 0;
     //robot_ = new crpi_robot::CrpiRobot("universal_ur10_right.dat");
   }
 
@@ -132,6 +125,8 @@ namespace MotionPrims
   {
     termParams_.clear();
     assemblyParams_.clear();
+    path_.clear();
+    live_.clear();
     //robot_ = NULL;
   }
   
@@ -191,23 +186,11 @@ namespace MotionPrims
     int sq_side = 2 * irad + 1;
     aP.totalPoints = sq_side * sq_side;
 
-    // generate lookup table
-    init_sqs_table(aP.totalPoints);
-
     return AddSearch(aP);
   }
 
-  LIBRARY_API void Assembly::init_sqs_table(int table_size)
+  LIBRARY_API void Assembly::init_sqs_table(const assemblyParams &ap)
   {
-    //! delete if arrays previously initialized
-    if (sqs_x)
-      delete[] sqs_x;
-    if (sqs_y)
-      delete[] sqs_y;
-
-    sqs_x = new int[table_size];
-    sqs_y = new int[table_size];
-
     //! (di, dj) is a vector - direction in which we move right now
     int di = 1;
     int dj = 0;
@@ -218,7 +201,7 @@ namespace MotionPrims
     int i = 0;
     int j = 0;
     int segment_passed = 0;
-    for (int k = 0; k < table_size; ++k)
+    for (int k = 0; k < ap.totalPoints; ++k)
     {
       //! make a step, add 'direction' vector (di, dj) to current position (i, j)
       i += di;
@@ -226,8 +209,8 @@ namespace MotionPrims
       ++segment_passed;
 
       //! record offsets
-      sqs_x[k] = i;
-      sqs_y[k] = j;
+      path_[k].x += i * ap.lengthStep;
+      path_[k].y += j * ap.lengthStep;
 
       //System.out.println(i + " " + j);
 
@@ -334,6 +317,7 @@ namespace MotionPrims
     if (motionCfg (aP))
     {
       assemblyParams_.push_back (aP);
+      compilePath ();
       return CANON_SUCCESS;
     }
 
@@ -355,23 +339,32 @@ namespace MotionPrims
     cur_freq = last_known_freq;
     */
 
+    aP.periodic = true;
+    aP.tabulated = false;
+
     switch (aP.sType)
     {
     case ASSEMBLY_RANDOM:
     case ASSEMBLY_SOBOL:
       //! Ignore the update frequency, each motion needs to be in the range of the specified radius
+      //! (and depends on where the robot is, so it cannot be precomputed)
+      aP.totalPoints = 0;
       break;
     case ASSEMBLY_SPIRAL_OPTIMAL:
       aP.thetaMax = (aP.radius / aP.pitch) * 360.0f;
       aP.radiusOffset = aP.pitch / 360.0f;
       aP.degOffsetDelta = (aP.speed < 360.0f ? aP.speed : 360.0f) / curFreq_;
+      aP.totalPoints = steps(aP.thetaMax / aP.degOffsetDelta);
       break;
     case ASSEMBLY_SPIRAL:
       aP.thetaMax = aP.turns * 360.0f;
       aP.radiusOffset = aP.radius / aP.thetaMax;
       aP.degOffsetDelta = (aP.speed < 360.0f ? aP.speed : 360.0f) / curFreq_;
+      aP.totalPoints = steps(aP.thetaMax / aP.degOffsetDelta);
       break;
     case ASSEMBLY_SQ_SPIRAL:
+      //! Comes to rest at the center once the square is covered
+      aP.periodic = false;
       break;
     case ASSEMBLY_RASTER:
       if (even(aP.turns))
@@ -386,18 +379,23 @@ namespace MotionPrims
       }
       aP.lengthDelta = aP.speed / curFreq_;
       aP.rasterRatio = aP.width / (aP.width + aP.lengthStep);
+      aP.totalPoints = steps(2.0f * (aP.totalLength / aP.lengthDelta));
       break;
     case ASSEMBLY_TILT:
       //! TODO
+      aP.totalPoints = 0;
       break;
     case ASSEMBLY_ROTATION:
       aP.degOffsetDelta = (aP.speed < 360.0f ? aP.speed : 360.0f) / curFreq_;
+      aP.totalPoints = sinePeriod(aP.degOffsetDelta);
       break;
     case ASSEMBLY_CIRCLE:
       aP.degOffsetDelta = (aP.speed < 360.0f ? aP.speed : 360.0f) / curFreq_;
+      aP.totalPoints = steps(360.0f / aP.degOffsetDelta);
       break;
     case ASSEMBLY_HOP:
       aP.degOffsetDelta = aP.speed * curFreq_;
+      aP.totalPoints = sinePeriod(aP.degOffsetDelta);
       break;
     case ASSEMBLY_LINEAR:
       aP.totalLength = sqrt((aP.x * aP.x)+(aP.y * aP.y)+(aP.z * aP.z));
@@ -406,6 +404,7 @@ namespace MotionPrims
       aP.xOffset = (aP.x / aP.lengthDelta) / curFreq_;
       aP.yOffset = (aP.y / aP.lengthDelta) / curFreq_;
       aP.zOffset = (aP.z / aP.lengthDelta) / curFreq_;
+      aP.totalPoints = steps(2.0f * (aP.totalLength / aP.lengthStep));
       break;
     case ASSEMBLY_CONST_OFFSET:
       //aP.speed = 30.0f;
@@ -415,16 +414,245 @@ namespace MotionPrims
       aP.xOffset = aP.x;//(aP.x / aP.lengthDelta) / curFreq_;
       aP.yOffset = aP.y;//(aP.y / aP.lengthDelta) / curFreq_;
       aP.zOffset = aP.z;//(aP.z / aP.lengthDelta) / curFreq_;
+      //! At the start on the first step, and offset from then on
+      aP.totalPoints = 1;
+      aP.periodic = false;
       break;
     default:
       //! Unknown state
       return false;
       break;
     }
+
     return true;
   } //motionCfg
 
 
+  LIBRARY_API void Assembly::compilePath ()
+  {
+    vector<assemblyParams>::iterator api;
+    long long cycle = 1;
+    int prefix = 0, k;
+
+    started_ = false;
+    live_.clear();
+    for (api = assemblyParams_.begin(); api != assemblyParams_.end(); ++api)
+    {
+      api->tabulated = false;
+      if (api->totalPoints < 1)
+      {
+        live_.push_back((int)(api - assemblyParams_.begin()));
+        continue;
+      }
+      if (api->periodic)
+      {
+        //! The cycle must repeat every search's, so searches that would make it too long are
+        //! computed at each step instead
+        long long next = (cycle / gcd((int)cycle, api->totalPoints)) * api->totalPoints;
+        if (next > ASSEMBLY_MAX_POINTS)
+        {
+          live_.push_back((int)(api - assemblyParams_.begin()));
+          continue;
+        }
+        cycle = next;
+      }
+      else if (api->totalPoints > prefix)
+      {
+        prefix = api->totalPoints;
+      }
+      api->tabulated = true;
+    }
+
+    pathPrefix_ = prefix;
+    pathCycle_ = (int)cycle;
+    path_.assign(pathPrefix_ + pathCycle_, robotPose());
+    for (k = 0; k < pathPrefix_ + pathCycle_; ++k)
+    {
+      path_[k].x = path_[k].y = path_[k].z = path_[k].xrot = path_[k].yrot = path_[k].zrot = 0.0f;
+    }
+
+    for (api = assemblyParams_.begin(); api != assemblyParams_.end(); ++api)
+    {
+      if (!api->tabulated)
+      {
+        continue;
+      }
+      if (api->sType == ASSEMBLY_SQ_SPIRAL)
+      {
+        //! At rest (no offset) after the walk, so the cycle is untouched
+        init_sqs_table(*api);
+        continue;
+      }
+      for (k = 0; k < pathPrefix_; ++k)
+      {
+        path_[k] = path_[k] + pathOffset(*api, k);
+      }
+      //! Entry k of the cycle stands for every later step with the same remainder, which for
+      //! a search that has come to rest is just its final offset
+      for (k = 0; k < pathCycle_; ++k)
+      {
+        path_[pathPrefix_ + k] = path_[pathPrefix_ + k] +
+                                 pathOffset(*api, api->periodic ? k : api->totalPoints);
+      }
+    }
+    orderPath();
+  } // compilePath
+
+
+  LIBRARY_API void Assembly::orderPath ()
+  {
+    vector<priorMode>::const_iterator mi;
+    vector<double> density;
+    double best = 0.0, dx, dy;
+    int points = pathPrefix_ + pathCycle_, k;
+
+    order_.clear();
+    if (prior_.empty() || path_.empty())
+    {
+      return;
+    }
+
+    //! Gaussian mixture at every distinct step of the table
+    density.assign(points, 0.0);
+    for (k = 0; k < points; ++k)
+    {
+      for (mi = prior_.begin(); mi != prior_.end(); ++mi)
+      {
+        dx = pathAt(k).x - mi->x;
+        dy = pathAt(k).y - mi->y;
+        density[k] += (mi->weight / (mi->spread * mi->spread)) *
+                      exp(-((dx * dx) + (dy * dy)) / (2.0 * mi->spread * mi->spread));
+      }
+      best = (density[k] > best) ? density[k] : best;
+    }
+
+    //! Beyond about 3.7 standard deviations of every mode, keep the pattern's order rather than
+    //! jumping between steps that are all unlikely
+    for (k = 0; k < points; ++k)
+    {
+      density[k] = (density[k] < (best * 1e-3)) ? 0.0 : density[k];
+      order_.push_back(k);
+    }
+    std::stable_sort(order_.begin(), order_.end(),
+                     [&density] (int a, int b) { return density[a] > density[b]; });
+  } // orderPath
+
+
+  LIBRARY_API CanonReturn Assembly::SetSearchPrior (const vector<priorMode> &modes)
+  {
+    vector<priorMode>::const_iterator mi;
+
+    for (mi = modes.begin(); mi != modes.end(); ++mi)
+    {
+      if (mi->weight < 0.0 || mi->spread <= 0.0)
+      {
+        return CANON_FAILURE;
+      }
+    }
+    prior_ = modes;
+    //! Steps saved from a search in the old order no longer mean the same place
+    started_ = false;
+    orderPath();
+    return CANON_SUCCESS;
+  } // SetSearchPrior
+
+
+  LIBRARY_API const robotPose &Assembly::pathAt (int counter) const
+  {
+    if (counter < 0)
+    {
+      counter = 0;
+    }
+    if (counter < (int)order_.size())
+    {
+      counter = order_[counter];
+    }
+    if (counter < pathPrefix_)
+    {
+      return path_[counter];
+    }
+    return path_[pathPrefix_ + (counter % pathCycle_)];
+  } // pathAt
+
+
+  LIBRARY_API CanonReturn Assembly::GetSearchPath (robotPose &start, vector<robotPose> &path, int points, int first)
+  {
+    vector<int>::iterator li;
+    vector<double> points2;
+    int k;
+
+    if (assemblyParams_.empty())
+    {
+      return CANON_FAILURE;
+    }
+    for (li = live_.begin(); li != live_.end(); ++li)
+    {
+      if (assemblyParams_.at(*li).randWalk)
+      {
+        return CANON_REJECT;
+      }
+    }
+    if (points < 0)
+    {
+      if (!live_.empty())
+      {
+        return CANON_REJECT;
+      }
+      points = pathPrefix_ + pathCycle_;
+    }
+    if (first < 0)
+    {
+      first = 0;
+    }
+
+    path.assign(points, start);
+    if (!path_.empty())
+    {
+      for (k = 0; k < points; ++k)
+      {
+        path[k] = path[k] + pathAt(first + k);
+      }
+    }
+
+    for (li = live_.begin(); li != live_.end(); ++li)
+    {
+      assemblyParams &ap = assemblyParams_.at(*li);
+      switch (ap.sType)
+      {
+      case ASSEMBLY_RANDOM:
+        for (k = (first == 0) ? 1 : 0; k < points; ++k)
+        {
+          path[k] = path[k] + randomOffset(ap, first + k);
+        }
+        break;
+      case ASSEMBLY_SOBOL:
+        //! The whole run of the sequence at once; step 0 is the start pose
+        points2.resize(2 * points);
+        sobol_.seek(first);
+        sobol_.fill(&points2[0], points);
+        for (k = (first == 0) ? 1 : 0; k < points; ++k)
+        {
+          path[k] = path[k] + sobolOffset(ap, &points2[2 * k]);
+        }
+        break;
+      default:
+        for (k = 0; k < points; ++k)
+        {
+          path[k] = path[k] + pathOffset(ap, first + k);
+        }
+        break;
+      }
+    }
+    return CANON_SUCCESS;
+  } // GetSearchPath
+
+
+  LIBRARY_API int Assembly::LastStep () const
+  {
+    return lastStep_;
+  } // LastStep
+
+
   LIBRARY_API CanonReturn Assembly::AddTerminator (terminatorParams &tP)
   {
     termParams_.push_back (tP);
@@ -436,6 +664,11 @@ namespace MotionPrims
   {
     termParams_.clear();
     assemblyParams_.clear();
+    path_.clear();
+    live_.clear();
+    order_.clear();
+    pathPrefix_ = 0;
+    pathCycle_ = 1;
     newSearch = true;
     return CANON_SUCCESS;
   } //ClearSearch
@@ -445,15 +678,13 @@ namespace MotionPrims
   {
     bool state;
     CanonReturn returnMe = CANON_RUNNING;
-    vector<terminatorParams>::iterator tpi;
-    vector<assemblyParams>::iterator api;
     int index;
 
     //! known_freq = get_freq(10, new_search)
 
-    state = true;
     curPose_ = robPose;
     curIO_ = ios;
+    lastStep_ = counter;
 
     if (termParams_.size() < 1)
     {
@@ -463,25 +694,10 @@ namespace MotionPrims
 
     if (newSearch)
     {
-      initPose_ = robPose;
-
-      for (tpi = termParams_.begin(); tpi != termParams_.end(); ++tpi)
-      {
-        if (tpi->tType == TERMINATOR_TIMER)
-        {
-          timer_.stopTimer();
-          timer_.startTimer();
-        }        
-      } // for (tpi ...)
-      newSearch = false;
+      startSearch(robPose);
     } // if (newSearch)
 
-    newPose_ = initPose_;
-
-    for (api = assemblyParams_.begin(); api != assemblyParams_.end(); ++api)
-    {
-      state = state && applyOffset(counter, *api);
-    }
+    state = stepTarget(counter);
 
     if (state)
     {
@@ -511,19 +727,162 @@ namespace MotionPrims
     return returnMe;
   } //RunAssembly
 
+
+  LIBRARY_API CanonReturn Assembly::TestTerminators (const terminatorBatch &batch, int &sample)
+  {
+    double x0 = initPose_.x, y0 = initPose_.y, z0 = initPose_.z, limit, start;
+    int x, hit, index = -1;
+
+    sample = -1;
+    if (termParams_.size() < 1)
+    {
+      return CANON_FAILURE;
+    }
+
+    //! Each condition only needs to be tested up to the earliest hit so far
+    for (x = 0; x < (int)termParams_.size(); ++x)
+    {
+      terminatorParams &tp = termParams_.at(x);
+      const int count = (sample < 0) ? batch.count : sample + 1;
+      const double *t = batch.time, *px = batch.x, *py = batch.y, *pz = batch.z, *fz = batch.fz;
+      const robotIO *ios = batch.ios;
+      const double *tactile = batch.tactile;
+
+      hit = -1;
+      switch (tp.tType)
+      {
+      case TERMINATOR_TIMER:
+        if (t != NULL && timer_.started)
+        {
+          start = timer_.inittime + tp.endTime;
+          hit = firstMatch(count, [t, start] (int i) { return t[i] >= start; });
+        }
+        break;
+      case TERMINATOR_EXTSIGNAL:
+        if (ios != NULL)
+        {
+          const int signal = tp.signal;
+          hit = firstMatch(count, [ios, signal] (int i) { return ios[i].dio[signal]; });
+        }
+        break;
+      case TERMINATOR_ANALOG:
+        if (ios != NULL)
+        {
+          const int signal = tp.signal;
+          limit = tp.threshold;
+          if (tp.rising)
+          {
+            hit = firstMatch(count, [ios, signal, limit] (int i) { return ios[i].aio[signal] >= limit; });
+          }
+          else
+          {
+            hit = firstMatch(count, [ios, signal, limit] (int i) { return ios[i].aio[signal] <= limit; });
+          }
+        }
+        break;
+      case TERMINATOR_CONTACT:
+        if (fz != NULL)
+        {
+          limit = tp.threshold;
+          hit = firstMatch(count, [fz, limit] (int i) { return fabs(fz[i]) >= limit; });
+        }
+        break;
+      case TERMINATOR_TACTILE:
+        if (tactile != NULL)
+        {
+          limit = tp.threshold;
+          hit = firstMatch(count, [tactile, limit] (int i) { return tactile[i] >= limit; });
+        }
+        break;
+      case TERMINATOR_DISTANCE:
+        //! Z travel takes precedence, as in testTerm
+        if (tp.zDelta > 0.0f && pz != NULL)
+        {
+          limit = tp.zDelta;
+          hit = firstMatch(count, [pz, z0, limit] (int i) { return fabs(z0 - pz[i]) >= limit; });
+        }
+        else if (tp.threshold > 0.0f && px != NULL && py != NULL && pz != NULL)
+        {
+          limit = tp.threshold * tp.threshold;
+          hit = firstMatch(count, [px, py, pz, x0, y0, z0, limit] (int i) {
+            double dx = x0 - px[i], dy = y0 - py[i], dz = z0 - pz[i];
+            return ((dx * dx) + (dy * dy) + (dz * dz)) >= limit;
+          });
+        }
+        break;
+      default:
+        break;
+      }
+
+      //! At the same sample, the condition added first wins
+      tp.result = (hit >= 0);
+      if (hit >= 0 && (sample < 0 || hit < sample))
+      {
+        sample = hit;
+        index = x;
+      }
+    }
+
+    if (index < 0)
+    {
+      return CANON_RUNNING;
+    }
+    if (termParams_.at(index).tType == TERMINATOR_TIMER)
+    {
+      timer_.stopTimer();
+    }
+    return termParams_.at(index).rType;
+  } // TestTerminators
+
+
+  LIBRARY_API void Assembly::startSearch (robotPose &robPose, bool resume)
+  {
+    vector<terminatorParams>::iterator tpi;
+
+    if (!resume)
+    {
+      initPose_ = robPose;
+      randSeed_ = rng_.next();
+      started_ = true;
+    }
+
+    for (tpi = termParams_.begin(); tpi != termParams_.end(); ++tpi)
+    {
+      if (tpi->tType == TERMINATOR_TIMER)
+      {
+        timer_.stopTimer();
+        timer_.startTimer();
+      }
+    } // for (tpi ...)
+    newSearch = false;
+  } // startSearch
+
+
+  LIBRARY_API bool Assembly::stepTarget (int counter)
+  {
+    vector<int>::iterator li;
+    bool state = true;
+
+    newPose_ = initPose_;
+    if (!path_.empty())
+    {
+      newPose_ = newPose_ + pathAt(counter);
+    }
+
+    //! Only the searches that could not be precomputed are worked out here
+    for (li = live_.begin(); li != live_.end(); ++li)
+    {
+      state = state && applyOffset(counter, assemblyParams_.at(*li));
+    }
+    return state;
+  } // stepTarget
+
   
   LIBRARY_API bool Assembly::applyOffset (int counter, assemblyParams &ap)
   {
     robotPose deltas;
     //! Initialize variables to 0
     deltas.x = deltas.y = deltas.z = deltas.xrot = deltas.yrot = deltas.zrot = 0.0f;
-    int localCount;
-    double radius;
-    double degOffset;
-    double position;
-    double ratio;
-    double temp;
-    int wholeval;
 
     switch (ap.sType)
     {
@@ -533,51 +892,113 @@ namespace MotionPrims
         deltas.x = (curPose_.x - initPose_.x);
         deltas.y = (curPose_.y - initPose_.y);
       }
-    if (counter > 0) {
-      deltas.x += (ap.radius * ((2500.0f - (double)(rand() % 5000)) / 2500.0f));
-      deltas.y += (ap.radius * ((2500.0f - (double)(rand() % 5000)) / 2500.0f));
-      //cout << endl << "Random Offset " << counter << ": (" << deltas.x << ", " << deltas.y << ")";
-    }
+      if (counter > 0)
+      {
+        deltas = deltas + randomOffset(ap, counter);
+      }
+      break;
+    case ASSEMBLY_SOBOL:
+      if (ap.randWalk)
+      {
+        deltas.x = (curPose_.x - initPose_.x);
+        deltas.y = (curPose_.y - initPose_.y);
+      }
+      //! Point counter of the sequence; its first point (the center) is the pose already being
+      //! tried.  Steps taken in order just continue the sequence.
+      {
+        double point[2];
+        if (sobol_.index() != (uint32_t)counter)
+        {
+          sobol_.seek(counter);
+        }
+        sobol_.next(point);
+        if (counter > 0)
+        {
+          deltas = deltas + sobolOffset(ap, point);
+        }
+      }
+      break;
+    case ASSEMBLY_SQ_SPIRAL:
+      //! Always precomputed
+      return false;
+    case ASSEMBLY_SPIRAL:
+    case ASSEMBLY_SPIRAL_OPTIMAL:
+    case ASSEMBLY_RASTER:
+    case ASSEMBLY_TILT:
+    case ASSEMBLY_ROTATION:
+    case ASSEMBLY_CIRCLE:
+    case ASSEMBLY_HOP:
+    case ASSEMBLY_LINEAR:
+    case ASSEMBLY_CONST_OFFSET:
+      //! Searches whose cycle was too long to precompute
+      deltas = pathOffset(ap, counter);
+      break;
+    default:
+      //! ERROR
+      return false;
       break;
-  case ASSEMBLY_SOBOL:
-    if (ap.randWalk)
-    {
-      deltas.x = (curPose_.x - initPose_.x);
-      deltas.y = (curPose_.y - initPose_.y);
-    }
-    if (counter == 0) { sobseq(&deltas.x, &deltas.y, 0); }
-    else {
-      sobseq(&deltas.x, &deltas.y, 1);
-      deltas.x = (ap.radius * ((0.5f - deltas.x) / 0.5f));
-      deltas.y = (ap.radius * ((0.5f - deltas.y) / 0.5f));
-      //cout << endl << "Sobol Offset " << counter << ": (" << deltas.x << ", " << deltas.y << ")";
     }
-    break;
+
+    newPose_ = newPose_ + deltas;
+    //newPose_.x += deltas.x;
+    //newPose_.y += deltas.y;
+    return true;
+  } // applyOffset
+
+
+  LIBRARY_API robotPose Assembly::randomOffset (const assemblyParams &ap, int counter) const
+  {
+    robotPose deltas;
+    deltas.x = deltas.y = deltas.z = deltas.xrot = deltas.yrot = deltas.zrot = 0.0f;
+
+    deltas.x = ap.radius * ((2.0 * Math::bitsToUnit(Math::randomAt(randSeed_, 2 * (uint64_t)counter))) - 1.0);
+    deltas.y = ap.radius * ((2.0 * Math::bitsToUnit(Math::randomAt(randSeed_, (2 * (uint64_t)counter) + 1))) - 1.0);
+    return deltas;
+  } // randomOffset
+
+
+  LIBRARY_API robotPose Assembly::sobolOffset (const assemblyParams &ap, const double *point)
+  {
+    robotPose deltas;
+    deltas.x = deltas.y = deltas.z = deltas.xrot = deltas.yrot = deltas.zrot = 0.0f;
+
+    deltas.x = (ap.radius * ((0.5f - point[0]) / 0.5f));
+    deltas.y = (ap.radius * ((0.5f - point[1]) / 0.5f));
+    return deltas;
+  } // sobolOffset
+
+
+  LIBRARY_API robotPose Assembly::pathOffset (const assemblyParams &ap, int counter)
+  {
+    robotPose deltas;
+    //! Initialize variables to 0
+    deltas.x = deltas.y = deltas.z = deltas.xrot = deltas.yrot = deltas.zrot = 0.0f;
+    int localCount;
+    double radius;
+    double degOffset;
+    double position;
+    double ratio;
+    double temp;
+    int wholeval;
+
+    switch (ap.sType)
+    {
   case ASSEMBLY_SPIRAL:
   case ASSEMBLY_SPIRAL_OPTIMAL:
-    localCount = counter % (int)(ap.thetaMax / ap.degOffsetDelta);
+    localCount = counter % ap.totalPoints;
       degOffset = localCount * ap.degOffsetDelta;
       radius = degOffset * ap.radiusOffset;
     //cout << endl << "Helix Iteration " << counter << "   Degrees: " << degOffset << "   Radius: " << radius;
       deltas.x = radius * cos(degOffset*(3.141592654/180.0f));
       deltas.y = radius * sin(degOffset*(3.141592654/180.0f));
       break;
-  case ASSEMBLY_SQ_SPIRAL:
-    if (counter < ap.totalPoints)
-    {
-      deltas.x = sqs_x[counter] * ap.lengthStep;
-      deltas.y = sqs_y[counter] * ap.lengthStep;
-
-      //std::cout << "Square Spiral: total = " << ap.totalPoints << ", count = " << counter << ", x = " << deltas.x << ", y = " << deltas.y << std::endl;
-    }
-    break;
   case ASSEMBLY_RASTER:
       temp = ap.totalLength / ap.lengthDelta;
-      localCount = counter % (int)(2.0f * temp);
+      localCount = counter % ap.totalPoints;
 
       if (localCount > temp)
       {
-        localCount = (int)(2.0f * temp) - localCount;
+        localCount = ap.totalPoints - localCount;
       }
 
       position = localCount * ap.lengthDelta;
@@ -620,7 +1041,7 @@ namespace MotionPrims
       deltas.zrot = ap.magnitude * sin((counter * ap.degOffsetDelta)*(3.141592654/180.0f));
       break;
     case ASSEMBLY_CIRCLE:
-      localCount = counter % (int)(360.0f / ap.degOffsetDelta);
+      localCount = counter % ap.totalPoints;
       temp = localCount * ap.degOffsetDelta;
       deltas.x = ap.radius - (ap.radius * cos(temp));
       deltas.y = ap.radius * sin(temp*(3.141592654/180.0f));
@@ -630,10 +1051,10 @@ namespace MotionPrims
       break;
     case ASSEMBLY_LINEAR:
       temp = ap.totalLength / ap.lengthStep;
-      localCount = counter % (int)(2.0f * temp);
+      localCount = counter % ap.totalPoints;
       if (localCount > temp)
       {
-        localCount = (int)(2.0f * temp) - localCount;
+        localCount = ap.totalPoints - localCount;
       }
       deltas.x = localCount * ap.xOffset;
       deltas.y = localCount * ap.yOffset;
@@ -655,16 +1076,10 @@ namespace MotionPrims
       }
       break;
     default:
-      //! ERROR
-      return false;
       break;
     }
-
-    newPose_ = newPose_ + deltas;
-    //newPose_.x += deltas.x;
-    //newPose_.y += deltas.y;
-    return true;
-  } // applyOffset
+    return deltas;
+  } // pathOffset
 
 
   LIBRARY_API CanonReturn Assembly::AddTerminatorTimer (CanonReturn rType, double timeout)
@@ -688,6 +1103,17 @@ namespace MotionPrims
     return AddTerminator(tP);
   }
 
+  LIBRARY_API CanonReturn Assembly::AddTerminatorTactile (CanonReturn rType, double threshold)
+  {
+    terminatorParams tP;
+
+    tP.tType = TERMINATOR_TACTILE;
+    tP.rType = rType;
+    tP.threshold = fabs(threshold);
+
+    return AddTerminator(tP);
+  }
+
   LIBRARY_API CanonReturn Assembly::AddTerminatorSignal (CanonReturn rType, int signal)
   {
     terminatorParams tP;
@@ -699,6 +1125,24 @@ namespace MotionPrims
   }
 
 
+  LIBRARY_API CanonReturn Assembly::AddTerminatorAnalog (CanonReturn rType, int signal, double threshold, bool rising)
+  {
+    terminatorParams tP;
+
+    if (signal < 0 || signal >= CRPI_IO_MAX)
+    {
+      return CANON_FAILURE;
+    }
+    tP.tType = TERMINATOR_ANALOG;
+    tP.rType = rType;
+    tP.signal = signal;
+    tP.threshold = threshold;
+    tP.rising = rising;
+
+    return AddTerminator(tP);
+  }
+
+
   LIBRARY_API CanonReturn Assembly::AddTerminatorDistance (CanonReturn rType, double x, double y, double z, double total)
   {
     terminatorParams tP;
@@ -782,11 +1226,29 @@ namespace MotionPrims
           return false;
         }
         break;
+      case TERMINATOR_ANALOG:
+        if (termParams_.at(x).rising)
+        {
+          termParams_.at(x).result = (curIO_.aio[termParams_.at(x).signal] >= termParams_.at(x).threshold);
+        }
+        else
+        {
+          termParams_.at(x).result = (curIO_.aio[termParams_.at(x).signal] <= termParams_.at(x).threshold);
+        }
+        if (termParams_.at(x).result)
+        {
+          index = x;
+          return false;
+        }
+        break;
       case TERMINATOR_CONTACT:
-        /*
-        TODO
-        TERMINATORS[COUNTER].RESULT_ = TERMINATORS[COUNTER].RESULT_ OR (ABS($TORQUE_TCP_EST.FT.Z) >= TERMINATORS[COUNTER].THRESHOLD_)
-        */
+        //! Force along the TCP's Z axis, as in the KRL original
+        termParams_.at(x).result = sensing_ && (fabs(curForces_.z) >= termParams_.at(x).threshold);
+        if (termParams_.at(x).result)
+        {
+          index = x;
+          return false;
+        }
         break;
       case TERMINATOR_DISTANCE:
         dx = fabs(initPose_.x - curPose_.x);
@@ -812,6 +1274,10 @@ namespace MotionPrims
       case TERMINATOR_REPETITION:
         //! TODO
         break;
+      case TERMINATOR_TACTILE:
+        //! Tactile forces come from the hand, in TestTerminators batches only
+        termParams_.at(x).result = false;
+        break;
       case TERMINATOR_NONE:
       default:
         termParams_.at(x).result = false;
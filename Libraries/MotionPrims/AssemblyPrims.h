@@ -17,6 +17,11 @@
 #include "crpi.h"
 #include <vector>
 #include "crpi_robot.h"
+#include "../Math/Random.h"
+
+//! @brief Largest repeating cycle (in steps) of a precomputed search path
+//!
+#define ASSEMBLY_MAX_POINTS 65536
 
 namespace MotionPrims
 {
@@ -46,6 +51,8 @@ namespace MotionPrims
     TERMINATOR_TIMER,
     TERMINATOR_DISTANCE,
     TERMINATOR_REPETITION,
+    TERMINATOR_ANALOG,
+    TERMINATOR_TACTILE,
     TERMINATOR_NONE
   } TermType;
 
@@ -151,7 +158,58 @@ namespace MotionPrims
     double thetaMax;
     double rasterRatio;
     double pitch;
+
+    //! @brief Steps in one cycle of the search (periodic), or before it comes to rest (not
+    //!        periodic); 0 if the search cannot be precomputed
     int totalPoints;
+    bool periodic;
+
+    //! @brief Whether the search is part of the precomputed path (or computed at each step)
+    bool tabulated;
+  };
+
+  //! @brief A run of feedback samples (e.g., from a stream), as one array per quantity so that
+  //!        the terminators are tested over contiguous values.  Quantities left NULL are not
+  //!        tested.
+  //!
+  struct LIBRARY_API terminatorBatch
+  {
+    //! @brief Number of samples
+    int count;
+
+    //! @brief Time of each sample (s, ulapi_time), for timer conditions
+    const double *time;
+
+    //! @brief TCP position of each sample, for distance conditions
+    const double *x;
+    const double *y;
+    const double *z;
+
+    //! @brief Force along the TCP's Z axis at each sample, for contact conditions
+    const double *fz;
+
+    //! @brief I/O of each sample, for signal conditions
+    const robotIO *ios;
+
+    //! @brief Tactile force (N) at each sample (e.g., CrpiTactileContacts::total from the hand's
+    //!        "tactile_contacts"), for tactile conditions
+    const double *tactile;
+  };
+
+  //! @brief One mode of a prior over where searches end, e.g., a cluster of the successful
+  //!        termination poses of past insertions
+  //!
+  struct LIBRARY_API priorMode
+  {
+    //! @brief Center of the mode, as an offset from the start of the search
+    double x;
+    double y;
+
+    //! @brief Relative likelihood of the mode (e.g., its number of members)
+    double weight;
+
+    //! @brief Standard deviation about the center (length units)
+    double spread;
   };
 
   //! @brief A collection of termination conditions that define when to stop the assembly search
@@ -165,6 +223,7 @@ namespace MotionPrims
     int timer;
     double endTime;
     int signal;
+    bool rising;
     double xDelta;
     double yDelta;
     double zDelta;
@@ -324,6 +383,32 @@ namespace MotionPrims
     //!
     CanonReturn AddTerminatorSignal (CanonReturn rType, int signal);
 
+    //! @brief Add a condition that terminates the search when an analog input crosses a level
+    //!        (e.g., a load cell or vacuum sensor merged into the robot's I/O by Sensor::NIDAQ)
+    //!
+    //! @param rType     Specified return time upon meeting the termination condition
+    //! @param signal    The AI/O input number to monitor
+    //! @param threshold The level at which the search must stop
+    //! @param rising    Stop when the input is at or above the level (true), or at or below it
+    //!                  (false)
+    //!
+    //! @return CANON_SUCCESS if the termination condition was added successfully, CANON_FAILURE otherwise
+    //!
+    CanonReturn AddTerminatorAnalog (CanonReturn rType, int signal, double threshold, bool rising = true);
+
+    //! @brief Add a condition that terminates the search when the hand's tactile pads feel a
+    //!        contact
+    //!
+    //! @param rType     Specified return time upon meeting the termination condition
+    //! @param threshold Total contact force (N) over the pads that terminates the search
+    //!
+    //! @return CANON_SUCCESS if the termination condition was added successfully, CANON_FAILURE otherwise
+    //!
+    //! @note Only tested by TestTerminators, with the batch's tactile forces, since the arm's
+    //!       own feedback has none
+    //!
+    CanonReturn AddTerminatorTactile (CanonReturn rType, double threshold);
+
     //! @brief TODO
     //!
     //! @param rType Specified return time upon meeting the termination condition
@@ -345,6 +430,24 @@ namespace MotionPrims
     //!
     CanonReturn AddTerminatorRepetition (CanonReturn rType, int reps);
 
+    //! @brief Visit the precomputed steps of the search in order of how likely the prior makes
+    //!        them to end the search, so that the usual hole offsets are tried first.  Each mode
+    //!        is a Gaussian; steps where the mixture is negligible keep the search's own order,
+    //!        after the others.
+    //!
+    //! @param modes The prior (empty to search in the pattern's order)
+    //!
+    //! @return CANON_SUCCESS if the prior was set, CANON_FAILURE if a weight is negative or a
+    //!         spread is not positive
+    //!
+    //! @note A prior from Clustering::kMeans run on the (x, y) offsets of past termination poses
+    //!       has one mode per cluster:  getClusterInfo gives the center, getClusters ().at (k).size
+    //!       the weight.  Only precomputed steps are reordered; the random and Sobol searches, and
+    //!       steps past the first cycle, are visited in their own order.  The prior is kept when
+    //!       the searches are cleared.
+    //!
+    CanonReturn SetSearchPrior (const vector<priorMode> &modes);
+
     //! @brief Clear the search and terminator parameters
     //!
     //! @return CANON_SUCCESS if paramters successfully cleared, CANON_FAILURE otherwise
@@ -362,6 +465,79 @@ namespace MotionPrims
     //!
     CanonReturn RunAssemblyStep (int counter, robotPose &robPose, robotPose &newPose, robotIO &ios);
 
+    //! @brief Test the termination conditions over a run of samples received since the last
+    //!        step, against the current search's start pose and timer, instead of passing each
+    //!        sample to RunAssemblyStep
+    //!
+    //! @param batch  The samples, oldest first
+    //! @param sample The first sample at which a condition is met (-1 if none), populated by
+    //!               this function
+    //!
+    //! @return The return type of the first condition met at that sample (in the order the
+    //!         conditions were added, as in RunAssemblyStep), CANON_RUNNING if none is met, and
+    //!         CANON_FAILURE if no termination condition is defined
+    //!
+    CanonReturn TestTerminators (const terminatorBatch &batch, int &sample);
+
+    //! @brief Get the waypoints of the configured search, e.g., for MoveThroughTo or a stream, in
+    //!        place of stepping through RunAssemblyStep
+    //!
+    //! @param start  The pose at the start of the search
+    //! @param path   The targets of steps first through first + points - 1, populated by this
+    //!               function
+    //! @param points Number of steps (-1 for the steps before the path starts repeating, plus one
+    //!               full cycle)
+    //! @param first  The first step, e.g., to continue a search from LastStep
+    //!
+    //! @return CANON_SUCCESS if the path was generated, CANON_REJECT if a search depends on the
+    //!         robot's progress (random and Sobol walks) or never repeats (random and Sobol
+    //!         searches, and searches too long to precompute) and points is -1, CANON_FAILURE if
+    //!         no search is defined
+    //!
+    //! @note Random and Sobol offsets are generated in one batch, and depend only on the step, so
+    //!       any part of the path can be regenerated without the steps before it
+    //!
+    CanonReturn GetSearchPath (robotPose &start, vector<robotPose> &path, int points = -1, int first = 0);
+
+    //! @brief The last step the most recent search reached (the counter of the last call to
+    //!        RunAssemblyStep, or the step at which Execute stopped)
+    //!
+    int LastStep () const;
+
+    //! @brief Run the whole search as one continuous stream of setpoints, from the robot's current
+    //!        pose, instead of a move per search step.  Steps are taken at the rate the search
+    //!        parameters assume, with the setpoints in between blended linearly, and the
+    //!        termination conditions are tested against the robot's feedback at each setpoint.
+    //!
+    //! @param robot  The robot, which must support BeginStream
+    //! @param period Seconds between setpoints (match the robot's "stream_period")
+    //! @param first  Step to start from.  0 starts a new search at the robot's pose; any other
+    //!               step continues the last search (e.g., from LastStep after a failed
+    //!               insertion), with the same start pose and offsets, and the timers restarted.
+    //!
+    //! @return The return type of the termination condition that ended the search, CANON_REJECT
+    //!         if the robot cannot stream or there is no search to continue, CANON_FAILURE if no
+    //!         termination condition is defined or a setpoint or feedback request fails
+    //!
+    //! @note Contact conditions are only tested here, since RunAssemblyStep is not given forces
+    //!
+    template <class T> CanonReturn Execute (crpi_robot::CrpiRobot<T> &robot, double period = 0.008, int first = 0);
+
+    //! @brief Run the whole search on the robot's controller (SetParameter "guarded_search"), so
+    //!        that the termination conditions are tested at the controller's rate rather than on
+    //!        the feedback CRPI receives.  Timer, contact, distance, and signal conditions can be
+    //!        offloaded this way.
+    //!
+    //! @param robot   The robot, starting from its current pose
+    //! @param endPose The robot's pose when the search ended, populated by this function (may be
+    //!                NULL)
+    //!
+    //! @return The return type of the termination condition that ended the search, CANON_REJECT
+    //!         if the robot cannot run searches or the search or its conditions cannot be
+    //!         precomputed, CANON_FAILURE if no termination condition is defined or the search failed
+    //!
+    template <class T> CanonReturn Offload (crpi_robot::CrpiRobot<T> &robot, robotPose *endPose = NULL);
+
   private:
 
     //! @brief Whether or not the current assembly search is the first instance it has been configured
@@ -384,6 +560,12 @@ namespace MotionPrims
     //!
     robotIO curIO_;
 
+    //! @brief Current forces at the robot's TCP, and whether they have been measured (only while
+    //!        the search is run by Execute)
+    //!
+    robotPose curForces_;
+    bool sensing_;
+
     //! @brief Timer for maintaining correct motion profile and tracking timer-based termination conditions
     //!
     AssemblyTimer timer_;
@@ -400,10 +582,38 @@ namespace MotionPrims
     //!
     double curFreq_;
 
-    //! @brief TODO
+    //! @brief Summed offsets of the tabulated searches: pathPrefix_ steps from the start of the
+    //!        search, followed by a cycle of pathCycle_ steps indexed by (counter % pathCycle_)
+    //!
+    vector<robotPose> path_;
+    int pathPrefix_;
+    int pathCycle_;
+
+    //! @brief Indices of the searches in assemblyParams_ that are computed at each step
+    //!
+    vector<int> live_;
+
+    //! @brief Prior over where the search ends, and the step of path_ visited at each of the
+    //!        first (pathPrefix_ + pathCycle_) steps (empty for the pattern's own order)
+    //!
+    vector<priorMode> prior_;
+    vector<int> order_;
+
+    //! @brief Draws the seed of each new ASSEMBLY_RANDOM search, whose offsets are then
+    //!        Math::randomAt (seed, step), so that any step can be regenerated
+    //!
+    Math::Xoshiro256 rng_;
+    uint64_t randSeed_;
+
+    //! @brief Whether a search has been started since the searches were last changed (and so can
+    //!        be continued), and the last step it reached
     //!
-    int *sqs_x;
-    int *sqs_y;
+    bool started_;
+    int lastStep_;
+
+    //! @brief Low-discrepancy sequence of the ASSEMBLY_SOBOL search
+    //!
+    Math::Sobol sobol_;
 
     //! @brief TODO
     //!
@@ -443,14 +653,310 @@ namespace MotionPrims
     //! @return TODO
     //!
     bool testTerm (int &index);
-    
-    //! @brief TODO
+
+    //! @brief Offset of a search at a step, for all but the random, Sobol, and square spiral searches
+    //!
+    //! @param ap      The search
+    //! @param counter The step
+    //!
+    //! @return The offset from the start of the search
+    //!
+    static robotPose pathOffset (const assemblyParams &ap, int counter);
+
+    //! @brief Offset of a random search at a step (before any walk)
+    //!
+    robotPose randomOffset (const assemblyParams &ap, int counter) const;
+
+    //! @brief Offset of a Sobol search at a point of the sequence (before any walk)
+    //!
+    static robotPose sobolOffset (const assemblyParams &ap, const double *point);
+
+    //! @brief Rebuild path_ and live_ from assemblyParams_
+    //!
+    void compilePath ();
+
+    //! @brief Rebuild order_ from prior_ and path_
+    //!
+    void orderPath ();
+
+    //! @brief Add the square spiral walk of a search to the first steps of path_
+    //!
+    //! @param ap The square spiral search
+    //!
+    void init_sqs_table (const assemblyParams &ap);
+
+    //! @brief Summed offset of the tabulated searches at a step
+    //!
+    const robotPose &pathAt (int counter) const;
+
+    //! @brief Record the start of a search (its pose, and its timer if one is used)
+    //!
+    //! @param robPose The pose of the robot at the start of the search
+    //! @param resume  Only restart the timers, keeping the start pose and offsets of the search
+    //!                being continued
     //!
-    //! @param table_size TODO
+    void startSearch (robotPose &robPose, bool resume = false);
+
+    //! @brief Compute the target pose of a step into newPose_
+    //!
+    //! @param counter The step
+    //!
+    //! @return True if the target was computed, false if a search is not defined correctly
+    //!
+    bool stepTarget (int counter);
+
+    //! @brief Get the robot's pose, I/O, and forces into curPose_, curIO_, and curForces_, from
+    //!        its latest state snapshot if it publishes them
+    //!
+    //! @return True if the feedback was read, false otherwise
     //!
-    void init_sqs_table(int table_size);
+    template <class T> bool readFeedback (crpi_robot::CrpiRobot<T> &robot);
   }; // Assembly
 
+
+  template <class T> CanonReturn Assembly::Execute (crpi_robot::CrpiRobot<T> &robot, double period, int first)
+  {
+    CanonReturn returnMe = CANON_RUNNING;
+    robotPose from, to, target;
+    double start, step;
+    void *timer;
+    int counter = first, index;
+
+    if (termParams_.size() < 1)
+    {
+      //! At least one termination condition must be defined
+      return CANON_FAILURE;
+    }
+    if (first < 0 || (first > 0 && !started_))
+    {
+      return CANON_REJECT;
+    }
+    if (!readFeedback(robot))
+    {
+      return CANON_FAILURE;
+    }
+
+    startSearch(curPose_, first > 0);
+    if (!stepTarget(counter))
+    {
+      newSearch = true;
+      return CANON_FAILURE;
+    }
+    from = newPose_;
+    stepTarget(counter + 1);
+    to = newPose_;
+
+    if ((returnMe = robot.BeginStream()) != CANON_SUCCESS)
+    {
+      newSearch = true;
+      return returnMe;
+    }
+    returnMe = CANON_RUNNING;
+    sensing_ = true;
+    timer = ulapi_periodic_new(period);
+    start = ulapi_time();
+
+    while (returnMe == CANON_RUNNING)
+    {
+      if (timer != NULL)
+      {
+        ulapi_periodic_wait(timer);
+      }
+      else
+      {
+        ulapi_sleep(period);
+      }
+
+      if (!readFeedback(robot))
+      {
+        returnMe = CANON_FAILURE;
+        break;
+      }
+      if (!testTerm(index))
+      {
+        returnMe = termParams_.at(index).rType;
+        break;
+      }
+
+      //! Advance to the search step that the elapsed time falls in, then blend toward the next
+      step = first + ((ulapi_time() - start) * curFreq_);
+      while (counter + 1 <= (int)step)
+      {
+        ++counter;
+        from = to;
+        if (!stepTarget(counter + 1))
+        {
+          returnMe = CANON_FAILURE;
+          break;
+        }
+        to = newPose_;
+      }
+      if (returnMe != CANON_RUNNING)
+      {
+        break;
+      }
+      target = from + ((to - from) * (step - counter));
+      if (robot.StreamPose(target) != CANON_SUCCESS)
+      {
+        returnMe = CANON_FAILURE;
+      }
+    }
+
+    robot.EndStream();
+    if (timer != NULL)
+    {
+      ulapi_periodic_delete(timer);
+    }
+    sensing_ = false;
+    newSearch = true;
+    lastStep_ = counter;
+    return returnMe;
+  } // Execute
+
+
+  template <class T> CanonReturn Assembly::Offload (crpi_robot::CrpiRobot<T> &robot, robotPose *endPose)
+  {
+    crpiGuardedSearch search;
+    vector<robotPose> path;
+    CanonReturn returnMe;
+    int which[SEARCH_TIMEOUT + 1], x;
+
+    if (termParams_.size() < 1)
+    {
+      //! At least one termination condition must be defined
+      return CANON_FAILURE;
+    }
+
+    //! Of several conditions of a kind, the tightest is the one that can end the search
+    for (x = 0; x <= SEARCH_TIMEOUT; ++x)
+    {
+      which[x] = -1;
+    }
+    for (x = 0; x < (int)termParams_.size(); ++x)
+    {
+      terminatorParams &tp = termParams_.at(x);
+      switch (tp.tType)
+      {
+      case TERMINATOR_TIMER:
+        if (which[SEARCH_TIMEOUT] < 0 || tp.endTime < search.timeout)
+        {
+          search.timeout = tp.endTime;
+          which[SEARCH_TIMEOUT] = x;
+        }
+        break;
+      case TERMINATOR_CONTACT:
+        if (which[SEARCH_CONTACT] < 0 || tp.threshold < search.contact)
+        {
+          search.contact = tp.threshold;
+          which[SEARCH_CONTACT] = x;
+        }
+        break;
+      case TERMINATOR_DISTANCE:
+        if (which[SEARCH_DISTANCE] >= 0)
+        {
+          return CANON_REJECT;
+        }
+        //! Z travel takes precedence, as in testTerm
+        if (tp.zDelta > 0.0f)
+        {
+          search.zDelta = tp.zDelta;
+        }
+        else
+        {
+          search.distance = tp.threshold;
+        }
+        which[SEARCH_DISTANCE] = x;
+        break;
+      case TERMINATOR_EXTSIGNAL:
+        if (which[SEARCH_SIGNAL] >= 0)
+        {
+          return CANON_REJECT;
+        }
+        search.signal = tp.signal;
+        which[SEARCH_SIGNAL] = x;
+        break;
+      default:
+        //! Not something the controller can test
+        return CANON_REJECT;
+      }
+    }
+
+    if (robot.GetRobotPose(&curPose_) != CANON_SUCCESS)
+    {
+      return CANON_FAILURE;
+    }
+    if (!live_.empty())
+    {
+      //! The controller takes a table of prefix and cycle
+      return CANON_REJECT;
+    }
+    startSearch(curPose_);
+    newSearch = true;
+    if ((returnMe = GetSearchPath(curPose_, path)) != CANON_SUCCESS)
+    {
+      return returnMe;
+    }
+
+    search.path = &path[0];
+    search.prefix = pathPrefix_;
+    search.cycle = pathCycle_;
+    search.step = 1.0f / curFreq_;
+    if ((returnMe = robot.SetParameter("guarded_search", &search)) != CANON_SUCCESS)
+    {
+      return returnMe;
+    }
+
+    if (endPose != NULL)
+    {
+      *endPose = search.pose;
+    }
+    if (search.reason <= SEARCH_RUNNING || search.reason > SEARCH_TIMEOUT || which[search.reason] < 0)
+    {
+      return CANON_FAILURE;
+    }
+    return termParams_.at(which[search.reason]).rType;
+  } // Offload
+
+
+  template <class T> bool Assembly::readFeedback (crpi_robot::CrpiRobot<T> &robot)
+  {
+    RobotStateSnapshot state;
+    unsigned int need = STATE_POSE | STATE_IO | STATE_FORCES;
+    int i;
+
+    if (robot.GetRobotState(&state) == CANON_SUCCESS && (state.valid & need) == need)
+    {
+      curPose_ = state.pose;
+      curForces_ = state.forces;
+      for (i = 0; i < state.ndio && i < CRPI_IO_MAX; ++i)
+      {
+        curIO_.dio[i] = state.dio[i];
+      }
+      for (i = 0; i < state.naio && i < CRPI_IO_MAX; ++i)
+      {
+        curIO_.aio[i] = state.aio[i];
+      }
+      curIO_.ndio = state.ndio;
+      curIO_.naio = state.naio;
+      return true;
+    }
+
+    //! The robot does not publish snapshots (or not all of these), so ask for each
+    if (robot.GetRobotPose(&curPose_) != CANON_SUCCESS)
+    {
+      return false;
+    }
+    if (robot.GetRobotIO(&curIO_) != CANON_SUCCESS)
+    {
+      curIO_ = robotIO();
+    }
+    if (robot.GetRobotForces(&curForces_) != CANON_SUCCESS)
+    {
+      curForces_ = robotPose();
+    }
+    return true;
+  } // readFeedback
+
 } // namespace MotionPrims
 
 #endif
\ No newline at end of file
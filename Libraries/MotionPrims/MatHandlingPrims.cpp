@@ -17,101 +17,184 @@
 
 namespace MotionPrims
 {
-  LIBRARY_API MatHandling::MatHandling ()
+  LIBRARY_API MatHandling::MatHandling () :
+    gripLead_(0.0),
+    gripper_(-1)
   {
+    newSearch = true;
   }
 
 
   LIBRARY_API MatHandling::~MatHandling()
   {
   }
-  
-  /*
-  LIBRARY_API bool MatHandling::motionCfg (assemblyParams &aP)
+
+
+  LIBRARY_API CanonReturn MatHandling::AddGetPart(robotPose &hover, robotPose &acquire, robotPose &retract)
   {
-    return true;
-  } //motionCfg
-  */
+    robotPose lead = acquire;
+    double dist = acquire.distance(hover), f;
+
+    //! An open gripper is left open; otherwise it opens on the way to the hover pose, which the
+    //! robot stops at so the descent does not start until it has
+    if (gripper_ != 0)
+    {
+      addTool(0.0, true);
+    }
+    addMove(hover, gripper_ == 0);
+    gripper_ = 0;
+
+    if (gripLead_ > 0.0 && dist > gripLead_)
+    {
+      //! Stop short of the part, then close during the last of the descent
+      f = gripLead_ / dist;
+      lead.x += (hover.x - acquire.x) * f;
+      lead.y += (hover.y - acquire.y) * f;
+      lead.z += (hover.z - acquire.z) * f;
+      addMove(lead, false);
+      addTool(1.0, true);
+      addMove(acquire, false);
+    }
+    else
+    {
+      addMove(acquire, false);
+      addTool(1.0, false);
+    }
+    gripper_ = 1;
 
-  LIBRARY_API CanonReturn MatHandling  ::ClearMotions ()
+    addMove(retract, true);
+    return CANON_SUCCESS;
+  } // AddGetPart
+
+
+  LIBRARY_API CanonReturn MatHandling::AddGetPart(robotPose &acquire, robotPose &relHover)
   {
-    //! Not yet implemented
-    return CANON_REJECT;
-  } //ClearSearch
+    robotPose hover = acquire;
 
+    hover.x += relHover.x;
+    hover.y += relHover.y;
+    hover.z += relHover.z;
+    hover.xrot += relHover.xrot;
+    hover.yrot += relHover.yrot;
+    hover.zrot += relHover.zrot;
+    return AddGetPart(hover, acquire, hover);
+  } // AddGetPart
 
-  LIBRARY_API CanonReturn MatHandling::RunMatHandleStep (int counter, robotPose &robPose, robotPose &newPose, robotIO &ios)
+
+  LIBRARY_API CanonReturn MatHandling::AddMovePart(robotPose &target)
   {
-    //! Not yet imnplemented
-    return CANON_REJECT;
-/*
-    bool state;
-    CanonReturn returnMe = CANON_RUNNING;
-    vector<terminatorParams>::iterator tpi;
-    vector<assemblyParams>::iterator api;
-    int index;
-
-    //! known_freq = get_freq(10, new_search)
-
-    state = true;
-    curPose_ = robPose;
-    curIO_ = ios;
+    addMove(target, true);
+    return CANON_SUCCESS;
+  } // AddMovePart
+
+
+  LIBRARY_API CanonReturn MatHandling::AddPutPart(robotPose &hover, robotPose &place, robotPose &retract)
+  {
+    //! The part is only released once the robot has stopped at the place pose
+    addMove(hover, true);
+    addMove(place, false);
+    addTool(0.0, false);
+    gripper_ = 0;
+    addMove(retract, true);
+    return CANON_SUCCESS;
+  } // AddPutPart
+
 
-    if (termParams_.size() < 1)
+  LIBRARY_API CanonReturn MatHandling::SetGripLead (double lead)
+  {
+    if (lead < 0.0)
     {
-      //! At least one termination condition must be defined
       return CANON_FAILURE;
     }
+    gripLead_ = lead;
+    return CANON_SUCCESS;
+  } // SetGripLead
 
-    if (newSearch)
-    {
-      initPose_ = robPose;
 
-      for (tpi = termParams_.begin(); tpi != termParams_.end(); ++tpi)
-      {
-        if (tpi->tType == TERMINATOR_TIMER)
-        {
-          timer_.stopTimer();
-          timer_.startTimer();
-        }        
-      } // for (tpi ...)
-      newSearch = false;
-    } // if (newSearch)
+  LIBRARY_API CanonReturn MatHandling::ClearMotions ()
+  {
+    actions_.clear();
+    gripper_ = -1;
+    newSearch = true;
+    return CANON_SUCCESS;
+  } //ClearMotions
 
-    newPose_ = initPose_;
 
-    for (api = assemblyParams_.begin(); api != assemblyParams_.end(); ++api)
+  LIBRARY_API const vector<matHandleAction> &MatHandling::Actions () const
+  {
+    return actions_;
+  } // Actions
+
+
+  LIBRARY_API CanonReturn MatHandling::RunMatHandleStep (int counter, robotPose &robPose, robotPose &newPose, robotIO &ios, double &tool)
+  {
+    curPose_ = robPose;
+    curIO_ = ios;
+    tool = -1.0;
+
+    if (actions_.empty())
     {
-      state = state && applyOffset(counter, *api);
+      return CANON_FAILURE;
     }
 
-    if (state)
+    if (newSearch)
     {
-      state &= testTerm (index);
+      initPose_ = robPose;
+      newSearch = false;
     }
-    else
+
+    if (counter < 0 || counter >= (int)actions_.size())
     {
+      //! Sequence complete
+      newPose = robPose;
       newSearch = true;
-      return CANON_FAILURE;
+      return CANON_SUCCESS;
     }
 
-    if (state)
+    matHandleAction &act = actions_.at(counter);
+    if (act.type == MATHANDLE_TOOL)
     {
-      newPose = newPose_;
-      //! Termination condition not met, still searching
-//      state &= (robot_->MoveTo(newPose_) == CANON_SUCCESS);
-      //counter += 1;
+      newPose = robPose;
+      tool = act.tool;
     }
     else
     {
-      //! Search terminated (success, error, fail)
-      //! Type of terminator condition found at termParms_.at(index).tType
-      returnMe = termParams_.at(index).rType;
-      newSearch = true;
+      newPose = act.pose;
     }
-    
-    return returnMe;
-    */
-  } //RunAssembly
+    newPose_ = newPose;
+    return CANON_RUNNING;
+  } //RunMatHandleStep
+
+
+  LIBRARY_API CanonReturn MatHandling::RunMatHandleStep (int counter, robotPose &robPose, robotPose &newPose, robotIO &ios)
+  {
+    double tool;
+    return RunMatHandleStep(counter, robPose, newPose, ios, tool);
+  } //RunMatHandleStep
+
+
+  void MatHandling::addMove (robotPose &pose, bool blend)
+  {
+    matHandleAction act;
+
+    act.type = MATHANDLE_MOVE;
+    act.pose = pose;
+    act.blend = blend;
+    act.tool = -1.0;
+    act.overlap = false;
+    actions_.push_back(act);
+  } // addMove
+
+
+  void MatHandling::addTool (double tool, bool overlap)
+  {
+    matHandleAction act;
+
+    act.type = MATHANDLE_TOOL;
+    act.blend = false;
+    act.tool = tool;
+    act.overlap = overlap;
+    actions_.push_back(act);
+  } // addTool
 
-} // namespace MotionPrims
\ No newline at end of file
+} // namespace MotionPrims
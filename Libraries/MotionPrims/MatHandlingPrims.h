@@ -20,6 +20,30 @@
 
 namespace MotionPrims
 {
+  //! @brief Material handling action identifiers
+  //!
+  typedef enum
+  {
+    MATHANDLE_MOVE = 0,
+    MATHANDLE_TOOL
+  } MatHandleType;
+
+  //! @brief One action of the compiled pick-and-place sequence
+  //!
+  struct LIBRARY_API matHandleAction
+  {
+    MatHandleType type;
+
+    //! @brief Target of a motion, and whether the robot passes through it without stopping
+    robotPose pose;
+    bool blend;
+
+    //! @brief Setting of a gripper action (0 open, 1 closed), and whether it runs alongside the
+    //!        motion that follows it (otherwise that motion waits for the gripper)
+    double tool;
+    bool overlap;
+  };
+
   //! @ingroup MotionPrims
   //!
   class LIBRARY_API MatHandling
@@ -33,23 +57,58 @@ namespace MotionPrims
     //!
     ~MatHandling ();
 
-    //! @brief TODO
+    //! @brief Add picking up a part to the queue:  pass through the hover pose, grip the part at
+    //!        the acquire pose, and leave through the retract pose
     //!
-    //! @param hover
-    //! @param acquire
-    //! @param retract
+    //! @param hover   Pose above the part
+    //! @param acquire Pose at which the part is gripped
+    //! @param retract Pose to which the part is lifted
     //!
-    //! @return CANON_SUCCESS if the search routine was added successfully, CANON_FAILURE otherwise
+    //! @return CANON_SUCCESS if the action was added successfully, CANON_FAILURE otherwise
     //!
     CanonReturn AddGetPart(robotPose &hover, robotPose &acquire, robotPose &retract);
-    CanonReturn AddGetPart(robotPose &acquire, robotPose &relHover);
-
 
+    //! @brief Add picking up a part, approached from and retracted to the same offset
+    //!
+    //! @param acquire  Pose at which the part is gripped
+    //! @param relHover Offset of the hover (and retract) pose from the acquire pose
+    //!
+    //! @return CANON_SUCCESS if the action was added successfully, CANON_FAILURE otherwise
+    //!
+    CanonReturn AddGetPart(robotPose &acquire, robotPose &relHover);
 
+    //! @brief Add carrying the part through a pose (blended with the motions around it)
+    //!
+    //! @param target The pose to pass through
+    //!
+    //! @return CANON_SUCCESS if the action was added successfully, CANON_FAILURE otherwise
+    //!
     CanonReturn AddMovePart(robotPose &target);
 
+    //! @brief Add placing the part:  pass through the hover pose, release the part at the place
+    //!        pose, and leave through the retract pose
+    //!
+    //! @param hover   Pose above the place pose
+    //! @param place   Pose at which the part is released
+    //! @param retract Pose to which the gripper withdraws
+    //!
+    //! @return CANON_SUCCESS if the action was added successfully, CANON_FAILURE otherwise
+    //!
     CanonReturn AddPutPart(robotPose &hover, robotPose &place, robotPose &retract);
 
+    //! @brief Start closing the gripper this far (length units) before the acquire pose, during the
+    //!        last of the approach, rather than after the robot stops there
+    //!
+    //! @param lead Distance before the acquire pose (0 to close after stopping)
+    //!
+    //! @return CANON_SUCCESS if the distance was set, CANON_FAILURE if it is negative
+    //!
+    //! @note Only set this when the fingers cannot touch the part before it is reached, i.e., the
+    //!       gripper takes longer to close than the robot takes to cover the distance.  Applies to
+    //!       parts added afterward.
+    //!
+    CanonReturn SetGripLead (double lead);
+
     //! @brief Add a spiral search (moving the TCP on the XY plane in a spiral pattern) to the queue
     //!
     //! @param turns  The number of turns in the spiral
@@ -66,14 +125,48 @@ namespace MotionPrims
     //!
     CanonReturn ClearMotions ();
 
-    //! @brief TODO
+    //! @brief Get the next step of the compiled sequence
     //!
-    //! @param counter TODO
+    //! @param counter The current counter step in the process (0 for the first)
+    //! @param robPose The current pose of the robot
+    //! @param newPose The next target pose of the robot, populated by this function (robPose for
+    //!                a gripper step)
+    //! @param ios     Current I/O of the robot
+    //! @param tool    Gripper setting of the step, or -1 if the step is a motion
     //!
-    //! @return TODO
+    //! @return CANON_RUNNING while steps remain, CANON_SUCCESS once the sequence is done, and
+    //!         CANON_FAILURE if no actions are queued
+    //!
+    CanonReturn RunMatHandleStep (int counter, robotPose &robPose, robotPose &newPose, robotIO &ios, double &tool);
+
+    //! @brief As above, for callers that drive the gripper themselves
     //!
     CanonReturn RunMatHandleStep (int counter, robotPose &robPose, robotPose &newPose, robotIO &ios);
 
+    //! @brief Run the whole sequence, with blended motion between the stops at the acquire and
+    //!        place poses, and the gripper commanded on the arm's queue after each stop
+    //!
+    //! @param arm The robot carrying the gripper
+    //!
+    //! @return CANON_SUCCESS if every action succeeded, or the result of the first one that did not
+    //!
+    template <class A> CanonReturn Execute (crpi_robot::CrpiRobot<A> &arm);
+
+    //! @brief Run the whole sequence with a gripper that is its own CrpiRobot, so that gripper
+    //!        actions marked overlap run alongside the arm's motion
+    //!
+    //! @param arm     The robot carrying the gripper
+    //! @param gripper The gripper
+    //!
+    //! @return CANON_SUCCESS if every action succeeded, or the result of the first one that did not
+    //!
+    template <class A, class G> CanonReturn Execute (crpi_robot::CrpiRobot<A> &arm,
+                                                     crpi_robot::CrpiRobot<G> &gripper);
+
+    //! @brief The compiled sequence
+    //!
+    const vector<matHandleAction> &Actions () const;
+
   private:
 
     //! @brief Whether or not the current assembly search is the first instance it has been configured
@@ -96,8 +189,113 @@ namespace MotionPrims
     //!
     robotIO curIO_;
 
+    //! @brief The queued parts' motions and gripper actions, in order, with every pose resolved
+    //!
+    vector<matHandleAction> actions_;
+
+    //! @brief Distance before the acquire pose at which the gripper starts closing
+    //!
+    double gripLead_;
+
+    //! @brief Gripper state at the end of the queue (-1 unknown, 0 open, 1 closed)
+    //!
+    int gripper_;
+
+    //! @brief Append a motion
+    //!
+    void addMove (robotPose &pose, bool blend);
+
+    //! @brief Append a gripper action
+    //!
+    void addTool (double tool, bool overlap);
+
+    //! @brief Run the sequence, commanding the gripper through tool
+    //!
+    template <class A> CanonReturn run (crpi_robot::CrpiRobot<A> &arm,
+                                        std::function<CrpiCompletion (double)> tool);
   }; // MatHandling
 
+
+  template <class A> CanonReturn MatHandling::Execute (crpi_robot::CrpiRobot<A> &arm)
+  {
+    //! Queued behind the motions on the arm's own thread, so the gripper actions stay in order
+    return run(arm, [&arm] (double percent) { return arm.SetToolAsync(percent); });
+  } // Execute
+
+
+  template <class A, class G> CanonReturn MatHandling::Execute (crpi_robot::CrpiRobot<A> &arm,
+                                                                crpi_robot::CrpiRobot<G> &gripper)
+  {
+    return run(arm, [&gripper] (double percent) { return gripper.SetToolAsync(percent); });
+  } // Execute
+
+
+  template <class A> CanonReturn MatHandling::run (crpi_robot::CrpiRobot<A> &arm,
+                                                   std::function<CrpiCompletion (double)> tool)
+  {
+    vector<robotPose> poses;
+    CrpiCompletion pending;
+    CanonReturn returnMe = CANON_SUCCESS, val;
+    size_t i = 0;
+
+    while (i < actions_.size() && returnMe == CANON_SUCCESS)
+    {
+      if (actions_.at(i).type == MATHANDLE_TOOL)
+      {
+        pending = tool(actions_.at(i).tool);
+        if (!actions_.at(i).overlap)
+        {
+          returnMe = pending.get();
+          pending = CrpiCompletion();
+        }
+        ++i;
+        continue;
+      }
+
+      //! Motions up to and including the next stop go to the robot as one blended move
+      poses.clear();
+      while (i < actions_.size() && actions_.at(i).type == MATHANDLE_MOVE)
+      {
+        poses.push_back(actions_.at(i).pose);
+        if (!actions_.at((i++)).blend)
+        {
+          break;
+        }
+      }
+      //! Queued like the gripper commands, so that with the arm-only Execute nothing reaches the
+      //! robot out of order
+      if (poses.size() == 1)
+      {
+        returnMe = arm.MoveStraightToAsync(poses[0]).get();
+      }
+      else
+      {
+        returnMe = arm.MoveThroughToAsync(&poses[0], (int)poses.size()).get();
+      }
+
+      //! A gripper action running alongside the motion must finish before the robot goes on
+      if (pending.valid())
+      {
+        val = pending.get();
+        pending = CrpiCompletion();
+        if (returnMe == CANON_SUCCESS)
+        {
+          returnMe = val;
+        }
+      }
+    }
+
+    if (pending.valid())
+    {
+      val = pending.get();
+      if (returnMe == CANON_SUCCESS)
+      {
+        returnMe = val;
+      }
+    }
+    return returnMe;
+  } // run
+
 } // namespace MotionPrims
 
 #endif
\ No newline at end of file
@@ -0,0 +1,305 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Motion Primitives
+//  Workfile:        RatePrims.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Resolved-rate Cartesian velocity control
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RatePrims.h"
+#include <math.h>
+
+#define RATE_DEG (3.14159265358979323846 / 180.0)
+
+//! @brief Columns of the padded Jacobian (KIN_JOINTS_MAX rounded up to a whole number of SIMD
+//!        registers, so the column loops vectorize without remainders)
+//!
+#define RATE_COLS 8
+
+using namespace crpi_robot;
+
+namespace MotionPrims
+{
+  //! @brief Cholesky factorization of a 6x6 symmetric positive definite matrix, in place (lower
+  //!        triangle)
+  //!
+  //! @return False if the matrix is not positive definite
+  //!
+  static bool cholesky6 (double A[6][6])
+  {
+    int i, j, k;
+    double s;
+
+    for (j = 0; j < 6; ++j)
+    {
+      s = A[j][j];
+      for (k = 0; k < j; ++k)
+      {
+        s -= A[j][k] * A[j][k];
+      }
+      if (s <= 0.0)
+      {
+        return false;
+      }
+      A[j][j] = sqrt(s);
+      for (i = j + 1; i < 6; ++i)
+      {
+        s = A[i][j];
+        for (k = 0; k < j; ++k)
+        {
+          s -= A[i][k] * A[j][k];
+        }
+        A[i][j] = s / A[j][j];
+      }
+    }
+    return true;
+  }
+
+
+  //! @brief Solve L L' x = b in place, with L from cholesky6
+  //!
+  static void cholSolve6 (const double L[6][6], double *b)
+  {
+    int i, k;
+
+    for (i = 0; i < 6; ++i)
+    {
+      for (k = 0; k < i; ++k)
+      {
+        b[i] -= L[i][k] * b[k];
+      }
+      b[i] /= L[i][i];
+    }
+    for (i = 5; i >= 0; --i)
+    {
+      for (k = i + 1; k < 6; ++k)
+      {
+        b[i] -= L[k][i] * b[k];
+      }
+      b[i] /= L[i][i];
+    }
+  }
+
+
+  LIBRARY_API ResolvedRate::ResolvedRate (const CrpiKinematics &kinematics, RateSource source, void *param,
+                                          const char *name) :
+    kinematics_(kinematics),
+    source_(source),
+    param_(param),
+    maxDamping_(20.0),
+    threshold_(50.0),
+    weight_(200.0),
+    limited_(false),
+    maxAge_(0.1),
+    budget_(0.0005),
+    manipulability_(0.0),
+    damping_(0.0),
+    saturated_(false),
+    running_(false)
+  {
+    std::string label = CrpiMetrics::Label("controller", name);
+
+    for (int j = 0; j < KIN_JOINTS_MAX; ++j)
+    {
+      limits_[j] = 0.0;
+    }
+    working_ = RateStatus();
+
+    computeMetric_ = CrpiMetrics::Histogram("crpi_rate_solve_seconds", "Time spent solving for the joint velocities",
+                                            label);
+    manipulabilityMetric_ = CrpiMetrics::Gauge("crpi_rate_manipulability", "Manipulability of the arm's configuration",
+                                               label);
+    overBudgetMetric_ = CrpiMetrics::Counter("crpi_rate_over_budget", "Solves that took longer than the budget",
+                                             label);
+  }
+
+
+  LIBRARY_API ResolvedRate::~ResolvedRate ()
+  {
+  }
+
+
+  LIBRARY_API void ResolvedRate::SetDamping (double maximum, double threshold)
+  {
+    maxDamping_ = maximum;
+    threshold_ = threshold;
+  }
+
+
+  LIBRARY_API void ResolvedRate::SetOrientationWeight (double weight)
+  {
+    weight_ = weight;
+  }
+
+
+  LIBRARY_API void ResolvedRate::SetJointSpeedLimits (const double *limits)
+  {
+    limited_ = (limits != NULL);
+    for (int j = 0; j < KIN_JOINTS_MAX; ++j)
+    {
+      limits_[j] = (limits != NULL && j < kinematics_.Joints()) ? limits[j] : 0.0;
+    }
+  }
+
+
+  LIBRARY_API void ResolvedRate::SetMaxAge (double seconds)
+  {
+    maxAge_ = seconds;
+  }
+
+
+  LIBRARY_API void ResolvedRate::SetBudget (double seconds)
+  {
+    budget_ = seconds;
+  }
+
+
+  LIBRARY_API CanonReturn ResolvedRate::Solve (const robotAxes &axes, const double *twist, robotAxes &speed)
+  {
+    double jac[6 * KIN_JOINTS_MAX], JJ[6][6], y[6], qd[RATE_COLS], lambda, scale, s;
+    alignas(32) double J[6][RATE_COLS];
+    int joints = kinematics_.Joints(), i, k, j;
+
+    if (kinematics_.Jacobian(axes, jac) != CANON_SUCCESS)
+    {
+      return CANON_REJECT;
+    }
+
+    //! Padded copy, orientation rows weighted so both halves of the twist are in mm
+    for (i = 0; i < 6; ++i)
+    {
+      for (j = 0; j < RATE_COLS; ++j)
+      {
+        J[i][j] = (j < KIN_JOINTS_MAX) ? jac[(i * KIN_JOINTS_MAX) + j] * ((i < 3) ? 1.0 : weight_) : 0.0;
+      }
+      y[i] = twist[i] * ((i < 3) ? 1.0 : (weight_ * RATE_DEG));
+    }
+
+    //! J J' (6x6, symmetric):  each entry a dot product of two padded rows
+    for (i = 0; i < 6; ++i)
+    {
+      for (k = 0; k <= i; ++k)
+      {
+        s = 0.0;
+        for (j = 0; j < RATE_COLS; ++j)
+        {
+          s += J[i][j] * J[k][j];
+        }
+        JJ[i][k] = JJ[k][i] = s;
+      }
+    }
+
+    //! Manipulability, as the geometric mean of J's singular values (det(J J')^(1/12), from the
+    //! Cholesky diagonal) so it is in mm; arms with fewer than six joints, and singular
+    //! configurations, have none
+    double L[6][6];
+    for (i = 0; i < 6; ++i)
+    {
+      for (k = 0; k < 6; ++k)
+      {
+        L[i][k] = JJ[i][k];
+      }
+    }
+    manipulability_ = 0.0;
+    if (cholesky6(L))
+    {
+      manipulability_ = 1.0;
+      for (i = 0; i < 6; ++i)
+      {
+        manipulability_ *= L[i][i];
+      }
+      manipulability_ = pow(manipulability_, 1.0 / 6.0);
+    }
+
+    //! Damped least squares:  qd = J' (J J' + lambda^2 I)^-1 v, with a small floor on lambda so
+    //! the factorization always succeeds
+    lambda = (manipulability_ < threshold_) ? (maxDamping_ * (1.0 - (manipulability_ / threshold_))) : 0.0;
+    damping_ = lambda;
+    for (i = 0; i < 6; ++i)
+    {
+      JJ[i][i] += (lambda * lambda) + 1.0e-9;
+    }
+    if (!cholesky6(JJ))
+    {
+      for (i = 0; i < 6; ++i)
+      {
+        y[i] = 0.0;
+      }
+    }
+    else
+    {
+      cholSolve6(JJ, y);
+    }
+    for (j = 0; j < RATE_COLS; ++j)
+    {
+      qd[j] = (J[0][j] * y[0]) + (J[1][j] * y[1]) + (J[2][j] * y[2]) +
+              (J[3][j] * y[3]) + (J[4][j] * y[4]) + (J[5][j] * y[5]);
+    }
+
+    //! One scale for every joint keeps the tool on its commanded direction
+    scale = 1.0;
+    for (j = 0; limited_ && j < joints; ++j)
+    {
+      s = fabs(qd[j]) / RATE_DEG;
+      if (limits_[j] > 0.0 && s > limits_[j] && (limits_[j] / s) < scale)
+      {
+        scale = limits_[j] / s;
+      }
+    }
+    saturated_ = (scale < 1.0);
+
+    speed = robotAxes(axes.axes);
+    for (j = 0; j < joints; ++j)
+    {
+      speed.axis[j] = qd[j] * scale / RATE_DEG;
+    }
+    return CANON_SUCCESS;
+  }
+
+
+  LIBRARY_API void ResolvedRate::Stop ()
+  {
+    running_ = false;
+  }
+
+
+  LIBRARY_API bool ResolvedRate::GetStatus (RateStatus &status) const
+  {
+    return status_.read(status) > 0;
+  }
+
+
+  void ResolvedRate::record (double compute, bool stale)
+  {
+    working_.manipulability = manipulability_;
+    working_.damping = damping_;
+    working_.compute = compute;
+    if (compute > working_.worst)
+    {
+      working_.worst = compute;
+    }
+    ++working_.cycles;
+    if (compute > budget_)
+    {
+      ++working_.overBudget;
+      overBudgetMetric_->Inc();
+    }
+    if (saturated_)
+    {
+      ++working_.saturated;
+    }
+    if (stale)
+    {
+      ++working_.stale;
+    }
+    computeMetric_->Observe(compute);
+    manipulabilityMetric_->Set(manipulability_);
+    status_.write(working_);
+  }
+} // MotionPrims namespace
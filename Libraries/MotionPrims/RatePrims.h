@@ -0,0 +1,306 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Motion Primitives
+//  Workfile:        RatePrims.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Resolved-rate Cartesian velocity control, for visual servoing and
+//  teleoperation by velocity.
+//
+//  Each period the controller reads a tool velocity (twist) from a source
+//  function and the robot's joint positions, takes the arm's Jacobian from
+//  its CrpiKinematics model, and solves for joint velocities by damped
+//  least squares.  The damping grows as the arm nears a singularity
+//  (measured by its manipulability), so the joint velocities stay bounded
+//  where the plain pseudo-inverse would blow up, at the cost of tracking
+//  the twist less closely there.  Joint velocities are streamed to robots
+//  that take them (the UR "stream_velocity" setting, speedj), and
+//  integrated into joint position setpoints for the others.
+//
+//  The solve is a fixed amount of work (no iteration, no allocation), well
+//  within a 500 Hz cycle; its time is exported through CrpiMetrics and
+//  checked against a budget.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef RATE_PRIMS
+#define RATE_PRIMS
+
+#include <atomic>
+#include "crpi.h"
+#include "crpi_robot.h"
+#include "crpi_kinematics.h"
+#include "crpi_metrics.h"
+
+namespace MotionPrims
+{
+  //! @brief Reads the newest velocity command, without blocking
+  //!
+  //! @param twist Populated with the tool's linear (mm/s) and angular (deg/s) velocity in the
+  //!              robot's base frame, as x, y, z, xrot, yrot, zrot
+  //! @param param The pointer given to the ResolvedRate constructor
+  //!
+  //! @return True if a new command was read, false if there is none
+  //!
+  typedef bool (*RateSource) (double *twist, void *param);
+
+  //! @brief Controller figures from the last cycle, and totals since Run started
+  //!
+  struct RateStatus
+  {
+    //! @brief Manipulability (geometric mean of the singular values of the Jacobian, with the
+    //!        orientation rows weighted; mm) and the damping (mm) applied at it
+    //!
+    double manipulability;
+    double damping;
+
+    //! @brief Time (s) spent solving for the joint velocities, last and largest
+    //!
+    double compute;
+    double worst;
+
+    //! @brief Cycles run, of them those whose solve took longer than the budget, those whose
+    //!        joint velocities were scaled down to the limits, and those on which the robot was
+    //!        stopped because the command was stale
+    //!
+    unsigned long cycles;
+    unsigned long overBudget;
+    unsigned long saturated;
+    unsigned long stale;
+  };
+
+  //! @ingroup MotionPrims
+  //!
+  //! @brief Resolved-rate (Jacobian pseudo-inverse) Cartesian velocity controller
+  //!
+  class LIBRARY_API ResolvedRate
+  {
+  public:
+
+    //! @brief Default constructor
+    //!
+    //! @param kinematics Model of the arm (with its tool set), which must outlive the controller
+    //! @param source     Function that reads the velocity commands
+    //! @param param      Passed to source
+    //! @param name       Name of the controller in the exported metrics
+    //!
+    ResolvedRate (const crpi_robot::CrpiKinematics &kinematics, RateSource source, void *param,
+                  const char *name = "rate");
+
+    //! @brief Default destructor
+    //!
+    ~ResolvedRate ();
+
+    //! @brief Singularity-robust damping:  lambda = maximum (1 - w / threshold) while the
+    //!        manipulability w is below threshold, and 0 above it
+    //!
+    //! @param maximum   Damping at the singularity (mm, default 20)
+    //! @param threshold Manipulability (see RateStatus) below which damping is applied (mm,
+    //!                  default 50)
+    //!
+    void SetDamping (double maximum, double threshold);
+
+    //! @brief Weight (mm/rad) of angular velocity against linear velocity in the solve (default
+    //!        200)
+    //!
+    void SetOrientationWeight (double weight);
+
+    //! @brief Limit the joint velocities, by scaling all of them when one would exceed its limit
+    //!        (so the tool keeps its direction of motion)
+    //!
+    //! @param limits Largest speed of each joint (deg/s), or NULL for no limits
+    //!
+    void SetJointSpeedLimits (const double *limits);
+
+    //! @brief Stop the robot when the newest command is older than this (s)
+    //!
+    void SetMaxAge (double seconds);
+
+    //! @brief Solve time (s) above which a cycle is counted as over budget
+    //!
+    void SetBudget (double seconds);
+
+    //! @brief Joint velocities for a twist at a configuration
+    //!
+    //! @param axes  The joint positions (deg)
+    //! @param twist The tool's linear (mm/s) and angular (deg/s) velocity in the base frame
+    //! @param speed Populated with the joint velocities (deg/s)
+    //!
+    //! @return CANON_SUCCESS, or CANON_REJECT if axes has too few joints for the model
+    //!
+    CanonReturn Solve (const robotAxes &axes, const double *twist, robotAxes &speed);
+
+    //! @brief Ask Run to end the stream and return (from any thread)
+    //!
+    void Stop ();
+
+    //! @brief Copy the latest controller figures (from any thread)
+    //!
+    //! @return True if Run has completed a cycle
+    //!
+    bool GetStatus (RateStatus &status) const;
+
+    //! @brief Drive the robot at the commanded twists until Stop is called
+    //!
+    //! @param robot  The robot, which must support BeginStream and report joint angles in degrees
+    //! @param period Seconds between setpoints (match the robot's "stream_period"; 0.002 for
+    //!               500 Hz)
+    //!
+    //! @return CANON_SUCCESS once stopped, CANON_REJECT if the robot cannot stream or does not
+    //!         match the model, CANON_FAILURE if the robot's joints could not be read or a
+    //!         setpoint could not be sent
+    //!
+    template <class T> CanonReturn Run (crpi_robot::CrpiRobot<T> &robot, double period = 0.002);
+
+  private:
+
+    //! @brief Record one cycle's figures
+    //!
+    void record (double compute, bool stale);
+
+    //! @brief Arm model and command source
+    //!
+    const crpi_robot::CrpiKinematics &kinematics_;
+    RateSource source_;
+    void *param_;
+
+    //! @brief Solver settings (see the setters)
+    //!
+    double maxDamping_;
+    double threshold_;
+    double weight_;
+    double limits_[KIN_JOINTS_MAX];
+    bool limited_;
+    double maxAge_;
+    double budget_;
+
+    //! @brief Figures of the last solve
+    //!
+    double manipulability_;
+    double damping_;
+    bool saturated_;
+
+    //! @brief Run until cleared
+    //!
+    std::atomic<bool> running_;
+
+    //! @brief Controller accounting
+    //!
+    RateStatus working_;
+    crpi_seqlock<RateStatus> status_;
+    crpi_robot::CrpiHistogram *computeMetric_;
+    crpi_robot::CrpiGauge *manipulabilityMetric_;
+    crpi_robot::CrpiCounter *overBudgetMetric_;
+
+    ResolvedRate (const ResolvedRate &);
+    ResolvedRate &operator= (const ResolvedRate &);
+  }; // ResolvedRate
+
+
+  template <class T> CanonReturn ResolvedRate::Run (crpi_robot::CrpiRobot<T> &robot, double period)
+  {
+    CanonReturn returnMe = CANON_SUCCESS;
+    robotAxes axes, speed, setpoint;
+    double twist[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0}, commanded, start;
+    bool velocity = true, stale;
+    int joints = kinematics_.Joints(), j;
+    void *timer;
+
+    if (robot.GetRobotAxes(&axes) != CANON_SUCCESS)
+    {
+      return CANON_FAILURE;
+    }
+    if (axes.axes < joints)
+    {
+      return CANON_REJECT;
+    }
+
+    //! Joint speeds where the robot takes them; integrated joint positions otherwise
+    if (robot.SetParameter("stream_velocity", &velocity) != CANON_SUCCESS)
+    {
+      velocity = false;
+    }
+    if ((returnMe = robot.BeginStream()) != CANON_SUCCESS)
+    {
+      if (velocity)
+      {
+        velocity = false;
+        robot.SetParameter("stream_velocity", &velocity);
+      }
+      return returnMe;
+    }
+    setpoint = axes;
+    working_ = RateStatus();
+    running_ = true;
+    timer = ulapi_periodic_new(period);
+    commanded = -1.0;
+
+    while (running_)
+    {
+      if (timer != NULL)
+      {
+        ulapi_periodic_wait(timer);
+      }
+      else
+      {
+        ulapi_sleep(period);
+      }
+
+      if (robot.GetRobotAxes(&axes) != CANON_SUCCESS)
+      {
+        returnMe = CANON_FAILURE;
+        break;
+      }
+      if (source_(twist, param_))
+      {
+        commanded = ulapi_time();
+      }
+
+      //! A stale command stops the robot rather than repeating the last velocity
+      stale = (commanded < 0.0) || (ulapi_time() - commanded) > maxAge_;
+      if (stale)
+      {
+        for (j = 0; j < 6; ++j)
+        {
+          twist[j] = 0.0;
+        }
+      }
+
+      start = ulapi_time();
+      Solve(axes, twist, speed);
+      record(ulapi_time() - start, stale);
+
+      if (!velocity)
+      {
+        for (j = 0; j < joints; ++j)
+        {
+          setpoint.axis[j] += speed.axis[j] * period;
+        }
+      }
+      if (robot.StreamAxes(velocity ? speed : setpoint) != CANON_SUCCESS)
+      {
+        returnMe = CANON_FAILURE;
+        break;
+      }
+    } // while (running_)
+
+    robot.EndStream();
+    if (velocity)
+    {
+      velocity = false;
+      robot.SetParameter("stream_velocity", &velocity);
+    }
+    if (timer != NULL)
+    {
+      ulapi_periodic_delete(timer);
+    }
+    running_ = false;
+    return returnMe;
+  } // Run
+} // MotionPrims namespace
+
+#endif
@@ -0,0 +1,255 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Motion Primitives
+//  Workfile:        TeleopPrims.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Teleoperation pipeline from a human-tracking sensor to a streaming robot
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TeleopPrims.h"
+#include <cstring>
+#include <math.h>
+
+using namespace crpi_robot;
+
+namespace MotionPrims
+{
+  static const char *stageNames[TELEOP_STAGES] = {"input", "filter", "map", "output"};
+
+  //! @brief Turn q toward r by at most maxAngle (rad)
+  //!
+  static Math::quaternion limitRotation (const Math::quaternion &q, const Math::quaternion &r, double maxAngle)
+  {
+    //! r = d q, with d the rotation still to go, in world coordinates
+    Math::quaternion d = r * q.conjugate(), out;
+    double s, angle, half;
+
+    if (d.w < 0.0)
+    {
+      d = Math::quaternion(-d.w, -d.x, -d.y, -d.z);
+    }
+    angle = 2.0 * acos((d.w > 1.0) ? 1.0 : d.w);
+    if (angle <= maxAngle)
+    {
+      return r;
+    }
+
+    s = sqrt((d.x * d.x) + (d.y * d.y) + (d.z * d.z));
+    half = maxAngle / 2.0;
+    d = Math::quaternion(cos(half), d.x * sin(half) / s, d.y * sin(half) / s, d.z * sin(half) / s);
+    out = d * q;
+    out.normalize();
+    return out;
+  }
+
+
+  LIBRARY_API Teleop::Teleop (TeleopSource source, void *param, const char *name) :
+    source_(source),
+    param_(param),
+    haveSample_(false),
+    lookahead_(0.0),
+    maxAge_(0.1),
+    engaged_(false),
+    scale_(1.0),
+    linearLimit_(0.0),
+    angularLimit_(0.0),
+    limitBox_(false),
+    useDegrees_(true),
+    running_(false),
+    budget_(0.030)
+  {
+    std::string pipeline = CrpiMetrics::Label("pipeline", name);
+
+    memset(&newest_, 0, sizeof(newest_));
+    memset(&working_, 0, sizeof(working_));
+    for (int i = 0; i < 3; ++i)
+    {
+      boxMin_[i] = boxMax_[i] = 0.0;
+    }
+
+    for (int i = 0; i < TELEOP_STAGES; ++i)
+    {
+      stageMetric_[i] = CrpiMetrics::Histogram("crpi_teleop_stage_seconds", "Time spent in each teleoperation stage",
+                                               pipeline + "," + CrpiMetrics::Label("stage", stageNames[i]));
+    }
+    endToEndMetric_ = CrpiMetrics::Histogram("crpi_teleop_latency_seconds",
+                                             "Time from a sensor sample to the setpoint streamed from it", pipeline);
+    overBudgetMetric_ = CrpiMetrics::Counter("crpi_teleop_over_budget",
+                                             "Setpoints streamed later than the latency budget", pipeline);
+  }
+
+
+  LIBRARY_API Teleop::~Teleop ()
+  {
+  }
+
+
+  LIBRARY_API void Teleop::SetScale (double scale)
+  {
+    scale_ = scale;
+  }
+
+
+  LIBRARY_API void Teleop::SetWorkspace (const robotPose &minimum, const robotPose &maximum)
+  {
+    boxMin_[0] = minimum.x;
+    boxMin_[1] = minimum.y;
+    boxMin_[2] = minimum.z;
+    boxMax_[0] = maximum.x;
+    boxMax_[1] = maximum.y;
+    boxMax_[2] = maximum.z;
+    limitBox_ = (maximum.x >= minimum.x && maximum.y >= minimum.y && maximum.z >= minimum.z);
+  }
+
+
+  LIBRARY_API void Teleop::SetSpeedLimit (double linear, double angular)
+  {
+    linearLimit_ = linear;
+    angularLimit_ = angular;
+  }
+
+
+  LIBRARY_API void Teleop::SetFiltering (double position, double rotation, double lookahead)
+  {
+    tracker_.setMeasurementNoise(position, rotation);
+    lookahead_ = lookahead;
+  }
+
+
+  LIBRARY_API void Teleop::SetMaxAge (double seconds)
+  {
+    maxAge_ = seconds;
+    tracker_.setMaxGap(seconds);
+  }
+
+
+  LIBRARY_API void Teleop::SetBudget (double seconds)
+  {
+    budget_ = seconds;
+  }
+
+
+  LIBRARY_API void Teleop::SetAngleUnits (bool useDegrees)
+  {
+    useDegrees_ = useDegrees;
+  }
+
+
+  LIBRARY_API void Teleop::Stop ()
+  {
+    running_ = false;
+  }
+
+
+  LIBRARY_API bool Teleop::GetLatency (TeleopLatency &latency) const
+  {
+    return latency_.read(latency) > 0;
+  }
+
+
+  bool Teleop::drain ()
+  {
+    TeleopSample sample;
+    bool read = false;
+
+    //! Every sample goes through the filter, even when several arrived in one period
+    while (source_(sample, param_))
+    {
+      tracker_.correct(Math::toQPose(sample.pose.pose(), useDegrees_), sample.timestamp);
+      newest_ = sample;
+      haveSample_ = read = true;
+    }
+    return read;
+  }
+
+
+  void Teleop::anchor (const Math::qpose &op)
+  {
+    opAnchor_ = op;
+    robotAnchor_ = target_;
+    engaged_ = true;
+  }
+
+
+  void Teleop::follow (const Math::qpose &op, double dt, robotPose &target)
+  {
+    Math::qpose next;
+    Math::point step;
+    double length, limit;
+    int i;
+
+    //! The operator's motion since the clutch was engaged, in world coordinates:  translation
+    //! scaled, rotation applied as is
+    next.position = robotAnchor_.position + ((op.position - opAnchor_.position) * scale_);
+    next.orientation = op.orientation * opAnchor_.orientation.conjugate() * robotAnchor_.orientation;
+    next.orientation.normalize();
+
+    if (limitBox_)
+    {
+      double *axis[3] = {&next.position.x, &next.position.y, &next.position.z};
+      for (i = 0; i < 3; ++i)
+      {
+        *axis[i] = (*axis[i] < boxMin_[i]) ? boxMin_[i] : ((*axis[i] > boxMax_[i]) ? boxMax_[i] : *axis[i]);
+      }
+    }
+
+    //! Speed limits, so a jump in the sensor (or a late cycle) does not become a jump in the robot
+    if (linearLimit_ > 0.0 && dt > 0.0)
+    {
+      step = next.position - target_.position;
+      length = sqrt((step.x * step.x) + (step.y * step.y) + (step.z * step.z));
+      limit = linearLimit_ * dt;
+      if (length > limit)
+      {
+        next.position = target_.position + (step * (limit / length));
+      }
+    }
+    if (angularLimit_ > 0.0 && dt > 0.0)
+    {
+      limit = angularLimit_ * dt * (useDegrees_ ? (3.14159265358979323846 / 180.0) : 1.0);
+      next.orientation = limitRotation(target_.orientation, next.orientation, limit);
+    }
+
+    target_ = next;
+    target = target_.toPose(useDegrees_);
+  }
+
+
+  void Teleop::record (const double *marks, bool fresh)
+  {
+    int i;
+
+    for (i = TELEOP_FILTER; i < TELEOP_STAGES; ++i)
+    {
+      working_.stage[i] = marks[i + 1] - marks[i];
+      stageMetric_[i]->Observe(working_.stage[i]);
+    }
+    ++working_.cycles;
+
+    //! Input and end-to-end times are measured from the sample, so only when there is a new one
+    if (fresh)
+    {
+      working_.stage[TELEOP_INPUT] = marks[TELEOP_INPUT + 1] - newest_.timestamp;
+      stageMetric_[TELEOP_INPUT]->Observe(working_.stage[TELEOP_INPUT]);
+
+      working_.endToEnd = marks[TELEOP_STAGES] - newest_.timestamp;
+      endToEndMetric_->Observe(working_.endToEnd);
+      if (working_.endToEnd > working_.worst)
+      {
+        working_.worst = working_.endToEnd;
+      }
+      if (working_.endToEnd > budget_)
+      {
+        ++working_.overBudget;
+        overBudgetMetric_->Inc();
+      }
+    }
+    latency_.write(working_);
+  }
+} // MotionPrims namespace
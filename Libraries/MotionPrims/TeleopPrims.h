@@ -0,0 +1,351 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Motion Primitives
+//  Workfile:        TeleopPrims.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Teleoperation pipeline from a human-tracking sensor to a streaming robot.
+//
+//  Each period the pipeline drains the sensor (through a source function
+//  that reads its ring, e.g., LeapMotion::getHandFrame, ManusGloves, or a
+//  MoCapStream subject), runs every new sample through a PoseTracker, and
+//  predicts the operator's pose at the time the setpoint will execute.  The
+//  operator's motion since the clutch was engaged is scaled onto the robot's
+//  pose in world coordinates, kept inside a workspace box and under a speed
+//  limit, mapped to the robot with FromWorld, and streamed with StreamPose.
+//  The sensor and robot rates need not match:  the tracker fills in between
+//  samples, and holds the robot once the samples go stale.
+//
+//  The time spent in each stage and from the sensor sample to the streamed
+//  setpoint is exported through CrpiMetrics and kept for GetLatency.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TELEOP_PRIMS
+#define TELEOP_PRIMS
+
+#include <atomic>
+#include <string>
+#include "crpi.h"
+#include "crpi_robot.h"
+#include "crpi_metrics.h"
+#include "../Math/Filters.h"
+
+namespace MotionPrims
+{
+  //! @brief One operator pose from the sensor
+  //!
+  struct TeleopSample
+  {
+    //! @brief Time (s, ulapi_time) at which the sample was received from the sensor
+    //!
+    double timestamp;
+
+    //! @brief The operator's pose in world coordinates (mm, in the robot's angle units)
+    //!
+    robotPose pose;
+
+    //! @brief Whether the operator is holding the clutch (e.g., a closed hand).  The robot only
+    //!        follows while it is held, and the motion is measured from where it was engaged.
+    //!
+    bool engaged;
+  };
+
+  //! @brief Reads the next waiting sample from the sensor, without blocking
+  //!
+  //! @param sample Populated with the sample
+  //! @param param  The pointer given to the Teleop constructor
+  //!
+  //! @return True if a sample was read, false if none is waiting
+  //!
+  typedef bool (*TeleopSource) (TeleopSample &sample, void *param);
+
+  //! @brief Pipeline stages whose latency is measured
+  //!
+  typedef enum
+  {
+    TELEOP_INPUT = 0, //! Sample received to sample drained by the pipeline
+    TELEOP_FILTER,    //! Tracker updates and prediction
+    TELEOP_MAP,       //! Workspace mapping, limits, and FromWorld
+    TELEOP_OUTPUT,    //! StreamPose
+    TELEOP_STAGES
+  } TeleopStage;
+
+  //! @brief Latency of the last cycle that had a fresh sample, and totals since Run started
+  //!
+  struct TeleopLatency
+  {
+    //! @brief Time (s) spent in each stage
+    //!
+    double stage[TELEOP_STAGES];
+
+    //! @brief Time (s) from the sample being received to the setpoint being streamed, last and
+    //!        largest
+    //!
+    double endToEnd;
+    double worst;
+
+    //! @brief Setpoints streamed, of them those over the latency budget, and cycles on which the
+    //!        robot was held because the samples were stale
+    //!
+    unsigned long cycles;
+    unsigned long overBudget;
+    unsigned long stale;
+  };
+
+  //! @ingroup MotionPrims
+  //!
+  //! @brief Sensor-to-robot teleoperation pipeline
+  //!
+  class LIBRARY_API Teleop
+  {
+  public:
+
+    //! @brief Default constructor
+    //!
+    //! @param source Function that reads the sensor's samples
+    //! @param param  Passed to source
+    //! @param name   Name of the pipeline in the exported metrics
+    //!
+    Teleop (TeleopSource source, void *param, const char *name = "teleop");
+
+    //! @brief Default destructor
+    //!
+    ~Teleop ();
+
+    //! @brief Scale the operator's translation onto the robot's (e.g., 0.5 for fine work)
+    //!
+    void SetScale (double scale);
+
+    //! @brief Keep the robot's target inside a box in world coordinates (mm); orientations are
+    //!        not limited.  A box with maximum below minimum on any axis removes the limit.
+    //!
+    void SetWorkspace (const robotPose &minimum, const robotPose &maximum);
+
+    //! @brief Limit the speed of the target
+    //!
+    //! @param linear  Largest translational speed (mm/s, 0 for no limit)
+    //! @param angular Largest rotational speed (robot angle units/s, 0 for no limit)
+    //!
+    void SetSpeedLimit (double linear, double angular);
+
+    //! @brief Tune the smoothing of the operator's pose
+    //!
+    //! @param position  Standard deviation of the sensor's position (mm)
+    //! @param rotation  Standard deviation of the sensor's orientation (rad)
+    //! @param lookahead Time (s) past each setpoint's streaming at which the operator's pose is
+    //!                  predicted, e.g., the robot's "stream_lookahead" plus its servo lag
+    //!
+    void SetFiltering (double position, double rotation, double lookahead);
+
+    //! @brief Hold the robot when the newest sample is older than this (s)
+    //!
+    void SetMaxAge (double seconds);
+
+    //! @brief End-to-end latency (s) above which a setpoint is counted as over budget
+    //!
+    void SetBudget (double seconds);
+
+    //! @brief Whether robotPose angles are in degrees (true, the default) or radians, matching
+    //!        the robot's SetAngleUnits
+    //!
+    void SetAngleUnits (bool useDegrees);
+
+    //! @brief Ask Run to end the stream and return (from any thread)
+    //!
+    void Stop ();
+
+    //! @brief Copy the latest latency figures (from any thread)
+    //!
+    //! @return True if Run has streamed a setpoint
+    //!
+    bool GetLatency (TeleopLatency &latency) const;
+
+    //! @brief Stream the robot after the operator until Stop is called.  The robot starts where
+    //!        it is, and moves only while the clutch is engaged.
+    //!
+    //! @param robot  The robot, which must support BeginStream
+    //! @param period Seconds between setpoints (match the robot's "stream_period")
+    //!
+    //! @return CANON_SUCCESS once stopped, CANON_REJECT if the robot cannot stream, CANON_FAILURE
+    //!         if the robot's pose or a setpoint could not be sent or mapped
+    //!
+    template <class T> CanonReturn Run (crpi_robot::CrpiRobot<T> &robot, double period = 0.008);
+
+  private:
+
+    //! @brief Read every waiting sample into the tracker
+    //!
+    //! @return True if any sample was read
+    //!
+    bool drain ();
+
+    //! @brief Restart the motion from the robot's current world target and the operator's
+    //!        current pose
+    //!
+    void anchor (const Math::qpose &op);
+
+    //! @brief Scale and limit the operator's motion onto the robot's world pose
+    //!
+    //! @param op     The operator's predicted pose
+    //! @param dt     Time since the last target (s)
+    //! @param target Populated with the robot's target in world coordinates
+    //!
+    void follow (const Math::qpose &op, double dt, robotPose &target);
+
+    //! @brief Record one cycle's stage times (start, then the end of each stage)
+    //!
+    void record (const double *marks, bool fresh);
+
+    //! @brief Sensor source
+    //!
+    TeleopSource source_;
+    void *param_;
+
+    //! @brief Operator pose filter and the newest sample it was given
+    //!
+    Math::PoseTracker tracker_;
+    TeleopSample newest_;
+    bool haveSample_;
+    double lookahead_;
+    double maxAge_;
+
+    //! @brief Clutch state, and the operator's and robot's world poses when it was engaged
+    //!
+    bool engaged_;
+    Math::qpose opAnchor_;
+    Math::qpose robotAnchor_;
+
+    //! @brief The last target streamed, in world coordinates
+    //!
+    Math::qpose target_;
+
+    //! @brief Mapping limits (see the setters)
+    //!
+    double scale_;
+    double linearLimit_;
+    double angularLimit_;
+    bool limitBox_;
+    double boxMin_[3];
+    double boxMax_[3];
+    bool useDegrees_;
+
+    //! @brief Run until cleared
+    //!
+    std::atomic<bool> running_;
+
+    //! @brief Latency accounting
+    //!
+    double budget_;
+    TeleopLatency working_;
+    crpi_seqlock<TeleopLatency> latency_;
+    crpi_robot::CrpiHistogram *stageMetric_[TELEOP_STAGES];
+    crpi_robot::CrpiHistogram *endToEndMetric_;
+    crpi_robot::CrpiCounter *overBudgetMetric_;
+
+    Teleop (const Teleop &);
+    Teleop &operator= (const Teleop &);
+  }; // Teleop
+
+
+  template <class T> CanonReturn Teleop::Run (crpi_robot::CrpiRobot<T> &robot, double period)
+  {
+    CanonReturn returnMe = CANON_SUCCESS;
+    robotPose current, world, target;
+    Math::qpose op;
+    double marks[TELEOP_STAGES + 1], last;
+    bool fresh, live;
+    void *timer;
+
+    if (robot.GetRobotPose(&current) != CANON_SUCCESS || robot.ToWorld(&current, &world) != CANON_SUCCESS)
+    {
+      return CANON_FAILURE;
+    }
+    target_ = Math::toQPose(world.pose(), useDegrees_);
+    engaged_ = false;
+    working_ = TeleopLatency();
+
+    if ((returnMe = robot.BeginStream()) != CANON_SUCCESS)
+    {
+      return returnMe;
+    }
+    running_ = true;
+    timer = ulapi_periodic_new(period);
+    last = ulapi_time();
+
+    while (running_)
+    {
+      if (timer != NULL)
+      {
+        ulapi_periodic_wait(timer);
+      }
+      else
+      {
+        ulapi_sleep(period);
+      }
+
+      //! Input:  everything the sensor has queued since the last cycle
+      marks[0] = ulapi_time();
+      fresh = drain();
+      marks[TELEOP_INPUT + 1] = ulapi_time();
+
+      //! Filter:  the operator's pose when this setpoint takes effect
+      live = haveSample_ && (marks[0] - newest_.timestamp) <= maxAge_;
+      if (live)
+      {
+        op = tracker_.predict(marks[0] + lookahead_);
+      }
+      marks[TELEOP_FILTER + 1] = ulapi_time();
+
+      //! Map:  the robot follows while the clutch is held, and holds otherwise
+      if (live && newest_.engaged)
+      {
+        if (!engaged_)
+        {
+          anchor(op);
+        }
+        follow(op, marks[0] - last, world);
+      }
+      else
+      {
+        engaged_ = false;
+        world = target_.toPose(useDegrees_);
+      }
+      if (robot.FromWorld(&world, &target) != CANON_SUCCESS)
+      {
+        returnMe = CANON_FAILURE;
+        break;
+      }
+      marks[TELEOP_MAP + 1] = ulapi_time();
+
+      //! Output
+      if (robot.StreamPose(target) != CANON_SUCCESS)
+      {
+        returnMe = CANON_FAILURE;
+        break;
+      }
+      marks[TELEOP_OUTPUT + 1] = ulapi_time();
+
+      if (haveSample_ && !live)
+      {
+        ++working_.stale;
+      }
+      record(marks, fresh && live);
+      last = marks[0];
+    } // while (running_)
+
+    robot.EndStream();
+    if (timer != NULL)
+    {
+      ulapi_periodic_delete(timer);
+    }
+    running_ = false;
+    return returnMe;
+  } // Run
+} // MotionPrims namespace
+
+#endif
@@ -0,0 +1,1418 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: Collaborative Robot Programming Interface
+//  Subsystem:       Python Interface
+//  Workfile:        crpi_python.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Python extension module (import crpi) for offline analysis of CRPI data.
+//
+//  Containers and logs are handed to Python as crpi.Array objects, which
+//  export the native storage through the buffer protocol:  numpy.asarray()
+//  and memoryview() wrap them without copying, with the strides of the
+//  native layout (a PointCloud's coordinate arrays, a Patterns store's
+//  padded rows, the fields of decoded RobotStateSnapshot records).  A
+//  container cannot grow while any of its arrays is exported.
+//
+//    crpi.PointCloud, crpi.PoseBatch   Math::PointCloud and Math::PoseBatch
+//    crpi.Patterns                     Clustering::Patterns
+//    crpi.read_states(path, channel)   RobotStateSnapshot records of a
+//                                      recording (crpi_recorder.h)
+//    crpi.read_mocap(path)             motion capture subject poses of a
+//                                      recording, per subject
+//    crpi.kmeans, crpi.reg2target,     Clustering::kMeans,
+//    crpi.transform_points,            Registration::reg2target,
+//    crpi.transform_poses              Math::transformPoints / transformPoses
+//
+//  The native work runs with the GIL released.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "crpi_recorder.h"
+#include "PointCloud.h"
+#include "../../Clustering/kMeans/kMeansCluster.h"
+#include "../RegistrationKit/CoordFrameReg.h"
+#include "../Sensor/MoCap/MoCapStream.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//! @brief Storage behind arrays that are not views of a container (decoded logs, results),
+//!        owned by a capsule that the arrays reference
+//!
+struct pyStore
+{
+  virtual ~pyStore ()
+  {
+  }
+};
+
+template <class T> struct pyVector : public pyStore
+{
+  vector<T> data;
+};
+
+//! @brief Decoded RobotStateSnapshot records and the channel of each
+//!
+struct pyStateStore : public pyStore
+{
+  vector<RobotStateSnapshot> states;
+  vector<int> channels;
+};
+
+//! @brief Decoded poses of one motion capture subject
+//!
+struct pySubjectStore : public pyStore
+{
+  vector<Sensor::MoCapRecordSubject> samples;
+  vector<double> timestamps;
+  vector<unsigned int> frames;
+};
+
+static void storeDestructor (PyObject *capsule)
+{
+  delete (pyStore *)PyCapsule_GetPointer(capsule, "crpi.store");
+}
+
+static PyObject *newStore (pyStore *store)
+{
+  PyObject *capsule = PyCapsule_New(store, "crpi.store", storeDestructor);
+  if (capsule == NULL)
+  {
+    delete store;
+  }
+  return capsule;
+}
+
+//! @brief Stand-in address for arrays with no elements
+//!
+static double emptyData[4];
+
+
+///////////////////////////////////////////////////////////////////////////////
+//!                              crpi.Array                                 !//
+///////////////////////////////////////////////////////////////////////////////
+
+struct pyArray
+{
+  PyObject_HEAD
+  PyObject *owner;
+  int *exports;
+  char *data;
+  int ndim;
+  Py_ssize_t shape[3];
+  Py_ssize_t strides[3];
+  Py_ssize_t itemsize;
+  char format[2];
+  int readonly;
+};
+
+static PyTypeObject pyArrayType = {PyVarObject_HEAD_INIT(NULL, 0)};
+
+//! @brief Describe native storage in a Py_buffer
+//!
+static int fillBuffer (Py_buffer *view, PyObject *obj, void *data, const char *format,
+                       Py_ssize_t itemsize, int ndim, Py_ssize_t *shape, Py_ssize_t *strides,
+                       int readonly, int flags)
+{
+  Py_ssize_t len = itemsize, step = itemsize;
+  bool contiguous = true;
+  int i;
+
+  for (i = ndim - 1; i >= 0; --i)
+  {
+    len *= shape[i];
+    contiguous = contiguous && (shape[i] <= 1 || strides[i] == step);
+    step *= shape[i];
+  }
+  if ((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE && readonly)
+  {
+    PyErr_SetString(PyExc_BufferError, "array is read-only");
+    return -1;
+  }
+  if ((flags & PyBUF_STRIDES) != PyBUF_STRIDES && !contiguous)
+  {
+    PyErr_SetString(PyExc_BufferError, "array is not contiguous; request a strided buffer");
+    return -1;
+  }
+
+  view->buf = (data == NULL) ? (void *)emptyData : data;
+  view->obj = obj;
+  Py_INCREF(obj);
+  view->len = len;
+  view->readonly = readonly;
+  view->itemsize = itemsize;
+  view->format = ((flags & PyBUF_FORMAT) == PyBUF_FORMAT) ? (char *)format : NULL;
+  view->ndim = ndim;
+  view->shape = ((flags & PyBUF_ND) == PyBUF_ND) ? shape : NULL;
+  view->strides = ((flags & PyBUF_STRIDES) == PyBUF_STRIDES) ? strides : NULL;
+  view->suboffsets = NULL;
+  view->internal = NULL;
+  return 0;
+}
+
+//! @brief Make an array over the storage of owner
+//!
+//! @param exports Export count of a container (NULL for storage that never moves)
+//!
+static PyObject *newArray (PyObject *owner, int *exports, void *data, char format,
+                           Py_ssize_t itemsize, int ndim, const Py_ssize_t *shape,
+                           const Py_ssize_t *strides, bool readonly = false)
+{
+  pyArray *self = PyObject_New(pyArray, &pyArrayType);
+  if (self == NULL)
+  {
+    return NULL;
+  }
+  self->owner = owner;
+  Py_INCREF(owner);
+  self->exports = exports;
+  if (exports != NULL)
+  {
+    ++*exports;
+  }
+  self->data = (char *)data;
+  self->ndim = ndim;
+  for (int i = 0; i < ndim; ++i)
+  {
+    self->shape[i] = shape[i];
+    self->strides[i] = strides[i];
+  }
+  self->itemsize = itemsize;
+  self->format[0] = format;
+  self->format[1] = '\0';
+  self->readonly = readonly ? 1 : 0;
+  return (PyObject *)self;
+}
+
+static void arrayDealloc (pyArray *self)
+{
+  if (self->exports != NULL)
+  {
+    --*self->exports;
+  }
+  Py_DECREF(self->owner);
+  PyObject_Del(self);
+}
+
+static int arrayGetBuffer (pyArray *self, Py_buffer *view, int flags)
+{
+  return fillBuffer(view, (PyObject *)self, self->data, self->format, self->itemsize,
+                    self->ndim, self->shape, self->strides, self->readonly, flags);
+}
+
+static Py_ssize_t arrayLength (pyArray *self)
+{
+  return self->shape[0];
+}
+
+static PyObject *arrayShape (pyArray *self, void *)
+{
+  PyObject *shape = PyTuple_New(self->ndim);
+  for (int i = 0; shape != NULL && i < self->ndim; ++i)
+  {
+    PyTuple_SET_ITEM(shape, i, PyLong_FromSsize_t(self->shape[i]));
+  }
+  return shape;
+}
+
+static PyBufferProcs arrayBuffer = {(getbufferproc)arrayGetBuffer, NULL};
+
+static PySequenceMethods arraySequence = {(lenfunc)arrayLength};
+
+static PyGetSetDef arrayGetSet[] = {
+  {(char *)"shape", (getter)arrayShape, NULL, (char *)"Dimensions of the array", NULL},
+  {NULL}
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+//!                         Argument conversion                             !//
+///////////////////////////////////////////////////////////////////////////////
+
+//! @brief A 2-D array of doubles passed in by the caller
+//!
+struct matrixArg
+{
+  Py_buffer buf;
+  bool held;
+
+  matrixArg () :
+    held(false)
+  {
+  }
+
+  ~matrixArg ()
+  {
+    if (held)
+    {
+      PyBuffer_Release(&buf);
+    }
+  }
+
+  //! @brief Get the buffer of obj
+  //!
+  //! @param cols Required column count (0 for any)
+  //!
+  bool get (PyObject *obj, int cols, const char *what)
+  {
+    if (PyObject_GetBuffer(obj, &buf, PyBUF_RECORDS_RO) < 0)
+    {
+      return false;
+    }
+    held = true;
+    const char *f = buf.format;
+    if (f != NULL && (*f == '@' || *f == '=' || *f == '<'))
+    {
+      ++f;
+    }
+    if (buf.itemsize != sizeof(double) || (f != NULL && strcmp(f, "d") != 0) || buf.ndim != 2 ||
+        (cols > 0 && buf.shape[1] != cols))
+    {
+      PyErr_Format(PyExc_ValueError, "%s must be a 2-D float64 array%s", what,
+                   (cols == 3) ? " of shape (n, 3)" : ((cols == 4) ? " of shape (4, 4)" : ""));
+      return false;
+    }
+    return true;
+  }
+
+  Py_ssize_t rows () const
+  {
+    return buf.shape[0];
+  }
+
+  Py_ssize_t cols () const
+  {
+    return buf.shape[1];
+  }
+
+  double at (Py_ssize_t r, Py_ssize_t c) const
+  {
+    return *(const double *)((const char *)buf.buf + (r * buf.strides[0]) + (c * buf.strides[1]));
+  }
+
+  //! @brief Copy the rows into a packed row-major block
+  //!
+  void pack (vector<double> &out) const
+  {
+    out.resize((size_t)(rows() * cols()));
+    for (Py_ssize_t r = 0; r < rows(); ++r)
+    {
+      for (Py_ssize_t c = 0; c < cols(); ++c)
+      {
+        out[(size_t)(r * cols() + c)] = at(r, c);
+      }
+    }
+  }
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+//!                      crpi.PointCloud, crpi.PoseBatch                    !//
+///////////////////////////////////////////////////////////////////////////////
+
+struct pyPointCloud
+{
+  PyObject_HEAD
+  Math::PointCloud *cloud;
+  int exports;
+  Py_ssize_t shape[2];
+  Py_ssize_t strides[2];
+};
+
+struct pyPoseBatch
+{
+  PyObject_HEAD
+  Math::PoseBatch *batch;
+  int exports;
+  Py_ssize_t shape[2];
+  Py_ssize_t strides[2];
+};
+
+static PyTypeObject pyPointCloudType = {PyVarObject_HEAD_INIT(NULL, 0)};
+static PyTypeObject pyPoseBatchType = {PyVarObject_HEAD_INIT(NULL, 0)};
+
+//! @brief Distance (bytes) between the coordinate arrays of a structure-of-arrays container
+//!
+static Py_ssize_t arrayStride (const double *first, const double *second)
+{
+  return (first == NULL || second == NULL) ? 0 : (Py_ssize_t)((const char *)second - (const char *)first);
+}
+
+static bool checkExports (int exports)
+{
+  if (exports > 0)
+  {
+    PyErr_SetString(PyExc_BufferError, "cannot resize while arrays of the container are in use");
+    return false;
+  }
+  return true;
+}
+
+static PyObject *pointCloudNew (PyTypeObject *type, PyObject *, PyObject *)
+{
+  pyPointCloud *self = (pyPointCloud *)type->tp_alloc(type, 0);
+  if (self != NULL)
+  {
+    self->cloud = new Math::PointCloud();
+    self->exports = 0;
+  }
+  return (PyObject *)self;
+}
+
+static void pointCloudDealloc (pyPointCloud *self)
+{
+  delete self->cloud;
+  Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+//! @brief Copy (n, 3) rows into a point cloud
+//!
+static bool loadCloud (const matrixArg &points, Math::PointCloud &cloud)
+{
+  cloud.resize((size_t)points.rows());
+  for (Py_ssize_t i = 0; i < points.rows(); ++i)
+  {
+    cloud.x()[i] = points.at(i, 0);
+    cloud.y()[i] = points.at(i, 1);
+    cloud.z()[i] = points.at(i, 2);
+  }
+  return true;
+}
+
+static int pointCloudInit (pyPointCloud *self, PyObject *args, PyObject *)
+{
+  PyObject *points = NULL;
+  if (!PyArg_ParseTuple(args, "|O", &points) || !checkExports(self->exports))
+  {
+    return -1;
+  }
+  if (points == NULL)
+  {
+    self->cloud->clear();
+    return 0;
+  }
+  if (PyLong_Check(points))
+  {
+    Py_ssize_t n = PyLong_AsSsize_t(points);
+    if (n < 0)
+    {
+      PyErr_SetString(PyExc_ValueError, "point count must not be negative");
+      return -1;
+    }
+    self->cloud->resize((size_t)n);
+    return 0;
+  }
+  matrixArg m;
+  if (!m.get(points, 3, "points"))
+  {
+    return -1;
+  }
+  loadCloud(m, *self->cloud);
+  return 0;
+}
+
+static Py_ssize_t pointCloudLength (pyPointCloud *self)
+{
+  return (Py_ssize_t)self->cloud->size();
+}
+
+//! @brief The cloud as a (3, n) array:  one row per coordinate array
+//!
+static int pointCloudGetBuffer (pyPointCloud *self, Py_buffer *view, int flags)
+{
+  self->shape[0] = 3;
+  self->shape[1] = (Py_ssize_t)self->cloud->size();
+  self->strides[0] = arrayStride(self->cloud->x(), self->cloud->y());
+  self->strides[1] = sizeof(double);
+  if (fillBuffer(view, (PyObject *)self, self->cloud->x(), "d", sizeof(double), 2,
+                 self->shape, self->strides, 0, flags) < 0)
+  {
+    return -1;
+  }
+  ++self->exports;
+  return 0;
+}
+
+static void pointCloudReleaseBuffer (pyPointCloud *self, Py_buffer *)
+{
+  --self->exports;
+}
+
+//! @brief The cloud as an (n, 3) array (the transpose of the buffer)
+//!
+static PyObject *pointCloudPoints (pyPointCloud *self, void *)
+{
+  Py_ssize_t shape[2] = {(Py_ssize_t)self->cloud->size(), 3};
+  Py_ssize_t strides[2] = {sizeof(double), arrayStride(self->cloud->x(), self->cloud->y())};
+  return newArray((PyObject *)self, &self->exports, self->cloud->x(), 'd', sizeof(double), 2,
+                  shape, strides);
+}
+
+static PyObject *pointCloudResize (pyPointCloud *self, PyObject *args)
+{
+  Py_ssize_t n;
+  if (!PyArg_ParseTuple(args, "n", &n) || !checkExports(self->exports))
+  {
+    return NULL;
+  }
+  self->cloud->resize((size_t)((n < 0) ? 0 : n));
+  Py_RETURN_NONE;
+}
+
+static PyObject *poseBatchNew (PyTypeObject *type, PyObject *, PyObject *)
+{
+  pyPoseBatch *self = (pyPoseBatch *)type->tp_alloc(type, 0);
+  if (self != NULL)
+  {
+    self->batch = new Math::PoseBatch();
+    self->exports = 0;
+  }
+  return (PyObject *)self;
+}
+
+static void poseBatchDealloc (pyPoseBatch *self)
+{
+  delete self->batch;
+  Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static int poseBatchInit (pyPoseBatch *self, PyObject *args, PyObject *)
+{
+  PyObject *poses = NULL;
+  if (!PyArg_ParseTuple(args, "|O", &poses) || !checkExports(self->exports))
+  {
+    return -1;
+  }
+  if (poses == NULL)
+  {
+    self->batch->clear();
+    return 0;
+  }
+  if (PyLong_Check(poses))
+  {
+    Py_ssize_t n = PyLong_AsSsize_t(poses);
+    if (n < 0)
+    {
+      PyErr_SetString(PyExc_ValueError, "pose count must not be negative");
+      return -1;
+    }
+    self->batch->clear();
+    self->batch->resize((size_t)n);
+    return 0;
+  }
+
+  //! Rows of x, y, z, qw, qx, qy, qz
+  matrixArg m;
+  if (!m.get(poses, 7, "poses"))
+  {
+    return -1;
+  }
+  self->batch->resize((size_t)m.rows());
+  double *arrays[7] = {self->batch->x(), self->batch->y(), self->batch->z(), self->batch->qw(),
+                       self->batch->qx(), self->batch->qy(), self->batch->qz()};
+  for (Py_ssize_t i = 0; i < m.rows(); ++i)
+  {
+    for (int k = 0; k < 7; ++k)
+    {
+      arrays[k][i] = m.at(i, k);
+    }
+  }
+  return 0;
+}
+
+static Py_ssize_t poseBatchLength (pyPoseBatch *self)
+{
+  return (Py_ssize_t)self->batch->size();
+}
+
+//! @brief The batch as a (7, n) array:  x, y, z, qw, qx, qy, qz
+//!
+static int poseBatchGetBuffer (pyPoseBatch *self, Py_buffer *view, int flags)
+{
+  self->shape[0] = 7;
+  self->shape[1] = (Py_ssize_t)self->batch->size();
+  self->strides[0] = arrayStride(self->batch->x(), self->batch->y());
+  self->strides[1] = sizeof(double);
+  if (fillBuffer(view, (PyObject *)self, self->batch->x(), "d", sizeof(double), 2,
+                 self->shape, self->strides, 0, flags) < 0)
+  {
+    return -1;
+  }
+  ++self->exports;
+  return 0;
+}
+
+static void poseBatchReleaseBuffer (pyPoseBatch *self, Py_buffer *)
+{
+  --self->exports;
+}
+
+//! @brief Positions as an (n, 3) array and quaternions (w, x, y, z) as an (n, 4) array
+//!
+static PyObject *poseBatchPositions (pyPoseBatch *self, void *)
+{
+  Py_ssize_t shape[2] = {(Py_ssize_t)self->batch->size(), 3};
+  Py_ssize_t strides[2] = {sizeof(double), arrayStride(self->batch->x(), self->batch->y())};
+  return newArray((PyObject *)self, &self->exports, self->batch->x(), 'd', sizeof(double), 2,
+                  shape, strides);
+}
+
+static PyObject *poseBatchOrientations (pyPoseBatch *self, void *)
+{
+  Py_ssize_t shape[2] = {(Py_ssize_t)self->batch->size(), 4};
+  Py_ssize_t strides[2] = {sizeof(double), arrayStride(self->batch->x(), self->batch->y())};
+  return newArray((PyObject *)self, &self->exports, self->batch->qw(), 'd', sizeof(double), 2,
+                  shape, strides);
+}
+
+static PyObject *poseBatchResize (pyPoseBatch *self, PyObject *args)
+{
+  Py_ssize_t n;
+  if (!PyArg_ParseTuple(args, "n", &n) || !checkExports(self->exports))
+  {
+    return NULL;
+  }
+  self->batch->resize((size_t)((n < 0) ? 0 : n));
+  Py_RETURN_NONE;
+}
+
+static PyBufferProcs pointCloudBuffer = {(getbufferproc)pointCloudGetBuffer,
+                                         (releasebufferproc)pointCloudReleaseBuffer};
+static PySequenceMethods pointCloudSequence = {(lenfunc)pointCloudLength};
+static PyGetSetDef pointCloudGetSet[] = {
+  {(char *)"points", (getter)pointCloudPoints, NULL, (char *)"The points as an (n, 3) array", NULL},
+  {NULL}
+};
+static PyMethodDef pointCloudMethods[] = {
+  {"resize", (PyCFunction)pointCloudResize, METH_VARARGS, "Set the number of points"},
+  {NULL}
+};
+
+static PyBufferProcs poseBatchBuffer = {(getbufferproc)poseBatchGetBuffer,
+                                        (releasebufferproc)poseBatchReleaseBuffer};
+static PySequenceMethods poseBatchSequence = {(lenfunc)poseBatchLength};
+static PyGetSetDef poseBatchGetSet[] = {
+  {(char *)"positions", (getter)poseBatchPositions, NULL, (char *)"Positions as an (n, 3) array", NULL},
+  {(char *)"orientations", (getter)poseBatchOrientations, NULL,
+   (char *)"Quaternions (w, x, y, z) as an (n, 4) array", NULL},
+  {NULL}
+};
+static PyMethodDef poseBatchMethods[] = {
+  {"resize", (PyCFunction)poseBatchResize, METH_VARARGS, "Set the number of poses (new poses are the identity)"},
+  {NULL}
+};
+
+//! @brief Points passed in by the caller:  a crpi.PointCloud (used in place), a (3, n) array
+//!        with contiguous rows (used in place), or an (n, 3) array (copied)
+//!
+struct cloudArg
+{
+  matrixArg buf;
+  Math::PointCloud copy;
+  Math::PointCloudView view;
+
+  bool get (PyObject *obj, const char *what)
+  {
+    if (PyObject_TypeCheck(obj, &pyPointCloudType))
+    {
+      view = ((pyPointCloud *)obj)->cloud->view();
+      return true;
+    }
+    if (!buf.get(obj, 0, what))
+    {
+      return false;
+    }
+    if (buf.rows() == 3 && buf.cols() != 3 && buf.buf.strides[1] == sizeof(double))
+    {
+      const char *base = (const char *)buf.buf.buf;
+      view = Math::PointCloudView((const double *)base, (const double *)(base + buf.buf.strides[0]),
+                                  (const double *)(base + 2 * buf.buf.strides[0]), (size_t)buf.cols());
+      return true;
+    }
+    if (buf.cols() != 3)
+    {
+      PyErr_Format(PyExc_ValueError, "%s must be a PointCloud or an (n, 3) array", what);
+      return false;
+    }
+    loadCloud(buf, copy);
+    view = copy.view();
+    return true;
+  }
+};
+
+//! @brief A 4x4 homogeneous transform passed in by the caller
+//!
+static bool getTransform (PyObject *obj, Math::Mat4 &t)
+{
+  matrixArg m;
+  if (!m.get(obj, 4, "transform") || m.rows() != 4)
+  {
+    if (!PyErr_Occurred())
+    {
+      PyErr_SetString(PyExc_ValueError, "transform must be a 2-D float64 array of shape (4, 4)");
+    }
+    return false;
+  }
+  for (int r = 0; r < 4; ++r)
+  {
+    for (int c = 0; c < 4; ++c)
+    {
+      t.at(r, c) = m.at(r, c);
+    }
+  }
+  return true;
+}
+
+//! @brief Array owning a copy of a row-major block of doubles
+//!
+static PyObject *newMatrix (const double *values, Py_ssize_t rows, Py_ssize_t cols)
+{
+  pyVector<double> *store = new pyVector<double>();
+  store->data.assign(values, values + (rows * cols));
+  PyObject *owner = newStore(store);
+  if (owner == NULL)
+  {
+    return NULL;
+  }
+  Py_ssize_t shape[2] = {rows, cols};
+  Py_ssize_t strides[2] = {cols * (Py_ssize_t)sizeof(double), sizeof(double)};
+  PyObject *array = newArray(owner, NULL, store->data.empty() ? NULL : &store->data[0], 'd',
+                             sizeof(double), 2, shape, strides);
+  Py_DECREF(owner);
+  return array;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+//!                              crpi.Patterns                              !//
+///////////////////////////////////////////////////////////////////////////////
+
+struct pyPatterns
+{
+  PyObject_HEAD
+  Clustering::Patterns *patterns;
+  int exports;
+  int fdims;
+  int adims;
+};
+
+static PyTypeObject pyPatternsType = {PyVarObject_HEAD_INIT(NULL, 0)};
+
+static void patternsDealloc (pyPatterns *self)
+{
+  delete self->patterns;
+  Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static bool loadPatterns (Clustering::Patterns *patterns, const char *path)
+{
+  bool ok;
+  Py_BEGIN_ALLOW_THREADS
+  ok = Clustering::Patterns::isBinaryPatternFile(path) ? patterns->loadBinary(path) :
+                                                         patterns->loadText(path);
+  Py_END_ALLOW_THREADS
+  if (!ok)
+  {
+    PyErr_Format(PyExc_IOError, "could not read patterns from %s", path);
+  }
+  return ok;
+}
+
+static int patternsInit (pyPatterns *self, PyObject *args, PyObject *kwds)
+{
+  static const char *keywords[] = {"fdims", "adims", "path", NULL};
+  int fdims, adims = 0;
+  const char *path = NULL;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "i|iz", (char **)keywords, &fdims, &adims, &path))
+  {
+    return -1;
+  }
+  if (fdims < 1 || adims < 0)
+  {
+    PyErr_SetString(PyExc_ValueError, "fdims must be positive and adims not negative");
+    return -1;
+  }
+  if (self->patterns != NULL)
+  {
+    if (!checkExports(self->exports))
+    {
+      return -1;
+    }
+    delete self->patterns;
+  }
+  self->patterns = new Clustering::Patterns(fdims, adims, NULL);
+  self->fdims = fdims;
+  self->adims = adims;
+  return (path == NULL || loadPatterns(self->patterns, path)) ? 0 : -1;
+}
+
+static Py_ssize_t patternsLength (pyPatterns *self)
+{
+  return (self->patterns == NULL) ? 0 : self->patterns->getPatternCount();
+}
+
+static PyObject *patternsAdd (pyPatterns *self, PyObject *args)
+{
+  PyObject *featObj, *attrObj = NULL;
+  matrixArg feat, attr;
+  vector<double> frow, arow;
+
+  if (!PyArg_ParseTuple(args, "O|O", &featObj, &attrObj) || !checkExports(self->exports) ||
+      !feat.get(featObj, self->fdims, "features") ||
+      (attrObj != NULL && self->adims > 0 && !attr.get(attrObj, self->adims, "attributes")))
+  {
+    return NULL;
+  }
+  if (attr.held && attr.rows() != feat.rows())
+  {
+    PyErr_SetString(PyExc_ValueError, "features and attributes must have the same number of rows");
+    return NULL;
+  }
+
+  frow.resize(self->fdims);
+  arow.assign(self->adims + 1, 0.0);
+  self->patterns->reserve(self->patterns->getPatternCount() + (int)feat.rows());
+  for (Py_ssize_t r = 0; r < feat.rows(); ++r)
+  {
+    for (int c = 0; c < self->fdims; ++c)
+    {
+      frow[c] = feat.at(r, c);
+    }
+    for (int c = 0; attr.held && c < self->adims; ++c)
+    {
+      arow[c] = attr.at(r, c);
+    }
+    if (!self->patterns->addPattern(&frow[0], &arow[0]))
+    {
+      return PyErr_NoMemory();
+    }
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject *patternsLoad (pyPatterns *self, PyObject *args)
+{
+  const char *path;
+  if (!PyArg_ParseTuple(args, "s", &path) || !checkExports(self->exports) ||
+      !loadPatterns(self->patterns, path))
+  {
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject *patternsSave (pyPatterns *self, PyObject *args)
+{
+  const char *path;
+  bool ok;
+  if (!PyArg_ParseTuple(args, "s", &path))
+  {
+    return NULL;
+  }
+  Py_BEGIN_ALLOW_THREADS
+  ok = self->patterns->saveBinary(path);
+  Py_END_ALLOW_THREADS
+  if (!ok)
+  {
+    PyErr_Format(PyExc_IOError, "could not write %s", path);
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject *patternsClear (pyPatterns *self, PyObject *)
+{
+  if (!checkExports(self->exports))
+  {
+    return NULL;
+  }
+  self->patterns->clearPatterns();
+  Py_RETURN_NONE;
+}
+
+//! @brief A matrix of the store, one padded row per pattern
+//!
+static PyObject *patternsMatrix (pyPatterns *self, const double *base, int dims, int stride, bool readonly)
+{
+  Py_ssize_t shape[2] = {self->patterns->getPatternCount(), dims};
+  Py_ssize_t strides[2] = {stride * (Py_ssize_t)sizeof(double), sizeof(double)};
+  return newArray((PyObject *)self, &self->exports, (shape[0] == 0) ? NULL : (void *)base, 'd',
+                  sizeof(double), 2, shape, strides, readonly);
+}
+
+static PyObject *patternsRaw (pyPatterns *self, void *)
+{
+  const double *base = (self->patterns->getPatternCount() == 0) ? NULL : self->patterns->getRawFeatureRow(0);
+  return patternsMatrix(self, base, self->fdims, self->patterns->getFeatureStride(), false);
+}
+
+static PyObject *patternsScaled (pyPatterns *self, void *)
+{
+  const double *base = (self->patterns->getPatternCount() == 0) ? NULL : self->patterns->getScaledFeatureRow(0);
+  return patternsMatrix(self, base, self->fdims, self->patterns->getFeatureStride(), true);
+}
+
+static PyObject *patternsAttributes (pyPatterns *self, void *)
+{
+  const double *base = (self->patterns->getPatternCount() == 0) ? NULL : self->patterns->getAttributeRow(0);
+  return patternsMatrix(self, base, self->adims, self->patterns->getAttributeStride(), false);
+}
+
+static PySequenceMethods patternsSequence = {(lenfunc)patternsLength};
+static PyGetSetDef patternsGetSet[] = {
+  {(char *)"raw", (getter)patternsRaw, NULL, (char *)"Raw features, an (n, fdims) array", NULL},
+  {(char *)"scaled", (getter)patternsScaled, NULL,
+   (char *)"Features scaled to [0, 1] by the feature ranges (read-only)", NULL},
+  {(char *)"attributes", (getter)patternsAttributes, NULL, (char *)"Attributes, an (n, adims) array", NULL},
+  {NULL}
+};
+static PyMethodDef patternsMethods[] = {
+  {"add", (PyCFunction)patternsAdd, METH_VARARGS, "add(features[, attributes]):  append (n, fdims) patterns"},
+  {"load", (PyCFunction)patternsLoad, METH_VARARGS, "Append the patterns of a text or binary pattern file"},
+  {"save", (PyCFunction)patternsSave, METH_VARARGS, "Write the patterns as a binary pattern file"},
+  {"clear", (PyCFunction)patternsClear, METH_NOARGS, "Remove all patterns"},
+  {NULL}
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+//!                              Recordings                                 !//
+///////////////////////////////////////////////////////////////////////////////
+
+//! @brief Add a column of fixed-size records to a dictionary
+//!
+static bool addColumn (PyObject *dict, const char *name, PyObject *owner, size_t count,
+                       size_t recordSize, const void *field, char format,
+                       Py_ssize_t itemsize, Py_ssize_t width = 0, Py_ssize_t height = 0)
+{
+  Py_ssize_t shape[3] = {(Py_ssize_t)count, width, height};
+  Py_ssize_t strides[3] = {(Py_ssize_t)recordSize, itemsize, itemsize};
+  int ndim = (width == 0) ? 1 : ((height == 0) ? 2 : 3);
+  if (ndim == 3)
+  {
+    strides[1] = height * itemsize;
+  }
+  PyObject *array = newArray(owner, NULL, (count == 0) ? NULL : (void *)field, format, itemsize,
+                             ndim, shape, strides);
+  if (array == NULL)
+  {
+    return false;
+  }
+  int status = PyDict_SetItemString(dict, name, array);
+  Py_DECREF(array);
+  return status == 0;
+}
+
+static PyObject *readStates (PyObject *, PyObject *args, PyObject *kwds)
+{
+  static const char *keywords[] = {"path", "channel", NULL};
+  const char *path, *channel = NULL;
+  crpi_robot::CrpiRecordReader reader;
+  crpi_robot::CrpiRecord record;
+  pyStateStore *store;
+  bool opened;
+  int axes = 0;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|z", (char **)keywords, &path, &channel))
+  {
+    return NULL;
+  }
+
+  store = new pyStateStore();
+  Py_BEGIN_ALLOW_THREADS
+  opened = reader.Open(path);
+  while (opened && reader.Next(record))
+  {
+    if (record.kind != crpi_robot::RECORD_STATE ||
+        (channel != NULL && strcmp(reader.ChannelName(record.channel), channel) != 0))
+    {
+      continue;
+    }
+    //! States recorded before the later fields existed are shorter
+    store->states.push_back(RobotStateSnapshot());
+    memcpy(&store->states.back(), record.data,
+           ((size_t)record.size < sizeof(RobotStateSnapshot)) ? (size_t)record.size : sizeof(RobotStateSnapshot));
+    store->channels.push_back(record.channel);
+    axes = (store->states.back().axes > axes) ? store->states.back().axes : axes;
+  }
+  Py_END_ALLOW_THREADS
+  if (!opened)
+  {
+    delete store;
+    PyErr_Format(PyExc_IOError, "%s is not a CRPI recording", path);
+    return NULL;
+  }
+  axes = (axes > CRPI_AXES_MAX) ? CRPI_AXES_MAX : axes;
+
+  PyObject *owner = newStore(store), *dict = (owner == NULL) ? NULL : PyDict_New();
+  if (dict != NULL)
+  {
+    size_t n = store->states.size(), size = sizeof(RobotStateSnapshot);
+    const RobotStateSnapshot *s = (n == 0) ? NULL : &store->states[0];
+    const int *ch = (n == 0) ? NULL : &store->channels[0];
+    bool ok = (n == 0 ||
+               (&s->pose.y == &s->pose.x + 1 && &s->pose.zrot == &s->pose.x + 5));
+    ok = ok &&
+      addColumn(dict, "timestamp", owner, n, size, (n == 0) ? NULL : &s->timestamp, 'd', sizeof(double)) &&
+      addColumn(dict, "pose", owner, n, size, (n == 0) ? NULL : &s->pose.x, 'd', sizeof(double), 6) &&
+      addColumn(dict, "forces", owner, n, size, (n == 0) ? NULL : &s->forces.x, 'd', sizeof(double), 6) &&
+      addColumn(dict, "speeds", owner, n, size, (n == 0) ? NULL : &s->speeds.x, 'd', sizeof(double), 6) &&
+      addColumn(dict, "axis", owner, n, size, (n == 0) ? NULL : &s->axis[0], 'd', sizeof(double), axes) &&
+      addColumn(dict, "torque", owner, n, size, (n == 0) ? NULL : &s->torque[0], 'd', sizeof(double), axes) &&
+      addColumn(dict, "valid", owner, n, size, (n == 0) ? NULL : &s->valid, 'I', sizeof(unsigned int)) &&
+      addColumn(dict, "sequence", owner, n, size, (n == 0) ? NULL : &s->sequence, 'L', sizeof(unsigned long)) &&
+      addColumn(dict, "robot_mode", owner, n, size, (n == 0) ? NULL : &s->robotMode, 'i', sizeof(int)) &&
+      addColumn(dict, "safety_mode", owner, n, size, (n == 0) ? NULL : &s->safetyMode, 'i', sizeof(int)) &&
+      addColumn(dict, "status", owner, n, size, (n == 0) ? NULL : &s->status, 'I', sizeof(unsigned int)) &&
+      addColumn(dict, "channel", owner, n, sizeof(int), ch, 'i', sizeof(int));
+    if (!ok)
+    {
+      if (!PyErr_Occurred())
+      {
+        PyErr_SetString(PyExc_RuntimeError, "unexpected robotPose layout");
+      }
+      Py_CLEAR(dict);
+    }
+  }
+  Py_XDECREF(owner);
+  return dict;
+}
+
+static PyObject *readMocap (PyObject *, PyObject *args)
+{
+  const char *path;
+  crpi_robot::CrpiRecordReader reader;
+  crpi_robot::CrpiRecord record;
+  map<pair<int, int>, pySubjectStore *> subjects;
+  map<pair<int, int>, string> names;
+  bool opened;
+
+  if (!PyArg_ParseTuple(args, "s", &path))
+  {
+    return NULL;
+  }
+
+  Py_BEGIN_ALLOW_THREADS
+  opened = reader.Open(path);
+  while (opened && reader.Next(record))
+  {
+    if (strncmp(reader.ChannelName(record.channel), "mocap/", 6) != 0)
+    {
+      continue;
+    }
+    if (record.kind == crpi_robot::RECORD_NAME && record.size > (int)sizeof(int))
+    {
+      const crpi_robot::crpiRecordName *name = (const crpi_robot::crpiRecordName *)record.data;
+      names[make_pair(record.channel, name->id)] = string(name->name, record.size - sizeof(int));
+    }
+    else if (record.kind == crpi_robot::RECORD_SENSOR && record.size >= (int)sizeof(Sensor::MoCapRecordHeader))
+    {
+      const Sensor::MoCapRecordHeader *header = (const Sensor::MoCapRecordHeader *)record.data;
+      const Sensor::MoCapRecordSubject *subject = (const Sensor::MoCapRecordSubject *)(header + 1);
+      int count = (record.size - (int)sizeof(Sensor::MoCapRecordHeader)) / (int)sizeof(Sensor::MoCapRecordSubject);
+      count = (header->subjectCount < count) ? header->subjectCount : count;
+      for (int i = 0; i < count; ++i)
+      {
+        pySubjectStore *&store = subjects[make_pair(record.channel, subject[i].id)];
+        if (store == NULL)
+        {
+          store = new pySubjectStore();
+        }
+        store->samples.push_back(subject[i]);
+        store->timestamps.push_back(record.timestamp);
+        store->frames.push_back(header->frameNumber);
+      }
+    }
+  }
+  Py_END_ALLOW_THREADS
+
+  PyObject *result = opened ? PyDict_New() : NULL;
+  if (!opened)
+  {
+    PyErr_Format(PyExc_IOError, "%s is not a CRPI recording", path);
+  }
+  map<pair<int, int>, pySubjectStore *>::iterator iter;
+  for (iter = subjects.begin(); iter != subjects.end(); ++iter)
+  {
+    pySubjectStore *store = iter->second;
+    iter->second = NULL;
+    if (result == NULL)
+    {
+      delete store;
+      continue;
+    }
+
+    //! Subjects are keyed by name; one seen on two trackers is keyed by tracker too
+    string name = names.count(iter->first) ? names[iter->first] :
+                  ("id" + to_string((long long)iter->first.second));
+    if (PyDict_GetItemString(result, name.c_str()) != NULL)
+    {
+      name = string(reader.ChannelName(iter->first.first)) + "/" + name;
+    }
+
+    PyObject *owner = newStore(store), *dict = (owner == NULL) ? NULL : PyDict_New();
+    size_t n = store->samples.size(), size = sizeof(Sensor::MoCapRecordSubject);
+    const Sensor::MoCapRecordSubject *s = &store->samples[0];
+    bool ok = dict != NULL &&
+      addColumn(dict, "timestamp", owner, n, sizeof(double), &store->timestamps[0], 'd', sizeof(double)) &&
+      addColumn(dict, "frame", owner, n, sizeof(unsigned int), &store->frames[0], 'I', sizeof(unsigned int)) &&
+      addColumn(dict, "pose", owner, n, size, s->pose, 'd', sizeof(double), 6) &&
+      addColumn(dict, "rotation", owner, n, size, s->rotation, 'd', sizeof(double), 3, 3) &&
+      PyDict_SetItemString(result, name.c_str(), dict) == 0;
+    Py_XDECREF(dict);
+    Py_XDECREF(owner);
+    if (!ok)
+    {
+      Py_CLEAR(result);
+    }
+  }
+  return result;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+//!                         Clustering, registration                        !//
+///////////////////////////////////////////////////////////////////////////////
+
+static PyObject *kmeansCluster (PyObject *, PyObject *args, PyObject *kwds)
+{
+  static const char *keywords[] = {"features", "k", "attributes", "iterations", "seeding",
+                                   "assignment", "threads", "seed", "min_members", NULL};
+  PyObject *featObj, *attrObj = Py_None, *seedObj = Py_None;
+  const char *seeding = "plusplus", *assignment = "lloyd";
+  int k, iterations = 100, threads = 0, minMembers = 0, fdim, adim = 0, n;
+  vector<double> features, attributes;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "Oi|OissiOi", (char **)keywords, &featObj, &k,
+                                   &attrObj, &iterations, &seeding, &assignment, &threads,
+                                   &seedObj, &minMembers))
+  {
+    return NULL;
+  }
+
+  //! A Patterns store is read in place; arrays are packed
+  if (PyObject_TypeCheck(featObj, &pyPatternsType))
+  {
+    Clustering::Patterns *patterns = ((pyPatterns *)featObj)->patterns;
+    fdim = ((pyPatterns *)featObj)->fdims;
+    adim = ((pyPatterns *)featObj)->adims;
+    n = patterns->getPatternCount();
+    features.resize((size_t)n * fdim);
+    attributes.resize((size_t)n * adim);
+    for (int i = 0; i < n; ++i)
+    {
+      memcpy(&features[(size_t)i * fdim], patterns->getRawFeatureRow(i), fdim * sizeof(double));
+      if (adim > 0)
+      {
+        memcpy(&attributes[(size_t)i * adim], patterns->getAttributeRow(i), adim * sizeof(double));
+      }
+    }
+  }
+  else
+  {
+    matrixArg feat, attr;
+    if (!feat.get(featObj, 0, "features"))
+    {
+      return NULL;
+    }
+    feat.pack(features);
+    fdim = (int)feat.cols();
+    n = (int)feat.rows();
+    if (attrObj != Py_None)
+    {
+      if (!attr.get(attrObj, 0, "attributes"))
+      {
+        return NULL;
+      }
+      if (attr.rows() != feat.rows())
+      {
+        PyErr_SetString(PyExc_ValueError, "features and attributes must have the same number of rows");
+        return NULL;
+      }
+      attr.pack(attributes);
+      adim = (int)attr.cols();
+    }
+  }
+  if (k < 1 || n < k || fdim < 1)
+  {
+    PyErr_SetString(PyExc_ValueError, "need at least k patterns of at least one feature");
+    return NULL;
+  }
+
+  Clustering::kMeansSeeding seed = (strcmp(seeding, "random") == 0) ? Clustering::KMEANS_SEED_RANDOM :
+                                                                       Clustering::KMEANS_SEED_PLUSPLUS;
+  Clustering::kMeansAssignment assign = (strcmp(assignment, "hamerly") == 0) ? Clustering::KMEANS_ASSIGN_HAMERLY :
+                                                                                Clustering::KMEANS_ASSIGN_LLOYD;
+  unsigned long long rngSeed = 0;
+  if (seedObj != Py_None)
+  {
+    rngSeed = PyLong_AsUnsignedLongLong(seedObj);
+    if (PyErr_Occurred())
+    {
+      return NULL;
+    }
+  }
+
+  vector<double> centroids((size_t)k * fdim), means((size_t)k * adim + 1);
+  pyVector<int> *labels = new pyVector<int>();
+  labels->data.resize(n);
+  Py_BEGIN_ALLOW_THREADS
+  Clustering::kMeans km(fdim, adim, k, NULL, seed, assign);
+  if (seedObj != Py_None)
+  {
+    km.setRandomSeed(rngSeed);
+  }
+  km.setMinClusterMembers(minMembers);
+  km.addTrainingPatterns(&features[0], attributes.empty() ? NULL : &attributes[0], n);
+  km.seedClusters();
+  for (int i = 0; i < iterations && km.recluster(threads) > 0; ++i)
+  {
+  }
+  km.evalPatterns(&features[0], n, &labels->data[0]);
+  for (int c = 0; c < k; ++c)
+  {
+    km.getClusterInfo(c, &centroids[(size_t)c * fdim], &means[(size_t)c * adim]);
+  }
+  Py_END_ALLOW_THREADS
+
+  PyObject *owner = newStore(labels);
+  if (owner == NULL)
+  {
+    return NULL;
+  }
+  Py_ssize_t shape[1] = {n}, strides[1] = {sizeof(int)};
+  PyObject *labelArray = newArray(owner, NULL, &labels->data[0], 'i', sizeof(int), 1, shape, strides);
+  Py_DECREF(owner);
+  PyObject *centroidArray = newMatrix(&centroids[0], k, fdim);
+  PyObject *meanArray = newMatrix(&means[0], k, adim);
+  if (labelArray == NULL || centroidArray == NULL || meanArray == NULL)
+  {
+    Py_XDECREF(labelArray);
+    Py_XDECREF(centroidArray);
+    Py_XDECREF(meanArray);
+    return NULL;
+  }
+  return Py_BuildValue("NNN", centroidArray, labelArray, meanArray);
+}
+
+static PyObject *registerTarget (PyObject *, PyObject *args)
+{
+  PyObject *sutObj, *tarObj;
+  cloudArg sut, tar;
+  Math::matrix out(4, 4);
+  double values[16];
+  bool ok;
+
+  if (!PyArg_ParseTuple(args, "OO", &sutObj, &tarObj) || !sut.get(sutObj, "sut") || !tar.get(tarObj, "target"))
+  {
+    return NULL;
+  }
+  Py_BEGIN_ALLOW_THREADS
+  ok = Registration::reg2target(sut.view, tar.view, out);
+  Py_END_ALLOW_THREADS
+  if (!ok)
+  {
+    PyErr_SetString(PyExc_ValueError, "registration failed (fewer than three corresponding points, or collinear points)");
+    return NULL;
+  }
+  for (int r = 0; r < 4; ++r)
+  {
+    for (int c = 0; c < 4; ++c)
+    {
+      values[r * 4 + c] = out.at(r, c);
+    }
+  }
+  return newMatrix(values, 4, 4);
+}
+
+static PyObject *transformPoints (PyObject *, PyObject *args)
+{
+  PyObject *tObj, *inObj, *outObj = Py_None;
+  Math::Mat4 t;
+  cloudArg in;
+
+  if (!PyArg_ParseTuple(args, "OO|O", &tObj, &inObj, &outObj) || !getTransform(tObj, t) ||
+      !in.get(inObj, "points"))
+  {
+    return NULL;
+  }
+  if (outObj == Py_None)
+  {
+    outObj = PyObject_CallObject((PyObject *)&pyPointCloudType, NULL);
+    if (outObj == NULL)
+    {
+      return NULL;
+    }
+  }
+  else if (!PyObject_TypeCheck(outObj, &pyPointCloudType))
+  {
+    PyErr_SetString(PyExc_TypeError, "out must be a PointCloud");
+    return NULL;
+  }
+  else
+  {
+    Py_INCREF(outObj);
+  }
+
+  pyPointCloud *out = (pyPointCloud *)outObj;
+  if (out->cloud->x() != in.view.x && out->cloud->size() != in.view.count && !checkExports(out->exports))
+  {
+    Py_DECREF(outObj);
+    return NULL;
+  }
+  Py_BEGIN_ALLOW_THREADS
+  Math::transformPoints(t, in.view, *out->cloud);
+  Py_END_ALLOW_THREADS
+  return outObj;
+}
+
+static PyObject *transformPoses (PyObject *, PyObject *args)
+{
+  PyObject *tObj, *inObj, *outObj = Py_None;
+  Math::Mat4 t;
+  Math::Mat<3, 3> rot;
+
+  if (!PyArg_ParseTuple(args, "OO!|O", &tObj, &pyPoseBatchType, &inObj, &outObj) || !getTransform(tObj, t))
+  {
+    return NULL;
+  }
+  if (outObj == Py_None)
+  {
+    outObj = PyObject_CallObject((PyObject *)&pyPoseBatchType, NULL);
+    if (outObj == NULL)
+    {
+      return NULL;
+    }
+  }
+  else if (!PyObject_TypeCheck(outObj, &pyPoseBatchType))
+  {
+    PyErr_SetString(PyExc_TypeError, "out must be a PoseBatch");
+    return NULL;
+  }
+  else
+  {
+    Py_INCREF(outObj);
+  }
+
+  pyPoseBatch *in = (pyPoseBatch *)inObj, *out = (pyPoseBatch *)outObj;
+  if (out != in && out->batch->size() != in->batch->size() && !checkExports(out->exports))
+  {
+    Py_DECREF(outObj);
+    return NULL;
+  }
+  for (int r = 0; r < 3; ++r)
+  {
+    for (int c = 0; c < 3; ++c)
+    {
+      rot.at(r, c) = t.at(r, c);
+    }
+  }
+  Math::qpose q(Math::point(t.at(0, 3), t.at(1, 3), t.at(2, 3)), Math::matrixToQuaternion(rot));
+  Py_BEGIN_ALLOW_THREADS
+  Math::transformPoses(q, *in->batch, *out->batch);
+  Py_END_ALLOW_THREADS
+  return outObj;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+//!                                 Module                                  !//
+///////////////////////////////////////////////////////////////////////////////
+
+static PyMethodDef crpiMethods[] = {
+  {"read_states", (PyCFunction)(void (*)(void))readStates, METH_VARARGS | METH_KEYWORDS,
+   "read_states(path, channel=None):  columns of the robot states of a recording (a dict of arrays)"},
+  {"read_mocap", (PyCFunction)readMocap, METH_VARARGS,
+   "read_mocap(path):  the motion capture subjects of a recording (a dict of dicts of arrays)"},
+  {"kmeans", (PyCFunction)(void (*)(void))kmeansCluster, METH_VARARGS | METH_KEYWORDS,
+   "kmeans(features, k, attributes=None, iterations=100, seeding='plusplus', assignment='lloyd', "
+   "threads=0, seed=None, min_members=0):  (centroids, labels, attribute means)"},
+  {"reg2target", (PyCFunction)registerTarget, METH_VARARGS,
+   "reg2target(sut, target):  4x4 least squares rigid transform from sut to target points"},
+  {"transform_points", (PyCFunction)transformPoints, METH_VARARGS,
+   "transform_points(t, points, out=None):  apply a 4x4 transform, returning a PointCloud"},
+  {"transform_poses", (PyCFunction)transformPoses, METH_VARARGS,
+   "transform_poses(t, poses, out=None):  compose a 4x4 rigid transform with a PoseBatch"},
+  {NULL}
+};
+
+static struct PyModuleDef crpiModule = {
+  PyModuleDef_HEAD_INIT, "crpi", "CRPI containers, recordings, and batch math for NumPy", -1, crpiMethods
+};
+
+static bool readyType (PyObject *module, PyTypeObject *type, const char *name, const char *doc,
+                       size_t size)
+{
+  type->tp_name = name;
+  type->tp_doc = doc;
+  type->tp_basicsize = (Py_ssize_t)size;
+  type->tp_flags = Py_TPFLAGS_DEFAULT;
+  if (PyType_Ready(type) < 0)
+  {
+    return false;
+  }
+  Py_INCREF(type);
+  return PyModule_AddObject(module, strrchr(name, '.') + 1, (PyObject *)type) == 0;
+}
+
+PyMODINIT_FUNC PyInit_crpi (void)
+{
+  PyObject *module = PyModule_Create(&crpiModule);
+  if (module == NULL)
+  {
+    return NULL;
+  }
+
+  pyArrayType.tp_dealloc = (destructor)arrayDealloc;
+  pyArrayType.tp_as_buffer = &arrayBuffer;
+  pyArrayType.tp_as_sequence = &arraySequence;
+  pyArrayType.tp_getset = arrayGetSet;
+
+  pyPointCloudType.tp_new = pointCloudNew;
+  pyPointCloudType.tp_init = (initproc)pointCloudInit;
+  pyPointCloudType.tp_dealloc = (destructor)pointCloudDealloc;
+  pyPointCloudType.tp_as_buffer = &pointCloudBuffer;
+  pyPointCloudType.tp_as_sequence = &pointCloudSequence;
+  pyPointCloudType.tp_getset = pointCloudGetSet;
+  pyPointCloudType.tp_methods = pointCloudMethods;
+
+  pyPoseBatchType.tp_new = poseBatchNew;
+  pyPoseBatchType.tp_init = (initproc)poseBatchInit;
+  pyPoseBatchType.tp_dealloc = (destructor)poseBatchDealloc;
+  pyPoseBatchType.tp_as_buffer = &poseBatchBuffer;
+  pyPoseBatchType.tp_as_sequence = &poseBatchSequence;
+  pyPoseBatchType.tp_getset = poseBatchGetSet;
+  pyPoseBatchType.tp_methods = poseBatchMethods;
+
+  pyPatternsType.tp_new = PyType_GenericNew;
+  pyPatternsType.tp_init = (initproc)patternsInit;
+  pyPatternsType.tp_dealloc = (destructor)patternsDealloc;
+  pyPatternsType.tp_as_sequence = &patternsSequence;
+  pyPatternsType.tp_getset = patternsGetSet;
+  pyPatternsType.tp_methods = patternsMethods;
+
+  if (!readyType(module, &pyArrayType, "crpi.Array",
+                 "View of native CRPI storage, exported through the buffer protocol", sizeof(pyArray)) ||
+      !readyType(module, &pyPointCloudType, "crpi.PointCloud",
+                 "PointCloud([points]):  points from a count or an (n, 3) array; a (3, n) buffer", sizeof(pyPointCloud)) ||
+      !readyType(module, &pyPoseBatchType, "crpi.PoseBatch",
+                 "PoseBatch([poses]):  poses from a count or an (n, 7) array; a (7, n) buffer", sizeof(pyPoseBatch)) ||
+      !readyType(module, &pyPatternsType, "crpi.Patterns",
+                 "Patterns(fdims, adims=0, path=None):  a pattern store", sizeof(pyPatterns)))
+  {
+    Py_DECREF(module);
+    return NULL;
+  }
+  return module;
+}
@@ -12,156 +12,448 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "CoordFrameReg.h"
+#include "Random.h"
+#include "Interpolation.h"
+#include <cstring>
+#include <thread>
 
 //! Clustering
 #if defined(_MSC_VER)
 #include "kMeansCluster.h"
+#include "GaussianMixture.h"
 #elif defined(__GNUC__)
 #include "../../Clustering/kMeans/kMeansCluster.h"
+#include "../../Clustering/GMM/GaussianMixture.h"
 #endif
 using namespace Clustering;
 
 namespace Registration
 {
-  LIBRARY_API bool reg2target(vector<point> &sutPoints, vector<point> &tarPoints, matrix &out)
+  //! @brief Least squares rigid transformation from the weighted sums of a set of correspondences
+  //!
+  //! @param sum      Total weight
+  //! @param ssut     Weighted sum of the source points, relative to origin_s
+  //! @param star     Weighted sum of the target points, relative to origin_t
+  //! @param cross    Weighted sum of (s - origin_s)(t - origin_t)' (row-major; overwritten)
+  //! @param origin_s Origin of the source sums
+  //! @param origin_t Origin of the target sums
+  //! @param h        The row-major 4x4 transformation
+  //!
+  //! @return True if the points are not collinear
+  //!
+  static bool rigidFromSums(double sum, const double *ssut, const double *star, double *cross,
+                            const double *origin_s, const double *origin_t, double *h)
   {
-    double precision = 0.001f;
-    int i;
-    point temp;
-    point sut_p[3], tar_p[3];
-    point sut_v1, sut_v2, tar_v1, tar_v2;
-    point sut_x_hat, tar_x_hat;
-    double mag;
-    point sut_z_hat, tar_z_hat;
-    point sut_y_hat, tar_y_hat;
+    double ms[3], mt[3], u[9], sv[3], v[9], r[9], det;
+    int j, k;
 
-    matrix test(4, 4);
-
-    matrix sut_H(4, 4), tar_H(4, 4), sut_H_inv(4, 4);
+    if (sum <= 0.0)
+    {
+      return false;
+    }
 
-    vector<point>::iterator sut_iter, tar_iter;
+    //! Cross-covariance H = sum w (s - s_mean)(t - t_mean)'
+    for (j = 0; j < 3; ++j)
+    {
+      ms[j] = ssut[j] / sum;
+      mt[j] = star[j] / sum;
+    }
+    for (j = 0; j < 3; ++j)
+    {
+      for (k = 0; k < 3; ++k)
+      {
+        cross[(j * 3) + k] = (cross[(j * 3) + k] / sum) - (ms[j] * mt[k]);
+      }
+    }
 
-    if (sutPoints.size() != tarPoints.size() || sutPoints.size() < 3 ||
-      out.cols != 4 || out.rows != 4)
+    //! H = U S V', R = V diag(1, 1, d) U' with d correcting a reflection.  Collinear (or
+    //! coincident) points leave the second singular value at zero.
+    svd3(cross, u, sv, v);
+    if (sv[0] <= 0.0 || sv[1] <= (1.0e-9 * sv[0]))
     {
-      //! Dimensions are wrong
       return false;
     }
+    det = (u[0] * ((u[4] * u[8]) - (u[5] * u[7]))) - (u[1] * ((u[3] * u[8]) - (u[5] * u[6]))) +
+          (u[2] * ((u[3] * u[7]) - (u[4] * u[6])));
+    det *= (v[0] * ((v[4] * v[8]) - (v[5] * v[7]))) - (v[1] * ((v[3] * v[8]) - (v[5] * v[6]))) +
+           (v[2] * ((v[3] * v[7]) - (v[4] * v[6])));
+    for (j = 0; j < 3; ++j)
+    {
+      for (k = 0; k < 3; ++k)
+      {
+        r[(j * 3) + k] = (v[(j * 3) + 0] * u[(k * 3) + 0]) + (v[(j * 3) + 1] * u[(k * 3) + 1]) +
+                         (((det < 0.0) ? -1.0 : 1.0) * v[(j * 3) + 2] * u[(k * 3) + 2]);
+      }
+    }
+
+    //! t = t_mean - R s_mean
+    for (j = 0; j < 3; ++j)
+    {
+      h[(j * 4) + 0] = r[(j * 3) + 0];
+      h[(j * 4) + 1] = r[(j * 3) + 1];
+      h[(j * 4) + 2] = r[(j * 3) + 2];
+      h[(j * 4) + 3] = origin_t[j] + mt[j];
+      for (k = 0; k < 3; ++k)
+      {
+        h[(j * 4) + 3] -= r[(j * 3) + k] * (origin_s[k] + ms[k]);
+      }
+    }
+    h[12] = h[13] = h[14] = 0.0;
+    h[15] = 1.0;
+    return true;
+  }
+
 
-    sut_iter = sutPoints.begin();
-    tar_iter = tarPoints.begin();
+  //! @brief Weighted least squares rigid transformation (Kabsch) from sut to tar
+  //!
+  //! @param sutPoints Points in the source frame
+  //! @param tarPoints Corresponding points in the target frame
+  //! @param weights   Weight of each correspondence (NULL for all 1); zero weights are skipped
+  //! @param h         The row-major 4x4 transformation
+  //!
+  //! @return True if at least three non-collinear points carry weight
+  //!
+  //! @note Takes any point container with size() and operator[] returning a point:  vectors of
+  //!       points, or PointCloudViews over coordinate arrays
+  //!
+  template <class Points> static bool fitRigid(const Points &sutPoints, const Points &tarPoints,
+                                               const double *weights, double *h)
+  {
+    double sum = 0.0, ssut[3] = {0.0, 0.0, 0.0}, star[3] = {0.0, 0.0, 0.0}, cross[9];
+    double origin_s[3], origin_t[3], a[3], b[3], w;
+    int i, j, k, used = 0, n = (int)sutPoints.size();
+
+    if (n < 3)
+    {
+      return false;
+    }
+    for (j = 0; j < 9; ++j)
+    {
+      cross[j] = 0.0;
+    }
 
-    //! Take the first three points, discard the rest
-    for (i = 0; i < 3; ++i, ++sut_iter, ++tar_iter)
+    //! One pass over the correspondences, with sums taken about the first pair to limit
+    //! cancellation when the points are far from the origin
+    origin_s[0] = sutPoints[0].x;
+    origin_s[1] = sutPoints[0].y;
+    origin_s[2] = sutPoints[0].z;
+    origin_t[0] = tarPoints[0].x;
+    origin_t[1] = tarPoints[0].y;
+    origin_t[2] = tarPoints[0].z;
+    for (i = 0; i < n; ++i)
+    {
+      w = (weights == NULL) ? 1.0 : weights[i];
+      if (w <= 0.0)
+      {
+        continue;
+      }
+      a[0] = sutPoints[i].x - origin_s[0];
+      a[1] = sutPoints[i].y - origin_s[1];
+      a[2] = sutPoints[i].z - origin_s[2];
+      b[0] = tarPoints[i].x - origin_t[0];
+      b[1] = tarPoints[i].y - origin_t[1];
+      b[2] = tarPoints[i].z - origin_t[2];
+      sum += w;
+      for (j = 0; j < 3; ++j)
+      {
+        ssut[j] += w * a[j];
+        star[j] += w * b[j];
+        for (k = 0; k < 3; ++k)
+        {
+          cross[(j * 3) + k] += w * a[j] * b[k];
+        }
+      }
+      ++used;
+    }
+    if (used < 3)
     {
-      sut_p[i] = *sut_iter;
-      tar_p[i] = *tar_iter;
+      return false;
+    }
+    return rigidFromSums(sum, ssut, star, cross, origin_s, origin_t, h);
+  }
 
-      //cout << sut_p[i].x << " " << sut_p[i].y << " " << sut_p[i].z << "  |  " << tar_p[i].x << " " << tar_p[i].y << " " << tar_p[i].z << endl;
+
+  //! @brief Distance between a target point and its transformed source point
+  //!
+  static double fitResidual(const double *h, const point &sut, const point &tar)
+  {
+    double dx = (h[0] * sut.x) + (h[1] * sut.y) + (h[2] * sut.z) + h[3] - tar.x;
+    double dy = (h[4] * sut.x) + (h[5] * sut.y) + (h[6] * sut.z) + h[7] - tar.y;
+    double dz = (h[8] * sut.x) + (h[9] * sut.y) + (h[10] * sut.z) + h[11] - tar.z;
+    return sqrt((dx * dx) + (dy * dy) + (dz * dz));
+  }
+
+
+  //! @brief Copy a row-major 4x4 transformation into a matrix
+  //!
+  static void storeRigid(const double *h, matrix &out)
+  {
+    int i, j;
+    for (i = 0; i < 4; ++i)
+    {
+      for (j = 0; j < 4; ++j)
+      {
+        out.at(i, j) = h[(i * 4) + j];
+      }
     }
+  }
+
+
+  LIBRARY_API bool reg2target(vector<point> &sutPoints, vector<point> &tarPoints, matrix &out)
+  {
+    double h[16];
 
-    sut_v1 = sut_p[1] - sut_p[0];
-    sut_v2 = sut_p[2] - sut_p[0];
+    if (sutPoints.size() != tarPoints.size() || sutPoints.size() < 3 ||
+      out.cols != 4 || out.rows != 4)
+    {
+      //! Dimensions are wrong
+      return false;
+    }
 
-    //! Test for collinearity
-    temp = sut_v1.cross(sut_v2);
-    if (fabs(temp.x) <= precision && fabs(temp.y) <= precision && fabs(temp.z) <= precision)
+    if (!fitRigid(sutPoints, tarPoints, NULL, h))
     {
       //! Points are collinear.
       return false;
     }
+    storeRigid(h, out);
+    return true;
+  }
+
 
-    tar_v1 = tar_p[1] - tar_p[0];
-    tar_v2 = tar_p[2] - tar_p[0];
+  LIBRARY_API bool reg2target(const PointCloudView &sutPoints, const PointCloudView &tarPoints, matrix &out)
+  {
+    double h[16];
 
-    mag = sut_v1.magnitude();
-    if (mag < precision)
+    if (sutPoints.size() != tarPoints.size() || sutPoints.size() < 3 ||
+      out.cols != 4 || out.rows != 4)
     {
       return false;
     }
-    sut_x_hat = sut_v1 / mag;
 
-    mag = tar_v1.magnitude();
-    if (mag < precision)
+    if (!fitRigid(sutPoints, tarPoints, NULL, h))
     {
       return false;
     }
-    tar_x_hat = tar_v1 / mag;
+    storeRigid(h, out);
+    return true;
+  }
+
 
-    temp = sut_x_hat.cross(sut_v2);
-    mag = temp.magnitude();
-    if (mag < precision)
+  LIBRARY_API bool reg2targetRobust(vector<point> &sutPoints,
+                                    vector<point> &tarPoints,
+                                    matrix &out,
+                                    double threshold,
+                                    RegRobustMethod method,
+                                    int iterations,
+                                    vector<bool> *inliers)
+  {
+    vector<point> sample_s(3), sample_t(3);
+    vector<double> weights;
+    double h[16], best[16], r, w, change;
+    int i, it, n = (int)sutPoints.size(), count, bestCount = -1, pick[3];
+    Math::Xoshiro256 rng(0x5EED);
+
+    if (sutPoints.size() != tarPoints.size() || n < 3 || out.cols != 4 || out.rows != 4 ||
+        threshold <= 0.0)
     {
       return false;
     }
-    sut_z_hat = temp / mag;
 
-    temp = tar_x_hat.cross(tar_v2);
-    mag = temp.magnitude();
-    if (mag < precision)
+    weights.assign(n, 1.0);
+    if (method == REG_RANSAC)
     {
-      return false;
+      //! Keep the three-point fit that the most correspondences agree with
+      iterations = (iterations > 0) ? iterations : 200;
+      for (it = 0; it < iterations; ++it)
+      {
+        pick[0] = (int)rng.below(n);
+        do
+        {
+          pick[1] = (int)rng.below(n);
+        } while (pick[1] == pick[0]);
+        do
+        {
+          pick[2] = (int)rng.below(n);
+        } while (pick[2] == pick[0] || pick[2] == pick[1]);
+        for (i = 0; i < 3; ++i)
+        {
+          sample_s[i] = sutPoints[pick[i]];
+          sample_t[i] = tarPoints[pick[i]];
+        }
+        if (!fitRigid(sample_s, sample_t, NULL, h))
+        {
+          continue;
+        }
+        for (i = 0, count = 0; i < n; ++i)
+        {
+          count += (fitResidual(h, sutPoints[i], tarPoints[i]) <= threshold) ? 1 : 0;
+        }
+        if (count > bestCount)
+        {
+          bestCount = count;
+          memcpy(best, h, sizeof(best));
+        }
+      }
+      if (bestCount < 3)
+      {
+        return false;
+      }
+
+      //! Refit on the consensus set
+      for (i = 0; i < n; ++i)
+      {
+        weights[i] = (fitResidual(best, sutPoints[i], tarPoints[i]) <= threshold) ? 1.0 : 0.0;
+      }
+      if (!fitRigid(sutPoints, tarPoints, &weights[0], h))
+      {
+        memcpy(h, best, sizeof(h));
+      }
+    }
+    else
+    {
+      //! Huber weights:  full weight inside the threshold, threshold / residual beyond it
+      iterations = (iterations > 0) ? iterations : 20;
+      if (!fitRigid(sutPoints, tarPoints, NULL, h))
+      {
+        return false;
+      }
+      for (it = 0; it < iterations; ++it)
+      {
+        change = 0.0;
+        for (i = 0; i < n; ++i)
+        {
+          r = fitResidual(h, sutPoints[i], tarPoints[i]);
+          w = (r <= threshold) ? 1.0 : threshold / r;
+          change = (fabs(w - weights[i]) > change) ? fabs(w - weights[i]) : change;
+          weights[i] = w;
+        }
+        if (!fitRigid(sutPoints, tarPoints, &weights[0], h))
+        {
+          return false;
+        }
+        if (change < 1.0e-6)
+        {
+          break;
+        }
+      }
     }
-    tar_z_hat = temp / mag;
-
-    sut_y_hat = sut_x_hat.cross(sut_z_hat);
-    tar_y_hat = tar_x_hat.cross(tar_z_hat);
-
-    sut_H.at(0, 0) = sut_x_hat.x;
-    sut_H.at(1, 0) = sut_x_hat.y;
-    sut_H.at(2, 0) = sut_x_hat.z;
-    sut_H.at(0, 1) = sut_y_hat.x;
-    sut_H.at(1, 1) = sut_y_hat.y;
-    sut_H.at(2, 1) = sut_y_hat.z;
-    sut_H.at(0, 2) = sut_z_hat.x;
-    sut_H.at(1, 2) = sut_z_hat.y;
-    sut_H.at(2, 2) = sut_z_hat.z;
-    sut_H.at(0, 3) = sut_p[0].x;
-    sut_H.at(1, 3) = sut_p[0].y;
-    sut_H.at(2, 3) = sut_p[0].z;
-    sut_H.at(3, 3) = 1.0f;
-
-    tar_H.at(0, 0) = tar_x_hat.x;
-    tar_H.at(1, 0) = tar_x_hat.y;
-    tar_H.at(2, 0) = tar_x_hat.z;
-    tar_H.at(0, 1) = tar_y_hat.x;
-    tar_H.at(1, 1) = tar_y_hat.y;
-    tar_H.at(2, 1) = tar_y_hat.z;
-    tar_H.at(0, 2) = tar_z_hat.x;
-    tar_H.at(1, 2) = tar_z_hat.y;
-    tar_H.at(2, 2) = tar_z_hat.z;
-    tar_H.at(0, 3) = tar_p[0].x;
-    tar_H.at(1, 3) = tar_p[0].y;
-    tar_H.at(2, 3) = tar_p[0].z;
-    tar_H.at(3, 3) = 1.0f;
-
-    sut_H_inv = sut_H.inv();
-
-    out = tar_H * sut_H_inv;
 
+    if (inliers != NULL)
+    {
+      inliers->resize(n);
+      for (i = 0; i < n; ++i)
+      {
+        (*inliers)[i] = (fitResidual(h, sutPoints[i], tarPoints[i]) <= threshold);
+      }
+    }
+    storeRigid(h, out);
     return true;
   }
 
 
-  LIBRARY_API bool reg2targetML(vector<point> &sutPoints,
-                                vector<point> &tarPoints,
-                                int numRegs,
-                                vector<point> &kernels,
-                                vector<matrix> &outs)
+  //! @brief Work shared by the reg2targetML local fit threads
+  //!
+  struct localFitHandler
+  {
+    vector<point> *sutPoints;
+    vector<point> *tarPoints;
+
+    //! @brief Points nearest each cluster, and points for which it is the second nearest
+    //!
+    vector<vector<int> > members;
+    vector<vector<int> > neighbours;
+
+    //! @brief Weights of the members and neighbours (empty for equal weights)
+    //!
+    vector<vector<double> > memberWeights;
+    vector<vector<double> > neighbourWeights;
+
+    //! @brief Fit over every point (row-major 4x4, tar to sut)
+    //!
+    double global[16];
+
+    vector<matrix> *outs;
+    int numRegs;
+    int threads;
+  };
+
+
+  //! @brief Fit the local registrations id, id + threads, ...:  from the cluster's members,
+  //!        widened to its boundary neighbours and then to the whole set if they are too few
+  //!        or collinear
+  //!
+  static void localFitThread(localFitHandler *h, int id)
+  {
+    vector<point> sut, tar;
+    vector<double> weights;
+    vector<int>::iterator iter;
+    double fit[16];
+    int i, pass;
+    bool fitted, weighted = !h->memberWeights.empty();
+
+    for (i = id; i < h->numRegs; i += h->threads)
+    {
+      sut.clear();
+      tar.clear();
+      weights.clear();
+      fitted = false;
+      for (pass = 0; pass < 2 && !fitted; ++pass)
+      {
+        vector<int> &points = (pass == 0) ? h->members[i] : h->neighbours[i];
+        for (iter = points.begin(); iter != points.end(); ++iter)
+        {
+          sut.push_back(h->sutPoints->at(*iter));
+          tar.push_back(h->tarPoints->at(*iter));
+        }
+        if (weighted)
+        {
+          vector<double> &w = (pass == 0) ? h->memberWeights[i] : h->neighbourWeights[i];
+          weights.insert(weights.end(), w.begin(), w.end());
+        }
+        fitted = fitRigid(tar, sut, (weighted && !weights.empty()) ? &weights[0] : NULL, fit);
+      }
+      storeRigid(fitted ? fit : h->global, h->outs->at(i));
+    }
+  }
+
+
+  //! @brief The work of reg2targetML
+  //!
+  //! @param seed          Random number seed of the clustering (0 to seed from the clock)
+  //! @param assignment    If not NULL, filled with the nearest cluster (most responsible
+  //!                      component) of each point
+  //! @param logLikelihood If not NULL and the model is REG_MODEL_GMM, set to the mean log
+  //!                      likelihood of the points under the mixture
+  //!
+  static bool localRegistrations(vector<point> &sutPoints,
+                                 vector<point> &tarPoints,
+                                 int numRegs,
+                                 vector<point> &kernels,
+                                 vector<matrix> &outs,
+                                 int threads,
+                                 RegClusterModel model,
+                                 uint64_t seed,
+                                 vector<int> *assignment,
+                                 double *logLikelihood)
   {
-    kMeans world_clusters(3, 3, numRegs, NULL);
+    kMeans world_clusters(3, 3, numRegs, NULL, KMEANS_SEED_PLUSPLUS, KMEANS_ASSIGN_HAMERLY);
     world_clusters.setMinClusterMembers(1);
+    GaussianMixture world_mixture(3, 3, numRegs, NULL, GMM_FULL);
+    bool mixture = (model == REG_MODEL_GMM);
     int count = 0;
 
-    if (sutPoints.size() != tarPoints.size())
+    if (seed != 0)
+    {
+      world_clusters.setRandomSeed(seed);
+      world_mixture.setRandomSeed(seed);
+    }
+
+    if (sutPoints.size() != tarPoints.size() || sutPoints.size() < 3 || numRegs < 1)
     {
       return false;
     }
 
-    point  wrd, rob, centerf, centera;
-    vector<point> world;
-    vector<point> robot;
-    matrix r_2_w(4, 4), w_2_r(4, 4);
+    point centera;
 
     outs.clear();
     outs.resize(numRegs);
@@ -195,109 +487,1617 @@ namespace Registration
       cout << "Add pattern ((" << feat.at(0) << ", " << feat.at(1) << ", " << feat.at(2) << "), ("
         << attrib.at(0) << ", " << attrib.at(1) << ", " << attrib.at(2) << "}}" << endl;
 #endif
-      world_clusters.addTrainingPattern(feat, attrib);
+      if (mixture)
+      {
+        world_mixture.addTrainingPattern(feat, attrib);
+      }
+      else
+      {
+        world_clusters.addTrainingPattern(feat, attrib);
+      }
     }
 #ifdef NOISY
     cout << count << " patterns added to the collection of clusters" << endl;
     cout << "Seeding clusters" << endl;
 #endif
 
-    world_clusters.seedClusters();
-    count = 0;
-    do
+    if (mixture)
     {
-      count = world_clusters.recluster();
+      if (world_mixture.train(100, 1.0e-6, threads) < 0)
+      {
+        return false;
+      }
+#ifdef NOISY
+      cout << "Finished EM after " << world_mixture.getIterations() << " iterations with mean log likelihood "
+           << world_mixture.getLogLikelihood() << endl;
+#endif
+    }
+    else
+    {
+      world_clusters.seedClusters();
+      count = 0;
+      do
+      {
+        count = world_clusters.recluster(threads);
 #ifdef NOISY
-      cout << count << " patterns moved." << endl;
+        cout << count << " patterns moved." << endl;
 #endif
-    } while (count > 0);
+      } while (count > 0);
 
 #ifdef NOISY
-    cout << "Finished clustering." << endl;
+      cout << "Finished clustering after " << world_clusters.getIterations() << " iterations and "
+           << world_clusters.getDistanceEvaluations() << " distance evaluations." << endl;
 #endif
+    }
 
 #ifdef NOISY
     cout << "Generating robot-world registration data" << endl;
 #endif
 
+    //! Nearest and second nearest cluster of every point, from the centroid index (or the most
+    //! and second most responsible components, and their responsibilities)
+    int n = (int)sutPoints.size();
+    vector<double> positions(n * 3), firstResp, secondResp;
+    vector<int> nearest(n), second(n);
+    for (count = 0; count < n; ++count)
+    {
+      positions[(count * 3) + 0] = sutPoints[count].x;
+      positions[(count * 3) + 1] = sutPoints[count].y;
+      positions[(count * 3) + 2] = sutPoints[count].z;
+    }
+    if (mixture)
+    {
+      firstResp.resize(n);
+      secondResp.resize(n);
+      world_mixture.evalPatterns(&positions[0], n, &nearest[0], &second[0], &firstResp[0], &secondResp[0], threads);
+    }
+    else
+    {
+      world_clusters.buildIndex();
+      world_clusters.evalPatterns(&positions[0], n, &nearest[0], &second[0]);
+    }
+    if (assignment != NULL)
+    {
+      *assignment = nearest;
+    }
+    if (logLikelihood != NULL && mixture)
+    {
+      *logLikelihood = world_mixture.getLogLikelihood();
+    }
+
+    localFitHandler handler;
+    handler.sutPoints = &sutPoints;
+    handler.tarPoints = &tarPoints;
+    handler.members.resize(numRegs);
+    handler.neighbours.resize(numRegs);
+    handler.outs = &outs;
+    if (mixture)
+    {
+      handler.memberWeights.resize(numRegs);
+      handler.neighbourWeights.resize(numRegs);
+    }
+    for (count = 0; count < n; ++count)
+    {
+      handler.members[nearest[count]].push_back(count);
+      if (mixture)
+      {
+        handler.memberWeights[nearest[count]].push_back(firstResp[count]);
+      }
+      if (second[count] >= 0)
+      {
+        handler.neighbours[second[count]].push_back(count);
+        if (mixture)
+        {
+          handler.neighbourWeights[second[count]].push_back(secondResp[count]);
+        }
+      }
+    }
+
+    //! Whole-set fit, for clusters whose points alone do not fix a registration
+    if (!fitRigid(tarPoints, sutPoints, NULL, handler.global))
+    {
+      return false;
+    }
+
     kernels.clear();
     for (int i = 0; i < numRegs; ++i)
     {
-      world_clusters.getClusterInfo(i, feat, attrib);
+      if (mixture)
+      {
+        vector<double> covariance;
+        double weight;
+        world_mixture.getComponentInfo(i, weight, feat, covariance, attrib);
+      }
+      else
+      {
+        world_clusters.getClusterInfo(i, feat, attrib);
+      }
 #ifdef NOISY
       cout << "Cluster data: " << i << " ((" << feat.at(0) << ", " << feat.at(1) << ", " << feat.at(2) << "), ("
         << attrib.at(0) << ", " << attrib.at(1) << ", " << attrib.at(2) << ")) with "
-        << world_clusters.getClusters().at(i).size() << " members" << endl;
+        << handler.members[i].size() << " members" << endl;
 #endif
-      centerf.x = feat.at(0);
-      centerf.y = feat.at(1);
-      centerf.z = feat.at(2);
       centera.x = attrib.at(0);
       centera.y = attrib.at(1);
       centera.z = attrib.at(2);
       kernels.push_back(centera);
+    }
 
-#ifdef NOISY
-      for (int j = 0; j < truth.size(); ++j)
+    //! Local fits are independent of each other
+    handler.numRegs = numRegs;
+    if (threads < 1)
+    {
+      threads = (int)thread::hardware_concurrency();
+    }
+    threads = (threads < 1) ? 1 : threads;
+    handler.threads = (threads < numRegs) ? threads : numRegs;
+    if (handler.threads < 2)
+    {
+      localFitThread(&handler, 0);
+    }
+    else
+    {
+      vector<thread> workers;
+      for (count = 0; count < handler.threads; ++count)
+      {
+        workers.push_back(thread(localFitThread, &handler, count));
+      }
+      for (count = 0; count < handler.threads; ++count)
+      {
+        workers[count].join();
+      }
+    }
+
+    return true;
+  }
+
+
+  LIBRARY_API bool reg2targetML(vector<point> &sutPoints,
+                                vector<point> &tarPoints,
+                                int numRegs,
+                                vector<point> &kernels,
+                                vector<matrix> &outs,
+                                int threads,
+                                RegClusterModel model)
+  {
+    return localRegistrations(sutPoints, tarPoints, numRegs, kernels, outs, threads, model, 0, NULL, NULL);
+  }
+
+
+  //! @brief Mean silhouette of a clustering:  for each point, (b - a) / max(a, b) with a its mean
+  //!        distance to the rest of its cluster and b its mean distance to the nearest other
+  //!        cluster.  Measured over every point, or an even sample of REG_SILHOUETTE_SAMPLE of
+  //!        them against every point, which keeps large sets linear in the number of points.
+  //!
+  static double meanSilhouette(const vector<point> &points, const vector<int> &cluster, int numRegs)
+  {
+    vector<double> sum(numRegs);
+    vector<int> size(numRegs, 0);
+    double a, b, dx, dy, dz, total = 0.0;
+    int i, j, c, own, count = 0, n = (int)points.size();
+    int stride = (n + REG_SILHOUETTE_SAMPLE - 1) / REG_SILHOUETTE_SAMPLE;
+
+    if (numRegs < 2 || n < 2)
+    {
+      return 0.0;
+    }
+    for (i = 0; i < n; ++i)
+    {
+      ++size[cluster[i]];
+    }
+    for (i = 0; i < n; i += stride, ++count)
+    {
+      own = cluster[i];
+      if (size[own] < 2)
       {
-        feat.at(0) = sutPoints.at(j).x;
-        feat.at(1) = sutPoints.at(j).y;
-        feat.at(2) = sutPoints.at(j).z;
-        attrib.at(0) = tarPoints.at(j).x;
-        attrib.at(1) = tarPoints.at(j).y;
-        attrib.at(2) = tarPoints.at(j).z;
-        if (world_clusters.getClusters().closestCluster(feat) == i)
+        //! A point alone in its cluster scores 0
+        continue;
+      }
+      for (c = 0; c < numRegs; ++c)
+      {
+        sum[c] = 0.0;
+      }
+      for (j = 0; j < n; ++j)
+      {
+        dx = points[j].x - points[i].x;
+        dy = points[j].y - points[i].y;
+        dz = points[j].z - points[i].z;
+        sum[cluster[j]] += sqrt((dx * dx) + (dy * dy) + (dz * dz));
+      }
+      a = sum[own] / (size[own] - 1);
+      b = HUGE_VAL;
+      for (c = 0; c < numRegs; ++c)
+      {
+        if (c != own && size[c] > 0 && (sum[c] / size[c]) < b)
         {
-          cout << "  Member : ((" << feat.at(0) << ", " << feat.at(1) << ", " << feat.at(2) << "), ("
-            << attrib.at(0) << ", " << attrib.at(1) << ", " << attrib.at(2) << "))" << endl;
+          b = sum[c] / size[c];
         }
-      } // for (int j = 0; j < truth.size(); ++j)
-      cout << endl;
-#endif
-      world.clear();
-      robot.clear();
-      world.resize(3);
-      robot.resize(3);
+      }
+      if (b < HUGE_VAL && (a > 0.0 || b > 0.0))
+      {
+        total += (b - a) / ((a > b) ? a : b);
+      }
+    }
+    return total / count;
+  }
 
-      outs.at(i).setAll(0.0f);
 
-      world.at(0) = centera;
-      robot.at(0) = centerf;
-      count = 0;
-      for (int j = 0; j < tarPoints.size(); ++j)
-      {
-        wrd.x = tarPoints.at(j).x;
-        wrd.y = tarPoints.at(j).y;
-        wrd.z = tarPoints.at(j).z;
-        world.at(1) = wrd;
-        rob.x = sutPoints.at(j).x;
-        rob.y = sutPoints.at(j).y;
-        rob.z = sutPoints.at(j).z;
-        robot.at(1) = rob;
-
-        for (int k = j + 1; k < tarPoints.size(); ++k)
-        {
-          wrd.x = tarPoints.at(k).x;
-          wrd.y = tarPoints.at(k).y;
-          wrd.z = tarPoints.at(k).z;
-          world.at(2) = wrd;
-          rob.x = sutPoints.at(k).x;
-          rob.y = sutPoints.at(k).y;
-          rob.z = sutPoints.at(k).z;
-          robot.at(2) = rob;
-
-          if (reg2target(robot, world, r_2_w))
+  //! @brief Work shared by the reg2targetMLSelect jobs:  one for each fold of each candidate,
+  //!        and one fitting each candidate to every point
+  //!
+  struct modelSelectHandler
+  {
+    vector<point> *sutPoints;
+    vector<point> *tarPoints;
+    RegClusterModel model;
+    int minRegs;
+    int folds;
+
+    //! @brief Fold of each point
+    //!
+    vector<int> fold;
+
+    //! @brief Sum of the squared held-out errors, and the number of points held out, of each
+    //!        fold of each candidate (candidate * folds + fold)
+    //!
+    vector<double> squared;
+    vector<int> heldOut;
+
+    //! @brief Whether each job succeeded (candidate * (folds + 1) + fold, the last for every point)
+    //!
+    vector<char> fitted;
+
+    //! @brief Each candidate fitted to every point, with its silhouette and BIC
+    //!
+    vector<vector<point> > kernels;
+    vector<vector<matrix> > outs;
+    vector<double> silhouette;
+    vector<double> bic;
+  };
+
+
+  //! @brief Run reg2targetMLSelect jobs first to last - 1.  Each is one clustering fitted on one
+  //!        thread, so the pool is kept busy by running the jobs side by side.
+  //!
+  static void modelSelectJobs(ulapi_integer first, ulapi_integer last, void *arg)
+  {
+    modelSelectHandler *h = (modelSelectHandler *)arg;
+    vector<point> sut, tar, kernels;
+    vector<matrix> outs;
+    vector<int> assignment;
+    double fit[16], ll, dx, dy, dz, d, nearest;
+    int job, candidate, fold, numRegs, i, j, best, n = (int)h->sutPoints->size();
+
+    for (job = (int)first; job < (int)last; ++job)
+    {
+      candidate = job / (h->folds + 1);
+      fold = job % (h->folds + 1);
+      numRegs = h->minRegs + candidate;
+
+      if (fold == h->folds)
+      {
+        //! Every point:  the registrations returned if the candidate is chosen
+        ll = 0.0;
+        if (n < (2 * numRegs) ||
+            !localRegistrations(*h->sutPoints, *h->tarPoints, numRegs, h->kernels[candidate],
+                                h->outs[candidate], 1, h->model, 0x5EED + candidate, &assignment, &ll))
+        {
+          continue;
+        }
+        h->silhouette[candidate] = meanSilhouette(*h->sutPoints, assignment, numRegs);
+        if (h->model == REG_MODEL_GMM)
+        {
+          //! Full covariance mixture in three dimensions:  a mean and six covariance terms per
+          //! component, and all but one of the weights
+          h->bic[candidate] = (-2.0 * n * ll) + (((10.0 * numRegs) - 1.0) * log((double)n));
+        }
+        h->fitted[job] = 1;
+        continue;
+      }
+
+      sut.clear();
+      tar.clear();
+      for (i = 0; i < n; ++i)
+      {
+        if (h->fold[i] != fold)
+        {
+          sut.push_back(h->sutPoints->at(i));
+          tar.push_back(h->tarPoints->at(i));
+        }
+      }
+      if ((int)sut.size() < (2 * numRegs) ||
+          !localRegistrations(sut, tar, numRegs, kernels, outs, 1, h->model, 0x5EED + candidate, NULL, NULL))
+      {
+        continue;
+      }
+
+      //! Held-out points, mapped from the target frame by the registration of the nearest kernel
+      for (i = 0; i < n; ++i)
+      {
+        if (h->fold[i] != fold)
+        {
+          continue;
+        }
+        point &t = h->tarPoints->at(i);
+        best = 0;
+        nearest = HUGE_VAL;
+        for (j = 0; j < numRegs; ++j)
+        {
+          dx = kernels[j].x - t.x;
+          dy = kernels[j].y - t.y;
+          dz = kernels[j].z - t.z;
+          d = (dx * dx) + (dy * dy) + (dz * dz);
+          if (d < nearest)
           {
-            w_2_r = r_2_w.inv();
-            outs.at(i) = outs.at(i) + w_2_r;
-            ++count;
+            nearest = d;
+            best = j;
           }
-        } // for (int k = j + 1; k < truth.size(); ++k)
-      } // for (int j = 0; j < truth.size(); ++j)
-      outs.at(i) = outs.at(i) / count;
-    } // for (int i = 0; i < numRegs; ++i)
-
-    return true;
+        }
+        for (j = 0; j < 16; ++j)
+        {
+          fit[j] = outs[best].at(j / 4, j % 4);
+        }
+        d = fitResidual(fit, t, h->sutPoints->at(i));
+        h->squared[(candidate * h->folds) + fold] += d * d;
+        ++h->heldOut[(candidate * h->folds) + fold];
+      }
+      h->fitted[job] = 1;
+    }
   }
 
+
+  LIBRARY_API bool reg2targetMLSelect(vector<point> &sutPoints,
+                                      vector<point> &tarPoints,
+                                      int minRegs,
+                                      int maxRegs,
+                                      int &numRegs,
+                                      vector<point> &kernels,
+                                      vector<matrix> &sut_2_tar,
+                                      RegClusterModel model,
+                                      RegSelectCriterion criterion,
+                                      int folds,
+                                      vector<RegModelScore> *scores)
+  {
+    modelSelectHandler handler;
+    vector<int> order;
+    vector<RegModelScore> results;
+    Math::Xoshiro256 rng(0x5EED);
+    double squared, score, bestScore = HUGE_VAL;
+    int i, j, f, held, candidates, best = -1, n = (int)sutPoints.size();
+
+    minRegs = (minRegs < 1) ? 1 : minRegs;
+    if (sutPoints.size() != tarPoints.size() || n < 3 || maxRegs < minRegs ||
+        (criterion == REG_SELECT_BIC && model != REG_MODEL_GMM) ||
+        (criterion == REG_SELECT_HOLDOUT && folds < 2))
+    {
+      return false;
+    }
+    folds = (folds < 0) ? 0 : ((folds == 1) ? 2 : ((folds > n) ? n : folds));
+    candidates = maxRegs - minRegs + 1;
+
+    //! Points are dealt into the folds in a fixed random order
+    handler.sutPoints = &sutPoints;
+    handler.tarPoints = &tarPoints;
+    handler.model = model;
+    handler.minRegs = minRegs;
+    handler.folds = folds;
+    handler.fold.resize(n);
+    order.resize(n);
+    for (i = 0; i < n; ++i)
+    {
+      order[i] = i;
+    }
+    for (i = n - 1; i > 0; --i)
+    {
+      j = (int)rng.below(i + 1);
+      f = order[i];
+      order[i] = order[j];
+      order[j] = f;
+    }
+    for (i = 0; i < n; ++i)
+    {
+      handler.fold[order[i]] = (folds > 0) ? (i % folds) : 0;
+    }
+    handler.squared.assign(candidates * folds, 0.0);
+    handler.heldOut.assign(candidates * folds, 0);
+    handler.fitted.assign(candidates * (folds + 1), 0);
+    handler.kernels.resize(candidates);
+    handler.outs.resize(candidates);
+    handler.silhouette.assign(candidates, 0.0);
+    handler.bic.assign(candidates, HUGE_VAL);
+
+    //! Every fold of every candidate at once, one job at a time per worker
+    if (ulapi_parallel_for(NULL, 0, candidates * (folds + 1), 1, modelSelectJobs, &handler) != ULAPI_OK)
+    {
+      return false;
+    }
+
+    for (i = 0; i < candidates; ++i)
+    {
+      RegModelScore result;
+      result.numRegs = minRegs + i;
+      result.silhouette = handler.silhouette[i];
+      result.bic = handler.bic[i];
+      result.valid = true;
+      squared = 0.0;
+      held = 0;
+      for (f = 0; f <= folds; ++f)
+      {
+        result.valid = result.valid && (handler.fitted[(i * (folds + 1)) + f] != 0);
+      }
+      for (f = 0; f < folds; ++f)
+      {
+        squared += handler.squared[(i * folds) + f];
+        held += handler.heldOut[(i * folds) + f];
+      }
+      result.holdout = (held > 0) ? sqrt(squared / held) : HUGE_VAL;
+      results.push_back(result);
+
+      if (!result.valid)
+      {
+        continue;
+      }
+      score = (criterion == REG_SELECT_HOLDOUT) ? result.holdout :
+              ((criterion == REG_SELECT_SILHOUETTE) ? -result.silhouette : result.bic);
+      if (best < 0 || score < bestScore)
+      {
+        best = i;
+        bestScore = score;
+      }
+    }
+
+    if (scores != NULL)
+    {
+      *scores = results;
+    }
+    if (best < 0)
+    {
+      return false;
+    }
+    numRegs = minRegs + best;
+    kernels = handler.kernels[best];
+    sut_2_tar = handler.outs[best];
+    return true;
+  }
+
+
+  LIBRARY_API void buildKernelIndex(vector<point> &kernels, KDTree &index)
+  {
+    vector<double> centers;
+    vector<point>::iterator iter;
+
+    for (iter = kernels.begin(); iter != kernels.end(); ++iter)
+    {
+      centers.push_back(iter->x);
+      centers.push_back(iter->y);
+      centers.push_back(iter->z);
+    }
+    index.build(centers.empty() ? NULL : &centers[0], (int)kernels.size(), 3);
+  }
+
+
+  LIBRARY_API int nearestKernel(KDTree &index,
+                                point &query,
+                                int *second,
+                                double *dist,
+                                double *secondDist)
+  {
+    double pos[3] = {query.x, query.y, query.z};
+    int other, first;
+
+    if (second == NULL && secondDist == NULL)
+    {
+      return index.nearest(pos, dist);
+    }
+    first = index.nearestTwo(pos, other, dist, secondDist);
+    if (second != NULL)
+    {
+      *second = other;
+    }
+    return first;
+  }
+
+  //! @brief One motion (or pose pair) of a hand-eye calibration:  AX = XB (or YB), with the
+  //!        rotations row-major
+  //!
+  struct handEyeMotion
+  {
+    quaternion qa;
+    quaternion qb;
+    double ra[9];
+    double ta[3];
+    double rb[9];
+    double tb[3];
+  };
+
+
+  //! @brief Row-major rotation matrix of a unit quaternion
+  //!
+  static void quaternionRotation(const quaternion &q, double *r)
+  {
+    r[0] = 1.0 - 2.0 * ((q.y * q.y) + (q.z * q.z));
+    r[1] = 2.0 * ((q.x * q.y) - (q.w * q.z));
+    r[2] = 2.0 * ((q.x * q.z) + (q.w * q.y));
+    r[3] = 2.0 * ((q.x * q.y) + (q.w * q.z));
+    r[4] = 1.0 - 2.0 * ((q.x * q.x) + (q.z * q.z));
+    r[5] = 2.0 * ((q.y * q.z) - (q.w * q.x));
+    r[6] = 2.0 * ((q.x * q.z) - (q.w * q.y));
+    r[7] = 2.0 * ((q.y * q.z) + (q.w * q.x));
+    r[8] = 1.0 - 2.0 * ((q.x * q.x) + (q.y * q.y));
+  }
+
+
+  //! @brief Store a motion, with its quaternions on the w >= 0 hemisphere
+  //!
+  static handEyeMotion makeMotion(const qpose &a, const qpose &b)
+  {
+    handEyeMotion m;
+
+    m.qa = a.orientation;
+    m.qb = b.orientation;
+    m.qa.normalize();
+    m.qb.normalize();
+    if (m.qa.w < 0.0)
+    {
+      m.qa = quaternion(-m.qa.w, -m.qa.x, -m.qa.y, -m.qa.z);
+    }
+    if (m.qb.w < 0.0)
+    {
+      m.qb = quaternion(-m.qb.w, -m.qb.x, -m.qb.y, -m.qb.z);
+    }
+    quaternionRotation(m.qa, m.ra);
+    quaternionRotation(m.qb, m.rb);
+    m.ta[0] = a.position.x;
+    m.ta[1] = a.position.y;
+    m.ta[2] = a.position.z;
+    m.tb[0] = b.position.x;
+    m.tb[1] = b.position.y;
+    m.tb[2] = b.position.z;
+    return m;
+  }
+
+
+  //! @brief Sum of per-item contributions over count items:  add(i, sum) adds item i's width
+  //!        values to sum.  Items are split into contiguous ranges, one per thread, each summed
+  //!        into its own buffer, and the buffers are added in order, so the result does not
+  //!        depend on scheduling.
+  //!
+  template <class F> static void parallelSum(int count, int threads, int width, F add, double *sum)
+  {
+    int t, i;
+
+    if (threads < 1)
+    {
+      threads = (int)thread::hardware_concurrency();
+    }
+
+    //! Small sets are not worth a thread
+    threads = (threads > count / 256) ? count / 256 : threads;
+    threads = (threads < 1) ? 1 : threads;
+
+    vector<double> partial(threads * width, 0.0);
+    auto work = [&] (int id)
+    {
+      int last = (int)(((long long)count * (id + 1)) / threads);
+      for (int k = (int)(((long long)count * id) / threads); k < last; ++k)
+      {
+        add(k, &partial[id * width]);
+      }
+    };
+
+    if (threads < 2)
+    {
+      work(0);
+    }
+    else
+    {
+      vector<thread> workers;
+      for (t = 0; t < threads; ++t)
+      {
+        workers.push_back(thread(work, t));
+      }
+      for (t = 0; t < threads; ++t)
+      {
+        workers[t].join();
+      }
+    }
+
+    for (i = 0; i < width; ++i)
+    {
+      sum[i] = 0.0;
+      for (t = 0; t < threads; ++t)
+      {
+        sum[i] += partial[(t * width) + i];
+      }
+    }
+  }
+
+
+  //! @brief Solve A x = b in place for symmetric positive definite A (n x n, row-major) by
+  //!        Cholesky factorization
+  //!
+  //! @return False if A is not (numerically) positive definite
+  //!
+  static bool solveSPD(double *A, double *b, int n)
+  {
+    int i, j, k;
+    double s, scale = 0.0;
+
+    for (i = 0; i < n; ++i)
+    {
+      scale = (A[(i * n) + i] > scale) ? A[(i * n) + i] : scale;
+    }
+    for (j = 0; j < n; ++j)
+    {
+      s = A[(j * n) + j];
+      for (k = 0; k < j; ++k)
+      {
+        s -= A[(j * n) + k] * A[(j * n) + k];
+      }
+      if (s <= 1.0e-12 * scale)
+      {
+        return false;
+      }
+      A[(j * n) + j] = sqrt(s);
+      for (i = j + 1; i < n; ++i)
+      {
+        s = A[(i * n) + j];
+        for (k = 0; k < j; ++k)
+        {
+          s -= A[(i * n) + k] * A[(j * n) + k];
+        }
+        A[(i * n) + j] = s / A[(j * n) + j];
+      }
+    }
+    for (i = 0; i < n; ++i)
+    {
+      for (k = 0; k < i; ++k)
+      {
+        b[i] -= A[(i * n) + k] * b[k];
+      }
+      b[i] /= A[(i * n) + i];
+    }
+    for (i = n - 1; i >= 0; --i)
+    {
+      for (k = i + 1; k < n; ++k)
+      {
+        b[i] -= A[(k * n) + i] * b[k];
+      }
+      b[i] /= A[(i * n) + i];
+    }
+    return true;
+  }
+
+
+  //! @brief Add the rows of a small least squares problem (rows x cols, row-major J and r) to
+  //!        its normal equations:  sum[0 .. cols^2) += J'J, sum[cols^2 ..) += J'r
+  //!
+  static void addNormal(const double *J, const double *r, int rows, int cols, double *sum)
+  {
+    int i, j, k;
+
+    for (k = 0; k < rows; ++k)
+    {
+      for (i = 0; i < cols; ++i)
+      {
+        if (J[(k * cols) + i] == 0.0)
+        {
+          continue;
+        }
+        for (j = 0; j < cols; ++j)
+        {
+          sum[(i * cols) + j] += J[(k * cols) + i] * J[(k * cols) + j];
+        }
+        sum[(cols * cols) + i] += J[(k * cols) + i] * r[k];
+      }
+    }
+  }
+
+
+  //! @brief Skew-symmetric (cross product) matrix of v, into a 3x3 block of a row-major matrix
+  //!        with the given row stride
+  //!
+  static void skew(const double *v, double *out, int stride, double sign = 1.0)
+  {
+    out[0] = 0.0;
+    out[1] = -sign * v[2];
+    out[2] = sign * v[1];
+    out[stride] = sign * v[2];
+    out[stride + 1] = 0.0;
+    out[stride + 2] = -sign * v[0];
+    out[(2 * stride)] = -sign * v[1];
+    out[(2 * stride) + 1] = sign * v[0];
+    out[(2 * stride) + 2] = 0.0;
+  }
+
+
+  //! @brief Relative motions for AX = XB:  between consecutive poses and between poses half
+  //!        the set apart
+  //!
+  static bool handEyeMotions(const vector<qpose> &robotPoses,
+                             const vector<qpose> &sensorPoses,
+                             vector<handEyeMotion> &motions)
+  {
+    int n = (int)robotPoses.size(), half = n / 2, i;
+
+    motions.clear();
+    if (n < 3 || sensorPoses.size() != robotPoses.size())
+    {
+      return false;
+    }
+    motions.reserve(2 * n);
+    for (i = 0; i < n; ++i)
+    {
+      //! Pi X Si = Pj X Sj, so (Pj' Pi) X = X (Sj Si')
+      if (i + 1 < n)
+      {
+        motions.push_back(makeMotion(robotPoses[i + 1].inverse() * robotPoses[i],
+                                     sensorPoses[i + 1] * sensorPoses[i].inverse()));
+      }
+      if (half > 1 && i + half < n)
+      {
+        motions.push_back(makeMotion(robotPoses[i + half].inverse() * robotPoses[i],
+                                     sensorPoses[i + half] * sensorPoses[i].inverse()));
+      }
+    }
+    return true;
+  }
+
+
+  //! @brief Rotation of X by Tsai-Lenz:  skew(Pa + Pb) Px' = Pb - Pa for the modified Rodrigues
+  //!        vectors P = 2 sin(angle / 2) axis
+  //!
+  static bool tsaiRotation(const vector<handEyeMotion> &motions, int threads, quaternion &qx)
+  {
+    double sum[12], A[9], b[3], n2, k;
+
+    parallelSum((int)motions.size(), threads, 12, [&] (int i, double *acc)
+    {
+      const handEyeMotion &m = motions[i];
+      double pa[3] = {2.0 * m.qa.x, 2.0 * m.qa.y, 2.0 * m.qa.z};
+      double pb[3] = {2.0 * m.qb.x, 2.0 * m.qb.y, 2.0 * m.qb.z};
+      double s[3] = {pa[0] + pb[0], pa[1] + pb[1], pa[2] + pb[2]};
+      double J[9], r[3] = {pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2]};
+      skew(s, J, 3);
+      addNormal(J, r, 3, 3, acc);
+    }, sum);
+
+    memcpy(A, sum, sizeof(A));
+    memcpy(b, sum + 9, sizeof(b));
+    if (!solveSPD(A, b, 3))
+    {
+      return false;
+    }
+
+    //! Px = 2 Px' / sqrt(1 + |Px'|^2), and Px / 2 is the vector part of qx
+    n2 = (b[0] * b[0]) + (b[1] * b[1]) + (b[2] * b[2]);
+    k = 1.0 / sqrt(1.0 + n2);
+    qx = quaternion(sqrt(1.0 - (n2 * k * k)), b[0] * k, b[1] * k, b[2] * k);
+    qx.normalize();
+    return true;
+  }
+
+
+  //! @brief Rotation of X by Park-Martin:  the rotation taking log(Rb) onto log(Ra), fit over
+  //!        every motion as in fitRigid
+  //!
+  static bool parkRotation(const vector<handEyeMotion> &motions, int threads, quaternion &qx)
+  {
+    double cross[9], u[9], sv[3], v[9], r[9], det;
+    int j, k;
+    Mat<3, 3> m;
+
+    parallelSum((int)motions.size(), threads, 9, [&] (int i, double *acc)
+    {
+      quaternion la = quaternionLog(motions[i].qa), lb = quaternionLog(motions[i].qb);
+      double a[3] = {la.x, la.y, la.z}, b[3] = {lb.x, lb.y, lb.z};
+      for (int p = 0; p < 3; ++p)
+      {
+        for (int q = 0; q < 3; ++q)
+        {
+          acc[(p * 3) + q] += b[p] * a[q];
+        }
+      }
+    }, cross);
+
+    svd3(cross, u, sv, v);
+    if (sv[0] <= 0.0 || sv[1] <= (1.0e-9 * sv[0]))
+    {
+      //! Every motion rotates about the same axis
+      return false;
+    }
+    det = (u[0] * ((u[4] * u[8]) - (u[5] * u[7]))) - (u[1] * ((u[3] * u[8]) - (u[5] * u[6]))) +
+          (u[2] * ((u[3] * u[7]) - (u[4] * u[6])));
+    det *= (v[0] * ((v[4] * v[8]) - (v[5] * v[7]))) - (v[1] * ((v[3] * v[8]) - (v[5] * v[6]))) +
+           (v[2] * ((v[3] * v[7]) - (v[4] * v[6])));
+    for (j = 0; j < 3; ++j)
+    {
+      for (k = 0; k < 3; ++k)
+      {
+        r[(j * 3) + k] = (v[(j * 3) + 0] * u[(k * 3) + 0]) + (v[(j * 3) + 1] * u[(k * 3) + 1]) +
+                         (((det < 0.0) ? -1.0 : 1.0) * v[(j * 3) + 2] * u[(k * 3) + 2]);
+        m.at(j, k) = r[(j * 3) + k];
+      }
+    }
+    qx = matrixToQuaternion(m);
+    qx.normalize();
+    return true;
+  }
+
+
+  //! @brief Translation of X given its rotation:  (Ra - I) tx = Rx tb - ta
+  //!
+  static bool handEyeTranslation(const vector<handEyeMotion> &motions, int threads,
+                                 const quaternion &qx, double *tx)
+  {
+    double rx[9], sum[12];
+
+    quaternionRotation(qx, rx);
+    parallelSum((int)motions.size(), threads, 12, [&] (int i, double *acc)
+    {
+      const handEyeMotion &m = motions[i];
+      double J[9], r[3];
+      for (int p = 0; p < 3; ++p)
+      {
+        for (int q = 0; q < 3; ++q)
+        {
+          J[(p * 3) + q] = m.ra[(p * 3) + q] - ((p == q) ? 1.0 : 0.0);
+        }
+        r[p] = (rx[p * 3] * m.tb[0]) + (rx[(p * 3) + 1] * m.tb[1]) + (rx[(p * 3) + 2] * m.tb[2]) - m.ta[p];
+      }
+      addNormal(J, r, 3, 3, acc);
+    }, sum);
+
+    memcpy(tx, sum + 9, 3 * sizeof(double));
+    return solveSPD(sum, tx, 3);
+  }
+
+
+  //! @brief Residual of one motion for AX = YB (AX = XB when y is x):  rotation
+  //!        Ra Rx - Ry Rb (9 values, scaled by weight) and translation Ra tx + ta - Ry tb - ty
+  //!
+  static void handEyeResidual(const handEyeMotion &m, const double *rx, const double *tx,
+                              const double *ry, const double *ty, double weight, double *r)
+  {
+    int p, q, k;
+
+    for (p = 0; p < 3; ++p)
+    {
+      for (q = 0; q < 3; ++q)
+      {
+        double s = 0.0;
+        for (k = 0; k < 3; ++k)
+        {
+          s += (m.ra[(p * 3) + k] * rx[(k * 3) + q]) - (ry[(p * 3) + k] * m.rb[(k * 3) + q]);
+        }
+        r[(p * 3) + q] = weight * s;
+      }
+      r[9 + p] = m.ta[p] - ty[p];
+      for (k = 0; k < 3; ++k)
+      {
+        r[9 + p] += (m.ra[(p * 3) + k] * tx[k]) - (ry[(p * 3) + k] * m.tb[k]);
+      }
+    }
+  }
+
+
+  //! @brief Jacobian of handEyeResidual (12 rows, row-major) with respect to a rotation
+  //!        perturbation of X (dx, left-multiplied) and tx, and, when ry is not fixed to rx, of Y
+  //!        (dy) and ty.  cols is 6 for AX = XB and 12 for AX = YB.
+  //!
+  static void handEyeJacobian(const handEyeMotion &m, const double *rx, const double *ry,
+                              const double *tb, double weight, int cols, double *J)
+  {
+    double col[3], rycol[3], ryb[9], t[3], S[9];
+    int p, q, c, k;
+
+    memset(J, 0, 12 * cols * sizeof(double));
+
+    //! Ry Rb, whose columns move with Y (with X when cols is 6)
+    for (p = 0; p < 3; ++p)
+    {
+      for (q = 0; q < 3; ++q)
+      {
+        ryb[(p * 3) + q] = (ry[p * 3] * m.rb[q]) + (ry[(p * 3) + 1] * m.rb[3 + q]) + (ry[(p * 3) + 2] * m.rb[6 + q]);
+      }
+    }
+
+    for (c = 0; c < 3; ++c)
+    {
+      //! Column c of the rotation residual (rows c, 3 + c, 6 + c):  d(Ra Rx) = -Ra [xc] dx and
+      //! d(-Ry Rb) = [ybc] dy
+      col[0] = rx[c];
+      col[1] = rx[3 + c];
+      col[2] = rx[6 + c];
+      rycol[0] = ryb[c];
+      rycol[1] = ryb[3 + c];
+      rycol[2] = ryb[6 + c];
+      skew(col, S, 3);
+      for (p = 0; p < 3; ++p)
+      {
+        for (q = 0; q < 3; ++q)
+        {
+          double s = 0.0;
+          for (k = 0; k < 3; ++k)
+          {
+            s -= m.ra[(p * 3) + k] * S[(k * 3) + q];
+          }
+          J[((((p * 3) + c)) * cols) + q] = weight * s;
+        }
+      }
+      skew(rycol, S, 3);
+      for (p = 0; p < 3; ++p)
+      {
+        for (q = 0; q < 3; ++q)
+        {
+          J[((((p * 3) + c)) * cols) + ((cols == 6) ? q : (6 + q))] += weight * S[(p * 3) + q];
+        }
+      }
+    }
+
+    //! Translation rows:  d(Ra tx) = Ra dtx, d(-Ry tb) = [Ry tb] dy, d(-ty) = -dty
+    for (p = 0; p < 3; ++p)
+    {
+      t[p] = (ry[p * 3] * tb[0]) + (ry[(p * 3) + 1] * tb[1]) + (ry[(p * 3) + 2] * tb[2]);
+    }
+    skew(t, S, 3);
+    for (p = 0; p < 3; ++p)
+    {
+      for (q = 0; q < 3; ++q)
+      {
+        J[((9 + p) * cols) + 3 + q] = m.ra[(p * 3) + q] - ((cols == 6 && p == q) ? 1.0 : 0.0);
+        J[((9 + p) * cols) + ((cols == 6) ? q : (6 + q))] += S[(p * 3) + q];
+        if (cols == 12)
+        {
+          J[((9 + p) * cols) + 9 + q] = (p == q) ? -1.0 : 0.0;
+        }
+      }
+    }
+  }
+
+
+  //! @brief Apply a small rotation (rotation vector d) on the left of q
+  //!
+  static quaternion rotateBy(const quaternion &q, const double *d)
+  {
+    quaternion out = quaternionExp(quaternion(0.0, d[0] / 2.0, d[1] / 2.0, d[2] / 2.0)) * q;
+    out.normalize();
+    return out;
+  }
+
+
+  //! @brief Gauss-Newton refinement of AX = YB (AX = XB when world is false) over every motion
+  //!
+  static void handEyeRefine(const vector<handEyeMotion> &motions, int threads, bool world,
+                            quaternion &qx, double *tx, quaternion &qy, double *ty)
+  {
+    int cols = world ? 12 : 6, width = (cols * cols) + cols, it, i;
+    double rx[9], ry[9], weight = 0.0, step[12];
+    vector<double> sum(width);
+
+    //! Rotation residuals weighted by the motions' typical translation, so that both are in
+    //! pose units
+    for (i = 0; i < (int)motions.size(); ++i)
+    {
+      weight += (motions[i].ta[0] * motions[i].ta[0]) + (motions[i].ta[1] * motions[i].ta[1]) +
+                (motions[i].ta[2] * motions[i].ta[2]);
+    }
+    weight = sqrt(weight / (motions.empty() ? 1.0 : (double)motions.size()));
+    weight = (weight < 1.0) ? 1.0 : weight;
+
+    for (it = 0; it < 20; ++it)
+    {
+      quaternionRotation(qx, rx);
+      quaternionRotation(world ? qy : qx, ry);
+      parallelSum((int)motions.size(), threads, width, [&] (int k, double *acc)
+      {
+        double r[12], J[12 * 12];
+        handEyeResidual(motions[k], rx, tx, ry, world ? ty : tx, weight, r);
+        handEyeJacobian(motions[k], rx, ry, motions[k].tb, weight, cols, J);
+        addNormal(J, r, 12, cols, acc);
+      }, &sum[0]);
+
+      //! Solve (J'J) step = -J'r
+      for (i = 0; i < cols; ++i)
+      {
+        step[i] = -sum[(cols * cols) + i];
+      }
+      if (!solveSPD(&sum[0], step, cols))
+      {
+        return;
+      }
+      qx = rotateBy(qx, step);
+      tx[0] += step[3];
+      tx[1] += step[4];
+      tx[2] += step[5];
+      if (world)
+      {
+        qy = rotateBy(qy, step + 6);
+        ty[0] += step[9];
+        ty[1] += step[10];
+        ty[2] += step[11];
+      }
+
+      double norm = 0.0;
+      for (i = 0; i < cols; ++i)
+      {
+        norm += step[i] * step[i];
+      }
+      if (norm < 1.0e-18)
+      {
+        break;
+      }
+    }
+  }
+
+
+  //! @brief RMS rotation (deg) and translation errors of AX against YB
+  //!
+  static void handEyeFit(const vector<handEyeMotion> &motions, int threads, const quaternion &qx,
+                         const double *tx, const quaternion &qy, const double *ty, HandEyeResidual &out)
+  {
+    double rx[9], ry[9], sum[2];
+
+    quaternionRotation(qx, rx);
+    quaternionRotation(qy, ry);
+    parallelSum((int)motions.size(), threads, 2, [&] (int i, double *acc)
+    {
+      const handEyeMotion &m = motions[i];
+      quaternion d = (m.qa * qx).conjugate() * (qy * m.qb);
+      double r[12], w = fabs(d.w), angle;
+      handEyeResidual(m, rx, tx, ry, ty, 0.0, r);
+      angle = 2.0 * acos((w > 1.0) ? 1.0 : w);
+      acc[0] += angle * angle;
+      acc[1] += (r[9] * r[9]) + (r[10] * r[10]) + (r[11] * r[11]);
+    }, sum);
+
+    out.count = (int)motions.size();
+    out.rotation = sqrt(sum[0] / (motions.empty() ? 1.0 : (double)motions.size())) * (180.0 / 3.14159265358979323846);
+    out.translation = sqrt(sum[1] / (motions.empty() ? 1.0 : (double)motions.size()));
+  }
+
+
+  //! @brief Store a rotation and translation as a 4x4 transformation
+  //!
+  static void storePose(const quaternion &q, const double *t, matrix &out)
+  {
+    double r[9], h[16];
+    int i;
+
+    quaternionRotation(q, r);
+    for (i = 0; i < 3; ++i)
+    {
+      h[(i * 4) + 0] = r[(i * 3) + 0];
+      h[(i * 4) + 1] = r[(i * 3) + 1];
+      h[(i * 4) + 2] = r[(i * 3) + 2];
+      h[(i * 4) + 3] = t[i];
+    }
+    h[12] = h[13] = h[14] = 0.0;
+    h[15] = 1.0;
+    storeRigid(h, out);
+  }
+
+
+  LIBRARY_API bool handEye(const vector<qpose> &robotPoses,
+                           const vector<qpose> &sensorPoses,
+                           matrix &out,
+                           HandEyeMethod method,
+                           int threads,
+                           HandEyeResidual *residual)
+  {
+    vector<handEyeMotion> motions;
+    quaternion qx;
+    double tx[3];
+
+    if (out.rows != 4 || out.cols != 4 || !handEyeMotions(robotPoses, sensorPoses, motions))
+    {
+      return false;
+    }
+
+    if (!((method == HANDEYE_TSAI) ? tsaiRotation(motions, threads, qx) : parkRotation(motions, threads, qx)) ||
+        !handEyeTranslation(motions, threads, qx, tx))
+    {
+      return false;
+    }
+    if (method == HANDEYE_REFINED)
+    {
+      handEyeRefine(motions, threads, false, qx, tx, qx, tx);
+    }
+
+    if (residual != NULL)
+    {
+      handEyeFit(motions, threads, qx, tx, qx, tx, *residual);
+    }
+    storePose(qx, tx, out);
+    return true;
+  }
+
+
+  LIBRARY_API bool handEyeWorld(const vector<qpose> &robotPoses,
+                                const vector<qpose> &sensorPoses,
+                                matrix &x,
+                                matrix &y,
+                                int threads,
+                                HandEyeResidual *residual)
+  {
+    vector<handEyeMotion> motions, poses;
+    quaternion qx, qy, q;
+    double tx[3], ty[3] = {0.0, 0.0, 0.0}, sum[4] = {0.0, 0.0, 0.0, 0.0};
+    size_t i;
+
+    if (x.rows != 4 || x.cols != 4 || y.rows != 4 || y.cols != 4 ||
+        !handEyeMotions(robotPoses, sensorPoses, motions))
+    {
+      return false;
+    }
+
+    //! X from the relative motions first
+    if (!parkRotation(motions, threads, qx) || !handEyeTranslation(motions, threads, qx, tx))
+    {
+      return false;
+    }
+    handEyeRefine(motions, threads, false, qx, tx, qx, tx);
+
+    //! Then Y = Pi X Si averaged over the poses (quaternions on one hemisphere), and both refined
+    //! against Pi X = Y Si'
+    qpose xp(point(tx[0], tx[1], tx[2]), qx), yi;
+    poses.reserve(robotPoses.size());
+    for (i = 0; i < robotPoses.size(); ++i)
+    {
+      poses.push_back(makeMotion(robotPoses[i], sensorPoses[i].inverse()));
+      yi = robotPoses[i] * xp * sensorPoses[i];
+      q = yi.orientation;
+      if (i > 0 && ((q.w * sum[0]) + (q.x * sum[1]) + (q.y * sum[2]) + (q.z * sum[3])) < 0.0)
+      {
+        q = quaternion(-q.w, -q.x, -q.y, -q.z);
+      }
+      sum[0] += q.w;
+      sum[1] += q.x;
+      sum[2] += q.y;
+      sum[3] += q.z;
+      ty[0] += yi.position.x / (double)robotPoses.size();
+      ty[1] += yi.position.y / (double)robotPoses.size();
+      ty[2] += yi.position.z / (double)robotPoses.size();
+    }
+    qy = quaternion(sum[0], sum[1], sum[2], sum[3]);
+    qy.normalize();
+    handEyeRefine(poses, threads, true, qx, tx, qy, ty);
+
+    if (residual != NULL)
+    {
+      handEyeFit(poses, threads, qx, tx, qy, ty, *residual);
+    }
+    storePose(qx, tx, x);
+    storePose(qy, ty, y);
+    return true;
+  }
+
+
+  LIBRARY_API bool buildIcpTarget(const PointCloudView &tarPoints, IcpTarget &target, int neighbours)
+  {
+    int n = (int)tarPoints.size(), i, j, k, found;
+    double mean[3], cov[9], d[3], u[9], sv[3], v[9];
+    vector<int> near;
+    vector<double> dist;
+    point p;
+
+    target.points.resize(3 * n);
+    target.normals.clear();
+    for (i = 0; i < n; ++i)
+    {
+      p = tarPoints[i];
+      target.points[(3 * i) + 0] = p.x;
+      target.points[(3 * i) + 1] = p.y;
+      target.points[(3 * i) + 2] = p.z;
+    }
+    target.index.build(n > 0 ? &target.points[0] : NULL, n, 3);
+    if (n < 3)
+    {
+      return false;
+    }
+    if (neighbours < 3)
+    {
+      return true;
+    }
+
+    //! Each normal is the direction of least spread of the point's neighbourhood
+    near.resize(neighbours);
+    dist.resize(neighbours);
+    target.normals.resize(3 * n);
+    for (i = 0; i < n; ++i)
+    {
+      found = target.index.nearestK(&target.points[3 * i], neighbours, &near[0], &dist[0]);
+      mean[0] = mean[1] = mean[2] = 0.0;
+      for (k = 0; k < found; ++k)
+      {
+        for (j = 0; j < 3; ++j)
+        {
+          mean[j] += target.points[(3 * near[k]) + j] / found;
+        }
+      }
+      memset(cov, 0, sizeof(cov));
+      for (k = 0; k < found; ++k)
+      {
+        for (j = 0; j < 3; ++j)
+        {
+          d[j] = target.points[(3 * near[k]) + j] - mean[j];
+        }
+        for (j = 0; j < 9; ++j)
+        {
+          cov[j] += d[j / 3] * d[j % 3];
+        }
+      }
+      svd3(cov, u, sv, v);
+      target.normals[(3 * i) + 0] = u[2];
+      target.normals[(3 * i) + 1] = u[5];
+      target.normals[(3 * i) + 2] = u[8];
+    }
+    return true;
+  }
+
+
+  //! @brief Apply a row-major 4x4 transformation to a point
+  //!
+  static void transformPoint(const double *h, const point &in, double *out)
+  {
+    out[0] = (h[0] * in.x) + (h[1] * in.y) + (h[2] * in.z) + h[3];
+    out[1] = (h[4] * in.x) + (h[5] * in.y) + (h[6] * in.z) + h[7];
+    out[2] = (h[8] * in.x) + (h[9] * in.y) + (h[10] * in.z) + h[11];
+  }
+
+
+  LIBRARY_API bool icp(const PointCloudView &sutPoints,
+                       const IcpTarget &target,
+                       matrix &out,
+                       IcpMetric metric,
+                       double maxDistance,
+                       matrix *initial,
+                       int iterations,
+                       int threads,
+                       IcpResult *result)
+  {
+    bool plane = (metric == ICP_POINT_TO_PLANE), converged = false, evaluate = false;
+    int n = (int)sutPoints.size(), width = plane ? 44 : 17, it, i, j, k;
+    double h[16], step[16], next[16], c[3], moved[3], sums[44], limit, radius = 0.0, angle, change;
+    point mean;
+
+    if (n < 3 || target.index.size() < 3 || out.rows != 4 || out.cols != 4 ||
+        (plane && target.normals.size() != target.points.size()) ||
+        (initial != NULL && (initial->rows != 4 || initial->cols != 4)))
+    {
+      return false;
+    }
+    for (i = 0; i < 16; ++i)
+    {
+      h[i] = (initial != NULL) ? initial->at(i / 4, i % 4) : ((i % 5 == 0) ? 1.0 : 0.0);
+    }
+    limit = (maxDistance > 0.0) ? maxDistance * maxDistance : DBL_MAX;
+    iterations = (iterations > 0) ? iterations : 30;
+
+    //! Size of the source cloud, to judge when a step is negligible
+    mean = centroid(sutPoints);
+    for (i = 0; i < n; ++i)
+    {
+      point p = sutPoints[i];
+      radius += (((p.x - mean.x) * (p.x - mean.x)) + ((p.y - mean.y) * (p.y - mean.y)) +
+                 ((p.z - mean.z) * (p.z - mean.z))) / n;
+    }
+    radius = (radius > 0.0) ? sqrt(radius) : 1.0;
+
+    //! Match each transformed source point p to its nearest target point q, summing the step's
+    //! equations about the transformed centroid c to keep them well conditioned
+    auto match = [&] (int id, double *acc)
+    {
+      double p[3], a[3], b[3], J[6], r, dist;
+      int q, e, f;
+
+      transformPoint(h, sutPoints[id], p);
+      q = target.index.nearest(p, &dist);
+      if (q < 0 || dist * dist > limit)
+      {
+        return;
+      }
+      acc[0] += 1.0;
+      acc[1] += dist * dist;
+      if (evaluate)
+      {
+        return;
+      }
+      for (e = 0; e < 3; ++e)
+      {
+        a[e] = p[e] - c[e];
+        b[e] = target.points[(3 * q) + e] - c[e];
+      }
+      if (!plane)
+      {
+        for (e = 0; e < 3; ++e)
+        {
+          acc[2 + e] += a[e];
+          acc[5 + e] += b[e];
+          for (f = 0; f < 3; ++f)
+          {
+            acc[8 + (e * 3) + f] += a[e] * b[f];
+          }
+        }
+        return;
+      }
+
+      //! n . (R a + t - b) with R = I + [w]x:  residual n . (a - b), row (a x n, n)
+      const double *nq = &target.normals[3 * q];
+      J[0] = (a[1] * nq[2]) - (a[2] * nq[1]);
+      J[1] = (a[2] * nq[0]) - (a[0] * nq[2]);
+      J[2] = (a[0] * nq[1]) - (a[1] * nq[0]);
+      J[3] = nq[0];
+      J[4] = nq[1];
+      J[5] = nq[2];
+      r = (nq[0] * (a[0] - b[0])) + (nq[1] * (a[1] - b[1])) + (nq[2] * (a[2] - b[2]));
+      addNormal(J, &r, 1, 6, acc + 2);
+    };
+
+    for (it = 0; it < iterations && !converged; ++it)
+    {
+      transformPoint(h, mean, c);
+      parallelSum(n, threads, width, match, sums);
+      if (sums[0] < 3.0)
+      {
+        return false;
+      }
+
+      if (!plane)
+      {
+        if (!rigidFromSums(sums[0], sums + 2, sums + 5, sums + 8, c, c, step))
+        {
+          return false;
+        }
+        angle = ((step[0] + step[5] + step[10]) - 1.0) / 2.0;
+        angle = acos((angle > 1.0) ? 1.0 : ((angle < -1.0) ? -1.0 : angle));
+      }
+      else
+      {
+        //! (J'J) x = -J'r, lightly damped so that directions the target does not constrain
+        //! (e.g., sliding along a plane) stay where they are
+        double *JJ = sums + 2, x[6], scale = 0.0, rot[9];
+        for (j = 0; j < 6; ++j)
+        {
+          scale = (JJ[(j * 6) + j] > scale) ? JJ[(j * 6) + j] : scale;
+          x[j] = -sums[38 + j];
+        }
+        for (j = 0; j < 6; ++j)
+        {
+          JJ[(j * 6) + j] += 1.0e-9 * scale;
+        }
+        if (!solveSPD(JJ, x, 6))
+        {
+          return false;
+        }
+        angle = sqrt((x[0] * x[0]) + (x[1] * x[1]) + (x[2] * x[2]));
+        quaternionRotation(rotateBy(quaternion(1.0, 0.0, 0.0, 0.0), x), rot);
+
+        //! Rotation about c, then the translation
+        for (j = 0; j < 3; ++j)
+        {
+          step[(j * 4) + 0] = rot[(j * 3) + 0];
+          step[(j * 4) + 1] = rot[(j * 3) + 1];
+          step[(j * 4) + 2] = rot[(j * 3) + 2];
+          step[(j * 4) + 3] = c[j] + x[3 + j] -
+                              ((rot[(j * 3) + 0] * c[0]) + (rot[(j * 3) + 1] * c[1]) + (rot[(j * 3) + 2] * c[2]));
+        }
+        step[12] = step[13] = step[14] = 0.0;
+        step[15] = 1.0;
+      }
+
+      //! h = step h
+      for (j = 0; j < 4; ++j)
+      {
+        for (k = 0; k < 4; ++k)
+        {
+          next[(j * 4) + k] = (step[(j * 4) + 0] * h[k]) + (step[(j * 4) + 1] * h[4 + k]) +
+                              (step[(j * 4) + 2] * h[8 + k]) + (step[(j * 4) + 3] * h[12 + k]);
+        }
+      }
+      memcpy(h, next, sizeof(h));
+
+      //! Converged when the step moves the cloud by a negligible fraction of its size
+      transformPoint(step, point(c[0], c[1], c[2]), moved);
+      change = sqrt(((moved[0] - c[0]) * (moved[0] - c[0])) + ((moved[1] - c[1]) * (moved[1] - c[1])) +
+                    ((moved[2] - c[2]) * (moved[2] - c[2]))) + (angle * radius);
+      converged = (change < 1.0e-6 * radius);
+    }
+
+    if (result != NULL)
+    {
+      //! After a negligible last step, the last matches stand for the final transformation
+      if (!converged)
+      {
+        evaluate = true;
+        transformPoint(h, mean, c);
+        parallelSum(n, threads, 2, match, sums);
+      }
+      result->matched = (int)sums[0];
+      result->rms = (sums[0] > 0.0) ? sqrt(sums[1] / sums[0]) : 0.0;
+      result->iterations = it;
+      result->converged = converged;
+    }
+    storeRigid(h, out);
+    return true;
+  }
+
+
+  LIBRARY_API bool icp(vector<point> &sutPoints,
+                       vector<point> &tarPoints,
+                       matrix &out,
+                       IcpMetric metric,
+                       double maxDistance)
+  {
+    PointCloud sut(sutPoints), tar(tarPoints);
+    IcpTarget target;
+
+    if (!buildIcpTarget(tar, target, (metric == ICP_POINT_TO_PLANE) ? 8 : 0))
+    {
+      return false;
+    }
+    return icp(sut, target, out, metric, maxDistance);
+  }
+
+
+  LIBRARY_API OnlineRegistration::OnlineRegistration (double forgetting) :
+    forgetting_(1.0),
+    gate_(0.0)
+  {
+    setForgetting(forgetting);
+    reset();
+  }
+
+
+  LIBRARY_API OnlineRegistration::~OnlineRegistration ()
+  {
+  }
+
+
+  LIBRARY_API void OnlineRegistration::setForgetting (double forgetting)
+  {
+    forgetting_ = (forgetting > 0.0 && forgetting < 1.0) ? forgetting : 1.0;
+  }
+
+
+  LIBRARY_API void OnlineRegistration::setGate (double threshold)
+  {
+    gate_ = (threshold > 0.0) ? threshold : 0.0;
+  }
+
+
+  LIBRARY_API bool OnlineRegistration::add (const point &sut, const point &tar, double weight)
+  {
+    double a[3], b[3];
+    int j, k;
+
+    if (weight <= 0.0)
+    {
+      return false;
+    }
+    if (gate_ > 0.0 && solved_ && fitResidual(h_, sut, tar) > gate_)
+    {
+      return false;
+    }
+
+    if (count_ == 0)
+    {
+      origin_s_[0] = sut.x;
+      origin_s_[1] = sut.y;
+      origin_s_[2] = sut.z;
+      origin_t_[0] = tar.x;
+      origin_t_[1] = tar.y;
+      origin_t_[2] = tar.z;
+    }
+    a[0] = sut.x - origin_s_[0];
+    a[1] = sut.y - origin_s_[1];
+    a[2] = sut.z - origin_s_[2];
+    b[0] = tar.x - origin_t_[0];
+    b[1] = tar.y - origin_t_[1];
+    b[2] = tar.z - origin_t_[2];
+
+    //! Forget, then add
+    sum_ = (forgetting_ * sum_) + weight;
+    sqsut_ = (forgetting_ * sqsut_) + (weight * ((a[0] * a[0]) + (a[1] * a[1]) + (a[2] * a[2])));
+    sqtar_ = (forgetting_ * sqtar_) + (weight * ((b[0] * b[0]) + (b[1] * b[1]) + (b[2] * b[2])));
+    for (j = 0; j < 3; ++j)
+    {
+      ssut_[j] = (forgetting_ * ssut_[j]) + (weight * a[j]);
+      star_[j] = (forgetting_ * star_[j]) + (weight * b[j]);
+      for (k = 0; k < 3; ++k)
+      {
+        cross_[(j * 3) + k] = (forgetting_ * cross_[(j * 3) + k]) + (weight * a[j] * b[k]);
+      }
+    }
+    ++count_;
+    return true;
+  }
+
+
+  LIBRARY_API int OnlineRegistration::add (vector<point> &sutPoints, vector<point> &tarPoints)
+  {
+    size_t i;
+    int added = 0;
+
+    for (i = 0; i < sutPoints.size() && i < tarPoints.size(); ++i)
+    {
+      added += add(sutPoints[i], tarPoints[i]) ? 1 : 0;
+    }
+    return added;
+  }
+
+
+  LIBRARY_API bool OnlineRegistration::solve (matrix &out, double *rms)
+  {
+    double cross[9], h[16], ms[3], mt[3], fit;
+    int j, k;
+
+    if (count_ < 3 || out.rows != 4 || out.cols != 4)
+    {
+      return false;
+    }
+    memcpy(cross, cross_, sizeof(cross));
+    if (!rigidFromSums(sum_, ssut_, star_, cross, origin_s_, origin_t_, h))
+    {
+      return false;
+    }
+
+    if (rms != NULL)
+    {
+      //! Sum w |R (s - s_mean) - (t - t_mean)|^2 = Ss + St - 2 tr(R H), with H the (now
+      //! normalized) cross-covariance left in cross by rigidFromSums
+      fit = 0.0;
+      for (j = 0; j < 3; ++j)
+      {
+        ms[j] = ssut_[j] / sum_;
+        mt[j] = star_[j] / sum_;
+        for (k = 0; k < 3; ++k)
+        {
+          fit += h[(j * 4) + k] * cross[(k * 3) + j];
+        }
+      }
+      fit = ((sqsut_ + sqtar_) / sum_) - ((ms[0] * ms[0]) + (ms[1] * ms[1]) + (ms[2] * ms[2])) -
+            ((mt[0] * mt[0]) + (mt[1] * mt[1]) + (mt[2] * mt[2])) - (2.0 * fit);
+      *rms = (fit > 0.0) ? sqrt(fit) : 0.0;
+    }
+
+    memcpy(h_, h, sizeof(h_));
+    solved_ = true;
+    storeRigid(h, out);
+    return true;
+  }
+
+
+  LIBRARY_API void OnlineRegistration::reset ()
+  {
+    int j;
+
+    sum_ = sqsut_ = sqtar_ = 0.0;
+    for (j = 0; j < 3; ++j)
+    {
+      origin_s_[j] = origin_t_[j] = ssut_[j] = star_[j] = 0.0;
+    }
+    for (j = 0; j < 9; ++j)
+    {
+      cross_[j] = 0.0;
+    }
+    for (j = 0; j < 16; ++j)
+    {
+      h_[j] = (j % 5 == 0) ? 1.0 : 0.0;
+    }
+    count_ = 0;
+    solved_ = false;
+  }
+
+
+  LIBRARY_API int OnlineRegistration::count () const
+  {
+    return count_;
+  }
+
+
+  LIBRARY_API double OnlineRegistration::weight () const
+  {
+    return sum_;
+  }
 } // namespace Registration
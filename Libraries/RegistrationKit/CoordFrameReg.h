@@ -16,25 +16,112 @@
 
 #include "crpi.h"
 #include "MatrixMath.h"
+#include "KDTree.h"
+#include "PointCloud.h"
 #include <iostream>
 #include <vector>
 
 using namespace std;
 using namespace Math;
 
+//! Most source points over which reg2targetMLSelect measures the silhouette of a candidate
+#define REG_SILHOUETTE_SAMPLE 1000
+
 namespace Registration
 {
+  //! @brief Outlier handling used by reg2targetRobust
+  //!
+  typedef enum
+  {
+    REG_IRLS = 0,   //! Iteratively reweighted least squares with Huber weights
+    REG_RANSAC      //! Best three-point fit by inlier count, refined on its inliers
+  } RegRobustMethod;
+
+  //! @brief Clustering used by reg2targetML to localize the registrations
+  //!
+  typedef enum
+  {
+    REG_MODEL_KMEANS = 0,  //! k-means:  each point belongs to its nearest cluster
+    REG_MODEL_GMM          //! Gaussian mixture:  points are weighted by their responsibilities
+  } RegClusterModel;
+
+  //! @brief Criterion by which reg2targetMLSelect picks the number of local registrations
+  //!
+  typedef enum
+  {
+    REG_SELECT_HOLDOUT = 0, //! Lowest cross-validated (held-out) registration error
+    REG_SELECT_SILHOUETTE,  //! Highest mean silhouette of the clustering of the source points
+    REG_SELECT_BIC          //! Lowest Bayesian information criterion of the mixture (REG_MODEL_GMM)
+  } RegSelectCriterion;
+
+  //! @brief Scores of one candidate number of local registrations, from reg2targetMLSelect
+  //!
+  struct RegModelScore
+  {
+    //! @brief The number of local registrations
+    //!
+    int numRegs;
+
+    //! @brief RMS distance (source units) between each held-out source point and its target
+    //!        point under the local registration of the nearest kernel, over every fold
+    //!        (HUGE_VAL without cross-validation)
+    //!
+    double holdout;
+
+    //! @brief Mean silhouette of the clustering of every point, in [-1, 1]:  near 1 when the
+    //!        clusters are compact and well apart (0 for a single registration)
+    //!
+    double silhouette;
+
+    //! @brief BIC of the mixture fitted to every point (HUGE_VAL for REG_MODEL_KMEANS)
+    //!
+    double bic;
+
+    //! @brief Whether every fold and the fit to every point succeeded
+    //!
+    bool valid;
+  };
+
   //! @brief Calculate the homogeneous transformation matrix from one coordinate frame (sut)
-  //!        to another (tar)
+  //!        to another (tar), as the least squares rigid fit (Kabsch) over every
+  //!        correspondence
   //!
   //! @param sutPoints Collection of points from the system under test's coordinate frame
   //! @param tarPoints Collection of corresponding points from the target coordinate frame
   //! @param sut_2_tar The 4x4 transformation from sut to tar
   //!
-  //! @return True if operation completed successfully, False otherwise
+  //! @return True if operation completed successfully, False otherwise (e.g., fewer than
+  //!         three points, or the points are collinear)
   //!
   LIBRARY_API bool reg2target(vector<point> &sutPoints, vector<point> &tarPoints, matrix &out);
 
+  //! @brief As reg2target above, for points stored as coordinate arrays (e.g., PointClouds)
+  //!
+  LIBRARY_API bool reg2target(const PointCloudView &sutPoints, const PointCloudView &tarPoints, matrix &out);
+
+  //! @brief Calculate the homogeneous transformation matrix from one coordinate frame (sut)
+  //!        to another (tar) when some correspondences may be wrong
+  //!
+  //! @param sutPoints  Collection of points from the system under test's coordinate frame
+  //! @param tarPoints  Collection of corresponding points from the target coordinate frame
+  //! @param out        The 4x4 transformation from sut to tar
+  //! @param threshold  Residual distance (in target units) beyond which a correspondence is
+  //!                   treated as an outlier (the Huber constant for REG_IRLS)
+  //! @param method     REG_IRLS or REG_RANSAC
+  //! @param iterations The number of reweightings or random samples (0 for 20 and 200)
+  //! @param inliers    If not NULL, filled with whether each correspondence is within the
+  //!                   threshold of the final fit
+  //!
+  //! @return True if operation completed successfully, False otherwise
+  //!
+  LIBRARY_API bool reg2targetRobust(vector<point> &sutPoints,
+                                    vector<point> &tarPoints,
+                                    matrix &out,
+                                    double threshold,
+                                    RegRobustMethod method = REG_IRLS,
+                                    int iterations = 0,
+                                    vector<bool> *inliers = NULL);
+
   //! @brief Calculate several local homogeneous transformation matrices from one coordinate frame
   //!        (sut) to another (tar) using unsupervised machine learning (clustering)
   //!
@@ -45,14 +132,353 @@ namespace Registration
   //!                  corresponding with the registration matrices such that the closes one to a
   //!                  target location can be selected
   //! @param sut_2_tar The collection (of size numRegs) of 4x4 transformations from sut to tar
+  //! @param threads   The number of threads clustering and fitting the local registrations (0
+  //!                  for one per core)
+  //! @param model     The clustering that localizes the registrations
   //!
   //! @return True if the operation completed successfully, False otherwise
   //!
+  //! @note Each local registration is the least squares fit over the points of its cluster
+  //!       (widened to the points for which it is the second nearest cluster, and then to every
+  //!       point, when they are too few or collinear), so the work is linear in the number of
+  //!       points rather than quadratic.  With REG_MODEL_GMM a cluster is a mixture component,
+  //!       its points are those for which it is the most or second most responsible, and each
+  //!       is weighted by that responsibility, so the registrations change smoothly across
+  //!       component boundaries.
+  //!
   LIBRARY_API bool reg2targetML(vector<point> &sutPoints,
                                 vector<point> &tarPoints,
                                 int numRegs,
                                 vector<point> &kernels,
-                                vector<matrix> &sut_2_tar);
+                                vector<matrix> &sut_2_tar,
+                                int threads = 0,
+                                RegClusterModel model = REG_MODEL_KMEANS);
+
+  //! @brief As reg2targetML, choosing the number of local registrations:  every candidate is
+  //!        fitted to every point and cross-validated, all in parallel on the shared ulapi pool,
+  //!        and the best candidate's kernels and registrations are returned
+  //!
+  //! @param sutPoints Collection of points from the system under test's coordinate frame
+  //! @param tarPoints Collection of corresponding points from the target coordinate frame
+  //! @param minRegs   The fewest local registrations to try
+  //! @param maxRegs   The most local registrations to try
+  //! @param numRegs   Set to the number of local registrations chosen
+  //! @param kernels   As for reg2targetML, for the chosen number
+  //! @param sut_2_tar As for reg2targetML, for the chosen number
+  //! @param model     The clustering that localizes the registrations
+  //! @param criterion The score by which the candidates are compared
+  //! @param folds     The number of cross-validation folds (0 to skip cross-validation when the
+  //!                  criterion does not need it)
+  //! @param scores    If not NULL, filled with the scores of every candidate, fewest
+  //!                  registrations first
+  //!
+  //! @return True if the operation completed successfully, False otherwise (e.g., no candidate
+  //!         could be fitted, or REG_SELECT_BIC requested for REG_MODEL_KMEANS)
+  //!
+  //! @note A candidate is valid only if every training fold holds at least two points per
+  //!       registration.  Ties go to the fewer registrations.  The folds and the clustering
+  //!       seeds are fixed, so the same points always give the same choice.
+  //!
+  LIBRARY_API bool reg2targetMLSelect(vector<point> &sutPoints,
+                                      vector<point> &tarPoints,
+                                      int minRegs,
+                                      int maxRegs,
+                                      int &numRegs,
+                                      vector<point> &kernels,
+                                      vector<matrix> &sut_2_tar,
+                                      RegClusterModel model = REG_MODEL_KMEANS,
+                                      RegSelectCriterion criterion = REG_SELECT_HOLDOUT,
+                                      int folds = 5,
+                                      vector<RegModelScore> *scores = NULL);
+
+  //! @brief Index the kernels produced by reg2targetML so that the local registration(s) for
+  //!        each commanded position can be found without scanning every kernel
+  //!
+  //! @param kernels The spatial centers of the local registrations
+  //! @param index   The k-d tree to (re)build over the kernels
+  //!
+  LIBRARY_API void buildKernelIndex(vector<point> &kernels, KDTree &index);
+
+  //! @brief Find the kernel(s) nearest a position, e.g., to pick or blend local registrations
+  //!
+  //! @param index      A kernel index from buildKernelIndex
+  //! @param query      The position (in target coordinate space)
+  //! @param second     If not NULL, set to the second nearest kernel (-1 if there is only one)
+  //! @param dist       If not NULL, set to the distance to the nearest kernel
+  //! @param secondDist If not NULL, set to the distance to the second nearest kernel
+  //!
+  //! @return The index of the nearest kernel, or -1 if the index is empty
+  //!
+  LIBRARY_API int nearestKernel(KDTree &index,
+                                point &query,
+                                int *second = NULL,
+                                double *dist = NULL,
+                                double *secondDist = NULL);
+
+  //! @brief Solvers for hand-eye calibration
+  //!
+  typedef enum
+  {
+    HANDEYE_TSAI = 0, //! Tsai-Lenz:  rotation from modified Rodrigues vectors, then translation
+    HANDEYE_PARK,     //! Park-Martin:  rotation from the logarithms of the rotations, then translation
+    HANDEYE_REFINED   //! Park-Martin, refined by Gauss-Newton over rotation and translation together
+  } HandEyeMethod;
+
+  //! @brief Fit quality of a hand-eye calibration, over the motions (or poses) it was solved from
+  //!
+  struct HandEyeResidual
+  {
+    //! @brief RMS rotation (deg) and translation (pose units) errors of AX against XB (or YB)
+    //!
+    double rotation;
+    double translation;
+
+    //! @brief Number of motions (or poses) used
+    //!
+    int count;
+  };
+
+  //! @brief Calibrate a sensor mounted on a robot's tool (eye-in-hand) by solving AX = XB:  the
+  //!        robot's motion between two poses (A) and the sensor's apparent motion of a fixed
+  //!        target between the same two poses (B) are related by the sensor's pose on the tool
+  //!        (X)
+  //!
+  //! @param robotPoses  The robot's tool poses in its base frame
+  //! @param sensorPoses The target's pose in the sensor's frame at each robot pose
+  //! @param out         The 4x4 pose of the sensor in the tool frame
+  //! @param method      The solver
+  //! @param threads     The number of threads assembling the per-motion equations (0 for one per
+  //!                    core)
+  //! @param residual    If not NULL, populated with the fit quality
+  //!
+  //! @return True if the operation completed successfully, false otherwise (e.g., the poses
+  //!         differ in number, or every motion rotates about the same axis)
+  //!
+  //! @note Motions are taken between consecutive poses and between poses half the set apart, so
+  //!       the work is linear in the number of poses.  For a sensor fixed in the cell watching a
+  //!       target on the tool (eye-to-hand), pass the inverse robot poses; X is then the sensor's
+  //!       pose in the robot's base frame.
+  //!
+  LIBRARY_API bool handEye(const vector<qpose> &robotPoses,
+                           const vector<qpose> &sensorPoses,
+                           matrix &out,
+                           HandEyeMethod method = HANDEYE_REFINED,
+                           int threads = 0,
+                           HandEyeResidual *residual = NULL);
+
+  //! @brief Calibrate the sensor on the tool and the target in the robot's base frame together,
+  //!        by solving AX = YB with A the robot poses and B the sensor's poses in the target frame
+  //!
+  //! @param robotPoses  The robot's tool poses in its base frame
+  //! @param sensorPoses The target's pose in the sensor's frame at each robot pose
+  //! @param x           The 4x4 pose of the sensor in the tool frame
+  //! @param y           The 4x4 pose of the target in the robot's base frame
+  //! @param threads     As for handEye
+  //! @param residual    If not NULL, populated with the fit quality over the poses
+  //!
+  //! @return True if the operation completed successfully, false otherwise
+  //!
+  LIBRARY_API bool handEyeWorld(const vector<qpose> &robotPoses,
+                                const vector<qpose> &sensorPoses,
+                                matrix &x,
+                                matrix &y,
+                                int threads = 0,
+                                HandEyeResidual *residual = NULL);
+
+  //! @brief Error minimized by icp
+  //!
+  typedef enum
+  {
+    ICP_POINT_TO_POINT = 0, //! Distance to the nearest target point, with a closed-form (SVD) step
+    ICP_POINT_TO_PLANE      //! Distance to the tangent plane at the nearest target point, with a
+                            //! linearized step; fewer iterations on surfaces, but needs normals
+  } IcpMetric;
+
+  //! @brief A target cloud for icp, indexed once so that it can be registered against every frame
+  //!
+  struct IcpTarget
+  {
+    //! @brief Points and their unit surface normals, as x, y, z triples (normals is empty unless
+    //!        estimated by buildIcpTarget)
+    //!
+    vector<double> points;
+    vector<double> normals;
+
+    //! @brief Nearest neighbour index over the points
+    //!
+    KDTree index;
+  };
+
+  //! @brief Outcome of an icp registration
+  //!
+  struct IcpResult
+  {
+    //! @brief RMS distance between the matched source points and their nearest target points
+    //!        at the final transformation
+    //!
+    double rms;
+
+    //! @brief Source points matched to a target point within the match distance
+    //!
+    int matched;
+
+    //! @brief Iterations run, and whether the steps had become negligible before the limit
+    //!
+    int iterations;
+    bool converged;
+  };
+
+  //! @brief Index a target cloud for icp
+  //!
+  //! @param tarPoints  The target points
+  //! @param target     Populated with the index (and normals)
+  //! @param neighbours Number of nearest points from which each normal is estimated (0 for no
+  //!                   normals, which ICP_POINT_TO_PLANE needs; 8 to 12 is typical)
+  //!
+  //! @return True if the operation completed successfully, false otherwise (fewer than three
+  //!         points)
+  //!
+  LIBRARY_API bool buildIcpTarget(const PointCloudView &tarPoints, IcpTarget &target, int neighbours = 0);
+
+  //! @brief Register an unordered cloud (sut) to a target cloud by Iterative Closest Point:
+  //!        match each point to its nearest target point, solve for the rigid step that best
+  //!        aligns the matches, and repeat
+  //!
+  //! @param sutPoints   The points in the source frame
+  //! @param target      The target, from buildIcpTarget
+  //! @param out         The 4x4 transformation from the source frame to the target frame
+  //! @param metric      The error minimized
+  //! @param maxDistance Matches farther apart than this are ignored, e.g., points the target
+  //!                    does not cover (0 for no limit)
+  //! @param initial     Starting estimate, e.g., the previous frame's registration (NULL for the
+  //!                    identity).  ICP only finds the nearest local fit, so the start must be
+  //!                    close.
+  //! @param iterations  Iteration limit
+  //! @param threads     The number of threads matching points (0 for one per core); clouds of a
+  //!                    few hundred points are matched on the calling thread
+  //! @param result      If not NULL, populated with the outcome
+  //!
+  //! @return True if the operation completed successfully, false otherwise (e.g., fewer than
+  //!         three points matched, or point-to-plane requested without target normals)
+  //!
+  LIBRARY_API bool icp(const PointCloudView &sutPoints,
+                       const IcpTarget &target,
+                       matrix &out,
+                       IcpMetric metric = ICP_POINT_TO_POINT,
+                       double maxDistance = 0.0,
+                       matrix *initial = NULL,
+                       int iterations = 30,
+                       int threads = 0,
+                       IcpResult *result = NULL);
+
+  //! @brief As icp above, indexing the target points for a single registration
+  //!
+  LIBRARY_API bool icp(vector<point> &sutPoints,
+                       vector<point> &tarPoints,
+                       matrix &out,
+                       IcpMetric metric = ICP_POINT_TO_POINT,
+                       double maxDistance = 0.0);
+
+  //! @brief Rigid registration from one coordinate frame (sut) to another (tar) kept current as
+  //!        correspondences arrive, e.g., robot and motion capture positions of the tool during
+  //!        production.  Only the weighted sums and cross-covariance of the correspondences are
+  //!        stored, so adding a correspondence and solving are constant time and memory however
+  //!        many have been seen.  With forgetting, older correspondences count for exponentially
+  //!        less, so the registration follows slow drift.
+  //!
+  //! @note The object is not synchronized; guard it if correspondences are added on one thread
+  //!       and the registration is solved on another.
+  //!
+  //! @note For a robot's world transformation, add each new pair of robot and motion capture
+  //!       positions and pass the result of solve to CrpiRobot::UpdateWorldTransform
+  //!
+  class LIBRARY_API OnlineRegistration
+  {
+  public:
+
+    //! @brief Default constructor
+    //!
+    //! @param forgetting See setForgetting
+    //!
+    OnlineRegistration (double forgetting = 1.0);
+
+    //! @brief Default destructor
+    //!
+    ~OnlineRegistration ();
+
+    //! @brief Factor in (0, 1] by which every earlier correspondence is down-weighted when one
+    //!        is added (1 to keep them all at full weight).  A factor f gives the registration a
+    //!        memory of about 1 / (1 - f) correspondences.
+    //!
+    void setForgetting (double forgetting);
+
+    //! @brief Reject correspondences farther than threshold from the latest registration (see
+    //!        solve), e.g., a mislabeled marker (0, the default, to accept every correspondence)
+    //!
+    void setGate (double threshold);
+
+    //! @brief Add a correspondence
+    //!
+    //! @param sut    The position in the source frame
+    //! @param tar    The same position in the target frame
+    //! @param weight Weight of the correspondence relative to the others
+    //!
+    //! @return True if the correspondence was added, false if it was rejected by the gate
+    //!
+    bool add (const point &sut, const point &tar, double weight = 1.0);
+
+    //! @brief Add a set of correspondences, e.g., those of a calibration session to start from
+    //!
+    //! @return The number of correspondences added
+    //!
+    int add (vector<point> &sutPoints, vector<point> &tarPoints);
+
+    //! @brief Solve for the registration from the correspondences added so far
+    //!
+    //! @param out The 4x4 transformation from the source frame to the target frame
+    //! @param rms If not NULL, set to the weighted RMS distance between the correspondences
+    //!            under the registration
+    //!
+    //! @return True if the operation completed successfully, false otherwise (fewer than three
+    //!         correspondences, or all of them collinear)
+    //!
+    bool solve (matrix &out, double *rms = NULL);
+
+    //! @brief Discard every correspondence (and the latest registration)
+    //!
+    void reset ();
+
+    //! @brief The number of correspondences added, and their total weight after forgetting
+    //!        (the effective number of correspondences)
+    //!
+    int count () const;
+    double weight () const;
+
+  private:
+
+    //! @brief Settings
+    //!
+    double forgetting_;
+    double gate_;
+
+    //! @brief Weighted sums of the correspondences, taken about the first one:  total weight,
+    //!        source and target positions, their squared lengths, and the cross-covariance
+    //!
+    double origin_s_[3];
+    double origin_t_[3];
+    double sum_;
+    double ssut_[3];
+    double star_[3];
+    double sqsut_;
+    double sqtar_;
+    double cross_[9];
+    int count_;
+
+    //! @brief The latest registration (row-major 4x4), for the gate
+    //!
+    double h_[16];
+    bool solved_;
+  }; // OnlineRegistration
 
 } // namespace Registration
 
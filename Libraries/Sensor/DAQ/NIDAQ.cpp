@@ -0,0 +1,294 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: CRPI
+//  Subsystem:       Data Acquisition Sensor
+//  Workfile:        NIDAQ.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Continuous analog acquisition through NI-DAQmx
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "NIDAQ.h"
+
+#include <cstdio>
+#include <cstring>
+#include <math.h>
+
+//#define NIDAQ_NOISY
+
+using namespace std;
+
+namespace Sensor
+{
+  LIBRARY_API NIDAQ::NIDAQ (const char *channels, double rate, int block, int decimation,
+                            double minVal, double maxVal, int terminal, int ringScans) :
+    task_(NULL),
+    running_(false),
+    error_(0),
+    channels_(0),
+    rate_(rate),
+    block_((block > 0) ? block : 1),
+    start_(0.0),
+    scans_(0),
+    mask_(0),
+    head_(0),
+    tail_(0),
+    dropped_(0),
+    decimation_((decimation > 0) ? decimation : 1),
+    mode_(NIDAQ_MEAN),
+    pending_(0)
+  {
+    uInt32 count = 0;
+    size_t slots = 1;
+
+    memset(accum_, 0, sizeof(accum_));
+    memset(&working_, 0, sizeof(working_));
+
+    if (failed(DAQmxCreateTask("", &task_)) ||
+        failed(DAQmxCreateAIVoltageChan(task_, channels, "", terminal, minVal, maxVal, DAQmx_Val_Volts, NULL)) ||
+        failed(DAQmxGetTaskNumChans(task_, &count)))
+    {
+      return;
+    }
+    if (count < 1 || count > NIDAQ_CHANNELS_MAX)
+    {
+      printf("NIDAQ:  %u channels requested; at most %d are supported\n", (unsigned int)count, NIDAQ_CHANNELS_MAX);
+      return;
+    }
+    channels_ = (int)count;
+
+    //! Everything the callback touches is allocated here, so it never allocates
+    while (slots < (size_t)((ringScans > block_) ? ringScans : block_))
+    {
+      slots <<= 1;
+    }
+    mask_ = slots - 1;
+    ring_.assign(slots * channels_, 0.0);
+    ringTimes_.assign(slots, 0.0);
+    scratch_.assign((size_t)block_ * channels_, 0.0);
+
+    //! The driver's buffer holds several blocks, so a late callback does not overrun it
+    if (failed(DAQmxCfgSampClkTiming(task_, "", rate, DAQmx_Val_Rising, DAQmx_Val_ContSamps, (uInt64)block_ * 8)) ||
+        failed(DAQmxRegisterEveryNSamplesEvent(task_, DAQmx_Val_Acquired_Into_Buffer, (uInt32)block_, 0, everyNSamples, this)) ||
+        failed(DAQmxRegisterDoneEvent(task_, 0, done, this)) ||
+        failed(DAQmxStartTask(task_)))
+    {
+      return;
+    }
+    running_ = true;
+  }
+
+
+  LIBRARY_API NIDAQ::~NIDAQ ()
+  {
+    if (task_ != NULL)
+    {
+      //! Clearing the task waits for a callback that is in progress
+      running_ = false;
+      DAQmxStopTask(task_);
+      DAQmxClearTask(task_);
+      task_ = NULL;
+    }
+  }
+
+
+  LIBRARY_API bool NIDAQ::Running () const
+  {
+    return running_;
+  }
+
+
+  LIBRARY_API int NIDAQ::LastError (char *message, int size) const
+  {
+    if (message != NULL && size > 0)
+    {
+      DAQmxGetExtendedErrorInfo(message, (uInt32)size);
+    }
+    return error_;
+  }
+
+
+  LIBRARY_API int NIDAQ::Channels () const
+  {
+    return channels_;
+  }
+
+
+  LIBRARY_API void NIDAQ::SetDecimation (NIDAQDecimation mode)
+  {
+    mode_ = mode;
+  }
+
+
+  LIBRARY_API int NIDAQ::Read (double *values, double *times, int max)
+  {
+    size_t t = tail_.load(std::memory_order_relaxed);
+    size_t n = head_.load(std::memory_order_acquire) - t, i, slot;
+
+    n = (max < 0 || n < (size_t)max) ? n : (size_t)max;
+    for (i = 0; i < n; ++i)
+    {
+      slot = (t + i) & mask_;
+      memcpy(values + (i * channels_), &ring_[slot * channels_], channels_ * sizeof(double));
+      if (times != NULL)
+      {
+        times[i] = ringTimes_[slot];
+      }
+    }
+    tail_.store(t + n, std::memory_order_release);
+    return (int)n;
+  }
+
+
+  LIBRARY_API int NIDAQ::Waiting () const
+  {
+    return (int)(head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire));
+  }
+
+
+  LIBRARY_API unsigned long NIDAQ::Dropped () const
+  {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+
+  LIBRARY_API bool NIDAQ::GetLevels (NIDAQLevels &levels) const
+  {
+    return levels_.read(levels) > 0;
+  }
+
+
+  LIBRARY_API bool NIDAQ::MergeInto (robotIO &io, int first) const
+  {
+    NIDAQLevels levels;
+    int i, last;
+
+    if (first < 0 || levels_.read(levels) == 0)
+    {
+      return false;
+    }
+
+    last = first + channels_;
+    last = (last > CRPI_IO_MAX) ? CRPI_IO_MAX : last;
+    for (i = first; i < last; ++i)
+    {
+      io.aio[i] = levels.value[i - first];
+    }
+    if (io.naio < last)
+    {
+      io.naio = last;
+    }
+    return true;
+  }
+
+
+  int32 CVICALLBACK NIDAQ::everyNSamples (TaskHandle task, int32 type, uInt32 samples, void *param)
+  {
+    NIDAQ *daq = (NIDAQ*)param;
+    int32 read = 0;
+    double now, period = 1.0 / daq->rate_;
+    size_t h, slot;
+    int i, free;
+
+    if (daq->failed(DAQmxReadAnalogF64(task, daq->block_, 0.0, DAQmx_Val_GroupByScanNumber,
+                                       &daq->scratch_[0], (uInt32)daq->scratch_.size(), &read, NULL)) ||
+        read < 1)
+    {
+      return 0;
+    }
+    now = ulapi_time();
+
+    //! Scans are evenly spaced on the device's clock; the first block anchors them to ulapi_time
+    if (daq->scans_ == 0)
+    {
+      daq->start_ = now - ((read - 1) * period);
+    }
+
+    h = daq->head_.load(std::memory_order_relaxed);
+    free = (int)((daq->mask_ + 1) - (h - daq->tail_.load(std::memory_order_acquire)));
+    for (i = 0; i < read; ++i)
+    {
+      if (i >= free)
+      {
+        //! The consumer has fallen a full ring behind:  drop the rest of the block
+        daq->dropped_.fetch_add(read - i, std::memory_order_relaxed);
+        break;
+      }
+      slot = (h + i) & daq->mask_;
+      memcpy(&daq->ring_[slot * daq->channels_], &daq->scratch_[i * daq->channels_], daq->channels_ * sizeof(double));
+      daq->ringTimes_[slot] = daq->start_ + ((daq->scans_ + i) * period);
+    }
+    daq->head_.store(h + i, std::memory_order_release);
+
+    daq->scans_ += read;
+    daq->decimate(&daq->scratch_[0], read, daq->start_ + ((daq->scans_ - 1) * period));
+    return 0;
+  }
+
+
+  int32 CVICALLBACK NIDAQ::done (TaskHandle task, int32 status, void *param)
+  {
+    NIDAQ *daq = (NIDAQ*)param;
+
+    daq->failed(status);
+    daq->running_ = false;
+    return 0;
+  }
+
+
+  bool NIDAQ::failed (int32 status)
+  {
+    if (!DAQmxFailed(status))
+    {
+      return false;
+    }
+
+    error_ = (int)status;
+#ifdef NIDAQ_NOISY
+    char message[2048];
+    DAQmxGetExtendedErrorInfo(message, sizeof(message));
+    printf("NIDAQ error %d:  %s\n", (int)status, message);
+#endif
+    return true;
+  }
+
+
+  void NIDAQ::decimate (const double *scans, int count, double last)
+  {
+    const bool peak = (mode_.load(std::memory_order_relaxed) == NIDAQ_PEAK);
+    const double *scan;
+    int i, j;
+
+    for (i = 0; i < count; ++i)
+    {
+      scan = scans + (i * channels_);
+      for (j = 0; j < channels_; ++j)
+      {
+        if (!peak)
+        {
+          accum_[j] += scan[j];
+        }
+        else if (pending_ == 0 || fabs(scan[j]) > fabs(accum_[j]))
+        {
+          accum_[j] = scan[j];
+        }
+      }
+
+      if (++pending_ == decimation_)
+      {
+        for (j = 0; j < channels_; ++j)
+        {
+          working_.value[j] = peak ? accum_[j] : (accum_[j] / decimation_);
+          accum_[j] = 0.0;
+        }
+        working_.timestamp = last - ((count - 1 - i) / rate_);
+        levels_.write(working_);
+        pending_ = 0;
+      }
+    }
+  }
+} // Sensor namespace
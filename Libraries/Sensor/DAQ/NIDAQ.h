@@ -0,0 +1,214 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: CRPI
+//  Subsystem:       Data Acquisition Sensor
+//  Workfile:        NIDAQ.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Continuous analog acquisition from National Instruments DAQ devices
+//  (e.g., load cells and vacuum sensors wired to the cell) through NI-DAQmx.
+//
+//  The device samples on its own clock into the driver's buffer, and DAQmx
+//  calls back every N samples.  The callback reads the block into a
+//  lock-free ring of timestamped scans and folds it into a decimated level
+//  per channel.  Readers either drain the ring for the full-rate signal or
+//  merge the latest levels into a robotIO, so that an assembly search can
+//  end on an analog signal (see Assembly::AddTerminatorAnalog).
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef NIDAQ_H
+#define NIDAQ_H
+
+#include <atomic>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <ulapi.h>
+#include <crpi.h>
+#include "NIDAQmx.h"
+#elif defined(__GNUC__)
+#include "../../ulapi/src/ulapi.h"
+#include "../../CRPI/crpi.h"
+#include "../../ThirdParty/NI/NIDAQ/include/NIDAQmx.h"
+#endif
+
+//! @brief Most channels in one acquisition
+//!
+#define NIDAQ_CHANNELS_MAX 32
+
+//! @brief Default capacity of the scan ring, in scans (rounded up to a power of two)
+//!
+#define NIDAQ_RING_SCANS 65536
+
+namespace Sensor
+{
+  //! @brief How a run of scans is reduced to one level per channel
+  //!
+  typedef enum
+  {
+    NIDAQ_MEAN = 0, //! Average of the run
+    NIDAQ_PEAK      //! Value of largest magnitude in the run, so short spikes still trigger
+  } NIDAQDecimation;
+
+  //! @brief Latest decimated levels of every channel
+  //!
+  struct NIDAQLevels
+  {
+    //! @brief Time (s, ulapi_time) of the last scan folded into the levels
+    //!
+    double timestamp;
+
+    //! @brief One level per channel (in the channels' units, e.g., V)
+    //!
+    double value[NIDAQ_CHANNELS_MAX];
+  };
+
+  //! @ingroup Sensor
+  //!
+  //! @brief   Hardware-timed, buffered analog input task.  The DAQmx callback is the only
+  //!          producer; any one thread may drain the ring, and any thread may read the levels.
+  //!
+  class LIBRARY_API NIDAQ
+  {
+  public:
+
+    //! @brief Default constructor.  Creates and starts the task.
+    //!
+    //! @param channels   Physical channels (e.g., "Dev1/ai0:3")
+    //! @param rate       Sample clock rate (Hz per channel)
+    //! @param block      Scans per callback (e.g., rate / 100 for a callback every 10 ms)
+    //! @param decimation Scans per decimated level
+    //! @param minVal     Lowest expected input (V)
+    //! @param maxVal     Highest expected input (V)
+    //! @param terminal   Terminal configuration (e.g., DAQmx_Val_Diff)
+    //! @param ringScans  Capacity of the scan ring
+    //!
+    NIDAQ (const char *channels, double rate, int block, int decimation = 1,
+           double minVal = -10.0, double maxVal = 10.0, int terminal = DAQmx_Val_Cfg_Default,
+           int ringScans = NIDAQ_RING_SCANS);
+
+    //! @brief Default destructor.  Stops and clears the task.
+    //!
+    ~NIDAQ ();
+
+    //! @brief Whether the task is acquiring
+    //!
+    bool Running () const;
+
+    //! @brief The last DAQmx error (0 if none) and its description
+    //!
+    int LastError (char *message = NULL, int size = 0) const;
+
+    //! @brief Number of channels in the task
+    //!
+    int Channels () const;
+
+    //! @brief Set how scans are decimated (takes effect at the next level)
+    //!
+    void SetDecimation (NIDAQDecimation mode);
+
+    //! @brief Move waiting scans, oldest first, out of the ring (one consumer thread only)
+    //!
+    //! @param values Populated with Channels() values per scan, scan by scan
+    //! @param times  Populated with the time (s, ulapi_time) of each scan (may be NULL)
+    //! @param max    Most scans to move
+    //!
+    //! @return The number of scans moved
+    //!
+    int Read (double *values, double *times, int max);
+
+    //! @brief Number of scans waiting in the ring
+    //!
+    int Waiting () const;
+
+    //! @brief Number of scans dropped because the ring was full
+    //!
+    unsigned long Dropped () const;
+
+    //! @brief Copy the latest decimated levels
+    //!
+    //! @return True if any levels have been published
+    //!
+    bool GetLevels (NIDAQLevels &levels) const;
+
+    //! @brief Copy the latest decimated levels into a robot's analog I/O
+    //!
+    //! @param io    Populated by the function:  aio[first + i] is the level of channel i, and
+    //!              naio is raised to cover them (up to CRPI_IO_MAX)
+    //! @param first Index of the first analog I/O to overwrite
+    //!
+    //! @return True if any levels have been published
+    //!
+    bool MergeInto (robotIO &io, int first = 0) const;
+
+  private:
+
+    //! @brief DAQmx callback:  reads a block of scans into the ring and the levels
+    //!
+    static int32 CVICALLBACK everyNSamples (TaskHandle task, int32 type, uInt32 samples, void *param);
+
+    //! @brief DAQmx callback:  the task stopped on an error
+    //!
+    static int32 CVICALLBACK done (TaskHandle task, int32 status, void *param);
+
+    //! @brief Record a DAQmx status
+    //!
+    //! @return True if the status is an error
+    //!
+    bool failed (int32 status);
+
+    //! @brief Fold a block of scans into the decimated levels (callback only)
+    //!
+    void decimate (const double *scans, int count, double last);
+
+    //! @brief The DAQmx task
+    //!
+    TaskHandle task_;
+    std::atomic<bool> running_;
+    std::atomic<int> error_;
+
+    //! @brief Channels, sample rate (Hz), and scans per callback
+    //!
+    int channels_;
+    double rate_;
+    int block_;
+
+    //! @brief Block read by the callback, interleaved by scan
+    //!
+    std::vector<double> scratch_;
+
+    //! @brief Time of scan 0, set at the first callback, and scans read so far
+    //!
+    double start_;
+    unsigned long long scans_;
+
+    //! @brief Scan ring:  channels_ values per slot, and each slot's time.  The producer and
+    //!        consumer positions count scans and are kept on separate cache lines.
+    //!
+    std::vector<double> ring_;
+    std::vector<double> ringTimes_;
+    size_t mask_;
+    std::atomic<size_t> head_;
+    char pad_[64];
+    std::atomic<size_t> tail_;
+    std::atomic<unsigned long> dropped_;
+
+    //! @brief Decimation state (callback only) and the published levels
+    //!
+    int decimation_;
+    std::atomic<int> mode_;
+    int pending_;
+    double accum_[NIDAQ_CHANNELS_MAX];
+    NIDAQLevels working_;
+    crpi_seqlock<NIDAQLevels> levels_;
+
+    NIDAQ (const NIDAQ &);
+    NIDAQ &operator= (const NIDAQ &);
+  }; // NIDAQ
+} // Sensor namespace
+
+#endif
@@ -0,0 +1,321 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: CRPI
+//  Subsystem:       Depth Camera Sensor
+//  Workfile:        DepthCamera.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Interface library for OpenNI depth cameras
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DepthCamera.h"
+
+#include <cstdio>
+#include <math.h>
+
+//#define DEPTHCAMERA_NOISY
+
+using namespace std;
+
+namespace Sensor
+{
+  //! @brief Project one row of depth pixels through the ray tables.  Depths are converted and
+  //!        scaled two or four at a time with AVX, SSE2, or NEON when available.
+  //!
+  //! @param depth       The row's depths (mm)
+  //! @param rayX        Ray slope of each column
+  //! @param rayY        Ray slope of the row
+  //! @param count       Number of pixels in the row
+  //! @param out         Populated with the points
+  //! @param skipInvalid Leave out pixels with no depth
+  //!
+  //! @return The number of points written
+  //!
+  static size_t projectRow (const unsigned short *depth, const double *rayX, double rayY, int count,
+                            point *out, bool skipInvalid)
+  {
+    size_t n = 0;
+    int u = 0, k;
+
+#if defined(__AVX__)
+    double tx[4], ty[4], tz[4];
+    const __m256d ky = _mm256_set1_pd(rayY), zero = _mm256_setzero_pd();
+    int valid;
+
+    for (; u + 4 <= count; u += 4)
+    {
+      __m256d z = _mm256_set_pd(depth[u + 3], depth[u + 2], depth[u + 1], depth[u]);
+      _mm256_storeu_pd(tx, _mm256_mul_pd(_mm256_loadu_pd(rayX + u), z));
+      _mm256_storeu_pd(ty, _mm256_mul_pd(ky, z));
+      _mm256_storeu_pd(tz, z);
+      valid = skipInvalid ? _mm256_movemask_pd(_mm256_cmp_pd(z, zero, _CMP_GT_OQ)) : 0xf;
+      for (k = 0; k < 4; ++k)
+      {
+        if (valid & (1 << k))
+        {
+          out[n].x = tx[k];
+          out[n].y = ty[k];
+          out[n].z = tz[k];
+          ++n;
+        }
+      }
+    }
+#elif defined(MATH_USE_SSE2)
+    double tx[2], ty[2], tz[2];
+    const __m128d ky = _mm_set1_pd(rayY), zero = _mm_setzero_pd();
+    int valid;
+
+    for (; u + 2 <= count; u += 2)
+    {
+      __m128d z = _mm_set_pd(depth[u + 1], depth[u]);
+      _mm_storeu_pd(tx, _mm_mul_pd(_mm_loadu_pd(rayX + u), z));
+      _mm_storeu_pd(ty, _mm_mul_pd(ky, z));
+      _mm_storeu_pd(tz, z);
+      valid = skipInvalid ? _mm_movemask_pd(_mm_cmpgt_pd(z, zero)) : 0x3;
+      for (k = 0; k < 2; ++k)
+      {
+        if (valid & (1 << k))
+        {
+          out[n].x = tx[k];
+          out[n].y = ty[k];
+          out[n].z = tz[k];
+          ++n;
+        }
+      }
+    }
+#elif defined(MATH_USE_NEON)
+    double tx[2], ty[2], tz[2];
+
+    for (; u + 2 <= count; u += 2)
+    {
+      float64x2_t z = { (double)depth[u], (double)depth[u + 1] };
+      vst1q_f64(tx, vmulq_f64(vld1q_f64(rayX + u), z));
+      vst1q_f64(ty, vmulq_n_f64(z, rayY));
+      vst1q_f64(tz, z);
+      for (k = 0; k < 2; ++k)
+      {
+        if (!skipInvalid || tz[k] > 0.0)
+        {
+          out[n].x = tx[k];
+          out[n].y = ty[k];
+          out[n].z = tz[k];
+          ++n;
+        }
+      }
+    }
+#endif
+
+    //! The rest of the row (all of it without SIMD)
+    for (; u < count; ++u)
+    {
+      double z = depth[u];
+      if (!skipInvalid || z > 0.0)
+      {
+        out[n].x = rayX[u] * z;
+        out[n].y = rayY * z;
+        out[n].z = z;
+        ++n;
+      }
+    }
+    return n;
+  }
+
+
+  LIBRARY_API DepthCamera::DepthCamera () :
+    open_(false),
+    streamIR_(false),
+    width_(0),
+    height_(0),
+    status_(XN_STATUS_OK)
+  {
+  }
+
+
+  LIBRARY_API DepthCamera::~DepthCamera ()
+  {
+    Close();
+  }
+
+
+  LIBRARY_API bool DepthCamera::Open (int width, int height, int fps, bool ir)
+  {
+    XnMapOutputMode mode;
+    XnFieldOfView fov;
+    double fx, fy, cx, cy;
+    int i;
+
+    Close();
+
+    mode.nXRes = width;
+    mode.nYRes = height;
+    mode.nFPS = fps;
+
+    if (failed(context_.Init()))
+    {
+      return false;
+    }
+    if (failed(depth_.Create(context_)) || failed(depth_.SetMapOutputMode(mode)) ||
+        (ir && (failed(ir_.Create(context_)) || failed(ir_.SetMapOutputMode(mode)))) ||
+        failed(depth_.GetFieldOfView(fov)) ||
+        failed(context_.StartGeneratingAll()))
+    {
+      ir_.Release();
+      depth_.Release();
+      context_.Shutdown();
+      return false;
+    }
+
+    width_ = width;
+    height_ = height;
+    streamIR_ = ir;
+
+    //! Pinhole model from the field of view, with the optical axis at the center of the map.
+    //! OpenNI's real-world frame has Y up, so rows count down from +Y.
+    fx = (width_ / 2.0) / tan(fov.fHFOV / 2.0);
+    fy = (height_ / 2.0) / tan(fov.fVFOV / 2.0);
+    cx = (width_ - 1) / 2.0;
+    cy = (height_ - 1) / 2.0;
+    rayX_.resize(width_);
+    rayY_.resize(height_);
+    for (i = 0; i < width_; ++i)
+    {
+      rayX_[i] = (i - cx) / fx;
+    }
+    for (i = 0; i < height_; ++i)
+    {
+      rayY_[i] = (cy - i) / fy;
+    }
+
+#ifdef DEPTHCAMERA_NOISY
+    printf("Depth camera open:  %dx%d at %d fps, FOV %.1f x %.1f deg\n", width_, height_, fps,
+           fov.fHFOV * 180.0 / 3.141592654, fov.fVFOV * 180.0 / 3.141592654);
+#endif
+    open_ = true;
+    return true;
+  }
+
+
+  LIBRARY_API void DepthCamera::Close ()
+  {
+    if (!open_)
+    {
+      return;
+    }
+    context_.StopGeneratingAll();
+    ir_.Release();
+    depth_.Release();
+    context_.Shutdown();
+    open_ = false;
+  }
+
+
+  LIBRARY_API bool DepthCamera::IsOpen () const
+  {
+    return open_;
+  }
+
+
+  LIBRARY_API const char *DepthCamera::LastError () const
+  {
+    return xnGetStatusString(status_);
+  }
+
+
+  LIBRARY_API bool DepthCamera::WaitFrame (DepthFrameView &frame)
+  {
+    if (!open_ || failed(context_.WaitOneUpdateAll(depth_)))
+    {
+      return false;
+    }
+
+    frame.timestamp = ulapi_time();
+    frame.depth = depth_.GetDepthMap();
+    frame.ir = streamIR_ ? ir_.GetIRMap() : NULL;
+    frame.width = width_;
+    frame.height = height_;
+    frame.frameId = depth_.GetFrameID();
+    frame.deviceTime = depth_.GetTimestamp();
+    return frame.depth != NULL;
+  }
+
+
+  LIBRARY_API size_t DepthCamera::MaxPoints () const
+  {
+    return (size_t)width_ * height_;
+  }
+
+
+  LIBRARY_API size_t DepthCamera::ProjectPoints (const DepthFrameView &frame, point *out, int stride,
+                                                 bool skipInvalid) const
+  {
+    size_t n = 0;
+    int u, v;
+
+    if (frame.depth == NULL || frame.width != width_ || frame.height != height_)
+    {
+      return 0;
+    }
+
+    if (stride <= 1)
+    {
+      for (v = 0; v < height_; ++v)
+      {
+        n += projectRow(frame.depth + ((size_t)v * width_), &rayX_[0], rayY_[v], width_, out + n, skipInvalid);
+      }
+      return n;
+    }
+
+    for (v = 0; v < height_; v += stride)
+    {
+      const unsigned short *row = frame.depth + ((size_t)v * width_);
+      for (u = 0; u < width_; u += stride)
+      {
+        double z = row[u];
+        if (!skipInvalid || z > 0.0)
+        {
+          out[n].x = rayX_[u] * z;
+          out[n].y = rayY_[v] * z;
+          out[n].z = z;
+          ++n;
+        }
+      }
+    }
+    return n;
+  }
+
+
+  LIBRARY_API size_t DepthCamera::ProjectPoints (const DepthFrameView &frame, vector<point> &out, int stride,
+                                                 bool skipInvalid) const
+  {
+    size_t n;
+
+    //! Growing within the capacity does not reallocate
+    out.resize(MaxPoints());
+    if (out.empty())
+    {
+      return 0;
+    }
+    n = ProjectPoints(frame, &out[0], stride, skipInvalid);
+    out.resize(n);
+    return n;
+  }
+
+
+  bool DepthCamera::failed (XnStatus status)
+  {
+    if (status == XN_STATUS_OK)
+    {
+      return false;
+    }
+
+    status_ = status;
+#ifdef DEPTHCAMERA_NOISY
+    printf("OpenNI error:  %s\n", xnGetStatusString(status));
+#endif
+    return true;
+  }
+} // Sensor namespace
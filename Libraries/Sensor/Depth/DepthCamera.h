@@ -0,0 +1,196 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: CRPI
+//  Subsystem:       Depth Camera Sensor
+//  Workfile:        DepthCamera.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Interface library for OpenNI depth cameras (Kinect, PrimeSense, Xtion).
+//
+//  Frames are views over OpenNI's own buffers:  WaitFrame updates the
+//  context and points the view at the new depth (and IR) maps, which stay
+//  valid until the next WaitFrame.  ProjectPoints turns a depth map into
+//  Math::point arrays (millimeters, camera frame:  X right, Y up, Z out of
+//  the lens) with per-column and per-row ray tables built when the camera
+//  is opened, so no frame allocates.  The points go straight into
+//  CrpiRobot::ToWorldPoints or Math::transformPoints (with the camera's
+//  registration from RegistrationKit) and into the RegistrationKit fits.
+//
+//  The CL NUI SDK (also vendored) only copies frames into caller buffers, so
+//  Kinects are opened through OpenNI's SensorKinect driver instead.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef DEPTHCAMERA_H
+#define DEPTHCAMERA_H
+
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <ulapi.h>
+#include <crpi.h>
+#include "MatrixMath.h"
+#include "XnCppWrapper.h"
+#elif defined(__GNUC__)
+#include "../../ulapi/src/ulapi.h"
+#include "../../CRPI/crpi.h"
+#include "../../Math/MatrixMath.h"
+#include <ni/XnCppWrapper.h>
+#endif
+
+using namespace std;
+using namespace Math;
+
+namespace Sensor
+{
+  //! @brief One frame, as pointers into the driver's buffers.  Valid until the next WaitFrame
+  //!        (or Close) on the camera that filled it.
+  //!
+  struct DepthFrameView
+  {
+    //! @brief Depth of each pixel (mm, 0 where there is no reading), row by row
+    //!
+    const unsigned short *depth;
+
+    //! @brief IR intensity of each pixel, or NULL if the IR stream is not open
+    //!
+    const unsigned short *ir;
+
+    //! @brief Map size (pixels)
+    //!
+    int width;
+    int height;
+
+    //! @brief The driver's frame counter and timestamp (us, device clock)
+    //!
+    unsigned int frameId;
+    unsigned long long deviceTime;
+
+    //! @brief Time (s, ulapi_time) at which the frame was received
+    //!
+    double timestamp;
+
+    DepthFrameView () :
+      depth(NULL),
+      ir(NULL),
+      width(0),
+      height(0),
+      frameId(0),
+      deviceTime(0),
+      timestamp(0.0)
+    {
+    }
+  };
+
+  //! @ingroup Sensor
+  //!
+  //! @brief   OpenNI depth camera.  One thread reads frames; the views it is handed stay valid
+  //!          while it works on them.
+  //!
+  class LIBRARY_API DepthCamera
+  {
+  public:
+
+    //! @brief Default constructor
+    //!
+    DepthCamera ();
+
+    //! @brief Default destructor
+    //!
+    ~DepthCamera ();
+
+    //! @brief Open the first depth camera found and start streaming
+    //!
+    //! @param width  Depth map width (e.g., 640)
+    //! @param height Depth map height (e.g., 480)
+    //! @param fps    Frame rate
+    //! @param ir     Whether to stream IR along with depth (not supported by every camera)
+    //!
+    //! @return True if the camera is streaming, false otherwise (see LastError)
+    //!
+    bool Open (int width = 640, int height = 480, int fps = 30, bool ir = false);
+
+    //! @brief Stop streaming and release the camera.  Views of its frames become invalid.
+    //!
+    void Close ();
+
+    //! @brief Whether the camera is streaming
+    //!
+    bool IsOpen () const;
+
+    //! @brief Description of the last OpenNI error
+    //!
+    const char *LastError () const;
+
+    //! @brief Wait for the next frame and view it in place
+    //!
+    //! @param frame Pointed at the new frame's maps
+    //!
+    //! @return True if a frame was received, false otherwise
+    //!
+    bool WaitFrame (DepthFrameView &frame);
+
+    //! @brief Number of points a full frame projects to (width x height)
+    //!
+    size_t MaxPoints () const;
+
+    //! @brief Project a depth map into camera-frame points (mm)
+    //!
+    //! @param frame       The frame to project
+    //! @param out         Populated with the points; room for MaxPoints() (or, with a stride,
+    //!                    one per sampled pixel)
+    //! @param stride      Use every stride-th pixel of every stride-th row
+    //! @param skipInvalid Leave out pixels with no depth (true), or write them as (0, 0, 0) so
+    //!                    that point i is pixel i (false)
+    //!
+    //! @return The number of points written
+    //!
+    size_t ProjectPoints (const DepthFrameView &frame, point *out, int stride = 1,
+                          bool skipInvalid = true) const;
+
+    //! @brief Project a depth map into a vector of points (see above).  The vector is sized to
+    //!        MaxPoints() the first time and only shrunk afterward, so once it has grown it is
+    //!        never reallocated.
+    //!
+    size_t ProjectPoints (const DepthFrameView &frame, vector<point> &out, int stride = 1,
+                          bool skipInvalid = true) const;
+
+  private:
+
+    //! @brief Record an OpenNI status
+    //!
+    //! @return True if the status is an error
+    //!
+    bool failed (XnStatus status);
+
+    //! @brief OpenNI context and the streams opened on it
+    //!
+    xn::Context context_;
+    xn::DepthGenerator depth_;
+    xn::IRGenerator ir_;
+    bool open_;
+    bool streamIR_;
+
+    //! @brief Map size (pixels)
+    //!
+    int width_;
+    int height_;
+
+    //! @brief Ray tables:  a pixel (u, v) at depth d is at (rayX_[u] d, rayY_[v] d, d)
+    //!
+    vector<double> rayX_;
+    vector<double> rayY_;
+
+    //! @brief Last OpenNI error
+    //!
+    XnStatus status_;
+
+    DepthCamera (const DepthCamera &);
+    DepthCamera &operator= (const DepthCamera &);
+  }; // DepthCamera
+} // Sensor namespace
+
+#endif
@@ -23,6 +23,7 @@
 #include "opencv2/highgui/highgui.hpp"
 #include "opencv2/imgproc/imgproc.hpp"
 #include "opencv2/contrib/contrib.hpp"
+#include "opencv2/gpu/gpu.hpp"
 #include <stdio.h>
 
 //#define LEAP_NOISY
@@ -40,6 +41,112 @@ namespace Sensor
   ulapi_mutex_struct* datamutex;
   Frame globalFrame;
 
+  //! @brief Dewarped image size
+  //!
+  static const int dewarpWidth = 400;
+  static const int dewarpHeight = 400;
+
+  //! @brief Block matching search range
+  //!
+  static const int depthMinDisparity = -80;
+  static const int depthDisparities = 112;
+
+  //! @brief Block matchers configured once, and the buffers they use (reused while the image
+  //!        size does not change)
+  //!
+  struct LeapMotion::stereoState
+  {
+    //! @brief The matcher in use
+    //!
+    LeapDepthBackend backend;
+
+    //! @brief CPU matcher and its 16-bit (1/16 pixel) disparities
+    //!
+    StereoBM sbm;
+    cv::Mat disp;
+
+    //! @brief CUDA matcher, its stream, page-locked host buffers, and device buffers
+    //!
+    cv::gpu::StereoBM_GPU gsbm;
+    cv::gpu::Stream *stream;
+    cv::gpu::CudaMem hostL, hostR, hostD;
+    cv::gpu::GpuMat gpuL, gpuR, gpuD;
+
+    //! @brief Whether a requested depth map has not been collected yet, and its size
+    //!
+    bool pending;
+    int rows;
+    int cols;
+
+    stereoState (LeapDepthBackend requested) :
+      backend(LEAP_DEPTH_CPU),
+      gsbm(cv::gpu::StereoBM_GPU::PREFILTER_XSOBEL, depthDisparities, 7),
+      stream(NULL),
+      pending(false),
+      rows(0),
+      cols(0)
+    {
+      sbm.state->SADWindowSize = 7;
+      sbm.state->numberOfDisparities = depthDisparities;
+      sbm.state->preFilterSize = 5;
+      sbm.state->preFilterCap = 39; //61
+      sbm.state->minDisparity = depthMinDisparity; //-80
+      sbm.state->textureThreshold = 607; // 507
+      sbm.state->uniquenessRatio = 8;
+      sbm.state->speckleWindowSize = 0;
+      sbm.state->speckleRange = 8;
+      sbm.state->disp12MaxDiff = 1;
+
+      //! Falls back to the CPU matcher without a CUDA device (or a CUDA build of OpenCV)
+      if (requested == LEAP_DEPTH_CUDA)
+      {
+        try
+        {
+          if (cv::gpu::getCudaEnabledDeviceCount() > 0)
+          {
+            stream = new cv::gpu::Stream();
+            backend = LEAP_DEPTH_CUDA;
+          }
+        }
+        catch (const cv::Exception &)
+        {
+          delete stream;
+          stream = NULL;
+        }
+      }
+    }
+
+    ~stereoState ()
+    {
+      if (stream != NULL)
+      {
+        stream->waitForCompletion();
+      }
+      delete stream;
+    }
+  };
+
+  //! @brief Copy a Leap vector into three doubles
+  //!
+  static void copyVector (const Leap::Vector &from, double to[3])
+  {
+    to[0] = from.x;
+    to[1] = from.y;
+    to[2] = from.z;
+  }
+
+  CrpiListener::CrpiListener(crpi_queue<LeapHandFrame> *handFrames) :
+    handFrames_(handFrames),
+    dropped_(0)
+  {
+    memset(&working_, 0, sizeof(working_));
+  }
+
+  unsigned long CrpiListener::dropped() const
+  {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
   void CrpiListener::onInit(const Controller& controller)
   {
 #ifdef LEAP_NOISY
@@ -75,12 +182,60 @@ namespace Sensor
   void CrpiListener::onFrame(const Controller& controller)
   {
     static bool firstrun = true;
+    const Frame frame = controller.frame();
 
     //! Get the most recent frame
     ulapi_mutex_take (datamutex);
-    globalFrame = controller.frame();
+    globalFrame = frame;
     ulapi_mutex_give (datamutex);
 
+    //! Record the hands of every frame as it arrives, outside the lock
+    if (handFrames_ != NULL)
+    {
+      const HandList hands = frame.hands();
+      int count = 0;
+
+      working_.frameId = frame.id();
+      working_.deviceTime = frame.timestamp();
+      working_.timestamp = ulapi_time();
+      for (HandList::const_iterator hl = hands.begin(); hl != hands.end() && count < LEAP_HANDS_MAX; ++hl, ++count)
+      {
+        const Hand hand = *hl;
+        LeapHandSkeleton &skeleton = working_.hands[count];
+        const FingerList fingers = hand.fingers();
+
+        skeleton.id = hand.id();
+        skeleton.left = hand.isLeft();
+        skeleton.confidence = hand.confidence();
+        copyVector(hand.palmPosition(), skeleton.palm);
+        copyVector(hand.palmNormal(), skeleton.normal);
+        copyVector(hand.direction(), skeleton.direction);
+        skeleton.grab = hand.grabStrength();
+        skeleton.pinch = hand.pinchStrength();
+
+        //! Fingers missing from the list keep their tips at the palm
+        for (int i = 0; i < 5; ++i)
+        {
+          memcpy(skeleton.tips[i], skeleton.palm, sizeof(skeleton.palm));
+        }
+        for (FingerList::const_iterator fl = fingers.begin(); fl != fingers.end(); ++fl)
+        {
+          const Finger finger = *fl;
+          int type = (int)finger.type();
+          if (type >= 0 && type < 5)
+          {
+            copyVector(finger.tipPosition(), skeleton.tips[type]);
+          }
+        }
+      }
+      working_.handCount = count;
+
+      if (!handFrames_->push(working_))
+      {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+
 #ifdef LEAP_NOISY
     //! Report basic frame information
     cout << "Frame id: " << globalFrame.id()
@@ -140,10 +295,11 @@ namespace Sensor
 
 
 
-  LIBRARY_API LeapMotion::LeapMotion ()
+  LIBRARY_API LeapMotion::LeapMotion (LeapDepthBackend depth)
   {
     datamutex = ulapi_mutex_new(101);
-    listener_ = new CrpiListener();
+    handFrames_ = new crpi_queue<LeapHandFrame>(LEAP_HAND_FRAMES);
+    listener_ = new CrpiListener(handFrames_);
     controller_ = new Controller();
 
     //! Configure the controller to receive events from the controller
@@ -151,6 +307,14 @@ namespace Sensor
     controller_->setPolicy(Controller::POLICY_BACKGROUND_FRAMES);
     controller_->setPolicy(Controller::POLICY_IMAGES);
 
+    for (int i = 0; i < 2; ++i)
+    {
+      for (int j = 0; j < 6; ++j)
+      {
+        warpKey_[i][j] = 0.0f;
+      }
+    }
+    stereo_ = new stereoState(depth);
   }
 
 
@@ -160,6 +324,8 @@ namespace Sensor
 
     delete listener_;
     delete controller_;
+    delete stereo_;
+    delete handFrames_;
   }
 
 
@@ -221,6 +387,28 @@ namespace Sensor
   }
 
 
+  LIBRARY_API bool LeapMotion::getHandFrame (LeapHandFrame &frame, double timeout)
+  {
+    if (timeout == 0.0)
+    {
+      return handFrames_->pop(frame);
+    }
+    return handFrames_->popWait(frame, timeout);
+  }
+
+
+  LIBRARY_API int LeapMotion::handFramesWaiting () const
+  {
+    return handFrames_->size();
+  }
+
+
+  LIBRARY_API unsigned long LeapMotion::handFramesDropped () const
+  {
+    return listener_->dropped();
+  }
+
+
   LIBRARY_API bool LeapMotion::getGestures (GestureList *gestures)
   {
     ulapi_mutex_take (datamutex);
@@ -335,161 +523,261 @@ namespace Sensor
   }
 
 
-  LIBRARY_API bool LeapMotion::getImages (Math::matrix& left, Math::matrix& right, bool dewarp)
+  LIBRARY_API bool LeapMotion::getImages (LeapImageView &left, LeapImageView &right, bool dewarp)
   {
+    LeapImageView *views[2] = {&left, &right};
+
     ulapi_mutex_take (datamutex);
     images_ = globalFrame.images();
     ulapi_mutex_give (datamutex);
 
-    Image srcL, srcR;
-    srcR = images_[0];
-    srcL = images_[1];
+    //! The first image is from the right camera
+    raw_[0] = images_[1];
+    raw_[1] = images_[0];
 
-    if (!srcL.isValid())
+    if (!raw_[0].isValid() || !raw_[1].isValid())
     {
       return false;
     }
 
-    if (!dewarp)
+    for (int i = 0; i < 2; ++i)
     {
-      left.resize(srcR.height(), srcR.width());
-      right.resize(srcL.height(), srcL.width());
-
+      if (dewarp)
+      {
+        dewarpImage(i, *views[i]);
+      }
+      else
+      {
+        views[i]->data = raw_[i].data();
+        views[i]->width = views[i]->stride = raw_[i].width();
+        views[i]->height = raw_[i].height();
+      }
     }
-    else
-    {
-      int targetWidth = 400;
-      int targetHeight = 400;
-
-      left.resize(targetHeight, targetWidth);
-      right.resize(targetHeight, targetWidth);
-      unsigned char brightness;
+    return true;
+  }
 
-      Leap::Vector pixel;
-      Vec3b color;
 
-      for (int x = 0; x < targetWidth; ++x)
+  void LeapMotion::dewarpImage (int camera, LeapImageView &out)
+  {
+    const Image &src = raw_[camera];
+    const unsigned char *data = src.data();
+    vector<int> &map = warpMap_[camera];
+    vector<unsigned char> &image = dewarped_[camera];
+    int x, y, i, width = src.width(), height = src.height();
+    int count = dewarpWidth * dewarpHeight;
+    float key[6] = {(float)width, (float)height, src.rayOffsetX(), src.rayOffsetY(),
+                    src.rayScaleX(), src.rayScaleY()};
+    Leap::Vector pixel;
+
+    if ((int)map.size() != count || memcmp(key, warpKey_[camera], sizeof(key)) != 0)
+    {
+      //! warp() is costly, so each target pixel's source is found once per calibration
+      map.resize(count);
+      for (y = 0, i = 0; y < dewarpHeight; ++y)
       {
-        for (int y = 0; y < targetHeight; ++y)
+        for (x = 0; x < dewarpWidth; ++x, ++i)
         {
-          Leap::Vector vec((float)x/targetWidth, (float)y/targetHeight, 0);
-          vec.x = (vec.x - srcL.rayOffsetX()) / srcL.rayScaleX();
-          vec.y = (vec.y - srcL.rayOffsetY()) / srcL.rayScaleY();
-
-          //! Dewarp left image
-          pixel = srcL.warp(vec);
-          if(pixel.x >= 0 && pixel.x < srcL.width() && pixel.y >= 0 && pixel.y < srcL.height()) 
-          {
-            int data_index = (int)(floor(pixel.y) * srcL.width() + floor(pixel.x)); //xy to buffer index
-            brightness = srcL.data()[data_index]; //Look up brightness value
-            brightness = (brightness == 0 ? 1 : brightness);
-          } 
-          else
+          Leap::Vector vec((float)x/dewarpWidth, (float)y/dewarpHeight, 0);
+          vec.x = (vec.x - src.rayOffsetX()) / src.rayScaleX();
+          vec.y = (vec.y - src.rayOffsetY()) / src.rayScaleY();
+          pixel = src.warp(vec);
+          if (pixel.x >= 0 && pixel.x < width && pixel.y >= 0 && pixel.y < height)
           {
-            brightness = 0; //! Display invalid pixels as black
+            map[i] = (int)(floor(pixel.y) * width + floor(pixel.x)); //xy to buffer index
           }
-          left.at(y, x) = brightness;
-
-          //! Dewarp right image
-          pixel = srcR.warp(vec);
-          if(pixel.x >= 0 && pixel.x < srcR.width() && pixel.y >= 0 && pixel.y < srcR.height()) 
-          {
-            int data_index = (int)(floor(pixel.y) * srcR.width() + floor(pixel.x)); //xy to buffer index
-            brightness = srcR.data()[data_index];
-            brightness = (brightness == 0 ? 1 : brightness);
-          } 
           else
           {
-            brightness = 0;
+            map[i] = -1;
           }
-          right.at(y, x) = brightness;
-        } // for (int y = 0; y < targetHeight; ++y)
-      } // for (int x = 0; x < targetWidth; ++x)
-    } // if (!dewarp) ... else
+        } // for (x = 0; x < dewarpWidth; ++x, ++i)
+      } // for (y = 0, i = 0; y < dewarpHeight; ++y)
+      memcpy(warpKey_[camera], key, sizeof(key));
+    }
 
-    return true;
+    //! Valid pixels are at least 1 so that black (0) marks pixels outside the raw image
+    image.resize(count);
+    for (i = 0; i < count; ++i)
+    {
+      unsigned char brightness = (map[i] < 0) ? 0 : data[map[i]];
+      image[i] = (map[i] >= 0 && brightness == 0) ? 1 : brightness;
+    }
+
+    out.data = &image[0];
+    out.width = out.stride = dewarpWidth;
+    out.height = dewarpHeight;
   }
 
 
-  LIBRARY_API bool LeapMotion::getDepthMap (Math::matrix& mapout)
+  LIBRARY_API bool LeapMotion::getImages (Math::matrix& left, Math::matrix& right, bool dewarp)
   {
-    Math::matrix left, right;
+    LeapImageView views[2];
+    Math::matrix *outs[2] = {&left, &right};
 
-    if (!getImages(left, right))
+    if (!getImages(views[0], views[1], dewarp))
     {
       return false;
     }
 
-    Mat gL, gR;
-    Mat disp, disp8;
-
-    //Draw the undistorted image using the warp() function
-    int targetWidth = left.cols;
-    int targetHeight = left.rows;
-    Mat tIR(targetWidth, targetHeight, CV_8UC1),
-        tIL(targetWidth, targetHeight, CV_8UC1);
-
-    for (int x = 0; x < targetWidth; ++x)
+    for (int i = 0; i < 2; ++i)
     {
-      for (int y = 0; y < targetHeight; ++y)
+      if (outs[i]->rows != views[i].height || outs[i]->cols != views[i].width)
       {
-        tIL.at<unsigned char>(y, x) = (unsigned char)left.at(y, x);
-        tIR.at<unsigned char>(y, x) = (unsigned char)right.at(y, x);
+        outs[i]->resize(views[i].height, views[i].width);
       }
+      for (int y = 0; y < views[i].height; ++y)
+      {
+        const unsigned char *row = views[i].data + (y * views[i].stride);
+        for (int x = 0; x < views[i].width; ++x)
+        {
+          outs[i]->at(y, x) = row[x];
+        }
+      }
+    }
+    return true;
+  }
+
+
+  LIBRARY_API LeapDepthBackend LeapMotion::depthBackend () const
+  {
+    return stereo_->backend;
+  }
+
+
+  LIBRARY_API bool LeapMotion::requestDepthMap ()
+  {
+    LeapImageView left, right;
+
+    //! A map still in flight is superseded, but its staging buffers are about to be reused
+    if (stereo_->pending && stereo_->stream != NULL)
+    {
+      stereo_->stream->waitForCompletion();
+    }
+    stereo_->pending = false;
+
+    if (!getImages(left, right))
+    {
+      return false;
     }
+    stereo_->rows = left.height;
+    stereo_->cols = left.width;
+
+    //! Headers over the dewarped buffers:  no pixels are copied
+    cv::Mat tIL(left.height, left.width, CV_8UC1, (void*)left.data, left.stride),
+        tIR(right.height, right.width, CV_8UC1, (void*)right.data, right.stride);
 #ifdef LEAP_NOISY
     imshow("unwarped left", tIL);
     imshow("unwarped right", tIR);
 #endif
 
-    Vec3b color;
+    if (stereo_->backend == LEAP_DEPTH_CUDA)
+    {
+      int span = left.width + depthMinDisparity;
+
+      //! Page-locked staging buffers let the uploads and download run asynchronously; all are
+      //! reused while the image size is unchanged
+      stereo_->hostL.create(left.height, left.width, CV_8UC1);
+      stereo_->hostR.create(right.height, right.width, CV_8UC1);
+      cv::Mat stageL = stereo_->hostL.createMatHeader(), stageR = stereo_->hostR.createMatHeader();
+      tIL.copyTo(stageL);
+      tIR.copyTo(stageR);
+
+      stereo_->stream->enqueueUpload(stereo_->hostL, stereo_->gpuL);
+      stereo_->stream->enqueueUpload(stereo_->hostR, stereo_->gpuR);
+      stereo_->gpuD.create(left.height, left.width, CV_8UC1);
+      stereo_->stream->enqueueMemSet(stereo_->gpuD, Scalar::all(0));
+
+      //! The GPU matcher only searches non-negative disparities:  offsetting the right image by
+      //! the (negative) minimum disparity searches the same range as the CPU matcher
+      if (span > 0)
+      {
+        cv::gpu::GpuMat roiD = stereo_->gpuD(Rect(0, 0, span, left.height));
+        stereo_->gsbm(stereo_->gpuL(Rect(0, 0, span, left.height)),
+                      stereo_->gpuR(Rect(-depthMinDisparity, 0, span, left.height)),
+                      roiD, *stereo_->stream);
+      }
+      stereo_->stream->enqueueDownload(stereo_->gpuD, stereo_->hostD);
+    }
+    else
+    {
+      //! The disparity buffer is reused while the image size is unchanged
+      stereo_->sbm(tIL, tIR, stereo_->disp);
+    }
+    stereo_->pending = true;
+    return true;
+  }
 
 
-    StereoBM sbm;
-    sbm.state->SADWindowSize = 7;
-    sbm.state->numberOfDisparities = 112;
-    sbm.state->preFilterSize = 5;
-    sbm.state->preFilterCap = 39; //61
-    sbm.state->minDisparity = -80; //-80
-    sbm.state->textureThreshold = 607; // 507
-    sbm.state->uniquenessRatio = 8;
-    sbm.state->speckleWindowSize = 0;
-    sbm.state->speckleRange = 8;
-    sbm.state->disp12MaxDiff = 1;
-    
-    if (mapout.rows != targetHeight || mapout.cols != targetWidth)
+  LIBRARY_API bool LeapMotion::depthMapReady ()
+  {
+    if (!stereo_->pending)
     {
-      mapout.resize(targetWidth, targetHeight);
+      return false;
+    }
+    return (stereo_->backend != LEAP_DEPTH_CUDA) || stereo_->stream->queryIfComplete();
+  }
+
+
+  LIBRARY_API bool LeapMotion::getDepthMap (Math::matrix& mapout)
+  {
+    bool gpu = (stereo_->backend == LEAP_DEPTH_CUDA);
+    cv::Mat gpuDisp;
+    int x, y, d;
+
+    if (!stereo_->pending && !requestDepthMap())
+    {
+      return false;
+    }
+    if (gpu)
+    {
+      stereo_->stream->waitForCompletion();
+      gpuDisp = stereo_->hostD.createMatHeader();
+    }
+    stereo_->pending = false;
+
+    if (mapout.rows != stereo_->rows || mapout.cols != stereo_->cols)
+    {
+      mapout.resize(stereo_->rows, stereo_->cols);
     }
 
-    sbm(tIL, tIR, disp);
 #ifdef LEAP_NOISY
-    Mat out(targetWidth, targetHeight, CV_8UC3);
+    cv::Mat out(stereo_->rows, stereo_->cols, CV_8UC3);
+    Vec3b color;
 #endif
     short val;
-    for (int x = 0; x < targetWidth; ++x)
+    for (y = 0; y < stereo_->rows; ++y)
     {
-      for (int y = 0; y < targetHeight; ++y)
+      const short *disp = gpu ? NULL : stereo_->disp.ptr<short>(y);
+      const unsigned char *disp8 = gpu ? gpuDisp.ptr<unsigned char>(y) : NULL;
+      for (x = 0; x < stereo_->cols; ++x)
       {
-        val = (((disp.at<short>(x, y) < -350) || (disp.at<short>(x, y) > 150)) ? -1 : abs((disp.at<short>(x, y)+350)/2));
+        //! Both matchers are read in the CPU matcher's units (1/16 pixel).  The GPU matcher
+        //! reports whole, offset disparities, with 0 where it found none.
+        if (gpu)
+        {
+          d = (disp8[x] == 0) ? 16 * (depthMinDisparity - 1) : 16 * (disp8[x] + depthMinDisparity);
+        }
+        else
+        {
+          d = disp[x];
+        }
+        val = (((d < -350) || (d > 150)) ? -1 : abs((d+350)/2));
         if (val < 0)
         {
 #ifdef LEAP_NOISY
-          disp.at<short>(x, y) = -1000;
           color[0] = 255;
           color[1] = color[2] = 0;
 #endif
-          mapout.at(x, y) = -1;
+          mapout.at(y, x) = -1;
         }
         else
         {
 #ifdef LEAP_NOISY
           color[0] = color[1] = color[2] = (unsigned int)val;
 #endif
-          mapout.at(x, y) = val;
+          mapout.at(y, x) = val;
         }
 #ifdef LEAP_NOISY
-        out.at<Vec3b>(Point(y, x)) = color;
+        out.at<Vec3b>(y, x) = color;
 #endif
       }
     }
@@ -16,6 +16,7 @@
 #define LEAPMOTION_H
 
 #include <vector>
+#include <atomic>
 #include <string.h>
 
 #if defined(_MSC_VER)
@@ -23,13 +24,22 @@
 #include "MatrixMath.h"
 #include "Leap.h"
 #include "ulapi.h"
+#include <crpi.h>
 #else
 #include "../../../portable.h"
 #include "../../Math/MatrixMath.h"
 #include "../../ThirdParty/LeapSDK/include/Leap.h"
 #include "../../ulapi/src/ulapi.h"
+#include "../../CRPI/crpi.h"
 #endif
 
+//! @brief Most hands recorded per frame
+//!
+#define LEAP_HANDS_MAX 2
+
+//! @brief Capacity of the hand frame ring, in frames (about 2 s at the Leap's top rate)
+//!
+#define LEAP_HAND_FRAMES 256
 
 
 using namespace Leap;
@@ -37,8 +47,115 @@ using namespace Math;
 
 namespace Sensor
 {
+  //! @brief Read-only view of an 8-bit grayscale image stored row by row.  The pixels belong to
+  //!        whoever filled the view (the Leap image buffer or the LeapMotion object) and stay
+  //!        valid until that object next updates its images.
+  //!
+  struct LeapImageView
+  {
+    //! @brief The first pixel (NULL for an empty view)
+    //!
+    const unsigned char *data;
+
+    //! @brief Image dimensions, in pixels
+    //!
+    int width;
+    int height;
+
+    //! @brief Bytes from the start of one row to the start of the next
+    //!
+    int stride;
+
+    //! @brief Default constructor (empty view)
+    //!
+    LeapImageView () :
+      data(NULL),
+      width(0),
+      height(0),
+      stride(0)
+    {
+    }
+
+    //! @brief Pixel accessor
+    //!
+    unsigned char at (int row, int col) const
+    {
+      return data[(row * stride) + col];
+    }
+  };
+
+  //! @brief Skeleton of one tracked hand.  Positions are in mm and directions are unit vectors,
+  //!        both in the Leap frame (X right, Y up from the device, Z toward the user).
+  //!
+  struct LeapHandSkeleton
+  {
+    //! @brief The Leap's ID for the hand, kept while it stays in view
+    //!
+    int id;
+
+    //! @brief Whether this is a left hand
+    //!
+    bool left;
+
+    //! @brief How well the hand fits the tracking model (0 - 1)
+    //!
+    double confidence;
+
+    //! @brief Center of the palm, the palm's normal (down out of the palm), and the direction
+    //!        from the palm toward the fingers
+    //!
+    double palm[3];
+    double normal[3];
+    double direction[3];
+
+    //! @brief Tip of each finger, thumb (0) through pinky (4)
+    //!
+    double tips[5][3];
+
+    //! @brief How closed the hand is (0 open - 1 fist), and how closely the thumb and a finger
+    //!        are pinched (0 - 1)
+    //!
+    double grab;
+    double pinch;
+  };
+
+  //! @brief The hands of one Leap frame
+  //!
+  struct LeapHandFrame
+  {
+    //! @brief The Leap's frame counter and timestamp (us, device clock)
+    //!
+    long long frameId;
+    long long deviceTime;
+
+    //! @brief Time (s, ulapi_time) at which the frame was received
+    //!
+    double timestamp;
+
+    //! @brief Number of hands recorded (the first LEAP_HANDS_MAX in view)
+    //!
+    int handCount;
+    LeapHandSkeleton hands[LEAP_HANDS_MAX];
+  };
+
+  //! @brief Block matchers available to LeapMotion::getDepthMap
+  //!
+  typedef enum
+  {
+    LEAP_DEPTH_CPU = 0,
+    LEAP_DEPTH_CUDA
+  } LeapDepthBackend;
+
   class CrpiListener : public Listener {
     public:
+      //! @param handFrames Ring into which each frame's hands are pushed (NULL for none)
+      //!
+      CrpiListener(crpi_queue<LeapHandFrame> *handFrames = NULL);
+
+      //! @brief Number of hand frames dropped because the ring was full
+      //!
+      unsigned long dropped() const;
+
       virtual void onInit(const Controller&);
       virtual void onConnect(const Controller&);
       virtual void onDisconnect(const Controller&);
@@ -50,6 +167,11 @@ namespace Sensor
       virtual void onServiceConnect(const Controller&);
       virtual void onServiceDisconnect(const Controller&);
     private:
+      //! @brief Hand frame ring (the listener is its only producer), and the frame being filled
+      //!
+      crpi_queue<LeapHandFrame> *handFrames_;
+      LeapHandFrame working_;
+      std::atomic<unsigned long> dropped_;
   };
 
 
@@ -63,7 +185,10 @@ namespace Sensor
 
     //! @brief Default constructor
     //!
-    LeapMotion ();
+    //! @param depth The block matcher used for depth maps; LEAP_DEPTH_CUDA falls back to the CPU
+    //!              when no CUDA device is available (see depthBackend)
+    //!
+    LeapMotion (LeapDepthBackend depth = LEAP_DEPTH_CPU);
 
     //! @brief Default destructor
     //!
@@ -73,6 +198,25 @@ namespace Sensor
     //!
     bool getHands (HandList *hands);
 
+    //! @brief Take the oldest hand frame from the ring filled as frames arrive, so that every
+    //!        frame is seen once without copying the SDK's lists (one consumer thread only)
+    //!
+    //! @param frame   Populated with the hands of the frame
+    //! @param timeout Seconds to wait for a frame when none is waiting (0 to return at once,
+    //!                negative to wait indefinitely)
+    //!
+    //! @return True if a frame was taken, False otherwise
+    //!
+    bool getHandFrame (LeapHandFrame &frame, double timeout = 0.0);
+
+    //! @brief Number of hand frames waiting in the ring
+    //!
+    int handFramesWaiting () const;
+
+    //! @brief Number of hand frames dropped because the consumer fell a full ring behind
+    //!
+    unsigned long handFramesDropped () const;
+
     //! @brief Gesture model accessor
     //!
     bool getGestures (GestureList *gestures);
@@ -81,7 +225,19 @@ namespace Sensor
     //!
     bool getTools (ToolList *tools);
 
-    //! @brief Access the raw image stream from the two cameras
+    //! @brief Access the image stream from the two cameras without copying.  Raw views wrap
+    //!        the Leap image buffers; dewarped views wrap buffers owned by this object.  Either
+    //!        stays valid until the next call to getImages or getDepthMap.
+    //!
+    //! @param left   The image from the left camera
+    //! @param right  The image from the right camera
+    //! @param dewarp Whether or not to compensate for warping caused by the camera lenses
+    //!
+    //! @return True if method completes successfully, False otherwise
+    //!
+    bool getImages (LeapImageView &left, LeapImageView &right, bool dewarp = true);
+
+    //! @brief Access the image stream from the two cameras as copies (see above)
     //!
     //! @param left   The image from the left camera
     //! @param right  The image from the right camera
@@ -91,14 +247,32 @@ namespace Sensor
     //!
     bool getImages (Math::matrix& left, Math::matrix& right, bool dewarp = true);
 
-    //! @brief Depth map accessor
+    //! @brief Start computing a depth map from the current images.  With LEAP_DEPTH_CUDA, the
+    //!        upload, matching, and download are queued on a CUDA stream and this returns
+    //!        immediately, leaving the CPU free until getDepthMap collects the result.
     //!
-    //! @param out 
+    //! @return True if the images were available, False otherwise
+    //!
+    bool requestDepthMap ();
+
+    //! @brief Whether a requested depth map can be collected without waiting
+    //!
+    bool depthMapReady ();
+
+    //! @brief Depth map accessor.  Collects the map started by requestDepthMap (waiting for it
+    //!        if needed), or computes one from the current images if none was requested.  The
+    //!        matchers are kept between calls, so nothing is allocated once the map has its size.
+    //!
+    //! @param mapout Populated with the scaled disparity of each pixel (-1 where unknown)
     //!
     //! @return True if the function executes properly, False otherwise
     //!
     bool getDepthMap (Math::matrix& mapout);
 
+    //! @brief The block matcher in use
+    //!
+    LeapDepthBackend depthBackend () const;
+
   private:
     //! @brief Device controller
     //!
@@ -108,6 +282,10 @@ namespace Sensor
     //!
     CrpiListener *listener_;
 
+    //! @brief Hands of each frame, pushed by the listener
+    //!
+    crpi_queue<LeapHandFrame> *handFrames_;
+
     //! @brief Collection of identified hands
     //!
     HandList hands_;
@@ -124,6 +302,36 @@ namespace Sensor
     //!
     ImageList images_;
 
+    //! @brief The images last returned, left then right (keeps their buffers alive)
+    //!
+    Image raw_[2];
+
+    //! @brief Dewarped left and right images
+    //!
+    vector<unsigned char> dewarped_[2];
+
+    //! @brief For each dewarped pixel, the index of the raw pixel it samples (-1 outside the
+    //!        raw image).  The lens calibration is fixed, so the maps are only rebuilt when the
+    //!        image geometry changes (see warpKey_).
+    //!
+    vector<int> warpMap_[2];
+
+    //! @brief Image size and ray offsets and scales from which each warp map was built
+    //!
+    float warpKey_[2][6];
+
+    //! @brief Build (if needed) the warp map of one camera and dewarp its image
+    //!
+    //! @param camera 0 for the left camera, 1 for the right
+    //! @param out    Set to the dewarped image
+    //!
+    void dewarpImage (int camera, LeapImageView &out);
+
+    //! @brief Stereo matcher and disparity buffer (defined in LeapMotion.cpp)
+    //!
+    struct stereoState;
+    stereoState *stereo_;
+
   }; // LeapMotion
 } // Sensor namespace
 
@@ -14,6 +14,12 @@
 
 #include "MYO.h"
 
+#if defined(_MSC_VER)
+#include <crpi_hub.h>
+#elif defined(__GNUC__)
+#include "../../CRPI/crpi_hub.h"
+#endif
+
 #include <iostream>
 #include <stdexcept>
 #include <fstream>
@@ -54,21 +60,35 @@ namespace Sensor
   }
 
 
-  LIBRARY_API MyoObj::MyoObj()
+  LIBRARY_API MyoObj::MyoObj() :
+    bandCount_(0)
   {
     handle_ = ulapi_mutex_new(21);
+    for (int i = 0; i < MYO_ARMBANDS_MAX; ++i)
+    {
+      bands_[i] = NULL;
+    }
 
     //! Create new thread to force a constant polling of the Myo objects
-    task_ = ulapi_task_new();
-    ulapi_task_start((ulapi_task_struct*)task_, livemanMyo, this, ulapi_prio_lowest(), 0);
+    task_ = crpi_robot::SensorHub::Instance().StartLoop(livemanMyo, this, crpi_robot::HUB_SENSOR);
   }
 
 
   LIBRARY_API void MyoObj::onPair(myo::Myo* myo, uint64_t timestamp, myo::FirmwareVersion firmwareVersion)
   {
+    size_t count = bandCount_.load(std::memory_order_relaxed);
+    if (count >= MYO_ARMBANDS_MAX)
+    {
+      return;
+    }
+
     myo->setStreamEmg(myo::Myo::streamEmgEnabled);
     Myos_.push_back(myo);
 
+    //! The rings are allocated here, on the hub thread, so the callbacks never allocate
+    bands_[count] = new MyoBand();
+    bandCount_.store(count + 1, std::memory_order_release);
+
     ulapi_mutex_take(handle_);
     MyoSubject sub;
     subjects_.push_back(sub);
@@ -95,6 +115,11 @@ namespace Sensor
     if (index > 0)
     {
       --index;
+      MyoEmgSample sample;
+      sample.timestamp = timestamp;
+      memcpy(sample.emg, emg, sizeof(sample.emg));
+      bands_[index]->emg.push(sample);
+
       ulapi_mutex_take(handle_);
       for (int i = 0; i < 8; ++i)
       {
@@ -111,6 +136,12 @@ namespace Sensor
     if (index > 0)
     {
       --index;
+      MyoImuSample *sample = stageImu(index, timestamp, 2);
+      sample->accel[0] = accel.x();
+      sample->accel[1] = accel.y();
+      sample->accel[2] = accel.z();
+      publishImu(index);
+
       ulapi_mutex_take(handle_);
       subjects_.at(index).accelSamples.at(0) = accel.x();
       subjects_.at(index).accelSamples.at(1) = accel.y();
@@ -126,6 +157,12 @@ namespace Sensor
     if (index > 0)
     {
       --index;
+      MyoImuSample *sample = stageImu(index, timestamp, 4);
+      sample->gyro[0] = gyro.x();
+      sample->gyro[1] = gyro.y();
+      sample->gyro[2] = gyro.z();
+      publishImu(index);
+
       ulapi_mutex_take(handle_);
       subjects_.at(index).gyroSamples.at(0) = gyro.x();
       subjects_.at(index).gyroSamples.at(1) = gyro.y();
@@ -142,6 +179,13 @@ namespace Sensor
     {
       --index;
       //! Note:  our quaternion representation is (w, x, y, z) in vector format
+      MyoImuSample *sample = stageImu(index, timestamp, 1);
+      sample->orientation[0] = rotation.w();
+      sample->orientation[1] = rotation.x();
+      sample->orientation[2] = rotation.y();
+      sample->orientation[3] = rotation.z();
+      publishImu(index);
+
       ulapi_mutex_take(handle_);
       subjects_.at(index).orientSamples.at(0) = rotation.w();
       subjects_.at(index).orientSamples.at(1) = rotation.x();
@@ -194,7 +238,7 @@ namespace Sensor
   }
 
 
-  LIBRARY_API vector<MyoSubject>& MyoObj::getData()
+  LIBRARY_API vector<MyoSubject> MyoObj::getData()
   {
     vector<MyoSubject> temp;
     ulapi_mutex_take(handle_);
@@ -209,4 +253,69 @@ namespace Sensor
   }
 
 
+  LIBRARY_API size_t MyoObj::armbands() const
+  {
+    return bandCount_.load(std::memory_order_acquire);
+  }
+
+
+  LIBRARY_API size_t MyoObj::drain(size_t armband, vector<MyoEmgSample> &samples, size_t max)
+  {
+    if (armband >= bandCount_.load(std::memory_order_acquire))
+    {
+      return 0;
+    }
+    return bands_[armband]->emg.drain(samples, max);
+  }
+
+
+  LIBRARY_API size_t MyoObj::drain(size_t armband, vector<MyoImuSample> &samples, size_t max)
+  {
+    if (armband >= bandCount_.load(std::memory_order_acquire))
+    {
+      return 0;
+    }
+    return bands_[armband]->imu.drain(samples, max);
+  }
+
+
+  LIBRARY_API unsigned long MyoObj::dropped(size_t armband) const
+  {
+    if (armband >= bandCount_.load(std::memory_order_acquire))
+    {
+      return 0;
+    }
+    return bands_[armband]->emg.dropped() + bands_[armband]->imu.dropped();
+  }
+
+
+  LIBRARY_API MyoImuSample *MyoObj::stageImu(size_t index, uint64_t timestamp, int field)
+  {
+    MyoImuSample &pending = bands_[index]->pending;
+
+    //! The SDK reports the three parts of an IMU event back to back with one timestamp; a part
+    //! from a new event means the previous one will not be completed
+    if (pending.fields != 0 && (pending.timestamp != timestamp || (pending.fields & field) != 0))
+    {
+      bands_[index]->imu.push(pending);
+      pending.fields = 0;
+    }
+    pending.timestamp = timestamp;
+    pending.fields |= field;
+    return &pending;
+  }
+
+
+  LIBRARY_API void MyoObj::publishImu(size_t index)
+  {
+    MyoImuSample &pending = bands_[index]->pending;
+
+    if (pending.fields == 7)
+    {
+      bands_[index]->imu.push(pending);
+      pending.fields = 0;
+    }
+  }
+
+
 }
\ No newline at end of file
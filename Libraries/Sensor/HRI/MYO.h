@@ -23,6 +23,7 @@
 
 #include <array>
 #include <vector>
+#include <atomic>
 
 
 #include <string.h>
@@ -30,8 +31,150 @@
 
 using namespace std;
 
+#define MYO_ARMBANDS_MAX 4
+#define MYO_EMG_SAMPLES 1024
+#define MYO_IMU_SAMPLES 256
+
 namespace Sensor
 {
+  //! @brief One EMG reading from an armband (delivered at 200 Hz)
+  //!
+  struct MyoEmgSample
+  {
+    //! @brief Armband timestamp (microseconds)
+    //!
+    uint64_t timestamp;
+
+    //! @brief The eight EMG channels
+    //!
+    int8_t emg[8];
+  };
+
+  //! @brief One IMU reading from an armband (delivered at 50 Hz)
+  //!
+  struct MyoImuSample
+  {
+    //! @brief Armband timestamp (microseconds)
+    //!
+    uint64_t timestamp;
+
+    //! @brief Orientation (w, x, y, z)
+    //!
+    float orientation[4];
+
+    //! @brief Acceleration (x, y, z), in g
+    //!
+    float accel[3];
+
+    //! @brief Angular rate (x, y, z), in degrees per second
+    //!
+    float gyro[3];
+
+    //! @brief Which of orientation (1), accel (2), and gyro (4) were reported for this
+    //!        timestamp
+    //!
+    int fields;
+  };
+
+  //! @brief Fixed-capacity single-producer, single-consumer ring.  push never blocks or
+  //!        allocates:  when the consumer falls a full ring behind, new samples are dropped
+  //!        (and counted) rather than overwriting ones it may be reading.
+  //!
+  template <class T, size_t N> class MyoRing
+  {
+  public:
+    //! @brief Default constructor
+    //!
+    MyoRing() :
+      head_(0),
+      tail_(0),
+      dropped_(0)
+    {
+    }
+
+    //! @brief Append a sample (producer only)
+    //!
+    //! @return True if the sample was stored, false if the ring was full
+    //!
+    bool push(const T &sample)
+    {
+      size_t h = head_.load(std::memory_order_relaxed);
+
+      if (h - tail_.load(std::memory_order_acquire) >= N)
+      {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      data_[h % N] = sample;
+      head_.store(h + 1, std::memory_order_release);
+      return true;
+    }
+
+    //! @brief Move the waiting samples, oldest first, to the end of a vector (consumer only)
+    //!
+    //! @param out Vector to which the samples are appended
+    //! @param max Largest number of samples to move
+    //!
+    //! @return The number of samples moved
+    //!
+    size_t drain(vector<T> &out, size_t max = (size_t)-1)
+    {
+      size_t t = tail_.load(std::memory_order_relaxed);
+      size_t n = head_.load(std::memory_order_acquire) - t, i;
+
+      n = (n > max) ? max : n;
+      for (i = 0; i < n; ++i)
+      {
+        out.push_back(data_[(t + i) % N]);
+      }
+      tail_.store(t + n, std::memory_order_release);
+      return n;
+    }
+
+    //! @brief Number of samples waiting
+    //!
+    size_t size() const
+    {
+      return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    //! @brief Number of samples dropped because the ring was full
+    //!
+    unsigned long dropped() const
+    {
+      return dropped_.load(std::memory_order_relaxed);
+    }
+
+  private:
+    T data_[N];
+
+    //! @brief Producer and consumer positions, kept on separate cache lines
+    //!
+    std::atomic<size_t> head_;
+    char pad_[64];
+    std::atomic<size_t> tail_;
+
+    std::atomic<unsigned long> dropped_;
+  };
+
+  //! @brief Sample streams of one armband
+  //!
+  struct MyoBand
+  {
+    MyoRing<MyoEmgSample, MYO_EMG_SAMPLES> emg;
+    MyoRing<MyoImuSample, MYO_IMU_SAMPLES> imu;
+
+    //! @brief IMU reading being assembled from the orientation, accelerometer, and gyroscope
+    //!        callbacks (hub thread only)
+    //!
+    MyoImuSample pending;
+
+    MyoBand()
+    {
+      memset(&pending, 0, sizeof(pending));
+    }
+  };
+
   //! @brief Armband data container for reporting
   //!
   struct MyoSubject
@@ -195,7 +338,31 @@ namespace Sensor
     //!
     //! @return The most recent accelerometer, gyroscope, orientation, pose, and EMG data
     //!    
-    vector<MyoSubject>& getData();
+    vector<MyoSubject> getData();
+
+    //! @brief Number of armbands paired so far
+    //!
+    size_t armbands() const;
+
+    //! @brief Collect every EMG sample received from an armband since the last call, without
+    //!        blocking the hub thread.  Call from one consumer thread per armband.
+    //!
+    //! @param armband The armband's index (in pairing order, from 0)
+    //! @param samples Vector to which the samples are appended, oldest first
+    //! @param max     Largest number of samples to collect
+    //!
+    //! @return The number of samples collected
+    //!
+    size_t drain(size_t armband, vector<MyoEmgSample> &samples, size_t max = (size_t)-1);
+
+    //! @brief Collect every IMU sample received from an armband since the last call (see above)
+    //!
+    size_t drain(size_t armband, vector<MyoImuSample> &samples, size_t max = (size_t)-1);
+
+    //! @brief Number of samples from an armband lost because the consumer fell more than a
+    //!        ring (MYO_EMG_SAMPLES EMG or MYO_IMU_SAMPLES IMU samples) behind
+    //!
+    unsigned long dropped(size_t armband) const;
 
     //! @brief Collection of previously established Myo armbands connected to the computer
     //!
@@ -212,6 +379,26 @@ namespace Sensor
     //! @brief Thread object handler
     //!
     void *task_;
+
+  private:
+    //! @brief Sample rings of each paired armband (in pairing order), and the number published
+    //!
+    MyoBand *bands_[MYO_ARMBANDS_MAX];
+    std::atomic<size_t> bandCount_;
+
+    //! @brief Queue an IMU field, publishing the reading once it is complete or superseded
+    //!
+    //! @param index     The armband's index
+    //! @param timestamp Event timestamp
+    //! @param field     The field being reported (1, 2, or 4; see MyoImuSample::fields)
+    //!
+    //! @return The reading to fill in
+    //!
+    MyoImuSample *stageImu(size_t index, uint64_t timestamp, int field);
+
+    //! @brief Publish the staged IMU reading of an armband if it has all of its fields
+    //!
+    void publishImu(size_t index);
   };
 }
 
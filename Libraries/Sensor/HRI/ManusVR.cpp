@@ -1,8 +1,99 @@
 #include "ManusVR.h"
+
+#if defined(_MSC_VER)
+#include <crpi_hub.h>
+#elif defined(__GNUC__)
+#include "../../CRPI/crpi_hub.h"
+#endif
+#include <atomic>
 using namespace std;
 
 namespace Sensor
 {
+	//! @brief Two snapshots of a glove, filled alternately by the acquisition thread.  claimed is
+	//!        advanced before packet n is read into hands[n & 1] and written after, so a reader
+	//!        copying the newest snapshot can tell whether the thread moved on to overwrite it.
+	//!
+	struct ManusGloves::handFeed
+	{
+		manus_session_t session;
+		device_type_t device;
+		manus_hand_t hands[2];
+		double times[2];
+		std::atomic<unsigned long> claimed;
+		std::atomic<unsigned long> written;
+		std::atomic<bool> run;
+		void *task;
+
+		handFeed(manus_session_t sess, device_type_t dev) :
+			session(sess),
+			device(dev),
+			claimed(0),
+			written(0),
+			run(true),
+			task(NULL)
+		{
+		}
+
+		//! @brief Copy the newest snapshot (any thread)
+		//!
+		bool read(manus_hand_t &out, unsigned long *sequence, double *timestamp) const
+		{
+			unsigned long n;
+			double t;
+
+			do
+			{
+				n = written.load(std::memory_order_acquire);
+				if (n == 0)
+				{
+					return false;
+				}
+				memcpy((void*)&out, (const void*)&hands[n & 1], sizeof(manus_hand_t));
+				t = times[n & 1];
+				std::atomic_thread_fence(std::memory_order_acquire);
+			} while (claimed.load(std::memory_order_relaxed) > n + 1);
+
+			if (sequence != NULL)
+			{
+				*sequence = n;
+			}
+			if (timestamp != NULL)
+			{
+				*timestamp = t;
+			}
+			return true;
+		}
+	};
+
+
+	void ManusGloves::acquireHand(void *param)
+	{
+		handFeed *feed = (handFeed*)param;
+		unsigned long n;
+
+		while (feed->run)
+		{
+			if (!ManusIsConnected(feed->session, feed->device))
+			{
+				ulapi_sleep(0.1);
+				continue;
+			}
+
+			//! The SDK blocks until the next packet, which is read straight into the spare snapshot
+			n = feed->written.load(std::memory_order_relaxed);
+			feed->claimed.store(n + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			if (ManusGetHand(feed->session, feed->device, &feed->hands[(n + 1) & 1]) != MANUS_SUCCESS)
+			{
+				ulapi_sleep(0.01);
+				continue;
+			}
+			feed->times[(n + 1) & 1] = ulapi_time();
+			feed->written.store(n + 1, std::memory_order_release);
+		}
+	}
+
 
 	/* Methods for ManusGloves ---------------------------------------------------------------------*/
 	ManusGloves::ManusGloves()
@@ -19,12 +110,17 @@ namespace Sensor
 		formset = false;
 		rawset = false;
 
+		feeds_[0] = feeds_[1] = NULL;
+
 		//initializing manus session
 		ManusInit(sessp);
 	}
 
 	ManusGloves::~ManusGloves()
 	{
+		//acquisition threads use the session
+		StopAcquisition();
+
 		//exiting manus session
 		ManusExit(*sessp);
 
@@ -34,6 +130,76 @@ namespace Sensor
 		formatp = NULL;
 	}
 
+	bool ManusGloves::StartAcquisition(int handn)
+	{
+		for (int i = 0; i < 2; ++i)
+		{
+			if ((handn == 0 && i != 0) || (handn == 1 && i != 1) || feeds_[i] != NULL)
+			{
+				continue;
+			}
+			feeds_[i] = new handFeed(sess, (i == 0) ? GLOVE_LEFT : GLOVE_RIGHT);
+			feeds_[i]->task = crpi_robot::SensorHub::Instance().StartLoop(acquireHand, feeds_[i], crpi_robot::HUB_SENSOR);
+			if (feeds_[i]->task == NULL)
+			{
+				delete feeds_[i];
+				feeds_[i] = NULL;
+				return false;
+			}
+		}
+		return true;
+	}
+
+
+	void ManusGloves::StopAcquisition()
+	{
+		for (int i = 0; i < 2; ++i)
+		{
+			if (feeds_[i] == NULL)
+			{
+				continue;
+			}
+			feeds_[i]->run = false;
+			crpi_robot::SensorHub::Instance().JoinLoop(feeds_[i]->task);
+			delete feeds_[i];
+			feeds_[i] = NULL;
+		}
+	}
+
+
+	bool ManusGloves::GetLatestHand(manus_hand_t &formhand, int handn, unsigned long *sequence, double *timestamp) const
+	{
+		if (handn < 0 || handn > 1 || feeds_[handn] == NULL)
+		{
+			return false;
+		}
+		return feeds_[handn]->read(formhand, sequence, timestamp);
+	}
+
+
+	bool ManusGloves::GetLatestRawHand(manus_hand_raw_t &rawhand, int handn, unsigned long *sequence, double *timestamp) const
+	{
+		manus_hand_t current;
+
+		if (!GetLatestHand(current, handn, sequence, timestamp))
+		{
+			return false;
+		}
+		rawhand = current.raw;
+		return true;
+	}
+
+
+	unsigned long ManusGloves::GetSequence(int handn) const
+	{
+		if (handn < 0 || handn > 1 || feeds_[handn] == NULL)
+		{
+			return 0;
+		}
+		return feeds_[handn]->written.load(std::memory_order_acquire);
+	}
+
+
 	bool ManusGloves::allConnected()
 	{
 		bool isr, isl;
@@ -94,6 +260,17 @@ namespace Sensor
 			hand = GLOVE_RIGHT;
 		}
 
+		//latest snapshot, if the hand is being acquired in the background
+		if (feeds_[hand] != NULL && feeds_[hand]->read(*formatp, NULL, NULL))
+		{
+			if (formhand != NULL)
+			{
+				*formhand = *formatp;
+			}
+			formset = true;
+			return true;
+		}
+
 		//making sure hand is connected
 		while (!iscon)
 		{
@@ -110,8 +287,11 @@ namespace Sensor
 		//get data
 		ManusGetHand(*sessp, hand, formatp);
 
-		//set pointer and indicator bit
-		formhand = formatp;
+		//copy out and set indicator bit
+		if (formhand != NULL)
+		{
+			*formhand = *formatp;
+		}
 		formset = true;
 
 		return true;
@@ -133,6 +313,19 @@ namespace Sensor
 			hand = GLOVE_RIGHT;
 		}
 
+		//latest snapshot, if the hand is being acquired in the background
+		manus_hand_t latest;
+		if (feeds_[hand] != NULL && feeds_[hand]->read(latest, NULL, NULL))
+		{
+			*rawp = latest.raw;
+			if (rawpt != NULL)
+			{
+				*rawpt = *rawp;
+			}
+			rawset = true;
+			return true;
+		}
+
 		//making sure hand is connected
 		while (!iscon)
 		{
@@ -149,8 +342,11 @@ namespace Sensor
 		//get data
 		ManusGetHandRaw(*sessp, hand, rawp);
 
-		//set pointer and indicator bit
-		rawpt = rawp;
+		//copy out and set indicator bit
+		if (rawpt != NULL)
+		{
+			*rawpt = *rawp;
+		}
 		rawset = true;
 
 		return true;
@@ -19,8 +19,10 @@
 #include <iostream>
 #if defined(_MSC_VER)
 #include "..\..\Libraries\ThirdParty\Manus\Manus.h"
+#include <ulapi.h>
 #else
 #include "../../ThirdParty/Manus/Manus.h"
+#include "../../ulapi/src/ulapi.h"
 #endif
 
 
@@ -65,7 +67,45 @@ namespace Sensor
 		//!
 		bool isConnected(int handn);
 
-		//! @brief Formated hand output getter
+		//! @brief Start a background thread per glove that reads each new packet from the SDK into
+		//!        a double-buffered snapshot, so that the hand getters return the latest state
+		//!        without waiting on the SDK.  SendVibration still goes to the SDK directly.
+		//!
+		//! @param handn		which glove to acquire, 0 for left, 1 for right - any other values (say, 2) start both
+		//!
+		//! @return True if the threads are running, false otherwise
+		//!
+		bool StartAcquisition(int handn = 2);
+
+		//! @brief Stop the background acquisition threads (also done by the destructor)
+		//!
+		void StopAcquisition();
+
+		//! @brief Latest formatted hand read by the acquisition thread, without calling the SDK
+		//!
+		//! @param formhand		populated with the hand (which also holds its raw data)
+		//! @param handn		which hand to obtain, 0 for left, 1 for right
+		//! @param sequence		if not NULL, set to the number of packets acquired for the hand so far
+		//! @param timestamp	if not NULL, set to the time (ulapi_time, s) at which the packet was received
+		//!
+		//! @return True if the hand is being acquired and a packet has arrived, false otherwise
+		//!
+		bool GetLatestHand(manus_hand_t &formhand, int handn, unsigned long *sequence = NULL, double *timestamp = NULL) const;
+
+		//! @brief Latest raw hand read by the acquisition thread (see GetLatestHand)
+		//!
+		bool GetLatestRawHand(manus_hand_raw_t &rawhand, int handn, unsigned long *sequence = NULL, double *timestamp = NULL) const;
+
+		//! @brief Number of packets acquired for a hand, e.g. to tell whether a new one has
+		//!        arrived since the last read
+		//!
+		//! @param handn		which hand, 0 for left, 1 for right
+		//!
+		//! @return The packet count (0 if the hand is not being acquired)
+		//!
+		unsigned long GetSequence(int handn) const;
+
+		//! @brief Formated hand output getter (from the acquisition thread's snapshot while it runs)
 		//!
 		//! @param formhand		pointer to hand object, returns hand to both format and the pointer object refered to 
 		//! @param handn		which hand to obtain, 0 for left, 1 for right - any other values (say, 2), Hand will be whichever it was most recently set to
@@ -74,7 +114,7 @@ namespace Sensor
 		//!
 		bool GetHand(manus_hand_t* formhand, int handn);
 
-		//! @brief Raw hand output getter
+		//! @brief Raw hand output getter (from the acquisition thread's snapshot while it runs)
 		//!
 		//! @param rawpt		pointer to raw hand object, returns hand to both format and the pointer object refered to 
 		//! @param handn		which hand to obtain, 0 for left, 1 for right - any other values (say, 2), Hand will be whichever it was most recently set to
@@ -146,6 +186,20 @@ namespace Sensor
 		bool formset;
 		bool rawset;
 
+		//! @breif Double-buffered snapshot of one glove, written by its acquisition thread
+		//!        (defined in ManusVR.cpp)
+		//!
+		struct handFeed;
+
+		//! @breif Acquisition state of the left and right gloves (NULL when not acquired)
+		//!
+		handFeed *feeds_[2];
+
+		//! @breif Acquisition thread of one glove
+		//!
+		//! @param param		The handFeed being served
+		//!
+		static void acquireHand(void *param);
 
 	};
 
@@ -0,0 +1,315 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: CRPI
+//  Subsystem:       Human-Robot Interaction
+//  Workfile:        MyoFeatures.cpp
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Sliding-window EMG feature extraction for the Myo armband.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MyoFeatures.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MYOFEATURES_SSE2
+#endif
+
+namespace Sensor
+{
+  //! Terms of one sample, all eight channels at a time.  A sample contributes its square and
+  //! magnitude, a zero crossing and the absolute difference with the sample before it, and a
+  //! slope sign change at the sample before it (between that one's neighbors).  The window's
+  //! sums cover the amplitude terms of every sample in it, the pair terms of all but the
+  //! oldest, and the triple terms of all but the oldest two.
+#if defined(MYOFEATURES_SSE2)
+  static inline __m128i absEpi16(__m128i v)
+  {
+    return _mm_max_epi16(v, _mm_sub_epi16(_mm_setzero_si128(), v));
+  }
+
+
+  static inline __m128i loadSample(const int16_t *x)
+  {
+    return _mm_loadu_si128((const __m128i *)x);
+  }
+
+
+  //! Terms of x (and of the preceding a and b, if not NULL) for sums_ 0 to 4
+  static inline void sampleTerms(const int16_t *a, const int16_t *b, const int16_t *x, __m128i thr,
+                                 __m128i terms[5])
+  {
+    __m128i zero = _mm_setzero_si128(), vx = loadSample(x), vb, d, d1, d2, slope, small;
+
+    terms[0] = _mm_mullo_epi16(vx, vx);
+    terms[1] = absEpi16(vx);
+    terms[2] = terms[3] = terms[4] = zero;
+    if (b == NULL)
+    {
+      return;
+    }
+    vb = loadSample(b);
+    d = absEpi16(_mm_sub_epi16(vx, vb));
+    small = _mm_cmplt_epi16(d, thr);
+    terms[2] = _mm_srli_epi16(_mm_andnot_si128(small, _mm_cmplt_epi16(_mm_mullo_epi16(vx, vb), zero)), 15);
+    terms[4] = d;
+    if (a == NULL)
+    {
+      return;
+    }
+    d1 = _mm_sub_epi16(vb, loadSample(a));
+    d2 = _mm_sub_epi16(vb, vx);
+    slope = _mm_or_si128(_mm_and_si128(_mm_cmpgt_epi16(d1, zero), _mm_cmpgt_epi16(d2, zero)),
+                         _mm_and_si128(_mm_cmplt_epi16(d1, zero), _mm_cmplt_epi16(d2, zero)));
+    small = _mm_cmplt_epi16(_mm_max_epi16(absEpi16(d1), absEpi16(d2)), thr);
+    terms[3] = _mm_srli_epi16(_mm_andnot_si128(small, slope), 15);
+  }
+
+
+  //! sum += delta, widening the 16-bit differences
+  static inline void accumulate(int32_t *sum, __m128i delta)
+  {
+    __m128i sign = _mm_srai_epi16(delta, 15);
+    __m128i *s = (__m128i *)sum;
+    _mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), _mm_unpacklo_epi16(delta, sign)));
+    _mm_storeu_si128(s + 1, _mm_add_epi32(_mm_loadu_si128(s + 1), _mm_unpackhi_epi16(delta, sign)));
+  }
+#else
+  static inline void sampleTerms(const int16_t *a, const int16_t *b, const int16_t *x, int thr,
+                                 int terms[5][MYO_EMG_CHANNELS])
+  {
+    int c, d, d1, d2;
+
+    for (c = 0; c < MYO_EMG_CHANNELS; ++c)
+    {
+      terms[0][c] = x[c] * x[c];
+      terms[1][c] = (x[c] < 0) ? -x[c] : x[c];
+      terms[2][c] = terms[3][c] = terms[4][c] = 0;
+      if (b == NULL)
+      {
+        continue;
+      }
+      d = (x[c] > b[c]) ? x[c] - b[c] : b[c] - x[c];
+      terms[2][c] = ((x[c] * b[c]) < 0 && d >= thr) ? 1 : 0;
+      terms[4][c] = d;
+      if (a == NULL)
+      {
+        continue;
+      }
+      d1 = b[c] - a[c];
+      d2 = b[c] - x[c];
+      terms[3][c] = (((d1 > 0 && d2 > 0) || (d1 < 0 && d2 < 0)) &&
+                     ((d1 < 0 ? -d1 : d1) >= thr || (d2 < 0 ? -d2 : d2) >= thr)) ? 1 : 0;
+    }
+  }
+#endif
+
+
+  LIBRARY_API MyoFeatures::MyoFeatures(int window, int features, int threshold) :
+    features_(features & MYO_FEATURE_ALL),
+    threshold_(threshold < 0 ? 0 : threshold)
+  {
+    //! The squares of a full window must fit in 32 bits
+    window_ = (window < 3) ? 3 : ((window > 65536) ? 65536 : window);
+    ring_.resize(window_ * MYO_EMG_CHANNELS);
+    reset();
+  }
+
+
+  LIBRARY_API MyoFeatures::~MyoFeatures()
+  {
+  }
+
+
+  LIBRARY_API void MyoFeatures::push(const int8_t *emg)
+  {
+    const int16_t *oldest[3] = {NULL, NULL, NULL}, *prev = NULL, *prev2 = NULL;
+    int16_t x[MYO_EMG_CHANNELS];
+    int c;
+
+    for (c = 0; c < MYO_EMG_CHANNELS; ++c)
+    {
+      x[c] = emg[c];
+    }
+    if (count_ > 0)
+    {
+      prev = at(count_ - 1);
+    }
+    if (count_ > 1)
+    {
+      prev2 = at(count_ - 2);
+    }
+    if (count_ == window_)
+    {
+      //! The oldest sample leaves, and the next two lose their links to it
+      oldest[0] = at(0);
+      oldest[1] = at(1);
+      oldest[2] = at(2);
+    }
+
+#if defined(MYOFEATURES_SSE2)
+    __m128i thr = _mm_set1_epi16((short)(threshold_ > 32767 ? 32767 : threshold_));
+    __m128i add[5], drop[5], amp[5], pair[5];
+
+    sampleTerms(prev2, prev, x, thr, add);
+    if (oldest[0] != NULL)
+    {
+      //! Amplitude terms of the oldest, the pair terms of the next, and the triple terms of
+      //! the one after that
+      sampleTerms(NULL, NULL, oldest[0], thr, amp);
+      sampleTerms(NULL, oldest[0], oldest[1], thr, pair);
+      sampleTerms(oldest[0], oldest[1], oldest[2], thr, drop);
+      drop[0] = amp[0];
+      drop[1] = amp[1];
+      drop[2] = pair[2];
+      drop[4] = pair[4];
+      for (c = 0; c < 5; ++c)
+      {
+        add[c] = _mm_sub_epi16(add[c], drop[c]);
+      }
+    }
+    for (c = 0; c < 5; ++c)
+    {
+      accumulate(sums_[c], add[c]);
+    }
+#else
+    int add[5][MYO_EMG_CHANNELS], amp[5][MYO_EMG_CHANNELS], pair[5][MYO_EMG_CHANNELS],
+        drop[5][MYO_EMG_CHANNELS], k;
+
+    sampleTerms(prev2, prev, x, threshold_, add);
+    if (oldest[0] != NULL)
+    {
+      sampleTerms(NULL, NULL, oldest[0], threshold_, amp);
+      sampleTerms(NULL, oldest[0], oldest[1], threshold_, pair);
+      sampleTerms(oldest[0], oldest[1], oldest[2], threshold_, drop);
+      for (c = 0; c < MYO_EMG_CHANNELS; ++c)
+      {
+        add[0][c] -= amp[0][c];
+        add[1][c] -= amp[1][c];
+        add[2][c] -= pair[2][c];
+        add[3][c] -= drop[3][c];
+        add[4][c] -= pair[4][c];
+      }
+    }
+    for (k = 0; k < 5; ++k)
+    {
+      for (c = 0; c < MYO_EMG_CHANNELS; ++c)
+      {
+        sums_[k][c] += add[k][c];
+      }
+    }
+#endif
+
+    //! When the window is full, the new sample takes the oldest one's slot
+    memcpy(&ring_[next_ * MYO_EMG_CHANNELS], x, sizeof(x));
+    next_ = (next_ + 1) % window_;
+    if (count_ < window_)
+    {
+      ++count_;
+    }
+  }
+
+
+  LIBRARY_API void MyoFeatures::push(const MyoEmgSample &sample)
+  {
+    push(sample.emg);
+  }
+
+
+  LIBRARY_API void MyoFeatures::push(const vector<MyoEmgSample> &samples)
+  {
+    vector<MyoEmgSample>::const_iterator iter;
+
+    for (iter = samples.begin(); iter != samples.end(); ++iter)
+    {
+      push(iter->emg);
+    }
+  }
+
+
+  LIBRARY_API void MyoFeatures::reset()
+  {
+    count_ = 0;
+    next_ = 0;
+    memset(sums_, 0, sizeof(sums_));
+  }
+
+
+  LIBRARY_API bool MyoFeatures::ready() const
+  {
+    return count_ == window_;
+  }
+
+
+  LIBRARY_API int MyoFeatures::samples() const
+  {
+    return count_;
+  }
+
+
+  LIBRARY_API int MyoFeatures::size() const
+  {
+    int n = 0;
+
+    for (int k = 0; k < 5; ++k)
+    {
+      n += ((features_ >> k) & 1) ? MYO_EMG_CHANNELS : 0;
+    }
+    return n;
+  }
+
+
+  LIBRARY_API void MyoFeatures::extract(double *out) const
+  {
+    double n = (count_ > 0) ? (double)count_ : 1.0;
+    int k, c;
+
+    for (k = 0; k < 5; ++k)
+    {
+      if (((features_ >> k) & 1) == 0)
+      {
+        continue;
+      }
+      for (c = 0; c < MYO_EMG_CHANNELS; ++c, ++out)
+      {
+        switch (k)
+        {
+        case 0:
+          *out = sqrt(sums_[k][c] / n);
+          break;
+        case 1:
+          *out = sums_[k][c] / n;
+          break;
+        default:
+          //! Counts and waveform length are totals over the window
+          *out = (double)sums_[k][c];
+          break;
+        }
+      }
+    }
+  }
+
+
+  LIBRARY_API void MyoFeatures::extract(vector<double> &out) const
+  {
+    out.resize(size());
+    if (!out.empty())
+    {
+      extract(&out[0]);
+    }
+  }
+
+
+  const int16_t *MyoFeatures::at(int k) const
+  {
+    int slot = (next_ - count_ + k + window_) % window_;
+    return &ring_[slot * MYO_EMG_CHANNELS];
+  }
+} // Sensor namespace
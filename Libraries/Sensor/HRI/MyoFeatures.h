@@ -0,0 +1,127 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: CRPI
+//  Subsystem:       Human-Robot Interaction
+//  Workfile:        MyoFeatures.h
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Sliding-window EMG feature extraction for the Myo armband.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MYOFEATURES_H
+#define MYOFEATURES_H
+
+#include "MYO.h"
+
+#define MYO_EMG_CHANNELS 8
+
+namespace Sensor
+{
+  //! @brief Windowed EMG features (combined as a bit mask)
+  //!
+  typedef enum
+  {
+    MYO_FEATURE_RMS = 1,  //! Root mean square
+    MYO_FEATURE_MAV = 2,  //! Mean absolute value
+    MYO_FEATURE_ZC = 4,   //! Zero crossings
+    MYO_FEATURE_SSC = 8,  //! Slope sign changes
+    MYO_FEATURE_WL = 16,  //! Waveform length
+    MYO_FEATURE_ALL = 31
+  } MyoFeature;
+
+  //! @ingroup Sensor
+  //!
+  //! @brief Incremental time-domain features of the eight EMG channels over a sliding window of
+  //!        the most recent samples.  Each sample adds its own terms to running per-channel sums
+  //!        and removes those of the sample leaving the window, so an update costs the same for
+  //!        any window length.  The sums are kept in integers (EMG samples are 8-bit), so they
+  //!        never drift, and all eight channels are updated together with SSE2 where available.
+  //!
+  class LIBRARY_API MyoFeatures
+  {
+  public:
+    //! @brief Default constructor
+    //!
+    //! @param window    Number of samples in the window (3 to 65536; 40 is 200 ms of EMG)
+    //! @param features  Features to extract (MyoFeature values combined with |)
+    //! @param threshold Smallest amplitude step counted as a zero crossing or slope sign change,
+    //!                  to reject noise
+    //!
+    MyoFeatures(int window = 40, int features = MYO_FEATURE_ALL, int threshold = 0);
+
+    //! @brief Default destructor
+    //!
+    ~MyoFeatures();
+
+    //! @brief Add the next EMG sample to the window
+    //!
+    //! @param emg The eight channel readings
+    //!
+    void push(const int8_t *emg);
+    void push(const MyoEmgSample &sample);
+
+    //! @brief Add a run of samples (e.g., those collected by MyoObj::drain), oldest first
+    //!
+    void push(const vector<MyoEmgSample> &samples);
+
+    //! @brief Empty the window
+    //!
+    void reset();
+
+    //! @brief Whether the window is full
+    //!
+    bool ready() const;
+
+    //! @brief Number of samples currently in the window
+    //!
+    int samples() const;
+
+    //! @brief Length of the feature vector:  eight values (one per channel) for each feature
+    //!        selected
+    //!
+    int size() const;
+
+    //! @brief Compute the features of the current window.  The vector holds the eight channels
+    //!        of each selected feature in turn, in MyoFeature order, and can be passed directly
+    //!        to Clustering::kMeans::evalPattern (with an fdim of size()).
+    //!
+    //! @param out Populated by the function with size() values
+    //!
+    void extract(double *out) const;
+    void extract(vector<double> &out) const;
+
+  private:
+    //! @brief Window length and selected features
+    //!
+    int window_;
+    int features_;
+
+    //! @brief Step threshold for zero crossings and slope sign changes
+    //!
+    int threshold_;
+
+    //! @brief Samples in the window, and the slot for the next one
+    //!
+    int count_;
+    int next_;
+
+    //! @brief Ring of the windowed samples, widened to 16 bits (window_ x 8)
+    //!
+    vector<int16_t> ring_;
+
+    //! @brief Running sums of each channel:  squares, magnitudes, zero crossings, slope sign
+    //!        changes, and absolute differences
+    //!
+    int32_t sums_[5][MYO_EMG_CHANNELS];
+
+    //! @brief The sample k places after the oldest in the window
+    //!
+    const int16_t *at(int k) const;
+  }; // MyoFeatures
+} // Sensor namespace
+
+#endif
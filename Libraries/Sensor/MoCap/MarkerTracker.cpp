@@ -0,0 +1,506 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: CRPI
+//  Subsystem:       Motion Capture Sensor
+//  Workfile:        MarkerTracker.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Frame-to-frame tracking of unlabeled motion capture markers.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MarkerTracker.h"
+
+namespace Sensor
+{
+  //! @brief Cost of a pairing that is not allowed (finite, so the dual updates stay finite)
+  //!
+  static const double trackForbidden = 1.0e15;
+
+  //! @brief Grid cells further than this from the origin (in cells) are folded onto the edge
+  //!        cell, keeping the integer cell coordinates in range
+  //!
+  static const double trackCellLimit = 1.0e8;
+
+
+  //! @brief Hash of a grid cell
+  //!
+  static inline unsigned int trackHash (int x, int y, int z)
+  {
+    return ((unsigned int)x * 73856093u) ^ ((unsigned int)y * 19349663u) ^ ((unsigned int)z * 83492791u);
+  }
+
+
+  //! @brief Grid cell coordinate of a position
+  //!
+  static inline int trackCell (double v, double inverse)
+  {
+    v = floor(v * inverse);
+    return (int)((v > trackCellLimit) ? trackCellLimit : ((v < -trackCellLimit) ? -trackCellLimit : v));
+  }
+
+
+  //! @brief Whether a marker has a position (occluded markers may be reported as NaN)
+  //!
+  static inline bool trackFinite (const point &p)
+  {
+    return fabs(p.x) < HUGE_VAL && fabs(p.y) < HUGE_VAL && fabs(p.z) < HUGE_VAL;
+  }
+
+
+  LIBRARY_API MarkerTracker::MarkerTracker (double gate, int maxMissed) :
+    gate_(gate),
+    maxMissed_(maxMissed),
+    beta_(0.5),
+    nextId_(0),
+    lastTime_(0.0),
+    started_(false),
+    mask_(0)
+  {
+  }
+
+
+  LIBRARY_API MarkerTracker::~MarkerTracker ()
+  {
+  }
+
+
+  LIBRARY_API void MarkerTracker::SetGate (double gate)
+  {
+    gate_ = gate;
+  }
+
+
+  LIBRARY_API void MarkerTracker::SetMaxMissed (int maxMissed)
+  {
+    maxMissed_ = maxMissed;
+  }
+
+
+  LIBRARY_API void MarkerTracker::SetSmoothing (double beta)
+  {
+    beta_ = (beta < 0.0) ? 0.0 : ((beta > 1.0) ? 1.0 : beta);
+  }
+
+
+  LIBRARY_API int MarkerTracker::Update (const vector<point> &markers, double timestamp)
+  {
+    return Update(markers.empty() ? NULL : &markers[0], (int)markers.size(), timestamp);
+  }
+
+
+  LIBRARY_API int MarkerTracker::Update (const MoCapFrame &frame)
+  {
+    return Update(frame.markers + frame.firstUnlabeled, frame.unlabeledCount, frame.timestamp);
+  }
+
+
+  LIBRARY_API int MarkerTracker::Update (const point *markers, int count, double timestamp)
+  {
+    int numTracks = (int)tracks_.size(), t, j, e, g, numGroups, x, y, z, s, kept, lo[3];
+    double dt = started_ ? (timestamp - lastTime_) : 0.0, inverse, g2, d2, dx, dy, dz, c;
+    point residual;
+    unsigned int h;
+
+    dt = (dt > 0.0) ? dt : 0.0;
+    lastTime_ = timestamp;
+    started_ = true;
+    inverse = (gate_ > 0.0) ? 0.5 / gate_ : 0.0;
+    g2 = gate_ * gate_;
+
+    //! Constant velocity prediction (tracks that are not matched keep it)
+    for (t = 0; t < numTracks; ++t)
+    {
+      tracks_[t].position.x += tracks_[t].velocity.x * dt;
+      tracks_[t].position.y += tracks_[t].velocity.y * dt;
+      tracks_[t].position.z += tracks_[t].velocity.z * dt;
+    }
+
+    //! Candidate pairs:  the markers within the gate of each prediction.  Cells are twice the
+    //! gate wide, so the gate around a prediction spans two cells on each axis:  its own and the
+    //! neighbour on the side it is nearer.
+    bin(markers, count);
+    edgeTrack_.clear();
+    edgeMarker_.clear();
+    edgeCost_.clear();
+    for (t = 0; t < numTracks && gate_ > 0.0 && count > 0; ++t)
+    {
+      const point &p = tracks_[t].position;
+      if (!trackFinite(p))
+      {
+        continue;
+      }
+      const double *axis[3] = {&p.x, &p.y, &p.z};
+      for (j = 0; j < 3; ++j)
+      {
+        c = *axis[j] * inverse;
+        lo[j] = trackCell(*axis[j], inverse);
+        lo[j] -= ((c - floor(c)) < 0.5) ? 1 : 0;
+      }
+      for (x = lo[0]; x <= lo[0] + 1; ++x)
+      {
+        for (y = lo[1]; y <= lo[1] + 1; ++y)
+        {
+          for (z = lo[2]; z <= lo[2] + 1; ++z)
+          {
+            h = trackHash(x, y, z) & mask_;
+            for (s = bucketStart_[h]; s < bucketStart_[h + 1]; ++s)
+            {
+              j = sorted_[s];
+              if (cells_[(j * 3)] != x || cells_[(j * 3) + 1] != y || cells_[(j * 3) + 2] != z)
+              {
+                continue;
+              }
+              dx = markers[j].x - p.x;
+              dy = markers[j].y - p.y;
+              dz = markers[j].z - p.z;
+              d2 = (dx * dx) + (dy * dy) + (dz * dz);
+              if (d2 <= g2)
+              {
+                edgeTrack_.push_back(t);
+                edgeMarker_.push_back(j);
+                edgeCost_.push_back(d2);
+              }
+            }
+          }
+        }
+      }
+    }
+
+    //! Groups of tracks and markers connected by candidate pairs, each assigned on its own
+    parent_.resize(numTracks + count);
+    for (j = 0; j < numTracks + count; ++j)
+    {
+      parent_[j] = j;
+    }
+    for (e = 0; e < (int)edgeTrack_.size(); ++e)
+    {
+      t = root(edgeTrack_[e]);
+      j = root(numTracks + edgeMarker_[e]);
+      if (t != j)
+      {
+        parent_[j] = t;
+      }
+    }
+    groupOf_.assign(numTracks + count, -1);
+    groupStart_.assign(1, 0);
+    numGroups = 0;
+    for (e = 0; e < (int)edgeTrack_.size(); ++e)
+    {
+      t = root(edgeTrack_[e]);
+      if (groupOf_[t] < 0)
+      {
+        groupOf_[t] = numGroups++;
+        groupStart_.push_back(0);
+      }
+      ++groupStart_[groupOf_[t] + 1];
+    }
+    for (g = 0; g < numGroups; ++g)
+    {
+      groupStart_[g + 1] += groupStart_[g];
+    }
+    groupEdges_.resize(edgeTrack_.size());
+    match_.assign(groupStart_.begin(), groupStart_.end() - 1);
+    for (e = 0; e < (int)edgeTrack_.size(); ++e)
+    {
+      groupEdges_[match_[groupOf_[root(edgeTrack_[e])]]++] = e;
+    }
+
+    trackMarker_.assign(numTracks, -1);
+    markerTrack_.assign(count, -1);
+    for (g = 0; g < numGroups; ++g)
+    {
+      assign(g);
+    }
+
+    //! Matched tracks take their markers; the velocity moves toward the measured one (straight
+    //! to it on a track's second sighting)
+    for (t = 0; t < numTracks; ++t)
+    {
+      MarkerTrack &track = tracks_[t];
+      j = trackMarker_[t];
+      track.marker = j;
+      if (j < 0)
+      {
+        ++track.missed;
+        continue;
+      }
+      if (dt > 0.0)
+      {
+        double beta = (track.hits == 1) ? 1.0 : beta_;
+        residual.x = markers[j].x - track.position.x;
+        residual.y = markers[j].y - track.position.y;
+        residual.z = markers[j].z - track.position.z;
+        track.velocity.x += beta * residual.x / dt;
+        track.velocity.y += beta * residual.y / dt;
+        track.velocity.z += beta * residual.z / dt;
+      }
+      track.position = markers[j];
+      ++track.hits;
+      track.missed = 0;
+    }
+
+    //! Drop tracks missing too long (keeping the order), and start tracks for the unmatched
+    //! markers
+    for (t = 0, kept = 0; t < numTracks; ++t)
+    {
+      if (tracks_[t].missed <= maxMissed_)
+      {
+        if (kept != t)
+        {
+          tracks_[kept] = tracks_[t];
+        }
+        ++kept;
+      }
+    }
+    tracks_.resize(kept);
+    markerIds_.assign(count, -1);
+    for (t = 0; t < kept; ++t)
+    {
+      if (tracks_[t].marker >= 0)
+      {
+        markerIds_[tracks_[t].marker] = tracks_[t].id;
+      }
+    }
+    for (j = 0; j < count; ++j)
+    {
+      if (markerTrack_[j] >= 0 || !trackFinite(markers[j]))
+      {
+        continue;
+      }
+      MarkerTrack track;
+      track.id = nextId_++;
+      track.position = markers[j];
+      track.velocity = point(0.0, 0.0, 0.0);
+      track.hits = 1;
+      track.missed = 0;
+      track.marker = j;
+      tracks_.push_back(track);
+      markerIds_[j] = track.id;
+    }
+
+    return (int)tracks_.size();
+  }
+
+
+  LIBRARY_API const vector<MarkerTrack> &MarkerTracker::Tracks () const
+  {
+    return tracks_;
+  }
+
+
+  LIBRARY_API const vector<int> &MarkerTracker::MarkerIds () const
+  {
+    return markerIds_;
+  }
+
+
+  LIBRARY_API void MarkerTracker::Reset ()
+  {
+    tracks_.clear();
+    markerIds_.clear();
+    started_ = false;
+  }
+
+
+  void MarkerTracker::bin (const point *markers, int count)
+  {
+    unsigned int buckets = 1, hash;
+    double inverse = (gate_ > 0.0) ? 0.5 / gate_ : 0.0;
+    int i;
+
+    //! At least two buckets per marker keeps the chains short
+    while (buckets < (unsigned int)(count * 2))
+    {
+      buckets <<= 1;
+    }
+    mask_ = buckets - 1;
+
+    cells_.resize(count * 3);
+    bucketStart_.assign(buckets + 1, 0);
+    sorted_.resize(count);
+    way_.resize(count);
+    for (i = 0; i < count; ++i)
+    {
+      if (!trackFinite(markers[i]))
+      {
+        way_[i] = -1;
+        continue;
+      }
+      cells_[(i * 3)] = trackCell(markers[i].x, inverse);
+      cells_[(i * 3) + 1] = trackCell(markers[i].y, inverse);
+      cells_[(i * 3) + 2] = trackCell(markers[i].z, inverse);
+      hash = trackHash(cells_[(i * 3)], cells_[(i * 3) + 1], cells_[(i * 3) + 2]) & mask_;
+      way_[i] = (int)hash;
+      ++bucketStart_[hash + 1];
+    }
+
+    //! Counting sort of the markers by bucket
+    for (i = 0; i < (int)buckets; ++i)
+    {
+      bucketStart_[i + 1] += bucketStart_[i];
+    }
+    match_.assign(bucketStart_.begin(), bucketStart_.end() - 1);
+    for (i = 0; i < count; ++i)
+    {
+      if (way_[i] >= 0)
+      {
+        sorted_[match_[way_[i]]++] = i;
+      }
+    }
+  }
+
+
+  void MarkerTracker::assign (int group)
+  {
+    int first = groupStart_[group], last = groupStart_[group + 1], e, a, b, n, T, M, i, j, i0, j0, j1;
+    double half, delta, cur;
+
+    //! Most groups are one track and one marker
+    if (last - first == 1)
+    {
+      e = groupEdges_[first];
+      trackMarker_[edgeTrack_[e]] = edgeMarker_[e];
+      markerTrack_[edgeMarker_[e]] = edgeTrack_[e];
+      return;
+    }
+
+    //! The group's tracks and markers, numbered locally (trackMarker_ and markerTrack_ hold the
+    //! local numbers until the group is solved)
+    localTracks_.clear();
+    localMarkers_.clear();
+    for (e = first; e < last; ++e)
+    {
+      a = edgeTrack_[groupEdges_[e]];
+      b = edgeMarker_[groupEdges_[e]];
+      if (trackMarker_[a] == -1)
+      {
+        trackMarker_[a] = -2 - (int)localTracks_.size();
+        localTracks_.push_back(a);
+      }
+      if (markerTrack_[b] == -1)
+      {
+        markerTrack_[b] = -2 - (int)localMarkers_.size();
+        localMarkers_.push_back(b);
+      }
+    }
+    T = (int)localTracks_.size();
+    M = (int)localMarkers_.size();
+    n = T + M;
+
+    //! Square cost matrix:  tracks against markers (the squared distance), each track against
+    //! its own "missed" column and each marker against its own "new track" row (half the
+    //! squared gate each, so a pair within the gate is always worth matching), and the unused
+    //! missed/new slots against each other at no cost
+    half = 0.5 * gate_ * gate_;
+    cost_.assign(n * n, trackForbidden);
+    for (e = first; e < last; ++e)
+    {
+      i = -2 - trackMarker_[edgeTrack_[groupEdges_[e]]];
+      j = -2 - markerTrack_[edgeMarker_[groupEdges_[e]]];
+      cost_[(i * n) + j] = edgeCost_[groupEdges_[e]];
+    }
+    for (i = 0; i < T; ++i)
+    {
+      cost_[(i * n) + M + i] = half;
+    }
+    for (j = 0; j < M; ++j)
+    {
+      cost_[((T + j) * n) + j] = half;
+      for (i = 0; i < T; ++i)
+      {
+        cost_[((T + j) * n) + M + i] = 0.0;
+      }
+    }
+
+    //! Hungarian algorithm (shortest augmenting paths with row and column potentials), 1-based
+    //! with column 0 as the root of each search
+    u_.assign(n + 1, 0.0);
+    v_.assign(n + 1, 0.0);
+    match_.assign(n + 1, 0);
+    way_.assign(n + 1, 0);
+    for (i = 1; i <= n; ++i)
+    {
+      match_[0] = i;
+      j0 = 0;
+      minv_.assign(n + 1, HUGE_VAL);
+      used_.assign(n + 1, false);
+      do
+      {
+        used_[j0] = true;
+        i0 = match_[j0];
+        delta = HUGE_VAL;
+        j1 = 0;
+        for (j = 1; j <= n; ++j)
+        {
+          if (used_[j])
+          {
+            continue;
+          }
+          cur = cost_[((i0 - 1) * n) + (j - 1)] - u_[i0] - v_[j];
+          if (cur < minv_[j])
+          {
+            minv_[j] = cur;
+            way_[j] = j0;
+          }
+          if (minv_[j] < delta)
+          {
+            delta = minv_[j];
+            j1 = j;
+          }
+        }
+        for (j = 0; j <= n; ++j)
+        {
+          if (used_[j])
+          {
+            u_[match_[j]] += delta;
+            v_[j] -= delta;
+          }
+          else
+          {
+            minv_[j] -= delta;
+          }
+        }
+        j0 = j1;
+      } while (match_[j0] != 0);
+      do
+      {
+        j1 = way_[j0];
+        match_[j0] = match_[j1];
+        j0 = j1;
+      } while (j0 != 0);
+    }
+
+    for (i = 0; i < T; ++i)
+    {
+      trackMarker_[localTracks_[i]] = -1;
+    }
+    for (j = 0; j < M; ++j)
+    {
+      markerTrack_[localMarkers_[j]] = -1;
+    }
+    for (j = 1; j <= M; ++j)
+    {
+      i = match_[j] - 1;
+      if (i < T && cost_[(i * n) + (j - 1)] < trackForbidden)
+      {
+        trackMarker_[localTracks_[i]] = localMarkers_[j - 1];
+        markerTrack_[localMarkers_[j - 1]] = localTracks_[i];
+      }
+    }
+  }
+
+
+  int MarkerTracker::root (int i)
+  {
+    while (parent_[i] != i)
+    {
+      parent_[i] = parent_[parent_[i]];
+      i = parent_[i];
+    }
+    return i;
+  }
+} // Sensor namespace
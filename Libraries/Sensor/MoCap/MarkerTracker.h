@@ -0,0 +1,179 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: CRPI
+//  Subsystem:       Motion Capture Sensor
+//  Workfile:        MarkerTracker.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Frame-to-frame tracking of unlabeled motion capture markers:  gives each
+//  marker a stable id and a velocity, so consumers of GetUnlabeledMarkers do
+//  not each re-solve the correspondence between frames.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MARKERTRACKER_H
+#define MARKERTRACKER_H
+
+#include <vector>
+
+#include "MoCapTypes.h"
+
+using namespace std;
+
+namespace Sensor
+{
+  //! @brief One tracked marker
+  //!
+  struct MarkerTrack
+  {
+    //! @brief Identifier, unique for the life of the tracker
+    //!
+    int id;
+
+    //! @brief Position (the last measurement, or the prediction while the marker is missing)
+    //!        and velocity (position units per second)
+    //!
+    point position;
+    point velocity;
+
+    //! @brief Frames in which the marker was seen, and consecutive frames (up to now) in which
+    //!        it was not
+    //!
+    int hits;
+    int missed;
+
+    //! @brief Index of the marker in the last frame given to Update (-1 while missing)
+    //!
+    int marker;
+  };
+
+  //! @ingroup Sensor
+  //!
+  //! @brief Tracks unlabeled markers across frames.  Each frame, every track's position is
+  //!        predicted at constant velocity, markers within the gate of a prediction are found
+  //!        through a hash grid (8 cells per track), and tracks are matched to markers by a
+  //!        minimum total squared distance assignment (Hungarian algorithm), solved separately
+  //!        for each group of tracks and markers that share candidates, so well separated
+  //!        markers never reach the assignment solver.  Unmatched markers start
+  //!        new tracks; tracks unmatched for too many frames are dropped.
+  //!
+  class LIBRARY_API MarkerTracker
+  {
+  public:
+    //! @brief Constructor
+    //!
+    //! @param gate      Largest distance between a track's prediction and its marker (position
+    //!                  units, e.g., mm); tracks and markers further apart are never matched
+    //! @param maxMissed Frames a track survives without a marker
+    //!
+    MarkerTracker (double gate = 20.0, int maxMissed = 5);
+
+    //! @brief Default destructor
+    //!
+    ~MarkerTracker ();
+
+    //! @brief Change the gate and track lifetime for later frames
+    //!
+    void SetGate (double gate);
+    void SetMaxMissed (int maxMissed);
+
+    //! @brief Weight (0 to 1) of each frame's measured velocity against the predicted one; lower
+    //!        values smooth the velocities more (default 0.5)
+    //!
+    void SetSmoothing (double beta);
+
+    //! @brief Track one frame of markers
+    //!
+    //! @param markers   The frame's unlabeled markers
+    //! @param count     The number of markers
+    //! @param timestamp The frame's capture time (s)
+    //!
+    //! @return The number of tracks
+    //!
+    int Update (const point *markers, int count, double timestamp);
+    int Update (const vector<point> &markers, double timestamp);
+
+    //! @brief Track the unlabeled markers of a frame (e.g., from MoCapStream::AcquireFrame)
+    //!
+    int Update (const MoCapFrame &frame);
+
+    //! @brief The tracks after the last Update, oldest first
+    //!
+    const vector<MarkerTrack> &Tracks () const;
+
+    //! @brief The track id of each marker given to the last Update
+    //!
+    const vector<int> &MarkerIds () const;
+
+    //! @brief Drop every track (ids continue from where they were)
+    //!
+    void Reset ();
+
+  private:
+
+    //! @brief Settings
+    //!
+    double gate_;
+    int maxMissed_;
+    double beta_;
+
+    //! @brief Tracks, the id of the next new track, and the time of the last frame
+    //!
+    vector<MarkerTrack> tracks_;
+    int nextId_;
+    double lastTime_;
+    bool started_;
+
+    //! @brief Marker hash grid (as in Clustering::DBSCAN):  cell of each marker, start of each
+    //!        bucket in sorted_, and the markers sorted by bucket
+    //!
+    vector<int> cells_;
+    vector<int> bucketStart_;
+    vector<int> sorted_;
+    unsigned int mask_;
+
+    //! @brief Candidate pairs within the gate, and the groups of tracks and markers that share
+    //!        them (union-find over tracks, then markers)
+    //!
+    vector<int> edgeTrack_;
+    vector<int> edgeMarker_;
+    vector<double> edgeCost_;
+    vector<int> parent_;
+    vector<int> groupOf_;
+    vector<int> groupStart_;
+    vector<int> groupEdges_;
+
+    //! @brief Assignment work space, and the result:  marker of each track (-1 for none) and
+    //!        track of each marker
+    //!
+    vector<double> cost_;
+    vector<double> u_;
+    vector<double> v_;
+    vector<double> minv_;
+    vector<int> way_;
+    vector<int> match_;
+    vector<bool> used_;
+    vector<int> localTracks_;
+    vector<int> localMarkers_;
+    vector<int> trackMarker_;
+    vector<int> markerTrack_;
+    vector<int> markerIds_;
+
+    //! @brief Bin the markers of a frame into the grid
+    //!
+    void bin (const point *markers, int count);
+
+    //! @brief Assign the tracks and markers of one group
+    //!
+    void assign (int group);
+
+    //! @brief Union-find root
+    //!
+    int root (int i);
+  }; // MarkerTracker
+} // Sensor namespace
+
+#endif
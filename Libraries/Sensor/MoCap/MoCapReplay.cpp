@@ -0,0 +1,211 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: CRPI
+//  Subsystem:       Motion Capture Sensor
+//  Workfile:        MoCapReplay.cpp
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Motion capture stream that replays frames recorded from a Vicon or
+//  OptiTrack system.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MoCapReplay.h"
+
+#if defined(_MSC_VER)
+#include <crpi_hub.h>
+#elif defined(__GNUC__)
+#include "../../CRPI/crpi_hub.h"
+#endif
+
+#include <string.h>
+
+using namespace std;
+
+namespace Sensor
+{
+  LIBRARY_API MoCapReplay::MoCapReplay (const char *path, const char *channel, double speed) :
+    channel_(channel != NULL ? channel : ""),
+    speed_(speed > 0.0 ? speed : 0.0),
+    valid_(false),
+    task_(NULL),
+    run_(true),
+    finished_(false)
+  {
+    valid_ = reader_.Open(path);
+    if (!valid_)
+    {
+      finished_.store(true, std::memory_order_release);
+      return;
+    }
+    SetMetricLabels("replay", path);
+    task_ = crpi_robot::SensorHub::Instance().StartLoop(replayFrames, this, crpi_robot::HUB_SENSOR);
+  }
+
+
+  LIBRARY_API MoCapReplay::~MoCapReplay ()
+  {
+    run_.store(false, std::memory_order_release);
+    if (task_ != NULL)
+    {
+      crpi_robot::SensorHub::Instance().JoinLoop(task_);
+    }
+  }
+
+
+  void MoCapReplay::replayFrames (void *param)
+  {
+    MoCapReplay *replay = (MoCapReplay*)param;
+    crpi_robot::CrpiRecord record;
+    MoCapRecordHeader header;
+    MoCapRecordSubject from;
+    MoCapFrameSubject *subject;
+    MoCapFrame *frame;
+    int ids[MOCAP_NAMES_MAX];
+    int channel = -1, i;
+    double start = 0.0, first = 0.0, due;
+    bool started = false;
+
+    for (i = 0; i < MOCAP_NAMES_MAX; ++i)
+    {
+      ids[i] = -1;
+    }
+
+    while (replay->run_.load(std::memory_order_acquire) && replay->reader_.Next(record))
+    {
+      //! The channel is known once its name record has been read
+      if (channel < 0)
+      {
+        const char *name = replay->reader_.ChannelName(record.channel);
+        if (replay->channel_.empty() ? (strncmp(name, "mocap/", 6) == 0) : (replay->channel_ == name))
+        {
+          channel = record.channel;
+        }
+      }
+      if (record.channel != channel)
+      {
+        continue;
+      }
+
+      if (record.kind == crpi_robot::RECORD_NAME)
+      {
+        crpi_robot::crpiRecordName named;
+        int length = record.size - (int)sizeof(named.id);
+        if (length < 0 || length >= MOCAP_NAME_MAX)
+        {
+          continue;
+        }
+        memcpy(&named, record.data, record.size);
+        named.name[length] = '\0';
+        if (named.id >= 0 && named.id < MOCAP_NAMES_MAX)
+        {
+          ids[named.id] = replay->InternSubject(named.name);
+        }
+        continue;
+      }
+      if (record.kind != crpi_robot::RECORD_SENSOR || record.size < (int)sizeof(header))
+      {
+        continue;
+      }
+      memcpy(&header, record.data, sizeof(header));
+      if (header.subjectCount < 0 || header.subjectCount > MOCAP_SUBJECTS_MAX ||
+          record.size < (int)(sizeof(header) + (header.subjectCount * sizeof(from))))
+      {
+        continue;
+      }
+
+      if (!started)
+      {
+        start = ulapi_time();
+        first = record.timestamp;
+        started = true;
+      }
+      if (replay->speed_ > 0.0)
+      {
+        due = start + ((record.timestamp - first) / replay->speed_);
+        ulapi_sleep_until(due);
+      }
+      else
+      {
+        due = start + (record.timestamp - first);
+      }
+
+      frame = replay->BeginFrame();
+      if (frame == NULL)
+      {
+        continue;
+      }
+      frame->frameNumber = header.frameNumber;
+      frame->latency = header.latency;
+      frame->timestamp = due;
+      for (i = 0; i < header.subjectCount; ++i)
+      {
+        memcpy(&from, record.data + sizeof(header) + (i * sizeof(from)), sizeof(from));
+        subject = frame->addSubject((from.id >= 0 && from.id < MOCAP_NAMES_MAX) ? ids[from.id] : -1);
+        if (subject == NULL)
+        {
+          break;
+        }
+        subject->pose.x = from.pose[0];
+        subject->pose.y = from.pose[1];
+        subject->pose.z = from.pose[2];
+        subject->pose.xr = from.pose[3];
+        subject->pose.yr = from.pose[4];
+        subject->pose.zr = from.pose[5];
+        memcpy(subject->rotation, from.rotation, sizeof(subject->rotation));
+      }
+      frame->firstUnlabeled = frame->markerCount;
+      frame->unlabeledCount = 0;
+      replay->PublishFrame(frame);
+    } // while (replay->run_ && replay->reader_.Next(record))
+
+    replay->finished_.store(true, std::memory_order_release);
+  }
+
+
+  LIBRARY_API bool MoCapReplay::GetFrame (MoCapFrame &frame, int age)
+  {
+    MoCapFrameView view;
+
+    if (!view.acquire(*frames_, age))
+    {
+      return false;
+    }
+    frame = *view.get();
+    return true;
+  }
+
+
+  LIBRARY_API void MoCapReplay::GetCurrentSubjects (vector<MoCapSubject> &subjects)
+  {
+    MoCapFrameView view;
+    int i, j;
+
+    subjects.clear();
+    if (view.acquire(*frames_))
+    {
+      for (i = 0; i < view->subjectCount; ++i)
+      {
+        const MoCapFrameSubject &subject = view->subjects[i];
+        temp.name = view.name(i);
+        temp.pose = subject.pose;
+        for (j = 0; j < 9; ++j)
+        {
+          temp.rotation.at(j / 3, j % 3) = subject.rotation[j];
+        }
+        temp.labeledMarkers.clear();
+        temp.valid = true;
+        subjects.push_back(temp);
+      }
+    }
+  }
+
+
+  LIBRARY_API void MoCapReplay::GetUnlabeledMarkers (vector<point> &markers)
+  {
+    markers.clear();
+  }
+}
@@ -0,0 +1,129 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: CRPI
+//  Subsystem:       Motion Capture Sensor
+//  Workfile:        MoCapReplay.h
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Motion capture stream that replays frames recorded from a Vicon or
+//  OptiTrack system (see crpi_recorder.h).
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MOCAPREPLAY_H
+#define MOCAPREPLAY_H
+
+#if defined(_MSC_VER)
+#include <ulapi.h>
+#include <crpi.h>
+#elif defined(__GNUC__)
+#include "../../ulapi/src/ulapi.h"
+#include "../../CRPI/crpi.h"
+#endif
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "MoCapStream.h"
+
+using namespace std;
+using namespace Math;
+
+namespace Sensor
+{
+  //! @ingroup Sensor
+  //!
+  //! @brief Plays back a recorded motion capture stream through the same interface as the
+  //!        live Vicon and OptiTrack backends, so that registration and tracking code can be
+  //!        run and profiled against captured data without the tracker
+  //!
+  //! @note Frames are published at the recorded rate scaled by the speed (1 for real time),
+  //!       or as fast as the replay thread can publish them (speed 0).  Timestamps are
+  //!       rebased to the start of the replay, keeping the recorded spacing between frames
+  //!       (scaled by the speed), so repeated as-fast-as-possible runs see the same times.
+  //! @note Markers are not recorded, so replayed frames have subjects only.
+  //!
+  class LIBRARY_API MoCapReplay : public MoCapStream
+  {
+  public:
+
+    //! @brief Constructor
+    //!
+    //! @param path    The recording
+    //! @param channel The recorder channel to replay (e.g., "mocap/vicon/192.168.1.20"), or
+    //!                NULL for the first motion capture channel in the recording
+    //! @param speed   Replay speed relative to the recording, or 0 for as fast as possible
+    //!
+    MoCapReplay (const char *path, const char *channel = NULL, double speed = 1.0);
+
+    //! @brief Default destructor
+    //!
+    ~MoCapReplay ();
+
+    //! @brief Whether the recording was opened
+    //!
+    bool Valid () const
+    {
+      return valid_;
+    }
+
+    //! @brief Whether every frame of the recording has been published
+    //!
+    bool Finished () const
+    {
+      return finished_.load(std::memory_order_acquire);
+    }
+
+    //! @brief Query the replayed stream for a list of identified rigid objects in the scene
+    //!
+    //! @param subjects Vector populated by the function with the subjects of the newest frame
+    //!
+    void GetCurrentSubjects (vector<MoCapSubject> &subjects);
+
+    //! @brief Query the replayed stream for a list of unlabeled markers (always empty)
+    //!
+    //! @param markers Vector populated by the function with point objects
+    //!
+    void GetUnlabeledMarkers (vector<point> &markers);
+
+    //! @brief Copy one of the most recently replayed frames
+    //!
+    //! @param frame Populated by the function with the frame
+    //! @param age   0 for the newest frame, 1 for the one before it, and so on
+    //!
+    //! @return True if the frame was copied, false if it is not available
+    //!
+    bool GetFrame (MoCapFrame &frame, int age = 0);
+
+  private:
+
+    //! @brief Replay thread:  reads the recording and publishes its frames
+    //!
+    //! @param param The MoCapReplay object being served
+    //!
+    static void replayFrames (void *param);
+
+    //! @brief The recording and the channel replayed
+    //!
+    crpi_robot::CrpiRecordReader reader_;
+    string channel_;
+    double speed_;
+    bool valid_;
+
+    //! @brief Replay thread and its stop signal, and whether the recording has been played out
+    //!
+    void *task_;
+    std::atomic<bool> run_;
+    std::atomic<bool> finished_;
+
+    //! @brief Temporary storage for replayed subject information
+    //!
+    MoCapSubject temp;
+  }; // MoCapReplay
+} // Sensor namespace
+
+#endif
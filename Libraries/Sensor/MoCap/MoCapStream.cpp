@@ -0,0 +1,422 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: CRPI
+//  Subsystem:       Motion Capture Sensor
+//  Workfile:        MoCapStream.cpp
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Pooled frames and per-subject pose histories shared by the motion capture
+//  interfaces.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MoCapStream.h"
+
+#if defined(_MSC_VER)
+#include <crpi_alloc.h>
+#elif defined(__GNUC__)
+#include "../../CRPI/crpi_alloc.h"
+#endif
+
+#include <cstring>
+
+using namespace std;
+
+namespace Sensor
+{
+  //! @brief Ring of one subject's samples, written by the acquisition thread only.  Sample n is
+  //!        stored in samples[n % MOCAP_HISTORY_SAMPLES].  claimed is advanced before a sample
+  //!        is stored and written after, so a reader that finished copying knows which of the
+  //!        samples it used may have been overwritten in the meantime.
+  //!
+  struct MoCapStream::subjectHistory
+  {
+    MoCapSample samples[MOCAP_HISTORY_SAMPLES];
+    std::atomic<unsigned long> claimed;
+    std::atomic<unsigned long> written;
+
+    subjectHistory () :
+      claimed(0),
+      written(0)
+    {
+    }
+
+    //! @brief Store the next sample (writer only)
+    //!
+    void append (const MoCapSample &sample)
+    {
+      unsigned long n = written.load(std::memory_order_relaxed);
+
+      claimed.store(n + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      memcpy((void*)&samples[n % MOCAP_HISTORY_SAMPLES], (const void*)&sample, sizeof(MoCapSample));
+      written.store(n + 1, std::memory_order_release);
+    }
+
+    //! @brief Timestamp of sample n (may be torn if the sample is being overwritten; callers
+    //!        validate afterward)
+    //!
+    double time (unsigned long n) const
+    {
+      return samples[n % MOCAP_HISTORY_SAMPLES].timestamp;
+    }
+
+    //! @brief Copy sample n (validated afterward by the caller)
+    //!
+    void copy (unsigned long n, MoCapSample &sample) const
+    {
+      memcpy((void*)&sample, (const void*)&samples[n % MOCAP_HISTORY_SAMPLES], sizeof(MoCapSample));
+    }
+
+    //! @brief Whether samples from oldest onward were left intact by the writer
+    //!
+    bool intact (unsigned long oldest) const
+    {
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return claimed.load(std::memory_order_relaxed) <= oldest + MOCAP_HISTORY_SAMPLES;
+    }
+
+    //! @brief The oldest sample a reader should use when n have been written.  One slot is
+    //!        kept in reserve so that the sample being written does not invalidate every read.
+    //!
+    static unsigned long oldest (unsigned long n)
+    {
+      return (n >= MOCAP_HISTORY_SAMPLES) ? n - MOCAP_HISTORY_SAMPLES + 1 : 0;
+    }
+  };
+
+
+  LIBRARY_API MoCapStream::MoCapStream () :
+    frames_(new MoCapFrameBuffer()),
+    framesMetric_(NULL),
+    droppedMetric_(NULL),
+    lastFrame_(0),
+    sequenced_(false),
+    recordChannel_(-1),
+    clock_(new crpi_robot::CrpiTimeSync()),
+    recordGeneration_(0)
+  {
+    for (int i = 0; i < MOCAP_NAMES_MAX; ++i)
+    {
+      history_[i].store(NULL, std::memory_order_relaxed);
+      recordNamed_[i] = false;
+    }
+  }
+
+
+  LIBRARY_API MoCapStream::~MoCapStream ()
+  {
+    //! Derived destructors stop the acquisition thread before this runs
+    for (int i = 0; i < MOCAP_NAMES_MAX; ++i)
+    {
+      delete history_[i].load(std::memory_order_acquire);
+    }
+    delete frames_;
+    delete clock_;
+  }
+
+
+  LIBRARY_API bool MoCapStream::AcquireFrame (MoCapFrameView &view, int age)
+  {
+    return view.acquire(*frames_, age);
+  }
+
+
+  LIBRARY_API bool MoCapStream::GetUnlabeledCloud (Math::PointCloud &cloud)
+  {
+    MoCapFrameView view;
+
+    if (!view.acquire(*frames_))
+    {
+      cloud.clear();
+      return false;
+    }
+    cloud.assign(view->unlabeledMarkers(), view->unlabeledCount);
+    return true;
+  }
+
+
+  LIBRARY_API int MoCapStream::FindSubject (const char *name) const
+  {
+    return frames_->names.find(name);
+  }
+
+
+  LIBRARY_API const char *MoCapStream::SubjectName (int id) const
+  {
+    return frames_->names.name(id);
+  }
+
+
+  LIBRARY_API bool MoCapStream::GetSubjectTimeRange (int id, double &oldest, double &newest) const
+  {
+    const subjectHistory *hist;
+    unsigned long n, first;
+
+    if (id < 0 || id >= MOCAP_NAMES_MAX ||
+        (hist = history_[id].load(std::memory_order_acquire)) == NULL)
+    {
+      return false;
+    }
+    do
+    {
+      n = hist->written.load(std::memory_order_acquire);
+      if (n == 0)
+      {
+        return false;
+      }
+      first = subjectHistory::oldest(n);
+      oldest = hist->time(first);
+      newest = hist->time(n - 1);
+    } while (!hist->intact(first));
+    return true;
+  }
+
+
+  LIBRARY_API bool MoCapStream::GetSubjectPose (int id, double t, MoCapSample &sample,
+                                                double tolerance) const
+  {
+    const subjectHistory *hist;
+    MoCapSample a, b;
+    unsigned long n, first, lo, hi, mid;
+    bool bracketed;
+    double u;
+
+    if (id < 0 || id >= MOCAP_NAMES_MAX ||
+        (hist = history_[id].load(std::memory_order_acquire)) == NULL)
+    {
+      return false;
+    }
+
+    for (;;)
+    {
+      n = hist->written.load(std::memory_order_acquire);
+      if (n == 0)
+      {
+        return false;
+      }
+      first = subjectHistory::oldest(n);
+      bracketed = false;
+      if (t <= hist->time(first))
+      {
+        hist->copy(first, a);
+      }
+      else if (t >= hist->time(n - 1))
+      {
+        hist->copy(n - 1, a);
+      }
+      else
+      {
+        //! Timestamps increase along the ring:  find samples lo and lo + 1 on either side of t
+        lo = first;
+        hi = n - 1;
+        while (hi - lo > 1)
+        {
+          mid = lo + ((hi - lo) / 2);
+          if (hist->time(mid) <= t)
+          {
+            lo = mid;
+          }
+          else
+          {
+            hi = mid;
+          }
+        }
+        hist->copy(lo, a);
+        hist->copy(hi, b);
+        bracketed = true;
+      }
+      if (hist->intact(first))
+      {
+        break;
+      }
+    }
+
+    if (!bracketed)
+    {
+      //! Outside the history:  the nearest sample stands in if it is close enough
+      sample = a;
+      return fabs(a.timestamp - t) <= tolerance;
+    }
+    u = (b.timestamp > a.timestamp) ? (t - a.timestamp) / (b.timestamp - a.timestamp) : 0.0;
+    sample.timestamp = t;
+    sample.frameNumber = (u < 0.5) ? a.frameNumber : b.frameNumber;
+    sample.pose = interpolate(a.pose, b.pose, u);
+    return true;
+  }
+
+
+  LIBRARY_API bool MoCapStream::GetSubjectPose (const char *name, double t, pose &out,
+                                                bool useDegrees, double tolerance) const
+  {
+    MoCapSample sample;
+
+    if (!GetSubjectPose(FindSubject(name), t, sample, tolerance))
+    {
+      return false;
+    }
+    out = sample.pose.toPose(useDegrees);
+    return true;
+  }
+
+
+  LIBRARY_API void MoCapStream::SetMetricLabels (const char *sensor, const char *address)
+  {
+    using crpi_robot::CrpiMetrics;
+    string labels = CrpiMetrics::Label("sensor", sensor) + "," + CrpiMetrics::Label("address", address);
+    framesMetric_ = CrpiMetrics::Counter("crpi_mocap_frames", "Motion capture frames published", labels);
+    droppedMetric_ = CrpiMetrics::Counter("crpi_mocap_dropped", "Motion capture frames dropped", labels);
+    rateMetric_.gauge = CrpiMetrics::Gauge("crpi_mocap_rate_hz", "Motion capture frames published per second",
+                                           labels);
+    recordChannel_ = crpi_robot::CrpiRecorder::Channel(string("mocap/") + sensor + "/" + address);
+    delete clock_;
+    clock_ = new crpi_robot::CrpiTimeSync((string("mocap/") + sensor + "/" + address).c_str());
+  }
+
+
+  LIBRARY_API double MoCapStream::FollowClock (double trackerTime, double received)
+  {
+    clock_->AddOneWay(trackerTime, received);
+    return clock_->Synced() ? clock_->ToLocal(trackerTime) : received;
+  }
+
+
+  LIBRARY_API const crpi_robot::CrpiTimeSync &MoCapStream::Clock () const
+  {
+    return *clock_;
+  }
+
+
+  LIBRARY_API MoCapFrame *MoCapStream::BeginFrame ()
+  {
+    if (framesMetric_ == NULL)
+    {
+      SetMetricLabels("mocap", "");
+    }
+    return frames_->beginWrite();
+  }
+
+
+  LIBRARY_API void MoCapStream::PublishFrame (MoCapFrame *frame)
+  {
+    CRPI_NO_ALLOC_SCOPE("MoCapStream::PublishFrame");
+    subjectHistory *hist;
+    MoCapSample sample;
+    unsigned long n;
+    Mat3 rot;
+    int i, j;
+
+    //! Histories first, so that a reader of the frame also finds it in the histories
+    sample.timestamp = frame->timestamp;
+    sample.frameNumber = frame->frameNumber;
+    for (i = 0; i < frame->subjectCount; ++i)
+    {
+      const MoCapFrameSubject &subject = frame->subjects[i];
+      if (subject.id < 0 || subject.id >= MOCAP_NAMES_MAX)
+      {
+        continue;
+      }
+      hist = history_[subject.id].load(std::memory_order_relaxed);
+      if (hist == NULL)
+      {
+        //! Once per subject, the first time it is tracked
+        hist = new subjectHistory();
+        history_[subject.id].store(hist, std::memory_order_release);
+      }
+      n = hist->written.load(std::memory_order_relaxed);
+      if (n > 0 && !(frame->timestamp > hist->time(n - 1)))
+      {
+        continue;
+      }
+
+      for (j = 0; j < 9; ++j)
+      {
+        rot.at(j / 3, j % 3) = subject.rotation[j];
+      }
+      sample.pose.position = point(subject.pose.x, subject.pose.y, subject.pose.z);
+      sample.pose.orientation = matrixToQuaternion(rot);
+      sample.pose.orientation.normalize();
+      hist->append(sample);
+    }
+    frames_->endWrite(frame);
+
+    //! A frame number that goes backward is a tracker restart, not a drop
+    if (sequenced_ && frame->frameNumber > lastFrame_ + 1)
+    {
+      droppedMetric_->Inc(frame->frameNumber - lastFrame_ - 1);
+    }
+    lastFrame_ = frame->frameNumber;
+    sequenced_ = true;
+    framesMetric_->Inc();
+    rateMetric_.Tick(frame->timestamp);
+    if (crpi_robot::CrpiRecorder::Recording())
+    {
+      recordFrame(frame);
+    }
+  }
+
+
+  void MoCapStream::recordFrame (const MoCapFrame *frame)
+  {
+    unsigned char buffer[sizeof(MoCapRecordHeader) + (MOCAP_SUBJECTS_MAX * sizeof(MoCapRecordSubject))];
+    MoCapRecordHeader header;
+    MoCapRecordSubject subject;
+    unsigned int generation = crpi_robot::CrpiRecorder::Generation();
+    int i;
+
+    //! Names go out ahead of the first frame of each recording that uses them
+    if (generation != recordGeneration_)
+    {
+      recordGeneration_ = generation;
+      for (i = 0; i < MOCAP_NAMES_MAX; ++i)
+      {
+        recordNamed_[i] = false;
+      }
+    }
+    for (i = 0; i < frame->subjectCount; ++i)
+    {
+      int id = frame->subjects[i].id;
+      if (id >= 0 && id < MOCAP_NAMES_MAX && !recordNamed_[id])
+      {
+        recordNamed_[id] = crpi_robot::CrpiRecorder::RecordName(recordChannel_, id, SubjectName(id),
+                                                                frame->timestamp);
+      }
+    }
+
+    header.frameNumber = frame->frameNumber;
+    header.subjectCount = frame->subjectCount;
+    header.latency = frame->latency;
+    memcpy(buffer, &header, sizeof(header));
+    for (i = 0; i < frame->subjectCount; ++i)
+    {
+      const MoCapFrameSubject &from = frame->subjects[i];
+      subject.id = from.id;
+      subject.reserved = 0;
+      subject.pose[0] = from.pose.x;
+      subject.pose[1] = from.pose.y;
+      subject.pose[2] = from.pose.z;
+      subject.pose[3] = from.pose.xr;
+      subject.pose[4] = from.pose.yr;
+      subject.pose[5] = from.pose.zr;
+      memcpy(subject.rotation, from.rotation, sizeof(subject.rotation));
+      memcpy(buffer + sizeof(header) + (i * sizeof(subject)), &subject, sizeof(subject));
+    }
+    crpi_robot::CrpiRecorder::Record(recordChannel_, crpi_robot::RECORD_SENSOR, frame->timestamp, buffer,
+                                     (int)(sizeof(header) + (frame->subjectCount * sizeof(subject))));
+  }
+
+
+  LIBRARY_API void MoCapStream::DiscardFrame (MoCapFrame *frame)
+  {
+    frames_->abortWrite(frame);
+  }
+
+
+  LIBRARY_API int MoCapStream::InternSubject (const char *name)
+  {
+    return frames_->names.intern(name);
+  }
+}
@@ -0,0 +1,274 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: CRPI
+//  Subsystem:       Motion Capture Sensor
+//  Workfile:        MoCapStream.h
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Common base of the motion capture interfaces:  the pooled frames written by
+//  the acquisition thread, and a time-indexed history of each rigid body that
+//  can be interpolated to an arbitrary query time.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MOCAPSTREAM_H
+#define MOCAPSTREAM_H
+
+#include <atomic>
+
+#include "MoCapTypes.h"
+
+#if defined(_MSC_VER)
+#include "RotationMath.h"
+#include "PointCloud.h"
+#include <crpi_metrics.h>
+#include <crpi_recorder.h>
+#include <crpi_timesync.h>
+#elif defined(__GNUC__)
+#include "../../Math/RotationMath.h"
+#include "../../Math/PointCloud.h"
+#include "../../CRPI/crpi_metrics.h"
+#include "../../CRPI/crpi_recorder.h"
+#include "../../CRPI/crpi_timesync.h"
+#endif
+
+#define MOCAP_HISTORY_SAMPLES 256
+
+namespace Sensor
+{
+  //! @brief Pose of one rigid body at one instant
+  //!
+  struct MoCapSample
+  {
+    //! @brief Capture time (ulapi_time, s), as in MoCapFrame::timestamp
+    //!
+    double timestamp;
+
+    //! @brief The tracker's frame number (of the nearer frame, for interpolated samples)
+    //!
+    unsigned int frameNumber;
+
+    //! @brief Position and orientation of the rigid body
+    //!
+    Math::qpose pose;
+  };
+
+  //! @brief Layout of a frame in a recording (see crpi_recorder.h):  a MoCapRecordHeader
+  //!        followed by subjectCount MoCapRecordSubjects.  Markers are not recorded.  Each
+  //!        subject's name is written once per recording, as a RECORD_NAME record ahead of
+  //!        the first frame that tracks it.
+  //!
+  struct MoCapRecordHeader
+  {
+    unsigned int frameNumber;
+    int subjectCount;
+    double latency;
+  };
+
+  struct MoCapRecordSubject
+  {
+    //! @brief The subject's id, as in MoCapFrameSubject (see the stream's SubjectName)
+    //!
+    int id;
+    int reserved;
+
+    //! @brief Pose (x, y, z, xr, yr, zr, in the backend's units) and row-major rotation of
+    //!        the rigid body
+    //!
+    double pose[6];
+    double rotation[9];
+  };
+
+  //! @ingroup Sensor
+  //!
+  //! @brief Timestamped motion capture stream.  Each backend's acquisition thread fills frames
+  //!        with BeginFrame and PublishFrame, which also append every tracked rigid body to a
+  //!        ring of its last MOCAP_HISTORY_SAMPLES poses.  Readers never block the acquisition
+  //!        thread:  frames are pinned in place (AcquireFrame), and history rings are read
+  //!        optimistically and re-read if the writer overtook them.
+  //!
+  class LIBRARY_API MoCapStream
+  {
+  public:
+    //! @brief Default constructor
+    //!
+    MoCapStream ();
+
+    //! @brief Default destructor
+    //!
+    virtual ~MoCapStream ();
+
+    //! @brief View one of the most recently acquired frames in place, without copying or
+    //!        waiting on the acquisition thread.  The frame stays valid (and is not reused)
+    //!        until the view is reset or destroyed.
+    //!
+    //! @param view Set by the function to the frame
+    //! @param age  0 for the newest frame, 1 for the one before it, and so on (fewer than
+    //!             MOCAP_FRAME_BUFFERS frames are kept)
+    //!
+    //! @return True if the frame is available, false otherwise
+    //!
+    bool AcquireFrame (MoCapFrameView &view, int age = 0);
+
+    //! @brief Copy the unlabeled markers of the newest frame into a point cloud, e.g. for
+    //!        reg2target or CrpiRobot::ToWorldPoints
+    //!
+    //! @param cloud Set by the function to the markers (its storage is reused from call to call)
+    //!
+    //! @return True if a frame is available, false otherwise (cloud is then emptied)
+    //!
+    bool GetUnlabeledCloud (Math::PointCloud &cloud);
+
+    //! @brief Look up a rigid body by name
+    //!
+    //! @return The subject's id (as in MoCapFrameSubject::id), or -1 if it has not been seen
+    //!
+    int FindSubject (const char *name) const;
+
+    //! @brief The name of a rigid body
+    //!
+    //! @return The name, or an empty string for an unknown id
+    //!
+    const char *SubjectName (int id) const;
+
+    //! @brief The span of time covered by a rigid body's history
+    //!
+    //! @param id     The subject's id
+    //! @param oldest Set to the timestamp of the oldest sample held
+    //! @param newest Set to the timestamp of the newest sample held
+    //!
+    //! @return True if the subject has any samples, false otherwise
+    //!
+    bool GetSubjectTimeRange (int id, double &oldest, double &newest) const;
+
+    //! @brief Estimate the pose of a rigid body at an arbitrary time, interpolating linearly in
+    //!        position and spherically (SLERP) in orientation between the samples on either
+    //!        side of it
+    //!
+    //! @param id        The subject's id
+    //! @param t         The query time (ulapi_time, s)
+    //! @param sample    Populated by the function with the pose at t (when t is outside the
+    //!                  history, the nearest sample, with its own timestamp)
+    //! @param tolerance How far (s) outside the history t may be; such queries take the
+    //!                  nearest sample rather than extrapolating
+    //!
+    //! @return True if t is covered by the history (within the tolerance), false otherwise
+    //!
+    bool GetSubjectPose (int id, double t, MoCapSample &sample, double tolerance = 0.0) const;
+
+    //! @brief Estimate the pose of a rigid body at an arbitrary time (see above)
+    //!
+    //! @param name       The subject's name
+    //! @param t          The query time (ulapi_time, s)
+    //! @param out        Populated by the function with the pose at t
+    //! @param useDegrees Whether to report the orientation in degrees (true) or radians (false)
+    //! @param tolerance  How far (s) outside the history t may be
+    //!
+    //! @return True if the pose is available, false otherwise
+    //!
+    bool GetSubjectPose (const char *name, double t, pose &out, bool useDegrees,
+                         double tolerance = 0.0) const;
+
+    //! @brief Claim an empty frame to fill (acquisition thread only)
+    //!
+    //! @return The frame, or NULL if readers are holding every buffer (drop the data)
+    //!
+    MoCapFrame *BeginFrame ();
+
+    //! @brief Publish a frame claimed by BeginFrame and add its rigid bodies to their
+    //!        histories (acquisition thread only).  Samples that do not advance a subject's
+    //!        history in time are not added to it.
+    //!
+    void PublishFrame (MoCapFrame *frame);
+
+    //! @brief Return a frame claimed by BeginFrame without publishing it (e.g., when the
+    //!        tracker's data could not be decoded; acquisition thread only)
+    //!
+    void DiscardFrame (MoCapFrame *frame);
+
+    //! @brief Find or add a subject name (acquisition thread only)
+    //!
+    //! @return The subject's id, or -1 if there are already MOCAP_NAMES_MAX names
+    //!
+    int InternSubject (const char *name);
+
+    //! @brief Label the stream's runtime metrics (frames published, frames dropped, and the
+    //!        frame rate; see crpi_metrics.h) and name its recorder channel
+    //!        ("mocap/<sensor>/<address>").  Called by a backend before its acquisition
+    //!        thread starts; streams that are never labelled report as sensor="mocap".
+    //!
+    //! @param sensor  Backend name (e.g., "vicon")
+    //! @param address Tracker address
+    //!
+    void SetMetricLabels (const char *sensor, const char *address);
+
+    //! @brief Follow the tracker's clock through the time stamp it puts in each frame
+    //!        (acquisition thread only)
+    //!
+    //! @param trackerTime The frame's time stamp on the tracker's clock (s)
+    //! @param received    When the frame arrived (ulapi_time, s)
+    //!
+    //! @return The arrival time without the network jitter, from the tracker's time stamp
+    //!         mapped onto the ulapi_time clock (received, until the clock is synchronized)
+    //!
+    double FollowClock (double trackerTime, double received);
+
+    //! @brief The tracker's clock, registered as "mocap/<sensor>/<address>" (see
+    //!        crpi_timesync.h; not synchronized for backends without tracker time stamps)
+    //!
+    const crpi_robot::CrpiTimeSync &Clock () const;
+
+  protected:
+    //! @brief Recently acquired frames, written by the acquisition thread
+    //!
+    MoCapFrameBuffer *frames_;
+
+  private:
+    MoCapStream (const MoCapStream &) = delete;
+    MoCapStream &operator= (const MoCapStream &) = delete;
+
+    //! @brief Ring of one subject's samples (defined in MoCapStream.cpp)
+    //!
+    struct subjectHistory;
+
+    //! @brief Per-subject history, indexed by id and allocated the first time the subject is
+    //!        tracked
+    //!
+    std::atomic<subjectHistory *> history_[MOCAP_NAMES_MAX];
+
+    //! @brief Runtime metrics.  Frames are counted as dropped when the tracker's frame number
+    //!        skips ahead, which covers frames lost in transit, frames that could not be
+    //!        decoded, and frames discarded because readers held every buffer.
+    //!
+    crpi_robot::CrpiCounter *framesMetric_;
+    crpi_robot::CrpiCounter *droppedMetric_;
+    crpi_robot::CrpiRateMeter rateMetric_;
+
+    //! @brief Frame number of the last published frame, and whether there is one
+    //!
+    unsigned int lastFrame_;
+    bool sequenced_;
+
+    //! @brief Recorder channel of the published frames
+    //!
+    int recordChannel_;
+
+    //! @brief The tracker's clock (named by SetMetricLabels)
+    //!
+    crpi_robot::CrpiTimeSync *clock_;
+
+    //! @brief Recording the subject names were written to, and which were written
+    //!
+    unsigned int recordGeneration_;
+    bool recordNamed_[MOCAP_NAMES_MAX];
+
+    //! @brief Copy a published frame to the recorder (acquisition thread only)
+    //!
+    void recordFrame (const MoCapFrame *frame);
+  }; // MoCapStream
+} // Sensor namespace
+
+#endif
@@ -17,6 +17,9 @@
 #define MOCAPTYPES_H
 
 #include <vector>
+#include <string>
+#include <atomic>
+#include <cmath>
 
 #include <string.h>
 
@@ -78,6 +81,499 @@ namespace Sensor
     }
   } MoCapSubject;
 
+#define MOCAP_SUBJECTS_MAX 32
+#define MOCAP_MARKERS_MAX 512
+#define MOCAP_NAMES_MAX 128
+#define MOCAP_NAME_MAX 64
+#define MOCAP_FRAME_BUFFERS 8
+
+  //! @brief One rigid body in a MoCapFrame
+  //!
+  struct MoCapFrameSubject
+  {
+    //! @brief The subject's name, interned in the sensor's MoCapNameTable (-1 if the table
+    //!        was full)
+    //!
+    int id;
+
+    //! @brief The pose of the rigid body subject
+    //!
+    Math::pose pose;
+
+    //! @brief The rotation of the rigid body, row-major
+    //!
+    double rotation[9];
+
+    //! @brief The subject's markers:  markerCount points starting at MoCapFrame::markers[firstMarker]
+    //!
+    int firstMarker;
+    int markerCount;
+
+    //! @brief Set the rotation from a quaternion (need not be normalized), using the same
+    //!        convention as matrix::rotQuaternionMatrixConvert
+    //!
+    void setQuaternion (double w, double x, double y, double z)
+    {
+      double sqw = w * w, sqx = x * x, sqy = y * y, sqz = z * z;
+      double inv = 1.0 / (sqw + sqx + sqy + sqz);
+
+      rotation[0] = (sqx - sqy - sqz + sqw) * inv;
+      rotation[4] = (-sqx + sqy - sqz + sqw) * inv;
+      rotation[8] = (-sqx - sqy + sqz + sqw) * inv;
+      rotation[3] = 2.0 * ((x * y) + (z * w)) * inv;
+      rotation[1] = 2.0 * ((x * y) - (z * w)) * inv;
+      rotation[6] = 2.0 * ((x * z) - (y * w)) * inv;
+      rotation[2] = 2.0 * ((x * z) + (y * w)) * inv;
+      rotation[7] = 2.0 * ((y * z) + (x * w)) * inv;
+      rotation[5] = 2.0 * ((y * z) - (x * w)) * inv;
+    }
+
+    //! @brief Set the pose orientation from the rotation, using the same convention as
+    //!        matrix::rotMatrixEulerConvert
+    //!
+    //! @param degrees Whether to report the angles in degrees (true) or radians (false)
+    //!
+    void updateEuler (bool degrees)
+    {
+      double scale = degrees ? (180.0 / 3.141592654) : 1.0;
+
+      pose.yr = atan2(-rotation[6], sqrt((rotation[0] * rotation[0]) + (rotation[3] * rotation[3])));
+      if (fabs(pose.yr - 1.57079632679489661923) < 1.0e-4)
+      {
+        pose.xr = atan2(rotation[1], rotation[4]);
+        pose.yr = 1.57079632679489661923;
+        pose.zr = 0.0;
+      }
+      else if (fabs(pose.yr + 1.57079632679489661923) < 1.0e-4)
+      {
+        pose.xr = -atan2(rotation[1], rotation[4]);
+        pose.yr = -1.57079632679489661923;
+        pose.zr = 0.0;
+      }
+      else
+      {
+        pose.xr = atan2(rotation[7], rotation[8]);
+        pose.zr = atan2(rotation[3], rotation[0]);
+      }
+      pose.xr *= scale;
+      pose.yr *= scale;
+      pose.zr *= scale;
+    }
+  };
+
+  //! @brief One complete frame from a motion capture system.  Fixed-size, so that frames can
+  //!        be pooled (see MoCapFrameBuffer) and filled at the tracker's rate without allocating.
+  //!
+  struct MoCapFrame
+  {
+    //! @brief The tracker's frame number
+    //!
+    unsigned int frameNumber;
+
+    //! @brief Estimated time (ulapi_time, s) at which the frame was captured:  the time it was
+    //!        received less the tracker's reported latency
+    //!
+    double timestamp;
+
+    //! @brief Reported latency (s) from capture to receipt
+    //!
+    double latency;
+
+    //! @brief Tracked rigid bodies and the number of them used
+    //!
+    MoCapFrameSubject subjects[MOCAP_SUBJECTS_MAX];
+    int subjectCount;
+
+    //! @brief Arena holding every marker in the frame (subject markers, then the unlabeled
+    //!        ones), and the number of points used
+    //!
+    point markers[MOCAP_MARKERS_MAX];
+    int markerCount;
+
+    //! @brief The unlabeled markers:  unlabeledCount points starting at markers[firstUnlabeled]
+    //!
+    int firstUnlabeled;
+    int unlabeledCount;
+
+    //! @brief Default constructor
+    //!
+    MoCapFrame ()
+    {
+      clear();
+    }
+
+    //! @brief Empty the frame for reuse
+    //!
+    void clear ()
+    {
+      frameNumber = 0;
+      timestamp = latency = 0.0;
+      subjectCount = markerCount = 0;
+      firstUnlabeled = unlabeledCount = 0;
+    }
+
+    //! @brief Add a subject
+    //!
+    //! @return The new subject (with no markers), or NULL if the frame is full
+    //!
+    MoCapFrameSubject *addSubject (int id)
+    {
+      if (subjectCount >= MOCAP_SUBJECTS_MAX)
+      {
+        return NULL;
+      }
+      MoCapFrameSubject *subject = &subjects[subjectCount++];
+      subject->id = id;
+      subject->firstMarker = markerCount;
+      subject->markerCount = 0;
+      return subject;
+    }
+
+    //! @brief Append a marker to the arena (markers past the arena's capacity are dropped)
+    //!
+    //! @return True if the marker was stored
+    //!
+    bool addMarker (double x, double y, double z)
+    {
+      if (markerCount >= MOCAP_MARKERS_MAX)
+      {
+        return false;
+      }
+      markers[markerCount].x = x;
+      markers[markerCount].y = y;
+      markers[markerCount].z = z;
+      ++markerCount;
+      return true;
+    }
+
+    //! @brief The markers of subject i
+    //!
+    const point *subjectMarkers (int i) const
+    {
+      return &markers[subjects[i].firstMarker];
+    }
+
+    //! @brief The unlabeled markers
+    //!
+    const point *unlabeledMarkers () const
+    {
+      return &markers[firstUnlabeled];
+    }
+  };
+
+  //! @brief Subject names seen by a sensor, each stored once and referred to by index.  Names
+  //!        are only ever added (by the acquisition thread), so readers look them up without
+  //!        locking.
+  //!
+  class MoCapNameTable
+  {
+  public:
+    //! @brief Default constructor
+    //!
+    MoCapNameTable () :
+      count_(0)
+    {
+    }
+
+    //! @brief Find or add a name (acquisition thread only)
+    //!
+    //! @return The name's index, or -1 if the table is full
+    //!
+    int intern (const char *name)
+    {
+      int i, n = count_.load(std::memory_order_relaxed);
+
+      for (i = 0; i < n; ++i)
+      {
+        if (strncmp(names_[i], name, MOCAP_NAME_MAX - 1) == 0)
+        {
+          return i;
+        }
+      }
+      if (n >= MOCAP_NAMES_MAX)
+      {
+        return -1;
+      }
+      strncpy(names_[n], name, MOCAP_NAME_MAX - 1);
+      names_[n][MOCAP_NAME_MAX - 1] = '\0';
+      count_.store(n + 1, std::memory_order_release);
+      return n;
+    }
+
+    //! @brief Find a name without adding it
+    //!
+    //! @return The name's index, or -1 if it has not been seen
+    //!
+    int find (const char *name) const
+    {
+      int i, n = count_.load(std::memory_order_acquire);
+
+      for (i = 0; i < n; ++i)
+      {
+        if (strncmp(names_[i], name, MOCAP_NAME_MAX - 1) == 0)
+        {
+          return i;
+        }
+      }
+      return -1;
+    }
+
+    //! @brief Look up an interned name
+    //!
+    //! @return The name, or an empty string for an unknown index
+    //!
+    const char *name (int id) const
+    {
+      return (id >= 0 && id < count_.load(std::memory_order_acquire)) ? names_[id] : "";
+    }
+
+  private:
+    std::atomic<int> count_;
+    char names_[MOCAP_NAMES_MAX][MOCAP_NAME_MAX];
+  };
+
+  //! @brief Pool of MOCAP_FRAME_BUFFERS frames written by one acquisition thread and read in
+  //!        place by any number of readers.  A reader pins a published frame; the writer fills
+  //!        the oldest frame that is not pinned, so the pool also serves as a short history.
+  //!        Nothing is allocated or copied per frame.
+  //!
+  class MoCapFrameBuffer
+  {
+  public:
+    //! @brief Default constructor
+    //!
+    MoCapFrameBuffer () :
+      published_(0),
+      dropped_(0)
+    {
+      for (int i = 0; i < MOCAP_FRAME_BUFFERS; ++i)
+      {
+        pins_[i].store(0);
+        sequence_[i].store(0);
+      }
+    }
+
+    //! @brief Claim a frame to fill (writer only)
+    //!
+    //! @return An empty frame, or NULL if every frame is pinned by readers (the new data should
+    //!         be dropped)
+    //!
+    MoCapFrame *beginWrite ()
+    {
+      int i, best = -1, idle;
+      unsigned long oldest = 0;
+
+      for (i = 0; i < MOCAP_FRAME_BUFFERS; ++i)
+      {
+        if (pins_[i].load(std::memory_order_relaxed) == 0 &&
+            (best < 0 || sequence_[i].load(std::memory_order_relaxed) < oldest))
+        {
+          best = i;
+          oldest = sequence_[i].load(std::memory_order_relaxed);
+        }
+      }
+
+      //! A reader may pin the frame between the scan and the claim
+      idle = 0;
+      if (best < 0 || !pins_[best].compare_exchange_strong(idle, -1, std::memory_order_acquire))
+      {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return NULL;
+      }
+      sequence_[best].store(0, std::memory_order_relaxed);
+      frames_[best].clear();
+      return &frames_[best];
+    }
+
+    //! @brief Publish a frame claimed by beginWrite
+    //!
+    void endWrite (MoCapFrame *frame)
+    {
+      int i = (int)(frame - frames_);
+      unsigned long p = published_.load(std::memory_order_relaxed) + 1;
+
+      sequence_[i].store(p, std::memory_order_relaxed);
+      pins_[i].store(0, std::memory_order_release);
+      published_.store(p, std::memory_order_release);
+    }
+
+    //! @brief Hand back a frame claimed by beginWrite without publishing it
+    //!
+    void abortWrite (MoCapFrame *frame)
+    {
+      pins_[frame - frames_].store(0, std::memory_order_release);
+    }
+
+    //! @brief Pin a published frame for reading
+    //!
+    //! @param age 0 for the newest frame, 1 for the one before it, and so on
+    //!
+    //! @return The frame, or NULL if it has not been published or has since been reused; a
+    //!         frame returned must be handed back to release
+    //!
+    const MoCapFrame *acquire (int age = 0)
+    {
+      unsigned long p, target;
+      int i, pins;
+
+      for (;;)
+      {
+        p = published_.load(std::memory_order_acquire);
+        if (age < 0 || (unsigned long)age >= p)
+        {
+          return NULL;
+        }
+        target = p - (unsigned long)age;
+        for (i = 0; i < MOCAP_FRAME_BUFFERS; ++i)
+        {
+          if (sequence_[i].load(std::memory_order_acquire) == target)
+          {
+            break;
+          }
+        }
+        if (i == MOCAP_FRAME_BUFFERS)
+        {
+          //! Reused, unless the newest frame moved on while scanning
+          if (published_.load(std::memory_order_acquire) == p)
+          {
+            return NULL;
+          }
+          continue;
+        }
+
+        //! Pins only succeed while the frame is not being written
+        pins = pins_[i].load(std::memory_order_relaxed);
+        while (pins >= 0 && !pins_[i].compare_exchange_weak(pins, pins + 1, std::memory_order_acquire))
+        {
+        }
+        if (pins < 0)
+        {
+          continue;
+        }
+        if (sequence_[i].load(std::memory_order_acquire) == target)
+        {
+          return &frames_[i];
+        }
+
+        //! Rewritten between the scan and the pin
+        pins_[i].fetch_sub(1, std::memory_order_release);
+      }
+    }
+
+    //! @brief Hand back a frame returned by acquire
+    //!
+    void release (const MoCapFrame *frame)
+    {
+      if (frame != NULL)
+      {
+        pins_[frame - frames_].fetch_sub(1, std::memory_order_release);
+      }
+    }
+
+    //! @brief Number of frames published so far
+    //!
+    unsigned long count () const
+    {
+      return published_.load(std::memory_order_acquire);
+    }
+
+    //! @brief Number of frames dropped because every buffer was pinned
+    //!
+    unsigned long dropped () const
+    {
+      return dropped_.load(std::memory_order_relaxed);
+    }
+
+    //! @brief Names referred to by MoCapFrameSubject::id
+    //!
+    MoCapNameTable names;
+
+  private:
+    MoCapFrame frames_[MOCAP_FRAME_BUFFERS];
+
+    //! @brief Reader count of each frame (-1 while the writer is filling it)
+    //!
+    std::atomic<int> pins_[MOCAP_FRAME_BUFFERS];
+
+    //! @brief Publication number of each frame (0 if it holds no published frame)
+    //!
+    std::atomic<unsigned long> sequence_[MOCAP_FRAME_BUFFERS];
+
+    std::atomic<unsigned long> published_;
+    std::atomic<unsigned long> dropped_;
+  };
+
+  //! @brief Read-only view of a pooled frame, released when the view is destroyed or reset
+  //!
+  class MoCapFrameView
+  {
+  public:
+    //! @brief Default constructor (empty view)
+    //!
+    MoCapFrameView () :
+      buffer_(NULL),
+      frame_(NULL)
+    {
+    }
+
+    //! @brief Default destructor
+    //!
+    ~MoCapFrameView ()
+    {
+      reset();
+    }
+
+    //! @brief Pin a frame of a buffer, releasing any frame already held
+    //!
+    //! @return True if the frame is available
+    //!
+    bool acquire (MoCapFrameBuffer &buffer, int age = 0)
+    {
+      reset();
+      frame_ = buffer.acquire(age);
+      buffer_ = (frame_ == NULL) ? NULL : &buffer;
+      return frame_ != NULL;
+    }
+
+    //! @brief Release the frame
+    //!
+    void reset ()
+    {
+      if (buffer_ != NULL)
+      {
+        buffer_->release(frame_);
+      }
+      buffer_ = NULL;
+      frame_ = NULL;
+    }
+
+    //! @brief The frame (NULL if the view is empty)
+    //!
+    const MoCapFrame *get () const
+    {
+      return frame_;
+    }
+
+    const MoCapFrame *operator-> () const
+    {
+      return frame_;
+    }
+
+    //! @brief The name of one of the frame's subjects
+    //!
+    const char *name (int i) const
+    {
+      return buffer_->names.name(frame_->subjects[i].id);
+    }
+
+  private:
+    MoCapFrameView (const MoCapFrameView &) = delete;
+    MoCapFrameView &operator= (const MoCapFrameView &) = delete;
+
+    MoCapFrameBuffer *buffer_;
+    const MoCapFrame *frame_;
+  };
+
 }
 
 #endif // MOCAPTYPES
@@ -0,0 +1,555 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: CRPI
+//  Subsystem:       Motion Capture Sensor
+//  Workfile:        NatNetReceiver.cpp
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Native NatNet multicast receiver.  The frame layout follows the NatNet
+//  SDK's PacketClient sample for stream versions 2.0 through 3.x.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "NatNetReceiver.h"
+
+#if defined(_MSC_VER)
+#include <crpi_hub.h>
+#include <crpi_log.h>
+#elif defined(__GNUC__)
+#include "../../CRPI/crpi_hub.h"
+#include "../../CRPI/crpi_log.h"
+#endif
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef WIN32
+  #include <winsock2.h>
+  #include <ws2tcpip.h>
+#else
+  #include <sys/types.h>
+  #include <sys/socket.h>
+  #include <netinet/in.h>
+  #include <arpa/inet.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <errno.h>
+#endif
+
+//! @brief NatNet message carrying a frame of data
+//!
+#define NATNET_FRAMEOFDATA 7
+
+//! @brief Datagrams read per batch, and the size of each receive buffer (the largest UDP
+//!        payload)
+//!
+#define NATNET_BATCH 16
+#define NATNET_PACKET_MAX 65536
+
+//! @brief How long (s) the receive thread waits for data before checking whether to stop
+//!
+#define NATNET_POLL_PERIOD 0.1
+
+using namespace std;
+
+namespace Sensor
+{
+  namespace
+  {
+    //! @brief Bounds-checked sequential reader over a NatNet payload.  A read past the end
+    //!        marks the cursor bad and yields zeros, so the decoder checks once at the end.
+    //!
+    struct natnetCursor
+    {
+      const char *ptr;
+      const char *end;
+      bool ok;
+
+      natnetCursor (const char *data, int length) :
+        ptr(data),
+        end(data + length),
+        ok(true)
+      {
+      }
+
+      //! @brief Whether n more bytes are available
+      //!
+      bool has (long long n)
+      {
+        if (!ok || n < 0 || n > (long long)(end - ptr))
+        {
+          ok = false;
+        }
+        return ok;
+      }
+
+      //! @brief Skip n bytes
+      //!
+      void skip (long long n)
+      {
+        if (has(n))
+        {
+          ptr += n;
+        }
+      }
+
+      //! @brief Skip a count of items of the given size, rejecting counts that are negative or
+      //!        would run past the end
+      //!
+      void skip (int count, int size)
+      {
+        skip((count < 0) ? -1 : (long long)count * size);
+      }
+
+      //! @brief Skip a NUL-terminated string
+      //!
+      void skipString ()
+      {
+        const char *nul = ok ? (const char *)memchr(ptr, '\0', end - ptr) : NULL;
+        if (nul == NULL)
+        {
+          ok = false;
+          return;
+        }
+        ptr = nul + 1;
+      }
+
+      int readInt ()
+      {
+        int v = 0;
+        if (has(sizeof(v)))
+        {
+          memcpy(&v, ptr, sizeof(v));
+          ptr += sizeof(v);
+        }
+        return v;
+      }
+
+      short readShort ()
+      {
+        short v = 0;
+        if (has(sizeof(v)))
+        {
+          memcpy(&v, ptr, sizeof(v));
+          ptr += sizeof(v);
+        }
+        return v;
+      }
+
+      float readFloat ()
+      {
+        float v = 0.0f;
+        if (has(sizeof(v)))
+        {
+          memcpy(&v, ptr, sizeof(v));
+          ptr += sizeof(v);
+        }
+        return v;
+      }
+
+      double readDouble ()
+      {
+        double v = 0.0;
+        if (has(sizeof(v)))
+        {
+          memcpy(&v, ptr, sizeof(v));
+          ptr += sizeof(v);
+        }
+        return v;
+      }
+
+      //! @brief Read a count that must be non-negative
+      //!
+      int readCount ()
+      {
+        int v = readInt();
+        if (v < 0)
+        {
+          ok = false;
+          v = 0;
+        }
+        return v;
+      }
+    };
+
+
+    //! @brief Whether the stream version is at least major.minor
+    //!
+    bool atLeast (int major, int minor, int wantMajor, int wantMinor)
+    {
+      return (major > wantMajor) || (major == wantMajor && minor >= wantMinor);
+    }
+
+
+    //! @brief Close a socket
+    //!
+    void closeSocket (ulapi_integer fd)
+    {
+#ifdef WIN32
+      closesocket((SOCKET)fd);
+#else
+      close((int)fd);
+#endif
+    }
+
+
+    //! @brief Open a non-blocking UDP socket on the port and join the multicast group
+    //!
+    //! @return The socket, or -1 on failure
+    //!
+    ulapi_integer openMulticast (const char *intf, const char *group, int port)
+    {
+      struct sockaddr_in addr;
+      struct ip_mreq mreq;
+      int on = 1, size = 4 * 1024 * 1024;
+
+#ifdef WIN32
+      WSADATA wsa;
+      u_long nonblocking = 1;
+      SOCKET fd;
+
+      if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0)
+      {
+        return -1;
+      }
+      fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+      if (fd == INVALID_SOCKET)
+      {
+        return -1;
+      }
+#else
+      int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+      if (fd < 0)
+      {
+        return -1;
+      }
+#endif
+
+      //! Share the port with other listeners, and leave room to ride out scheduling delays
+      setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (const char *)&on, sizeof(on));
+      setsockopt(fd, SOL_SOCKET, SO_RCVBUF, (const char *)&size, sizeof(size));
+
+      memset(&addr, 0, sizeof(addr));
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_ANY);
+      addr.sin_port = htons((unsigned short)port);
+      memset(&mreq, 0, sizeof(mreq));
+      mreq.imr_multiaddr.s_addr = inet_addr(group);
+      mreq.imr_interface.s_addr = (intf == NULL) ? htonl(INADDR_ANY) : inet_addr(intf);
+
+      if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+          setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char *)&mreq, sizeof(mreq)) != 0)
+      {
+        closeSocket((ulapi_integer)fd);
+        return -1;
+      }
+
+#ifdef WIN32
+      ioctlsocket(fd, FIONBIO, &nonblocking);
+#else
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+#endif
+      return (ulapi_integer)fd;
+    }
+  }
+
+
+  LIBRARY_API NatNetReceiver::NatNetReceiver (const char *localInterface, const char *group,
+                                              int port, int major, int minor) :
+    task_(NULL),
+    runThread_(true),
+    buffers_(new char[NATNET_BATCH * NATNET_PACKET_MAX]),
+    major_(major),
+    minor_(minor),
+    rejected_(0)
+  {
+    socket_ = openMulticast(localInterface, group, port);
+    if (socket_ < 0)
+    {
+      CRPI_LOG(crpi_robot::CRPI_LOG_ERROR, "Could not join NatNet multicast group %s on port %d.", group, port);
+      return;
+    }
+    //! Frames are stamped on arrival, so their age does not include the receive thread's delay
+    ulapi_socket_set_timestamps(socket_, ULAPI_STAMP_KERNEL);
+    SetMetricLabels("natnet", group);
+    task_ = crpi_robot::SensorHub::Instance().StartLoop(receiveFrames, this, crpi_robot::HUB_SENSOR);
+  }
+
+
+  LIBRARY_API NatNetReceiver::~NatNetReceiver ()
+  {
+    //! The receive thread notices within one poll period
+    runThread_ = false;
+    crpi_robot::SensorHub::Instance().JoinLoop(task_);
+    if (socket_ >= 0)
+    {
+      closeSocket(socket_);
+    }
+    delete [] buffers_;
+  }
+
+
+  LIBRARY_API bool NatNetReceiver::Listening () const
+  {
+    return task_ != NULL;
+  }
+
+
+  LIBRARY_API unsigned long NatNetReceiver::Rejected () const
+  {
+    return rejected_.load(std::memory_order_relaxed);
+  }
+
+
+  void NatNetReceiver::receiveFrames (void *param)
+  {
+    NatNetReceiver *nn = (NatNetReceiver*)param;
+    ulapi_datagram msgs[NATNET_BATCH];
+    ulapi_integer ready;
+    int i, count;
+
+    for (i = 0; i < NATNET_BATCH; ++i)
+    {
+      msgs[i].buf = nn->buffers_ + ((size_t)i * NATNET_PACKET_MAX);
+      msgs[i].size = NATNET_PACKET_MAX;
+    }
+
+    while (nn->runThread_)
+    {
+      if (ulapi_socket_poll(&nn->socket_, &ready, 1, NATNET_POLL_PERIOD) <= 0)
+      {
+        continue;
+      }
+
+      //! Everything queued is read in as few calls as possible (one recvmmsg per batch on
+      //! Linux); a full batch means more may be waiting
+      do
+      {
+        count = (int)ulapi_socket_read_batch(nn->socket_, msgs, NATNET_BATCH);
+        for (i = 0; i < count; ++i)
+        {
+          nn->handlePacket(msgs[i].buf, (int)msgs[i].len, msgs[i].stamp);
+        }
+      } while (count == NATNET_BATCH && nn->runThread_);
+    } // while (nn->runThread_)
+
+    return;
+  }
+
+
+  void NatNetReceiver::handlePacket (const char *data, int length, double received)
+  {
+    unsigned short message, bytes;
+    MoCapFrame *frame;
+    double serverTime;
+
+    //! Header:  message ID and payload size
+    if (length < 4)
+    {
+      rejected_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    memcpy(&message, data, sizeof(message));
+    memcpy(&bytes, data + 2, sizeof(bytes));
+    if (message != NATNET_FRAMEOFDATA)
+    {
+      return;
+    }
+    if ((int)bytes > length - 4)
+    {
+      rejected_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    //! Decoded in place; dropped if readers are holding every buffer
+    frame = BeginFrame();
+    if (frame == NULL)
+    {
+      return;
+    }
+    if (!decodeFrame(data + 4, bytes, *frame, serverTime))
+    {
+      rejected_.fetch_add(1, std::memory_order_relaxed);
+      DiscardFrame(frame);
+      return;
+    }
+    frame->timestamp = FollowClock(serverTime, received) - frame->latency;
+    PublishFrame(frame);
+  }
+
+
+  bool NatNetReceiver::decodeFrame (const char *data, int length, MoCapFrame &frame, double &serverTime)
+  {
+    natnetCursor in(data, length);
+    const char *unlabeled;
+    int i, j, count, markers, unlabeledCount, id, params;
+    float x, y, z, qx, qy, qz, qw;
+    bool valid;
+    char name[16];
+
+    frame.frameNumber = (unsigned int)in.readInt();
+
+    //! Marker sets:  not used
+    count = in.readCount();
+    for (i = 0; i < count && in.ok; ++i)
+    {
+      in.skipString();
+      in.skip(in.readCount(), 12);
+    }
+
+    //! Unlabeled ("other") markers:  copied after the rigid bodies, whose markers come first
+    //! in the arena
+    unlabeledCount = in.readCount();
+    unlabeled = in.ptr;
+    in.skip(unlabeledCount, 12);
+
+    //! Rigid bodies
+    count = in.readCount();
+    for (i = 0; i < count && in.ok; ++i)
+    {
+      id = in.readInt();
+      x = in.readFloat();
+      y = in.readFloat();
+      z = in.readFloat();
+      qx = in.readFloat();
+      qy = in.readFloat();
+      qz = in.readFloat();
+      qw = in.readFloat();
+
+      //! Before 3.0, each rigid body carries its markers (positions, then IDs and sizes)
+      const char *positions = in.ptr;
+      markers = 0;
+      if (major_ < 3)
+      {
+        markers = in.readCount();
+        positions = in.ptr;
+        in.skip(markers, 12);
+        if (major_ >= 2)
+        {
+          in.skip(markers, 8);
+        }
+      }
+      if (major_ >= 2)
+      {
+        in.readFloat();
+      }
+      params = atLeast(major_, minor_, 2, 6) ? in.readShort() : 0x01;
+      valid = (params & 0x01) != 0;
+      if (!in.ok)
+      {
+        break;
+      }
+      if (!valid)
+      {
+        continue;
+      }
+
+      sprintf(name, "%d", id);
+      MoCapFrameSubject *sub = frame.addSubject(InternSubject(name));
+      if (sub == NULL)
+      {
+        continue;
+      }
+      sub->setQuaternion(qw, qx, qy, qz);
+      sub->updateEuler(false);
+      sub->pose.x = x;
+      sub->pose.y = y;
+      sub->pose.z = z;
+      for (j = 0; j < markers; ++j)
+      {
+        float m[3];
+        memcpy(m, positions + (j * 12), sizeof(m));
+        if (frame.addMarker(m[0], m[1], m[2]))
+        {
+          ++sub->markerCount;
+        }
+      }
+      CRPI_LOG(crpi_robot::CRPI_LOG_DEBUG, "Rigid Body [ID=%d] %3.2f %3.2f %3.2f", id, x, y, z);
+    } // for (i = 0; i < count && in.ok; ++i)
+
+    //! Skeletons (2.1 and later):  an ID and a list of rigid bodies, not used
+    if (atLeast(major_, minor_, 2, 1))
+    {
+      count = in.readCount();
+      for (i = 0; i < count && in.ok; ++i)
+      {
+        in.readInt();
+        markers = in.readCount();
+        for (j = 0; j < markers && in.ok; ++j)
+        {
+          in.skip(32);
+          if (major_ < 3)
+          {
+            int n = in.readCount();
+            in.skip(n, 12);
+            in.skip(n, 8);
+          }
+          in.skip(4);
+          if (atLeast(major_, minor_, 2, 6))
+          {
+            in.skip(2);
+          }
+        }
+      }
+    }
+
+    //! Labeled markers (2.3 and later):  ID, position, and size, then params (2.6) and
+    //! residual (3.0); not used
+    if (atLeast(major_, minor_, 2, 3))
+    {
+      in.skip(in.readCount(), 20 + (atLeast(major_, minor_, 2, 6) ? 2 : 0) + ((major_ >= 3) ? 4 : 0));
+    }
+
+    //! Force plates (2.9) and devices (2.11):  ID, then frames of each channel; not used
+    for (int block = 0; block < 2; ++block)
+    {
+      if (!atLeast(major_, minor_, 2, (block == 0) ? 9 : 11))
+      {
+        continue;
+      }
+      count = in.readCount();
+      for (i = 0; i < count && in.ok; ++i)
+      {
+        in.readInt();
+        markers = in.readCount();
+        for (j = 0; j < markers && in.ok; ++j)
+        {
+          in.skip(in.readCount(), 4);
+        }
+      }
+    }
+
+    //! Software latency (s) was dropped in 3.0; later servers only send clock ticks, whose
+    //! rate is in the server description, so their frames report no latency
+    frame.latency = (major_ < 3) ? in.readFloat() : 0.0;
+    if (!in.ok || frame.latency < 0.0)
+    {
+      return false;
+    }
+
+    //! SMPTE timecode (not used), then the server's time stamp (s since it started), a double
+    //! since 2.7.  Later time stamps (3.0) and the parameters are not needed.
+    in.skip(8);
+    serverTime = atLeast(major_, minor_, 2, 7) ? in.readDouble() : (double)in.readFloat();
+    if (!in.ok)
+    {
+      return false;
+    }
+
+    frame.firstUnlabeled = frame.markerCount;
+    for (i = 0; i < unlabeledCount; ++i)
+    {
+      float m[3];
+      memcpy(m, unlabeled + (i * 12), sizeof(m));
+      if (!frame.addMarker(m[0], m[1], m[2]))
+      {
+        break;
+      }
+    }
+    frame.unlabeledCount = frame.markerCount - frame.firstUnlabeled;
+    return true;
+  }
+}
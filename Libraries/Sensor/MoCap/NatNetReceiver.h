@@ -0,0 +1,134 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: CRPI
+//  Subsystem:       Motion Capture Sensor
+//  Workfile:        NatNetReceiver.h
+//  Revision:        1.0 - 14 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Native receiver for OptiTrack (Motive) frames streamed over NatNet
+//  multicast, decoded directly into the pooled frame buffer without the
+//  NatNet SDK.
+//
+//  To use, select Multicast as the streaming "Type" in Motive's Advanced
+//  Network Settings.  Any number of receivers (in one process or several) may
+//  listen to the same group.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef NATNETRECEIVER_H
+#define NATNETRECEIVER_H
+
+#include <atomic>
+
+#if defined(_MSC_VER)
+#include <ulapi.h>
+#elif defined(__GNUC__)
+#include "../../ulapi/src/ulapi.h"
+#endif
+
+#include "MoCapStream.h"
+
+//! @brief Motive's default multicast group and data port
+//!
+#define NATNET_MULTICAST_GROUP "239.255.42.99"
+#define NATNET_DATA_PORT 1511
+
+namespace Sensor
+{
+  //! @ingroup Sensor
+  //!
+  //! @brief   Listener for the NatNet multicast data stream.  A single thread drains the socket
+  //!          in batches (recvmmsg on Linux) whenever it becomes readable and decodes each frame
+  //!          in place into a pooled MoCapFrame, so no SDK callback, intermediate copy, or lock
+  //!          sits between the network and readers.  Rigid bodies are named by their NatNet
+  //!          ID, and orientations are reported in radians, as by OptiTrack.
+  //!
+  class LIBRARY_API NatNetReceiver : public MoCapStream
+  {
+  public:
+
+    //! @brief Default constructor
+    //!
+    //! @param localInterface Address of the network interface on which to join the group (NULL
+    //!                       for the system default)
+    //! @param group          Multicast group to which the server streams
+    //! @param port           Data port to which the server streams
+    //! @param major          NatNet stream version (major) of the server; frame layouts differ
+    //!                       between versions and are not self-describing
+    //! @param minor          NatNet stream version (minor) of the server
+    //!
+    NatNetReceiver (const char *localInterface = NULL, const char *group = NATNET_MULTICAST_GROUP,
+                    int port = NATNET_DATA_PORT, int major = 2, int minor = 9);
+
+    //! @brief Default destructor
+    //!
+    ~NatNetReceiver ();
+
+    //! @brief Whether the receiver joined the group and is listening
+    //!
+    bool Listening () const;
+
+    //! @brief Number of datagrams received that were not valid frames of data for the stream
+    //!        version (other message types are not counted)
+    //!
+    unsigned long Rejected () const;
+
+  private:
+
+    //! @brief Receive thread:  waits for the socket to become readable and decodes everything
+    //!        queued on it
+    //!
+    //! @param param The NatNetReceiver object being served
+    //!
+    static void receiveFrames (void *param);
+
+    //! @brief Decode one datagram
+    //!
+    //! @param data     The datagram
+    //! @param length   Bytes in the datagram
+    //! @param received Time (ulapi_time, s) at which it was received
+    //!
+    void handlePacket (const char *data, int length, double received);
+
+    //! @brief Decode the payload of a frame of data message
+    //!
+    //! @param data       The payload
+    //! @param length     Bytes in the payload
+    //! @param frame      The frame to fill
+    //! @param serverTime Set to the server's time stamp of the frame (s)
+    //!
+    //! @return True if the payload was a complete frame, false otherwise
+    //!
+    bool decodeFrame (const char *data, int length, MoCapFrame &frame, double &serverTime);
+
+    //! @brief Handle for the receive thread
+    //!
+    void *task_;
+
+    //! @brief Flag to stop the receive thread
+    //!
+    std::atomic<bool> runThread_;
+
+    //! @brief The multicast socket (-1 if it could not be opened)
+    //!
+    ulapi_integer socket_;
+
+    //! @brief Receive buffers, one per datagram of a batch
+    //!
+    char *buffers_;
+
+    //! @brief NatNet stream version of the server
+    //!
+    int major_;
+    int minor_;
+
+    //! @brief Count of datagrams that failed to decode
+    //!
+    std::atomic<unsigned long> rejected_;
+  }; // NatNetReceiver
+} // Sensor namespace
+
+#endif
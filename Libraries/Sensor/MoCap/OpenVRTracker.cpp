@@ -0,0 +1,302 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: CRPI
+//  Subsystem:       Motion Capture Sensor
+//  Workfile:        OpenVRTracker.cpp
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Interface library for devices tracked by the OpenVR runtime
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "OpenVRTracker.h"
+
+#if defined(_MSC_VER)
+#include <crpi_hub.h>
+#include <crpi_log.h>
+#else
+#include "../../CRPI/crpi_hub.h"
+#include "../../CRPI/crpi_log.h"
+#endif
+
+#include <cstdio>
+#include <cstring>
+
+//! @brief Weight of each new sample in the measured latency
+//!
+#define OPENVR_LATENCY_GAIN 0.05
+
+using namespace std;
+
+namespace Sensor
+{
+  //! @brief OpenVR (right-handed, Y up, -Z forward) to the reported frame (X forward, Y left,
+  //!        Z up):  axis i of the reported frame is sign[i] times axis source[i] of OpenVR's
+  //!
+  static const int axisSource[3] = { 2, 0, 1 };
+  static const double axisSign[3] = { -1.0, -1.0, 1.0 };
+
+
+  void OpenVRTracker::pollPoses (void *param)
+  {
+    OpenVRTracker *tracker = (OpenVRTracker*)param;
+    MoCapFrame *frame;
+    double start, ahead, next, sample, latency;
+
+    next = ulapi_time();
+    while (tracker->runThread_)
+    {
+      if (tracker->system_ == NULL && !tracker->connect())
+      {
+        //! SteamVR is not running:  check again shortly
+        ulapi_sleep(1.0);
+        next = ulapi_time();
+        continue;
+      }
+
+      if (!tracker->pumpEvents())
+      {
+        continue;
+      }
+
+      //! Ask for the poses at the time the frame will be published
+      start = ulapi_time();
+      latency = tracker->latency_.load();
+      ahead = latency + tracker->prediction_.load();
+      tracker->system_->GetDeviceToAbsoluteTrackingPose(vr::TrackingUniverseStanding, (float)ahead,
+                                                        tracker->poses_, vr::k_unMaxTrackedDeviceCount);
+
+      //! Filled in place; dropped if readers are holding every buffer
+      frame = tracker->BeginFrame();
+      if (frame != NULL)
+      {
+        frame->frameNumber = ++tracker->frameNumber_;
+        frame->latency = latency;
+        frame->timestamp = start + ahead;
+        tracker->readFrame(*frame);
+        tracker->PublishFrame(frame);
+
+        sample = ulapi_time() - start;
+        tracker->latency_.store((latency > 0.0) ? (latency + (OPENVR_LATENCY_GAIN * (sample - latency))) : sample);
+      }
+
+      //! Hold the rate; a poll that overran starts the next period now rather than catching up
+      next += tracker->period_;
+      if (next < ulapi_time())
+      {
+        next = ulapi_time();
+      }
+      ulapi_sleep_until(next);
+    } // while (tracker->runThread_)
+
+    if (tracker->system_ != NULL)
+    {
+      tracker->connected_ = false;
+      tracker->system_ = NULL;
+      vr::VR_Shutdown();
+    }
+  }
+
+
+  LIBRARY_API OpenVRTracker::OpenVRTracker (double rate, bool controllers) :
+    runThread_(true),
+    system_(NULL),
+    connected_(false),
+    controllers_(controllers),
+    latency_(0.0),
+    prediction_(0.0),
+    frameNumber_(0)
+  {
+    period_ = 1.0 / ((rate > 0.0) ? rate : OPENVR_POLL_RATE);
+    for (vr::TrackedDeviceIndex_t i = 0; i < vr::k_unMaxTrackedDeviceCount; ++i)
+    {
+      subjects_[i] = -1;
+      present_[i] = false;
+    }
+
+    SetMetricLabels("openvr", "localhost");
+    task_ = crpi_robot::SensorHub::Instance().StartLoop(pollPoses, this, crpi_robot::HUB_SENSOR);
+  }
+
+
+  LIBRARY_API OpenVRTracker::~OpenVRTracker ()
+  {
+    //! The acquisition thread releases the runtime as it exits
+    runThread_ = false;
+    crpi_robot::SensorHub::Instance().JoinLoop(task_);
+  }
+
+
+  bool OpenVRTracker::connect ()
+  {
+    vr::EVRInitError error = vr::VRInitError_None;
+
+    if (!vr::VR_IsRuntimeInstalled())
+    {
+      return false;
+    }
+
+    //! As a background application, so that SteamVR is not started (or kept running) on our
+    //! account
+    system_ = vr::VR_Init(&error, vr::VRApplication_Background);
+    if (error != vr::VRInitError_None || system_ == NULL)
+    {
+      CRPI_LOG(crpi_robot::CRPI_LOG_ERROR, "Could not attach to the OpenVR runtime:  %s",
+               vr::VR_GetVRInitErrorAsEnglishDescription(error));
+      system_ = NULL;
+      return false;
+    }
+
+    //! Devices are identified afresh on the first poll
+    for (vr::TrackedDeviceIndex_t i = 0; i < vr::k_unMaxTrackedDeviceCount; ++i)
+    {
+      present_[i] = false;
+    }
+    latency_ = 0.0;
+    connected_ = true;
+    return true;
+  }
+
+
+  bool OpenVRTracker::pumpEvents ()
+  {
+    vr::VREvent_t event;
+
+    while (system_->PollNextEvent(&event, sizeof(event)))
+    {
+      if (event.eventType == vr::VREvent_Quit)
+      {
+        //! SteamVR is shutting down:  let go of it and wait for it to return
+        system_->AcknowledgeQuit_Exiting();
+        connected_ = false;
+        system_ = NULL;
+        vr::VR_Shutdown();
+        return false;
+      }
+    }
+    return true;
+  }
+
+
+  void OpenVRTracker::identify (vr::TrackedDeviceIndex_t device)
+  {
+    vr::ETrackedDeviceClass type = system_->GetTrackedDeviceClass(device);
+    char serial[vr::k_unMaxPropertyStringSize < 128 ? vr::k_unMaxPropertyStringSize : 128];
+
+    subjects_[device] = -1;
+    if (type == vr::TrackedDeviceClass_GenericTracker ||
+        (controllers_ && type == vr::TrackedDeviceClass_Controller))
+    {
+      if (system_->GetStringTrackedDeviceProperty(device, vr::Prop_SerialNumber_String, serial, sizeof(serial)) == 0)
+      {
+        sprintf(serial, "device%u", device);
+      }
+      subjects_[device] = InternSubject(serial);
+      CRPI_LOG(crpi_robot::CRPI_LOG_INFO, "Tracking %s (device %u)", serial, device);
+    }
+  }
+
+
+  void OpenVRTracker::readFrame (MoCapFrame &frame)
+  {
+    MoCapFrameSubject *subject;
+    int i, j;
+
+    for (vr::TrackedDeviceIndex_t device = 0; device < vr::k_unMaxTrackedDeviceCount; ++device)
+    {
+      const vr::TrackedDevicePose_t &pose = poses_[device];
+
+      //! A device is looked up when it appears (or reappears) at an index
+      if (pose.bDeviceIsConnected != present_[device])
+      {
+        present_[device] = pose.bDeviceIsConnected;
+        if (pose.bDeviceIsConnected)
+        {
+          identify(device);
+        }
+      }
+
+      if (!pose.bDeviceIsConnected || !pose.bPoseIsValid || subjects_[device] < 0)
+      {
+        continue;
+      }
+
+      subject = frame.addSubject(subjects_[device]);
+      if (subject == NULL)
+      {
+        break;
+      }
+
+      const float (*m)[4] = pose.mDeviceToAbsoluteTracking.m;
+      for (i = 0; i < 3; ++i)
+      {
+        for (j = 0; j < 3; ++j)
+        {
+          subject->rotation[(i * 3) + j] = axisSign[i] * axisSign[j] * m[axisSource[i]][axisSource[j]];
+        }
+      }
+      subject->updateEuler(false);
+
+      //! Meters to millimeters
+      subject->pose.x = axisSign[0] * m[axisSource[0]][3] * 1000.0;
+      subject->pose.y = axisSign[1] * m[axisSource[1]][3] * 1000.0;
+      subject->pose.z = axisSign[2] * m[axisSource[2]][3] * 1000.0;
+    }
+
+    frame.firstUnlabeled = frame.markerCount;
+    frame.unlabeledCount = 0;
+  }
+
+
+  LIBRARY_API bool OpenVRTracker::Connected () const
+  {
+    return connected_;
+  }
+
+
+  LIBRARY_API void OpenVRTracker::SetPrediction (double seconds)
+  {
+    prediction_ = seconds;
+  }
+
+
+  LIBRARY_API double OpenVRTracker::Latency () const
+  {
+    return latency_;
+  }
+
+
+  LIBRARY_API void OpenVRTracker::GetCurrentSubjects (vector<MoCapSubject> &subjects)
+  {
+    MoCapFrameView view;
+    MoCapSubject sub;
+    int i, j;
+
+    subjects.clear();
+    if (view.acquire(*frames_))
+    {
+      for (i = 0; i < view->subjectCount; ++i)
+      {
+        const MoCapFrameSubject &subject = view->subjects[i];
+        sub.name = view.name(i);
+        sub.pose = subject.pose;
+        for (j = 0; j < 9; ++j)
+        {
+          sub.rotation.at(j / 3, j % 3) = subject.rotation[j];
+        }
+        sub.labeledMarkers.clear();
+        sub.valid = true;
+        subjects.push_back(sub);
+      }
+    }
+  }
+
+
+  LIBRARY_API void OpenVRTracker::GetUnlabeledMarkers (vector<point> &markers)
+  {
+    markers.clear();
+  }
+}
@@ -0,0 +1,172 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+//  Original System: CRPI
+//  Subsystem:       Motion Capture Sensor
+//  Workfile:        OpenVRTracker.h
+//  Revision:        1.0 - 15 October, 2026
+//  Author:          J. Marvel
+//
+//  Description
+//  ===========
+//  Interface library for Vive trackers (and other tracked devices) through
+//  the OpenVR runtime (SteamVR).
+//
+//  SteamVR must be running; the tracker attaches as a background application
+//  and does not start it.  Trackers without a headset need SteamVR's null
+//  display driver ("requireHmd": false in steamvr.vrsettings).  Poses are
+//  reported in millimeters in a Z-up frame (X forward, Y left), as by Vicon,
+//  with the orientation in radians.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef OPENVRTRACKER_H
+#define OPENVRTRACKER_H
+
+#include <atomic>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <ulapi.h>
+#include <crpi.h>
+#include "MatrixMath.h"
+#include "openvr.h"
+#elif defined(__GNUC__)
+#include "../../ulapi/src/ulapi.h"
+#include "../../CRPI/crpi.h"
+#include "../../Math/MatrixMath.h"
+#include "../../ThirdParty/OpenVR/headers/openvr.h"
+#endif
+
+#include "MoCapStream.h"
+
+//! @brief Default polling rate (Hz) of the tracked device poses
+//!
+#define OPENVR_POLL_RATE 250.0
+
+using namespace std;
+using namespace Math;
+
+namespace Sensor
+{
+  //! @ingroup Sensor
+  //!
+  //! @brief   Interface class for devices tracked by the OpenVR runtime.  A thread polls every
+  //!          device's pose with GetDeviceToAbsoluteTrackingPose and publishes a frame per poll.
+  //!          The runtime extrapolates each pose to the time asked for, so the thread asks for
+  //!          the time at which the frame will be published:  it measures how long a poll takes
+  //!          from the call to the publish and predicts each pose that far forward.  Frame
+  //!          timestamps are the predicted time and need no further latency correction.  Devices
+  //!          are named by their serial numbers (e.g., "LHR-1A2B3C4D").
+  //!
+  class LIBRARY_API OpenVRTracker : public MoCapStream
+  {
+  public:
+
+    //! @brief Default constructor
+    //!
+    //! @param rate        Polling rate (Hz)
+    //! @param controllers Whether to report controllers as well as generic trackers
+    //!
+    OpenVRTracker (double rate = OPENVR_POLL_RATE, bool controllers = false);
+
+    //! @brief Default destructor
+    //!
+    ~OpenVRTracker ();
+
+    //! @brief Query the runtime for a list of tracked devices
+    //!
+    //! @param subjects Vector populated by the function with MoCapSubject objects
+    //!
+    void GetCurrentSubjects (vector<MoCapSubject> &subjects);
+
+    //! @brief Tracked devices have no markers; the vector is always emptied
+    //!
+    //! @param markers Vector populated by the function with point objects
+    //!
+    void GetUnlabeledMarkers (vector<point> &markers);
+
+    //! @brief Whether the runtime is connected
+    //!
+    bool Connected () const;
+
+    //! @brief Set a prediction (s) added to the measured latency, e.g., to report where the
+    //!        devices will be when a reader acts on the frame
+    //!
+    void SetPrediction (double seconds);
+
+    //! @brief The measured delay (s) from a poll to the publication of its frame
+    //!
+    double Latency () const;
+
+  private:
+
+    //! @brief Acquisition thread:  connects to the runtime and polls it at the set rate
+    //!
+    //! @param param The OpenVRTracker object being served
+    //!
+    static void pollPoses (void *param);
+
+    //! @brief Attach to the runtime
+    //!
+    //! @return True if the runtime is running and was attached, false otherwise
+    //!
+    bool connect ();
+
+    //! @brief Handle the runtime's events
+    //!
+    //! @return False if the runtime is quitting (and has been released), true otherwise
+    //!
+    bool pumpEvents ();
+
+    //! @brief Look up whether a device is reported and, if so, intern its serial number
+    //!
+    //! @param device Index of the device
+    //!
+    void identify (vr::TrackedDeviceIndex_t device);
+
+    //! @brief Copy the devices' poses into a frame
+    //!
+    //! @param frame Populated by the function with the tracked devices
+    //!
+    void readFrame (MoCapFrame &frame);
+
+    //! @brief Handle for the acquisition thread
+    //!
+    void *task_;
+
+    //! @brief Flag to stop the acquisition thread
+    //!
+    std::atomic<bool> runThread_;
+
+    //! @brief The runtime's system interface (NULL while not connected)
+    //!
+    vr::IVRSystem *system_;
+    std::atomic<bool> connected_;
+
+    //! @brief Seconds between polls, and whether controllers are reported
+    //!
+    double period_;
+    bool controllers_;
+
+    //! @brief Measured latency and the added prediction (s)
+    //!
+    std::atomic<double> latency_;
+    std::atomic<double> prediction_;
+
+    //! @brief Number of frames published
+    //!
+    unsigned int frameNumber_;
+
+    //! @brief Poses returned by the runtime
+    //!
+    vr::TrackedDevicePose_t poses_[vr::k_unMaxTrackedDeviceCount];
+
+    //! @brief Subject id of each device index (-1 for devices that are not reported), and
+    //!        whether the index held a connected device at the last poll
+    //!
+    int subjects_[vr::k_unMaxTrackedDeviceCount];
+    bool present_[vr::k_unMaxTrackedDeviceCount];
+  }; // OpenVRTracker
+} // Sensor namespace
+
+#endif
@@ -14,6 +14,12 @@
 
 #include "OptiTrack.h"
 
+#if defined(_MSC_VER)
+#include <crpi_log.h>
+#elif defined(__GNUC__)
+#include "../../CRPI/crpi_log.h"
+#endif
+
 #include <iostream>
 #include <fstream>
 #include <cassert>
@@ -30,79 +36,52 @@
 
 #include <time.h>
 
-//#define OPTITRACK_NOISY
-
 using namespace std;
 
 namespace Sensor
 {
   void __cdecl MsgHandler(int msgType, char* msg)
   {
-    printf("\n%s\n", msg);
+    CRPI_LOG(crpi_robot::CRPI_LOG_INFO, "OptiTrack:  %s", msg);
   }
 
   void __cdecl DataHandler(sFrameOfMocapData* data, void* pUserData)
   {
     OTPointer *otp = (OTPointer*)pUserData;
+    double received = ulapi_time();
     int i = 0;
     Math::point pt;
     char name[128];
-    vector<double> q;
-    vector<double> e;
 
-#ifdef OPTITRACK_NOISY
-    printf("FrameID : %d\n", data->iFrame);
-    printf("Timestamp :  %3.2lf\n", data->fTimestamp);
-    printf("Latency :  %3.2lf\n", data->fLatency);
-
-    bool bIsRecording = ((data->params & 0x01) != 0);
-    bool bTrackedModelsChanged = ((data->params & 0x02) != 0);
-    if (bIsRecording)
-    {
-      printf("RECORDING\n");
-    }
-    if (bTrackedModelsChanged)
-    {
-      printf("Models Changed.\n");
-    }
-#endif
+    CRPI_LOG(crpi_robot::CRPI_LOG_DEBUG, "FrameID : %d  Timestamp : %3.2f  Latency : %3.2f%s%s", data->iFrame, data->fTimestamp,
+             data->fLatency, ((data->params & 0x01) != 0) ? "  RECORDING" : "",
+             ((data->params & 0x02) != 0) ? "  Models Changed." : "");
 
     //! Timecode - for systems with an eSync and SMPTE timecode generator - decode to values
     int hour, minute, second, frame, subframe;
     bool bValid = otp->client->DecodeTimecode(data->Timecode, data->TimecodeSubframe, &hour, &minute, &second, &frame, &subframe);
 
     //! Decode to friendly string
-#ifdef OPTITRACK_NOISY
-    char szTimecode[128] = "";
-    otp->client->TimecodeStringify(data->Timecode, data->TimecodeSubframe, szTimecode, 128);
-    printf("Timecode : %s\n", szTimecode);
-#endif
-
-    //! Other Markers (unlabeled)
-#ifdef OPTITRACK_NOISY
-    printf("Other Markers [Count=%d]\n", data->nOtherMarkers);
-#endif
-
-    ulapi_mutex_take(otp->handle);
+    if (crpi_robot::CrpiLog::Enabled(crpi_robot::CRPI_LOG_DEBUG))
+    {
+      char szTimecode[128] = "";
+      otp->client->TimecodeStringify(data->Timecode, data->TimecodeSubframe, szTimecode, 128);
+      CRPI_LOG(crpi_robot::CRPI_LOG_DEBUG, "Timecode : %s", szTimecode);
+    }
 
-    otp->markers.clear();
-    for (i = 0; i < data->nOtherMarkers; ++i)
+    //! Filled in place; dropped if readers are holding every buffer
+    MoCapFrame *out = otp->stream->BeginFrame();
+    if (out == NULL)
     {
-      pt.x = data->OtherMarkers[i][0];
-      pt.y = data->OtherMarkers[i][1];
-      pt.z = data->OtherMarkers[i][2];
-#ifdef OPTITRACK_NOISY
-      printf("Other Marker %d : %3.2f\t%3.2f\t%3.2f\n", i, pt.x, pt.y, pt.z);
-#endif
-      otp->markers.push_back(pt);
-    } // for (i = 0; i < data->nOtherMarkers; ++i)
+      return;
+    }
+    out->frameNumber = (unsigned int)data->iFrame;
+    out->latency = data->fLatency;
+    out->timestamp = otp->stream->FollowClock(data->fTimestamp, received) - data->fLatency;
 
     //! Rigid Bodies
-#ifdef OPTITRACK_NOISY
-    printf("Rigid Bodies [Count=%d]\n", data->nRigidBodies);
-#endif
+    CRPI_LOG(crpi_robot::CRPI_LOG_DEBUG, "Rigid Bodies [Count=%d]", data->nRigidBodies);
 
-    otp->subjects.clear();
     for (i = 0; i < data->nRigidBodies; ++i)
     {
       //! 0x01 : bool, rigid body was successfully tracked in this frame
@@ -110,38 +89,26 @@ namespace Sensor
 
       if (bTrackingValid)
       {
-        MoCapSubject sub;
-        //subject = new OptiTrackSubject();
-
-        q.clear();
-        q.push_back(data->RigidBodies[i].qw);
-        q.push_back(data->RigidBodies[i].qx);
-        q.push_back(data->RigidBodies[i].qy);
-        q.push_back(data->RigidBodies[i].qz);
-
-        bool val = sub.rotation.rotQuaternionMatrixConvert(q);
-        val = sub.rotation.rotMatrixEulerConvert(e);
-        sub.pose.xr = e.at(0);
-        sub.pose.yr = e.at(1);
-        sub.pose.zr = e.at(2);
-
-        sub.pose.x = data->RigidBodies[i].x;
-        sub.pose.y = data->RigidBodies[i].y;
-        sub.pose.z = data->RigidBodies[i].z;
-
         sprintf(name, "%d", data->RigidBodies[i].ID);
-        sub.name = name;
+        MoCapFrameSubject *sub = out->addSubject(otp->stream->InternSubject(name));
+        if (sub == NULL)
+        {
+          break;
+        }
 
-#ifdef OPTITRACK_NOISY
-        printf("Rigid Body [ID=%s  Error=%3.2f  Valid=%d]\n", sub.name.c_str(), data->RigidBodies[i].MeanError, bTrackingValid);
-        printf("\tx\ty\tz\trx\try\trz\n");
-        printf("\t%3.2f\t%3.2f\t%3.2f\t%3.2f\t%3.2f\t%3.2f\n", sub.pose.x, sub.pose.y, sub.pose.z, sub.pose.xrot, sub.pose.yrot, sub.pose.zrot);
-#endif
+        sub->setQuaternion(data->RigidBodies[i].qw, data->RigidBodies[i].qx,
+                           data->RigidBodies[i].qy, data->RigidBodies[i].qz);
+        sub->updateEuler(false);
 
-#ifdef OPTITRACK_NOISY
-        printf("\tRigid body markers [Count=%d]\n", data->RigidBodies[i].nMarkers);
-#endif
-        sub.labeledMarkers.clear();
+        sub->pose.x = data->RigidBodies[i].x;
+        sub->pose.y = data->RigidBodies[i].y;
+        sub->pose.z = data->RigidBodies[i].z;
+
+        CRPI_LOG(crpi_robot::CRPI_LOG_DEBUG, "Rigid Body [ID=%s  Error=%3.2f  Valid=%d]", name, data->RigidBodies[i].MeanError,
+                 (int)bTrackingValid);
+        CRPI_LOG(crpi_robot::CRPI_LOG_DEBUG, "\t%3.2f\t%3.2f\t%3.2f\t%3.2f\t%3.2f\t%3.2f", sub->pose.x, sub->pose.y, sub->pose.z,
+                 sub->pose.xr, sub->pose.yr, sub->pose.zr);
+        CRPI_LOG(crpi_robot::CRPI_LOG_DEBUG, "\tRigid body markers [Count=%d]", data->RigidBodies[i].nMarkers);
         for (int iMarker = 0; iMarker < data->RigidBodies[i].nMarkers; ++iMarker)
         {
           if (data->RigidBodies[i].Markers)
@@ -150,28 +117,34 @@ namespace Sensor
             pt.y = data->RigidBodies[i].Markers[iMarker][1];
             pt.z = data->RigidBodies[i].Markers[iMarker][2];
           }
-          sub.labeledMarkers.push_back(pt);
-#ifdef OPTITRACK_NOISY
-          printf("\t\t");
-          if (data->RigidBodies[i].MarkerIDs)
+          if (out->addMarker(pt.x, pt.y, pt.z))
           {
-            printf("MarkerID:%d", data->RigidBodies[i].MarkerIDs[iMarker]);
+            ++sub->markerCount;
           }
-          if (data->RigidBodies[i].MarkerSizes)
-          {
-            printf("\tMarkerSize:%3.2f", data->RigidBodies[i].MarkerSizes[iMarker]);
-          }
-          if (data->RigidBodies[i].Markers)
-          {
-            printf("\tMarkerPos:%3.2f,%3.2f,%3.2f\n", pt.x, pt.y, pt.z);
-          }
-#endif
+          CRPI_LOG(crpi_robot::CRPI_LOG_DEBUG, "\t\tMarkerID:%d\tMarkerSize:%3.2f\tMarkerPos:%3.2f,%3.2f,%3.2f",
+                   data->RigidBodies[i].MarkerIDs ? data->RigidBodies[i].MarkerIDs[iMarker] : -1,
+                   data->RigidBodies[i].MarkerSizes ? data->RigidBodies[i].MarkerSizes[iMarker] : 0.0f,
+                   pt.x, pt.y, pt.z);
         } // for (int iMarker = 0; iMarker < data->RigidBodies[i].nMarkers; ++iMarker)
-        sub.valid = true;
-        otp->subjects.push_back(sub);
       } // if (bTrackingValid)
     } // for (i = 0; i < data->nRigidBodies; ++i)
-    ulapi_mutex_give(otp->handle);
+
+    //! Other Markers (unlabeled)
+    CRPI_LOG(crpi_robot::CRPI_LOG_DEBUG, "Other Markers [Count=%d]", data->nOtherMarkers);
+
+    out->firstUnlabeled = out->markerCount;
+    for (i = 0; i < data->nOtherMarkers; ++i)
+    {
+      CRPI_LOG(crpi_robot::CRPI_LOG_DEBUG, "Other Marker %d : %3.2f\t%3.2f\t%3.2f", i, data->OtherMarkers[i][0], data->OtherMarkers[i][1],
+               data->OtherMarkers[i][2]);
+      if (!out->addMarker(data->OtherMarkers[i][0], data->OtherMarkers[i][1], data->OtherMarkers[i][2]))
+      {
+        break;
+      }
+    } // for (i = 0; i < data->nOtherMarkers; ++i)
+    out->unlabeledCount = out->markerCount - out->firstUnlabeled;
+
+    otp->stream->PublishFrame(out);
   }
 
 
@@ -182,11 +155,12 @@ namespace Sensor
 
     // Interface options  
     std::string HostName = ipAddress;
-    otp_->handle = ulapi_mutex_new(78);
 
     int result;
     Client_ = new NatNetClient(ConnectionType_Unicast);
     otp_->client = Client_;
+    otp_->stream = this;
+    SetMetricLabels("optitrack", ipAddress);
 
     Client_->SetVerbosityLevel(Verbosity_Warning);
     Client_->SetMessageCallback(MsgHandler);
@@ -207,7 +181,7 @@ namespace Sensor
       result = Client_->Initialize(myIPAddress, ipAddress);
       if (result != ErrorCode_OK)
       {
-        printf("Could not connect to OptiTrack server.");
+        CRPI_LOG(crpi_robot::CRPI_LOG_WARNING, "Could not connect to OptiTrack server.");
       }
       else
       {
@@ -217,7 +191,7 @@ namespace Sensor
         Client_->GetServerDescription(&sd);
         if (!sd.HostPresent)
         {
-          printf("Unable to connect to OptiTrack server.  Host not present.");
+          CRPI_LOG(crpi_robot::CRPI_LOG_WARNING, "Unable to connect to OptiTrack server.  Host not present.");
         }
         else
         {
@@ -237,20 +211,38 @@ namespace Sensor
 
   LIBRARY_API void OptiTrack::GetCurrentSubjects(vector<MoCapSubject> &subjects)
   {
-    subjects.clear();
+    MoCapFrameView view;
+    MoCapSubject sub;
+    int i, j;
 
-    ulapi_mutex_take(otp_->handle);
-    subjects = otp_->subjects;
-    ulapi_mutex_give(otp_->handle);
+    subjects.clear();
+    if (view.acquire(*frames_))
+    {
+      for (i = 0; i < view->subjectCount; ++i)
+      {
+        const MoCapFrameSubject &subject = view->subjects[i];
+        sub.name = view.name(i);
+        sub.pose = subject.pose;
+        for (j = 0; j < 9; ++j)
+        {
+          sub.rotation.at(j / 3, j % 3) = subject.rotation[j];
+        }
+        sub.labeledMarkers.assign(view->subjectMarkers(i), view->subjectMarkers(i) + subject.markerCount);
+        sub.valid = true;
+        subjects.push_back(sub);
+      }
+    }
   }
 
 
   LIBRARY_API void OptiTrack::GetUnlabeledMarkers(vector<point> &markers)
   {
-    markers.clear();
+    MoCapFrameView view;
 
-    ulapi_mutex_take(otp_->handle);
-    markers = otp_->markers;
-    ulapi_mutex_give(otp_->handle);
+    markers.clear();
+    if (view.acquire(*frames_))
+    {
+      markers.assign(view->unlabeledMarkers(), view->unlabeledMarkers() + view->unlabeledCount);
+    }
   }
 }
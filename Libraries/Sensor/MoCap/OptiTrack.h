@@ -34,7 +34,7 @@
 
 #include "NatNetTypes.h"
 #include "NatNetClient.h"
-#include "MoCapTypes.h"
+#include "MoCapStream.h"
 #pragma warning( disable : 4996 )
 using namespace Math;
 #elif defined(__GNUC__)
@@ -46,7 +46,7 @@ using namespace Math;
 
 #include "../../ThirdParty/OptiTrack/include/NatNetTypes.h"
 #include "../../ThirdParty/OptiTrack/include/NatNetClient.h"
-#include "MoCapTypes.h"
+#include "MoCapStream.h"
 #endif
 
 
@@ -59,22 +59,15 @@ namespace Sensor
   //!
   typedef LIBRARY_API struct OTPointer_
   {
-    //! @brief Collection of rigid bodies being tracked
+    //! @brief Stream receiving the frames of tracked rigid bodies and markers, filled by the
+    //!        data callback
     //!
-    vector<MoCapSubject> subjects;
-
-    //! @brief Collection of un-named markers detected in the scene
-    //!
-    vector<point>        markers;
+    MoCapStream          *stream;
 
     //! @brief Handle of the OptiTrack sensor instance
     //!
     NatNetClient         *client;
 
-    //! @brief Mutex handle for data protection
-    //!
-    ulapi_mutex_struct   *handle;
-
     //! @brief Flag to specify when threads should be killed cleanly and remotely
     //!
     bool                 runThread;
@@ -84,13 +77,7 @@ namespace Sensor
     OTPointer_()
     {
       runThread = true;
-    }
-
-    //! @brief Default destructor
-    //!
-    ~OTPointer_()
-    {
-      markers.clear();
+      stream = NULL;
     }
   } OTPointer;
 
@@ -99,7 +86,7 @@ namespace Sensor
   //!
   //! @brief   Interface class for the OptiTrack motion capture system
   //!
-  class LIBRARY_API OptiTrack
+  class LIBRARY_API OptiTrack : public MoCapStream
   {
   public:
 
@@ -122,6 +109,7 @@ namespace Sensor
     //! @param markers Vector populated by the function with point objects
     //!
     void GetUnlabeledMarkers(vector<point> &markers);
+
     
   private:
 
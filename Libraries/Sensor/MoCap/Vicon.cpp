@@ -15,6 +15,14 @@
 
 #include "Vicon.h"
 
+#if defined(_MSC_VER)
+#include <crpi_hub.h>
+#include <crpi_log.h>
+#elif defined(__GNUC__)
+#include "../../CRPI/crpi_hub.h"
+#include "../../CRPI/crpi_log.h"
+#endif
+
 #include <iostream>
 #include <fstream>
 #include <cassert>
@@ -32,8 +40,6 @@
 
 #include <time.h>
 
-//#define VICON_NOISY
-
 using namespace std;
 using namespace ViconDataStreamSDK::CPP;
 
@@ -162,42 +168,49 @@ namespace Sensor
   }
 
 
-  void livemanVicon (void *param)
+  void Vicon::acquireFrames (void *param)
   {
-    keepalive *ka = (keepalive*)param;
-    crpi_timer timer;
-
-    size_t FrameRateWindow = 1000;
-    size_t Counter = 0;
-    clock_t LastTime = clock();
+    Vicon *vicon = (Vicon*)param;
+    keepalive *ka = &vicon->ka_;
+    Client *client = (Client*)ka->rob;
+    MoCapFrame *frame;
     Result::Enum gtfo;
+    double received, rate;
 
     while (ka->runThread)
     {
-      //! Grab the next frame
-#ifdef VICON_NOISY
-      cout << "Waiting for new frame...";
-#endif
-      do
+      //! In ServerPush mode GetFrame blocks until the next frame arrives, so frames are
+      //! delivered at the tracker's rate.  The client is only used by this thread once it is
+      //! running, so no lock is held while waiting.
+      CRPI_LOG(crpi_robot::CRPI_LOG_DEBUG, "Waiting for new frame...");
+      gtfo = client->GetFrame().Result;
+      received = ulapi_time();
+      if (gtfo != Result::Success)
       {
-        ulapi_mutex_take(ka->handle);
-        gtfo = ((Client*)ka->rob)->GetFrame().Result;
-        ulapi_mutex_give(ka->handle);
-        // Sleep a little so that we don't lumber the CPU with a busy poll
-#ifdef WIN32
-        Sleep (100);
-#else
-        usleep(100000);
-#endif
-#ifdef VICON_NOISY
-        cout << ".";
-#endif
-      } while(gtfo != Result::Success );
+        //! Not connected (or no data yet):  back off briefly rather than spin
+        ulapi_sleep(0.001);
+        continue;
+      }
 
-#ifdef VICON_NOISY
-      cout << endl;
-#endif 
-      timer.waitUntil(100);
+      //! Filled in place; dropped if readers are holding every buffer
+      frame = vicon->BeginFrame();
+      if (frame == NULL)
+      {
+        continue;
+      }
+      frame->frameNumber = client->GetFrameNumber().FrameNumber;
+      frame->latency = client->GetLatencyTotal().Total;
+
+      //! Frames are numbered at the cameras' rate, which makes the frame number the tracker's
+      //! clock
+      rate = client->GetFrameRate().FrameRateHz;
+      if (rate > 0.0)
+      {
+        received = vicon->FollowClock(frame->frameNumber / rate, received);
+      }
+      frame->timestamp = received - frame->latency;
+      vicon->readFrame(*frame);
+      vicon->PublishFrame(frame);
     } // while (ka->runThread)
 
     return;
@@ -206,21 +219,19 @@ namespace Sensor
 
   LIBRARY_API Vicon::Vicon (char * ipAddress)
   {
-    task_ = ulapi_task_new();
-
     // Interface options  
     std::string HostName = ipAddress;
     HostName.append(":801");
     client_ = new Client();
     ka_.rob = client_;
     ka_.handle = ulapi_mutex_new(78);
+    ulapi_lock_name(ka_.handle, "Vicon frame");
+    ka_.runThread = true;
 
     for(int i=0; i != 3; ++i) // repeat to check disconnecting doesn't wreck next connect
     {
       // Connect to a server
-#ifdef VICON_NOISY
-      cout << "Connecting to " << HostName << " ..." << std::flush;
-#endif
+      CRPI_LOG(crpi_robot::CRPI_LOG_DEBUG, "Connecting to %s ...", HostName.c_str());
       while(!((Client*)ka_.rob)->IsConnected().Connected)
       {
         // Direct connection
@@ -228,18 +239,14 @@ namespace Sensor
         ok =(((Client*)ka_.rob)->Connect( HostName ).Result == Result::Success );
         if(!ok)
         {
-          cout << "Warning - connect failed..." << endl;
+          CRPI_LOG(crpi_robot::CRPI_LOG_WARNING, "Vicon:  connect to %s failed", HostName.c_str());
         }
-#ifdef VICON_NOISY
-        cout << ".";
-#endif
 #ifdef WIN32
         Sleep (200);
 #else
         usleep(200000);
 #endif
       } // while( !((Client*)ka->rob)->IsConnected().Connected)
-      cout << endl;
     } // 
 
     // Enable some different data types
@@ -248,12 +255,14 @@ namespace Sensor
     ((Client*)ka_.rob)->EnableUnlabeledMarkerData();
     ((Client*)ka_.rob)->EnableDeviceData();
 
-#ifdef VICON_NOISY
-    cout << "Segment Data Enabled: "          << Adapt( ((Client*)ka_.rob)->IsSegmentDataEnabled().Enabled )         << endl;
-    cout << "Marker Data Enabled: "           << Adapt( ((Client*)ka_.rob)->IsMarkerDataEnabled().Enabled )          << endl;
-    cout << "Unlabeled Marker Data Enabled: " << Adapt( ((Client*)ka_.rob)->IsUnlabeledMarkerDataEnabled().Enabled ) << endl;
-    cout << "Device Data Enabled: "           << Adapt( ((Client*)ka_.rob)->IsDeviceDataEnabled().Enabled )          << endl;
-#endif
+    CRPI_LOG(crpi_robot::CRPI_LOG_DEBUG, "Segment Data Enabled: %s",
+             Adapt( ((Client*)ka_.rob)->IsSegmentDataEnabled().Enabled ).c_str());
+    CRPI_LOG(crpi_robot::CRPI_LOG_DEBUG, "Marker Data Enabled: %s",
+             Adapt( ((Client*)ka_.rob)->IsMarkerDataEnabled().Enabled ).c_str());
+    CRPI_LOG(crpi_robot::CRPI_LOG_DEBUG, "Unlabeled Marker Data Enabled: %s",
+             Adapt( ((Client*)ka_.rob)->IsUnlabeledMarkerDataEnabled().Enabled ).c_str());
+    CRPI_LOG(crpi_robot::CRPI_LOG_DEBUG, "Device Data Enabled: %s",
+             Adapt( ((Client*)ka_.rob)->IsDeviceDataEnabled().Enabled ).c_str());
     // Set the streaming mode
     //((Client*)ka_.rob)->SetStreamMode( ViconDataStreamSDK::CPP::StreamMode::ClientPull );
     //((Client*)ka_.rob)->SetStreamMode( ViconDataStreamSDK::CPP::StreamMode::ClientPullPreFetch );
@@ -265,192 +274,172 @@ namespace Sensor
                                         Direction::Up ); // Z-up
 
     Output_GetAxisMapping _Output_GetAxisMapping = ((Client*)ka_.rob)->GetAxisMapping();
-#ifdef VICON_NOISY
-    cout << "Axis Mapping: X-" << Adapt( _Output_GetAxisMapping.XAxis ) 
-                           << " Y-" << Adapt( _Output_GetAxisMapping.YAxis ) 
-                           << " Z-" << Adapt( _Output_GetAxisMapping.ZAxis ) << endl;
-#endif
+    CRPI_LOG(crpi_robot::CRPI_LOG_DEBUG, "Axis Mapping: X-%s Y-%s Z-%s", Adapt( _Output_GetAxisMapping.XAxis ).c_str(),
+             Adapt( _Output_GetAxisMapping.YAxis ).c_str(), Adapt( _Output_GetAxisMapping.ZAxis ).c_str());
 
-    ulapi_task_start((ulapi_task_struct*)task_, livemanVicon, &ka_, ulapi_prio_lowest(), 0);
+    SetMetricLabels("vicon", ipAddress);
+    task_ = crpi_robot::SensorHub::Instance().StartLoop(acquireFrames, this, crpi_robot::HUB_SENSOR);
   }
 
 
   LIBRARY_API Vicon::~Vicon ()
   {
+    //! The acquisition thread exits after the frame it is waiting on
+    ka_.runThread = false;
+    crpi_robot::SensorHub::Instance().JoinLoop(task_);
+
     ((Client*)ka_.rob)->DisableSegmentData();
     ((Client*)ka_.rob)->DisableMarkerData();
     ((Client*)ka_.rob)->DisableUnlabeledMarkerData();
     ((Client*)ka_.rob)->DisableDeviceData();
 
-#ifdef VICON_NOISY
-    cout << " Disconnecting..." << endl;
-#endif
+    CRPI_LOG(crpi_robot::CRPI_LOG_DEBUG, "Disconnecting...");
     ((Client*)ka_.rob)->Disconnect();
   }
 
 
-  LIBRARY_API void Vicon::GetCurrentSubjects(vector<MoCapSubject> &subjects)
+  void Vicon::readFrame (MoCapFrame &frame)
   {
-    subjects.clear();
-    ulapi_mutex_take(ka_.handle);
-    matrix rotation(3, 3);
+    Client *client = (Client*)ka_.rob;
+    MoCapFrameSubject *subject;
+    int i;
 
     //! Count the number of subjects
-    unsigned int SubjectCount = ((Client*)ka_.rob)->GetSubjectCount().SubjectCount;
-#ifdef VICON_NOISY
-    cout << "Subjects (" << SubjectCount << "):" << endl;
-#endif
+    unsigned int SubjectCount = client->GetSubjectCount().SubjectCount;
+    CRPI_LOG(crpi_robot::CRPI_LOG_DEBUG, "Subjects (%u):", SubjectCount);
 
     for( unsigned int SubjectIndex = 0 ; SubjectIndex < SubjectCount ; ++SubjectIndex )
     {
-#ifdef VICON_NOISY
-      cout << "  Subject #" << SubjectIndex << endl;
-#endif
-
       //! Get the subject name
-      temp.name = ((Client*)ka_.rob)->GetSubjectName( SubjectIndex ).SubjectName;
-#ifdef VICON_NOISY
-      cout << "    Name: " << temp.name << endl;
-#endif
+      std::string SubjectName = client->GetSubjectName( SubjectIndex ).SubjectName;
+      subject = frame.addSubject(InternSubject(SubjectName.c_str()));
+      if (subject == NULL)
+      {
+        break;
+      }
+      CRPI_LOG(crpi_robot::CRPI_LOG_DEBUG, "  Subject #%u:  %s", SubjectIndex, SubjectName.c_str());
 
-      //! Count the number of segments
-      unsigned int SegmentCount = ((Client*)ka_.rob)->GetSegmentCount( temp.name ).SegmentCount;
+      //! Count the number of segments.  The subject takes the pose of its last segment.
+      unsigned int SegmentCount = client->GetSegmentCount( SubjectName ).SegmentCount;
       for( unsigned int SegmentIndex = 0 ; SegmentIndex < SegmentCount ; ++SegmentIndex )
       {
         //! Get the segment name
-        std::string SegmentName = ((Client*)ka_.rob)->GetSegmentName( temp.name, SegmentIndex ).SegmentName;
-
-        //! Get the segment's children
-        unsigned int ChildCount = ((Client*)ka_.rob)->GetSegmentChildCount( temp.name, SegmentName ).SegmentCount;
-        for( unsigned int ChildIndex = 0 ; ChildIndex < ChildCount ; ++ChildIndex )
-        {
-          std::string ChildName = ((Client*)ka_.rob)->GetSegmentChildName( temp.name, SegmentName, ChildIndex ).SegmentName;
-        }
+        std::string SegmentName = client->GetSegmentName( SubjectName, SegmentIndex ).SegmentName;
 
         //! Get the global segment translation
         Output_GetSegmentGlobalTranslation _Output_GetSegmentGlobalTranslation = 
-          ((Client*)ka_.rob)->GetSegmentGlobalTranslation( temp.name, SegmentName );
-#ifdef VICON_NOISY
-        cout << "        Global Translation: (" << _Output_GetSegmentGlobalTranslation.Translation[ 0 ]  << ", " 
-              << _Output_GetSegmentGlobalTranslation.Translation[ 1 ]  << ", " 
-              << _Output_GetSegmentGlobalTranslation.Translation[ 2 ]  << ") " 
-              << Adapt( _Output_GetSegmentGlobalTranslation.Occluded ) << endl;
-#endif
-        temp.pose.x = _Output_GetSegmentGlobalTranslation.Translation[ 0 ];
-        temp.pose.y = _Output_GetSegmentGlobalTranslation.Translation[ 1 ];
-        temp.pose.z = _Output_GetSegmentGlobalTranslation.Translation[ 2 ];
+          client->GetSegmentGlobalTranslation( SubjectName, SegmentName );
+        CRPI_LOG(crpi_robot::CRPI_LOG_DEBUG, "        Global Translation: (%f, %f, %f) %s",
+                 _Output_GetSegmentGlobalTranslation.Translation[ 0 ],
+                 _Output_GetSegmentGlobalTranslation.Translation[ 1 ],
+                 _Output_GetSegmentGlobalTranslation.Translation[ 2 ],
+                 Adapt( _Output_GetSegmentGlobalTranslation.Occluded ).c_str());
+        subject->pose.x = _Output_GetSegmentGlobalTranslation.Translation[ 0 ];
+        subject->pose.y = _Output_GetSegmentGlobalTranslation.Translation[ 1 ];
+        subject->pose.z = _Output_GetSegmentGlobalTranslation.Translation[ 2 ];
 
         //! Get the global segment rotation as a matrix
         Output_GetSegmentGlobalRotationMatrix _Output_GetSegmentGlobalRotationMatrix = 
-          ((Client*)ka_.rob)->GetSegmentGlobalRotationMatrix( temp.name, SegmentName );
-#ifdef VICON_NOISY
-        cout << "        Global Rotation Matrix: (" << _Output_GetSegmentGlobalRotationMatrix.Rotation[ 0 ]     << ", " 
-              << _Output_GetSegmentGlobalRotationMatrix.Rotation[ 1 ]     << ", " 
-              << _Output_GetSegmentGlobalRotationMatrix.Rotation[ 2 ]     << ", " 
-              << _Output_GetSegmentGlobalRotationMatrix.Rotation[ 3 ]     << ", " 
-              << _Output_GetSegmentGlobalRotationMatrix.Rotation[ 4 ]     << ", " 
-              << _Output_GetSegmentGlobalRotationMatrix.Rotation[ 5 ]     << ", " 
-              << _Output_GetSegmentGlobalRotationMatrix.Rotation[ 6 ]     << ", " 
-              << _Output_GetSegmentGlobalRotationMatrix.Rotation[ 7 ]     << ", " 
-              << _Output_GetSegmentGlobalRotationMatrix.Rotation[ 8 ]     << ") " 
-              << Adapt( _Output_GetSegmentGlobalRotationMatrix.Occluded ) << endl;
-#endif
-        rotation.at(0, 0) = _Output_GetSegmentGlobalRotationMatrix.Rotation[ 0 ];
-        rotation.at(0, 1) = _Output_GetSegmentGlobalRotationMatrix.Rotation[ 1 ];
-        rotation.at(0, 2) = _Output_GetSegmentGlobalRotationMatrix.Rotation[ 2 ];
-        rotation.at(1, 0) = _Output_GetSegmentGlobalRotationMatrix.Rotation[ 3 ];
-        rotation.at(1, 1) = _Output_GetSegmentGlobalRotationMatrix.Rotation[ 4 ];
-        rotation.at(1, 2) = _Output_GetSegmentGlobalRotationMatrix.Rotation[ 5 ];
-        rotation.at(2, 0) = _Output_GetSegmentGlobalRotationMatrix.Rotation[ 6 ];
-        rotation.at(2, 1) = _Output_GetSegmentGlobalRotationMatrix.Rotation[ 7 ];
-        rotation.at(2, 2) = _Output_GetSegmentGlobalRotationMatrix.Rotation[ 8 ];
-
-        //! Get the global segment rotation in EulerXYZ co-ordinates
-        Output_GetSegmentGlobalRotationEulerXYZ _Output_GetSegmentGlobalRotationEulerXYZ = 
-          ((Client*)ka_.rob)->GetSegmentGlobalRotationEulerXYZ( temp.name, SegmentName );
-#ifdef VICON_NOISY
-        cout << "        Global Rotation EulerXYZ: (" << _Output_GetSegmentGlobalRotationEulerXYZ.Rotation[ 0 ]     << ", " 
-              << _Output_GetSegmentGlobalRotationEulerXYZ.Rotation[ 1 ]     << ", " 
-              << _Output_GetSegmentGlobalRotationEulerXYZ.Rotation[ 2 ]     << ") " 
-              << Adapt( _Output_GetSegmentGlobalRotationEulerXYZ.Occluded ) << endl;
-#endif
-        vector<double> vecout;
-        rotation.rotMatrixEulerConvert (vecout);
-
-        temp.pose.xr = vecout.at(0) * (180.0 / 3.141592654);
-        temp.pose.yr = vecout.at(1) * (180.0 / 3.141592654);
-        temp.pose.zr = vecout.at(2) * (180.0 / 3.141592654);
+          client->GetSegmentGlobalRotationMatrix( SubjectName, SegmentName );
+        for (i = 0; i < 9; ++i)
+        {
+          subject->rotation[i] = _Output_GetSegmentGlobalRotationMatrix.Rotation[ i ];
+        }
+        subject->updateEuler(true);
       } // for( unsigned int SegmentIndex = 0 ; SegmentIndex < SegmentCount ; ++SegmentIndex )
 
-      temp.labeledMarkers.clear();
-
       //! Count the number of markers
-      unsigned int MarkerCount = ((Client*)ka_.rob)->GetMarkerCount( temp.name ).MarkerCount;
-#ifdef VICON_NOISY
-      cout << "    Markers (" << MarkerCount << "):" << endl;
-#endif
+      unsigned int MarkerCount = client->GetMarkerCount( SubjectName ).MarkerCount;
+      CRPI_LOG(crpi_robot::CRPI_LOG_DEBUG, "    Markers (%u):", MarkerCount);
 
       for( unsigned int MarkerIndex = 0 ; MarkerIndex < MarkerCount ; ++MarkerIndex )
       {
         //! Get the marker name
-        std::string MarkerName = ((Client*)ka_.rob)->GetMarkerName( temp.name, MarkerIndex ).MarkerName;
+        std::string MarkerName = client->GetMarkerName( SubjectName, MarkerIndex ).MarkerName;
 
         //! Get the global marker translation
         Output_GetMarkerGlobalTranslation _Output_GetMarkerGlobalTranslation =
-          ((Client*)ka_.rob)->GetMarkerGlobalTranslation( temp.name, MarkerName );
-#ifdef VICON_NOISY
-        cout << "      Marker #" << MarkerIndex            << ": "
-              << MarkerName             << " ("
-              << _Output_GetMarkerGlobalTranslation.Translation[ 0 ]  << ", "
-              << _Output_GetMarkerGlobalTranslation.Translation[ 1 ]  << ", "
-              << _Output_GetMarkerGlobalTranslation.Translation[ 2 ]  << ") "
-              << Adapt( _Output_GetMarkerGlobalTranslation.Occluded ) << endl;
-#endif
-        ptemp.x = _Output_GetMarkerGlobalTranslation.Translation[ 0 ];
-        ptemp.y = _Output_GetMarkerGlobalTranslation.Translation[ 1 ];
-        ptemp.z = _Output_GetMarkerGlobalTranslation.Translation[ 2 ];
-        temp.labeledMarkers.push_back(ptemp);
+          client->GetMarkerGlobalTranslation( SubjectName, MarkerName );
+        CRPI_LOG(crpi_robot::CRPI_LOG_DEBUG, "      Marker #%u: %s (%f, %f, %f) %s", MarkerIndex, MarkerName.c_str(),
+                 _Output_GetMarkerGlobalTranslation.Translation[ 0 ],
+                 _Output_GetMarkerGlobalTranslation.Translation[ 1 ],
+                 _Output_GetMarkerGlobalTranslation.Translation[ 2 ],
+                 Adapt( _Output_GetMarkerGlobalTranslation.Occluded ).c_str());
+        if (frame.addMarker(_Output_GetMarkerGlobalTranslation.Translation[ 0 ],
+                            _Output_GetMarkerGlobalTranslation.Translation[ 1 ],
+                            _Output_GetMarkerGlobalTranslation.Translation[ 2 ]))
+        {
+          ++subject->markerCount;
+        }
       } // for( unsigned int MarkerIndex = 0 ; MarkerIndex < MarkerCount ; ++MarkerIndex )
-      temp.valid = true;
-
-      subjects.push_back(temp);
     } // for( unsigned int SubjectIndex = 0 ; SubjectIndex < SubjectCount ; ++SubjectIndex )
 
-    ulapi_mutex_give(ka_.handle);
-  }
-
-
-  LIBRARY_API void Vicon::GetUnlabeledMarkers(vector<point> &markers)
-  {
-    markers.clear();
-
-    ulapi_mutex_take(ka_.handle);
-
-      //! Get the unlabeled markers
-    unsigned int UnlabeledMarkerCount = ((Client*)ka_.rob)->GetUnlabeledMarkerCount().MarkerCount;
-#ifdef VICON_NOISY
-    cout << "    Unlabeled Markers (" << UnlabeledMarkerCount << "):" << endl;
-#endif
+    //! Get the unlabeled markers
+    unsigned int UnlabeledMarkerCount = client->GetUnlabeledMarkerCount().MarkerCount;
+    CRPI_LOG(crpi_robot::CRPI_LOG_DEBUG, "    Unlabeled Markers (%u):", UnlabeledMarkerCount);
+    frame.firstUnlabeled = frame.markerCount;
     for( unsigned int UnlabeledMarkerIndex = 0 ; UnlabeledMarkerIndex < UnlabeledMarkerCount ; ++UnlabeledMarkerIndex )
     { 
       // Get the global marker translation
       Output_GetUnlabeledMarkerGlobalTranslation _Output_GetUnlabeledMarkerGlobalTranslation =
-        ((Client*)ka_.rob)->GetUnlabeledMarkerGlobalTranslation( UnlabeledMarkerIndex );
-#ifdef VICON_NOISY
-      cout << "      Marker #" << UnlabeledMarkerIndex   << ": ("
-            << _Output_GetUnlabeledMarkerGlobalTranslation.Translation[ 0 ] << ", "
-            << _Output_GetUnlabeledMarkerGlobalTranslation.Translation[ 1 ] << ", "
-            << _Output_GetUnlabeledMarkerGlobalTranslation.Translation[ 2 ] << ")" << endl;
-#endif
-      ptemp.x = _Output_GetUnlabeledMarkerGlobalTranslation.Translation[ 0 ];
-      ptemp.y = _Output_GetUnlabeledMarkerGlobalTranslation.Translation[ 0 ];
-      ptemp.z = _Output_GetUnlabeledMarkerGlobalTranslation.Translation[ 0 ];
-      markers.push_back(ptemp);
+        client->GetUnlabeledMarkerGlobalTranslation( UnlabeledMarkerIndex );
+      if (!frame.addMarker(_Output_GetUnlabeledMarkerGlobalTranslation.Translation[ 0 ],
+                           _Output_GetUnlabeledMarkerGlobalTranslation.Translation[ 1 ],
+                           _Output_GetUnlabeledMarkerGlobalTranslation.Translation[ 2 ]))
+      {
+        break;
+      }
     } //for( unsigned int UnlabeledMarkerIndex = 0 ; UnlabeledMarkerIndex < UnlabeledMarkerCount ; ++UnlabeledMarkerIndex )
-    ulapi_mutex_give(ka_.handle);
+    frame.unlabeledCount = frame.markerCount - frame.firstUnlabeled;
   }
 
 
+  LIBRARY_API bool Vicon::GetFrame (MoCapFrame &frame, int age)
+  {
+    MoCapFrameView view;
+
+    if (!view.acquire(*frames_, age))
+    {
+      return false;
+    }
+    frame = *view.get();
+    return true;
+  }
 
 
+  LIBRARY_API void Vicon::GetCurrentSubjects(vector<MoCapSubject> &subjects)
+  {
+    MoCapFrameView view;
+    int i, j;
+
+    subjects.clear();
+    if (view.acquire(*frames_))
+    {
+      for (i = 0; i < view->subjectCount; ++i)
+      {
+        const MoCapFrameSubject &subject = view->subjects[i];
+        temp.name = view.name(i);
+        temp.pose = subject.pose;
+        for (j = 0; j < 9; ++j)
+        {
+          temp.rotation.at(j / 3, j % 3) = subject.rotation[j];
+        }
+        temp.labeledMarkers.assign(view->subjectMarkers(i), view->subjectMarkers(i) + subject.markerCount);
+        temp.valid = true;
+        subjects.push_back(temp);
+      }
+    }
+  }
+
+
+  LIBRARY_API void Vicon::GetUnlabeledMarkers(vector<point> &markers)
+  {
+    MoCapFrameView view;
+
+    markers.clear();
+    if (view.acquire(*frames_))
+    {
+      markers.assign(view->unlabeledMarkers(), view->unlabeledMarkers() + view->unlabeledCount);
+    }
+  }
 }
@@ -30,7 +30,7 @@
 #include <vector>
 #include <string.h>
 
-#include "MoCapTypes.h"
+#include "MoCapStream.h"
 
 using namespace std;
 using namespace Math;
@@ -41,7 +41,7 @@ namespace Sensor
   //!
   //! @brief   Interface class for the Vicon Tracker software system
   //!
-  class LIBRARY_API Vicon
+  class LIBRARY_API Vicon : public MoCapStream
   {
   public:
 
@@ -64,9 +64,30 @@ namespace Sensor
     //! @param markers Vector populated by the function with point objects
     //!
     void GetUnlabeledMarkers(vector<point> &markers);
+
+    //! @brief Copy one of the most recently acquired frames
+    //!
+    //! @param frame Populated by the function with the frame
+    //! @param age   0 for the newest frame, 1 for the one before it, and so on
+    //!
+    //! @return True if the frame was copied, false if it is not available
+    //!
+    bool GetFrame (MoCapFrame &frame, int age = 0);
     
   private:
 
+    //! @brief Acquisition thread:  waits on each frame pushed by the server and publishes it
+    //!
+    //! @param param The Vicon object being served
+    //!
+    static void acquireFrames (void *param);
+
+    //! @brief Copy the client's current frame
+    //!
+    //! @param frame Populated by the function with the subjects and markers of the frame
+    //!
+    void readFrame (MoCapFrame &frame);
+
     //! @brief Handle for a separate thread that maintains contact with the Vicon system
     //!
     void *task_;
@@ -16,8 +16,13 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include <stdio.h>
+#include <chrono>
 #include "serial.h"
 
+#if defined(__GNUC__)
+#include <poll.h>
+#endif
+
 //#define NOISY
 
 namespace Network
@@ -42,7 +47,7 @@ namespace Network
 
 
   //! Note:  this function blocks
-  LIBRARY_API bool serial::getData (char *buffer, serialStruct serialData, int bytes)
+  LIBRARY_API bool serial::getData (char *buffer, serialStruct &serialData, int bytes)
   {
     DWORD dwBytes;
 #if defined(_MSC_VER)
@@ -79,7 +84,7 @@ namespace Network
   }
 
 
-  LIBRARY_API bool serial::sendData (const char * buffer, struct serialStruct serialData)
+  LIBRARY_API bool serial::sendData (const char * buffer, struct serialStruct &serialData)
   {
     DWORD dwBytes;
     int resp;
@@ -202,4 +207,677 @@ namespace Network
 	serialData.connected = false;
   }
 
+
+
+  //! *************************************************************************
+  //!                        NON-BLOCKING SERIAL PORT
+  //! *************************************************************************
+#ifndef WIN32
+  //! termios speed of a baud rate (0 if there is none)
+  static speed_t termiosSpeed (DWORD baud)
+  {
+    switch (baud)
+    {
+    case 110:
+      return B110;
+    case 300:
+      return B300;
+    case 1200:
+      return B1200;
+    case 2400:
+      return B2400;
+    case 4800:
+      return B4800;
+    case 9600:
+      return B9600;
+    case 19200:
+      return B19200;
+    case 38400:
+      return B38400;
+    case 57600:
+      return B57600;
+    case 115200:
+      return B115200;
+#ifdef B230400
+    case 230400:
+      return B230400;
+#endif
+#ifdef B460800
+    case 460800:
+      return B460800;
+#endif
+#ifdef B921600
+    case 921600:
+      return B921600;
+#endif
+    default:
+      return 0;
+    }
+  }
+#endif
+
+
+  LIBRARY_API serialPort::serialPort (int capacity) :
+    head_(0),
+    count_(0),
+    scanned_(0),
+    dropped_(0),
+    framing_(SERIAL_FRAME_RAW),
+    size_(0),
+    delimiter_('\n'),
+    bigEndian_(true),
+    inclusive_(false),
+    handler_(NULL),
+    param_(NULL)
+  {
+    ring_.resize(capacity < 16 ? 16 : capacity);
+#ifdef WIN32
+    handle_ = INVALID_HANDLE_VALUE;
+    memset(&rxOv_, 0, sizeof(rxOv_));
+    memset(&txOv_, 0, sizeof(txOv_));
+    rxPending_ = txPending_ = false;
+#else
+    fd_ = -1;
+#endif
+  }
+
+
+  LIBRARY_API serialPort::~serialPort ()
+  {
+    close();
+  }
+
+
+  LIBRARY_API bool serialPort::open (const serialStruct &settings)
+  {
+    if (isOpen() || settings.COMChannel == NULL)
+    {
+      return false;
+    }
+
+#ifdef WIN32
+    DCB dcb;
+    COMMTIMEOUTS timeouts;
+    std::string name = settings.COMChannel;
+
+    //! Ports above COM9 can only be opened by their device name
+    if (name.compare(0, 4, "\\\\.\\") != 0)
+    {
+      name = std::string("\\\\.\\") + name;
+    }
+    handle_ = CreateFileA(name.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING,
+                          FILE_FLAG_OVERLAPPED, NULL);
+    if (handle_ == INVALID_HANDLE_VALUE)
+    {
+      return false;
+    }
+
+    memset(&dcb, 0, sizeof(dcb));
+    dcb.DCBlength = sizeof(DCB);
+    GetCommState(handle_, &dcb);
+    dcb.BaudRate = settings.BaudRate;
+    dcb.fBinary = TRUE;
+    dcb.ByteSize = 8;
+    dcb.fParity = TRUE;
+    dcb.Parity = (settings.evenParity ? EVENPARITY : ODDPARITY);
+    dcb.StopBits = (settings.stopBits == 2 ? TWOSTOPBITS : ONESTOPBIT);
+
+    //! A read returns as soon as anything has arrived, or after 100 ms with nothing, so the
+    //! servicing thread is never parked in the driver; writes never time out
+    timeouts.ReadIntervalTimeout = MAXDWORD;
+    timeouts.ReadTotalTimeoutMultiplier = MAXDWORD;
+    timeouts.ReadTotalTimeoutConstant = 100;
+    timeouts.WriteTotalTimeoutMultiplier = 0;
+    timeouts.WriteTotalTimeoutConstant = 0;
+
+    rxOv_.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    txOv_.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (!SetCommState(handle_, &dcb) || !SetCommTimeouts(handle_, &timeouts) ||
+        rxOv_.hEvent == NULL || txOv_.hEvent == NULL)
+    {
+      close();
+      return false;
+    }
+    PurgeComm(handle_, PURGE_RXCLEAR | PURGE_TXCLEAR);
+
+    if (!startRead())
+    {
+      close();
+      return false;
+    }
+#else
+    struct termios tio;
+    speed_t speed = termiosSpeed(settings.BaudRate);
+
+    if (speed == 0)
+    {
+      return false;
+    }
+
+    fd_ = ::open(settings.COMChannel, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd_ < 0)
+    {
+      return false;
+    }
+
+    if (tcgetattr(fd_, &tio) != 0)
+    {
+      close();
+      return false;
+    }
+
+    //! Raw bytes, no echo or line editing, and a read that never waits (the poll does that)
+    cfmakeraw(&tio);
+    tio.c_cflag |= (CLOCAL | CREAD | PARENB);
+    if (settings.evenParity)
+    {
+      tio.c_cflag &= ~PARODD;
+    }
+    else
+    {
+      tio.c_cflag |= PARODD;
+    }
+    if (settings.stopBits == 2)
+    {
+      tio.c_cflag |= CSTOPB;
+    }
+    else
+    {
+      tio.c_cflag &= ~CSTOPB;
+    }
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+
+    if (tcsetattr(fd_, TCSANOW, &tio) != 0)
+    {
+      close();
+      return false;
+    }
+    tcflush(fd_, TCIOFLUSH);
+#endif
+
+    head_ = count_ = scanned_ = 0;
+    message_.clear();
+    inbox_.clear();
+    return true;
+  }
+
+
+  LIBRARY_API void serialPort::close ()
+  {
+    std::lock_guard<std::mutex> lock(txLock_);
+    DWORD bytes;
+
+#ifdef WIN32
+    if (handle_ != INVALID_HANDLE_VALUE)
+    {
+      //! The buffers of a cancelled request may be written until it completes
+      CancelIo(handle_);
+      if (rxPending_)
+      {
+        GetOverlappedResult(handle_, &rxOv_, &bytes, TRUE);
+      }
+      if (txPending_)
+      {
+        GetOverlappedResult(handle_, &txOv_, &bytes, TRUE);
+      }
+      CloseHandle(handle_);
+      handle_ = INVALID_HANDLE_VALUE;
+    }
+    if (rxOv_.hEvent != NULL)
+    {
+      CloseHandle(rxOv_.hEvent);
+    }
+    if (txOv_.hEvent != NULL)
+    {
+      CloseHandle(txOv_.hEvent);
+    }
+    memset(&rxOv_, 0, sizeof(rxOv_));
+    memset(&txOv_, 0, sizeof(txOv_));
+    rxPending_ = txPending_ = false;
+    txFlight_.clear();
+#else
+    (void)bytes;
+    if (fd_ >= 0)
+    {
+      ::close(fd_);
+      fd_ = -1;
+    }
+#endif
+    txQueue_.clear();
+  }
+
+
+  LIBRARY_API bool serialPort::isOpen () const
+  {
+#ifdef WIN32
+    return handle_ != INVALID_HANDLE_VALUE;
+#else
+    return fd_ >= 0;
+#endif
+  }
+
+
+  LIBRARY_API bool serialPort::setFraming (serialFraming framing, int size, char delimiter,
+                                           bool bigEndian, bool inclusive)
+  {
+    switch (framing)
+    {
+    case SERIAL_FRAME_RAW:
+    case SERIAL_FRAME_DELIMITED:
+      break;
+    case SERIAL_FRAME_FIXED:
+      if (size < 1 || size > (int)ring_.size())
+      {
+        return false;
+      }
+      break;
+    case SERIAL_FRAME_PREFIXED:
+      if (size != 1 && size != 2 && size != 4)
+      {
+        return false;
+      }
+      break;
+    default:
+      return false;
+    }
+
+    framing_ = framing;
+    size_ = size;
+    delimiter_ = delimiter;
+    bigEndian_ = bigEndian;
+    inclusive_ = inclusive;
+    scanned_ = 0;
+    return true;
+  }
+
+
+  LIBRARY_API void serialPort::setHandler (serialHandler handler, void *param)
+  {
+    handler_ = handler;
+    param_ = param;
+  }
+
+
+  LIBRARY_API bool serialPort::send (const char *data, int bytes)
+  {
+    std::lock_guard<std::mutex> lock(txLock_);
+
+    if (!isOpen() || bytes < 0)
+    {
+      return false;
+    }
+    txQueue_.append(data, bytes);
+    return drain();
+  }
+
+
+  LIBRARY_API int serialPort::service (double timeout)
+  {
+    int done;
+
+    if (!isOpen() || !pump())
+    {
+      return -1;
+    }
+    done = frame();
+    if (done > 0 || timeout <= 0.0)
+    {
+      return done;
+    }
+
+#ifdef WIN32
+    HANDLE events[2];
+    DWORD n = 0;
+
+    events[n++] = rxOv_.hEvent;
+    {
+      std::lock_guard<std::mutex> lock(txLock_);
+      if (txPending_)
+      {
+        events[n++] = txOv_.hEvent;
+      }
+    }
+    if (WaitForMultipleObjects(n, events, FALSE, (DWORD)(timeout * 1000.0)) == WAIT_FAILED)
+    {
+      return -1;
+    }
+#else
+    struct pollfd pfd;
+
+    pfd.fd = fd_;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (queued() > 0)
+    {
+      pfd.events |= POLLOUT;
+    }
+    if (poll(&pfd, 1, (int)(timeout * 1000.0)) < 0)
+    {
+      if (errno != EINTR)
+      {
+        return -1;
+      }
+    }
+    else if ((pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) != 0)
+    {
+      return -1;
+    }
+#endif
+
+    if (!pump())
+    {
+      return -1;
+    }
+    return done + frame();
+  }
+
+
+  LIBRARY_API bool serialPort::receive (char *buffer, int size, int &length, double timeout)
+  {
+    std::chrono::steady_clock::time_point until = std::chrono::steady_clock::now() +
+      std::chrono::microseconds((long long)(timeout * 1.0e6));
+    double left;
+
+    length = 0;
+    while (inbox_.empty())
+    {
+      left = std::chrono::duration<double>(until - std::chrono::steady_clock::now()).count();
+      if (service(left > 0.0 ? left : 0.0) < 0)
+      {
+        return false;
+      }
+      if (inbox_.empty() && left <= 0.0)
+      {
+        return false;
+      }
+    }
+
+    length = (int)inbox_.front().size();
+    if (length > size)
+    {
+      length = size;
+    }
+    if (length > 0)
+    {
+      memcpy(buffer, inbox_.front().data(), length);
+    }
+    inbox_.pop_front();
+    return true;
+  }
+
+
+  LIBRARY_API int serialPort::pollId () const
+  {
+#ifdef WIN32
+    return -1;
+#else
+    return fd_;
+#endif
+  }
+
+
+  LIBRARY_API int serialPort::queued () const
+  {
+    std::lock_guard<std::mutex> lock(txLock_);
+#ifdef WIN32
+    return (int)(txQueue_.size() + txFlight_.size());
+#else
+    return (int)txQueue_.size();
+#endif
+  }
+
+
+  LIBRARY_API unsigned long serialPort::dropped () const
+  {
+    return dropped_;
+  }
+
+
+  void serialPort::store (const char *data, int bytes)
+  {
+    int cap = (int)ring_.size(), tail, span;
+
+    if (bytes > cap - count_)
+    {
+      dropped_ += bytes - (cap - count_);
+      bytes = cap - count_;
+    }
+    while (bytes > 0)
+    {
+      tail = (head_ + count_) % cap;
+      span = (tail + bytes > cap) ? cap - tail : bytes;
+      memcpy(&ring_[tail], data, span);
+      count_ += span;
+      data += span;
+      bytes -= span;
+    }
+  }
+
+
+  char serialPort::at (int k) const
+  {
+    return ring_[(head_ + k) % ring_.size()];
+  }
+
+
+  void serialPort::take (int bytes)
+  {
+    int cap = (int)ring_.size(), span = (head_ + bytes > cap) ? cap - head_ : bytes;
+
+    message_.assign(&ring_[head_], span);
+    if (span < bytes)
+    {
+      message_.append(&ring_[0], bytes - span);
+    }
+    head_ = (head_ + bytes) % cap;
+    count_ -= bytes;
+    scanned_ = 0;
+
+    if (handler_ != NULL)
+    {
+      handler_(message_.data(), (int)message_.size(), param_);
+    }
+    else
+    {
+      inbox_.push_back(message_);
+    }
+  }
+
+
+  int serialPort::frame ()
+  {
+    int done = 0, i, length;
+
+    while (count_ > 0)
+    {
+      switch (framing_)
+      {
+      case SERIAL_FRAME_RAW:
+        take(count_);
+        ++done;
+        break;
+
+      case SERIAL_FRAME_DELIMITED:
+        for (i = scanned_; i < count_ && at(i) != delimiter_; ++i);
+        if (i < count_)
+        {
+          take(i + 1);
+          ++done;
+          break;
+        }
+        scanned_ = count_;
+        if (count_ == (int)ring_.size())
+        {
+          //! A message longer than the ring can never complete
+          dropped_ += count_;
+          head_ = count_ = scanned_ = 0;
+        }
+        return done;
+
+      case SERIAL_FRAME_FIXED:
+        if (count_ < size_)
+        {
+          return done;
+        }
+        take(size_);
+        ++done;
+        break;
+
+      case SERIAL_FRAME_PREFIXED:
+        if (count_ < size_)
+        {
+          return done;
+        }
+        for (i = 0, length = 0; i < size_; ++i)
+        {
+          length |= (int)(unsigned char)at(bigEndian_ ? i : (size_ - 1 - i)) << (8 * (size_ - 1 - i));
+        }
+        if (!inclusive_)
+        {
+          length += size_;
+        }
+        if (length < size_ || length > (int)ring_.size())
+        {
+          //! A corrupt or oversized prefix; start over with whatever arrives next
+          dropped_ += count_;
+          head_ = count_ = scanned_ = 0;
+          return done;
+        }
+        if (count_ < length)
+        {
+          return done;
+        }
+        take(length);
+        ++done;
+        break;
+
+      default:
+        return done;
+      }
+    }
+    return done;
+  }
+
+
+  bool serialPort::pump ()
+  {
+#ifdef WIN32
+    DWORD got;
+
+    while (true)
+    {
+      if (!rxPending_ && !startRead())
+      {
+        return false;
+      }
+      if (!GetOverlappedResult(handle_, &rxOv_, &got, FALSE))
+      {
+        if (GetLastError() != ERROR_IO_INCOMPLETE)
+        {
+          return false;
+        }
+        break;
+      }
+      rxPending_ = false;
+      store(rxChunk_, (int)got);
+      if (got == 0)
+      {
+        //! The read timed out empty; leave the next one waiting
+        if (!startRead())
+        {
+          return false;
+        }
+        break;
+      }
+    }
+#else
+    char chunk[1024];
+    ssize_t got;
+
+    while ((got = ::read(fd_, chunk, sizeof(chunk))) > 0)
+    {
+      store(chunk, (int)got);
+    }
+    if (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+    {
+      return false;
+    }
+#endif
+
+    std::lock_guard<std::mutex> lock(txLock_);
+    return drain();
+  }
+
+
+  bool serialPort::drain ()
+  {
+#ifdef WIN32
+    DWORD put;
+
+    if (txPending_)
+    {
+      if (!GetOverlappedResult(handle_, &txOv_, &put, FALSE))
+      {
+        return GetLastError() == ERROR_IO_INCOMPLETE;
+      }
+      txPending_ = false;
+      txFlight_.erase(0, put);
+    }
+    if (txFlight_.empty())
+    {
+      txFlight_.swap(txQueue_);
+    }
+    return txFlight_.empty() || startWrite();
+#else
+    ssize_t put;
+
+    while (!txQueue_.empty())
+    {
+      put = ::write(fd_, txQueue_.data(), txQueue_.size());
+      if (put > 0)
+      {
+        txQueue_.erase(0, put);
+      }
+      else if (put < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      {
+        break;
+      }
+      else if (put < 0 && errno != EINTR)
+      {
+        return false;
+      }
+    }
+    return true;
+#endif
+  }
+
+
+#ifdef WIN32
+  bool serialPort::startRead ()
+  {
+    if (!ReadFile(handle_, rxChunk_, sizeof(rxChunk_), NULL, &rxOv_) &&
+        GetLastError() != ERROR_IO_PENDING)
+    {
+      return false;
+    }
+    //! Completed or not, the result is collected by GetOverlappedResult
+    rxPending_ = true;
+    return true;
+  }
+
+
+  bool serialPort::startWrite ()
+  {
+    if (!WriteFile(handle_, txFlight_.data(), (DWORD)txFlight_.size(), NULL, &txOv_) &&
+        GetLastError() != ERROR_IO_PENDING)
+    {
+      return false;
+    }
+    txPending_ = true;
+    return true;
+  }
+#endif
 }
\ No newline at end of file
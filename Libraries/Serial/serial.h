@@ -26,6 +26,11 @@
 #include "gccserial.h"
 #endif
 
+#include <vector>
+#include <deque>
+#include <string>
+#include <mutex>
+
 
 #define SERVER_MAX_CONNECTIONS 8      //! max clients connected at a time 
 #define REQUEST_MSG_SIZE       8192   //! max size of request message
@@ -76,8 +81,11 @@ namespace Network
     //!
     serialStruct() :
       defined(false),
-      connected(false),
-      COMChannel(NULL)
+      COMChannel(NULL),
+      BaudRate(9600),
+      evenParity(false),
+      stopBits(1),
+      connected(false)
     {}
 
     //! @brief Set the COM channel for the serial connection
@@ -157,6 +165,9 @@ namespace Network
       default:
         return false;
       }
+      #else
+      //! The termios speed is chosen when the port is opened
+      BaudRate = baud;
       #endif
 
       return true;
@@ -239,7 +250,7 @@ namespace Network
     //!
     //! @return True if data was read successfully, False otherwise
     //!
-    bool getData (char* buffer, serialStruct conn, int bytes = -1);
+    bool getData (char* buffer, serialStruct &conn, int bytes = -1);
 
     //! @brief Read raw bytes from an open serial connection (Not currently implemented)
     //!
@@ -265,7 +276,7 @@ namespace Network
     //!
     //! @return True if data was sent successfully, False otherwise
     //!
-    bool sendData (const char* buffer, serialStruct conn);
+    bool sendData (const char* buffer, serialStruct &conn);
 
     //! @brief Write raw bytes to an open serial connection (Not currently implemented)
     //!
@@ -285,6 +296,235 @@ namespace Network
   private:
 
   };
+
+
+  //! @brief How a serialPort divides the bytes it receives into messages
+  //!
+  typedef enum
+  {
+    SERIAL_FRAME_RAW = 0,   //! Whatever has arrived, as soon as anything has
+    SERIAL_FRAME_DELIMITED, //! Up to and including a delimiter byte
+    SERIAL_FRAME_FIXED,     //! A fixed number of bytes
+    SERIAL_FRAME_PREFIXED   //! A 1, 2, or 4 byte length, followed by that many bytes
+  } serialFraming;
+
+  //! @brief Called with each message a serialPort receives
+  //!
+  //! @param message The message (including its delimiter or length prefix, if any)
+  //! @param length  Number of bytes in the message
+  //! @param param   Passed to serialPort::setHandler
+  //!
+  typedef void (*serialHandler)(const char *message, int length, void *param);
+
+
+  //! @ingroup Network
+  //!
+  //! @brief Non-blocking serial port.  Received bytes collect in a ring buffer and are split
+  //!        into messages by the configured framing; writes are queued and drained as the port
+  //!        accepts them, so neither direction holds up the caller.  Windows ports use
+  //!        overlapped I/O and Linux ports a non-blocking, raw-mode descriptor.
+  //!
+  //!        A port is driven by calling service(), either from a thread of its own or, on
+  //!        Linux, from a thread that waits on many ports and sockets at once by adding
+  //!        pollId() to a ulapi poller and servicing the port (with a timeout of 0) when it is
+  //!        ready.  Messages go to the handler, if one is set, and otherwise wait for receive().
+  //!
+  //! @note send() may be called from any thread; the rest of the interface belongs to the thread
+  //!       that services the port.
+  //!
+  class LIBRARY_API serialPort
+  {
+  public:
+    //! @brief Default constructor
+    //!
+    //! @param capacity Size of the receive ring (bytes).  Bytes that arrive while the ring is
+    //!                 full are dropped.
+    //!
+    serialPort (int capacity = REQUEST_MSG_SIZE);
+
+    //! @brief Default destructor (closes the port)
+    //!
+    ~serialPort ();
+
+    //! @brief Open and configure a port (8 data bits, with the parity, stop bits, and baud
+    //!        rate of the settings)
+    //!
+    //! @param settings Connection parameters; COMChannel must be defined (e.g., "COM3" or
+    //!                 "/dev/ttyUSB0")
+    //!
+    //! @return True if the port was opened, false otherwise
+    //!
+    bool open (const serialStruct &settings);
+
+    //! @brief Close the port, discarding anything not yet sent or received
+    //!
+    void close ();
+
+    //! @brief Whether the port is open
+    //!
+    bool isOpen () const;
+
+    //! @brief Set how received bytes are divided into messages (RAW by default)
+    //!
+    //! @param framing   The framing mode
+    //! @param size      Message length for SERIAL_FRAME_FIXED, or the size of the length prefix
+    //!                  (1, 2, or 4 bytes) for SERIAL_FRAME_PREFIXED
+    //! @param delimiter Final byte of a message for SERIAL_FRAME_DELIMITED
+    //! @param bigEndian Byte order of the length prefix
+    //! @param inclusive Whether the length prefix counts its own bytes
+    //!
+    //! @return True if the settings are valid, false otherwise
+    //!
+    bool setFraming (serialFraming framing, int size = 0, char delimiter = '\n',
+                     bool bigEndian = true, bool inclusive = false);
+
+    //! @brief Deliver messages to a callback (run by the servicing thread) instead of holding
+    //!        them for receive()
+    //!
+    //! @param handler The callback (NULL to hold messages again)
+    //! @param param   Passed to the callback
+    //!
+    void setHandler (serialHandler handler, void *param);
+
+    //! @brief Queue bytes to be written.  Whatever the port accepts immediately is written
+    //!        before returning; the rest goes out as the port is serviced.
+    //!
+    //! @param data  The bytes to write
+    //! @param bytes Number of bytes to write
+    //!
+    //! @return True if the bytes were queued, false if the port is not open or failed
+    //!
+    bool send (const char *data, int bytes);
+
+    //! @brief Move bytes between the port and the buffers, and deliver any complete messages
+    //!
+    //! @param timeout Longest time (s) to wait for the port if nothing is ready (0 to only
+    //!                take what is already there)
+    //!
+    //! @return Number of messages completed, or -1 if the port is not open or failed
+    //!
+    int service (double timeout);
+
+    //! @brief Wait for the next message (when no handler is set)
+    //!
+    //! @param buffer  Populated with the message
+    //! @param size    Capacity of the buffer (longer messages are truncated)
+    //! @param length  Populated with the number of bytes placed in the buffer
+    //! @param timeout Longest time (s) to wait
+    //!
+    //! @return True if a message was received, false on a timeout or error
+    //!
+    bool receive (char *buffer, int size, int &length, double timeout);
+
+    //! @brief The descriptor to add to a ulapi poller (for ulapi_poller_add with
+    //!        ULAPI_POLL_READ, and ULAPI_POLL_WRITE while writes are queued)
+    //!
+    //! @return The descriptor on Linux, or -1 where the port cannot be polled with sockets
+    //!         (Windows COM handles), in which case the port needs a thread for service()
+    //!
+    int pollId () const;
+
+    //! @brief Number of bytes waiting to be written
+    //!
+    int queued () const;
+
+    //! @brief Number of bytes dropped because the receive ring was full, or because a
+    //!        message did not fit in it
+    //!
+    unsigned long dropped () const;
+
+  private:
+    //! @brief Copy bytes into the receive ring
+    //!
+    void store (const char *data, int bytes);
+
+    //! @brief The byte k places after the oldest in the receive ring
+    //!
+    char at (int k) const;
+
+    //! @brief Remove the first bytes of the ring as a message
+    //!
+    void take (int bytes);
+
+    //! @brief Split the ring into messages
+    //!
+    //! @return Number of messages completed
+    //!
+    int frame ();
+
+    //! @brief Read whatever the port has, and write whatever it will take
+    //!
+    //! @return False if the port failed
+    //!
+    bool pump ();
+
+    //! @brief Write what the port will take of the queue (txLock_ held)
+    //!
+    //! @return False if the port failed
+    //!
+    bool drain ();
+
+    //! @brief Receive ring:  storage, oldest byte, and bytes held
+    //!
+    std::vector<char> ring_;
+    int head_;
+    int count_;
+
+    //! @brief Bytes of the ring already searched for a delimiter
+    //!
+    int scanned_;
+
+    //! @brief Bytes dropped
+    //!
+    unsigned long dropped_;
+
+    //! @brief Framing settings
+    //!
+    serialFraming framing_;
+    int size_;
+    char delimiter_;
+    bool bigEndian_;
+    bool inclusive_;
+
+    //! @brief Message callback
+    //!
+    serialHandler handler_;
+    void *param_;
+
+    //! @brief Messages held for receive(), and the one being assembled
+    //!
+    std::deque<std::string> inbox_;
+    std::string message_;
+
+    //! @brief Bytes waiting to be written, guarded by txLock_
+    //!
+    std::string txQueue_;
+    mutable std::mutex txLock_;
+
+#ifdef WIN32
+    //! @brief Port, and the read and write in progress
+    //!
+    HANDLE handle_;
+    OVERLAPPED rxOv_;
+    OVERLAPPED txOv_;
+    bool rxPending_;
+    bool txPending_;
+    char rxChunk_[1024];
+    std::string txFlight_;
+
+    //! @brief Start the next overlapped read and write
+    //!
+    bool startRead ();
+    bool startWrite ();
+#else
+    //! @brief Port descriptor
+    //!
+    int fd_;
+#endif
+
+    serialPort (const serialPort &) = delete;
+    serialPort &operator= (const serialPort &) = delete;
+  }; // serialPort
 }
 
 #endif
\ No newline at end of file
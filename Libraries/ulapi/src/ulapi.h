@@ -102,6 +102,48 @@ extern LIBRARY_API const char *ulapi_time_string(char *dst, size_t size);
 /*! Puts the calling thread to sleep for a period of \a secs seconds. */
 extern LIBRARY_API void ulapi_sleep(ulapi_real secs);
 
+/*!
+  Puts the calling thread to sleep until \a when, a time on the
+  ulapi_time clock. Returns at once if that time has passed.
+*/
+extern LIBRARY_API void ulapi_sleep_until(ulapi_real when);
+
+/*!
+  Returns a timer that wakes a task at deadlines a fixed \a period
+  seconds apart, the first one period after the timer is made, or
+  NULL if none can be made. The deadlines are absolute, so the time a
+  task spends between waits does not make the rate drift. Unix sleeps
+  with clock_nanosleep on the monotonic clock; Windows uses a
+  high-resolution waitable timer where the system has one.
+*/
+extern LIBRARY_API void *ulapi_periodic_new(ulapi_real period);
+extern LIBRARY_API ulapi_result ulapi_periodic_delete(void *timer);
+
+/*!
+  Sleeps until the next deadline of \a timer. Returns 0 if the caller
+  arrived before it. If the deadline had already passed, returns at
+  once with the number of deadlines overrun (that one, and any that
+  passed wholly while the caller was busy); these are skipped rather
+  than made up, so the next wait is for the first deadline still ahead.
+  Returns -1 if \a timer is not valid.
+*/
+extern LIBRARY_API ulapi_integer ulapi_periodic_wait(void *timer);
+
+/*!
+  Starts the deadlines of \a timer again from now, with a new
+  \a period if it is positive, and clears its statistics.
+*/
+extern LIBRARY_API ulapi_result ulapi_periodic_reset(void *timer, ulapi_real period);
+
+/*! Returns the number of deadlines overrun since the timer was made or reset. */
+extern LIBRARY_API ulapi_integer ulapi_periodic_overruns(void *timer);
+
+/*!
+  Returns the longest time, in seconds, that a wait has returned after
+  its deadline, whether from oversleeping or from an overrun.
+*/
+extern LIBRARY_API ulapi_real ulapi_periodic_worst(void *timer);
+
 /*! Puts the application to sleep indefinitely until a signal */
 extern LIBRARY_API ulapi_result ulapi_app_wait(void);
 
@@ -205,11 +247,86 @@ extern LIBRARY_API ulapi_result ulapi_task_start(ulapi_task_struct *task,
 				     ulapi_prio prio,
 				     ulapi_integer period_nsec);
 
+/*! Scheduling policies for ulapi_task_start_attr */
+typedef enum {
+  ULAPI_SCHED_NORMAL = 0,
+  ULAPI_SCHED_FIFO,
+  ULAPI_SCHED_RR
+} ulapi_sched;
+
+/*!
+  How a task is to be run. Set the defaults with ulapi_task_attr_init,
+  then change what is needed.
+
+  \a policy and \a priority give the scheduling: for ULAPI_SCHED_FIFO
+  and ULAPI_SCHED_RR, \a priority is a real-time priority from 1 (low)
+  to 99 (high), limited to what the system allows; it is ignored for
+  ULAPI_SCHED_NORMAL. On Windows, the real-time policies run the thread
+  at a priority above normal (time-critical from 90 up) and register it
+  with the Multimedia Class Scheduler ("Pro Audio" task) where present.
+
+  \a cpu pins the task to one processor (-1 for any). \a stack_size is
+  the size of the task's stack in bytes (0 for the default), all of
+  which is touched before the task code runs, so that it is not paged
+  in later. \a lock_memory locks all of the process's memory, current
+  and future, into RAM before the task starts (mlockall), so that the
+  task never waits on a page fault; Windows has no equivalent, and
+  reports it as refused.
+*/
+typedef struct {
+  ulapi_sched policy;
+  ulapi_integer priority;
+  ulapi_integer cpu;
+  ulapi_integer stack_size;
+  ulapi_flag lock_memory;
+} ulapi_task_attr;
+
+extern LIBRARY_API void ulapi_task_attr_init(ulapi_task_attr *attr);
+
+/*!
+  Starts \a taskcode on \a task as ulapi_task_start does, but with the
+  attributes in \a attr. A real-time policy or memory locking usually
+  needs privileges (e.g., CAP_SYS_NICE and CAP_IPC_LOCK, or an rtprio
+  and memlock limit, on Linux). If they are refused, the task is still
+  started, with normal scheduling, and ULAPI_IMPL_ERROR is returned.
+  Returns ULAPI_ERROR only if the task could not be started at all.
+*/
+extern LIBRARY_API ulapi_result ulapi_task_start_attr(ulapi_task_struct *task,
+				     void (*taskcode)(void *),
+				     void *taskarg,
+				     const ulapi_task_attr *attr);
+
 extern  LIBRARY_API ulapi_result ulapi_task_stop(ulapi_task_struct *);
 extern LIBRARY_API ulapi_result ulapi_task_pause(ulapi_task_struct *);
 extern LIBRARY_API ulapi_result ulapi_task_resume(ulapi_task_struct *);
 extern LIBRARY_API ulapi_result ulapi_task_set_period(ulapi_task_struct *, ulapi_integer period_nsec);
 extern LIBRARY_API ulapi_result ulapi_self_set_period(ulapi_integer period_nsec);
+
+/*!
+  Restricts the calling task to processor \a cpu, numbered from 0, or
+  lets it run on any processor if \a cpu is negative. Returns ULAPI_OK
+  if successful, ULAPI_ERROR if there is no such processor or the
+  platform cannot pin threads.
+*/
+extern LIBRARY_API ulapi_result ulapi_self_set_affinity(ulapi_integer cpu);
+
+/*! Returns the number of processors online */
+extern LIBRARY_API ulapi_integer ulapi_cpu_count(void);
+
+/*!
+  Returns the number of NUMA nodes (processor sockets, on most
+  machines), which is 1 where memory is not divided by node or the
+  system does not say.
+*/
+extern LIBRARY_API ulapi_integer ulapi_numa_node_count(void);
+
+/*!
+  Restricts the calling task to the processors of NUMA node \a node,
+  numbered from 0, or lets it run on any processor if \a node is
+  negative. Returns ULAPI_OK if successful, ULAPI_ERROR if there is
+  no such node or the platform cannot pin threads.
+*/
+extern LIBRARY_API ulapi_result ulapi_self_set_node(ulapi_integer node);
 extern LIBRARY_API ulapi_result ulapi_wait(ulapi_integer period_nsec);
 
 /*!
@@ -269,6 +386,214 @@ extern LIBRARY_API ulapi_result ulapi_mutex_give(ulapi_mutex_struct *mutex);
   blocks the caller until the mutex is given. */
 extern LIBRARY_API ulapi_result ulapi_mutex_take(ulapi_mutex_struct *mutex);
 
+/*!
+  Returns a lock for short critical sections taken often (e.g., the
+  shared state of a driver), or NULL if none can be created. Taking
+  one that is free costs a single atomic operation; a task that finds
+  it held spins briefly, then sleeps in the kernel until it is given
+  (a futex on Linux, a critical section with a spin count on
+  Windows). Fast locks are not recursive, are private to the process,
+  and cannot be passed to \a ulapi_cond_wait.
+*/
+extern LIBRARY_API void *ulapi_fastlock_new(void);
+extern LIBRARY_API ulapi_result ulapi_fastlock_delete(void *lock);
+extern LIBRARY_API ulapi_result ulapi_fastlock_take(void *lock);
+/*! Takes the lock if it is free, returning ULAPI_ERROR if it is held. */
+extern LIBRARY_API ulapi_result ulapi_fastlock_trytake(void *lock);
+extern LIBRARY_API ulapi_result ulapi_fastlock_give(void *lock);
+
+/*!
+  Returns a reader-writer lock, or NULL if none can be created. Any
+  number of tasks may hold it for reading at once; a writer holds it
+  alone. Where the system allows, waiting writers are preferred, so
+  that a stream of readers cannot hold off the task publishing new
+  data. Reader-writer locks
+  are not recursive, and a reader may not take the lock for writing
+  without first giving it.
+*/
+extern LIBRARY_API void *ulapi_rwlock_new(void);
+extern LIBRARY_API ulapi_result ulapi_rwlock_delete(void *lock);
+extern LIBRARY_API ulapi_result ulapi_rwlock_read_take(void *lock);
+extern LIBRARY_API ulapi_result ulapi_rwlock_read_give(void *lock);
+extern LIBRARY_API ulapi_result ulapi_rwlock_write_take(void *lock);
+extern LIBRARY_API ulapi_result ulapi_rwlock_write_give(void *lock);
+
+/*!
+  Lock profiling. While it is on, each take of a mutex, fast lock or
+  reader-writer lock records whether the lock was held and how long
+  the caller waited for it, and each exclusive take also how long the
+  lock was then held and from where it was taken. Profiling is off
+  until turned on; while off, a take or give costs one extra load. A
+  lock is profiled only if it was created through ulapi (up to
+  ULAPI_LOCK_PROFILE_MAX of them at once).
+*/
+#define ULAPI_LOCK_PROFILE_MAX 512
+#define ULAPI_LOCK_NAME_LEN 32
+
+typedef struct {
+  const void *lock;		/* the lock */
+  ulapi_id key;			/* key given to ulapi_mutex_new, or 0 */
+  char name[ULAPI_LOCK_NAME_LEN]; /* name given to ulapi_lock_name, or "" */
+  int kind;			/* 0 mutex, 1 fast lock, 2 reader-writer lock */
+  unsigned long long takes;	/* takes while profiling */
+  unsigned long long contended;	/* takes that found the lock held */
+  ulapi_real wait_total;	/* total and longest wait for the lock (s) */
+  ulapi_real wait_max;
+  ulapi_real hold_total;	/* total and longest exclusive hold (s) */
+  ulapi_real hold_max;
+  void *wait_max_site;		/* code that waited longest for the lock */
+  void *hold_max_site;		/* code that held the lock longest */
+} ulapi_lock_stats;
+
+/*! Turns lock profiling on or off. */
+extern LIBRARY_API void ulapi_lock_profile(ulapi_flag on);
+extern LIBRARY_API ulapi_flag ulapi_lock_profiling(void);
+/*! Names a lock (a mutex, fast lock or reader-writer lock) in its
+  statistics. The name is copied, and truncated if too long. */
+extern LIBRARY_API ulapi_result ulapi_lock_name(const void *lock, const char *name);
+/*! Copies the statistics of up to \a max existing locks that have been
+  taken while profiling into \a stats, returning how many were copied. */
+extern LIBRARY_API ulapi_integer ulapi_lock_stats_get(ulapi_lock_stats *stats, ulapi_integer max);
+/*! Clears the statistics of every lock. */
+extern LIBRARY_API void ulapi_lock_stats_reset(void);
+
+/*!
+  Returns a lock-free ring queue of fixed-size items, for handing data
+  from one task to another without a mutex (e.g., commands to a
+  driver's control thread, or samples from a sensor's acquisition
+  thread), or NULL if none can be created. The queue has at least
+  \a slots slots (rounded up to a power of two) of \a size bytes
+  each. \a ulapi_spsc_new makes a queue for a single producer and a
+  single consumer; \a ulapi_mpsc_new one that any number of producers
+  may push to at once, still with a single consumer. The ends used by
+  the producers and by the consumer sit on cache lines of their own,
+  so the two sides do not contend for them. Both kinds are used with
+  the ulapi_queue calls below.
+*/
+extern LIBRARY_API void *ulapi_spsc_new(ulapi_integer slots, ulapi_integer size);
+extern LIBRARY_API void *ulapi_mpsc_new(ulapi_integer slots, ulapi_integer size);
+extern LIBRARY_API ulapi_result ulapi_queue_delete(void *queue);
+
+/*!
+  Copies \a item into the queue, returning ULAPI_ERROR if it is full.
+  Never blocks; wakes the consumer if it is waiting for an item.
+*/
+extern LIBRARY_API ulapi_result ulapi_queue_push(void *queue, const void *item);
+
+/*!
+  Copies the oldest item into \a item and removes it from the queue,
+  returning ULAPI_ERROR if the queue is empty. Never blocks.
+*/
+extern LIBRARY_API ulapi_result ulapi_queue_pop(void *queue, void *item);
+
+/*!
+  Pops the oldest item, first waiting up to \a secs seconds (forever
+  if negative) for one to be pushed if the queue is empty. Returns
+  ULAPI_ERROR on a timeout.
+*/
+extern LIBRARY_API ulapi_result ulapi_queue_pop_wait(void *queue, void *item, ulapi_real secs);
+
+/*!
+  Returns the number of items in the queue. The count is only a
+  snapshot while other tasks are pushing or popping.
+*/
+extern LIBRARY_API ulapi_integer ulapi_queue_count(void *queue);
+
+/*!
+  Sets a hook for a consumer that waits on something other than the
+  queue (e.g., a poller, with \a ulapi_poller_wake as \a notify and the
+  poller as \a arg). After the consumer calls \a ulapi_queue_arm, the
+  next push calls \a notify(\a arg) from the pushing task, once. A
+  NULL \a notify removes the hook.
+*/
+extern LIBRARY_API ulapi_result ulapi_queue_set_notify(void *queue, ulapi_result (*notify)(void *), void *arg);
+
+/*!
+  Asks for the notify hook to be called on the next push, before the
+  consumer goes to wait. Returns ULAPI_ERROR, without arming, if items
+  are already waiting; the consumer should pop them instead of
+  waiting. The pairing of arm and push is race-free, so a consumer
+  that pops until the queue is empty and then arms never sleeps past
+  an item.
+*/
+extern LIBRARY_API ulapi_result ulapi_queue_arm(void *queue);
+
+/*!
+  Work pools, for running many short functions in parallel (e.g., the
+  points of a batch transform, or the candidates of a clustering pass)
+  without starting threads for each job. A pool has a fixed set of
+  worker tasks, each with its own queue of work in each priority lane.
+  A worker runs its own newest work first, and when it has none takes
+  the oldest work of another worker, preferring those on its NUMA
+  node. Work is taken from the highest lane that has any. On machines
+  with more than one NUMA node, workers are spread evenly across the
+  nodes and kept on their node's processors.
+
+  Work is submitted through a group, and \a ulapi_group_wait returns
+  when all of the group's work is done. Work may itself submit work:
+  a worker puts it on its own queue, so nested parallel work stays on
+  the worker's node unless others are idle. A task that waits on a
+  group runs queued work while it waits, so nested waits do not tie
+  up the pool.
+*/
+typedef enum {
+  ULAPI_LANE_HIGH = 0,
+  ULAPI_LANE_NORMAL,
+  ULAPI_LANE_LOW
+} ulapi_lane;
+
+/*!
+  Returns a pool of \a workers worker tasks (one per processor if 0 or
+  less), or NULL if none can be created.
+*/
+extern LIBRARY_API void *ulapi_pool_new(ulapi_integer workers);
+
+/*!
+  Runs any work still queued, then stops the workers and deletes the
+  pool. The groups of the pool must be deleted first.
+*/
+extern LIBRARY_API ulapi_result ulapi_pool_delete(void *pool);
+
+/*!
+  Returns the process's shared pool, with one worker per processor,
+  creating it on first use. It is never deleted. Libraries should
+  use this pool rather than making their own, so that the processors
+  are not oversubscribed.
+*/
+extern LIBRARY_API void *ulapi_pool_default(void);
+
+/*! Returns the number of workers in the pool */
+extern LIBRARY_API ulapi_integer ulapi_pool_workers(void *pool);
+
+/*!
+  Returns a new, empty group for submitting work to \a pool (the
+  shared pool if NULL), or NULL on error.
+*/
+extern LIBRARY_API void *ulapi_group_new(void *pool);
+
+/*! Waits for the group's work, then deletes the group. */
+extern LIBRARY_API ulapi_result ulapi_group_delete(void *group);
+
+/*!
+  Queues \a code(\a arg) to run on the group's pool, in \a lane.
+  Returns ULAPI_ERROR if the work could not be queued.
+*/
+extern LIBRARY_API ulapi_result ulapi_group_run(void *group, void (*code)(void *), void *arg, ulapi_lane lane);
+
+/*! Waits until all of the work submitted to the group has finished. */
+extern LIBRARY_API ulapi_result ulapi_group_wait(void *group);
+
+/*!
+  Calls \a body(first, last, \a arg) for subranges [first, last) that
+  together cover [\a begin, \a end), in parallel on \a pool (the
+  shared pool if NULL), and returns when all of them are done. The
+  calling task takes part. Subranges hold \a grain indices (the last
+  may hold fewer), or, if \a grain is 0 or less, about a quarter of an
+  even share for each worker, so that workers that finish early take
+  on more.
+*/
+extern LIBRARY_API ulapi_result ulapi_parallel_for(void *pool, ulapi_integer begin, ulapi_integer end, ulapi_integer grain, void (*body)(ulapi_integer first, ulapi_integer last, void *arg), void *arg);
+
 extern LIBRARY_API void *ulapi_sem_new(ulapi_id key);
 extern LIBRARY_API ulapi_result ulapi_sem_delete(void *sem);
 extern LIBRARY_API ulapi_result ulapi_sem_give(void *sem);
@@ -293,6 +618,15 @@ extern LIBRARY_API ulapi_result ulapi_cond_broadcast(void *cond);
 /*! Waits until the condition variable has reached its release value */
 extern LIBRARY_API ulapi_result ulapi_cond_wait(void *cond, void *mutex);
 
+/*!
+  Waits until the condition variable has reached its release value,
+  or until \a secs seconds have elapsed. The mutex is held again on
+  return in either case. Returns ULAPI_OK if signaled, ULAPI_ERROR
+  on timeout or failure. Callers should recheck their predicate, since
+  wakeups may be spurious.
+*/
+extern LIBRARY_API ulapi_result ulapi_cond_timedwait(void *cond, void *mutex, ulapi_real secs);
+
 /*!
   Allocates space for a platform-specific data structure that holds
   the shared memory configuration. Pass this to \a ulapi_shm_addr
@@ -372,7 +706,9 @@ extern LIBRARY_API ulapi_integer ulapi_socket_get_broadcastee_id_on_interface(ul
  */
 extern LIBRARY_API ulapi_integer ulapi_socket_get_multicaster_id(ulapi_integer port);
 /*!
-  Equivalent to ulapi_socket_get_multicaster_id but with a specified interface group.
+  Equivalent to ulapi_socket_get_multicaster_id but with a specified
+  multicast group address \a intf (e.g., "239.255.0.1"). Datagrams are
+  sent with a TTL of 1 and are looped back to the sending computer.
  */
 extern LIBRARY_API ulapi_integer ulapi_socket_get_multicaster_id_on_interface(ulapi_integer port, const char *intf);
 /*!
@@ -380,7 +716,9 @@ extern LIBRARY_API ulapi_integer ulapi_socket_get_multicaster_id_on_interface(ul
 */
 extern LIBRARY_API ulapi_integer ulapi_socket_get_multicastee_id(ulapi_integer port);
 /*!
-  Equivalent to ulapi_socket_get_multicastee_id but with a specified interface group. */
+  Equivalent to ulapi_socket_get_multicastee_id but with a specified
+  multicast group address \a intf. Any number of readers on one computer
+  can share the port. */
 extern LIBRARY_API ulapi_integer ulapi_socket_get_multicastee_id_on_interface(ulapi_integer port, const char *intf);
 
 /*!
@@ -389,6 +727,12 @@ extern LIBRARY_API ulapi_integer ulapi_socket_get_multicastee_id_on_interface(ul
 extern LIBRARY_API ulapi_result ulapi_socket_set_nonblocking(ulapi_integer id);
 extern LIBRARY_API ulapi_result ulapi_socket_set_blocking(ulapi_integer id);
 
+/*!
+  Disables Nagle's algorithm on a TCP socket, so that short writes are
+  sent immediately rather than coalesced with later ones.
+*/
+extern LIBRARY_API ulapi_result ulapi_socket_set_nodelay(ulapi_integer id);
+
 extern LIBRARY_API char *ulapi_address_to_hostname(ulapi_integer address);
 extern LIBRARY_API ulapi_integer ulapi_hostname_to_address(const char *hostname);
 extern LIBRARY_API ulapi_integer ulapi_get_host_address(void);
@@ -405,12 +749,195 @@ extern LIBRARY_API ulapi_integer ulapi_socket_read(ulapi_integer id, char *buf,
  */
 extern LIBRARY_API ulapi_integer ulapi_socket_write(ulapi_integer id, const char *buf, ulapi_integer len);
 
+/*!
+  Reads one datagram of up to \a len bytes from UDP socket \a id into
+  \a buf. If \a address and \a port are not NULL, they are set to the
+  sender's address (as returned by ulapi_hostname_to_address) and port,
+  for replying with ulapi_socket_write_to. Returns the number of bytes
+  read, or -1 on error.
+ */
+extern LIBRARY_API ulapi_integer ulapi_socket_read_from(ulapi_integer id, char *buf, ulapi_integer len, ulapi_integer *address, ulapi_integer *port);
+
+/*!
+  Sends \a len bytes from \a buf as one datagram on UDP socket \a id to
+  \a address and \a port. Returns the number of bytes written, or -1 on
+  error.
+ */
+extern LIBRARY_API ulapi_integer ulapi_socket_write_to(ulapi_integer id, ulapi_integer address, ulapi_integer port, const char *buf, ulapi_integer len);
+
+/*! One buffer of a scatter/gather transfer */
+typedef struct {
+  char *buf;
+  ulapi_integer len;
+} ulapi_iovec;
+
+/*!
+  Reads from socket \a id into the \a count buffers of \a iov in turn,
+  filling each before the next, in one call. Returns the total number
+  of bytes read, or -1 on error.
+ */
+extern LIBRARY_API ulapi_integer ulapi_socket_readv(ulapi_integer id, const ulapi_iovec *iov, ulapi_integer count);
+
+/*!
+  Writes the \a count buffers of \a iov to socket \a id, in order, as
+  if they were one. Returns the total number of bytes written, or -1
+  on error.
+ */
+extern LIBRARY_API ulapi_integer ulapi_socket_writev(ulapi_integer id, const ulapi_iovec *iov, ulapi_integer count);
+
+/*!
+  One datagram of a batched transfer. \a buf holds \a size bytes; \a len
+  is the length of the datagram, set on reads and given on writes.
+  \a address and \a port are those of the sender on reads, and the
+  destination on writes (both 0 for a connected socket). \a stamp is
+  set on reads to the time the datagram arrived (see
+  ulapi_socket_set_timestamps).
+ */
+typedef struct {
+  char *buf;
+  ulapi_integer size;
+  ulapi_integer len;
+  ulapi_integer address;
+  ulapi_integer port;
+  ulapi_real stamp;
+} ulapi_datagram;
+
+/*! Sources of receive timestamps */
+enum {
+  ULAPI_STAMP_OFF = 0,
+  ULAPI_STAMP_KERNEL,
+  ULAPI_STAMP_HARDWARE
+};
+
+/*!
+  Has the kernel stamp the data arriving on socket \a id, so that reads
+  report when it arrived rather than when the reader got to it.
+  ULAPI_STAMP_KERNEL uses the time the network stack received each
+  packet (SO_TIMESTAMPNS on Linux, SO_TIMESTAMP elsewhere on Unix).
+  ULAPI_STAMP_HARDWARE asks for the network card's own stamp
+  (SO_TIMESTAMPING), falling back to the kernel's for packets the card
+  does not stamp; the card must have been set up for receive stamping
+  (e.g., by ptp4l), and its clock kept in step with the system's (e.g.,
+  by phc2sys). Returns ULAPI_OK if enabled, or ULAPI_IMPL_ERROR where
+  unsupported (including Windows), in which case reads stamp data with
+  ulapi_time when it is read.
+ */
+extern LIBRARY_API ulapi_result ulapi_socket_set_timestamps(ulapi_integer id, ulapi_integer how);
+
+/*!
+  Equivalent to ulapi_socket_read, also setting \a stamp (if not NULL)
+  to the time, on the ulapi_time clock, at which the data arrived.
+ */
+extern LIBRARY_API ulapi_integer ulapi_socket_read_stamped(ulapi_integer id, char *buf, ulapi_integer len, ulapi_real *stamp);
+
+/*! Most datagrams moved per system call; larger batches take several */
+#define ULAPI_SOCKET_BATCH_MAX 64
+
+/*!
+  Reads up to \a count datagrams that are already queued on UDP socket
+  \a id, without waiting for more. Uses recvmmsg on Linux, so a burst
+  is drained in one call. Returns the number of datagrams read (0 if
+  none were waiting), or -1 on error.
+ */
+extern LIBRARY_API ulapi_integer ulapi_socket_read_batch(ulapi_integer id, ulapi_datagram *msgs, ulapi_integer count);
+
+/*!
+  Sends the \a count datagrams of \a msgs on UDP socket \a id. Uses
+  sendmmsg on Linux. Returns the number of datagrams sent, or -1 if
+  none could be.
+ */
+extern LIBRARY_API ulapi_integer ulapi_socket_write_batch(ulapi_integer id, const ulapi_datagram *msgs, ulapi_integer count);
+
 /*!
   Broadcasts \a len bytes from \a buf to socket \a id using port -a
   port. Returns the number of bytes written, or -1 on error.
  */
 extern LIBRARY_API ulapi_integer ulapi_socket_broadcast(ulapi_integer id, ulapi_integer port, const char *buf, ulapi_integer len);
 
+/*!
+  Waits up to \a secs seconds for any of the \a count sockets in \a ids
+  to have data to read (or, for a server socket, a pending connection).
+  On return, \a ready[i] is nonzero if \a ids[i] is readable or has been
+  closed by the peer. Returns the number of ready sockets, 0 on timeout,
+  or -1 on error. A negative \a secs waits indefinitely. At most
+  ULAPI_SOCKET_POLL_MAX sockets can be polled at once.
+ */
+#define ULAPI_SOCKET_POLL_MAX 64
+extern LIBRARY_API ulapi_integer ulapi_socket_poll(const ulapi_integer *ids, ulapi_integer *ready, ulapi_integer count, ulapi_real secs);
+
+/*
+  Poller API
+*/
+
+/*!
+  A poller holds a set of sockets and waits for any of them to become
+  ready, without the set being rebuilt on each wait as with
+  ulapi_socket_poll. It is implemented with epoll on Linux, and with
+  poll on other Unix systems and select on Windows, where at most
+  ULAPI_SOCKET_POLL_MAX sockets can be added. Sockets should be added,
+  changed and removed only by the thread that waits. Readiness is
+  level-triggered: a socket is reported by every wait until it has been
+  read (or written) enough to no longer be ready.
+*/
+
+/*! Events waited for, combined with | */
+#define ULAPI_POLL_READ 1
+#define ULAPI_POLL_WRITE 2
+/*! Events reported whether or not they are waited for */
+#define ULAPI_POLL_HANGUP 4
+#define ULAPI_POLL_ERROR 8
+
+/*! A ready socket, along with the data it was added with */
+typedef struct {
+  ulapi_integer id;
+  ulapi_integer events;
+  void *data;
+} ulapi_poll_event;
+
+/*!
+  Returns a new, empty poller, or NULL on error.
+*/
+extern LIBRARY_API void *ulapi_poller_new(void);
+
+/*!
+  Deletes the poller. The sockets in it are not closed.
+*/
+extern LIBRARY_API ulapi_result ulapi_poller_delete(void *poller);
+
+/*!
+  Adds socket \a id to the poller, to wait for \a events. \a data is
+  returned with each of the socket's events. A socket can be added only
+  once.
+*/
+extern LIBRARY_API ulapi_result ulapi_poller_add(void *poller, ulapi_integer id, ulapi_integer events, void *data);
+
+/*!
+  Changes the events waited for, and the data returned, for socket
+  \a id.
+*/
+extern LIBRARY_API ulapi_result ulapi_poller_modify(void *poller, ulapi_integer id, ulapi_integer events, void *data);
+
+/*!
+  Removes socket \a id from the poller. This must be done before the
+  socket is closed.
+*/
+extern LIBRARY_API ulapi_result ulapi_poller_remove(void *poller, ulapi_integer id);
+
+/*!
+  Waits up to \a secs seconds for any socket in the poller to be ready
+  (indefinitely if \a secs is negative), and fills in up to \a max
+  \a events. Returns the number of events, 0 on timeout or if woken by
+  ulapi_poller_wake, or -1 on error. Only one thread should wait on a
+  poller at a time.
+*/
+extern LIBRARY_API ulapi_integer ulapi_poller_wait(void *poller, ulapi_poll_event *events, ulapi_integer max, ulapi_real secs);
+
+/*!
+  Makes a wait in progress on the poller (or, if there is none, the
+  next one) return at once. Safe to call from any thread.
+*/
+extern LIBRARY_API ulapi_result ulapi_poller_wake(void *poller);
+
 /*!
   Closes the socket id, whether that for a client, for a server, or to
   a client, broadcast or otherwise.
@@ -0,0 +1,510 @@
+/*
+  DISCLAIMER:
+  This software was produced by the National Institute of Standards
+  and Technology (NIST), an agency of the U.S. government, and by statute is
+  not subject to copyright in the United States.  Recipients of this software
+  assume all responsibility associated with its operation, modification,
+  maintenance, and subsequent redistribution.
+
+  See NIST Administration Manual 4.09.07 b and Appendix I.
+*/
+
+/*!
+  \file ulapi_pool.c
+
+  Work pools, built on the task, lock and condition variable calls of
+  the platform's ulapi, so the same code serves every platform.
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include "ulapi.h"		/* these decls */
+#include <stddef.h>		/* NULL */
+#include <stdlib.h>		/* malloc, realloc, free */
+#include <string.h>		/* memset */
+
+#ifdef _MSC_VER
+#define POOL_TLS __declspec(thread)
+typedef volatile LONG pool_count;
+static long pool_add(pool_count *p, long v) { return InterlockedExchangeAdd(p, v) + v; }
+static long pool_load(pool_count *p) { return InterlockedCompareExchange(p, 0, 0); }
+static void *pool_cas_ptr(void *volatile *p, void *expected, void *desired)
+{
+  return InterlockedCompareExchangePointer(p, desired, expected);
+}
+#else
+#define POOL_TLS __thread
+typedef long pool_count;
+static long pool_add(pool_count *p, long v) { return __atomic_add_fetch(p, v, __ATOMIC_SEQ_CST); }
+static long pool_load(pool_count *p) { return __atomic_load_n(p, __ATOMIC_SEQ_CST); }
+static void *pool_cas_ptr(void *volatile *p, void *expected, void *desired)
+{
+  (void) __atomic_compare_exchange_n(p, &expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+  return expected;
+}
+#endif
+
+#define POOL_LANES 3
+#define POOL_LINE 64
+
+struct pool_struct;
+struct pool_group;
+
+typedef struct {
+  void (*code)(void *);
+  void *arg;
+  struct pool_group *group;
+} pool_work;
+
+/* a ring of work, taken from the newest end by its owner and from
+   the oldest end by thieves */
+typedef struct {
+  pool_work *items;
+  long size;
+  long first;
+  pool_count count;
+} pool_deque;
+
+typedef struct {
+  struct pool_struct *pool;
+  void *lock;
+  pool_deque lane[POOL_LANES];
+  ulapi_integer node;
+  ulapi_integer index;
+  ulapi_task_struct *task;
+  char pad[POOL_LINE];
+} pool_worker;
+
+typedef struct pool_struct {
+  pool_worker *workers;
+  ulapi_integer count;
+  ulapi_integer started;
+  ulapi_integer nodes;
+  /* for each worker, the others in the order it steals from them */
+  ulapi_integer *victims;
+  pool_count queued;
+  pool_count sleepers;
+  pool_count next;
+  pool_count run;
+  ulapi_mutex_struct *mutex;
+  void *cond;
+} pool_struct;
+
+typedef struct pool_group {
+  pool_struct *pool;
+  pool_count outstanding;
+  ulapi_mutex_struct *mutex;
+  void *cond;
+} pool_group;
+
+/* the worker the calling task is, if it is one */
+static POOL_TLS pool_worker *pool_self = NULL;
+
+static int deque_push(pool_deque *dq, const pool_work *work)
+{
+  pool_work *items;
+  long i, n;
+
+  if (dq->count == dq->size) {
+    n = (dq->size > 0 ? 2 * dq->size : 64);
+    items = (pool_work *) malloc(n * sizeof(pool_work));
+    if (NULL == items) return 0;
+    for (i = 0; i < dq->count; i++) items[i] = dq->items[(dq->first + i) % dq->size];
+    free(dq->items);
+    dq->items = items;
+    dq->size = n;
+    dq->first = 0;
+  }
+  dq->items[(dq->first + dq->count) % dq->size] = *work;
+  dq->count++;
+
+  return 1;
+}
+
+static int deque_take(pool_deque *dq, pool_work *work, int newest)
+{
+  if (0 == dq->count) return 0;
+
+  if (newest) {
+    *work = dq->items[(dq->first + dq->count - 1) % dq->size];
+  } else {
+    *work = dq->items[dq->first];
+    dq->first = (dq->first + 1) % dq->size;
+  }
+  dq->count--;
+
+  return 1;
+}
+
+static int pool_submit(pool_struct *pool, const pool_work *work, ulapi_lane lane)
+{
+  pool_worker *w;
+  int ok;
+
+  if (lane < ULAPI_LANE_HIGH || lane > ULAPI_LANE_LOW) lane = ULAPI_LANE_NORMAL;
+
+  /* a worker keeps its own work; others spread theirs around */
+  if (NULL != pool_self && pool_self->pool == pool) {
+    w = pool_self;
+  } else {
+    w = &pool->workers[(unsigned long) pool_add(&pool->next, 1) % pool->count];
+  }
+
+  ulapi_fastlock_take(w->lock);
+  ok = deque_push(&w->lane[lane], work);
+  ulapi_fastlock_give(w->lock);
+  if (!ok) return 0;
+
+  /* pairs with the check in pool_idle:  either a sleeper is seen
+     here, or the work is seen there */
+  pool_add(&pool->queued, 1);
+  if (pool_load(&pool->sleepers) > 0) {
+    ulapi_mutex_take(pool->mutex);
+    ulapi_cond_signal(pool->cond);
+    ulapi_mutex_give(pool->mutex);
+  }
+
+  return 1;
+}
+
+static int pool_take(pool_struct *pool, pool_work *work)
+{
+  pool_worker *w;
+  ulapi_integer k, self;
+  int lane, got;
+
+  if (0 == pool_load(&pool->queued)) return 0;
+
+  self = (NULL != pool_self && pool_self->pool == pool) ? pool_self->index : -1;
+  for (lane = 0; lane < POOL_LANES; lane++) {
+    for (k = (self >= 0 ? -1 : 0); k < (self >= 0 ? pool->count - 1 : pool->count); k++) {
+      if (k < 0) {
+	w = pool_self;
+      } else if (self >= 0) {
+	w = &pool->workers[pool->victims[self * (pool->count - 1) + k]];
+      } else {
+	w = &pool->workers[k];
+      }
+      /* an unlocked look, to pass over empty lanes cheaply */
+      if (0 == w->lane[lane].count) continue;
+      ulapi_fastlock_take(w->lock);
+      got = deque_take(&w->lane[lane], work, w == pool_self);
+      ulapi_fastlock_give(w->lock);
+      if (got) {
+	pool_add(&pool->queued, -1);
+	return 1;
+      }
+    }
+  }
+
+  return 0;
+}
+
+static void pool_finish(pool_work *work)
+{
+  pool_group *group = work->group;
+
+  work->code(work->arg);
+
+  if (0 == pool_add(&group->outstanding, -1)) {
+    ulapi_mutex_take(group->mutex);
+    ulapi_cond_broadcast(group->cond);
+    ulapi_mutex_give(group->mutex);
+  }
+}
+
+static void pool_idle(pool_struct *pool)
+{
+  ulapi_mutex_take(pool->mutex);
+  pool_add(&pool->sleepers, 1);
+  if (0 == pool_load(&pool->queued) && pool_load(&pool->run)) {
+    ulapi_cond_wait(pool->cond, pool->mutex);
+  }
+  pool_add(&pool->sleepers, -1);
+  ulapi_mutex_give(pool->mutex);
+}
+
+static void pool_worker_code(void *arg)
+{
+  pool_worker *w = (pool_worker *) arg;
+  pool_struct *pool = w->pool;
+  pool_work work;
+
+  pool_self = w;
+  if (pool->nodes > 1) (void) ulapi_self_set_node(w->node);
+
+  /* queued work is finished before the pool is torn down */
+  while (pool_load(&pool->run) || pool_load(&pool->queued) > 0) {
+    if (pool_take(pool, &work)) pool_finish(&work);
+    else pool_idle(pool);
+  }
+}
+
+void *ulapi_pool_new(ulapi_integer workers)
+{
+  pool_struct *pool;
+  pool_worker *w;
+  ulapi_integer i, k, n, v;
+  int pass;
+
+  if (workers <= 0) workers = ulapi_cpu_count();
+
+  pool = (pool_struct *) malloc(sizeof(pool_struct));
+  if (NULL == pool) return NULL;
+  memset(pool, 0, sizeof(pool_struct));
+  pool->count = workers;
+  pool->nodes = ulapi_numa_node_count();
+  if (pool->nodes > workers) pool->nodes = workers;
+  pool->run = 1;
+  pool->workers = (pool_worker *) calloc(workers, sizeof(pool_worker));
+  pool->victims = (ulapi_integer *) malloc((workers * (workers - 1) + 1) * sizeof(ulapi_integer));
+  pool->mutex = ulapi_mutex_new(0);
+  pool->cond = ulapi_cond_new(0);
+  if (NULL == pool->workers || NULL == pool->victims || NULL == pool->mutex || NULL == pool->cond) {
+    if (NULL != pool->cond) ulapi_cond_delete(pool->cond);
+    if (NULL != pool->mutex) ulapi_mutex_delete(pool->mutex);
+    free(pool->victims);
+    free(pool->workers);
+    free(pool);
+    return NULL;
+  }
+
+  for (i = 0; i < workers; i++) {
+    w = &pool->workers[i];
+    w->pool = pool;
+    w->index = i;
+    w->node = i % pool->nodes;
+    w->lock = ulapi_fastlock_new();
+  }
+
+  /* thieves look on their own node first, then on the others, each
+     starting just past themselves so that they spread out */
+  for (i = 0; i < workers; i++) {
+    n = 0;
+    for (pass = 0; pass < 2; pass++) {
+      for (k = 1; k < workers; k++) {
+	v = (i + k) % workers;
+	if ((pool->workers[v].node == pool->workers[i].node) == (0 == pass)) {
+	  pool->victims[i * (workers - 1) + n++] = v;
+	}
+      }
+    }
+  }
+
+  for (i = 0; i < workers; i++) {
+    w = &pool->workers[i];
+    w->task = ulapi_task_new();
+    if (NULL == w->lock || NULL == w->task ||
+	ULAPI_OK != ulapi_task_start(w->task, pool_worker_code, w, ulapi_prio_lowest(), 0)) {
+      if (NULL != w->task) ulapi_task_delete(w->task);
+      ulapi_pool_delete(pool);
+      return NULL;
+    }
+    pool->started++;
+  }
+
+  return (void *) pool;
+}
+
+ulapi_result ulapi_pool_delete(void *pool_arg)
+{
+  pool_struct *pool = (pool_struct *) pool_arg;
+  ulapi_integer i;
+  int lane;
+
+  if (NULL == pool) return ULAPI_ERROR;
+
+  ulapi_mutex_take(pool->mutex);
+  pool_add(&pool->run, -1);
+  ulapi_cond_broadcast(pool->cond);
+  ulapi_mutex_give(pool->mutex);
+
+  for (i = 0; i < pool->started; i++) {
+    ulapi_task_join(pool->workers[i].task, NULL);
+    ulapi_task_delete(pool->workers[i].task);
+  }
+
+  for (i = 0; i < pool->count; i++) {
+    for (lane = 0; lane < POOL_LANES; lane++) free(pool->workers[i].lane[lane].items);
+    if (NULL != pool->workers[i].lock) ulapi_fastlock_delete(pool->workers[i].lock);
+  }
+
+  ulapi_cond_delete(pool->cond);
+  ulapi_mutex_delete(pool->mutex);
+  free(pool->victims);
+  free(pool->workers);
+  free(pool);
+
+  return ULAPI_OK;
+}
+
+void *ulapi_pool_default(void)
+{
+  static void *volatile shared = NULL;
+  void *pool;
+
+  if (NULL != shared) return shared;
+
+  /* of two tasks that race to make it, one keeps its pool */
+  pool = ulapi_pool_new(0);
+  if (NULL == pool) return NULL;
+  if (NULL != pool_cas_ptr(&shared, NULL, pool)) ulapi_pool_delete(pool);
+
+  return shared;
+}
+
+ulapi_integer ulapi_pool_workers(void *pool)
+{
+  return (NULL == pool ? 0 : ((pool_struct *) pool)->count);
+}
+
+void *ulapi_group_new(void *pool)
+{
+  pool_group *group;
+
+  if (NULL == pool) pool = ulapi_pool_default();
+  if (NULL == pool) return NULL;
+
+  group = (pool_group *) malloc(sizeof(pool_group));
+  if (NULL == group) return NULL;
+  group->pool = (pool_struct *) pool;
+  group->outstanding = 0;
+  group->mutex = ulapi_mutex_new(0);
+  group->cond = ulapi_cond_new(0);
+  if (NULL == group->mutex || NULL == group->cond) {
+    if (NULL != group->cond) ulapi_cond_delete(group->cond);
+    if (NULL != group->mutex) ulapi_mutex_delete(group->mutex);
+    free(group);
+    return NULL;
+  }
+
+  return (void *) group;
+}
+
+ulapi_result ulapi_group_delete(void *group_arg)
+{
+  pool_group *group = (pool_group *) group_arg;
+
+  if (NULL == group) return ULAPI_ERROR;
+
+  ulapi_group_wait(group);
+  ulapi_cond_delete(group->cond);
+  ulapi_mutex_delete(group->mutex);
+  free(group);
+
+  return ULAPI_OK;
+}
+
+ulapi_result ulapi_group_run(void *group_arg, void (*code)(void *), void *arg, ulapi_lane lane)
+{
+  pool_group *group = (pool_group *) group_arg;
+  pool_work work;
+
+  if (NULL == group || NULL == code) return ULAPI_ERROR;
+
+  work.code = code;
+  work.arg = arg;
+  work.group = group;
+  pool_add(&group->outstanding, 1);
+  if (!pool_submit(group->pool, &work, lane)) {
+    pool_add(&group->outstanding, -1);
+    return ULAPI_ERROR;
+  }
+
+  return ULAPI_OK;
+}
+
+ulapi_result ulapi_group_wait(void *group_arg)
+{
+  pool_group *group = (pool_group *) group_arg;
+  pool_work work;
+
+  if (NULL == group) return ULAPI_ERROR;
+
+  while (pool_load(&group->outstanding) > 0) {
+    /* help with whatever is queued, ours or not */
+    if (pool_take(group->pool, &work)) {
+      pool_finish(&work);
+      continue;
+    }
+    /* the rest is running; recheck now and then, in case the work
+       that ends it is queued behind a task that waits on it */
+    ulapi_mutex_take(group->mutex);
+    if (pool_load(&group->outstanding) > 0) {
+      ulapi_cond_timedwait(group->cond, group->mutex, 0.001);
+    }
+    ulapi_mutex_give(group->mutex);
+  }
+
+  return ULAPI_OK;
+}
+
+typedef struct {
+  void (*body)(ulapi_integer, ulapi_integer, void *);
+  void *arg;
+  ulapi_integer begin;
+  ulapi_integer end;
+  ulapi_integer grain;
+  pool_count next;
+} pool_range;
+
+static void pool_range_code(void *arg)
+{
+  pool_range *range = (pool_range *) arg;
+  ulapi_integer first, last;
+
+  /* subranges are handed out in order, so that each is taken once */
+  for (;;) {
+    first = range->begin + (pool_add(&range->next, 1) - 1) * range->grain;
+    if (first >= range->end) break;
+    last = first + range->grain;
+    if (last > range->end) last = range->end;
+    range->body(first, last, range->arg);
+  }
+}
+
+ulapi_result ulapi_parallel_for(void *pool, ulapi_integer begin, ulapi_integer end, ulapi_integer grain, void (*body)(ulapi_integer first, ulapi_integer last, void *arg), void *arg)
+{
+  pool_range range;
+  void *group;
+  ulapi_integer pieces, helpers, workers, i;
+
+  if (NULL == body) return ULAPI_ERROR;
+  if (end <= begin) return ULAPI_OK;
+  if (NULL == pool) pool = ulapi_pool_default();
+  workers = ulapi_pool_workers(pool);
+
+  if (grain <= 0) {
+    grain = (end - begin) / (4 * (workers > 0 ? workers : 1));
+    if (grain < 1) grain = 1;
+  }
+  pieces = (end - begin + grain - 1) / grain;
+
+  range.body = body;
+  range.arg = arg;
+  range.begin = begin;
+  range.end = end;
+  range.grain = grain;
+  range.next = 0;
+
+  /* one piece, or no pool, needs no help */
+  group = (pieces > 1 && NULL != pool) ? ulapi_group_new(pool) : NULL;
+  if (NULL == group) {
+    body(begin, end, arg);
+    return ULAPI_OK;
+  }
+
+  helpers = (pieces - 1 < workers) ? pieces - 1 : workers;
+  for (i = 0; i < helpers; i++) {
+    if (ULAPI_OK != ulapi_group_run(group, pool_range_code, &range, ULAPI_LANE_NORMAL)) break;
+  }
+  pool_range_code(&range);
+
+  return ulapi_group_delete(group);
+}
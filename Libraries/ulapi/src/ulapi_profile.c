@@ -0,0 +1,312 @@
+/*
+  DISCLAIMER:
+  This software was produced by the National Institute of Standards
+  and Technology (NIST), an agency of the U.S. government, and by statute is
+  not subject to copyright in the United States.  Recipients of this software
+  assume all responsibility associated with its operation, modification,
+  maintenance, and subsequent redistribution.
+
+  See NIST Administration Manual 4.09.07 b and Appendix I.
+*/
+
+/*!
+  \file ulapi_profile.c
+
+  Lock profiling, shared by every platform. Locks are kept in a fixed
+  open-addressed table keyed by address, so that looking one up
+  neither allocates nor takes a lock. A lock's wait statistics may be
+  updated by several tasks at once and are kept with atomic adds; its
+  hold statistics are updated only by the task holding it exclusively,
+  while it holds it.
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include "ulapi.h"		/* these decls */
+#include "ulapi_profile.h"	/* the hooks */
+#include <stddef.h>		/* NULL, size_t */
+#include <string.h>		/* memset, strncpy */
+
+#ifdef _MSC_VER
+typedef volatile LONGLONG profile_count;
+static void profile_add(profile_count *p, LONGLONG v) { (void) InterlockedExchangeAdd64(p, v); }
+static LONGLONG profile_load(profile_count *p) { return InterlockedCompareExchange64(p, 0, 0); }
+static int profile_cas(profile_count *p, LONGLONG expected, LONGLONG desired)
+{
+  return (expected == InterlockedCompareExchange64(p, desired, expected));
+}
+static const void *profile_load_ptr(const void *volatile *p)
+{
+  return InterlockedCompareExchangePointer((PVOID volatile *) p, NULL, NULL);
+}
+static int profile_cas_ptr(const void *volatile *p, const void *expected, const void *desired)
+{
+  return (expected == InterlockedCompareExchangePointer((PVOID volatile *) p, (PVOID) desired, (PVOID) expected));
+}
+#else
+typedef long long profile_count;
+static void profile_add(profile_count *p, long long v) { (void) __atomic_fetch_add(p, v, __ATOMIC_RELAXED); }
+static long long profile_load(profile_count *p) { return __atomic_load_n(p, __ATOMIC_RELAXED); }
+static int profile_cas(profile_count *p, long long expected, long long desired)
+{
+  return __atomic_compare_exchange_n(p, &expected, desired, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+static const void *profile_load_ptr(const void *volatile *p)
+{
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+static int profile_cas_ptr(const void *volatile *p, const void *expected, const void *desired)
+{
+  return __atomic_compare_exchange_n(p, &expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+#endif
+
+/* a take without a non-blocking attempt that waited longer than this
+   (s) is counted as contended */
+#define PROFILE_CONTENDED 2.0e-6
+
+typedef struct {
+  const void *volatile lock;	/* NULL if never used, PROFILE_GONE if deleted */
+  ulapi_id key;
+  int kind;
+  char name[ULAPI_LOCK_NAME_LEN];
+  /* updated by any task taking the lock */
+  profile_count takes;
+  profile_count contended;
+  profile_count wait_ns;
+  profile_count wait_max_ns;
+  void *volatile wait_max_site;
+  /* updated by the task holding the lock exclusively */
+  long long hold_ns;
+  long long hold_max_ns;
+  void *hold_max_site;
+  ulapi_real since;		/* when the current hold began, 0 if none */
+  void *site;			/* where the current hold began */
+} profile_entry;
+
+static profile_entry profile_table[ULAPI_LOCK_PROFILE_MAX];
+
+#define PROFILE_GONE ((const void *) profile_table)
+
+volatile int ulapi_profile_on = 0;
+
+static size_t profile_hash(const void *lock)
+{
+  /* allocations are at least 16-byte aligned, so the low bits carry nothing */
+  return ((((size_t) lock) >> 4) * (size_t) 2654435761u) & (ULAPI_LOCK_PROFILE_MAX - 1);
+}
+
+static profile_entry *profile_find(const void *lock)
+{
+  size_t i, n;
+  const void *p;
+
+  i = profile_hash(lock);
+  for (n = 0; n < ULAPI_LOCK_PROFILE_MAX; n++) {
+    p = profile_load_ptr(&profile_table[i].lock);
+    if (p == lock) return &profile_table[i];
+    if (NULL == p) return NULL;
+    i = (i + 1) & (ULAPI_LOCK_PROFILE_MAX - 1);
+  }
+
+  return NULL;
+}
+
+static void profile_clear(profile_entry *e)
+{
+  e->takes = 0;
+  e->contended = 0;
+  e->wait_ns = 0;
+  e->wait_max_ns = 0;
+  e->wait_max_site = NULL;
+  e->hold_ns = 0;
+  e->hold_max_ns = 0;
+  e->hold_max_site = NULL;
+}
+
+void ulapi_profile_add(const void *lock, ulapi_id key, int kind)
+{
+  size_t i, n;
+  const void *p;
+  profile_entry *e;
+
+  if (NULL == lock) return;
+
+  i = profile_hash(lock);
+  for (n = 0; n < ULAPI_LOCK_PROFILE_MAX; n++) {
+    e = &profile_table[i];
+    p = profile_load_ptr(&e->lock);
+    if ((NULL == p || PROFILE_GONE == p) && profile_cas_ptr(&e->lock, p, lock)) {
+      /* nobody can take the lock before it is returned to its creator */
+      e->key = key;
+      e->kind = kind;
+      e->name[0] = 0;
+      e->since = 0.0;
+      profile_clear(e);
+      return;
+    }
+    i = (i + 1) & (ULAPI_LOCK_PROFILE_MAX - 1);
+  }
+  /* else the table is full, and the lock goes unprofiled */
+}
+
+void ulapi_profile_remove(const void *lock)
+{
+  profile_entry *e;
+
+  e = profile_find(lock);
+  if (NULL != e) {
+    /* left in place so that lookups of later entries still find them */
+    (void) profile_cas_ptr(&e->lock, lock, PROFILE_GONE);
+  }
+}
+
+static void profile_taken(profile_entry *e, ulapi_real now, ulapi_real wait, int contended, void *site, int shared)
+{
+  long long ns, max;
+
+  profile_add(&e->takes, 1);
+  if (contended) {
+    ns = (long long) (wait * 1.0e9);
+    profile_add(&e->contended, 1);
+    profile_add(&e->wait_ns, ns);
+    for (max = profile_load(&e->wait_max_ns); ns > max; max = profile_load(&e->wait_max_ns)) {
+      if (profile_cas(&e->wait_max_ns, max, ns)) {
+	e->wait_max_site = site;
+	break;
+      }
+    }
+  }
+
+  if (!shared) {
+    e->since = now;
+    e->site = site;
+  }
+}
+
+ulapi_result ulapi_profile_take(void *lock, ulapi_profile_op trytake,
+				ulapi_profile_op take, void *site, int shared)
+{
+  profile_entry *e;
+  ulapi_real start, now;
+  ulapi_result retval;
+
+  e = profile_find(lock);
+  if (NULL == e) return take(lock);
+
+  if (NULL != trytake && ULAPI_OK == trytake(lock)) {
+    profile_taken(e, shared ? 0.0 : ulapi_time(), 0.0, 0, site, shared);
+    return ULAPI_OK;
+  }
+
+  start = ulapi_time();
+  retval = take(lock);
+  if (ULAPI_OK != retval) return retval;
+  now = ulapi_time();
+  profile_taken(e, now, now - start, (NULL != trytake || (now - start) > PROFILE_CONTENDED), site, shared);
+
+  return ULAPI_OK;
+}
+
+void ulapi_profile_acquired(void *lock, void *site)
+{
+  profile_entry *e;
+
+  e = profile_find(lock);
+  if (NULL != e) profile_taken(e, ulapi_time(), 0.0, 0, site, 0);
+}
+
+void ulapi_profile_released(void *lock)
+{
+  profile_entry *e;
+  long long ns;
+
+  e = profile_find(lock);
+  /* a hold that began while profiling was off is not counted */
+  if (NULL == e || e->since <= 0.0) return;
+
+  ns = (long long) ((ulapi_time() - e->since) * 1.0e9);
+  e->since = 0.0;
+  e->hold_ns += ns;
+  if (ns > e->hold_max_ns) {
+    e->hold_max_ns = ns;
+    e->hold_max_site = e->site;
+  }
+}
+
+ulapi_result ulapi_profile_give(void *lock, ulapi_profile_op give, int shared)
+{
+  if (!shared) ulapi_profile_released(lock);
+
+  return give(lock);
+}
+
+void ulapi_lock_profile(ulapi_flag on)
+{
+  ulapi_profile_on = (on ? 1 : 0);
+}
+
+ulapi_flag ulapi_lock_profiling(void)
+{
+  return (ulapi_profile_on ? 1 : 0);
+}
+
+ulapi_result ulapi_lock_name(const void *lock, const char *name)
+{
+  profile_entry *e;
+
+  e = profile_find(lock);
+  if (NULL == e || NULL == name) return ULAPI_ERROR;
+
+  strncpy(e->name, name, ULAPI_LOCK_NAME_LEN - 1);
+  e->name[ULAPI_LOCK_NAME_LEN - 1] = 0;
+
+  return ULAPI_OK;
+}
+
+ulapi_integer ulapi_lock_stats_get(ulapi_lock_stats *stats, ulapi_integer max)
+{
+  profile_entry *e;
+  ulapi_lock_stats *s;
+  const void *p;
+  ulapi_integer count = 0;
+  size_t i;
+
+  for (i = 0; i < ULAPI_LOCK_PROFILE_MAX && count < max; i++) {
+    e = &profile_table[i];
+    p = profile_load_ptr(&e->lock);
+    if (NULL == p || PROFILE_GONE == p || 0 == profile_load(&e->takes)) continue;
+
+    s = &stats[count++];
+    s->lock = p;
+    s->key = e->key;
+    memcpy(s->name, e->name, ULAPI_LOCK_NAME_LEN);
+    s->name[ULAPI_LOCK_NAME_LEN - 1] = 0;
+    s->kind = e->kind;
+    s->takes = (unsigned long long) profile_load(&e->takes);
+    s->contended = (unsigned long long) profile_load(&e->contended);
+    s->wait_total = (ulapi_real) profile_load(&e->wait_ns) * 1.0e-9;
+    s->wait_max = (ulapi_real) profile_load(&e->wait_max_ns) * 1.0e-9;
+    s->hold_total = (ulapi_real) e->hold_ns * 1.0e-9;
+    s->hold_max = (ulapi_real) e->hold_max_ns * 1.0e-9;
+    s->wait_max_site = e->wait_max_site;
+    s->hold_max_site = e->hold_max_site;
+  }
+
+  return count;
+}
+
+void ulapi_lock_stats_reset(void)
+{
+  size_t i;
+
+  for (i = 0; i < ULAPI_LOCK_PROFILE_MAX; i++) {
+    profile_clear(&profile_table[i]);
+  }
+}
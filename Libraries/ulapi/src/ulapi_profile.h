@@ -0,0 +1,80 @@
+/*
+  DISCLAIMER:
+  This software was produced by the National Institute of Standards
+  and Technology (NIST), an agency of the U.S. government, and by statute is
+  not subject to copyright in the United States.  Recipients of this software
+  assume all responsibility associated with its operation, modification,
+  maintenance, and subsequent redistribution.
+
+  See NIST Administration Manual 4.09.07 b and Appendix I.
+*/
+
+/*!
+  \file ulapi_profile.h
+
+  Lock profiling hooks, called by the platform ulapis' lock functions.
+  Applications use the ulapi_lock_ calls in ulapi.h instead.
+*/
+
+#ifndef ULAPI_PROFILE_H
+#define ULAPI_PROFILE_H
+
+#include "ulapi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the address the calling ulapi function will return to */
+#if defined(_MSC_VER)
+#include <intrin.h>
+#pragma intrinsic(_ReturnAddress)
+#define ULAPI_PROFILE_CALLER() _ReturnAddress()
+#elif defined(__GNUC__)
+#define ULAPI_PROFILE_CALLER() __builtin_return_address(0)
+#else
+#define ULAPI_PROFILE_CALLER() NULL
+#endif
+
+/* kinds of lock */
+enum {
+  ULAPI_PROFILE_MUTEX = 0,
+  ULAPI_PROFILE_FASTLOCK,
+  ULAPI_PROFILE_RWLOCK
+};
+
+/* nonzero while profiling is on; checked before any hook is called */
+extern volatile int ulapi_profile_on;
+
+/* a lock operation that does not block (try) or may (take, give) */
+typedef ulapi_result (*ulapi_profile_op)(void *lock);
+
+/* adds a lock to the table when it is created, and removes it when
+   it is deleted */
+extern void ulapi_profile_add(const void *lock, ulapi_id key, int kind);
+extern void ulapi_profile_remove(const void *lock);
+
+/*
+  Takes a profiled lock:  tries it first, and if it is held, times
+  the blocking take. \a trytake may be NULL where the platform has no
+  non-blocking take, in which case a take that waited noticeably is
+  counted as contended. \a shared is nonzero for a reader's take,
+  which is not timed while held.
+*/
+extern ulapi_result ulapi_profile_take(void *lock, ulapi_profile_op trytake,
+				       ulapi_profile_op take, void *site, int shared);
+
+/* gives a profiled lock, ending the hold begun by its take */
+extern ulapi_result ulapi_profile_give(void *lock, ulapi_profile_op give, int shared);
+
+/* a hold that began (a successful trytake, or the mutex retaken when
+   a condition variable wakes) or ended (a condition variable wait)
+   outside ulapi_profile_take and ulapi_profile_give */
+extern void ulapi_profile_acquired(void *lock, void *site);
+extern void ulapi_profile_released(void *lock);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ULAPI_PROFILE_H */
@@ -23,13 +23,20 @@
 #include "config.h"
 #endif
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE		/* CPU_SET, sched_setaffinity */
+#endif
+
 #include "ulapi.h"		/* these decls */
+#include "ulapi_profile.h"	/* lock profiling hooks */
 #include <stddef.h>		/* NULL */
 #include <stdlib.h>		/* malloc */
+#include <limits.h>		/* PTHREAD_STACK_MIN */
 #include <string.h>		/* memset */
 #include <signal.h>		/* kill, SIGINT */
 #include <ctype.h>		/* isspace */
 #include <pthread.h>		/* pthread_create(), pthread_mutex_t */
+#include <sched.h>		/* sched_setaffinity() */
 #include <time.h>		/* struct timespec, nanosleep */
 #include <sys/time.h>		/* gettimeofday(), struct timeval */
 #include <sys/types.h>		/* struct stat */
@@ -37,17 +44,28 @@
 #include <unistd.h>		/* select(), write(), _exit() */
 #include <sys/ipc.h>		/* IPC_* */
 #include <sys/shm.h>		/* shmget() */
+#include <sys/mman.h>		/* mlockall() */
 #include <sys/sem.h>
 #include <errno.h>
 #include <fcntl.h>		/* O_RDONLY, O_NONBLOCK */
+#include <poll.h>		/* poll(), struct pollfd */
 #include <termios.h>  		/* tcflush, TCIOFLUSH */
 #include <sys/types.h>		/* fd_set, FD_ISSET() */
 #include <sys/wait.h>		/* waitpid */
 #include <sys/socket.h>		/* PF_INET, socket(), listen(), bind(), etc. */
 #include <netinet/in.h>		/* struct sockaddr_in */
+#include <netinet/tcp.h>	/* TCP_NODELAY */
+#include <sys/uio.h>		/* readv(), writev() */
 #include <netdb.h>		/* gethostbyname */
 #include <arpa/inet.h>		/* inet_addr */
 #include <sys/stat.h>		/* struct stat */
+#ifdef __linux__
+#include <linux/net_tstamp.h>	/* SOF_TIMESTAMPING_* */
+#include <sys/epoll.h>		/* epoll_create1(), epoll_wait() */
+#include <sys/eventfd.h>	/* eventfd() */
+#include <sys/syscall.h>	/* SYS_futex */
+#include <linux/futex.h>	/* FUTEX_WAIT, FUTEX_WAKE */
+#endif
 #ifndef NO_DL
 #include <dlfcn.h>
 #endif
@@ -127,6 +145,146 @@ void ulapi_sleep(ulapi_real secs)
   (void) nanosleep(&ts, NULL);
 }
 
+void ulapi_sleep_until(ulapi_real when)
+{
+  ulapi_real left;
+
+  /* ulapi_time's clock depends on the build, so sleep relative to it */
+  while ((left = when - ulapi_time()) > 0.0) {
+    ulapi_sleep(left);
+  }
+}
+
+#if defined(_POSIX_TIMERS) && (_POSIX_TIMERS > 0) && defined(CLOCK_MONOTONIC)
+#define PERIODIC_ABSOLUTE
+#endif
+
+typedef struct {
+  ulapi_real period;
+  ulapi_integer overruns;
+  ulapi_real worst;
+#ifdef PERIODIC_ABSOLUTE
+  struct timespec next;		/* on CLOCK_MONOTONIC */
+#else
+  ulapi_real next;		/* on the ulapi_time clock */
+#endif
+} periodic_struct;
+
+#ifdef PERIODIC_ABSOLUTE
+
+static ulapi_real periodic_seconds(const struct timespec *ts)
+{
+  return (ulapi_real) ts->tv_sec + (ulapi_real) ts->tv_nsec * 1.0e-9;
+}
+
+static void periodic_advance(struct timespec *ts, ulapi_real secs)
+{
+  long long nsec;
+
+  nsec = (long long) ts->tv_nsec + (long long) (secs * 1.0e9 + 0.5);
+  ts->tv_sec += (time_t) (nsec / 1000000000LL);
+  ts->tv_nsec = (long) (nsec % 1000000000LL);
+}
+
+static ulapi_real periodic_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return periodic_seconds(&ts);
+}
+
+#endif
+
+ulapi_result ulapi_periodic_reset(void *timer, ulapi_real period)
+{
+  periodic_struct *pt = (periodic_struct *) timer;
+
+  if (NULL == pt) return ULAPI_ERROR;
+
+  if (period > 0.0) pt->period = period;
+  pt->overruns = 0;
+  pt->worst = 0.0;
+#ifdef PERIODIC_ABSOLUTE
+  clock_gettime(CLOCK_MONOTONIC, &pt->next);
+  periodic_advance(&pt->next, pt->period);
+#else
+  pt->next = ulapi_time() + pt->period;
+#endif
+
+  return ULAPI_OK;
+}
+
+void *ulapi_periodic_new(ulapi_real period)
+{
+  periodic_struct *pt;
+
+  if (period <= 0.0) return NULL;
+
+  pt = (periodic_struct *) malloc(sizeof(periodic_struct));
+  if (NULL == pt) return NULL;
+  (void) ulapi_periodic_reset(pt, period);
+
+  return pt;
+}
+
+ulapi_result ulapi_periodic_delete(void *timer)
+{
+  if (NULL == timer) return ULAPI_ERROR;
+  free(timer);
+
+  return ULAPI_OK;
+}
+
+ulapi_integer ulapi_periodic_wait(void *timer)
+{
+  periodic_struct *pt = (periodic_struct *) timer;
+  ulapi_real now, late;
+  ulapi_integer missed = 0;
+
+  if (NULL == pt) return -1;
+
+#ifdef PERIODIC_ABSOLUTE
+  now = periodic_now();
+  late = now - periodic_seconds(&pt->next);
+  if (late < 0.0) {
+    while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &pt->next, NULL));
+    late = periodic_now() - periodic_seconds(&pt->next);
+    periodic_advance(&pt->next, pt->period);
+  } else {
+    missed = 1 + (ulapi_integer) (late / pt->period);
+    periodic_advance(&pt->next, missed * pt->period);
+  }
+#else
+  now = ulapi_time();
+  late = now - pt->next;
+  if (late < 0.0) {
+    ulapi_sleep_until(pt->next);
+    late = ulapi_time() - pt->next;
+    pt->next += pt->period;
+  } else {
+    missed = 1 + (ulapi_integer) (late / pt->period);
+    pt->next += missed * pt->period;
+  }
+#endif
+
+  pt->overruns += missed;
+  if (late > pt->worst) pt->worst = late;
+
+  return missed;
+}
+
+ulapi_integer ulapi_periodic_overruns(void *timer)
+{
+  return (NULL == timer ? 0 : ((periodic_struct *) timer)->overruns);
+}
+
+ulapi_real ulapi_periodic_worst(void *timer)
+{
+  return (NULL == timer ? 0.0 : ((periodic_struct *) timer)->worst);
+}
+
 static void quit(int sig)
 {
   return;
@@ -301,6 +459,108 @@ ulapi_task_start(ulapi_task_struct *task,
   return ULAPI_OK;
 }
 
+void ulapi_task_attr_init(ulapi_task_attr *attr)
+{
+  attr->policy = ULAPI_SCHED_NORMAL;
+  attr->priority = 0;
+  attr->cpu = -1;
+  attr->stack_size = 0;
+  attr->lock_memory = 0;
+}
+
+/* what the starting task needs to do before running the task code */
+typedef struct {
+  void (*taskcode)(void *);
+  void *taskarg;
+  ulapi_integer cpu;
+  size_t prefault;
+} task_launch;
+
+/* touches a span of the stack below the caller, so it is mapped now */
+static void task_prefault(size_t bytes)
+{
+  enum {CHUNK = 4096};
+  volatile char page[CHUNK];
+  size_t t;
+
+  for (t = 0; t < CHUNK; t += 64) page[t] = 0;
+  if (bytes > CHUNK) task_prefault(bytes - CHUNK);
+  /* used after the call, so the call cannot reuse this frame */
+  page[0] = page[CHUNK - 1];
+}
+
+static void *task_launcher(void *arg)
+{
+  task_launch launch = *((task_launch *) arg);
+
+  free(arg);
+  if (launch.cpu >= 0) (void) ulapi_self_set_affinity(launch.cpu);
+  if (launch.prefault > 0) task_prefault(launch.prefault);
+  launch.taskcode(launch.taskarg);
+
+  return NULL;
+}
+
+ulapi_result
+ulapi_task_start_attr(ulapi_task_struct *task,
+		      void (*taskcode)(void *),
+		      void *taskarg,
+		      const ulapi_task_attr *attr)
+{
+  pthread_attr_t pattr;
+  struct sched_param sched_param;
+  task_launch *launch;
+  ulapi_result result = ULAPI_OK;
+  int policy, lo, hi, retval;
+  size_t stack_size;
+
+  if (NULL == task || NULL == attr) return ULAPI_ERROR;
+
+  launch = (task_launch *) malloc(sizeof(task_launch));
+  if (NULL == launch) return ULAPI_ERROR;
+  launch->taskcode = taskcode;
+  launch->taskarg = taskarg;
+  launch->cpu = attr->cpu;
+  launch->prefault = 0;
+
+  if (attr->lock_memory && 0 != mlockall(MCL_CURRENT | MCL_FUTURE)) result = ULAPI_IMPL_ERROR;
+
+  pthread_attr_init(&pattr);
+  if (attr->stack_size > 0) {
+    stack_size = (size_t) attr->stack_size;
+    if (stack_size < PTHREAD_STACK_MIN) stack_size = PTHREAD_STACK_MIN;
+    pthread_attr_setstacksize(&pattr, stack_size);
+    /* leave the top of the stack for the launcher's own frames */
+    launch->prefault = (stack_size > 16384 ? stack_size - 16384 : 0);
+  }
+
+  policy = (ULAPI_SCHED_FIFO == attr->policy ? SCHED_FIFO : (ULAPI_SCHED_RR == attr->policy ? SCHED_RR : SCHED_OTHER));
+  if (SCHED_OTHER != policy) {
+    lo = sched_get_priority_min(policy);
+    hi = sched_get_priority_max(policy);
+    sched_param.sched_priority = attr->priority < lo ? lo : (attr->priority > hi ? hi : (int) attr->priority);
+    pthread_attr_setinheritsched(&pattr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&pattr, policy);
+    pthread_attr_setschedparam(&pattr, &sched_param);
+  }
+
+  retval = pthread_create((pthread_t *) task, &pattr, task_launcher, launch);
+  if (EPERM == retval && SCHED_OTHER != policy) {
+    /* not allowed a real-time policy, so run it normally */
+    pthread_attr_setinheritsched(&pattr, PTHREAD_INHERIT_SCHED);
+    retval = pthread_create((pthread_t *) task, &pattr, task_launcher, launch);
+    result = ULAPI_IMPL_ERROR;
+  }
+  pthread_attr_destroy(&pattr);
+
+  if (0 != retval) {
+    free(launch);
+    return ULAPI_ERROR;
+  }
+
+  return result;
+}
+
 ulapi_result ulapi_task_stop(ulapi_task_struct *task)
 {
   return (pthread_cancel(*((ulapi_task_struct *) task)) == 0 ? ULAPI_OK : ULAPI_ERROR);
@@ -326,6 +586,95 @@ ulapi_result ulapi_self_set_period(ulapi_integer period_nsec)
   return ULAPI_OK;
 }
 
+ulapi_result ulapi_self_set_affinity(ulapi_integer cpu)
+{
+#ifdef __linux__
+  cpu_set_t set;
+  ulapi_integer i, count;
+
+  count = ulapi_cpu_count();
+  if (cpu >= count) return ULAPI_ERROR;
+
+  CPU_ZERO(&set);
+  if (cpu >= 0) {
+    CPU_SET(cpu, &set);
+  } else {
+    for (i = 0; i < count; i++) CPU_SET(i, &set);
+  }
+
+  /* a pid of 0 applies to the calling thread only */
+  return (0 == sched_setaffinity(0, sizeof(set), &set) ? ULAPI_OK : ULAPI_ERROR);
+#else
+  return (cpu < 0 ? ULAPI_OK : ULAPI_ERROR);
+#endif
+}
+
+ulapi_integer ulapi_cpu_count(void)
+{
+  long count;
+
+  count = sysconf(_SC_NPROCESSORS_ONLN);
+
+  return (count > 0 ? (ulapi_integer) count : 1);
+}
+
+#ifdef __linux__
+/* reads the processors of NUMA node \a node into \a set */
+static int numa_node_cpus(ulapi_integer node, cpu_set_t *set)
+{
+  char path[64];
+  FILE *fp;
+  int first, last, n, any = 0;
+
+  CPU_ZERO(set);
+  ulapi_snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", (int) node);
+  if (NULL == (fp = fopen(path, "r"))) return 0;
+
+  /* a list of ranges, e.g., "0-7,16-23" */
+  while (1 == fscanf(fp, "%d", &first)) {
+    last = first;
+    if (1 == fscanf(fp, "-%d", &last) && last < first) last = first;
+    for (n = first; n <= last && n < CPU_SETSIZE; n++) {
+      CPU_SET(n, set);
+      any = 1;
+    }
+    if (',' != fgetc(fp)) break;
+  }
+  fclose(fp);
+
+  return any;
+}
+#endif
+
+ulapi_integer ulapi_numa_node_count(void)
+{
+#ifdef __linux__
+  cpu_set_t set;
+  ulapi_integer count;
+
+  /* nodes are numbered densely from 0 */
+  for (count = 0; numa_node_cpus(count, &set); count++);
+
+  return (count > 0 ? count : 1);
+#else
+  return 1;
+#endif
+}
+
+ulapi_result ulapi_self_set_node(ulapi_integer node)
+{
+#ifdef __linux__
+  cpu_set_t set;
+
+  if (node < 0) return ulapi_self_set_affinity(-1);
+  if (!numa_node_cpus(node, &set)) return ULAPI_ERROR;
+
+  return (0 == sched_setaffinity(0, sizeof(set), &set) ? ULAPI_OK : ULAPI_ERROR);
+#else
+  return (node <= 0 ? ULAPI_OK : ULAPI_ERROR);
+#endif
+}
+
 ulapi_result ulapi_wait(ulapi_integer period_nsec)
 {
   struct timespec ts;
@@ -350,14 +699,15 @@ void ulapi_task_exit(ulapi_integer retval)
 
 ulapi_result ulapi_task_join(ulapi_task_struct *task, ulapi_integer *retptr)
 {
-  ulapi_integer retval;
+  /* pthread_join stores a pointer, which is wider than an int ulapi_integer */
+  void *retval;
   int ret;
 
-  ret = pthread_join(*((ulapi_task_struct *) task), (void **) &retval);
+  ret = pthread_join(*((ulapi_task_struct *) task), &retval);
 
   if (0 == ret) {
     if (NULL != retptr) {
-      *retptr = retval;
+      *retptr = (ulapi_integer) (size_t) retval;
     }
     return ULAPI_OK;
   }
@@ -536,6 +886,7 @@ ulapi_result ulapi_mutex_init(ulapi_mutex_struct *mutex, ulapi_id key)
   /* initialize mutex to default attributes, and give it */
   if (0 == pthread_mutex_init(mutex, NULL)) {
     (void) pthread_mutex_unlock(mutex);
+    ulapi_profile_add(mutex, key, ULAPI_PROFILE_MUTEX);
     return ULAPI_OK;
   }
   return ULAPI_ERROR;
@@ -551,6 +902,7 @@ ulapi_mutex_struct *ulapi_mutex_new(ulapi_id key)
   /* initialize mutex to default attributes, and give it */
   if (0 == pthread_mutex_init(mutex, NULL)) {
     (void) pthread_mutex_unlock(mutex);
+    ulapi_profile_add(mutex, key, ULAPI_PROFILE_MUTEX);
     return mutex;
   }
   /* else got an error, so free the mutex and return null */
@@ -561,6 +913,7 @@ ulapi_mutex_struct *ulapi_mutex_new(ulapi_id key)
 
 ulapi_result ulapi_mutex_clear(ulapi_mutex_struct *mutex)
 {
+  ulapi_profile_remove(mutex);
   (void) pthread_mutex_destroy((pthread_mutex_t *) mutex);
 
   return ULAPI_OK;
@@ -570,618 +923,2000 @@ ulapi_result ulapi_mutex_delete(ulapi_mutex_struct *mutex)
 {
   if (NULL == mutex) return ULAPI_ERROR;
 
+  ulapi_profile_remove(mutex);
   (void) pthread_mutex_destroy((pthread_mutex_t *) mutex);
   free(mutex);
 
   return ULAPI_OK;
 }
 
-ulapi_result ulapi_mutex_give(ulapi_mutex_struct *mutex)
+static ulapi_result mutex_give(void *mutex)
 {
   return (0 == pthread_mutex_unlock((pthread_mutex_t *) mutex) ? ULAPI_OK : ULAPI_ERROR);
 }
 
-ulapi_result ulapi_mutex_take(ulapi_mutex_struct *mutex)
+static ulapi_result mutex_take(void *mutex)
 {
   return (0 == pthread_mutex_lock((pthread_mutex_t *) mutex) ? ULAPI_OK : ULAPI_ERROR);
 }
 
-#define SEM_TAKE (-1)		/* decrement sembuf.sem_op */
-#define SEM_GIVE (1)		/* increment sembuf.sem_op */
-
-/* destroy binary semaphore */
-static void semdestroy(int semid)
+static ulapi_result mutex_trytake(void *mutex)
 {
-  (void) semctl(semid, 0, IPC_RMID);
-  return;
+  return (0 == pthread_mutex_trylock((pthread_mutex_t *) mutex) ? ULAPI_OK : ULAPI_ERROR);
 }
 
-/* create binary semaphore, initially given, returning the id */
-static int semcreate(int key)
+ulapi_result ulapi_mutex_give(ulapi_mutex_struct *mutex)
 {
-  int semid;			/* semaphore id returned */
-  int semflg;			/* flag for perms, create, etc. */
-  struct sembuf sops;
-  
-  semflg = 0664;		/* permissions */
-  /* leave IPC_CREAT and IPC_EXCL out, we want to see if it's there
-     and delete it if so with the semid returned */
+  if (ulapi_profile_on) return ulapi_profile_give(mutex, mutex_give, 0);
 
-  semid = semget((key_t) key, 1, semflg);
-  if (-1 == semid) {
-    if (errno != ENOENT) {
-      /* some other error */
-      return -1;
-    }
-    /* else it just wasn't there, which is what we expected */
-  } else {
-    /* it's already there, so return it */
-    return semid;
-  }
+  return mutex_give(mutex);
+}
 
-  semflg |= IPC_CREAT;		/* create it afresh */
-  if ((semid = semget((key_t) key, 1, semflg)) == -1) {
-    return -1;
-  }
-  /* initialize it to the given state */
-  sops.sem_num = 0;
-  sops.sem_flg = 0;		/* default is wait for it */
-  sops.sem_op = SEM_GIVE;
-  if (semop(semid, &sops, 1) == -1) {
-    return -1;
-  }
+ulapi_result ulapi_mutex_take(ulapi_mutex_struct *mutex)
+{
+  if (ulapi_profile_on) return ulapi_profile_take(mutex, mutex_trytake, mutex_take, ULAPI_PROFILE_CALLER(), 0);
 
-  return semid;
+  return mutex_take(mutex);
 }
 
-/* take a binary semaphore */
-static int semtake(int semid)
+/* times a task tries a held fast lock before sleeping */
+#define FASTLOCK_SPIN 100
+
+static void cpu_relax(void)
 {
-  struct sembuf sops;
+#if defined(__i386__) || defined(__x86_64__)
+  __asm__ __volatile__("pause" ::: "memory");
+#else
+  __asm__ __volatile__("" ::: "memory");
+#endif
+}
 
-  sops.sem_num = 0;		/* only one semaphore in set */
-  sops.sem_flg = 0;		/* wait indefinitely */
-  sops.sem_op = SEM_TAKE;
+#ifdef __linux__
 
-  return semop(semid, &sops, 1);
+/*
+  The lock word is 0 when free, 1 when held, and 2 when held with
+  tasks (possibly) sleeping on it, so that giving an uncontended lock
+  needs no system call.
+*/
+typedef struct {
+  int state;
+} fastlock_struct;
+
+static int fastlock_cas(int *state, int expected, int desired)
+{
+  (void) __atomic_compare_exchange_n(state, &expected, desired, 0,
+				     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+  return expected;
 }
 
-/* give a binary semaphore */
-static int semgive(int semid)
+static void *fastlock_new(void)
 {
-  struct sembuf sops;
+  fastlock_struct *lock;
 
-  sops.sem_num = 0;		/* only one semaphore in set */
-  sops.sem_flg = 0;		/* wait indefinitely */
-  sops.sem_op = SEM_GIVE;
+  lock = (fastlock_struct *) malloc(sizeof(fastlock_struct));
+  if (NULL == lock) return NULL;
+  lock->state = 0;
 
-  if (semctl(semid, 0, GETVAL) == 1) {
-    /* it's given-- leave it alone */
-    return 0;
-  }
-  /* it's taken-- suppose now others take it again before
-     we give it? they block, and this semgive will release
-     one of them */
-  return semop(semid, &sops, 1);
+  return lock;
 }
 
-void * ulapi_sem_new(ulapi_id key)
+static ulapi_result fastlock_delete(void *lock)
 {
-  int * id;
+  if (NULL == lock) return ULAPI_ERROR;
+  free(lock);
 
-  id = (int *) malloc(sizeof(int));
-  if (NULL == (void *) id) return NULL;
+  return ULAPI_OK;
+}
 
-  *id = semcreate((key_t) key);
+static ulapi_result fastlock_take(void *lock)
+{
+  fastlock_struct *fl = (fastlock_struct *) lock;
+  int spin;
 
-  if (*id == -1) {
-    free(id);
-    return NULL;
+  if (NULL == fl) return ULAPI_ERROR;
+
+  if (0 == fastlock_cas(&fl->state, 0, 1)) return ULAPI_OK;
+
+  for (spin = 0; spin < FASTLOCK_SPIN; spin++) {
+    cpu_relax();
+    if (0 == __atomic_load_n(&fl->state, __ATOMIC_RELAXED) &&
+	0 == fastlock_cas(&fl->state, 0, 1)) return ULAPI_OK;
   }
-  
-  return (void *) id;
-}
 
-ulapi_result ulapi_sem_delete(void * sem)
-{
-  if (NULL != sem) {
-    semdestroy(*((int *) sem));
-    free(sem);
-    return ULAPI_OK;
+  /* mark it contended, and sleep until it is given */
+  while (0 != __atomic_exchange_n(&fl->state, 2, __ATOMIC_ACQUIRE)) {
+    (void) syscall(SYS_futex, &fl->state, FUTEX_WAIT_PRIVATE, 2, NULL, NULL, 0);
   }
 
-  return ULAPI_ERROR;
+  return ULAPI_OK;
 }
 
-ulapi_result ulapi_sem_give(void * sem)
+static ulapi_result fastlock_trytake(void *lock)
 {
-  return semgive(*((int *) sem)) == 0 ? ULAPI_OK : ULAPI_ERROR;
-}
+  fastlock_struct *fl = (fastlock_struct *) lock;
 
-ulapi_result ulapi_sem_take(void * sem)
-{
-  return semtake(*((int *) sem)) == 0 ? ULAPI_OK : ULAPI_ERROR;
+  if (NULL == fl) return ULAPI_ERROR;
+
+  return (0 == fastlock_cas(&fl->state, 0, 1) ? ULAPI_OK : ULAPI_ERROR);
 }
 
-void * ulapi_cond_new(ulapi_id key)
+static ulapi_result fastlock_give(void *lock)
 {
-  pthread_cond_t * cond;
+  fastlock_struct *fl = (fastlock_struct *) lock;
 
-  cond = (pthread_cond_t *) malloc(sizeof(pthread_cond_t));
-  if (NULL == (void *) cond) return NULL;
+  if (NULL == fl) return ULAPI_ERROR;
 
-  if (0 == pthread_cond_init(cond, NULL)) {
-    return (void *) cond;
+  if (1 != __atomic_fetch_sub(&fl->state, 1, __ATOMIC_RELEASE)) {
+    /* someone may be asleep on it */
+    __atomic_store_n(&fl->state, 0, __ATOMIC_RELEASE);
+    (void) syscall(SYS_futex, &fl->state, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
   }
-  /* else got an error, so free the condition variable and return null */
 
-  free(cond);
-  return NULL;
+  return ULAPI_OK;
 }
 
-ulapi_result ulapi_cond_delete(void * cond)
+#else
+
+static void *fastlock_new(void)
 {
-  if (NULL == (void *) cond) return ULAPI_ERROR;
+  pthread_mutex_t *lock;
 
-  (void) pthread_cond_destroy((pthread_cond_t *) cond);
-  free(cond);
+  lock = (pthread_mutex_t *) malloc(sizeof(pthread_mutex_t));
+  if (NULL == lock) return NULL;
 
-  return ULAPI_OK;
+  if (0 == pthread_mutex_init(lock, NULL)) return lock;
+
+  free(lock);
+  return NULL;
 }
 
-ulapi_result ulapi_cond_signal(void * cond)
+static ulapi_result fastlock_delete(void *lock)
 {
-  return (0 == pthread_cond_signal((pthread_cond_t *) cond) ? ULAPI_OK : ULAPI_ERROR);
+  if (NULL == lock) return ULAPI_ERROR;
+
+  (void) pthread_mutex_destroy((pthread_mutex_t *) lock);
+  free(lock);
+
+  return ULAPI_OK;
 }
 
-ulapi_result ulapi_cond_broadcast(void * cond)
+static ulapi_result fastlock_take(void *lock)
 {
-  return (0 == pthread_cond_broadcast((pthread_cond_t *) cond) ? ULAPI_OK : ULAPI_ERROR);
+  int spin;
+
+  if (NULL == lock) return ULAPI_ERROR;
+
+  for (spin = 0; spin < FASTLOCK_SPIN; spin++) {
+    if (0 == pthread_mutex_trylock((pthread_mutex_t *) lock)) return ULAPI_OK;
+    cpu_relax();
+  }
+
+  return (0 == pthread_mutex_lock((pthread_mutex_t *) lock) ? ULAPI_OK : ULAPI_ERROR);
 }
 
-ulapi_result ulapi_cond_wait(void * cond, void * mutex)
+static ulapi_result fastlock_trytake(void *lock)
 {
-  return (0 == pthread_cond_wait((pthread_cond_t *) cond, (pthread_mutex_t *) mutex) ? ULAPI_OK : ULAPI_ERROR);
-}
+  if (NULL == lock) return ULAPI_ERROR;
 
-typedef struct {
-  ulapi_id key;
-  ulapi_integer size;
-  ulapi_id id;
-  void * addr;
-} shm_struct;
+  return (0 == pthread_mutex_trylock((pthread_mutex_t *) lock) ? ULAPI_OK : ULAPI_ERROR);
+}
 
-void * ulapi_shm_new(ulapi_id key, ulapi_integer size)
+static ulapi_result fastlock_give(void *lock)
 {
-  shm_struct * shm;
+  if (NULL == lock) return ULAPI_ERROR;
 
-  shm = malloc(sizeof(shm_struct));
-  if (NULL == (void *) shm) return NULL;
+  return (0 == pthread_mutex_unlock((pthread_mutex_t *) lock) ? ULAPI_OK : ULAPI_ERROR);
+}
 
-  shm->id = shmget((key_t) key, (int) size, IPC_CREAT | 0666);
-  if (-1 == shm->id) {
-    perror("shmget");
-    free(shm);
-    return NULL;
-  }
+#endif
 
-  shm->addr = shmat(shm->id, NULL, 0);
-  if ((void *) -1 == shm->addr) {
-    perror("shmat");
-    free(shm);
-    return NULL;
-  }
+void *ulapi_fastlock_new(void)
+{
+  void *lock;
 
-  return (void *) shm;
+  lock = fastlock_new();
+  ulapi_profile_add(lock, 0, ULAPI_PROFILE_FASTLOCK);
+
+  return lock;
 }
 
-void * ulapi_shm_addr(void * shm)
+ulapi_result ulapi_fastlock_delete(void *lock)
 {
-  return ((shm_struct *) shm)->addr;
+  ulapi_profile_remove(lock);
+
+  return fastlock_delete(lock);
 }
 
-ulapi_result ulapi_shm_delete(void * shm)
+ulapi_result ulapi_fastlock_take(void *lock)
 {
-  struct shmid_ds d;
-  int r1, r2;
+  if (ulapi_profile_on && NULL != lock) {
+    return ulapi_profile_take(lock, fastlock_trytake, fastlock_take, ULAPI_PROFILE_CALLER(), 0);
+  }
 
-  if (NULL == shm) return ULAPI_OK;
+  return fastlock_take(lock);
+}
 
-  r1 = shmdt(((shm_struct *) shm)->addr);
-  r2 = shmctl(IPC_RMID, ((shm_struct *) shm)->id, &d);
+ulapi_result ulapi_fastlock_trytake(void *lock)
+{
+  ulapi_result retval;
 
-  free(shm);
+  retval = fastlock_trytake(lock);
+  if (ulapi_profile_on && ULAPI_OK == retval) ulapi_profile_acquired(lock, ULAPI_PROFILE_CALLER());
 
-  return (r1 || r2 ? ULAPI_ERROR : ULAPI_OK);
+  return retval;
 }
 
-#ifdef HAVE_RTAI
+ulapi_result ulapi_fastlock_give(void *lock)
+{
+  if (ulapi_profile_on && NULL != lock) return ulapi_profile_give(lock, fastlock_give, 0);
 
-typedef struct {
-  ulapi_id key;
-  void * addr;
-} rtm_struct;
+  return fastlock_give(lock);
+}
 
-void *ulapi_rtm_new(ulapi_id key, ulapi_integer size)
+void *ulapi_rwlock_new(void)
 {
-  rtm_struct * shm;
+  pthread_rwlock_t *lock;
+  pthread_rwlockattr_t attr;
+  int retval;
 
-  shm = (rtm_struct *) malloc(sizeof(rtm_struct));
-  if (NULL == (void *) shm) return NULL;
+  lock = (pthread_rwlock_t *) malloc(sizeof(pthread_rwlock_t));
+  if (NULL == lock) return NULL;
 
-  shm->addr = rt_shm_alloc(key, size, USE_GFP_KERNEL);
-  if (NULL == shm->addr) {
-    free(shm);
+  if (0 != pthread_rwlockattr_init(&attr)) {
+    free(lock);
     return NULL;
   }
+#ifdef __GLIBC__
+  /* glibc prefers readers unless told otherwise */
+  (void) pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+  retval = pthread_rwlock_init(lock, &attr);
+  (void) pthread_rwlockattr_destroy(&attr);
+
+  if (0 == retval) {
+    ulapi_profile_add(lock, 0, ULAPI_PROFILE_RWLOCK);
+    return lock;
+  }
 
-  shm->key = key;
-  return shm;
+  free(lock);
+  return NULL;
 }
 
-void *ulapi_rtm_addr(void * shm)
+ulapi_result ulapi_rwlock_delete(void *lock)
 {
-  return ((rtm_struct *) shm)->addr;
-}
+  if (NULL == lock) return ULAPI_ERROR;
 
-ulapi_result ulapi_rtm_delete(void * shm)
-{
-  if (NULL != shm) {
-    if (NULL != ((rtm_struct *) shm)->addr) {
-      rt_shm_free(((rtm_struct *) shm)->key);
-    }
-    free(shm);
-  }
+  ulapi_profile_remove(lock);
+  (void) pthread_rwlock_destroy((pthread_rwlock_t *) lock);
+  free(lock);
 
   return ULAPI_OK;
 }
 
-#else
-
-/*
-  If we don't have RTAI, just use normal shm. The RT side that
-  simualates realtime will do the same.
-*/
+static ulapi_result rwlock_read_take(void *lock)
+{
+  return (0 == pthread_rwlock_rdlock((pthread_rwlock_t *) lock) ? ULAPI_OK : ULAPI_ERROR);
+}
 
-void *ulapi_rtm_new(ulapi_id key, ulapi_integer size)
+static ulapi_result rwlock_read_trytake(void *lock)
 {
-  return ulapi_shm_new(key, size);
+  return (0 == pthread_rwlock_tryrdlock((pthread_rwlock_t *) lock) ? ULAPI_OK : ULAPI_ERROR);
 }
 
-void *ulapi_rtm_addr(void * shm)
+static ulapi_result rwlock_write_take(void *lock)
 {
-  return ulapi_shm_addr(shm);
+  return (0 == pthread_rwlock_wrlock((pthread_rwlock_t *) lock) ? ULAPI_OK : ULAPI_ERROR);
 }
 
-ulapi_result ulapi_rtm_delete(void * shm)
+static ulapi_result rwlock_write_trytake(void *lock)
 {
-  return ulapi_shm_delete(shm);
+  return (0 == pthread_rwlock_trywrlock((pthread_rwlock_t *) lock) ? ULAPI_OK : ULAPI_ERROR);
 }
 
-#endif	/* HAVE_RTAI */
+static ulapi_result rwlock_give(void *lock)
+{
+  return (0 == pthread_rwlock_unlock((pthread_rwlock_t *) lock) ? ULAPI_OK : ULAPI_ERROR);
+}
 
-ulapi_integer
-ulapi_socket_get_client_id(ulapi_integer port, const char *hostname)
+ulapi_result ulapi_rwlock_read_take(void *lock)
 {
-  int socket_fd;
-  struct sockaddr_in server_addr;
-  struct hostent *ent;
-  struct in_addr *in_a;
+  if (NULL == lock) return ULAPI_ERROR;
 
-  if (NULL == (ent = gethostbyname(hostname))) {
-    PERROR("gethostbyname");
-    return -1;
+  if (ulapi_profile_on) {
+    return ulapi_profile_take(lock, rwlock_read_trytake, rwlock_read_take, ULAPI_PROFILE_CALLER(), 1);
   }
-  in_a = (struct in_addr *) ent->h_addr_list[0];
 
-  memset(&server_addr, 0, sizeof(struct sockaddr_in));
-  server_addr.sin_family = PF_INET;
-  server_addr.sin_addr.s_addr = in_a->s_addr;
-  server_addr.sin_port = htons(port);
+  return rwlock_read_take(lock);
+}
 
-  if (-1 == (socket_fd = socket(PF_INET, SOCK_STREAM, 0))) {
-    PERROR("socket");
-    return -1;
-  }
+ulapi_result ulapi_rwlock_read_give(void *lock)
+{
+  if (NULL == lock) return ULAPI_ERROR;
 
-  if (-1 == connect(socket_fd, 
-		    (struct sockaddr *) &server_addr,
-		    sizeof(struct sockaddr_in))) {
-    PERROR("connect");
-    close(socket_fd);
-    return -1;
+  return (0 == pthread_rwlock_unlock((pthread_rwlock_t *) lock) ? ULAPI_OK : ULAPI_ERROR);
+}
+
+ulapi_result ulapi_rwlock_write_take(void *lock)
+{
+  if (NULL == lock) return ULAPI_ERROR;
+
+  if (ulapi_profile_on) {
+    return ulapi_profile_take(lock, rwlock_write_trytake, rwlock_write_take, ULAPI_PROFILE_CALLER(), 0);
   }
 
-  return socket_fd;
+  return rwlock_write_take(lock);
 }
 
-ulapi_integer
-ulapi_socket_get_server_id_on_interface(ulapi_integer port, const char *intf)
+ulapi_result ulapi_rwlock_write_give(void *lock)
 {
-  int socket_fd;
-  struct sockaddr_in myaddr;
-  int on;
-  struct linger mylinger = { 0 };
-  enum {BACKLOG = 5};
+  if (NULL == lock) return ULAPI_ERROR;
 
-  if (-1 == (socket_fd = socket(PF_INET, SOCK_STREAM, 0))) {
-    PERROR("socket");
-    return -1;
-  }
+  if (ulapi_profile_on) return ulapi_profile_give(lock, rwlock_give, 0);
 
-  /*
-    Turn off bind address checking, and allow
-    port numbers to be reused - otherwise the
-    TIME_WAIT phenomenon will prevent binding
-    to these address.port combinations for
-    (2 * MSL) seconds.
-  */
-  on = 1;
-  if (-1 == 
-      setsockopt(socket_fd,
-		 SOL_SOCKET,
-		 SO_REUSEADDR,
-		 (const char *) &on,
-		 sizeof(on))) {
-    PERROR("setsockopt");
-    close(socket_fd);
-    return -1;
-  }
+  return rwlock_give(lock);
+}
 
-  /*
-    When connection is closed, there is a need
-    to linger to ensure all data is transmitted.
-  */
-  mylinger.l_onoff = 1;
-  mylinger.l_linger = 30;
-  if (-1 ==
-      setsockopt(socket_fd,
-		 SOL_SOCKET,
-		 SO_LINGER,
-		 (const char *) &mylinger,
-		 sizeof(struct linger))) {
-    PERROR("setsockopt");
-    close(socket_fd);
-    return -1;
-  }
+/*
+  Lock-free queues. The producer end (tail) and the consumer end
+  (head) are on separate cache lines, each with a cached copy of the
+  other end so that a side only reads the other's line when the queue
+  looks full or empty. Slots of a multi-producer queue begin with a
+  sequence number (Vyukov's bounded queue): producers claim a slot by
+  advancing the tail, and publish it by storing its sequence, so a
+  consumer never sees a slot that is still being copied. The waiting
+  word is set by a consumer about to sleep and cleared, with a wakeup,
+  by the first push that sees it.
+*/
+#define QUEUE_LINE 64
 
-  memset(&myaddr, 0, sizeof(struct sockaddr_in));
-  myaddr.sin_family = PF_INET;
-  if (NULL == intf) {
-    myaddr.sin_addr.s_addr = htonl(INADDR_ANY);
-  } else {
-    myaddr.sin_addr.s_addr = inet_addr(intf);
+typedef struct {
+  unsigned long tail;
+  unsigned long head_seen;
+  char pad1[QUEUE_LINE - 2 * sizeof(unsigned long)];
+  unsigned long head;
+  unsigned long tail_seen;
+  char pad2[QUEUE_LINE - 2 * sizeof(unsigned long)];
+  int waiting;
+  int multi;
+  unsigned long mask;
+  unsigned long size;
+  unsigned long stride;
+  unsigned char *slots;
+  ulapi_result (*notify)(void *);
+  void *arg;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+} queue_struct;
+
+#define QUEUE_SLOT(q, pos) ((q)->slots + ((pos) & (q)->mask) * (q)->stride)
+#define QUEUE_SEQ(slot) ((unsigned long *) (slot))
+
+static void *queue_new(ulapi_integer slots, ulapi_integer size, int multi)
+{
+  queue_struct *q;
+  void *mem;
+  unsigned long n, i;
+
+  if (slots < 1 || size < 1 || slots > (1L << 30)) return NULL;
+  for (n = 1; n < (unsigned long) slots; n <<= 1);
+
+  if (0 != posix_memalign(&mem, QUEUE_LINE, sizeof(queue_struct))) return NULL;
+  q = (queue_struct *) mem;
+  memset(q, 0, sizeof(queue_struct));
+  q->multi = multi;
+  q->mask = n - 1;
+  q->size = (unsigned long) size;
+  /* keep each slot's sequence number aligned */
+  q->stride = (q->size + sizeof(unsigned long) - 1) & ~(sizeof(unsigned long) - 1);
+  if (multi) q->stride += sizeof(unsigned long);
+
+  if (0 != posix_memalign(&mem, QUEUE_LINE, n * q->stride)) {
+    free(q);
+    return NULL;
   }
-  myaddr.sin_port = htons(port);
-
-  if (-1 == bind(socket_fd, (struct sockaddr *) &myaddr,
-		 sizeof(struct sockaddr_in))) {
-    PERROR("bind");
-    close(socket_fd);
-    return -1;
+  q->slots = (unsigned char *) mem;
+  if (multi) {
+    for (i = 0; i < n; i++) *QUEUE_SEQ(QUEUE_SLOT(q, i)) = i;
   }
+  pthread_mutex_init(&q->mutex, NULL);
+  pthread_cond_init(&q->cond, NULL);
 
-  if (-1 == listen(socket_fd, BACKLOG)) {
-    PERROR("listen");
-    close(socket_fd);
-    return -1;
-  }
+  return (void *) q;
+}
 
-  return socket_fd;
+void *ulapi_spsc_new(ulapi_integer slots, ulapi_integer size)
+{
+  return queue_new(slots, size, 0);
 }
 
-ulapi_integer
-ulapi_socket_get_server_id(ulapi_integer port)
+void *ulapi_mpsc_new(ulapi_integer slots, ulapi_integer size)
 {
-  return ulapi_socket_get_server_id_on_interface(port, NULL);
+  return queue_new(slots, size, 1);
 }
 
-ulapi_integer
-ulapi_socket_get_connection_id(ulapi_integer socket_fd)
+ulapi_result ulapi_queue_delete(void *queue)
 {
-  fd_set rfds;
-  struct sockaddr_in client_addr;
-  unsigned int client_len;
-  int client_fd;
-  int retval;
+  queue_struct *q = (queue_struct *) queue;
 
-  do {
-    FD_ZERO(&rfds);
-    FD_SET(socket_fd, &rfds);
-    retval = select(socket_fd + 1, &rfds, NULL, NULL, NULL);
-  } while (0 == retval ||
-	   ! FD_ISSET(socket_fd, &rfds));
+  if (NULL == q) return ULAPI_ERROR;
 
-  if (retval == -1) {
-    PERROR("select");
-    return -1;
-  }
+  pthread_cond_destroy(&q->cond);
+  pthread_mutex_destroy(&q->mutex);
+  free(q->slots);
+  free(q);
 
-  memset(&client_addr, 0, sizeof(struct sockaddr_in));
-  client_len = sizeof(struct sockaddr_in);
-  client_fd = 
-    accept(socket_fd,
-	   (struct sockaddr *) &client_addr, 
-	   &client_len);
-  if (-1 == client_fd) {
-    PERROR("accept");
-    return -1;
-  }
-  
-  return client_fd;
+  return ULAPI_OK;
 }
 
-ulapi_integer
-ulapi_socket_get_broadcaster_id_on_interface(ulapi_integer port, const char *intf)
+/* wake a consumer that armed the queue before this push */
+static void queue_wake(queue_struct *q)
 {
-  struct sockaddr_in addr;
-  int fd;
-  int perm;
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (0 == __atomic_load_n(&q->waiting, __ATOMIC_RELAXED)) return;
+  if (0 == __atomic_exchange_n(&q->waiting, 0, __ATOMIC_ACQ_REL)) return;
 
-  fd = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
-  if (0 > fd) {
-    return -1;
+  if (NULL != q->notify) (void) q->notify(q->arg);
+  pthread_mutex_lock(&q->mutex);
+  pthread_cond_signal(&q->cond);
+  pthread_mutex_unlock(&q->mutex);
+}
+
+ulapi_result ulapi_queue_push(void *queue, const void *item)
+{
+  queue_struct *q = (queue_struct *) queue;
+  unsigned char *slot;
+  unsigned long pos, seq;
+  long dif;
+
+  if (NULL == q || NULL == item) return ULAPI_ERROR;
+
+  if (!q->multi) {
+    pos = q->tail;
+    if (pos - q->head_seen > q->mask) {
+      q->head_seen = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+      if (pos - q->head_seen > q->mask) return ULAPI_ERROR;
+    }
+    memcpy(QUEUE_SLOT(q, pos), item, q->size);
+    __atomic_store_n(&q->tail, pos + 1, __ATOMIC_RELEASE);
+  } else {
+    pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+    for (;;) {
+      slot = QUEUE_SLOT(q, pos);
+      seq = __atomic_load_n(QUEUE_SEQ(slot), __ATOMIC_ACQUIRE);
+      dif = (long) (seq - pos);
+      if (0 == dif) {
+	if (__atomic_compare_exchange_n(&q->tail, &pos, pos + 1, 1,
+					__ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+      } else if (dif < 0) {
+	/* the consumer has not freed this slot from the last lap */
+	return ULAPI_ERROR;
+      } else {
+	pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+      }
+    }
+    memcpy(slot + sizeof(unsigned long), item, q->size);
+    __atomic_store_n(QUEUE_SEQ(slot), pos + 1, __ATOMIC_RELEASE);
+  }
+
+  queue_wake(q);
+
+  return ULAPI_OK;
+}
+
+/* whether an item is ready for the consumer */
+static int queue_ready(queue_struct *q)
+{
+  if (!q->multi) {
+    return q->head != __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+  }
+  return __atomic_load_n(QUEUE_SEQ(QUEUE_SLOT(q, q->head)), __ATOMIC_ACQUIRE) == q->head + 1;
+}
+
+ulapi_result ulapi_queue_pop(void *queue, void *item)
+{
+  queue_struct *q = (queue_struct *) queue;
+  unsigned char *slot;
+  unsigned long pos;
+
+  if (NULL == q || NULL == item) return ULAPI_ERROR;
+
+  pos = q->head;
+  slot = QUEUE_SLOT(q, pos);
+  if (!q->multi) {
+    if (pos == q->tail_seen) {
+      q->tail_seen = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+      if (pos == q->tail_seen) return ULAPI_ERROR;
+    }
+    memcpy(item, slot, q->size);
+  } else {
+    if (__atomic_load_n(QUEUE_SEQ(slot), __ATOMIC_ACQUIRE) != pos + 1) return ULAPI_ERROR;
+    memcpy(item, slot + sizeof(unsigned long), q->size);
+    /* free the slot for the producer one lap ahead */
+    __atomic_store_n(QUEUE_SEQ(slot), pos + q->mask + 1, __ATOMIC_RELEASE);
+  }
+  __atomic_store_n(&q->head, pos + 1, __ATOMIC_RELEASE);
+
+  return ULAPI_OK;
+}
+
+ulapi_result ulapi_queue_arm(void *queue)
+{
+  queue_struct *q = (queue_struct *) queue;
+
+  if (NULL == q) return ULAPI_ERROR;
+
+  /* pairs with the fence in queue_wake:  either the producer sees the
+     flag, or this sees the item */
+  __atomic_store_n(&q->waiting, 1, __ATOMIC_SEQ_CST);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (queue_ready(q)) {
+    __atomic_store_n(&q->waiting, 0, __ATOMIC_RELEASE);
+    return ULAPI_ERROR;
+  }
+
+  return ULAPI_OK;
+}
+
+ulapi_result ulapi_queue_pop_wait(void *queue, void *item, ulapi_real secs)
+{
+  queue_struct *q = (queue_struct *) queue;
+  struct timeval tv;
+  struct timespec ts;
+  long nsec;
+  int expired = 0;
+
+  if (NULL == q || NULL == item) return ULAPI_ERROR;
+
+  if (secs >= 0.0) {
+    gettimeofday(&tv, NULL);
+    ts.tv_sec = tv.tv_sec + (time_t) secs;
+    nsec = tv.tv_usec * 1000L + (long) ((secs - (time_t) secs) * 1.0e9);
+    ts.tv_sec += nsec / 1000000000L;
+    ts.tv_nsec = nsec % 1000000000L;
+  }
+
+  while (ULAPI_OK != ulapi_queue_pop(q, item)) {
+    if (expired) return ULAPI_ERROR;
+    if (ULAPI_OK != ulapi_queue_arm(q)) continue;
+
+    pthread_mutex_lock(&q->mutex);
+    while (__atomic_load_n(&q->waiting, __ATOMIC_ACQUIRE)) {
+      if (secs < 0.0) {
+	pthread_cond_wait(&q->cond, &q->mutex);
+      } else if (0 != pthread_cond_timedwait(&q->cond, &q->mutex, &ts)) {
+	/* disarm, unless a push has just claimed the wakeup */
+	__atomic_store_n(&q->waiting, 0, __ATOMIC_RELEASE);
+	expired = 1;
+	break;
+      }
+    }
+    pthread_mutex_unlock(&q->mutex);
+  }
+
+  return ULAPI_OK;
+}
+
+ulapi_integer ulapi_queue_count(void *queue)
+{
+  queue_struct *q = (queue_struct *) queue;
+  unsigned long tail, head;
+
+  if (NULL == q) return 0;
+
+  head = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+  tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+
+  /* a multi-producer tail counts slots claimed but not yet filled */
+  return (ulapi_integer) (tail - head > q->mask + 1 ? 0 : tail - head);
+}
+
+ulapi_result ulapi_queue_set_notify(void *queue, ulapi_result (*notify)(void *), void *arg)
+{
+  queue_struct *q = (queue_struct *) queue;
+
+  if (NULL == q) return ULAPI_ERROR;
+
+  q->arg = arg;
+  q->notify = notify;
+
+  return ULAPI_OK;
+}
+
+#define SEM_TAKE (-1)		/* decrement sembuf.sem_op */
+#define SEM_GIVE (1)		/* increment sembuf.sem_op */
+
+/* destroy binary semaphore */
+static void semdestroy(int semid)
+{
+  (void) semctl(semid, 0, IPC_RMID);
+  return;
+}
+
+/* create binary semaphore, initially given, returning the id */
+static int semcreate(int key)
+{
+  int semid;			/* semaphore id returned */
+  int semflg;			/* flag for perms, create, etc. */
+  struct sembuf sops;
+  
+  semflg = 0664;		/* permissions */
+  /* leave IPC_CREAT and IPC_EXCL out, we want to see if it's there
+     and delete it if so with the semid returned */
+
+  semid = semget((key_t) key, 1, semflg);
+  if (-1 == semid) {
+    if (errno != ENOENT) {
+      /* some other error */
+      return -1;
+    }
+    /* else it just wasn't there, which is what we expected */
+  } else {
+    /* it's already there, so return it */
+    return semid;
+  }
+
+  semflg |= IPC_CREAT;		/* create it afresh */
+  if ((semid = semget((key_t) key, 1, semflg)) == -1) {
+    return -1;
+  }
+  /* initialize it to the given state */
+  sops.sem_num = 0;
+  sops.sem_flg = 0;		/* default is wait for it */
+  sops.sem_op = SEM_GIVE;
+  if (semop(semid, &sops, 1) == -1) {
+    return -1;
+  }
+
+  return semid;
+}
+
+/* take a binary semaphore */
+static int semtake(int semid)
+{
+  struct sembuf sops;
+
+  sops.sem_num = 0;		/* only one semaphore in set */
+  sops.sem_flg = 0;		/* wait indefinitely */
+  sops.sem_op = SEM_TAKE;
+
+  return semop(semid, &sops, 1);
+}
+
+/* give a binary semaphore */
+static int semgive(int semid)
+{
+  struct sembuf sops;
+
+  sops.sem_num = 0;		/* only one semaphore in set */
+  sops.sem_flg = 0;		/* wait indefinitely */
+  sops.sem_op = SEM_GIVE;
+
+  if (semctl(semid, 0, GETVAL) == 1) {
+    /* it's given-- leave it alone */
+    return 0;
+  }
+  /* it's taken-- suppose now others take it again before
+     we give it? they block, and this semgive will release
+     one of them */
+  return semop(semid, &sops, 1);
+}
+
+void * ulapi_sem_new(ulapi_id key)
+{
+  int * id;
+
+  id = (int *) malloc(sizeof(int));
+  if (NULL == (void *) id) return NULL;
+
+  *id = semcreate((key_t) key);
+
+  if (*id == -1) {
+    free(id);
+    return NULL;
+  }
+  
+  return (void *) id;
+}
+
+ulapi_result ulapi_sem_delete(void * sem)
+{
+  if (NULL != sem) {
+    semdestroy(*((int *) sem));
+    free(sem);
+    return ULAPI_OK;
+  }
+
+  return ULAPI_ERROR;
+}
+
+ulapi_result ulapi_sem_give(void * sem)
+{
+  return semgive(*((int *) sem)) == 0 ? ULAPI_OK : ULAPI_ERROR;
+}
+
+ulapi_result ulapi_sem_take(void * sem)
+{
+  return semtake(*((int *) sem)) == 0 ? ULAPI_OK : ULAPI_ERROR;
+}
+
+void * ulapi_cond_new(ulapi_id key)
+{
+  pthread_cond_t * cond;
+
+  cond = (pthread_cond_t *) malloc(sizeof(pthread_cond_t));
+  if (NULL == (void *) cond) return NULL;
+
+  if (0 == pthread_cond_init(cond, NULL)) {
+    return (void *) cond;
+  }
+  /* else got an error, so free the condition variable and return null */
+
+  free(cond);
+  return NULL;
+}
+
+ulapi_result ulapi_cond_delete(void * cond)
+{
+  if (NULL == (void *) cond) return ULAPI_ERROR;
+
+  (void) pthread_cond_destroy((pthread_cond_t *) cond);
+  free(cond);
+
+  return ULAPI_OK;
+}
+
+ulapi_result ulapi_cond_signal(void * cond)
+{
+  return (0 == pthread_cond_signal((pthread_cond_t *) cond) ? ULAPI_OK : ULAPI_ERROR);
+}
+
+ulapi_result ulapi_cond_broadcast(void * cond)
+{
+  return (0 == pthread_cond_broadcast((pthread_cond_t *) cond) ? ULAPI_OK : ULAPI_ERROR);
+}
+
+ulapi_result ulapi_cond_wait(void * cond, void * mutex)
+{
+  int profiled = ulapi_profile_on;
+  int retval;
+
+  /* the mutex is given while waiting, so that is not counted as held */
+  if (profiled) ulapi_profile_released(mutex);
+  retval = pthread_cond_wait((pthread_cond_t *) cond, (pthread_mutex_t *) mutex);
+  if (profiled) ulapi_profile_acquired(mutex, ULAPI_PROFILE_CALLER());
+
+  return (0 == retval ? ULAPI_OK : ULAPI_ERROR);
+}
+
+ulapi_result ulapi_cond_timedwait(void * cond, void * mutex, ulapi_real secs)
+{
+  int profiled = ulapi_profile_on;
+  struct timeval tv;
+  struct timespec ts;
+  long nsec;
+  int retval;
+
+  if (secs < 0.0) secs = 0.0;
+
+  /* pthread_cond_timedwait takes an absolute CLOCK_REALTIME deadline */
+  gettimeofday(&tv, NULL);
+  ts.tv_sec = tv.tv_sec + (time_t) secs;
+  nsec = tv.tv_usec * 1000L + (long) ((secs - (time_t) secs) * 1.0e9);
+  ts.tv_sec += nsec / 1000000000L;
+  ts.tv_nsec = nsec % 1000000000L;
+
+  if (profiled) ulapi_profile_released(mutex);
+  retval = pthread_cond_timedwait((pthread_cond_t *) cond, (pthread_mutex_t *) mutex, &ts);
+  if (profiled) ulapi_profile_acquired(mutex, ULAPI_PROFILE_CALLER());
+
+  return (0 == retval ? ULAPI_OK : ULAPI_ERROR);
+}
+
+typedef struct {
+  ulapi_id key;
+  ulapi_integer size;
+  ulapi_id id;
+  void * addr;
+} shm_struct;
+
+void * ulapi_shm_new(ulapi_id key, ulapi_integer size)
+{
+  shm_struct * shm;
+
+  shm = malloc(sizeof(shm_struct));
+  if (NULL == (void *) shm) return NULL;
+
+  shm->id = shmget((key_t) key, (int) size, IPC_CREAT | 0666);
+  if (-1 == shm->id) {
+    perror("shmget");
+    free(shm);
+    return NULL;
+  }
+
+  shm->addr = shmat(shm->id, NULL, 0);
+  if ((void *) -1 == shm->addr) {
+    perror("shmat");
+    free(shm);
+    return NULL;
+  }
+
+  return (void *) shm;
+}
+
+void * ulapi_shm_addr(void * shm)
+{
+  return ((shm_struct *) shm)->addr;
+}
+
+ulapi_result ulapi_shm_delete(void * shm)
+{
+  struct shmid_ds d;
+  int r1, r2;
+
+  if (NULL == shm) return ULAPI_OK;
+
+  r1 = shmdt(((shm_struct *) shm)->addr);
+  r2 = shmctl(IPC_RMID, ((shm_struct *) shm)->id, &d);
+
+  free(shm);
+
+  return (r1 || r2 ? ULAPI_ERROR : ULAPI_OK);
+}
+
+#ifdef HAVE_RTAI
+
+typedef struct {
+  ulapi_id key;
+  void * addr;
+} rtm_struct;
+
+void *ulapi_rtm_new(ulapi_id key, ulapi_integer size)
+{
+  rtm_struct * shm;
+
+  shm = (rtm_struct *) malloc(sizeof(rtm_struct));
+  if (NULL == (void *) shm) return NULL;
+
+  shm->addr = rt_shm_alloc(key, size, USE_GFP_KERNEL);
+  if (NULL == shm->addr) {
+    free(shm);
+    return NULL;
+  }
+
+  shm->key = key;
+  return shm;
+}
+
+void *ulapi_rtm_addr(void * shm)
+{
+  return ((rtm_struct *) shm)->addr;
+}
+
+ulapi_result ulapi_rtm_delete(void * shm)
+{
+  if (NULL != shm) {
+    if (NULL != ((rtm_struct *) shm)->addr) {
+      rt_shm_free(((rtm_struct *) shm)->key);
+    }
+    free(shm);
+  }
+
+  return ULAPI_OK;
+}
+
+#else
+
+/*
+  If we don't have RTAI, just use normal shm. The RT side that
+  simualates realtime will do the same.
+*/
+
+void *ulapi_rtm_new(ulapi_id key, ulapi_integer size)
+{
+  return ulapi_shm_new(key, size);
+}
+
+void *ulapi_rtm_addr(void * shm)
+{
+  return ulapi_shm_addr(shm);
+}
+
+ulapi_result ulapi_rtm_delete(void * shm)
+{
+  return ulapi_shm_delete(shm);
+}
+
+#endif	/* HAVE_RTAI */
+
+ulapi_integer
+ulapi_socket_get_client_id(ulapi_integer port, const char *hostname)
+{
+  int socket_fd;
+  struct sockaddr_in server_addr;
+  struct hostent *ent;
+  struct in_addr *in_a;
+
+  if (NULL == (ent = gethostbyname(hostname))) {
+    PERROR("gethostbyname");
+    return -1;
+  }
+  in_a = (struct in_addr *) ent->h_addr_list[0];
+
+  memset(&server_addr, 0, sizeof(struct sockaddr_in));
+  server_addr.sin_family = PF_INET;
+  server_addr.sin_addr.s_addr = in_a->s_addr;
+  server_addr.sin_port = htons(port);
+
+  if (-1 == (socket_fd = socket(PF_INET, SOCK_STREAM, 0))) {
+    PERROR("socket");
+    return -1;
+  }
+
+  if (-1 == connect(socket_fd, 
+		    (struct sockaddr *) &server_addr,
+		    sizeof(struct sockaddr_in))) {
+    PERROR("connect");
+    close(socket_fd);
+    return -1;
+  }
+
+  return socket_fd;
+}
+
+ulapi_integer
+ulapi_socket_get_server_id_on_interface(ulapi_integer port, const char *intf)
+{
+  int socket_fd;
+  struct sockaddr_in myaddr;
+  int on;
+  struct linger mylinger = { 0 };
+  enum {BACKLOG = 5};
+
+  if (-1 == (socket_fd = socket(PF_INET, SOCK_STREAM, 0))) {
+    PERROR("socket");
+    return -1;
+  }
+
+  /*
+    Turn off bind address checking, and allow
+    port numbers to be reused - otherwise the
+    TIME_WAIT phenomenon will prevent binding
+    to these address.port combinations for
+    (2 * MSL) seconds.
+  */
+  on = 1;
+  if (-1 == 
+      setsockopt(socket_fd,
+		 SOL_SOCKET,
+		 SO_REUSEADDR,
+		 (const char *) &on,
+		 sizeof(on))) {
+    PERROR("setsockopt");
+    close(socket_fd);
+    return -1;
+  }
+
+  /*
+    When connection is closed, there is a need
+    to linger to ensure all data is transmitted.
+  */
+  mylinger.l_onoff = 1;
+  mylinger.l_linger = 30;
+  if (-1 ==
+      setsockopt(socket_fd,
+		 SOL_SOCKET,
+		 SO_LINGER,
+		 (const char *) &mylinger,
+		 sizeof(struct linger))) {
+    PERROR("setsockopt");
+    close(socket_fd);
+    return -1;
+  }
+
+  memset(&myaddr, 0, sizeof(struct sockaddr_in));
+  myaddr.sin_family = PF_INET;
+  if (NULL == intf) {
+    myaddr.sin_addr.s_addr = htonl(INADDR_ANY);
+  } else {
+    myaddr.sin_addr.s_addr = inet_addr(intf);
+  }
+  myaddr.sin_port = htons(port);
+
+  if (-1 == bind(socket_fd, (struct sockaddr *) &myaddr,
+		 sizeof(struct sockaddr_in))) {
+    PERROR("bind");
+    close(socket_fd);
+    return -1;
+  }
+
+  if (-1 == listen(socket_fd, BACKLOG)) {
+    PERROR("listen");
+    close(socket_fd);
+    return -1;
+  }
+
+  return socket_fd;
+}
+
+ulapi_integer
+ulapi_socket_get_server_id(ulapi_integer port)
+{
+  return ulapi_socket_get_server_id_on_interface(port, NULL);
+}
+
+ulapi_integer
+ulapi_socket_get_connection_id(ulapi_integer socket_fd)
+{
+  fd_set rfds;
+  struct sockaddr_in client_addr;
+  unsigned int client_len;
+  int client_fd;
+  int retval;
+
+  do {
+    FD_ZERO(&rfds);
+    FD_SET(socket_fd, &rfds);
+    retval = select(socket_fd + 1, &rfds, NULL, NULL, NULL);
+  } while (0 == retval ||
+	   ! FD_ISSET(socket_fd, &rfds));
+
+  if (retval == -1) {
+    PERROR("select");
+    return -1;
+  }
+
+  memset(&client_addr, 0, sizeof(struct sockaddr_in));
+  client_len = sizeof(struct sockaddr_in);
+  client_fd = 
+    accept(socket_fd,
+	   (struct sockaddr *) &client_addr, 
+	   &client_len);
+  if (-1 == client_fd) {
+    PERROR("accept");
+    return -1;
+  }
+  
+  return client_fd;
+}
+
+ulapi_integer
+ulapi_socket_get_broadcaster_id_on_interface(ulapi_integer port, const char *intf)
+{
+  struct sockaddr_in addr;
+  int fd;
+  int perm;
+
+  fd = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (0 > fd) {
+    return -1;
+  }
+
+  perm = 1;
+  if (0 > setsockopt(fd, SOL_SOCKET, SO_BROADCAST, (void *) &perm, sizeof(perm))) {
+    return -1;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  if (NULL == intf) {
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  } else {
+    addr.sin_addr.s_addr = inet_addr(intf);
+  }
+  addr.sin_port = htons(port);
+
+  if (-1 == connect(fd, 
+		    (struct sockaddr *) &addr,
+		    sizeof(struct sockaddr_in))) {
+    PERROR("connect");
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+ulapi_integer
+ulapi_socket_get_broadcaster_id(ulapi_integer port)
+{
+  return ulapi_socket_get_broadcaster_id_on_interface(port, NULL);
+}
+
+ulapi_integer
+ulapi_socket_get_broadcastee_id_on_interface(ulapi_integer port, const char *intf)
+{
+  struct sockaddr_in addr;
+  int fd;
+  int retval;
+
+  /* Create a best-effort datagram socket using UDP */
+  fd = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (0 > fd) {
+    return -1;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  if (NULL == intf) {
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  } else {
+    addr.sin_addr.s_addr = inet_addr(intf);
+  }
+  addr.sin_port = htons(port);
+
+  retval = bind(fd, (struct sockaddr *) &addr, sizeof(addr));
+
+  if (0 > retval) {
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+ulapi_integer
+ulapi_socket_get_broadcastee_id(ulapi_integer port)
+{
+  return ulapi_socket_get_broadcastee_id_on_interface(port, NULL);
+}
+
+/*
+  For the multicast calls, \a intf is the multicast group (e.g.,
+  "239.255.0.1"); NULL is ULAPI_SOCKET_DEFAULT_MULTICAST_GROUP. Datagrams
+  are sent with a TTL of 1, so they stay on the local subnet, and are
+  looped back to listeners on the sending computer.
+*/
+
+ulapi_integer
+ulapi_socket_get_multicaster_id_on_interface(ulapi_integer port, const char *intf)
+{
+  struct sockaddr_in addr;
+  int fd;
+  unsigned char ttl;
+  unsigned char loop;
+
+  fd = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (0 > fd) {
+    return -1;
+  }
+
+  ttl = 1;
+  loop = 1;
+  if (0 > setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, (void *) &ttl, sizeof(ttl)) ||
+      0 > setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, (void *) &loop, sizeof(loop))) {
+    close(fd);
+    return -1;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = inet_addr(NULL == intf ? ULAPI_SOCKET_DEFAULT_MULTICAST_GROUP : intf);
+  addr.sin_port = htons(port);
+
+  if (-1 == connect(fd,
+		    (struct sockaddr *) &addr,
+		    sizeof(struct sockaddr_in))) {
+    PERROR("connect");
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+ulapi_integer
+ulapi_socket_get_multicaster_id(ulapi_integer port)
+{
+  return ulapi_socket_get_multicaster_id_on_interface(port, NULL);
+}
+
+ulapi_integer
+ulapi_socket_get_multicastee_id_on_interface(ulapi_integer port, const char *intf)
+{
+  struct sockaddr_in addr;
+  struct ip_mreq mreq;
+  int fd;
+  int reuse;
+
+  fd = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (0 > fd) {
+    return -1;
+  }
+
+  /* Let any number of listeners on this computer share the port */
+  reuse = 1;
+  if (0 > setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (void *) &reuse, sizeof(reuse))) {
+    close(fd);
+    return -1;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+
+  if (0 > bind(fd, (struct sockaddr *) &addr, sizeof(addr))) {
+    close(fd);
+    return -1;
+  }
+
+  memset(&mreq, 0, sizeof(mreq));
+  mreq.imr_multiaddr.s_addr = inet_addr(NULL == intf ? ULAPI_SOCKET_DEFAULT_MULTICAST_GROUP : intf);
+  mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+  if (0 > setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, (void *) &mreq, sizeof(mreq))) {
+    PERROR("IP_ADD_MEMBERSHIP");
+    close(fd);
+    return -1;
   }
 
-  perm = 1;
-  if (0 > setsockopt(fd, SOL_SOCKET, SO_BROADCAST, (void *) &perm, sizeof(perm))) {
-    return -1;
-  }
+  return fd;
+}
+
+ulapi_integer
+ulapi_socket_get_multicastee_id(ulapi_integer port)
+{
+  return ulapi_socket_get_multicastee_id_on_interface(port, NULL);
+}
+
+char *
+ulapi_address_to_hostname(ulapi_integer address)
+{
+  static char string[4 * DIGITS_IN(int) + 3 + 1];
+
+  sprintf(string, "%d.%d.%d.%d",
+	  (int) ((address >> 24) & 0xFF),
+	  (int) ((address >> 16) & 0xFF),
+	  (int) ((address >> 8) & 0xFF),
+	  (int) (address & 0xFF));
+
+  return string;
+}
+
+ulapi_integer
+ulapi_hostname_to_address(const char *hostname)
+{
+  struct hostent * ent;
+
+  ent = gethostbyname(hostname);
+  if (NULL == ent) return (127 << 24) + (0 << 16) + (0 << 8) + 1;
+  if (4 != ent->h_length) return 0;
+
+  /* FIXME-- could use ntohl here */
+  return ((ent->h_addr_list[0][0] & 0xFF) << 24)
+    + ((ent->h_addr_list[0][1] & 0xFF) << 16)
+    + ((ent->h_addr_list[0][2] & 0xFF) << 8)
+    + (ent->h_addr_list[0][3] & 0xFF);
+}
+
+ulapi_integer
+ulapi_get_host_address(void)
+{
+  enum {HOSTNAMELEN = 256};
+  char hostname[HOSTNAMELEN];
+
+  if (0 != gethostname(hostname, HOSTNAMELEN)) return 0;
+  hostname[HOSTNAMELEN - 1] = 0; /* force null termination */
+
+  return ulapi_hostname_to_address(hostname);
+}
+
+ulapi_result
+ulapi_socket_set_nonblocking(ulapi_integer fd)
+{
+  int flags;
+
+  flags = fcntl(fd, F_GETFL);
+  if (-1 == fcntl(fd, F_SETFL, flags | O_NONBLOCK)) {
+    return ULAPI_ERROR;
+  }
+
+  return ULAPI_OK;
+}
+
+ulapi_result
+ulapi_socket_set_blocking(ulapi_integer fd)
+{
+  int flags;
+
+  flags = fcntl(fd, F_GETFL);
+  if (-1 == fcntl(fd, F_SETFL, flags & ~O_NONBLOCK)) {
+    return ULAPI_ERROR;
+  }
+
+  return ULAPI_OK;
+}
+
+ulapi_result
+ulapi_socket_set_nodelay(ulapi_integer fd)
+{
+  int on = 1;
+
+  if (0 > setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (void *) &on, sizeof(on))) {
+    return ULAPI_ERROR;
+  }
+
+  return ULAPI_OK;
+}
+
+ulapi_integer
+ulapi_socket_read(ulapi_integer id,
+		  char *buf,
+		  ulapi_integer len)
+{
+  return recv(id, buf, len, 0);
+}
+
+ulapi_integer
+ulapi_socket_write(ulapi_integer id,
+		   const char *buf,
+		   ulapi_integer len)
+{
+  return send(id, buf, len, MSG_NOSIGNAL);
+}
+
+ulapi_integer
+ulapi_socket_read_from(ulapi_integer id,
+		       char *buf,
+		       ulapi_integer len,
+		       ulapi_integer *address,
+		       ulapi_integer *port)
+{
+  struct sockaddr_in addr;
+  socklen_t addr_len;
+  ssize_t retval;
+
+  addr_len = sizeof(addr);
+  retval = recvfrom(id, buf, len, 0, (struct sockaddr *) &addr, &addr_len);
+  if (retval >= 0) {
+    if (NULL != address) *address = ntohl(addr.sin_addr.s_addr);
+    if (NULL != port) *port = ntohs(addr.sin_port);
+  }
+
+  return retval;
+}
+
+ulapi_integer
+ulapi_socket_write_to(ulapi_integer id,
+		      ulapi_integer address,
+		      ulapi_integer port,
+		      const char *buf,
+		      ulapi_integer len)
+{
+  struct sockaddr_in addr;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(address);
+  addr.sin_port = htons(port);
+
+  return sendto(id, buf, len, MSG_NOSIGNAL, (struct sockaddr *) &addr, sizeof(addr));
+}
+
+ulapi_result
+ulapi_socket_set_timestamps(ulapi_integer id,
+			    ulapi_integer how)
+{
+  int on = (ULAPI_STAMP_OFF != how);
+  int retval = -1;
+
+#if defined(__linux__) && defined(SO_TIMESTAMPING)
+  int flags = 0;
+
+  if (ULAPI_STAMP_HARDWARE == how) {
+    flags = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE |
+      SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+  }
+  retval = setsockopt((int) id, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags));
+  if (0 != flags) return (0 == retval ? ULAPI_OK : ULAPI_IMPL_ERROR);
+#endif
+
+#if defined(SO_TIMESTAMPNS)
+  retval = setsockopt((int) id, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+#elif defined(SO_TIMESTAMP)
+  retval = setsockopt((int) id, SOL_SOCKET, SO_TIMESTAMP, &on, sizeof(on));
+#endif
+
+  return (0 == retval ? ULAPI_OK : ULAPI_IMPL_ERROR);
+}
+
+/*
+  Room for whichever receive stamps the socket has turned on. Kernel
+  stamps are on the realtime clock, which ulapi_time may not use, so
+  they are converted by their age: how long before now they were taken.
+*/
+#define STAMP_CONTROL_SIZE (CMSG_SPACE(3 * sizeof(struct timespec)) + CMSG_SPACE(sizeof(struct timespec)))
 
-  memset(&addr, 0, sizeof(addr));
-  addr.sin_family = AF_INET;
-  if (NULL == intf) {
-    addr.sin_addr.s_addr = htonl(INADDR_ANY);
-  } else {
-    addr.sin_addr.s_addr = inet_addr(intf);
+static ulapi_real stamp_from_age(double secs, double nsecs)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+
+  return ulapi_time() - ((((double) now.tv_sec) - secs) + (((double) now.tv_usec) * 1.0e-6 - nsecs * 1.0e-9));
+}
+
+static ulapi_real stamp_from_msg(struct msghdr *msg)
+{
+  struct cmsghdr *cmsg;
+  struct timespec ts[3];
+  struct timeval tv;
+
+  for (cmsg = CMSG_FIRSTHDR(msg); NULL != cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+    if (SOL_SOCKET != cmsg->cmsg_level) continue;
+#ifdef SCM_TIMESTAMPING
+    if (SCM_TIMESTAMPING == cmsg->cmsg_type) {
+      /* software stamp first, raw hardware stamp last */
+      memcpy(ts, CMSG_DATA(cmsg), sizeof(ts));
+      if (0 != ts[2].tv_sec) return stamp_from_age(ts[2].tv_sec, ts[2].tv_nsec);
+      if (0 != ts[0].tv_sec) return stamp_from_age(ts[0].tv_sec, ts[0].tv_nsec);
+    }
+#endif
+#ifdef SCM_TIMESTAMPNS
+    if (SCM_TIMESTAMPNS == cmsg->cmsg_type) {
+      memcpy(ts, CMSG_DATA(cmsg), sizeof(ts[0]));
+      return stamp_from_age(ts[0].tv_sec, ts[0].tv_nsec);
+    }
+#endif
+#ifdef SCM_TIMESTAMP
+    if (SCM_TIMESTAMP == cmsg->cmsg_type) {
+      memcpy(&tv, CMSG_DATA(cmsg), sizeof(tv));
+      return stamp_from_age(tv.tv_sec, tv.tv_usec * 1000.0);
+    }
+#endif
   }
-  addr.sin_port = htons(port);
 
-  if (-1 == connect(fd, 
-		    (struct sockaddr *) &addr,
-		    sizeof(struct sockaddr_in))) {
-    PERROR("connect");
-    close(fd);
-    return -1;
+  /* stamps not turned on, or none for this data */
+  return ulapi_time();
+}
+
+ulapi_integer
+ulapi_socket_read_stamped(ulapi_integer id,
+			  char *buf,
+			  ulapi_integer len,
+			  ulapi_real *stamp)
+{
+  char control[STAMP_CONTROL_SIZE];
+  struct msghdr msg;
+  struct iovec v;
+  ssize_t retval;
+
+  v.iov_base = buf;
+  v.iov_len = (size_t) len;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &v;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  retval = recvmsg((int) id, &msg, 0);
+  if (retval >= 0 && NULL != stamp) *stamp = stamp_from_msg(&msg);
+
+  return retval;
+}
+
+ulapi_integer
+ulapi_socket_readv(ulapi_integer id,
+		   const ulapi_iovec *iov,
+		   ulapi_integer count)
+{
+  struct iovec v[ULAPI_SOCKET_BATCH_MAX];
+  ulapi_integer t;
+
+  if (count < 0) return -1;
+  if (count > ULAPI_SOCKET_BATCH_MAX) count = ULAPI_SOCKET_BATCH_MAX;
+
+  for (t = 0; t < count; t++) {
+    v[t].iov_base = iov[t].buf;
+    v[t].iov_len = (size_t) iov[t].len;
   }
 
-  return fd;
+  return readv((int) id, v, (int) count);
 }
 
 ulapi_integer
-ulapi_socket_get_broadcaster_id(ulapi_integer port)
+ulapi_socket_writev(ulapi_integer id,
+		    const ulapi_iovec *iov,
+		    ulapi_integer count)
 {
-  return ulapi_socket_get_broadcaster_id_on_interface(port, NULL);
+  struct iovec v[ULAPI_SOCKET_BATCH_MAX];
+  struct msghdr msg;
+  ulapi_integer t, sent, total;
+
+  if (count < 0) return -1;
+
+  /* sendmsg rather than writev, to suppress SIGPIPE as ulapi_socket_write does */
+  for (total = 0; count > 0; count -= t, iov += t) {
+    for (t = 0; t < count && t < ULAPI_SOCKET_BATCH_MAX; t++) {
+      v[t].iov_base = iov[t].buf;
+      v[t].iov_len = (size_t) iov[t].len;
+    }
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = v;
+    msg.msg_iovlen = t;
+    sent = sendmsg((int) id, &msg, MSG_NOSIGNAL);
+    if (sent < 0) return (total > 0 ? total : -1);
+    total += sent;
+  }
+
+  return total;
 }
 
 ulapi_integer
-ulapi_socket_get_broadcastee_id_on_interface(ulapi_integer port, const char *intf)
+ulapi_socket_read_batch(ulapi_integer id,
+			ulapi_datagram *msgs,
+			ulapi_integer count)
+{
+#ifdef __linux__
+  struct mmsghdr m[ULAPI_SOCKET_BATCH_MAX];
+  struct iovec v[ULAPI_SOCKET_BATCH_MAX];
+  struct sockaddr_in addr[ULAPI_SOCKET_BATCH_MAX];
+  char control[ULAPI_SOCKET_BATCH_MAX][STAMP_CONTROL_SIZE];
+  ulapi_integer t, total;
+  int n, retval;
+
+  if (count < 0) return -1;
+
+  /* a full batch means more may be waiting */
+  for (total = 0; total < count; total += retval) {
+    n = (int) ((count - total) < ULAPI_SOCKET_BATCH_MAX ? (count - total) : ULAPI_SOCKET_BATCH_MAX);
+    memset(m, 0, n * sizeof(m[0]));
+    for (t = 0; t < n; t++) {
+      v[t].iov_base = msgs[total + t].buf;
+      v[t].iov_len = (size_t) msgs[total + t].size;
+      m[t].msg_hdr.msg_iov = &v[t];
+      m[t].msg_hdr.msg_iovlen = 1;
+      m[t].msg_hdr.msg_name = &addr[t];
+      m[t].msg_hdr.msg_namelen = sizeof(addr[t]);
+      m[t].msg_hdr.msg_control = control[t];
+      m[t].msg_hdr.msg_controllen = sizeof(control[t]);
+    }
+    retval = recvmmsg((int) id, m, n, MSG_DONTWAIT, NULL);
+    if (retval < 0) {
+      if (EAGAIN == errno || EWOULDBLOCK == errno || EINTR == errno) break;
+      return (total > 0 ? total : -1);
+    }
+    for (t = 0; t < retval; t++) {
+      msgs[total + t].len = m[t].msg_len;
+      msgs[total + t].address = ntohl(addr[t].sin_addr.s_addr);
+      msgs[total + t].port = ntohs(addr[t].sin_port);
+      msgs[total + t].stamp = stamp_from_msg(&m[t].msg_hdr);
+    }
+    if (retval < n) {
+      total += retval;
+      break;
+    }
+  }
+
+  return total;
+#else
+  char control[STAMP_CONTROL_SIZE];
+  struct sockaddr_in addr;
+  struct msghdr msg;
+  struct iovec v;
+  ulapi_integer total;
+  ssize_t retval;
+
+  if (count < 0) return -1;
+
+  for (total = 0; total < count; total++) {
+    v.iov_base = msgs[total].buf;
+    v.iov_len = (size_t) msgs[total].size;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &v;
+    msg.msg_iovlen = 1;
+    msg.msg_name = &addr;
+    msg.msg_namelen = sizeof(addr);
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    retval = recvmsg((int) id, &msg, MSG_DONTWAIT);
+    if (retval < 0) {
+      if (EAGAIN == errno || EWOULDBLOCK == errno || EINTR == errno) break;
+      return (total > 0 ? total : -1);
+    }
+    msgs[total].len = retval;
+    msgs[total].address = ntohl(addr.sin_addr.s_addr);
+    msgs[total].port = ntohs(addr.sin_port);
+    msgs[total].stamp = stamp_from_msg(&msg);
+  }
+
+  return total;
+#endif
+}
+
+/* fills in the destination of a datagram, returning NULL for a connected socket */
+static struct sockaddr *datagram_address(const ulapi_datagram *msg, struct sockaddr_in *addr)
 {
+  if (0 == msg->address && 0 == msg->port) return NULL;
+
+  memset(addr, 0, sizeof(*addr));
+  addr->sin_family = AF_INET;
+  addr->sin_addr.s_addr = htonl(msg->address);
+  addr->sin_port = htons(msg->port);
+
+  return (struct sockaddr *) addr;
+}
+
+ulapi_integer
+ulapi_socket_write_batch(ulapi_integer id,
+			 const ulapi_datagram *msgs,
+			 ulapi_integer count)
+{
+#ifdef __linux__
+  struct mmsghdr m[ULAPI_SOCKET_BATCH_MAX];
+  struct iovec v[ULAPI_SOCKET_BATCH_MAX];
+  struct sockaddr_in addr[ULAPI_SOCKET_BATCH_MAX];
+  ulapi_integer t, total;
+  int n, retval;
+
+  if (count < 0) return -1;
+
+  for (total = 0; total < count; total += retval) {
+    n = (int) ((count - total) < ULAPI_SOCKET_BATCH_MAX ? (count - total) : ULAPI_SOCKET_BATCH_MAX);
+    memset(m, 0, n * sizeof(m[0]));
+    for (t = 0; t < n; t++) {
+      v[t].iov_base = msgs[total + t].buf;
+      v[t].iov_len = (size_t) msgs[total + t].len;
+      m[t].msg_hdr.msg_iov = &v[t];
+      m[t].msg_hdr.msg_iovlen = 1;
+      m[t].msg_hdr.msg_name = datagram_address(&msgs[total + t], &addr[t]);
+      m[t].msg_hdr.msg_namelen = (NULL == m[t].msg_hdr.msg_name ? 0 : sizeof(addr[t]));
+    }
+    retval = sendmmsg((int) id, m, n, MSG_NOSIGNAL);
+    if (retval <= 0) return (total > 0 ? total : -1);
+  }
+
+  return total;
+#else
   struct sockaddr_in addr;
-  int fd;
+  struct sockaddr *to;
+  ulapi_integer total;
+
+  if (count < 0) return -1;
+
+  for (total = 0; total < count; total++) {
+    to = datagram_address(&msgs[total], &addr);
+    if (0 > sendto((int) id, msgs[total].buf, msgs[total].len, MSG_NOSIGNAL, to, (NULL == to ? 0 : sizeof(addr)))) {
+      return (total > 0 ? total : -1);
+    }
+  }
+
+  return total;
+#endif
+}
+
+ulapi_integer
+ulapi_socket_poll(const ulapi_integer *ids,
+		  ulapi_integer *ready,
+		  ulapi_integer count,
+		  ulapi_real secs)
+{
+  struct pollfd fds[ULAPI_SOCKET_POLL_MAX];
+  ulapi_integer t;
   int retval;
 
-  /* Create a best-effort datagram socket using UDP */
-  fd = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
-  if (0 > fd) {
-    return -1;
+  if (count < 0 || count > ULAPI_SOCKET_POLL_MAX) return -1;
+
+  for (t = 0; t < count; t++) {
+    fds[t].fd = (int) ids[t];
+    fds[t].events = POLLIN;
+    fds[t].revents = 0;
   }
 
-  memset(&addr, 0, sizeof(addr));
-  addr.sin_family = AF_INET;
-  if (NULL == intf) {
-    addr.sin_addr.s_addr = htonl(INADDR_ANY);
-  } else {
-    addr.sin_addr.s_addr = inet_addr(intf);
+  retval = poll(fds, (nfds_t) count, secs < 0.0 ? -1 : (int) (secs * 1000.0));
+  if (retval < 0) return (EINTR == errno ? 0 : -1);
+
+  for (t = 0; t < count; t++) {
+    ready[t] = (0 != (fds[t].revents & (POLLIN | POLLHUP | POLLERR | POLLNVAL)));
   }
-  addr.sin_port = htons(port);
 
-  retval = bind(fd, (struct sockaddr *) &addr, sizeof(addr));
+  return retval;
+}
 
-  if (0 > retval) {
-    close(fd);
-    return -1;
+ulapi_result
+ulapi_socket_close(ulapi_integer id)
+{
+  return 0 == close((int) id) ? ULAPI_OK : ULAPI_ERROR;
+}
+
+/* Poller interface */
+
+#ifdef __linux__
+
+/*
+  The kernel keeps the set; here we only keep the data of each socket,
+  indexed by descriptor, since an epoll event carries just one of the
+  two. The wake descriptor is an eventfd in the set.
+*/
+typedef struct {
+  int epfd;
+  int wakefd;
+  void **data;
+  int size;
+} poller_struct;
+
+static uint32_t poller_to_epoll(ulapi_integer events)
+{
+  return ((events & ULAPI_POLL_READ) ? EPOLLIN : 0) |
+    ((events & ULAPI_POLL_WRITE) ? EPOLLOUT : 0) | EPOLLRDHUP;
+}
+
+static ulapi_result poller_set(poller_struct *p, int op, ulapi_integer id, ulapi_integer events, void *data)
+{
+  struct epoll_event ev;
+  void **grown;
+  int size;
+
+  if (NULL == p || id < 0) return ULAPI_ERROR;
+
+  if (id >= p->size) {
+    for (size = (p->size > 0 ? p->size : 64); size <= id; size *= 2);
+    grown = (void **) realloc(p->data, size * sizeof(void *));
+    if (NULL == grown) return ULAPI_ERROR;
+    memset(grown + p->size, 0, (size - p->size) * sizeof(void *));
+    p->data = grown;
+    p->size = size;
   }
 
-  return fd;
+  ev.events = poller_to_epoll(events);
+  ev.data.fd = (int) id;
+  if (0 != epoll_ctl(p->epfd, op, (int) id, &ev)) return ULAPI_ERROR;
+  p->data[id] = data;
+
+  return ULAPI_OK;
 }
 
-ulapi_integer
-ulapi_socket_get_broadcastee_id(ulapi_integer port)
+void *ulapi_poller_new(void)
 {
-  return ulapi_socket_get_broadcastee_id_on_interface(port, NULL);
+  poller_struct *p;
+  struct epoll_event ev;
+
+  p = (poller_struct *) malloc(sizeof(poller_struct));
+  if (NULL == p) return NULL;
+
+  p->data = NULL;
+  p->size = 0;
+  p->epfd = epoll_create1(EPOLL_CLOEXEC);
+  p->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (p->epfd >= 0 && p->wakefd >= 0) {
+    ev.events = EPOLLIN;
+    ev.data.fd = p->wakefd;
+    if (0 == epoll_ctl(p->epfd, EPOLL_CTL_ADD, p->wakefd, &ev)) return p;
+  }
+  /* else got an error, so clean up and return null */
+
+  if (p->epfd >= 0) close(p->epfd);
+  if (p->wakefd >= 0) close(p->wakefd);
+  free(p);
+  return NULL;
 }
 
-char *
-ulapi_address_to_hostname(ulapi_integer address)
+ulapi_result ulapi_poller_delete(void *poller)
 {
-  static char string[4 * DIGITS_IN(int) + 3 + 1];
+  poller_struct *p = (poller_struct *) poller;
 
-  sprintf(string, "%d.%d.%d.%d",
-	  (int) ((address >> 24) & 0xFF),
-	  (int) ((address >> 16) & 0xFF),
-	  (int) ((address >> 8) & 0xFF),
-	  (int) (address & 0xFF));
+  if (NULL == p) return ULAPI_ERROR;
 
-  return string;
+  close(p->epfd);
+  close(p->wakefd);
+  free(p->data);
+  free(p);
+
+  return ULAPI_OK;
 }
 
-ulapi_integer
-ulapi_hostname_to_address(const char *hostname)
+ulapi_result ulapi_poller_add(void *poller, ulapi_integer id, ulapi_integer events, void *data)
 {
-  struct hostent * ent;
+  return poller_set((poller_struct *) poller, EPOLL_CTL_ADD, id, events, data);
+}
 
-  ent = gethostbyname(hostname);
-  if (NULL == ent) return (127 << 24) + (0 << 16) + (0 << 8) + 1;
-  if (4 != ent->h_length) return 0;
+ulapi_result ulapi_poller_modify(void *poller, ulapi_integer id, ulapi_integer events, void *data)
+{
+  return poller_set((poller_struct *) poller, EPOLL_CTL_MOD, id, events, data);
+}
 
-  /* FIXME-- could use ntohl here */
-  return ((ent->h_addr_list[0][0] & 0xFF) << 24)
-    + ((ent->h_addr_list[0][1] & 0xFF) << 16)
-    + ((ent->h_addr_list[0][2] & 0xFF) << 8)
-    + (ent->h_addr_list[0][3] & 0xFF);
+ulapi_result ulapi_poller_remove(void *poller, ulapi_integer id)
+{
+  poller_struct *p = (poller_struct *) poller;
+  struct epoll_event ev;
+
+  if (NULL == p || id < 0 || id >= p->size) return ULAPI_ERROR;
+
+  /* kernels before 2.6.9 want an event even though it is ignored */
+  if (0 != epoll_ctl(p->epfd, EPOLL_CTL_DEL, (int) id, &ev)) return ULAPI_ERROR;
+  p->data[id] = NULL;
+
+  return ULAPI_OK;
 }
 
-ulapi_integer
-ulapi_get_host_address(void)
+ulapi_integer ulapi_poller_wait(void *poller, ulapi_poll_event *events, ulapi_integer max, ulapi_real secs)
 {
-  enum {HOSTNAMELEN = 256};
-  char hostname[HOSTNAMELEN];
+  poller_struct *p = (poller_struct *) poller;
+  struct epoll_event ev[ULAPI_SOCKET_POLL_MAX];
+  uint64_t count;
+  int retval, t, n;
 
-  if (0 != gethostname(hostname, HOSTNAMELEN)) return 0;
-  hostname[HOSTNAMELEN - 1] = 0; /* force null termination */
+  if (NULL == p || max < 1) return -1;
+  if (max > ULAPI_SOCKET_POLL_MAX) max = ULAPI_SOCKET_POLL_MAX;
 
-  return ulapi_hostname_to_address(hostname);
+  retval = epoll_wait(p->epfd, ev, (int) max, secs < 0.0 ? -1 : (int) (secs * 1000.0 + 0.5));
+  if (retval < 0) return (EINTR == errno ? 0 : -1);
+
+  for (t = 0, n = 0; t < retval; t++) {
+    if (ev[t].data.fd == p->wakefd) {
+      /* reset the count so the next wait sleeps again */
+      if (read(p->wakefd, &count, sizeof(count))) {}
+      continue;
+    }
+    events[n].id = ev[t].data.fd;
+    events[n].events = ((ev[t].events & EPOLLIN) ? ULAPI_POLL_READ : 0) |
+      ((ev[t].events & EPOLLOUT) ? ULAPI_POLL_WRITE : 0) |
+      ((ev[t].events & (EPOLLHUP | EPOLLRDHUP)) ? ULAPI_POLL_HANGUP : 0) |
+      ((ev[t].events & EPOLLERR) ? ULAPI_POLL_ERROR : 0);
+    events[n].data = p->data[ev[t].data.fd];
+    n++;
+  }
+
+  return n;
 }
 
-ulapi_result
-ulapi_socket_set_nonblocking(ulapi_integer fd)
+ulapi_result ulapi_poller_wake(void *poller)
 {
-  int flags;
+  poller_struct *p = (poller_struct *) poller;
+  uint64_t one = 1;
 
-  flags = fcntl(fd, F_GETFL);
-  if (-1 == fcntl(fd, F_SETFL, flags | O_NONBLOCK)) {
-    return ULAPI_ERROR;
+  if (NULL == p) return ULAPI_ERROR;
+
+  return (sizeof(one) == write(p->wakefd, &one, sizeof(one)) || EAGAIN == errno) ? ULAPI_OK : ULAPI_ERROR;
+}
+
+#else
+
+/*
+  Elsewhere the set is kept here and handed to poll on each wait. The
+  wake descriptor is the read end of a pipe, kept in the first entry.
+*/
+typedef struct {
+  struct pollfd fds[ULAPI_SOCKET_POLL_MAX + 1];
+  void *data[ULAPI_SOCKET_POLL_MAX + 1];
+  int count;
+  int wakefd;
+} poller_struct;
+
+static int poller_find(poller_struct *p, ulapi_integer id)
+{
+  int t;
+
+  for (t = 1; t < p->count; t++) {
+    if (p->fds[t].fd == (int) id) return t;
   }
 
-  return ULAPI_OK;
+  return -1;
 }
 
-ulapi_result
-ulapi_socket_set_blocking(ulapi_integer fd)
+static short poller_to_poll(ulapi_integer events)
 {
-  int flags;
+  return ((events & ULAPI_POLL_READ) ? POLLIN : 0) | ((events & ULAPI_POLL_WRITE) ? POLLOUT : 0);
+}
 
-  flags = fcntl(fd, F_GETFL);
-  if (-1 == fcntl(fd, F_SETFL, flags & ~O_NONBLOCK)) {
-    return ULAPI_ERROR;
+void *ulapi_poller_new(void)
+{
+  poller_struct *p;
+  int fds[2];
+
+  if (0 != pipe(fds)) return NULL;
+  p = (poller_struct *) malloc(sizeof(poller_struct));
+  if (NULL == p) {
+    close(fds[0]);
+    close(fds[1]);
+    return NULL;
   }
 
+  fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+  fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+  p->fds[0].fd = fds[0];
+  p->fds[0].events = POLLIN;
+  p->data[0] = NULL;
+  p->count = 1;
+  p->wakefd = fds[1];
+
+  return p;
+}
+
+ulapi_result ulapi_poller_delete(void *poller)
+{
+  poller_struct *p = (poller_struct *) poller;
+
+  if (NULL == p) return ULAPI_ERROR;
+
+  close(p->fds[0].fd);
+  close(p->wakefd);
+  free(p);
+
   return ULAPI_OK;
 }
 
-ulapi_integer
-ulapi_socket_read(ulapi_integer id,
-		  char *buf,
-		  ulapi_integer len)
+ulapi_result ulapi_poller_add(void *poller, ulapi_integer id, ulapi_integer events, void *data)
 {
-  return recv(id, buf, len, 0);
+  poller_struct *p = (poller_struct *) poller;
+
+  if (NULL == p || id < 0 || poller_find(p, id) >= 0 || p->count > ULAPI_SOCKET_POLL_MAX) return ULAPI_ERROR;
+
+  p->fds[p->count].fd = (int) id;
+  p->fds[p->count].events = poller_to_poll(events);
+  p->data[p->count] = data;
+  p->count++;
+
+  return ULAPI_OK;
 }
 
-ulapi_integer
-ulapi_socket_write(ulapi_integer id,
-		   const char *buf,
-		   ulapi_integer len)
+ulapi_result ulapi_poller_modify(void *poller, ulapi_integer id, ulapi_integer events, void *data)
 {
-  return send(id, buf, len, MSG_NOSIGNAL);
+  poller_struct *p = (poller_struct *) poller;
+  int t;
+
+  if (NULL == p || (t = poller_find(p, id)) < 0) return ULAPI_ERROR;
+
+  p->fds[t].events = poller_to_poll(events);
+  p->data[t] = data;
+
+  return ULAPI_OK;
 }
 
-ulapi_result
-ulapi_socket_close(ulapi_integer id)
+ulapi_result ulapi_poller_remove(void *poller, ulapi_integer id)
 {
-  return 0 == close((int) id) ? ULAPI_OK : ULAPI_ERROR;
+  poller_struct *p = (poller_struct *) poller;
+  int t;
+
+  if (NULL == p || (t = poller_find(p, id)) < 0) return ULAPI_ERROR;
+
+  /* fill the gap with the last entry */
+  p->count--;
+  p->fds[t] = p->fds[p->count];
+  p->data[t] = p->data[p->count];
+
+  return ULAPI_OK;
 }
 
+ulapi_integer ulapi_poller_wait(void *poller, ulapi_poll_event *events, ulapi_integer max, ulapi_real secs)
+{
+  poller_struct *p = (poller_struct *) poller;
+  char drain[64];
+  int retval, t, n;
+
+  if (NULL == p || max < 1) return -1;
+
+  retval = poll(p->fds, (nfds_t) p->count, secs < 0.0 ? -1 : (int) (secs * 1000.0 + 0.5));
+  if (retval < 0) return (EINTR == errno ? 0 : -1);
+
+  if (p->fds[0].revents & POLLIN) {
+    while (read(p->fds[0].fd, drain, sizeof(drain)) > 0);
+  }
+  for (t = 1, n = 0; t < p->count && n < max; t++) {
+    if (0 == p->fds[t].revents) continue;
+    events[n].id = p->fds[t].fd;
+    events[n].events = ((p->fds[t].revents & POLLIN) ? ULAPI_POLL_READ : 0) |
+      ((p->fds[t].revents & POLLOUT) ? ULAPI_POLL_WRITE : 0) |
+      ((p->fds[t].revents & POLLHUP) ? ULAPI_POLL_HANGUP : 0) |
+      ((p->fds[t].revents & (POLLERR | POLLNVAL)) ? ULAPI_POLL_ERROR : 0);
+    events[n].data = p->data[t];
+    n++;
+  }
+
+  return n;
+}
+
+ulapi_result ulapi_poller_wake(void *poller)
+{
+  poller_struct *p = (poller_struct *) poller;
+  char one = 1;
+
+  if (NULL == p) return ULAPI_ERROR;
+
+  return (1 == write(p->wakefd, &one, 1) || EAGAIN == errno) ? ULAPI_OK : ULAPI_ERROR;
+}
+
+#endif
+
 /* File descriptor interface */
 
 void * 
@@ -30,6 +30,7 @@
 #include <stdio.h>    /* printf */
 #include <stddef.h>    /* NULL, sizeof */
 #include <stdlib.h>    /* malloc, free */
+#include <malloc.h>    /* _aligned_malloc, _aligned_free */
 #include <ctype.h>    /* isspace */
 #include <string.h>    /* strcpy, strrchr */
 #include <time.h>    /* clock, CLK_TCK */
@@ -38,6 +39,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include "ulapi.h"
+#include "ulapi_profile.h"
 
 static ulapi_integer ulapi_debug_level = 0;
 
@@ -140,6 +142,182 @@ void ulapi_sleep(ulapi_real secs)
   Sleep(dwMilliseconds);
 }
 
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+typedef HANDLE (WINAPI *timer_create_ex)(LPSECURITY_ATTRIBUTES, LPCWSTR, DWORD, DWORD);
+typedef UINT (WINAPI *timer_period)(UINT);
+
+/*
+  Makes a waitable timer, high resolution if the system has them
+  (Windows 10 1803 on). Otherwise the timer only fires on a system
+  tick, so the tick is set to 1 ms while the timer lives; *ticked
+  says whether timer_give must set it back.
+*/
+static HANDLE timer_take(int *ticked)
+{
+  timer_create_ex create;
+  timer_period begin;
+  HMODULE module;
+  HANDLE timer = NULL;
+
+  *ticked = 0;
+  module = GetModuleHandleA("kernel32.dll");
+  if (NULL != module) {
+    create = (timer_create_ex) GetProcAddress(module, "CreateWaitableTimerExW");
+    if (NULL != create) {
+      timer = create(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    }
+  }
+  if (NULL != timer) return timer;
+
+  timer = CreateWaitableTimer(NULL, TRUE, NULL);
+  if (NULL == timer) return NULL;
+  module = LoadLibraryA("winmm.dll");
+  if (NULL != module) {
+    begin = (timer_period) GetProcAddress(module, "timeBeginPeriod");
+    if (NULL != begin && 0 == begin(1)) *ticked = 1;
+  }
+
+  return timer;
+}
+
+static void timer_give(HANDLE timer, int ticked)
+{
+  timer_period end;
+  HMODULE module;
+
+  if (ticked) {
+    module = GetModuleHandleA("winmm.dll");
+    if (NULL != module) {
+      end = (timer_period) GetProcAddress(module, "timeEndPeriod");
+      if (NULL != end) (void) end(1);
+    }
+  }
+  CloseHandle(timer);
+}
+
+/* sleeps on timer until when, on the ulapi_time clock */
+static void timer_wait(HANDLE timer, ulapi_real when)
+{
+  LARGE_INTEGER due;
+  ulapi_real left;
+
+  while ((left = when - ulapi_time()) > 0.0) {
+    /* negative for a relative time, in 100-ns units */
+    due.QuadPart = -((LONGLONG) (left * 1.0e7) + 1);
+    if (!SetWaitableTimer(timer, &due, 0, NULL, NULL, FALSE) ||
+	WAIT_OBJECT_0 != WaitForSingleObject(timer, INFINITE)) {
+      ulapi_sleep(left);
+    }
+  }
+}
+
+void ulapi_sleep_until(ulapi_real when)
+{
+  HANDLE timer;
+  int ticked;
+
+  if (when <= ulapi_time()) return;
+
+  timer = timer_take(&ticked);
+  if (NULL == timer) {
+    ulapi_sleep(when - ulapi_time());
+    return;
+  }
+  timer_wait(timer, when);
+  timer_give(timer, ticked);
+}
+
+typedef struct {
+  HANDLE timer;
+  int ticked;
+  ulapi_real period;
+  ulapi_real next;		/* on the ulapi_time clock */
+  ulapi_integer overruns;
+  ulapi_real worst;
+} win32_periodic_struct;
+
+ulapi_result ulapi_periodic_reset(void *timer, ulapi_real period)
+{
+  win32_periodic_struct *pt = (win32_periodic_struct *) timer;
+
+  if (NULL == pt) return ULAPI_ERROR;
+
+  if (period > 0.0) pt->period = period;
+  pt->overruns = 0;
+  pt->worst = 0.0;
+  pt->next = ulapi_time() + pt->period;
+
+  return ULAPI_OK;
+}
+
+void *ulapi_periodic_new(ulapi_real period)
+{
+  win32_periodic_struct *pt;
+
+  if (period <= 0.0) return NULL;
+
+  pt = (win32_periodic_struct *) malloc(sizeof(win32_periodic_struct));
+  if (NULL == pt) return NULL;
+
+  pt->timer = timer_take(&pt->ticked);
+  if (NULL == pt->timer) {
+    free(pt);
+    return NULL;
+  }
+  (void) ulapi_periodic_reset(pt, period);
+
+  return pt;
+}
+
+ulapi_result ulapi_periodic_delete(void *timer)
+{
+  win32_periodic_struct *pt = (win32_periodic_struct *) timer;
+
+  if (NULL == pt) return ULAPI_ERROR;
+
+  timer_give(pt->timer, pt->ticked);
+  free(pt);
+
+  return ULAPI_OK;
+}
+
+ulapi_integer ulapi_periodic_wait(void *timer)
+{
+  win32_periodic_struct *pt = (win32_periodic_struct *) timer;
+  ulapi_real late;
+  ulapi_integer missed = 0;
+
+  if (NULL == pt) return -1;
+
+  late = ulapi_time() - pt->next;
+  if (late < 0.0) {
+    timer_wait(pt->timer, pt->next);
+    late = ulapi_time() - pt->next;
+    pt->next += pt->period;
+  } else {
+    missed = 1 + (ulapi_integer) (late / pt->period);
+    pt->next += missed * pt->period;
+  }
+
+  pt->overruns += missed;
+  if (late > pt->worst) pt->worst = late;
+
+  return missed;
+}
+
+ulapi_integer ulapi_periodic_overruns(void *timer)
+{
+  return (NULL == timer ? 0 : ((win32_periodic_struct *) timer)->overruns);
+}
+
+ulapi_real ulapi_periodic_worst(void *timer)
+{
+  return (NULL == timer ? 0.0 : ((win32_periodic_struct *) timer)->worst);
+}
+
 ulapi_result ulapi_app_wait(void)
 {
   /* sort of a kludge -- keep waiting a bunch of seconds */
@@ -322,6 +500,111 @@ ulapi_result ulapi_task_delete(ulapi_task_struct *task)
   return ULAPI_OK;
 }
 
+void ulapi_task_attr_init(ulapi_task_attr *attr)
+{
+  attr->policy = ULAPI_SCHED_NORMAL;
+  attr->priority = 0;
+  attr->cpu = -1;
+  attr->stack_size = 0;
+  attr->lock_memory = 0;
+}
+
+/* what the starting task needs to do before running the task code */
+typedef struct {
+  void (*taskcode)(void *);
+  void *taskarg;
+  ulapi_integer cpu;
+  size_t prefault;
+  int mmcss;
+} task_launch;
+
+typedef HANDLE (WINAPI *mmcss_join)(LPCSTR, LPDWORD);
+
+/* touches a span of the stack below the caller, so it is committed now */
+static void task_prefault(size_t bytes)
+{
+  enum {CHUNK = 4096};
+  volatile char page[CHUNK];
+  size_t t;
+
+  for (t = 0; t < CHUNK; t += 64) page[t] = 0;
+  if (bytes > CHUNK) task_prefault(bytes - CHUNK);
+  /* used after the call, so the call cannot reuse this frame */
+  page[0] = page[CHUNK - 1];
+}
+
+static DWORD WINAPI task_launcher(LPVOID arg)
+{
+  task_launch launch = *((task_launch *) arg);
+  HMODULE avrt;
+  mmcss_join join;
+  DWORD index = 0;
+
+  free(arg);
+  if (launch.cpu >= 0) (void) ulapi_self_set_affinity(launch.cpu);
+  if (launch.mmcss) {
+    /* loaded at run time, as the service is not on every system */
+    avrt = LoadLibraryA("avrt.dll");
+    if (NULL != avrt) {
+      join = (mmcss_join) GetProcAddress(avrt, "AvSetMmThreadCharacteristicsA");
+      if (NULL != join) (void) join("Pro Audio", &index);
+    }
+  }
+  if (launch.prefault > 0) task_prefault(launch.prefault);
+  launch.taskcode(launch.taskarg);
+
+  return 0;
+}
+
+ulapi_result ulapi_task_start_attr(ulapi_task_struct *task,
+				   void (*taskcode)(void *),
+				   void *taskarg,
+				   const ulapi_task_attr *attr)
+{
+  task_launch *launch;
+  ulapi_result result = ULAPI_OK;
+  int realtime, prio;
+
+  if (NULL == task || NULL == attr) return ULAPI_ERROR;
+
+  launch = (task_launch *) malloc(sizeof(task_launch));
+  if (NULL == launch) return ULAPI_ERROR;
+  realtime = (ULAPI_SCHED_FIFO == attr->policy || ULAPI_SCHED_RR == attr->policy);
+  launch->taskcode = taskcode;
+  launch->taskarg = taskarg;
+  launch->cpu = attr->cpu;
+  /* leave room for the launcher's own frames */
+  launch->prefault = (attr->stack_size > 16384 ? (size_t) attr->stack_size - 16384 : 0);
+  launch->mmcss = realtime;
+
+  /* no way to lock all of the process's memory */
+  if (attr->lock_memory) result = ULAPI_IMPL_ERROR;
+
+  task->hThread = CreateThread(NULL, (SIZE_T) (attr->stack_size > 0 ? attr->stack_size : 0),
+			       task_launcher, launch, CREATE_SUSPENDED, &task->dwThreadId);
+  if (NULL == task->hThread) {
+    free(launch);
+    return ULAPI_ERROR;
+  }
+
+  if (realtime) {
+    prio = (attr->priority >= 90 ? THREAD_PRIORITY_TIME_CRITICAL :
+	    (attr->priority >= 50 ? THREAD_PRIORITY_HIGHEST : THREAD_PRIORITY_ABOVE_NORMAL));
+    if (0 == SetThreadPriority(task->hThread, prio)) result = ULAPI_IMPL_ERROR;
+  }
+
+  if ((DWORD) -1 == ResumeThread(task->hThread)) {
+    /* the launcher never ran, so the launch data is still ours */
+    free(launch);
+    (void) TerminateThread(task->hThread, 0);
+    CloseHandle(task->hThread);
+    task->hThread = NULL;
+    return ULAPI_ERROR;
+  }
+
+  return result;
+}
+
 ulapi_result ulapi_task_start(ulapi_task_struct *task,
      void (*taskcode)(void *),
      void *taskarg,
@@ -396,6 +679,82 @@ ulapi_result ulapi_self_set_period(ulapi_integer period_nsec)
   return ULAPI_OK;
 }
 
+ulapi_result ulapi_self_set_affinity(ulapi_integer cpu)
+{
+  DWORD_PTR process, system, mask;
+
+  if (!GetProcessAffinityMask(GetCurrentProcess(), &process, &system)) return ULAPI_ERROR;
+
+  if (cpu < 0) {
+    mask = process;
+  } else {
+    if (cpu >= (ulapi_integer) (8 * sizeof(DWORD_PTR))) return ULAPI_ERROR;
+    mask = ((DWORD_PTR) 1) << cpu;
+    if (0 == (mask & process)) return ULAPI_ERROR;
+  }
+
+  return (0 != SetThreadAffinityMask(GetCurrentThread(), mask) ? ULAPI_OK : ULAPI_ERROR);
+}
+
+ulapi_integer ulapi_cpu_count(void)
+{
+  SYSTEM_INFO info;
+
+  GetSystemInfo(&info);
+
+  return (info.dwNumberOfProcessors > 0 ? (ulapi_integer) info.dwNumberOfProcessors : 1);
+}
+
+/* NUMA queries, looked up at run time as they postdate the target version */
+typedef BOOL (WINAPI *numa_highest_fn)(PULONG);
+typedef BOOL (WINAPI *numa_mask_fn)(UCHAR, PULONGLONG);
+
+static numa_highest_fn numa_highest = NULL;
+static numa_mask_fn numa_mask = NULL;
+
+static int numa_present(void)
+{
+  static volatile LONG looked_up = 0;
+  HMODULE kernel;
+
+  if (0 == InterlockedCompareExchange(&looked_up, 1, 0)) {
+    kernel = GetModuleHandleA("kernel32.dll");
+    if (NULL != kernel) {
+      numa_highest = (numa_highest_fn) GetProcAddress(kernel, "GetNumaHighestNodeNumber");
+      numa_mask = (numa_mask_fn) GetProcAddress(kernel, "GetNumaNodeProcessorMask");
+    }
+    InterlockedExchange(&looked_up, 2);
+  }
+  while (2 != InterlockedCompareExchange(&looked_up, 2, 2)) Sleep(0);
+
+  return (NULL != numa_highest && NULL != numa_mask);
+}
+
+ulapi_integer ulapi_numa_node_count(void)
+{
+  ULONG highest;
+
+  if (!numa_present() || !numa_highest(&highest)) return 1;
+
+  return (ulapi_integer) highest + 1;
+}
+
+ulapi_result ulapi_self_set_node(ulapi_integer node)
+{
+  DWORD_PTR process, system;
+  ULONGLONG mask;
+
+  if (node < 0) return ulapi_self_set_affinity(-1);
+  if (!numa_present()) return (0 == node ? ULAPI_OK : ULAPI_ERROR);
+  if (node > 255 || !numa_mask((UCHAR) node, &mask)) return ULAPI_ERROR;
+  if (!GetProcessAffinityMask(GetCurrentProcess(), &process, &system)) return ULAPI_ERROR;
+
+  mask &= (ULONGLONG) process;
+  if (0 == mask) return ULAPI_ERROR;
+
+  return (0 != SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR) mask) ? ULAPI_OK : ULAPI_ERROR);
+}
+
 ulapi_result ulapi_wait(ulapi_integer period_nsec)
 {
   DWORD dwMilliseconds;
@@ -565,6 +924,7 @@ ulapi_result ulapi_mutex_init(ulapi_mutex_struct *mutex, ulapi_id key)
   }
 
   mutex->hMutex = hMutex;
+  ulapi_profile_add(mutex, key, ULAPI_PROFILE_MUTEX);
 
   return ULAPI_OK;
 }
@@ -589,12 +949,14 @@ ulapi_mutex_struct *ulapi_mutex_new(ulapi_id key)
   }
 
   mutex->hMutex = hMutex;
+  ulapi_profile_add(mutex, key, ULAPI_PROFILE_MUTEX);
 
   return mutex;
 }
 
 ulapi_result ulapi_mutex_clear(ulapi_mutex_struct *mutex)
 {
+  ulapi_profile_remove(mutex);
   CloseHandle(mutex->hMutex);
 
   return ULAPI_OK;
@@ -604,29 +966,53 @@ ulapi_result ulapi_mutex_delete(ulapi_mutex_struct *mutex)
 {
   if (NULL == mutex) return ULAPI_ERROR;
 
+  ulapi_profile_remove(mutex);
   CloseHandle(mutex->hMutex);
   free(mutex);
 
   return ULAPI_OK;
 }
 
-ulapi_result ulapi_mutex_give(ulapi_mutex_struct *mutex)
+static ulapi_result mutex_give(void *mutex)
 {
   BOOL retval;
 
-  retval = ReleaseMutex(mutex->hMutex);
+  retval = ReleaseMutex(((ulapi_mutex_struct *) mutex)->hMutex);
 
   return retval ? ULAPI_OK : ULAPI_ERROR;
 }
 
-ulapi_result ulapi_mutex_take(ulapi_mutex_struct *mutex)
+static ulapi_result mutex_take(void *mutex)
+{
+  DWORD retval;
+
+  retval = WaitForSingleObject(((ulapi_mutex_struct *) mutex)->hMutex, INFINITE);
+
+  return retval == WAIT_OBJECT_0 ? ULAPI_OK : ULAPI_ERROR;
+}
+
+static ulapi_result mutex_trytake(void *mutex)
 {
   DWORD retval;
 
-  retval = WaitForSingleObject(mutex->hMutex, INFINITE);
+  retval = WaitForSingleObject(((ulapi_mutex_struct *) mutex)->hMutex, 0);
 
   return retval == WAIT_OBJECT_0 ? ULAPI_OK : ULAPI_ERROR;
-} 
+}
+
+ulapi_result ulapi_mutex_give(ulapi_mutex_struct *mutex)
+{
+  if (ulapi_profile_on) return ulapi_profile_give(mutex, mutex_give, 0);
+
+  return mutex_give(mutex);
+}
+
+ulapi_result ulapi_mutex_take(ulapi_mutex_struct *mutex)
+{
+  if (ulapi_profile_on) return ulapi_profile_take(mutex, mutex_trytake, mutex_take, ULAPI_PROFILE_CALLER(), 0);
+
+  return mutex_take(mutex);
+}
 
 /* this needs to be static, not heap or stack */
 static char ulapi_sem_name[3   /* for "sem" */
@@ -637,133 +1023,630 @@ typedef struct {
   HANDLE hSemaphore;
 } win32_sem_struct;
 
-void *ulapi_sem_new(ulapi_id key)
+/* times a task tries a held fast lock before sleeping */
+#define FASTLOCK_SPIN 4000
+
+static void *fastlock_new(void)
 {
-  win32_sem_struct * sem;
-  HANDLE hSemaphore;
+  CRITICAL_SECTION *lock;
 
-  sem = (win32_sem_struct *) malloc(sizeof(win32_sem_struct));
-  if (NULL == sem) {
+  lock = (CRITICAL_SECTION *) malloc(sizeof(CRITICAL_SECTION));
+  if (NULL == lock) return NULL;
+
+  if (!InitializeCriticalSectionAndSpinCount(lock, FASTLOCK_SPIN)) {
+    free(lock);
     return NULL;
   }
 
-  sprintf(ulapi_sem_name, "sem%d", (int) key);
+  return lock;
+}
 
-  hSemaphore = CreateSemaphore(NULL,
-             1, /* initial count */
-             1, /* max count */
-             ulapi_sem_name);
-  if (NULL == hSemaphore) {
-    free(sem);
-    return NULL;
-  }
+static ulapi_result fastlock_delete(void *lock)
+{
+  if (NULL == lock) return ULAPI_ERROR;
 
-  sem->hSemaphore = hSemaphore;
+  DeleteCriticalSection((CRITICAL_SECTION *) lock);
+  free(lock);
 
-  return sem;
+  return ULAPI_OK;
 }
 
-ulapi_result ulapi_sem_delete(void *sem)
+static ulapi_result fastlock_take(void *lock)
 {
-  if (NULL == sem) return ULAPI_ERROR;
+  if (NULL == lock) return ULAPI_ERROR;
+
+  EnterCriticalSection((CRITICAL_SECTION *) lock);
 
-  CloseHandle(((win32_sem_struct *) sem)->hSemaphore);
-  free(sem);
-  
   return ULAPI_OK;
 }
 
-ulapi_result ulapi_sem_give(void *sem)
+static ulapi_result fastlock_trytake(void *lock)
 {
-  BOOL retval;
+  if (NULL == lock) return ULAPI_ERROR;
 
-  retval = ReleaseSemaphore(((win32_sem_struct *) sem)->hSemaphore,
-          1,  /* how much to give */
-          NULL); /* no need for previous count */
-  return retval ? ULAPI_OK : ULAPI_ERROR;
+  return (TryEnterCriticalSection((CRITICAL_SECTION *) lock) ? ULAPI_OK : ULAPI_ERROR);
 }
 
-ulapi_result ulapi_sem_take(void *sem)
+static ulapi_result fastlock_give(void *lock)
 {
-  DWORD retval;
+  if (NULL == lock) return ULAPI_ERROR;
 
-  retval = WaitForSingleObject(((win32_sem_struct *) sem)->hSemaphore,
-             INFINITE);
+  LeaveCriticalSection((CRITICAL_SECTION *) lock);
 
-  return retval == WAIT_OBJECT_0 ? ULAPI_OK : ULAPI_ERROR;
+  return ULAPI_OK;
 }
 
-/*
-  See http://www.cs.wustl.edu/~schmidt/win32-cv-1.html for details
-  on implementing condition variables in Win32.
-*/
-
-typedef struct {
-  int waiters_count_;
-  /* Number of waiting threads. */
+void *ulapi_fastlock_new(void)
+{
+  void *lock;
 
-  CRITICAL_SECTION waiters_count_lock_;
-  /* Serialize access to <waiters_count_>. */
+  lock = fastlock_new();
+  ulapi_profile_add(lock, 0, ULAPI_PROFILE_FASTLOCK);
 
-  HANDLE sema_;
-  /* Semaphore used to queue up threads waiting for the condition to */
-  /* become signaled.  */
+  return lock;
+}
 
-  HANDLE waiters_done_;
-  /* An auto-reset event used by the broadcast/signal thread to wait */
-  /* for all the waiting thread(s) to wake up and be released from the */
-  /* semaphore.  */
+ulapi_result ulapi_fastlock_delete(void *lock)
+{
+  ulapi_profile_remove(lock);
 
-  size_t was_broadcast_;
-  /* Keeps track of whether we were broadcasting or signaling.  This */
-  /* allows us to optimize the code if we're just signaling. */
-} pthread_cond_t;
+  return fastlock_delete(lock);
+}
 
-typedef int pthread_condattr_t;
+ulapi_result ulapi_fastlock_take(void *lock)
+{
+  if (ulapi_profile_on && NULL != lock) {
+    return ulapi_profile_take(lock, fastlock_trytake, fastlock_take, ULAPI_PROFILE_CALLER(), 0);
+  }
 
-typedef HANDLE pthread_mutex_t;
+  return fastlock_take(lock);
+}
 
-static int pthread_cond_init(pthread_cond_t *cv,
-           const pthread_condattr_t * attr)
+ulapi_result ulapi_fastlock_trytake(void *lock)
 {
-  cv->waiters_count_ = 0;
-  cv->was_broadcast_ = 0;
-  cv->sema_ = CreateSemaphore(NULL,       /* no security */
-            0,          /* initially 0 */
-            0x7fffffff, /* max count */
-            NULL);      /* unnamed  */
-  InitializeCriticalSection (&cv->waiters_count_lock_);
-  cv->waiters_done_ = CreateEvent(NULL,  /* no security */
-          FALSE, /* auto-reset */
-          FALSE, /* non-signaled initially */
-          NULL); /* unnamed */
+  ulapi_result retval;
 
-  return 0;
+  retval = fastlock_trytake(lock);
+  if (ulapi_profile_on && ULAPI_OK == retval) ulapi_profile_acquired(lock, ULAPI_PROFILE_CALLER());
+
+  return retval;
 }
 
-static int pthread_cond_wait(pthread_cond_t *cv, 
-           pthread_mutex_t *external_mutex)
+ulapi_result ulapi_fastlock_give(void *lock)
 {
-  int last_waiter;
+  if (ulapi_profile_on && NULL != lock) return ulapi_profile_give(lock, fastlock_give, 0);
 
-  /* Avoid race conditions. */
-  EnterCriticalSection (&cv->waiters_count_lock_);
-  cv->waiters_count_++;
-  LeaveCriticalSection (&cv->waiters_count_lock_);
+  return fastlock_give(lock);
+}
 
-  /* This call atomically releases the mutex and waits on the */
-  /* semaphore until <pthread_cond_signal> or <pthread_cond_broadcast> */
-  /* are called by another thread. */
-  SignalObjectAndWait (*external_mutex, cv->sema_, INFINITE, FALSE);
+/*
+  Slim reader-writer locks arrived with Vista, after the Windows
+  version this is built for, so they are looked up at run time. Where
+  they are missing, readers are serialized like writers.
+*/
+typedef VOID (WINAPI *srw_op)(PVOID);
 
-  /* Reacquire lock to avoid race conditions. */
-  EnterCriticalSection (&cv->waiters_count_lock_);
+static srw_op srw_read_take = NULL;
+static srw_op srw_read_give = NULL;
+static srw_op srw_write_take = NULL;
+static srw_op srw_write_give = NULL;
+static LONG srw_looked_up = 0;
 
-  /* We're no longer waiting... */
-  cv->waiters_count_--;
+typedef struct {
+  PVOID srw;			/* an SRWLOCK, which is one pointer */
+  CRITICAL_SECTION cs;		/* used without them */
+} win32_rwlock_struct;
 
-  /* Check to see if we're the last waiter after <pthread_cond_broadcast>. */
-  last_waiter = cv->was_broadcast_ && cv->waiters_count_ == 0;
+static int srw_present(void)
+{
+  HMODULE kernel;
+
+  if (0 == InterlockedCompareExchange(&srw_looked_up, 1, 0)) {
+    kernel = GetModuleHandleA("kernel32.dll");
+    if (NULL != kernel) {
+      srw_read_take = (srw_op) GetProcAddress(kernel, "AcquireSRWLockShared");
+      srw_read_give = (srw_op) GetProcAddress(kernel, "ReleaseSRWLockShared");
+      srw_write_take = (srw_op) GetProcAddress(kernel, "AcquireSRWLockExclusive");
+      srw_write_give = (srw_op) GetProcAddress(kernel, "ReleaseSRWLockExclusive");
+    }
+    if (NULL == srw_read_take || NULL == srw_read_give ||
+	NULL == srw_write_take || NULL == srw_write_give) {
+      srw_read_take = srw_read_give = srw_write_take = srw_write_give = NULL;
+    }
+    InterlockedExchange(&srw_looked_up, 2);
+  }
+  while (2 != InterlockedCompareExchange(&srw_looked_up, 2, 2)) Sleep(0);
+
+  return (NULL != srw_write_take);
+}
+
+void *ulapi_rwlock_new(void)
+{
+  win32_rwlock_struct *lock;
+
+  lock = (win32_rwlock_struct *) malloc(sizeof(win32_rwlock_struct));
+  if (NULL == lock) return NULL;
+
+  /* SRWLOCK_INIT */
+  lock->srw = NULL;
+  if (!srw_present() &&
+      !InitializeCriticalSectionAndSpinCount(&lock->cs, FASTLOCK_SPIN)) {
+    free(lock);
+    return NULL;
+  }
+  ulapi_profile_add(lock, 0, ULAPI_PROFILE_RWLOCK);
+
+  return lock;
+}
+
+ulapi_result ulapi_rwlock_delete(void *lock)
+{
+  if (NULL == lock) return ULAPI_ERROR;
+
+  ulapi_profile_remove(lock);
+  if (!srw_present()) DeleteCriticalSection(&((win32_rwlock_struct *) lock)->cs);
+  free(lock);
+
+  return ULAPI_OK;
+}
+
+static ulapi_result rwlock_read_take(void *lock)
+{
+  win32_rwlock_struct *rw = (win32_rwlock_struct *) lock;
+
+  if (srw_present()) srw_read_take(&rw->srw);
+  else EnterCriticalSection(&rw->cs);
+
+  return ULAPI_OK;
+}
+
+static ulapi_result rwlock_write_take(void *lock)
+{
+  win32_rwlock_struct *rw = (win32_rwlock_struct *) lock;
+
+  if (srw_present()) srw_write_take(&rw->srw);
+  else EnterCriticalSection(&rw->cs);
+
+  return ULAPI_OK;
+}
+
+static ulapi_result rwlock_write_give(void *lock)
+{
+  win32_rwlock_struct *rw = (win32_rwlock_struct *) lock;
+
+  if (srw_present()) srw_write_give(&rw->srw);
+  else LeaveCriticalSection(&rw->cs);
+
+  return ULAPI_OK;
+}
+
+/* no non-blocking take is looked up, so the profile times every take */
+ulapi_result ulapi_rwlock_read_take(void *lock)
+{
+  if (NULL == lock) return ULAPI_ERROR;
+
+  if (ulapi_profile_on) return ulapi_profile_take(lock, NULL, rwlock_read_take, ULAPI_PROFILE_CALLER(), 1);
+
+  return rwlock_read_take(lock);
+}
+
+ulapi_result ulapi_rwlock_read_give(void *lock)
+{
+  win32_rwlock_struct *rw = (win32_rwlock_struct *) lock;
+
+  if (NULL == rw) return ULAPI_ERROR;
+
+  if (srw_present()) srw_read_give(&rw->srw);
+  else LeaveCriticalSection(&rw->cs);
+
+  return ULAPI_OK;
+}
+
+ulapi_result ulapi_rwlock_write_take(void *lock)
+{
+  if (NULL == lock) return ULAPI_ERROR;
+
+  if (ulapi_profile_on) return ulapi_profile_take(lock, NULL, rwlock_write_take, ULAPI_PROFILE_CALLER(), 0);
+
+  return rwlock_write_take(lock);
+}
+
+ulapi_result ulapi_rwlock_write_give(void *lock)
+{
+  if (NULL == lock) return ULAPI_ERROR;
+
+  if (ulapi_profile_on) return ulapi_profile_give(lock, rwlock_write_give, 0);
+
+  return rwlock_write_give(lock);
+}
+
+/*
+  Lock-free queues, laid out as in unix_ulapi.c:  the producer end
+  (tail) and consumer end (head) each on a cache line of their own,
+  and, for multiple producers, a sequence number at the start of each
+  slot. Indices are 32 bits and wrap. Plain volatile accesses are
+  acquire loads and release stores on x86 and x64; elsewhere the
+  interlocked calls provide the ordering.
+*/
+#define QUEUE_LINE 64
+
+typedef struct {
+  volatile LONG tail;
+  LONG head_seen;
+  char pad1[QUEUE_LINE - 2 * sizeof(LONG)];
+  volatile LONG head;
+  LONG tail_seen;
+  char pad2[QUEUE_LINE - 2 * sizeof(LONG)];
+  volatile LONG waiting;
+  int multi;
+  DWORD mask;
+  DWORD size;
+  DWORD stride;
+  unsigned char *slots;
+  ulapi_result (*notify)(void *);
+  void *arg;
+  HANDLE event;
+} win32_queue_struct;
+
+#define QUEUE_SLOT(q, pos) ((q)->slots + ((DWORD) (pos) & (q)->mask) * (q)->stride)
+#define QUEUE_SEQ(slot) ((volatile LONG *) (slot))
+
+static LONG queue_load(volatile LONG *p)
+{
+#if defined(_M_IX86) || defined(_M_X64)
+  return *p;
+#else
+  return InterlockedCompareExchange(p, 0, 0);
+#endif
+}
+
+static void queue_store(volatile LONG *p, LONG v)
+{
+#if defined(_M_IX86) || defined(_M_X64)
+  *p = v;
+#else
+  InterlockedExchange(p, v);
+#endif
+}
+
+static void *queue_new(ulapi_integer slots, ulapi_integer size, int multi)
+{
+  win32_queue_struct *q;
+  DWORD n, i;
+
+  if (slots < 1 || size < 1 || slots > (1L << 30)) return NULL;
+  for (n = 1; n < (DWORD) slots; n <<= 1);
+
+  q = (win32_queue_struct *) _aligned_malloc(sizeof(win32_queue_struct), QUEUE_LINE);
+  if (NULL == q) return NULL;
+  memset(q, 0, sizeof(win32_queue_struct));
+  q->multi = multi;
+  q->mask = n - 1;
+  q->size = (DWORD) size;
+  q->stride = (q->size + sizeof(LONG) - 1) & ~(sizeof(LONG) - 1);
+  if (multi) q->stride += sizeof(LONG);
+
+  q->slots = (unsigned char *) _aligned_malloc(n * q->stride, QUEUE_LINE);
+  /* auto-reset, so each wakeup releases the consumer once */
+  q->event = CreateEvent(NULL, FALSE, FALSE, NULL);
+  if (NULL == q->slots || NULL == q->event) {
+    if (NULL != q->slots) _aligned_free(q->slots);
+    if (NULL != q->event) CloseHandle(q->event);
+    _aligned_free(q);
+    return NULL;
+  }
+  if (multi) {
+    for (i = 0; i < n; i++) *QUEUE_SEQ(QUEUE_SLOT(q, i)) = (LONG) i;
+  }
+
+  return (void *) q;
+}
+
+void *ulapi_spsc_new(ulapi_integer slots, ulapi_integer size)
+{
+  return queue_new(slots, size, 0);
+}
+
+void *ulapi_mpsc_new(ulapi_integer slots, ulapi_integer size)
+{
+  return queue_new(slots, size, 1);
+}
+
+ulapi_result ulapi_queue_delete(void *queue)
+{
+  win32_queue_struct *q = (win32_queue_struct *) queue;
+
+  if (NULL == q) return ULAPI_ERROR;
+
+  CloseHandle(q->event);
+  _aligned_free(q->slots);
+  _aligned_free(q);
+
+  return ULAPI_OK;
+}
+
+static void queue_wake(win32_queue_struct *q)
+{
+  MemoryBarrier();
+  if (0 == q->waiting) return;
+  if (0 == InterlockedExchange(&q->waiting, 0)) return;
+
+  if (NULL != q->notify) (void) q->notify(q->arg);
+  SetEvent(q->event);
+}
+
+ulapi_result ulapi_queue_push(void *queue, const void *item)
+{
+  win32_queue_struct *q = (win32_queue_struct *) queue;
+  unsigned char *slot;
+  LONG pos, seq;
+
+  if (NULL == q || NULL == item) return ULAPI_ERROR;
+
+  if (!q->multi) {
+    pos = q->tail;
+    if ((DWORD) (pos - q->head_seen) > q->mask) {
+      q->head_seen = queue_load(&q->head);
+      if ((DWORD) (pos - q->head_seen) > q->mask) return ULAPI_ERROR;
+    }
+    memcpy(QUEUE_SLOT(q, pos), item, q->size);
+    queue_store(&q->tail, pos + 1);
+  } else {
+    pos = queue_load(&q->tail);
+    for (;;) {
+      slot = QUEUE_SLOT(q, pos);
+      seq = queue_load(QUEUE_SEQ(slot));
+      if (seq == pos) {
+	if (pos == InterlockedCompareExchange(&q->tail, pos + 1, pos)) break;
+	pos = queue_load(&q->tail);
+      } else if ((LONG) (seq - pos) < 0) {
+	return ULAPI_ERROR;
+      } else {
+	pos = queue_load(&q->tail);
+      }
+    }
+    memcpy(slot + sizeof(LONG), item, q->size);
+    queue_store(QUEUE_SEQ(slot), pos + 1);
+  }
+
+  queue_wake(q);
+
+  return ULAPI_OK;
+}
+
+static int queue_ready(win32_queue_struct *q)
+{
+  if (!q->multi) {
+    return q->head != queue_load(&q->tail);
+  }
+  return queue_load(QUEUE_SEQ(QUEUE_SLOT(q, q->head))) == q->head + 1;
+}
+
+ulapi_result ulapi_queue_pop(void *queue, void *item)
+{
+  win32_queue_struct *q = (win32_queue_struct *) queue;
+  unsigned char *slot;
+  LONG pos;
+
+  if (NULL == q || NULL == item) return ULAPI_ERROR;
+
+  pos = q->head;
+  slot = QUEUE_SLOT(q, pos);
+  if (!q->multi) {
+    if (pos == q->tail_seen) {
+      q->tail_seen = queue_load(&q->tail);
+      if (pos == q->tail_seen) return ULAPI_ERROR;
+    }
+    memcpy(item, slot, q->size);
+  } else {
+    if (queue_load(QUEUE_SEQ(slot)) != pos + 1) return ULAPI_ERROR;
+    memcpy(item, slot + sizeof(LONG), q->size);
+    queue_store(QUEUE_SEQ(slot), pos + (LONG) q->mask + 1);
+  }
+  queue_store(&q->head, pos + 1);
+
+  return ULAPI_OK;
+}
+
+ulapi_result ulapi_queue_arm(void *queue)
+{
+  win32_queue_struct *q = (win32_queue_struct *) queue;
+
+  if (NULL == q) return ULAPI_ERROR;
+
+  /* the exchange is a full barrier, pairing with the one in queue_wake */
+  InterlockedExchange(&q->waiting, 1);
+  if (queue_ready(q)) {
+    InterlockedExchange(&q->waiting, 0);
+    return ULAPI_ERROR;
+  }
+
+  return ULAPI_OK;
+}
+
+ulapi_result ulapi_queue_pop_wait(void *queue, void *item, ulapi_real secs)
+{
+  win32_queue_struct *q = (win32_queue_struct *) queue;
+  ulapi_real until, left;
+  int expired = 0;
+
+  if (NULL == q || NULL == item) return ULAPI_ERROR;
+
+  until = ulapi_time() + secs;
+  while (ULAPI_OK != ulapi_queue_pop(q, item)) {
+    if (expired) return ULAPI_ERROR;
+    if (ULAPI_OK != ulapi_queue_arm(q)) continue;
+
+    /* a wakeup left over from an earlier timeout only costs a retry */
+    while (0 != queue_load(&q->waiting)) {
+      if (secs < 0.0) {
+	WaitForSingleObject(q->event, INFINITE);
+	continue;
+      }
+      left = until - ulapi_time();
+      if (left <= 0.0 ||
+	  WAIT_TIMEOUT == WaitForSingleObject(q->event, (DWORD) (left * 1000.0) + 1)) {
+	InterlockedExchange(&q->waiting, 0);
+	expired = 1;
+	break;
+      }
+    }
+  }
+
+  return ULAPI_OK;
+}
+
+ulapi_integer ulapi_queue_count(void *queue)
+{
+  win32_queue_struct *q = (win32_queue_struct *) queue;
+  DWORD n;
+
+  if (NULL == q) return 0;
+
+  n = (DWORD) (queue_load(&q->tail) - queue_load(&q->head));
+
+  return (ulapi_integer) (n > q->mask + 1 ? 0 : n);
+}
+
+ulapi_result ulapi_queue_set_notify(void *queue, ulapi_result (*notify)(void *), void *arg)
+{
+  win32_queue_struct *q = (win32_queue_struct *) queue;
+
+  if (NULL == q) return ULAPI_ERROR;
+
+  q->arg = arg;
+  q->notify = notify;
+
+  return ULAPI_OK;
+}
+
+void *ulapi_sem_new(ulapi_id key)
+{
+  win32_sem_struct * sem;
+  HANDLE hSemaphore;
+
+  sem = (win32_sem_struct *) malloc(sizeof(win32_sem_struct));
+  if (NULL == sem) {
+    return NULL;
+  }
+
+  sprintf(ulapi_sem_name, "sem%d", (int) key);
+
+  hSemaphore = CreateSemaphore(NULL,
+             1, /* initial count */
+             1, /* max count */
+             ulapi_sem_name);
+  if (NULL == hSemaphore) {
+    free(sem);
+    return NULL;
+  }
+
+  sem->hSemaphore = hSemaphore;
+
+  return sem;
+}
+
+ulapi_result ulapi_sem_delete(void *sem)
+{
+  if (NULL == sem) return ULAPI_ERROR;
+
+  CloseHandle(((win32_sem_struct *) sem)->hSemaphore);
+  free(sem);
+  
+  return ULAPI_OK;
+}
+
+ulapi_result ulapi_sem_give(void *sem)
+{
+  BOOL retval;
+
+  retval = ReleaseSemaphore(((win32_sem_struct *) sem)->hSemaphore,
+          1,  /* how much to give */
+          NULL); /* no need for previous count */
+  return retval ? ULAPI_OK : ULAPI_ERROR;
+}
+
+ulapi_result ulapi_sem_take(void *sem)
+{
+  DWORD retval;
+
+  retval = WaitForSingleObject(((win32_sem_struct *) sem)->hSemaphore,
+             INFINITE);
+
+  return retval == WAIT_OBJECT_0 ? ULAPI_OK : ULAPI_ERROR;
+}
+
+/*
+  See http://www.cs.wustl.edu/~schmidt/win32-cv-1.html for details
+  on implementing condition variables in Win32.
+*/
+
+typedef struct {
+  int waiters_count_;
+  /* Number of waiting threads. */
+
+  CRITICAL_SECTION waiters_count_lock_;
+  /* Serialize access to <waiters_count_>. */
+
+  HANDLE sema_;
+  /* Semaphore used to queue up threads waiting for the condition to */
+  /* become signaled.  */
+
+  HANDLE waiters_done_;
+  /* An auto-reset event used by the broadcast/signal thread to wait */
+  /* for all the waiting thread(s) to wake up and be released from the */
+  /* semaphore.  */
+
+  size_t was_broadcast_;
+  /* Keeps track of whether we were broadcasting or signaling.  This */
+  /* allows us to optimize the code if we're just signaling. */
+} pthread_cond_t;
+
+typedef int pthread_condattr_t;
+
+typedef HANDLE pthread_mutex_t;
+
+static int pthread_cond_init(pthread_cond_t *cv,
+           const pthread_condattr_t * attr)
+{
+  cv->waiters_count_ = 0;
+  cv->was_broadcast_ = 0;
+  cv->sema_ = CreateSemaphore(NULL,       /* no security */
+            0,          /* initially 0 */
+            0x7fffffff, /* max count */
+            NULL);      /* unnamed  */
+  InitializeCriticalSection (&cv->waiters_count_lock_);
+  cv->waiters_done_ = CreateEvent(NULL,  /* no security */
+          FALSE, /* auto-reset */
+          FALSE, /* non-signaled initially */
+          NULL); /* unnamed */
+
+  return 0;
+}
+
+static int pthread_cond_wait(pthread_cond_t *cv, 
+           pthread_mutex_t *external_mutex)
+{
+  int last_waiter;
+
+  /* Avoid race conditions. */
+  EnterCriticalSection (&cv->waiters_count_lock_);
+  cv->waiters_count_++;
+  LeaveCriticalSection (&cv->waiters_count_lock_);
+
+  /* This call atomically releases the mutex and waits on the */
+  /* semaphore until <pthread_cond_signal> or <pthread_cond_broadcast> */
+  /* are called by another thread. */
+  SignalObjectAndWait (*external_mutex, cv->sema_, INFINITE, FALSE);
+
+  /* Reacquire lock to avoid race conditions. */
+  EnterCriticalSection (&cv->waiters_count_lock_);
+
+  /* We're no longer waiting... */
+  cv->waiters_count_--;
+
+  /* Check to see if we're the last waiter after <pthread_cond_broadcast>. */
+  last_waiter = cv->was_broadcast_ && cv->waiters_count_ == 0;
 
   LeaveCriticalSection (&cv->waiters_count_lock_);
 
@@ -778,7 +1661,39 @@ static int pthread_cond_wait(pthread_cond_t *cv,
     /* give to our callers.  */
     WaitForSingleObject (*external_mutex, INFINITE);
 
-  return 0;
+  return 0;
+}
+
+/*
+  Same as pthread_cond_wait, but gives up after 'msec' milliseconds.
+  A waiter that times out just after a signal may leave a token in the
+  semaphore, so a later waiter can wake spuriously; callers recheck
+  their predicate anyway.
+*/
+static int pthread_cond_timedwait_ms(pthread_cond_t *cv,
+                                     pthread_mutex_t *external_mutex,
+                                     DWORD msec)
+{
+  int last_waiter;
+  DWORD retval;
+
+  EnterCriticalSection (&cv->waiters_count_lock_);
+  cv->waiters_count_++;
+  LeaveCriticalSection (&cv->waiters_count_lock_);
+
+  retval = SignalObjectAndWait (*external_mutex, cv->sema_, msec, FALSE);
+
+  EnterCriticalSection (&cv->waiters_count_lock_);
+  cv->waiters_count_--;
+  last_waiter = cv->was_broadcast_ && cv->waiters_count_ == 0;
+  LeaveCriticalSection (&cv->waiters_count_lock_);
+
+  if (last_waiter)
+    SignalObjectAndWait (cv->waiters_done_, *external_mutex, INFINITE, FALSE);
+  else
+    WaitForSingleObject (*external_mutex, INFINITE);
+
+  return (retval == WAIT_OBJECT_0) ? 0 : 1;
 }
 
 static int pthread_cond_signal(pthread_cond_t * cv)
@@ -874,7 +1789,30 @@ ulapi_result ulapi_cond_broadcast(void *cond)
 
 ulapi_result ulapi_cond_wait(void *cond, void *mutex)
 {
-  return (0 == pthread_cond_wait((pthread_cond_t *) cond, (pthread_mutex_t *) mutex) ? ULAPI_OK : ULAPI_ERROR);
+  int profiled = ulapi_profile_on;
+  int retval;
+
+  /* the mutex is given while waiting, so that is not counted as held */
+  if (profiled) ulapi_profile_released(mutex);
+  retval = pthread_cond_wait((pthread_cond_t *) cond, (pthread_mutex_t *) mutex);
+  if (profiled) ulapi_profile_acquired(mutex, ULAPI_PROFILE_CALLER());
+
+  return (0 == retval ? ULAPI_OK : ULAPI_ERROR);
+}
+
+ulapi_result ulapi_cond_timedwait(void *cond, void *mutex, ulapi_real secs)
+{
+  int profiled = ulapi_profile_on;
+  DWORD msec;
+  int retval;
+
+  msec = (secs <= 0.0) ? 0 : (DWORD) (secs * 1000.0 + 0.5);
+
+  if (profiled) ulapi_profile_released(mutex);
+  retval = pthread_cond_timedwait_ms((pthread_cond_t *) cond, (pthread_mutex_t *) mutex, msec);
+  if (profiled) ulapi_profile_acquired(mutex, ULAPI_PROFILE_CALLER());
+
+  return (0 == retval ? ULAPI_OK : ULAPI_ERROR);
 }
 
 /* this needs to be static, not heap or stack */
@@ -1256,6 +2194,126 @@ ulapi_integer ulapi_socket_get_broadcastee_id(ulapi_integer port)
   return ulapi_socket_get_broadcastee_id_on_interface(port, NULL);
 }
 
+/*
+  For the multicast calls, \a intf is the multicast group (e.g.,
+  "239.255.0.1"); NULL is ULAPI_SOCKET_DEFAULT_MULTICAST_GROUP. Datagrams
+  are sent with a TTL of 1, so they stay on the local subnet, and are
+  looped back to listeners on the sending computer.
+
+  windows.h declares the Winsock 1 option numbers, which differ from
+  those of the Winsock 2 library ulapi is linked with, so the latter are
+  given here.
+*/
+
+#define ULAPI_WS2_IP_MULTICAST_TTL 10
+#define ULAPI_WS2_IP_MULTICAST_LOOP 11
+#define ULAPI_WS2_IP_ADD_MEMBERSHIP 12
+
+ulapi_integer ulapi_socket_get_multicaster_id_on_interface(ulapi_integer port, const char *intf)
+{
+  WSADATA wsaData;
+  int iResult;
+  struct sockaddr_in addr;
+  int fd;
+  DWORD ttl;
+  DWORD loop;
+
+  iResult = WSAStartup(MAKEWORD(2,2), &wsaData);
+  if (iResult != 0) {
+    return -1;
+  }
+
+  fd = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (0 > fd) {
+    return -1;
+  }
+
+  ttl = 1;
+  loop = 1;
+  if (0 > setsockopt(fd, IPPROTO_IP, ULAPI_WS2_IP_MULTICAST_TTL, (char *) &ttl, sizeof(ttl)) ||
+      0 > setsockopt(fd, IPPROTO_IP, ULAPI_WS2_IP_MULTICAST_LOOP, (char *) &loop, sizeof(loop))) {
+    closesocket(fd);
+    return -1;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = inet_addr(NULL == intf ? ULAPI_SOCKET_DEFAULT_MULTICAST_GROUP : intf);
+  addr.sin_port = htons(port);
+
+  if (-1 == connect(fd,
+        (struct sockaddr *) &addr,
+        sizeof(struct sockaddr_in))) {
+    PERROR("connect");
+    closesocket(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+ulapi_integer ulapi_socket_get_multicaster_id(ulapi_integer port)
+{
+  return ulapi_socket_get_multicaster_id_on_interface(port, NULL);
+}
+
+ulapi_integer ulapi_socket_get_multicastee_id_on_interface(ulapi_integer port, const char *intf)
+{
+  WSADATA wsaData;
+  int iResult;
+  struct sockaddr_in addr;
+  struct
+  {
+    struct in_addr imr_multiaddr;
+    struct in_addr imr_interface;
+  } mreq;
+  int fd;
+  BOOL reuse;
+
+  iResult = WSAStartup(MAKEWORD(2,2), &wsaData);
+  if (iResult != 0) {
+    return -1;
+  }
+
+  fd = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (0 > fd) {
+    return -1;
+  }
+
+  /* Let any number of listeners on this computer share the port */
+  reuse = TRUE;
+  if (0 > setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (char *) &reuse, sizeof(reuse))) {
+    closesocket(fd);
+    return -1;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+
+  if (0 > bind(fd, (struct sockaddr *) &addr, sizeof(addr))) {
+    closesocket(fd);
+    return -1;
+  }
+
+  memset(&mreq, 0, sizeof(mreq));
+  mreq.imr_multiaddr.s_addr = inet_addr(NULL == intf ? ULAPI_SOCKET_DEFAULT_MULTICAST_GROUP : intf);
+  mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+  if (0 > setsockopt(fd, IPPROTO_IP, ULAPI_WS2_IP_ADD_MEMBERSHIP, (char *) &mreq, sizeof(mreq))) {
+    PERROR("IP_ADD_MEMBERSHIP");
+    closesocket(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+ulapi_integer ulapi_socket_get_multicastee_id(ulapi_integer port)
+{
+  return ulapi_socket_get_multicastee_id_on_interface(port, NULL);
+}
+
 ulapi_result ulapi_socket_set_nonblocking(ulapi_integer fd)
 {
   /* FIXME-- implement this */
@@ -1268,6 +2326,17 @@ ulapi_result ulapi_socket_set_blocking(ulapi_integer fd)
   return ULAPI_ERROR;
 }
 
+ulapi_result ulapi_socket_set_nodelay(ulapi_integer fd)
+{
+  BOOL on = TRUE;
+
+  if (0 != setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const char *) &on, sizeof(on))) {
+    return ULAPI_ERROR;
+  }
+
+  return ULAPI_OK;
+}
+
 ulapi_integer ulapi_socket_read(ulapi_integer id,
         char *buf,
         ulapi_integer len)
@@ -1282,11 +2351,379 @@ ulapi_integer ulapi_socket_write(ulapi_integer id,
   return send(id, buf, len, 0);
 }
 
+ulapi_integer ulapi_socket_read_from(ulapi_integer id,
+        char *buf,
+        ulapi_integer len,
+        ulapi_integer *address,
+        ulapi_integer *port)
+{
+  struct sockaddr_in addr;
+  int addr_len;
+  int retval;
+
+  addr_len = sizeof(addr);
+  retval = recvfrom(id, buf, len, 0, (struct sockaddr *) &addr, &addr_len);
+  if (retval >= 0) {
+    if (NULL != address) *address = ntohl(addr.sin_addr.s_addr);
+    if (NULL != port) *port = ntohs(addr.sin_port);
+  }
+
+  return retval;
+}
+
+ulapi_integer ulapi_socket_write_to(ulapi_integer id,
+         ulapi_integer address,
+         ulapi_integer port,
+         const char *buf,
+         ulapi_integer len)
+{
+  struct sockaddr_in addr;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(address);
+  addr.sin_port = htons((u_short) port);
+
+  return sendto(id, buf, len, 0, (struct sockaddr *) &addr, sizeof(addr));
+}
+
+ulapi_result ulapi_socket_set_timestamps(ulapi_integer id,
+         ulapi_integer how)
+{
+  /* receive stamps need SIO_TIMESTAMPING, from Windows 10 on */
+  return (ULAPI_STAMP_OFF == how ? ULAPI_OK : ULAPI_IMPL_ERROR);
+}
+
+ulapi_integer ulapi_socket_read_stamped(ulapi_integer id,
+        char *buf,
+        ulapi_integer len,
+        ulapi_real *stamp)
+{
+  int retval;
+
+  retval = recv((SOCKET) id, buf, len, 0);
+  if (retval >= 0 && NULL != stamp) *stamp = ulapi_time();
+
+  return retval;
+}
+
+/*
+  Winsock 1 has no scatter/gather or batched calls, so these are loops
+  over the single-buffer calls. FIONREAD keeps the loops from blocking
+  once the data already queued has been taken.
+*/
+
+ulapi_integer ulapi_socket_readv(ulapi_integer id,
+        const ulapi_iovec *iov,
+        ulapi_integer count)
+{
+  ulapi_integer t, total;
+  u_long queued;
+  int retval;
+
+  if (count < 0) return -1;
+
+  for (t = 0, total = 0; t < count; t++) {
+    if (t > 0 && (0 != ioctlsocket((SOCKET) id, FIONREAD, &queued) || 0 == queued)) break;
+    retval = recv((SOCKET) id, iov[t].buf, iov[t].len, 0);
+    if (retval < 0) return (total > 0 ? total : -1);
+    total += retval;
+    if (retval < iov[t].len) break;
+  }
+
+  return total;
+}
+
+ulapi_integer ulapi_socket_writev(ulapi_integer id,
+         const ulapi_iovec *iov,
+         ulapi_integer count)
+{
+  enum {COALESCE = 4096};
+  char joined[COALESCE];
+  ulapi_integer t, total, sent;
+
+  if (count < 0) return -1;
+
+  /* short messages go out in one send, so Nagle does not hold back the tail */
+  for (t = 0, total = 0; t < count; t++) total += iov[t].len;
+  if (total <= COALESCE) {
+    for (t = 0, total = 0; t < count; t++) {
+      memcpy(joined + total, iov[t].buf, iov[t].len);
+      total += iov[t].len;
+    }
+    return send((SOCKET) id, joined, total, 0);
+  }
+
+  for (t = 0, total = 0; t < count; t++) {
+    sent = send((SOCKET) id, iov[t].buf, iov[t].len, 0);
+    if (sent < 0) return (total > 0 ? total : -1);
+    total += sent;
+    if (sent < iov[t].len) break;
+  }
+
+  return total;
+}
+
+ulapi_integer ulapi_socket_read_batch(ulapi_integer id,
+        ulapi_datagram *msgs,
+        ulapi_integer count)
+{
+  struct sockaddr_in addr;
+  int addr_len;
+  ulapi_integer total;
+  u_long queued;
+  int retval;
+
+  if (count < 0) return -1;
+
+  for (total = 0; total < count; total++) {
+    if (0 != ioctlsocket((SOCKET) id, FIONREAD, &queued)) return (total > 0 ? total : -1);
+    if (0 == queued) break;
+    addr_len = sizeof(addr);
+    retval = recvfrom((SOCKET) id, msgs[total].buf, msgs[total].size, 0, (struct sockaddr *) &addr, &addr_len);
+    if (retval < 0) {
+      /* a datagram longer than the buffer is truncated, as on Unix */
+      if (WSAEMSGSIZE != WSAGetLastError()) return (total > 0 ? total : -1);
+      retval = msgs[total].size;
+    }
+    msgs[total].len = retval;
+    msgs[total].address = ntohl(addr.sin_addr.s_addr);
+    msgs[total].port = ntohs(addr.sin_port);
+    msgs[total].stamp = ulapi_time();
+  }
+
+  return total;
+}
+
+ulapi_integer ulapi_socket_write_batch(ulapi_integer id,
+         const ulapi_datagram *msgs,
+         ulapi_integer count)
+{
+  struct sockaddr_in addr;
+  ulapi_integer total;
+  int retval;
+
+  if (count < 0) return -1;
+
+  for (total = 0; total < count; total++) {
+    if (0 == msgs[total].address && 0 == msgs[total].port) {
+      retval = send((SOCKET) id, msgs[total].buf, msgs[total].len, 0);
+    } else {
+      memset(&addr, 0, sizeof(addr));
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(msgs[total].address);
+      addr.sin_port = htons((u_short) msgs[total].port);
+      retval = sendto((SOCKET) id, msgs[total].buf, msgs[total].len, 0, (struct sockaddr *) &addr, sizeof(addr));
+    }
+    if (retval < 0) return (total > 0 ? total : -1);
+  }
+
+  return total;
+}
+
+ulapi_integer ulapi_socket_poll(const ulapi_integer *ids,
+        ulapi_integer *ready,
+        ulapi_integer count,
+        ulapi_real secs)
+{
+  fd_set rfds;
+  struct timeval tv;
+  ulapi_integer t;
+  int retval;
+
+  if (count < 0 || count > ULAPI_SOCKET_POLL_MAX || count > FD_SETSIZE) return -1;
+
+  FD_ZERO(&rfds);
+  for (t = 0; t < count; t++) {
+    FD_SET((SOCKET) ids[t], &rfds);
+  }
+
+  tv.tv_sec = (long) secs;
+  tv.tv_usec = (long) ((secs - tv.tv_sec) * 1.0e6);
+  retval = select(0, &rfds, NULL, NULL, secs < 0.0 ? NULL : &tv);
+  if (SOCKET_ERROR == retval) return -1;
+
+  for (t = 0; t < count; t++) {
+    ready[t] = FD_ISSET((SOCKET) ids[t], &rfds) ? 1 : 0;
+  }
+
+  return retval;
+}
+
 ulapi_result ulapi_socket_close(ulapi_integer id)
 {
   return 0 == closesocket((int) id) ? ULAPI_OK : ULAPI_ERROR;
 }
 
+/* Poller interface */
+
+/*
+  The set is kept here and handed to select on each wait. WSAPoll would
+  need Vista, and I/O completion ports report finished transfers rather
+  than readiness. The wake socket is a UDP socket connected to itself on
+  the loopback interface, kept in the first entry.
+*/
+typedef struct {
+  SOCKET ids[ULAPI_SOCKET_POLL_MAX + 1];
+  ulapi_integer events[ULAPI_SOCKET_POLL_MAX + 1];
+  void *data[ULAPI_SOCKET_POLL_MAX + 1];
+  int count;
+} poller_struct;
+
+static int poller_find(poller_struct *p, ulapi_integer id)
+{
+  int t;
+
+  for (t = 1; t < p->count; t++) {
+    if (p->ids[t] == (SOCKET) id) return t;
+  }
+
+  return -1;
+}
+
+void *ulapi_poller_new(void)
+{
+  poller_struct *p;
+  struct sockaddr_in addr;
+  int addr_len;
+  u_long on = 1;
+  SOCKET wake;
+  WSADATA wsaData;
+
+  if (0 != WSAStartup(MAKEWORD(2,2), &wsaData)) return NULL;
+
+  wake = socket(AF_INET, SOCK_DGRAM, 0);
+  if (INVALID_SOCKET == wake) return NULL;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  addr_len = sizeof(addr);
+  if (0 != bind(wake, (struct sockaddr *) &addr, sizeof(addr)) ||
+      0 != getsockname(wake, (struct sockaddr *) &addr, &addr_len) ||
+      0 != connect(wake, (struct sockaddr *) &addr, sizeof(addr)) ||
+      0 != ioctlsocket(wake, FIONBIO, &on) ||
+      NULL == (p = (poller_struct *) malloc(sizeof(poller_struct)))) {
+    closesocket(wake);
+    return NULL;
+  }
+
+  p->ids[0] = wake;
+  p->events[0] = ULAPI_POLL_READ;
+  p->data[0] = NULL;
+  p->count = 1;
+
+  return p;
+}
+
+ulapi_result ulapi_poller_delete(void *poller)
+{
+  poller_struct *p = (poller_struct *) poller;
+
+  if (NULL == p) return ULAPI_ERROR;
+
+  closesocket(p->ids[0]);
+  free(p);
+
+  return ULAPI_OK;
+}
+
+ulapi_result ulapi_poller_add(void *poller, ulapi_integer id, ulapi_integer events, void *data)
+{
+  poller_struct *p = (poller_struct *) poller;
+
+  if (NULL == p || poller_find(p, id) >= 0 || p->count > ULAPI_SOCKET_POLL_MAX) return ULAPI_ERROR;
+
+  p->ids[p->count] = (SOCKET) id;
+  p->events[p->count] = events;
+  p->data[p->count] = data;
+  p->count++;
+
+  return ULAPI_OK;
+}
+
+ulapi_result ulapi_poller_modify(void *poller, ulapi_integer id, ulapi_integer events, void *data)
+{
+  poller_struct *p = (poller_struct *) poller;
+  int t;
+
+  if (NULL == p || (t = poller_find(p, id)) < 0) return ULAPI_ERROR;
+
+  p->events[t] = events;
+  p->data[t] = data;
+
+  return ULAPI_OK;
+}
+
+ulapi_result ulapi_poller_remove(void *poller, ulapi_integer id)
+{
+  poller_struct *p = (poller_struct *) poller;
+  int t;
+
+  if (NULL == p || (t = poller_find(p, id)) < 0) return ULAPI_ERROR;
+
+  /* fill the gap with the last entry */
+  p->count--;
+  p->ids[t] = p->ids[p->count];
+  p->events[t] = p->events[p->count];
+  p->data[t] = p->data[p->count];
+
+  return ULAPI_OK;
+}
+
+ulapi_integer ulapi_poller_wait(void *poller, ulapi_poll_event *events, ulapi_integer max, ulapi_real secs)
+{
+  poller_struct *p = (poller_struct *) poller;
+  fd_set rfds, wfds, efds;
+  struct timeval tv;
+  char drain[64];
+  int retval, t, n;
+
+  if (NULL == p || max < 1) return -1;
+
+  FD_ZERO(&rfds);
+  FD_ZERO(&wfds);
+  FD_ZERO(&efds);
+  for (t = 0; t < p->count; t++) {
+    if (p->events[t] & ULAPI_POLL_READ) FD_SET(p->ids[t], &rfds);
+    if (p->events[t] & ULAPI_POLL_WRITE) FD_SET(p->ids[t], &wfds);
+    FD_SET(p->ids[t], &efds);
+  }
+
+  tv.tv_sec = (long) secs;
+  tv.tv_usec = (long) ((secs - tv.tv_sec) * 1.0e6);
+  retval = select(0, &rfds, &wfds, &efds, secs < 0.0 ? NULL : &tv);
+  if (SOCKET_ERROR == retval) return -1;
+
+  if (FD_ISSET(p->ids[0], &rfds)) {
+    while (recv(p->ids[0], drain, sizeof(drain), 0) > 0);
+  }
+  for (t = 1, n = 0; t < p->count && n < max; t++) {
+    events[n].events = (FD_ISSET(p->ids[t], &rfds) ? ULAPI_POLL_READ : 0) |
+      (FD_ISSET(p->ids[t], &wfds) ? ULAPI_POLL_WRITE : 0) |
+      (FD_ISSET(p->ids[t], &efds) ? ULAPI_POLL_ERROR : 0);
+    if (0 == events[n].events) continue;
+    /* select reports a closed connection as readable; the read returns 0 */
+    events[n].id = (ulapi_integer) p->ids[t];
+    events[n].data = p->data[t];
+    n++;
+  }
+
+  return n;
+}
+
+ulapi_result ulapi_poller_wake(void *poller)
+{
+  poller_struct *p = (poller_struct *) poller;
+  char one = 1;
+
+  if (NULL == p) return ULAPI_ERROR;
+
+  /* a full buffer means a wake is already pending */
+  return (1 == send(p->ids[0], &one, 1, 0) || WSAEWOULDBLOCK == WSAGetLastError()) ? ULAPI_OK : ULAPI_ERROR;
+}
+
 /* File descriptor interface */
 
 void *ulapi_fd_new(void)
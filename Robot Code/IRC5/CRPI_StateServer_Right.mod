@@ -4,82 +4,86 @@ MODULE CRPI_StateServer_Right
   VAR string state_client_ip;
   VAR bool state_connected:=FALSE;
 
+  ! State record, sent as one packed little-endian binary message per cycle:
+  !   Byte  0  UDINT  magic (0x43525049, "CRPI")
+  !   Byte  4  UDINT  sequence number
+  !   Byte  8  UDINT  controller time (ms)
+  !   Byte 12  7 x Float4  TCP position (mm) and orientation quaternion (q1..q4)
+  !   Byte 40  7 x Float4  joint positions (deg):  rax_1, rax_2, eax_a, rax_3..rax_6
+  !   Byte 68  7 x Float4  motor torques (Nm), 0 for eax_a
+  !   Byte 96  UDINT  digital inputs custom_DI_0..custom_DI_6 (bit 0 = custom_DI_0)
+  CONST num state_record_bytes:=100;
+  CONST dnum state_magic:=1129466953;
+  CONST num state_period:=0.004; ! 250 Hz
+  VAR dnum state_seq:=0;
+  VAR clock state_clock;
+
   ! @brief Main program loop
   !
   PROC CRPI_State_Right()
     VAR robtarget r_r_p;
     VAR jointtarget r_r_j;
-    VAR num psarry_l{8};
-    VAR string tstring;
-        
+    VAR rawbytes record;
+    VAR num di_bits;
+
     TPWrite("Running Right NIST CRPI State Server ");
+    ClkReset state_clock;
+    ClkStart state_clock;
     WHILE TRUE DO
-      ! ---------------------------------------------------------------  
+      r_r_p:=CRobT(\TaskRef:=T_ROB_RId \Tool:=tool0 \WObj:=wobj0);
+      r_r_j:=CJointT(\TaskRef:=T_ROB_RId);
+      di_bits:=custom_DI_0 + 2*custom_DI_1 + 4*custom_DI_2 + 8*custom_DI_3 + 16*custom_DI_4 + 32*custom_DI_5 + 64*custom_DI_6;
+      state_seq:=state_seq + 1;
+
+      ClearRawBytes record;
+      PackRawBytes state_magic, record, 1 \IntX:=UDINT;
+      PackRawBytes state_seq, record, 5 \IntX:=UDINT;
+      PackRawBytes Round(ClkRead(state_clock \HighRes)*1000), record, 9 \IntX:=UDINT;
+
+      ! ---------------------------------------------------------------
       !                        Cartesian Feedback
       ! ---------------------------------------------------------------
-      r_r_p:=CRobT(\TaskRef:=T_ROB_RId \Tool:=tool0 \WObj:=wobj0);
-      psarry_l{1}:=1;
-      psarry_l{2}:=Trunc(r_r_p.trans.x\Dec:=5);
-      psarry_l{3}:=Trunc(r_r_p.trans.y\Dec:=5);
-      psarry_l{4}:=Trunc(r_r_p.trans.z\Dec:=5);
-      psarry_l{5}:=Trunc(r_r_p.rot.q1\Dec:=5);
-      psarry_l{6}:=Trunc(r_r_p.rot.q2\Dec:=5);
-      psarry_l{7}:=Trunc(r_r_p.rot.q3\Dec:=5);
-      psarry_l{8}:=Trunc(r_r_p.rot.q4\Dec:=5);
-      tstring:=ValToStr(psarry_l);
-      ! Return robot status to the client
-      SocketSend state_client_socket \Str:=tstring+"\00";
+      PackRawBytes r_r_p.trans.x, record, 13 \Float4;
+      PackRawBytes r_r_p.trans.y, record, 17 \Float4;
+      PackRawBytes r_r_p.trans.z, record, 21 \Float4;
+      PackRawBytes r_r_p.rot.q1, record, 25 \Float4;
+      PackRawBytes r_r_p.rot.q2, record, 29 \Float4;
+      PackRawBytes r_r_p.rot.q3, record, 33 \Float4;
+      PackRawBytes r_r_p.rot.q4, record, 37 \Float4;
 
-      ! ---------------------------------------------------------------  
+      ! ---------------------------------------------------------------
       !                          Joint Feedback
       ! ---------------------------------------------------------------
-      r_r_j:=CJointT(\TaskRef:=T_ROB_RId);
-      psarry_l{1}:=2;
-      psarry_l{2}:=Trunc(r_r_j.robax.rax_1\Dec:=5);
-      psarry_l{3}:=Trunc(r_r_j.robax.rax_2\Dec:=5);
-      psarry_l{4}:=Trunc(r_r_j.extax.eax_a\Dec:=5);
-      psarry_l{5}:=Trunc(r_r_j.robax.rax_3\Dec:=5);
-      psarry_l{6}:=Trunc(r_r_j.robax.rax_4\Dec:=5);
-      psarry_l{7}:=Trunc(r_r_j.robax.rax_5\Dec:=5);
-      psarry_l{8}:=Trunc(r_r_j.robax.rax_6\Dec:=5);
-      tstring:=ValToStr(psarry_l);
-      ! Return robot status to the client
-      SocketSend state_client_socket \Str:=tstring+"\00";
+      PackRawBytes r_r_j.robax.rax_1, record, 41 \Float4;
+      PackRawBytes r_r_j.robax.rax_2, record, 45 \Float4;
+      PackRawBytes r_r_j.extax.eax_a, record, 49 \Float4;
+      PackRawBytes r_r_j.robax.rax_3, record, 53 \Float4;
+      PackRawBytes r_r_j.robax.rax_4, record, 57 \Float4;
+      PackRawBytes r_r_j.robax.rax_5, record, 61 \Float4;
+      PackRawBytes r_r_j.robax.rax_6, record, 65 \Float4;
 
-      ! ---------------------------------------------------------------  
+      ! ---------------------------------------------------------------
       !                       Joint Torque Feedback
       ! ---------------------------------------------------------------
-      psarry_l{1}:=3;
-      psarry_l{2}:=Trunc(GetMotorTorque(1)\Dec:=5);
-      psarry_l{3}:=Trunc(GetMotorTorque(2)\Dec:=5);
-      psarry_l{4}:=0;
-      psarry_l{5}:=Trunc(GetMotorTorque(3)\Dec:=5);
-      psarry_l{6}:=Trunc(GetMotorTorque(4)\Dec:=5);
-      psarry_l{7}:=Trunc(GetMotorTorque(5)\Dec:=5);
-      psarry_l{8}:=Trunc(GetMotorTorque(6)\Dec:=5);
-      tstring:=ValToStr(psarry_l);
-      ! Return robot status to the client
-      SocketSend state_client_socket \Str:=tstring+"\00";
+      PackRawBytes GetMotorTorque(1), record, 69 \Float4;
+      PackRawBytes GetMotorTorque(2), record, 73 \Float4;
+      PackRawBytes 0, record, 77 \Float4;
+      PackRawBytes GetMotorTorque(3), record, 81 \Float4;
+      PackRawBytes GetMotorTorque(4), record, 85 \Float4;
+      PackRawBytes GetMotorTorque(5), record, 89 \Float4;
+      PackRawBytes GetMotorTorque(6), record, 93 \Float4;
 
-      ! ---------------------------------------------------------------  
-      !                           Digital Inputs 
       ! ---------------------------------------------------------------
-      psarry_l{1}:=4;
-      psarry_l{2}:=custom_DI_0;
-      psarry_l{3}:=custom_DI_1;
-      psarry_l{4}:=custom_DI_2;
-      psarry_l{5}:=custom_DI_3;
-      psarry_l{6}:=custom_DI_4;
-      psarry_l{7}:=custom_DI_5;
-      psarry_l{8}:=custom_DI_6;
+      !                           Digital Inputs
+      ! ---------------------------------------------------------------
+      PackRawBytes di_bits, record, 97 \IntX:=UDINT;
 
-      tstring:=ValToStr(psarry_l);
       ! Return robot status to the client
-      SocketSend state_client_socket \Str:=tstring+"\00";
+      SocketSend state_client_socket \RawData:=record \NoOfBytes:=state_record_bytes;
 
-      WaitTime 0.03; ! 30 Hz
+      WaitTime state_period;
     ENDWHILE
-    
+
     ERROR
       IF ERRNO=ERR_SOCK_TIMEOUT THEN
         RETRY;
@@ -91,7 +95,7 @@ MODULE CRPI_StateServer_Right
       ENDIF
   ENDPROC
 
-  
+
   ! @brief Recover from socket communication errors
   !
   PROC CRPI_Recover_State_Right()
@@ -231,6 +231,27 @@ def cleanAll():
 	return
 
 
+#Build and run the CPU micro-benchmarks on their recorded samples
+#Results are written to Applications/CPU_Bench/cpu_bench.json
+def makeBench():
+	root = os.getcwd()
+	cd("Applications/CPU_Bench")
+	print("CPU Bench")
+	flag = bash("make bench")
+	cd(root)
+	return flag
+
+#Compare the CPU micro-benchmarks against their stored baseline,
+#or record the baseline (see Applications/CPU_Bench/perf_check.py)
+#Reports are written to Applications/CPU_Bench/perf
+def makePerf(target):
+	root = os.getcwd()
+	cd("Applications/CPU_Bench")
+	print("CPU Bench " + target)
+	flag = bash("make " + target)
+	cd(root)
+	return flag
+
 def clean():
 	cmd = "make clean"
 	return bash(cmd)
@@ -263,6 +284,13 @@ def main(argv):
 			makeAll()
 		elif argv[1] ==  '-c':
 			cleanAll()
+		elif argv[1] == '-bench':
+			makeBench()
+		elif argv[1] == '-perf':
+			if makePerf("perf-check") != 0:
+				sys.exit(1)
+		elif argv[1] == '-perf-baseline':
+			makePerf("perf-baseline")
 		elif argv[1] == '-plus':
 			if len(argv) > 2:
 				for i in argv: